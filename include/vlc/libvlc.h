@@ -620,6 +620,162 @@ libvlc_module_description_t *libvlc_video_filter_list_get( libvlc_instance_t *p_
 
 /** @} */
 
+/** \defgroup libvlc_latency LibVLC pipeline latency
+ * Histograms of the time spent in each stage of the playback pipeline, by
+ * all the media players of an instance. They are only collected if the
+ * instance was created with the "--latency-stats" option.
+ * @{
+ */
+
+/**
+ * Stages of the playback pipeline.
+ */
+typedef enum libvlc_latency_stage_t
+{
+    libvlc_latency_demux,         /**< demultiplexer calls */
+    libvlc_latency_decoder_queue, /**< wait in the decoder queues */
+    libvlc_latency_decode,        /**< decoder calls */
+    libvlc_latency_filter,        /**< video filter chains */
+    libvlc_latency_render,        /**< subtitles blending and display prepare */
+    libvlc_latency_display,       /**< picture display calls */
+    libvlc_latency_lateness,      /**< picture display after its date */
+} libvlc_latency_stage_t;
+
+/**
+ * Number of buckets of a latency histogram.
+ *
+ * The first bucket counts the durations of less than one microsecond, and
+ * the N-th counts those from 2^(N-1) (included) to 2^N (excluded)
+ * microseconds. The last bucket also counts all longer durations.
+ */
+#define LIBVLC_LATENCY_BUCKETS 24
+
+/**
+ * Gets the latency histogram of a pipeline stage.
+ *
+ * The buckets are updated concurrently, so the histogram is not an exact
+ * snapshot if media are playing.
+ *
+ * \param p_instance libvlc instance
+ * \param stage pipeline stage
+ * \param counts table of count buckets to fill [OUT]
+ * \param count size of the table, normally LIBVLC_LATENCY_BUCKETS
+ * \return the number of buckets filled, or -1 if the statistics are not
+ * collected
+ * \version LibVLC 3.0.0 and later.
+ */
+LIBVLC_API
+int libvlc_latency_histogram( libvlc_instance_t *p_instance,
+                              libvlc_latency_stage_t stage,
+                              uint64_t *counts, unsigned count );
+
+/**
+ * Zeroes the latency histograms of all the pipeline stages.
+ *
+ * \param p_instance libvlc instance
+ * \version LibVLC 3.0.0 and later.
+ */
+LIBVLC_API
+void libvlc_latency_reset( libvlc_instance_t *p_instance );
+
+/** @} */
+
+/** \defgroup libvlc_memory LibVLC memory usage
+ * Memory held by the buffers of the playback pipeline (stream caches,
+ * decoder queues...), per component. The accounting covers the whole
+ * process, i.e. all the LibVLC instances. The budget is set with the
+ * "--memory-budget" option.
+ * @{
+ */
+
+/**
+ * Memory usage of a component.
+ */
+typedef struct libvlc_memory_usage_t
+{
+    char *psz_component; /**< component name */
+    uint64_t i_usage;    /**< current usage in bytes */
+    uint64_t i_peak;     /**< sum of the peak usages of the current users */
+    unsigned i_users;    /**< number of buffers of the component */
+    struct libvlc_memory_usage_t *p_next;
+} libvlc_memory_usage_t;
+
+/**
+ * Gets the memory usage of each component.
+ *
+ * \param p_instance libvlc instance
+ * \return a list of usages, to release with
+ * libvlc_memory_usage_list_release(), or NULL if there is no usage to
+ * report or on error
+ * \version LibVLC 3.0.0 and later.
+ */
+LIBVLC_API
+libvlc_memory_usage_t *libvlc_memory_usage_get( libvlc_instance_t *p_instance );
+
+/**
+ * Releases a list of memory usages.
+ *
+ * \param p_list the list to be released
+ * \version LibVLC 3.0.0 and later.
+ */
+LIBVLC_API
+void libvlc_memory_usage_list_release( libvlc_memory_usage_t *p_list );
+
+/** @} */
+
+/** \defgroup libvlc_cputime LibVLC module CPU time
+ * CPU time spent in each module (demuxers, packetizers, decoders, filters
+ * and stream outputs) by all the media players of an instance. It is only
+ * measured if the instance was created with the "--cpu-stats" option.
+ * @{
+ */
+
+/**
+ * CPU time spent in a module.
+ */
+typedef struct libvlc_module_cputime_t
+{
+    char *psz_name;       /**< module name */
+    char *psz_capability; /**< module capability */
+    uint64_t i_calls;     /**< number of calls to the module */
+    uint64_t i_self;      /**< CPU time in the module itself (ns) */
+    uint64_t i_total;     /**< CPU time including the modules it called,
+                               e.g. the next stream outputs of a chain (ns) */
+    struct libvlc_module_cputime_t *p_next;
+} libvlc_module_cputime_t;
+
+/**
+ * Gets the CPU time spent in each module, hottest first.
+ *
+ * \param p_instance libvlc instance
+ * \return a list of CPU times in decreasing order of self time, to release
+ * with libvlc_module_cputime_list_release(), or NULL if no module was
+ * called, if the statistics are not collected or on error
+ * \version LibVLC 3.0.0 and later.
+ */
+LIBVLC_API
+libvlc_module_cputime_t *libvlc_module_cputime_get( libvlc_instance_t *p_instance );
+
+/**
+ * Releases a list of module CPU times.
+ *
+ * \param p_list the list to be released
+ * \version LibVLC 3.0.0 and later.
+ */
+LIBVLC_API
+void libvlc_module_cputime_list_release( libvlc_module_cputime_t *p_list );
+
+/**
+ * Zeroes the CPU times of all the modules.
+ *
+ * \param p_instance libvlc instance
+ * \version LibVLC 3.0.0 and later.
+ */
+LIBVLC_API
+void libvlc_module_cputime_reset( libvlc_instance_t *p_instance );
+
+/** @} */
+
 /** \defgroup libvlc_clock LibVLC time
  * These functions provide access to the LibVLC time/clock.
  * @{
@@ -792,6 +792,108 @@ void libvlc_media_tracks_release( libvlc_media_track_t **p_tracks,
 LIBVLC_API
 libvlc_media_type_t libvlc_media_get_type( libvlc_media_t *p_md );
 
+/**
+ * Extract a thumbnail of the media descriptor object
+ *
+ * The media is opened and decoded synchronously on the calling thread,
+ * without any media player, video nor audio output. It is seeked to the
+ * keyframe nearest to the given time, and only that frame is decoded, so the
+ * thumbnail is not taken at the exact requested time.
+ *
+ * \version LibVLC 3.0.0 and later.
+ *
+ * \param p_md media descriptor object
+ * \param i_time time of the thumbnail (in ms), 0 for the start
+ * \param i_width width of the thumbnail, or 0 to keep the aspect ratio
+ * \param i_height height of the thumbnail, or 0 to keep the aspect ratio
+ *        (if both are 0, the original size is used)
+ * \param psz_format image format ("png", "jpeg"...), NULL for PNG
+ * \param pi_size where to store the size of the image [OUT]
+ *
+ * \return the encoded image, to be released with libvlc_free(),
+ *         or NULL on error
+ */
+LIBVLC_API
+unsigned char *libvlc_media_thumbnail( libvlc_media_t *p_md,
+                                       libvlc_time_t i_time,
+                                       unsigned i_width, unsigned i_height,
+                                       const char *psz_format,
+                                       size_t *pi_size );
+
+/**
+ * Opaque thumbnails strip of a media
+ */
+typedef struct libvlc_media_thumbnails_t libvlc_media_thumbnails_t;
+
+/**
+ * Start generating a thumbnails strip of the media descriptor object
+ *
+ * A thumbnail is extracted at every interval, as with
+ * libvlc_media_thumbnail(), on a background thread which reuses a single
+ * demuxer and decoder. This does not involve nor disturb any media player
+ * of the media. The thumbnails can be fetched while they are generated.
+ *
+ * \version LibVLC 3.0.0 and later.
+ *
+ * \param p_md media descriptor object
+ * \param i_interval time between two thumbnails (in ms)
+ * \param i_width width of the thumbnails, or 0 to keep the aspect ratio
+ * \param i_height height of the thumbnails, or 0 to keep the aspect ratio
+ *        (if both are 0, the original size is used)
+ * \param psz_format image format ("png", "jpeg"...), NULL for PNG
+ *
+ * \return the thumbnails strip, to be released with
+ *         libvlc_media_thumbnails_release(), or NULL on error
+ */
+LIBVLC_API
+libvlc_media_thumbnails_t *libvlc_media_thumbnails_new( libvlc_media_t *p_md,
+                                                      libvlc_time_t i_interval,
+                                                      unsigned i_width,
+                                                      unsigned i_height,
+                                                      const char *psz_format );
+
+/**
+ * Stop generating and release a thumbnails strip
+ *
+ * \version LibVLC 3.0.0 and later.
+ *
+ * \param p_strip thumbnails strip
+ */
+LIBVLC_API
+void libvlc_media_thumbnails_release( libvlc_media_thumbnails_t *p_strip );
+
+/**
+ * Get the number of thumbnails in a strip
+ *
+ * The thumbnail of index i is taken at i times the interval.
+ *
+ * \version LibVLC 3.0.0 and later.
+ *
+ * \param p_strip thumbnails strip
+ *
+ * \return the number of thumbnails, or 0 if the length of the media is not
+ *         known yet
+ */
+LIBVLC_API
+unsigned libvlc_media_thumbnails_count( libvlc_media_thumbnails_t *p_strip );
+
+/**
+ * Get a thumbnail of a strip
+ *
+ * \version LibVLC 3.0.0 and later.
+ *
+ * \param p_strip thumbnails strip
+ * \param i_index index of the thumbnail
+ * \param pi_size where to store the size of the image [OUT]
+ *
+ * \return the encoded image, to be released with libvlc_free(),
+ *         or NULL if it is not generated (yet)
+ */
+LIBVLC_API
+unsigned char *libvlc_media_thumbnails_get( libvlc_media_thumbnails_t *p_strip,
+                                            unsigned i_index,
+                                            size_t *pi_size );
+
 /** @}*/
 
 # ifdef __cplusplus
@@ -219,6 +219,20 @@ LIBVLC_API
 void libvlc_media_list_player_set_playback_mode(libvlc_media_list_player_t * p_mlp,
                                                 libvlc_playback_mode_t e_mode );
 
+/**
+ * Sets how long before the end of the playing item the next one is opened,
+ * so that it starts without a gap. The next item is opened by default 5
+ * seconds before.
+ *
+ * \param p_mlp media list player instance
+ * \param i_time the time before the end of the item (in ms), or 0 to only
+ *               open the next item once the playing one is over
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API
+void libvlc_media_list_player_set_preload_time(libvlc_media_list_player_t * p_mlp,
+                                               libvlc_time_t i_time );
+
 /** @} media_list_player */
 
 # ifdef __cplusplus
@@ -264,6 +264,23 @@ LIBVLC_API void libvlc_media_player_pause ( libvlc_media_player_t *p_mi );
  */
 LIBVLC_API void libvlc_media_player_stop ( libvlc_media_player_t *p_mi );
 
+/**
+ * Reset the media player to a clean state, so that it can be reused for
+ * another media instead of being destroyed and created again.
+ *
+ * Playback is stopped and the media is detached. The playback and rendering
+ * settings (rate, video adjustments, marquee, logo, deinterlacing, cropping,
+ * aspect ratio, equalizer, title display...) are restored to their defaults.
+ *
+ * The output configuration (video and audio callbacks, drawables, output
+ * modules) is kept, and so are the plug-ins already loaded by the LibVLC
+ * instance, which are shared by all its media players.
+ *
+ * \param p_mi the Media Player
+ * \version LibVLC 3.0.0 and later.
+ */
+LIBVLC_API void libvlc_media_player_reset ( libvlc_media_player_t *p_mi );
+
 /**
  * Callback prototype to allocate and lock a picture buffer.
  *
@@ -706,6 +723,18 @@ LIBVLC_API libvlc_time_t libvlc_media_player_get_length( libvlc_media_player_t *
  */
 LIBVLC_API libvlc_time_t libvlc_media_player_get_time( libvlc_media_player_t *p_mi );
 
+/**
+ * Get the current playback latency (in ms): the delay between the reception
+ * of the media data and its presentation, as measured by the player.
+ * This is mostly relevant for live sources, see also the "low-latency"
+ * option.
+ *
+ * \param p_mi the Media Player
+ * \return the latency (in ms), or -1 if there is no media.
+ * \version LibVLC 3.0.0 and later.
+ */
+LIBVLC_API libvlc_time_t libvlc_media_player_get_latency( libvlc_media_player_t *p_mi );
+
 /**
  * Set the movie time (in ms). This has no effect if no media is being played.
  * Not all formats and protocols support this.
@@ -335,6 +335,17 @@ VLC_API void aout_FiltersDelete(vlc_object_t *, aout_filters_t *);
 #define aout_FiltersDelete(o,f) \
         aout_FiltersDelete(VLC_OBJECT(o),f)
 VLC_API bool aout_FiltersAdjustResampling(aout_filters_t *, int);
+
+/**
+ * Gets the playback latency that audio outputs should aim for.
+ * Outputs that can size their buffer should do so accordingly.
+ * \return the target latency, or 0 to keep the output defaults
+ */
+static inline mtime_t aout_LatencyTarget(vlc_object_t *obj)
+{
+    return var_InheritInteger(obj, "audio-latency") * (CLOCK_FREQ / 1000);
+}
+#define aout_LatencyTarget(o) aout_LatencyTarget(VLC_OBJECT(o))
 VLC_API block_t *aout_FiltersPlay(aout_filters_t *, block_t *, int rate);
 
 VLC_API vout_thread_t * aout_filter_RequestVout( filter_t *, vout_thread_t *p_vout, video_format_t *p_fmt );
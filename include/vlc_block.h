@@ -179,6 +179,46 @@ static inline void block_Cleanup (void *block)
 }
 #define block_cleanup_push( block ) vlc_cleanup_push (block_Cleanup, block)
 
+/****************************************************************************
+ * Shared blocks:
+ ****************************************************************************
+ * - block_Shareable : turn a block into a view of its payload, which can be
+ *      shared without copying.
+ * - block_Share : create another view of the payload of a shareable block,
+ *      or a copy of any other block.
+ * - block_ShareRange : same as block_Share, for a part of the payload only.
+ * - block_ChainJoin : join views of consecutive parts of the same payload
+ *      into one view, without copying.
+ * - block_Unshare : make the payload of a block private before modifying it
+ *      in place; only copies it if it is shared.
+ * Views of a shared payload are read-only. block_Realloc() copies the payload
+ * of a view when it needs to grow it.
+ ****************************************************************************/
+VLC_API block_t *block_Shareable(block_t *) VLC_USED;
+VLC_API block_t *block_Share(block_t *) VLC_USED;
+VLC_API block_t *block_ShareRange(block_t *, size_t, size_t) VLC_USED;
+VLC_API block_t *block_ChainJoin(block_t *) VLC_USED;
+VLC_API block_t *block_Unshare(block_t *) VLC_USED;
+
+/****************************************************************************
+ * Pools of blocks:
+ ****************************************************************************
+ * - block_PoolNew : create a pool recycling blocks of up to a given payload
+ *      size, keeping at most a given number of idle blocks.
+ * - block_PoolDelete : release a pool. Blocks still in use remain valid.
+ * - block_PoolAlloc : allocate a block from a pool. The block is released
+ *      with block_Release(), which returns it to the pool.
+ * - block_PoolGetStats : get the number of recycled (hits) and heap (misses)
+ *      allocations.
+ ****************************************************************************/
+typedef struct block_pool_t block_pool_t;
+
+VLC_API block_pool_t *block_PoolNew(size_t size, unsigned max) VLC_USED;
+VLC_API void block_PoolDelete(block_pool_t *);
+VLC_API block_t *block_PoolAlloc(block_pool_t *, size_t) VLC_USED;
+VLC_API void block_PoolGetStats(block_pool_t *, uint64_t *hits,
+                                uint64_t *misses);
+
 /****************************************************************************
  * Chains of blocks functions helper
  ****************************************************************************
@@ -189,7 +229,8 @@ static inline void block_Cleanup (void *block)
  *      and update it.
  * - block_ChainRelease : release a chain of block
  * - block_ChainExtract : extract data from a chain, return real bytes counts
- * - block_ChainGather : gather a chain, free it and return one block.
+ * - block_ChainGather : gather a chain, free it and return one block;
+ *      does not copy consecutive views of the same payload (block_ChainJoin).
  ****************************************************************************/
 static inline void block_ChainAppend( block_t **pp_list, block_t *p_block )
 {
@@ -276,6 +317,10 @@ static inline block_t *block_ChainGather( block_t *p_list )
     if( p_list->p_next == NULL )
         return p_list;  /* Already gathered */
 
+    g = block_ChainJoin( p_list );
+    if( g != NULL )
+        return g;
+
     block_ChainProperties( p_list, NULL, &i_total, &i_length );
 
     g = block_Alloc( i_total );
@@ -297,6 +342,9 @@ static inline block_t *block_ChainGather( block_t *p_list )
  * Fifos of blocks.
  ****************************************************************************
  * - block_FifoNew : create and init a new fifo
+ * - block_FifoNewSPSC : create a lock-less fifo for exactly one producer
+ *      and one consumer thread. Only block_FifoPut/Get/Show/Empty/Count/Size
+ *      can be used with it (not the vlc_fifo_* functions).
  * - block_FifoRelease : destroy a fifo and free all blocks in it.
  * - block_FifoEmpty : free all blocks in a fifo
  * - block_FifoPut : put a block
@@ -310,6 +358,7 @@ static inline block_t *block_ChainGather( block_t *p_list )
  ****************************************************************************/
 
 VLC_API block_fifo_t *block_FifoNew( void ) VLC_USED VLC_MALLOC;
+VLC_API block_fifo_t *block_FifoNewSPSC( void ) VLC_USED VLC_MALLOC;
 VLC_API void block_FifoRelease( block_fifo_t * );
 VLC_API void block_FifoEmpty( block_fifo_t * );
 VLC_API void block_FifoPut( block_fifo_t *, block_t * );
@@ -325,6 +374,7 @@ VLC_API void vlc_fifo_Unlock(vlc_fifo_t *);
 VLC_API void vlc_fifo_Signal(vlc_fifo_t *);
 VLC_API void vlc_fifo_Wait(vlc_fifo_t *);
 VLC_API void vlc_fifo_WaitCond(vlc_fifo_t *, vlc_cond_t *);
+VLC_API int vlc_fifo_TimedWaitCond(vlc_fifo_t *, vlc_cond_t *, mtime_t);
 VLC_API void vlc_fifo_QueueUnlocked(vlc_fifo_t *, block_t *);
 VLC_API block_t *vlc_fifo_DequeueUnlocked(vlc_fifo_t *) VLC_USED;
 VLC_API block_t *vlc_fifo_DequeueAllUnlocked(vlc_fifo_t *) VLC_USED;
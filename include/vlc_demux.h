@@ -97,6 +97,9 @@ typedef struct demux_meta_t
 
     int i_attachments;                  /**< number of attachments */
     input_attachment_t **attachments;    /**< array of attachments */
+
+    mtime_t i_duration;                 /**< duration, 0 if unknown */
+    es_format_t fmt;                    /**< main track, UNKNOWN_ES if none */
 } demux_meta_t;
 
 enum demux_query_e
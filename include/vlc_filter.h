@@ -236,6 +236,96 @@ VLC_API int filter_Blend( filter_t *, picture_t *p_dst, int i_dst_x, int i_dst_y
  */
 VLC_API void filter_DeleteBlend( filter_t * );
 
+/**
+ * Slice-parallel picture processing.
+ *
+ * Video filters can split the lines of a picture in horizontal bands
+ * (slices), and process them concurrently on a pool of worker threads.
+ */
+typedef struct filter_slices_t filter_slices_t;
+
+/**
+ * Callback processing one slice.
+ *
+ * \param opaque data pointer given to filter_RunSlices()
+ * \param slice index of the slice, from 0 to slices - 1
+ * \param slices total number of slices
+ */
+typedef void (*filter_slice_cb)( void *opaque, unsigned slice, unsigned slices );
+
+/**
+ * It creates a pool of slice worker threads.
+ *
+ * \param threads maximum number of threads processing slices, including
+ * the calling thread, or 0 to use one per CPU
+ * \return the pool, or NULL on error
+ */
+VLC_API filter_slices_t * filter_NewSlices( vlc_object_t *, unsigned threads ) VLC_USED;
+#define filter_NewSlices(o, t) filter_NewSlices(VLC_OBJECT(o), t)
+
+/**
+ * It runs a callback on every slice of a picture, and waits for all of
+ * them to complete.
+ *
+ * The number of slices depends on the number of threads and on the
+ * number of lines, so that slices are not too small. The calling thread
+ * processes slices too. This function must not be called from more than one
+ * thread at a time for a given pool.
+ *
+ * \param lines number of picture lines to split
+ */
+VLC_API void filter_RunSlices( filter_slices_t *, unsigned lines, filter_slice_cb, void *opaque );
+
+/**
+ * It runs a callback on a given number of independent tasks, such as the
+ * planes of a picture, and waits for all of them to complete.
+ *
+ * Unlike filter_RunSlices(), the number of tasks is not adjusted: the
+ * callback is called exactly once for each task, from 0 to tasks - 1.
+ *
+ * \param tasks number of tasks
+ */
+VLC_API void filter_RunTasks( filter_slices_t *, unsigned tasks, filter_slice_cb, void *opaque );
+
+/**
+ * It destroys a pool created by filter_NewSlices.
+ */
+VLC_API void filter_DeleteSlices( filter_slices_t * );
+
+/**
+ * It computes the range [*first, *end[ of a slice out of a number of lines.
+ */
+static inline void filter_GetSliceLines( int lines, unsigned slice,
+                                         unsigned slices,
+                                         int *first, int *end )
+{
+    *first = (int64_t)lines * slice / slices;
+    *end = (int64_t)lines * (slice + 1) / slices;
+}
+
+/**
+ * It fills a view of a picture restricted to the visible lines of one slice
+ * in every plane.
+ *
+ * The view shares the pixels of the picture, and must neither be held nor
+ * released.
+ */
+static inline void filter_SlicePicture( picture_t *view, const picture_t *pic,
+                                        unsigned slice, unsigned slices )
+{
+    *view = *pic;
+    for( int i = 0; i < pic->i_planes; i++ )
+    {
+        const plane_t *p = &pic->p[i];
+        int first, end;
+
+        filter_GetSliceLines( p->i_visible_lines, slice, slices, &first, &end );
+        view->p[i].p_pixels = p->p_pixels + first * p->i_pitch;
+        view->p[i].i_lines = end - first;
+        view->p[i].i_visible_lines = end - first;
+    }
+}
+
 /**
  * Create a picture_t *(*)( filter_t *, picture_t * ) compatible wrapper
  * using a void (*)( filter_t *, picture_t *, picture_t * ) function
@@ -126,6 +126,11 @@ typedef int (*httpd_file_callback_t)( httpd_file_sys_t *, httpd_file_t *, uint8_
 VLC_API httpd_file_t * httpd_FileNew( httpd_host_t *, const char *psz_url, const char *psz_mime, const char *psz_user, const char *psz_password, httpd_file_callback_t pf_fill, httpd_file_sys_t * ) VLC_USED;
 VLC_API httpd_file_sys_t * httpd_FileDelete( httpd_file_t * );
 
+/* Local file served as is, with byte ranges and cache validators */
+typedef struct httpd_vod_t httpd_vod_t;
+VLC_API httpd_vod_t * httpd_VodNew( httpd_host_t *, const char *psz_url, const char *psz_path, const char *psz_mime, const char *psz_user, const char *psz_password ) VLC_USED;
+VLC_API void httpd_VodDelete( httpd_vod_t * );
+
 
 typedef struct httpd_handler_t  httpd_handler_t;
 typedef struct httpd_handler_sys_t httpd_handler_sys_t;
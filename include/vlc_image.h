@@ -67,6 +67,78 @@ VLC_API void image_HandlerDelete( image_handler_t * );
 #define image_WriteUrl( a, b, c, d, e ) a->pf_write_url( a, b, c, d, e )
 #define image_Convert( a, b, c, d ) a->pf_convert( a, b, c, d )
 
+/**
+ * \defgroup image_async Asynchronous image reading
+ * @{
+ * Reads, decodes and scales images on worker threads dedicated to blocking I/O,
+ * so that user interfaces can load many covers or thumbnails concurrently
+ * without blocking. The resulting pictures are kept in a cache keyed by the
+ * URL and the requested output format, whose size is accounted with the
+ * memory budget.
+ */
+
+typedef struct image_async_t image_async_t;
+typedef struct image_request_t image_request_t;
+
+/**
+ * Completion callback of an asynchronous read.
+ *
+ * It is called from a worker thread, at most once per request and never
+ * after image_AsyncCancel() has returned.
+ *
+ * \param p_pic decoded picture, or NULL on error. The callback owns the
+ *              reference, but the picture may be shared with the cache and
+ *              other requests: it must not be modified.
+ * \param p_fmt format of the picture (only valid during the call)
+ */
+typedef void (*image_async_cb)( void *p_opaque, picture_t *p_pic,
+                                const video_format_t *p_fmt );
+
+/**
+ * Creates an asynchronous image reader.
+ *
+ * \param p_parent parent object of the decoders and filters, which must
+ *                 outlive the reader
+ * \param i_cache maximum size of the picture cache in bytes (0 disables it)
+ */
+VLC_API image_async_t *image_AsyncCreate( vlc_object_t *p_parent,
+                                          size_t i_cache ) VLC_USED;
+#define image_AsyncCreate( a, b ) image_AsyncCreate( VLC_OBJECT(a), b )
+
+/**
+ * Deletes an asynchronous image reader and flushes its cache.
+ *
+ * All its requests must have been cancelled.
+ */
+VLC_API void image_AsyncDelete( image_async_t * );
+
+/**
+ * Reads an image asynchronously.
+ *
+ * The formats are the same as for image_ReadUrl(). Every request must
+ * eventually be cancelled with image_AsyncCancel(), even after its
+ * callback was called.
+ *
+ * \return a request, or NULL on error (the callback will not be called)
+ */
+VLC_API image_request_t *image_AsyncReadUrl( image_async_t *,
+                                             const char *psz_url,
+                                             const video_format_t *p_fmt_in,
+                                             const video_format_t *p_fmt_out,
+                                             image_async_cb pf_done,
+                                             void *p_opaque ) VLC_USED;
+
+/**
+ * Cancels and releases a request.
+ *
+ * If the callback has not been called yet, it will not be, and the pending
+ * I/O is interrupted. If the callback is running, this function waits for
+ * it to return, so it must not be called from the callback itself.
+ */
+VLC_API void image_AsyncCancel( image_request_t * );
+
+/** @} */
+
 VLC_API vlc_fourcc_t image_Type2Fourcc( const char *psz_name );
 VLC_API vlc_fourcc_t image_Ext2Fourcc( const char *psz_name );
 VLC_API vlc_fourcc_t image_Mime2Fourcc( const char *psz_mime );
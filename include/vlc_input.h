@@ -502,6 +502,34 @@ VLC_API void input_Stop( input_thread_t * );
 VLC_API int input_Read( vlc_object_t *, input_item_t * );
 #define input_Read(a,b) input_Read(VLC_OBJECT(a),b)
 
+/**
+ * Extracts a thumbnail from an input item, without any input thread nor
+ * video output: the media is seeked to the keyframe nearest to i_time and
+ * only that frame is decoded.
+ *
+ * i_format is the image codec (e.g. VLC_CODEC_PNG) and i_width/i_height
+ * are handled as in picture_Export().
+ *
+ * \return the encoded image, or NULL on error
+ */
+VLC_API block_t *input_GetThumbnail( vlc_object_t *, input_item_t *, mtime_t i_time, vlc_fourcc_t i_format, int i_width, int i_height ) VLC_USED;
+#define input_GetThumbnail(a,b,c,d,e,f) input_GetThumbnail(VLC_OBJECT(a),b,c,d,e,f)
+
+/**
+ * Thumbnails strip: the thumbnails of an input item at regular intervals,
+ * extracted as with input_GetThumbnail() on a background thread, with a
+ * single demuxer and decoder.
+ *
+ * The parent object must outlive the strip.
+ */
+typedef struct input_thumbnails_t input_thumbnails_t;
+
+VLC_API input_thumbnails_t *input_thumbnails_New( vlc_object_t *, input_item_t *, mtime_t i_interval, vlc_fourcc_t i_format, int i_width, int i_height ) VLC_USED;
+#define input_thumbnails_New(a,b,c,d,e,f) input_thumbnails_New(VLC_OBJECT(a),b,c,d,e,f)
+VLC_API void input_thumbnails_Delete( input_thumbnails_t * );
+VLC_API unsigned input_thumbnails_Count( input_thumbnails_t * );
+VLC_API block_t *input_thumbnails_Get( input_thumbnails_t *, unsigned i_index ) VLC_USED;
+
 VLC_API int input_vaControl( input_thread_t *, int i_query, va_list  );
 
 VLC_API int input_Control( input_thread_t *, int i_query, ...  );
@@ -123,6 +123,7 @@ struct input_item_node_t
     input_item_node_t      *p_parent;
     input_item_compar_cb   compar_cb;
     bool                   b_can_loop;
+    bool                   b_partial; /**< More sub-items will be posted */
 };
 
 VLC_API void input_item_CopyOptions( input_item_t *p_parent, input_item_t *p_child );
@@ -319,7 +320,8 @@ typedef enum input_item_meta_request_option_t
     META_REQUEST_OPTION_NONE          = 0x00,
     META_REQUEST_OPTION_SCOPE_LOCAL   = 0x01,
     META_REQUEST_OPTION_SCOPE_NETWORK = 0x02,
-    META_REQUEST_OPTION_SCOPE_ANY     = 0x03
+    META_REQUEST_OPTION_SCOPE_ANY     = 0x03,
+    META_REQUEST_OPTION_PRIORITY      = 0x04, /**< ahead of the queued items */
 } input_item_meta_request_option_t;
 
 VLC_API int libvlc_MetaRequest(libvlc_int_t *, input_item_t *,
@@ -351,10 +353,17 @@ struct input_stats_t
     /* Decoders */
     int64_t i_decoded_audio;
     int64_t i_decoded_video;
+    int64_t i_decoder_held; /* blocks held back by full decoder queues */
+    int64_t i_decoder_latency; /* time spent decoding the last block (us) */
+    int64_t i_video_fifo; /* bytes queued to the video decoder */
+    int64_t i_audio_fifo; /* bytes queued to the audio decoder */
 
     /* Vout */
     int64_t i_displayed_pictures;
     int64_t i_lost_pictures;
+    int64_t i_late_pictures; /* pictures output after their date */
+    int64_t i_zap_time; /* from the start or the standby exit, to the first
+                           picture display date (us) */
 
     /* Sout */
     int64_t i_sent_packets;
@@ -364,6 +373,7 @@ struct input_stats_t
     /* Aout */
     int64_t i_played_abuffers;
     int64_t i_lost_abuffers;
+    int64_t i_audio_latency; /* audio output playback delay (us) */
 };
 
 #endif
@@ -47,6 +47,82 @@ static inline void *realloc_or_free( void *p, size_t sz )
     return n;
 }
 
+/**
+ * @}
+ */
+
+/**
+ * \defgroup membudget Memory budget
+ * @{
+ * Process-wide accounting of the memory held by the buffers of the
+ * pipeline (stream caches, decoder queues...).
+ *
+ * Each buffer registers as a client under a component name, and keeps its
+ * current usage up to date. If the total usage exceeds the budget set with
+ * the "memory-budget" option, the clients that can shrink are asked to
+ * release memory in proportion of their usage; they are told when the
+ * pressure goes away.
+ */
+
+typedef struct vlc_membudget vlc_membudget_t;
+
+/**
+ * Asks a client to reduce its usage to at most the given number of bytes,
+ * or lifts the request if the target is SIZE_MAX.
+ *
+ * This is called from any thread, usually one updating the usage of another
+ * client, with the budget lock held. It must not block nor call the budget
+ * functions: typically it only stores the target for the thread owning the
+ * buffer.
+ */
+typedef void (*vlc_membudget_shrink_cb)(void *opaque, size_t target);
+
+/** Maximum length of a component name, including the nul terminator */
+#define VLC_MEMBUDGET_NAME_MAX 32
+
+/** Usage of all the clients of a component */
+typedef struct
+{
+    char psz_name[VLC_MEMBUDGET_NAME_MAX];
+    size_t i_usage; /**< current usage, in bytes */
+    size_t i_peak; /**< sum of the peak usages of the current clients */
+    unsigned i_clients; /**< number of registered clients */
+} vlc_membudget_usage_t;
+
+/**
+ * Registers a memory client.
+ *
+ * \param name component name, such as "prefetch" (copied)
+ * \param shrink shrink request callback, or NULL if the client cannot
+ * shrink and is only accounted
+ * \param opaque data for the callback
+ * \return the client, or NULL on error. The other functions accept NULL,
+ * so that a failed registration needs no special handling.
+ */
+VLC_API vlc_membudget_t *vlc_membudget_Register(const char *name,
+                                                vlc_membudget_shrink_cb shrink,
+                                                void *opaque) VLC_USED;
+
+/**
+ * Unregisters a memory client. Its callback is not called anymore after
+ * this function returns.
+ */
+VLC_API void vlc_membudget_Unregister(vlc_membudget_t *);
+
+/**
+ * Updates the current usage of a client, in bytes. This does not take any
+ * lock, unless the budget is exceeded.
+ */
+VLC_API void vlc_membudget_Set(vlc_membudget_t *, size_t usage);
+
+/**
+ * Gets the usage of each component.
+ *
+ * \param tab pointer to the table of usages, to release with free() [OUT]
+ * \return the number of components, or -1 on error
+ */
+VLC_API ssize_t vlc_membudget_GetUsage(vlc_membudget_usage_t **tab) VLC_USED;
+
 /**
  * @}
  */
@@ -65,6 +65,32 @@ VLC_API const char * module_get_capability( const module_t *m ) VLC_USED;
 VLC_API int module_get_score( const module_t *m ) VLC_USED;
 VLC_API const char * module_gettext( const module_t *, const char * ) VLC_USED;
 
+/**
+ * CPU time spent in a module.
+ *
+ * The times are measured with the CPU clock of the calling threads, around
+ * the main callbacks of the demuxers, decoders, filters and stream outputs.
+ */
+typedef struct
+{
+    const module_t *p_module;
+    uint64_t i_calls; /**< number of calls */
+    uint64_t i_self;  /**< CPU time in the module itself (ns) */
+    uint64_t i_total; /**< CPU time including the modules it called (ns) */
+} vlc_module_cputime_t;
+
+/**
+ * Gets the CPU time spent in each module called by a LibVLC instance, in
+ * decreasing order of self time. This requires the "cpu-stats" option.
+ *
+ * \param tab pointer to the table of CPU times [OUT], to free with free()
+ * \return the number of modules, or -1 if the statistics are disabled or
+ * on error
+ */
+VLC_API ssize_t vlc_module_GetCpuTime( vlc_object_t *,
+                                       vlc_module_cputime_t **tab ) VLC_USED;
+#define vlc_module_GetCpuTime(o, t) vlc_module_GetCpuTime(VLC_OBJECT(o), t)
+
 VLC_USED static inline module_t *module_get_main (void)
 {
     return module_find ("core");
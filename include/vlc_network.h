@@ -249,6 +249,7 @@ VLC_API int  getnameinfo ( const struct sockaddr *, socklen_t,
 VLC_API int vlc_getnameinfo( const struct sockaddr *, int, char *, int, int *, int );
 VLC_API int vlc_getaddrinfo (const char *, unsigned,
                              const struct addrinfo *, struct addrinfo **);
+VLC_API void vlc_freeaddrinfo (struct addrinfo *);
 
 
 #ifdef __OS2__
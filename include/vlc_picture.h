@@ -139,6 +139,19 @@ typedef struct
  */
 VLC_API picture_t * picture_NewFromResource( const video_format_t *, const picture_resource_t * ) VLC_USED;
 
+/**
+ * This function will create a new picture sharing the pixels of part of
+ * another picture, without copying them.
+ *
+ * The view has the format p_fmt, of the same chroma as the picture, and its
+ * top left corner at (i_x, i_y) luma pixels into the picture. It holds a
+ * reference to the picture until it is released itself, and must not be
+ * written to.
+ *
+ * It returns NULL if the chroma has no known planes, or on error.
+ */
+VLC_API picture_t * picture_NewView( picture_t *p_picture, const video_format_t *p_fmt, unsigned i_x, unsigned i_y ) VLC_USED;
+
 /**
  * This function will increase the picture reference count.
  * It will not have any effect on picture obtained from vout
@@ -120,6 +120,19 @@ VLC_API void picture_pool_Release( picture_pool_t * );
  */
 VLC_API picture_t * picture_pool_Get( picture_pool_t * ) VLC_USED;
 
+/**
+ * Obtains a picture from a pool, waiting until one is available.
+ *
+ * The picture must be released with picture_Release().
+ *
+ * @return a picture
+ *
+ * @note This function is thread-safe and is a cancellation point.
+ * @warning This function waits forever if all pictures are allocated and
+ * never released, e.g. by the calling thread itself.
+ */
+VLC_API picture_t * picture_pool_Wait( picture_pool_t * ) VLC_USED;
+
 /**
  * Enumerates all pictures in a pool, both free and allocated.
  *
@@ -136,6 +136,7 @@ struct playlist_item_t
     playlist_item_t      **pp_children; /**< Children nodes/items */
     playlist_item_t       *p_parent;    /**< Item parent */
     int                    i_children;  /**< Number of children, -1 if not a node */
+    int                    i_partial;   /**< Sub-items from partial trees */
     unsigned               i_nb_played; /**< Times played */
 
     int                    i_id;        /**< Playlist item specific id */
@@ -352,6 +353,7 @@ VLC_API int playlist_Add( playlist_t *, const char *, const char *, int, int, bo
 VLC_API int playlist_AddExt( playlist_t *, const char *, const char *, int, int, mtime_t, int, const char *const *, unsigned, bool, bool );
 VLC_API int playlist_AddInput( playlist_t *, input_item_t *, int, int, bool, bool );
 VLC_API playlist_item_t * playlist_NodeAddInput( playlist_t *, input_item_t *, playlist_item_t *, int, int, bool );
+VLC_API int playlist_NodeAddInputs( playlist_t *, input_item_t *const *, int, playlist_item_t *, int, int, bool );
 VLC_API int playlist_NodeAddCopy( playlist_t *, playlist_item_t *, playlist_item_t *, int );
 
 /********************************** Item search *************************/
@@ -53,6 +53,9 @@ struct sout_instance_t
 
     /** count of output that can't control the space */
     int                 i_out_pace_nocontrol;
+    /** whether the outputs that can't control the pace are ignored, so that
+     * the input runs as fast as possible */
+    bool                b_unpaced;
 
     vlc_mutex_t         lock;
     sout_stream_t       *p_stream;
@@ -226,11 +229,8 @@ static inline void sout_StreamIdDel( sout_stream_t *s,
     s->pf_del( s, id );
 }
 
-static inline int sout_StreamIdSend( sout_stream_t *s,
-                                     sout_stream_id_sys_t *id, block_t *b )
-{
-    return s->pf_send( s, id, b );
-}
+VLC_API int sout_StreamIdSend( sout_stream_t *s,
+                               sout_stream_id_sys_t *id, block_t *b );
 
 /****************************************************************************
  * Encoder
@@ -177,6 +177,18 @@ struct subpicture_t
     int          i_alpha;                                  /**< transparency */
      /**@}*/
 
+    /** \name Dirty area
+     * Bounding box of the changes since the previous subpicture rendered by
+     * the same subpicture unit, in original picture coordinates. It is empty
+     * when the regions, their pictures, positions and transparency are all
+     * unchanged, and covers everything for other subpictures. */
+    /**@{*/
+    int          i_dirty_x;
+    int          i_dirty_y;
+    int          i_dirty_width;
+    int          i_dirty_height;
+    /**@}*/
+
     subpicture_updater_t updater;
 
     subpicture_private_t *p_private;    /* Reserved to the core */
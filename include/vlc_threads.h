@@ -819,6 +819,125 @@ VLC_API unsigned vlc_timer_getoverrun(vlc_timer_t) VLC_USED;
  */
 VLC_API unsigned vlc_GetCPUCount(void);
 
+/**
+ * \defgroup taskpool Task pool
+ * Work-stealing thread pool
+ *
+ * The task pool is a process-wide set of worker threads, one per CPU, that
+ * modules share to run short CPU-bound tasks concurrently, rather than
+ * creating threads of their own. Each worker runs the tasks it submits
+ * itself first and in last-in first-out order, and steals the oldest tasks
+ * of the other workers when it has none left.
+ *
+ * Tasks are tracked with task groups: a thread waiting for a group runs
+ * queued tasks in the mean time, so that tasks can submit and wait for
+ * tasks of their own without tying up the workers.
+ *
+ * @{
+ */
+
+typedef struct vlc_taskpool vlc_taskpool_t;
+
+/**
+ * Task group.
+ *
+ * A task group counts the pending tasks submitted with it.
+ * Use vlc_taskgroup_init() to initialize it.
+ */
+typedef struct
+{
+    vlc_mutex_t lock;
+    unsigned    pending;
+    vlc_sem_t   done;
+} vlc_taskgroup_t;
+
+/**
+ * Holds the process-wide task pool.
+ *
+ * The worker threads are started on the first hold, and stopped when the
+ * pool is released for the last time.
+ *
+ * \return the task pool, or NULL on error
+ */
+VLC_API vlc_taskpool_t *vlc_taskpool_hold(void) VLC_USED;
+
+/**
+ * Releases the task pool.
+ *
+ * All the tasks submitted with the pool must have completed.
+ */
+VLC_API void vlc_taskpool_release(vlc_taskpool_t *);
+
+/**
+ * Returns the number of worker threads of a task pool.
+ */
+VLC_API unsigned vlc_taskpool_count(const vlc_taskpool_t *) VLC_USED;
+
+/**
+ * Initializes a task group.
+ */
+VLC_API void vlc_taskgroup_init(vlc_taskgroup_t *);
+
+/**
+ * Deinitializes a task group.
+ *
+ * The group must have no pending tasks, i.e. it must have been waited for.
+ */
+VLC_API void vlc_taskgroup_destroy(vlc_taskgroup_t *);
+
+/**
+ * Submits a task.
+ *
+ * Queues a call to a function for a worker of the pool. If memory is
+ * exhausted, the function is called before this function returns.
+ *
+ * \param group task group to count the task with
+ * \param func function to call
+ * \param data data pointer for the function
+ */
+VLC_API void vlc_taskpool_submit(vlc_taskpool_t *, vlc_taskgroup_t *group,
+                                 void (*func)(void *), void *data);
+
+/**
+ * Waits for all the pending tasks of a group.
+ *
+ * The calling thread runs queued tasks, possibly of other groups, until
+ * the tasks of the group have completed.
+ */
+VLC_API void vlc_taskpool_wait(vlc_taskpool_t *, vlc_taskgroup_t *group);
+
+/**
+ * Waits for all the pending tasks of a group, interruptibly.
+ *
+ * This function does not run any queued task, so that it can be
+ * interrupted promptly (see vlc_interrupt_raise()).
+ *
+ * \warning If this function is interrupted, the tasks keep running, and
+ * the group must be waited for again before the data of the tasks are freed.
+ *
+ * \retval 0 the tasks of the group have completed
+ * \retval EINTR the wait was interrupted
+ */
+VLC_API int vlc_taskpool_wait_i11e(vlc_taskpool_t *, vlc_taskgroup_t *group);
+
+/**
+ * Runs a function over rows in parallel.
+ *
+ * Splits the rows in as many consecutive bands as there are threads,
+ * including the calling one, and returns when all bands are processed.
+ *
+ * \param rows number of rows
+ * \param func function to process the rows from first (included) to last
+ *             (excluded)
+ * \param data data pointer for the function
+ */
+VLC_API void vlc_taskpool_for(vlc_taskpool_t *, unsigned rows,
+                              void (*func)(void *data, unsigned first,
+                                           unsigned last),
+                              void *data);
+
+/** @} */
+
 #if defined (LIBVLC_USE_PTHREAD_CLEANUP)
 /**
  * Registers a thread cancellation handler.
@@ -161,6 +161,39 @@ VLC_API int var_Inherit( vlc_object_t *, const char *, int, vlc_value_t * );
 
 VLC_API void var_FreeList( vlc_value_t *, vlc_value_t * );
 
+/*****************************************************************************
+ * Variable handles
+ *****************************************************************************
+ * For variables accessed often, such as from a playback thread: the name is
+ * looked up only once, and boolean, integer and float values can be read
+ * without locking.
+ *****************************************************************************/
+typedef struct variable_t vlc_var_handle_t;
+
+VLC_API vlc_var_handle_t *var_GetHandle( vlc_object_t *, const char * ) VLC_USED;
+VLC_API void var_ReleaseHandle( vlc_object_t *, vlc_var_handle_t * );
+VLC_API vlc_value_t var_HandleGet( vlc_var_handle_t * ) VLC_USED;
+VLC_API int var_HandleSet( vlc_object_t *, vlc_var_handle_t *, vlc_value_t );
+
+#define var_GetHandle(a,b) var_GetHandle( VLC_OBJECT(a), b )
+#define var_ReleaseHandle(a,b) var_ReleaseHandle( VLC_OBJECT(a), b )
+#define var_HandleSet(a,b,c) var_HandleSet( VLC_OBJECT(a), b, c )
+
+static inline int64_t var_HandleGetInteger( vlc_var_handle_t *h )
+{
+    return var_HandleGet( h ).i_int;
+}
+
+static inline bool var_HandleGetBool( vlc_var_handle_t *h )
+{
+    return var_HandleGet( h ).b_bool;
+}
+
+static inline float var_HandleGetFloat( vlc_var_handle_t *h )
+{
+    return var_HandleGet( h ).f_float;
+}
+
 
 /*****************************************************************************
  * Variable callbacks
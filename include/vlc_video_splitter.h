@@ -111,6 +111,11 @@ struct video_splitter_t
  * You must either returned them through pf_filter or by calling
  * video_splitter_DeletePicture.
  *
+ * A NULL entry means that the output accepts any picture of its format, and
+ * that the splitter must provide one itself: typically a picture_Hold() of
+ * the source, or a picture_NewView() of the part of it to show, saving the
+ * copy.
+ *
  * If VLC_SUCCESS is not returned, pp_picture values are undefined.
  */
 static inline int video_splitter_NewPicture( video_splitter_t *p_splitter,
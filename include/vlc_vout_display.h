@@ -130,6 +130,7 @@ typedef struct {
     bool has_hide_mouse;                    /* Is mouse automatically hidden */
     bool has_pictures_invalid;              /* Will VOUT_DISPLAY_EVENT_PICTURES_INVALID be used */
     bool has_event_thread;                  /* Will events (key at least) be emitted using an independent thread */
+    bool has_deinterlace;                   /* Will VOUT_DISPLAY_CHANGE_DEINTERLACE be handled */
     const vlc_fourcc_t *subpicture_chromas; /* List of supported chromas for subpicture rendering. */
 } vout_display_info_t;
 
@@ -175,6 +176,12 @@ enum {
      * The cropping requested is stored by video_format_t::i_x/y_offset and
      * video_format_t::i_visible_width/height */
     VOUT_DISPLAY_CHANGE_SOURCE_CROP,   /* const video_format_t *p_source */
+
+    /* Ask the module to deinterlace the pictures itself with the given
+     * deinterlace mode, or to stop deinterlacing if the mode is NULL.
+     * It is only sent when vout_display_t::info.has_deinterlace is true,
+     * and the deinterlace filter is used if the mode is refused. */
+    VOUT_DISPLAY_CHANGE_DEINTERLACE,   /* const char *psz_mode */
 };
 
 /**
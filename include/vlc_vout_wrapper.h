@@ -93,6 +93,7 @@ void vout_SetDisplayZoom(vout_display_t *, unsigned num, unsigned den);
 void vout_SetDisplayAspect(vout_display_t *, unsigned num, unsigned den);
 void vout_SetDisplayCrop(vout_display_t *, unsigned num, unsigned den,
                          unsigned left, unsigned top, int right, int bottom);
+bool vout_SetDisplayDeinterlace(vout_display_t *, const char *mode);
 
 #endif /* VLC_VOUT_WRAPPER_H */
 
@@ -31,6 +31,7 @@
 
 #include <vlc_interface.h>
 #include <vlc_vlm.h>
+#include <vlc_memory.h>
 
 #include <stdarg.h>
 #include <limits.h>
@@ -257,3 +258,129 @@ int64_t libvlc_clock(void)
 {
     return mdate();
 }
+
+int libvlc_latency_histogram( libvlc_instance_t *p_instance,
+                              libvlc_latency_stage_t stage,
+                              uint64_t *counts, unsigned count )
+{
+    int ret = libvlc_InternalLatency( p_instance->p_libvlc_int, stage,
+                                      counts, count );
+    if( ret < 0 )
+        libvlc_printerr( "Latency statistics not available" );
+    return ret;
+}
+
+void libvlc_latency_reset( libvlc_instance_t *p_instance )
+{
+    libvlc_InternalLatencyReset( p_instance->p_libvlc_int );
+}
+
+libvlc_memory_usage_t *libvlc_memory_usage_get( libvlc_instance_t *p_instance )
+{
+    vlc_membudget_usage_t *tab;
+    ssize_t count = vlc_membudget_GetUsage( &tab );
+    libvlc_memory_usage_t *p_list = NULL;
+
+    VLC_UNUSED( p_instance );
+    if( count < 0 )
+    {
+        libvlc_printerr( "Not enough memory" );
+        return NULL;
+    }
+
+    for( ssize_t i = count - 1; i >= 0; i-- )
+    {
+        libvlc_memory_usage_t *p_usage = malloc( sizeof( *p_usage ) );
+        char *psz_component = strdup( tab[i].psz_name );
+        if( unlikely(p_usage == NULL || psz_component == NULL) )
+        {
+            free( psz_component );
+            free( p_usage );
+            libvlc_printerr( "Not enough memory" );
+            libvlc_memory_usage_list_release( p_list );
+            p_list = NULL;
+            break;
+        }
+
+        p_usage->psz_component = psz_component;
+        p_usage->i_usage = tab[i].i_usage;
+        p_usage->i_peak = tab[i].i_peak;
+        p_usage->i_users = tab[i].i_clients;
+        p_usage->p_next = p_list;
+        p_list = p_usage;
+    }
+
+    free( tab );
+    return p_list;
+}
+
+void libvlc_memory_usage_list_release( libvlc_memory_usage_t *p_list )
+{
+    while( p_list != NULL )
+    {
+        libvlc_memory_usage_t *p_next = p_list->p_next;
+
+        free( p_list->psz_component );
+        free( p_list );
+        p_list = p_next;
+    }
+}
+
+libvlc_module_cputime_t *libvlc_module_cputime_get( libvlc_instance_t *p_instance )
+{
+    vlc_module_cputime_t *tab;
+    ssize_t count = vlc_module_GetCpuTime( p_instance->p_libvlc_int, &tab );
+    libvlc_module_cputime_t *p_list = NULL;
+
+    if( count < 0 )
+    {
+        libvlc_printerr( "CPU time statistics not available" );
+        return NULL;
+    }
+
+    for( ssize_t i = count - 1; i >= 0; i-- )
+    {
+        libvlc_module_cputime_t *p_time = malloc( sizeof( *p_time ) );
+        char *psz_name = strdup( module_get_object( tab[i].p_module ) );
+        char *psz_cap = strdup( module_get_capability( tab[i].p_module ) );
+        if( unlikely(p_time == NULL || psz_name == NULL || psz_cap == NULL) )
+        {
+            free( psz_cap );
+            free( psz_name );
+            free( p_time );
+            libvlc_printerr( "Not enough memory" );
+            libvlc_module_cputime_list_release( p_list );
+            p_list = NULL;
+            break;
+        }
+
+        p_time->psz_name = psz_name;
+        p_time->psz_capability = psz_cap;
+        p_time->i_calls = tab[i].i_calls;
+        p_time->i_self = tab[i].i_self;
+        p_time->i_total = tab[i].i_total;
+        p_time->p_next = p_list;
+        p_list = p_time;
+    }
+
+    free( tab );
+    return p_list;
+}
+
+void libvlc_module_cputime_list_release( libvlc_module_cputime_t *p_list )
+{
+    while( p_list != NULL )
+    {
+        libvlc_module_cputime_t *p_next = p_list->p_next;
+
+        free( p_list->psz_capability );
+        free( p_list->psz_name );
+        free( p_list );
+        p_list = p_next;
+    }
+}
+
+void libvlc_module_cputime_reset( libvlc_instance_t *p_instance )
+{
+    libvlc_InternalCpuTimeReset( p_instance->p_libvlc_int );
+}
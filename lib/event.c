@@ -78,13 +78,32 @@ typedef struct libvlc_event_listener_t
     libvlc_callback_t   pf_callback;
 } libvlc_event_listener_t;
 
+/* Rate limit of an event type: the events sent within the interval after
+ * the last one delivered are merged into the latest of them, which is
+ * delivered at the end of the interval, or earlier before the next event of
+ * a type that is not rate limited, and before the manager is released. */
+typedef struct libvlc_event_coalescer_t
+{
+    libvlc_event_type_t event_type;
+    mtime_t             interval;
+    mtime_t             last; /* date of the last delivery */
+    bool                pending;
+    libvlc_event_t      event; /* latest event, if pending */
+} libvlc_event_coalescer_t;
+
 typedef struct libvlc_event_manager_t
 {
     void * p_obj;
     vlc_array_t listeners;
+    vlc_array_t coalescers;
+    vlc_timer_t timer; /* delivers the pending rate limited events */
+    mtime_t     deadline; /* of the timer, or VLC_TS_INVALID if idle */
     vlc_mutex_t lock;
 } libvlc_event_sender_t;
 
+static mtime_t event_flush( libvlc_event_manager_t *, mtime_t );
+static void event_timer( void * );
+
 /*
  * Internal libvlc functions
  */
@@ -108,6 +127,8 @@ libvlc_event_manager_new( void * p_obj )
 
     p_em->p_obj = p_obj;
     vlc_array_init(&p_em->listeners);
+    vlc_array_init(&p_em->coalescers);
+    p_em->deadline = VLC_TS_INVALID;
     vlc_mutex_init_recursive(&p_em->lock);
     return p_em;
 }
@@ -119,15 +140,110 @@ libvlc_event_manager_new( void * p_obj )
  **************************************************************************/
 void libvlc_event_manager_release( libvlc_event_manager_t * p_em )
 {
+    if (vlc_array_count(&p_em->coalescers) > 0)
+    {
+        vlc_timer_destroy(p_em->timer);
+        /* Deliver what is still pending */
+        vlc_mutex_lock(&p_em->lock);
+        event_flush(p_em, INT64_MAX);
+        vlc_mutex_unlock(&p_em->lock);
+    }
     vlc_mutex_destroy(&p_em->lock);
 
     for (int i = 0; i < vlc_array_count(&p_em->listeners); i++)
         free(vlc_array_item_at_index(&p_em->listeners, i));
+    for (int i = 0; i < vlc_array_count(&p_em->coalescers); i++)
+        free(vlc_array_item_at_index(&p_em->coalescers, i));
 
     vlc_array_clear(&p_em->listeners);
+    vlc_array_clear(&p_em->coalescers);
     free( p_em );
 }
 
+/**************************************************************************
+ *       libvlc_event_manager_coalesce (internal) :
+ *
+ * Rate limit an event type. Must be called before any event is sent.
+ **************************************************************************/
+int libvlc_event_manager_coalesce( libvlc_event_manager_t * p_em,
+                                   libvlc_event_type_t event_type,
+                                   mtime_t interval )
+{
+    libvlc_event_coalescer_t *coalescer = malloc(sizeof (*coalescer));
+    if (unlikely(coalescer == NULL))
+        return ENOMEM;
+
+    coalescer->event_type = event_type;
+    coalescer->interval = interval;
+    coalescer->last = VLC_TS_INVALID;
+    coalescer->pending = false;
+
+    if (vlc_array_count(&p_em->coalescers) == 0
+     && vlc_timer_create(&p_em->timer, event_timer, p_em))
+    {
+        free(coalescer);
+        return ENOMEM;
+    }
+
+    vlc_mutex_lock(&p_em->lock);
+    vlc_array_append(&p_em->coalescers, coalescer);
+    vlc_mutex_unlock(&p_em->lock);
+    return 0;
+}
+
+static void event_dispatch( libvlc_event_manager_t * p_em,
+                            libvlc_event_t * p_event )
+{
+    for (int i = 0; i < vlc_array_count(&p_em->listeners); i++)
+    {
+        libvlc_event_listener_t *listener;
+
+        listener = vlc_array_item_at_index(&p_em->listeners, i);
+        if (listener->event_type == p_event->type)
+            listener->pf_callback(p_event, listener->p_user_data);
+    }
+}
+
+/* Delivers the pending rate limited events due by the given date, in order,
+ * and returns the deadline of the first one left, or VLC_TS_INVALID */
+static mtime_t event_flush( libvlc_event_manager_t * p_em, mtime_t date )
+{
+    mtime_t deadline = VLC_TS_INVALID;
+
+    for (int i = 0; i < vlc_array_count(&p_em->coalescers); i++)
+    {
+        libvlc_event_coalescer_t *c;
+
+        c = vlc_array_item_at_index(&p_em->coalescers, i);
+        if (!c->pending)
+            continue;
+
+        mtime_t due = c->last + c->interval;
+        if (due <= date)
+        {
+            libvlc_event_t event = c->event;
+
+            c->last = mdate();
+            c->pending = false;
+            event_dispatch(p_em, &event);
+        }
+        else if (deadline == VLC_TS_INVALID || due < deadline)
+            deadline = due;
+    }
+    return deadline;
+}
+
+static void event_timer( void * data )
+{
+    libvlc_event_manager_t *p_em = data;
+
+    vlc_mutex_lock(&p_em->lock);
+    p_em->deadline = event_flush(p_em, mdate());
+    if (p_em->deadline != VLC_TS_INVALID)
+        vlc_timer_schedule(p_em->timer, true, p_em->deadline, 0);
+    vlc_mutex_unlock(&p_em->lock);
+}
+
 /**************************************************************************
  *       libvlc_event_send (internal) :
  *
@@ -136,18 +252,51 @@ void libvlc_event_manager_release( libvlc_event_manager_t * p_em )
 void libvlc_event_send( libvlc_event_manager_t * p_em,
                         libvlc_event_t * p_event )
 {
+    libvlc_event_coalescer_t *coalescer = NULL;
+
     /* Fill event with the sending object now */
     p_event->p_obj = p_em->p_obj;
 
     vlc_mutex_lock(&p_em->lock);
-    for (int i = 0; i < vlc_array_count(&p_em->listeners); i++)
+    for (int i = 0; i < vlc_array_count(&p_em->coalescers); i++)
     {
-        libvlc_event_listener_t *listener;
+        libvlc_event_coalescer_t *c;
+
+        c = vlc_array_item_at_index(&p_em->coalescers, i);
+        if (c->event_type == p_event->type)
+        {
+            coalescer = c;
+            break;
+        }
+    }
 
-        listener = vlc_array_item_at_index(&p_em->listeners, i);
-        if (listener->event_type == p_event->type)
-            listener->pf_callback(p_event, listener->p_user_data);
+    if (coalescer != NULL)
+    {
+        mtime_t now = mdate();
+
+        if (coalescer->last != VLC_TS_INVALID
+         && now < coalescer->last + coalescer->interval)
+        {   /* Too soon: keep only the latest event */
+            mtime_t due = coalescer->last + coalescer->interval;
+
+            coalescer->event = *p_event;
+            coalescer->pending = true;
+            if (p_em->deadline == VLC_TS_INVALID || due < p_em->deadline)
+            {
+                p_em->deadline = due;
+                vlc_timer_schedule(p_em->timer, true, due, 0);
+            }
+            vlc_mutex_unlock(&p_em->lock);
+            return;
+        }
+        coalescer->last = now;
+        coalescer->pending = false;
     }
+    else
+        /* Deliver the pending rate limited events first */
+        event_flush(p_em, INT64_MAX);
+
+    event_dispatch(p_em, p_event);
     vlc_mutex_unlock(&p_em->lock);
 }
 
@@ -53,6 +53,11 @@ VLC_API void libvlc_InternalPlay( libvlc_int_t * );
 VLC_API void libvlc_InternalWait( libvlc_int_t * );
 VLC_API void libvlc_SetExitHandler( libvlc_int_t *, void (*) (void *), void * );
 
+VLC_API int libvlc_InternalLatency( libvlc_int_t *, unsigned, uint64_t *,
+                                    unsigned );
+VLC_API void libvlc_InternalLatencyReset( libvlc_int_t * );
+VLC_API void libvlc_InternalCpuTimeReset( libvlc_int_t * );
+
 typedef void (*libvlc_vlm_release_func_t)( libvlc_instance_t * ) ;
 
 /***************************************************************************
@@ -95,6 +100,11 @@ libvlc_event_manager_t * libvlc_event_manager_new(void * p_obj);
 void libvlc_event_manager_release(
         libvlc_event_manager_t * p_em );
 
+int libvlc_event_manager_coalesce(
+        libvlc_event_manager_t * p_em,
+        libvlc_event_type_t event_type,
+        mtime_t interval );
+
 void libvlc_event_send(
         libvlc_event_manager_t * p_em,
         libvlc_event_t * p_event );
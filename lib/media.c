@@ -34,7 +34,9 @@
 #include <vlc/libvlc_events.h>
 
 #include <vlc_common.h>
+#include <vlc_block.h>
 #include <vlc_input.h>
+#include <vlc_image.h>
 #include <vlc_meta.h>
 #include <vlc_playlist.h> /* For the preparser */
 #include <vlc_url.h>
@@ -1043,3 +1045,133 @@ libvlc_media_type_t libvlc_media_get_type( libvlc_media_t *p_md )
         return libvlc_media_type_unknown;
     }
 }
+
+/**************************************************************************
+ * Extract a thumbnail of the media at the keyframe nearest to a time
+ **************************************************************************/
+unsigned char *libvlc_media_thumbnail( libvlc_media_t *p_md,
+                                       libvlc_time_t i_time,
+                                       unsigned i_width, unsigned i_height,
+                                       const char *psz_format,
+                                       size_t *pi_size )
+{
+    assert( p_md );
+
+    vlc_fourcc_t i_format = image_Type2Fourcc( psz_format ? psz_format
+                                                          : "png" );
+    if( i_format == 0 )
+    {
+        libvlc_printerr( "Unknown image format: %s", psz_format );
+        return NULL;
+    }
+
+    block_t *p_image = input_GetThumbnail(
+        p_md->p_libvlc_instance->p_libvlc_int, p_md->p_input_item,
+        i_time > 0 ? i_time * 1000 : 0, i_format,
+        i_width ? (int)i_width : (i_height ? 0 : -1),
+        i_height ? (int)i_height : (i_width ? 0 : -1) );
+    if( p_image == NULL )
+    {
+        libvlc_printerr( "Thumbnail extraction failed" );
+        return NULL;
+    }
+
+    unsigned char *p_data = malloc( p_image->i_buffer );
+    if( likely(p_data != NULL) )
+    {
+        memcpy( p_data, p_image->p_buffer, p_image->i_buffer );
+        *pi_size = p_image->i_buffer;
+    }
+    else
+        libvlc_printerr( "Not enough memory" );
+    block_Release( p_image );
+    return p_data;
+}
+
+/**************************************************************************
+ * Thumbnails strip, generated in the background
+ **************************************************************************/
+struct libvlc_media_thumbnails_t
+{
+    libvlc_media_t     *p_md;
+    input_thumbnails_t *p_thumbnails;
+};
+
+libvlc_media_thumbnails_t *libvlc_media_thumbnails_new( libvlc_media_t *p_md,
+                                                      libvlc_time_t i_interval,
+                                                      unsigned i_width,
+                                                      unsigned i_height,
+                                                      const char *psz_format )
+{
+    assert( p_md );
+
+    if( i_interval <= 0 )
+    {
+        libvlc_printerr( "Invalid thumbnails interval" );
+        return NULL;
+    }
+
+    vlc_fourcc_t i_format = image_Type2Fourcc( psz_format ? psz_format
+                                                          : "png" );
+    if( i_format == 0 )
+    {
+        libvlc_printerr( "Unknown image format: %s", psz_format );
+        return NULL;
+    }
+
+    libvlc_media_thumbnails_t *p_strip = malloc( sizeof( *p_strip ) );
+    if( unlikely(p_strip == NULL) )
+    {
+        libvlc_printerr( "Not enough memory" );
+        return NULL;
+    }
+
+    /* The media holds the instance, which is the parent of the strip */
+    libvlc_media_retain( p_md );
+    p_strip->p_md = p_md;
+    p_strip->p_thumbnails = input_thumbnails_New(
+        p_md->p_libvlc_instance->p_libvlc_int, p_md->p_input_item,
+        i_interval * 1000, i_format,
+        i_width ? (int)i_width : (i_height ? 0 : -1),
+        i_height ? (int)i_height : (i_width ? 0 : -1) );
+    if( p_strip->p_thumbnails == NULL )
+    {
+        libvlc_printerr( "Thumbnails generation failed" );
+        libvlc_media_release( p_md );
+        free( p_strip );
+        return NULL;
+    }
+    return p_strip;
+}
+
+void libvlc_media_thumbnails_release( libvlc_media_thumbnails_t *p_strip )
+{
+    input_thumbnails_Delete( p_strip->p_thumbnails );
+    libvlc_media_release( p_strip->p_md );
+    free( p_strip );
+}
+
+unsigned libvlc_media_thumbnails_count( libvlc_media_thumbnails_t *p_strip )
+{
+    return input_thumbnails_Count( p_strip->p_thumbnails );
+}
+
+unsigned char *libvlc_media_thumbnails_get( libvlc_media_thumbnails_t *p_strip,
+                                            unsigned i_index,
+                                            size_t *pi_size )
+{
+    block_t *p_image = input_thumbnails_Get( p_strip->p_thumbnails, i_index );
+    if( p_image == NULL )
+        return NULL;
+
+    unsigned char *p_data = malloc( p_image->i_buffer );
+    if( likely(p_data != NULL) )
+    {
+        memcpy( p_data, p_image->p_buffer, p_image->i_buffer );
+        *pi_size = p_image->i_buffer;
+    }
+    else
+        libvlc_printerr( "Not enough memory" );
+    block_Release( p_image );
+    return p_data;
+}
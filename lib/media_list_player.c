@@ -39,6 +39,7 @@
 
 #include "media_internal.h" // Abuse, could and should be removed
 #include "media_list_path.h"
+#include "media_player_internal.h"
 
 //#define DEBUG_MEDIA_LIST_PLAYER
 
@@ -52,8 +53,14 @@
  *
  * This is thread safe, and we use a two keys (locks) scheme
  * to discriminate between callbacks and regular uses.
+ *
+ * For gapless playback, the next item is also pre-opened by the media
+ * player some time before the current one ends, via the event callback
+ * media_player_time_changed().
  */
 
+#define PRELOAD_DEFAULT 5000 /* ms */
+
 struct libvlc_media_list_player_t
 {
     libvlc_event_manager_t *    p_event_manager;
@@ -70,6 +77,12 @@ struct libvlc_media_list_player_t
     libvlc_media_player_t *     p_mi;
     libvlc_playback_mode_t      e_playback_mode;
 
+    /* Gapless playback, protected by mp_callback_lock */
+    libvlc_time_t               i_preload; /* 0 if disabled */
+    libvlc_time_t               i_length; /* of the current item */
+    bool                        b_preload_pending;
+    bool                        b_preloaded;
+
     vlc_thread_t                thread;
 };
 
@@ -322,6 +335,41 @@ get_previous_path(libvlc_media_list_player_t * p_mlp, bool b_loop)
     return ret;
 }
 
+/**************************************************************************
+ *       preload_next_item (private)
+ *
+ * Pre-opens the item following the playing one.
+ * Lock must be held.
+ **************************************************************************/
+static void preload_next_item(libvlc_media_list_player_t * p_mlp)
+{
+    assert_locked(p_mlp);
+
+    if (!p_mlp->p_mlist
+     || p_mlp->e_playback_mode == libvlc_playback_mode_repeat)
+        return;
+
+    libvlc_media_list_lock(p_mlp->p_mlist);
+
+    bool b_loop = (p_mlp->e_playback_mode == libvlc_playback_mode_loop);
+    libvlc_media_list_path_t path = get_next_path(p_mlp, b_loop);
+    libvlc_media_t * p_md = NULL;
+
+    if (path)
+    {
+        p_md = libvlc_media_list_item_at_path(p_mlp->p_mlist, path);
+        free(path);
+    }
+
+    libvlc_media_list_unlock(p_mlp->p_mlist);
+
+    if (p_md)
+    {
+        libvlc_media_player_preload(p_mlp->p_mi, p_md);
+        libvlc_media_release(p_md);
+    }
+}
+
 static void *playlist_thread(void *data)
 {
     libvlc_media_list_player_t *mlp = data;
@@ -333,12 +381,18 @@ static void *playlist_thread(void *data)
     {
         int canc;
 
-        while (mlp->seek_offset == 0)
+        while (mlp->seek_offset == 0 && !mlp->b_preload_pending)
             vlc_cond_wait(&mlp->seek_pending, &mlp->mp_callback_lock);
 
         canc = vlc_savecancel();
-        set_relative_playlist_position_and_play(mlp, mlp->seek_offset);
-        mlp->seek_offset = 0;
+        if (mlp->seek_offset != 0)
+        {
+            set_relative_playlist_position_and_play(mlp, mlp->seek_offset);
+            mlp->seek_offset = 0;
+        }
+        else
+            preload_next_item(mlp);
+        mlp->b_preload_pending = false;
         vlc_restorecancel(canc);
     }
 
@@ -365,6 +419,41 @@ media_player_reached_end(const libvlc_event_t * p_event, void * p_user_data)
     vlc_mutex_unlock(&p_mlp->mp_callback_lock);
 }
 
+/**************************************************************************
+ *       media_player_time_changed (private) (Event Callback)
+ **************************************************************************/
+static void
+media_player_time_changed(const libvlc_event_t * p_event, void * p_user_data)
+{
+    libvlc_media_list_player_t * p_mlp = p_user_data;
+    libvlc_time_t i_time = p_event->u.media_player_time_changed.new_time;
+
+    /* As for the end of the item, pre-opening the next one is deferred to
+     * the playlist thread. */
+    vlc_mutex_lock(&p_mlp->mp_callback_lock);
+    if (p_mlp->i_preload > 0 && !p_mlp->b_preloaded && p_mlp->i_length > 0
+     && p_mlp->i_length - i_time <= p_mlp->i_preload)
+    {
+        p_mlp->b_preloaded = true;
+        p_mlp->b_preload_pending = true;
+        vlc_cond_signal(&p_mlp->seek_pending);
+    }
+    vlc_mutex_unlock(&p_mlp->mp_callback_lock);
+}
+
+/**************************************************************************
+ *       media_player_length_changed (private) (Event Callback)
+ **************************************************************************/
+static void
+media_player_length_changed(const libvlc_event_t * p_event, void * p_user_data)
+{
+    libvlc_media_list_player_t * p_mlp = p_user_data;
+
+    vlc_mutex_lock(&p_mlp->mp_callback_lock);
+    p_mlp->i_length = p_event->u.media_player_length_changed.new_length;
+    vlc_mutex_unlock(&p_mlp->mp_callback_lock);
+}
+
 /**************************************************************************
  *       playlist_item_deleted (private) (Event Callback)
  **************************************************************************/
@@ -405,6 +494,8 @@ install_media_player_observer(libvlc_media_list_player_t * p_mlp)
 {
     assert_locked(p_mlp);
     libvlc_event_attach(mplayer_em(p_mlp), libvlc_MediaPlayerEndReached, media_player_reached_end, p_mlp);
+    libvlc_event_attach(mplayer_em(p_mlp), libvlc_MediaPlayerTimeChanged, media_player_time_changed, p_mlp);
+    libvlc_event_attach(mplayer_em(p_mlp), libvlc_MediaPlayerLengthChanged, media_player_length_changed, p_mlp);
 }
 
 
@@ -420,6 +511,8 @@ uninstall_media_player_observer(libvlc_media_list_player_t * p_mlp)
     // This is safe because only callbacks are allowed, and there execution will be cancelled.
     vlc_mutex_unlock(&p_mlp->mp_callback_lock);
     libvlc_event_detach(mplayer_em(p_mlp), libvlc_MediaPlayerEndReached, media_player_reached_end, p_mlp);
+    libvlc_event_detach(mplayer_em(p_mlp), libvlc_MediaPlayerTimeChanged, media_player_time_changed, p_mlp);
+    libvlc_event_detach(mplayer_em(p_mlp), libvlc_MediaPlayerLengthChanged, media_player_length_changed, p_mlp);
 
     // Now, lock back the callback lock. No more callback will be present from this point.
     vlc_mutex_lock(&p_mlp->mp_callback_lock);
@@ -448,6 +541,11 @@ set_current_playing_item(libvlc_media_list_player_t * p_mlp, libvlc_media_list_p
     if (!path)
         return;
 
+    /* The next item is pre-opened again during this one */
+    p_mlp->i_length = 0;
+    p_mlp->b_preloaded = false;
+    p_mlp->b_preload_pending = false;
+
     libvlc_media_t * p_md;
     p_md = libvlc_media_list_item_at_path(p_mlp->p_mlist, path);
     if (!p_md)
@@ -482,6 +580,7 @@ libvlc_media_list_player_new(libvlc_instance_t * p_instance)
 
     p_mlp->i_refcount = 1;
     p_mlp->seek_offset = 0;
+    p_mlp->i_preload = PRELOAD_DEFAULT;
     vlc_mutex_init(&p_mlp->object_lock);
     vlc_mutex_init(&p_mlp->mp_callback_lock);
     vlc_cond_init(&p_mlp->seek_pending);
@@ -861,3 +960,15 @@ void libvlc_media_list_player_set_playback_mode(
     p_mlp->e_playback_mode = e_mode;
     unlock(p_mlp);
 }
+
+/**************************************************************************
+ *        Set preload time (Public)
+ **************************************************************************/
+void libvlc_media_list_player_set_preload_time(
+                                            libvlc_media_list_player_t * p_mlp,
+                                            libvlc_time_t i_time )
+{
+    lock(p_mlp);
+    p_mlp->i_preload = i_time;
+    unlock(p_mlp);
+}
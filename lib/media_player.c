@@ -154,6 +154,48 @@ static void release_input_thread( libvlc_media_player_t *p_mi )
     input_Close( p_input_thread );
 }
 
+/*
+ * Release the input thread pre-opened in standby, if any.
+ *
+ * Input lock is held or instance is being destroyed.
+ */
+static void release_next_input( libvlc_media_player_t *p_mi )
+{
+    input_thread_t *p_input_thread = p_mi->input.p_next;
+    if( !p_input_thread )
+        return;
+    p_mi->input.p_next = NULL;
+
+    input_Stop( p_input_thread );
+    input_Close( p_input_thread );
+    libvlc_media_release( p_mi->input.p_next_md );
+    p_mi->input.p_next_md = NULL;
+}
+
+/*
+ * Take the input thread pre-opened in standby for the current media, if it is
+ * still alive.
+ *
+ * Object and input locks are held.
+ */
+static input_thread_t *take_next_input( libvlc_media_player_t *p_mi )
+{
+    input_thread_t *p_input_thread = p_mi->input.p_next;
+    if( !p_input_thread || p_mi->input.p_next_md != p_mi->p_md )
+        return NULL;
+    p_mi->input.p_next = NULL;
+    libvlc_media_release( p_mi->input.p_next_md );
+    p_mi->input.p_next_md = NULL;
+
+    int state = var_GetInteger( p_input_thread, "state" );
+    if( state == END_S || state == ERROR_S )
+    {
+        input_Close( p_input_thread );
+        return NULL;
+    }
+    return p_input_thread;
+}
+
 /*
  * Retrieve the input thread. Be sure to release the object
  * once you are done with it. (libvlc Internal)
@@ -528,6 +570,64 @@ static int volume_changed(vlc_object_t *obj, const char *name, vlc_value_t old,
     return VLC_SUCCESS;
 }
 
+/**************************************************************************
+ * Playback and rendering settings of a media player.
+ *
+ * They are restored to their defaults by libvlc_media_player_reset(),
+ * unlike the output configuration (callbacks, drawables, modules).
+ **************************************************************************/
+static const struct
+{
+    char name[24];
+    int type;
+} mp_settings[] =
+{
+    /* Input */
+    { "rate", VLC_VAR_FLOAT | VLC_VAR_DOINHERIT },
+    /* Video */
+    { "autoscale", VLC_VAR_BOOL | VLC_VAR_DOINHERIT },
+    { "zoom", VLC_VAR_FLOAT | VLC_VAR_DOINHERIT },
+    { "aspect-ratio", VLC_VAR_STRING },
+    { "crop", VLC_VAR_STRING },
+    { "deinterlace", VLC_VAR_INTEGER },
+    { "deinterlace-mode", VLC_VAR_STRING },
+    { "vbi-page", VLC_VAR_INTEGER },
+    /* Marquee */
+    { "marq-marquee", VLC_VAR_STRING },
+    { "marq-color", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT },
+    { "marq-opacity", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT },
+    { "marq-position", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT },
+    { "marq-refresh", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT },
+    { "marq-size", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT },
+    { "marq-timeout", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT },
+    { "marq-x", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT },
+    { "marq-y", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT },
+    /* Logo */
+    { "logo-file", VLC_VAR_STRING },
+    { "logo-x", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT },
+    { "logo-y", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT },
+    { "logo-delay", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT },
+    { "logo-repeat", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT },
+    { "logo-opacity", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT },
+    { "logo-position", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT },
+    /* Adjust */
+    { "contrast", VLC_VAR_FLOAT | VLC_VAR_DOINHERIT },
+    { "brightness", VLC_VAR_FLOAT | VLC_VAR_DOINHERIT },
+    { "hue", VLC_VAR_FLOAT | VLC_VAR_DOINHERIT },
+    { "saturation", VLC_VAR_FLOAT | VLC_VAR_DOINHERIT },
+    { "gamma", VLC_VAR_FLOAT | VLC_VAR_DOINHERIT },
+    /* Audio */
+    { "audio-filter", VLC_VAR_STRING },
+    /* Video Title */
+    { "video-title-show", VLC_VAR_BOOL },
+    { "video-title-position", VLC_VAR_INTEGER },
+    { "video-title-timeout", VLC_VAR_INTEGER },
+    /* Equalizer */
+    { "equalizer-preamp", VLC_VAR_FLOAT },
+    { "equalizer-vlcfreqs", VLC_VAR_BOOL },
+    { "equalizer-bands", VLC_VAR_STRING }
+};
+
 /**************************************************************************
  * Create a Media Instance object.
  *
@@ -556,8 +656,9 @@ libvlc_media_player_new( libvlc_instance_t *instance )
         return NULL;
     }
 
-    /* Input */
-    var_Create (mp, "rate", VLC_VAR_FLOAT|VLC_VAR_DOINHERIT);
+    for (size_t i = 0; i < ARRAY_SIZE(mp_settings); i++)
+        var_Create (mp, mp_settings[i].name, mp_settings[i].type);
+    var_SetInteger (mp, "vbi-page", 100);
 
     /* Video */
     var_Create (mp, "vout", VLC_VAR_STRING|VLC_VAR_DOINHERIT);
@@ -591,39 +692,6 @@ libvlc_media_player_new( libvlc_instance_t *instance )
     var_SetBool (mp, "mouse-events", true);
 
     var_Create (mp, "fullscreen", VLC_VAR_BOOL);
-    var_Create (mp, "autoscale", VLC_VAR_BOOL | VLC_VAR_DOINHERIT);
-    var_Create (mp, "zoom", VLC_VAR_FLOAT | VLC_VAR_DOINHERIT);
-    var_Create (mp, "aspect-ratio", VLC_VAR_STRING);
-    var_Create (mp, "crop", VLC_VAR_STRING);
-    var_Create (mp, "deinterlace", VLC_VAR_INTEGER);
-    var_Create (mp, "deinterlace-mode", VLC_VAR_STRING);
-
-    var_Create (mp, "vbi-page", VLC_VAR_INTEGER);
-    var_SetInteger (mp, "vbi-page", 100);
-
-    var_Create (mp, "marq-marquee", VLC_VAR_STRING);
-    var_Create (mp, "marq-color", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
-    var_Create (mp, "marq-opacity", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
-    var_Create (mp, "marq-position", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
-    var_Create (mp, "marq-refresh", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
-    var_Create (mp, "marq-size", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
-    var_Create (mp, "marq-timeout", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
-    var_Create (mp, "marq-x", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
-    var_Create (mp, "marq-y", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
-
-    var_Create (mp, "logo-file", VLC_VAR_STRING);
-    var_Create (mp, "logo-x", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
-    var_Create (mp, "logo-y", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
-    var_Create (mp, "logo-delay", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
-    var_Create (mp, "logo-repeat", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
-    var_Create (mp, "logo-opacity", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
-    var_Create (mp, "logo-position", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
-
-    var_Create (mp, "contrast", VLC_VAR_FLOAT | VLC_VAR_DOINHERIT);
-    var_Create (mp, "brightness", VLC_VAR_FLOAT | VLC_VAR_DOINHERIT);
-    var_Create (mp, "hue", VLC_VAR_FLOAT | VLC_VAR_DOINHERIT);
-    var_Create (mp, "saturation", VLC_VAR_FLOAT | VLC_VAR_DOINHERIT);
-    var_Create (mp, "gamma", VLC_VAR_FLOAT | VLC_VAR_DOINHERIT);
 
      /* Audio */
     var_Create (mp, "aout", VLC_VAR_STRING | VLC_VAR_DOINHERIT);
@@ -631,7 +699,6 @@ libvlc_media_player_new( libvlc_instance_t *instance )
     var_Create (mp, "mute", VLC_VAR_BOOL);
     var_Create (mp, "volume", VLC_VAR_FLOAT);
     var_Create (mp, "corks", VLC_VAR_INTEGER);
-    var_Create (mp, "audio-filter", VLC_VAR_STRING);
     var_Create (mp, "amem-data", VLC_VAR_ADDRESS);
     var_Create (mp, "amem-setup", VLC_VAR_ADDRESS);
     var_Create (mp, "amem-cleanup", VLC_VAR_ADDRESS);
@@ -645,20 +712,12 @@ libvlc_media_player_new( libvlc_instance_t *instance )
     var_Create (mp, "amem-rate", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
     var_Create (mp, "amem-channels", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
 
-    /* Video Title */
-    var_Create (mp, "video-title-show", VLC_VAR_BOOL);
-    var_Create (mp, "video-title-position", VLC_VAR_INTEGER);
-    var_Create (mp, "video-title-timeout", VLC_VAR_INTEGER);
-
-    /* Equalizer */
-    var_Create (mp, "equalizer-preamp", VLC_VAR_FLOAT);
-    var_Create (mp, "equalizer-vlcfreqs", VLC_VAR_BOOL);
-    var_Create (mp, "equalizer-bands", VLC_VAR_STRING);
-
     mp->p_md = NULL;
     mp->state = libvlc_NothingSpecial;
     mp->p_libvlc_instance = instance;
     mp->input.p_thread = NULL;
+    mp->input.p_next = NULL;
+    mp->input.p_next_md = NULL;
     mp->input.p_resource = input_resource_New(VLC_OBJECT(mp));
     if (unlikely(mp->input.p_resource == NULL))
     {
@@ -680,6 +739,18 @@ libvlc_media_player_new( libvlc_instance_t *instance )
     }
     vlc_mutex_init(&mp->object_lock);
 
+    /* Rate limit the time and position changes, if so configured */
+    mtime_t interval = var_InheritInteger(mp, "time-event-interval") * 1000;
+    if (interval > 0)
+    {
+        libvlc_event_manager_coalesce(mp->p_event_manager,
+                                      libvlc_MediaPlayerPositionChanged,
+                                      interval);
+        libvlc_event_manager_coalesce(mp->p_event_manager,
+                                      libvlc_MediaPlayerTimeChanged,
+                                      interval);
+    }
+
     var_AddCallback(mp, "corks", corks_changed, NULL);
     var_AddCallback(mp, "audio-device", audio_device_changed, NULL);
     var_AddCallback(mp, "mute", mute_changed, NULL);
@@ -739,6 +810,7 @@ static void libvlc_media_player_destroy( libvlc_media_player_t *p_mi )
     /* No need for lock_input() because no other threads knows us anymore */
     if( p_mi->input.p_thread )
         release_input_thread(p_mi);
+    release_next_input(p_mi);
     input_resource_Terminate( p_mi->input.p_resource );
     input_resource_Release( p_mi->input.p_resource );
     vlc_mutex_destroy( &p_mi->input.lock );
@@ -796,6 +868,8 @@ void libvlc_media_player_set_media(
     lock_input(p_mi);
 
     release_input_thread( p_mi );
+    if( p_mi->input.p_next_md != p_md )
+        release_next_input( p_mi );
 
     lock( p_mi );
     set_state( p_mi, libvlc_NothingSpecial, true );
@@ -873,6 +947,66 @@ static void del_es_callbacks( input_thread_t *p_input_thread, libvlc_media_playe
     var_DelCallback( p_input_thread, "spu-es", input_es_selected, p_mi );
 }
 
+/*
+ * Send the events that the media player missed while the input thread was
+ * in standby.
+ */
+static void sync_input_events( libvlc_media_player_t *p_mi,
+                               input_thread_t *p_input_thread )
+{
+    vlc_value_t dummy = { .i_int = 0 }, val;
+
+    var_TriggerCallback( p_input_thread, "can-seek" );
+    var_TriggerCallback( p_input_thread, "can-pause" );
+    val.i_int = INPUT_EVENT_LENGTH;
+    input_event_changed( VLC_OBJECT(p_input_thread), "intf-event", dummy, val,
+                         p_mi );
+    val.i_int = INPUT_EVENT_STATE;
+    input_event_changed( VLC_OBJECT(p_input_thread), "intf-event", dummy, val,
+                         p_mi );
+}
+
+/**************************************************************************
+ * Pre-open a media in standby, for play() to start it without delay once it
+ * is set. (libvlc Internal)
+ **************************************************************************/
+int libvlc_media_player_preload( libvlc_media_player_t *p_mi,
+                                 libvlc_media_t *p_md )
+{
+    lock_input( p_mi );
+    if( p_mi->input.p_next_md == p_md )
+    {
+        unlock_input( p_mi );
+        return 0;
+    }
+    release_next_input( p_mi );
+
+    input_thread_t *p_input_thread = input_Create( p_mi, p_md->p_input_item,
+                                                   NULL,
+                                                   p_mi->input.p_resource );
+    if( !p_input_thread )
+    {
+        unlock_input( p_mi );
+        libvlc_printerr( "Not enough memory" );
+        return -1;
+    }
+
+    var_SetBool( p_input_thread, "standby", true );
+    if( input_Start( p_input_thread ) )
+    {
+        unlock_input( p_mi );
+        input_Close( p_input_thread );
+        libvlc_printerr( "Input initialization failure" );
+        return -1;
+    }
+
+    libvlc_media_retain( p_md );
+    p_mi->input.p_next = p_input_thread;
+    p_mi->input.p_next_md = p_md;
+    unlock_input( p_mi );
+    return 0;
+}
+
 /**************************************************************************
  * Tell media player to start playing.
  **************************************************************************/
@@ -900,8 +1034,12 @@ int libvlc_media_player_play( libvlc_media_player_t *p_mi )
         return -1;
     }
 
-    p_input_thread = input_Create( p_mi, p_mi->p_md->p_input_item, NULL,
-                                   p_mi->input.p_resource );
+    /* The media may have been pre-opened for gapless playback */
+    p_input_thread = take_next_input( p_mi );
+    const bool b_preloaded = p_input_thread != NULL;
+    if( !b_preloaded )
+        p_input_thread = input_Create( p_mi, p_mi->p_md->p_input_item, NULL,
+                                       p_mi->input.p_resource );
     unlock(p_mi);
     if( !p_input_thread )
     {
@@ -916,7 +1054,9 @@ int libvlc_media_player_play( libvlc_media_player_t *p_mi )
     var_AddCallback( p_input_thread, "intf-event", input_event_changed, p_mi );
     add_es_callbacks( p_input_thread, p_mi );
 
-    if( input_Start( p_input_thread ) )
+    if( b_preloaded )
+        var_SetBool( p_input_thread, "standby", false );
+    else if( input_Start( p_input_thread ) )
     {
         unlock_input(p_mi);
         del_es_callbacks( p_input_thread, p_mi );
@@ -929,7 +1069,15 @@ int libvlc_media_player_play( libvlc_media_player_t *p_mi )
         return -1;
     }
     p_mi->input.p_thread = p_input_thread;
+    if( b_preloaded )
+        vlc_object_hold( p_input_thread );
     unlock_input(p_mi);
+
+    if( b_preloaded )
+    {
+        sync_input_events( p_mi, p_input_thread );
+        vlc_object_release( p_input_thread );
+    }
     return 0;
 }
 
@@ -988,6 +1136,7 @@ void libvlc_media_player_stop( libvlc_media_player_t *p_mi )
 {
     lock_input(p_mi);
     release_input_thread( p_mi ); /* This will stop the input thread */
+    release_next_input( p_mi );
 
     /* Force to go to stopped state, in case we were in Ended, or Error
      * state. */
@@ -1005,6 +1154,34 @@ void libvlc_media_player_stop( libvlc_media_player_t *p_mi )
     unlock_input(p_mi);
 }
 
+void libvlc_media_player_reset( libvlc_media_player_t *p_mi )
+{
+    libvlc_media_player_stop( p_mi );
+    libvlc_media_player_set_media( p_mi, NULL );
+
+    for( size_t i = 0; i < ARRAY_SIZE(mp_settings); i++ )
+    {
+        const char *name = mp_settings[i].name;
+        int type = mp_settings[i].type & VLC_VAR_CLASS;
+        vlc_value_t val;
+
+        if( !(mp_settings[i].type & VLC_VAR_DOINHERIT)
+         || var_Inherit( VLC_OBJECT(p_mi->p_libvlc), name, type, &val ) )
+        {   /* Same as a newly created variable */
+            memset( &val, 0, sizeof (val) );
+            if( type == VLC_VAR_STRING )
+                val.psz_string = (char *)"";
+            var_Set( p_mi, name, val );
+            continue;
+        }
+
+        var_Set( p_mi, name, val );
+        if( type == VLC_VAR_STRING )
+            free( val.psz_string );
+    }
+    var_SetInteger( p_mi, "vbi-page", 100 );
+}
+
 
 void libvlc_video_set_callbacks( libvlc_media_player_t *mp,
     void *(*lock_cb) (void *, void **),
@@ -1236,6 +1413,20 @@ libvlc_time_t libvlc_media_player_get_time( libvlc_media_player_t *p_mi )
     return i_time;
 }
 
+libvlc_time_t libvlc_media_player_get_latency( libvlc_media_player_t *p_mi )
+{
+    input_thread_t *p_input_thread;
+    libvlc_time_t i_latency;
+
+    p_input_thread = libvlc_get_input_thread ( p_mi );
+    if( !p_input_thread )
+        return -1;
+
+    i_latency = from_mtime(var_GetInteger( p_input_thread, "latency" ));
+    vlc_object_release( p_input_thread );
+    return i_latency;
+}
+
 void libvlc_media_player_set_time( libvlc_media_player_t *p_mi,
                                    libvlc_time_t i_time )
 {
@@ -47,6 +47,8 @@ struct libvlc_media_player_t
     {
         input_thread_t   *p_thread;
         input_resource_t *p_resource;
+        input_thread_t   *p_next; /* pre-opened in standby */
+        libvlc_media_t   *p_next_md;
         vlc_mutex_t       lock;
     } input;
 
@@ -59,6 +61,9 @@ struct libvlc_media_player_t
 /* Media player - audio, video */
 input_thread_t *libvlc_get_input_thread(libvlc_media_player_t * );
 
+/* Media player - pre-open a media for gapless playback */
+int libvlc_media_player_preload( libvlc_media_player_t *, libvlc_media_t * );
+
 
 libvlc_track_description_t * libvlc_get_track_description(
         libvlc_media_player_t *p_mi,
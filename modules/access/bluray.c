@@ -116,6 +116,14 @@ typedef struct bluray_overlay_t
     subpicture_region_t *p_regions;
     int                 width, height;
 
+    /* regions handed to the vout, shared with the subpicture. Only the area
+     * drawn since the last update is copied from p_regions into them. */
+    subpicture_region_t *p_display;
+    struct
+    {
+        int x0, y0, x1, y1;
+    } dirty;
+
     /* pointer to last subpicture updater.
      * used to disconnect this overlay from vout when:
      * - the overlay is closed
@@ -804,6 +812,98 @@ static void updater_unlock_overlay(subpicture_updater_sys_t *p_upd_sys)
     vlc_mutex_unlock(&p_upd_sys->lock);
 }
 
+static void blurayDirtyAdd(bluray_overlay_t *ov, int x, int y, int w, int h)
+{
+    if (ov->dirty.x0 >= ov->dirty.x1 || ov->dirty.y0 >= ov->dirty.y1) {
+        ov->dirty.x0 = x;
+        ov->dirty.y0 = y;
+        ov->dirty.x1 = x + w;
+        ov->dirty.y1 = y + h;
+    } else {
+        ov->dirty.x0 = __MIN(ov->dirty.x0, x);
+        ov->dirty.y0 = __MIN(ov->dirty.y0, y);
+        ov->dirty.x1 = __MAX(ov->dirty.x1, x + w);
+        ov->dirty.y1 = __MAX(ov->dirty.y1, y + h);
+    }
+}
+
+static bool blurayRegionSameLayout(const subpicture_region_t *a,
+                                   const subpicture_region_t *b)
+{
+    for (; a != NULL && b != NULL; a = a->p_next, b = b->p_next)
+        if (a->i_x != b->i_x || a->i_y != b->i_y ||
+            a->fmt.i_chroma != b->fmt.i_chroma ||
+            a->fmt.i_width != b->fmt.i_width ||
+            a->fmt.i_height != b->fmt.i_height ||
+            picture_IsReferenced(b->p_picture))
+            return false;
+    return a == NULL && b == NULL;
+}
+
+/*
+ * Bring the displayed regions up to date with the drawn ones.
+ * Only the dirty area is copied, unless the region layout changed or the
+ * displayed pictures are still used by the vout.
+ * Called with the overlay lock held. Returns false if there is nothing to
+ * display.
+ */
+static bool blurayOverlaySync(bluray_overlay_t *ov)
+{
+    if (!blurayRegionSameLayout(ov->p_regions, ov->p_display)) {
+        subpicture_region_ChainDelete(ov->p_display);
+        ov->p_display = NULL;
+
+        subpicture_region_t **pp_dst = &ov->p_display;
+        for (subpicture_region_t *p_src = ov->p_regions; p_src != NULL;
+             p_src = p_src->p_next) {
+            *pp_dst = subpicture_region_Copy(p_src);
+            if (*pp_dst == NULL)
+                break;
+            pp_dst = &(*pp_dst)->p_next;
+        }
+    } else if (ov->dirty.x0 < ov->dirty.x1 && ov->dirty.y0 < ov->dirty.y1) {
+        subpicture_region_t *p_dst = ov->p_display;
+        for (subpicture_region_t *p_src = ov->p_regions; p_src != NULL;
+             p_src = p_src->p_next, p_dst = p_dst->p_next) {
+            if (p_src->fmt.p_palette)
+                *p_dst->fmt.p_palette = *p_src->fmt.p_palette;
+
+            int x0 = __MAX(ov->dirty.x0 - p_src->i_x, 0);
+            int y0 = __MAX(ov->dirty.y0 - p_src->i_y, 0);
+            int x1 = __MIN(ov->dirty.x1 - p_src->i_x, (int)p_src->fmt.i_width);
+            int y1 = __MIN(ov->dirty.y1 - p_src->i_y, (int)p_src->fmt.i_height);
+            if (x0 >= x1 || y0 >= y1)
+                continue;
+
+            const plane_t *src = &p_src->p_picture->p[0];
+            plane_t       *dst = &p_dst->p_picture->p[0];
+            for (int y = y0; y < y1; y++)
+                memcpy(&dst->p_pixels[y * dst->i_pitch + x0 * dst->i_pixel_pitch],
+                       &src->p_pixels[y * src->i_pitch + x0 * src->i_pixel_pitch],
+                       (x1 - x0) * src->i_pixel_pitch);
+        }
+    }
+    ov->dirty.x0 = ov->dirty.x1 = 0;
+
+    return ov->p_display != NULL;
+}
+
+/* New region sharing the picture of the given one */
+static subpicture_region_t *blurayRegionShare(subpicture_region_t *p_src)
+{
+    subpicture_region_t *p_dst = subpicture_region_New(&p_src->fmt);
+    if (unlikely(p_dst == NULL))
+        return NULL;
+
+    picture_Release(p_dst->p_picture);
+    p_dst->p_picture = picture_Hold(p_src->p_picture);
+    p_dst->i_x     = p_src->i_x;
+    p_dst->i_y     = p_src->i_y;
+    p_dst->i_align = p_src->i_align;
+    p_dst->i_alpha = p_src->i_alpha;
+    return p_dst;
+}
+
 static int subpictureUpdaterValidate(subpicture_t *p_subpic,
                                       bool b_fmt_src, const video_format_t *p_fmt_src,
                                       bool b_fmt_dst, const video_format_t *p_fmt_dst,
@@ -848,22 +948,19 @@ static void subpictureUpdaterUpdate(subpicture_t *p_subpic,
      * When this function is called, all p_subpic regions are gone.
      * We need to duplicate our regions (stored internaly) to this subpic.
      */
-    subpicture_region_t *p_src = p_overlay->p_regions;
-    if (!p_src) {
+    if (!blurayOverlaySync(p_overlay)) {
         updater_unlock_overlay(p_upd_sys);
         return;
     }
 
     subpicture_region_t **p_dst = &p_subpic->p_region;
-    while (p_src != NULL) {
-        *p_dst = subpicture_region_Copy(p_src);
+    for (subpicture_region_t *p_src = p_overlay->p_display; p_src != NULL;
+         p_src = p_src->p_next) {
+        *p_dst = blurayRegionShare(p_src);
         if (*p_dst == NULL)
             break;
         p_dst = &(*p_dst)->p_next;
-        p_src = p_src->p_next;
     }
-    if (*p_dst != NULL)
-        (*p_dst)->p_next = NULL;
     p_overlay->status = Displayed;
 
     updater_unlock_overlay(p_upd_sys);
@@ -973,6 +1070,7 @@ static void blurayCloseOverlay(demux_t *p_demux, int plane)
 
         vlc_mutex_destroy(&ov->lock);
         subpicture_region_ChainDelete(ov->p_regions);
+        subpicture_region_ChainDelete(ov->p_display);
         free(ov);
 
         p_sys->p_overlays[plane] = NULL;
@@ -1054,6 +1152,7 @@ static void blurayClearOverlay(demux_t *p_demux, int plane)
 
     subpicture_region_ChainDelete(ov->p_regions);
     ov->p_regions = NULL;
+    blurayDirtyAdd(ov, 0, 0, ov->width, ov->height);
     ov->status = Outdated;
 
     vlc_mutex_unlock(&ov->lock);
@@ -1123,6 +1222,8 @@ static void blurayDrawOverlay(demux_t *p_demux, const BD_OVERLAY* const ov)
         }
     }
 
+    blurayDirtyAdd(p_sys->p_overlays[ov->plane], ov->x, ov->y, ov->w, ov->h);
+
     vlc_mutex_unlock(&p_sys->p_overlays[ov->plane]->lock);
     /*
      * /!\ The region is now stored in our internal list, but not in the subpicture /!\
@@ -1217,6 +1318,8 @@ static void blurayDrawArgbOverlay(demux_t *p_demux, const BD_ARGB_OVERLAY* const
         dst0 += p_reg->p_picture->p[0].i_pitch;
     }
 
+    blurayDirtyAdd(p_sys->p_overlays[ov->plane], ov->x, ov->y, ov->w, ov->h);
+
     vlc_mutex_unlock(&p_sys->p_overlays[ov->plane]->lock);
     /*
      * /!\ The region is now stored in our internal list, but not in the subpicture /!\
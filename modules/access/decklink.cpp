@@ -92,6 +92,10 @@ static const char *const ppsz_audioconns_text[] = {
 #define ASPECT_RATIO_TEXT N_("Aspect ratio")
 #define ASPECT_RATIO_LONGTEXT N_(\
     "Aspect ratio (4:3, 16:9). Default assumes square pixels.")
+#define V210_TEXT N_("Pass v210 through")
+#define V210_LONGTEXT N_(\
+    "Send the 10 bits video as captured (v210), instead of converting it " \
+    "to planar 4:2:2.")
 
 vlc_module_begin ()
     set_shortname(N_("DeckLink"))
@@ -116,6 +120,7 @@ vlc_module_begin ()
     add_string("decklink-aspect-ratio", NULL,
                 ASPECT_RATIO_TEXT, ASPECT_RATIO_LONGTEXT, true)
     add_bool("decklink-tenbits", false, N_("10 bits"), N_("10 bits"), true)
+    add_bool("decklink-v210", false, V210_TEXT, V210_LONGTEXT, true)
 
     add_shortcut("decklink")
     set_capability("access_demux", 10)
@@ -126,6 +131,17 @@ static int Control(demux_t *, int, va_list);
 
 class DeckLinkCaptureDelegate;
 
+/* The captured frames and audio packets are sent without copy, holding a
+ * reference to them. The card drops incoming frames when all its buffers are
+ * held, so past this count the data is copied instead. */
+#define MAX_HELD_FRAMES 8
+
+/* Owner of the frames in flight, that can outlive the demux */
+struct frame_pool_t
+{
+    std::atomic_uint refs; /* the demux and the blocks in flight */
+};
+
 struct demux_sys_t
 {
     IDeckLink *card;
@@ -150,8 +166,53 @@ struct demux_sys_t
     int channels;
 
     bool tenbits;
+    bool v210;
+
+    frame_pool_t *pool;
 };
 
+static void frame_pool_Release(frame_pool_t *pool)
+{
+    if (pool->refs.fetch_sub(1) == 1)
+        delete pool;
+}
+
+struct frame_block_t
+{
+    block_t self;
+    IUnknown *frame;
+    frame_pool_t *pool;
+};
+
+static void frame_block_Release(block_t *block)
+{
+    frame_block_t *fb = (frame_block_t *)block;
+
+    fb->frame->Release();
+    frame_pool_Release(fb->pool);
+    free(fb);
+}
+
+/* Wraps a video frame or audio packet of the card into a block */
+static block_t *frame_block_Hold(frame_pool_t *pool, IUnknown *frame,
+                                 void *data, size_t size)
+{
+    if (pool->refs.load() > MAX_HELD_FRAMES)
+        return NULL;
+
+    frame_block_t *fb = (frame_block_t *)malloc(sizeof(*fb));
+    if (unlikely(fb == NULL))
+        return NULL;
+
+    block_Init(&fb->self, data, size);
+    fb->self.pf_release = frame_block_Release;
+    fb->frame = frame;
+    fb->pool = pool;
+    frame->AddRef();
+    pool->refs.fetch_add(1);
+    return &fb->self;
+}
+
 static const char *GetFieldDominance(BMDFieldDominance dom, uint32_t *flags)
 {
     switch(dom)
@@ -185,7 +246,7 @@ static es_format_t GetModeSettings(demux_t *demux, IDeckLinkDisplayMode *m)
     }
 
     es_format_t video_fmt;
-    vlc_fourcc_t chroma; chroma = sys->tenbits ? VLC_CODEC_I422_10L : VLC_CODEC_UYVY;
+    vlc_fourcc_t chroma; chroma = sys->tenbits ? (sys->v210 ? VLC_CODEC_V210 : VLC_CODEC_I422_10L) : VLC_CODEC_UYVY;
     es_format_Init(&video_fmt, VIDEO_ES, chroma);
 
     video_fmt.video.i_width = m->GetWidth();
@@ -282,21 +343,40 @@ HRESULT DeckLinkCaptureDelegate::VideoInputFrameArrived(IDeckLinkVideoInputFrame
         const int height = videoFrame->GetHeight();
         const int stride = videoFrame->GetRowBytes();
 
-        int bpp = sys->tenbits ? 4 : 2;
-        block_t *video_frame = block_Alloc(width * height * bpp);
-        if (!video_frame)
-            return S_OK;
-
         const uint32_t *frame_bytes;
         videoFrame->GetBytes((void**)&frame_bytes);
 
+        /* v210 rows are padded to 128 bytes, as decoders expect them */
+        const bool passthrough = sys->tenbits ? sys->v210 : stride == width * 2;
+        block_t *video_frame = NULL;
+        if (passthrough)
+            video_frame = frame_block_Hold(sys->pool, videoFrame,
+                                           (void *)frame_bytes, stride * height);
+        if (!video_frame) {
+            int bpp = sys->tenbits ? 4 : 2;
+            video_frame = block_Alloc(passthrough ? stride * height
+                                                  : width * height * bpp);
+            if (!video_frame)
+                return S_OK;
+
+            if (passthrough)
+                memcpy(video_frame->p_buffer, frame_bytes, stride * height);
+            else if (sys->tenbits)
+                v210_convert((uint16_t*)video_frame->p_buffer, frame_bytes, width, height);
+            else
+                for (int y = 0; y < height; ++y) {
+                    const uint8_t *src = (const uint8_t *)frame_bytes + stride * y;
+                    uint8_t *dst = video_frame->p_buffer + width * 2 * y;
+                    memcpy(dst, src, width * 2);
+                }
+        }
+
         BMDTimeValue stream_time, frame_duration;
         videoFrame->GetStreamTime(&stream_time, &frame_duration, CLOCK_FREQ);
         video_frame->i_flags = BLOCK_FLAG_TYPE_I | sys->dominance_flags;
         video_frame->i_pts = video_frame->i_dts = VLC_TS_0 + stream_time;
 
         if (sys->tenbits) {
-            v210_convert((uint16_t*)video_frame->p_buffer, frame_bytes, width, height);
             IDeckLinkVideoFrameAncillary *vanc;
             if (videoFrame->GetAncillaryData(&vanc) == S_OK) {
                 for (int i = 1; i < 21; i++) {
@@ -328,12 +408,6 @@ HRESULT DeckLinkCaptureDelegate::VideoInputFrameArrived(IDeckLinkVideoInputFrame
                 }
                 vanc->Release();
             }
-        } else {
-            for (int y = 0; y < height; ++y) {
-                const uint8_t *src = (const uint8_t *)frame_bytes + stride * y;
-                uint8_t *dst = video_frame->p_buffer + width * 2 * y;
-                memcpy(dst, src, width * 2);
-            }
         }
 
         vlc_mutex_lock(&sys->pts_lock);
@@ -348,13 +422,17 @@ HRESULT DeckLinkCaptureDelegate::VideoInputFrameArrived(IDeckLinkVideoInputFrame
     if (audioFrame) {
         const int bytes = audioFrame->GetSampleFrameCount() * sizeof(int16_t) * sys->channels;
 
-        block_t *audio_frame = block_Alloc(bytes);
-        if (!audio_frame)
-            return S_OK;
-
         void *frame_bytes;
         audioFrame->GetBytes(&frame_bytes);
-        memcpy(audio_frame->p_buffer, frame_bytes, bytes);
+
+        block_t *audio_frame = frame_block_Hold(sys->pool, audioFrame,
+                                                frame_bytes, bytes);
+        if (!audio_frame) {
+            audio_frame = block_Alloc(bytes);
+            if (!audio_frame)
+                return S_OK;
+            memcpy(audio_frame->p_buffer, frame_bytes, bytes);
+        }
 
         BMDTimeValue packet_time;
         audioFrame->GetPacketTime(&packet_time, CLOCK_FREQ);
@@ -465,6 +543,10 @@ static int Open(vlc_object_t *p_this)
     vlc_mutex_init(&sys->pts_lock);
 
     sys->tenbits = var_InheritBool(p_this, "decklink-tenbits");
+    sys->v210 = var_InheritBool(p_this, "decklink-v210");
+
+    sys->pool = new frame_pool_t;
+    sys->pool->refs.store(1);
 
     IDeckLinkIterator *decklink_iterator = CreateDeckLinkIteratorInstance();
     if (!decklink_iterator) {
@@ -684,6 +766,7 @@ static void Close(vlc_object_t *p_this)
     if (sys->delegate)
         sys->delegate->Release();
 
+    frame_pool_Release(sys->pool);
     vlc_mutex_destroy(&sys->pts_lock);
     free(sys);
 }
@@ -213,6 +213,8 @@ dvb_device_t *dvb_open (vlc_object_t *obj)
     d->budget = var_InheritBool (obj, "dvb-budget-mode");
 
 #ifndef USE_DMX
+    for (size_t i = 0; i < MAX_PIDS; i++)
+        d->pids[i].pid = d->pids[i].fd = -1;
     if (d->budget)
 #endif
     {
@@ -249,8 +251,6 @@ dvb_device_t *dvb_open (vlc_object_t *obj)
     }
     else
     {
-        for (size_t i = 0; i < MAX_PIDS; i++)
-            d->pids[i].pid = d->pids[i].fd = -1;
         d->demux = dvb_open_node (d, "dvr", O_RDONLY);
         if (d->demux == -1)
         {
@@ -284,12 +284,9 @@ error:
 void dvb_close (dvb_device_t *d)
 {
 #ifndef USE_DMX
-    if (!d->budget)
-    {
-        for (size_t i = 0; i < MAX_PIDS; i++)
-            if (d->pids[i].fd != -1)
-                close (d->pids[i].fd);
-    }
+    for (size_t i = 0; i < MAX_PIDS; i++)
+        if (d->pids[i].fd != -1)
+            close (d->pids[i].fd);
 #endif
 #ifdef HAVE_DVBPSI
     if (d->cam != NULL)
@@ -385,6 +382,50 @@ ssize_t dvb_read (dvb_device_t *d, void *buf, size_t len)
     return -1;
 }
 
+#ifndef USE_DMX
+/**
+ * Falls back to receiving the full transport stream through the DVR, when
+ * the demultiplexer runs out of PID filters.
+ */
+static int dvb_set_budget (dvb_device_t *d, int errnum)
+{
+    int fd = dvb_open_node (d, "demux", O_RDONLY);
+    if (fd == -1)
+        goto error;
+
+    struct dmx_pes_filter_params param;
+
+    param.pid = 0x2000;
+    param.input = DMX_IN_FRONTEND;
+    param.output = DMX_OUT_TS_TAP;
+    param.pes_type = DMX_PES_OTHER;
+    param.flags = DMX_IMMEDIATE_START;
+    if (ioctl (fd, DMX_SET_PES_FILTER, &param) < 0)
+    {
+        close (fd);
+        goto error;
+    }
+
+    /* Close the PID filters only now, so that no packets are lost. */
+    for (size_t i = 0; i < MAX_PIDS; i++)
+        if (d->pids[i].fd != -1)
+        {
+            close (d->pids[i].fd);
+            d->pids[i].pid = d->pids[i].fd = -1;
+        }
+    d->pids[0].fd = fd;
+    d->pids[0].pid = 0x2000;
+    d->budget = true;
+
+    msg_Warn (d->obj, "cannot filter more PIDs (%s), "
+              "receiving the full transport stream", vlc_strerror_c(errnum));
+    return 0;
+error:
+    errno = errnum;
+    return -1;
+}
+#endif
+
 int dvb_add_pid (dvb_device_t *d, uint16_t pid)
 {
     if (d->budget)
@@ -424,6 +465,8 @@ int dvb_add_pid (dvb_device_t *d, uint16_t pid)
     }
     errno = EMFILE;
 error:
+    if (dvb_set_budget (d, errno) == 0)
+        return 0;
 #endif
     msg_Err (d->obj, "cannot add PID 0x%04"PRIu16": %s", pid,
              vlc_strerror_c(errno));
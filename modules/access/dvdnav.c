@@ -146,6 +146,13 @@ struct demux_sys_t
     uint8_t  palette[4][4];
     bool b_spu_change;
 
+    /* last highlight sent to the vout */
+    struct
+    {
+        bool b_enabled;
+        int  sx, sy, ex, ey;
+    } highlight;
+
     /* Aspect ration */
     struct {
         unsigned i_num;
@@ -1214,17 +1221,34 @@ static void ButtonUpdate( demux_t *p_demux, bool b_mode )
 
     if( b_button_ok )
     {
+        uint8_t palette[4][4];
+
         for( unsigned i = 0; i < 4; i++ )
         {
             uint32_t i_yuv = p_sys->clut[(hl.palette>>(16+i*4))&0x0f];
             uint8_t i_alpha = ( (hl.palette>>(i*4))&0x0f ) * 0xff / 0xf;
 
-            p_sys->palette[i][0] = (i_yuv >> 16) & 0xff;
-            p_sys->palette[i][1] = (i_yuv >> 0) & 0xff;
-            p_sys->palette[i][2] = (i_yuv >> 8) & 0xff;
-            p_sys->palette[i][3] = i_alpha;
+            palette[i][0] = (i_yuv >> 16) & 0xff;
+            palette[i][1] = (i_yuv >> 0) & 0xff;
+            palette[i][2] = (i_yuv >> 8) & 0xff;
+            palette[i][3] = i_alpha;
         }
 
+        /* Every highlight change makes the vout crop and reconvert the
+         * menu subpicture: skip the ones that do not change anything */
+        if( p_sys->highlight.b_enabled &&
+            p_sys->highlight.sx == hl.sx && p_sys->highlight.sy == hl.sy &&
+            p_sys->highlight.ex == hl.ex && p_sys->highlight.ey == hl.ey &&
+            !memcmp( p_sys->palette, palette, sizeof(palette) ) )
+            return;
+
+        p_sys->highlight.b_enabled = true;
+        p_sys->highlight.sx = hl.sx;
+        p_sys->highlight.sy = hl.sy;
+        p_sys->highlight.ex = hl.ex;
+        p_sys->highlight.ey = hl.ey;
+        memcpy( p_sys->palette, palette, sizeof(palette) );
+
         vlc_global_lock( VLC_HIGHLIGHT_MUTEX );
         var_SetInteger( p_demux->p_input, "x-start", hl.sx );
         var_SetInteger( p_demux->p_input, "x-end",  hl.ex );
@@ -1241,6 +1265,10 @@ static void ButtonUpdate( demux_t *p_demux, bool b_mode )
         msg_Dbg( p_demux, "buttonUpdate not done b=%d t=%d",
                  i_button, i_title );
 
+        if( !p_sys->highlight.b_enabled )
+            return;
+        p_sys->highlight.b_enabled = false;
+
         /* Show all */
         vlc_global_lock( VLC_HIGHLIGHT_MUTEX );
         var_SetBool( p_demux->p_input, "highlight", false );
@@ -52,6 +52,9 @@
 #   include <unistd.h>
 #endif
 #include <dirent.h>
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include "fs.h"
@@ -70,6 +73,20 @@ struct access_sys_t
     int fd;
 
     bool b_pace_control;
+#ifdef HAVE_MMAP
+    uint64_t offset; /* of the next mapped block */
+    bool b_seeked; /* the next block follows a seek */
+#endif
+#ifdef HAVE_PREAD
+    struct file_read **reads; /* asynchronous read-ahead, or NULL */
+    unsigned read_count;
+    uint64_t pos; /* of the next byte to return */
+    uint64_t next_offset; /* of the next read to queue */
+    vlc_mutex_t lock;
+    vlc_cond_t wait_work; /* read queued */
+    vlc_sem_t wait_done; /* read completed */
+    bool quit;
+#endif
 };
 
 #if !defined (_WIN32) && !defined (__OS2__)
@@ -129,6 +146,14 @@ static bool IsRemote (const char *path)
 #endif
 
 static ssize_t Read (access_t *, uint8_t *, size_t);
+#ifdef HAVE_MMAP
+static block_t *MmapBlock (access_t *);
+static int MmapSeek (access_t *, uint64_t);
+#endif
+#ifdef HAVE_PREAD
+static int AsyncInit (access_t *, unsigned);
+static void AsyncClean (access_t *);
+#endif
 static int FileSeek (access_t *, uint64_t);
 static int NoSeek (access_t *, uint64_t);
 static int FileControl (access_t *, int, va_list);
@@ -219,6 +244,9 @@ int FileOpen( vlc_object_t *p_this )
     p_access->pf_control = FileControl;
     p_access->p_sys = p_sys;
     p_sys->fd = fd;
+#ifdef HAVE_PREAD
+    p_sys->reads = NULL;
+#endif
 
     if (S_ISREG (st.st_mode) || S_ISBLK (st.st_mode))
     {
@@ -237,6 +265,30 @@ int FileOpen( vlc_object_t *p_this )
             fcntl (fd, F_RDAHEAD, 0);
         else
             fcntl (fd, F_RDAHEAD, 1);
+#endif
+#ifdef HAVE_MMAP
+        /* Mapping remote files would crash (SIGBUS) on network errors. */
+        if (S_ISREG (st.st_mode) && var_InheritBool (p_access, "file-mmap")
+         && !IsRemote(fd, p_access->psz_filepath))
+        {
+            msg_Dbg (p_access, "using memory mapping");
+            p_access->pf_read = NULL;
+            p_access->pf_block = MmapBlock;
+            p_access->pf_seek = MmapSeek;
+            p_sys->offset = 0;
+            p_sys->b_seeked = false;
+        }
+#endif
+#ifdef HAVE_PREAD
+        /* Each read blocks for a whole round trip on network file systems,
+         * so keep several of them in flight. */
+        if (S_ISREG (st.st_mode) && p_access->pf_read != NULL
+         && IsRemote(fd, p_access->psz_filepath))
+        {
+            unsigned count = var_InheritInteger (p_access, "file-async-reads");
+            if (count > 0 && AsyncInit (p_access, count) == VLC_SUCCESS)
+                msg_Dbg (p_access, "using %u asynchronous reads", count);
+        }
 #endif
     }
     else
@@ -259,7 +311,7 @@ void FileClose (vlc_object_t * p_this)
 {
     access_t     *p_access = (access_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_read == NULL && p_access->pf_block == NULL)
     {
         DirClose (p_this);
         return;
@@ -267,6 +319,10 @@ void FileClose (vlc_object_t * p_this)
 
     access_sys_t *p_sys = p_access->p_sys;
 
+#ifdef HAVE_PREAD
+    if (p_sys->reads != NULL)
+        AsyncClean (p_access);
+#endif
     close (p_sys->fd);
     free (p_sys);
 }
@@ -298,6 +354,341 @@ static ssize_t Read (access_t *p_access, uint8_t *p_buffer, size_t i_len)
     return val;
 }
 
+#ifdef HAVE_MMAP
+#define MMAP_SIZE (1 << 20) /* bytes per block */
+
+/*****************************************************************************
+ * MmapBlock: map the next part of the file, without copying it
+ *****************************************************************************/
+static block_t *MmapBlock (access_t *p_access)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    struct stat st;
+
+    /* The size is checked every time, as the file may still be growing
+     * (e.g. a recording in progress). */
+    if (fstat (p_sys->fd, &st))
+    {
+        msg_Err (p_access, "read error: %s", vlc_strerror_c(errno));
+        p_access->info.b_eof = true;
+        return NULL;
+    }
+
+    if (p_sys->offset >= (uint64_t)st.st_size)
+    {
+        p_access->info.b_eof = true;
+        return NULL;
+    }
+
+    /* The mapping must start on a page boundary */
+    uint64_t page_mask = sysconf (_SC_PAGESIZE) - 1;
+    uint64_t base = p_sys->offset & ~page_mask;
+    size_t delta = p_sys->offset - base;
+    size_t length = MMAP_SIZE;
+
+    if ((uint64_t)st.st_size - p_sys->offset < length)
+        length = st.st_size - p_sys->offset;
+
+    void *addr = mmap (NULL, delta + length, PROT_READ, MAP_SHARED,
+                       p_sys->fd, base);
+    if (addr == MAP_FAILED)
+    {
+        msg_Err (p_access, "memory mapping error: %s",
+                 vlc_strerror_c(errno));
+        p_access->info.b_eof = true;
+        return NULL;
+    }
+
+#ifdef HAVE_POSIX_MADVISE
+    /* Read ahead while playing linearly, but not right after a seek, as
+     * demuxers looking for an index or scrubbing only need a few pages. */
+    posix_madvise (addr, delta + length, p_sys->b_seeked
+                   ? POSIX_MADV_RANDOM : POSIX_MADV_SEQUENTIAL);
+#endif
+
+    block_t *block = block_mmap_Alloc ((char *)addr + delta, length);
+    if (unlikely(block == NULL))
+        return NULL;
+
+    p_sys->offset += length;
+    p_sys->b_seeked = false;
+    return block;
+}
+
+static int MmapSeek (access_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    p_access->info.b_eof = false;
+    if (p_sys->offset != i_pos)
+        p_sys->b_seeked = true;
+    p_sys->offset = i_pos;
+    return VLC_SUCCESS;
+}
+#endif
+
+#ifdef HAVE_PREAD
+#define ASYNC_READ_SIZE (1 << 18) /* bytes per read */
+
+/* One read-ahead request, served by its own thread with pread() */
+struct file_read
+{
+    vlc_thread_t thread;
+    access_sys_t *sys;
+    uint64_t offset;
+    ssize_t result;
+    int errnum;
+    enum { READ_FREE, READ_PENDING, READ_RUNNING, READ_DONE } state;
+    bool stale; /* dropped by a seek while running */
+    uint8_t buf[ASYNC_READ_SIZE];
+};
+
+/* Must be called with the lock held */
+static void AsyncSchedule (access_sys_t *p_sys)
+{
+    bool queued = false;
+
+    for (unsigned i = 0; i < p_sys->read_count; i++)
+    {
+        struct file_read *r = p_sys->reads[i];
+
+        /* Recycle the reads that were consumed entirely */
+        if (r->state == READ_DONE && r->offset + ASYNC_READ_SIZE <= p_sys->pos)
+            r->state = READ_FREE;
+    }
+
+    for (unsigned i = 0; i < p_sys->read_count; i++)
+    {
+        struct file_read *r = p_sys->reads[i];
+
+        if (r->state != READ_FREE)
+            continue;
+        r->offset = p_sys->next_offset;
+        r->state = READ_PENDING;
+        p_sys->next_offset += ASYNC_READ_SIZE;
+        queued = true;
+    }
+
+    if (queued)
+        vlc_cond_broadcast (&p_sys->wait_work);
+}
+
+/* Must be called with the lock held */
+static struct file_read *AsyncFind (access_sys_t *p_sys)
+{
+    for (unsigned i = 0; i < p_sys->read_count; i++)
+    {
+        struct file_read *r = p_sys->reads[i];
+
+        if (r->state != READ_FREE && !r->stale && r->offset <= p_sys->pos
+         && p_sys->pos - r->offset < ASYNC_READ_SIZE)
+            return r;
+    }
+    return NULL;
+}
+
+/* Must be called with the lock held */
+static void AsyncRestart (access_sys_t *p_sys)
+{
+    for (unsigned i = 0; i < p_sys->read_count; i++)
+    {
+        struct file_read *r = p_sys->reads[i];
+
+        if (r->state == READ_RUNNING)
+            r->stale = true;
+        else
+            r->state = READ_FREE;
+    }
+    p_sys->next_offset = p_sys->pos;
+    AsyncSchedule (p_sys);
+}
+
+static void *AsyncThread (void *data)
+{
+    struct file_read *r = data;
+    access_sys_t *p_sys = r->sys;
+
+    vlc_mutex_lock (&p_sys->lock);
+    for (;;)
+    {
+        while (!p_sys->quit && r->state != READ_PENDING)
+            vlc_cond_wait (&p_sys->wait_work, &p_sys->lock);
+        if (p_sys->quit)
+            break;
+
+        uint64_t offset = r->offset;
+        r->state = READ_RUNNING;
+        vlc_mutex_unlock (&p_sys->lock);
+
+        /* Network file systems may return less than asked before the end */
+        size_t done = 0;
+        ssize_t val;
+        do
+        {
+            val = pread (p_sys->fd, r->buf + done, ASYNC_READ_SIZE - done,
+                         offset + done);
+            if (val > 0)
+                done += val;
+        }
+        while ((val > 0 && done < ASYNC_READ_SIZE)
+            || (val < 0 && errno == EINTR));
+        int errnum = errno;
+
+        vlc_mutex_lock (&p_sys->lock);
+        r->result = (val < 0 && done == 0) ? -1 : (ssize_t)done;
+        r->errnum = errnum;
+        if (r->stale)
+        {
+            r->stale = false;
+            r->state = READ_FREE;
+            AsyncSchedule (p_sys);
+        }
+        else
+            r->state = READ_DONE;
+        vlc_sem_post (&p_sys->wait_done);
+    }
+    vlc_mutex_unlock (&p_sys->lock);
+    return NULL;
+}
+
+/*****************************************************************************
+ * AsyncRead: return data from the reads in flight, and queue the next ones
+ *****************************************************************************/
+static ssize_t AsyncRead (access_t *p_access, uint8_t *p_buffer, size_t i_len)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    struct file_read *r;
+
+    vlc_mutex_lock (&p_sys->lock);
+    while ((r = AsyncFind (p_sys)) == NULL || r->state != READ_DONE)
+    {
+        if (r == NULL)
+        {   /* Seek, or consumed faster than read */
+            AsyncRestart (p_sys);
+            continue;
+        }
+
+        vlc_mutex_unlock (&p_sys->lock);
+        if (vlc_sem_wait_i11e (&p_sys->wait_done))
+        {
+            errno = EINTR;
+            return -1;
+        }
+        vlc_mutex_lock (&p_sys->lock);
+    }
+
+    ssize_t val = 0;
+
+    if (r->result < 0)
+    {
+        int errnum = r->errnum;
+
+        r->state = READ_FREE; /* retry on the next attempt */
+        vlc_mutex_unlock (&p_sys->lock);
+
+        msg_Err (p_access, "read error: %s", vlc_strerror_c(errnum));
+        dialog_Fatal (p_access, _("File reading failed"),
+                      _("VLC could not read the file (%s)."),
+                      vlc_strerror(errnum));
+        p_access->info.b_eof = true;
+        return 0;
+    }
+
+    size_t delta = p_sys->pos - r->offset;
+    if ((size_t)r->result > delta)
+    {
+        val = r->result - delta;
+        if ((size_t)val > i_len)
+            val = i_len;
+        memcpy (p_buffer, r->buf + delta, val);
+        p_sys->pos += val;
+        AsyncSchedule (p_sys);
+    }
+    vlc_mutex_unlock (&p_sys->lock);
+
+    p_access->info.b_eof = !val;
+    return val;
+}
+
+static int AsyncSeek (access_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    p_access->info.b_eof = false;
+    /* The reads in flight are kept if they still cover the new position */
+    vlc_mutex_lock (&p_sys->lock);
+    p_sys->pos = i_pos;
+    vlc_mutex_unlock (&p_sys->lock);
+    return VLC_SUCCESS;
+}
+
+static int AsyncInit (access_t *p_access, unsigned count)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    p_sys->reads = calloc (count, sizeof (*p_sys->reads));
+    if (unlikely(p_sys->reads == NULL))
+        return VLC_ENOMEM;
+
+    p_sys->read_count = 0;
+    p_sys->pos = 0;
+    p_sys->next_offset = 0;
+    p_sys->quit = false;
+    vlc_mutex_init (&p_sys->lock);
+    vlc_cond_init (&p_sys->wait_work);
+    vlc_sem_init (&p_sys->wait_done, 0);
+
+    while (p_sys->read_count < count)
+    {
+        struct file_read *r = malloc (sizeof (*r));
+        if (unlikely(r == NULL))
+            break;
+
+        r->sys = p_sys;
+        r->state = READ_FREE;
+        r->stale = false;
+        if (vlc_clone (&r->thread, AsyncThread, r, VLC_THREAD_PRIORITY_INPUT))
+        {
+            free (r);
+            break;
+        }
+        p_sys->reads[p_sys->read_count++] = r;
+    }
+
+    if (p_sys->read_count == 0)
+    {
+        AsyncClean (p_access);
+        return VLC_EGENERIC;
+    }
+
+    p_access->pf_read = AsyncRead;
+    p_access->pf_seek = AsyncSeek;
+    return VLC_SUCCESS;
+}
+
+static void AsyncClean (access_t *p_access)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    vlc_mutex_lock (&p_sys->lock);
+    p_sys->quit = true;
+    vlc_cond_broadcast (&p_sys->wait_work);
+    vlc_mutex_unlock (&p_sys->lock);
+
+    for (unsigned i = 0; i < p_sys->read_count; i++)
+    {
+        vlc_join (p_sys->reads[i]->thread, NULL);
+        free (p_sys->reads[i]);
+    }
+
+    vlc_sem_destroy (&p_sys->wait_done);
+    vlc_cond_destroy (&p_sys->wait_work);
+    vlc_mutex_destroy (&p_sys->lock);
+    free (p_sys->reads);
+    p_sys->reads = NULL;
+}
+#endif
+
 /*****************************************************************************
  * Seek: seek to a specific location in a file
  *****************************************************************************/
@@ -39,6 +39,19 @@ vlc_module_begin ()
     set_capability( "access", 50 )
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( FileOpen, FileClose )
+#ifdef HAVE_MMAP
+    add_bool( "file-mmap", false, N_("Memory-map files"),
+              N_("Map local files into memory instead of reading them, so "
+                 "that the data is never copied. This helps with very large "
+                 "files read at high rates."), true )
+#endif
+#ifdef HAVE_PREAD
+    add_integer( "file-async-reads", 4, N_("Parallel reads"),
+                 N_("Number of reads kept in flight for files on network "
+                    "file systems (NFS, SMB...), to hide their latency. "
+                    "0 reads synchronously."), true )
+        change_integer_range( 0, 16 )
+#endif
 
     add_submodule()
     set_section( N_("Directory" ), NULL )
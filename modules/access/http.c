@@ -126,6 +126,13 @@ vlc_module_end ()
  * Local prototypes
  *****************************************************************************/
 
+/* Size of the first range requested after a seek; it doubles with each
+ * following range of a sequential read, up to HTTP_RANGE_MAX */
+#define HTTP_RANGE_MIN   (UINT64_C(256) << 10)
+#define HTTP_RANGE_MAX   (UINT64_C(16) << 20)
+/* Up to this many bytes are read and dropped rather than reconnecting */
+#define HTTP_DRAIN_MAX   (UINT64_C(64) << 10)
+
 struct access_sys_t
 {
     int fd;
@@ -176,6 +183,11 @@ struct access_sys_t
     uint64_t i_remaining;
     uint64_t offset;
     uint64_t size;
+    uint64_t i_range; /* size of requested ranges, 0 if open-ended */
+
+    /* statistics */
+    unsigned i_requests;
+    unsigned i_reused; /* requests sent on a persistent connection */
 
     /* cookie jar borrowed from playlist, do not free */
     vlc_http_cookie_jar_t * cookies;
@@ -200,6 +212,7 @@ static int Control( access_t *, int, va_list );
 
 /* */
 static int Connect( access_t *, uint64_t );
+static int Reuse( access_t *, uint64_t );
 static int Request( access_t *p_access, uint64_t i_tell );
 static void Disconnect( access_t * );
 
@@ -272,6 +285,9 @@ static int OpenRedirected( vlc_object_t *p_this, const char *psz_url,
     p_sys->b_has_size = false;
     p_sys->offset = 0;
     p_sys->size = 0;
+    p_sys->i_range = 0;
+    p_sys->i_requests = 0;
+    p_sys->i_reused = 0;
     p_access->info.b_eof  = false;
 
     /* Only forward an store cookies if the corresponding option is activated */
@@ -537,6 +553,9 @@ static void Close( vlc_object_t *p_this )
     access_t     *p_access = (access_t*)p_this;
     access_sys_t *p_sys = p_access->p_sys;
 
+    msg_Dbg( p_access, "%u request(s), %u on reused connections",
+             p_sys->i_requests, p_sys->i_reused );
+
     vlc_UrlClean( &p_sys->url );
     http_auth_Reset( &p_sys->auth );
     vlc_UrlClean( &p_sys->proxy );
@@ -638,6 +657,21 @@ static ssize_t Read( access_t *p_access, uint8_t *p_buffer, size_t i_len )
     if( p_sys->fd == -1 )
         goto fatal;
 
+    /* End of a bounded range response: request the next range */
+    if( p_sys->b_has_size && p_sys->i_remaining == 0 && p_sys->i_range > 0
+     && p_sys->offset < p_sys->size )
+    {
+        uint64_t i_tell = p_sys->offset;
+
+        p_sys->i_range = __MIN( 2 * p_sys->i_range, HTTP_RANGE_MAX );
+        if( Reuse( p_access, i_tell ) )
+        {
+            Disconnect( p_access );
+            if( Connect( p_access, i_tell ) )
+                goto fatal;
+        }
+    }
+
     if( p_sys->b_has_size )
     {
         /* Remaining bytes in the file */
@@ -840,14 +874,44 @@ static ssize_t ReadCompressed( access_t *p_access, uint8_t *p_buffer,
 #endif
 
 /*****************************************************************************
- * Seek: close and re-open a connection at the right place
+ * Drain: read and drop i_len bytes of the current response
+ *****************************************************************************/
+static int Drain( access_t *p_access, uint64_t i_len )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    uint8_t p_buffer[4096];
+
+    if( p_sys->fd == -1 || !p_sys->b_has_size || p_sys->b_chunked
+     || p_sys->i_icy_meta > 0 || i_len > p_sys->i_remaining
+     || i_len > HTTP_DRAIN_MAX )
+        return VLC_EGENERIC;
+#ifdef HAVE_ZLIB_H
+    if( p_sys->b_compressed )
+        return VLC_EGENERIC;
+#endif
+
+    while( i_len > 0 )
+    {
+        int i_read;
+
+        if( ReadData( p_access, &i_read, p_buffer,
+                      __MIN( i_len, sizeof (p_buffer) ) ) || i_read <= 0 )
+            return VLC_EGENERIC;
+        p_sys->offset += i_read;
+        p_sys->i_remaining -= i_read;
+        i_len -= i_read;
+    }
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Seek: skip forward, reuse the connection or re-open one at the right place
  *****************************************************************************/
 static int Seek( access_t *p_access, uint64_t i_pos )
 {
     access_sys_t *p_sys = p_access->p_sys;
 
     msg_Dbg( p_access, "trying to seek to %"PRId64, i_pos );
-    Disconnect( p_access );
 
     if( p_sys->size && i_pos >= p_sys->size )
     {
@@ -860,6 +924,22 @@ static int Seek( access_t *p_access, uint64_t i_pos )
         }
         return retval;
     }
+
+    /* Short forward seek within the current response */
+    if( i_pos >= p_sys->offset
+     && Drain( p_access, i_pos - p_sys->offset ) == VLC_SUCCESS )
+    {
+        p_access->info.b_eof = false;
+        return VLC_SUCCESS;
+    }
+
+    /* Demuxers often seek to read only a few bytes: only ask for a short
+     * range, so that the connection can be reused for the next seek. */
+    p_sys->i_range = p_sys->b_persist ? HTTP_RANGE_MIN : 0;
+    if( Reuse( p_access, i_pos ) == VLC_SUCCESS )
+        return VLC_SUCCESS;
+
+    Disconnect( p_access );
     if( Connect( p_access, i_pos ) )
     {
         msg_Err( p_access, "seek failed" );
@@ -967,14 +1047,12 @@ static int WriteHeaders( access_t *access, const char *fmt, ... )
 }
 
 /*****************************************************************************
- * Connect:
+ * ResetResponse: clean the info of the previous response
  *****************************************************************************/
-static int Connect( access_t *p_access, uint64_t i_tell )
+static void ResetResponse( access_t *p_access, uint64_t i_tell )
 {
     access_sys_t   *p_sys = p_access->p_sys;
-    vlc_url_t      srv = p_sys->b_proxy ? p_sys->proxy : p_sys->url;
 
-    /* Clean info */
     free( p_sys->psz_location );
     free( p_sys->psz_mime );
     free( p_sys->psz_pragma );
@@ -1001,6 +1079,17 @@ static int Connect( access_t *p_access, uint64_t i_tell )
     p_sys->offset = i_tell;
     p_sys->size = 0;
     p_access->info.b_eof  = false;
+}
+
+/*****************************************************************************
+ * Connect:
+ *****************************************************************************/
+static int Connect( access_t *p_access, uint64_t i_tell )
+{
+    access_sys_t   *p_sys = p_access->p_sys;
+    vlc_url_t      srv = p_sys->b_proxy ? p_sys->proxy : p_sys->url;
+
+    ResetResponse( p_access, i_tell );
 
     /* Open connection */
     assert( p_sys->fd == -1 ); /* No open sockets (leaking fds is BAD) */
@@ -1093,6 +1182,34 @@ static int Connect( access_t *p_access, uint64_t i_tell )
     return Request( p_access, i_tell ) ? -2 : 0;
 }
 
+/*****************************************************************************
+ * Reuse: send a new request on the current persistent connection
+ *****************************************************************************/
+static int Reuse( access_t *p_access, uint64_t i_tell )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if( !p_sys->b_persist )
+        return VLC_EGENERIC;
+
+    /* Whatever is left of the previous response must be read first */
+    if( Drain( p_access, p_sys->i_remaining ) )
+        return VLC_EGENERIC;
+
+    ResetResponse( p_access, i_tell );
+    if( Request( p_access, i_tell ) )
+        return VLC_EGENERIC;
+
+    if( p_sys->i_code != 206 )
+    {   /* let the caller start over on a new connection */
+        Disconnect( p_access );
+        return VLC_EGENERIC;
+    }
+    p_sys->i_reused++;
+    msg_Dbg( p_access, "reused connection at %"PRIu64, i_tell );
+    return VLC_SUCCESS;
+}
+
 
 static int Request( access_t *p_access, uint64_t i_tell )
 {
@@ -1101,6 +1218,7 @@ static int Request( access_t *p_access, uint64_t i_tell )
     p_sys->b_persist = false;
 
     p_sys->i_remaining = 0;
+    p_sys->i_requests++;
 
     const char *psz_path = p_sys->url.psz_path;
     if( !psz_path || !*psz_path )
@@ -1130,8 +1248,11 @@ static int Request( access_t *p_access, uint64_t i_tell )
     if( p_sys->i_version == 1 && ! p_sys->b_continuous )
     {
         p_sys->b_persist = true;
-        WriteHeaders( p_access, "Range: bytes=%"PRIu64"-\r\n", i_tell );
-        WriteHeaders( p_access, "Connection: close\r\n" );
+        if( p_sys->i_range > 0 )
+            WriteHeaders( p_access, "Range: bytes=%"PRIu64"-%"PRIu64"\r\n",
+                          i_tell, i_tell + p_sys->i_range - 1 );
+        else
+            WriteHeaders( p_access, "Range: bytes=%"PRIu64"-\r\n", i_tell );
     }
 
     /* Cookies */
@@ -1487,6 +1608,10 @@ static int Request( access_t *p_access, uint64_t i_tell )
 
         free( psz );
     }
+    /* Bounded ranges are only worth it if the connection can be reused */
+    if( !p_sys->b_persist )
+        p_sys->i_range = 0;
+
     /* We close the stream for zero length data, unless of course the
      * server has already promised to do this for us.
      */
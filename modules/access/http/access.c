@@ -0,0 +1,494 @@
+/*****************************************************************************
+ * access.c: HTTP/2 access module
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_access.h>
+#include <vlc_network.h>
+#include <vlc_url.h>
+#include <vlc_tls.h>
+
+#include "h2conn.h"
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+#define HTTP2_TEXT N_("HTTP/2")
+#define HTTP2_LONGTEXT N_( \
+    "Use HTTP/2 for HTTPS streams if the server supports it. A single " \
+    "connection then carries all the requests, including those caused by " \
+    "seeking." )
+
+vlc_module_begin ()
+    set_description( N_("HTTP/2 input") )
+    set_shortname( N_( "HTTP/2" ) )
+    /* Above the HTTP/1 access, which remains the fallback */
+    set_capability( "access", 2 )
+    set_category( CAT_INPUT )
+    set_subcategory( SUBCAT_INPUT_ACCESS )
+    add_bool( "http2", true, HTTP2_TEXT, HTTP2_LONGTEXT, true )
+    add_shortcut( "https" )
+    set_callbacks( Open, Close )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+
+/* Up to this many bytes of a parked response are read and dropped rather
+ * than issuing a new request */
+#define HTTP2_SKIP_MAX (UINT64_C(64) << 10)
+
+struct access_sys_t
+{
+    vlc_tls_creds_t *p_creds;
+    struct vlc_h2_conn *p_conn;
+
+    vlc_url_t url;
+    char *psz_authority;
+    char *psz_path;
+    char *psz_user_agent;
+    char *psz_referrer;
+    char *psz_mime;
+
+    /* current response */
+    struct vlc_h2_stream *p_stream;
+    uint64_t offset;
+
+    /* previous response, kept open after a seek in case the demuxer comes
+     * back to it, e.g. for interleaved index and data */
+    struct vlc_h2_stream *p_parked;
+    uint64_t i_parked_offset;
+
+    uint64_t size;
+    bool b_has_size;
+    bool b_seekable;
+};
+
+static ssize_t Read( access_t *, uint8_t *, size_t );
+static int Seek( access_t *, uint64_t );
+static int Control( access_t *, int, va_list );
+
+/*****************************************************************************
+ * Request: send a GET request from the given offset on a new stream
+ *****************************************************************************/
+static struct vlc_h2_stream *Request( access_t *p_access, uint64_t i_offset )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    char psz_range[32];
+
+    snprintf( psz_range, sizeof (psz_range), "bytes=%"PRIu64"-", i_offset );
+
+    const char *headers[][2] = {
+        { ":method", "GET" },
+        { ":scheme", "https" },
+        { ":authority", p_sys->psz_authority },
+        { ":path", p_sys->psz_path },
+        { "user-agent", p_sys->psz_user_agent },
+        { "range", psz_range },
+        { "referer", p_sys->psz_referrer },
+    };
+    unsigned i_count = sizeof (headers) / sizeof (headers[0]);
+
+    if( p_sys->psz_referrer == NULL )
+        i_count--;
+
+    struct vlc_h2_stream *p_stream = vlc_h2_stream_open( p_sys->p_conn,
+                                                         headers, i_count );
+    if( p_stream == NULL )
+    {
+        msg_Err( p_access, "cannot send request" );
+        return NULL;
+    }
+
+    int i_status = vlc_h2_stream_wait( p_stream );
+    if( i_status < 0 )
+    {
+        msg_Err( p_access, "no response" );
+        goto error;
+    }
+    msg_Dbg( p_access, "answer code %d at %"PRIu64, i_status, i_offset );
+
+    const char *psz_value;
+
+    if( i_status == 206 )
+    {
+        uint64_t i_start, i_end, i_size;
+
+        p_sys->b_seekable = true;
+        psz_value = vlc_h2_stream_get_header( p_stream, "content-range" );
+        if( psz_value == NULL
+         || sscanf( psz_value, "bytes %"SCNu64"-%"SCNu64"/%"SCNu64,
+                    &i_start, &i_end, &i_size ) != 3
+         || i_start != i_offset )
+        {
+            msg_Err( p_access, "invalid content range" );
+            goto error;
+        }
+        p_sys->size = i_size;
+        p_sys->b_has_size = true;
+    }
+    else if( i_status == 200 && i_offset == 0 )
+    {
+        psz_value = vlc_h2_stream_get_header( p_stream, "accept-ranges" );
+        p_sys->b_seekable = psz_value != NULL
+                         && !strcasecmp( psz_value, "bytes" );
+        psz_value = vlc_h2_stream_get_header( p_stream, "content-length" );
+        if( psz_value != NULL )
+        {
+            p_sys->size = strtoull( psz_value, NULL, 10 );
+            p_sys->b_has_size = true;
+        }
+    }
+    else
+    {   /* Redirections, authentication and such are left to the HTTP/1
+         * access module. */
+        msg_Dbg( p_access, "unsupported answer code %d", i_status );
+        goto error;
+    }
+
+    if( p_sys->psz_mime == NULL )
+    {
+        psz_value = vlc_h2_stream_get_header( p_stream, "content-type" );
+        if( psz_value != NULL )
+            p_sys->psz_mime = strdup( psz_value );
+    }
+    return p_stream;
+
+error:
+    vlc_h2_stream_close( p_stream );
+    return NULL;
+}
+
+/*****************************************************************************
+ * Open:
+ *****************************************************************************/
+static int Open( vlc_object_t *p_this )
+{
+    access_t     *p_access = (access_t*)p_this;
+    access_sys_t *p_sys;
+    char         *psz;
+
+    if( !var_InheritBool( p_access, "http2" ) )
+        return VLC_EGENERIC;
+
+    /* Proxies are handled by the HTTP/1 access module */
+    psz = var_InheritString( p_access, "http-proxy" );
+    if( psz == NULL )
+        psz = vlc_getProxyUrl( p_access->psz_url );
+    if( psz != NULL )
+    {
+        free( psz );
+        return VLC_EGENERIC;
+    }
+
+    STANDARD_READ_ACCESS_INIT;
+
+    vlc_UrlParse( &p_sys->url, p_access->psz_url );
+    if( p_sys->url.psz_protocol == NULL
+     || strcasecmp( p_sys->url.psz_protocol, "https" )
+     || p_sys->url.psz_host == NULL || *p_sys->url.psz_host == '\0' )
+        goto error;
+    if( p_sys->url.i_port <= 0 )
+        p_sys->url.i_port = 443;
+
+    if( p_sys->url.i_port != 443 )
+    {
+        if( asprintf( &p_sys->psz_authority, "%s:%d", p_sys->url.psz_host,
+                      p_sys->url.i_port ) < 0 )
+            p_sys->psz_authority = NULL;
+    }
+    else
+        p_sys->psz_authority = strdup( p_sys->url.psz_host );
+
+    const char *psz_path = p_sys->url.psz_path;
+    if( psz_path == NULL || *psz_path == '\0' )
+        psz_path = "/";
+    if( p_sys->url.psz_option != NULL )
+    {
+        if( asprintf( &p_sys->psz_path, "%s?%s", psz_path,
+                      p_sys->url.psz_option ) < 0 )
+            p_sys->psz_path = NULL;
+    }
+    else
+        p_sys->psz_path = strdup( psz_path );
+
+    p_sys->psz_user_agent = var_InheritString( p_access, "http-user-agent" );
+    if( p_sys->psz_user_agent == NULL )
+        p_sys->psz_user_agent = var_InheritString( p_access, "user-agent" );
+    p_sys->psz_referrer = var_InheritString( p_access, "http-referrer" );
+    if( p_sys->psz_authority == NULL || p_sys->psz_path == NULL
+     || p_sys->psz_user_agent == NULL )
+        goto error;
+
+    /* Connect, and negotiate HTTP/2 during the TLS handshake */
+    p_sys->p_creds = vlc_tls_ClientCreate( p_this );
+    if( p_sys->p_creds == NULL )
+        goto error;
+
+    int fd = net_ConnectTCP( p_access, p_sys->url.psz_host,
+                             p_sys->url.i_port );
+    if( fd == -1 )
+        goto error;
+
+    static const char *const alpn[] = { "h2", NULL };
+    char *psz_alp;
+    vlc_tls_t *p_tls = vlc_tls_ClientSessionCreate( p_sys->p_creds, fd,
+                                                    p_sys->url.psz_host,
+                                                    "https", alpn, &psz_alp );
+    if( p_tls == NULL )
+    {
+        net_Close( fd );
+        goto error;
+    }
+
+    if( psz_alp == NULL || strcmp( psz_alp, "h2" ) )
+    {
+        msg_Dbg( p_access, "HTTP/2 not supported by %s",
+                 p_sys->url.psz_host );
+        free( psz_alp );
+        vlc_tls_SessionDelete( p_tls );
+        net_Close( fd );
+        goto error;
+    }
+    free( psz_alp );
+
+    p_sys->p_conn = vlc_h2_conn_create( p_this, p_tls );
+    if( p_sys->p_conn == NULL )
+    {
+        vlc_tls_SessionDelete( p_tls );
+        net_Close( fd );
+        goto error;
+    }
+
+    p_sys->p_stream = Request( p_access, 0 );
+    if( p_sys->p_stream == NULL )
+        goto error;
+    p_sys->offset = 0;
+
+    msg_Dbg( p_access, "HTTP/2 stream opened (size %"PRIu64"%s)",
+             p_sys->size, p_sys->b_seekable ? ", seekable" : "" );
+    return VLC_SUCCESS;
+
+error:
+    if( p_sys->p_conn != NULL )
+        vlc_h2_conn_release( p_sys->p_conn );
+    vlc_tls_Delete( p_sys->p_creds );
+    free( p_sys->psz_mime );
+    free( p_sys->psz_referrer );
+    free( p_sys->psz_user_agent );
+    free( p_sys->psz_path );
+    free( p_sys->psz_authority );
+    vlc_UrlClean( &p_sys->url );
+    free( p_sys );
+    return VLC_EGENERIC;
+}
+
+/*****************************************************************************
+ * Close:
+ *****************************************************************************/
+static void Close( vlc_object_t *p_this )
+{
+    access_t     *p_access = (access_t*)p_this;
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if( p_sys->p_parked != NULL )
+        vlc_h2_stream_close( p_sys->p_parked );
+    if( p_sys->p_stream != NULL )
+        vlc_h2_stream_close( p_sys->p_stream );
+    vlc_h2_conn_release( p_sys->p_conn );
+    vlc_tls_Delete( p_sys->p_creds );
+
+    free( p_sys->psz_mime );
+    free( p_sys->psz_referrer );
+    free( p_sys->psz_user_agent );
+    free( p_sys->psz_path );
+    free( p_sys->psz_authority );
+    vlc_UrlClean( &p_sys->url );
+    free( p_sys );
+}
+
+/*****************************************************************************
+ * Read:
+ *****************************************************************************/
+static ssize_t Read( access_t *p_access, uint8_t *p_buffer, size_t i_len )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if( p_sys->p_stream == NULL )
+    {
+        p_access->info.b_eof = true;
+        return 0;
+    }
+
+    ssize_t i_read = vlc_h2_stream_read( p_sys->p_stream, p_buffer, i_len );
+    if( i_read < 0 )
+    {
+        if( errno == EINTR )
+            return -1;
+        msg_Err( p_access, "read error: %s", vlc_strerror_c( errno ) );
+        i_read = 0;
+    }
+
+    if( i_read == 0 )
+        p_access->info.b_eof = true;
+    p_sys->offset += i_read;
+    return i_read;
+}
+
+/*****************************************************************************
+ * Skip: read and drop data of the current response
+ *****************************************************************************/
+static int Skip( access_t *p_access, uint64_t i_len )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    uint8_t p_buffer[4096];
+
+    while( i_len > 0 )
+    {
+        ssize_t i_read = vlc_h2_stream_read( p_sys->p_stream, p_buffer,
+                                    __MIN( i_len, sizeof (p_buffer) ) );
+        if( i_read <= 0 )
+            return VLC_EGENERIC;
+        p_sys->offset += i_read;
+        i_len -= i_read;
+    }
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Seek: switch to another response, on the same connection
+ *****************************************************************************/
+static int Seek( access_t *p_access, uint64_t i_pos )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    msg_Dbg( p_access, "trying to seek to %"PRIu64, i_pos );
+
+    /* Come back to the parked response if it is (nearly) there */
+    if( p_sys->p_parked != NULL && i_pos >= p_sys->i_parked_offset
+     && i_pos - p_sys->i_parked_offset <= HTTP2_SKIP_MAX )
+    {
+        struct vlc_h2_stream *p_stream = p_sys->p_stream;
+        uint64_t i_offset = p_sys->offset;
+
+        p_sys->p_stream = p_sys->p_parked;
+        p_sys->offset = p_sys->i_parked_offset;
+        p_sys->p_parked = p_stream;
+        p_sys->i_parked_offset = i_offset;
+    }
+
+    if( p_sys->p_stream != NULL && i_pos >= p_sys->offset
+     && i_pos - p_sys->offset <= HTTP2_SKIP_MAX
+     && Skip( p_access, i_pos - p_sys->offset ) == VLC_SUCCESS )
+    {
+        p_access->info.b_eof = false;
+        return VLC_SUCCESS;
+    }
+
+    /* The request is sent before the current response is reset, so that
+     * both overlap on the connection rather than waiting for each other. */
+    struct vlc_h2_stream *p_stream = Request( p_access, i_pos );
+    if( p_stream == NULL )
+    {
+        msg_Err( p_access, "seek failed" );
+        p_access->info.b_eof = true;
+        return VLC_EGENERIC;
+    }
+
+    if( p_sys->p_parked != NULL )
+        vlc_h2_stream_close( p_sys->p_parked );
+    p_sys->p_parked = p_sys->p_stream;
+    p_sys->i_parked_offset = p_sys->offset;
+    p_sys->p_stream = p_stream;
+    p_sys->offset = i_pos;
+    p_access->info.b_eof = false;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Control:
+ *****************************************************************************/
+static int Control( access_t *p_access, int i_query, va_list args )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    bool       *pb_bool;
+    int64_t    *pi_64;
+
+    switch( i_query )
+    {
+        case ACCESS_CAN_SEEK:
+            pb_bool = (bool*)va_arg( args, bool* );
+            *pb_bool = p_sys->b_seekable;
+            break;
+        case ACCESS_CAN_FASTSEEK:
+            pb_bool = (bool*)va_arg( args, bool* );
+            *pb_bool = false;
+            break;
+        case ACCESS_CAN_PAUSE:
+        case ACCESS_CAN_CONTROL_PACE:
+            pb_bool = (bool*)va_arg( args, bool* );
+            *pb_bool = true;
+            break;
+
+        case ACCESS_GET_PTS_DELAY:
+            pi_64 = (int64_t*)va_arg( args, int64_t * );
+            *pi_64 = INT64_C(1000)
+                * var_InheritInteger( p_access, "network-caching" );
+            break;
+
+        case ACCESS_GET_SIZE:
+            if( !p_sys->b_has_size )
+                return VLC_EGENERIC;
+            pi_64 = (int64_t*)va_arg( args, int64_t * );
+            *pi_64 = p_sys->size;
+            break;
+
+        case ACCESS_SET_PAUSE_STATE:
+            break;
+
+        case ACCESS_GET_CONTENT_TYPE:
+        {
+            char **type = va_arg( args, char ** );
+
+            if( p_sys->psz_mime == NULL )
+                return VLC_EGENERIC;
+            *type = strdup( p_sys->psz_mime );
+            break;
+        }
+
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
@@ -0,0 +1,695 @@
+/*****************************************************************************
+ * h2conn.c: HTTP/2 client connection
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_network.h>
+#include <vlc_tls.h>
+#include <vlc_interrupt.h>
+
+#include "h2frame.h"
+#include "h2conn.h"
+
+#define VLC_H2_CLIENT_PREFACE "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+
+struct vlc_h2_conn
+{
+    vlc_object_t *obj;
+    vlc_tls_t *tls;
+    vlc_thread_t thread; /**< frames receiver thread */
+
+    vlc_mutex_t lock; /**< protects all of the state below */
+    vlc_mutex_t send_lock; /**< serializes the output frames */
+    struct vlc_h2_stream *streams; /**< list of open streams */
+    uint32_t next_id; /**< next stream identifier */
+    uint32_t max_streams; /**< concurrent streams allowed by the server */
+    unsigned active; /**< number of open streams */
+    unsigned refs;
+    unsigned requests; /**< number of streams opened so far */
+    bool dead; /**< no more streams can be opened */
+    bool broken; /**< output failed, protected by send_lock */
+};
+
+struct vlc_h2_stream
+{
+    struct vlc_h2_conn *conn;
+    struct vlc_h2_stream *next;
+    uint32_t id;
+    vlc_sem_t sem; /**< posted on any change of the stream state */
+
+    /* All of the following is protected by the connection lock */
+    char *(*headers)[2]; /**< response header fields */
+    unsigned header_count;
+    int status; /**< response status, -1 until received */
+    bool eos; /**< whether the response was entirely received */
+    int error; /**< errno value, or 0 if no error */
+    struct vlc_h2_frame *recv_head; /**< received DATA frames */
+    struct vlc_h2_frame **recv_tailp;
+    size_t recv_offset; /**< bytes already read from the first frame */
+    uint32_t recv_cwnd; /**< remaining receive window */
+    uint32_t recv_consumed; /**< bytes read but not credited yet */
+};
+
+static int vlc_h2_conn_send(struct vlc_h2_conn *conn, struct vlc_h2_frame *f)
+{
+    int ret;
+
+    if (unlikely(f == NULL))
+        return -1;
+
+    vlc_mutex_lock(&conn->send_lock);
+    ret = conn->broken ? -1 : 0;
+    while (f != NULL)
+    {
+        struct vlc_h2_frame *next = f->next;
+        size_t size = vlc_h2_frame_size(f);
+
+        if (ret == 0)
+        {
+            int val = vlc_tls_Write(conn->tls, f->data, size);
+
+            if (val < 0)
+                ret = -1; /* nothing was sent */
+            else if ((size_t)val < size)
+            {   /* partial frame: the output is broken */
+                conn->broken = true;
+                ret = -1;
+            }
+        }
+        free(f);
+        f = next;
+    }
+    vlc_mutex_unlock(&conn->send_lock);
+    return ret;
+}
+
+static struct vlc_h2_stream *vlc_h2_stream_find(struct vlc_h2_conn *conn,
+                                                uint_fast32_t id)
+{
+    for (struct vlc_h2_stream *s = conn->streams; s != NULL; s = s->next)
+        if (s->id == id)
+            return s;
+    return NULL;
+}
+
+static void vlc_h2_stream_wake(struct vlc_h2_stream *s)
+{
+    vlc_sem_post(&s->sem);
+}
+
+/*** Parser callbacks (with the connection lock held) ***/
+
+static void vlc_h2_setting(void *ctx, uint_fast16_t id, uint_fast32_t value)
+{
+    struct vlc_h2_conn *conn = ctx;
+
+    switch (id)
+    {
+        case VLC_H2_SETTING_MAX_CONCURRENT_STREAMS:
+            conn->max_streams = value;
+            break;
+        /* The encoder does not use the dynamic table, only DATA frames
+         * are subject to flow control, and the client does not send any.
+         * The other settings are hence irrelevant. */
+    }
+}
+
+static int vlc_h2_settings_done(void *ctx)
+{
+    struct vlc_h2_conn *conn = ctx;
+
+    return vlc_h2_conn_send(conn, vlc_h2_frame_settings_ack());
+}
+
+static int vlc_h2_ping(void *ctx, uint_fast64_t opaque)
+{
+    struct vlc_h2_conn *conn = ctx;
+
+    return vlc_h2_conn_send(conn, vlc_h2_frame_pong(opaque));
+}
+
+static void vlc_h2_error(void *ctx, uint_fast32_t code)
+{
+    struct vlc_h2_conn *conn = ctx;
+
+    msg_Err(conn->obj, "local error: %s (0x%"PRIxFAST32")",
+            vlc_h2_strerror(code), code);
+    conn->dead = true;
+    vlc_h2_conn_send(conn, vlc_h2_frame_goaway(0, code));
+}
+
+static int vlc_h2_reset(void *ctx, uint_fast32_t last_seq, uint_fast32_t code)
+{
+    struct vlc_h2_conn *conn = ctx;
+
+    if (code != VLC_H2_NO_ERROR)
+        msg_Err(conn->obj, "peer error: %s (0x%"PRIxFAST32")",
+                vlc_h2_strerror(code), code);
+    else
+        msg_Dbg(conn->obj, "peer closing the connection");
+
+    conn->dead = true;
+
+    /* Streams the server will not process can be retried elsewhere */
+    for (struct vlc_h2_stream *s = conn->streams; s != NULL; s = s->next)
+        if (s->id > last_seq)
+        {
+            s->error = ECONNREFUSED;
+            vlc_h2_stream_wake(s);
+        }
+    return 0;
+}
+
+static void vlc_h2_window_status(void *ctx, uint32_t *rcwd)
+{
+    struct vlc_h2_conn *conn = ctx;
+
+    /* The per-stream windows limit the buffered data: the connection
+     * window is only there to comply with the protocol. */
+    if (*rcwd >= VLC_H2_CONN_WINDOW / 2)
+        return;
+
+    if (vlc_h2_conn_send(conn, vlc_h2_frame_window_update(0,
+                                          VLC_H2_CONN_WINDOW - *rcwd)) == 0)
+        *rcwd = VLC_H2_CONN_WINDOW;
+}
+
+static void *vlc_h2_stream_lookup(void *ctx, uint_fast32_t id)
+{
+    struct vlc_h2_conn *conn = ctx;
+
+    return vlc_h2_stream_find(conn, id);
+}
+
+static int vlc_h2_stream_error(void *ctx, uint_fast32_t id,
+                               uint_fast32_t code)
+{
+    struct vlc_h2_conn *conn = ctx;
+    struct vlc_h2_stream *s = vlc_h2_stream_find(conn, id);
+
+    if (code != VLC_H2_STREAM_CLOSED)
+        msg_Err(conn->obj, "local stream %"PRIuFAST32" error: %s",
+                id, vlc_h2_strerror(code));
+    if (s != NULL)
+    {
+        s->error = ECONNRESET;
+        vlc_h2_stream_wake(s);
+    }
+    return vlc_h2_conn_send(conn, vlc_h2_frame_rst_stream(id, code));
+}
+
+static void vlc_h2_stream_headers(void *ctx, unsigned count,
+                                  char *headers[][2])
+{
+    struct vlc_h2_stream *s = ctx;
+    int status = -1;
+
+    for (unsigned i = 0; i < count; i++)
+        if (!strcmp(headers[i][0], ":status"))
+            status = atoi(headers[i][1]);
+
+    /* Skip informational responses and trailers */
+    if (s->status >= 0 || (status >= 100 && status < 200))
+        goto drop;
+
+    if (status < 0)
+    {   /* malformed response */
+        s->error = EPROTO;
+        vlc_h2_stream_wake(s);
+        goto drop;
+    }
+
+    s->headers = malloc(count * sizeof (*s->headers));
+    if (unlikely(s->headers == NULL))
+    {
+        s->error = ENOMEM;
+        vlc_h2_stream_wake(s);
+        goto drop;
+    }
+
+    memcpy(s->headers, headers, count * sizeof (*s->headers));
+    s->header_count = count;
+    s->status = status;
+    vlc_h2_stream_wake(s);
+    return;
+
+drop:
+    for (unsigned i = 0; i < count; i++)
+    {
+        free(headers[i][1]);
+        free(headers[i][0]);
+    }
+}
+
+static int vlc_h2_stream_data(void *ctx, struct vlc_h2_frame *f)
+{
+    struct vlc_h2_stream *s = ctx;
+    struct vlc_h2_conn *conn = s->conn;
+    size_t len = vlc_h2_frame_length(f);
+    size_t dlen;
+
+    if (s->eos || s->error)
+    {
+        free(f);
+        return 0;
+    }
+
+    if (len > s->recv_cwnd)
+    {
+        free(f);
+        s->error = ECONNRESET;
+        vlc_h2_stream_wake(s);
+        return vlc_h2_conn_send(conn,
+                    vlc_h2_frame_rst_stream(s->id, VLC_H2_FLOW_CONTROL_ERROR));
+    }
+    s->recv_cwnd -= len;
+
+    vlc_h2_frame_data_get(f, &dlen);
+    if (dlen == 0)
+    {   /* Nothing to read: credit the (padding) bytes on the next read */
+        s->recv_consumed += len;
+        free(f);
+        return 0;
+    }
+
+    *(s->recv_tailp) = f;
+    s->recv_tailp = &f->next;
+    vlc_h2_stream_wake(s);
+    return 0;
+}
+
+static void vlc_h2_stream_end(void *ctx)
+{
+    struct vlc_h2_stream *s = ctx;
+
+    s->eos = true;
+    vlc_h2_stream_wake(s);
+}
+
+static int vlc_h2_stream_reset(void *ctx, uint_fast32_t code)
+{
+    struct vlc_h2_stream *s = ctx;
+
+    msg_Dbg(s->conn->obj, "peer stream %"PRIu32" error: %s",
+            s->id, vlc_h2_strerror(code));
+    s->error = (code == VLC_H2_REFUSED_STREAM) ? ECONNREFUSED : ECONNRESET;
+    vlc_h2_stream_wake(s);
+    return 0;
+}
+
+static const struct vlc_h2_parser_cbs vlc_h2_parser_callbacks =
+{
+    vlc_h2_setting,
+    vlc_h2_settings_done,
+    vlc_h2_ping,
+    vlc_h2_error,
+    vlc_h2_reset,
+    vlc_h2_window_status,
+    vlc_h2_stream_lookup,
+    vlc_h2_stream_error,
+    vlc_h2_stream_headers,
+    vlc_h2_stream_data,
+    vlc_h2_stream_end,
+    vlc_h2_stream_reset,
+};
+
+/*** Frames receiver ***/
+
+static struct vlc_h2_frame *vlc_h2_frame_recv(vlc_tls_t *tls)
+{
+    uint8_t header[VLC_H2_FRAME_HEADER_SIZE];
+
+    if (vlc_tls_Read(tls, header, sizeof (header), true) < (int)sizeof (header))
+        return NULL;
+
+    size_t len = (header[0] << 16) | (header[1] << 8) | header[2];
+
+    /* The client never raises the maximum frame size */
+    if (len > VLC_H2_DEFAULT_MAX_FRAME)
+    {
+        errno = EPROTO;
+        return NULL;
+    }
+
+    struct vlc_h2_frame *f = malloc(sizeof (*f) + sizeof (header) + len);
+    if (unlikely(f == NULL))
+        return NULL;
+
+    f->next = NULL;
+    memcpy(f->data, header, sizeof (header));
+
+    if (len > 0
+     && vlc_tls_Read(tls, f->data + sizeof (header), len, true) < (int)len)
+    {
+        free(f);
+        return NULL;
+    }
+    return f;
+}
+
+static void *vlc_h2_recv_thread(void *data)
+{
+    struct vlc_h2_conn *conn = data;
+    struct vlc_h2_parser *parser;
+
+    parser = vlc_h2_parse_init(conn, &vlc_h2_parser_callbacks);
+    if (likely(parser != NULL))
+    {
+        struct vlc_h2_frame *f;
+
+        while ((f = vlc_h2_frame_recv(conn->tls)) != NULL)
+        {
+            int val;
+
+            /* Streams cannot be closed while their frames are dispatched */
+            vlc_mutex_lock(&conn->lock);
+            val = vlc_h2_parse(parser, f);
+            vlc_mutex_unlock(&conn->lock);
+            if (val)
+                break;
+        }
+        vlc_h2_parse_destroy(parser);
+    }
+
+    /* Fail all pending streams */
+    vlc_mutex_lock(&conn->lock);
+    conn->dead = true;
+    for (struct vlc_h2_stream *s = conn->streams; s != NULL; s = s->next)
+        if (!s->eos && s->error == 0)
+        {
+            s->error = ECONNRESET;
+            vlc_h2_stream_wake(s);
+        }
+    vlc_mutex_unlock(&conn->lock);
+    return NULL;
+}
+
+/*** Connection ***/
+
+struct vlc_h2_conn *vlc_h2_conn_create(vlc_object_t *obj, vlc_tls_t *tls)
+{
+    struct vlc_h2_conn *conn = malloc(sizeof (*conn));
+    if (unlikely(conn == NULL))
+        return NULL;
+
+    conn->obj = obj;
+    conn->tls = tls;
+    vlc_mutex_init(&conn->lock);
+    vlc_mutex_init(&conn->send_lock);
+    conn->streams = NULL;
+    conn->next_id = 1; /* client-initiated streams are odd */
+    conn->max_streams = UINT32_MAX;
+    conn->active = 0;
+    conn->refs = 1;
+    conn->requests = 0;
+    conn->dead = false;
+    conn->broken = false;
+
+    if (vlc_tls_Write(tls, VLC_H2_CLIENT_PREFACE,
+                      strlen(VLC_H2_CLIENT_PREFACE))
+                                       < (int)strlen(VLC_H2_CLIENT_PREFACE)
+     || vlc_h2_conn_send(conn, vlc_h2_frame_settings()))
+        goto error;
+
+    if (vlc_clone(&conn->thread, vlc_h2_recv_thread, conn,
+                  VLC_THREAD_PRIORITY_INPUT))
+        goto error;
+
+    return conn;
+
+error:
+    vlc_mutex_destroy(&conn->send_lock);
+    vlc_mutex_destroy(&conn->lock);
+    free(conn);
+    return NULL;
+}
+
+struct vlc_h2_conn *vlc_h2_conn_hold(struct vlc_h2_conn *conn)
+{
+    vlc_mutex_lock(&conn->lock);
+    assert(conn->refs > 0);
+    conn->refs++;
+    vlc_mutex_unlock(&conn->lock);
+    return conn;
+}
+
+void vlc_h2_conn_release(struct vlc_h2_conn *conn)
+{
+    bool last;
+
+    vlc_mutex_lock(&conn->lock);
+    assert(conn->refs > 0);
+    last = --conn->refs == 0;
+    vlc_mutex_unlock(&conn->lock);
+
+    if (!last)
+        return;
+
+    assert(conn->streams == NULL);
+    msg_Dbg(conn->obj, "closing HTTP/2 connection after %u request(s)",
+            conn->requests);
+
+    vlc_h2_conn_send(conn, vlc_h2_frame_goaway(0, VLC_H2_NO_ERROR));
+
+    /* Wake the receiver thread up */
+    int fd = conn->tls->fd;
+    shutdown(fd, SHUT_RDWR);
+    vlc_join(conn->thread, NULL);
+
+    vlc_tls_SessionDelete(conn->tls);
+    net_Close(fd);
+    vlc_mutex_destroy(&conn->send_lock);
+    vlc_mutex_destroy(&conn->lock);
+    free(conn);
+}
+
+bool vlc_h2_conn_usable(struct vlc_h2_conn *conn)
+{
+    bool usable;
+
+    vlc_mutex_lock(&conn->lock);
+    vlc_mutex_lock(&conn->send_lock);
+    usable = !conn->dead && !conn->broken && conn->next_id < 0x80000000
+          && conn->active < conn->max_streams;
+    vlc_mutex_unlock(&conn->send_lock);
+    vlc_mutex_unlock(&conn->lock);
+    return usable;
+}
+
+/*** Streams ***/
+
+struct vlc_h2_stream *vlc_h2_stream_open(struct vlc_h2_conn *conn,
+                                         const char *const headers[][2],
+                                         unsigned count)
+{
+    struct vlc_h2_stream *s = malloc(sizeof (*s));
+    if (unlikely(s == NULL))
+        return NULL;
+
+    s->conn = conn;
+    vlc_sem_init(&s->sem, 0);
+    s->headers = NULL;
+    s->header_count = 0;
+    s->status = -1;
+    s->eos = false;
+    s->error = 0;
+    s->recv_head = NULL;
+    s->recv_tailp = &s->recv_head;
+    s->recv_offset = 0;
+    s->recv_cwnd = VLC_H2_INIT_WINDOW;
+    s->recv_consumed = 0;
+
+    vlc_mutex_lock(&conn->lock);
+    if (conn->dead || conn->next_id >= 0x80000000
+     || conn->active >= conn->max_streams)
+    {
+        vlc_mutex_unlock(&conn->lock);
+        errno = EBUSY;
+        goto error;
+    }
+
+    /* Stream identifiers must be sent in increasing order, hence the
+     * request is sent with the connection lock held. */
+    s->id = conn->next_id;
+    conn->next_id += 2;
+
+    if (vlc_h2_conn_send(conn, vlc_h2_frame_headers(s->id,
+                                        VLC_H2_DEFAULT_MAX_FRAME, true,
+                                        count, headers)))
+    {
+        vlc_mutex_unlock(&conn->lock);
+        errno = ECONNRESET;
+        goto error;
+    }
+
+    s->next = conn->streams;
+    conn->streams = s;
+    conn->active++;
+    conn->refs++;
+    conn->requests++;
+    vlc_mutex_unlock(&conn->lock);
+    return s;
+
+error:
+    vlc_sem_destroy(&s->sem);
+    free(s);
+    return NULL;
+}
+
+int vlc_h2_stream_wait(struct vlc_h2_stream *s)
+{
+    struct vlc_h2_conn *conn = s->conn;
+    int status;
+
+    vlc_mutex_lock(&conn->lock);
+    while ((status = s->status) < 0)
+    {
+        if (s->error || s->eos)
+            break;
+
+        vlc_mutex_unlock(&conn->lock);
+        if (vlc_sem_wait_i11e(&s->sem))
+            return -1;
+        vlc_mutex_lock(&conn->lock);
+    }
+    vlc_mutex_unlock(&conn->lock);
+    return status;
+}
+
+const char *vlc_h2_stream_get_header(const struct vlc_h2_stream *s,
+                                     const char *name)
+{
+    for (unsigned i = 0; i < s->header_count; i++)
+        if (!strcasecmp(s->headers[i][0], name))
+            return s->headers[i][1];
+    return NULL;
+}
+
+ssize_t vlc_h2_stream_read(struct vlc_h2_stream *s, void *buf, size_t len)
+{
+    struct vlc_h2_conn *conn = s->conn;
+    struct vlc_h2_frame *f;
+
+    vlc_mutex_lock(&conn->lock);
+    while ((f = s->recv_head) == NULL)
+    {
+        if (s->eos || s->error)
+        {
+            int error = s->error;
+
+            vlc_mutex_unlock(&conn->lock);
+            if (error)
+            {
+                errno = error;
+                return -1;
+            }
+            return 0;
+        }
+
+        vlc_mutex_unlock(&conn->lock);
+        if (vlc_sem_wait_i11e(&s->sem))
+        {
+            errno = EINTR;
+            return -1;
+        }
+        vlc_mutex_lock(&conn->lock);
+    }
+
+    size_t dlen;
+    const uint8_t *data = vlc_h2_frame_data_get(f, &dlen);
+
+    assert(s->recv_offset < dlen);
+    data += s->recv_offset;
+    dlen -= s->recv_offset;
+    if (len > dlen)
+        len = dlen;
+    memcpy(buf, data, len);
+    s->recv_offset += len;
+
+    if (len == dlen)
+    {   /* Frame fully consumed */
+        s->recv_head = f->next;
+        if (s->recv_head == NULL)
+            s->recv_tailp = &s->recv_head;
+        s->recv_offset = 0;
+        s->recv_consumed += vlc_h2_frame_length(f);
+        free(f);
+
+        /* Let the server send more once half of the window was read */
+        if (s->recv_consumed >= VLC_H2_INIT_WINDOW / 2 && !s->eos
+         && vlc_h2_conn_send(conn, vlc_h2_frame_window_update(s->id,
+                                                  s->recv_consumed)) == 0)
+        {
+            s->recv_cwnd += s->recv_consumed;
+            s->recv_consumed = 0;
+        }
+    }
+    vlc_mutex_unlock(&conn->lock);
+    return len;
+}
+
+void vlc_h2_stream_close(struct vlc_h2_stream *s)
+{
+    struct vlc_h2_conn *conn = s->conn;
+
+    vlc_mutex_lock(&conn->lock);
+    for (struct vlc_h2_stream **pp = &conn->streams; *pp != NULL;
+         pp = &(*pp)->next)
+        if (*pp == s)
+        {
+            *pp = s->next;
+            break;
+        }
+    conn->active--;
+
+    /* The request was sent whole: the stream is closed on the client side
+     * already, and is only open on the server side until the end of the
+     * response. */
+    if (!s->eos && s->error == 0 && !conn->dead)
+        vlc_h2_conn_send(conn, vlc_h2_frame_rst_stream(s->id, VLC_H2_CANCEL));
+    vlc_mutex_unlock(&conn->lock);
+
+    while (s->recv_head != NULL)
+    {
+        struct vlc_h2_frame *f = s->recv_head;
+
+        s->recv_head = f->next;
+        free(f);
+    }
+
+    for (unsigned i = 0; i < s->header_count; i++)
+    {
+        free(s->headers[i][1]);
+        free(s->headers[i][0]);
+    }
+    free(s->headers);
+    vlc_sem_destroy(&s->sem);
+    free(s);
+
+    vlc_h2_conn_release(conn);
+}
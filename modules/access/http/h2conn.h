@@ -0,0 +1,121 @@
+/*****************************************************************************
+ * h2conn.h: HTTP/2 client connection
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_H2CONN_H
+#define VLC_H2CONN_H 1
+
+/**
+ * \file
+ * HTTP/2 client connection.
+ *
+ * A connection multiplexes any number of concurrent streams, each carrying
+ * one request and its response. A dedicated thread receives and dispatches
+ * the incoming frames, while the owners of the streams wait for and read
+ * their own response.
+ */
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+struct vlc_h2_conn;
+struct vlc_h2_stream;
+
+/**
+ * Starts an HTTP/2 client connection over an established TLS session.
+ *
+ * The TLS session must have negotiated the "h2" application protocol.
+ * The connection takes ownership of the session and of its socket.
+ *
+ * \return the connection, or NULL on error (the session is then left alone)
+ */
+struct vlc_h2_conn *vlc_h2_conn_create(vlc_object_t *obj, vlc_tls_t *tls);
+
+/**
+ * Acquires an extra reference to a connection.
+ */
+struct vlc_h2_conn *vlc_h2_conn_hold(struct vlc_h2_conn *);
+
+/**
+ * Releases a reference to a connection.
+ *
+ * Each open stream also holds a reference. The connection is closed and
+ * destroyed with its last reference.
+ */
+void vlc_h2_conn_release(struct vlc_h2_conn *);
+
+/**
+ * Checks whether more streams can be opened on a connection.
+ */
+bool vlc_h2_conn_usable(struct vlc_h2_conn *);
+
+/**
+ * Sends a request on a new stream.
+ *
+ * \param headers request header fields (including pseudo-headers), with
+ * lower case names
+ * \return the stream, or NULL on error
+ */
+struct vlc_h2_stream *vlc_h2_stream_open(struct vlc_h2_conn *,
+                                         const char *const headers[][2],
+                                         unsigned count);
+
+/**
+ * Waits for the header of the response on a stream.
+ *
+ * This function can be interrupted with vlc_interrupt_raise().
+ *
+ * \return the HTTP status code, or -1 on error
+ */
+int vlc_h2_stream_wait(struct vlc_h2_stream *);
+
+/**
+ * Gets a header field value of the response.
+ *
+ * \note vlc_h2_stream_wait() must have succeeded first.
+ * \return the value, or NULL if the header field is absent
+ */
+const char *vlc_h2_stream_get_header(const struct vlc_h2_stream *,
+                                     const char *name);
+
+/**
+ * Reads data of the response body.
+ *
+ * Blocks until some data is available. This function can be interrupted
+ * with vlc_interrupt_raise().
+ *
+ * \return the number of bytes read, 0 at the end of the body,
+ * or -1 on error
+ */
+ssize_t vlc_h2_stream_read(struct vlc_h2_stream *, void *buf, size_t len);
+
+/**
+ * Closes a stream.
+ *
+ * The stream is reset if the response was not entirely received, so that
+ * the server stops sending it.
+ */
+void vlc_h2_stream_close(struct vlc_h2_stream *);
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif
@@ -0,0 +1,799 @@
+/*****************************************************************************
+ * h2frame.c: HTTP/2 frame formatting and parsing
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+
+#include "hpack.h"
+#include "h2frame.h"
+
+/** Frame types */
+enum
+{
+    VLC_H2_FRAME_DATA,
+    VLC_H2_FRAME_HEADERS,
+    VLC_H2_FRAME_PRIORITY,
+    VLC_H2_FRAME_RST_STREAM,
+    VLC_H2_FRAME_SETTINGS,
+    VLC_H2_FRAME_PUSH_PROMISE,
+    VLC_H2_FRAME_PING,
+    VLC_H2_FRAME_GOAWAY,
+    VLC_H2_FRAME_WINDOW_UPDATE,
+    VLC_H2_FRAME_CONTINUATION,
+};
+
+/** Frame flags */
+enum
+{
+    VLC_H2_DATA_END_STREAM = 0x01,
+    VLC_H2_DATA_PADDED = 0x08,
+};
+
+enum
+{
+    VLC_H2_HEADERS_END_STREAM = 0x01,
+    VLC_H2_HEADERS_END_HEADERS = 0x04,
+    VLC_H2_HEADERS_PADDED = 0x08,
+    VLC_H2_HEADERS_PRIORITY = 0x20,
+};
+
+enum
+{
+    VLC_H2_SETTINGS_ACK = 0x01,
+};
+
+enum
+{
+    VLC_H2_PING_ACK = 0x01,
+};
+
+enum
+{
+    VLC_H2_CONTINUATION_END_HEADERS = 0x04,
+};
+
+/** Largest header block accepted from the server */
+#define VLC_H2_MAX_HEADER_BLOCK (1 << 20)
+/** Largest number of header fields accepted from the server */
+#define VLC_H2_MAX_HEADERS 255
+
+static struct vlc_h2_frame *
+vlc_h2_frame_alloc(uint_fast8_t type, uint_fast8_t flags,
+                   uint_fast32_t stream_id, size_t length)
+{
+    assert((stream_id >> 31) == 0);
+
+    if (unlikely(length >= (1u << 24)))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    struct vlc_h2_frame *f = malloc(sizeof (*f)
+                                    + VLC_H2_FRAME_HEADER_SIZE + length);
+    if (unlikely(f == NULL))
+        return NULL;
+
+    f->next = NULL;
+    f->data[0] = length >> 16;
+    f->data[1] = length >> 8;
+    f->data[2] = length;
+    f->data[3] = type;
+    f->data[4] = flags;
+    SetDWBE(f->data + 5, stream_id);
+    return f;
+}
+
+#define vlc_h2_frame_payload(f) ((f)->data + VLC_H2_FRAME_HEADER_SIZE)
+
+static uint_fast8_t vlc_h2_frame_type(const struct vlc_h2_frame *f)
+{
+    return f->data[3];
+}
+
+static uint_fast8_t vlc_h2_frame_flags(const struct vlc_h2_frame *f)
+{
+    return f->data[4];
+}
+
+static uint_fast32_t vlc_h2_frame_id(const struct vlc_h2_frame *f)
+{
+    return GetDWBE(f->data + 5) & 0x7FFFFFFF;
+}
+
+struct vlc_h2_frame *
+vlc_h2_frame_headers(uint_fast32_t stream_id, uint_fast32_t mtu, bool eos,
+                     unsigned count, const char *const headers[][2])
+{
+    struct vlc_h2_frame *f;
+    uint_fast8_t flags = eos ? VLC_H2_HEADERS_END_STREAM : 0;
+
+    size_t len = hpack_encode(NULL, 0, headers, count);
+
+    if (likely(len <= mtu))
+    {   /* Most common case: single frame */
+        f = vlc_h2_frame_alloc(VLC_H2_FRAME_HEADERS,
+                               flags | VLC_H2_HEADERS_END_HEADERS,
+                               stream_id, len);
+        if (likely(f != NULL))
+            hpack_encode(vlc_h2_frame_payload(f), len, headers, count);
+        return f;
+    }
+
+    /* Edge case: HEADERS frame then CONTINUATION frame(s) */
+    uint8_t *payload = malloc(len);
+    if (unlikely(payload == NULL))
+        return NULL;
+
+    hpack_encode(payload, len, headers, count);
+
+    struct vlc_h2_frame **pp = &f, *n;
+    const uint8_t *offset = payload;
+    uint_fast8_t type = VLC_H2_FRAME_HEADERS;
+
+    f = NULL;
+
+    while (len > mtu)
+    {
+        n = vlc_h2_frame_alloc(type, flags, stream_id, mtu);
+        if (unlikely(n == NULL))
+            goto error;
+
+        memcpy(vlc_h2_frame_payload(n), offset, mtu);
+        *pp = n;
+        pp = &n->next;
+
+        len -= mtu;
+        offset += mtu;
+        flags = 0;
+        type = VLC_H2_FRAME_CONTINUATION;
+    }
+
+    n = vlc_h2_frame_alloc(type, flags | VLC_H2_HEADERS_END_HEADERS,
+                           stream_id, len);
+    if (unlikely(n == NULL))
+        goto error;
+
+    memcpy(vlc_h2_frame_payload(n), offset, len);
+    *pp = n;
+
+    free(payload);
+    return f;
+
+error:
+    while (f != NULL)
+    {
+        n = f->next;
+        free(f);
+        f = n;
+    }
+    free(payload);
+    return NULL;
+}
+
+struct vlc_h2_frame *vlc_h2_frame_rst_stream(uint_fast32_t stream_id,
+                                             uint_fast32_t error_code)
+{
+    struct vlc_h2_frame *f = vlc_h2_frame_alloc(VLC_H2_FRAME_RST_STREAM, 0,
+                                                stream_id, 4);
+    if (likely(f != NULL))
+        SetDWBE(vlc_h2_frame_payload(f), error_code);
+    return f;
+}
+
+struct vlc_h2_frame *vlc_h2_frame_settings(void)
+{
+    static const struct
+    {
+        uint16_t id;
+        uint32_t value;
+    } settings[] = {
+        /* Server push is useless for media playback */
+        { VLC_H2_SETTING_ENABLE_PUSH, 0 },
+        { VLC_H2_SETTING_INITIAL_WINDOW_SIZE, VLC_H2_INIT_WINDOW },
+    };
+    const unsigned count = sizeof (settings) / sizeof (settings[0]);
+
+    struct vlc_h2_frame *f = vlc_h2_frame_alloc(VLC_H2_FRAME_SETTINGS, 0, 0,
+                                                count * 6);
+    if (unlikely(f == NULL))
+        return NULL;
+
+    uint8_t *p = vlc_h2_frame_payload(f);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        SetWBE(p, settings[i].id);
+        SetDWBE(p + 2, settings[i].value);
+        p += 6;
+    }
+    return f;
+}
+
+struct vlc_h2_frame *vlc_h2_frame_settings_ack(void)
+{
+    return vlc_h2_frame_alloc(VLC_H2_FRAME_SETTINGS, VLC_H2_SETTINGS_ACK, 0,
+                              0);
+}
+
+struct vlc_h2_frame *vlc_h2_frame_pong(uint64_t opaque)
+{
+    struct vlc_h2_frame *f = vlc_h2_frame_alloc(VLC_H2_FRAME_PING,
+                                                VLC_H2_PING_ACK, 0, 8);
+    if (likely(f != NULL))
+        memcpy(vlc_h2_frame_payload(f), &opaque, 8);
+    return f;
+}
+
+struct vlc_h2_frame *vlc_h2_frame_goaway(uint_fast32_t last_stream_id,
+                                         uint_fast32_t error_code)
+{
+    struct vlc_h2_frame *f = vlc_h2_frame_alloc(VLC_H2_FRAME_GOAWAY, 0, 0, 8);
+    if (likely(f != NULL))
+    {
+        uint8_t *p = vlc_h2_frame_payload(f);
+
+        SetDWBE(p, last_stream_id);
+        SetDWBE(p + 4, error_code);
+    }
+    return f;
+}
+
+struct vlc_h2_frame *vlc_h2_frame_window_update(uint_fast32_t stream_id,
+                                                uint_fast32_t credit)
+{
+    assert((credit >> 31) == 0);
+
+    struct vlc_h2_frame *f = vlc_h2_frame_alloc(VLC_H2_FRAME_WINDOW_UPDATE,
+                                                0, stream_id, 4);
+    if (likely(f != NULL))
+        SetDWBE(vlc_h2_frame_payload(f), credit);
+    return f;
+}
+
+const char *vlc_h2_strerror(uint_fast32_t code)
+{
+    static const char names[][20] = {
+        [VLC_H2_NO_ERROR]            = "No error",
+        [VLC_H2_PROTOCOL_ERROR]      = "Protocol error",
+        [VLC_H2_INTERNAL_ERROR]      = "Internal error",
+        [VLC_H2_FLOW_CONTROL_ERROR]  = "Flow control error",
+        [VLC_H2_SETTINGS_TIMEOUT]    = "Settings time-out",
+        [VLC_H2_STREAM_CLOSED]       = "Stream closed",
+        [VLC_H2_FRAME_SIZE_ERROR]    = "Frame size error",
+        [VLC_H2_REFUSED_STREAM]      = "Refused stream",
+        [VLC_H2_CANCEL]              = "Cancellation",
+        [VLC_H2_COMPRESSION_ERROR]   = "Compression error",
+        [VLC_H2_CONNECT_ERROR]       = "CONNECT error",
+        [VLC_H2_ENHANCE_YOUR_CALM]   = "Excessive load",
+        [VLC_H2_INADEQUATE_SECURITY] = "Inadequate security",
+        [VLC_H2_HTTP_1_1_REQUIRED]   = "Required HTTP/1.1",
+    };
+
+    if (code >= sizeof (names) / sizeof (names[0]) || names[code][0] == 0)
+        return "Unknown error";
+    return names[code];
+}
+
+const uint8_t *vlc_h2_frame_data_get(const struct vlc_h2_frame *f,
+                                     size_t *restrict lenp)
+{
+    assert(vlc_h2_frame_type(f) == VLC_H2_FRAME_DATA);
+
+    size_t len = vlc_h2_frame_length(f);
+    const uint8_t *ptr = vlc_h2_frame_payload(f);
+
+    if (vlc_h2_frame_flags(f) & VLC_H2_DATA_PADDED)
+    {
+        if (len < 1 || len < 1u + ptr[0])
+            return NULL;
+        len -= 1 + ptr[0];
+        ptr++;
+    }
+
+    *lenp = len;
+    return ptr;
+}
+
+/*** Frame parsing ***/
+
+typedef int (*vlc_h2_parser)(struct vlc_h2_parser *, struct vlc_h2_frame *,
+                             size_t, uint_fast32_t);
+
+struct vlc_h2_parser
+{
+    void *opaque;
+    const struct vlc_h2_parser_cbs *cbs;
+    vlc_h2_parser parser; /**< parser for the next frame */
+    uint32_t rcwd_size; /**< connection receive window remaining */
+    struct
+    {
+        uint32_t sid; /**< stream ID of the pending header block */
+        bool eos; /**< whether the stream ends with the header block */
+        size_t len; /**< length of the pending header block */
+        uint8_t *buf; /**< pending header block */
+        struct hpack_decoder *decoder;
+    } headers;
+};
+
+static int vlc_h2_parse_generic(struct vlc_h2_parser *,
+                                struct vlc_h2_frame *, size_t, uint_fast32_t);
+static int vlc_h2_parse_headers_block(struct vlc_h2_parser *,
+                                      struct vlc_h2_frame *, size_t,
+                                      uint_fast32_t);
+
+static int vlc_h2_parse_error(struct vlc_h2_parser *p, uint_fast32_t code)
+{
+    p->cbs->error(p->opaque, code);
+    return -1;
+}
+
+static int vlc_h2_stream_error(struct vlc_h2_parser *p, uint_fast32_t id,
+                               uint_fast32_t code)
+{
+    return p->cbs->stream_error(p->opaque, id, code);
+}
+
+static void *vlc_h2_stream_lookup(struct vlc_h2_parser *p, uint_fast32_t id)
+{
+    return p->cbs->stream_lookup(p->opaque, id);
+}
+
+static void vlc_h2_parse_headers_start(struct vlc_h2_parser *p,
+                                       uint_fast32_t sid, bool eos)
+{
+    assert(sid != 0);
+    assert(p->headers.sid == 0);
+
+    p->parser = vlc_h2_parse_headers_block;
+    p->headers.sid = sid;
+    p->headers.eos = eos;
+    p->headers.len = 0;
+}
+
+static int vlc_h2_parse_headers_append(struct vlc_h2_parser *p,
+                                       const uint8_t *data, size_t len)
+{
+    assert(p->headers.sid != 0);
+
+    if (p->headers.len + len > VLC_H2_MAX_HEADER_BLOCK)
+        return vlc_h2_parse_error(p, VLC_H2_ENHANCE_YOUR_CALM);
+
+    uint8_t *buf = realloc(p->headers.buf, p->headers.len + len);
+    if (unlikely(buf == NULL))
+        return vlc_h2_parse_error(p, VLC_H2_INTERNAL_ERROR);
+
+    p->headers.buf = buf;
+    memcpy(p->headers.buf + p->headers.len, data, len);
+    p->headers.len += len;
+    return 0;
+}
+
+static int vlc_h2_parse_headers_end(struct vlc_h2_parser *p)
+{
+    char *headers[VLC_H2_MAX_HEADERS][2];
+
+    /* TODO: limit total decompressed size of the headers list */
+    int n = hpack_decode(p->headers.decoder, p->headers.buf, p->headers.len,
+                         headers, VLC_H2_MAX_HEADERS);
+    if (n < 0)
+        return vlc_h2_parse_error(p, VLC_H2_COMPRESSION_ERROR);
+
+    void *s = vlc_h2_stream_lookup(p, p->headers.sid);
+    if (s != NULL)
+    {
+        p->cbs->stream_headers(s, n, headers);
+        if (p->headers.eos)
+            p->cbs->stream_end(s);
+    }
+    else
+    {   /* The stream is closed on our side: the block only matters to
+         * keep the decoder state in sync. */
+        for (int i = 0; i < n; i++)
+        {
+            free(headers[i][1]);
+            free(headers[i][0]);
+        }
+    }
+
+    p->parser = vlc_h2_parse_generic;
+    p->headers.sid = 0;
+    return 0;
+}
+
+/** Parses a DATA frame */
+static int vlc_h2_parse_frame_data(struct vlc_h2_parser *p,
+                                   struct vlc_h2_frame *f, size_t len,
+                                   uint_fast32_t id)
+{
+    const uint8_t *ptr;
+    size_t dlen;
+
+    if (id == 0)
+    {
+        free(f);
+        return vlc_h2_parse_error(p, VLC_H2_PROTOCOL_ERROR);
+    }
+
+    ptr = vlc_h2_frame_data_get(f, &dlen);
+    if (ptr == NULL)
+    {
+        free(f);
+        return vlc_h2_parse_error(p, VLC_H2_PROTOCOL_ERROR);
+    }
+
+    /* Padding counts against flow control too */
+    if (len > p->rcwd_size)
+    {
+        free(f);
+        return vlc_h2_parse_error(p, VLC_H2_FLOW_CONTROL_ERROR);
+    }
+    p->rcwd_size -= len;
+    p->cbs->window_status(p->opaque, &p->rcwd_size);
+
+    void *s = vlc_h2_stream_lookup(p, id);
+    if (s == NULL)
+    {   /* Most likely data in flight on a stream that we reset */
+        free(f);
+        return 0;
+    }
+
+    bool eos = (vlc_h2_frame_flags(f) & VLC_H2_DATA_END_STREAM) != 0;
+    int ret = p->cbs->stream_data(s, f);
+    if (ret == 0 && eos)
+        p->cbs->stream_end(s);
+    return ret;
+}
+
+/** Parses a HEADERS frame */
+static int vlc_h2_parse_frame_headers(struct vlc_h2_parser *p,
+                                      struct vlc_h2_frame *f, size_t len,
+                                      uint_fast32_t id)
+{
+    uint_fast8_t flags = vlc_h2_frame_flags(f);
+    const uint8_t *ptr = vlc_h2_frame_payload(f);
+
+    if (id == 0)
+    {
+        free(f);
+        return vlc_h2_parse_error(p, VLC_H2_PROTOCOL_ERROR);
+    }
+
+    if (flags & VLC_H2_HEADERS_PADDED)
+    {
+        if (len < 1 || len < (1u + ptr[0]))
+        {
+            free(f);
+            return vlc_h2_parse_error(p, VLC_H2_FRAME_SIZE_ERROR);
+        }
+        len -= 1 + ptr[0];
+        ptr++;
+    }
+
+    if (flags & VLC_H2_HEADERS_PRIORITY)
+    {   /* Ignore priorities for now as we do not upload anything. */
+        if (len < 5)
+        {
+            free(f);
+            return vlc_h2_parse_error(p, VLC_H2_FRAME_SIZE_ERROR);
+        }
+        ptr += 5;
+        len -= 5;
+    }
+
+    vlc_h2_parse_headers_start(p, id, flags & VLC_H2_HEADERS_END_STREAM);
+
+    int ret = vlc_h2_parse_headers_append(p, ptr, len);
+
+    if (ret == 0 && (flags & VLC_H2_HEADERS_END_HEADERS))
+        ret = vlc_h2_parse_headers_end(p);
+
+    free(f);
+    return ret;
+}
+
+/** Parses a PRIORITY frame */
+static int vlc_h2_parse_frame_priority(struct vlc_h2_parser *p,
+                                       struct vlc_h2_frame *f, size_t len,
+                                       uint_fast32_t id)
+{
+    free(f);
+
+    if (id == 0)
+        return vlc_h2_parse_error(p, VLC_H2_PROTOCOL_ERROR);
+
+    if (len != 5)
+        return vlc_h2_stream_error(p, id, VLC_H2_FRAME_SIZE_ERROR);
+
+    /* Ignore priorities for now as we do not upload anything. */
+    return 0;
+}
+
+/** Parses a RST_STREAM frame */
+static int vlc_h2_parse_frame_rst_stream(struct vlc_h2_parser *p,
+                                         struct vlc_h2_frame *f, size_t len,
+                                         uint_fast32_t id)
+{
+    if (id == 0)
+    {
+        free(f);
+        return vlc_h2_parse_error(p, VLC_H2_PROTOCOL_ERROR);
+    }
+
+    if (len != 4)
+    {
+        free(f);
+        return vlc_h2_parse_error(p, VLC_H2_FRAME_SIZE_ERROR);
+    }
+
+    uint_fast32_t code = GetDWBE(vlc_h2_frame_payload(f));
+    free(f);
+
+    void *s = vlc_h2_stream_lookup(p, id);
+    if (s == NULL)
+        return 0;
+    return p->cbs->stream_reset(s, code);
+}
+
+/** Parses a SETTINGS frame */
+static int vlc_h2_parse_frame_settings(struct vlc_h2_parser *p,
+                                       struct vlc_h2_frame *f, size_t len,
+                                       uint_fast32_t id)
+{
+    const uint8_t *ptr = vlc_h2_frame_payload(f);
+
+    if (id != 0)
+    {
+        free(f);
+        return vlc_h2_parse_error(p, VLC_H2_PROTOCOL_ERROR);
+    }
+
+    if (len % 6 || len > VLC_H2_DEFAULT_MAX_FRAME)
+    {
+        free(f);
+        return vlc_h2_parse_error(p, VLC_H2_FRAME_SIZE_ERROR);
+    }
+
+    if (vlc_h2_frame_flags(f) & VLC_H2_SETTINGS_ACK)
+    {
+        free(f);
+        if (len != 0)
+            return vlc_h2_parse_error(p, VLC_H2_FRAME_SIZE_ERROR);
+        /* Ignore ACKs for now as we never change settings. */
+        return 0;
+    }
+
+    for (const uint8_t *end = ptr + len; ptr < end; ptr += 6)
+        p->cbs->setting(p->opaque, GetWBE(ptr), GetDWBE(ptr + 2));
+
+    free(f);
+    return p->cbs->settings_done(p->opaque);
+}
+
+/** Parses a PING frame */
+static int vlc_h2_parse_frame_ping(struct vlc_h2_parser *p,
+                                   struct vlc_h2_frame *f, size_t len,
+                                   uint_fast32_t id)
+{
+    uint64_t opaque;
+
+    if (id != 0)
+    {
+        free(f);
+        return vlc_h2_parse_error(p, VLC_H2_PROTOCOL_ERROR);
+    }
+
+    if (len != 8)
+    {
+        free(f);
+        return vlc_h2_parse_error(p, VLC_H2_FRAME_SIZE_ERROR);
+    }
+
+    if (vlc_h2_frame_flags(f) & VLC_H2_PING_ACK)
+    {
+        free(f);
+        return 0;
+    }
+
+    memcpy(&opaque, vlc_h2_frame_payload(f), 8);
+    free(f);
+
+    return p->cbs->ping(p->opaque, opaque);
+}
+
+/** Parses a GOAWAY frame */
+static int vlc_h2_parse_frame_goaway(struct vlc_h2_parser *p,
+                                     struct vlc_h2_frame *f, size_t len,
+                                     uint_fast32_t id)
+{
+    const uint8_t *ptr = vlc_h2_frame_payload(f);
+
+    if (id != 0)
+    {
+        free(f);
+        return vlc_h2_parse_error(p, VLC_H2_PROTOCOL_ERROR);
+    }
+
+    if (len < 8)
+    {
+        free(f);
+        return vlc_h2_parse_error(p, VLC_H2_FRAME_SIZE_ERROR);
+    }
+
+    uint_fast32_t last_id = GetDWBE(ptr) & 0x7FFFFFFF;
+    uint_fast32_t code = GetDWBE(ptr + 4);
+
+    free(f);
+    return p->cbs->reset(p->opaque, last_id, code);
+}
+
+/** Parses a WINDOW_UPDATE frame */
+static int vlc_h2_parse_frame_window_update(struct vlc_h2_parser *p,
+                                            struct vlc_h2_frame *f,
+                                            size_t len, uint_fast32_t id)
+{
+    free(f);
+
+    if (len != 4)
+    {
+        if (id == 0)
+            return vlc_h2_parse_error(p, VLC_H2_FRAME_SIZE_ERROR);
+        return vlc_h2_stream_error(p, id, VLC_H2_FRAME_SIZE_ERROR);
+    }
+
+    /* Nothing to do as we do not send data for the time being. */
+    return 0;
+}
+
+/** Parses a frame that is not expected at this point */
+static int vlc_h2_parse_frame_unexpected(struct vlc_h2_parser *p,
+                                         struct vlc_h2_frame *f, size_t len,
+                                         uint_fast32_t id)
+{
+    (void) len; (void) id;
+    free(f);
+    return vlc_h2_parse_error(p, VLC_H2_PROTOCOL_ERROR);
+}
+
+/** Parses a frame of unknown type */
+static int vlc_h2_parse_frame_unknown(struct vlc_h2_parser *p,
+                                      struct vlc_h2_frame *f, size_t len,
+                                      uint_fast32_t id)
+{
+    /* Unknown frame types must be ignored */
+    (void) p; (void) len; (void) id;
+    free(f);
+    return 0;
+}
+
+static const vlc_h2_parser vlc_h2_parsers[] = {
+    [VLC_H2_FRAME_DATA]          = vlc_h2_parse_frame_data,
+    [VLC_H2_FRAME_HEADERS]       = vlc_h2_parse_frame_headers,
+    [VLC_H2_FRAME_PRIORITY]      = vlc_h2_parse_frame_priority,
+    [VLC_H2_FRAME_RST_STREAM]    = vlc_h2_parse_frame_rst_stream,
+    [VLC_H2_FRAME_SETTINGS]      = vlc_h2_parse_frame_settings,
+    /* Server push is disabled in our settings */
+    [VLC_H2_FRAME_PUSH_PROMISE]  = vlc_h2_parse_frame_unexpected,
+    [VLC_H2_FRAME_PING]          = vlc_h2_parse_frame_ping,
+    [VLC_H2_FRAME_GOAWAY]        = vlc_h2_parse_frame_goaway,
+    [VLC_H2_FRAME_WINDOW_UPDATE] = vlc_h2_parse_frame_window_update,
+    [VLC_H2_FRAME_CONTINUATION]  = vlc_h2_parse_frame_unexpected,
+};
+
+/** Parses any frame outside of a header block */
+static int vlc_h2_parse_generic(struct vlc_h2_parser *p,
+                                struct vlc_h2_frame *f, size_t len,
+                                uint_fast32_t id)
+{
+    vlc_h2_parser func = vlc_h2_parse_frame_unknown;
+    uint_fast8_t type = vlc_h2_frame_type(f);
+
+    if (type < sizeof (vlc_h2_parsers) / sizeof (vlc_h2_parsers[0]))
+        func = vlc_h2_parsers[type];
+
+    return func(p, f, len, id);
+}
+
+/** Parses a CONTINUATION frame, within a header block */
+static int vlc_h2_parse_headers_block(struct vlc_h2_parser *p,
+                                      struct vlc_h2_frame *f, size_t len,
+                                      uint_fast32_t id)
+{
+    assert(p->headers.sid != 0);
+
+    /* Nothing else may come before the end of the header block */
+    if (vlc_h2_frame_type(f) != VLC_H2_FRAME_CONTINUATION
+     || id != p->headers.sid)
+    {
+        free(f);
+        return vlc_h2_parse_error(p, VLC_H2_PROTOCOL_ERROR);
+    }
+
+    int ret = vlc_h2_parse_headers_append(p, vlc_h2_frame_payload(f), len);
+
+    if (ret == 0
+     && (vlc_h2_frame_flags(f) & VLC_H2_CONTINUATION_END_HEADERS))
+        ret = vlc_h2_parse_headers_end(p);
+
+    free(f);
+    return ret;
+}
+
+struct vlc_h2_parser *vlc_h2_parse_init(void *ctx,
+                                        const struct vlc_h2_parser_cbs *cbs)
+{
+    struct vlc_h2_parser *p = malloc(sizeof (*p));
+    if (unlikely(p == NULL))
+        return NULL;
+
+    p->opaque = ctx;
+    p->cbs = cbs;
+    p->parser = vlc_h2_parse_generic;
+    p->rcwd_size = VLC_H2_DEFAULT_INIT_WINDOW;
+    p->headers.sid = 0;
+    p->headers.buf = NULL;
+    p->headers.len = 0;
+    p->headers.decoder = hpack_decode_init(4096);
+    if (unlikely(p->headers.decoder == NULL))
+    {
+        free(p);
+        return NULL;
+    }
+    return p;
+}
+
+int vlc_h2_parse(struct vlc_h2_parser *p, struct vlc_h2_frame *f)
+{
+    while (f != NULL)
+    {
+        struct vlc_h2_frame *next = f->next;
+        size_t len = vlc_h2_frame_length(f);
+        uint_fast32_t id = vlc_h2_frame_id(f);
+
+        f->next = NULL;
+        if (p->parser(p, f, len, id))
+        {
+            while (next != NULL)
+            {
+                f = next->next;
+                free(next);
+                next = f;
+            }
+            return -1;
+        }
+        f = next;
+    }
+    return 0;
+}
+
+void vlc_h2_parse_destroy(struct vlc_h2_parser *p)
+{
+    hpack_decode_destroy(p->headers.decoder);
+    free(p->headers.buf);
+    free(p);
+}
@@ -0,0 +1,149 @@
+/*****************************************************************************
+ * h2frame.h: HTTP/2 frame formatting and parsing
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_H2FRAME_H
+#define VLC_H2FRAME_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \file
+ * HTTP/2 (RFC 7540) frames.
+ */
+
+/** HTTP/2 frame */
+struct vlc_h2_frame
+{
+    struct vlc_h2_frame *next; /**< next frame in a chain */
+    uint8_t data[]; /**< 9 bytes frame header, then payload */
+};
+
+#define VLC_H2_FRAME_HEADER_SIZE 9
+/** Default maximum frame payload size, that any peer must accept */
+#define VLC_H2_DEFAULT_MAX_FRAME 16384
+/** Default flow control window size */
+#define VLC_H2_DEFAULT_INIT_WINDOW 65535
+
+static inline size_t vlc_h2_frame_length(const struct vlc_h2_frame *f)
+{
+    const uint8_t *buf = f->data;
+    return (buf[0] << 16) | (buf[1] << 8) | buf[2];
+}
+
+static inline size_t vlc_h2_frame_size(const struct vlc_h2_frame *f)
+{
+    return VLC_H2_FRAME_HEADER_SIZE + vlc_h2_frame_length(f);
+}
+
+/** HTTP/2 error codes */
+enum vlc_h2_error
+{
+    VLC_H2_NO_ERROR,
+    VLC_H2_PROTOCOL_ERROR,
+    VLC_H2_INTERNAL_ERROR,
+    VLC_H2_FLOW_CONTROL_ERROR,
+    VLC_H2_SETTINGS_TIMEOUT,
+    VLC_H2_STREAM_CLOSED,
+    VLC_H2_FRAME_SIZE_ERROR,
+    VLC_H2_REFUSED_STREAM,
+    VLC_H2_CANCEL,
+    VLC_H2_COMPRESSION_ERROR,
+    VLC_H2_CONNECT_ERROR,
+    VLC_H2_ENHANCE_YOUR_CALM,
+    VLC_H2_INADEQUATE_SECURITY,
+    VLC_H2_HTTP_1_1_REQUIRED,
+};
+
+/** HTTP/2 settings */
+enum vlc_h2_setting
+{
+    VLC_H2_SETTING_HEADER_TABLE_SIZE = 0x0001,
+    VLC_H2_SETTING_ENABLE_PUSH,
+    VLC_H2_SETTING_MAX_CONCURRENT_STREAMS,
+    VLC_H2_SETTING_INITIAL_WINDOW_SIZE,
+    VLC_H2_SETTING_MAX_FRAME_SIZE,
+    VLC_H2_SETTING_MAX_HEADER_LIST_SIZE,
+};
+
+/** Flow control window that the client announces for each stream */
+#define VLC_H2_INIT_WINDOW   (1 << 20)
+/** Flow control window that the client grants the whole connection */
+#define VLC_H2_CONN_WINDOW   (16 << 20)
+
+const char *vlc_h2_strerror(uint_fast32_t code);
+
+/*** Frame formatting ***/
+struct vlc_h2_frame *
+vlc_h2_frame_headers(uint_fast32_t stream_id, uint_fast32_t mtu, bool eos,
+                     unsigned count, const char *const headers[][2]);
+struct vlc_h2_frame *vlc_h2_frame_rst_stream(uint_fast32_t stream_id,
+                                             uint_fast32_t error_code);
+struct vlc_h2_frame *vlc_h2_frame_settings(void);
+struct vlc_h2_frame *vlc_h2_frame_settings_ack(void);
+struct vlc_h2_frame *vlc_h2_frame_pong(uint64_t opaque);
+struct vlc_h2_frame *vlc_h2_frame_goaway(uint_fast32_t last_stream_id,
+                                         uint_fast32_t error_code);
+struct vlc_h2_frame *vlc_h2_frame_window_update(uint_fast32_t stream_id,
+                                                uint_fast32_t credit);
+
+/**
+ * Gets the payload of a DATA frame, without padding.
+ * \return the payload, or NULL if the frame is not a valid DATA frame
+ */
+const uint8_t *vlc_h2_frame_data_get(const struct vlc_h2_frame *,
+                                     size_t *restrict len);
+
+/*** Frame parsing ***/
+
+/** Callbacks of the HTTP/2 frame parser */
+struct vlc_h2_parser_cbs
+{
+    void (*setting)(void *ctx, uint_fast16_t id, uint_fast32_t value);
+    int  (*settings_done)(void *ctx);
+    int  (*ping)(void *ctx, uint_fast64_t opaque);
+    void (*error)(void *ctx, uint_fast32_t code);
+    int  (*reset)(void *ctx, uint_fast32_t last_stream_id,
+                  uint_fast32_t code);
+    /** Called after each DATA frame with the connection receive window */
+    void (*window_status)(void *ctx, uint32_t *rcwd);
+
+    void *(*stream_lookup)(void *ctx, uint_fast32_t id);
+    int  (*stream_error)(void *ctx, uint_fast32_t id, uint_fast32_t code);
+    void (*stream_headers)(void *s, unsigned count, char *headers[][2]);
+    int  (*stream_data)(void *s, struct vlc_h2_frame *f);
+    void (*stream_end)(void *s);
+    int  (*stream_reset)(void *s, uint_fast32_t code);
+};
+
+struct vlc_h2_parser;
+
+struct vlc_h2_parser *vlc_h2_parse_init(void *ctx,
+                                        const struct vlc_h2_parser_cbs *cbs);
+/**
+ * Parses one received frame. The frame is consumed.
+ * \return 0 on success, -1 on connection error (the error callback has then
+ * been invoked).
+ */
+int vlc_h2_parse(struct vlc_h2_parser *, struct vlc_h2_frame *);
+void vlc_h2_parse_destroy(struct vlc_h2_parser *);
+
+#endif
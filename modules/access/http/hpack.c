@@ -0,0 +1,567 @@
+/*****************************************************************************
+ * hpack.c: HPACK header compression for HTTP/2
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hpack.h"
+
+/** Static header table (RFC 7541 appendix A) */
+static const char hpack_names[][28] =
+{
+    ":authority", ":method", ":method", ":path", ":path", ":scheme",
+    ":scheme", ":status", ":status", ":status", ":status", ":status",
+    ":status", ":status", "accept-charset", "accept-encoding",
+    "accept-language", "accept-ranges", "accept",
+    "access-control-allow-origin", "age", "allow", "authorization",
+    "cache-control", "content-disposition", "content-encoding",
+    "content-language", "content-length", "content-location",
+    "content-range", "content-type", "cookie", "date", "etag", "expect",
+    "expires", "from", "host", "if-match", "if-modified-since",
+    "if-none-match", "if-range", "if-unmodified-since", "last-modified",
+    "link", "location", "max-forwards", "proxy-authenticate",
+    "proxy-authorization", "range", "referer", "refresh", "retry-after",
+    "server", "set-cookie", "strict-transport-security",
+    "transfer-encoding", "user-agent", "vary", "via", "www-authenticate",
+};
+
+static const char hpack_values[][14] =
+{
+    "", "GET", "POST", "/", "/index.html", "http", "https", "200", "204",
+    "206", "304", "400", "404", "500", "", "gzip, deflate",
+};
+
+#define HPACK_STATIC_COUNT \
+    (sizeof (hpack_names) / sizeof (hpack_names[0]))
+
+/**
+ * Huffman code (RFC 7541 appendix B).
+ *
+ * The code is canonical: it is fully described by the number of codes of
+ * each bit length, and the symbols sorted by code. The end-of-string
+ * symbol is the last code of 30 bits, and is not listed.
+ */
+static const uint8_t hpack_huff_counts[30] =
+{
+    0, 0, 0, 0, 10, 26, 32, 6, 0, 5, 3, 2, 6, 2, 3, 0,
+    0, 0, 3, 8, 13, 26, 29, 12, 4, 15, 19, 29, 0, 4,
+};
+
+static const uint8_t hpack_huff_syms[256] =
+{
+    /* 5 bits */
+    '0', '1', '2', 'a', 'c', 'e', 'i', 'o', 's', 't',
+    /* 6 bits */
+    ' ', '%', '-', '.', '/', '3', '4', '5', '6', '7', '8', '9', '=', 'A',
+    '_', 'b', 'd', 'f', 'g', 'h', 'l', 'm', 'n', 'p', 'r', 'u',
+    /* 7 bits */
+    ':', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N',
+    'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'Y', 'j', 'k', 'q', 'v',
+    'w', 'x', 'y', 'z',
+    /* 8 bits */
+    '&', '*', ',', ';', 'X', 'Z',
+    /* 10 to 15 bits */
+    '!', '"', '(', ')', '?', '\'', '+', '|', '#', '>',
+    0, '$', '@', '[', ']', '~', '^', '}', '<', '`', '{',
+    /* 19 bits */
+    92, 195, 208,
+    /* 20 bits */
+    128, 130, 131, 162, 184, 194, 224, 226,
+    /* 21 bits */
+    153, 161, 167, 172, 176, 177, 179, 209, 216, 217, 227, 229, 230,
+    /* 22 bits */
+    129, 132, 133, 134, 136, 146, 154, 156, 160, 163, 164, 169, 170, 173,
+    178, 181, 185, 186, 187, 189, 190, 196, 198, 228, 232, 233,
+    /* 23 bits */
+    1, 135, 137, 138, 139, 140, 141, 143, 147, 149, 150, 151, 152, 155,
+    157, 158, 165, 166, 168, 174, 175, 180, 182, 183, 188, 191, 197, 231,
+    239,
+    /* 24 bits */
+    9, 142, 144, 145, 148, 159, 171, 206, 215, 225, 236, 237,
+    /* 25 bits */
+    199, 207, 234, 235,
+    /* 26 bits */
+    192, 193, 200, 201, 202, 205, 210, 213, 218, 219, 238, 240, 242, 243,
+    255,
+    /* 27 bits */
+    203, 204, 211, 212, 214, 221, 222, 223, 241, 244, 245, 246, 247, 248,
+    250, 251, 252, 253, 254,
+    /* 28 bits */
+    2, 3, 4, 5, 6, 7, 8, 11, 12, 14, 15, 16, 17, 18, 19, 20, 21, 23, 24,
+    25, 26, 27, 28, 29, 30, 31, 127, 220, 249,
+    /* 30 bits */
+    10, 13, 22,
+};
+
+struct hpack_decoder
+{
+    char **table; /**< dynamic table entries, oldest first */
+    unsigned count; /**< number of dynamic table entries */
+    size_t size; /**< current size of the dynamic table */
+    size_t max_size; /**< current maximum size of the dynamic table */
+    size_t limit; /**< maximum size allowed for the dynamic table */
+};
+
+struct hpack_decoder *hpack_decode_init(size_t size)
+{
+    struct hpack_decoder *dec = malloc(sizeof (*dec));
+    if (dec == NULL)
+        return NULL;
+
+    dec->table = NULL;
+    dec->count = 0;
+    dec->size = 0;
+    dec->max_size = size;
+    dec->limit = size;
+    return dec;
+}
+
+void hpack_decode_destroy(struct hpack_decoder *dec)
+{
+    for (unsigned i = 0; i < dec->count; i++)
+        free(dec->table[i]);
+    free(dec->table);
+    free(dec);
+}
+
+/* Dynamic table entries are stored as "name\0value" */
+static size_t hpack_entry_size(const char *entry)
+{
+    size_t namelen = strlen(entry);
+
+    return namelen + strlen(entry + namelen + 1) + 32;
+}
+
+static void hpack_evict(struct hpack_decoder *dec, size_t max)
+{
+    unsigned evicted = 0;
+
+    while (dec->size > max)
+    {
+        assert(evicted < dec->count);
+        dec->size -= hpack_entry_size(dec->table[evicted]);
+        free(dec->table[evicted]);
+        evicted++;
+    }
+
+    if (evicted > 0)
+    {
+        dec->count -= evicted;
+        memmove(dec->table, dec->table + evicted,
+                dec->count * sizeof (*dec->table));
+    }
+}
+
+static int hpack_append(struct hpack_decoder *dec, const char *name,
+                        const char *value)
+{
+    size_t namelen = strlen(name), valuelen = strlen(value);
+    size_t size = namelen + valuelen + 32;
+
+    if (size > dec->max_size)
+    {   /* An entry larger than the table empties it */
+        hpack_evict(dec, 0);
+        return 0;
+    }
+
+    hpack_evict(dec, dec->max_size - size);
+
+    char *entry = malloc(namelen + valuelen + 2);
+    if (entry == NULL)
+        return -1;
+    memcpy(entry, name, namelen + 1);
+    memcpy(entry + namelen + 1, value, valuelen + 1);
+
+    char **table = realloc(dec->table, (dec->count + 1) * sizeof (*table));
+    if (table == NULL)
+    {
+        free(entry);
+        return -1;
+    }
+
+    table[dec->count++] = entry;
+    dec->table = table;
+    dec->size += size;
+    return 0;
+}
+
+/** Looks an entry up in the static or dynamic tables */
+static int hpack_lookup(const struct hpack_decoder *dec, uint_fast32_t idx,
+                        const char **restrict name,
+                        const char **restrict value)
+{
+    if (idx == 0)
+        return -1;
+
+    idx--;
+    if (idx < HPACK_STATIC_COUNT)
+    {
+        *name = hpack_names[idx];
+        *value = (idx < sizeof (hpack_values) / sizeof (hpack_values[0]))
+                 ? hpack_values[idx] : "";
+        return 0;
+    }
+
+    idx -= HPACK_STATIC_COUNT;
+    if (idx >= dec->count)
+        return -1;
+
+    const char *entry = dec->table[dec->count - 1 - idx];
+    *name = entry;
+    *value = entry + strlen(entry) + 1;
+    return 0;
+}
+
+/** Decodes an integer with a prefix of n bits */
+static int_fast32_t hpack_decode_int(unsigned n, const uint8_t **restrict datap,
+                                     size_t *restrict lengthp)
+{
+    const uint8_t *p = *datap;
+    size_t length = *lengthp;
+
+    assert(n >= 1 && n <= 8 && length > 0);
+
+    uint_fast32_t mask = (1u << n) - 1;
+    uint_fast32_t i = *(p++) & mask;
+    length--;
+
+    if (i == mask)
+    {
+        unsigned shift = 0;
+        uint8_t b;
+
+        do
+        {
+            if (length == 0 || shift > 21)
+                return -1; /* truncated or unreasonably large */
+            b = *(p++);
+            length--;
+            i += (b & 0x7F) << shift;
+            shift += 7;
+        }
+        while (b & 0x80);
+    }
+
+    *datap = p;
+    *lengthp = length;
+    return i;
+}
+
+/** Decodes one Huffman-coded symbol */
+static int hpack_decode_huff_sym(const uint8_t *data, size_t length,
+                                 size_t *restrict bit)
+{
+    uint_fast32_t code = 0; /* code read so far */
+    uint_fast32_t first = 0; /* first code of the current bit length */
+    unsigned offset = 0; /* index of the first symbol of that length */
+    bool padding = true;
+
+    for (unsigned i = 0; i < 30; i++)
+    {
+        if ((*bit / 8) >= length)
+        {   /* End of string: only an EOS prefix of up to 7 bits is valid */
+            if (i < 8 && padding)
+                return -2;
+            return -1;
+        }
+
+        unsigned b = (data[*bit / 8] >> (7 - (*bit % 8))) & 1;
+
+        (*bit)++;
+        padding = padding && b;
+        code = (code << 1) | b;
+
+        if (code - first < hpack_huff_counts[i])
+        {
+            unsigned idx = offset + (code - first);
+
+            if (idx >= sizeof (hpack_huff_syms))
+                return -1; /* EOS must not appear in a string */
+            return hpack_huff_syms[idx];
+        }
+
+        offset += hpack_huff_counts[i];
+        first = (first + hpack_huff_counts[i]) << 1;
+    }
+    return -1;
+}
+
+static char *hpack_decode_huffman(const uint8_t *data, size_t length)
+{
+    /* The shortest code is 5 bits long */
+    char *str = malloc(length * 8 / 5 + 1);
+    if (str == NULL)
+        return NULL;
+
+    size_t bit = 0, len = 0;
+
+    for (;;)
+    {
+        int c = hpack_decode_huff_sym(data, length, &bit);
+        if (c == -2)
+            break;
+        if (c <= 0)
+        {   /* error or nul byte */
+            free(str);
+            errno = EINVAL;
+            return NULL;
+        }
+        str[len++] = c;
+    }
+
+    str[len] = '\0';
+    return str;
+}
+
+static char *hpack_decode_str(const uint8_t **restrict datap,
+                              size_t *restrict lengthp)
+{
+    if (*lengthp == 0)
+        return NULL;
+
+    bool huffman = (**datap & 0x80) != 0;
+    int_fast32_t len = hpack_decode_int(7, datap, lengthp);
+    if (len < 0 || (size_t)len > *lengthp)
+        return NULL;
+
+    const uint8_t *p = *datap;
+    char *str;
+
+    if (huffman)
+        str = hpack_decode_huffman(p, len);
+    else
+    {
+        if (memchr(p, 0, len) != NULL)
+            return NULL;
+        str = malloc(len + 1);
+        if (str != NULL)
+        {
+            memcpy(str, p, len);
+            str[len] = '\0';
+        }
+    }
+
+    *datap += len;
+    *lengthp -= len;
+    return str;
+}
+
+/** Decodes a literal field, with a name index prefix of n bits */
+static int hpack_decode_literal(struct hpack_decoder *dec, unsigned n,
+                                const uint8_t **restrict datap,
+                                size_t *restrict lengthp,
+                                char **restrict namep, char **restrict valuep)
+{
+    int_fast32_t idx = hpack_decode_int(n, datap, lengthp);
+    char *name;
+
+    if (idx < 0)
+        return -1;
+    if (idx > 0)
+    {
+        const char *iname, *ivalue;
+
+        if (hpack_lookup(dec, idx, &iname, &ivalue))
+            return -1;
+        name = strdup(iname);
+    }
+    else
+        name = hpack_decode_str(datap, lengthp);
+    if (name == NULL)
+        return -1;
+
+    char *value = hpack_decode_str(datap, lengthp);
+    if (value == NULL)
+    {
+        free(name);
+        return -1;
+    }
+
+    *namep = name;
+    *valuep = value;
+    return 0;
+}
+
+int hpack_decode(struct hpack_decoder *dec, const uint8_t *data,
+                 size_t length, char *headers[][2], unsigned max)
+{
+    unsigned count = 0;
+
+    while (length > 0)
+    {
+        char *name, *value;
+        uint8_t b = *data;
+
+        if (b & 0x80)
+        {   /* Indexed header field */
+            int_fast32_t idx = hpack_decode_int(7, &data, &length);
+            const char *n, *v;
+
+            if (idx < 0 || hpack_lookup(dec, idx, &n, &v))
+                goto error;
+            name = strdup(n);
+            value = strdup(v);
+            if (name == NULL || value == NULL)
+            {
+                free(value);
+                free(name);
+                goto error;
+            }
+        }
+        else if (b & 0x40)
+        {   /* Literal header field with incremental indexing */
+            if (hpack_decode_literal(dec, 6, &data, &length, &name, &value))
+                goto error;
+            if (hpack_append(dec, name, value))
+            {
+                free(value);
+                free(name);
+                goto error;
+            }
+        }
+        else if (b & 0x20)
+        {   /* Dynamic table size update */
+            int_fast32_t size = hpack_decode_int(5, &data, &length);
+
+            if (size < 0 || (size_t)size > dec->limit)
+                goto error;
+            dec->max_size = size;
+            hpack_evict(dec, size);
+            continue;
+        }
+        else
+        {   /* Literal header field without indexing or never indexed */
+            if (hpack_decode_literal(dec, 4, &data, &length, &name, &value))
+                goto error;
+        }
+
+        if (count >= max)
+        {
+            free(value);
+            free(name);
+            goto error;
+        }
+        headers[count][0] = name;
+        headers[count][1] = value;
+        count++;
+    }
+    return count;
+
+error:
+    while (count > 0)
+    {
+        count--;
+        free(headers[count][1]);
+        free(headers[count][0]);
+    }
+    return -1;
+}
+
+/** Encodes an integer with a prefix of n bits */
+static size_t hpack_encode_int(uint8_t *restrict buf, size_t size,
+                               uintmax_t value, unsigned n)
+{
+    uintmax_t mask = (1u << n) - 1;
+    size_t len = 1;
+
+    if (value < mask)
+    {
+        if (size > 0)
+            *buf = (*buf & ~mask) | value;
+        return len;
+    }
+
+    if (size > 0)
+        *(buf++) |= mask;
+    size = (size > 0) ? size - 1 : 0;
+    value -= mask;
+
+    while (value >= 0x80)
+    {
+        if (size > 0)
+        {
+            *(buf++) = 0x80 | (value & 0x7F);
+            size--;
+        }
+        value >>= 7;
+        len++;
+    }
+
+    if (size > 0)
+        *buf = value;
+    return len + 1;
+}
+
+static size_t hpack_encode_str(uint8_t *restrict buf, size_t size,
+                               const char *str)
+{
+    size_t slen = strlen(str);
+    size_t len;
+
+    if (size > 0)
+        *buf = 0; /* no Huffman coding */
+    len = hpack_encode_int(buf, size, slen, 7);
+    if (len < size)
+        memcpy(buf + len, str, (slen < size - len) ? slen : size - len);
+    return len + slen;
+}
+
+size_t hpack_encode(uint8_t *buf, size_t size,
+                    const char *const headers[][2], unsigned count)
+{
+    size_t total = 0;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        size_t len;
+
+        /* Literal header field without indexing, with a new name */
+        if (size > 0)
+            *buf = 0;
+        len = 1;
+
+        len += hpack_encode_str(buf + ((len < size) ? len : size),
+                                (len < size) ? size - len : 0,
+                                headers[i][0]);
+        len += hpack_encode_str(buf + ((len < size) ? len : size),
+                                (len < size) ? size - len : 0,
+                                headers[i][1]);
+
+        total += len;
+        if (len < size)
+        {
+            buf += len;
+            size -= len;
+        }
+        else
+        {
+            buf += size;
+            size = 0;
+        }
+    }
+    return total;
+}
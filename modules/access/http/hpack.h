@@ -0,0 +1,66 @@
+/*****************************************************************************
+ * hpack.h: HPACK header compression for HTTP/2
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_HPACK_H
+#define VLC_HPACK_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \file
+ * HPACK (RFC 7541) header block decoder and encoder.
+ */
+
+struct hpack_decoder;
+
+/**
+ * Creates an HPACK decoder.
+ * \param size initial maximum size of the dynamic table (in bytes)
+ */
+struct hpack_decoder *hpack_decode_init(size_t size);
+void hpack_decode_destroy(struct hpack_decoder *);
+
+/**
+ * Decodes an HPACK header block.
+ *
+ * On success, the decoded names and values are heap-allocated and must be
+ * released by the caller with free().
+ *
+ * \param headers table of (name, value) pairs [OUT]
+ * \param max size of the headers table
+ * \return the number of decoded headers, or -1 on error
+ */
+int hpack_decode(struct hpack_decoder *, const uint8_t *data, size_t length,
+                 char *headers[][2], unsigned max);
+
+/**
+ * Encodes an HPACK header block.
+ *
+ * Fields are encoded as literals without indexing, so the encoder does not
+ * need any state.
+ *
+ * \return the size of the encoded block; if it is larger than the size of
+ * the buffer, the content of the buffer is undefined
+ */
+size_t hpack_encode(uint8_t *buf, size_t size,
+                    const char *const headers[][2], unsigned count);
+
+#endif
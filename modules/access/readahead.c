@@ -0,0 +1,108 @@
+/*****************************************************************************
+ * readahead.c: read-ahead buffer for remote file system accesses
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Remote file system clients (libsmbclient, libssh2) split large reads into
+ * several protocol requests kept in flight at the same time, whereas small
+ * reads cost one round trip each. The read-ahead buffer therefore issues
+ * requests of a window that grows, slow-start style, for as long as doubling
+ * it still improves the throughput, i.e. until it covers the
+ * bandwidth-delay product of the link. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+
+#include "readahead.h"
+
+void ReadAheadInit( readahead_t *ra, size_t i_min, size_t i_max )
+{
+    ra->p_buf = NULL;
+    ra->i_begin = ra->i_end = 0;
+    ra->i_window = i_min;
+    ra->i_max = i_max;
+    ra->i_rate = 0;
+    ra->b_probe = true;
+}
+
+void ReadAheadClean( readahead_t *ra )
+{
+    free( ra->p_buf );
+    ra->p_buf = NULL;
+}
+
+void ReadAheadFlush( readahead_t *ra )
+{
+    ra->i_begin = ra->i_end = 0;
+}
+
+static void Adapt( readahead_t *ra, size_t i_read, mtime_t i_duration )
+{
+    /* Only full requests tell whether the window is the bottleneck */
+    if( !ra->b_probe || i_read < ra->i_window || i_duration <= 0 )
+        return;
+
+    uint64_t i_rate = (uint64_t)i_read * CLOCK_FREQ / i_duration;
+
+    if( i_rate > ra->i_rate + ra->i_rate / 4 && ra->i_window < ra->i_max )
+    {
+        uint8_t *p_buf = realloc( ra->p_buf, 2 * ra->i_window );
+        if( p_buf != NULL )
+        {
+            ra->p_buf = p_buf;
+            ra->i_window *= 2;
+        }
+    }
+    else
+        ra->b_probe = false;
+    ra->i_rate = i_rate;
+}
+
+ssize_t ReadAhead( readahead_t *ra, uint8_t *buf, size_t len,
+                   readahead_cb pf_read, void *opaque )
+{
+    if( ra->i_begin >= ra->i_end )
+    {
+        if( ra->p_buf == NULL )
+        {
+            ra->p_buf = malloc( ra->i_window );
+            if( unlikely(ra->p_buf == NULL) )
+                return pf_read( opaque, buf, len );
+        }
+
+        mtime_t i_start = mdate();
+        ssize_t i_read = pf_read( opaque, ra->p_buf, ra->i_window );
+        if( i_read <= 0 )
+            return i_read;
+
+        ra->i_begin = 0;
+        ra->i_end = i_read;
+        Adapt( ra, i_read, mdate() - i_start );
+    }
+
+    size_t i_copy = __MIN( len, ra->i_end - ra->i_begin );
+    memcpy( buf, ra->p_buf + ra->i_begin, i_copy );
+    ra->i_begin += i_copy;
+    return i_copy;
+}
@@ -0,0 +1,43 @@
+/*****************************************************************************
+ * readahead.h: read-ahead buffer for remote file system accesses
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/**
+ * Reads up to the given size from the remote file.
+ * @return the number of bytes read, 0 at end of file, negative on error.
+ */
+typedef ssize_t (*readahead_cb)( void *opaque, uint8_t *buf, size_t len );
+
+typedef struct
+{
+    uint8_t *p_buf;
+    size_t   i_begin;   /**< first unread byte in p_buf */
+    size_t   i_end;     /**< end of the valid data in p_buf */
+
+    size_t   i_window;  /**< size of the next remote request */
+    size_t   i_max;
+    uint64_t i_rate;    /**< throughput of the last full request (bytes/s) */
+    bool     b_probe;   /**< whether the window is still growing */
+} readahead_t;
+
+void ReadAheadInit( readahead_t *, size_t i_min, size_t i_max );
+void ReadAheadClean( readahead_t * );
+ssize_t ReadAhead( readahead_t *, uint8_t *buf, size_t len,
+                   readahead_cb pf_read, void *opaque );
+void ReadAheadFlush( readahead_t * );
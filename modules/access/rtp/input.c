@@ -35,6 +35,9 @@
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
+#ifdef HAVE_SYS_SOCKET_H
+# include <sys/socket.h>
+#endif
 
 #include "rtp.h"
 #ifdef HAVE_SRTP
@@ -95,6 +98,79 @@ static int rtp_timeout (mtime_t deadline)
     return t;
 }
 
+#ifdef HAVE_RECVMMSG
+/** Maximum number of datagrams received at once */
+# define RTP_BATCH 16
+
+static void rtp_batch_release (void *data)
+{
+    block_t **blocks = data;
+
+    for (unsigned i = 0; i < RTP_BATCH; i++)
+        if (blocks[i] != NULL)
+            block_Release (blocks[i]);
+}
+
+/**
+ * Receives all the pending datagrams, at most RTP_BATCH per system call.
+ * The blocks not filled are kept for the next time.
+ */
+static void rtp_dgram_recv (demux_t *demux, int fd, block_t **blocks)
+{
+    struct mmsghdr msgs[RTP_BATCH];
+    struct iovec iovs[RTP_BATCH];
+    unsigned n;
+
+    for (n = 0; n < RTP_BATCH; n++)
+    {
+        if (blocks[n] == NULL)
+        {
+            /* Room for the largest datagram, so none is truncated */
+            blocks[n] = block_Alloc (0xffff);
+            if (unlikely(blocks[n] == NULL))
+                break;
+        }
+
+        iovs[n].iov_base = blocks[n]->p_buffer;
+        iovs[n].iov_len = blocks[n]->i_buffer;
+        memset (&msgs[n].msg_hdr, 0, sizeof (msgs[n].msg_hdr));
+        msgs[n].msg_hdr.msg_iov = &iovs[n];
+        msgs[n].msg_hdr.msg_iovlen = 1;
+    }
+
+    if (unlikely(n == 0))
+    {   /* OOM - dequeue and discard one packet */
+        char dummy;
+        recv (fd, &dummy, 1, 0);
+        return;
+    }
+
+    int count = recvmmsg (fd, msgs, n, MSG_DONTWAIT, NULL);
+    if (count == -1)
+    {
+        if (errno != EAGAIN)
+            msg_Warn (demux, "RTP network error: %s", vlc_strerror_c(errno));
+        return;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        block_t *block = blocks[i];
+
+        blocks[i] = NULL;
+        block->i_buffer = msgs[i].msg_len;
+        rtp_process (demux, block);
+    }
+
+    /* Keep the remaining buffers at the beginning */
+    for (unsigned i = count; i < RTP_BATCH; i++)
+    {
+        blocks[i - count] = blocks[i];
+        blocks[i] = NULL;
+    }
+}
+#endif
+
 /**
  * RTP/RTCP session thread for datagram sockets
  */
@@ -104,11 +180,17 @@ void *rtp_dgram_thread (void *opaque)
     demux_sys_t *sys = demux->p_sys;
     mtime_t deadline = VLC_TS_INVALID;
     int rtp_fd = sys->fd;
+#ifdef HAVE_RECVMMSG
+    block_t *blocks[RTP_BATCH] = { NULL };
+#endif
 
     struct pollfd ufd[1];
     ufd[0].fd = rtp_fd;
     ufd[0].events = POLLIN;
 
+#ifdef HAVE_RECVMMSG
+    vlc_cleanup_push (rtp_batch_release, blocks);
+#endif
     for (;;)
     {
         int n = poll (ufd, 1, rtp_timeout (deadline));
@@ -125,6 +207,9 @@ void *rtp_dgram_thread (void *opaque)
             if (unlikely(ufd[0].revents & POLLHUP))
                 break; /* RTP socket dead (DCCP only) */
 
+#ifdef HAVE_RECVMMSG
+            rtp_dgram_recv (demux, rtp_fd, blocks);
+#else
             block_t *block = block_Alloc (0xffff); /* TODO: p_sys->mru */
             if (unlikely(block == NULL))
                 break; /* we are totallly screwed */
@@ -141,6 +226,7 @@ void *rtp_dgram_thread (void *opaque)
                           vlc_strerror_c(errno));
                 block_Release (block);
             }
+#endif
         }
 
     dequeue:
@@ -148,6 +234,10 @@ void *rtp_dgram_thread (void *opaque)
             deadline = VLC_TS_INVALID;
         vlc_restorecancel (canc);
     }
+#ifdef HAVE_RECVMMSG
+    vlc_cleanup_pop ();
+    rtp_batch_release (blocks);
+#endif
     return NULL;
 }
 
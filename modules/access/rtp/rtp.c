@@ -32,6 +32,7 @@
 #include <vlc_network.h>
 #include <vlc_plugin.h>
 #include <vlc_dialog.h>
+#include <vlc_rand.h>
 #include <vlc_aout.h> /* aout_FormatPrepare() */
 
 #include "rtp.h"
@@ -75,6 +76,12 @@
     "RTP packets will be discarded if they are too far behind (i.e. in the " \
     "past) by this many packets from the last received packet." )
 
+#define RTP_NACK_TEXT N_("Request retransmissions")
+#define RTP_NACK_LONGTEXT N_( \
+    "Lost RTP packets will be requested again from the sender with RTCP " \
+    "negative acknowledgements (RFC 4585), if the RTCP port is set. " \
+    "The sender must retransmit them on the same stream." )
+
 #define RTP_DYNAMIC_PT_TEXT N_("RTP payload format assumed for dynamic " \
                                "payloads")
 #define RTP_DYNAMIC_PT_LONGTEXT N_( \
@@ -122,6 +129,7 @@ vlc_module_begin ()
     add_integer ("rtp-max-misorder", 100, RTP_MAX_MISORDER_TEXT,
                  RTP_MAX_MISORDER_LONGTEXT, true)
         change_integer_range (0, 32767)
+    add_bool ("rtp-nack", false, RTP_NACK_TEXT, RTP_NACK_LONGTEXT, true)
     add_string ("rtp-dynamic-pt", NULL, RTP_DYNAMIC_PT_TEXT,
                 RTP_DYNAMIC_PT_LONGTEXT, true)
         change_string_list (dynamic_pt_list, dynamic_pt_list_text)
@@ -264,6 +272,8 @@ static int Open (vlc_object_t *obj)
                         * CLOCK_FREQ;
     p_sys->max_dropout  = var_CreateGetInteger (obj, "rtp-max-dropout");
     p_sys->max_misorder = var_CreateGetInteger (obj, "rtp-max-misorder");
+    p_sys->nack         = var_CreateGetBool (obj, "rtp-nack") && rtcp_fd != -1;
+    vlc_rand_bytes (&p_sys->ssrc, sizeof (p_sys->ssrc));
     p_sys->thread_ready = false;
     p_sys->autodetect   = true;
 
@@ -298,6 +308,7 @@ static int Open (vlc_object_t *obj)
                      vlc_strerror_c(val));
             goto error;
         }
+        p_sys->nack = false; /* FIXME: SRTCP is not implemented */
     }
 #endif
 
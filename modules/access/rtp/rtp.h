@@ -74,6 +74,8 @@ struct demux_sys_t
     uint16_t      max_dropout; /**< Max packet forward misordering */
     uint16_t      max_misorder; /**< Max packet backward misordering */
     uint8_t       max_src; /**< Max simultaneous RTP sources */
+    uint32_t      ssrc; /**< Own SSRC, for RTCP feedback */
+    bool          nack; /**< Request retransmissions of the lost packets */
     bool          thread_ready;
     bool          autodetect; /**< Payload type autodetection pending */
 };
@@ -30,11 +30,17 @@
 
 #include <vlc_common.h>
 #include <vlc_demux.h>
+#include <vlc_network.h>
 
 #include "rtp.h"
 
 typedef struct rtp_source_t rtp_source_t;
 
+/** Size of the re-ordering buffer of a source (must be a power of two) */
+#define RTP_RING_SIZE 4096
+/** Maximum number of NACK entries in a RTCP feedback packet */
+#define RTP_NACK_MAX 16
+
 /** State for a RTP session: */
 struct rtp_session_t
 {
@@ -49,7 +55,8 @@ rtp_source_create (demux_t *, const rtp_session_t *, uint32_t, uint16_t);
 static void
 rtp_source_destroy (demux_t *, const rtp_session_t *, rtp_source_t *);
 
-static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
+static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *,
+                        block_t *);
 
 /**
  * Creates a new RTP session.
@@ -147,11 +154,59 @@ struct rtp_source_t
     uint16_t bad_seq; /* tentatively next expected sequence for resync */
     uint16_t max_seq; /* next expected sequence */
 
-    uint16_t last_seq; /* sequence of the next dequeued packet */
-    block_t *blocks; /* re-ordered blocks queue */
+    uint16_t last_seq; /* sequence of the last dequeued packet */
+    unsigned count; /* number of queued blocks */
+    /* Re-ordered blocks, indexed by their sequence number modulo the size */
+    block_t *ring[RTP_RING_SIZE];
     void    *opaque[]; /* Per-source private payload data */
 };
 
+static inline uint16_t rtp_seq (const block_t *block)
+{
+    assert (block->i_buffer >= 4);
+    return GetWBE (block->p_buffer + 2);
+}
+
+static inline block_t **rtp_slot (rtp_source_t *src, uint16_t seq)
+{
+    return &src->ring[seq & (RTP_RING_SIZE - 1)];
+}
+
+/**
+ * Finds the queued block with the lowest sequence number.
+ * There must be at least one. The search only walks through the missing
+ * packets, so it is usually immediate.
+ */
+static block_t **rtp_first (rtp_source_t *src)
+{
+    uint16_t seq = src->last_seq + 1;
+    block_t **slot;
+
+    assert (src->count > 0);
+    while (*(slot = rtp_slot (src, seq)) == NULL)
+        seq++;
+    return slot;
+}
+
+/**
+ * Removes the queued block with the lowest sequence number.
+ */
+static block_t *rtp_pop (rtp_source_t *src)
+{
+    block_t **slot = rtp_first (src);
+    block_t *block = *slot;
+
+    *slot = NULL;
+    src->count--;
+    return block;
+}
+
+static void rtp_flush (rtp_source_t *src)
+{
+    while (src->count > 0)
+        block_Release (rtp_pop (src));
+}
+
 /**
  * Initializes a new RTP source within an RTP session.
  */
@@ -172,7 +227,9 @@ rtp_source_create (demux_t *demux, const rtp_session_t *session,
     source->ref_ntp = UINT64_C (1) << 62;
     source->max_seq = source->bad_seq = init_seq;
     source->last_seq = init_seq - 1;
-    source->blocks = NULL;
+    source->count = 0;
+    for (unsigned i = 0; i < RTP_RING_SIZE; i++)
+        source->ring[i] = NULL;
 
     /* Initializes all payload */
     for (unsigned i = 0; i < session->ptc; i++)
@@ -194,16 +251,10 @@ rtp_source_destroy (demux_t *demux, const rtp_session_t *session,
 
     for (unsigned i = 0; i < session->ptc; i++)
         session->ptv[i].destroy (demux, source->opaque[i]);
-    block_ChainRelease (source->blocks);
+    rtp_flush (source);
     free (source);
 }
 
-static inline uint16_t rtp_seq (const block_t *block)
-{
-    assert (block->i_buffer >= 4);
-    return GetWBE (block->p_buffer + 2);
-}
-
 static inline uint32_t rtp_timestamp (const block_t *block)
 {
     assert (block->i_buffer >= 12);
@@ -228,6 +279,48 @@ rtp_find_ptype (const rtp_session_t *session, rtp_source_t *source,
     return NULL;
 }
 
+/**
+ * Requests the retransmission of missing packets with RTCP generic NACKs
+ * (RFC 4585 §6.2.1), for senders retransmitting them on the same stream.
+ *
+ * @param first sequence number of the first missing packet
+ * @param count number of missing packets
+ */
+static void rtp_nack (demux_t *demux, const rtp_source_t *src,
+                      uint16_t first, unsigned count)
+{
+    demux_sys_t *p_sys = demux->p_sys;
+    uint8_t buf[12 + 4 * RTP_NACK_MAX];
+    unsigned fci = 0;
+
+    if (p_sys->rtcp_fd == -1)
+        return;
+
+    /* Each FCI covers a packet and the 16 following ones */
+    while (count > 0 && fci < RTP_NACK_MAX)
+    {
+        uint16_t blp = 0;
+        unsigned n = (count > 17) ? 17 : count;
+
+        for (unsigned i = 1; i < n; i++)
+            blp |= 1 << (i - 1);
+        SetWBE (buf + 12 + 4 * fci, first);
+        SetWBE (buf + 14 + 4 * fci, blp);
+        fci++;
+        first += n;
+        count -= n;
+    }
+
+    buf[0] = 0x80 | 1; /* V=2, FMT=1 (generic NACK) */
+    buf[1] = 205; /* RTPFB */
+    SetWBE (buf + 2, 2 + fci);
+    SetDWBE (buf + 4, p_sys->ssrc);
+    SetDWBE (buf + 8, src->ssrc);
+
+    if (send (p_sys->rtcp_fd, buf, 12 + 4 * fci, 0) == -1)
+        msg_Dbg (demux, "cannot send RTCP NACK: %s", vlc_strerror_c(errno));
+}
+
 /**
  * Receives an RTP packet and queues it. Not a cancellation point.
  *
@@ -335,10 +428,10 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
         if (seq == src->bad_seq)
         {
             src->max_seq = src->bad_seq = seq + 1;
-            src->last_seq = seq - 0x7fffe; /* hack for rtp_decode() */
             msg_Warn (demux, "sequence resynchronized");
-            block_ChainRelease (src->blocks);
-            src->blocks = NULL;
+            rtp_flush (src);
+            src->last_seq = seq - 1;
+            block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
         }
         else
         {
@@ -348,36 +441,45 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
     }
     else
     if (delta_seq >= 0)
+    {
+        if (delta_seq > 0 && p_sys->nack)
+            rtp_nack (demux, src, src->max_seq, delta_seq);
         src->max_seq = seq + 1;
+    }
 
     /* Queues the block in sequence order,
      * hence there is a single queue for all payload types. */
-    block_t **pp = &src->blocks;
-    for (block_t *prev = *pp; prev != NULL; prev = *pp)
+    uint16_t ahead = seq - (uint16_t)(src->last_seq + 1);
+    if (ahead >= 0x8000)
+    {   /* Trash too late packets (and PIM Assert duplicates) */
+        msg_Dbg (demux, "ignoring late packet (sequence: %"PRIu16")", seq);
+        goto drop;
+    }
+    if (ahead >= RTP_RING_SIZE)
+    {   /* Too far ahead: give up waiting on the oldest missing packets */
+        while (src->count > 0
+            && (uint16_t)(seq - (uint16_t)(src->last_seq + 1)) >= RTP_RING_SIZE)
+            rtp_decode (demux, session, src, rtp_pop (src));
+        if ((uint16_t)(seq - (uint16_t)(src->last_seq + 1)) >= RTP_RING_SIZE)
+            src->last_seq = seq - RTP_RING_SIZE;
+    }
+
+    block_t **slot = rtp_slot (src, seq);
+    if (*slot != NULL)
     {
-        int16_t delta_seq = seq - rtp_seq (prev);
-        if (delta_seq < 0)
-            break;
-        if (delta_seq == 0)
-        {
-            msg_Dbg (demux, "duplicate packet (sequence: %"PRIu16")", seq);
-            goto drop; /* duplicate */
-        }
-        pp = &prev->p_next;
+        msg_Dbg (demux, "duplicate packet (sequence: %"PRIu16")", seq);
+        goto drop; /* duplicate */
     }
-    block->p_next = *pp;
-    *pp = block;
+    block->p_next = NULL;
+    *slot = block;
+    src->count++;
 
-    /*rtp_decode (demux, session, src);*/
     return;
 
 drop:
     block_Release (block);
 }
 
-
-static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
-
 /**
  * Dequeues RTP packets and pass them to decoder. Not cancellation-safe(?).
  * A packet is decoded if it is the next in sequence order, or if we have
@@ -401,7 +503,6 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
     for (unsigned i = 0, max = session->srcc; i < max; i++)
     {
         rtp_source_t *src = session->srcv[i];
-        block_t *block;
 
         /* Because of IP packet delay variation (IPDV), we need to guesstimate
          * how long to wait for a missing packet in the RTP sequence
@@ -419,11 +520,13 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
          * LibVLC E/S-out clock synchronization. Here, we need to bother about
          * re-ordering packets, as decoders can't cope with mis-ordered data.
          */
-        while (((block = src->blocks)) != NULL)
+        while (src->count > 0)
         {
-            if ((int16_t)(rtp_seq (block) - (src->last_seq + 1)) <= 0)
-            {   /* Next (or earlier) block ready, no need to wait */
-                rtp_decode (demux, session, src);
+            block_t *block = *rtp_first (src);
+
+            if (rtp_seq (block) == (uint16_t)(src->last_seq + 1))
+            {   /* Next block ready, no need to wait */
+                rtp_decode (demux, session, src, rtp_pop (src));
                 continue;
             }
 
@@ -449,7 +552,7 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
             deadline += block->i_pts;
             if (now >= deadline)
             {
-                rtp_decode (demux, session, src);
+                rtp_decode (demux, session, src, rtp_pop (src));
                 continue;
             }
             if (*deadlinep > deadline)
@@ -470,10 +573,9 @@ void rtp_dequeue_force (demux_t *demux, const rtp_session_t *session)
     for (unsigned i = 0, max = session->srcc; i < max; i++)
     {
         rtp_source_t *src = session->srcv[i];
-        block_t *block;
 
-        while (((block = src->blocks)) != NULL)
-            rtp_decode (demux, session, src);
+        while (src->count > 0)
+            rtp_decode (demux, session, src, rtp_pop (src));
     }
 }
 
@@ -481,14 +583,9 @@ void rtp_dequeue_force (demux_t *demux, const rtp_session_t *session)
  * Decodes one RTP packet.
  */
 static void
-rtp_decode (demux_t *demux, const rtp_session_t *session, rtp_source_t *src)
+rtp_decode (demux_t *demux, const rtp_session_t *session, rtp_source_t *src,
+            block_t *block)
 {
-    block_t *block = src->blocks;
-
-    assert (block);
-    src->blocks = block->p_next;
-    block->p_next = NULL;
-
     /* Discontinuity detection */
     uint16_t delta_seq = rtp_seq (block) - (src->last_seq + 1);
     if (delta_seq != 0)
@@ -26,19 +26,64 @@
 #include "srtp.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <errno.h>
 
 #undef NDEBUG
 #include <assert.h>
 
+static const char key[] =
+    "123456789ABCDEF0" "123456789ABCDEF0";
+static const char salt[] =
+    "1234567890" "1234567890" "12345678";
 
-int main (void)
+/**
+ * Measures the number of packets of a given size sent then received per
+ * second (of processor time).
+ */
+static void bench (unsigned long count, size_t size)
+{
+    srtp_session_t *se, *sd;
+    uint8_t buf[1500];
+
+    assert (size >= 12 && size + 20 <= sizeof (buf));
+    se = srtp_create (SRTP_ENCR_AES_CM, SRTP_AUTH_HMAC_SHA1, 10,
+                      SRTP_PRF_AES_CM, 0);
+    sd = srtp_create (SRTP_ENCR_AES_CM, SRTP_AUTH_HMAC_SHA1, 10,
+                      SRTP_PRF_AES_CM, 0);
+    assert (se != NULL && sd != NULL);
+    if (srtp_setkeystring (se, key, salt) || srtp_setkeystring (sd, key, salt))
+        abort ();
+
+    memset (buf, 0, sizeof (buf));
+    buf[0] = 0x80;
+
+    clock_t t = clock ();
+    for (unsigned long i = 0; i < count; i++)
+    {
+        size_t len = size;
+        int val;
+
+        buf[2] = (i + 1) >> 8;
+        buf[3] = i + 1;
+        val = srtp_send (se, buf, &len, sizeof (buf));
+        assert (val == 0);
+        val = srtp_recv (sd, buf, &len);
+        assert (val == 0);
+        assert (len == size);
+    }
+    t = clock () - t;
+
+    printf ("%zu bytes: %.0f packets/s\n", size,
+            (double)count * CLOCKS_PER_SEC / (t ? t : 1));
+    srtp_destroy (se);
+    srtp_destroy (sd);
+}
+
+int main (int argc, char *argv[])
 {
-    static const char key[] =
-        "123456789ABCDEF0" "123456789ABCDEF0";
-    static const char salt[] =
-        "1234567890" "1234567890" "12345678";
     int val;
     srtp_session_t *sd, *se;
 
@@ -168,5 +213,14 @@ int main (void)
 
     srtp_destroy (se);
     srtp_destroy (sd);
+
+    /* Benchmark, if a number of packets is given */
+    if (argc > 1)
+    {
+        unsigned long count = strtoul (argv[1], NULL, 10);
+
+        bench (count, 200);
+        bench (count, 1328);
+    }
     return 0;
 }
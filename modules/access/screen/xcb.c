@@ -32,6 +32,12 @@
 # include <sys/shm.h>
 # include <xcb/shm.h>
 #endif
+#if defined (HAVE_SYS_SHM_H) && defined (HAVE_XCB_DAMAGE)
+# include <xcb/damage.h>
+# include <xcb/xfixes.h>
+#else
+# undef HAVE_XCB_DAMAGE
+#endif
 #include <vlc_common.h>
 #include <vlc_demux.h>
 #include <vlc_plugin.h>
@@ -60,6 +66,11 @@
 #define FOLLOW_MOUSE_LONGTEXT N_( \
     "Follow the mouse when capturing a subscreen." )
 
+#define DAMAGE_TEXT N_("Capture changed regions only")
+#define DAMAGE_LONGTEXT N_( \
+    "Track the changes with the X Damage extension, and only capture " \
+    "the modified parts of the screen into a shared memory frame.")
+
 static int  Open (vlc_object_t *);
 static void Close (vlc_object_t *);
 
@@ -89,6 +100,7 @@ vlc_module_begin ()
         change_safe ()
     add_bool ("screen-follow-mouse", false, FOLLOW_MOUSE_TEXT,
               FOLLOW_MOUSE_LONGTEXT, true)
+    add_bool ("screen-damage", true, DAMAGE_TEXT, DAMAGE_LONGTEXT, true)
 
     add_shortcut ("screen", "window")
 vlc_module_end ()
@@ -116,6 +128,16 @@ struct demux_sys_t
     bool              shm; /**< Whether to use MIT-SHM */
     bool              follow_mouse;
     uint16_t          cur_w, cur_h; /**< Actual capture pixel dimensions */
+#ifdef HAVE_XCB_DAMAGE
+    bool              damaged; /**< Whether to use X Damage */
+    bool              frame_ok; /**< Whether the frame content is current */
+    xcb_damage_damage_t damage; /**< Damage object XID */
+    xcb_xfixes_region_t region; /**< Damaged region XID */
+    xcb_shm_seg_t     frame_segment; /**< Persistent SHM segment XID */
+    uint8_t          *frame; /**< Persistent frame (and scratch space) */
+    size_t            frame_size; /**< Frame size in bytes */
+    int16_t           frame_x, frame_y; /**< Frame top-left coordinates */
+#endif
     /* Timer does not use this, only input thread: */
     vlc_timer_t       timer;
 };
@@ -136,6 +158,243 @@ static bool CheckSHM (xcb_connection_t *conn)
 #endif
 }
 
+#ifdef HAVE_XCB_DAMAGE
+/** Maximum number of damaged rectangles fetched separately */
+#define DAMAGE_MAX_RECTS 16
+
+/** Checks X Damage and XFixes extensions support */
+static bool CheckDamage (xcb_connection_t *conn)
+{
+    xcb_damage_query_version_cookie_t dc;
+    xcb_xfixes_query_version_cookie_t fc;
+    xcb_damage_query_version_reply_t *dr;
+    xcb_xfixes_query_version_reply_t *fr;
+
+    dc = xcb_damage_query_version (conn, 1, 1);
+    fc = xcb_xfixes_query_version (conn, 2, 0);
+    dr = xcb_damage_query_version_reply (conn, dc, NULL);
+    fr = xcb_xfixes_query_version_reply (conn, fc, NULL);
+
+    bool ok = dr != NULL && fr != NULL && fr->major_version >= 2;
+    free (fr);
+    free (dr);
+    return ok;
+}
+
+static void FrameRelease (demux_t *demux)
+{
+    demux_sys_t *sys = demux->p_sys;
+
+    if (sys->frame == NULL)
+        return;
+    xcb_shm_detach (sys->conn, sys->frame_segment);
+    shmdt (sys->frame);
+    sys->frame = NULL;
+}
+
+/**
+ * Allocates the persistent frame, followed by as much scratch space for the
+ * partial updates, and attaches it to both X and VLC.
+ */
+static int FrameAlloc (demux_t *demux, size_t size)
+{
+    demux_sys_t *sys = demux->p_sys;
+
+    int id = shmget (IPC_PRIVATE, 2 * size, IPC_CREAT | 0700);
+    if (id == -1)
+    {
+        msg_Err (demux, "shared memory allocation error: %s",
+                 vlc_strerror_c(errno));
+        return -1;
+    }
+
+    void *shm = shmat (id, NULL, 0 /* read/write */);
+    if (-1 == (intptr_t)shm)
+    {
+        msg_Err (demux, "shared memory attachment error: %s",
+                 vlc_strerror_c(errno));
+        shmctl (id, IPC_RMID, 0);
+        return -1;
+    }
+
+    xcb_void_cookie_t ck = xcb_shm_attach_checked (sys->conn,
+                                                   sys->frame_segment, id,
+                                                   0 /* read/write */);
+    xcb_generic_error_t *err = xcb_request_check (sys->conn, ck);
+    shmctl (id, IPC_RMID, 0); /* destroyed when both sides detach */
+    if (err != NULL)
+    {
+        msg_Err (demux, "shared memory X11 error %d", err->error_code);
+        free (err);
+        shmdt (shm);
+        return -1;
+    }
+
+    sys->frame = shm;
+    sys->frame_size = size;
+    sys->frame_ok = false;
+    return 0;
+}
+
+/**
+ * Captures the screen into the persistent frame, only fetching the regions
+ * damaged since the previous capture, and copies the frame into a block.
+ * \return a block, or NULL to fall back to full captures
+ */
+static block_t *DamageCapture (demux_t *demux, xcb_drawable_t drawable,
+                               int x, int y, unsigned w, unsigned h)
+{
+    demux_sys_t *sys = demux->p_sys;
+    xcb_connection_t *conn = sys->conn;
+    const size_t pitch = w * sys->bpp;
+    const size_t size = pitch * h;
+
+    /* The damage is read below, the notifications are not needed. */
+    xcb_generic_event_t *ev;
+    while ((ev = xcb_poll_for_event (conn)) != NULL)
+        free (ev);
+
+    if (sys->frame == NULL || sys->frame_size != size)
+    {
+        FrameRelease (demux);
+        if (FrameAlloc (demux, size))
+        {
+            sys->damaged = false;
+            return NULL;
+        }
+    }
+    if (x != sys->frame_x || y != sys->frame_y)
+        sys->frame_ok = false;
+
+    /* Fetch and reset the damage accumulated since the last capture */
+    xcb_xfixes_fetch_region_reply_t *reg = NULL;
+    xcb_rectangle_t full = { x, y, w, h };
+    const xcb_rectangle_t *rects = &full;
+    int n = 1;
+
+    xcb_damage_subtract (conn, sys->damage, XCB_NONE, sys->region);
+    if (sys->frame_ok)
+    {
+        reg = xcb_xfixes_fetch_region_reply (conn,
+                  xcb_xfixes_fetch_region (conn, sys->region), NULL);
+        if (reg == NULL)
+            sys->frame_ok = false;
+        else
+        {
+            rects = xcb_xfixes_fetch_region_rectangles (reg);
+            n = xcb_xfixes_fetch_region_rectangles_length (reg);
+            if (n > DAMAGE_MAX_RECTS)
+            {   /* Too fragmented: fetch the bounding box instead */
+                rects = &reg->extents;
+                n = 1;
+            }
+        }
+    }
+
+    /* Request all the (clipped) damaged rectangles at once */
+    xcb_shm_get_image_cookie_t ck[DAMAGE_MAX_RECTS];
+    xcb_rectangle_t clip[DAMAGE_MAX_RECTS];
+    uint32_t offset[DAMAGE_MAX_RECTS];
+    uint32_t used = 0;
+    int count = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        int left = __MAX(rects[i].x, x);
+        int top = __MAX(rects[i].y, y);
+        int right = __MIN(rects[i].x + rects[i].width, x + (int)w);
+        int bottom = __MIN(rects[i].y + rects[i].height, y + (int)h);
+
+        if (left >= right || top >= bottom)
+            continue; /* outside of the capture region */
+
+        clip[count].x = left;
+        clip[count].y = top;
+        clip[count].width = right - left;
+        clip[count].height = bottom - top;
+
+        if (!sys->frame_ok)
+            offset[count] = 0; /* the full frame is fetched in place */
+        else
+        {   /* Z pixmap scan lines are padded to at most 32 bits */
+            uint32_t len = ((clip[count].width * sys->bpp + 3) & ~3)
+                         * clip[count].height;
+            if (used + len > size)
+            {   /* Out of scratch space: fetch the full frame instead */
+                for (int j = 0; j < count; j++)
+                    xcb_discard_reply (conn, ck[j].sequence);
+                free (reg);
+                sys->frame_ok = false;
+                clip[0] = full;
+                offset[0] = 0;
+                ck[0] = xcb_shm_get_image (conn, drawable, x, y, w, h, ~0,
+                                           XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                           sys->frame_segment, 0);
+                count = 1;
+                reg = NULL;
+                break;
+            }
+            offset[count] = size + used;
+            used += len;
+        }
+
+        ck[count] = xcb_shm_get_image (conn, drawable, clip[count].x,
+                                       clip[count].y, clip[count].width,
+                                       clip[count].height, ~0,
+                                       XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                       sys->frame_segment, offset[count]);
+        count++;
+    }
+    free (reg);
+
+    /* Copy the damaged rectangles into the frame */
+    bool ok = true;
+
+    for (int i = 0; i < count; i++)
+    {
+        xcb_shm_get_image_reply_t *img =
+            xcb_shm_get_image_reply (conn, ck[i], NULL);
+        if (img == NULL)
+        {
+            ok = false;
+            continue;
+        }
+
+        if (offset[i] != 0)
+        {
+            const uint8_t *src = sys->frame + offset[i];
+            uint8_t *dst = sys->frame + (clip[i].y - y) * pitch
+                         + (clip[i].x - x) * sys->bpp;
+            size_t src_pitch = img->size / clip[i].height;
+            size_t len = clip[i].width * sys->bpp;
+
+            for (unsigned j = 0; j < clip[i].height; j++)
+            {
+                memcpy (dst, src, len);
+                src += src_pitch;
+                dst += pitch;
+            }
+        }
+        free (img);
+    }
+
+    if (!ok)
+    {   /* Start over from a full capture on the next frame */
+        sys->frame_ok = false;
+        return NULL;
+    }
+
+    sys->frame_ok = true;
+    sys->frame_x = x;
+    sys->frame_y = y;
+
+    block_t *block = block_Alloc (size);
+    if (likely(block != NULL))
+        memcpy (block->p_buffer, sys->frame, size);
+    return block;
+}
+#endif
+
 /**
  * Probes and initializes.
  */
@@ -218,6 +477,21 @@ static int Open (vlc_object_t *obj)
     p_sys->pixmap = xcb_generate_id (conn);
     p_sys->segment = xcb_generate_id (conn);
     p_sys->shm = CheckSHM (conn);
+#ifdef HAVE_XCB_DAMAGE
+    p_sys->frame = NULL;
+    p_sys->damaged = p_sys->shm && var_InheritBool (obj, "screen-damage")
+                  && CheckDamage (conn);
+    if (p_sys->damaged)
+    {
+        p_sys->damage = xcb_generate_id (conn);
+        p_sys->region = xcb_generate_id (conn);
+        p_sys->frame_segment = xcb_generate_id (conn);
+        xcb_damage_create (conn, p_sys->damage, p_sys->window,
+                           XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+        xcb_xfixes_create_region (conn, p_sys->region, 0, NULL);
+        msg_Dbg (obj, "using Damage extension");
+    }
+#endif
     p_sys->w = var_InheritInteger (obj, "screen-width");
     p_sys->h = var_InheritInteger (obj, "screen-height");
     if (p_sys->w != 0 || p_sys->h != 0)
@@ -268,6 +542,9 @@ static void Close (vlc_object_t *obj)
     demux_sys_t *p_sys = demux->p_sys;
 
     vlc_timer_destroy (p_sys->timer);
+#ifdef HAVE_XCB_DAMAGE
+    FrameRelease (demux);
+#endif
     xcb_disconnect (p_sys->conn);
     free (p_sys);
 }
@@ -432,8 +709,12 @@ discard:
     free (geo);
 
     block_t *block = NULL;
+#ifdef HAVE_XCB_DAMAGE
+    if (sys->damaged && sys->es != NULL)
+        block = DamageCapture (demux, drawable, x, y, w, h);
+#endif
 #if HAVE_SYS_SHM_H
-    if (sys->shm)
+    if (sys->shm && block == NULL)
     {   /* Capture screen through shared memory */
         size_t size = w * h * sys->bpp;
         int id = shmget (IPC_PRIVATE, size, IPC_CREAT | 0777);
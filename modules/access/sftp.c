@@ -43,6 +43,8 @@
 #include <libssh2.h>
 #include <libssh2_sftp.h>
 
+#include "readahead.h"
+
 
 /*****************************************************************************
  * Module descriptor
@@ -90,6 +92,7 @@ struct access_sys_t
     LIBSSH2_SFTP* sftp_session;
     LIBSSH2_SFTP_HANDLE* file;
     uint64_t filesize;
+    readahead_t readahead;
 
     /* browser */
     char* psz_username_opt;
@@ -125,6 +128,8 @@ static int Open( vlc_object_t* p_this )
     if( !p_sys ) return VLC_ENOMEM;
 
     p_sys->i_socket = -1;
+    /* libssh2 keeps one SFTP read request in flight per 30000 bytes */
+    ReadAheadInit( &p_sys->readahead, 64 * 1024, 4 * 1024 * 1024 );
 
     /* Parse the URL */
     vlc_UrlParse( &url, p_access->psz_location );
@@ -351,14 +356,21 @@ static void Close( vlc_object_t* p_this )
 }
 
 
+static ssize_t RemoteRead( void *opaque, uint8_t *buf, size_t len )
+{
+    access_sys_t *p_sys = opaque;
+
+    return libssh2_sftp_read( p_sys->file, (char *)buf, len );
+}
+
 static ssize_t Read( access_t *p_access, uint8_t *buf, size_t len )
 {
     access_sys_t *p_sys = p_access->p_sys;
 
     if( p_access->info.b_eof )
-        return NULL;
+        return 0;
 
-    ssize_t val = libssh2_sftp_read(  p_sys->file, (char *)buf, len );
+    ssize_t val = ReadAhead( &p_sys->readahead, buf, len, RemoteRead, p_sys );
     if( val < 0 )
     {
         p_access->info.b_eof = true;
@@ -375,7 +387,7 @@ static ssize_t Read( access_t *p_access, uint8_t *buf, size_t len )
 static int Seek( access_t* p_access, uint64_t i_pos )
 {
     p_access->info.b_eof = false;
-
+    ReadAheadFlush( &p_access->p_sys->readahead );
     libssh2_sftp_seek( p_access->p_sys->file, i_pos );
     return VLC_SUCCESS;
 }
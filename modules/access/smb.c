@@ -48,6 +48,8 @@
 #include <vlc_access.h>
 #include <vlc_input_item.h>
 
+#include "readahead.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -97,6 +99,7 @@ struct access_sys_t
 {
     int i_smb;
     uint64_t size;
+    readahead_t readahead;
 };
 
 #ifdef _WIN32
@@ -277,6 +280,7 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->size = i_size;
     p_sys->i_smb = i_smb;
+    ReadAheadInit( &p_sys->readahead, 64 * 1024, 4 * 1024 * 1024 );
 
     return VLC_SUCCESS;
 }
@@ -295,6 +299,9 @@ static void Close( vlc_object_t *p_this )
     else
 #endif
         smbc_close( p_sys->i_smb );
+
+    ReadAheadClean( &p_sys->readahead );
+    free( p_sys );
 }
 
 /*****************************************************************************
@@ -317,6 +324,7 @@ static int Seek( access_t *p_access, uint64_t i_pos )
         return VLC_EGENERIC;
     }
 
+    ReadAheadFlush( &p_sys->readahead );
     p_access->info.b_eof = false;
 
     return VLC_SUCCESS;
@@ -325,14 +333,22 @@ static int Seek( access_t *p_access, uint64_t i_pos )
 /*****************************************************************************
  * Read:
  *****************************************************************************/
+static ssize_t RemoteRead( void *opaque, uint8_t *p_buffer, size_t i_len )
+{
+    access_sys_t *p_sys = opaque;
+
+    /* libsmbclient splits large reads into parallel SMB requests */
+    return smbc_read( p_sys->i_smb, p_buffer, i_len );
+}
+
 static ssize_t Read( access_t *p_access, uint8_t *p_buffer, size_t i_len )
 {
     access_sys_t *p_sys = p_access->p_sys;
-    int i_read;
+    ssize_t i_read;
 
     if( p_access->info.b_eof ) return 0;
 
-    i_read = smbc_read( p_sys->i_smb, p_buffer, i_len );
+    i_read = ReadAhead( &p_sys->readahead, p_buffer, i_len, RemoteRead, p_sys );
     if( i_read < 0 )
     {
         msg_Err( p_access, "read failed (%s)", vlc_strerror_c(errno) );
@@ -43,9 +43,20 @@
 #include <vlc_network.h>
 #include <vlc_block.h>
 #include <vlc_interrupt.h>
+#include <vlc_atomic.h>
+#include <assert.h>
 #include <fcntl.h>
+#ifdef HAVE_RECVMMSG
+# include <sys/socket.h>
+#endif
 
 #define MTU 65535
+/* Smallest receive buffer: 7 TS packets, the usual payload of TS over UDP */
+#define MRU_MIN (7 * 188)
+/* Idle packets kept for recycling */
+#define POOL_MAX 64
+/* Datagrams received per system call */
+#define BATCH_SIZE 16
 
 /*****************************************************************************
  * Module descriptor
@@ -71,13 +82,51 @@ vlc_module_begin ()
     set_callbacks( Open, Close )
 vlc_module_end ()
 
-struct access_sys_t
+/* Socket and receive thread, shared by all the inputs of the process opening
+ * the same addresses (e.g. several VLM outputs of one multicast channel), so
+ * that each group is joined and each datagram received only once. */
+typedef struct udp_receiver_t
 {
+    struct udp_receiver_t *next;
+    char *key;
+    unsigned refs;
+
     int fd;
+    size_t mru; /* size of the pooled blocks */
+    block_pool_t *pool;
+    vlc_thread_t thread;
+
+    vlc_mutex_t lock;
+    access_sys_t **subscribers;
+    size_t subscriber_count;
+} udp_receiver_t;
+
+static vlc_mutex_t receivers_lock = VLC_STATIC_MUTEX;
+static udp_receiver_t *receivers = NULL;
+
+struct access_sys_t
+{
+    udp_receiver_t *receiver;
     size_t fifo_size;
     block_fifo_t *fifo;
     vlc_sem_t semaphore;
-    vlc_thread_t thread;
+};
+
+/* Datagram received for several subscribers: each one gets its own block
+ * header, the payload is shared and released with the last header. */
+typedef struct udp_shared_t udp_shared_t;
+
+struct udp_shared_block
+{
+    block_t self;
+    udp_shared_t *shared;
+};
+
+struct udp_shared_t
+{
+    atomic_uint refs;
+    block_t *pkt;
+    struct udp_shared_block blocks[];
 };
 
 /*****************************************************************************
@@ -87,6 +136,181 @@ static block_t *BlockUDP( access_t * );
 static int Control( access_t *, int, va_list );
 static void* ThreadRead( void *data );
 
+/*****************************************************************************
+ * ReceiverNew: open the socket and start the receive thread
+ *****************************************************************************/
+static udp_receiver_t *ReceiverNew( access_t *p_access, const char *key,
+                                    const char *psz_bind_addr, int i_bind_port,
+                                    const char *psz_server_addr,
+                                    int i_server_port )
+{
+    udp_receiver_t *rcv = malloc( sizeof( *rcv ) );
+    if( unlikely(rcv == NULL) )
+        return NULL;
+
+    rcv->key = strdup( key );
+    rcv->refs = 1;
+    rcv->subscribers = NULL;
+    rcv->subscriber_count = 0;
+    if( unlikely(rcv->key == NULL) )
+        goto error;
+
+    rcv->fd = net_OpenDgram( p_access, psz_bind_addr, i_bind_port,
+                             psz_server_addr, i_server_port, IPPROTO_UDP );
+    if( rcv->fd == -1 )
+    {
+        msg_Err( p_access, "cannot open socket" );
+        goto error;
+    }
+
+    /* Revert to blocking I/O */
+#ifndef _WIN32
+    fcntl(rcv->fd, F_SETFL, fcntl(rcv->fd, F_GETFL) & ~O_NONBLOCK);
+#else
+    ioctlsocket(rcv->fd, FIONBIO, &(unsigned long){ 0 });
+#endif
+
+    /* Most datagrams fit in the configured MTU: do not keep 64 KiB blocks
+     * around for each of them. */
+    int64_t mtu = var_InheritInteger( p_access, "mtu" );
+    rcv->mru = (mtu < MRU_MIN) ? MRU_MIN : (mtu > MTU) ? MTU : mtu;
+    rcv->pool = block_PoolNew( rcv->mru, POOL_MAX );
+    if( unlikely( rcv->pool == NULL ) )
+    {
+        net_Close( rcv->fd );
+        goto error;
+    }
+
+    vlc_mutex_init( &rcv->lock );
+
+    if( vlc_clone( &rcv->thread, ThreadRead, rcv,
+                   VLC_THREAD_PRIORITY_INPUT ) )
+    {
+        vlc_mutex_destroy( &rcv->lock );
+        block_PoolDelete( rcv->pool );
+        net_Close( rcv->fd );
+        goto error;
+    }
+    return rcv;
+
+error:
+    free( rcv->key );
+    free( rcv );
+    return NULL;
+}
+
+static void ReceiverDelete( vlc_object_t *obj, udp_receiver_t *rcv )
+{
+    assert( rcv->subscriber_count == 0 );
+
+    vlc_cancel( rcv->thread );
+    vlc_join( rcv->thread, NULL );
+    vlc_mutex_destroy( &rcv->lock );
+
+    uint64_t hits, misses;
+    block_PoolGetStats( rcv->pool, &hits, &misses );
+    msg_Dbg( obj, "block pool: %"PRIu64" hits, %"PRIu64" misses",
+             hits, misses );
+    block_PoolDelete( rcv->pool );
+
+    net_Close( rcv->fd );
+    free( rcv->subscribers );
+    free( rcv->key );
+    free( rcv );
+}
+
+/*****************************************************************************
+ * Unsubscribe: detach an input, and stop the receiver if it was the last one
+ *****************************************************************************/
+static void Unsubscribe( vlc_object_t *obj, access_sys_t *sys )
+{
+    udp_receiver_t *rcv = sys->receiver;
+
+    vlc_mutex_lock( &receivers_lock );
+    vlc_mutex_lock( &rcv->lock );
+    for( size_t i = 0; i < rcv->subscriber_count; i++ )
+        if( rcv->subscribers[i] == sys )
+        {
+            rcv->subscribers[i] = rcv->subscribers[--rcv->subscriber_count];
+            break;
+        }
+    vlc_mutex_unlock( &rcv->lock );
+
+    if( --rcv->refs > 0 )
+    {
+        vlc_mutex_unlock( &receivers_lock );
+        return;
+    }
+
+    udp_receiver_t **pp = &receivers;
+    while( *pp != rcv )
+        pp = &(*pp)->next;
+    *pp = rcv->next;
+    vlc_mutex_unlock( &receivers_lock );
+
+    ReceiverDelete( obj, rcv );
+}
+
+/*****************************************************************************
+ * Subscribe: attach an input to the receiver of its addresses
+ *****************************************************************************/
+static int Subscribe( access_t *p_access, access_sys_t *sys,
+                      const char *psz_bind_addr, int i_bind_port,
+                      const char *psz_server_addr, int i_server_port )
+{
+    char *key;
+    if( asprintf( &key, "%s:%d@%s:%d", psz_server_addr, i_server_port,
+                  psz_bind_addr, i_bind_port ) == -1 )
+        return VLC_ENOMEM;
+
+    vlc_mutex_lock( &receivers_lock );
+
+    udp_receiver_t *rcv;
+    for( rcv = receivers; rcv != NULL; rcv = rcv->next )
+        if( !strcmp( rcv->key, key ) )
+            break;
+
+    if( rcv != NULL )
+    {
+        msg_Dbg( p_access, "sharing the socket of %s", key );
+        rcv->refs++;
+    }
+    else
+    {
+        rcv = ReceiverNew( p_access, key, psz_bind_addr, i_bind_port,
+                           psz_server_addr, i_server_port );
+        if( rcv == NULL )
+        {
+            vlc_mutex_unlock( &receivers_lock );
+            free( key );
+            return VLC_EGENERIC;
+        }
+        rcv->next = receivers;
+        receivers = rcv;
+    }
+    free( key );
+
+    vlc_mutex_lock( &rcv->lock );
+    access_sys_t **tab = realloc( rcv->subscribers,
+                                  (rcv->subscriber_count + 1) * sizeof (*tab) );
+    if( likely(tab != NULL) )
+    {
+        tab[rcv->subscriber_count++] = sys;
+        rcv->subscribers = tab;
+    }
+    vlc_mutex_unlock( &rcv->lock );
+
+    sys->receiver = rcv;
+    vlc_mutex_unlock( &receivers_lock );
+
+    if( unlikely(tab == NULL) )
+    {
+        Unsubscribe( VLC_OBJECT(p_access), sys );
+        return VLC_ENOMEM;
+    }
+    return VLC_SUCCESS;
+}
+
 /*****************************************************************************
  * Open: open the socket
  *****************************************************************************/
@@ -153,40 +377,25 @@ static int Open( vlc_object_t *p_this )
     msg_Dbg( p_access, "opening server=%s:%d local=%s:%d",
              psz_server_addr, i_server_port, psz_bind_addr, i_bind_port );
 
-    sys->fd = net_OpenDgram( p_access, psz_bind_addr, i_bind_port,
-                             psz_server_addr, i_server_port, IPPROTO_UDP );
-    free( psz_name );
-    if( sys->fd == -1 )
-    {
-        msg_Err( p_access, "cannot open socket" );
-        goto error;
-    }
-
-    /* Revert to blocking I/O */
-#ifndef _WIN32
-    fcntl(sys->fd, F_SETFL, fcntl(sys->fd, F_GETFL) & ~O_NONBLOCK);
-#else
-    ioctlsocket(sys->fd, FIONBIO, &(unsigned long){ 0 });
-#endif
-
-    /* FIXME: There are no particular reasons to create a FIFO and thread here.
-     * Those are just working around bugs in the stream cache. */
     sys->fifo = block_FifoNew();
     if( unlikely( sys->fifo == NULL ) )
     {
-        net_Close( sys->fd );
+        free( psz_name );
         goto error;
     }
 
     sys->fifo_size = var_InheritInteger( p_access, "udp-buffer");
     vlc_sem_init( &sys->semaphore, 0 );
 
-    if( vlc_clone( &sys->thread, ThreadRead, p_access,
-                   VLC_THREAD_PRIORITY_INPUT ) )
+    /* FIXME: There are no particular reasons to create a FIFO and thread here.
+     * Those are just working around bugs in the stream cache. */
+    int val = Subscribe( p_access, sys, psz_bind_addr, i_bind_port,
+                         psz_server_addr, i_server_port );
+    free( psz_name );
+    if( val != VLC_SUCCESS )
     {
         vlc_sem_destroy( &sys->semaphore );
         block_FifoRelease( sys->fifo );
-        net_Close( sys->fd );
 error:
         free( sys );
         return VLC_EGENERIC;
@@ -203,11 +412,9 @@ static void Close( vlc_object_t *p_this )
     access_t     *p_access = (access_t*)p_this;
     access_sys_t *sys = p_access->p_sys;
 
-    vlc_cancel( sys->thread );
-    vlc_join( sys->thread, NULL );
+    Unsubscribe( p_this, sys );
     vlc_sem_destroy( &sys->semaphore );
     block_FifoRelease( sys->fifo );
-    net_Close( sys->fd );
     free( sys );
 }
 
@@ -260,53 +467,246 @@ static block_t *BlockUDP( access_t *p_access )
     return block;
 }
 
+/*****************************************************************************
+ * Enqueue: hand a received packet over to BlockUDP
+ *****************************************************************************/
+static void Enqueue( access_sys_t *sys, block_t *pkt )
+{
+    /* Discard old buffers on overflow */
+    while (vlc_fifo_GetBytes(sys->fifo) + pkt->i_buffer > sys->fifo_size)
+    {
+        int canc = vlc_savecancel();
+        block_Release(vlc_fifo_DequeueUnlocked(sys->fifo));
+        vlc_restorecancel(canc);
+    }
+
+    vlc_fifo_QueueUnlocked(sys->fifo, pkt);
+}
+
+static void SharedRelease( block_t *block )
+{
+    udp_shared_t *shared = ((struct udp_shared_block *)block)->shared;
+
+    if (atomic_fetch_sub(&shared->refs, 1) == 1)
+    {
+        block_Release(shared->pkt);
+        free(shared);
+    }
+}
+
+/*****************************************************************************
+ * Distribute: hand received packets over to all the subscribers
+ *****************************************************************************
+ * With a single subscriber, the packets are queued as is. Otherwise, each
+ * subscriber gets its own block headers on top of the same payloads.
+ *****************************************************************************/
+static void Distribute( udp_receiver_t *rcv, block_t **pkts, unsigned count )
+{
+    udp_shared_t *shared[count];
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock(&rcv->lock);
+    const size_t n = rcv->subscriber_count;
+
+    for (unsigned j = 0; j < count; j++)
+    {
+        shared[j] = NULL;
+        if (n == 0)
+        {
+            block_Release(pkts[j]);
+            pkts[j] = NULL;
+        }
+        if (n <= 1)
+            continue;
+
+        shared[j] = malloc(sizeof (*shared[j])
+                           + n * sizeof (shared[j]->blocks[0]));
+        if (unlikely(shared[j] == NULL))
+        {
+            block_Release(pkts[j]);
+            pkts[j] = NULL;
+            continue;
+        }
+
+        atomic_init(&shared[j]->refs, n);
+        shared[j]->pkt = pkts[j];
+        for (size_t i = 0; i < n; i++)
+        {
+            block_t *block = &shared[j]->blocks[i].self;
+
+            block_Init(block, pkts[j]->p_buffer, pkts[j]->i_buffer);
+            block->pf_release = SharedRelease;
+            shared[j]->blocks[i].shared = shared[j];
+        }
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        access_sys_t *sys = rcv->subscribers[i];
+        unsigned queued = 0;
+
+        vlc_fifo_Lock(sys->fifo);
+        for (unsigned j = 0; j < count; j++)
+        {
+            if (pkts[j] == NULL)
+                continue;
+            Enqueue(sys, (n > 1) ? &shared[j]->blocks[i].self : pkts[j]);
+            queued++;
+        }
+        vlc_fifo_Unlock(sys->fifo);
+
+        while (queued-- > 0)
+            vlc_sem_post(&sys->semaphore);
+    }
+    vlc_mutex_unlock(&rcv->lock);
+    vlc_restorecancel(canc);
+}
+
+/*****************************************************************************
+ * Claim: get the block of a received datagram
+ *****************************************************************************
+ * Datagrams are received in full size buffers, so that none is truncated.
+ * Those of up to the MTU are copied to a pooled block, and the buffer is
+ * reused. A larger datagram takes the buffer.
+ *****************************************************************************/
+static block_t *Claim( udp_receiver_t *rcv, block_t **pbuf, size_t len )
+{
+    block_t *buf = *pbuf;
+
+    if (len <= rcv->mru)
+    {
+        block_t *pkt = block_PoolAlloc(rcv->pool, len);
+        if (likely(pkt != NULL))
+        {
+            memcpy(pkt->p_buffer, buf->p_buffer, len);
+            return pkt;
+        }
+    }
+
+    *pbuf = NULL;
+    buf->i_buffer = len;
+    return buf;
+}
+
+#ifdef HAVE_RECVMMSG
+static void ReleaseBatch( void *data )
+{
+    block_t **bufs = data;
+
+    for (unsigned i = 0; i < BATCH_SIZE; i++)
+        if (bufs[i] != NULL)
+            block_Release(bufs[i]);
+}
+
 /*****************************************************************************
  * ThreadRead: Pull packets from socket as soon as possible.
+ *****************************************************************************
+ * Up to BATCH_SIZE datagrams are read per system call.
  *****************************************************************************/
 static void* ThreadRead( void *data )
 {
-    access_t *access = data;
-    access_sys_t *sys = access->p_sys;
+    udp_receiver_t *rcv = data;
+    block_t *bufs[BATCH_SIZE] = { NULL };
+    block_t *pkts[BATCH_SIZE];
+    struct mmsghdr msgs[BATCH_SIZE];
+    struct iovec iovs[BATCH_SIZE];
 
+    vlc_cleanup_push(ReleaseBatch, bufs);
     for(;;)
     {
-        block_t *pkt = block_Alloc(MTU);
-        if (unlikely(pkt == NULL))
+        unsigned n;
+
+        for (n = 0; n < BATCH_SIZE; n++)
+        {
+            if (bufs[n] == NULL)
+            {
+                bufs[n] = block_Alloc(MTU);
+                if (unlikely(bufs[n] == NULL))
+                    break;
+            }
+
+            iovs[n].iov_base = bufs[n]->p_buffer;
+            iovs[n].iov_len = MTU;
+            memset(&msgs[n].msg_hdr, 0, sizeof (msgs[n].msg_hdr));
+            msgs[n].msg_hdr.msg_iov = &iovs[n];
+            msgs[n].msg_hdr.msg_iovlen = 1;
+        }
+
+        if (unlikely(n == 0))
         {   /* OOM - dequeue and discard one packet */
             char dummy;
-            recv(sys->fd, &dummy, 1, 0);
+            recv(rcv->fd, &dummy, 1, 0);
             continue;
         }
 
-        ssize_t len;
+        int count;
 
-        block_cleanup_push(pkt);
         do
         {
 #ifndef LIBVLC_USE_PTHREAD
-            struct pollfd ufd = { .fd = sys->fd, .events = POLLIN };
+            struct pollfd ufd = { .fd = rcv->fd, .events = POLLIN };
             while (poll(&ufd, 1, -1) <= 0); /* cancellation point */
 #endif
-            len = recv(sys->fd, pkt->p_buffer, MTU, 0);
+            /* Block for the first datagram only */
+            count = recvmmsg(rcv->fd, msgs, n, MSG_WAITFORONE, NULL);
+            if (count == -1 && errno == ENOSYS)
+            {   /* Linux < 2.6.33 */
+                ssize_t len = recv(rcv->fd, bufs[0]->p_buffer, MTU, 0);
+                if (len >= 0)
+                {
+                    msgs[0].msg_len = len;
+                    count = 1;
+                }
+            }
         }
-        while (len == -1);
-        vlc_cleanup_pop();
+        while (count == -1);
 
-        pkt->i_buffer = len;
+        for (int i = 0; i < count; i++)
+            pkts[i] = Claim(rcv, &bufs[i], msgs[i].msg_len);
+        Distribute(rcv, pkts, count);
+    }
+    vlc_cleanup_pop();
 
-        vlc_fifo_Lock(sys->fifo);
-        /* Discard old buffers on overflow */
-        while (vlc_fifo_GetBytes(sys->fifo) + len > sys->fifo_size)
+    return NULL;
+}
+#else
+/*****************************************************************************
+ * ThreadRead: Pull packets from socket as soon as possible.
+ *****************************************************************************/
+static void* ThreadRead( void *data )
+{
+    udp_receiver_t *rcv = data;
+    block_t *buf = NULL;
+
+    for(;;)
+    {
+        if (buf == NULL)
+            buf = block_Alloc(MTU);
+        if (unlikely(buf == NULL))
+        {   /* OOM - dequeue and discard one packet */
+            char dummy;
+            recv(rcv->fd, &dummy, 1, 0);
+            continue;
+        }
+
+        ssize_t len;
+
+        block_cleanup_push(buf);
+        do
         {
-            int canc = vlc_savecancel();
-            block_Release(vlc_fifo_DequeueUnlocked(sys->fifo));
-            vlc_restorecancel(canc);
+#ifndef LIBVLC_USE_PTHREAD
+            struct pollfd ufd = { .fd = rcv->fd, .events = POLLIN };
+            while (poll(&ufd, 1, -1) <= 0); /* cancellation point */
+#endif
+            len = recv(rcv->fd, buf->p_buffer, MTU, 0);
         }
+        while (len == -1);
+        vlc_cleanup_pop();
 
-        vlc_fifo_QueueUnlocked(sys->fifo, pkt);
-        vlc_fifo_Unlock(sys->fifo);
-        vlc_sem_post(&sys->semaphore);
+        block_t *pkt = Claim(rcv, &buf, len);
+        Distribute(rcv, &pkt, 1);
     }
 
     return NULL;
 }
+#endif
@@ -46,7 +46,7 @@ struct access_sys_t
         uint32_t bufc;
         uint32_t blocksize;
     };
-    struct buffer_t *bufv;
+    struct buffer_pool_t *pool;
     vlc_v4l2_ctrl_t *controls;
 };
 
@@ -163,16 +163,16 @@ int InitVideo (access_t *access, int fd, uint32_t caps)
     /* Init I/O method */
     if (caps & V4L2_CAP_STREAMING)
     {
-        sys->bufc = 4;
-        sys->bufv = StartMmap (VLC_OBJECT(access), fd, &sys->bufc);
-        if (sys->bufv == NULL)
+        sys->bufc = var_InheritInteger (access, CFG_PREFIX"buffers");
+        sys->pool = StartMmap (VLC_OBJECT(access), fd, &sys->bufc);
+        if (sys->pool == NULL)
             return -1;
         access->pf_block = MMapBlock;
     }
     else if (caps & V4L2_CAP_READWRITE)
     {
         sys->blocksize = fmt.fmt.pix.sizeimage;
-        sys->bufv = NULL;
+        sys->pool = NULL;
         access->pf_block = ReadBlock;
     }
     else
@@ -189,8 +189,8 @@ void AccessClose( vlc_object_t *obj )
     access_t *access = (access_t *)obj;
     access_sys_t *sys = access->p_sys;
 
-    if (sys->bufv != NULL)
-        StopMmap (sys->fd, sys->bufv, sys->bufc);
+    if (sys->pool != NULL)
+        StopMmap (sys->pool);
     ControlsDeinit( obj, sys->controls );
     v4l2_close (sys->fd);
     free( sys );
@@ -216,7 +216,7 @@ static block_t *MMapBlock (access_t *access)
     if (AccessPoll (access))
         return NULL;
 
-    block_t *block = GrabVideo (VLC_OBJECT(access), sys->fd, sys->bufv);
+    block_t *block = GrabVideo (VLC_OBJECT(access), sys->pool);
     if( block != NULL )
     {
         block->i_pts = block->i_dts = mdate();
@@ -47,7 +47,7 @@ struct demux_sys_t
     int fd;
     vlc_thread_t thread;
 
-    struct buffer_t *bufv;
+    struct buffer_pool_t *pool;
     union
     {
         uint32_t bufc;
@@ -426,16 +426,16 @@ static int InitVideo (demux_t *demux, int fd, uint32_t caps)
             const long pagemask = sysconf (_SC_PAGE_SIZE) - 1;
 
             sys->blocksize = (fmt.fmt.pix.sizeimage + pagemask) & ~pagemask;
-            sys->bufv = NULL;
+            sys->pool = NULL;
             entry = UserPtrThread;
             msg_Dbg (demux, "streaming with %"PRIu32"-bytes user buffers",
                      sys->blocksize);
         }
         else /* fall back to memory map */
         {
-            sys->bufc = 4;
-            sys->bufv = StartMmap (VLC_OBJECT(demux), fd, &sys->bufc);
-            if (sys->bufv == NULL)
+            sys->bufc = var_InheritInteger (demux, CFG_PREFIX"buffers");
+            sys->pool = StartMmap (VLC_OBJECT(demux), fd, &sys->bufc);
+            if (sys->pool == NULL)
                 return -1;
             entry = MmapThread;
             msg_Dbg (demux, "streaming with %"PRIu32" memory-mapped buffers",
@@ -445,7 +445,7 @@ static int InitVideo (demux_t *demux, int fd, uint32_t caps)
     else if (caps & V4L2_CAP_READWRITE)
     {
         sys->blocksize = fmt.fmt.pix.sizeimage;
-        sys->bufv = NULL;
+        sys->pool = NULL;
         entry = ReadThread;
         msg_Dbg (demux, "reading %"PRIu32" bytes at a time", sys->blocksize);
     }
@@ -471,8 +471,8 @@ static int InitVideo (demux_t *demux, int fd, uint32_t caps)
         if (sys->vbi != NULL)
             CloseVBI (sys->vbi);
 #endif
-        if (sys->bufv != NULL)
-            StopMmap (sys->fd, sys->bufv, sys->bufc);
+        if (sys->pool != NULL)
+            StopMmap (sys->pool);
         return -1;
     }
     return 0;
@@ -485,8 +485,8 @@ void DemuxClose( vlc_object_t *obj )
 
     vlc_cancel (sys->thread);
     vlc_join (sys->thread, NULL);
-    if (sys->bufv != NULL)
-        StopMmap (sys->fd, sys->bufv, sys->bufc);
+    if (sys->pool != NULL)
+        StopMmap (sys->pool);
     ControlsDeinit( obj, sys->controls );
     v4l2_close (sys->fd);
 
@@ -618,7 +618,7 @@ static void *MmapThread (void *data)
         if( ufd[0].revents )
         {
             int canc = vlc_savecancel ();
-            block_t *block = GrabVideo (VLC_OBJECT(demux), fd, sys->bufv);
+            block_t *block = GrabVideo (VLC_OBJECT(demux), sys->pool);
             if (block != NULL)
             {
                 block->i_flags |= sys->block_flags;
@@ -38,6 +38,9 @@ struct buffer_t
     size_t  length;
 };
 
+/* Memory-mapped buffers, shared with the blocks in flight */
+struct buffer_pool_t;
+
 /* v4l2.c */
 void ParseMRL(vlc_object_t *, const char *);
 int OpenDevice (vlc_object_t *, const char *, uint32_t *);
@@ -52,11 +55,11 @@ int SetupFormat (vlc_object_t *, int, uint32_t,
 int SetupTuner (vlc_object_t *, int fd, uint32_t);
 
 int StartUserPtr (vlc_object_t *, int);
-struct buffer_t *StartMmap (vlc_object_t *, int, uint32_t *);
-void StopMmap (int, struct buffer_t *, uint32_t);
+struct buffer_pool_t *StartMmap (vlc_object_t *, int, uint32_t *);
+void StopMmap (struct buffer_pool_t *);
 
 mtime_t GetBufferPTS (const struct v4l2_buffer *);
-block_t* GrabVideo (vlc_object_t *, int, const struct buffer_t *);
+block_t* GrabVideo (vlc_object_t *, struct buffer_pool_t *);
 
 #ifdef ZVBI_COMPILED
 /* vbi.c */
@@ -579,11 +579,65 @@ mtime_t GetBufferPTS (const struct v4l2_buffer *buf)
     return pts;
 }
 
+struct buffer_pool_t
+{
+    int fd;
+    vlc_mutex_t lock;
+    unsigned refs; /* The owner and the blocks in flight */
+    uint32_t queued; /* Buffers owned by the driver */
+    bool streaming;
+    uint32_t count;
+    struct buffer_t bufv[];
+};
+
+/* Buffers left to the driver below which frames are copied */
+#define MIN_QUEUED_BUFFERS 2
+
+static void ReleasePool (struct buffer_pool_t *pool)
+{
+    vlc_mutex_lock (&pool->lock);
+    unsigned refs = --pool->refs;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (refs > 0)
+        return;
+
+    for (uint32_t i = 0; i < pool->count; i++)
+        v4l2_munmap (pool->bufv[i].start, pool->bufv[i].length);
+    vlc_mutex_destroy (&pool->lock);
+    free (pool);
+}
+
+/* Block wrapping a dequeued buffer, queued back on release */
+typedef struct
+{
+    block_t self;
+    struct buffer_pool_t *pool;
+    struct v4l2_buffer buf;
+} buffer_block_t;
+
+static void ReleaseBufferBlock (block_t *block)
+{
+    buffer_block_t *bb = (buffer_block_t *)block;
+    struct buffer_pool_t *pool = bb->pool;
+
+    vlc_mutex_lock (&pool->lock);
+    /* STREAMOFF took the buffers back already */
+    if (pool->streaming)
+    {
+        if (v4l2_ioctl (pool->fd, VIDIOC_QBUF, &bb->buf) == 0)
+            pool->queued++;
+    }
+    vlc_mutex_unlock (&pool->lock);
+
+    free (bb);
+    ReleasePool (pool);
+}
+
 /*****************************************************************************
  * GrabVideo: Grab a video frame
  *****************************************************************************/
-block_t *GrabVideo (vlc_object_t *demux, int fd,
-                    const struct buffer_t *restrict bufv)
+block_t *GrabVideo (vlc_object_t *demux, struct buffer_pool_t *pool)
 {
     struct v4l2_buffer buf = {
         .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
@@ -591,7 +645,7 @@ block_t *GrabVideo (vlc_object_t *demux, int fd,
     };
 
     /* Wait for next frame */
-    if (v4l2_ioctl (fd, VIDIOC_DQBUF, &buf) < 0)
+    if (v4l2_ioctl (pool->fd, VIDIOC_DQBUF, &buf) < 0)
     {
         switch (errno)
         {
@@ -606,20 +660,55 @@ block_t *GrabVideo (vlc_object_t *demux, int fd,
         }
     }
 
-    /* Copy frame */
-    block_t *block = block_Alloc (buf.bytesused);
-    if (unlikely(block == NULL))
-        return NULL;
-    block->i_pts = block->i_dts = GetBufferPTS (&buf);
-    memcpy (block->p_buffer, bufv[buf.index].start, buf.bytesused);
+    const struct buffer_t *buffer = &pool->bufv[buf.index];
+    block_t *block;
 
-    /* Unlock */
-    if (v4l2_ioctl (fd, VIDIOC_QBUF, &buf) < 0)
-    {
-        msg_Err (demux, "queue error: %s", vlc_strerror_c(errno));
-        block_Release (block);
-        return NULL;
+    vlc_mutex_lock (&pool->lock);
+    pool->queued--;
+    if (pool->queued >= MIN_QUEUED_BUFFERS)
+    {   /* Pass the buffer on, it is queued back when released */
+        buffer_block_t *bb = malloc (sizeof (*bb));
+        if (likely(bb != NULL))
+        {
+            block_Init (&bb->self, buffer->start, buffer->length);
+            bb->self.i_buffer = buf.bytesused;
+            bb->self.pf_release = ReleaseBufferBlock;
+            bb->pool = pool;
+            bb->buf = buf;
+            pool->refs++;
+        }
+        vlc_mutex_unlock (&pool->lock);
+
+        if (unlikely(bb == NULL))
+            goto copy;
+        block = &bb->self;
+    }
+    else
+    {   /* Copy the frame not to starve the driver */
+        vlc_mutex_unlock (&pool->lock);
+copy:
+        block = block_Alloc (buf.bytesused);
+        if (likely(block != NULL))
+            memcpy (block->p_buffer, buffer->start, buf.bytesused);
+
+        /* Unlock */
+        vlc_mutex_lock (&pool->lock);
+        if (v4l2_ioctl (pool->fd, VIDIOC_QBUF, &buf) < 0)
+        {
+            vlc_mutex_unlock (&pool->lock);
+            msg_Err (demux, "queue error: %s", vlc_strerror_c(errno));
+            if (block != NULL)
+                block_Release (block);
+            return NULL;
+        }
+        pool->queued++;
+        vlc_mutex_unlock (&pool->lock);
+
+        if (unlikely(block == NULL))
+            return NULL;
     }
+
+    block->i_pts = block->i_dts = GetBufferPTS (&buf);
     return block;
 }
 
@@ -651,9 +740,10 @@ int StartUserPtr (vlc_object_t *obj, int fd)
 /**
  * Allocates memory-mapped buffers, queues them and start streaming.
  * @param n requested buffers count [IN], allocated buffers count [OUT]
- * @return array of allocated buffers (use free()), or NULL on error.
+ * @return the buffers pool (use StopMmap()), or NULL on error.
  */
-struct buffer_t *StartMmap (vlc_object_t *obj, int fd, uint32_t *restrict n)
+struct buffer_pool_t *StartMmap (vlc_object_t *obj, int fd,
+                                 uint32_t *restrict n)
 {
     struct v4l2_requestbuffers req = {
         .count = *n,
@@ -673,44 +763,53 @@ struct buffer_t *StartMmap (vlc_object_t *obj, int fd, uint32_t *restrict n)
         return NULL;
     }
 
-    struct buffer_t *bufv = malloc (req.count * sizeof (*bufv));
-    if (unlikely(bufv == NULL))
+    struct buffer_pool_t *pool = malloc (sizeof (*pool)
+                                         + req.count * sizeof (pool->bufv[0]));
+    if (unlikely(pool == NULL))
         return NULL;
 
-    uint32_t bufc = 0;
-    while (bufc < req.count)
+    pool->fd = fd;
+    vlc_mutex_init (&pool->lock);
+    pool->refs = 1;
+    pool->queued = 0;
+    pool->streaming = false;
+    pool->count = 0;
+
+    while (pool->count < req.count)
     {
+        struct buffer_t *buffer = &pool->bufv[pool->count];
         struct v4l2_buffer buf = {
             .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
             .memory = V4L2_MEMORY_MMAP,
-            .index = bufc,
+            .index = pool->count,
         };
 
         if (v4l2_ioctl (fd, VIDIOC_QUERYBUF, &buf) < 0)
         {
-            msg_Err (obj, "cannot query buffer %"PRIu32": %s", bufc,
+            msg_Err (obj, "cannot query buffer %"PRIu32": %s", pool->count,
                      vlc_strerror_c(errno));
             goto error;
         }
 
-        bufv[bufc].start = v4l2_mmap (NULL, buf.length, PROT_READ | PROT_WRITE,
-                                      MAP_SHARED, fd, buf.m.offset);
-        if (bufv[bufc].start == MAP_FAILED)
+        buffer->start = v4l2_mmap (NULL, buf.length, PROT_READ | PROT_WRITE,
+                                   MAP_SHARED, fd, buf.m.offset);
+        if (buffer->start == MAP_FAILED)
         {
-            msg_Err (obj, "cannot map buffer %"PRIu32": %s", bufc,
+            msg_Err (obj, "cannot map buffer %"PRIu32": %s", pool->count,
                      vlc_strerror_c(errno));
             goto error;
         }
-        bufv[bufc].length = buf.length;
-        bufc++;
+        buffer->length = buf.length;
+        pool->count++;
 
         /* Some drivers refuse to queue buffers before they are mapped. Bug? */
         if (v4l2_ioctl (fd, VIDIOC_QBUF, &buf) < 0)
         {
-            msg_Err (obj, "cannot queue buffer %"PRIu32": %s", bufc,
+            msg_Err (obj, "cannot queue buffer %"PRIu32": %s", pool->count,
                      vlc_strerror_c(errno));
             goto error;
         }
+        pool->queued++;
     }
 
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -719,20 +818,27 @@ struct buffer_t *StartMmap (vlc_object_t *obj, int fd, uint32_t *restrict n)
         msg_Err (obj, "cannot start streaming: %s", vlc_strerror_c(errno));
         goto error;
     }
-    *n = bufc;
-    return bufv;
+    pool->streaming = true;
+    *n = pool->count;
+    return pool;
 error:
-    StopMmap (fd, bufv, bufc);
+    StopMmap (pool);
     return NULL;
 }
 
-void StopMmap (int fd, struct buffer_t *bufv, uint32_t bufc)
+/**
+ * Stops streaming. The buffers are unmapped once the last block using one
+ * of them is released.
+ */
+void StopMmap (struct buffer_pool_t *pool)
 {
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
     /* STREAMOFF implicitly dequeues all buffers */
-    v4l2_ioctl (fd, VIDIOC_STREAMOFF, &type);
-    for (uint32_t i = 0; i < bufc; i++)
-        v4l2_munmap (bufv[i].start, bufv[i].length);
-    free (bufv);
+    vlc_mutex_lock (&pool->lock);
+    v4l2_ioctl (pool->fd, VIDIOC_STREAMOFF, &type);
+    pool->streaming = false;
+    vlc_mutex_unlock (&pool->lock);
+
+    ReleasePool (pool);
 }
@@ -42,11 +42,18 @@ struct access_sys_t
 {
     /* zlib / unzip members */
     unzFile            zipFile;
+    stream_t          *stream;  /* archive, owned by unzip */
+
+    uint64_t           i_pos;   /* read offset in the file */
+    uint64_t           i_size;  /* uncompressed size of the file */
+    uint64_t           i_data;  /* offset of the data of a stored file in
+                                 * the archive, 0 if it is compressed */
 };
 
 static int AccessControl( access_t *p_access, int i_query, va_list args );
 static ssize_t AccessRead( access_t *, uint8_t *, size_t );
 static int AccessSeek( access_t *, uint64_t );
+static int ZipLocateData( access_t *, uint64_t * );
 static char *unescapeXml( const char *psz_text );
 
 /** **************************************************************************
@@ -176,6 +183,18 @@ int AccessOpen( vlc_object_t *p_this )
         goto exit;
     }
 
+    /* Stored files are read and seeked directly in the archive */
+    unz_file_info z_info;
+    if( unzGetCurrentFileInfo( p_sys->zipFile, &z_info,
+                               NULL, 0, NULL, 0, NULL, 0 ) != UNZ_OK )
+        goto exit;
+    p_sys->i_pos = 0;
+    p_sys->i_size = z_info.uncompressed_size;
+    p_sys->i_data = 0;
+    if( z_info.compression_method == 0 && !(z_info.flag & 1) /* encrypted */
+     && ZipLocateData( p_access, &p_sys->i_data ) == VLC_SUCCESS )
+        msg_Dbg( p_access, "stored file at offset %"PRIu64, p_sys->i_data );
+
     /* Set callback */
     ACCESS_SET_CALLBACKS( AccessRead, NULL, AccessControl, AccessSeek );
 
@@ -233,18 +252,12 @@ static int AccessControl( access_t *p_access, int i_query, va_list args )
 
         case ACCESS_CAN_FASTSEEK:
             pb_bool = (bool*)va_arg( args, bool* );
-            *pb_bool = false;
+            *pb_bool = p_access->p_sys->i_data != 0;
             break;
 
         case ACCESS_GET_SIZE:
-        {
-            unz_file_info z_info;
-
-            unzGetCurrentFileInfo( p_access->p_sys->zipFile, &z_info,
-                                   NULL, 0, NULL, 0, NULL, 0 );
-            *va_arg( args, uint64_t * ) = z_info.uncompressed_size;
+            *va_arg( args, uint64_t * ) = p_access->p_sys->i_size;
             break;
-        }
 
         case ACCESS_GET_PTS_DELAY:
             pi_64 = (int64_t*)va_arg( args, int64_t * );
@@ -271,25 +284,95 @@ static ssize_t AccessRead( access_t *p_access, uint8_t *p_buffer, size_t sz )
     access_sys_t *p_sys = p_access->p_sys;
     unzFile file = p_sys->zipFile;
 
+    if( p_sys->i_data != 0 )
+    {
+        if( p_sys->i_pos >= p_sys->i_size )
+            return 0;
+        if( sz > p_sys->i_size - p_sys->i_pos )
+            sz = p_sys->i_size - p_sys->i_pos;
+
+        /* unzip moves the archive stream while locating the file */
+        uint64_t i_offset = p_sys->i_data + p_sys->i_pos;
+        if( stream_Tell( p_sys->stream ) != i_offset
+         && stream_Seek( p_sys->stream, i_offset ) )
+            return VLC_EGENERIC;
+
+        ssize_t i_read = stream_Read( p_sys->stream, p_buffer, sz );
+        if( i_read > 0 )
+            p_sys->i_pos += i_read;
+        return ( i_read >= 0 ? i_read : VLC_EGENERIC );
+    }
+
     int i_read = unzReadCurrentFile( file, p_buffer, sz );
+    if( i_read > 0 )
+        p_sys->i_pos += i_read;
 
     return ( i_read >= 0 ? i_read : VLC_EGENERIC );
 }
 
 /** **************************************************************************
  * \brief Seek inside zip file
+ * Stored files are seeked in the archive. Compressed files are decompressed
+ * up to the new offset, from the start of the file if seeking backward.
  *****************************************************************************/
 static int AccessSeek( access_t *p_access, uint64_t seek_len )
 {
     access_sys_t *p_sys = p_access->p_sys;
     unzFile file = p_sys->zipFile;
 
-    if( seek_len > ULONG_MAX )
-        return VLC_EGENERIC; /* TODO: update minizip to LFS */
+    if( p_sys->i_data != 0 )
+    {
+        p_sys->i_pos = seek_len; /* AccessRead() seeks the archive */
+        return VLC_SUCCESS;
+    }
+
+    if( seek_len < p_sys->i_pos )
+    {
+        unzCloseCurrentFile( file );
+        if( unzOpenCurrentFile( file ) != UNZ_OK )
+            return VLC_EGENERIC;
+        p_sys->i_pos = 0;
+    }
+
+    uint8_t buf[16384];
+    while( p_sys->i_pos < seek_len )
+    {
+        uint64_t i_skip = seek_len - p_sys->i_pos;
+        int i_read = unzReadCurrentFile( file, buf,
+                                         __MIN( i_skip, sizeof( buf ) ) );
+        if( i_read <= 0 )
+            return VLC_EGENERIC;
+        p_sys->i_pos += i_read;
+    }
+
+    return VLC_SUCCESS;
+}
+
+/** **************************************************************************
+ * \brief Finds the data of the current (stored) file in the archive
+ * This reads the offset of the local header from the central directory, and
+ * skips the local header.
+ *****************************************************************************/
+static int ZipLocateData( access_t *p_access, uint64_t *pi_offset )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    uint8_t header[46];
+
+    /* Central directory file header */
+    uLong i_central = unzGetOffset( p_sys->zipFile );
+    if( i_central == 0 || stream_Seek( p_sys->stream, i_central )
+     || stream_Read( p_sys->stream, header, 46 ) < 46
+     || memcmp( header, "PK\x01\x02", 4 ) )
+        return VLC_EGENERIC;
 
-    if( unzSetOffset( file, seek_len ) < 0 )
+    /* Local file header */
+    uint64_t i_local = GetDWLE( header + 42 );
+    if( stream_Seek( p_sys->stream, i_local )
+     || stream_Read( p_sys->stream, header, 30 ) < 30
+     || memcmp( header, "PK\x03\x04", 4 ) )
         return VLC_EGENERIC;
 
+    *pi_offset = i_local + 30 + GetWLE( header + 26 ) + GetWLE( header + 28 );
     return VLC_SUCCESS;
 }
 
@@ -318,6 +401,7 @@ static void* ZCALLBACK ZipIO_Open( void* opaque, const char* file, int mode )
 
     stream_t *s = stream_UrlNew( p_access, fileUri );
     free( fileUri );
+    p_access->p_sys->stream = s;
     return s;
 }
 
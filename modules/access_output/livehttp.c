@@ -43,6 +43,7 @@
 #include <vlc_fs.h>
 #include <vlc_strings.h>
 #include <vlc_charset.h>
+#include <vlc_httpd.h>
 
 #include <gcrypt.h>
 #include <vlc_gcrypt.h>
@@ -105,6 +106,23 @@ static void Close( vlc_object_t * );
 #define INTITIAL_SEG_TEXT N_("Number of first segment")
 #define INITIAL_SEG_LONGTEXT N_("The number of the first segment generated")
 
+#define BATCH_TEXT N_("Write whole segments")
+#define BATCH_LONGTEXT N_("Keep each segment in memory until it is complete, "\
+                          "then write it at once to a temporary file renamed "\
+                          "into place")
+
+#define HTTPD_TEXT N_("Serve from memory")
+#define HTTPD_LONGTEXT N_("Keep the segments and the index in memory and "\
+                          "serve them with the HTTP server (see --http-host "\
+                          "and --http-port) instead of writing files. The "\
+                          "segment and index paths are then URL paths.")
+
+#define INIT_TEXT N_("Initialization segment")
+#define INIT_LONGTEXT N_("Path of the initialization segment of fragmented "\
+                         "MP4 streams (from the mp4frag muxer). By default, "\
+                         "the segment number in the segment path is replaced "\
+                         "by \"init\".")
+
 vlc_module_begin ()
     set_description( N_("HTTP Live streaming output") )
     set_shortname( N_("LiveHTTP" ))
@@ -133,6 +151,12 @@ vlc_module_begin ()
                 KEYURI_TEXT, KEYURI_TEXT, true )
     add_loadfile( SOUT_CFG_PREFIX "key-file", NULL,
                 KEYFILE_TEXT, KEYFILE_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "batch", false,
+              BATCH_TEXT, BATCH_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "httpd", false,
+              HTTPD_TEXT, HTTPD_LONGTEXT, true )
+    add_string( SOUT_CFG_PREFIX "init-segment", NULL,
+                INIT_TEXT, INIT_LONGTEXT, true )
     add_loadfile( SOUT_CFG_PREFIX "key-loadfile", NULL,
                 KEYLOADFILE_TEXT, KEYLOADFILE_LONGTEXT, true )
     set_callbacks( Open, Close )
@@ -156,6 +180,9 @@ static const char *const ppsz_sout_options[] = {
     "key-loadfile",
     "generate-iv",
     "initial-segment-number",
+    "batch",
+    "httpd",
+    "init-segment",
     NULL
 };
 
@@ -172,6 +199,8 @@ typedef struct output_segment
     float f_seglength;
     uint32_t i_segment_number;
     uint8_t aes_ivs[16];
+    block_t *p_data; /* segment served from memory */
+    httpd_file_t *p_file;
 } output_segment_t;
 
 struct sout_access_out_sys_t
@@ -203,6 +232,27 @@ struct sout_access_out_sys_t
     uint8_t stuffing_bytes[16];
     ssize_t stuffing_size;
     vlc_array_t *segments_t;
+
+    /* whole segments in memory */
+    bool b_batch;
+    bool b_segment_open;
+    block_t *p_segment_data;
+    block_t **pp_segment_last;
+
+    /* fragmented MP4 */
+    bool b_started;
+    bool b_fmp4;
+    char *psz_initPath;
+    char *psz_initUri;
+    block_t *p_init;
+    httpd_file_t *p_init_file;
+
+    /* serving from memory */
+    httpd_host_t *p_httpd_host;
+    httpd_file_t *p_index_file;
+    vlc_mutex_t lock; /* index */
+    char *psz_index;
+    size_t i_index;
 };
 
 static int LoadCryptFile( sout_access_out_t *p_access);
@@ -210,6 +260,8 @@ static int CryptSetup( sout_access_out_t *p_access, char *keyfile );
 static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer );
 static ssize_t writeSegment( sout_access_out_t *p_access );
 static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys );
+static int IndexCallback( httpd_file_sys_t *, httpd_file_t *, uint8_t *,
+                          uint8_t **, int * );
 /*****************************************************************************
  * Open: open the file
  *****************************************************************************/
@@ -243,6 +295,9 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_caching = var_GetBool( p_access, SOUT_CFG_PREFIX "caching") ;
     p_sys->b_generate_iv = var_GetBool( p_access, SOUT_CFG_PREFIX "generate-iv") ;
     p_sys->b_segment_has_data = false;
+    bool b_httpd = var_GetBool( p_access, SOUT_CFG_PREFIX "httpd" );
+    p_sys->b_batch = b_httpd || var_GetBool( p_access, SOUT_CFG_PREFIX "batch" );
+    p_sys->pp_segment_last = &p_sys->p_segment_data;
 
     p_sys->segments_t = vlc_array_new();
 
@@ -264,9 +319,16 @@ static int Open( vlc_object_t *p_this )
         }
         path_sanitize( psz_tmp );
         p_sys->psz_indexPath = psz_tmp;
-        if( p_sys->i_initial_segment != 1 )
+        if( p_sys->i_initial_segment != 1 && !b_httpd )
             vlc_unlink( p_sys->psz_indexPath );
     }
+    else if( b_httpd )
+    {
+        msg_Err( p_access, "serving from memory needs an index" );
+        vlc_array_destroy( p_sys->segments_t );
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
 
     p_sys->psz_indexUrl = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "index-url" );
     p_sys->psz_keyfile  = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "key-loadfile" );
@@ -291,6 +353,39 @@ static int Open( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
+    vlc_mutex_init( &p_sys->lock );
+    if( b_httpd )
+    {
+        p_sys->p_httpd_host = vlc_http_HostNew( VLC_OBJECT(p_access) );
+        if( p_sys->p_httpd_host )
+            p_sys->p_index_file = httpd_FileNew( p_sys->p_httpd_host,
+                                        p_sys->psz_indexPath,
+                                        "application/vnd.apple.mpegurl",
+                                        NULL, NULL, IndexCallback,
+                                        (void*)p_sys );
+        if( !p_sys->p_index_file )
+        {
+            msg_Err( p_access, "cannot serve `%s'", p_sys->psz_indexPath );
+            if( p_sys->p_httpd_host )
+                httpd_HostDelete( p_sys->p_httpd_host );
+            vlc_mutex_destroy( &p_sys->lock );
+            if( p_sys->key_uri )
+            {
+                gcry_cipher_close( p_sys->aes_ctx );
+                free( p_sys->key_uri );
+            }
+            vlc_array_destroy( p_sys->segments_t );
+            free( p_sys->psz_keyfile );
+            free( p_sys->psz_indexUrl );
+            free( p_sys->psz_indexPath );
+            free( p_sys );
+            return VLC_EGENERIC;
+        }
+        if( p_sys->i_numsegs == 0 )
+            msg_Warn( p_access, "all the segments will stay in memory, "
+                      "set the number of segments to bound it" );
+    }
+
     p_sys->i_handle = -1;
     p_sys->i_segment = p_sys->i_initial_segment-1;
     p_sys->psz_cursegPath = NULL;
@@ -502,8 +597,161 @@ static char *formatSegmentPath( char *psz_path, uint32_t i_seg, bool b_sanitize
     return psz_result;
 }
 
+/*****************************************************************************
+ * formatInitPath: create the initialization segment path from the segment
+ * path, with "init" instead of the segment number
+ *****************************************************************************/
+static char *formatInitPath( char *psz_path, bool b_sanitize )
+{
+    char *psz_result;
+    char *psz_firstNumSign;
+
+    if ( ! ( psz_result  = str_format_time( psz_path ) ) )
+        return NULL;
+
+    psz_firstNumSign = psz_result + strcspn( psz_result, SEG_NUMBER_PLACEHOLDER );
+    char *psz_newResult;
+    int ret;
+    if ( *psz_firstNumSign )
+    {
+        int i_cnt = strspn( psz_firstNumSign, SEG_NUMBER_PLACEHOLDER );
+
+        *psz_firstNumSign = '\0';
+        ret = asprintf( &psz_newResult, "%sinit%s", psz_result, psz_firstNumSign + i_cnt );
+    }
+    else
+        ret = asprintf( &psz_newResult, "%s.init", psz_result );
+    free ( psz_result );
+    if ( ret < 0 )
+        return NULL;
+    psz_result = psz_newResult;
+
+    if ( b_sanitize )
+        path_sanitize( psz_result );
+
+    return psz_result;
+}
+
+/*****************************************************************************
+ * writeFile: write a whole file at once, to a temporary file renamed into
+ * place, so that readers never see it partially written
+ *****************************************************************************/
+static int writeFile( sout_access_out_t *p_access, const char *psz_path,
+                      const uint8_t *p_data, size_t i_data )
+{
+    char *psz_tmp;
+    if ( asprintf( &psz_tmp, "%s.tmp", psz_path ) < 0 )
+        return -1;
+
+    int fd = vlc_open( psz_tmp, O_WRONLY | O_CREAT | O_LARGEFILE |
+                       O_TRUNC, 0666 );
+    if ( fd == -1 )
+    {
+        msg_Err( p_access, "cannot open `%s' (%s)", psz_tmp,
+                 vlc_strerror_c(errno) );
+        free( psz_tmp );
+        return -1;
+    }
+
+    while( i_data > 0 )
+    {
+        ssize_t val = vlc_write( fd, p_data, i_data );
+        if ( val == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+            msg_Err( p_access, "cannot write `%s' (%s)", psz_tmp,
+                     vlc_strerror_c(errno) );
+            close( fd );
+            vlc_unlink( psz_tmp );
+            free( psz_tmp );
+            return -1;
+        }
+        p_data += val;
+        i_data -= val;
+    }
+    close( fd );
+
+    if ( vlc_rename( psz_tmp, psz_path ) < 0 )
+    {
+        msg_Err( p_access, "cannot move `%s' (%s)", psz_tmp,
+                 vlc_strerror_c(errno) );
+        vlc_unlink( psz_tmp );
+        free( psz_tmp );
+        return -1;
+    }
+    free( psz_tmp );
+    return 0;
+}
+
+/*****************************************************************************
+ * indexAppend: append a formatted line to the index text
+ *****************************************************************************/
+static int indexAppend( char **ppsz_index, size_t *pi_index,
+                        const char *psz_fmt, ... )
+{
+    va_list args;
+    char *psz_line;
+
+    va_start( args, psz_fmt );
+    int i_line = vasprintf( &psz_line, psz_fmt, args );
+    va_end( args );
+    if ( i_line < 0 )
+        return -1;
+
+    char *psz_index = realloc( *ppsz_index, *pi_index + i_line + 1 );
+    if ( unlikely( !psz_index ) )
+    {
+        free( psz_line );
+        return -1;
+    }
+    memcpy( &psz_index[*pi_index], psz_line, i_line + 1 );
+    *ppsz_index = psz_index;
+    *pi_index += i_line;
+    free( psz_line );
+    return 0;
+}
+
+/*****************************************************************************
+ * IndexCallback, SegmentCallback: serve the index and the segments
+ *****************************************************************************/
+static int IndexCallback( httpd_file_sys_t *p_args, httpd_file_t *f,
+                          uint8_t *p_request, uint8_t **pp_data, int *pi_data )
+{
+    VLC_UNUSED(f); VLC_UNUSED(p_request);
+    sout_access_out_sys_t *p_sys = (sout_access_out_sys_t *)p_args;
+
+    vlc_mutex_lock( &p_sys->lock );
+    *pp_data = p_sys->i_index ? malloc( p_sys->i_index ) : NULL;
+    *pi_data = *pp_data ? p_sys->i_index : 0;
+    if( *pp_data )
+        memcpy( *pp_data, p_sys->psz_index, p_sys->i_index );
+    vlc_mutex_unlock( &p_sys->lock );
+
+    return VLC_SUCCESS;
+}
+
+static int SegmentCallback( httpd_file_sys_t *p_args, httpd_file_t *f,
+                            uint8_t *p_request, uint8_t **pp_data, int *pi_data )
+{
+    VLC_UNUSED(f); VLC_UNUSED(p_request);
+    /* the data does not change while it is served */
+    const block_t *p_data = (const block_t *)p_args;
+
+    *pp_data = malloc( p_data->i_buffer );
+    *pi_data = *pp_data ? p_data->i_buffer : 0;
+    if( *pp_data )
+        memcpy( *pp_data, p_data->p_buffer, p_data->i_buffer );
+
+    return VLC_SUCCESS;
+}
+
 static void destroySegment( output_segment_t *segment )
 {
+    if( segment->p_file )
+        httpd_FileDelete( segment->p_file );
+    if( segment->p_data )
+        block_Release( segment->p_data );
     free( segment->psz_filename );
     free( segment->psz_duration );
     free( segment->psz_uri );
@@ -577,35 +825,23 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
     // First update index
     if ( p_sys->psz_indexPath )
     {
-        int val;
-        FILE *fp;
-        char *psz_idxTmp;
-        if ( asprintf( &psz_idxTmp, "%s.tmp", p_sys->psz_indexPath ) < 0)
-            return -1;
-
-        fp = vlc_fopen( psz_idxTmp, "wt");
-        if ( !fp )
-        {
-            msg_Err( p_access, "cannot open index file `%s'", psz_idxTmp );
-            free( psz_idxTmp );
-            return -1;
-        }
+        char *psz_index = NULL;
+        size_t i_index = 0;
 
-        if ( fprintf( fp, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:3\n#EXT-X-ALLOW-CACHE:%s"
+        int ret = indexAppend( &psz_index, &i_index, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:%d\n#EXT-X-ALLOW-CACHE:%s"
                           "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n%s", p_sys->i_seglen,
+                          p_sys->b_fmp4 ? 7 : 3,
                           p_sys->b_caching ? "YES" : "NO",
                           p_sys->i_numsegs > 0 ? "" : b_isend ? "\n#EXT-X-PLAYLIST-TYPE:VOD" : "\n#EXT-X-PLAYLIST-TYPE:EVENT",
                           i_firstseg, ((p_sys->i_initial_segment > 1) && (p_sys->i_initial_segment == i_firstseg)) ? "#EXT-X-DISCONTINUITY\n" : ""
-                          ) < 0 )
-        {
-            free( psz_idxTmp );
-            fclose( fp );
-            return -1;
-        }
-        char *psz_current_uri=NULL;
+                          );
+        if ( ret == 0 && p_sys->b_fmp4 )
+            ret = indexAppend( &psz_index, &i_index, "#EXT-X-MAP:URI=\"%s\"\n",
+                               p_sys->psz_initUri );
 
+        const char *psz_current_uri = NULL;
 
-        for ( uint32_t i = i_firstseg; i <= p_sys->i_segment; i++ )
+        for ( uint32_t i = i_firstseg; ret == 0 && i <= p_sys->i_segment; i++ )
         {
             //scale to i_index_offset..numsegs + i_index_offset
             uint32_t index = i - i_firstseg + i_index_offset;
@@ -615,9 +851,7 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
                 ( !psz_current_uri ||  strcmp( psz_current_uri, segment->psz_key_uri ) )
               )
             {
-                int ret = 0;
-                free( psz_current_uri );
-                psz_current_uri = strdup( segment->psz_key_uri );
+                psz_current_uri = segment->psz_key_uri;
                 if( p_sys->b_generate_iv )
                 {
                     unsigned long long iv_hi = segment->aes_ivs[0];
@@ -629,55 +863,47 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
                         iv_lo <<= 8;
                         iv_lo |= segment->aes_ivs[8+i] & 0xff;
                     }
-                    ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=0X%16.16llx%16.16llx\n",
-                                   segment->psz_key_uri, iv_hi, iv_lo );
+                    ret = indexAppend( &psz_index, &i_index, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=0X%16.16llx%16.16llx\n",
+                                       segment->psz_key_uri, iv_hi, iv_lo );
 
                 } else {
-                    ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n", segment->psz_key_uri );
+                    ret = indexAppend( &psz_index, &i_index, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n", segment->psz_key_uri );
                 }
                 if( ret < 0 )
-                {
-                    free( psz_current_uri );
-                    free( psz_idxTmp );
-                    fclose( fp );
-                    return -1;
-                }
+                    break;
             }
 
-            val = fprintf( fp, "#EXTINF:%s,\n%s\n", segment->psz_duration, segment->psz_uri);
-            if ( val < 0 )
-            {
-                free( psz_current_uri );
-                free( psz_idxTmp );
-                fclose( fp );
-                return -1;
-            }
+            ret = indexAppend( &psz_index, &i_index, "#EXTINF:%s,\n%s\n", segment->psz_duration, segment->psz_uri);
         }
-        free( psz_current_uri );
 
-        if ( b_isend )
-        {
-            if ( fputs ( STR_ENDLIST, fp ) < 0)
-            {
-                free( psz_idxTmp );
-                fclose( fp ) ;
-                return -1;
-            }
+        if ( ret == 0 && b_isend )
+            ret = indexAppend( &psz_index, &i_index, "%s", STR_ENDLIST );
 
+        if ( ret < 0 )
+        {
+            free( psz_index );
+            return -1;
         }
-        fclose( fp );
-
-        val = vlc_rename ( psz_idxTmp, p_sys->psz_indexPath);
 
-        if ( val < 0 )
+        /* Replace the whole index at once */
+        if ( p_sys->p_httpd_host )
         {
-            vlc_unlink( psz_idxTmp );
-            msg_Err( p_access, "Error moving LiveHttp index file" );
+            vlc_mutex_lock( &p_sys->lock );
+            free( p_sys->psz_index );
+            p_sys->psz_index = psz_index;
+            p_sys->i_index = i_index;
+            vlc_mutex_unlock( &p_sys->lock );
+            msg_Dbg( p_access, "LiveHttpIndexComplete: %s" , p_sys->psz_indexPath );
         }
         else
-            msg_Dbg( p_access, "LiveHttpIndexComplete: %s" , p_sys->psz_indexPath );
-
-        free( psz_idxTmp );
+        {
+            if ( writeFile( p_access, p_sys->psz_indexPath,
+                            (const uint8_t *)psz_index, i_index ) < 0 )
+                msg_Err( p_access, "Error moving LiveHttp index file" );
+            else
+                msg_Dbg( p_access, "LiveHttpIndexComplete: %s" , p_sys->psz_indexPath );
+            free( psz_index );
+        }
     }
 
     // Then take care of deletion
@@ -690,7 +916,7 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
          msg_Dbg( p_access, "Removing segment number %d", segment->i_segment_number );
          vlc_array_remove( p_sys->segments_t, 0 );
 
-         if ( segment->psz_filename )
+         if ( segment->psz_filename && !p_sys->p_httpd_host )
          {
              vlc_unlink( segment->psz_filename );
          }
@@ -703,12 +929,49 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
     return 0;
 }
 
+/*****************************************************************************
+ * commitSegment: write or publish a segment kept in memory
+ *****************************************************************************/
+static int commitSegment( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys,
+                          output_segment_t *segment )
+{
+    block_t *p_data = p_sys->p_segment_data ?
+                      block_ChainGather( p_sys->p_segment_data ) : NULL;
+    p_sys->p_segment_data = NULL;
+    p_sys->pp_segment_last = &p_sys->p_segment_data;
+    if ( !p_data )
+        p_data = block_Alloc( 0 );
+    if ( unlikely( !p_data ) )
+        return -1;
+
+    if ( p_sys->p_httpd_host )
+    {
+        segment->p_data = p_data;
+        segment->p_file = httpd_FileNew( p_sys->p_httpd_host,
+                                         segment->psz_filename,
+                                         p_sys->b_fmp4 ? "video/mp4" : "video/MP2T",
+                                         NULL, NULL, SegmentCallback,
+                                         (void*)p_data );
+        if ( !segment->p_file )
+        {
+            msg_Err( p_access, "cannot serve `%s'", segment->psz_filename );
+            return -1;
+        }
+        return 0;
+    }
+
+    int ret = writeFile( p_access, segment->psz_filename,
+                         p_data->p_buffer, p_data->i_buffer );
+    block_Release( p_data );
+    return ret;
+}
+
 /*****************************************************************************
  * closeCurrentSegment: Close the segment file
  *****************************************************************************/
 static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
 {
-    if ( p_sys->i_handle >= 0 )
+    if ( p_sys->b_segment_open )
     {
         output_segment_t *segment = (output_segment_t *)vlc_array_item_at_index( p_sys->segments_t, vlc_array_count( p_sys->segments_t ) - 1 );
 
@@ -720,6 +983,15 @@ static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sy
 
             if( err ) {
                msg_Err( p_access, "Couldn't encrypt 16 bytes: %s", gpg_strerror(err) );
+            } else if( p_sys->b_batch ) {
+                block_t *p_pad = block_Alloc( 16 );
+                if( likely( p_pad ) )
+                {
+                    memcpy( p_pad->p_buffer, p_sys->stuffing_bytes, 16 );
+                    block_ChainLastAppend( &p_sys->pp_segment_last, p_pad );
+                }
+                else
+                    msg_Err( p_access, "Couldn't write 16 bytes" );
             } else {
 
             int ret = vlc_write( p_sys->i_handle, p_sys->stuffing_bytes, 16 );
@@ -729,9 +1001,17 @@ static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sy
             p_sys->stuffing_size = 0;
         }
 
-
-        close( p_sys->i_handle );
-        p_sys->i_handle = -1;
+        if( p_sys->b_batch )
+        {
+            if( commitSegment( p_access, p_sys, segment ) < 0 )
+                msg_Err( p_access, "Couldn't write segment %"PRIu32, p_sys->i_segment );
+        }
+        else
+        {
+            close( p_sys->i_handle );
+            p_sys->i_handle = -1;
+        }
+        p_sys->b_segment_open = false;
 
         if( ! ( us_asprintf( &segment->psz_duration, "%.2f", p_sys->f_seglen ) ) )
         {
@@ -809,7 +1089,8 @@ static void Close( vlc_object_t * p_this )
     {
         output_segment_t *segment = vlc_array_item_at_index( p_sys->segments_t, 0 );
         vlc_array_remove( p_sys->segments_t, 0 );
-        if( p_sys->b_delsegs && p_sys->i_numsegs && segment->psz_filename )
+        if( p_sys->b_delsegs && p_sys->i_numsegs && segment->psz_filename &&
+            !p_sys->p_httpd_host )
         {
             msg_Dbg( p_access, "Removing segment number %d name %s", segment->i_segment_number, segment->psz_filename );
             vlc_unlink( segment->psz_filename );
@@ -818,6 +1099,24 @@ static void Close( vlc_object_t * p_this )
         destroySegment( segment );
     }
     vlc_array_destroy( p_sys->segments_t );
+    block_ChainRelease( p_sys->p_segment_data );
+
+    if( p_sys->p_init_file )
+        httpd_FileDelete( p_sys->p_init_file );
+    if( p_sys->p_init )
+        block_Release( p_sys->p_init );
+    if( p_sys->psz_initPath && p_sys->b_delsegs && p_sys->i_numsegs &&
+        !p_sys->p_httpd_host )
+        vlc_unlink( p_sys->psz_initPath );
+    free( p_sys->psz_initPath );
+    free( p_sys->psz_initUri );
+
+    if( p_sys->p_index_file )
+        httpd_FileDelete( p_sys->p_index_file );
+    if( p_sys->p_httpd_host )
+        httpd_HostDelete( p_sys->p_httpd_host );
+    vlc_mutex_destroy( &p_sys->lock );
+    free( p_sys->psz_index );
 
     free( p_sys->psz_indexUrl );
     free( p_sys->psz_indexPath );
@@ -872,8 +1171,9 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
         return -1;
     }
 
-    fd = vlc_open( segment->psz_filename, O_WRONLY | O_CREAT | O_LARGEFILE |
-                     O_TRUNC, 0666 );
+    /* Whole segments are written when complete */
+    fd = p_sys->b_batch ? 0 : vlc_open( segment->psz_filename,
+                     O_WRONLY | O_CREAT | O_LARGEFILE | O_TRUNC, 0666 );
     if ( fd == -1 )
     {
         msg_Err( p_access, "cannot open `%s' (%s)", segment->psz_filename,
@@ -899,9 +1199,10 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
     msg_Dbg( p_access, "Successfully opened livehttp file: %s (%"PRIu32")" , segment->psz_filename, i_newseg );
 
     p_sys->psz_cursegPath = strdup(segment->psz_filename);
-    p_sys->i_handle = fd;
+    p_sys->i_handle = p_sys->b_batch ? -1 : fd;
     p_sys->i_segment = i_newseg;
     p_sys->b_segment_has_data = false;
+    p_sys->b_segment_open = true;
     return fd;
 }
 /*****************************************************************************
@@ -924,14 +1225,14 @@ static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer )
         msg_Dbg( p_access, "dts offset %"PRId64, p_sys->i_dts_offset );
     }
 
-    if( p_sys->i_handle > 0 && p_sys->b_segment_has_data &&
+    if( p_sys->b_segment_open && p_sys->b_segment_has_data &&
        (( p_buffer->i_length + p_buffer->i_dts - p_sys->i_opendts +
           p_sys->i_dts_offset ) >= p_sys->i_seglenm ) )
     {
         closeCurrentSegment( p_access, p_sys, false );
     }
 
-    if ( unlikely( p_sys->i_handle < 0 ) )
+    if ( unlikely( !p_sys->b_segment_open ) )
     {
         p_sys->i_dts_offset = 0;
         p_sys->i_opendts = output ? output->i_dts : p_buffer->i_dts;
@@ -986,6 +1287,16 @@ static ssize_t writeSegment( sout_access_out_t *p_access )
 
         }
 
+        if ( p_sys->b_batch )
+        {
+            p_sys->f_seglen =
+                (float)(output->i_length +
+                        output->i_dts - p_sys->i_opendts + p_sys->i_dts_offset) / CLOCK_FREQ;
+            i_write += output->i_buffer;
+            block_ChainLastAppend( &p_sys->pp_segment_last, output );
+            break;
+        }
+
         ssize_t val = vlc_write( p_sys->i_handle, output->p_buffer, output->i_buffer );
         if ( val == -1 )
         {
@@ -1015,6 +1326,65 @@ static ssize_t writeSegment( sout_access_out_t *p_access )
     return i_write;
 }
 
+/*****************************************************************************
+ * setupInitSegment: store the header of a fragmented MP4 stream, which the
+ * index refers to instead of repeating it in the segments
+ *****************************************************************************/
+static int setupInitSegment( sout_access_out_t *p_access, block_t *p_header )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( p_sys->key_uri )
+    {
+        msg_Err( p_access, "cannot encrypt fragmented MP4 segments" );
+        block_Release( p_header );
+        return -1;
+    }
+
+    char *psz_init = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "init-segment" );
+    if( psz_init )
+    {
+        p_sys->psz_initPath = strdup( psz_init );
+        if( p_sys->psz_initPath )
+            path_sanitize( p_sys->psz_initPath );
+        p_sys->psz_initUri = psz_init;
+    }
+    else
+    {
+        p_sys->psz_initPath = formatInitPath( p_access->psz_path, true );
+        p_sys->psz_initUri = formatInitPath( p_sys->psz_indexUrl ?
+                                 p_sys->psz_indexUrl : p_access->psz_path, false );
+    }
+    if( unlikely( !p_sys->psz_initPath || !p_sys->psz_initUri ) )
+    {
+        block_Release( p_header );
+        return -1;
+    }
+    p_sys->b_fmp4 = true;
+    msg_Dbg( p_access, "fragmented MP4, initialization segment %s",
+             p_sys->psz_initPath );
+
+    if( p_sys->p_httpd_host )
+    {
+        p_sys->p_init = p_header;
+        p_sys->p_init_file = httpd_FileNew( p_sys->p_httpd_host,
+                                            p_sys->psz_initPath, "video/mp4",
+                                            NULL, NULL, SegmentCallback,
+                                            (void*)p_header );
+        if( !p_sys->p_init_file )
+        {
+            msg_Err( p_access, "cannot serve `%s'", p_sys->psz_initPath );
+            return -1;
+        }
+        return 0;
+    }
+
+    int ret = writeFile( p_access, p_sys->psz_initPath,
+                         p_header->p_buffer, p_header->i_buffer );
+    block_Release( p_header );
+    return ret;
+}
+
 /*****************************************************************************
  * Write: standard write on a file descriptor.
  *****************************************************************************/
@@ -1025,7 +1395,30 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
     block_t *p_temp;
     while( p_buffer )
     {
-        if( ( p_sys->b_splitanywhere  || ( p_buffer->i_flags & BLOCK_FLAG_HEADER ) ) )
+        /* The mp4frag muxer starts with its header, then flags fragments
+         * as key frames */
+        if( unlikely( !p_sys->b_started ) )
+        {
+            p_sys->b_started = true;
+            if( ( p_buffer->i_flags & BLOCK_FLAG_HEADER ) &&
+                p_buffer->i_buffer >= 8 &&
+                !memcmp( &p_buffer->p_buffer[4], "ftyp", 4 ) )
+            {
+                p_temp = p_buffer->p_next;
+                p_buffer->p_next = NULL;
+                if( setupInitSegment( p_access, p_buffer ) < 0 )
+                {
+                    block_ChainRelease( p_temp );
+                    return -1;
+                }
+                p_buffer = p_temp;
+                continue;
+            }
+        }
+
+        const uint32_t i_split = p_sys->b_fmp4 ? BLOCK_FLAG_TYPE_I
+                                               : BLOCK_FLAG_HEADER;
+        if( ( p_sys->b_splitanywhere  || ( p_buffer->i_flags & i_split ) ) )
         {
             if( unlikely( CheckSegmentChange( p_access, p_buffer ) != VLC_SUCCESS ) )
             {
@@ -46,10 +46,15 @@
 #else
 #   include <sys/socket.h>
 #endif
+#ifdef HAVE_SENDMMSG
+#   include <netinet/udp.h>
+#endif
 
 #include <vlc_network.h>
 
 #define MAX_EMPTY_BLOCKS 200
+/* Maximum number of datagrams sent per system call */
+#define BATCH_MAX 16
 
 /*****************************************************************************
  * Module descriptor
@@ -122,6 +127,13 @@ struct sout_access_out_sys_t
     block_t      *p_buffer;
 
     vlc_thread_t  thread;
+    bool          b_gso; /* UDP segmentation offload usable */
+
+    /* pacing statistics, owned by the sender thread */
+    uint64_t      i_sent_packets;
+    uint64_t      i_sent_calls;
+    mtime_t       i_lateness_sum;
+    mtime_t       i_lateness_max;
 };
 
 #define DEFAULT_PORT 1234
@@ -210,9 +222,19 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
-    p_sys->p_fifo = block_FifoNew();
-    p_sys->p_empty_blocks = block_FifoNew();
+    /* Both queues have one producer and one consumer thread */
+    p_sys->p_fifo = block_FifoNewSPSC();
+    p_sys->p_empty_blocks = block_FifoNewSPSC();
     p_sys->p_buffer = NULL;
+#ifdef UDP_SEGMENT
+    p_sys->b_gso = true;
+#else
+    p_sys->b_gso = false;
+#endif
+    p_sys->i_sent_packets = 0;
+    p_sys->i_sent_calls = 0;
+    p_sys->i_lateness_sum = 0;
+    p_sys->i_lateness_max = 0;
 
     if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
@@ -242,6 +264,14 @@ static void Close( vlc_object_t * p_this )
 
     vlc_cancel( p_sys->thread );
     vlc_join( p_sys->thread, NULL );
+
+    if( p_sys->i_sent_packets > 0 )
+        msg_Dbg( p_access, "sent %"PRIu64" packets in %"PRIu64" calls, "
+                 "lateness average %"PRId64" us, maximum %"PRId64" us",
+                 p_sys->i_sent_packets, p_sys->i_sent_calls,
+                 p_sys->i_lateness_sum / (mtime_t)p_sys->i_sent_packets,
+                 p_sys->i_lateness_max );
+
     block_FifoRelease( p_sys->p_fifo );
     block_FifoRelease( p_sys->p_empty_blocks );
 
@@ -392,6 +422,138 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     return p_buffer;
 }
 
+typedef struct
+{
+    unsigned  i_count;
+    block_t  *pp_packets[BATCH_MAX];
+    mtime_t   pi_dates[BATCH_MAX];
+} udp_batch_t;
+
+static void ReleaseBatch( void *data )
+{
+    udp_batch_t *p_batch = data;
+
+    for( unsigned i = 0; i < p_batch->i_count; i++ )
+        block_Release( p_batch->pp_packets[i] );
+}
+
+#ifdef UDP_SEGMENT
+/*****************************************************************************
+ * SendSegmented: send a batch as a single GSO super-datagram.
+ *****************************************************************************
+ * All packets but the last must have the same size, and the last one may not
+ * be larger. Returns 0 if the batch was sent, -1 if it was not.
+ *****************************************************************************/
+static int SendSegmented( sout_access_out_sys_t *p_sys,
+                          const udp_batch_t *p_batch )
+{
+    const size_t i_segment = p_batch->pp_packets[0]->i_buffer;
+    struct iovec iov[BATCH_MAX];
+    size_t i_total = 0;
+
+    for( unsigned i = 0; i < p_batch->i_count; i++ )
+    {
+        const block_t *p_pk = p_batch->pp_packets[i];
+
+        if( p_pk->i_buffer > i_segment
+         || (p_pk->i_buffer < i_segment && i + 1 < p_batch->i_count) )
+            return -1;
+        iov[i].iov_base = p_pk->p_buffer;
+        iov[i].iov_len = p_pk->i_buffer;
+        i_total += p_pk->i_buffer;
+    }
+
+    if( i_total > 65000 )
+        return -1;
+
+    union
+    {
+        char buf[CMSG_SPACE(sizeof (uint16_t))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = {
+        .msg_iov = iov,
+        .msg_iovlen = p_batch->i_count,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof (control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR( &msg );
+
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof (uint16_t));
+    *(uint16_t *)CMSG_DATA(cmsg) = i_segment;
+
+    if( sendmsg( p_sys->i_handle, &msg, 0 ) == -1 )
+    {
+        if( errno == EINVAL || errno == EIO || errno == ENOPROTOOPT )
+            p_sys->b_gso = false; /* not supported by the kernel or device */
+        return -1;
+    }
+    return 0;
+}
+#endif
+
+/*****************************************************************************
+ * SendBatch: send a batch of packets with as few system calls as possible.
+ *****************************************************************************/
+static void SendBatch( sout_access_out_t *p_access, const udp_batch_t *p_batch )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    unsigned i_done = 0;
+
+#ifdef UDP_SEGMENT
+    if( p_sys->b_gso && p_batch->i_count > 1
+     && SendSegmented( p_sys, p_batch ) == 0 )
+    {
+        p_sys->i_sent_calls++;
+        return;
+    }
+#endif
+
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgs[BATCH_MAX];
+    struct iovec iov[BATCH_MAX];
+
+    for( unsigned i = 0; i < p_batch->i_count; i++ )
+    {
+        iov[i].iov_base = p_batch->pp_packets[i]->p_buffer;
+        iov[i].iov_len = p_batch->pp_packets[i]->i_buffer;
+        memset( &msgs[i], 0, sizeof (msgs[i]) );
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while( i_done < p_batch->i_count )
+    {
+        int val = sendmmsg( p_sys->i_handle, &msgs[i_done],
+                            p_batch->i_count - i_done, 0 );
+        p_sys->i_sent_calls++;
+        if( val == -1 )
+        {
+            if( errno == EINTR )
+                continue;
+            if( errno == ENOSYS )
+                break; /* Linux < 3.0: fallback to send() */
+            /* Like send(), lose only the datagram that failed and carry on
+             * with the rest of the batch. */
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            val = 1;
+        }
+        i_done += val;
+    }
+#endif
+
+    for( unsigned i = i_done; i < p_batch->i_count; i++ )
+    {
+        const block_t *p_pk = p_batch->pp_packets[i];
+
+        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+        p_sys->i_sent_calls++;
+    }
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -404,6 +566,7 @@ static void* ThreadWrite( void *data )
                                              SOUT_CFG_PREFIX "group" );
     mtime_t i_to_send = i_group;
     unsigned i_dropped_packets = 0;
+    udp_batch_t batch;
 
     for (;;)
     {
@@ -433,16 +596,41 @@ static void* ThreadWrite( void *data )
             }
         }
 
-        block_cleanup_push( p_pk );
+        batch.i_count = 1;
+        batch.pp_packets[0] = p_pk;
+        batch.pi_dates[0] = i_date;
+
+        vlc_cleanup_push( ReleaseBatch, &batch );
         i_to_send--;
         if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
         {
             mwait( i_date );
             i_to_send = i_group;
         }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+
+        /* Collect the queued packets which are already due, without
+         * sending any of them ahead of time. */
+        mtime_t i_now = mdate();
+        while( batch.i_count < BATCH_MAX
+            && block_FifoCount( p_sys->p_fifo ) > 0 )
+        {
+            block_t *p_next = block_FifoShow( p_sys->p_fifo );
+            mtime_t i_next = p_sys->i_caching + p_next->i_dts;
+
+            if( (p_next->i_flags & BLOCK_FLAG_CLOCK)
+             || i_next > i_now
+             || i_next < batch.pi_dates[batch.i_count - 1] )
+                break; /* needs pacing or special handling */
+
+            batch.pp_packets[batch.i_count] = block_FifoGet( p_sys->p_fifo );
+            batch.pi_dates[batch.i_count++] = i_next;
+            if( !--i_to_send )
+                i_to_send = i_group;
+        }
+
+        SendBatch( p_access, &batch );
         vlc_cleanup_pop();
+        i_date = batch.pi_dates[batch.i_count - 1];
 
         if( i_dropped_packets )
         {
@@ -450,8 +638,19 @@ static void* ThreadWrite( void *data )
             i_dropped_packets = 0;
         }
 
-#if 1
         i_sent = mdate();
+        for( unsigned i = 0; i < batch.i_count; i++ )
+        {
+            mtime_t i_late = i_sent - batch.pi_dates[i];
+
+            p_sys->i_lateness_sum += i_late;
+            if( i_late > p_sys->i_lateness_max )
+                p_sys->i_lateness_max = i_late;
+            block_FifoPut( p_sys->p_empty_blocks, batch.pp_packets[i] );
+        }
+        p_sys->i_sent_packets += batch.i_count;
+
+#if 1
         if ( i_sent > i_date + 20000 )
         {
             msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
@@ -459,8 +658,6 @@ static void* ThreadWrite( void *data )
         }
 #endif
 
-        block_FifoPut( p_sys->p_empty_blocks, p_pk );
-
         i_date_last = i_date;
     }
     return NULL;
@@ -39,6 +39,8 @@
 #include <vlc_filter.h>
 #include <vlc_block.h>
 
+#include <assert.h>
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -99,18 +101,73 @@ struct atomic_operation_t
 {
     int i_source_channel_offset;
     int i_dest_channel_offset;
-    unsigned int i_delay;/* in sample unit */
+    double d_delay;/* in sample unit */
     double d_amplitude_factor;
 };
 
-struct filter_sys_t
+struct headphone_model_t
 {
-    size_t i_overflow_buffer_size;/* in bytes */
-    float * p_overflow_buffer;
     unsigned int i_nb_atomic_operations;
     struct atomic_operation_t * p_atomic_operations;
 };
 
+/* The atomic operations are turned into one impulse response per source
+ * channel and ear, which is convolved in the frequency domain with a
+ * uniformly partitioned overlap-save scheme: each partition covers
+ * HEADPHONE_BLOCK samples of the response and is transformed with a
+ * 2 * HEADPHONE_BLOCK points FFT. */
+#define HEADPHONE_BLOCK 256
+#define HEADPHONE_FFT   (2 * HEADPHONE_BLOCK)
+
+/* Half width, in samples, of the fractional delay interpolator */
+#define HEADPHONE_SINC  8
+
+/* Spectrum of one non-silent partition of a channel to ear response */
+struct headphone_tap_t
+{
+    uint8_t i_channel;
+    uint8_t i_ear;
+    uint16_t i_partition;
+    float *p_spectrum;/* HEADPHONE_FFT complex values */
+};
+
+/* Filter kernel, shared by all the instances with the same parameters */
+typedef struct headphone_kernel_t
+{
+    struct headphone_kernel_t *p_next;
+    unsigned i_refs;
+
+    /* Lookup key */
+    unsigned i_rate;
+    uint32_t i_physical_channels;
+    int i_dim;
+    bool b_compensate;
+
+    unsigned i_channels;
+    unsigned i_partitions;
+    unsigned i_nb_taps;
+    struct headphone_tap_t *p_taps;
+
+    float p_twiddles[HEADPHONE_FFT];/* HEADPHONE_FFT / 2 complex values */
+    uint16_t pi_bitrev[HEADPHONE_FFT];
+} headphone_kernel_t;
+
+static vlc_mutex_t kernels_lock = VLC_STATIC_MUTEX;
+static headphone_kernel_t *kernels = NULL;
+
+struct filter_sys_t
+{
+    headphone_kernel_t *p_kernel;
+
+    float *p_window;/* last HEADPHONE_FFT input samples, per channel */
+    float *p_fdl;/* frequency domain delay line, per channel and partition */
+    unsigned i_fdl_pos;
+    float *p_spectrum;/* HEADPHONE_FFT complex values */
+
+    float p_out[2 * HEADPHONE_BLOCK];/* pending stereo output */
+    unsigned i_pos;/* samples in the current block */
+};
+
 /*****************************************************************************
  * Init: initialize internal data structures
  * and computes the needed atomic operations
@@ -129,7 +186,7 @@ struct filter_sys_t
  *
  *          x-axis
  *  */
-static void ComputeChannelOperations( struct filter_sys_t * p_data
+static void ComputeChannelOperations( struct headphone_model_t * p_data
         , unsigned int i_rate, unsigned int i_next_atomic_operation
         , int i_source_channel_offset, double d_x, double d_z
         , double d_compensation_length, double d_channel_amplitude_factor )
@@ -143,8 +200,8 @@ static void ComputeChannelOperations( struct filter_sys_t * p_data
     p_data->p_atomic_operations[i_next_atomic_operation]
         .i_dest_channel_offset = 0;/* left */
     p_data->p_atomic_operations[i_next_atomic_operation]
-        .i_delay = (int)( sqrt( (-0.1-d_x)*(-0.1-d_x) + (0-d_z)*(0-d_z) )
-                          / d_c * i_rate - d_compensation_delay );
+        .d_delay = __MAX( 0., sqrt( (-0.1-d_x)*(-0.1-d_x) + (0-d_z)*(0-d_z) )
+                              / d_c * i_rate - d_compensation_delay );
     if( d_x < 0 )
     {
         p_data->p_atomic_operations[i_next_atomic_operation]
@@ -167,8 +224,8 @@ static void ComputeChannelOperations( struct filter_sys_t * p_data
     p_data->p_atomic_operations[i_next_atomic_operation + 1]
         .i_dest_channel_offset = 1;/* right */
     p_data->p_atomic_operations[i_next_atomic_operation + 1]
-        .i_delay = (int)( sqrt( (0.1-d_x)*(0.1-d_x) + (0-d_z)*(0-d_z) )
-                          / d_c * i_rate - d_compensation_delay );
+        .d_delay = __MAX( 0., sqrt( (0.1-d_x)*(0.1-d_x) + (0-d_z)*(0-d_z) )
+                              / d_c * i_rate - d_compensation_delay );
     if( d_x < 0 )
     {
         p_data->p_atomic_operations[i_next_atomic_operation + 1]
@@ -186,19 +243,18 @@ static void ComputeChannelOperations( struct filter_sys_t * p_data
     }
 }
 
-static int Init( vlc_object_t *p_this, struct filter_sys_t * p_data
+static int Init( struct headphone_model_t * p_data
         , unsigned int i_nb_channels, uint32_t i_physical_channels
-        , unsigned int i_rate )
+        , unsigned int i_rate, int i_dim, bool b_compensate )
 {
-    double d_x = var_InheritInteger( p_this, "headphone-dim" );
+    double d_x = i_dim;
     double d_z = d_x;
     double d_z_rear = -d_x/3;
     double d_min = 0;
     unsigned int i_next_atomic_operation;
     int i_source_channel_offset;
-    unsigned int i;
 
-    if( var_InheritBool( p_this, "headphone-compensate" ) )
+    if( b_compensate )
     {
         /* minimal distance to any speaker */
         if( i_physical_channels & AOUT_CHAN_REARCENTER )
@@ -304,129 +360,359 @@ static int Init( vlc_object_t *p_this, struct filter_sys_t * p_data
         i_source_channel_offset++;
     }
 
-    /* Initialize the overflow buffer
-     * we need it because the process induce a delay in the samples */
-    p_data->i_overflow_buffer_size = 0;
-    for( i = 0 ; i < p_data->i_nb_atomic_operations ; i++ )
+    return 0;
+}
+
+/*****************************************************************************
+ * FFT: in-place radix-2 complex transform of HEADPHONE_FFT points
+ *****************************************************************************/
+static void FFT( float *restrict p_z, const headphone_kernel_t *p_kernel,
+                 bool b_inverse )
+{
+    const float f_sign = b_inverse ? -1.f : 1.f;
+
+    for( unsigned i = 0; i < HEADPHONE_FFT; i++ )
     {
-        if( p_data->i_overflow_buffer_size
-                < p_data->p_atomic_operations[i].i_delay * 2 * sizeof (float) )
+        unsigned j = p_kernel->pi_bitrev[i];
+        if( i < j )
         {
-            p_data->i_overflow_buffer_size
-                = p_data->p_atomic_operations[i].i_delay * 2 * sizeof (float);
+            float re = p_z[2*i], im = p_z[2*i+1];
+            p_z[2*i] = p_z[2*j];
+            p_z[2*i+1] = p_z[2*j+1];
+            p_z[2*j] = re;
+            p_z[2*j+1] = im;
         }
     }
-    p_data->p_overflow_buffer = (float *)malloc( p_data->i_overflow_buffer_size );
-    if( p_data->p_overflow_buffer == NULL )
+
+    for( unsigned i_len = 2; i_len <= HEADPHONE_FFT; i_len <<= 1 )
     {
-        free( p_data->p_atomic_operations );
-        return -1;
-    }
-    memset( p_data->p_overflow_buffer, 0 , p_data->i_overflow_buffer_size );
+        const unsigned i_half = i_len / 2;
+        const unsigned i_step = HEADPHONE_FFT / i_len;
 
-    return 0;
+        for( unsigned i = 0; i < HEADPHONE_FFT; i += i_len )
+            for( unsigned j = 0; j < i_half; j++ )
+            {
+                const float wr = p_kernel->p_twiddles[2*j*i_step];
+                const float wi = f_sign * p_kernel->p_twiddles[2*j*i_step+1];
+                float *a = &p_z[2*(i+j)], *b = &p_z[2*(i+j+i_half)];
+                const float tr = b[0] * wr - b[1] * wi;
+                const float ti = b[0] * wi + b[1] * wr;
+
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+    }
 }
 
 /*****************************************************************************
- * DoWork: convert a buffer
+ * KernelNew: computes the partitioned responses of a speaker layout
  *****************************************************************************/
-static void DoWork( filter_t * p_filter,
-                    block_t * p_in_buf, block_t * p_out_buf )
+static headphone_kernel_t *KernelNew( unsigned i_nb_channels,
+                                      uint32_t i_physical_channels,
+                                      unsigned i_rate, int i_dim,
+                                      bool b_compensate )
 {
-    filter_sys_t *p_sys = p_filter->p_sys;
-    int i_input_nb = aout_FormatNbChannels( &p_filter->fmt_in.audio );
-    int i_output_nb = aout_FormatNbChannels( &p_filter->fmt_out.audio );
+    struct headphone_model_t model;
+
+    if( Init( &model, i_nb_channels, i_physical_channels, i_rate,
+              i_dim, b_compensate ) < 0 )
+        return NULL;
 
-    float * p_in = (float*) p_in_buf->p_buffer;
-    float * p_out;
-    uint8_t * p_overflow;
-    uint8_t * p_end_overflow;
-    uint8_t * p_slide;
+    /* The leading silence common to all the responses is cut, up to one
+     * block, to hide the latency of the block processing */
+    double d_min_delay = HUGE_VAL, d_max_delay = 0.;
+    for( unsigned i = 0; i < model.i_nb_atomic_operations; i++ )
+    {
+        d_min_delay = __MIN( d_min_delay, model.p_atomic_operations[i].d_delay );
+        d_max_delay = __MAX( d_max_delay, model.p_atomic_operations[i].d_delay );
+    }
+    const int i_advance = __MIN( HEADPHONE_BLOCK,
+                                 __MAX( 0, (int)d_min_delay - HEADPHONE_SINC ) );
+    const double d_length = ceil( d_max_delay );
+    const size_t i_length = (size_t)d_length + HEADPHONE_SINC + 1 - i_advance;
+    const unsigned i_partitions = (i_length + HEADPHONE_BLOCK - 1)
+                                / HEADPHONE_BLOCK;
+    const size_t i_response = i_partitions * HEADPHONE_BLOCK;
+
+    headphone_kernel_t *p_kernel = calloc( 1, sizeof(*p_kernel) );
+    float *p_responses = calloc( i_nb_channels * 2 * i_response,
+                                 sizeof(float) );
+    if( unlikely(p_kernel == NULL || p_responses == NULL) )
+        goto error;
+
+    /* Each atomic operation is a gain and a fractional delay, interpolated
+     * with a Blackman-windowed sinc */
+    for( unsigned i = 0; i < model.i_nb_atomic_operations; i++ )
+    {
+        const struct atomic_operation_t *p_op = &model.p_atomic_operations[i];
+        float *p_h = &p_responses[(p_op->i_source_channel_offset * 2
+                                   + p_op->i_dest_channel_offset) * i_response];
+        const int i_first = ceil( p_op->d_delay ) - HEADPHONE_SINC;
+        const int i_last = floor( p_op->d_delay ) + HEADPHONE_SINC;
 
-    size_t i_overflow_size;     /* in bytes */
-    size_t i_out_size;          /* in bytes */
+        for( int k = i_first; k <= i_last; k++ )
+        {
+            const int t = k - i_advance;
+            if( t < 0 || (size_t)t >= i_response )
+                continue;
+
+            const double x = k - p_op->d_delay;
+            const double w = 0.42 + 0.5 * cos( M_PI * x / HEADPHONE_SINC )
+                           + 0.08 * cos( 2. * M_PI * x / HEADPHONE_SINC );
+            const double sinc = fabs( x ) < 1e-9 ? 1.
+                              : sin( M_PI * x ) / ( M_PI * x );
+            p_h[t] += p_op->d_amplitude_factor * sinc * w;
+        }
+    }
 
-    unsigned int i, j;
+    for( unsigned i = 0; i < HEADPHONE_FFT / 2; i++ )
+    {
+        p_kernel->p_twiddles[2*i] = cos( 2. * M_PI * i / HEADPHONE_FFT );
+        p_kernel->p_twiddles[2*i+1] = -sin( 2. * M_PI * i / HEADPHONE_FFT );
+    }
+    for( unsigned i = 0; i < HEADPHONE_FFT; i++ )
+    {
+        unsigned j = 0;
+        for( unsigned b = 1; b < HEADPHONE_FFT; b <<= 1 )
+            j = (j << 1) | !!(i & b);
+        p_kernel->pi_bitrev[i] = j;
+    }
 
-    int i_source_channel_offset;
-    int i_dest_channel_offset;
-    unsigned int i_delay;
-    double d_amplitude_factor;
+    /* Only the partitions holding part of a response are kept */
+    p_kernel->p_taps = malloc( i_nb_channels * 2 * i_partitions
+                               * sizeof(*p_kernel->p_taps) );
+    if( unlikely(p_kernel->p_taps == NULL) )
+        goto error;
 
-    p_out = (float *)p_out_buf->p_buffer;
-    i_out_size = p_out_buf->i_buffer;
+    for( unsigned i_channel = 0; i_channel < i_nb_channels; i_channel++ )
+        for( unsigned i_ear = 0; i_ear < 2; i_ear++ )
+            for( unsigned p = 0; p < i_partitions; p++ )
+            {
+                const float *p_h = &p_responses[(i_channel * 2 + i_ear)
+                                                * i_response
+                                                + p * HEADPHONE_BLOCK];
+                bool b_silent = true;
+                for( unsigned i = 0; i < HEADPHONE_BLOCK && b_silent; i++ )
+                    b_silent = p_h[i] == 0.f;
+                if( b_silent )
+                    continue;
+
+                float *p_z = calloc( 2 * HEADPHONE_FFT, sizeof(float) );
+                if( unlikely(p_z == NULL) )
+                    goto error;
+                /* The inverse transform scale is applied here once */
+                for( unsigned i = 0; i < HEADPHONE_BLOCK; i++ )
+                    p_z[2*i] = p_h[i] / HEADPHONE_FFT;
+                FFT( p_z, p_kernel, false );
+
+                struct headphone_tap_t *p_tap =
+                    &p_kernel->p_taps[p_kernel->i_nb_taps++];
+                p_tap->i_channel = i_channel;
+                p_tap->i_ear = i_ear;
+                p_tap->i_partition = p;
+                p_tap->p_spectrum = p_z;
+            }
 
-    /* Slide the overflow buffer */
-    p_overflow = (uint8_t *) p_sys->p_overflow_buffer;
-    i_overflow_size = p_sys->i_overflow_buffer_size;
-    p_end_overflow = p_overflow + i_overflow_size;
+    p_kernel->i_refs = 1;
+    p_kernel->i_rate = i_rate;
+    p_kernel->i_physical_channels = i_physical_channels;
+    p_kernel->i_dim = i_dim;
+    p_kernel->b_compensate = b_compensate;
+    p_kernel->i_channels = i_nb_channels;
+    p_kernel->i_partitions = i_partitions;
 
-    memset( p_out, 0, i_out_size );
-    memcpy( p_out, p_overflow, __MIN( i_out_size, i_overflow_size ) );
+    free( p_responses );
+    free( model.p_atomic_operations );
+    return p_kernel;
 
-    p_slide = (uint8_t *) p_sys->p_overflow_buffer;
-    while( p_slide < p_end_overflow )
+error:
+    if( p_kernel != NULL )
     {
-        size_t i_bytes_copied;
+        for( unsigned i = 0; i < p_kernel->i_nb_taps; i++ )
+            free( p_kernel->p_taps[i].p_spectrum );
+        free( p_kernel->p_taps );
+        free( p_kernel );
+    }
+    free( p_responses );
+    free( model.p_atomic_operations );
+    return NULL;
+}
 
-        if( p_slide + i_out_size < p_end_overflow )
+static void KernelDelete( headphone_kernel_t *p_kernel )
+{
+    for( unsigned i = 0; i < p_kernel->i_nb_taps; i++ )
+        free( p_kernel->p_taps[i].p_spectrum );
+    free( p_kernel->p_taps );
+    free( p_kernel );
+}
+
+/*****************************************************************************
+ * KernelHold: finds or computes the kernel of a speaker layout
+ *****************************************************************************/
+static headphone_kernel_t *KernelHold( unsigned i_nb_channels,
+                                       uint32_t i_physical_channels,
+                                       unsigned i_rate, int i_dim,
+                                       bool b_compensate )
+{
+    headphone_kernel_t *p_kernel;
+
+    vlc_mutex_lock( &kernels_lock );
+    for( p_kernel = kernels; p_kernel != NULL; p_kernel = p_kernel->p_next )
+        if( p_kernel->i_rate == i_rate
+         && p_kernel->i_physical_channels == i_physical_channels
+         && p_kernel->i_channels == i_nb_channels
+         && p_kernel->i_dim == i_dim
+         && p_kernel->b_compensate == b_compensate )
         {
-            memset( p_slide, 0, i_out_size );
-            if( p_slide + 2 * i_out_size < p_end_overflow )
-                i_bytes_copied = i_out_size;
-            else
-                i_bytes_copied = p_end_overflow - ( p_slide + i_out_size );
-            memcpy( p_slide, p_slide + i_out_size, i_bytes_copied );
+            p_kernel->i_refs++;
+            break;
         }
-        else
+
+    if( p_kernel == NULL )
+    {
+        p_kernel = KernelNew( i_nb_channels, i_physical_channels, i_rate,
+                              i_dim, b_compensate );
+        if( p_kernel != NULL )
         {
-            i_bytes_copied = p_end_overflow - p_slide;
-            memset( p_slide, 0, i_bytes_copied );
+            p_kernel->p_next = kernels;
+            kernels = p_kernel;
         }
-        p_slide += i_bytes_copied;
     }
+    vlc_mutex_unlock( &kernels_lock );
+    return p_kernel;
+}
+
+static void KernelRelease( headphone_kernel_t *p_kernel )
+{
+    vlc_mutex_lock( &kernels_lock );
+    assert( p_kernel->i_refs > 0 );
+    if( --p_kernel->i_refs == 0 )
+    {
+        headphone_kernel_t **pp = &kernels;
+        while( *pp != p_kernel )
+            pp = &(*pp)->p_next;
+        *pp = p_kernel->p_next;
+        KernelDelete( p_kernel );
+    }
+    vlc_mutex_unlock( &kernels_lock );
+}
 
-    /* apply the atomic operations */
-    for( i = 0; i < p_sys->i_nb_atomic_operations; i++ )
+/*****************************************************************************
+ * ProcessBlock: convolves the last block of input samples
+ *****************************************************************************/
+static void ProcessBlock( filter_sys_t *p_sys )
+{
+    const headphone_kernel_t *p_kernel = p_sys->p_kernel;
+    const unsigned i_channels = p_kernel->i_channels;
+    const unsigned i_partitions = p_kernel->i_partitions;
+    float *p_z = p_sys->p_spectrum;
+
+#define FDL(c, p) (&p_sys->p_fdl[((c) * i_partitions + (p)) * 2 * HEADPHONE_FFT])
+
+    /* Transform the input windows, two real channels per complex FFT */
+    for( unsigned c = 0; c < i_channels; c += 2 )
     {
-        /* shorter variable names */
-        i_source_channel_offset
-            = p_sys->p_atomic_operations[i].i_source_channel_offset;
-        i_dest_channel_offset
-            = p_sys->p_atomic_operations[i].i_dest_channel_offset;
-        i_delay = p_sys->p_atomic_operations[i].i_delay;
-        d_amplitude_factor
-            = p_sys->p_atomic_operations[i].d_amplitude_factor;
+        const float *p_x1 = &p_sys->p_window[c * HEADPHONE_FFT];
+        const float *p_x2 = c + 1 < i_channels ? p_x1 + HEADPHONE_FFT : NULL;
+        float *p_X1 = FDL( c, p_sys->i_fdl_pos );
 
-        if( p_out_buf->i_nb_samples > i_delay )
+        for( unsigned i = 0; i < HEADPHONE_FFT; i++ )
         {
-            /* current buffer coefficients */
-            for( j = 0; j < p_out_buf->i_nb_samples - i_delay; j++ )
-            {
-                ((float*)p_out)[ (i_delay+j)*i_output_nb + i_dest_channel_offset ]
-                    += p_in[ j * i_input_nb + i_source_channel_offset ]
-                       * d_amplitude_factor;
-            }
+            p_z[2*i] = p_x1[i];
+            p_z[2*i+1] = p_x2 != NULL ? p_x2[i] : 0.f;
+        }
+        FFT( p_z, p_kernel, false );
+
+        if( p_x2 == NULL )
+        {
+            memcpy( p_X1, p_z, 2 * HEADPHONE_FFT * sizeof(float) );
+            continue;
+        }
+
+        /* Split the spectra using their hermitian symmetry */
+        float *p_X2 = FDL( c + 1, p_sys->i_fdl_pos );
+        for( unsigned i = 0; i < HEADPHONE_FFT; i++ )
+        {
+            const unsigned m = (HEADPHONE_FFT - i) & (HEADPHONE_FFT - 1);
+            const float zr = p_z[2*i], zi = p_z[2*i+1];
+            const float mr = p_z[2*m], mi = p_z[2*m+1];
+
+            p_X1[2*i] = (zr + mr) * .5f;
+            p_X1[2*i+1] = (zi - mi) * .5f;
+            p_X2[2*i] = (zi + mi) * .5f;
+            p_X2[2*i+1] = (mr - zr) * .5f;
+        }
+    }
 
-            /* overflow buffer coefficients */
-            for( j = 0; j < i_delay; j++ )
+    /* Accumulate the products with the responses; the output is real for
+     * both ears, so the right ear is put in the imaginary part and both
+     * come out of a single inverse transform */
+    memset( p_z, 0, 2 * HEADPHONE_FFT * sizeof(float) );
+    for( unsigned t = 0; t < p_kernel->i_nb_taps; t++ )
+    {
+        const struct headphone_tap_t *p_tap = &p_kernel->p_taps[t];
+        const float *p_X = FDL( p_tap->i_channel,
+                                (p_sys->i_fdl_pos + i_partitions
+                                 - p_tap->i_partition) % i_partitions );
+        const float *p_H = p_tap->p_spectrum;
+
+        if( p_tap->i_ear == 0 )
+            for( unsigned i = 0; i < HEADPHONE_FFT; i++ )
             {
-                ((float*)p_overflow)[ j*i_output_nb + i_dest_channel_offset ]
-                    += p_in[ (p_out_buf->i_nb_samples - i_delay + j)
-                       * i_input_nb + i_source_channel_offset ]
-                       * d_amplitude_factor;
+                p_z[2*i] += p_X[2*i] * p_H[2*i] - p_X[2*i+1] * p_H[2*i+1];
+                p_z[2*i+1] += p_X[2*i] * p_H[2*i+1] + p_X[2*i+1] * p_H[2*i];
             }
-        }
         else
-        {
-            /* overflow buffer coefficients only */
-            for( j = 0; j < p_out_buf->i_nb_samples; j++ )
+            for( unsigned i = 0; i < HEADPHONE_FFT; i++ )
             {
-                ((float*)p_overflow)[ (i_delay - p_out_buf->i_nb_samples + j)
-                                        * i_output_nb + i_dest_channel_offset ]
-                    += p_in[ j * i_input_nb + i_source_channel_offset ]
-                       * d_amplitude_factor;
+                p_z[2*i] -= p_X[2*i] * p_H[2*i+1] + p_X[2*i+1] * p_H[2*i];
+                p_z[2*i+1] += p_X[2*i] * p_H[2*i] - p_X[2*i+1] * p_H[2*i+1];
             }
+    }
+#undef FDL
+
+    FFT( p_z, p_kernel, true );
+
+    /* Overlap-save: only the second half is free of circular aliasing */
+    memcpy( p_sys->p_out, &p_z[HEADPHONE_FFT],
+            2 * HEADPHONE_BLOCK * sizeof(float) );
+
+    p_sys->i_fdl_pos = (p_sys->i_fdl_pos + 1) % i_partitions;
+    for( unsigned c = 0; c < i_channels; c++ )
+        memcpy( &p_sys->p_window[c * HEADPHONE_FFT],
+                &p_sys->p_window[c * HEADPHONE_FFT + HEADPHONE_BLOCK],
+                HEADPHONE_BLOCK * sizeof(float) );
+}
+
+/*****************************************************************************
+ * DoWork: convert a buffer
+ *****************************************************************************/
+static void DoWork( filter_t * p_filter,
+                    block_t * p_in_buf, block_t * p_out_buf )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_input_nb = aout_FormatNbChannels( &p_filter->fmt_in.audio );
+    const unsigned i_channels = __MIN( i_input_nb, p_sys->p_kernel->i_channels );
+    const float *p_in = (const float *)p_in_buf->p_buffer;
+    float *p_out = (float *)p_out_buf->p_buffer;
+
+    /* The output lags one block behind the input, minus the leading
+     * silence cut from the responses */
+    for( unsigned j = 0; j < p_in_buf->i_nb_samples; j++ )
+    {
+        for( unsigned c = 0; c < i_channels; c++ )
+            p_sys->p_window[c * HEADPHONE_FFT + HEADPHONE_BLOCK + p_sys->i_pos]
+                = p_in[j * i_input_nb + c];
+
+        p_out[2*j] = p_sys->p_out[2*p_sys->i_pos];
+        p_out[2*j+1] = p_sys->p_out[2*p_sys->i_pos+1];
+
+        if( ++p_sys->i_pos == HEADPHONE_BLOCK )
+        {
+            ProcessBlock( p_sys );
+            p_sys->i_pos = 0;
         }
     }
 }
@@ -451,23 +737,38 @@ static int OpenFilter( vlc_object_t *p_this )
     }
 
     /* Allocate the memory needed to store the module's structure */
-    p_sys = p_filter->p_sys = malloc( sizeof(struct filter_sys_t) );
+    p_sys = p_filter->p_sys = calloc( 1, sizeof(struct filter_sys_t) );
     if( p_sys == NULL )
         return VLC_ENOMEM;
-    p_sys->i_overflow_buffer_size = 0;
-    p_sys->p_overflow_buffer = NULL;
-    p_sys->i_nb_atomic_operations = 0;
-    p_sys->p_atomic_operations = NULL;
 
-    if( Init( VLC_OBJECT(p_filter), p_sys
-                , aout_FormatNbChannels ( &(p_filter->fmt_in.audio) )
+    p_sys->p_kernel = KernelHold(
+                aout_FormatNbChannels ( &(p_filter->fmt_in.audio) )
                 , p_filter->fmt_in.audio.i_physical_channels
-                , p_filter->fmt_in.audio.i_rate ) < 0 )
+                , p_filter->fmt_in.audio.i_rate
+                , var_InheritInteger( p_filter, "headphone-dim" )
+                , var_InheritBool( p_filter, "headphone-compensate" ) );
+    if( p_sys->p_kernel == NULL )
     {
         free( p_sys );
         return VLC_EGENERIC;
     }
 
+    const unsigned i_channels = p_sys->p_kernel->i_channels;
+    p_sys->p_window = calloc( i_channels * HEADPHONE_FFT, sizeof(float) );
+    p_sys->p_fdl = calloc( i_channels * p_sys->p_kernel->i_partitions
+                           * 2 * HEADPHONE_FFT, sizeof(float) );
+    p_sys->p_spectrum = malloc( 2 * HEADPHONE_FFT * sizeof(float) );
+    if( unlikely(p_sys->p_window == NULL || p_sys->p_fdl == NULL
+              || p_sys->p_spectrum == NULL) )
+    {
+        free( p_sys->p_spectrum );
+        free( p_sys->p_fdl );
+        free( p_sys->p_window );
+        KernelRelease( p_sys->p_kernel );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
     /* Request a specific format if not already compatible */
     p_filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
     p_filter->fmt_out.audio.i_format = VLC_CODEC_FL32;
@@ -491,10 +792,13 @@ static int OpenFilter( vlc_object_t *p_this )
 static void CloseFilter( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
 
-    free( p_filter->p_sys->p_overflow_buffer );
-    free( p_filter->p_sys->p_atomic_operations );
-    free( p_filter->p_sys );
+    free( p_sys->p_spectrum );
+    free( p_sys->p_fdl );
+    free( p_sys->p_window );
+    KernelRelease( p_sys->p_kernel );
+    free( p_sys );
 }
 
 static block_t *Convert( filter_t *p_filter, block_t *p_block )
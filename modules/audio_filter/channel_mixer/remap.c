@@ -198,16 +198,25 @@ static void RemapAdd##name( filter_t *p_filter, \
     const type *p_src = p_srcorig; \
     type *p_dest = p_destorig; \
  \
-    for( int i = 0; i < i_nb_samples; i++ ) \
+    if( p_sys->b_normalize ) \
     { \
-        for( uint8_t in_ch = 0; in_ch < i_nb_in_channels; in_ch++ ) \
+        for( int i = 0; i < i_nb_samples; i++ ) \
         { \
-            uint8_t out_ch = p_sys->map_ch[ in_ch ]; \
-            if( p_sys->b_normalize ) \
+            for( uint8_t in_ch = 0; in_ch < i_nb_in_channels; in_ch++ ) \
+            { \
+                uint8_t out_ch = p_sys->map_ch[ in_ch ]; \
                 p_dest[ out_ch ] += p_src[ in_ch ] / p_sys->nb_in_ch[ out_ch ]; \
-            else \
-                p_dest[ out_ch ] += p_src[ in_ch ]; \
+            } \
+            p_src  += i_nb_in_channels; \
+            p_dest += i_nb_out_channels; \
         } \
+        return; \
+    } \
+ \
+    for( int i = 0; i < i_nb_samples; i++ ) \
+    { \
+        for( uint8_t in_ch = 0; in_ch < i_nb_in_channels; in_ch++ ) \
+            p_dest[ p_sys->map_ch[ in_ch ] ] += p_src[ in_ch ]; \
         p_src  += i_nb_in_channels; \
         p_dest += i_nb_out_channels; \
     } \
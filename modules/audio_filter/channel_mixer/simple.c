@@ -27,6 +27,7 @@
 #ifdef HAVE_CONFIG_H
 # include "config.h"
 #endif
+#include <assert.h>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -261,6 +262,9 @@ static void DoWork_6_1_to_5_x( filter_t * p_filter,  block_t * p_in_buf, block_t
 #if defined (CAN_COMPILE_ARM)
 #include "simple_neon.h"
 #define GET_WORK(in, out) GET_WORK_##in##_to_##out##_neon()
+#elif defined (CAN_COMPILE_SSE)
+#include "simple_sse.h"
+#define GET_WORK(in, out) GET_WORK_##in##_to_##out##_sse()
 #else
 #define GET_WORK(in, out) DoWork_##in##_to_##out
 #endif
@@ -367,32 +371,14 @@ static block_t *Filter( filter_t *p_filter, block_t *p_block )
         return NULL;
     }
 
-    size_t i_out_size = p_block->i_nb_samples *
-      p_filter->fmt_out.audio.i_bitspersample *
-        p_filter->fmt_out.audio.i_channels / 8;
-
-    block_t *p_out = block_Alloc( i_out_size );
-    if( !p_out )
-    {
-        msg_Warn( p_filter, "can't get output buffer" );
-        block_Release( p_block );
-        return NULL;
-    }
-
-    p_out->i_nb_samples = p_block->i_nb_samples;
-    p_out->i_dts = p_block->i_dts;
-    p_out->i_pts = p_block->i_pts;
-    p_out->i_length = p_block->i_length;
-
     int i_input_nb = aout_FormatNbChannels( &p_filter->fmt_in.audio );
     int i_output_nb = aout_FormatNbChannels( &p_filter->fmt_out.audio );
-    p_out->i_nb_samples = p_block->i_nb_samples;
-    p_out->i_buffer = p_block->i_buffer * i_output_nb / i_input_nb;
-
-    work( p_filter, p_block, p_out );
-
-    block_Release( p_block );
 
-    return p_out;
+    /* All the conversions remove channels, and each output frame is written
+     * after its input frame has been read: downmix in place. */
+    assert( i_output_nb < i_input_nb );
+    work( p_filter, p_block, p_block );
+    p_block->i_buffer = p_block->i_buffer * i_output_nb / i_input_nb;
+    return p_block;
 }
 
@@ -0,0 +1,114 @@
+/*****************************************************************************
+ * simple_sse.h : simple channel mixer plug-in using SSE intrinsics
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc_cpu.h>
+#include <xmmintrin.h>
+
+/* Only the downmixes to stereo right now. Like the C versions, each input
+ * frame is entirely read before its output frame is written, so that the
+ * conversion can be done in place. The operations are also done in the same
+ * order, so that the results are identical. */
+
+VLC_SSE
+static void DoWork_7_x_to_2_0_sse( filter_t *p_filter, block_t *p_in_buf,
+                                   block_t *p_out_buf )
+{
+    float *p_dest = (float *)p_out_buf->p_buffer;
+    const float *p_src = (const float *)p_in_buf->p_buffer;
+    const unsigned i_in = 7 + ((p_filter->fmt_in.audio.i_physical_channels
+                                & AOUT_CHAN_LFE) != 0);
+    const __m128 k = _mm_set1_ps( 0.7071f );
+    const __m128 quarter = _mm_set1_ps( 0.25f );
+
+    for( int i = p_in_buf->i_nb_samples; i--; )
+    {
+        __m128 front = _mm_loadu_ps( p_src ); /* L R ML MR */
+        __m128 rear = _mm_loadl_pi( _mm_setzero_ps(),
+                                    (const __m64 *)(p_src + 4) ); /* RL RR */
+        __m128 ctr = _mm_mul_ps( _mm_set1_ps( p_src[6] ), k );
+        __m128 mid = _mm_movehl_ps( front, front );
+
+        __m128 out = _mm_add_ps( ctr, front );
+        out = _mm_add_ps( out, _mm_mul_ps( mid, quarter ) );
+        out = _mm_add_ps( out, _mm_mul_ps( rear, quarter ) );
+        _mm_storel_pi( (__m64 *)p_dest, out );
+
+        p_src += i_in;
+        p_dest += 2;
+    }
+}
+
+VLC_SSE
+static void DoWork_5_x_to_2_0_sse( filter_t *p_filter, block_t *p_in_buf,
+                                   block_t *p_out_buf )
+{
+    float *p_dest = (float *)p_out_buf->p_buffer;
+    const float *p_src = (const float *)p_in_buf->p_buffer;
+    const unsigned i_in = 5 + ((p_filter->fmt_in.audio.i_physical_channels
+                                & AOUT_CHAN_LFE) != 0);
+    const __m128 k = _mm_set1_ps( 0.7071f );
+
+    for( int i = p_in_buf->i_nb_samples; i--; )
+    {
+        __m128 front = _mm_loadu_ps( p_src ); /* L R RL RR */
+        __m128 rear = _mm_movehl_ps( front, front );
+        __m128 ctr = _mm_set1_ps( p_src[4] );
+
+        __m128 out = _mm_mul_ps( _mm_add_ps( ctr, rear ), k );
+        out = _mm_add_ps( front, out );
+        _mm_storel_pi( (__m64 *)p_dest, out );
+
+        p_src += i_in;
+        p_dest += 2;
+    }
+}
+
+#define SSE_WRAPPER(in, out) \
+    static inline void (*GET_WORK_##in##_to_##out##_sse())(filter_t*, block_t*, block_t*) \
+    { \
+        return vlc_CPU_SSE() ? DoWork_##in##_to_##out##_sse : DoWork_##in##_to_##out; \
+    }
+
+SSE_WRAPPER(7_x,2_0)
+SSE_WRAPPER(5_x,2_0)
+
+/* TODO: the following conversions are not handled in SSE */
+
+#define C_WRAPPER(in, out) \
+    static inline void (*GET_WORK_##in##_to_##out##_sse())(filter_t*, block_t*, block_t*) \
+    { \
+        return DoWork_##in##_to_##out; \
+    }
+
+C_WRAPPER(4_0,2_0)
+C_WRAPPER(3_x,2_0)
+C_WRAPPER(7_x,1_0)
+C_WRAPPER(5_x,1_0)
+C_WRAPPER(7_x,4_0)
+C_WRAPPER(5_x,4_0)
+C_WRAPPER(4_0,1_0)
+C_WRAPPER(3_x,1_0)
+C_WRAPPER(2_x,1_0)
+C_WRAPPER(6_1,2_0)
+C_WRAPPER(7_x,5_x)
+C_WRAPPER(6_1,5_x)
@@ -83,71 +83,95 @@ static int Open(vlc_object_t *object)
 }
 
 
+/**
+ * Gets the output buffer of a widening conversion.
+ *
+ * The input block is recycled if it has enough tail room, so the samples
+ * must be converted backward, starting from the last one.
+ */
+static block_t *Grow(block_t *bsrc, size_t size)
+{
+    if ((size_t)(bsrc->p_start + bsrc->i_size - bsrc->p_buffer) >= size)
+    {
+        bsrc->i_buffer = size;
+        return bsrc;
+    }
+
+    block_t *bdst = block_Alloc(size);
+    if (likely(bdst != NULL))
+        block_CopyProperties(bdst, bsrc);
+    return bdst;
+}
+
 /*** from U8 ***/
 static block_t *U8toS16(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    size_t count = bsrc->i_buffer;
+    block_t *bdst = Grow(bsrc, count * 2);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    uint8_t *src = (uint8_t *)bsrc->p_buffer;
-    int16_t *dst = (int16_t *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer; i--;)
-        *dst++ = ((*src++) << 8) - 0x8000;
+    uint8_t *src = (uint8_t *)bsrc->p_buffer + count;
+    int16_t *dst = (int16_t *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
+        *--dst = ((*--src) << 8) - 0x8000;
 out:
-    block_Release(bsrc);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     VLC_UNUSED(filter);
     return bdst;
 }
 
 static block_t *U8toFl32(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 4);
+    size_t count = bsrc->i_buffer;
+    block_t *bdst = Grow(bsrc, count * 4);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    uint8_t *src = (uint8_t *)bsrc->p_buffer;
-    float   *dst = (float *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer; i--;)
-        *dst++ = ((float)((*src++) - 128)) / 128.f;
+    uint8_t *src = (uint8_t *)bsrc->p_buffer + count;
+    float   *dst = (float *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
+        *--dst = ((float)((*--src) - 128)) / 128.f;
 out:
-    block_Release(bsrc);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     VLC_UNUSED(filter);
     return bdst;
 }
 
 static block_t *U8toS32(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 4);
+    size_t count = bsrc->i_buffer;
+    block_t *bdst = Grow(bsrc, count * 4);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    uint8_t *src = (uint8_t *)bsrc->p_buffer;
-    int32_t *dst = (int32_t *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer; i--;)
-        *dst++ = ((*src++) << 24) - 0x80000000;
+    uint8_t *src = (uint8_t *)bsrc->p_buffer + count;
+    int32_t *dst = (int32_t *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
+        *--dst = ((*--src) << 24) - 0x80000000;
 out:
-    block_Release(bsrc);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     VLC_UNUSED(filter);
     return bdst;
 }
 
 static block_t *U8toFl64(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 8);
+    size_t count = bsrc->i_buffer;
+    block_t *bdst = Grow(bsrc, count * 8);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    uint8_t *src = (uint8_t *)bsrc->p_buffer;
-    double  *dst = (double *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer; i--;)
-        *dst++ = ((double)((*src++) - 128)) / 128.;
+    uint8_t *src = (uint8_t *)bsrc->p_buffer + count;
+    double  *dst = (double *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
+        *--dst = ((double)((*--src) - 128)) / 128.;
 out:
-    block_Release(bsrc);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     VLC_UNUSED(filter);
     return bdst;
 }
@@ -168,67 +192,69 @@ static block_t *S16toU8(filter_t *filter, block_t *b)
 
 static block_t *S16toFl32(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    size_t count = bsrc->i_buffer / 2;
+    block_t *bdst = Grow(bsrc, count * 4);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    int16_t *src = (int16_t *)bsrc->p_buffer;
-    float   *dst = (float *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer / 2; i--;)
+    int16_t *src = (int16_t *)bsrc->p_buffer + count;
+    float   *dst = (float *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
 #if 0
         /* Slow version */
-        *dst++ = (float)*src++ / 32768.f;
+        *--dst = (float)*--src / 32768.f;
 #else
     {   /* This is Walken's trick based on IEEE float format. On my PIII
          * this takes 16 seconds to perform one billion conversions, instead
          * of 19 seconds for the above division. */
         union { float f; int32_t i; } u;
-        u.i = *src++ + 0x43c00000;
-        *dst++ = u.f - 384.f;
+        u.i = *--src + 0x43c00000;
+        *--dst = u.f - 384.f;
     }
 #endif
 out:
-    block_Release(bsrc);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     VLC_UNUSED(filter);
     return bdst;
 }
 
 static block_t *S16toS32(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    size_t count = bsrc->i_buffer / 2;
+    block_t *bdst = Grow(bsrc, count * 4);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    int16_t *src = (int16_t *)bsrc->p_buffer;
-    int32_t *dst = (int32_t *)bdst->p_buffer;
-    for (int i = bsrc->i_buffer / 2; i--;)
-        *dst++ = *src++ << 16;
+    int16_t *src = (int16_t *)bsrc->p_buffer + count;
+    int32_t *dst = (int32_t *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
+        *--dst = *--src << 16;
 out:
-    block_Release(bsrc);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     VLC_UNUSED(filter);
     return bdst;
 }
 
 static block_t *S16toFl64(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 4);
+    size_t count = bsrc->i_buffer / 2;
+    block_t *bdst = Grow(bsrc, count * 8);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    int16_t *src = (int16_t *)bsrc->p_buffer;
-    float   *dst = (float *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer / 2; i--;)
-        *dst++ = (double)*src++ / 32768.;
+    int16_t *src = (int16_t *)bsrc->p_buffer + count;
+    double  *dst = (double *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
+        *--dst = (double)*--src / 32768.;
 out:
-    block_Release(bsrc);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     VLC_UNUSED(filter);
     return bdst;
 }
 
-
 /*** from FL32 ***/
 static block_t *Fl32toU8(filter_t *filter, block_t *b)
 {
@@ -299,22 +325,22 @@ static block_t *Fl32toS32(filter_t *filter, block_t *b)
 
 static block_t *Fl32toFl64(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    size_t count = bsrc->i_buffer / 4;
+    block_t *bdst = Grow(bsrc, count * 8);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    float  *src = (float *)bsrc->p_buffer;
-    double *dst = (double *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer / 4; i--;)
-        *(dst++) = *(src++);
+    float  *src = (float *)bsrc->p_buffer + count;
+    double *dst = (double *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
+        *--dst = *--src;
 out:
-    block_Release(bsrc);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     VLC_UNUSED(filter);
     return bdst;
 }
 
-
 /*** from S32N ***/
 static block_t *S32toU8(filter_t *filter, block_t *b)
 {
@@ -352,22 +378,22 @@ static block_t *S32toFl32(filter_t *filter, block_t *b)
 
 static block_t *S32toFl64(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    size_t count = bsrc->i_buffer / 4;
+    block_t *bdst = Grow(bsrc, count * 8);
     if (unlikely(bdst == NULL))
         goto out;
 
-    block_CopyProperties(bdst, bsrc);
-    int32_t *src = (int32_t*)bsrc->p_buffer;
-    double  *dst = (double *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer / 4; i--;)
-        *dst++ = (double)(*src++) / 2147483648.;
+    int32_t *src = (int32_t*)bsrc->p_buffer + count;
+    double  *dst = (double *)bdst->p_buffer + count;
+    for (size_t i = count; i--;)
+        *--dst = (double)(*--src) / 2147483648.;
 out:
     VLC_UNUSED(filter);
-    block_Release(bsrc);
+    if (bdst != bsrc)
+        block_Release(bsrc);
     return bdst;
 }
 
-
 /*** from FL64 ***/
 static block_t *Fl64toU8(filter_t *filter, block_t *b)
 {
@@ -415,6 +441,7 @@ static block_t *Fl64toFl32(filter_t *filter, block_t *b)
     for (size_t i = b->i_buffer / 8; i--;)
         *(dst++) = *(src++);
 
+    b->i_buffer /= 2;
     VLC_UNUSED(filter);
     return b;
 }
@@ -37,6 +37,10 @@
 
 #include <vlc_aout.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
+#ifdef CAN_COMPILE_SSE
+# include <xmmintrin.h>
+#endif
 
 #include "equalizer_presets.h"
 
@@ -114,13 +118,13 @@ struct filter_sys_t
     float f_gamp;   /* Global preamp */
     bool b_2eqz;
 
-    /* Filter state */
+    /* Filter state (previous and second previous outputs of each band) */
     float x[32][2];
-    float y[32][128][2];
+    float y[32][2][128];
 
     /* Second filter state */
     float x2[32][2];
-    float y2[32][128][2];
+    float y2[32][2][128];
 
     vlc_mutex_t lock;
 };
@@ -288,11 +292,14 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     bool b_vlcFreqs = var_InheritBool( p_aout, "equalizer-vlcfreqs" );
     EqzCoeffs( i_rate, 1.0f, b_vlcFreqs, &cfg );
 
-    /* Create the static filter config */
+    /* Create the static filter config, padded with (neutral) zeroes for the
+     * SIMD code */
+    const size_t i_pad = (cfg.i_band + 3) & ~3;
+
     p_sys->i_band = cfg.i_band;
-    p_sys->f_alpha = malloc( p_sys->i_band * sizeof(float) );
-    p_sys->f_beta  = malloc( p_sys->i_band * sizeof(float) );
-    p_sys->f_gamma = malloc( p_sys->i_band * sizeof(float) );
+    p_sys->f_alpha = calloc( i_pad, sizeof(float) );
+    p_sys->f_beta  = calloc( i_pad, sizeof(float) );
+    p_sys->f_gamma = calloc( i_pad, sizeof(float) );
     if( !p_sys->f_alpha || !p_sys->f_beta || !p_sys->f_gamma )
         goto error;
 
@@ -306,7 +313,7 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     /* Filter dyn config */
     p_sys->b_2eqz = false;
     p_sys->f_gamp = 1.0f;
-    p_sys->f_amp  = malloc( p_sys->i_band * sizeof(float) );
+    p_sys->f_amp  = calloc( i_pad, sizeof(float) );
     if( !p_sys->f_amp )
         goto error;
 
@@ -323,12 +330,12 @@ static int EqzInit( filter_t *p_filter, int i_rate )
         p_sys->x2[ch][0] =
         p_sys->x2[ch][1] = 0.0f;
 
-        for( i = 0; i < p_sys->i_band; i++ )
+        for( i = 0; i < (int)i_pad; i++ )
         {
-            p_sys->y[ch][i][0]  =
-            p_sys->y[ch][i][1]  =
-            p_sys->y2[ch][i][0] =
-            p_sys->y2[ch][i][1] = 0.0f;
+            p_sys->y[ch][0][i]  =
+            p_sys->y[ch][1][i]  =
+            p_sys->y2[ch][0][i] =
+            p_sys->y2[ch][1][i] = 0.0f;
         }
     }
 
@@ -385,11 +392,69 @@ error:
     return i_ret;
 }
 
+/* Runs all the band filters of one channel on one sample, and returns the
+ * sum of their amplified outputs. */
+static float EqzBands( const filter_sys_t *p_sys, float dx,
+                       float *restrict y1, float *restrict y2 )
+{
+    const float *restrict alpha = p_sys->f_alpha;
+    const float *restrict beta  = p_sys->f_beta;
+    const float *restrict gamma = p_sys->f_gamma;
+    const float *restrict amp   = p_sys->f_amp;
+    const int i_band = p_sys->i_band;
+    float o = 0.0f;
+
+    for( int j = 0; j < i_band; j++ )
+    {
+        float y = alpha[j] * dx + gamma[j] * y1[j] - beta[j] * y2[j];
+
+        y2[j] = y1[j];
+        y1[j] = y;
+        o += y * amp[j];
+    }
+    return o;
+}
+
+#ifdef CAN_COMPILE_SSE
+/* The bands are independent from each other: run them four at a time.
+ * The tables of coefficients are padded with zeroes to a multiple of four. */
+VLC_SSE
+static float EqzBandsSSE( const filter_sys_t *p_sys, float dx,
+                          float *restrict y1, float *restrict y2 )
+{
+    const __m128 vdx = _mm_set1_ps( dx );
+    __m128 o = _mm_setzero_ps();
+
+    for( int j = 0; j < p_sys->i_band; j += 4 )
+    {
+        __m128 v1 = _mm_loadu_ps( y1 + j );
+        __m128 v2 = _mm_loadu_ps( y2 + j );
+        __m128 y = _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( p_sys->f_alpha + j ), vdx ),
+                               _mm_mul_ps( _mm_loadu_ps( p_sys->f_gamma + j ), v1 ) );
+        y = _mm_sub_ps( y, _mm_mul_ps( _mm_loadu_ps( p_sys->f_beta + j ), v2 ) );
+
+        _mm_storeu_ps( y2 + j, v1 );
+        _mm_storeu_ps( y1 + j, y );
+        o = _mm_add_ps( o, _mm_mul_ps( y, _mm_loadu_ps( p_sys->f_amp + j ) ) );
+    }
+
+    o = _mm_add_ps( o, _mm_movehl_ps( o, o ) );
+    o = _mm_add_ss( o, _mm_shuffle_ps( o, o, 1 ) );
+    return _mm_cvtss_f32( o );
+}
+#endif
+
 static void EqzFilter( filter_t *p_filter, float *out, float *in,
                        int i_samples, int i_channels )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    int i, ch, j;
+    float (*bands)( const filter_sys_t *, float, float *, float * ) = EqzBands;
+    int i, ch;
+
+#ifdef CAN_COMPILE_SSE
+    if( vlc_CPU_SSE() )
+        bands = EqzBandsSSE;
+#endif
 
     vlc_mutex_lock( &p_sys->lock );
     for( i = 0; i < i_samples; i++ )
@@ -397,19 +462,9 @@ static void EqzFilter( filter_t *p_filter, float *out, float *in,
         for( ch = 0; ch < i_channels; ch++ )
         {
             const float x = in[ch];
-            float o = 0.0f;
-
-            for( j = 0; j < p_sys->i_band; j++ )
-            {
-                float y = p_sys->f_alpha[j] * ( x - p_sys->x[ch][1] ) +
-                          p_sys->f_gamma[j] * p_sys->y[ch][j][0] -
-                          p_sys->f_beta[j]  * p_sys->y[ch][j][1];
+            float o = bands( p_sys, x - p_sys->x[ch][1],
+                                p_sys->y[ch][0], p_sys->y[ch][1] );
 
-                p_sys->y[ch][j][1] = p_sys->y[ch][j][0];
-                p_sys->y[ch][j][0] = y;
-
-                o += y * p_sys->f_amp[j];
-            }
             p_sys->x[ch][1] = p_sys->x[ch][0];
             p_sys->x[ch][0] = x;
 
@@ -417,18 +472,9 @@ static void EqzFilter( filter_t *p_filter, float *out, float *in,
             if( p_sys->b_2eqz )
             {
                 const float x2 = EQZ_IN_FACTOR * x + o;
-                o = 0.0f;
-                for( j = 0; j < p_sys->i_band; j++ )
-                {
-                    float y = p_sys->f_alpha[j] * ( x2 - p_sys->x2[ch][1] ) +
-                              p_sys->f_gamma[j] * p_sys->y2[ch][j][0] -
-                              p_sys->f_beta[j]  * p_sys->y2[ch][j][1];
-
-                    p_sys->y2[ch][j][1] = p_sys->y2[ch][j][0];
-                    p_sys->y2[ch][j][0] = y;
-
-                    o += y * p_sys->f_amp[j];
-                }
+
+                o = bands( p_sys, x2 - p_sys->x2[ch][1],
+                              p_sys->y2[ch][0], p_sys->y2[ch][1] );
                 p_sys->x2[ch][1] = p_sys->x2[ch][0];
                 p_sys->x2[ch][0] = x2;
 
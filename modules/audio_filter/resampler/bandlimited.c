@@ -341,7 +341,7 @@ static void FilterFloatUP( const float Imp[], const float ImpD[], uint16_t Nwing
                             uint32_t ui_output_rate, int16_t Inc, int i_nb_channels )
 {
     const float *Hp, *Hdp, *End;
-    float t, temp;
+    float t, f_linear;
     uint32_t ui_linear_remainder;
     int i;
 
@@ -352,6 +352,8 @@ static void FilterFloatUP( const float Imp[], const float ImpD[], uint16_t Nwing
 
     ui_linear_remainder = (ui_remainder<<Nhc) -
                             (ui_remainder<<Nhc)/ui_output_rate*ui_output_rate;
+    /* The interpolation phase is the same for all coefficients */
+    f_linear = (float)ui_linear_remainder / ui_output_rate / Npc;
 
     if (Inc == 1)               /* If doing right wing...              */
     {                           /* ...drop extra coeff, so when Ph is  */
@@ -364,15 +366,9 @@ static void FilterFloatUP( const float Imp[], const float ImpD[], uint16_t Nwing
     }
 
     while (Hp < End) {
-        t = *Hp;                /* Get filter coeff */
-                                /* t is now interp'd filter coeff */
-        t += *Hdp * ui_linear_remainder / ui_output_rate / Npc;
+        t = *Hp + *Hdp * f_linear; /* Get interpolated filter coeff */
         for( i = 0; i < i_nb_channels; i++ )
-        {
-            temp = t;
-            temp *= *(p_in+i);  /* Mult coeff by input sample */
-            *(p_out+i) += temp; /* The filter output */
-        }
+            p_out[i] += t * p_in[i]; /* The filter output */
         Hdp += Npc;             /* Filter coeff differences step */
         Hp += Npc;              /* Filter coeff step */
         p_in += (Inc * i_nb_channels); /* Input signal step */
@@ -384,13 +380,18 @@ static void FilterFloatUD( const float Imp[], const float ImpD[], uint16_t Nwing
                            uint32_t ui_output_rate, uint32_t ui_input_rate,
                            int16_t Inc, int i_nb_channels )
 {
-    const float *Hp, *Hdp, *End;
-    float t, temp;
-    uint32_t ui_linear_remainder;
-    int i, ui_counter = 0;
+    const float *End;
+    const float f_scale = 1.f / ((float)ui_input_rate * Npc);
+    float t;
+    int i;
 
-    Hp = Imp + (ui_remainder<<Nhc) / ui_input_rate;
-    Hdp = ImpD  + (ui_remainder<<Nhc) / ui_input_rate;
+    /* The coefficient index and interpolation phase of each tap are the
+     * quotient and remainder of ((output_rate * tap + remainder) << Nhc)
+     * by the input rate. Track them incrementally rather than dividing. */
+    const uint32_t ui_step_q = (ui_output_rate << Nhc) / ui_input_rate;
+    const uint32_t ui_step_r = (ui_output_rate << Nhc) % ui_input_rate;
+    uint32_t ui_index = (ui_remainder << Nhc) / ui_input_rate;
+    uint32_t ui_linear_remainder = (ui_remainder << Nhc) % ui_input_rate;
 
     End = &Imp[Nwing];
 
@@ -399,37 +400,25 @@ static void FilterFloatUD( const float Imp[], const float ImpD[], uint16_t Nwing
         End--;                  /*    0.5, we don't do too many mult's */
         if (ui_remainder == 0)  /* If the phase is zero...           */
         {                       /* ...then we've already skipped the */
-            Hp = Imp +          /* first sample, so we must also  */
-                  (ui_output_rate << Nhc) / ui_input_rate;
-            Hdp = ImpD +        /* skip ahead in Imp[] and ImpD[] */
-                  (ui_output_rate << Nhc) / ui_input_rate;
-            ui_counter++;
+            ui_index = ui_step_q; /* first sample, so we must also   */
+            ui_linear_remainder = ui_step_r; /* skip ahead in Imp[]  */
         }
     }
 
-    while (Hp < End) {
-        t = *Hp;                /* Get filter coeff */
-                                /* t is now interp'd filter coeff */
-        ui_linear_remainder =
-          ((ui_output_rate * ui_counter + ui_remainder)<< Nhc) -
-          ((ui_output_rate * ui_counter + ui_remainder)<< Nhc) /
-          ui_input_rate * ui_input_rate;
-        t += *Hdp * ui_linear_remainder / ui_input_rate / Npc;
+    while (Imp + ui_index < End) {
+        /* Get interpolated filter coeff */
+        t = Imp[ui_index] + ImpD[ui_index] * (ui_linear_remainder * f_scale);
         for( i = 0; i < i_nb_channels; i++ )
-        {
-            temp = t;
-            temp *= *(p_in+i);  /* Mult coeff by input sample */
-            *(p_out+i) += temp; /* The filter output */
-        }
-
-        ui_counter++;
+            p_out[i] += t * p_in[i]; /* The filter output */
 
         /* Filter coeff step */
-        Hp = Imp + ((ui_output_rate * ui_counter + ui_remainder)<< Nhc)
-                    / ui_input_rate;
-        /* Filter coeff differences step */
-        Hdp = ImpD + ((ui_output_rate * ui_counter + ui_remainder)<< Nhc)
-                     / ui_input_rate;
+        ui_index += ui_step_q;
+        ui_linear_remainder += ui_step_r;
+        if (ui_linear_remainder >= ui_input_rate)
+        {
+            ui_linear_remainder -= ui_input_rate;
+            ui_index++;
+        }
 
         p_in += (Inc * i_nb_channels); /* Input signal step */
     }
@@ -35,6 +35,12 @@
 #define QUALITY_LONGTEXT N_( \
     "Resampling quality (0 = worst and fastest, 10 = best and slowest).")
 
+static const int quality_values[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+static const char *const quality_texts[] = {
+    N_("Fastest"), "1", "2", N_("Voice"), N_("Default"), N_("Desktop"),
+    "6", "7", "8", "9", N_("Best"),
+};
+
 static int Open (vlc_object_t *);
 static int OpenResampler (vlc_object_t *);
 static void Close (vlc_object_t *);
@@ -46,7 +52,7 @@ vlc_module_begin ()
     set_subcategory (SUBCAT_AUDIO_MISC)
     add_integer ("speex-resampler-quality", 4,
                  QUALITY_TEXT, QUALITY_LONGTEXT, true)
-        change_integer_range (0, 10)
+        change_integer_list (quality_values, quality_texts)
     set_capability ("audio converter", 0)
     set_callbacks (Open, Close)
 
@@ -58,6 +64,13 @@ vlc_module_end ()
 
 static block_t *Resample (filter_t *, block_t *);
 
+struct filter_sys_t
+{
+    SpeexResamplerState *st;
+    unsigned irate; /**< Current input rate (may differ from the format) */
+    unsigned orate;
+};
+
 static int OpenResampler (vlc_object_t *obj)
 {
     filter_t *filter = (filter_t *)obj;
@@ -78,6 +91,10 @@ static int OpenResampler (vlc_object_t *obj)
         default:             return VLC_EGENERIC;
     }
 
+    filter_sys_t *sys = malloc (sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
     SpeexResamplerState *st;
 
     unsigned channels = aout_FormatNbChannels (&filter->fmt_in.audio);
@@ -92,10 +109,14 @@ static int OpenResampler (vlc_object_t *obj)
     {
         msg_Err (obj, "cannot initialize resampler: %s",
                  speex_resampler_strerror (err));
+        free (sys);
         return VLC_ENOMEM;
     }
 
-    filter->p_sys = (filter_sys_t *)st;
+    sys->st = st;
+    sys->irate = filter->fmt_in.audio.i_rate;
+    sys->orate = filter->fmt_out.audio.i_rate;
+    filter->p_sys = sys;
     filter->pf_audio_filter = Resample;
     return VLC_SUCCESS;
 }
@@ -113,14 +134,16 @@ static int Open (vlc_object_t *obj)
 static void Close (vlc_object_t *obj)
 {
     filter_t *filter = (filter_t *)obj;
-    SpeexResamplerState *st = (SpeexResamplerState *)filter->p_sys;
+    filter_sys_t *sys = filter->p_sys;
 
-    speex_resampler_destroy (st);
+    speex_resampler_destroy (sys->st);
+    free (sys);
 }
 
 static block_t *Resample (filter_t *filter, block_t *in)
 {
-    SpeexResamplerState *st = (SpeexResamplerState *)filter->p_sys;
+    filter_sys_t *sys = filter->p_sys;
+    SpeexResamplerState *st = sys->st;
 
     const size_t framesize = filter->fmt_out.audio.i_bytes_per_frame;
     const unsigned irate = filter->fmt_in.audio.i_rate;
@@ -134,7 +157,14 @@ static block_t *Resample (filter_t *filter, block_t *in)
     if (unlikely(out == NULL))
         goto error;
 
-    speex_resampler_set_rate (st, irate, orate);
+    /* The input rate varies slightly with drift compensation. Only then
+     * update the ratio, which keeps the filter state and history. */
+    if (irate != sys->irate || orate != sys->orate)
+    {
+        speex_resampler_set_rate (st, irate, orate);
+        sys->irate = irate;
+        sys->orate = orate;
+    }
 
     int err;
     if (filter->fmt_in.audio.i_format == VLC_CODEC_FL32)
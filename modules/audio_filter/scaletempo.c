@@ -32,6 +32,10 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
+#ifdef CAN_COMPILE_SSE
+# include <xmmintrin.h>
+#endif
 
 #include <string.h> /* for memset */
 #include <limits.h> /* form INT_MIN */
@@ -150,6 +154,48 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
     return best_off * p->bytes_per_frame;
 }
 
+#ifdef CAN_COMPILE_SSE
+VLC_SSE
+static unsigned best_overlap_offset_float_sse( filter_t *p_filter )
+{
+    filter_sys_t *p = p_filter->p_sys;
+    const float *pw = p->table_window;
+    const float *po = (const float *)p->buf_overlap + p->samples_per_frame;
+    float *ppc = p->buf_pre_corr;
+    const unsigned n = p->samples_overlap - p->samples_per_frame;
+    float best_corr = INT_MIN;
+    unsigned best_off = 0;
+    unsigned i, off;
+
+    for( i = 0; i < n; i++ )
+      ppc[i] = pw[i] * po[i];
+
+    const float *search_start = (const float *)p->buf_queue + p->samples_per_frame;
+    for( off = 0; off < p->frames_search; off++ ) {
+      const float *ps = search_start;
+      __m128 acc = _mm_setzero_ps();
+
+      for( i = 0; i + 4 <= n; i += 4 )
+        acc = _mm_add_ps( acc, _mm_mul_ps( _mm_loadu_ps( ppc + i ),
+                                           _mm_loadu_ps( ps + i ) ) );
+      acc = _mm_add_ps( acc, _mm_movehl_ps( acc, acc ) );
+      acc = _mm_add_ss( acc, _mm_shuffle_ps( acc, acc, 1 ) );
+
+      float corr = _mm_cvtss_f32( acc );
+      for( ; i < n; i++ )
+        corr += ppc[i] * ps[i];
+
+      if( corr > best_corr ) {
+        best_corr = corr;
+        best_off  = off;
+      }
+      search_start += p->samples_per_frame;
+    }
+
+    return best_off * p->bytes_per_frame;
+}
+#endif
+
 /*****************************************************************************
  * output_overlap: blend end of previous stride with beginning of current stride
  *****************************************************************************/
@@ -338,6 +384,10 @@ static int reinit_buffers( filter_t *p_filter )
                 *pw++ = v;
         }
         p->best_overlap_offset = best_overlap_offset_float;
+#ifdef CAN_COMPILE_SSE
+        if( vlc_CPU_SSE() )
+            p->best_overlap_offset = best_overlap_offset_float_sse;
+#endif
     }
 
     unsigned new_size = ( p->frames_search + frames_stride + frames_overlap ) * p->bytes_per_frame;
@@ -34,6 +34,14 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_aout_volume.h>
+#include <vlc_cpu.h>
+
+/* The intrinsics headers can be used with target attributes since GCC 4.9 */
+#if (defined(__i386__) || defined(__x86_64__)) \
+ && (VLC_GCC_VERSION(4, 9) || defined(__clang__))
+# include <immintrin.h>
+# define HAVE_X86_KERNELS 1
+#endif
 
 /*****************************************************************************
  * Local prototypes
@@ -67,6 +75,57 @@ static void FilterFL32( audio_volume_t *p_volume, block_t *p_buffer,
     (void) p_volume;
 }
 
+#ifdef HAVE_X86_KERNELS
+VLC_SSE
+static void FilterFL32_SSE( audio_volume_t *p_volume, block_t *p_buffer,
+                            float f_multiplier )
+{
+    if( f_multiplier == 1.f )
+        return; /* nothing to do */
+
+    float *p = (float *)p_buffer->p_buffer;
+    size_t i = p_buffer->i_buffer / sizeof(*p);
+    const __m128 mult = _mm_set1_ps( f_multiplier );
+
+    for( ; i >= 8; i -= 8, p += 8 )
+    {
+        __m128 a = _mm_loadu_ps( p );
+        __m128 b = _mm_loadu_ps( p + 4 );
+        _mm_storeu_ps( p, _mm_mul_ps( a, mult ) );
+        _mm_storeu_ps( p + 4, _mm_mul_ps( b, mult ) );
+    }
+    for( ; i > 0; i-- )
+        *(p++) *= f_multiplier;
+
+    (void) p_volume;
+}
+
+__attribute__ ((__target__ ("avx")))
+static void FilterFL32_AVX( audio_volume_t *p_volume, block_t *p_buffer,
+                            float f_multiplier )
+{
+    if( f_multiplier == 1.f )
+        return; /* nothing to do */
+
+    float *p = (float *)p_buffer->p_buffer;
+    size_t i = p_buffer->i_buffer / sizeof(*p);
+    const __m256 mult = _mm256_set1_ps( f_multiplier );
+
+    for( ; i >= 16; i -= 16, p += 16 )
+    {
+        __m256 a = _mm256_loadu_ps( p );
+        __m256 b = _mm256_loadu_ps( p + 8 );
+        _mm256_storeu_ps( p, _mm256_mul_ps( a, mult ) );
+        _mm256_storeu_ps( p + 8, _mm256_mul_ps( b, mult ) );
+    }
+    _mm256_zeroupper();
+    for( ; i > 0; i-- )
+        *(p++) *= f_multiplier;
+
+    (void) p_volume;
+}
+#endif
+
 static void FilterFL64( audio_volume_t *p_volume, block_t *p_buffer,
                         float f_multiplier )
 {
@@ -92,6 +151,12 @@ static int Create( vlc_object_t *p_this )
     {
         case VLC_CODEC_FL32:
             p_volume->amplify = FilterFL32;
+#ifdef HAVE_X86_KERNELS
+            if( vlc_CPU_AVX() )
+                p_volume->amplify = FilterFL32_AVX;
+            else if( vlc_CPU_SSE() )
+                p_volume->amplify = FilterFL32_SSE;
+#endif
             break;
         case VLC_CODEC_FL64:
             p_volume->amplify = FilterFL64;
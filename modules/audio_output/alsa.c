@@ -495,8 +495,10 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
     }
     sys->rate = fmt->i_rate;
 
-    /* Set buffer size */
-    param = AOUT_MAX_ADVANCE_TIME;
+    /* Set buffer size, small enough for the latency target if any */
+    mtime_t latency = aout_LatencyTarget (aout);
+
+    param = (latency > 0) ? latency : AOUT_MAX_ADVANCE_TIME;
     val = snd_pcm_hw_params_set_buffer_time_near (pcm, hw, &param, NULL);
     if (val)
     {
@@ -504,7 +506,7 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
         goto error;
     }
 
-    param = AOUT_MIN_PREPARE_TIME;
+    param = (latency > 0) ? latency / 4 : AOUT_MIN_PREPARE_TIME;
     val = snd_pcm_hw_params_set_period_time_near (pcm, hw, &param, NULL);
     if (val)
     {
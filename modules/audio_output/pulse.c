@@ -795,9 +795,12 @@ static int Start(audio_output_t *aout, audio_sample_format_t *restrict fmt)
     /* PulseAudio goes berserk if the target length (tlength) is not
      * significantly longer than 2 periods (minreq), or when the period length
      * is unspecified and the target length is short. */
-    attr.tlength = pa_usec_to_bytes(3 * AOUT_MIN_PREPARE_TIME, &ss);
+    mtime_t latency = aout_LatencyTarget(aout);
+    if (latency <= 0)
+        latency = 3 * AOUT_MIN_PREPARE_TIME;
+    attr.tlength = pa_usec_to_bytes(latency, &ss);
     attr.prebuf = 0; /* trigger manually */
-    attr.minreq = pa_usec_to_bytes(AOUT_MIN_PREPARE_TIME, &ss);
+    attr.minreq = pa_usec_to_bytes(latency / 3, &ss);
     attr.fragsize = 0; /* not used for output */
 
     pa_cvolume *cvolume = NULL, cvolumebuf;
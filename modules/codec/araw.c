@@ -36,6 +36,8 @@
 #include <vlc_codec.h>
 #include <vlc_aout.h>
 
+#include "pcm_helper.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -386,7 +388,7 @@ static void U16LDecode( void *outp, const uint8_t *in, unsigned samples )
 
 static void S16IDecode( void *out, const uint8_t *in, unsigned samples )
 {
-    swab( in, out, samples * 2 );
+    pcm_Swap16( out, in, samples );
 }
 
 static void S20BDecode( void *outp, const uint8_t *in, unsigned samples )
@@ -434,26 +436,12 @@ static void U24LDecode( void *outp, const uint8_t *in, unsigned samples )
 
 static void S24BDecode( void *outp, const uint8_t *in, unsigned samples )
 {
-    uint32_t *out = outp;
-
-    for( size_t i = 0; i < samples; i++ )
-    {
-        uint32_t s = ((in[0] << 24) | (in[1] << 16) | (in[2] << 8));
-        *(out++) = s;
-        in += 3;
-    }
+    pcm_S24BToS32N( outp, in, samples );
 }
 
 static void S24LDecode( void *outp, const uint8_t *in, unsigned samples )
 {
-    uint32_t *out = outp;
-
-    for( size_t i = 0; i < samples; i++ )
-    {
-        uint32_t s = ((in[2] << 24) | (in[1] << 16) | (in[0] << 8));
-        *(out++) = s;
-        in += 3;
-    }
+    pcm_S24LToS32N( outp, in, samples );
 }
 
 static void S24B32Decode( void *outp, const uint8_t *in, unsigned samples )
@@ -502,17 +490,7 @@ static void U32LDecode( void *outp, const uint8_t *in, unsigned samples )
 
 static void S32IDecode( void *outp, const uint8_t *in, unsigned samples )
 {
-    int32_t *out = outp;
-
-    for( size_t i = 0; i < samples; i++ )
-    {
-#ifdef WORDS_BIGENDIAN
-        *(out++) = GetDWLE( in );
-#else
-        *(out++) = GetDWBE( in );
-#endif
-        in += 4;
-    }
+    pcm_Swap32( outp, in, samples );
 }
 
 static void F32NDecode( void *outp, const uint8_t *in, unsigned samples )
@@ -533,20 +511,10 @@ static void F32IDecode( void *outp, const uint8_t *in, unsigned samples )
 {
     float *out = outp;
 
+    pcm_Swap32( out, in, samples );
     for( size_t i = 0; i < samples; i++ )
-    {
-        union { float f; uint32_t u; } s;
-
-#ifdef WORDS_BIGENDIAN
-        s.u = GetDWLE( in );
-#else
-        s.u = GetDWBE( in );
-#endif
-        if( unlikely(!isfinite(s.f)) )
-            s.f = 0.f;
-        *(out++) = s.f;
-        in += 4;
-    }
+        if( unlikely(!isfinite(out[i])) )
+            out[i] = 0.f;
 }
 
 static void F64NDecode( void *outp, const uint8_t *in, unsigned samples )
@@ -61,6 +61,10 @@ static const int  nloopf_list[] = { 0, 1, 2, 3, 4 };
 static const char *const nloopf_list_text[] =
   { N_("None"), N_("Non-ref"), N_("Bidir"), N_("Non-key"), N_("All") };
 
+static const int  npreroll_list[] = { 0, 1, 2 };
+static const char *const npreroll_list_text[] =
+  { N_("None"), N_("Non-ref frames"), N_("Non-ref frames and loop filter") };
+
 #ifdef ENABLE_SOUT
 static const char *const enc_hq_list[] = { "rd", "bits", "simple" };
 static const char *const enc_hq_list_text[] = {
@@ -122,6 +126,9 @@ vlc_module_begin ()
                   SKIPLOOPF_LONGTEXT, false)
         change_safe ()
         change_integer_list( nloopf_list, nloopf_list_text )
+    add_integer( "avcodec-preroll-skip", 0, PREROLL_SKIP_TEXT,
+                 PREROLL_SKIP_LONGTEXT, true )
+        change_integer_list( npreroll_list, npreroll_list_text )
 
     add_obsolete_integer( "ffmpeg-debug" ) /* removed since 2.1.0 */
     add_integer( "avcodec-debug", 0, DEBUG_TEXT, DEBUG_LONGTEXT,
@@ -103,6 +103,13 @@ void ffmpeg_CloseCodec( decoder_t *p_dec );
     "Force skipping of idct to speed up decoding for frame types " \
     "(-1=None, 0=Default, 1=B-frames, 2=P-frames, 3=B+P frames, 4=all frames)." )
 
+#define PREROLL_SKIP_TEXT N_("Fast preroll after seeking")
+#define PREROLL_SKIP_LONGTEXT N_( \
+    "Decode the frames preceding the seek target with the cheapest settings. " \
+    "Skipping the non-reference frames does not affect the target frame. " \
+    "Skipping the loop filter as well is faster, but the first displayed " \
+    "frames can be distorted." )
+
 #define DEBUG_TEXT N_( "Debug mask" )
 #define DEBUG_LONGTEXT N_( "Set FFmpeg debug mask" )
 
@@ -457,7 +457,8 @@ static int Create( vlc_va_t *va, AVCodecContext *ctx, enum PixelFormat pix_fmt,
     if (FindFormat(sys))
         goto error;
 
-    if (unlikely(CopyInitCache(&sys->image_cache, ctx->coded_width)))
+    if (unlikely(CopyInitCache(VLC_OBJECT(va), &sys->image_cache,
+                               ctx->coded_width)))
         goto error;
 
     vlc_mutex_init(&sys->lock);
@@ -61,6 +61,19 @@ struct decoder_sys_t
     int     i_late_frames;
     mtime_t i_late_frames_start;
 
+    /* decoding quality, lowered while the frames are late (hurry up) */
+    int     i_quality;
+    mtime_t i_quality_date;     /* of the last quality change */
+    mtime_t i_late_date;        /* of the last late frame */
+    enum AVDiscard i_user_skip_loop_filter;
+    enum AVDiscard i_user_skip_frame;
+    enum AVDiscard i_user_skip_idct;
+
+    /* decoding of the frames preceding a seek target */
+    int     i_preroll_skip;
+    bool    b_preroll;
+    enum AVDiscard i_preroll_loop_filter; /* to restore after preroll */
+
     /* for direct rendering */
     bool        b_direct_rendering;
     atomic_bool b_dr_failure;
@@ -96,6 +109,77 @@ static inline void post_mt(decoder_sys_t *sys)
 # define post_mt(s) ((void)s)
 #endif
 
+/*****************************************************************************
+ * Decoding quality
+ *****************************************************************************
+ * While the frames are late, the decoding quality is lowered one level at a
+ * time, so that the decoder catches up without dropping whole frames: first
+ * the loop filter of the non-reference frames is skipped, then the loop
+ * filter of all frames, then the non-reference frames, and finally the IDCT
+ * of all but the key frames. It is restored one level at a time once the
+ * frames are on time again. The user settings are never lowered.
+ *****************************************************************************/
+#define QUALITY_LEVELS        4
+/* Minimum delay between two lowerings, for the last one to take effect */
+#define QUALITY_LOWER_DELAY   (CLOCK_FREQ / 2)
+/* Time without late frames before restoring one level */
+#define QUALITY_RESTORE_DELAY (5 * CLOCK_FREQ)
+
+static inline enum AVDiscard lavc_Discard( enum AVDiscard a, enum AVDiscard b )
+{
+    return a > b ? a : b;
+}
+
+static void lavc_SetQuality( decoder_t *p_dec, int i_quality )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+    AVCodecContext *p_context = p_sys->p_context;
+    enum AVDiscard loop_filter = AVDISCARD_DEFAULT, frame = AVDISCARD_DEFAULT,
+                   idct = AVDISCARD_DEFAULT;
+
+    switch( i_quality )
+    {
+        case 4: idct = AVDISCARD_NONKEY;        /* fall through */
+        case 3: frame = AVDISCARD_NONREF;       /* fall through */
+        case 2: loop_filter = AVDISCARD_ALL;    break;
+        case 1: loop_filter = AVDISCARD_NONREF; break;
+    }
+
+    p_context->skip_loop_filter = lavc_Discard( p_sys->i_user_skip_loop_filter,
+                                                loop_filter );
+    p_context->skip_idct = lavc_Discard( p_sys->i_user_skip_idct, idct );
+    p_sys->i_skip_frame = lavc_Discard( p_sys->i_user_skip_frame, frame );
+    p_context->skip_frame = p_sys->i_skip_frame;
+
+    msg_Dbg( p_dec, "decoding quality %s to level %d of %d",
+             i_quality > p_sys->i_quality ? "lowered" : "restored",
+             i_quality, QUALITY_LEVELS );
+    p_sys->i_quality = i_quality;
+    p_sys->i_quality_date = mdate();
+}
+
+/* Called for each decoded frame that is meant to be displayed */
+static void lavc_UpdateQuality( decoder_t *p_dec, bool b_late )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+    mtime_t i_now = mdate();
+
+    if( !p_sys->b_hurry_up || !p_dec->b_frame_drop_allowed )
+        return;
+
+    if( b_late )
+    {
+        p_sys->i_late_date = i_now;
+        if( p_sys->i_quality < QUALITY_LEVELS && p_sys->i_late_frames >= 2
+         && i_now - p_sys->i_quality_date >= QUALITY_LOWER_DELAY )
+            lavc_SetQuality( p_dec, p_sys->i_quality + 1 );
+    }
+    else if( p_sys->i_quality > 0
+          && i_now - p_sys->i_late_date >= QUALITY_RESTORE_DELAY
+          && i_now - p_sys->i_quality_date >= QUALITY_RESTORE_DELAY )
+        lavc_SetQuality( p_dec, p_sys->i_quality - 1 );
+}
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -383,6 +467,15 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
     else if( i_val == -1 ) p_context->skip_idct = AVDISCARD_NONE;
     else p_context->skip_idct = AVDISCARD_DEFAULT;
 
+    p_sys->i_user_skip_loop_filter = p_context->skip_loop_filter;
+    p_sys->i_user_skip_frame = p_context->skip_frame;
+    p_sys->i_user_skip_idct = p_context->skip_idct;
+    p_sys->i_quality = 0;
+    p_sys->i_quality_date = p_sys->i_late_date = 0;
+
+    p_sys->i_preroll_skip = var_CreateGetInteger( p_dec, "avcodec-preroll-skip" );
+    p_sys->b_preroll = false;
+
     /* ***** libavcodec direct rendering ***** */
     p_sys->b_direct_rendering = false;
     atomic_init(&p_sys->b_dr_failure, false);
@@ -422,11 +515,20 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
     if( i_thread_count <= 0 )
     {
         i_thread_count = vlc_GetCPUCount();
+
+        /* Share the CPUs with the other decoders of the process */
+        int i_slots = var_InheritInteger( p_dec, "decoder-slots" );
+        if( i_slots > 1 )
+            i_thread_count = __MAX( i_thread_count / i_slots, 1 );
+
         if( i_thread_count > 1 )
             i_thread_count++;
 
-        //FIXME: take in count the decoding time
-        i_thread_count = __MIN( i_thread_count, 4 );
+        /* The thread count cannot change once the codec is open: only use
+         * more than 4 threads for the streams that need them */
+        if( (unsigned)p_dec->fmt_in.video.i_width *
+            p_dec->fmt_in.video.i_height <= 1920 * 1088 )
+            i_thread_count = __MIN( i_thread_count, 4 );
     }
     i_thread_count = __MIN( i_thread_count, 16 );
     msg_Dbg( p_dec, "allowing %d thread(s) for decoding", i_thread_count );
@@ -453,10 +555,17 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
             break;
     }
 
+    /* Frame threading delays the output by one frame per thread */
+    if( var_InheritBool( p_dec, "low-latency" ) )
+        p_context->thread_type &= ~FF_THREAD_FRAME;
+
     if( p_context->thread_type & FF_THREAD_FRAME )
         p_dec->i_extra_picture_buffers = 2 * p_context->thread_count;
 #endif
 
+    if( var_InheritBool( p_dec, "low-latency" ) )
+        p_context->flags |= CODEC_FLAG_LOW_DELAY;
+
     /* ***** misc init ***** */
     p_sys->i_pts = VLC_TS_INVALID;
     p_sys->b_first_frame = true;
@@ -549,8 +658,7 @@ static picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
         if( p_block->i_flags & BLOCK_FLAG_PREROLL )
         {
             /* Do not care about late frames when prerolling
-             * TODO avoid decoding of non reference frame
-             * (ie all B except for H264 where it depends only on nal_ref_idc) */
+             * (see avcodec-preroll-skip to skip the non reference frames) */
             p_sys->i_late_frames = 0;
         }
     }
@@ -619,6 +727,27 @@ static picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
 #endif
     }
 
+    bool b_preroll = p_block && (p_block->i_flags & BLOCK_FLAG_PREROLL);
+    if( p_sys->i_preroll_skip > 0 )
+    {
+        if( b_preroll && !p_sys->b_preroll )
+            p_sys->i_preroll_loop_filter = p_context->skip_loop_filter;
+        else if( !b_preroll && p_sys->b_preroll )
+        {   /* End of preroll: restore the settings */
+            p_context->skip_loop_filter = p_sys->i_preroll_loop_filter;
+            p_context->skip_frame = p_sys->i_skip_frame;
+        }
+
+        if( b_preroll )
+        {   /* Only the reference frames matter to reach the seek target */
+            p_context->skip_frame = lavc_Discard( p_sys->i_skip_frame,
+                                                  AVDISCARD_NONREF );
+            if( p_sys->i_preroll_skip > 1 )
+                p_context->skip_loop_filter = AVDISCARD_ALL;
+        }
+    }
+    p_sys->b_preroll = b_preroll;
+
     /*
      * Do the actual decoding now */
 
@@ -772,6 +901,8 @@ static picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
         {
             p_sys->i_late_frames = 0;
         }
+        if( i_display_date > 0 )
+            lavc_UpdateQuality( p_dec, p_sys->i_late_frames > 0 );
 
         if( !b_drawpicture || ( !p_sys->p_va && !frame->linesize[0] ) )
         {
@@ -986,9 +1117,11 @@ static int lavc_dr_GetFrame(struct AVCodecContext *ctx, AVFrame *frame,
 
     avcodec_align_dimensions2(ctx, &width, &height, aligns);
 
-    /* Check that the picture is suitable for libavcodec */
-    assert(pic->p[0].i_pitch >= width * pic->p[0].i_pixel_pitch);
-    assert(pic->p[0].i_lines >= height);
+    /* Check that the picture is suitable for libavcodec. A picture allocated
+     * before a change of the frame size is not, but the next ones will be. */
+    if (pic->p[0].i_pitch < width * pic->p[0].i_pixel_pitch
+     || pic->p[0].i_lines < height)
+        goto error;
 
     for (int i = 0; i < pic->i_planes; i++)
     {
@@ -1070,7 +1203,8 @@ static int lavc_GetFrame(struct AVCodecContext *ctx, AVFrame *frame, int flags)
             return -1;
         }
     }
-    else if (!sys->b_direct_rendering)
+    else if (!sys->b_direct_rendering || atomic_load(&sys->b_dr_failure)
+          || sys->b_preroll /* not displayed: keep the output pictures */)
     {
         post_mt(sys);
         return avcodec_default_get_buffer2(ctx, frame, flags);
@@ -1162,10 +1296,6 @@ static enum PixelFormat ffmpeg_GetFormat( AVCodecContext *p_context,
         if (va->description != NULL)
             msg_Info(p_dec, "Using %s for hardware decoding", va->description);
 
-        /* FIXME this will disable direct rendering
-         * even if a new pixel format is renegotiated
-         */
-        p_sys->b_direct_rendering = false;
         p_sys->p_va = va;
         p_context->draw_horiz_band = NULL;
         return pi_fmt[i];
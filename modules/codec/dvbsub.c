@@ -159,6 +159,7 @@ typedef struct dvbsub_objectdef_s
     int i_fg_pc;
     int i_bg_pc;
     char *psz_text; /* for string of characters objects */
+    int i_version; /* of the object data rendered, -1 if none */
 
 } dvbsub_objectdef_t;
 
@@ -218,6 +219,7 @@ typedef struct dvbsub_region_s
     int i_clut;
 
     uint8_t *p_pixbuf;
+    picture_t *p_picture; /* p_pixbuf as rendered last, NULL if changed */
 
     int                    i_object_defs;
     dvbsub_objectdef_t     *p_object_defs;
@@ -874,8 +876,14 @@ static void decode_region_composition( decoder_t *p_dec, bs_t *s )
             return;
         p_region->p_object_defs = NULL;
         p_region->p_pixbuf = NULL;
+        p_region->p_picture = NULL;
         p_region->p_next = NULL;
     }
+    else if( p_region->p_picture )
+    {
+        picture_Release( p_region->p_picture );
+        p_region->p_picture = NULL;
+    }
 
     /* Region attributes */
     p_region->i_id = i_id;
@@ -962,6 +970,7 @@ static void decode_region_composition( decoder_t *p_dec, bs_t *s )
         bs_skip( s, 4 ); /* Reserved */
         p_obj->i_y          = bs_read( s, 12 );
         p_obj->psz_text     = NULL;
+        p_obj->i_version    = -1;
 
         i_processed_length += 6;
 
@@ -1052,14 +1061,14 @@ static void decode_object( decoder_t *p_dec, bs_t *s )
 {
     decoder_sys_t *p_sys = p_dec->p_sys;
     dvbsub_region_t *p_region;
-    int i_segment_length, i_coding_method, i_id, i;
+    int i_segment_length, i_coding_method, i_id, i_version, i;
 
     /* ETSI 300-743 paragraph 7.2.4
      * sync_byte, segment_type and page_id have already been processed.
      */
     i_segment_length = bs_read( s, 16 );
     i_id             = bs_read( s, 16 );
-    bs_skip( s, 4 ); /* version */
+    i_version        = bs_read( s, 4 );
     i_coding_method  = bs_read( s, 2 );
 
     if( i_coding_method > 1 )
@@ -1070,12 +1079,14 @@ static void decode_object( decoder_t *p_dec, bs_t *s )
     }
 
     /* Check if the object needs to be rendered in at least one
-     * of the regions */
+     * of the regions: the regions keep the objects already rendered in
+     * their pixel buffer as long as their version does not change */
     for( p_region = p_sys->p_regions; p_region != NULL;
          p_region = p_region->p_next )
     {
         for( i = 0; i < p_region->i_object_defs; i++ )
-            if( p_region->p_object_defs[i].i_id == i_id ) break;
+            if( p_region->p_object_defs[i].i_id == i_id &&
+                p_region->p_object_defs[i].i_version != i_version ) break;
 
         if( i != p_region->i_object_defs ) break;
     }
@@ -1117,7 +1128,15 @@ static void decode_object( decoder_t *p_dec, bs_t *s )
         {
             for( i = 0; i < p_region->i_object_defs; i++ )
             {
-                if( p_region->p_object_defs[i].i_id != i_id ) continue;
+                if( p_region->p_object_defs[i].i_id != i_id ||
+                    p_region->p_object_defs[i].i_version == i_version ) continue;
+
+                p_region->p_object_defs[i].i_version = i_version;
+                if( p_region->p_picture )
+                {
+                    picture_Release( p_region->p_picture );
+                    p_region->p_picture = NULL;
+                }
 
                 dvbsub_render_pdata( p_dec, p_region,
                                      p_region->p_object_defs[i].i_x,
@@ -1163,7 +1182,10 @@ static void decode_object( decoder_t *p_dec, bs_t *s )
             {
                 int j;
 
-                if( p_region->p_object_defs[i].i_id != i_id ) continue;
+                if( p_region->p_object_defs[i].i_id != i_id ||
+                    p_region->p_object_defs[i].i_version == i_version ) continue;
+
+                p_region->p_object_defs[i].i_version = i_version;
 
                 p_region->p_object_defs[i].psz_text =
                     xrealloc( p_region->p_object_defs[i].psz_text,
@@ -1456,6 +1478,8 @@ static void free_all( decoder_t *p_dec )
             free( p_reg->p_object_defs[i].psz_text );
         if( p_reg->i_object_defs ) free( p_reg->p_object_defs );
         free( p_reg->p_pixbuf );
+        if( p_reg->p_picture )
+            picture_Release( p_reg->p_picture );
         free( p_reg );
     }
     p_sys->p_regions = NULL;
@@ -1613,16 +1637,26 @@ static subpicture_t *render( decoder_t *p_dec )
         *pp_spu_region = p_spu_region;
         pp_spu_region = &p_spu_region->p_next;
 
-        p_src = p_region->p_pixbuf;
-        p_dst = p_spu_region->p_picture->Y_PIXELS;
-        i_pitch = p_spu_region->p_picture->Y_PITCH;
-
-        /* Copy pixel buffer */
-        for( j = 0; j < p_region->i_height; j++ )
+        if( p_region->p_picture )
+        {
+            /* Unchanged since rendered last, share the picture */
+            picture_Release( p_spu_region->p_picture );
+            p_spu_region->p_picture = picture_Hold( p_region->p_picture );
+        }
+        else
         {
-            memcpy( p_dst, p_src, p_region->i_width );
-            p_src += p_region->i_width;
-            p_dst += i_pitch;
+            p_src = p_region->p_pixbuf;
+            p_dst = p_spu_region->p_picture->Y_PIXELS;
+            i_pitch = p_spu_region->p_picture->Y_PITCH;
+
+            /* Copy pixel buffer */
+            for( j = 0; j < p_region->i_height; j++ )
+            {
+                memcpy( p_dst, p_src, p_region->i_width );
+                p_src += p_region->i_width;
+                p_dst += i_pitch;
+            }
+            p_region->p_picture = picture_Hold( p_spu_region->p_picture );
         }
 
         /* Check subtitles encoded as strings of characters
@@ -46,6 +46,7 @@
 
 #include <vlc_block_helper.h>
 #include <vlc_bits.h>
+#include "pcm_helper.h"
 
 #if defined(FLAC_API_VERSION_CURRENT) && FLAC_API_VERSION_CURRENT >= 8
 #   define USE_NEW_FLAC_API
@@ -127,25 +128,6 @@ vlc_module_begin ()
 
 vlc_module_end ()
 
-/*****************************************************************************
- * Interleave: helper function to interleave channels
- *****************************************************************************/
-static void Interleave( int32_t *p_out, const int32_t * const *pp_in,
-                        const unsigned char *restrict pi_index, unsigned i_nb_channels,
-                        unsigned i_samples, unsigned bits )
-{
-    unsigned shift = 32 - bits;
-
-    for( unsigned j = 0; j < i_samples; j++ )
-        for( unsigned i = 0; i < i_nb_channels; i++ )
-        {
-            union { int32_t i; uint32_t u; } spl;
-
-            spl.u = ((uint32_t)pp_in[pi_index[i]][j]) << shift;
-            p_out[j * i_nb_channels + i] = spl.i;
-        }
-}
-
 /*****************************************************************************
  * DecoderWriteCallback: called by libflac to output decoded samples
  *****************************************************************************/
@@ -185,9 +167,10 @@ DecoderWriteCallback( const FLAC__StreamDecoder *decoder,
     if( p_sys->p_aout_buffer == NULL )
         return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
 
-    Interleave( (int32_t *)p_sys->p_aout_buffer->p_buffer, buffer, pi_reorder,
-                 frame->header.channels, frame->header.blocksize,
-                 frame->header.bits_per_sample );
+    pcm_Interleave32( (int32_t *)p_sys->p_aout_buffer->p_buffer, buffer,
+                      pi_reorder, frame->header.channels,
+                      frame->header.blocksize,
+                      32 - frame->header.bits_per_sample );
 
     /* Date management (already done by packetizer) */
     p_sys->p_aout_buffer->i_pts = date_Get( &p_sys->end_date );
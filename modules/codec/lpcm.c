@@ -40,6 +40,8 @@
 #include <unistd.h>
 #include <assert.h>
 
+#include "pcm_helper.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -1123,7 +1125,8 @@ static void VobExtract( block_t *p_aout_buffer, block_t *p_block,
 #ifdef WORDS_BIGENDIAN
         memcpy( p_aout_buffer->p_buffer, p_block->p_buffer, p_block->i_buffer );
 #else
-        swab( p_block->p_buffer, p_aout_buffer->p_buffer, p_block->i_buffer );
+        pcm_Swap16( p_aout_buffer->p_buffer, p_block->p_buffer,
+                    p_block->i_buffer / 2 );
 #endif
     }
 }
@@ -1230,19 +1233,13 @@ static void BdExtract( block_t *p_aout_buffer, block_t *p_block,
 
         while( i_frame_length > 0 )
         {
+            if( i_bits != 16 )
+                pcm_S24BToS32N( (uint32_t *)p_dst, p_src, i_channels );
+            else
 #ifdef WORDS_BIGENDIAN
-            memcpy( p_dst, p_src, i_channels * i_bits / 8 );
+                memcpy( p_dst, p_src, i_channels * 2 );
 #else
-            if (i_bits == 16) {
-                swab( p_src, p_dst, (i_channels + i_channels_padding) * i_bits / 8 );
-            } else {
-                for (unsigned i = 0; i < i_channels; ++i) {
-                    p_dst[i * 4] = 0;
-                    p_dst[1 + (i * 4)] = p_src[2 + (i * 3)];
-                    p_dst[2 + (i * 4)] = p_src[1 + (i * 3)];
-                    p_dst[3 + (i * 4)] = p_src[i * 3];
-                }
-            }
+                pcm_Swap16( p_dst, p_src, i_channels );
 #endif
             p_src += (i_channels + i_channels_padding) * i_bits / 8;
             p_dst += dst_inc;
@@ -1254,7 +1251,8 @@ static void BdExtract( block_t *p_aout_buffer, block_t *p_block,
 #ifdef WORDS_BIGENDIAN
         memcpy( p_aout_buffer->p_buffer, p_block->p_buffer, p_block->i_buffer );
 #else
-        swab( p_block->p_buffer, p_aout_buffer->p_buffer, p_block->i_buffer );
+        pcm_Swap16( p_aout_buffer->p_buffer, p_block->p_buffer,
+                    p_block->i_buffer / 2 );
 #endif
     }
 }
@@ -1521,11 +1521,21 @@ static picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
     unsigned int i;
     block_t *p_block;
 
-    if( !pp_block || !*pp_block )
+    if( !pp_block )
         return NULL;
 
     p_block = *pp_block;
 
+    /* The block was queued by a previous call: hand over the other
+     * pictures the component filled meanwhile, without waiting */
+    if( !p_block )
+    {
+        if( !p_sys->b_error &&
+            DecodeVideoOutput( p_dec, &p_sys->out, &p_pic ) != 0 )
+            p_sys->b_error = true;
+        return p_pic;
+    }
+
     /* Check for errors from codec */
     if(p_sys->b_error)
     {
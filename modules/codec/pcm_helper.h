@@ -0,0 +1,194 @@
+/*****************************************************************************
+ * pcm_helper.h: PCM interleaving and byte order conversion kernels
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_PCM_HELPER_H_
+#define VLC_PCM_HELPER_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__ARM_NEON__)
+# include <arm_neon.h>
+#endif
+
+/* The vector paths handle 16 bytes at a time, the remaining samples (and
+ * whole buffers on other CPUs) go through the plain C loops. Source and
+ * destination may be unaligned but must not overlap. */
+
+/**
+ * Swaps the byte order of i_samples 16-bits samples.
+ */
+static inline void pcm_Swap16( void *dst, const void *src, size_t i_samples )
+{
+    uint8_t *p_dst = dst;
+    const uint8_t *p_src = src;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    for( ; i + 8 <= i_samples; i += 8 )
+    {
+        __m128i v = _mm_loadu_si128( (const __m128i *)&p_src[2 * i] );
+        v = _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+        _mm_storeu_si128( (__m128i *)&p_dst[2 * i], v );
+    }
+#elif defined(__ARM_NEON__)
+    for( ; i + 8 <= i_samples; i += 8 )
+        vst1q_u8( &p_dst[2 * i], vrev16q_u8( vld1q_u8( &p_src[2 * i] ) ) );
+#endif
+    for( ; i < i_samples; i++ )
+    {
+        p_dst[2 * i + 0] = p_src[2 * i + 1];
+        p_dst[2 * i + 1] = p_src[2 * i + 0];
+    }
+}
+
+/**
+ * Swaps the byte order of i_samples 32-bits samples.
+ */
+static inline void pcm_Swap32( void *dst, const void *src, size_t i_samples )
+{
+    uint8_t *p_dst = dst;
+    const uint8_t *p_src = src;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    for( ; i + 4 <= i_samples; i += 4 )
+    {
+        __m128i v = _mm_loadu_si128( (const __m128i *)&p_src[4 * i] );
+        v = _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+        v = _mm_shufflelo_epi16( v, _MM_SHUFFLE(2, 3, 0, 1) );
+        v = _mm_shufflehi_epi16( v, _MM_SHUFFLE(2, 3, 0, 1) );
+        _mm_storeu_si128( (__m128i *)&p_dst[4 * i], v );
+    }
+#elif defined(__ARM_NEON__)
+    for( ; i + 4 <= i_samples; i += 4 )
+        vst1q_u8( &p_dst[4 * i], vrev32q_u8( vld1q_u8( &p_src[4 * i] ) ) );
+#endif
+    for( ; i < i_samples; i++ )
+    {
+        uint32_t x;
+        memcpy( &x, &p_src[4 * i], 4 );
+        x = bswap32( x );
+        memcpy( &p_dst[4 * i], &x, 4 );
+    }
+}
+
+/**
+ * Expands i_samples packed 24-bits big endian samples to native 32-bits
+ * samples (the low byte is zero).
+ */
+static inline void pcm_S24BToS32N( uint32_t *restrict p_dst,
+                                   const uint8_t *restrict p_src,
+                                   size_t i_samples )
+{
+    /* Unrolled so that the compiler can merge the loads and stores */
+    for( ; i_samples >= 4; i_samples -= 4, p_src += 12, p_dst += 4 )
+    {
+        p_dst[0] = (p_src[ 0] << 24) | (p_src[ 1] << 16) | (p_src[ 2] << 8);
+        p_dst[1] = (p_src[ 3] << 24) | (p_src[ 4] << 16) | (p_src[ 5] << 8);
+        p_dst[2] = (p_src[ 6] << 24) | (p_src[ 7] << 16) | (p_src[ 8] << 8);
+        p_dst[3] = (p_src[ 9] << 24) | (p_src[10] << 16) | (p_src[11] << 8);
+    }
+    for( ; i_samples > 0; i_samples--, p_src += 3 )
+        *(p_dst++) = (p_src[0] << 24) | (p_src[1] << 16) | (p_src[2] << 8);
+}
+
+/**
+ * Expands i_samples packed 24-bits little endian samples to native 32-bits
+ * samples (the low byte is zero).
+ */
+static inline void pcm_S24LToS32N( uint32_t *restrict p_dst,
+                                   const uint8_t *restrict p_src,
+                                   size_t i_samples )
+{
+    for( ; i_samples >= 4; i_samples -= 4, p_src += 12, p_dst += 4 )
+    {
+        p_dst[0] = (p_src[ 2] << 24) | (p_src[ 1] << 16) | (p_src[ 0] << 8);
+        p_dst[1] = (p_src[ 5] << 24) | (p_src[ 4] << 16) | (p_src[ 3] << 8);
+        p_dst[2] = (p_src[ 8] << 24) | (p_src[ 7] << 16) | (p_src[ 6] << 8);
+        p_dst[3] = (p_src[11] << 24) | (p_src[10] << 16) | (p_src[ 9] << 8);
+    }
+    for( ; i_samples > 0; i_samples--, p_src += 3 )
+        *(p_dst++) = (p_src[2] << 24) | (p_src[1] << 16) | (p_src[0] << 8);
+}
+
+/**
+ * Interleaves i_channels planes of i_samples 32-bits samples, shifting them
+ * left by i_shift bits. Output channel i is read from plane pi_index[i].
+ */
+static inline void pcm_Interleave32( int32_t *restrict p_out,
+                                     const int32_t * const *pp_in,
+                                     const unsigned char *restrict pi_index,
+                                     unsigned i_channels, size_t i_samples,
+                                     unsigned i_shift )
+{
+    size_t j = 0;
+
+    if( i_channels == 2 )
+    {
+        const int32_t *p_l = pp_in[pi_index[0]], *p_r = pp_in[pi_index[1]];
+#if defined(__SSE2__)
+        const __m128i shift = _mm_cvtsi32_si128( i_shift );
+
+        for( ; j + 4 <= i_samples; j += 4 )
+        {
+            __m128i l = _mm_loadu_si128( (const __m128i *)&p_l[j] );
+            __m128i r = _mm_loadu_si128( (const __m128i *)&p_r[j] );
+            l = _mm_sll_epi32( l, shift );
+            r = _mm_sll_epi32( r, shift );
+            _mm_storeu_si128( (__m128i *)&p_out[2 * j],
+                              _mm_unpacklo_epi32( l, r ) );
+            _mm_storeu_si128( (__m128i *)&p_out[2 * j + 4],
+                              _mm_unpackhi_epi32( l, r ) );
+        }
+#elif defined(__ARM_NEON__)
+        const int32x4_t shift = vdupq_n_s32( i_shift );
+
+        for( ; j + 4 <= i_samples; j += 4 )
+        {
+            uint32x4x2_t v;
+            v.val[0] = vshlq_u32( vld1q_u32( (const uint32_t *)&p_l[j] ), shift );
+            v.val[1] = vshlq_u32( vld1q_u32( (const uint32_t *)&p_r[j] ), shift );
+            vst2q_u32( (uint32_t *)&p_out[2 * j], v );
+        }
+#endif
+        for( ; j < i_samples; j++ )
+        {
+            p_out[2 * j + 0] = (uint32_t)p_l[j] << i_shift;
+            p_out[2 * j + 1] = (uint32_t)p_r[j] << i_shift;
+        }
+        return;
+    }
+
+    /* One plane at a time: each inner loop is a plain strided shift that
+     * the compiler can vectorize. */
+    for( unsigned i = 0; i < i_channels; i++ )
+    {
+        const int32_t *p_in = pp_in[pi_index[i]];
+        int32_t *p_dst = &p_out[i];
+
+        for( j = 0; j < i_samples; j++ )
+            p_dst[j * i_channels] = (uint32_t)p_in[j] << i_shift;
+    }
+}
+
+#endif
@@ -416,6 +416,12 @@ static void x264_log( void *, int i_level, const char *psz, va_list );
 
 #define HRD_TEXT N_("HRD-timing information")
 #define TUNE_TEXT N_("Default tune setting used" )
+#define LIVE_TEXT N_("Low latency live encoding")
+#define LIVE_LONGTEXT N_("Encode each frame as soon as it is received: " \
+    "adds the zerolatency tune (sliced threads, no lookahead nor B-frames), " \
+    "uses periodic intra refresh instead of IDR frames and, with a bitrate, " \
+    "a constant rate buffer of a single frame. Also enabled by " \
+    "--low-latency.")
 #define PRESET_TEXT N_("Default preset setting used" )
 
 #define X264_OPTIONS_TEXT N_("x264 advanced options")
@@ -751,6 +757,7 @@ vlc_module_begin ()
         vlc_config_set (VLC_CONFIG_LIST,
             (sizeof(x264_tune_names) / sizeof (char*)) - 1,
             x264_tune_names, x264_tune_names);
+    add_bool( SOUT_CFG_PREFIX "live", false, LIVE_TEXT, LIVE_LONGTEXT, false )
 
     add_string( SOUT_CFG_PREFIX "options", NULL, X264_OPTIONS_TEXT,
                 X264_OPTIONS_LONGTEXT, true )
@@ -775,7 +782,7 @@ static const char *const ppsz_sout_options[] = {
     "aq-mode", "aq-strength", "psy-rd", "psy", "profile", "lookahead", "slices",
     "slice-max-size", "slice-max-mbs", "intra-refresh", "mbtree", "hrd",
     "tune","preset", "opengop", "bluray-compat", "frame-packing", "options",
-    "fullrange",
+    "fullrange", "live",
     NULL
 };
 
@@ -907,6 +914,20 @@ static int  Open ( vlc_object_t *p_this )
         free(psz_preset);
         psz_preset = NULL;
     }
+
+    const bool b_live = var_GetBool( p_enc, SOUT_CFG_PREFIX "live" )
+                     || var_InheritBool( p_enc, "low-latency" );
+    if( b_live && psz_tune != NULL && strstr( psz_tune, "zerolatency" ) == NULL )
+    {
+        /* zerolatency can be combined with one psy tune */
+        char *psz_live;
+        if( asprintf( &psz_live, "%s%szerolatency", psz_tune,
+                      *psz_tune ? "," : "" ) != -1 )
+        {
+            free( psz_tune );
+            psz_tune = psz_live;
+        }
+    }
 #ifdef MODULE_NAME_IS_x262
     p_sys->param.b_mpeg2 = true;
     x264_param_default_mpeg2( &p_sys->param );
@@ -1294,6 +1315,31 @@ static int  Open ( vlc_object_t *p_this )
         p_sys->param.b_vfr_input = 0;
     }
 
+    if( b_live )
+    {
+        /* Spread the intra macroblocks over the GOP: without IDR size
+         * peaks, a single frame of VBV buffer is enough */
+        p_sys->param.b_intra_refresh = true;
+        if( p_sys->param.rc.i_rc_method == X264_RC_ABR &&
+            p_sys->param.rc.i_vbv_max_bitrate == 0 )
+        {
+            unsigned i_fps = 25;
+            if( p_enc->fmt_in.video.i_frame_rate_base > 0 &&
+                p_enc->fmt_in.video.i_frame_rate >=
+                p_enc->fmt_in.video.i_frame_rate_base )
+                i_fps = p_enc->fmt_in.video.i_frame_rate /
+                        p_enc->fmt_in.video.i_frame_rate_base;
+
+            p_sys->param.rc.i_vbv_max_bitrate = p_sys->param.rc.i_bitrate;
+            if( p_sys->param.rc.i_vbv_buffer_size == 0 )
+                p_sys->param.rc.i_vbv_buffer_size =
+                    __MAX( 1, p_sys->param.rc.i_bitrate / i_fps );
+        }
+        msg_Dbg( p_enc, "live encoding, VBV %d kbit/s, %d kbit",
+                 p_sys->param.rc.i_vbv_max_bitrate,
+                 p_sys->param.rc.i_vbv_buffer_size );
+    }
+
     /* Check slice-options */
     i_val = var_GetInteger( p_enc, SOUT_CFG_PREFIX "slices" );
     if( i_val > 0 )
@@ -146,6 +146,16 @@ struct decoder_sys_t
     bool              b_update;
     bool              b_text;   /* Subtitles as text */
 
+    /* Content of the page drawn last, to skip drawing it again */
+    struct
+    {
+        int           pgno, subno;
+        int           i_first_row, i_rows, i_columns;
+        int           i_align;
+        bool          b_opaque;
+        vbi_char      *p_text; /* NULL if nothing was drawn */
+    }                 drawn;
+
     vlc_mutex_t       lock; /* Lock to protect the following variables */
     /* Positioning of Teletext images */
     int               i_align;
@@ -171,6 +181,9 @@ static void EventHandler( vbi_event *ev, void *user_data );
 static int OpaquePage( picture_t *p_src, const vbi_page *p_page,
                        const video_format_t fmt, bool b_opaque, const int text_offset );
 static int get_first_visible_row( vbi_char *p_text, int rows, int columns);
+static bool IsPageDrawn( decoder_sys_t *, const vbi_page *,
+                         int i_first_row, int i_rows, int i_align,
+                         bool b_opaque );
 static int get_last_visible_row( vbi_char *p_text, int rows, int columns);
 
 /* Properties callbacks */
@@ -285,6 +298,7 @@ static void Close( vlc_object_t *p_this )
 
     if( p_sys->p_vbi_dec )
         vbi_decoder_delete( p_sys->p_vbi_dec );
+    free( p_sys->drawn.p_text );
     free( p_sys );
 }
 
@@ -312,6 +326,10 @@ static subpicture_t *Decode( decoder_t *p_dec, block_t **pp_block )
     p_block = *pp_block;
     *pp_block = NULL;
 
+    /* The page drawn last may have been flushed from the screen */
+    if( p_block->i_flags & (BLOCK_FLAG_DISCONTINUITY|BLOCK_FLAG_CORRUPTED) )
+        FREENULL( p_sys->drawn.p_text );
+
     if( p_block->i_buffer > 0 &&
         ( ( p_block->p_buffer[0] >= 0x10 && p_block->p_buffer[0] <= 0x1f ) ||
           ( p_block->p_buffer[0] >= 0x99 && p_block->p_buffer[0] <= 0x9b ) ) )
@@ -385,6 +403,7 @@ static subpicture_t *Decode( decoder_t *p_dec, block_t **pp_block )
                 goto error;
             subpicture_updater_sys_t *p_spu_sys = p_spu->updater.p_sys;
             p_spu_sys->p_segments = text_segment_New("");
+            FREENULL( p_sys->drawn.p_text );
 
             p_sys->b_update = true;
             p_sys->i_last_page = i_wanted_page;
@@ -414,13 +433,24 @@ static subpicture_t *Decode( decoder_t *p_dec, block_t **pp_block )
              i_first_row + 1, i_first_row + i_num_rows, p_page.rows );
 #endif
 
+    /* The pages are transmitted again and again, often only with a new
+     * header or clock. The drawn ones stay on screen until replaced, so
+     * only the changed ones are drawn again. */
+    if( !p_sys->b_text &&
+        IsPageDrawn( p_sys, &p_page, i_first_row, i_num_rows, i_align,
+                     b_opaque ) )
+        goto error;
+
     /* If there is a page or sub to render, then we do that here */
     /* Create the subpicture unit */
     p_spu = Subpicture( p_dec, &fmt, p_sys->b_text,
                         p_page.columns, i_num_rows,
                         i_align, p_block->i_pts );
     if( !p_spu )
+    {
+        FREENULL( p_sys->drawn.p_text );
         goto error;
+    }
 
     if( p_sys->b_text )
     {
@@ -596,6 +626,40 @@ static void EventHandler( vbi_event *ev, void *user_data )
         msg_Dbg( p_dec, "Network ID changed" );
 }
 
+/* Returns true if the same page content was drawn last, and remembers it
+ * as drawn otherwise */
+static bool IsPageDrawn( decoder_sys_t *p_sys, const vbi_page *p_page,
+                         int i_first_row, int i_rows, int i_align,
+                         bool b_opaque )
+{
+    const vbi_char *p_text = &p_page->text[i_first_row * p_page->columns];
+    const size_t i_size = i_rows * p_page->columns * sizeof(*p_text);
+
+    if( p_sys->drawn.p_text &&
+        p_sys->drawn.pgno == p_page->pgno &&
+        p_sys->drawn.subno == p_page->subno &&
+        p_sys->drawn.i_first_row == i_first_row &&
+        p_sys->drawn.i_rows == i_rows &&
+        p_sys->drawn.i_columns == p_page->columns &&
+        p_sys->drawn.i_align == i_align &&
+        p_sys->drawn.b_opaque == b_opaque &&
+        !memcmp( p_sys->drawn.p_text, p_text, i_size ) )
+        return true;
+
+    free( p_sys->drawn.p_text );
+    p_sys->drawn.p_text = malloc( i_size > 0 ? i_size : 1 );
+    if( p_sys->drawn.p_text )
+        memcpy( p_sys->drawn.p_text, p_text, i_size );
+    p_sys->drawn.pgno = p_page->pgno;
+    p_sys->drawn.subno = p_page->subno;
+    p_sys->drawn.i_first_row = i_first_row;
+    p_sys->drawn.i_rows = i_rows;
+    p_sys->drawn.i_columns = p_page->columns;
+    p_sys->drawn.i_align = i_align;
+    p_sys->drawn.b_opaque = b_opaque;
+    return false;
+}
+
 static int get_first_visible_row( vbi_char *p_text, int rows, int columns)
 {
     for ( int i = 0; i < rows * columns; i++ )
@@ -0,0 +1,234 @@
+/*****************************************************************************
+ * metrics.c: statistics export in the Prometheus text format
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_interface.h>
+#include <vlc_input.h>
+#include <vlc_playlist.h>
+#include <vlc_httpd.h>
+
+static int  Open (vlc_object_t *);
+static void Close(vlc_object_t *);
+
+#define PATH_TEXT N_("Metrics URL path")
+#define PATH_LONGTEXT N_( \
+    "Path of the URL serving the statistics, on the HTTP host and port " \
+    "set with --http-host and --http-port.")
+
+vlc_module_begin()
+    set_shortname(N_("Metrics"))
+    set_description(N_("Statistics export over HTTP"))
+    set_category(CAT_INTERFACE)
+    set_subcategory(SUBCAT_INTERFACE_CONTROL)
+    add_string("metrics-path", "/metrics", PATH_TEXT, PATH_LONGTEXT, true)
+    set_capability("interface", 0)
+    set_callbacks(Open, Close)
+    add_shortcut("metrics", "prometheus")
+vlc_module_end()
+
+struct intf_sys_t
+{
+    playlist_t   *playlist;
+    httpd_host_t *host;
+    httpd_file_t *file;
+    mtime_t       start;
+};
+
+/* Prints the header of a metric family */
+static void PrintFamily(FILE *out, const char *name, const char *type,
+                        const char *help)
+{
+    fprintf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/* Prints a label value, escaped as the exposition format requires */
+static void PrintLabel(FILE *out, const char *value)
+{
+    for (const char *p = value; *p != '\0'; p++)
+        switch (*p)
+        {
+            case '\\': fputs("\\\\", out); break;
+            case '"':  fputs("\\\"", out); break;
+            case '\n': fputs("\\n", out);  break;
+            default:   fputc(*p, out);
+        }
+}
+
+static void PrintInput(FILE *out, input_thread_t *input)
+{
+    input_item_t *item = input_GetItem(input);
+    input_stats_t *st = item->p_stats;
+    char *uri = input_item_GetURI(item);
+
+#define METRIC(name, type, help, value) \
+    do { \
+        PrintFamily(out, "vlc_input_" name, type, help); \
+        fputs("vlc_input_" name "{input=\"", out); \
+        PrintLabel(out, (uri != NULL) ? uri : ""); \
+        fprintf(out, "\"} %"PRId64"\n", (int64_t)(value)); \
+    } while (0)
+#define COUNTER(name, help, value) METRIC(name "_total", "counter", help, value)
+#define GAUGE(name, help, value)   METRIC(name, "gauge", help, value)
+
+    vlc_mutex_lock(&st->lock);
+    /* Access and demux */
+    COUNTER("read_bytes", "Bytes read from the access.", st->i_read_bytes);
+    COUNTER("read_packets", "Packets read from the access.",
+            st->i_read_packets);
+    GAUGE("input_bitrate_bytes", "Access read rate (bytes/s).",
+          st->f_input_bitrate * CLOCK_FREQ);
+    COUNTER("demux_read_bytes", "Bytes demultiplexed.",
+            st->i_demux_read_bytes);
+    GAUGE("demux_bitrate_bytes", "Demultiplexing rate (bytes/s).",
+          st->f_demux_bitrate * CLOCK_FREQ);
+    COUNTER("demux_corrupted", "Corrupted demultiplexed packets.",
+            st->i_demux_corrupted);
+    COUNTER("demux_discontinuity", "Discontinuities in the stream.",
+            st->i_demux_discontinuity);
+    /* Decoders */
+    COUNTER("decoded_video", "Decoded video blocks.", st->i_decoded_video);
+    COUNTER("decoded_audio", "Decoded audio blocks.", st->i_decoded_audio);
+    COUNTER("decoder_held", "Blocks held back by full decoder queues.",
+            st->i_decoder_held);
+    GAUGE("decoder_latency_microseconds",
+          "Time spent decoding the last block.", st->i_decoder_latency);
+    GAUGE("video_fifo_bytes", "Data queued to the video decoder.",
+          st->i_video_fifo);
+    GAUGE("audio_fifo_bytes", "Data queued to the audio decoder.",
+          st->i_audio_fifo);
+    /* Outputs */
+    COUNTER("displayed_pictures", "Pictures displayed.",
+            st->i_displayed_pictures);
+    COUNTER("lost_pictures", "Pictures lost or dropped.",
+            st->i_lost_pictures);
+    COUNTER("late_pictures", "Pictures output after their date.",
+            st->i_late_pictures);
+    GAUGE("zap_time_microseconds",
+          "Delay until the first picture of the input is displayed.",
+          st->i_zap_time);
+    COUNTER("played_abuffers", "Audio buffers played.",
+            st->i_played_abuffers);
+    COUNTER("lost_abuffers", "Audio buffers lost.", st->i_lost_abuffers);
+    GAUGE("audio_latency_microseconds", "Audio output playback delay.",
+          st->i_audio_latency);
+    COUNTER("sent_packets", "Packets sent by the stream output.",
+            st->i_sent_packets);
+    COUNTER("sent_bytes", "Bytes sent by the stream output.",
+            st->i_sent_bytes);
+    vlc_mutex_unlock(&st->lock);
+
+    GAUGE("state", "Input state (see input_state_e).",
+          var_GetInteger(input, "state"));
+#undef GAUGE
+#undef COUNTER
+#undef METRIC
+    free(uri);
+}
+
+static int Fill(httpd_file_sys_t *data, httpd_file_t *file, uint8_t *request,
+                uint8_t **pp_data, int *pi_data)
+{
+    intf_thread_t *intf = (intf_thread_t *)data;
+    intf_sys_t *sys = intf->p_sys;
+    char *buf;
+    size_t len;
+    (void) file; (void) request;
+
+    FILE *out = open_memstream(&buf, &len);
+    if (out == NULL)
+        return VLC_ENOMEM;
+
+    PrintFamily(out, "vlc_uptime_seconds", "gauge",
+                "Time since the metrics interface started.");
+    fprintf(out, "vlc_uptime_seconds %"PRId64"\n",
+            (mdate() - sys->start) / CLOCK_FREQ);
+
+    playlist_Lock(sys->playlist);
+    int items = playlist_CurrentSize(sys->playlist);
+    playlist_Unlock(sys->playlist);
+    PrintFamily(out, "vlc_playlist_items", "gauge",
+                "Items in the current playing context.");
+    fprintf(out, "vlc_playlist_items %d\n", items);
+
+    input_thread_t *input = playlist_CurrentInput(sys->playlist);
+    PrintFamily(out, "vlc_inputs", "gauge", "Inputs being played.");
+    fprintf(out, "vlc_inputs %d\n", input != NULL);
+    if (input != NULL)
+    {
+        PrintInput(out, input);
+        vlc_object_release(input);
+    }
+
+    if (fclose(out))
+        return VLC_ENOMEM;
+
+    *pp_data = (uint8_t *)buf;
+    *pi_data = len;
+    return VLC_SUCCESS;
+}
+
+static int Open(vlc_object_t *obj)
+{
+    intf_thread_t *intf = (intf_thread_t *)obj;
+    intf_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    intf->p_sys = sys;
+    sys->playlist = pl_Get(intf);
+    sys->start = mdate();
+    sys->host = vlc_http_HostNew(obj);
+    if (sys->host == NULL)
+        goto error;
+
+    char *path = var_InheritString(intf, "metrics-path");
+    sys->file = httpd_FileNew(sys->host, (path != NULL) ? path : "/metrics",
+                              "text/plain; version=0.0.4", NULL, NULL, Fill,
+                              (httpd_file_sys_t *)intf);
+    free(path);
+    if (sys->file == NULL)
+    {
+        httpd_HostDelete(sys->host);
+        goto error;
+    }
+    return VLC_SUCCESS;
+error:
+    msg_Err(intf, "cannot serve the metrics");
+    free(sys);
+    return VLC_EGENERIC;
+}
+
+static void Close(vlc_object_t *obj)
+{
+    intf_thread_t *intf = (intf_thread_t *)obj;
+    intf_sys_t *sys = intf->p_sys;
+
+    httpd_FileDelete(sys->file);
+    httpd_HostDelete(sys->host);
+    free(sys);
+}
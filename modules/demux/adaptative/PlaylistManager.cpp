@@ -30,9 +30,11 @@
 #include "playlist/BaseAdaptationSet.h"
 #include "playlist/BaseRepresentation.h"
 #include "http/HTTPConnectionManager.h"
+#include "http/SegmentCache.hpp"
 #include "logic/AlwaysBestAdaptationLogic.h"
 #include "logic/RateBasedAdaptationLogic.h"
 #include "logic/AlwaysLowestAdaptationLogic.hpp"
+#include "logic/HybridAdaptationLogic.hpp"
 #include "plumbing/StreamOutput.hpp"
 #include <vlc_stream.h>
 #include <vlc_demux.h>
@@ -48,12 +50,14 @@ PlaylistManager::PlaylistManager( demux_t *p_demux_,
                                   AbstractStreamOutputFactory *factory,
                                   AbstractAdaptationLogic::LogicType type ) :
              conManager     ( NULL ),
+             cache          ( NULL ),
              logicType      ( type ),
              playlist       ( pl ),
              streamOutputFactory( factory ),
              p_demux        ( p_demux_ ),
              nextPlaylistupdate  ( 0 ),
-             i_nzpcr        ( 0 )
+             i_nzpcr        ( 0 ),
+             startupTime    ( 0 )
 {
     currentPeriod = playlist->getFirstPeriod();
 }
@@ -63,6 +67,7 @@ PlaylistManager::~PlaylistManager   ()
     delete conManager;
     delete streamOutputFactory;
     unsetPeriod();
+    delete cache;
     delete playlist;
 }
 
@@ -122,7 +127,16 @@ bool PlaylistManager::setupPeriod()
                 if(!set->description.Get().empty())
                     st->setDescription(set->description.Get());
 
-                st->create(logic, tracker, streamOutputFactory);
+                /* Rate driven logics start from the lowest representation */
+                if(logicType == AbstractAdaptationLogic::Default ||
+                   logicType == AbstractAdaptationLogic::RateBased ||
+                   logicType == AbstractAdaptationLogic::Hybrid)
+                    tracker->setFastStart(var_InheritBool(p_demux, "adaptative-faststart"));
+                if(playlist->isLive())
+                    tracker->setLiveDelay(CLOCK_FREQ / 1000 *
+                                          var_InheritInteger(p_demux, "adaptative-livedelay"));
+
+                st->create(logic, tracker, streamOutputFactory, cache);
 
                 streams.push_back(st);
             } catch (int) {
@@ -135,6 +149,18 @@ bool PlaylistManager::setupPeriod()
 
 bool PlaylistManager::start()
 {
+    startupTime = mdate();
+
+    size_t cachesize = var_InheritInteger(p_demux, "adaptative-cache-mem") * 1024;
+    char *psz_cachedir = var_InheritString(p_demux, "adaptative-cache-dir");
+    if(cachesize || psz_cachedir)
+    {
+        uint64_t disksize = var_InheritInteger(p_demux, "adaptative-cache-disk") * 1024 * 1024;
+        cache = new (std::nothrow) SegmentCache(VLC_OBJECT(p_demux), cachesize,
+                                                psz_cachedir ? psz_cachedir : "", disksize);
+    }
+    free(psz_cachedir);
+
     if(!setupPeriod())
         return false;
 
@@ -309,6 +335,12 @@ int PlaylistManager::doDemux(int64_t increment)
         {
             i_nzpcr += increment;
             es_out_Control(p_demux->out, ES_OUT_SET_GROUP_PCR, 0, VLC_TS_0 + i_nzpcr);
+            if(startupTime)
+            {
+                msg_Dbg(p_demux, "first data sent to decoders after %" PRId64 " ms",
+                        (mdate() - startupTime) / 1000);
+                startupTime = 0;
+            }
         }
         break;
     }
@@ -401,6 +433,8 @@ AbstractAdaptationLogic *PlaylistManager::createLogic(AbstractAdaptationLogic::L
         case AbstractAdaptationLogic::Default:
         case AbstractAdaptationLogic::RateBased:
             return new (std::nothrow) RateBasedAdaptationLogic(0, 0);
+        case AbstractAdaptationLogic::Hybrid:
+            return new (std::nothrow) HybridAdaptationLogic();
         default:
             return NULL;
     }
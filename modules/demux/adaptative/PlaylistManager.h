@@ -37,6 +37,7 @@ namespace adaptative
     namespace http
     {
         class HTTPConnectionManager;
+        class SegmentCache;
     }
 
     using namespace playlist;
@@ -80,6 +81,7 @@ namespace adaptative
             virtual AbstractAdaptationLogic *createLogic(AbstractAdaptationLogic::LogicType);
 
             HTTPConnectionManager              *conManager;
+            SegmentCache                       *cache;
             AbstractAdaptationLogic::LogicType  logicType;
             AbstractPlaylist                    *playlist;
             AbstractStreamOutputFactory         *streamOutputFactory;
@@ -87,6 +89,7 @@ namespace adaptative
             std::vector<Stream *>                streams;
             time_t                               nextPlaylistupdate;
             mtime_t                              i_nzpcr;
+            mtime_t                              startupTime;
             BasePeriod                          *currentPeriod;
     };
 
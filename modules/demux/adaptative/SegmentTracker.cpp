@@ -22,7 +22,9 @@
 #include "playlist/BaseRepresentation.h"
 #include "playlist/BaseAdaptationSet.h"
 #include "playlist/Segment.h"
+#include "playlist/SegmentChunk.hpp"
 #include "logic/AbstractAdaptationLogic.h"
+#include "logic/Representationselectors.hpp"
 
 using namespace adaptative;
 using namespace adaptative::logic;
@@ -34,6 +36,8 @@ SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSe
     initializing = true;
     index_sent = false;
     init_sent = false;
+    faststart = false;
+    liveDelay = 0;
     prevRepresentation = NULL;
     setAdaptationLogic(logic_);
     adaptationSet = adaptSet;
@@ -49,6 +53,16 @@ void SegmentTracker::setAdaptationLogic(AbstractAdaptationLogic *logic_)
     logic = logic_;
 }
 
+void SegmentTracker::setFastStart(bool b)
+{
+    faststart = b;
+}
+
+void SegmentTracker::setLiveDelay(mtime_t delay)
+{
+    liveDelay = delay;
+}
+
 void SegmentTracker::resetCounter()
 {
     count = 0;
@@ -70,6 +84,14 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed)
     if( !switch_allowed ||
        (prevRepresentation && prevRepresentation->getSwitchPolicy() == SegmentInformation::SWITCH_UNAVAILABLE) )
         rep = prevRepresentation;
+    else if( faststart && !prevRepresentation )
+    {
+        /* No rate sample yet: start with the smallest segments, the
+           logic takes over as soon as the first ones are downloaded */
+        RepresentationSelector selector;
+        rep = selector.select(adaptationSet, 0);
+        faststart = false;
+    }
     else
         rep = logic->getCurrentRepresentation(adaptationSet);
 
@@ -99,6 +121,15 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed)
             return segment->toChunk(count, rep);
     }
 
+    if(liveDelay)
+    {
+        /* Skip the older part of the live window */
+        uint64_t livecount;
+        if(rep->getLiveStartSegmentNumber(liveDelay, &livecount) && livecount > count)
+            count = livecount;
+        liveDelay = 0;
+    }
+
     segment = rep->getSegment(BaseRepresentation::INFOTYPE_MEDIA, count);
     if(!segment)
     {
@@ -110,7 +141,13 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed)
 
     SegmentChunk *chunk = segment->toChunk(count, rep);
     if(chunk)
+    {
+        const mtime_t start = rep->getPlaybackTimeBySegmentNumber(count);
         count++;
+        const mtime_t end = rep->getPlaybackTimeBySegmentNumber(count);
+        if(start != VLC_TS_INVALID && end > start)
+            chunk->setDuration(end - start);
+    }
 
     return chunk;
 }
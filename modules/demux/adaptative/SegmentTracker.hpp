@@ -51,6 +51,8 @@ namespace adaptative
             ~SegmentTracker();
 
             void setAdaptationLogic(AbstractAdaptationLogic *);
+            void setFastStart(bool);
+            void setLiveDelay(mtime_t);
             void resetCounter();
             SegmentChunk* getNextChunk(bool);
             bool setPosition(mtime_t, bool, bool);
@@ -61,6 +63,8 @@ namespace adaptative
             bool initializing;
             bool index_sent;
             bool init_sent;
+            bool faststart;
+            mtime_t liveDelay; /* to the live edge, applied once at start */
             uint64_t count;
             AbstractAdaptationLogic *logic;
             BaseAdaptationSet *adaptationSet;
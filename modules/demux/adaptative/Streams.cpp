@@ -20,6 +20,8 @@
 #include "Streams.hpp"
 #include "http/HTTPConnection.hpp"
 #include "http/HTTPConnectionManager.h"
+#include "http/Prefetcher.hpp"
+#include "http/SegmentCache.hpp"
 #include "logic/AbstractAdaptationLogic.h"
 #include "playlist/SegmentChunk.hpp"
 #include "plumbing/StreamOutput.hpp"
@@ -38,6 +40,10 @@ Stream::Stream(demux_t * demux_, const StreamFormat &format_)
     output = NULL;
     adaptationLogic = NULL;
     currentChunk = NULL;
+    prefetcher = NULL;
+    cache = NULL;
+    cacheChain = NULL;
+    cacheTail = NULL;
     eof = false;
     disabled = false;
     segmentTracker = NULL;
@@ -46,6 +52,9 @@ Stream::Stream(demux_t * demux_, const StreamFormat &format_)
 
 Stream::~Stream()
 {
+    flushPrefetched();
+    dropCacheData();
+    delete prefetcher;
     delete currentChunk;
     delete adaptationLogic;
     delete output;
@@ -67,12 +76,20 @@ StreamType Stream::mimeToType(const std::string &mime)
 }
 
 void Stream::create(AbstractAdaptationLogic *logic, SegmentTracker *tracker,
-                    const AbstractStreamOutputFactory *factory)
+                    const AbstractStreamOutputFactory *factory, SegmentCache *cache_)
 {
     adaptationLogic = logic;
     segmentTracker = tracker;
     streamOutputFactory = factory;
+    cache = cache_;
     updateFormat(format);
+
+    int64_t depth = var_InheritInteger(p_demux, "adaptative-prefetch");
+    if(depth > 0)
+    {
+        size_t budget = var_InheritInteger(p_demux, "adaptative-prefetch-mem") * 1024;
+        prefetcher = Prefetcher::create(VLC_OBJECT(p_demux->s), depth, budget);
+    }
 }
 
 void Stream::updateFormat(StreamFormat &newformat)
@@ -139,6 +156,7 @@ SegmentChunk * Stream::getChunk()
             disabled = true;
             return NULL;
         }
+        updateBufferLevel();
         currentChunk = segmentTracker->getNextChunk(output->switchAllowed());
         if (currentChunk == NULL)
             eof = true;
@@ -202,10 +220,25 @@ Stream::status Stream::demux(HTTPConnectionManager *connManager, mtime_t nz_dead
 
 size_t Stream::read(HTTPConnectionManager *connManager)
 {
+    if(prefetcher)
+        return readPrefetched();
+
     SegmentChunk *chunk = getChunk();
     if(!chunk)
         return 0;
 
+    if(cache && chunk->getBytesRead() == 0 && !chunk->getConnection())
+    {
+        block_t *block = cache->get(SegmentCache::getKey(chunk));
+        if(block)
+        {
+            currentChunk = NULL;
+            size_t readsize = readCached(chunk, block);
+            delete chunk;
+            return readsize;
+        }
+    }
+
     if(!chunk->getConnection())
     {
        if(!connManager->connectChunk(chunk))
@@ -226,6 +259,9 @@ size_t Stream::read(HTTPConnectionManager *connManager)
             return 0;
         }
         b_segment_head_chunk = true;
+        adaptationLogic->updateRequestStats(chunk->isConnectionReused(),
+                                            chunk->getConnectTime(),
+                                            chunk->getResponseTime());
     }
 
     /* Because we don't know Chunk size at start, we need to get size
@@ -255,6 +291,7 @@ size_t Stream::read(HTTPConnectionManager *connManager)
         block->i_buffer = (size_t)ret;
 
         adaptationLogic->updateDownloadRate(block->i_buffer, time);
+        cacheData(chunk, block, b_segment_head_chunk, chunk->getBytesToRead() == 0);
         chunk->onDownload(&block);
 
         StreamFormat chunkStreamFormat = chunk->getStreamFormat();
@@ -274,6 +311,13 @@ size_t Stream::read(HTTPConnectionManager *connManager)
 
     readsize = block->i_buffer;
 
+    /* The end of a transfer of unknown length comes without data */
+    if(readsize == 0 && !currentChunk)
+    {
+        block_Release(block);
+        return read(connManager);
+    }
+
     if(output)
         output->pushBlock(block, b_segment_head_chunk);
     else
@@ -282,6 +326,210 @@ size_t Stream::read(HTTPConnectionManager *connManager)
     return readsize;
 }
 
+size_t Stream::readPrefetched()
+{
+    if(esCount() && !isSelected())
+    {
+        flushPrefetched();
+        disabled = true;
+        return 0;
+    }
+
+    /* Keep the look-ahead queue filled. Once the tracker ran out of
+       segments, only ask again after reporting the end of the queue */
+    while(!eof && !prefetcher->isFull() &&
+          prefetchedChunks.size() < prefetcher->getDepth())
+    {
+        updateBufferLevel();
+        SegmentChunk *chunk = segmentTracker->getNextChunk(output->switchAllowed());
+        if(chunk == NULL)
+        {
+            eof = true;
+            break;
+        }
+        block_t *cached = (cache) ? cache->get(SegmentCache::getKey(chunk)) : NULL;
+        if(cached)
+        {
+            cachedChunks[chunk] = cached;
+        }
+        else if(!prefetcher->enqueue(chunk))
+        {
+            delete chunk;
+            break;
+        }
+        prefetchedChunks.push_back(chunk);
+    }
+
+    if(prefetchedChunks.empty())
+    {
+        eof = false;
+        return 0;
+    }
+
+    SegmentChunk *chunk = prefetchedChunks.front();
+
+    std::map<SegmentChunk *, block_t *>::iterator cacheit = cachedChunks.find(chunk);
+    if(cacheit != cachedChunks.end())
+    {
+        block_t *cached = (*cacheit).second;
+        cachedChunks.erase(cacheit);
+        prefetchedChunks.pop_front();
+        size_t readsize = readCached(chunk, cached);
+        delete chunk;
+        return readsize;
+    }
+
+    bool b_segment_head_chunk = (chunk->getBytesRead() == 0);
+    bool b_last;
+    mtime_t time;
+
+    block_t *block = prefetcher->read(&time, &b_last);
+    if(b_last)
+        prefetchedChunks.pop_front();
+
+    if(!block)
+    {
+        delete chunk;
+        return 0;
+    }
+
+    if(b_segment_head_chunk)
+        adaptationLogic->updateRequestStats(chunk->isConnectionReused(),
+                                            chunk->getConnectTime(),
+                                            chunk->getResponseTime());
+    adaptationLogic->updateDownloadRate(block->i_buffer, time);
+    cacheData(chunk, block, b_segment_head_chunk, b_last);
+    chunk->onDownload(&block);
+
+    StreamFormat chunkStreamFormat = chunk->getStreamFormat();
+    if(output && chunkStreamFormat != output->getStreamFormat())
+    {
+        msg_Info(p_demux, "Changing stream format");
+        updateFormat(chunkStreamFormat);
+    }
+
+    if(b_last)
+        delete chunk;
+
+    size_t readsize = block->i_buffer;
+
+    if(readsize == 0 && b_last)
+    {
+        block_Release(block);
+        return readPrefetched();
+    }
+
+    if(output)
+        output->pushBlock(block, b_segment_head_chunk);
+    else
+        block_Release(block);
+
+    return readsize;
+}
+
+void Stream::flushPrefetched()
+{
+    if(!prefetcher)
+        return;
+    prefetcher->flush();
+    std::list<SegmentChunk *>::iterator it;
+    for(it = prefetchedChunks.begin(); it != prefetchedChunks.end(); ++it)
+        delete *it;
+    prefetchedChunks.clear();
+
+    std::map<SegmentChunk *, block_t *>::iterator cacheit;
+    for(cacheit = cachedChunks.begin(); cacheit != cachedChunks.end(); ++cacheit)
+        block_Release((*cacheit).second);
+    cachedChunks.clear();
+    dropCacheData();
+}
+
+/* Hands a whole chunk from the cache to the demuxer, as if downloaded */
+size_t Stream::readCached(SegmentChunk *chunk, block_t *block)
+{
+    chunk->setLength(block->i_buffer);
+    chunk->setBytesRead(block->i_buffer);
+    chunk->onDownload(&block);
+
+    StreamFormat chunkStreamFormat = chunk->getStreamFormat();
+    if(output && chunkStreamFormat != output->getStreamFormat())
+    {
+        msg_Info(p_demux, "Changing stream format");
+        updateFormat(chunkStreamFormat);
+    }
+
+    size_t readsize = block->i_buffer;
+
+    if(output)
+        output->pushBlock(block, true);
+    else
+        block_Release(block);
+
+    return readsize;
+}
+
+/* Keeps a copy of the raw data of the chunk being downloaded, and
+   stores it into the cache once complete */
+void Stream::cacheData(SegmentChunk *chunk, block_t *block, bool b_head, bool b_last)
+{
+    if(!cache)
+        return;
+
+    if(b_head)
+    {
+        dropCacheData();
+        cacheTail = &cacheChain;
+    }
+
+    if(!cacheTail) /* missed the beginning */
+        return;
+
+    block_t *copy = block_Duplicate(block);
+    if(!copy)
+    {
+        dropCacheData();
+        return;
+    }
+    block_ChainLastAppend(&cacheTail, copy);
+
+    if(b_last)
+    {
+        block_t *data = block_ChainGather(cacheChain);
+        cacheChain = NULL;
+        cacheTail = NULL;
+        if(data)
+            cache->put(SegmentCache::getKey(chunk), data);
+    }
+}
+
+void Stream::dropCacheData()
+{
+    block_ChainRelease(cacheChain);
+    cacheChain = NULL;
+    cacheTail = NULL;
+}
+
+void Stream::updateBufferLevel()
+{
+    mtime_t level = 0;
+    mtime_t duration = 0;
+    std::list<SegmentChunk *>::const_iterator it;
+    for(it = prefetchedChunks.begin(); it != prefetchedChunks.end(); ++it)
+    {
+        const SegmentChunk *chunk = *it;
+        duration = chunk->getDuration();
+        const mtime_t length = chunk->getLength();
+        const mtime_t read = chunk->getBytesRead();
+        if(length > 0 && read <= length)
+            level += duration * (length - read) / length;
+        else
+            level += duration;
+    }
+
+    const unsigned depth = prefetcher ? prefetcher->getDepth() : 1;
+    adaptationLogic->updateBufferLevel(level, duration * depth, duration);
+}
+
 bool Stream::setPosition(mtime_t time, bool tryonly)
 {
     if(!output)
@@ -290,6 +538,8 @@ bool Stream::setPosition(mtime_t time, bool tryonly)
     bool ret = segmentTracker->setPosition(time, output->reinitsOnSeek(), tryonly);
     if(!tryonly && ret)
     {
+        /* The look-ahead chunks belong to the previous position */
+        flushPrefetched();
         output->setPosition(time);
         if(output->reinitsOnSeek())
         {
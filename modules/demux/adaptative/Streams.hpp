@@ -26,6 +26,7 @@
 
 #include <string>
 #include <list>
+#include <map>
 #include <vlc_common.h>
 #include <vlc_es.h>
 #include "StreamsType.hpp"
@@ -38,6 +39,8 @@ namespace adaptative
     namespace http
     {
         class HTTPConnectionManager;
+        class Prefetcher;
+        class SegmentCache;
     }
 
     namespace logic
@@ -66,7 +69,7 @@ namespace adaptative
         bool operator==(const Stream &) const;
         static StreamType mimeToType(const std::string &mime);
         void create(AbstractAdaptationLogic *, SegmentTracker *,
-                    const AbstractStreamOutputFactory *);
+                    const AbstractStreamOutputFactory *, SegmentCache *);
         void updateFormat(StreamFormat &);
         void setLanguage(const std::string &);
         void setDescription(const std::string &);
@@ -87,6 +90,12 @@ namespace adaptative
     private:
         SegmentChunk *getChunk();
         size_t read(HTTPConnectionManager *);
+        size_t readPrefetched();
+        void flushPrefetched();
+        void updateBufferLevel();
+        size_t readCached(SegmentChunk *, block_t *);
+        void cacheData(SegmentChunk *, block_t *, bool, bool);
+        void dropCacheData();
         demux_t *p_demux;
         StreamType type;
         StreamFormat format;
@@ -94,6 +103,12 @@ namespace adaptative
         AbstractAdaptationLogic *adaptationLogic;
         SegmentTracker *segmentTracker;
         SegmentChunk *currentChunk;
+        Prefetcher *prefetcher;
+        std::list<SegmentChunk *> prefetchedChunks;
+        SegmentCache *cache;
+        std::map<SegmentChunk *, block_t *> cachedChunks; /* look-ahead cache hits */
+        block_t *cacheChain; /* raw data of the chunk being read */
+        block_t **cacheTail;
         bool disabled;
         bool eof;
         std::string language;
@@ -67,15 +67,58 @@ static void Close   (vlc_object_t *);
 
 #define ADAPT_LOGIC_TEXT N_("Adaptation Logic")
 
+#define ADAPT_FASTSTART_TEXT N_("Fast start")
+#define ADAPT_FASTSTART_LONGTEXT N_("Start playback from the lowest " \
+    "quality, until the bandwidth has been measured.")
+
+#define ADAPT_PREFETCH_TEXT N_("Segments downloaded ahead")
+#define ADAPT_PREFETCH_LONGTEXT N_("Number of segments of each stream " \
+    "downloaded in parallel ahead of playback, to hide the request latency " \
+    "on high round trip time links. 0 downloads one segment at a time.")
+
+#define ADAPT_PREFETCH_MEM_TEXT N_("Look-ahead buffer size in KiB")
+#define ADAPT_PREFETCH_MEM_LONGTEXT N_("Maximum amount of data held by the " \
+    "segments downloaded ahead of each stream.")
+
+#define ADAPT_CACHE_MEM_TEXT N_("Segment cache size in KiB")
+#define ADAPT_CACHE_MEM_LONGTEXT N_("Amount of memory used to keep the " \
+    "recently downloaded segments, so that seeking back does not fetch " \
+    "them again. 0 disables the memory cache.")
+
+#define ADAPT_CACHE_DIR_TEXT N_("Segment cache directory")
+#define ADAPT_CACHE_DIR_LONGTEXT N_("Directory where downloaded segments " \
+    "are also stored, and reused across playbacks. Empty disables it.")
+
+#define ADAPT_CACHE_DISK_TEXT N_("Segment cache directory size in MiB")
+#define ADAPT_CACHE_DISK_LONGTEXT N_("Maximum size of the segment cache " \
+    "directory. The least recently used segments are removed first.")
+
+#define ADAPT_LOWLATENCY_TEXT N_("Low latency segment reading")
+#define ADAPT_LOWLATENCY_LONGTEXT N_("Hand the data of segments to the " \
+    "demuxer as soon as it is received, instead of in fixed size reads. " \
+    "Useful with servers sending live segments while they are produced.")
+
+#define ADAPT_LIVEDELAY_TEXT N_("Live delay in ms")
+#define ADAPT_LIVEDELAY_LONGTEXT N_("Start live streams that much behind " \
+    "the last available segment. 0 starts from the oldest segment of the " \
+    "live window.")
+
+#define ADAPT_HTTP2_TEXT N_("HTTP/2 segment retrieval")
+#define ADAPT_HTTP2_LONGTEXT N_("Retrieve the segments of HTTPS streams " \
+    "over a single multiplexed HTTP/2 connection per server, if the " \
+    "server supports it.")
+
 static const int pi_logics[] = {AbstractAdaptationLogic::RateBased,
                                 AbstractAdaptationLogic::FixedRate,
                                 AbstractAdaptationLogic::AlwaysLowest,
-                                AbstractAdaptationLogic::AlwaysBest};
+                                AbstractAdaptationLogic::AlwaysBest,
+                                AbstractAdaptationLogic::Hybrid};
 
 static const char *const ppsz_logics[] = { N_("Bandwidth Adaptive"),
                                            N_("Fixed Bandwidth"),
                                            N_("Lowest Bandwidth/Quality"),
-                                           N_("Highest Bandwith/Quality")};
+                                           N_("Highest Bandwith/Quality"),
+                                           N_("Bandwidth and Buffer Adaptive")};
 
 vlc_module_begin ()
         set_shortname( N_("Adaptative"))
@@ -89,6 +132,24 @@ vlc_module_begin ()
         add_integer( "adaptative-width",  480, ADAPT_WIDTH_TEXT,  ADAPT_WIDTH_TEXT,  true )
         add_integer( "adaptative-height", 360, ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, true )
         add_integer( "adaptative-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
+        add_bool(    "adaptative-faststart", true,
+                     ADAPT_FASTSTART_TEXT, ADAPT_FASTSTART_LONGTEXT, true )
+        add_integer_with_range( "adaptative-prefetch", 0, 0, 16,
+                                ADAPT_PREFETCH_TEXT, ADAPT_PREFETCH_LONGTEXT, true )
+        add_integer( "adaptative-prefetch-mem", 16384,
+                     ADAPT_PREFETCH_MEM_TEXT, ADAPT_PREFETCH_MEM_LONGTEXT, true )
+        add_integer( "adaptative-cache-mem", 0,
+                     ADAPT_CACHE_MEM_TEXT, ADAPT_CACHE_MEM_LONGTEXT, true )
+        add_directory( "adaptative-cache-dir", NULL,
+                       ADAPT_CACHE_DIR_TEXT, ADAPT_CACHE_DIR_LONGTEXT, true )
+        add_integer( "adaptative-cache-disk", 512,
+                     ADAPT_CACHE_DISK_TEXT, ADAPT_CACHE_DISK_LONGTEXT, true )
+        add_bool(    "adaptative-lowlatency", false,
+                     ADAPT_LOWLATENCY_TEXT, ADAPT_LOWLATENCY_LONGTEXT, true )
+        add_integer( "adaptative-livedelay", 0,
+                     ADAPT_LIVEDELAY_TEXT, ADAPT_LIVEDELAY_LONGTEXT, true )
+        add_bool(    "adaptative-http2", true,
+                     ADAPT_HTTP2_TEXT, ADAPT_HTTP2_LONGTEXT, true )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -38,9 +38,13 @@ Chunk::Chunk        (const std::string& url) :
        bitrate      (1),
        port         (0),
        length       (0),
+       lengthKnown  (true),
        bytesRead    (0),
        bytesToRead  (0),
-       connection   (NULL)
+       connection   (NULL),
+       connectionReused (false),
+       connectTime  (0),
+       responseTime (0)
 {
     this->url = url;
 
@@ -116,6 +120,25 @@ int                 Chunk::getBitrate           ()
     return this->bitrate;
 }
 
+void                Chunk::setRequestStats      (bool reused, int64_t connect, int64_t response)
+{
+    connectionReused = reused;
+    connectTime = connect;
+    responseTime = response;
+}
+bool                Chunk::isConnectionReused   () const
+{
+    return connectionReused;
+}
+int64_t             Chunk::getConnectTime       () const
+{
+    return connectTime;
+}
+int64_t             Chunk::getResponseTime      () const
+{
+    return responseTime;
+}
+
 const std::string&  Chunk::getScheme            () const
 {
     return scheme;
@@ -140,6 +163,16 @@ uint64_t            Chunk::getLength            () const
 void                Chunk::setLength            (uint64_t length)
 {
     this->length = length;
+    lengthKnown = true;
+}
+void                Chunk::setUnknownLength     ()
+{
+    length = 0;
+    lengthKnown = false;
+}
+bool                Chunk::isLengthKnown        () const
+{
+    return lengthKnown;
 }
 uint64_t            Chunk::getBytesRead         () const
 {
@@ -157,6 +190,8 @@ void                Chunk::setBytesToRead         (uint64_t bytes)
 
 uint64_t            Chunk::getBytesToRead       () const
 {
+        if(!lengthKnown)
+            return UINT64_MAX;
         return length - bytesRead;
 }
 
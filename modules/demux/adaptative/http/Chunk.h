@@ -53,6 +53,7 @@ namespace adaptative
                 uint64_t            getLength               () const;
                 uint64_t            getBytesRead            () const;
                 uint64_t            getBytesToRead          () const;
+                bool                isLengthKnown           () const;
                 size_t              getPercentDownloaded    () const;
                 HTTPConnection*     getConnection           () const;
 
@@ -60,12 +61,20 @@ namespace adaptative
                 void                setBytesRead    (uint64_t bytes);
                 void                setBytesToRead  (uint64_t bytes);
                 void                setLength       (uint64_t length);
+                /* Body delimited by the transfer (chunked encoding or end
+                   of connection): data is read until the connection
+                   sets the final length */
+                void                setUnknownLength();
                 void                setEndByte      (size_t endByte);
                 void                setStartByte    (size_t startByte);
                 void                addOptionalUrl  (const std::string& url);
                 bool                usesByteRange   () const;
                 void                setBitrate      (uint64_t bitrate);
                 int                 getBitrate      ();
+                void                setRequestStats (bool reused, int64_t connect, int64_t response);
+                bool                isConnectionReused      () const;
+                int64_t             getConnectTime          () const;
+                int64_t             getResponseTime         () const;
 
                 virtual void        onDownload      (block_t **) {}
 
@@ -80,9 +89,13 @@ namespace adaptative
                 int                         bitrate;
                 int                         port;
                 uint64_t                    length;
+                bool                        lengthKnown;
                 uint64_t                    bytesRead;
                 uint64_t                    bytesToRead;
                 HTTPConnection             *connection;
+                bool                        connectionReused;
+                int64_t                     connectTime;
+                int64_t                     responseTime;
         };
     }
 }
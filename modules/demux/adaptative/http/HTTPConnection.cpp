@@ -23,12 +23,17 @@
 #include "Chunk.h"
 #include "../adaptative/tools/Helper.h"
 
+#include <vlc_tls.h>
+#include "../../access/http/h2conn.h"
+
+#include <cerrno>
+#include <cstdlib>
 #include <sstream>
 
 using namespace adaptative::http;
 
 HTTPConnection::HTTPConnection(vlc_object_t *stream_, Socket *socket_,
-                               Chunk *chunk_, bool persistent)
+                               Chunk *chunk_, bool persistent_)
 {
     socket = socket_;
     stream = stream_;
@@ -36,8 +41,18 @@ HTTPConnection::HTTPConnection(vlc_object_t *stream_, Socket *socket_,
     toRead = 0;
     chunk = NULL;
     queryOk = false;
+    chunkedTransfer = false;
+    chunkedStarted = false;
+    chunkedRemaining = 0;
+    lowLatency = var_InheritBool(stream, "adaptative-lowlatency");
     retries = 0;
+    persistent = persistent_;
     connectionClose = !persistent;
+    connectTime = 0;
+    lastUse = mdate();
+    socketRequests = 0;
+    requests = 0;
+    connects = 0;
     bindChunk(chunk_);
 }
 
@@ -49,8 +64,12 @@ HTTPConnection::~HTTPConnection()
 
 bool HTTPConnection::connect(const std::string &hostname, int port)
 {
+    mtime_t time = mdate();
     if(!socket->connect(stream, hostname.c_str(), port))
         return false;
+    connectTime = mdate() - time;
+    socketRequests = 0;
+    connects++;
 
     this->hostname = hostname;
 
@@ -66,6 +85,7 @@ void HTTPConnection::disconnect()
 {
     queryOk = false;
     toRead = 0;
+    chunkedTransfer = false;
     socket->disconnect();
 }
 
@@ -75,41 +95,51 @@ int HTTPConnection::query(const std::string &path)
         return VLC_EGENERIC;
 
     queryOk = false;
+    connectionClose = !persistent;
+    chunkedTransfer = false;
+    chunkedStarted = false;
+    chunkedRemaining = 0;
 
     if(!connected() &&
        !connect(chunk->getHostname(), chunk->getPort()))
         return VLC_EGENERIC;
 
+    /* The server may have closed an idle kept-alive connection. Only
+       then retry once, on a new connection. */
+    const bool b_reused = (socketRequests > 0);
+
     std::string header = buildRequestHeader(path);
     if(connectionClose)
         header.append("Connection: close\r\n");
     header.append("\r\n");
 
+    mtime_t time = mdate();
+    socketRequests++;
+
     if(!send( header ))
     {
         socket->disconnect();
-        if(!connectionClose)
-        {
-            /* server closed connection pipeline after last req. need new */
-            connectionClose = true;
+        if(b_reused)
             return query(path);
-        }
         return VLC_EGENERIC;
     }
 
     int i_ret = parseReply();
     if(i_ret == VLC_SUCCESS)
     {
+        /* Without Content-Length, the body ends with the transfer */
+        if(chunkedTransfer || (connectionClose && toRead == 0))
+            chunk->setUnknownLength();
         queryOk = true;
+        requests++;
+        chunk->setRequestStats(b_reused, b_reused ? 0 : connectTime,
+                               mdate() - time);
     }
     else if(i_ret == VLC_EGENERIC)
     {
         socket->disconnect();
-        if(!connectionClose)
-        {
-            connectionClose = true;
+        if(b_reused)
             return query(path);
-        }
     }
 
     return i_ret;
@@ -132,12 +162,34 @@ ssize_t HTTPConnection::read(void *p_buffer, size_t len)
     if(len > chunk->getBytesToRead())
         len = chunk->getBytesToRead();
 
-    ssize_t ret = socket->read(stream, p_buffer, len);
-    if(ret >= 0)
+    ssize_t ret;
+    if(chunkedTransfer)
+        ret = readChunked(p_buffer, len);
+    else
+        ret = socket->read(stream, p_buffer, len, !lowLatency);
+    if(ret > 0)
         chunk->setBytesRead(chunk->getBytesRead() + ret);
 
-    if(ret < 0 || (size_t)ret < len) /* set EOF */
+    if(chunkedTransfer)
     {
+        if(ret < 0)
+        {
+            chunk->setBytesToRead(chunk->getBytesRead());
+            socket->disconnect();
+            return VLC_EGENERIC;
+        }
+        return ret;
+    }
+
+    if(ret < 0 || ret == 0 || (!lowLatency && (size_t)ret < len)) /* set EOF */
+    {
+        if(ret >= 0 && !chunk->isLengthKnown())
+        {
+            /* connection close delimited body */
+            chunk->setLength(chunk->getBytesRead());
+            socket->disconnect();
+            return ret;
+        }
         chunk->setBytesToRead(chunk->getBytesRead());
         socket->disconnect();
         return VLC_EGENERIC;
@@ -146,6 +198,46 @@ ssize_t HTTPConnection::read(void *p_buffer, size_t len)
     return ret;
 }
 
+/* Reads the body of a chunked transfer encoded reply. Returns 0 once
+   the last (empty) chunk has been read, and sets the final length */
+ssize_t HTTPConnection::readChunked(void *p_buffer, size_t len)
+{
+    if(chunkedRemaining == 0)
+    {
+        if(chunkedStarted)
+            readLine(); /* CRLF ending the previous chunk */
+        chunkedStarted = true;
+
+        std::string line = readLine();
+        if(line.empty())
+            return -1;
+
+        std::istringstream ss(line);
+        ss >> std::hex >> chunkedRemaining;
+        if(ss.fail())
+            return -1;
+
+        if(chunkedRemaining == 0)
+        {
+            /* skip trailers up to the final empty line */
+            while(!readLine().empty());
+            chunk->setLength(chunk->getBytesRead());
+            toRead = chunk->getBytesRead();
+            return 0;
+        }
+    }
+
+    if(len > chunkedRemaining)
+        len = chunkedRemaining;
+
+    ssize_t ret = socket->read(stream, p_buffer, len, !lowLatency);
+    if(ret <= 0 || (!lowLatency && (size_t)ret < len))
+        return -1;
+
+    chunkedRemaining -= ret;
+    return ret;
+}
+
 bool HTTPConnection::send(const std::string &data)
 {
     return send(data.c_str(), data.length());
@@ -172,7 +264,7 @@ int HTTPConnection::parseReply()
     if (replycode != 200 && replycode != 206)
         return VLC_ENOOBJ;
 
-    readLine();
+    line = readLine();
 
     while(!line.empty() && line.compare("\r\n"))
     {
@@ -224,6 +316,22 @@ void HTTPConnection::releaseChunk()
         chunk->setConnection(NULL);
         chunk = NULL;
     }
+    lastUse = mdate();
+}
+
+mtime_t HTTPConnection::getIdleTime() const
+{
+    return chunk ? 0 : mdate() - lastUse;
+}
+
+unsigned HTTPConnection::getRequestCount() const
+{
+    return requests;
+}
+
+unsigned HTTPConnection::getConnectCount() const
+{
+    return connects;
 }
 
 bool HTTPConnection::isAvailable() const
@@ -246,6 +354,10 @@ void HTTPConnection::onHeader(const std::string &key,
     {
         connectionClose = true;
     }
+    else if (key == "Transfer-Encoding" && value == "chunked")
+    {
+        chunkedTransfer = true;
+    }
 }
 
 std::string HTTPConnection::buildRequestHeader(const std::string &path) const
@@ -271,3 +383,172 @@ std::string HTTPConnection::extraRequestHeaders() const
     }
     return ss.str();
 }
+
+HTTP2Connection::HTTP2Connection(vlc_object_t *stream_, struct vlc_h2_conn *conn_,
+                                 mtime_t connectTime_, Chunk *chunk_) :
+    HTTPConnection(stream_, NULL, chunk_, true)
+{
+    conn = conn_;
+    h2stream = NULL;
+    /* The connection is shared: only its first user pays the connect */
+    connectTime = connectTime_;
+    socketRequests = connectTime_ ? 0 : 1;
+    connects = connectTime_ ? 1 : 0;
+}
+
+HTTP2Connection::~HTTP2Connection()
+{
+    disconnect();
+    vlc_h2_conn_release(conn);
+}
+
+bool HTTP2Connection::connect(const std::string &hostname, int)
+{
+    this->hostname = hostname;
+    return vlc_h2_conn_usable(conn);
+}
+
+bool HTTP2Connection::connected() const
+{
+    return h2stream != NULL || vlc_h2_conn_usable(conn);
+}
+
+void HTTP2Connection::disconnect()
+{
+    queryOk = false;
+    toRead = 0;
+    if(h2stream)
+        vlc_h2_stream_close(h2stream);
+    h2stream = NULL;
+}
+
+int HTTP2Connection::query(const std::string &path)
+{
+    if(!chunk)
+        return VLC_EGENERIC;
+
+    disconnect();
+
+    std::stringstream authority;
+    authority << chunk->getHostname();
+    if(chunk->getPort() != 443)
+        authority << ":" << chunk->getPort();
+    const std::string host = authority.str();
+
+    const char *headers[7][2] = {
+        { ":method", "GET" },
+        { ":scheme", "https" },
+        { ":authority", host.c_str() },
+        { ":path", path.c_str() },
+        { "user-agent", psz_useragent ? psz_useragent : PACKAGE_NAME },
+        { "cache-control", "no-cache" },
+    };
+    unsigned count = 6;
+
+    std::string range;
+    if(chunk->usesByteRange())
+    {
+        std::stringstream ss;
+        ss << "bytes=" << chunk->getStartByte() << "-";
+        if(chunk->getEndByte())
+            ss << chunk->getEndByte();
+        range = ss.str();
+        headers[count][0] = "range";
+        headers[count][1] = range.c_str();
+        count++;
+    }
+
+    const bool b_reused = (socketRequests > 0);
+    mtime_t time = mdate();
+    socketRequests++;
+
+    h2stream = vlc_h2_stream_open(conn, headers, count);
+    if(!h2stream)
+        return VLC_EGENERIC;
+
+    int status = vlc_h2_stream_wait(h2stream);
+    if(status != 200 && status != 206)
+    {
+        disconnect();
+        return (status < 0) ? VLC_EGENERIC : VLC_ENOOBJ;
+    }
+
+    const char *length = vlc_h2_stream_get_header(h2stream, "content-length");
+    if(length)
+    {
+        toRead = strtoull(length, NULL, 10);
+        chunk->setLength(toRead);
+    }
+    else /* the body ends with the stream */
+        chunk->setUnknownLength();
+
+    queryOk = true;
+    requests++;
+    chunk->setRequestStats(b_reused, b_reused ? 0 : connectTime,
+                           mdate() - time);
+    return VLC_SUCCESS;
+}
+
+ssize_t HTTP2Connection::read(void *p_buffer, size_t len)
+{
+    if(!chunk || !h2stream ||
+       (!queryOk && chunk->getBytesRead() == 0) )
+        return VLC_EGENERIC;
+
+    if(len == 0)
+        return VLC_SUCCESS;
+
+    queryOk = false;
+
+    if(chunk->getBytesToRead() == 0)
+        return VLC_SUCCESS;
+
+    if(len > chunk->getBytesToRead())
+        len = chunk->getBytesToRead();
+
+    size_t total = 0;
+    while(total < len)
+    {
+        ssize_t ret = vlc_h2_stream_read(h2stream, (uint8_t *)p_buffer + total,
+                                         len - total);
+        if(ret < 0)
+        {
+            if(total > 0) /* report the error with the next read */
+                break;
+            chunk->setBytesToRead(chunk->getBytesRead());
+            disconnect();
+            return VLC_EGENERIC;
+        }
+        if(ret == 0) /* end of stream */
+        {
+            chunk->setBytesRead(chunk->getBytesRead() + total);
+            if(!chunk->isLengthKnown())
+            {
+                chunk->setLength(chunk->getBytesRead());
+                return total;
+            }
+            chunk->setBytesToRead(chunk->getBytesRead());
+            return total ? (ssize_t)total : VLC_EGENERIC;
+        }
+        total += ret;
+        if(lowLatency)
+            break;
+    }
+
+    chunk->setBytesRead(chunk->getBytesRead() + total);
+    return total;
+}
+
+void HTTP2Connection::releaseChunk()
+{
+    /* Streams are not reusable; an unfinished one is reset, which leaves
+       the shared connection usable */
+    disconnect();
+
+    if(chunk)
+    {
+        chunk->setConnection(NULL);
+        chunk = NULL;
+    }
+    lastUse = mdate();
+}
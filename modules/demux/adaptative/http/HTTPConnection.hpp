@@ -32,6 +32,9 @@
 #include <vlc_common.h>
 #include <string>
 
+struct vlc_h2_conn;
+struct vlc_h2_stream;
+
 namespace adaptative
 {
     namespace http
@@ -58,6 +61,10 @@ namespace adaptative
                 virtual bool    isAvailable () const;
                 virtual void    releaseChunk();
 
+                mtime_t         getIdleTime     () const;
+                unsigned        getRequestCount () const;
+                unsigned        getConnectCount () const;
+
             protected:
 
                 virtual void    onHeader    (const std::string &line,
@@ -66,6 +73,7 @@ namespace adaptative
                 virtual std::string buildRequestHeader(const std::string &path) const;
 
                 int parseReply();
+                ssize_t readChunked(void *p_buffer, size_t len);
                 std::string readLine();
                 std::string hostname;
                 char * psz_useragent;
@@ -73,14 +81,46 @@ namespace adaptative
                 size_t toRead;
                 Chunk *chunk;
 
+                bool                persistent;
                 bool                connectionClose;
                 bool                queryOk;
+                bool                chunkedTransfer;
+                bool                chunkedStarted;
+                size_t              chunkedRemaining; /* in the current chunk */
+                bool                lowLatency; /* return data as it arrives */
                 int                 retries;
                 static const int    retryCount = 5;
 
+                mtime_t             connectTime;
+                mtime_t             lastUse;
+                unsigned            socketRequests; /* since the last connect */
+                unsigned            requests;
+                unsigned            connects;
+
             private:
                 Socket *socket;
        };
+
+        /* Sends each request on its own stream of a shared HTTP/2
+           connection, instead of owning a socket */
+        class HTTP2Connection : public HTTPConnection
+        {
+            public:
+                HTTP2Connection(vlc_object_t *stream, struct vlc_h2_conn *,
+                                mtime_t connectTime, Chunk * = NULL);
+                virtual ~HTTP2Connection();
+
+                virtual bool    connect     (const std::string& hostname, int port = 443);
+                virtual bool    connected   () const;
+                virtual int     query       (const std::string& path);
+                virtual ssize_t read        (void *p_buffer, size_t len);
+                virtual void    disconnect  ();
+                virtual void    releaseChunk();
+
+            private:
+                struct vlc_h2_conn   *conn;
+                struct vlc_h2_stream *h2stream;
+        };
     }
 }
 
@@ -30,12 +30,25 @@
 #include "Chunk.h"
 #include "Sockets.hpp"
 
+#include <vlc_network.h>
+#include <vlc_tls.h>
+#include "../../access/http/h2conn.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
 using namespace adaptative::http;
 
 const uint64_t  HTTPConnectionManager::CHUNKDEFAULTBITRATE    = 1;
+/* Servers usually close kept-alive connections after 5 to 15 seconds */
+const mtime_t   HTTPConnectionManager::IDLETIMEOUT            = CLOCK_FREQ * 5;
 
 HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *stream) :
-                       stream                   (stream)
+                       stream                   (stream),
+                       requests                 (0),
+                       connects                 (0),
+                       creds                    (NULL)
 {
 }
 HTTPConnectionManager::~HTTPConnectionManager   ()
@@ -46,25 +59,165 @@ HTTPConnectionManager::~HTTPConnectionManager   ()
 void HTTPConnectionManager::closeAllConnections      ()
 {
     releaseAllConnections();
-    vlc_delete_all(this->connectionPool);
+
+    ConnectionPool::iterator it;
+    for(it = connectionPool.begin(); it != connectionPool.end(); ++it)
+    {
+        std::list<HTTPConnection *>::iterator it2;
+        for(it2 = (*it).second.begin(); it2 != (*it).second.end(); ++it2)
+            deleteConnection(*it2);
+    }
+    connectionPool.clear();
+
+    /* The connections held their own reference to their HTTP/2 session */
+    std::map<std::string, struct vlc_h2_conn *>::iterator h2;
+    for(h2 = h2Connections.begin(); h2 != h2Connections.end(); ++h2)
+        vlc_h2_conn_release((*h2).second);
+    h2Connections.clear();
+    if(creds)
+        vlc_tls_Delete(creds);
+    creds = NULL;
+
+    if(requests > connects)
+        msg_Dbg(stream, "%u requests over %u connections (%u%% reused)",
+                requests, connects, 100 * (requests - connects) / requests);
 }
 
 void HTTPConnectionManager::releaseAllConnections()
 {
-    std::vector<HTTPConnection *>::iterator it;
+    ConnectionPool::iterator it;
     for(it = connectionPool.begin(); it != connectionPool.end(); ++it)
-        (*it)->releaseChunk();
+    {
+        std::list<HTTPConnection *>::iterator it2;
+        for(it2 = (*it).second.begin(); it2 != (*it).second.end(); ++it2)
+            (*it2)->releaseChunk();
+    }
 }
 
-HTTPConnection * HTTPConnectionManager::getConnectionForHost(const std::string &hostname)
+void HTTPConnectionManager::deleteConnection(HTTPConnection *conn)
 {
-    std::vector<HTTPConnection *>::const_iterator it;
-    for(it = connectionPool.begin(); it != connectionPool.end(); ++it)
+    requests += conn->getRequestCount();
+    connects += conn->getConnectCount();
+    delete conn;
+}
+
+HTTPConnection * HTTPConnectionManager::getConnectionForOrigin(const std::string &origin)
+{
+    ConnectionPool::iterator it = connectionPool.find(origin);
+    if(it == connectionPool.end())
+        return NULL;
+
+    /* Prefer the most recently used connection, the likeliest still open */
+    HTTPConnection *conn = NULL;
+    std::list<HTTPConnection *>::const_iterator it2;
+    for(it2 = (*it).second.begin(); it2 != (*it).second.end(); ++it2)
     {
-        if(!(*it)->getHostname().compare(hostname) && (*it)->isAvailable())
-            return *it;
+        if((*it2)->isAvailable() &&
+           (!conn || (*it2)->getIdleTime() < conn->getIdleTime()))
+            conn = *it2;
     }
-    return NULL;
+    return conn;
+}
+
+void HTTPConnectionManager::evictIdleConnections()
+{
+    ConnectionPool::iterator it = connectionPool.begin();
+    while(it != connectionPool.end())
+    {
+        std::list<HTTPConnection *>::iterator it2 = (*it).second.begin();
+        while(it2 != (*it).second.end())
+        {
+            if((*it2)->isAvailable() && (*it2)->getIdleTime() > IDLETIMEOUT)
+            {
+                deleteConnection(*it2);
+                it2 = (*it).second.erase(it2);
+            }
+            else
+                ++it2;
+        }
+
+        if((*it).second.empty())
+            connectionPool.erase(it++);
+        else
+            ++it;
+    }
+}
+
+/* Opens a stream on the HTTP/2 connection to an HTTPS origin, first
+   connecting if needed. Returns NULL if the server does not speak HTTP/2,
+   so that the caller falls back to HTTP/1.1. */
+HTTPConnection * HTTPConnectionManager::connectHTTP2(Chunk *chunk, const std::string &origin)
+{
+    if(h1Origins.count(origin) || !var_InheritBool(stream, "adaptative-http2"))
+        return NULL;
+
+    mtime_t connectTime = 0;
+    struct vlc_h2_conn *h2 = NULL;
+    std::map<std::string, struct vlc_h2_conn *>::iterator it = h2Connections.find(origin);
+    if(it != h2Connections.end())
+    {
+        if(vlc_h2_conn_usable((*it).second))
+            h2 = (*it).second;
+        else
+        {
+            vlc_h2_conn_release((*it).second);
+            h2Connections.erase(it);
+        }
+    }
+
+    if(!h2)
+    {
+        if(!creds)
+            creds = vlc_tls_ClientCreate(stream);
+        if(!creds)
+            return NULL;
+
+        mtime_t time = mdate();
+        int fd = net_ConnectTCP(stream, chunk->getHostname().c_str(),
+                                chunk->getPort());
+        if(fd == -1)
+            return NULL;
+
+        static const char *const alpn[] = { "h2", NULL };
+        char *alp = NULL;
+        vlc_tls_t *tls = vlc_tls_ClientSessionCreate(creds, fd,
+                                                     chunk->getHostname().c_str(),
+                                                     "https", alpn, &alp);
+        if(!tls)
+        {
+            net_Close(fd);
+            return NULL;
+        }
+
+        const bool b_h2 = (alp != NULL && !strcmp(alp, "h2"));
+        free(alp);
+        if(b_h2)
+            h2 = vlc_h2_conn_create(stream, tls);
+        if(!h2)
+        {
+            vlc_tls_SessionDelete(tls);
+            net_Close(fd);
+            if(!b_h2)
+            {
+                msg_Dbg(stream, "%s does not support HTTP/2", origin.c_str());
+                h1Origins.insert(origin);
+            }
+            return NULL;
+        }
+        connectTime = mdate() - time;
+        h2Connections[origin] = h2;
+    }
+
+    vlc_h2_conn_hold(h2);
+    HTTPConnection *conn = new (std::nothrow) HTTP2Connection(stream, h2, connectTime,
+                                                              chunk);
+    if(!conn)
+    {
+        vlc_h2_conn_release(h2);
+        return NULL;
+    }
+    conn->connect(chunk->getHostname(), chunk->getPort());
+    return conn;
 }
 
 bool HTTPConnectionManager::connectChunk(Chunk *chunk)
@@ -77,23 +230,38 @@ bool HTTPConnectionManager::connectChunk(Chunk *chunk)
     msg_Dbg(stream, "Retrieving %s @%zu", chunk->getUrl().c_str(),
             chunk->getStartByte());
 
-    HTTPConnection *conn = getConnectionForHost(chunk->getHostname());
+    evictIdleConnections();
+
+    std::stringstream origin;
+    origin << chunk->getScheme() << "://" << chunk->getHostname() << ":" << chunk->getPort();
+
+    HTTPConnection *conn = getConnectionForOrigin(origin.str());
+    const bool tls = (chunk->getScheme() == "https");
+    if(!conn && tls)
+    {
+        conn = connectHTTP2(chunk, origin.str());
+        if(conn)
+            connectionPool[origin.str()].push_back(conn);
+    }
     if(!conn)
     {
-        const bool tls = (chunk->getScheme() == "https");
         Socket *socket = tls ? new (std::nothrow) TLSSocket(): new (std::nothrow) Socket();
         if(!socket)
             return false;
-        /* disable pipelined tls until we have ticket/resume session support */
-        conn = new (std::nothrow) HTTPConnection(stream, socket, chunk, !tls);
+        /* keep TLS connections alive too; reconnects resume the session */
+        conn = new (std::nothrow) HTTPConnection(stream, socket, chunk, true);
         if(!conn)
         {
             delete socket;
             return false;
         }
-        connectionPool.push_back(conn);
-        if (!chunk->getConnection()->connect(chunk->getHostname(), chunk->getPort()))
+        if (!conn->connect(chunk->getHostname(), chunk->getPort()))
+        {
+            conn->releaseChunk();
+            deleteConnection(conn);
             return false;
+        }
+        connectionPool[origin.str()].push_back(conn);
     }
 
     conn->bindChunk(chunk);
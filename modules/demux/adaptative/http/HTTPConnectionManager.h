@@ -30,9 +30,14 @@
 #endif
 
 #include <vlc_common.h>
-#include <vector>
+#include <list>
+#include <map>
+#include <set>
 #include <string>
 
+typedef struct vlc_tls_creds vlc_tls_creds_t;
+struct vlc_h2_conn;
+
 namespace adaptative
 {
     namespace http
@@ -51,12 +56,25 @@ namespace adaptative
                 bool    connectChunk        (Chunk *chunk);
 
             private:
-                std::vector<HTTPConnection *>                       connectionPool;
+                /* Connections by origin (scheme://host:port) */
+                typedef std::map<std::string, std::list<HTTPConnection *> > ConnectionPool;
+                ConnectionPool                                      connectionPool;
                 vlc_object_t                                       *stream;
+                unsigned                                            requests;
+                unsigned                                            connects;
+                /* Shared HTTP/2 connections by origin, and origins that
+                   did not negotiate HTTP/2 */
+                std::map<std::string, struct vlc_h2_conn *>         h2Connections;
+                std::set<std::string>                               h1Origins;
+                vlc_tls_creds_t                                    *creds;
 
                 static const uint64_t   CHUNKDEFAULTBITRATE;
+                static const mtime_t    IDLETIMEOUT;
 
-                HTTPConnection * getConnectionForHost    (const std::string &hostname);
+                HTTPConnection * getConnectionForOrigin  (const std::string &origin);
+                void             evictIdleConnections    ();
+                void             deleteConnection        (HTTPConnection *);
+                HTTPConnection * connectHTTP2            (Chunk *, const std::string &origin);
         };
     }
 }
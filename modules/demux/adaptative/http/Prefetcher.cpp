@@ -0,0 +1,383 @@
+/*
+ * Prefetcher.cpp
+ *****************************************************************************
+ * Copyright (C) 2015 - VideoLAN and VLC authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "Prefetcher.hpp"
+#include "HTTPConnection.hpp"
+#include "HTTPConnectionManager.h"
+#include "Chunk.h"
+
+#include <vlc_block.h>
+
+using namespace adaptative::http;
+
+class Prefetcher::Download
+{
+    public:
+        Download(Chunk *chunk_) : target(chunk_), chunk(*chunk_)
+        {
+            chunk.setConnection(NULL);
+            length = 0;
+            started = false;
+            done = false;
+            cancelled = false;
+        }
+
+        ~Download()
+        {
+            std::list<Piece>::iterator it;
+            for(it = pieces.begin(); it != pieces.end(); ++it)
+                block_Release((*it).block);
+        }
+
+        class Piece
+        {
+            public:
+                Piece(block_t *b, mtime_t t, bool l) : block(b), time(t), last(l) {}
+                block_t *block;
+                mtime_t  time;
+                bool     last;
+        };
+
+        Chunk              *target;  /* consumer side chunk */
+        Chunk               chunk;   /* private copy used by the worker */
+        uint64_t            length;
+        std::list<Piece>    pieces;
+        bool                started;
+        bool                done;
+        bool                cancelled; /* dropped while being downloaded */
+};
+
+class Prefetcher::Worker
+{
+    public:
+        Prefetcher             *owner;
+        vlc_thread_t            thread;
+        vlc_interrupt_t        *interrupt;
+        HTTPConnectionManager  *connManager;
+};
+
+Prefetcher::Prefetcher(vlc_object_t *obj_, unsigned depth_, size_t budget_)
+{
+    obj = obj_;
+    depth = depth_;
+    budget = budget_;
+    buffered = 0;
+    b_exit = false;
+    vlc_mutex_init(&lock);
+    vlc_cond_init(&work_cond);
+    vlc_cond_init(&data_cond);
+    vlc_cond_init(&space_cond);
+
+    /* One connection per chunk in flight */
+    for(unsigned i = 0; i < depth; i++)
+    {
+        Worker *worker = new (std::nothrow) Worker;
+        if(!worker)
+            break;
+        worker->owner = this;
+        worker->interrupt = vlc_interrupt_create();
+        worker->connManager = new (std::nothrow) HTTPConnectionManager(obj);
+        if(!worker->interrupt || !worker->connManager ||
+           vlc_clone(&worker->thread, workerThread, worker, VLC_THREAD_PRIORITY_INPUT))
+        {
+            if(worker->interrupt)
+                vlc_interrupt_destroy(worker->interrupt);
+            delete worker->connManager;
+            delete worker;
+            break;
+        }
+        workers.push_back(worker);
+    }
+}
+
+Prefetcher * Prefetcher::create(vlc_object_t *obj, unsigned depth, size_t budget)
+{
+    Prefetcher *prefetcher = new (std::nothrow) Prefetcher(obj, depth, budget);
+    if(prefetcher && prefetcher->workers.empty())
+    {
+        delete prefetcher;
+        prefetcher = NULL;
+    }
+    return prefetcher;
+}
+
+Prefetcher::~Prefetcher()
+{
+    vlc_mutex_lock(&lock);
+    b_exit = true;
+    while(!queue.empty())
+    {
+        drop(queue.front());
+        queue.pop_front();
+    }
+    vlc_cond_broadcast(&work_cond);
+    vlc_cond_broadcast(&space_cond);
+    vlc_mutex_unlock(&lock);
+
+    std::vector<Worker *>::iterator it;
+    for(it = workers.begin(); it != workers.end(); ++it)
+    {
+        Worker *worker = *it;
+        vlc_interrupt_kill(worker->interrupt);
+        vlc_join(worker->thread, NULL);
+        vlc_interrupt_destroy(worker->interrupt);
+        delete worker->connManager;
+        delete worker;
+    }
+
+    vlc_cond_destroy(&space_cond);
+    vlc_cond_destroy(&data_cond);
+    vlc_cond_destroy(&work_cond);
+    vlc_mutex_destroy(&lock);
+}
+
+bool Prefetcher::isFull() const
+{
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+    bool b_full = queue.size() >= depth || buffered >= budget;
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+    return b_full;
+}
+
+bool Prefetcher::isEmpty() const
+{
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+    bool b_empty = queue.empty();
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+    return b_empty;
+}
+
+unsigned Prefetcher::getDepth() const
+{
+    return depth;
+}
+
+bool Prefetcher::enqueue(Chunk *chunk)
+{
+    Download *dl = new (std::nothrow) Download(chunk);
+    if(!dl)
+        return false;
+    vlc_mutex_lock(&lock);
+    queue.push_back(dl);
+    vlc_cond_signal(&work_cond);
+    vlc_mutex_unlock(&lock);
+    return true;
+}
+
+block_t * Prefetcher::read(mtime_t *time, bool *last)
+{
+    block_t *block = NULL;
+
+    *last = true;
+    vlc_mutex_lock(&lock);
+    if(queue.empty())
+    {
+        vlc_mutex_unlock(&lock);
+        return NULL;
+    }
+
+    Download *dl = queue.front();
+    /* Wake up regularly, as the demux thread can be interrupted */
+    while(dl->pieces.empty() && !dl->done && !vlc_killed())
+        vlc_cond_timedwait(&data_cond, &lock, mdate() + CLOCK_FREQ / 10);
+
+    if(!dl->pieces.empty())
+    {
+        Download::Piece &piece = dl->pieces.front();
+        block = piece.block;
+        *time = piece.time;
+        *last = piece.last;
+        dl->pieces.pop_front();
+        buffered -= block->i_buffer;
+
+        if(dl->target->getBytesRead() == 0)
+            dl->target->setRequestStats(dl->chunk.isConnectionReused(),
+                                        dl->chunk.getConnectTime(),
+                                        dl->chunk.getResponseTime());
+        dl->target->setLength(dl->length);
+        dl->target->setBytesRead(dl->target->getBytesRead() + block->i_buffer);
+    }
+
+    if(*last)
+    {
+        queue.pop_front();
+        drop(dl);
+    }
+    vlc_cond_broadcast(&space_cond);
+    vlc_mutex_unlock(&lock);
+
+    return block;
+}
+
+void Prefetcher::flush()
+{
+    vlc_mutex_lock(&lock);
+    while(!queue.empty())
+    {
+        drop(queue.front());
+        queue.pop_front();
+    }
+    vlc_cond_broadcast(&space_cond);
+    vlc_mutex_unlock(&lock);
+}
+
+/* Must be called with the lock held, once dequeued */
+void Prefetcher::drop(Download *dl)
+{
+    std::list<Download::Piece>::iterator it;
+    for(it = dl->pieces.begin(); it != dl->pieces.end(); ++it)
+    {
+        buffered -= (*it).block->i_buffer;
+        block_Release((*it).block);
+    }
+    dl->pieces.clear();
+
+    if(dl->started && !dl->done)
+        dl->cancelled = true; /* the worker will delete it */
+    else
+        delete dl;
+}
+
+void * Prefetcher::workerThread(void *data)
+{
+    Worker *worker = static_cast<Worker *>(data);
+    vlc_interrupt_set(worker->interrupt);
+    worker->owner->work(worker);
+    return NULL;
+}
+
+void Prefetcher::work(Worker *worker)
+{
+    vlc_mutex_lock(&lock);
+    for(;;)
+    {
+        Download *dl = NULL;
+        while(!b_exit)
+        {
+            std::list<Download *>::const_iterator it;
+            for(it = queue.begin(); it != queue.end(); ++it)
+            {
+                if(!(*it)->started)
+                {
+                    dl = *it;
+                    break;
+                }
+            }
+            if(dl)
+                break;
+            vlc_cond_wait(&work_cond, &lock);
+        }
+
+        if(b_exit)
+            break;
+
+        dl->started = true;
+        vlc_mutex_unlock(&lock);
+
+        download(worker, dl);
+
+        vlc_mutex_lock(&lock);
+        if(dl->cancelled)
+        {
+            delete dl;
+        }
+        else
+        {
+            dl->done = true;
+            vlc_cond_broadcast(&data_cond);
+        }
+    }
+    vlc_mutex_unlock(&lock);
+}
+
+void Prefetcher::download(Worker *worker, Download *dl)
+{
+    Chunk *chunk = &dl->chunk;
+
+    if(!worker->connManager->connectChunk(chunk))
+        return;
+
+    HTTPConnection *conn = chunk->getConnection();
+    if(conn->query(chunk->getPath()) != VLC_SUCCESS)
+    {
+        conn->releaseChunk();
+        return;
+    }
+
+    vlc_mutex_lock(&lock);
+    dl->length = chunk->getLength();
+    vlc_mutex_unlock(&lock);
+
+    for(;;)
+    {
+        /* Only the front chunk may exceed the memory budget */
+        vlc_mutex_lock(&lock);
+        while(!dl->cancelled && !b_exit &&
+              buffered >= budget && queue.front() != dl)
+            vlc_cond_wait(&space_cond, &lock);
+        bool b_stop = dl->cancelled || b_exit;
+        vlc_mutex_unlock(&lock);
+        if(b_stop)
+            break;
+
+        size_t readsize = chunk->getBytesToRead();
+        if (readsize > 32768)
+            readsize = 32768;
+
+        block_t *block = block_Alloc(readsize);
+        if(!block)
+            break;
+
+        mtime_t time = mdate();
+        ssize_t ret = conn->read(block->p_buffer, readsize);
+        time = mdate() - time;
+
+        const bool b_last = (chunk->getBytesToRead() == 0);
+        if(ret < 0 || (ret == 0 && !b_last))
+        {
+            /* The download ends without its last piece, which the
+               consumer reports as an error */
+            block_Release(block);
+            break;
+        }
+
+        block->i_buffer = (size_t)ret;
+
+        vlc_mutex_lock(&lock);
+        if(!dl->cancelled)
+        {
+            dl->length = chunk->getLength(); /* final once the transfer ended */
+            dl->pieces.push_back(Download::Piece(block, time, b_last));
+            buffered += block->i_buffer;
+            vlc_cond_broadcast(&data_cond);
+        }
+        else
+            block_Release(block);
+        vlc_mutex_unlock(&lock);
+
+        if(b_last)
+            break;
+    }
+
+    conn->releaseChunk();
+}
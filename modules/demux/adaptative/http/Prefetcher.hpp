@@ -0,0 +1,87 @@
+/*
+ * Prefetcher.hpp
+ *****************************************************************************
+ * Copyright (C) 2015 - VideoLAN and VLC authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef PREFETCHER_HPP
+#define PREFETCHER_HPP
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_interrupt.h>
+#include <list>
+#include <vector>
+
+namespace adaptative
+{
+    namespace http
+    {
+        class Chunk;
+        class HTTPConnectionManager;
+
+        /* Downloads the next chunks of a stream ahead of time, each one on
+         * its own connection, and hands their data back in queue order.
+         * All methods must be called from the same (demux) thread. */
+        class Prefetcher
+        {
+            public:
+                /* Returns NULL if no download thread could be started */
+                static Prefetcher * create(vlc_object_t *, unsigned depth, size_t budget);
+                ~Prefetcher();
+
+                bool        isFull   () const;
+                bool        isEmpty  () const;
+                unsigned    getDepth () const;
+                /* The chunk is not owned, and must remain valid until it
+                   has been entirely read or the queue has been flushed */
+                bool        enqueue  (Chunk *);
+                /* Returns the next block of the front chunk with its download
+                   time, or NULL on error. The front chunk is dequeued after
+                   its last block (*last) or on error. */
+                block_t *   read     (mtime_t *, bool *last);
+                void        flush    ();
+
+            private:
+                Prefetcher(vlc_object_t *, unsigned depth, size_t budget);
+
+                class Download;
+                class Worker;
+
+                static void * workerThread(void *);
+                void        work     (Worker *);
+                void        download (Worker *, Download *);
+                void        drop     (Download *);
+
+                vlc_object_t           *obj;
+                unsigned                depth;
+                size_t                  budget;
+                size_t                  buffered;
+                bool                    b_exit;
+                vlc_mutex_t             lock;
+                vlc_cond_t              work_cond;  /* download queued */
+                vlc_cond_t              data_cond;  /* data or end of a download */
+                vlc_cond_t              space_cond; /* buffered data consumed */
+                std::list<Download *>   queue;
+                std::vector<Worker *>   workers;
+        };
+    }
+}
+
+#endif // PREFETCHER_HPP
@@ -0,0 +1,309 @@
+/*
+ * SegmentCache.cpp
+ *****************************************************************************
+ * Copyright (C) 2015 - VideoLAN and VLC authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "SegmentCache.hpp"
+#include "Chunk.h"
+
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+#include <sys/stat.h>
+
+using namespace adaptative::http;
+
+#define CACHE_SUFFIX ".seg"
+
+SegmentCache::SegmentCache(vlc_object_t *obj_, size_t memsize_,
+                           const std::string &dir_, uint64_t disksize_)
+{
+    obj = obj_;
+    memsize = memsize_;
+    memused = 0;
+    dir = dir_;
+    disksize = disksize_;
+    diskused = 0;
+    hits = misses = 0;
+
+    if(!dir.empty())
+    {
+        vlc_mkdir(dir.c_str(), 0700);
+        loadDisk();
+    }
+}
+
+SegmentCache::~SegmentCache()
+{
+    if(hits + misses)
+        msg_Dbg(obj, "segment cache: %u hits, %u misses", hits, misses);
+
+    std::list<Entry>::iterator it;
+    for(it = entries.begin(); it != entries.end(); ++it)
+        block_Release((*it).block);
+}
+
+std::string SegmentCache::getKey(const Chunk *chunk)
+{
+    std::stringstream ss;
+    ss << chunk->getUrl();
+    if(chunk->usesByteRange())
+        ss << "@" << chunk->getStartByte() << "-" << chunk->getEndByte();
+    return ss.str();
+}
+
+bool SegmentCache::contains(const std::string &key)
+{
+    return index.find(key) != index.end() ||
+           diskindex.find(getName(key)) != diskindex.end();
+}
+
+block_t * SegmentCache::get(const std::string &key)
+{
+    std::map<std::string, EntryIterator>::iterator it = index.find(key);
+    if(it != index.end())
+    {
+        /* move to front */
+        entries.splice(entries.begin(), entries, (*it).second);
+        hits++;
+        return block_Duplicate((*(*it).second).block);
+    }
+
+    block_t *block = readDisk(key);
+    if(!block)
+    {
+        misses++;
+        return NULL;
+    }
+    hits++;
+
+    /* promote to the memory tier */
+    block_t *copy = block_Duplicate(block);
+    if(copy)
+    {
+        Entry entry;
+        entry.key = key;
+        entry.block = copy;
+        entries.push_front(entry);
+        index[key] = entries.begin();
+        memused += copy->i_buffer;
+        evict();
+    }
+    return block;
+}
+
+void SegmentCache::put(const std::string &key, block_t *block)
+{
+    if(contains(key) || block->i_buffer > memsize)
+    {
+        if(!dir.empty() && diskindex.find(getName(key)) == diskindex.end())
+            writeDisk(key, block);
+        block_Release(block);
+        return;
+    }
+
+    if(!dir.empty())
+        writeDisk(key, block);
+
+    Entry entry;
+    entry.key = key;
+    entry.block = block;
+    entries.push_front(entry);
+    index[key] = entries.begin();
+    memused += block->i_buffer;
+    evict();
+}
+
+void SegmentCache::evict()
+{
+    while(memused > memsize && !entries.empty())
+    {
+        Entry &entry = entries.back();
+        memused -= entry.block->i_buffer;
+        block_Release(entry.block);
+        index.erase(entry.key);
+        entries.pop_back();
+    }
+
+    while(diskused > disksize && !diskentries.empty())
+    {
+        DiskEntry &entry = diskentries.back();
+        vlc_unlink(getPath(entry.name).c_str());
+        diskused -= entry.size;
+        diskindex.erase(entry.name);
+        diskentries.pop_back();
+    }
+}
+
+std::string SegmentCache::getName(const std::string &key)
+{
+    struct md5_s md5;
+    InitMD5(&md5);
+    AddMD5(&md5, key.c_str(), key.length());
+    EndMD5(&md5);
+    char *psz_hash = psz_md5_hash(&md5);
+    if(!psz_hash)
+        return std::string();
+    std::string name(psz_hash);
+    free(psz_hash);
+    return name;
+}
+
+std::string SegmentCache::getPath(const std::string &name) const
+{
+    return dir + DIR_SEP + name + CACHE_SUFFIX;
+}
+
+static bool compareMTime(const std::pair<time_t, std::string> &a,
+                         const std::pair<time_t, std::string> &b)
+{
+    return a.first > b.first;
+}
+
+/* Rebuilds the disk tier from a previous session, most recently
+   written files first */
+void SegmentCache::loadDisk()
+{
+    DIR *p_dir = vlc_opendir(dir.c_str());
+    if(!p_dir)
+    {
+        msg_Warn(obj, "cannot open segment cache directory %s", dir.c_str());
+        dir.clear();
+        return;
+    }
+
+    std::vector<std::pair<time_t, std::string> > files;
+    std::map<std::string, uint64_t> sizes;
+    const char *psz_file;
+    while((psz_file = vlc_readdir(p_dir)))
+    {
+        std::string file(psz_file);
+        const size_t suffixlen = sizeof(CACHE_SUFFIX) - 1;
+        if(file.length() <= suffixlen ||
+           file.compare(file.length() - suffixlen, suffixlen, CACHE_SUFFIX))
+            continue;
+
+        struct stat st;
+        std::string name = file.substr(0, file.length() - suffixlen);
+        if(vlc_stat(getPath(name).c_str(), &st) || !S_ISREG(st.st_mode))
+            continue;
+        files.push_back(std::pair<time_t, std::string>(st.st_mtime, name));
+        sizes[name] = st.st_size;
+    }
+    closedir(p_dir);
+
+    std::sort(files.begin(), files.end(), compareMTime);
+    std::vector<std::pair<time_t, std::string> >::const_iterator it;
+    for(it = files.begin(); it != files.end(); ++it)
+    {
+        DiskEntry entry;
+        entry.name = (*it).second;
+        entry.size = sizes[entry.name];
+        diskentries.push_back(entry);
+        diskindex[entry.name] = --diskentries.end();
+        diskused += entry.size;
+    }
+    evict();
+}
+
+/* Files hold the key on the first line, followed by the data */
+block_t * SegmentCache::readDisk(const std::string &key)
+{
+    if(dir.empty())
+        return NULL;
+
+    const std::string name = getName(key);
+    std::map<std::string, DiskEntryIterator>::iterator it = diskindex.find(name);
+    if(it == diskindex.end())
+        return NULL;
+
+    DiskEntryIterator entry = (*it).second;
+    block_t *block = NULL;
+    FILE *file = vlc_fopen(getPath(name).c_str(), "rb");
+    if(file)
+    {
+        const size_t header = key.length() + 1;
+        std::vector<char> filekey(header);
+        if((*entry).size > header &&
+           fread(&filekey[0], 1, header, file) == header &&
+           !memcmp(&filekey[0], key.c_str(), header - 1) &&
+           filekey[header - 1] == '\n')
+        {
+            block = block_Alloc((*entry).size - header);
+            if(block && fread(block->p_buffer, 1, block->i_buffer, file) != block->i_buffer)
+            {
+                block_Release(block);
+                block = NULL;
+            }
+        }
+        fclose(file);
+    }
+
+    if(block)
+    {
+        diskentries.splice(diskentries.begin(), diskentries, entry);
+    }
+    else
+    {
+        /* stale or colliding entry */
+        vlc_unlink(getPath(name).c_str());
+        diskused -= (*entry).size;
+        diskentries.erase(entry);
+        diskindex.erase(it);
+    }
+
+    return block;
+}
+
+void SegmentCache::writeDisk(const std::string &key, const block_t *block)
+{
+    const std::string name = getName(key);
+    if(name.empty())
+        return;
+
+    const std::string path = getPath(name);
+    const std::string tmppath = path + ".part";
+    FILE *file = vlc_fopen(tmppath.c_str(), "wb");
+    if(!file)
+        return;
+
+    bool b_ok = fwrite(key.c_str(), 1, key.length(), file) == key.length() &&
+                fputc('\n', file) != EOF &&
+                fwrite(block->p_buffer, 1, block->i_buffer, file) == block->i_buffer;
+    b_ok = (fclose(file) == 0) && b_ok;
+    if(!b_ok || vlc_rename(tmppath.c_str(), path.c_str()))
+    {
+        vlc_unlink(tmppath.c_str());
+        return;
+    }
+
+    DiskEntry entry;
+    entry.name = name;
+    entry.size = key.length() + 1 + block->i_buffer;
+    diskentries.push_front(entry);
+    diskindex[name] = diskentries.begin();
+    diskused += entry.size;
+    evict();
+}
@@ -0,0 +1,96 @@
+/*
+ * SegmentCache.hpp
+ *****************************************************************************
+ * Copyright (C) 2015 - VideoLAN and VLC authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef SEGMENTCACHE_HPP
+#define SEGMENTCACHE_HPP
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <list>
+#include <map>
+#include <string>
+
+namespace adaptative
+{
+    namespace http
+    {
+        class Chunk;
+
+        /* Least recently used cache of downloaded chunks, keyed by URL and
+         * byte range. Chunks are kept in memory, and optionally written to
+         * a directory which outlives the session. Not thread safe. */
+        class SegmentCache
+        {
+            public:
+                SegmentCache(vlc_object_t *, size_t memsize,
+                             const std::string &dir, uint64_t disksize);
+                ~SegmentCache();
+
+                static std::string getKey(const Chunk *);
+                bool        contains (const std::string &);
+                /* Returns a copy of the cached data, or NULL */
+                block_t *   get      (const std::string &);
+                /* Takes ownership of the block holding the whole chunk */
+                void        put      (const std::string &, block_t *);
+
+            private:
+                class Entry
+                {
+                    public:
+                        std::string key;
+                        block_t    *block;
+                };
+
+                class DiskEntry
+                {
+                    public:
+                        std::string name;
+                        uint64_t    size;
+                };
+
+                typedef std::list<Entry>::iterator EntryIterator;
+                typedef std::list<DiskEntry>::iterator DiskEntryIterator;
+
+                void        evict    ();
+                std::string getPath  (const std::string &) const;
+                static std::string getName(const std::string &);
+                void        loadDisk ();
+                block_t *   readDisk (const std::string &);
+                void        writeDisk(const std::string &, const block_t *);
+
+                vlc_object_t                           *obj;
+                size_t                                  memsize;
+                size_t                                  memused;
+                std::list<Entry>                        entries; /* most recent first */
+                std::map<std::string, EntryIterator>    index;
+                std::string                             dir;
+                uint64_t                                disksize;
+                uint64_t                                diskused;
+                std::list<DiskEntry>                    diskentries;
+                std::map<std::string, DiskEntryIterator> diskindex;
+                unsigned                                hits;
+                unsigned                                misses;
+        };
+    }
+}
+
+#endif // SEGMENTCACHE_HPP
@@ -20,6 +20,7 @@
 #include "Sockets.hpp"
 
 #include <vlc_network.h>
+#include <vlc_interrupt.h>
 #include <cerrno>
 
 using namespace adaptative::http;
@@ -58,13 +59,16 @@ void Socket::disconnect()
     }
 }
 
-ssize_t Socket::read(vlc_object_t *stream, void *p_buffer, size_t len)
+ssize_t Socket::read(vlc_object_t *stream, void *p_buffer, size_t len, bool waitall)
 {
     ssize_t size;
     do
     {
-        size = net_Read(stream, netfd, p_buffer, len);
-    } while (size < 0 && (errno == EINTR || errno==EAGAIN) );
+        if(waitall)
+            size = net_Read(stream, netfd, p_buffer, len);
+        else /* return whatever has already arrived */
+            size = vlc_recv_i11e(netfd, p_buffer, len, 0);
+    } while (size < 0 && (errno == EINTR || errno==EAGAIN) && !vlc_killed());
     return size;
 }
 
@@ -128,9 +132,9 @@ bool TLSSocket::connected() const
     return Socket::connected() && tls;
 }
 
-ssize_t TLSSocket::read(vlc_object_t *, void *p_buffer, size_t len)
+ssize_t TLSSocket::read(vlc_object_t *, void *p_buffer, size_t len, bool waitall)
 {
-    return vlc_tls_Read(tls, p_buffer, len, true);
+    return vlc_tls_Read(tls, p_buffer, len, waitall);
 }
 
 std::string TLSSocket::readline(vlc_object_t *)
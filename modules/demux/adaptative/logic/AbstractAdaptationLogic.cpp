@@ -40,3 +40,11 @@ AbstractAdaptationLogic::~AbstractAdaptationLogic   ()
 void AbstractAdaptationLogic::updateDownloadRate    (size_t, mtime_t)
 {
 }
+
+void AbstractAdaptationLogic::updateRequestStats    (bool, mtime_t, mtime_t)
+{
+}
+
+void AbstractAdaptationLogic::updateBufferLevel     (mtime_t, mtime_t, mtime_t)
+{
+}
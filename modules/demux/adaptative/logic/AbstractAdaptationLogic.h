@@ -47,6 +47,10 @@ namespace adaptative
 
                 virtual BaseRepresentation* getCurrentRepresentation(BaseAdaptationSet *) const = 0;
                 virtual void                updateDownloadRate     (size_t, mtime_t);
+                virtual void                updateRequestStats     (bool, mtime_t, mtime_t);
+                /* Media time queued ahead of the demuxer, the most it can
+                   hold, and the segments duration */
+                virtual void                updateBufferLevel      (mtime_t, mtime_t, mtime_t);
 
                 enum LogicType
                 {
@@ -54,7 +58,8 @@ namespace adaptative
                     AlwaysBest,
                     AlwaysLowest,
                     RateBased,
-                    FixedRate
+                    FixedRate,
+                    Hybrid
                 };
         };
     }
@@ -0,0 +1,165 @@
+/*
+ * HybridAdaptationLogic.cpp
+ *****************************************************************************
+ * Copyright (C) 2015 - VideoLAN and VLC authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "HybridAdaptationLogic.hpp"
+#include "Representationselectors.hpp"
+
+#include "../playlist/BaseRepresentation.h"
+#include "../playlist/BaseAdaptationSet.h"
+
+#include <cmath>
+
+using namespace adaptative::logic;
+
+#define FAST_HALFLIFE 3.0 /* seconds */
+#define SLOW_HALFLIFE 8.0
+#define SAFETY_FACTOR 0.9 /* of the estimate, for the throughput rule */
+
+MovingAverage::MovingAverage(double halflife_)
+{
+    halflife = halflife_;
+    average = 0.0;
+    totalweight = 0.0;
+}
+
+void MovingAverage::push(double value, double weight)
+{
+    const double alpha = pow(0.5, weight / halflife);
+    average = alpha * average + (1.0 - alpha) * value;
+    totalweight += weight;
+}
+
+double MovingAverage::get() const
+{
+    /* Zero initial value bias correction */
+    const double zerofactor = 1.0 - pow(0.5, totalweight / halflife);
+    if(zerofactor <= 0.0)
+        return 0.0;
+    return average / zerofactor;
+}
+
+HybridAdaptationLogic::HybridAdaptationLogic() :
+                       AbstractAdaptationLogic(),
+                       fastAverage(FAST_HALFLIFE),
+                       slowAverage(SLOW_HALFLIFE)
+{
+    currentBps = 0;
+    bufferLevel = 0;
+    bufferTarget = 0;
+    segmentDuration = 0;
+}
+
+BaseRepresentation *HybridAdaptationLogic::getCurrentRepresentation(BaseAdaptationSet *adaptSet) const
+{
+    if(adaptSet == NULL)
+        return NULL;
+
+    RepresentationSelector selector;
+    BaseRepresentation *rep = NULL;
+
+    /* Buffer based decisions need a minimum of 2 segments of look-ahead,
+       and switch in from half of it */
+    if(segmentDuration > 0 && bufferTarget >= 2 * segmentDuration &&
+       bufferLevel >= bufferTarget / 2)
+    {
+        rep = getBufferBasedRepresentation(adaptSet, currentBps);
+    }
+
+    if(rep == NULL)
+        rep = selector.select(adaptSet, (uint64_t)(currentBps * SAFETY_FACTOR));
+    if(rep == NULL)
+        rep = selector.select(adaptSet);
+    return rep;
+}
+
+BaseRepresentation *HybridAdaptationLogic::getBufferBasedRepresentation(BaseAdaptationSet *adaptSet,
+                                                                        uint64_t maxbitrate) const
+{
+    std::vector<BaseRepresentation *> reps = adaptSet->getRepresentations();
+    std::vector<BaseRepresentation *>::const_iterator it;
+
+    BaseRepresentation *lowest = NULL, *highest = NULL;
+    for(it = reps.begin(); it != reps.end(); ++it)
+    {
+        if(!lowest || (*it)->getBandwidth() < lowest->getBandwidth())
+            lowest = *it;
+        if(!highest || (*it)->getBandwidth() > highest->getBandwidth())
+            highest = *it;
+    }
+    if(!lowest || lowest->getBandwidth() == 0)
+        return NULL;
+
+    /* BOLA: with utilities v = ln(S/Smin) + 1, pick the representation
+       maximizing (V * (v + gp) - Q) / S, where V and gp are set so that
+       the lowest one is chosen at one segment of buffer and the highest
+       one at the buffer target. Q, V and gp are in segments. */
+    const double lowbw = lowest->getBandwidth();
+    const double maxutility = log(highest->getBandwidth() / lowbw) + 1.0;
+    const double minbuffer = 1.0;
+    const double target = (double) bufferTarget / segmentDuration;
+    const double level = (double) bufferLevel / segmentDuration;
+    if(maxutility <= 1.0 || target <= minbuffer)
+        return lowest;
+    const double gp = (maxutility - 1.0) / (target / minbuffer - 1.0);
+    const double V = minbuffer / gp;
+
+    BaseRepresentation *best = NULL;
+    double bestscore = 0.0;
+    for(it = reps.begin(); it != reps.end(); ++it)
+    {
+        const double bw = (*it)->getBandwidth();
+        /* Do not go past what the link sustains */
+        if(*it != lowest && (maxbitrate == 0 || bw > maxbitrate))
+            continue;
+        const double score = (V * (log(bw / lowbw) + 1.0 + gp) - level) / bw;
+        if(!best || score > bestscore)
+        {
+            best = *it;
+            bestscore = score;
+        }
+    }
+
+    return best;
+}
+
+void HybridAdaptationLogic::updateDownloadRate(size_t size, mtime_t time)
+{
+    if(unlikely(time <= 0))
+        return;
+
+    const double bps = (double) size * 8 * CLOCK_FREQ / time;
+    const double seconds = (double) time / CLOCK_FREQ;
+    fastAverage.push(bps, seconds);
+    slowAverage.push(bps, seconds);
+
+    /* React quickly to drops, slowly to increases */
+    currentBps = (uint64_t) __MIN(fastAverage.get(), slowAverage.get());
+}
+
+void HybridAdaptationLogic::updateBufferLevel(mtime_t level, mtime_t target,
+                                              mtime_t duration)
+{
+    bufferLevel = level;
+    bufferTarget = target;
+    segmentDuration = duration;
+}
@@ -0,0 +1,69 @@
+/*
+ * HybridAdaptationLogic.hpp
+ *****************************************************************************
+ * Copyright (C) 2015 - VideoLAN and VLC authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef HYBRIDADAPTATIONLOGIC_HPP
+#define HYBRIDADAPTATIONLOGIC_HPP
+
+#include "AbstractAdaptationLogic.h"
+
+namespace adaptative
+{
+    namespace logic
+    {
+        /* Exponentially weighted moving average, where each sample
+           weights by its duration (half life in seconds) */
+        class MovingAverage
+        {
+            public:
+                MovingAverage(double halflife);
+                void    push    (double value, double weight);
+                double  get     () const;
+
+            private:
+                double  halflife;
+                double  average;
+                double  totalweight;
+        };
+
+        /* Picks the representation from the throughput estimate while the
+           buffer is low, then from the buffer level (BOLA) once enough
+           segments are queued ahead, capped by the sustainable rate */
+        class HybridAdaptationLogic : public AbstractAdaptationLogic
+        {
+            public:
+                HybridAdaptationLogic();
+
+                virtual BaseRepresentation* getCurrentRepresentation(BaseAdaptationSet *) const;
+                virtual void                updateDownloadRate     (size_t, mtime_t);
+                virtual void                updateBufferLevel      (mtime_t, mtime_t, mtime_t);
+
+            private:
+                BaseRepresentation *       getBufferBasedRepresentation(BaseAdaptationSet *,
+                                                                         uint64_t) const;
+                MovingAverage   fastAverage;
+                MovingAverage   slowAverage;
+                uint64_t        currentBps;
+                mtime_t         bufferLevel;
+                mtime_t         bufferTarget;
+                mtime_t         segmentDuration;
+        };
+    }
+}
+
+#endif // HYBRIDADAPTATIONLOGIC_HPP
@@ -39,6 +39,8 @@ namespace adaptative
         {
             public:
                 virtual void updateDownloadRate(size_t, mtime_t) = 0;
+                /* reused connection, connection setup and response delays */
+                virtual void updateRequestStats(bool, mtime_t, mtime_t) = 0;
                 virtual ~IDownloadRateObserver(){}
         };
     }
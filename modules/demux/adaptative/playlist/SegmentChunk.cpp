@@ -31,6 +31,7 @@ SegmentChunk::SegmentChunk(ISegment *segment_, const std::string &url) :
     segment = segment_;
     segment->chunksuse.Set(segment->chunksuse.Get() + 1);
     rep = NULL;
+    duration = 0;
 }
 
 SegmentChunk::~SegmentChunk()
@@ -49,6 +50,16 @@ void SegmentChunk::onDownload(block_t **pp_block)
     segment->onChunkDownload(pp_block, this, rep);
 }
 
+void SegmentChunk::setDuration(mtime_t duration_)
+{
+    duration = duration_;
+}
+
+mtime_t SegmentChunk::getDuration() const
+{
+    return duration;
+}
+
 StreamFormat SegmentChunk::getStreamFormat() const
 {
     if(rep)
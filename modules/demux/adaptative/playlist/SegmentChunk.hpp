@@ -42,10 +42,13 @@ namespace adaptative
             void setRepresentation(BaseRepresentation *);
             virtual void onDownload(block_t **); // reimpl
             StreamFormat getStreamFormat() const;
+            void setDuration(mtime_t);
+            mtime_t getDuration() const; /* media time, 0 if unknown */
 
         protected:
             ISegment *segment;
             BaseRepresentation *rep;
+            mtime_t duration;
         };
 
     }
@@ -246,6 +246,31 @@ mtime_t SegmentInformation::getPlaybackTimeBySegmentNumber(uint64_t number) cons
 
 
 
+/* Returns the first segment of the listed ones starting at least delay
+   before their end, which is the live edge on live playlists */
+bool SegmentInformation::getLiveStartSegmentNumber(mtime_t delay, uint64_t *ret) const
+{
+    std::vector<ISegment *> seglist;
+    std::size_t offset = 0;
+    const std::size_t size = getSegments(INFOTYPE_MEDIA, seglist, &offset);
+    if(size < 2) /* templates are resolved by time */
+        return false;
+
+    mtime_t total = 0;
+    std::size_t i = size;
+    while(i > 0 && total < delay)
+    {
+        const mtime_t duration = seglist.at(i - 1)->duration.Get() * CLOCK_FREQ / inheritTimescale();
+        if(!duration)
+            return false;
+        total += duration;
+        i--;
+    }
+
+    *ret = offset + i;
+    return true;
+}
+
 void SegmentInformation::getDurationsRange(mtime_t *min, mtime_t *max) const
 {
     /* FIXME: cache stuff in segment holders */
@@ -80,6 +80,7 @@ namespace adaptative
                 ISegment * getSegment(SegmentInfoType, uint64_t = 0) const;
                 bool getSegmentNumberByTime(mtime_t, uint64_t *) const;
                 mtime_t getPlaybackTimeBySegmentNumber(uint64_t) const;
+                bool getLiveStartSegmentNumber(mtime_t, uint64_t *) const;
                 void getDurationsRange(mtime_t *, mtime_t *) const;
                 virtual void mergeWith(SegmentInformation *, mtime_t);
                 virtual void pruneBySegmentNumber(uint64_t);
@@ -87,6 +88,7 @@ namespace adaptative
             protected:
                 std::size_t getAllSegments(std::vector<ISegment *> &) const;
                 std::size_t getSegments(SegmentInfoType, std::vector<ISegment *>&, std::size_t * = NULL) const;
+                SegmentList *     inheritSegmentList() const;
                 std::vector<SegmentInformation *> childs;
                 SegmentInformation *parent;
                 SwitchPolicy switchpolicy;
@@ -102,7 +104,6 @@ namespace adaptative
             private:
                 void init();
                 SegmentBase *     inheritSegmentBase() const;
-                SegmentList *     inheritSegmentList() const;
                 MediaSegmentTemplate * inheritSegmentTemplate() const;
 
                 SegmentBase     *segmentBase;
@@ -31,91 +31,99 @@ SegmentTimeline::SegmentTimeline(TimescaleAble *parent)
     :TimescaleAble(parent)
 {
     pruned = 0;
+    totalLength = 0;
 }
 
 SegmentTimeline::~SegmentTimeline()
 {
-    std::list<Element *>::iterator it;
+    std::deque<Element *>::iterator it;
     for(it = elements.begin(); it != elements.end(); ++it)
         delete *it;
 }
 
 void SegmentTimeline::addElement(stime_t d, uint64_t r, stime_t t)
 {
+    if(d <= 0) /* would break the ordering */
+        return;
+
+    if(!elements.empty())
+    {
+        const Element *el = elements.back();
+        if(!t)
+            t = el->t + (el->d * (el->r + 1));
+        else if(t <= el->t)
+            return;
+    }
+
     Element *element = new (std::nothrow) Element(d, r, t);
     if(element)
+        append(element);
+}
+
+/* Numbers the element, or folds it in the last one when it only repeats it */
+void SegmentTimeline::append(Element *element)
+{
+    if(!elements.empty())
     {
-        if(!elements.empty() && !t)
+        Element *last = elements.back();
+        if(last->d == element->d &&
+           last->t + last->d * (stime_t)(last->r + 1) == element->t)
         {
-            const Element *el = elements.back();
-            element->t = el->t + (el->d * (el->r + 1));
+            last->r += element->r + 1;
+            totalLength += element->r + 1;
+            delete element;
+            return;
         }
-        elements.push_back(element);
     }
+
+    element->number = pruned + totalLength;
+    totalLength += element->r + 1;
+    elements.push_back(element);
 }
 
-uint64_t SegmentTimeline::getElementNumberByScaledPlaybackTime(stime_t scaled) const
+bool SegmentTimeline::startsAfter(stime_t scaled, const Element *el)
 {
-    uint64_t count = 0;
-    std::list<Element *>::const_iterator it;
-    for(it = elements.begin(); it != elements.end(); ++it)
-    {
-        const Element *el = *it;
-        for(uint64_t repeat = 1 + el->r; repeat; repeat--)
-        {
-            if(el->d >= scaled)
-                return count;
+    return scaled < el->t;
+}
 
-            scaled -= el->d;
-            count++;
-        }
-    }
-    count += pruned;
-    return count;
+bool SegmentTimeline::numberedAfter(uint64_t number, const Element *el)
+{
+    return number < el->number;
 }
 
-stime_t SegmentTimeline::getScaledPlaybackTimeByElementNumber(uint64_t number) const
+uint64_t SegmentTimeline::getElementNumberByScaledPlaybackTime(stime_t scaled) const
 {
-    stime_t totalscaledtime = 0;
+    std::deque<Element *>::const_iterator it =
+            std::upper_bound(elements.begin(), elements.end(), scaled, startsAfter);
+    if(it == elements.begin())
+        return pruned;
+
+    const Element *el = *(--it);
+    uint64_t repeat = (scaled - el->t) / el->d;
+    if(repeat > el->r) /* in a gap, or past the end: next segment */
+        return el->number + el->r + 1;
+    return el->number + repeat;
+}
 
-    if(number < pruned)
+stime_t SegmentTimeline::getScaledPlaybackTimeByElementNumber(uint64_t number) const
+{
+    if(number < pruned || elements.empty())
         return 0;
 
-    number -= pruned;
+    /* the first element is numbered after the pruned ones */
+    std::deque<Element *>::const_iterator it =
+            std::upper_bound(elements.begin(), elements.end(), number, numberedAfter);
+    const Element *el = *(--it);
 
-    std::list<Element *>::const_iterator it;
-    for(it = elements.begin(); it != elements.end(); ++it)
-    {
-        const Element *el = *it;
-
-        if(number == 0)
-        {
-            totalscaledtime = el->t;
-            break;
-        }
-        else if(number <= el->r)
-        {
-            totalscaledtime = el->t + (number * el->d);
-            break;
-        }
-        else
-        {
-            number -= el->r + 1;
-        }
-    }
-
-    return totalscaledtime;
+    number -= el->number;
+    if(number > el->r)
+        return 0;
+    return el->t + (number * el->d);
 }
 
 size_t SegmentTimeline::maxElementNumber() const
 {
-    size_t count = 0;
-
-    std::list<Element *>::const_iterator it;
-    for(it = elements.begin(); it != elements.end(); ++it)
-        count += (*it)->r + 1;
-
-    return pruned + count - 1;
+    return pruned + totalLength - 1;
 }
 
 size_t SegmentTimeline::prune(mtime_t time)
@@ -128,6 +136,7 @@ size_t SegmentTimeline::prune(mtime_t time)
         if(el->t + (el->d * (stime_t)(el->r + 1)) < scaled)
         {
             prunednow += el->r + 1;
+            totalLength -= el->r + 1;
             delete el;
             elements.pop_front();
         }
@@ -141,50 +150,47 @@ size_t SegmentTimeline::prune(mtime_t time)
 
 void SegmentTimeline::mergeWith(SegmentTimeline &other)
 {
-    if(elements.empty())
-    {
-        while(other.elements.size())
-        {
-            elements.push_back(other.elements.front());
-            other.elements.pop_front();
-        }
-        return;
-    }
-
-    Element *last = elements.back();
     while(other.elements.size())
     {
         Element *el = other.elements.front();
         other.elements.pop_front();
-        if(el->t == last->t) /* Same element, but prev could have been middle of repeat */
-        {
-            last->r = std::max(last->r, el->r);
-            delete el;
-        }
-        else if(el->t > last->t) /* Did not exist in previous list */
+
+        if(!elements.empty())
         {
-            if( el->t - last->t >= last->d * (stime_t)(last->r + 1) )
+            Element *last = elements.back();
+            if(el->t == last->t) /* Same element, but prev could have been middle of repeat */
             {
-                elements.push_back(el);
-                last = el;
+                if(el->r > last->r)
+                {
+                    totalLength += el->r - last->r;
+                    last->r = el->r;
+                }
+                delete el;
+                continue;
             }
-            else if(last->d == el->d) /* should always be in that case */
+            else if(el->t < last->t) /* Already known */
             {
-                last->r = ((el->t - last->t) / last->d) - 1;
-                elements.push_back(el);
-                last = el;
+                delete el;
+                continue;
             }
-            else
+            else if( el->t - last->t < last->d * (stime_t)(last->r + 1) )
             {
-                /* borked: skip */
-                delete el;
+                /* Starts in the middle of the last repeats */
+                if(last->d != el->d || el->t - last->t < last->d)
+                {
+                    /* borked: skip */
+                    delete el;
+                    continue;
+                }
+                totalLength -= last->r;
+                last->r = ((el->t - last->t) / last->d) - 1;
+                totalLength += last->r;
             }
         }
-        else
-        {
-            delete el;
-        }
+
+        append(el);
     }
+    other.totalLength = 0;
 }
 
 mtime_t SegmentTimeline::start() const
@@ -208,4 +214,5 @@ SegmentTimeline::Element::Element(stime_t d_, uint64_t r_, stime_t t_)
     d = d_;
     t = t_;
     r = r_;
+    number = 0;
 }
@@ -30,7 +30,7 @@
 
 #include "SegmentInfoCommon.h"
 #include <vlc_common.h>
-#include <list>
+#include <deque>
 
 namespace adaptative
 {
@@ -53,8 +53,15 @@ namespace adaptative
                 mtime_t end() const;
 
             private:
-                std::list<Element *> elements;
+                void append(Element *);
+                static bool startsAfter(stime_t, const Element *);
+                static bool numberedAfter(uint64_t, const Element *);
+
+                /* Sorted by start time and by number, so that both can be
+                 * looked up with a binary search */
+                std::deque<Element *> elements;
                 size_t pruned;
+                uint64_t totalLength; /* segments in elements */
 
                 class Element
                 {
@@ -63,6 +70,7 @@ namespace adaptative
                         stime_t  t;
                         stime_t  d;
                         uint64_t r;
+                        uint64_t number; /* of the first segment, counting the pruned ones */
                 };
         };
     }
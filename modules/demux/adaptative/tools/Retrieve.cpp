@@ -48,21 +48,35 @@ uint64_t Retrieve::HTTP(vlc_object_t *obj, const std::string &uri, void **pp_dat
         return 0;
     }
 
-    size_t i_data = datachunk->getBytesToRead();
-    *pp_data = malloc(i_data);
-    if(*pp_data)
+    size_t i_data = 0;
+    *pp_data = NULL;
+    /* The length can be unknown until the end of the transfer */
+    while(datachunk->getBytesToRead() > 0)
     {
-        ssize_t ret = datachunk->getConnection()->read(*pp_data, i_data);
-        if(ret < 0)
+        size_t i_read = datachunk->getBytesToRead();
+        if(!datachunk->isLengthKnown())
+            i_read = 32768;
+        uint8_t *p_realloc = (uint8_t *) realloc(*pp_data, i_data + i_read);
+        if(!p_realloc)
         {
             free(*pp_data);
             *pp_data = NULL;
             i_data = 0;
+            break;
         }
-        else
+        *pp_data = p_realloc;
+
+        ssize_t ret = datachunk->getConnection()->read(p_realloc + i_data, i_read);
+        if(ret < 0)
         {
-            i_data = ret;
+            free(*pp_data);
+            *pp_data = NULL;
+            i_data = 0;
+            break;
         }
+        i_data += ret;
+        if(ret == 0 && datachunk->isLengthKnown())
+            break;
     }
     datachunk->getConnection()->releaseChunk();
     delete datachunk;
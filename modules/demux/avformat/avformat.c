@@ -45,6 +45,8 @@ vlc_module_begin ()
     set_section( N_("Demuxer"), NULL )
     add_string( "avformat-format", NULL, FORMAT_TEXT, FORMAT_LONGTEXT, true )
     add_obsolete_string("ffmpeg-format") /* removed since 2.1.0 */
+    add_integer_with_range( "avformat-io-buffer", 0, 0, 1024,
+                            IO_BUFFER_TEXT, IO_BUFFER_LONGTEXT, true )
 #if LIBAVFORMAT_VERSION_INT >= ((53<<16)+(26<<8)+0)
     add_string( "avformat-options", NULL, AV_OPTIONS_TEXT, AV_OPTIONS_LONGTEXT, true )
 #endif
@@ -36,3 +36,6 @@ void CloseMux( vlc_object_t * );
 #define MUX_LONGTEXT N_("Force use of a specific avformat muxer.")
 #define FORMAT_TEXT N_( "Format name" )
 #define FORMAT_LONGTEXT N_( "Internal libavcodec format name" )
+#define IO_BUFFER_TEXT N_( "I/O buffer size (KiB)" )
+#define IO_BUFFER_LONGTEXT N_( "Size of the buffer used to read the " \
+    "input. 0 picks a size matching the access latency." )
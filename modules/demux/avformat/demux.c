@@ -94,6 +94,7 @@ static int IORead( void *opaque, uint8_t *buf, int buf_size );
 static int64_t IOSeek( void *opaque, int64_t offset, int whence );
 
 static block_t *BuildSsaFrame( const AVPacket *p_pkt, unsigned i_order );
+static block_t *BlockFromPacket( const AVPacket *p_pkt );
 static void UpdateSeekPoint( demux_t *p_demux, int64_t i_time );
 static void ResetTime( demux_t *p_demux, int64_t i_time );
 
@@ -111,6 +112,31 @@ static vlc_fourcc_t CodecTagToFourcc( uint32_t codec_tag )
  * Open
  *****************************************************************************/
 
+/* Size the AVIO buffer after the access latency: local files are fine with
+ * small reads, while each read on a slow access should fetch as much data
+ * as possible. */
+#define IO_BUFFER_MIN (32 * 1024)
+#define IO_BUFFER_MAX (1024 * 1024)
+
+static int IOBufferSize( demux_t *p_demux )
+{
+    int64_t i_size = var_InheritInteger( p_demux, "avformat-io-buffer" ) * 1024;
+
+    if( i_size <= 0 )
+    {
+        int64_t i_delay;
+
+        if( stream_Control( p_demux->s, STREAM_GET_PTS_DELAY, &i_delay ) )
+            i_delay = DEFAULT_PTS_DELAY;
+        /* 32 KiB for every 300 ms of caching */
+        i_size = IO_BUFFER_MIN * ( i_delay / 300000 );
+    }
+
+    i_size = VLC_CLIP( i_size, IO_BUFFER_MIN, IO_BUFFER_MAX );
+    msg_Dbg( p_demux, "using %"PRId64" bytes of I/O buffer", i_size );
+    return i_size;
+}
+
 static void get_rotation(es_format_t *fmt, AVStream *s)
 {
     char const *kRotateKey = "rotate";
@@ -285,7 +311,7 @@ int OpenDemux( vlc_object_t *p_this )
     p_sys->p_title = NULL;
 
     /* Create I/O wrapper */
-    p_sys->io_buffer_size = 32768;  /* FIXME */
+    p_sys->io_buffer_size = IOBufferSize( p_demux );
     p_sys->io_buffer = xmalloc( p_sys->io_buffer_size );
 
     p_sys->ic = avformat_alloc_context();
@@ -723,12 +749,11 @@ static int Demux( demux_t *p_demux )
     }
     else
     {
-        if( ( p_frame = block_Alloc( pkt.size ) ) == NULL )
+        if( ( p_frame = BlockFromPacket( &pkt ) ) == NULL )
         {
             av_free_packet( &pkt );
             return 0;
         }
-        memcpy( p_frame->p_buffer, pkt.data, pkt.size );
     }
 
     if( pkt.flags & AV_PKT_FLAG_KEY )
@@ -852,6 +877,60 @@ static void ResetTime( demux_t *p_demux, int64_t i_time )
     }
 }
 
+#if LIBAVCODEC_VERSION_CHECK( 54, 34, 0, 59, 100 )
+/* block_t sharing the reference counted payload of an AVPacket */
+typedef struct
+{
+    block_t      self;
+    AVBufferRef *p_ref;
+} packet_block_t;
+
+static void PacketBlockRelease( block_t *p_block )
+{
+    packet_block_t *p_pblock = (packet_block_t *)p_block;
+
+    av_buffer_unref( &p_pblock->p_ref );
+    free( p_pblock );
+}
+#endif
+
+static block_t *BlockFromPacket( const AVPacket *p_pkt )
+{
+#if LIBAVCODEC_VERSION_CHECK( 54, 34, 0, 59, 100 )
+    /* Packets coming straight from the demuxer own their payload and can be
+     * handed over without copy. Packets built by the parsers may point to
+     * internal buffers, those are copied below. */
+    if( p_pkt->buf != NULL && p_pkt->data >= p_pkt->buf->data &&
+        p_pkt->data + p_pkt->size <= p_pkt->buf->data + p_pkt->buf->size )
+    {
+        packet_block_t *p_pblock = malloc( sizeof( *p_pblock ) );
+        if( unlikely(p_pblock == NULL) )
+            return NULL;
+
+        p_pblock->p_ref = av_buffer_ref( p_pkt->buf );
+        if( unlikely(p_pblock->p_ref == NULL) )
+        {
+            free( p_pblock );
+            return NULL;
+        }
+
+        /* Expose the padding allocated by libavformat as block tail room,
+         * so that the decoders can realloc in place. */
+        block_t *p_block = &p_pblock->self;
+        block_Init( p_block, p_pkt->data,
+                    p_pkt->buf->data + p_pkt->buf->size - p_pkt->data );
+        p_block->i_buffer = p_pkt->size;
+        p_block->pf_release = PacketBlockRelease;
+        return p_block;
+    }
+#endif
+
+    block_t *p_block = block_Alloc( p_pkt->size );
+    if( likely(p_block != NULL) )
+        memcpy( p_block->p_buffer, p_pkt->data, p_pkt->size );
+    return p_block;
+}
+
 static block_t *BuildSsaFrame( const AVPacket *p_pkt, unsigned i_order )
 {
     if( p_pkt->size <= 0 )
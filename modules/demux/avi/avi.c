@@ -135,6 +135,7 @@ typedef struct
 } avi_index_t;
 static void avi_index_Init( avi_index_t * );
 static void avi_index_Clean( avi_index_t * );
+static void avi_index_Reserve( avi_index_t *, unsigned int );
 static void avi_index_Append( avi_index_t *, off_t *, avi_entry_t * );
 
 typedef struct
@@ -803,6 +804,14 @@ aviindex:
         }
     }
 
+    /* The tracks have their own copy of the idx1 entries by now */
+    avi_chunk_idx1_t *p_idx1 = AVI_ChunkFind( p_riff, AVIFOURCC_idx1, 0 );
+    if( p_idx1 )
+    {
+        FREENULL( p_idx1->entry );
+        p_idx1->i_entry_count = p_idx1->i_entry_max = 0;
+    }
+
     if( p_sys->b_seekable )
     {
         /* we have read all chunk so go back to movi */
@@ -2254,6 +2263,18 @@ static void avi_index_Clean( avi_index_t *p_index )
 {
     free( p_index->p_entry );
 }
+static void avi_index_Reserve( avi_index_t *p_index, unsigned int i_count )
+{
+    /* Make room for i_count more entries at once */
+    if( p_index->i_max - p_index->i_size >= i_count )
+        return;
+
+    p_index->i_max = p_index->i_size + i_count;
+    p_index->p_entry = realloc_or_free( p_index->p_entry,
+                                        p_index->i_max * sizeof( *p_index->p_entry ) );
+    if( !p_index->p_entry )
+        p_index->i_size = p_index->i_max = 0;
+}
 static void avi_index_Append( avi_index_t *p_index, off_t *pi_last_pos,
                               avi_entry_t *p_entry )
 {
@@ -2360,6 +2381,15 @@ static int AVI_IndexLoad_idx1( demux_t *p_demux,
 
     p_sys->b_indexloaded = true;
 
+    /* Count the entries of each stream first, so as to allocate the
+     * indexes once instead of growing them entry after entry */
+    unsigned i_count[p_sys->i_track];
+    uint8_t  *pi_stream = malloc( p_idx1->i_entry_count );
+    if( p_idx1->i_entry_count > 0 && !pi_stream )
+        return VLC_ENOMEM;
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        i_count[i] = 0;
+
     for( unsigned i_index = 0; i_index < p_idx1->i_entry_count; i_index++ )
     {
         unsigned i_cat;
@@ -2370,6 +2400,19 @@ static int AVI_IndexLoad_idx1( demux_t *p_demux,
                                &i_cat );
         if( i_stream < p_sys->i_track &&
             (i_cat == p_sys->track[i_stream]->i_cat || i_cat == UNKNOWN_ES ) )
+            i_count[i_stream]++;
+        else
+            i_stream = UINT8_MAX;
+        pi_stream[i_index] = i_stream;
+    }
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        avi_index_Reserve( &p_index[i], i_count[i] );
+
+    for( unsigned i_index = 0; i_index < p_idx1->i_entry_count; i_index++ )
+    {
+        unsigned i_stream = pi_stream[i_index];
+
+        if( i_stream < p_sys->i_track )
         {
             avi_entry_t index;
             index.i_id     = p_idx1->entry[i_index].i_fourcc;
@@ -2381,6 +2424,7 @@ static int AVI_IndexLoad_idx1( demux_t *p_demux,
             avi_index_Append( &p_index[i_stream], pi_last_offset, &index );
         }
     }
+    free( pi_stream );
     return VLC_SUCCESS;
 }
 
@@ -2392,6 +2436,7 @@ static void __Parse_indx( demux_t *p_demux, avi_index_t *p_index, off_t *pi_max_
     p_demux->p_sys->b_indexloaded = true;
 
     msg_Dbg( p_demux, "loading subindex(0x%x) %d entries", p_indx->i_indextype, p_indx->i_entriesinuse );
+    avi_index_Reserve( p_index, p_indx->i_entriesinuse );
     if( p_indx->i_indexsubtype == 0 )
     {
         for( unsigned i = 0; i < p_indx->i_entriesinuse; i++ )
@@ -43,6 +43,7 @@
 #include <vlc_strings.h>
 #include <vlc_stream.h>
 #include <cstdio>
+#include <cstdlib>
 
 using namespace dash::mpd;
 using namespace dash::xml;
@@ -91,41 +92,30 @@ bool    IsoffMainParser::parse              (Profile profile)
 
 void    IsoffMainParser::setMPDAttributes   ()
 {
-    const std::map<std::string, std::string> attr = this->root->getAttributes();
+    if(root->hasAttribute("mediaPresentationDuration"))
+        this->mpd->duration.Set(IsoTime(root->getAttributeValue("mediaPresentationDuration")) * CLOCK_FREQ);
 
-    std::map<std::string, std::string>::const_iterator it;
+    if(root->hasAttribute("minBufferTime"))
+        this->mpd->minBufferTime.Set(IsoTime(root->getAttributeValue("minBufferTime")) * CLOCK_FREQ);
 
-    it = attr.find("mediaPresentationDuration");
-    if(it != attr.end())
-        this->mpd->duration.Set(IsoTime(it->second) * CLOCK_FREQ);
-
-    it = attr.find("minBufferTime");
-    if(it != attr.end())
-        this->mpd->minBufferTime.Set(IsoTime(it->second) * CLOCK_FREQ);
-
-    it = attr.find("minimumUpdatePeriod");
-    if(it != attr.end())
+    if(root->hasAttribute("minimumUpdatePeriod"))
     {
-        mtime_t minupdate = IsoTime(it->second) * CLOCK_FREQ;
+        mtime_t minupdate = IsoTime(root->getAttributeValue("minimumUpdatePeriod")) * CLOCK_FREQ;
         if(minupdate > 0)
             mpd->minUpdatePeriod.Set(minupdate);
     }
 
-    it = attr.find("maxSegmentDuration");
-    if(it != attr.end())
-        mpd->maxSegmentDuration.Set(IsoTime(it->second) * CLOCK_FREQ);
+    if(root->hasAttribute("maxSegmentDuration"))
+        mpd->maxSegmentDuration.Set(IsoTime(root->getAttributeValue("maxSegmentDuration")) * CLOCK_FREQ);
 
-    it = attr.find("type");
-    if(it != attr.end())
-        mpd->setType(it->second);
+    if(root->hasAttribute("type"))
+        mpd->setType(root->getAttributeValue("type"));
 
-    it = attr.find("availabilityStartTime");
-    if(it != attr.end())
-        mpd->availabilityStartTime.Set(UTCTime(it->second));
+    if(root->hasAttribute("availabilityStartTime"))
+        mpd->availabilityStartTime.Set(UTCTime(root->getAttributeValue("availabilityStartTime")));
 
-    it = attr.find("timeShiftBufferDepth");
-        if(it != attr.end())
-            mpd->timeShiftBufferDepth.Set(IsoTime(it->second) * CLOCK_FREQ);
+    if(root->hasAttribute("timeShiftBufferDepth"))
+        mpd->timeShiftBufferDepth.Set(IsoTime(root->getAttributeValue("timeShiftBufferDepth")) * CLOCK_FREQ);
 }
 
 void IsoffMainParser::parsePeriods(Node *root)
@@ -413,29 +403,39 @@ void IsoffMainParser::parseTimeline(Node *node, MediaSegmentTemplate *templ)
         return;
 
     SegmentTimeline *timeline = new (std::nothrow) SegmentTimeline(templ);
-    if(timeline)
+    if(!timeline)
+        return;
+
+    /* Live timelines can hold thousands of S elements and are parsed again
+     * at each refresh: walk the children in place, and convert the numbers
+     * without going through streams. */
+    const std::vector<Node *> &elements = node->getSubNodes();
+    std::vector<Node *>::const_iterator it;
+    size_t count = 0;
+    for(it = elements.begin(); it != elements.end(); ++it)
     {
-        std::vector<Node *> elements = DOMHelper::getElementByTagName(node, "S", false);
-        std::vector<Node *>::const_iterator it;
-        for(it = elements.begin(); it != elements.end(); ++it)
-        {
-            const Node *s = *it;
-            if(!s->hasAttribute("d")) /* Mandatory */
-                continue;
-            stime_t d = Integer<stime_t>(s->getAttributeValue("d"));
-            uint64_t r = 0; // never repeats by default
-            if(s->hasAttribute("r"))
-                r = Integer<uint64_t>(s->getAttributeValue("r"));
-            if(s->hasAttribute("t"))
-            {
-                stime_t t = Integer<stime_t>(s->getAttributeValue("t"));
-                timeline->addElement(d, r, t);
-            }
-            else timeline->addElement(d, r);
+        const Node *s = *it;
+        if(s->getName() != "S")
+            continue;
 
-            templ->segmentTimeline.Set(timeline);
-        }
+        const std::string &d = s->getAttributeValue("d");
+        if(d.empty()) /* Mandatory */
+            continue;
+
+        const std::string &r = s->getAttributeValue("r");
+        const std::string &t = s->getAttributeValue("t");
+        timeline->addElement(strtoll(d.c_str(), NULL, 10),
+                             strtoull(r.c_str(), NULL, 10), /* never repeats by default */
+                             strtoll(t.c_str(), NULL, 10));
+        count++;
+    }
+
+    if(count == 0)
+    {
+        delete timeline;
+        return;
     }
+    templ->segmentTimeline.Set(timeline);
 }
 
 void IsoffMainParser::parseProgramInformation(Node * node, MPD *mpd)
@@ -86,7 +86,7 @@ Node* DOMParser::processNode()
                         lifo.top()->addSubNode(node);
                     lifo.push(node);
 
-                    node->setName(std::string(data));
+                    node->setName(data);
                     addAttributesToNode(node);
                 }
 
@@ -98,7 +98,7 @@ Node* DOMParser::processNode()
             case XML_READER_TEXT:
             {
                 if(!lifo.empty())
-                    lifo.top()->setText(std::string(data));
+                    lifo.top()->setText(data);
                 break;
             }
 
@@ -133,11 +133,7 @@ void    DOMParser::addAttributesToNode      (Node *node)
     const char *attrName;
 
     while((attrName = xml_ReaderNextAttr(this->vlc_reader, &attrValue)) != NULL)
-    {
-        std::string key     = attrName;
-        std::string value   = attrValue;
-        node->addAttribute(key, value);
-    }
+        node->addAttribute(attrName, attrValue);
 }
 void    DOMParser::print                    (Node *node, int offset)
 {
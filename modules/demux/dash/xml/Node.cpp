@@ -57,35 +57,40 @@ const std::string&                  Node::getName               () const
 {
     return this->name;
 }
-void                                Node::setName               (const std::string& name)
+void                                Node::setName               (const char *name)
 {
     this->name = name;
 }
 
 bool                                Node::hasAttribute        (const std::string& name) const
 {
-    if(this->attributes.find(name) != this->attributes.end())
-        return true;
+    std::vector<std::pair<std::string, std::string> >::const_iterator it;
+
+    for(it = this->attributes.begin(); it != this->attributes.end(); ++it)
+        if(it->first == name)
+            return true;
 
     return false;
 }
 const std::string&                  Node::getAttributeValue     (const std::string& key) const
 {
-    std::map<std::string, std::string>::const_iterator  it = this->attributes.find( key );
+    std::vector<std::pair<std::string, std::string> >::const_iterator it;
 
-    if ( it != this->attributes.end() )
-        return it->second;
+    for(it = this->attributes.begin(); it != this->attributes.end(); ++it)
+        if(it->first == key)
+            return it->second;
     return EmptyString;
 }
 
-void                                Node::addAttribute          ( const std::string& key, const std::string& value)
+void                                Node::addAttribute          (const char *key, const char *value)
 {
-    this->attributes[key] = value;
+    /* The XML reader rejects duplicate attributes */
+    this->attributes.push_back(std::make_pair(std::string(key), std::string(value)));
 }
 std::vector<std::string>            Node::getAttributeKeys      () const
 {
     std::vector<std::string> keys;
-    std::map<std::string, std::string>::const_iterator it;
+    std::vector<std::pair<std::string, std::string> >::const_iterator it;
 
     for(it = this->attributes.begin(); it != this->attributes.end(); ++it)
     {
@@ -99,16 +104,11 @@ const std::string&                         Node::getText               () const
     return text;
 }
 
-void Node::setText(const std::string &text)
+void Node::setText(const char *text)
 {
     this->text = text;
 }
 
-const std::map<std::string,std::string>&   Node::getAttributes         () const
-{
-    return this->attributes;
-}
-
 int Node::getType() const
 {
     return this->type;
@@ -27,7 +27,7 @@
 
 #include <vector>
 #include <string>
-#include <map>
+#include <utility>
 
 namespace dash
 {
@@ -42,14 +42,13 @@ namespace dash
                 const std::vector<Node *>&          getSubNodes         () const;
                 void                                addSubNode          (Node *node);
                 const std::string&                  getName             () const;
-                void                                setName             (const std::string& name);
+                void                                setName             (const char *name);
                 bool                                hasAttribute        (const std::string& name) const;
-                void                                addAttribute        (const std::string& key, const std::string& value);
+                void                                addAttribute        (const char *key, const char *value);
                 const std::string&                  getAttributeValue   (const std::string& key) const;
                 std::vector<std::string>            getAttributeKeys    () const;
                 const std::string&                  getText             () const;
-                void                                setText( const std::string &text );
-                const std::map<std::string, std::string>& getAttributes () const;
+                void                                setText( const char *text );
                 int                                 getType() const;
                 void                                setType( int type );
                 std::vector<std::string>            toString(int) const;
@@ -57,7 +56,9 @@ namespace dash
             private:
                 static const std::string            EmptyString;
                 std::vector<Node *>                 subNodes;
-                std::map<std::string, std::string>  attributes;
+                /* Elements only carry a few attributes: a vector is cheaper
+                 * to fill and to search than a map */
+                std::vector<std::pair<std::string, std::string> > attributes;
                 std::string                         name;
                 std::string                         text;
                 int                                 type;
@@ -26,6 +26,9 @@
 #include "../adaptative/logic/RateBasedAdaptationLogic.h"
 #include "../adaptative/tools/Retrieve.hpp"
 #include "playlist/Parser.hpp"
+#include "playlist/Representation.hpp"
+#include "../adaptative/playlist/BasePeriod.h"
+#include "../adaptative/playlist/BaseAdaptationSet.h"
 #include <vlc_stream.h>
 #include <vlc_demux.h>
 #include <time.h>
@@ -133,9 +136,14 @@ bool HLSManager::updatePlaylist()
         return true;
 
     M3U8 *updatedplaylist = NULL;
+    bool b_updated = false;
 
-    /* do update */
-    if(nextPlaylistupdate)
+    /* do update, only parsing new segments when possible */
+    if(nextPlaylistupdate && updateMediaPlaylists())
+    {
+        b_updated = true;
+    }
+    else if(nextPlaylistupdate)
     {
         std::string url(p_demux->psz_access);
         url.append("://");
@@ -170,12 +178,19 @@ bool HLSManager::updatePlaylist()
     /* Compute new MPD update time */
     mtime_t mininterval = 0;
     mtime_t maxinterval = 0;
-    if(updatedplaylist)
+    if(updatedplaylist || b_updated)
     {
-        updatedplaylist->getPlaylistDurationsRange(&mininterval, &maxinterval);
-        playlist->mergeWith(updatedplaylist);
+        if(updatedplaylist)
+        {
+            updatedplaylist->getPlaylistDurationsRange(&mininterval, &maxinterval);
+            playlist->mergeWith(updatedplaylist);
+            delete updatedplaylist;
+        }
+        else
+        {
+            playlist->getPlaylistDurationsRange(&mininterval, &maxinterval);
+        }
         playlist->debug();
-        delete updatedplaylist;
 
         /* pruning */
         std::vector<Stream *>::iterator it;
@@ -205,3 +220,50 @@ bool HLSManager::updatePlaylist()
 
     return true;
 }
+
+/* Refreshes each live media playlist in place, parsing only the segments
+   following the last known one. Fails if any of them needs a full update. */
+bool HLSManager::updateMediaPlaylists()
+{
+    const std::vector<BasePeriod *> &periods = playlist->getPeriods();
+    std::vector<BasePeriod *>::const_iterator itp;
+    for(itp = periods.begin(); itp != periods.end(); ++itp)
+    {
+        const std::vector<BaseAdaptationSet *> &sets = (*itp)->getAdaptationSets();
+        std::vector<BaseAdaptationSet *>::const_iterator ita;
+        for(ita = sets.begin(); ita != sets.end(); ++ita)
+        {
+            std::vector<BaseRepresentation *> &reps = (*ita)->getRepresentations();
+            std::vector<BaseRepresentation *>::const_iterator itr;
+            for(itr = reps.begin(); itr != reps.end(); ++itr)
+            {
+                Representation *rep = dynamic_cast<Representation *>(*itr);
+                if(!rep || rep->getPlaylistUrl().empty())
+                    return false;
+                if(!rep->isLive())
+                    continue;
+
+                uint8_t *p_data = NULL;
+                size_t i_data = Retrieve::HTTP(VLC_OBJECT(p_demux->s), rep->getPlaylistUrl(),
+                                               (void**) &p_data);
+                if(!p_data)
+                    return false;
+
+                stream_t *updatestream = stream_MemoryNew(p_demux->s, p_data, i_data, false);
+                if(!updatestream)
+                {
+                    free(p_data);
+                    return false;
+                }
+
+                Parser parser(updatestream);
+                bool b_ret = parser.updateSegments(rep);
+                stream_Delete(updatestream);
+                if(!b_ret)
+                    return false;
+            }
+        }
+    }
+
+    return true;
+}
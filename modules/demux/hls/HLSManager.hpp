@@ -39,6 +39,9 @@ namespace hls
             virtual bool updatePlaylist();
 
             static bool isHTTPLiveStreaming(stream_t *);
+
+        private:
+            bool updateMediaPlaylists();
     };
 
 }
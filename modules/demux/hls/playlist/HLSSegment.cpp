@@ -100,7 +100,44 @@ void HLSSegment::onChunkDownload(block_t **pp_block, SegmentChunk *chunk, BaseRe
             }
         }
 
-        if(ctx)
+        if(ctx && !encpending.empty())
+        {
+            /* prepend the tail left from the previous read */
+            const size_t i_pending = encpending.size();
+            block_t *p_merged = block_Alloc(i_pending + p_block->i_buffer);
+            if(p_merged)
+            {
+                memcpy(p_merged->p_buffer, &encpending[0], i_pending);
+                memcpy(&p_merged->p_buffer[i_pending], p_block->p_buffer, p_block->i_buffer);
+                block_Release(p_block);
+                p_block = *pp_block = p_merged;
+            }
+            encpending.clear();
+            if(!p_merged)
+            {
+                p_block->i_buffer = 0;
+                gcry_cipher_close(ctx);
+                ctx = NULL;
+                return;
+            }
+        }
+
+        const bool b_last = (chunk->getBytesToRead() == 0);
+        if(ctx && !b_last)
+        {
+            /* Reads can end anywhere: only decrypt whole cipher blocks, and
+               while the length is unknown, keep the last one for removing
+               the padding once the end is reached */
+            size_t i_keep = p_block->i_buffer % 16;
+            if(!chunk->isLengthKnown())
+                i_keep = (p_block->i_buffer >= i_keep + 16) ? i_keep + 16
+                                                            : p_block->i_buffer;
+            encpending.assign(p_block->p_buffer + p_block->i_buffer - i_keep,
+                              p_block->p_buffer + p_block->i_buffer);
+            p_block->i_buffer -= i_keep;
+        }
+
+        if(ctx && (b_last || p_block->i_buffer))
         {
             if ((p_block->i_buffer % 16) != 0 || p_block->i_buffer < 16 ||
                 gcry_cipher_decrypt(ctx, p_block->p_buffer, p_block->i_buffer, NULL, 0))
@@ -112,7 +149,7 @@ void HLSSegment::onChunkDownload(block_t **pp_block, SegmentChunk *chunk, BaseRe
             else
             {
                 /* last bytes */
-                if(chunk->getBytesToRead() == 0)
+                if(b_last)
                 {
                     /* remove the PKCS#7 padding from the buffer */
                     const uint8_t pad = p_block->p_buffer[p_block->i_buffer - 1];
@@ -155,6 +192,11 @@ void HLSSegment::debug(vlc_object_t *obj, int indent) const
     msg_Dbg(obj, "%s", ss.str().c_str());
 }
 
+uint64_t HLSSegment::getSequenceNumber() const
+{
+    return sequence;
+}
+
 int HLSSegment::compare(ISegment *segment) const
 {
     HLSSegment *hlssegment = dynamic_cast<HLSSegment *>(segment);
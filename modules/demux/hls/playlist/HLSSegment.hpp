@@ -58,6 +58,7 @@ namespace hls
                 void setEncryption(SegmentEncryption &);
                 void debug(vlc_object_t *, int) const; /* reimpl */
                 virtual int compare(ISegment *) const; /* reimpl */
+                uint64_t getSequenceNumber() const;
 
             protected:
                 virtual void onChunkDownload(block_t **, SegmentChunk *, BaseRepresentation *); /* reimpl */
@@ -67,6 +68,7 @@ namespace hls
                 SegmentEncryption encryption;
 #ifdef HAVE_GCRYPT
                 gcry_cipher_hd_t ctx;
+                std::vector<uint8_t> encpending; /* not yet decrypted tail */
 #endif
         };
     }
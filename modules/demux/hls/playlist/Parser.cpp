@@ -108,15 +108,17 @@ void Parser::parseRepresentation(BaseAdaptationSet *adaptSet, const AttributesTa
             std::list<Tag *> tagslist = parseEntries(substream);
             stream_Delete(substream);
 
-            parseRepresentation(adaptSet, tag, tagslist);
+            Representation *rep = parseRepresentation(adaptSet, tag, tagslist);
+            if(rep)
+                rep->playlistUrl.Set(url.toString());
 
             releaseTagsList(tagslist);
         }
     }
 }
 
-void Parser::parseRepresentation(BaseAdaptationSet *adaptSet, const AttributesTag * tag,
-                                 const std::list<Tag *> &tagslist)
+Representation * Parser::parseRepresentation(BaseAdaptationSet *adaptSet, const AttributesTag * tag,
+                                             const std::list<Tag *> &tagslist)
 {
     const Attribute *uriAttr = tag->getAttributeByName("URI");
     const Attribute *bwAttr = tag->getAttributeByName("BANDWIDTH");
@@ -177,6 +179,7 @@ void Parser::parseRepresentation(BaseAdaptationSet *adaptSet, const AttributesTa
 
         adaptSet->addRepresentation(rep);
     }
+    return rep;
 }
 
 void Parser::parseSegments(Representation *rep, const std::list<Tag *> &tagslist)
@@ -186,8 +189,24 @@ void Parser::parseSegments(Representation *rep, const std::list<Tag *> &tagslist
 
     rep->timescale.Set(100);
 
+    const stime_t totalduration = appendSegments(rep, segmentList, tagslist, 0, 0);
+
+    if(rep->isLive())
+    {
+        rep->getPlaylist()->duration.Set(0);
+    }
+    else if(totalduration * CLOCK_FREQ / rep->timescale.Get() > rep->getPlaylist()->duration.Get())
+    {
+        rep->getPlaylist()->duration.Set(totalduration * CLOCK_FREQ / rep->timescale.Get());
+    }
+}
+
+/* skipped: number of segments dropped after the media sequence tag */
+stime_t Parser::appendSegments(Representation *rep, SegmentList *segmentList,
+                               const std::list<Tag *> &tagslist,
+                               stime_t nzStartTime, uint64_t skipped)
+{
     stime_t totalduration = 0;
-    stime_t nzStartTime = 0;
     uint64_t sequenceNumber = 0;
     std::size_t prevbyterangeoffset = 0;
     const SingleValueTag *ctx_byterange = NULL;
@@ -202,7 +221,7 @@ void Parser::parseSegments(Representation *rep, const std::list<Tag *> &tagslist
             /* using static cast as attribute type permits avoiding class check */
             case SingleValueTag::EXTXMEDIASEQUENCE:
             {
-                sequenceNumber = (static_cast<const SingleValueTag*>(tag))->getValue().decimal();
+                sequenceNumber = (static_cast<const SingleValueTag*>(tag))->getValue().decimal() + skipped;
             }
             break;
 
@@ -294,14 +313,36 @@ void Parser::parseSegments(Representation *rep, const std::list<Tag *> &tagslist
         }
     }
 
-    if(rep->isLive())
-    {
-        rep->getPlaylist()->duration.Set(0);
-    }
-    else if(totalduration * CLOCK_FREQ / rep->timescale.Get() > rep->getPlaylist()->duration.Get())
+    return totalduration;
+}
+
+bool Parser::updateSegments(Representation *rep)
+{
+    SegmentList *segmentList = rep->inheritSegmentList();
+    if(!segmentList || segmentList->getSegments().empty())
+        return false;
+
+    const HLSSegment *last = dynamic_cast<const HLSSegment *>(segmentList->getSegments().back());
+    if(!last)
+        return false;
+
+    char *psz_line = stream_ReadLine(p_stream);
+    if(!psz_line || strcmp(psz_line, "#EXTM3U"))
     {
-        rep->getPlaylist()->duration.Set(totalduration * CLOCK_FREQ / rep->timescale.Get());
+        free(psz_line);
+        return false;
     }
+    free(psz_line);
+
+    std::list<Tag *> tagslist;
+    uint64_t skipped = 0;
+    bool b_ret = parseNewEntries(p_stream, last->getSequenceNumber(), tagslist, &skipped);
+    if(b_ret)
+        appendSegments(rep, segmentList, tagslist,
+                       last->startTime.Get() + last->duration.Get(), skipped);
+    releaseTagsList(tagslist);
+
+    return b_ret;
 }
 
 M3U8 * Parser::parse(const std::string &playlisturl)
@@ -410,7 +451,9 @@ M3U8 * Parser::parse(const std::string &playlisturl)
         {
             period->addAdaptationSet(adaptSet);
             AttributesTag *tag = new AttributesTag(AttributesTag::EXTXSTREAMINF, "");
-            parseRepresentation(adaptSet, tag, tagslist);
+            Representation *rep = parseRepresentation(adaptSet, tag, tagslist);
+            if(rep)
+                rep->playlistUrl.Set(playlisturl);
             delete tag;
         }
     }
@@ -423,6 +466,37 @@ M3U8 * Parser::parse(const std::string &playlisturl)
     return playlist;
 }
 
+static Tag * createTagFromLine(const char *psz_line)
+{
+    std::string key;
+    std::string attributes;
+    const char *split = strchr(psz_line, ':');
+    if(split)
+    {
+        key = std::string(psz_line + 1, split - psz_line - 1);
+        attributes = std::string(split + 1);
+    }
+    else
+    {
+        key = std::string(psz_line + 1);
+    }
+
+    if(key.empty())
+        return NULL;
+    return TagFactory::createTagByName(key, attributes);
+}
+
+static void addURIToTag(Tag *tag, const char *psz_line)
+{
+    AttributesTag *attrTag = dynamic_cast<AttributesTag *>(tag);
+    if(attrTag)
+    {
+        Attribute *uriAttr = new (std::nothrow) Attribute("URI", std::string(psz_line));
+        if(uriAttr)
+            attrTag->addAttribute(uriAttr);
+    }
+}
+
 std::list<Tag *> Parser::parseEntries(stream_t *stream)
 {
     std::list<Tag *> entrieslist;
@@ -435,37 +509,86 @@ std::list<Tag *> Parser::parseEntries(stream_t *stream)
         {
             if(!strncmp(psz_line, "#EXT", 4)) //tag
             {
-                std::string key;
-                std::string attributes;
-                const char *split = strchr(psz_line, ':');
-                if(split)
-                {
-                    key = std::string(psz_line + 1, split - psz_line - 1);
-                    attributes = std::string(split + 1);
-                }
-                else
-                {
-                    key = std::string(psz_line + 1);
-                }
+                Tag *tag = createTagFromLine(psz_line);
+                if(tag)
+                    entrieslist.push_back(tag);
+                lastTag = tag;
+            }
+        }
+        else if(*psz_line && lastTag)
+        {
+            addURIToTag(lastTag, psz_line);
+            lastTag = NULL;
+        }
+        else // drop
+        {
+            lastTag = NULL;
+        }
+
+        free(psz_line);
+    }
+
+    return entrieslist;
+}
 
-                if(!key.empty())
+/* Same as parseEntries, but drops the segments up to lastsequence without
+ * creating their tags, and only keeps the last key preceding the new ones.
+ * Fails on byte ranges, as their offsets can depend on dropped segments. */
+bool Parser::parseNewEntries(stream_t *stream, uint64_t lastsequence,
+                             std::list<Tag *> &entrieslist, uint64_t *skipped)
+{
+    Tag *lastTag = NULL;
+    Tag *keyTag = NULL;
+    bool b_new = false;
+    bool b_ret = true;
+    uint64_t sequence = 0;
+    char *psz_line;
+
+    while((psz_line = stream_ReadLine(stream)))
+    {
+        if(*psz_line == '#')
+        {
+            if(!b_new && !strncmp(psz_line, "#EXTINF:", 8) && sequence <= lastsequence)
+            {
+                /* already known, drop along with its URI */
+                sequence++;
+                (*skipped)++;
+                lastTag = NULL;
+            }
+            else if(!strncmp(psz_line, "#EXT", 4)) //tag
+            {
+                Tag *tag = createTagFromLine(psz_line);
+                if(tag && !b_new)
                 {
-                    Tag *tag = TagFactory::createTagByName(key, attributes);
-                    if(tag)
-                        entrieslist.push_back(tag);
-                    lastTag = tag;
+                    switch(tag->getType())
+                    {
+                        case SingleValueTag::EXTXMEDIASEQUENCE:
+                            sequence = static_cast<const SingleValueTag *>(tag)->getValue().decimal();
+                            break;
+                        case SingleValueTag::EXTXBYTERANGE:
+                            b_ret = false;
+                            break;
+                        case AttributesTag::EXTXKEY:
+                            delete keyTag;
+                            keyTag = tag;
+                            tag = NULL;
+                            break;
+                        case URITag::EXTINF:
+                            b_new = true;
+                            if(keyTag)
+                                entrieslist.push_back(keyTag);
+                            keyTag = NULL;
+                            break;
+                    }
                 }
+                if(tag)
+                    entrieslist.push_back(tag);
+                lastTag = tag;
             }
         }
         else if(*psz_line && lastTag)
         {
-            AttributesTag *attrTag = dynamic_cast<AttributesTag *>(lastTag);
-            if(attrTag)
-            {
-                Attribute *uriAttr = new (std::nothrow) Attribute("URI", std::string(psz_line));
-                if(uriAttr)
-                    attrTag->addAttribute(uriAttr);
-            }
+            addURIToTag(lastTag, psz_line);
             lastTag = NULL;
         }
         else // drop
@@ -476,5 +599,7 @@ std::list<Tag *> Parser::parseEntries(stream_t *stream)
         free(psz_line);
     }
 
-    return entrieslist;
+    delete keyTag;
+
+    return b_ret;
 }
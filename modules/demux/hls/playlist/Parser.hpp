@@ -37,6 +37,7 @@ namespace adaptative
     {
         class SegmentInformation;
         class MediaSegmentTemplate;
+        class SegmentList;
         class BasePeriod;
         class BaseAdaptationSet;
     }
@@ -60,14 +61,20 @@ namespace hls
                 virtual ~Parser    ();
 
                 M3U8 *             parse  (const std::string &);
+                /* Appends the segments following the last known one,
+                   from the refreshed media playlist */
+                bool               updateSegments(Representation *);
 
             private:
                 void parseAdaptationSet(BasePeriod *, const AttributesTag *);
                 void parseRepresentation(BaseAdaptationSet *, const AttributesTag *);
-                void parseRepresentation(BaseAdaptationSet *, const AttributesTag *,
-                                         const std::list<Tag *>&);
+                Representation * parseRepresentation(BaseAdaptationSet *, const AttributesTag *,
+                                                      const std::list<Tag *>&);
                 void parseSegments(Representation *, const std::list<Tag *>&);
+                stime_t appendSegments(Representation *, SegmentList *, const std::list<Tag *>&,
+                                       stime_t, uint64_t);
                 std::list<Tag *> parseEntries(stream_t *);
+                bool parseNewEntries(stream_t *, uint64_t, std::list<Tag *>&, uint64_t *);
 
                 stream_t        *p_stream;
         };
@@ -57,6 +57,11 @@ bool Representation::isLive() const
     return b_live;
 }
 
+std::string Representation::getPlaylistUrl() const
+{
+    return playlistUrl.Get();
+}
+
 void Representation::localMergeWithPlaylist(M3U8 *updated, mtime_t prunebarrier)
 {
     BasePeriod *period = updated->getFirstPeriod();
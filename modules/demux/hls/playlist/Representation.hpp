@@ -44,6 +44,7 @@ namespace hls
 
                 void localMergeWithPlaylist(M3U8 *, mtime_t);
                 bool isLive() const;
+                std::string getPlaylistUrl() const;
                 virtual void mergeWith(SegmentInformation *, mtime_t); /* reimpl */
 
             private:
@@ -127,6 +127,24 @@ void EbmlParser::Unkeep()
     mb_keep = false;
 }
 
+/* Skips and drops the last element got, so that the next elements of the
+ * level can be read from the stream directly. */
+bool EbmlParser::Flush( void )
+{
+    if( mi_user_level != mi_level || m_got || mb_keep )
+        return false;
+
+    if( m_el[mi_level] )
+    {
+        m_el[mi_level]->SkipData( *m_es, EBML_CONTEXT(m_el[mi_level]) );
+        if( MKV_IS_ID( m_el[mi_level], KaxBlockVirtual ) )
+            static_cast<KaxBlockVirtualWorkaround*>(m_el[mi_level])->Fix();
+        delete m_el[mi_level];
+        m_el[mi_level] = NULL;
+    }
+    return true;
+}
+
 int EbmlParser::GetLevel( void ) const
 {
     return mi_user_level;
@@ -43,6 +43,7 @@ class EbmlParser
     EbmlElement *Get( int n_call = 0 );
     void        Keep( void );
     void        Unkeep( void );
+    bool        Flush( void );
     EbmlElement *UnGet( uint64 i_block_pos, uint64 i_cluster_pos );
 
     int  GetLevel( void ) const;
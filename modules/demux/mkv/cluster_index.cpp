@@ -0,0 +1,456 @@
+/*****************************************************************************
+ * cluster_index.cpp : matroska demuxer
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "cluster_index.hpp"
+
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+#include <vlc_stream.h>
+#include <vlc_configuration.h>
+
+#include <cerrno>
+#include <new>
+
+#define MKV_INDEX_MAGIC    "VLCMKVI1"
+
+#define MKV_ID_CLUSTER     0x1F43B675
+#define MKV_ID_TIMECODE    0xE7
+
+/*****************************************************************************
+ * EBML elements, read without libebml so as not to parse the blocks
+ *****************************************************************************/
+static bool IsClusterChild( uint32_t i_id )
+{
+    switch( i_id )
+    {
+        case MKV_ID_TIMECODE:
+        case 0x5854: /* SilentTracks */
+        case 0xA7:   /* Position */
+        case 0xAB:   /* PrevSize */
+        case 0xA3:   /* SimpleBlock */
+        case 0xA0:   /* BlockGroup */
+        case 0xAF:   /* EncryptedBlock */
+        case 0xEC:   /* Void */
+        case 0xBF:   /* CRC-32 */
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* Returns the length of the header of the element, or 0 on error. The size
+ * of the data is UINT64_MAX if unknown. */
+static unsigned ReadElementHeader( stream_t *s, uint32_t *pi_id,
+                                   uint64_t *pi_size )
+{
+    uint8_t p[12];
+
+    if( stream_Read( s, p, 1 ) != 1 )
+        return 0;
+
+    unsigned i_id_len = 1;
+    while( i_id_len <= 4 && !( p[0] & ( 0x80 >> ( i_id_len - 1 ) ) ) )
+        i_id_len++;
+    if( i_id_len > 4 )
+        return 0;
+
+    /* the rest of the ID and the first byte of the size */
+    if( stream_Read( s, &p[1], i_id_len ) != (ssize_t)i_id_len )
+        return 0;
+
+    uint32_t i_id = 0;
+    for( unsigned i = 0; i < i_id_len; i++ )
+        i_id = ( i_id << 8 ) | p[i];
+
+    const uint8_t *p_size = &p[i_id_len];
+    unsigned i_size_len = 1;
+    while( i_size_len <= 8 && !( p_size[0] & ( 0x80 >> ( i_size_len - 1 ) ) ) )
+        i_size_len++;
+    if( i_size_len > 8 )
+        return 0;
+    if( i_size_len > 1 &&
+        stream_Read( s, &p[i_id_len + 1], i_size_len - 1 ) != (ssize_t)( i_size_len - 1 ) )
+        return 0;
+
+    /* all the bits of the value set means an unknown size */
+    uint64_t i_size = p_size[0] & ( 0xFF >> i_size_len );
+    bool b_unknown = i_size == ( 0xFFu >> i_size_len );
+    for( unsigned i = 1; i < i_size_len; i++ )
+    {
+        i_size = ( i_size << 8 ) | p_size[i];
+        b_unknown = b_unknown && p_size[i] == 0xFF;
+    }
+
+    *pi_id = i_id;
+    *pi_size = b_unknown ? UINT64_MAX : i_size;
+    return i_id_len + i_size_len;
+}
+
+/*****************************************************************************
+ * cluster_index_c
+ *****************************************************************************/
+cluster_index_c::cluster_index_c( demux_t *p_demux_, const void *p_id,
+                                  size_t i_id, uint64_t i_size_ )
+    :p_demux( p_demux_ )
+    ,psz_path( NULL )
+    ,i_size( i_size_ )
+    ,psz_url( NULL )
+    ,i_start( 0 )
+    ,i_end( 0 )
+    ,i_timescale( 0 )
+    ,p_interrupt( NULL )
+    ,b_started( false )
+    ,b_done( false )
+    ,b_complete( false )
+    ,b_loaded( false )
+{
+    vlc_mutex_init( &lock );
+    vlc_cond_init( &wait );
+
+    if( !var_InheritBool( p_demux, "mkv-index-cache" ) )
+        return;
+
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    if( psz_cachedir == NULL )
+        return;
+
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, p_id, i_id );
+    AddMD5( &md5, &i_size, sizeof( i_size ) );
+    EndMD5( &md5 );
+
+    char *psz_key = psz_md5_hash( &md5 );
+    if( psz_key != NULL &&
+        asprintf( &psz_path, "%s" DIR_SEP "mkv" DIR_SEP "%s", psz_cachedir,
+                  psz_key ) == -1 )
+        psz_path = NULL;
+    free( psz_key );
+    free( psz_cachedir );
+}
+
+cluster_index_c::~cluster_index_c()
+{
+    if( b_started )
+    {
+        vlc_interrupt_kill( p_interrupt );
+        vlc_join( thread, NULL );
+        vlc_interrupt_destroy( p_interrupt );
+        Save();
+    }
+
+    vlc_cond_destroy( &wait );
+    vlc_mutex_destroy( &lock );
+    free( psz_url );
+    free( psz_path );
+}
+
+/* Loads the index saved by a previous complete scan */
+bool cluster_index_c::Load( std::vector<entry_t> & list )
+{
+    if( psz_path == NULL )
+        return false;
+
+    FILE *file = vlc_fopen( psz_path, "rb" );
+    if( file == NULL )
+        return false;
+
+    char p_magic[8];
+    uint64_t i_file_size, i_count;
+    bool b_ok = fread( p_magic, sizeof( p_magic ), 1, file ) == 1 &&
+                !memcmp( p_magic, MKV_INDEX_MAGIC, sizeof( p_magic ) ) &&
+                fread( &i_file_size, sizeof( i_file_size ), 1, file ) == 1 &&
+                i_file_size == i_size &&
+                fread( &i_count, sizeof( i_count ), 1, file ) == 1 &&
+                i_count > 0 && i_count <= i_size / 8;
+    if( b_ok )
+    {
+        try
+        {
+            entries.resize( i_count );
+        }
+        catch( std::bad_alloc & )
+        {
+            b_ok = false;
+        }
+    }
+    if( b_ok )
+        b_ok = fread( &entries[0], sizeof( entry_t ), i_count, file ) == i_count;
+    fclose( file );
+
+    for( size_t i = 0; b_ok && i < entries.size(); i++ )
+    {
+        if( entries[i].i_position < 0 || (uint64_t)entries[i].i_position >= i_size ||
+            ( i > 0 && entries[i].i_position <= entries[i - 1].i_position ) )
+            b_ok = false;
+    }
+
+    if( !b_ok )
+    {
+        msg_Warn( p_demux, "invalid clusters index %s", psz_path );
+        entries.clear();
+        return false;
+    }
+
+    msg_Dbg( p_demux, "loaded the index of %zu clusters from %s",
+             entries.size(), psz_path );
+    b_loaded = b_complete = true;
+    list = entries;
+    return true;
+}
+
+void cluster_index_c::Save()
+{
+    if( psz_path == NULL || b_loaded || !b_complete || entries.empty() )
+        return;
+
+    /* create the directories up to the index */
+    for( char *p = strchr( psz_path + 1, DIR_SEP_CHAR ); p != NULL;
+         p = strchr( p + 1, DIR_SEP_CHAR ) )
+    {
+        *p = '\0';
+        vlc_mkdir( psz_path, 0700 );
+        *p = DIR_SEP_CHAR;
+    }
+
+    char *psz_tmp;
+    if( asprintf( &psz_tmp, "%s.part", psz_path ) == -1 )
+        return;
+
+    FILE *file = vlc_fopen( psz_tmp, "wb" );
+    if( file == NULL )
+    {
+        msg_Warn( p_demux, "cannot save the clusters index %s: %s",
+                  psz_tmp, vlc_strerror_c(errno) );
+        free( psz_tmp );
+        return;
+    }
+
+    uint64_t i_count = entries.size();
+    bool b_ok = fwrite( MKV_INDEX_MAGIC, 8, 1, file ) == 1 &&
+                fwrite( &i_size, sizeof( i_size ), 1, file ) == 1 &&
+                fwrite( &i_count, sizeof( i_count ), 1, file ) == 1 &&
+                fwrite( &entries[0], sizeof( entry_t ), i_count, file ) == i_count;
+    b_ok = !fclose( file ) && b_ok;
+
+    if( b_ok && vlc_rename( psz_tmp, psz_path ) == 0 )
+        msg_Dbg( p_demux, "saved the index of %zu clusters to %s",
+                 entries.size(), psz_path );
+    else
+        vlc_unlink( psz_tmp );
+    free( psz_tmp );
+}
+
+/* Starts scanning the clusters from i_start up to i_end, on a stream of its
+ * own opened from psz_url */
+bool cluster_index_c::Start( const char *psz_url_, uint64_t i_start_,
+                             uint64_t i_end_, uint64_t i_timescale_ )
+{
+    if( b_started || b_loaded )
+        return b_started;
+
+    psz_url = strdup( psz_url_ );
+    p_interrupt = vlc_interrupt_create();
+    if( unlikely( psz_url == NULL || p_interrupt == NULL ) )
+        goto error;
+
+    i_start = i_start_;
+    i_end = i_end_;
+    i_timescale = i_timescale_;
+
+    if( vlc_clone( &thread, ScanThread, this, VLC_THREAD_PRIORITY_LOW ) )
+        goto error;
+
+    msg_Dbg( p_demux, "indexing the clusters in background" );
+    b_started = true;
+    return true;
+
+error:
+    if( p_interrupt != NULL )
+        vlc_interrupt_destroy( p_interrupt );
+    p_interrupt = NULL;
+    free( psz_url );
+    psz_url = NULL;
+    return false;
+}
+
+void *cluster_index_c::ScanThread( void *data )
+{
+    cluster_index_c *p_index = static_cast<cluster_index_c *>( data );
+    bool b_complete = false;
+
+    vlc_interrupt_set( p_index->p_interrupt );
+
+    stream_t *s = stream_UrlNew( VLC_OBJECT( p_index->p_demux ),
+                                 p_index->psz_url );
+    if( s != NULL )
+    {
+        b_complete = p_index->Scan( s );
+        stream_Delete( s );
+    }
+
+    vlc_mutex_lock( &p_index->lock );
+    msg_Dbg( p_index->p_demux, "indexed %zu clusters%s",
+             p_index->entries.size(), b_complete ? "" : " (incomplete)" );
+    p_index->b_complete = b_complete;
+    p_index->b_done = true;
+    vlc_cond_broadcast( &p_index->wait );
+    vlc_mutex_unlock( &p_index->lock );
+
+    vlc_interrupt_set( NULL );
+    return NULL;
+}
+
+/* Returns true if the whole segment was scanned */
+bool cluster_index_c::Scan( stream_t *s )
+{
+    uint64_t i_pos = i_start;
+
+    while( !vlc_killed() )
+    {
+        if( i_pos >= i_end )
+            return true;
+
+        uint32_t i_id;
+        uint64_t i_len;
+        unsigned i_hdr;
+        if( stream_Seek( s, i_pos ) ||
+            !( i_hdr = ReadElementHeader( s, &i_id, &i_len ) ) )
+            break;
+
+        uint64_t i_data = i_pos + i_hdr;
+        /* the last element may be truncated */
+        uint64_t i_next = i_len == UINT64_MAX ? 0 :
+                          ( i_data < i_end && i_len < i_end - i_data ) ?
+                          i_data + i_len : i_end;
+
+        if( i_id != MKV_ID_CLUSTER )
+        {
+            if( i_next == 0 ) /* cannot be skipped */
+                break;
+            i_pos = i_next;
+            continue;
+        }
+
+        /* Read the timecode of the cluster, and walk its children up to the
+         * next element if its size is unknown */
+        uint64_t i_child = i_data;
+        mtime_t i_mk_time = -1;
+        bool b_error = false;
+
+        while( i_mk_time < 0 || i_next == 0 )
+        {
+            uint32_t i_child_id;
+            uint64_t i_child_len;
+            unsigned i_child_hdr = 0;
+
+            if( ( i_next != 0 && i_child >= i_next ) || i_child >= i_end ||
+                stream_Seek( s, i_child ) ||
+                !( i_child_hdr = ReadElementHeader( s, &i_child_id, &i_child_len ) ) ||
+                !IsClusterChild( i_child_id ) )
+            {
+                if( i_next == 0 )
+                    i_next = i_child;
+                break;
+            }
+
+            if( i_child_id == MKV_ID_TIMECODE && i_child_len <= 8 )
+            {
+                uint8_t p[8];
+                if( stream_Read( s, p, i_child_len ) != (ssize_t)i_child_len )
+                {
+                    b_error = true;
+                    break;
+                }
+
+                uint64_t i_timecode = 0;
+                for( unsigned i = 0; i < i_child_len; i++ )
+                    i_timecode = ( i_timecode << 8 ) | p[i];
+                i_mk_time = i_timecode * i_timescale / INT64_C(1000);
+            }
+
+            if( i_child_len == UINT64_MAX )
+            {
+                b_error = true;
+                break;
+            }
+            i_child += i_child_hdr + i_child_len;
+        }
+
+        if( b_error || i_next <= i_pos )
+            break;
+
+        if( i_mk_time >= 0 )
+        {
+            const entry_t entry = { (int64_t)i_pos, i_mk_time };
+
+            vlc_mutex_lock( &lock );
+            try
+            {
+                entries.push_back( entry );
+            }
+            catch( std::bad_alloc & )
+            {
+                b_error = true;
+            }
+            vlc_cond_broadcast( &wait );
+            vlc_mutex_unlock( &lock );
+            if( b_error )
+                break;
+        }
+
+        i_pos = i_next;
+    }
+
+    return false;
+}
+
+/* Waits until the clusters are indexed past i_mk_date, or the scan ends.
+ * Returns true if i_mk_date is then covered by the index. */
+bool cluster_index_c::Wait( mtime_t i_mk_date )
+{
+    bool b_covered;
+
+    vlc_mutex_lock( &lock );
+    if( b_started && !b_done )
+        msg_Dbg( p_demux, "waiting for the clusters index" );
+    while( !( b_covered = b_complete ||
+                          ( !entries.empty() && entries.back().i_mk_time > i_mk_date ) ) &&
+           b_started && !b_done && !vlc_killed() )
+        vlc_cond_timedwait( &wait, &lock, mdate() + CLOCK_FREQ / 10 );
+    vlc_mutex_unlock( &lock );
+
+    return b_covered;
+}
+
+/* Copies the clusters indexed from the i_first one. Returns true if the
+ * index is complete. */
+bool cluster_index_c::Get( size_t i_first, std::vector<entry_t> & list )
+{
+    vlc_mutex_lock( &lock );
+    if( i_first < entries.size() )
+        list.assign( entries.begin() + i_first, entries.end() );
+    else
+        list.clear();
+    bool b_ret = b_complete;
+    vlc_mutex_unlock( &lock );
+
+    return b_ret;
+}
@@ -0,0 +1,85 @@
+/*****************************************************************************
+ * cluster_index.hpp : matroska demuxer
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef _CLUSTER_INDEX_HPP_
+#define _CLUSTER_INDEX_HPP_
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_interrupt.h>
+
+#include <vector>
+
+/*****************************************************************************
+ * Index of the clusters of a segment without cues
+ *****************************************************************************
+ * The clusters are scanned on a thread of their own, reading their headers
+ * only from a stream of its own. Once the whole segment is scanned, the index
+ * is saved in the cache directory, keyed by the identity of the segment, and
+ * loaded instead the next time.
+ *****************************************************************************/
+class cluster_index_c
+{
+  public:
+    struct entry_t
+    {
+        int64_t i_position; /* of the cluster */
+        mtime_t i_mk_time;
+    };
+
+    cluster_index_c( demux_t *p_demux, const void *p_id, size_t i_id,
+                     uint64_t i_size );
+    ~cluster_index_c();
+
+    bool Load( std::vector<entry_t> & list );
+    bool Start( const char *psz_url, uint64_t i_start, uint64_t i_end,
+                uint64_t i_timescale );
+    bool Wait( mtime_t i_mk_date );
+    bool Get( size_t i_first, std::vector<entry_t> & list );
+
+  private:
+    static void *ScanThread( void * );
+    bool Scan( stream_t *s );
+    void Save();
+
+    demux_t         *p_demux;
+    char            *psz_path;   /* of the saved index, NULL if disabled */
+    uint64_t        i_size;      /* of the stream */
+
+    char            *psz_url;
+    uint64_t        i_start;
+    uint64_t        i_end;
+    uint64_t        i_timescale;
+
+    vlc_thread_t    thread;
+    vlc_interrupt_t *p_interrupt;
+    vlc_mutex_t     lock;
+    vlc_cond_t      wait;
+    std::vector<entry_t> entries;
+    bool            b_started;
+    bool            b_done;
+    bool            b_complete; /* all the clusters of the segment */
+    bool            b_loaded;
+};
+
+#endif
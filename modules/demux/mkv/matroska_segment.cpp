@@ -27,6 +27,7 @@
 #include "demux.hpp"
 #include "util.hpp"
 #include "Ebml_parser.hpp"
+#include "stream_io_callback.hpp"
 
 matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estream )
     :segment(NULL)
@@ -52,6 +53,8 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,b_cues(false)
     ,i_index(0)
     ,i_index_max(1024)
+    ,p_cluster_index(NULL)
+    ,i_cluster_index_merged(0)
     ,psz_muxing_application(NULL)
     ,psz_writing_application(NULL)
     ,psz_segment_filename(NULL)
@@ -83,6 +86,7 @@ matroska_segment_c::~matroska_segment_c()
     free( psz_segment_filename );
     free( psz_title );
     free( psz_date_utc );
+    delete p_cluster_index;
     free( p_indexes );
 
     delete ep;
@@ -611,6 +615,99 @@ void matroska_segment_c::IndexAppendCluster( KaxCluster *cluster )
 #undef idx
 }
 
+void matroska_segment_c::IndexLoad()
+{
+    stream_t *s = static_cast<vlc_stream_io_callback &>( es.I_O() ).getStream();
+    bool b_fastseekable;
+
+    if( p_cluster_index != NULL || s->psz_url == NULL ||
+        stream_Control( s, STREAM_CAN_FASTSEEK, &b_fastseekable ) ||
+        !b_fastseekable )
+        return;
+
+    /* the UID identifies the segment, else its location */
+    if( p_segment_uid != NULL )
+        p_cluster_index = new cluster_index_c( &sys.demuxer,
+                                               p_segment_uid->GetBuffer(),
+                                               p_segment_uid->GetSize(),
+                                               stream_Size( s ) );
+    else
+        p_cluster_index = new cluster_index_c( &sys.demuxer, s->psz_url,
+                                               strlen( s->psz_url ),
+                                               stream_Size( s ) );
+
+    std::vector<cluster_index_c::entry_t> entries;
+    if( p_cluster_index->Load( entries ) )
+    {
+        IndexMerge( entries );
+        b_cues = true;
+    }
+}
+
+/* Adds the clusters to the index, both sorted by position */
+void matroska_segment_c::IndexMerge( const std::vector<cluster_index_c::entry_t> & entries )
+{
+    if( entries.empty() )
+        return;
+
+    int i_max = i_index + entries.size() + 1024;
+    mkv_index_t *p_merged = (mkv_index_t*)malloc( sizeof( mkv_index_t ) * i_max );
+    if( unlikely( p_merged == NULL ) )
+        return;
+
+    int i_merged = 0;
+    int i = 0;
+    size_t j = 0;
+    while( i < i_index || j < entries.size() )
+    {
+        if( j == entries.size() ||
+            ( i < i_index && p_indexes[i].i_position <= entries[j].i_position ) )
+        {
+            /* already known */
+            if( j < entries.size() && p_indexes[i].i_position == entries[j].i_position )
+                j++;
+            p_merged[i_merged++] = p_indexes[i++];
+            continue;
+        }
+
+#define idx p_merged[i_merged]
+        idx.i_track       = -1;
+        idx.i_block_number= -1;
+        idx.i_position    = entries[j].i_position;
+        idx.i_mk_time     = entries[j].i_mk_time;
+        idx.b_key         = true;
+#undef idx
+        i_merged++;
+        j++;
+    }
+
+    free( p_indexes );
+    p_indexes = p_merged;
+    i_index = i_merged;
+    i_index_max = i_max;
+}
+
+/* Without cues, waits for the clusters indexed in background up to
+ * i_mk_date, and adds them to the index. Returns true if it covers
+ * i_mk_date, so that seeking there does not need to read the segment. */
+bool matroska_segment_c::IndexWait( mtime_t i_mk_date )
+{
+    if( b_cues )
+        return true;
+    if( p_cluster_index == NULL )
+        return false;
+
+    bool b_covered = p_cluster_index->Wait( i_mk_date );
+
+    std::vector<cluster_index_c::entry_t> entries;
+    if( p_cluster_index->Get( i_cluster_index_merged, entries ) )
+        b_cues = true; /* all the clusters are indexed */
+    i_cluster_index_merged += entries.size();
+    IndexMerge( entries );
+
+    return b_covered;
+}
+
 bool matroska_segment_c::PreloadFamily( const matroska_segment_c & of_segment )
 {
     if ( b_preloaded )
@@ -761,6 +858,10 @@ bool matroska_segment_c::Preload( )
 
     b_preloaded = true;
 
+    /* without cues, the clusters may have been indexed before */
+    if( !b_cues )
+        IndexLoad();
+
     EnsureDuration();
 
     return true;
@@ -1035,7 +1136,7 @@ void matroska_segment_c::Seek( mtime_t i_mk_date, mtime_t i_mk_time_offset, int6
         {
             bool b_key_picture;
             bool b_discardable_picture;
-            if( BlockGet( block, simpleblock, &b_key_picture, &b_discardable_picture, &i_block_duration ) )
+            if( BlockGet( block, simpleblock, NULL, &b_key_picture, &b_discardable_picture, &i_block_duration ) )
             {
                 msg_Warn( &sys.demuxer, "cannot get block EOF?" );
                 while( p_first )
@@ -1111,7 +1212,7 @@ void matroska_segment_c::Seek( mtime_t i_mk_date, mtime_t i_mk_time_offset, int6
     {
         bool b_key_picture;
         bool b_discardable_picture;
-        BlockGet( block, simpleblock, &b_key_picture, &b_discardable_picture, &i_block_duration );
+        BlockGet( block, simpleblock, NULL, &b_key_picture, &b_discardable_picture, &i_block_duration );
         delete block;
         cluster = (KaxCluster *) ep->UnGet( p_min->i_seek_pos, p_min->i_cluster_pos );
     }
@@ -1346,6 +1447,16 @@ bool matroska_segment_c::Select( mtime_t i_mk_start_time )
     ep = new EbmlParser( &es, segment, &sys.demuxer,
                          var_InheritBool( &sys.demuxer, "mkv-use-dummy" ) );
 
+    /* without cues, index the clusters in background to seek in them */
+    if( p_cluster_index != NULL && !b_cues )
+    {
+        stream_t *s = static_cast<vlc_stream_io_callback &>( es.I_O() ).getStream();
+        uint64_t i_end = segment->IsFiniteSize() ? segment->GetEndPosition()
+                                                 : stream_Size( s );
+
+        p_cluster_index->Start( s->psz_url, i_start_pos, i_end, i_timescale );
+    }
+
     return true;
 }
 
@@ -1365,10 +1476,107 @@ void matroska_segment_c::UnSelect( )
     ep = NULL;
 }
 
-int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_simpleblock, bool *pb_key_picture, bool *pb_discardable_picture, int64_t *pi_duration )
+/* Reads an EBML variable size integer, UINT64_MAX if all its bits are set.
+ * Returns its length, or 0 if it does not fit. */
+static size_t ReadVint( const uint8_t *p, size_t i_max, uint64_t *pi_value )
+{
+    if( i_max == 0 )
+        return 0;
+
+    size_t i_len = 1;
+    while( i_len <= 8 && !( p[0] & ( 0x80 >> ( i_len - 1 ) ) ) )
+        i_len++;
+    if( i_len > 8 || i_len > i_max )
+        return 0;
+
+    uint64_t i_value = p[0] & ( 0xFF >> i_len );
+    bool b_all_set = i_value == ( 0xFFu >> i_len );
+    for( size_t i = 1; i < i_len; i++ )
+    {
+        i_value = ( i_value << 8 ) | p[i];
+        b_all_set = b_all_set && p[i] == 0xFF;
+    }
+
+    *pi_value = b_all_set ? UINT64_MAX : i_value;
+    return i_len;
+}
+
+/* Reads the next element of the cluster without libebml, if it is a
+ * SimpleBlock of a single frame that needs no more than a block_t */
+bool matroska_segment_c::BlockGetFrame( mkv_frame_t *p_frame, bool *pb_key_picture, bool *pb_discardable_picture )
+{
+    stream_t *s = static_cast<vlc_stream_io_callback &>( es.I_O() ).getStream();
+
+    if( !ep->Flush() )
+        return false;
+
+    /* ID, size, track number, timecode and flags */
+    const uint8_t *p_peek;
+    ssize_t i_peek = stream_Peek( s, &p_peek, 1 + 8 + 8 + 3 );
+    if( i_peek < 1 + 1 + 1 + 3 || p_peek[0] != 0xA3 /* SimpleBlock */ )
+        return false;
+
+    uint64_t i_size;
+    size_t i_header = 1;
+    size_t i_len = ReadVint( &p_peek[i_header], i_peek - i_header, &i_size );
+    if( i_len == 0 || i_size == UINT64_MAX || i_size >= SIZE_MAX )
+        return false;
+    i_header += i_len;
+
+    uint64_t i_track_number;
+    if( (size_t)i_peek <= i_header )
+        return false;
+    i_len = ReadVint( &p_peek[i_header], i_peek - i_header, &i_track_number );
+    if( i_len == 0 || i_header + i_len + 3 > (size_t)i_peek || i_size < i_len + 3 )
+        return false;
+
+    const uint8_t *p_data = &p_peek[i_header + i_len];
+    int16_t i_block_timecode = GetWBE( p_data );
+    uint8_t i_flags = p_data[2];
+    size_t i_data = i_header + i_len + 3;
+    if( i_flags & 0x06 ) /* laced */
+        return false;
+
+    if( cluster->IsFiniteSize() &&
+        (uint64_t)stream_Tell( s ) + i_header + i_size > cluster->GetEndPosition() )
+        return false;
+
+    size_t i_track;
+    for( i_track = 0; i_track < tracks.size(); i_track++ )
+        if( tracks[i_track]->i_number == i_track_number )
+            break;
+    if( i_track >= tracks.size() ||
+        tracks[i_track]->i_compression_type != MATROSKA_COMPRESSION_NONE ||
+        tracks[i_track]->fmt.i_codec == VLC_CODEC_WAVPACK )
+        return false;
+
+    block_t *p_block = stream_Block( s, i_header + i_size );
+    if( p_block == NULL )
+        return false;
+    if( p_block->i_buffer < i_header + i_size )
+    {
+        block_Release( p_block );
+        return false;
+    }
+    p_block->p_buffer += i_data;
+    p_block->i_buffer -= i_data;
+
+    p_frame->p_block    = p_block;
+    p_frame->i_track    = i_track;
+    p_frame->i_timecode = (int64_t)i_block_timecode * (int64_t)i_timescale
+                        + cluster->GlobalTimecode();
+
+    *pb_key_picture         = ( i_flags & 0x80 ) != 0;
+    *pb_discardable_picture = ( i_flags & 0x01 ) != 0;
+    return true;
+}
+
+int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_simpleblock, mkv_frame_t *p_frame, bool *pb_key_picture, bool *pb_discardable_picture, int64_t *pi_duration )
 {
     pp_simpleblock = NULL;
     pp_block = NULL;
+    if( p_frame != NULL )
+        p_frame->p_block = NULL;
 
     *pb_key_picture         = true;
     *pb_discardable_picture = false;
@@ -1383,6 +1591,21 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
         if ( ep == NULL )
             return VLC_EGENERIC;
 
+        /* most blocks do not need libebml objects */
+        if( p_frame != NULL && pp_block == NULL && cluster != NULL &&
+            ep->GetLevel() == 2 && ep->IsTopPresent( cluster ) &&
+            BlockGetFrame( p_frame, pb_key_picture, pb_discardable_picture ) )
+        {
+#define idx p_indexes[i_index - 1]
+            if( i_index > 0 && idx.i_mk_time == -1 )
+            {
+                idx.i_mk_time     = p_frame->i_timecode / INT64_C(1000);
+                idx.b_key         = *pb_key_picture;
+            }
+#undef idx
+            return VLC_SUCCESS;
+        }
+
         if( pp_simpleblock != NULL || ((el = ep->Get()) == NULL && pp_block != NULL) )
         {
             /* Check blocks validity to protect againts broken files */
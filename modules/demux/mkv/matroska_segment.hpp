@@ -26,6 +26,7 @@
 #define _MATROSKA_SEGMENT_HPP_
 
 #include "mkv.hpp"
+#include "cluster_index.hpp"
 
 class EbmlParser;
 
@@ -110,6 +111,8 @@ public:
     int                     i_index;
     int                     i_index_max;
     mkv_index_t             *p_indexes;
+    cluster_index_c         *p_cluster_index; /* without cues */
+    size_t                  i_cluster_index_merged;
 
     /* info */
     char                    *psz_muxing_application;
@@ -137,7 +140,7 @@ public:
     bool PreloadFamily( const matroska_segment_c & segment );
     void InformationCreate();
     void Seek( mtime_t i_mk_date, mtime_t i_mk_time_offset, int64_t i_global_position );
-    int BlockGet( KaxBlock * &, KaxSimpleBlock * &, bool *, bool *, int64_t *);
+    int BlockGet( KaxBlock * &, KaxSimpleBlock * &, mkv_frame_t *, bool *, bool *, int64_t *);
 
     int BlockFindTrackIndex( size_t *pi_track,
                              const KaxBlock *, const KaxSimpleBlock * );
@@ -145,6 +148,8 @@ public:
     bool Select( mtime_t i_mk_start_time );
     void UnSelect();
 
+    bool IndexWait( mtime_t i_mk_date );
+
     static bool CompareSegmentUIDs( const matroska_segment_c * item_a, const matroska_segment_c * item_b );
 
 private:
@@ -160,7 +165,10 @@ private:
     void ParseTrackEntry( KaxTrackEntry *m );
     void ParseCluster( KaxCluster *cluster, bool b_update_start_time = true, ScopeMode read_fully = SCOPE_ALL_DATA );
     SimpleTag * ParseSimpleTags( KaxTagSimple *tag, int level = 50 );
+    bool BlockGetFrame( mkv_frame_t *, bool *, bool * );
     void IndexAppendCluster( KaxCluster *cluster );
+    void IndexLoad();
+    void IndexMerge( const std::vector<cluster_index_c::entry_t> & entries );
     int32_t TrackInit( mkv_track_t * p_tk );
     void ComputeTrackPriority();
     void EnsureDuration();
@@ -74,6 +74,11 @@ vlc_module_begin ()
             N_("Dummy Elements"),
             N_("Read and discard unknown EBML elements (not good for broken files)."), true );
 
+    add_bool( "mkv-index-cache", true,
+            N_("Cache the index of files without cues"),
+            N_("Save the index of the clusters of local files without cues, "
+               "built to seek in them, so as not to build it again."), true );
+
     add_shortcut( "mka", "mkv" )
 vlc_module_end ()
 
@@ -460,11 +465,15 @@ static void Seek( demux_t *p_demux, mtime_t i_mk_date, double f_percent, virtual
         return;
     }
 
+    /* without cues, the clusters indexed in background may be enough */
+    bool b_indexed = p_segment->IndexWait( i_mk_date >= 0 ? i_mk_date :
+                                int64_t( f_percent * p_sys->f_duration * 1000.0 ) );
+
     /* seek without index or without date */
-    if( f_percent >= 0 && (var_InheritBool( p_demux, "mkv-seek-percent" ) || !p_segment->b_cues || i_mk_date < 0 ))
+    if( f_percent >= 0 && (var_InheritBool( p_demux, "mkv-seek-percent" ) || !b_indexed || i_mk_date < 0 ))
     {
         i_mk_date = int64_t( f_percent * p_sys->f_duration * 1000.0 );
-        if( !p_segment->b_cues )
+        if( !b_indexed )
         {
             int64_t i_pos = int64_t( f_percent * stream_Size( p_demux->s ) );
 
@@ -490,16 +499,26 @@ static void Seek( demux_t *p_demux, mtime_t i_mk_date, double f_percent, virtual
 
 /* Needed by matroska_segment::Seek() and Seek */
 void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock,
-                  mtime_t i_pts, mtime_t i_duration, bool b_key_picture,
-                  bool b_discardable_picture )
+                  mkv_frame_t *frame, mtime_t i_pts, mtime_t i_duration,
+                  bool b_key_picture, bool b_discardable_picture )
 {
     demux_sys_t        *p_sys = p_demux->p_sys;
     matroska_segment_c *p_segment = p_sys->p_current_segment->CurrentSegment();
 
-    if( !p_segment ) return;
+    /* the frame read without libebml, if any */
+    block_t *p_frame = frame != NULL ? frame->p_block : NULL;
+
+    if( !p_segment )
+    {
+        if( p_frame )
+            block_Release( p_frame );
+        return;
+    }
 
     size_t          i_track;
-    if( p_segment->BlockFindTrackIndex( &i_track, block, simpleblock ) )
+    if( p_frame != NULL )
+        i_track = frame->i_track;
+    else if( p_segment->BlockFindTrackIndex( &i_track, block, simpleblock ) )
     {
         msg_Err( p_demux, "invalid track number" );
         return;
@@ -510,6 +529,8 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
     if( tk->fmt.i_cat != NAV_ES && tk->p_es == NULL )
     {
         msg_Err( p_demux, "unknown track number" );
+        if( p_frame )
+            block_Release( p_frame );
         return;
     }
 
@@ -525,6 +546,8 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
             tk->b_inited = false;
             if( tk->fmt.i_cat == VIDEO_ES || tk->fmt.i_cat == AUDIO_ES )
                 tk->i_last_dts = VLC_TS_INVALID;
+            if( p_frame )
+                block_Release( p_frame );
             return;
         }
     }
@@ -545,40 +568,51 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
     size_t frame_size = 0;
     size_t block_size = 0;
 
-    if( simpleblock != NULL )
+    if( p_frame != NULL )
+        block_size = p_frame->i_buffer;
+    else if( simpleblock != NULL )
         block_size = simpleblock->GetSize();
     else
         block_size = block->GetSize();
  
-    const unsigned int i_number_frames = block != NULL ? block->NumberFrames() :
+    const unsigned int i_number_frames = p_frame != NULL ? 1 :
+            block != NULL ? block->NumberFrames() :
             ( simpleblock != NULL ? simpleblock->NumberFrames() : 0 );
     for( unsigned int i_frame = 0; i_frame < i_number_frames; i_frame++ )
     {
         block_t *p_block;
         DataBuffer *data;
-        if( simpleblock != NULL )
+        if( p_frame != NULL )
         {
-            data = &simpleblock->GetBuffer(i_frame);
+            /* neither compressed nor WavPack, see BlockGetFrame() */
+            p_block = p_frame;
         }
         else
         {
-            data = &block->GetBuffer(i_frame);
-        }
-        frame_size += data->Size();
-        if( !data->Buffer() || data->Size() > frame_size || frame_size > block_size  )
-        {
-            msg_Warn( p_demux, "Cannot read frame (too long or no frame)" );
-            break;
-        }
+            if( simpleblock != NULL )
+            {
+                data = &simpleblock->GetBuffer(i_frame);
+            }
+            else
+            {
+                data = &block->GetBuffer(i_frame);
+            }
+            frame_size += data->Size();
+            if( !data->Buffer() || data->Size() > frame_size || frame_size > block_size  )
+            {
+                msg_Warn( p_demux, "Cannot read frame (too long or no frame)" );
+                break;
+            }
 
-        if( tk->i_compression_type == MATROSKA_COMPRESSION_HEADER &&
-            tk->p_compression_data != NULL &&
-            tk->i_encoding_scope & MATROSKA_ENCODING_SCOPE_ALL_FRAMES )
-            p_block = MemToBlock( data->Buffer(), data->Size(), tk->p_compression_data->GetSize() );
-        else if( unlikely( tk->fmt.i_codec == VLC_CODEC_WAVPACK ) )
-            p_block = packetize_wavpack(tk, data->Buffer(), data->Size());
-        else
-            p_block = MemToBlock( data->Buffer(), data->Size(), 0 );
+            if( tk->i_compression_type == MATROSKA_COMPRESSION_HEADER &&
+                tk->p_compression_data != NULL &&
+                tk->i_encoding_scope & MATROSKA_ENCODING_SCOPE_ALL_FRAMES )
+                p_block = MemToBlock( data->Buffer(), data->Size(), tk->p_compression_data->GetSize() );
+            else if( unlikely( tk->fmt.i_codec == VLC_CODEC_WAVPACK ) )
+                p_block = packetize_wavpack(tk, data->Buffer(), data->Size());
+            else
+                p_block = MemToBlock( data->Buffer(), data->Size(), 0 );
+        }
 
         if( p_block == NULL )
         {
@@ -722,10 +756,11 @@ static int Demux( demux_t *p_demux)
 
         KaxBlock *block;
         KaxSimpleBlock *simpleblock;
+        mkv_frame_t frame;
         int64_t i_block_duration = 0;
         bool b_key_picture;
         bool b_discardable_picture;
-        if( p_segment->BlockGet( block, simpleblock, &b_key_picture, &b_discardable_picture, &i_block_duration ) )
+        if( p_segment->BlockGet( block, simpleblock, &frame, &b_key_picture, &b_discardable_picture, &i_block_duration ) )
         {
             if ( p_vsegment->CurrentEdition() && p_vsegment->CurrentEdition()->b_ordered )
             {
@@ -750,7 +785,9 @@ static int Demux( demux_t *p_demux)
             }
         }
 
-        if( simpleblock != NULL )
+        if( frame.p_block != NULL )
+            p_sys->i_pts = (mtime_t)frame.i_timecode / INT64_C(1000);
+        else if( simpleblock != NULL )
             p_sys->i_pts = (mtime_t)simpleblock->GlobalTimecode() / INT64_C(1000);
         else
             p_sys->i_pts = (mtime_t)block->GlobalTimecode() / INT64_C(1000);
@@ -762,6 +799,8 @@ static int Demux( demux_t *p_demux)
             {
                 i_return = 1;
                 delete block;
+                if( frame.p_block != NULL )
+                    block_Release( frame.p_block );
                 break;
             }
         }
@@ -772,10 +811,12 @@ static int Demux( demux_t *p_demux)
         {
             /* nothing left to read in this ordered edition */
             delete block;
+            if( frame.p_block != NULL )
+                block_Release( frame.p_block );
             break;
         }
 
-        BlockDecode( p_demux, block, simpleblock, p_sys->i_pts, i_block_duration, b_key_picture, b_discardable_picture );
+        BlockDecode( p_demux, block, simpleblock, &frame, p_sys->i_pts, i_block_duration, b_key_picture, b_discardable_picture );
 
         delete block;
 
@@ -116,9 +116,17 @@ enum
 
 using namespace LIBMATROSKA_NAMESPACE;
 
+/* A SimpleBlock of a single frame, read without libebml */
+struct mkv_frame_t
+{
+    block_t *p_block;    /* the frame, NULL if not read that way */
+    size_t  i_track;
+    int64_t i_timecode;  /* global, like GlobalTimecode() */
+};
+
 void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock,
-                  mtime_t i_pts, mtime_t i_duration, bool b_key_picture,
-                  bool b_discardable_picture );
+                  mkv_frame_t *frame, mtime_t i_pts, mtime_t i_duration,
+                  bool b_key_picture, bool b_discardable_picture );
 
 class attachment_c
 {
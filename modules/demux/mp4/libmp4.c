@@ -184,6 +184,28 @@ int MP4_PeekBoxHeader( stream_t *p_stream, MP4_Box_t *p_box )
  * if p_box == NULL, box is invalid or failed, position undefined
  * on success, position is past read box or EOF
  *****************************************************************************/
+/* Per-sample tables, only read when the track is used */
+#define MP4_LAZY_MIN_SIZE (1 << 14)
+
+static bool MP4_BoxIsDeferrable( const MP4_Box_t *p_box,
+                                 const MP4_Box_t *p_father )
+{
+    if( p_father->i_type != ATOM_stbl || p_box->i_size < MP4_LAZY_MIN_SIZE )
+        return false;
+
+    switch( p_box->i_type )
+    {
+        case ATOM_stsz:
+        case ATOM_ctts:
+        case ATOM_stss:
+        case ATOM_stsh:
+        case ATOM_sdtp:
+            return true;
+        default:
+            return false;
+    }
+}
+
 static MP4_Box_t *MP4_ReadBoxRestricted( stream_t *p_stream, MP4_Box_t *p_father,
                                          const uint32_t onlytypes[], const uint32_t nottypes[] )
 {
@@ -231,7 +253,15 @@ static MP4_Box_t *MP4_ReadBoxRestricted( stream_t *p_stream, MP4_Box_t *p_father
     *p_box = peekbox;
 
     const uint64_t i_next = p_box->i_pos + p_box->i_size;
-    if( MP4_Box_Read_Specific( p_stream, p_box, p_father ) != VLC_SUCCESS )
+    if( p_father && ( p_father->e_flags & BOX_FLAG_LAZY ) )
+    {
+        p_box->e_flags |= BOX_FLAG_LAZY;
+        if( MP4_BoxIsDeferrable( p_box, p_father ) )
+            p_box->e_flags |= BOX_FLAG_UNLOADED; /* skipped below */
+    }
+
+    if( !( p_box->e_flags & BOX_FLAG_UNLOADED ) &&
+        MP4_Box_Read_Specific( p_stream, p_box, p_father ) != VLC_SUCCESS )
     {
         msg_Warn( p_stream, "Failed reading box %4.4s", (char*) &peekbox.i_type );
         MP4_BoxFree( p_box );
@@ -253,6 +283,26 @@ static MP4_Box_t *MP4_ReadBoxRestricted( stream_t *p_stream, MP4_Box_t *p_father
     return p_box;
 }
 
+int MP4_BoxLoad( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    if( !( p_box->e_flags & BOX_FLAG_UNLOADED ) )
+        return VLC_SUCCESS;
+
+    const int64_t i_pos = stream_Tell( p_stream );
+    if( i_pos < 0 || MP4_Seek( p_stream, p_box->i_pos ) )
+        return VLC_EGENERIC;
+
+    int i_ret = MP4_Box_Read_Specific( p_stream, p_box, p_box->p_father );
+    if( i_ret == VLC_SUCCESS )
+        p_box->e_flags &= ~BOX_FLAG_UNLOADED;
+    else
+        msg_Warn( p_stream, "Failed loading box %4.4s", (char*) &p_box->i_type );
+
+    if( MP4_Seek( p_stream, i_pos ) )
+        return VLC_EGENERIC;
+    return i_ret;
+}
+
 static inline MP4_Box_t *MP4_ReadNextBox( stream_t *p_stream, MP4_Box_t *p_father )
 {
     return MP4_ReadBoxRestricted( p_stream, p_father, NULL, NULL );
@@ -289,6 +339,19 @@ static int MP4_ReadBoxContainerChildrenIndexed( stream_t *p_stream,
                 break;
         }
 
+        /* stop before an excluded box, which is left to be read later */
+        if ( excludelist )
+        {
+            MP4_Box_t peekbox = { 0 };
+            if ( !MP4_PeekBoxHeader( p_stream, &peekbox ) )
+                break;
+            for( size_t i=0; excludelist[i]; i++ )
+            {
+                if( peekbox.i_type == excludelist[i] )
+                    return 1;
+            }
+        }
+
         uint32_t i_index = 0;
         if ( b_indexed )
         {
@@ -4136,7 +4199,7 @@ MP4_Box_t *MP4_BoxGetNextChunk( stream_t *s )
     else if( p_tmp_box->i_type == ATOM_ftyp )
     {
         free( p_tmp_box );
-        return MP4_BoxGetRoot( s );
+        return MP4_BoxGetRoot( s, false );
     }
     free( p_tmp_box );
 
@@ -4166,7 +4229,7 @@ MP4_Box_t *MP4_BoxGetNextChunk( stream_t *s )
  *  The first box is a virtual box "root" and is the father for all first
  *  level boxes for the file, a sort of virtual contener
  *****************************************************************************/
-MP4_Box_t *MP4_BoxGetRoot( stream_t *p_stream )
+MP4_Box_t *MP4_BoxGetRoot( stream_t *p_stream, bool b_lazy )
 {
     int i_result;
 
@@ -4176,6 +4239,8 @@ MP4_Box_t *MP4_BoxGetRoot( stream_t *p_stream )
 
     p_vroot->i_type = ATOM_root;
     p_vroot->i_shortsize = 1;
+    if( b_lazy )
+        p_vroot->e_flags = BOX_FLAG_LAZY;
     int64_t i_size = stream_Size( p_stream );
     if( i_size > 0 )
         p_vroot->i_size = i_size;
@@ -1500,7 +1500,9 @@ struct MP4_Box_s
     enum
     {
         BOX_FLAG_NONE = 0,
-        BOX_FLAG_INCOMPLETE,
+        BOX_FLAG_INCOMPLETE = 1,
+        BOX_FLAG_LAZY = 2,      /* large children may be left unloaded */
+        BOX_FLAG_UNLOADED = 4,  /* only indexed, see MP4_BoxLoad */
     }            e_flags;
 
     UUID_t       i_uuid;  /* Set if i_type == "uuid" */
@@ -1666,8 +1668,18 @@ MP4_Box_t *MP4_BoxGetNextChunk( stream_t * );
  *****************************************************************************
  *  The first box is a virtual box "root" and is the father for all first
  *  level boxes
+ *  If b_lazy is set, the large per-sample tables of the sample table boxes
+ *  are only indexed: they have BOX_FLAG_UNLOADED and no data until
+ *  MP4_BoxLoad is called. The stream must then be seekable.
  *****************************************************************************/
-MP4_Box_t *MP4_BoxGetRoot( stream_t * );
+MP4_Box_t *MP4_BoxGetRoot( stream_t *, bool b_lazy );
+
+/*****************************************************************************
+ * MP4_BoxLoad : Read the data of a box left unloaded by MP4_BoxGetRoot
+ *****************************************************************************
+ *  Does nothing if the box is already loaded. The stream position is kept.
+ *****************************************************************************/
+int MP4_BoxLoad( stream_t *, MP4_Box_t * );
 
 /*****************************************************************************
  * MP4_FreeBox : free memory allocated after read with MP4_ReadBox
@@ -35,6 +35,7 @@
 #include <vlc_demux.h>
 #include <vlc_charset.h>                           /* EnsureUTF8 */
 #include <vlc_input.h>
+#include <vlc_interrupt.h>
 #include <vlc_aout.h>
 #include <assert.h>
 #include <limits.h>
@@ -58,6 +59,8 @@ vlc_module_end ()
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
+#define MP4_READAHEAD_SIZE (1024 * 1024) /* per track, if fast seekable */
+
 static int   Demux   ( demux_t * );
 static int   DemuxRef( demux_t *p_demux ){ (void)p_demux; return 0;}
 static int   DemuxFrg( demux_t * );
@@ -65,6 +68,8 @@ static int   DemuxAsLeaf( demux_t * );
 static int   Seek    ( demux_t *, mtime_t );
 static int   Control ( demux_t *, int, va_list );
 
+typedef struct mp4_fragindex_t mp4_fragindex_t;
+
 struct demux_sys_t
 {
     MP4_Box_t    *p_root;      /* container for the whole file */
@@ -90,6 +95,7 @@ struct demux_sys_t
     bool            b_fragments_probed;
     mp4_fragment_t  moovfragment; /* moov */
     mp4_fragment_t *p_fragments;  /* known fragments (moof following moov) */
+    mp4_fragindex_t *p_fragindex; /* moof positions, indexed in background */
 
     struct
     {
@@ -118,8 +124,10 @@ static void MP4_TrackCreate ( demux_t *, mp4_track_t *, MP4_Box_t  *, bool, bool
 static int  MP4_SmoothTrackCreate( demux_t *, mp4_track_t *, const mp4_chunk_t *,
                                    const MP4_Box_t *, bool );
 static void MP4_TrackDestroy( demux_t *, mp4_track_t * );
+static int  TrackCreateSamplesIndex( demux_t *, mp4_track_t * );
 
 static block_t * MP4_Block_Read( demux_t *, const mp4_track_t *, int );
+static block_t * MP4_Block_ReadAt( demux_t *, mp4_track_t *, uint64_t, uint32_t );
 static void MP4_Block_Send( demux_t *, mp4_track_t *, block_t * );
 
 static int  MP4_TrackSelect ( demux_t *, mp4_track_t *, mtime_t );
@@ -149,6 +157,10 @@ static mp4_fragment_t *GetFragmentByTime( demux_t *p_demux, const mtime_t i_time
 
 static int LeafIndexGetMoofPosByTime( demux_t *p_demux, const mtime_t i_target_time,
                                       uint64_t *pi_pos, mtime_t *pi_mooftime );
+static mp4_fragindex_t *FragIndexNew( demux_t *p_demux );
+static void FragIndexDelete( mp4_fragindex_t *p_index );
+static int FragIndexGetMoofPosByTime( demux_t *p_demux, const mtime_t i_target_time,
+                                      uint64_t *pi_pos, mtime_t *pi_mooftime );
 static mtime_t LeafGetTrackFragmentTimeOffset( demux_t *p_demux, mp4_fragment_t *, unsigned int );
 static int LeafGetTrackAndChunkByMOOVPos( demux_t *p_demux, uint64_t *pi_pos,
                                       mp4_track_t **pp_tk, unsigned int *pi_chunk );
@@ -231,6 +243,18 @@ static MP4_Box_t * MP4_GetTrakByTrackID( MP4_Box_t *p_moov, const uint32_t i_id
     return p_trak;
 }
 
+/* Number of samples of the chunk in its i_index-th stts/ctts entry (the last
+ * entry may hold more, callers stop at the chunk sample count) */
+static inline uint32_t ChunkCountDTS( const mp4_chunk_t *ck, uint32_t i_index )
+{
+    return ck->p_sample_count_dts[i_index] - ( i_index ? 0 : ck->i_skip_dts );
+}
+
+static inline uint32_t ChunkCountPTS( const mp4_chunk_t *ck, uint32_t i_index )
+{
+    return ck->p_sample_count_pts[i_index] - ( i_index ? 0 : ck->i_skip_pts );
+}
+
 /* Return time in microsecond of a track */
 static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
 {
@@ -247,11 +271,11 @@ static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
 
     while( i_sample > 0 && i_index < p_chunk->i_entries_dts )
     {
-        if( i_sample > p_chunk->p_sample_count_dts[i_index] )
+        uint32_t i_count = ChunkCountDTS( p_chunk, i_index );
+        if( i_sample > i_count )
         {
-            i_dts += p_chunk->p_sample_count_dts[i_index] *
-                p_chunk->p_sample_delta_dts[i_index];
-            i_sample -= p_chunk->p_sample_count_dts[i_index];
+            i_dts += (int64_t)i_count * p_chunk->p_sample_delta_dts[i_index];
+            i_sample -= i_count;
             i_index++;
         }
         else
@@ -303,14 +327,15 @@ static inline bool MP4_TrackGetPTSDelta( demux_t *p_demux, mp4_track_t *p_track,
 
     for( i_index = 0; i_index < ck->i_entries_pts ; i_index++ )
     {
-        if( i_sample < ck->p_sample_count_pts[i_index] )
+        uint32_t i_count = ChunkCountPTS( ck, i_index );
+        if( i_sample < i_count )
         {
             *pi_delta = ck->p_sample_offset_pts[i_index] * CLOCK_FREQ /
                         (int64_t)p_track->i_timescale;
             return true;
         }
 
-        i_sample -= ck->p_sample_count_pts[i_index];
+        i_sample -= i_count;
     }
     return false;
 }
@@ -364,7 +389,8 @@ static int LoadInitFrag( demux_t *p_demux )
     else
     {
         /* Load all boxes ( except raw data ) */
-        if( ( p_sys->p_root = MP4_BoxGetRoot( p_demux->s ) ) == NULL )
+        if( ( p_sys->p_root = MP4_BoxGetRoot( p_demux->s,
+                                              p_sys->b_seekable ) ) == NULL )
         {
             goto LoadInitFragError;
         }
@@ -487,12 +513,8 @@ static block_t * MP4_EIA608_Convert( block_t * p_block )
     return p_newblock;
 }
 
-static block_t * MP4_Block_Read( demux_t *p_demux, const mp4_track_t *p_track, int i_size )
+static block_t * MP4_Block_Encap( const mp4_track_t *p_track, block_t *p_block )
 {
-    block_t *p_block = stream_Block( p_demux->s, i_size );
-    if ( !p_block )
-        return NULL;
-
     /* might have some encap */
     if( p_track->fmt.i_cat == SPU_ES )
     {
@@ -514,6 +536,73 @@ static block_t * MP4_Block_Read( demux_t *p_demux, const mp4_track_t *p_track, i
     return p_block;
 }
 
+static block_t * MP4_Block_Read( demux_t *p_demux, const mp4_track_t *p_track, int i_size )
+{
+    block_t *p_block = stream_Block( p_demux->s, i_size );
+    if ( !p_block )
+        return NULL;
+
+    return MP4_Block_Encap( p_track, p_block );
+}
+
+/* On fast seekable streams, samples are read in DTS order, seeking for each
+ * one between the chunks of the tracks. Each track rather reads ahead a
+ * window of data from its position, so that this costs a read per window
+ * instead of a seek and a read per sample. A sample found in the window of
+ * any track, as for adjacent chunks, is served from there.
+ * (other streams are read through the prefetch filter, which already keeps
+ * windows of data around the previous positions) */
+static block_t * MP4_Block_ReadAt( demux_t *p_demux, mp4_track_t *p_track,
+                                   uint64_t i_pos, uint32_t i_size )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const mp4_track_t *p_window = NULL;
+
+    for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+    {
+        const mp4_track_t *tk = &p_sys->track[i];
+        if( tk->p_readahead && i_pos >= tk->i_readahead_pos &&
+            i_pos - tk->i_readahead_pos <= tk->p_readahead->i_buffer &&
+            tk->p_readahead->i_buffer - ( i_pos - tk->i_readahead_pos ) >= i_size )
+        {
+            p_window = tk;
+            break;
+        }
+    }
+
+    if( !p_window )
+    {
+        if( p_track->p_readahead )
+        {
+            block_Release( p_track->p_readahead );
+            p_track->p_readahead = NULL;
+        }
+
+        uint64_t i_current_pos;
+        if( !MP4_stream_Tell( p_demux->s, &i_current_pos ) ||
+            ( i_current_pos != i_pos && stream_Seek( p_demux->s, i_pos ) ) )
+            return NULL;
+
+        block_t *p_data = stream_Block( p_demux->s,
+                                        __MAX( i_size, MP4_READAHEAD_SIZE ) );
+        if( !p_data )
+            return NULL;
+        p_track->p_readahead = p_data;
+        p_track->i_readahead_pos = i_pos;
+        p_window = p_track;
+    }
+
+    /* the last sample of a truncated file is sent as is */
+    size_t i_offset = i_pos - p_window->i_readahead_pos;
+    size_t i_copy = __MIN( i_size, p_window->p_readahead->i_buffer - i_offset );
+    block_t *p_block = block_Alloc( i_copy );
+    if( unlikely(p_block == NULL) )
+        return NULL;
+    memcpy( p_block->p_buffer, &p_window->p_readahead->p_buffer[i_offset], i_copy );
+
+    return MP4_Block_Encap( p_track, p_block );
+}
+
 static void MP4_Block_Send( demux_t *p_demux, mp4_track_t *p_track, block_t *p_block )
 {
     if ( p_track->b_chans_reorder && aout_BitsPerSample( p_track->fmt.i_codec ) )
@@ -961,6 +1050,12 @@ static int Open( vlc_object_t * p_this )
     /* */
     LoadChapter( p_demux );
 
+    /* The fragments are otherwise only known once read: index them in
+     * background, so that seeking does not need to read them all first */
+    if( p_demux->pf_demux == DemuxAsLeaf && p_sys->b_seekable &&
+        !p_sys->b_fragments_probed )
+        p_sys->p_fragindex = FragIndexNew( p_demux );
+
     p_sys->asfpacketsys.p_demux = p_demux;
     p_sys->asfpacketsys.pi_preroll = &p_sys->i_preroll;
     p_sys->asfpacketsys.pi_preroll_start = &p_sys->i_preroll_start;
@@ -1089,16 +1184,6 @@ static int Demux( demux_t *p_demux )
         msg_Dbg( p_demux, "Could not select track by data position" );
         goto end;
     }
-    else if ( p_sys->b_seekmode )
-    {
-        if( stream_Seek( p_demux->s, i_candidate_pos ) )
-        {
-            msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)",
-                      tk->i_track_ID );
-            MP4_TrackUnselect( p_demux, tk );
-            goto end;
-        }
-    }
 
 #if 0
     msg_Dbg( p_demux, "tk(%i)=%"PRId64" mv=%"PRId64" pos=%"PRIu64, tk->i_track_ID,
@@ -1112,31 +1197,41 @@ static int Demux( demux_t *p_demux )
     {
         block_t *p_block;
         int64_t i_delta;
-        uint64_t i_current_pos;
 
-        /* go,go go ! */
-        if ( !MP4_stream_Tell( p_demux->s, &i_current_pos ) )
-            goto end;
-
-        if( i_current_pos != i_candidate_pos )
+        if ( p_sys->b_fastseekable )
         {
-            if( stream_Seek( p_demux->s, i_candidate_pos ) )
-            {
-                msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)"
-                          ": Failed to seek to %"PRIu64,
-                          tk->i_track_ID, i_candidate_pos );
-                MP4_TrackUnselect( p_demux, tk );
+            /* go,go go ! */
+            p_block = MP4_Block_ReadAt( p_demux, tk, i_candidate_pos,
+                                        i_samplessize );
+        }
+        else
+        {
+            uint64_t i_current_pos;
+
+            if ( !MP4_stream_Tell( p_demux->s, &i_current_pos ) )
                 goto end;
+
+            if( i_current_pos != i_candidate_pos )
+            {
+                if( stream_Seek( p_demux->s, i_candidate_pos ) )
+                {
+                    msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)"
+                              ": Failed to seek to %"PRIu64,
+                              tk->i_track_ID, i_candidate_pos );
+                    MP4_TrackUnselect( p_demux, tk );
+                    goto end;
+                }
             }
-            i_current_pos = i_candidate_pos;
+
+            /* now read pes */
+            p_block = MP4_Block_Read( p_demux, tk, i_samplessize );
         }
 
-        /* now read pes */
-        if( !(p_block = MP4_Block_Read( p_demux, tk, i_samplessize )) )
+        if( !p_block )
         {
             msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)"
                       ": Failed to read %d bytes sample at %"PRIu64,
-                      tk->i_track_ID, i_samplessize, i_current_pos );
+                      tk->i_track_ID, i_samplessize, i_candidate_pos );
             MP4_TrackUnselect( p_demux, tk );
             goto end;
         }
@@ -1220,6 +1315,9 @@ static int Seek( demux_t *p_demux, mtime_t i_date )
     for( i_track = 0; i_track < p_sys->i_tracks; i_track++ )
     {
         mp4_track_t *tk = &p_sys->track[i_track];
+        /* the unselected tracks will seek once selected by Demux */
+        if( !tk->b_selected )
+            continue;
         MP4_TrackSeek( p_demux, tk, i_date );
     }
     MP4_UpdateSeekpoint( p_demux );
@@ -1298,7 +1396,8 @@ static int LeafSeekToTime( demux_t *p_demux, mtime_t i_nztime )
     {
         mtime_t i_mooftime;
         msg_Dbg( p_demux, "seek can't find matching fragment for %"PRId64", trying index", i_nztime );
-        if ( LeafIndexGetMoofPosByTime( p_demux, i_nztime, &i64, &i_mooftime ) == VLC_SUCCESS )
+        if ( LeafIndexGetMoofPosByTime( p_demux, i_nztime, &i64, &i_mooftime ) == VLC_SUCCESS ||
+             FragIndexGetMoofPosByTime( p_demux, i_nztime, &i64, &i_mooftime ) == VLC_SUCCESS )
         {
             msg_Dbg( p_demux, "seek trying to go to unknown but indexed fragment at %"PRId64, i64 );
             if( stream_Seek( p_demux->s, i64 ) )
@@ -1311,9 +1410,9 @@ static int LeafSeekToTime( demux_t *p_demux, mtime_t i_nztime )
             p_sys->context.p_fragment = NULL;
             for( unsigned int i_track = 0; i_track < p_sys->i_tracks; i_track++ )
             {
-                p_sys->track[i_track].i_time = i_mooftime / CLOCK_FREQ * p_sys->track[i_track].i_timescale;
+                p_sys->track[i_track].i_time = i_mooftime * p_sys->track[i_track].i_timescale / CLOCK_FREQ;
             }
-            p_sys->i_time = i_mooftime / CLOCK_FREQ * p_sys->i_timescale;
+            p_sys->i_time = i_mooftime * p_sys->i_timescale / CLOCK_FREQ;
             p_sys->i_pcr  = VLC_TS_INVALID;
         }
         else
@@ -1730,6 +1829,10 @@ static void Close ( vlc_object_t * p_this )
 
     msg_Dbg( p_demux, "freeing all memory" );
 
+    /* the indexer reads the moov */
+    if( p_sys->p_fragindex )
+        FragIndexDelete( p_sys->p_fragindex );
+
     MP4_BoxFree( p_sys->p_root );
     for( i_track = 0; i_track < p_sys->i_tracks; i_track++ )
     {
@@ -1778,6 +1881,9 @@ static void LoadChapterApple( demux_t  *p_demux, mp4_track_t *tk )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    if( !tk->b_indexed && TrackCreateSamplesIndex( p_demux, tk ) )
+        return;
+
     for( tk->i_sample = 0; tk->i_sample < tk->i_sample_count; tk->i_sample++ )
     {
         const int64_t i_dts = MP4_TrackGetDTS( p_demux, tk );
@@ -1857,12 +1963,11 @@ static void LoadChapter( demux_t  *p_demux )
 static bool MP4_TrackIsInterleaved( const mp4_track_t *p_track )
 {
     const MP4_Box_t *p_stsc = MP4_BoxGet( p_track->p_stbl, "stsc" );
-    const MP4_Box_t *p_stsz = MP4_BoxGet( p_track->p_stbl, "stsz" );
-    if( p_stsc && BOXDATA(p_stsc) && p_stsz && BOXDATA(p_stsz) )
+    if( p_stsc && BOXDATA(p_stsc) )
     {
         if( BOXDATA(p_stsc)->i_entry_count == 1 &&
-            BOXDATA(p_stsz)->i_sample_count > 1 &&
-            BOXDATA(p_stsc)->i_samples_per_chunk[0] == BOXDATA(p_stsz)->i_sample_count )
+            p_track->i_sample_count > 1 &&
+            BOXDATA(p_stsc)->i_samples_per_chunk[0] == p_track->i_sample_count )
             return false;
     }
 
@@ -1964,54 +2069,142 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
     return VLC_SUCCESS;
 }
 
-static int xTTS_CountEntries( demux_t *p_demux, uint32_t *pi_entry /* out */,
-                              const uint32_t i_index,
-                              uint32_t i_index_samples_left,
-                              uint32_t i_sample_count,
-                              const uint32_t *pi_index_sample_count,
-                              const uint32_t i_table_count )
+/* Points the chunks into a stts (b_dts) or ctts table instead of copying
+ * it, and returns the total duration for a stts table */
+static uint64_t TrackMapTimeTable( demux_t *p_demux,
+                                   mp4_track_t *p_demux_track, bool b_dts,
+                                   uint32_t *pi_sample_count,
+                                   int32_t *pi_sample_value,
+                                   uint32_t i_entry_count )
 {
-    uint32_t i_array_offset;
-    while( i_sample_count > 0 )
+    uint64_t i_next_dts = 0;
+    uint32_t i_index = 0;
+    uint32_t i_used = 0; /* samples of entry i_index in previous chunks */
+
+    for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
     {
-        if ( likely((UINT32_MAX - i_index) >= *pi_entry) )
-            i_array_offset = i_index + *pi_entry;
-        else
-            return VLC_EGENERIC;
+        mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
+        const uint32_t i_first = i_index, i_skip = i_used;
+        uint32_t i_left = ck->i_sample_count;
+        uint32_t i_entries = 0;
 
-        if ( i_array_offset >= i_table_count )
+        if( b_dts )
         {
-            msg_Err( p_demux, "invalid index counting total samples %u %u", i_array_offset,  i_table_count );
-            return VLC_ENOVAR;
+            ck->i_first_dts = i_next_dts;
+            ck->i_last_dts  = i_next_dts;
         }
 
-        if ( i_index_samples_left )
+        while( i_left > 0 && i_index < i_entry_count )
         {
-            if ( i_index_samples_left > i_sample_count )
+            uint32_t i_avail = pi_sample_count[i_index] - i_used;
+            uint32_t i_count = __MIN( i_avail, i_left );
+
+            if( b_dts )
             {
-                i_index_samples_left -= i_sample_count;
-                i_sample_count = 0;
-                *pi_entry +=1; /* No samples left, go copy */
-                break;
+                if( i_count )
+                    ck->i_last_dts = i_next_dts;
+                i_next_dts += (uint64_t)i_count * (uint32_t)pi_sample_value[i_index];
             }
-            else
+            i_left -= i_count;
+            i_entries++;
+
+            if( i_count == i_avail )
             {
-                i_sample_count -= i_index_samples_left;
-                i_index_samples_left = 0;
-                *pi_entry += 1;
-                continue;
+                i_index++;
+                i_used = 0;
             }
+            else /* the entry continues in the next chunk */
+                i_used += i_count;
+        }
+
+        if( i_left > 0 )
+        {
+            msg_Err( p_demux, "invalid index counting total samples %u %u",
+                     i_index, i_entry_count );
+        }
+
+        if( b_dts )
+        {
+            ck->i_entries_dts = i_entries;
+            ck->i_skip_dts = i_skip;
+            ck->p_sample_count_dts = &pi_sample_count[i_first];
+            ck->p_sample_delta_dts = (uint32_t *)&pi_sample_value[i_first];
         }
         else
         {
-            i_sample_count -= __MIN( i_sample_count, pi_index_sample_count[i_array_offset] );
-            *pi_entry += 1;
+            ck->i_entries_pts = i_entries;
+            ck->i_skip_pts = i_skip;
+            ck->p_sample_count_pts = &pi_sample_count[i_first];
+            ck->p_sample_offset_pts = &pi_sample_value[i_first];
         }
     }
 
+    return i_next_dts;
+}
+
+/* now map the chunks on the decoding times, the sizes and the rest
+ * will be filled by TrackCreateSamplesIndex */
+static int TrackCreateDTSIndex( demux_t *p_demux,
+                                mp4_track_t *p_demux_track )
+{
+    MP4_Box_t *p_box;
+
+    /* Use stts table to create a sample number -> dts table.
+     * XXX: if we don't want to waste too much memory, we can't expand
+     *  the box! so each chunk points to an "extract" of this table
+     *  for fast research (problem with raw stream where a sample is sometime
+     *  just channels*bits_per_sample/8 */
+
+    mtime_t i_next_dts = 0;
+    /* Find stts
+     *  Gives mapping between sample and decoding time
+     */
+    p_box = MP4_BoxGet( p_demux_track->p_stbl, "stts" );
+    if( !p_box )
+    {
+        msg_Warn( p_demux, "cannot find STTS box" );
+        return VLC_EGENERIC;
+    }
+    else
+    {
+        MP4_Box_data_stts_t *stts = p_box->data.p_stts;
+
+        msg_Warn( p_demux, "STTS table of %"PRIu32" entries", stts->i_entry_count );
+
+        i_next_dts = TrackMapTimeTable( p_demux, p_demux_track, true,
+                                        stts->pi_sample_count,
+                                        stts->pi_sample_delta,
+                                        stts->i_entry_count );
+    }
+
+    /* until the stsz table is read */
+    if( p_demux_track->i_chunk_count )
+    {
+        const mp4_chunk_t *lastchunk =
+            &p_demux_track->chunk[p_demux_track->i_chunk_count - 1];
+        p_demux_track->i_sample_count = lastchunk->i_sample_first +
+                                        lastchunk->i_sample_count;
+    }
+
+    msg_Dbg( p_demux, "track[Id 0x%x] read %"PRIu32" samples length:%"PRId64"s",
+             p_demux_track->i_track_ID, p_demux_track->i_sample_count,
+             i_next_dts / p_demux_track->i_timescale );
+
     return VLC_SUCCESS;
 }
 
+/* Reads a table of the sample table box, if it was left unloaded */
+static MP4_Box_t *TrackGetTable( demux_t *p_demux, const mp4_track_t *p_track,
+                                 const char *psz_name )
+{
+    MP4_Box_t *p_box = MP4_BoxGet( p_track->p_stbl, psz_name );
+    if( p_box && MP4_BoxLoad( p_demux->s, p_box ) )
+        return NULL;
+    return p_box;
+}
+
+/* This maps the per-sample tables, which may be left unloaded until the
+ * track gets selected */
 static int TrackCreateSamplesIndex( demux_t *p_demux,
                                     mp4_track_t *p_demux_track )
 {
@@ -2025,8 +2218,8 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     /* Find stsz
      *  Gives the sample size for each samples. There is also a stz2 table
      *  (compressed form) that we need to implement TODO */
-    p_box = MP4_BoxGet( p_demux_track->p_stbl, "stsz" );
-    if( !p_box )
+    p_box = TrackGetTable( p_demux, p_demux_track, "stsz" );
+    if( !p_box || !p_box->data.p_stsz )
     {
         /* FIXME and stz2 */
         msg_Warn( p_demux, "cannot find STSZ box" );
@@ -2046,16 +2239,7 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     {
         /* 2: each sample can have a different size */
         p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
-
-        for( uint32_t i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
+        p_demux_track->p_sample_size = stsz->i_entry_size;
     }
 
     if ( p_demux_track->i_chunk_count )
@@ -2086,221 +2270,22 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
             p_sys->moovfragment.i_chunk_range_max_offset = i_total_size;
     }
 
-    /* Use stts table to create a sample number -> dts table.
-     * XXX: if we don't want to waste too much memory, we can't expand
-     *  the box! so each chunk will contain an "extract" of this table
-     *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
-
-     /* FIXME: refactor STTS & CTTS, STTS having now only few extra lines and
-      *        differing in 2/2 fields and 1 signedness */
-
-    mtime_t i_next_dts = 0;
-    /* Find stts
-     *  Gives mapping between sample and decoding time
-     */
-    p_box = MP4_BoxGet( p_demux_track->p_stbl, "stts" );
-    if( !p_box )
-    {
-        msg_Warn( p_demux, "cannot find STTS box" );
-        return VLC_EGENERIC;
-    }
-    else
-    {
-        MP4_Box_data_stts_t *stts = p_box->data.p_stts;
-
-        msg_Warn( p_demux, "STTS table of %"PRIu32" entries", stts->i_entry_count );
-
-        /* Create sample -> dts table per chunk */
-        uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
-
-        for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
-        {
-            mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
-
-            /* save first dts */
-            ck->i_first_dts = i_next_dts;
-            ck->i_last_dts  = i_next_dts;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            ck->i_entries_dts = 0;
-
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_dts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           stts->pi_sample_count,
-                                           stts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            ck->p_sample_delta_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
-            {
-                free( ck->p_sample_count_dts );
-                free( ck->p_sample_delta_dts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_dts );
-                ck->i_entries_dts = 0;
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < ck->i_entries_dts; i++ )
-            {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        if ( i_sample_count ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        if ( i_current_index_samples_left ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = i_current_index_samples_left;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( stts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        if ( i_sample_count ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_current_index_samples_left = stts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        if ( stts->pi_sample_count[i_index] ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = stts->pi_sample_count[i_index];
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_sample_count -= stts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
-            }
-        }
-    }
-
-
     /* Find ctts
      *  Gives the delta between decoding time (dts) and composition table (pts)
      */
-    p_box = MP4_BoxGet( p_demux_track->p_stbl, "ctts" );
+    p_box = TrackGetTable( p_demux, p_demux_track, "ctts" );
     if( p_box && p_box->data.p_ctts )
     {
         MP4_Box_data_ctts_t *ctts = p_box->data.p_ctts;
 
         msg_Warn( p_demux, "CTTS table of %"PRIu32" entries", ctts->i_entry_count );
 
-        /* Create pts-dts table per chunk */
-        uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
-
-        for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
-        {
-            mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_offset_pts and p_sample_count_pts */
-            ck->i_entries_pts = 0;
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_pts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           ctts->pi_sample_count,
-                                           ctts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_pts = calloc( ck->i_entries_pts, sizeof( uint32_t ) );
-            ck->p_sample_offset_pts = calloc( ck->i_entries_pts, sizeof( int32_t ) );
-            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
-            {
-                free( ck->p_sample_count_pts );
-                free( ck->p_sample_offset_pts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_pts );
-                ck->i_entries_pts = 0;
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < ck->i_entries_pts; i++ )
-            {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = i_current_index_samples_left;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( ctts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_current_index_samples_left = ctts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = ctts->pi_sample_count[i_index];
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_sample_count -= ctts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
-
-            }
-        }
+        TrackMapTimeTable( p_demux, p_demux_track, false,
+                           ctts->pi_sample_count, ctts->pi_sample_offset,
+                           ctts->i_entry_count );
     }
 
-    msg_Dbg( p_demux, "track[Id 0x%x] read %"PRIu32" samples length:%"PRId64"s",
-             p_demux_track->i_track_ID, p_demux_track->i_sample_count,
-             i_next_dts / p_demux_track->i_timescale );
+    p_demux_track->b_indexed = true;
 
     return VLC_SUCCESS;
 }
@@ -2509,49 +2494,38 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         i_start = i_start * p_track->i_timescale / CLOCK_FREQ;
     }
 
-    /* we start from sample 0/chunk 0, hope it won't take too much time */
-    /* *** find good chunk *** */
-    for( i_chunk = 0; ; i_chunk++ )
+    /* *** find good chunk: the last one starting before i_start *** */
+    unsigned int i_low = 0, i_high = p_track->i_chunk_count - 1;
+    while( i_low < i_high )
     {
-        if( i_chunk + 1 >= p_track->i_chunk_count )
-        {
-            /* at the end and can't check if i_start in this chunk,
-               it will be check while searching i_sample */
-            i_chunk = p_track->i_chunk_count - 1;
-            break;
-        }
-
-        if( (uint64_t)i_start >= p_track->chunk[i_chunk].i_first_dts &&
-            (uint64_t)i_start <  p_track->chunk[i_chunk + 1].i_first_dts )
-        {
-            break;
-        }
+        unsigned int i_mid = i_low + ( i_high - i_low + 1 ) / 2;
+        if( p_track->chunk[i_mid].i_first_dts <= (uint64_t)i_start )
+            i_low = i_mid;
+        else
+            i_high = i_mid - 1;
     }
+    i_chunk = i_low;
 
     /* *** find sample in the chunk *** */
-    i_sample = p_track->chunk[i_chunk].i_sample_first;
-    i_dts    = p_track->chunk[i_chunk].i_first_dts;
-    for( i_index = 0; i_sample < p_track->chunk[i_chunk].i_sample_count; )
+    const mp4_chunk_t *ck = &p_track->chunk[i_chunk];
+    uint32_t i_left = ck->i_sample_count;
+    i_sample = ck->i_sample_first;
+    i_dts    = ck->i_first_dts;
+    for( i_index = 0; i_index < (int)ck->i_entries_dts && i_left > 0; i_index++ )
     {
-        if( i_dts +
-            p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-            p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
-        {
-            i_dts    +=
-                p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+        uint32_t i_count = __MIN( ChunkCountDTS( ck, i_index ), i_left );
+        uint32_t i_delta = ck->p_sample_delta_dts[i_index];
 
-            i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
-            i_index++;
+        if( i_dts + (uint64_t)i_count * i_delta < (uint64_t)i_start )
+        {
+            i_dts    += (uint64_t)i_count * i_delta;
+            i_sample += i_count;
+            i_left   -= i_count;
         }
         else
         {
-            if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
-            {
-                break;
-            }
-            i_sample += ( i_start - i_dts ) /
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+            if( i_delta > 0 && (uint64_t)i_start > i_dts )
+                i_sample += ( i_start - i_dts ) / i_delta;
             break;
         }
     }
@@ -2566,36 +2540,44 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
 
 
     /* *** Try to find nearest sync points *** */
-    if( ( p_box_stss = MP4_BoxGet( p_track->p_stbl, "stss" ) ) )
+    if( ( p_box_stss = TrackGetTable( p_demux, p_track, "stss" ) ) &&
+        p_box_stss->data.p_stss )
     {
         MP4_Box_data_stss_t *p_stss = p_box_stss->data.p_stss;
         msg_Dbg( p_demux, "track[Id 0x%x] using Sync Sample Box (stss)",
                  p_track->i_track_ID );
-        for( unsigned i_index = 0; i_index < p_stss->i_entry_count; i_index++ )
+        if( p_stss->i_entry_count > 0 )
         {
-            if( i_index >= p_stss->i_entry_count - 1 ||
-                i_sample < p_stss->i_sample_number[i_index+1] )
+            /* last sync sample before i_sample, or the first one */
+            i_low = 0;
+            i_high = p_stss->i_entry_count - 1;
+            while( i_low < i_high )
             {
-                unsigned i_sync_sample = p_stss->i_sample_number[i_index];
-                msg_Dbg( p_demux, "stss gives %d --> %d (sample number)",
-                         i_sample, i_sync_sample );
+                unsigned int i_mid = i_low + ( i_high - i_low + 1 ) / 2;
+                if( p_stss->i_sample_number[i_mid] <= i_sample )
+                    i_low = i_mid;
+                else
+                    i_high = i_mid - 1;
+            }
 
-                if( i_sync_sample <= i_sample )
-                {
-                    while( i_chunk > 0 &&
-                           i_sync_sample < p_track->chunk[i_chunk].i_sample_first )
-                        i_chunk--;
-                }
+            unsigned i_sync_sample = p_stss->i_sample_number[i_low];
+            msg_Dbg( p_demux, "stss gives %d --> %d (sample number)",
+                     i_sample, i_sync_sample );
+
+            /* first chunk ending after the sync sample */
+            i_low = 0;
+            i_high = p_track->i_chunk_count - 1;
+            while( i_low < i_high )
+            {
+                unsigned int i_mid = i_low + ( i_high - i_low ) / 2;
+                if( i_sync_sample < p_track->chunk[i_mid].i_sample_first +
+                                    p_track->chunk[i_mid].i_sample_count )
+                    i_high = i_mid;
                 else
-                {
-                    while( i_chunk < p_track->i_chunk_count - 1 &&
-                           i_sync_sample >= p_track->chunk[i_chunk].i_sample_first +
-                                            p_track->chunk[i_chunk].i_sample_count )
-                        i_chunk++;
-                }
-                i_sample = i_sync_sample;
-                break;
+                    i_low = i_mid + 1;
             }
+            i_chunk = i_low;
+            i_sample = i_sync_sample;
         }
     }
     else
@@ -2877,9 +2859,14 @@ static void MP4_TrackCreate( demux_t *p_demux, mp4_track_t *p_track,
         }
     }
 
-    /* Create chunk index table and sample index table */
+    /* Create chunk index table and sample index table, the latter only
+     * once selected if its tables were left unloaded */
+    const MP4_Box_t *p_stsz = MP4_BoxGet( p_track->p_stbl, "stsz" );
+    const bool b_lazy = !p_sys->b_fragmented && p_stsz &&
+                        ( p_stsz->e_flags & BOX_FLAG_UNLOADED );
     if( TrackCreateChunksIndex( p_demux,p_track  ) ||
-        TrackCreateSamplesIndex( p_demux, p_track ) )
+        TrackCreateDTSIndex( p_demux, p_track ) ||
+        ( !b_lazy && TrackCreateSamplesIndex( p_demux, p_track ) ) )
     {
         msg_Err( p_demux, "cannot create chunks index" );
         return; /* cannot create chunks index */
@@ -2996,11 +2983,7 @@ static void MP4_TrackDestroy( demux_t *p_demux, mp4_track_t *p_track )
     if( p_track->p_es )
         es_out_Del( p_demux->out, p_track->p_es );
 
-    if( p_track->chunk )
-    {
-        for( unsigned int i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
-            DestroyChunk( &p_track->chunk[i_chunk] );
-    }
+    /* the chunks of the moov only point into its sample tables */
     free( p_track->chunk );
 
     if( p_track->cchunk )
@@ -3010,11 +2993,11 @@ static void MP4_TrackDestroy( demux_t *p_demux, mp4_track_t *p_track )
         free( p_track->cchunk );
     }
 
-    if( !p_track->i_sample_size )
-        free( p_track->p_sample_size );
-
     if ( p_track->asfinfo.p_frame )
         block_ChainRelease( p_track->asfinfo.p_frame );
+
+    if( p_track->p_readahead )
+        block_Release( p_track->p_readahead );
 }
 
 static int MP4_TrackSelect( demux_t *p_demux, mp4_track_t *p_track,
@@ -3055,6 +3038,12 @@ static void MP4_TrackUnselect( demux_t *p_demux, mp4_track_t *p_track )
     }
 
     p_track->b_selected = false;
+
+    if( p_track->p_readahead )
+    {
+        block_Release( p_track->p_readahead );
+        p_track->p_readahead = NULL;
+    }
 }
 
 static int MP4_TrackSeek( demux_t *p_demux, mp4_track_t *p_track,
@@ -3066,6 +3055,14 @@ static int MP4_TrackSeek( demux_t *p_demux, mp4_track_t *p_track,
     if( !p_track->b_ok || p_track->b_chapter )
         return VLC_EGENERIC;
 
+    if( !p_track->b_indexed && TrackCreateSamplesIndex( p_demux, p_track ) )
+    {
+        msg_Err( p_demux, "cannot create samples index for track[Id 0x%x]",
+                 p_track->i_track_ID );
+        p_track->b_ok = false;
+        return VLC_EGENERIC;
+    }
+
     p_track->b_selected = false;
 
     if( TrackTimeToSampleChunk( p_demux, p_track, i_start,
@@ -4771,13 +4768,13 @@ static inline mtime_t LeafGetMOOVTimeInChunk( const mp4_chunk_t *p_chunk, uint32
     mtime_t i_time = 0;
     uint32_t i_index = 0;
 
-    while( i_sample > 0 )
+    while( i_sample > 0 && i_index < p_chunk->i_entries_dts )
     {
-        if( i_sample > p_chunk->p_sample_count_dts[i_index] )
+        uint32_t i_count = ChunkCountDTS( p_chunk, i_index );
+        if( i_sample > i_count )
         {
-            i_time += p_chunk->p_sample_count_dts[i_index] *
-                p_chunk->p_sample_delta_dts[i_index];
-            i_sample -= p_chunk->p_sample_count_dts[i_index];
+            i_time += (mtime_t)i_count * p_chunk->p_sample_delta_dts[i_index];
+            i_sample -= i_count;
             i_index++;
         }
         else
@@ -5074,6 +5071,311 @@ static int LeafIndexGetMoofPosByTime( demux_t *p_demux, const mtime_t i_target_t
     return VLC_EGENERIC;
 }
 
+/*
+ * Fragments index
+ *
+ * Without a mfra, the fragments are only known as they are read, and a seek
+ * to an unread one would need to read all the previous moof first. When a
+ * sidx describes the whole file, it gives the index at once. Otherwise, the
+ * moof are read in background from another stream, and a seek waits until
+ * the index reaches the requested time.
+ */
+typedef struct
+{
+    uint64_t i_pos;  /* of the moof */
+    uint64_t i_time; /* in movie timescale, summing the fragments durations */
+} mp4_fragindex_entry_t;
+
+struct mp4_fragindex_t
+{
+    demux_t         *p_demux;
+    vlc_thread_t    thread;
+    vlc_interrupt_t *p_interrupt;
+    char            *psz_url;
+    uint64_t        i_start;    /* position of the first fragment */
+    bool            b_thread;
+
+    vlc_mutex_t     lock;
+    vlc_cond_t      wait;       /* an entry was added, or the index is done */
+    mp4_fragindex_entry_t *p_entries;
+    unsigned        i_entries;
+    unsigned        i_alloc;
+    uint64_t        i_time;     /* end of the indexed fragments */
+    bool            b_done;
+    bool            b_abort;
+};
+
+/* Appends a fragment, locked */
+static bool FragIndexAdd( mp4_fragindex_t *p_index, uint64_t i_pos,
+                          uint64_t i_duration )
+{
+    if( p_index->i_entries == p_index->i_alloc )
+    {
+        unsigned i_alloc = p_index->i_alloc ? p_index->i_alloc * 2 : 64;
+        mp4_fragindex_entry_t *p_entries =
+            realloc( p_index->p_entries, i_alloc * sizeof(*p_entries) );
+        if( unlikely(p_entries == NULL) )
+            return false;
+        p_index->p_entries = p_entries;
+        p_index->i_alloc = i_alloc;
+    }
+
+    p_index->p_entries[p_index->i_entries].i_pos = i_pos;
+    p_index->p_entries[p_index->i_entries].i_time = p_index->i_time;
+    p_index->i_entries++;
+    p_index->i_time += i_duration;
+    return true;
+}
+
+/* Indexes the fragments from a sidx referencing the media only */
+static bool FragIndexLoadSidx( demux_t *p_demux, mp4_fragindex_t *p_index )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const MP4_Box_t *p_sidx = MP4_BoxGet( p_sys->p_root, "/sidx" );
+    if( !p_sidx || !BOXDATA(p_sidx) || !BOXDATA(p_sidx)->i_timescale ||
+        MP4_BoxCount( p_sys->p_root, "/sidx" ) != 1 )
+        return false;
+
+    const MP4_Box_data_sidx_t *p_data = BOXDATA(p_sidx);
+    for( uint16_t i = 0; i < p_data->i_reference_count; i++ )
+    {
+        if( p_data->p_items[i].b_reference_type ) /* points to another sidx */
+            return false;
+    }
+
+    uint64_t i_pos = p_sidx->i_pos + p_sidx->i_size + p_data->i_first_offset;
+    for( uint16_t i = 0; i < p_data->i_reference_count; i++ )
+    {
+        if( !FragIndexAdd( p_index, i_pos, p_data->p_items[i].i_subsegment_duration *
+                                           p_sys->i_timescale / p_data->i_timescale ) )
+            return false;
+        i_pos += p_data->p_items[i].i_referenced_size;
+    }
+
+    msg_Dbg( p_demux, "indexed %u fragments from sidx", p_index->i_entries );
+    return true;
+}
+
+/* Returns the longest track duration in a moof, in movie timescale */
+static uint64_t FragIndexGetMoofDuration( demux_t *p_demux, const MP4_Box_t *p_moof )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    MP4_Box_t *p_moov = p_sys->moovfragment.p_moox;
+    uint64_t i_max_duration = 0;
+
+    for( const MP4_Box_t *p_traf = MP4_BoxGet( p_moof, "traf" );
+         p_traf; p_traf = p_traf->p_next )
+    {
+        const MP4_Box_t *p_tfhd = MP4_BoxGet( p_traf, "tfhd" );
+        if( p_traf->i_type != ATOM_traf || !p_tfhd || !BOXDATA(p_tfhd) )
+            continue;
+
+        const MP4_Box_t *p_trak = MP4_GetTrakByTrackID( p_moov, BOXDATA(p_tfhd)->i_track_ID );
+        const MP4_Box_t *p_mdhd = p_trak ? MP4_BoxGet( p_trak, "mdia/mdhd" ) : NULL;
+        if( !p_mdhd || !BOXDATA(p_mdhd)->i_timescale )
+            continue;
+
+        uint32_t i_default_duration = 0;
+        if( BOXDATA(p_tfhd)->i_flags & MP4_TFHD_DFLT_SAMPLE_DURATION )
+            i_default_duration = BOXDATA(p_tfhd)->i_default_sample_duration;
+        else
+        {
+            const MP4_Box_t *p_trex = MP4_GetTrexByTrackID( p_moov, BOXDATA(p_tfhd)->i_track_ID );
+            if( p_trex )
+                i_default_duration = BOXDATA(p_trex)->i_default_sample_duration;
+        }
+
+        uint64_t i_duration = 0;
+        for( const MP4_Box_t *p_trun = MP4_BoxGet( p_traf, "trun" );
+             p_trun; p_trun = p_trun->p_next )
+        {
+            const MP4_Box_data_trun_t *p_trundata = p_trun->data.p_trun;
+            if( p_trun->i_type != ATOM_trun || !p_trundata )
+                continue;
+
+            if( p_trundata->i_flags & MP4_TRUN_SAMPLE_DURATION )
+            {
+                for( uint32_t i = 0; i < p_trundata->i_sample_count; i++ )
+                    i_duration += p_trundata->p_samples[i].i_duration;
+            }
+            else
+                i_duration += (uint64_t) p_trundata->i_sample_count * i_default_duration;
+        }
+
+        i_duration = i_duration * p_sys->i_timescale / BOXDATA(p_mdhd)->i_timescale;
+        i_max_duration = __MAX( i_max_duration, i_duration );
+    }
+
+    return i_max_duration;
+}
+
+static void *FragIndexThread( void *data )
+{
+    mp4_fragindex_t *p_index = data;
+    demux_t *p_demux = p_index->p_demux;
+
+    vlc_interrupt_set( p_index->p_interrupt );
+
+    stream_t *s = stream_UrlNew( p_demux, p_index->psz_url );
+    if( s && stream_Seek( s, p_index->i_start ) == VLC_SUCCESS )
+    {
+        for( ;; )
+        {
+            /* reads up to the next moof, skipping the mdat */
+            MP4_Box_t *p_chunk = MP4_BoxGetNextChunk( s );
+            MP4_Box_t *p_moof = MP4_BoxGet( p_chunk, "moof" );
+            if( !p_moof )
+            {
+                MP4_BoxFree( p_chunk );
+                break;
+            }
+
+            uint64_t i_duration = FragIndexGetMoofDuration( p_demux, p_moof );
+
+            vlc_mutex_lock( &p_index->lock );
+            bool b_added = !p_index->b_abort &&
+                           FragIndexAdd( p_index, p_moof->i_pos, i_duration );
+            vlc_cond_broadcast( &p_index->wait );
+            vlc_mutex_unlock( &p_index->lock );
+
+            MP4_BoxFree( p_chunk );
+            if( !b_added )
+                break;
+        }
+    }
+    else
+        msg_Warn( p_demux, "cannot index fragments from %s", p_index->psz_url );
+
+    if( s )
+        stream_Delete( s );
+
+    vlc_mutex_lock( &p_index->lock );
+    msg_Dbg( p_demux, "indexed %u fragments", p_index->i_entries );
+    p_index->b_done = true;
+    vlc_cond_broadcast( &p_index->wait );
+    vlc_mutex_unlock( &p_index->lock );
+
+    vlc_interrupt_set( NULL );
+    return NULL;
+}
+
+static mp4_fragindex_t *FragIndexNew( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const MP4_Box_t *p_moov = p_sys->moovfragment.p_moox;
+    if( !p_moov || p_moov->i_type != ATOM_moov || !p_sys->i_timescale )
+        return NULL;
+
+    mp4_fragindex_t *p_index = calloc( 1, sizeof(*p_index) );
+    if( !p_index )
+        return NULL;
+
+    p_index->p_demux = p_demux;
+    p_index->i_start = p_moov->i_pos + p_moov->i_size;
+    vlc_mutex_init( &p_index->lock );
+    vlc_cond_init( &p_index->wait );
+
+    /* the fragments follow the moov samples, as in GetFragmentByTime() */
+    uint64_t i_moov_duration = 0;
+    if( p_sys->moovfragment.i_chunk_range_max_offset )
+    {
+        for( unsigned int i = 0; i < p_sys->i_tracks; i++ )
+            i_moov_duration = __MAX( i_moov_duration, (uint64_t)
+                GetTrackDurationInFragment( &p_sys->moovfragment,
+                                            p_sys->track[i].i_track_ID ) );
+    }
+
+    p_index->i_time = i_moov_duration;
+    if( FragIndexLoadSidx( p_demux, p_index ) )
+    {
+        p_index->b_done = true;
+        return p_index;
+    }
+    p_index->i_entries = 0;
+    p_index->i_time = i_moov_duration;
+
+    if( !p_demux->psz_access || !*p_demux->psz_access ||
+        asprintf( &p_index->psz_url, "%s://%s", p_demux->psz_access,
+                  p_demux->psz_location ) == -1 )
+        p_index->psz_url = NULL;
+
+    p_index->p_interrupt = vlc_interrupt_create();
+    if( p_index->psz_url && p_index->p_interrupt &&
+        !vlc_clone( &p_index->thread, FragIndexThread, p_index,
+                    VLC_THREAD_PRIORITY_LOW ) )
+    {
+        p_index->b_thread = true;
+        msg_Dbg( p_demux, "indexing fragments from %"PRIu64, p_index->i_start );
+        return p_index;
+    }
+
+    FragIndexDelete( p_index );
+    return NULL;
+}
+
+static void FragIndexDelete( mp4_fragindex_t *p_index )
+{
+    if( p_index->b_thread )
+    {
+        vlc_mutex_lock( &p_index->lock );
+        p_index->b_abort = true;
+        vlc_mutex_unlock( &p_index->lock );
+        vlc_interrupt_kill( p_index->p_interrupt );
+        vlc_join( p_index->thread, NULL );
+    }
+    if( p_index->p_interrupt )
+        vlc_interrupt_destroy( p_index->p_interrupt );
+
+    vlc_cond_destroy( &p_index->wait );
+    vlc_mutex_destroy( &p_index->lock );
+    free( p_index->p_entries );
+    free( p_index->psz_url );
+    free( p_index );
+}
+
+/* Gets the moof starting the fragment holding a time, waiting for the
+ * index to reach it */
+static int FragIndexGetMoofPosByTime( demux_t *p_demux, const mtime_t i_target_time,
+                                      uint64_t *pi_pos, mtime_t *pi_mooftime )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mp4_fragindex_t *p_index = p_sys->p_fragindex;
+    if( !p_index || i_target_time < 0 )
+        return VLC_EGENERIC;
+
+    const uint64_t i_time = i_target_time * p_sys->i_timescale / CLOCK_FREQ;
+    int i_ret = VLC_EGENERIC;
+
+    vlc_mutex_lock( &p_index->lock );
+    if( !p_index->b_done && p_index->i_time <= i_time )
+        msg_Dbg( p_demux, "waiting for the fragments index to reach %"PRId64,
+                 i_target_time );
+    while( !p_index->b_done && p_index->i_time <= i_time && !vlc_killed() )
+        vlc_cond_timedwait( &p_index->wait, &p_index->lock,
+                            mdate() + CLOCK_FREQ / 10 );
+
+    if( p_index->i_entries > 0 && p_index->p_entries[0].i_time <= i_time &&
+        i_time < p_index->i_time )
+    {
+        /* last fragment starting before the target time */
+        unsigned i_low = 0, i_high = p_index->i_entries;
+        while( i_high - i_low > 1 )
+        {
+            unsigned i_mid = i_low + ( i_high - i_low ) / 2;
+            if( p_index->p_entries[i_mid].i_time <= i_time )
+                i_low = i_mid;
+            else
+                i_high = i_mid;
+        }
+        *pi_pos = p_index->p_entries[i_low].i_pos;
+        *pi_mooftime = CLOCK_FREQ * p_index->p_entries[i_low].i_time / p_sys->i_timescale;
+        i_ret = VLC_SUCCESS;
+    }
+    vlc_mutex_unlock( &p_index->lock );
+
+    return i_ret;
+}
+
 static void MP4_GetDefaultSizeAndDuration( demux_t *p_demux,
                                            const MP4_Box_data_tfhd_t *p_tfhd_data,
                                            uint32_t *pi_default_size,
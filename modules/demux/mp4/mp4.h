@@ -49,11 +49,17 @@ typedef struct
     uint64_t     i_first_dts;   /* DTS of the first sample */
     uint64_t     i_last_dts;    /* DTS of the last sample */
 
+    /* for chunks of the moov, these point into the stts and ctts tables:
+     * the first entry may be shared with the previous chunk, which then
+     * used i_skip_dts (resp. i_skip_pts) of its samples, and the last entry
+     * may hold more samples than the chunk does */
     uint32_t     i_entries_dts;
+    uint32_t     i_skip_dts;
     uint32_t     *p_sample_count_dts;
     uint32_t     *p_sample_delta_dts;   /* dts delta */
 
     uint32_t     i_entries_pts;
+    uint32_t     i_skip_pts;
     uint32_t     *p_sample_count_pts;
     int32_t      *p_sample_offset_pts;  /* pts-dts */
 
@@ -110,8 +116,13 @@ typedef struct
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
-                                    too much time to do sumations each time*/
+    const uint32_t   *p_sample_size; /* stsz table, not a copy */
+
+    bool         b_indexed; /* sizes and pts mapped, once selected */
+
+    /* data read ahead from i_readahead_pos, if fast seekable */
+    block_t         *p_readahead;
+    uint64_t         i_readahead_pos;
 
     uint32_t     i_sample_first; /* i_sample_first value
                                                    of the next chunk */
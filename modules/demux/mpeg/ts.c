@@ -142,6 +142,12 @@ static const int const arib_mode_list[] =
 static const char *const arib_mode_list_text[] =
   { N_("Auto"), N_("Enabled"), N_("Disabled") };
 
+#define THREADS_TEXT N_("Demux programs in parallel")
+#define THREADS_LONGTEXT N_( \
+    "Reassemble the streams of each selected program on its own thread " \
+    "when several programs of a multiple program transport stream are " \
+    "selected, e.g. with --programs and #duplicate." )
+
 #define SUPPORT_ARIB_TEXT N_("ARIB STD-B24 mode")
 #define SUPPORT_ARIB_LONGTEXT N_( \
     "Forces ARIB STD-B24 mode for decoding characters." \
@@ -169,6 +175,7 @@ vlc_module_begin ()
 
     add_bool( "ts-split-es", true, SPLIT_ES_TEXT, SPLIT_ES_LONGTEXT, false )
     add_bool( "ts-seek-percent", false, SEEK_PERCENT_TEXT, SEEK_PERCENT_LONGTEXT, true )
+    add_bool( "ts-program-threads", false, THREADS_TEXT, THREADS_LONGTEXT, true )
 
     add_integer( "ts-arib", ARIBMODE_AUTO, SUPPORT_ARIB_TEXT, SUPPORT_ARIB_LONGTEXT, false )
         change_integer_list( arib_mode_list, arib_mode_list_text )
@@ -194,6 +201,54 @@ static const char *const ppsz_teletext_type[] = {
 
 typedef struct ts_pid_t ts_pid_t;
 
+/* Queued packets of a program demuxed on its own thread */
+#define TS_WORKER_QUEUE 1024
+
+typedef struct
+{
+    ts_pid_t *pid;
+    block_t  *p_pkt;
+    bool      b_pcr_only; /* no payload to gather */
+} ts_job_t;
+
+/* es_out is only called from the input thread: the calls of a worker are
+ * queued, and replayed by the input thread */
+#define TS_OUTPUT_SEND (-1)
+
+typedef struct
+{
+    int           i_query;  /* TS_OUTPUT_SEND or ES_OUT_SET_GROUP_* */
+    int           i_group;
+    es_out_id_t  *id;
+    union
+    {
+        block_t    *p_block;
+        mtime_t     i_pcr;
+        vlc_meta_t *p_meta;
+        vlc_epg_t  *p_epg;
+    } u;
+} ts_output_t;
+
+typedef DECL_ARRAY(ts_output_t) ts_output_array_t;
+
+typedef struct
+{
+    demux_t      *p_demux;
+    vlc_thread_t  thread;
+    vlc_mutex_t   lock;
+    vlc_cond_t    wait;     /* signaled when a job is queued */
+    vlc_cond_t    done;     /* signaled when a job is dequeued or completed */
+    unsigned      i_first;
+    unsigned      i_count;
+    bool          b_busy;
+    ts_job_t      jobs[TS_WORKER_QUEUE];
+    ts_output_array_t output;   /* filled by the worker */
+    ts_output_array_t replay;   /* owned by the input thread */
+} ts_worker_t;
+
+/* Digests of the EIT tables last sent to the EPG */
+#define TS_SI_EPG_DIGESTS 512
+
 typedef struct
 {
     int             i_version;
@@ -228,6 +283,9 @@ typedef struct
 
     mtime_t i_last_dts;
 
+    /* Thread gathering the program data, or NULL */
+    ts_worker_t *p_worker;
+
 } ts_pmt_t;
 
 typedef struct
@@ -344,6 +402,8 @@ typedef struct
 #define MIN_PAT_INTERVAL CLOCK_FREQ // DVB is 500ms
 
 #define PID_ALLOC_CHUNK 16
+#define PID_INDEX_BITS 8 /* PIDs per page of the lookup table: 256 */
+#define PACKET_POOL_MAX 512 /* idle TS packets kept for recycling */
 
 struct demux_sys_t
 {
@@ -361,8 +421,16 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
 
+    /* recycled TS packets (may be NULL) */
+    block_pool_t *packet_pool;
+
     bool        b_force_seek_per_percent;
 
+    /* Per program threads: only the demux thread touches the program
+     * tables, and it does so only while the workers are idle */
+    bool        b_program_threads;
+    bool        b_workers_dirty; /* programs or selection may have changed */
+
     struct
     {
         arib_modes_e e_mode;
@@ -381,9 +449,9 @@ struct demux_sys_t
         ts_pid_t **pp_all;
         int        i_all;
         int        i_all_alloc;
-        /* last recently used */
-        uint16_t   i_last_pid;
-        ts_pid_t  *p_last;
+        /* lookup table of the above, indexed by PID, in pages allocated
+         * on first use */
+        ts_pid_t **pp_index[8192 >> PID_INDEX_BITS];
     } pids;
 
     bool        b_user_pmt;
@@ -419,6 +487,17 @@ struct demux_sys_t
     int64_t     i_dvb_length;
     bool        b_broken_charset; /* True if broken encoding is used in EPG/SDT */
 
+    /* Thread parsing the SDT, EIT and TDT at low priority, or NULL */
+    ts_worker_t *p_si_worker;
+    bool        b_si_late; /* SI packets are being dropped */
+    struct
+    {
+        vlc_mutex_t lock; /* also protects i_tdt_delta and i_dvb_* */
+        bool        b_create_es;
+        int         i_program; /* first selected program, 0 if none */
+        uint64_t    epg[TS_SI_EPG_DIGESTS]; /* SI parsing only */
+    } si;
+
     /* Selected programs */
     DECL_ARRAY( int ) programs; /* List of selected/access-filtered programs */
     bool        b_default_selection; /* True if set by default to first pmt seen (to get data from filtered access) */
@@ -474,6 +553,12 @@ static inline int PIDGet( block_t *p )
 }
 
 static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk );
+
+static ts_worker_t *ts_worker_New( demux_t *, int );
+static void ts_worker_Delete( ts_worker_t * );
+static void UpdateSIState( demux_t * );
+static void DrainProgramWorkers( demux_t * );
+static void StopProgramWorkers( demux_t * );
 static void AddAndCreateES( demux_t *p_demux, ts_pid_t *pid, bool );
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, mtime_t i_pcr );
 
@@ -503,6 +588,33 @@ static int  SetPIDFilter( demux_sys_t *, ts_pid_t *, bool b_selected );
 #define TS_PACKET_SIZE_MAX 204
 #define TS_HEADER_SIZE 4
 
+/* Returns the offset of the first packet followed by another synchronized
+ * packet, or i_peek - i_packet_size if there is none. The sync bytes are
+ * looked up with memchr(), which the C library vectorizes. */
+static unsigned FindSync( const uint8_t *p_peek, unsigned i_peek,
+                          unsigned i_header_size, unsigned i_packet_size )
+{
+    const unsigned i_end = i_peek - i_packet_size;
+    unsigned i_skip = 0;
+
+    if( i_peek < i_header_size + i_packet_size )
+        return i_end;
+
+    while( i_skip < i_end - i_header_size )
+    {
+        const uint8_t *p_sync = memchr( &p_peek[i_skip + i_header_size], 0x47,
+                                        i_end - i_header_size - i_skip );
+        if( p_sync == NULL )
+            break;
+
+        i_skip = p_sync - p_peek - i_header_size;
+        if( p_sync[i_packet_size] == 0x47 )
+            return i_skip;
+        i_skip++;
+    }
+    return i_end;
+}
+
 static int DetectPacketSize( demux_t *p_demux, unsigned *pi_header_size, int i_offset )
 {
     const uint8_t *p_peek;
@@ -980,6 +1092,7 @@ static int Open( vlc_object_t *p_this )
         return VLC_ENOMEM;
     memset( p_sys, 0, sizeof( demux_sys_t ) );
     vlc_mutex_init( &p_sys->csa_lock );
+    vlc_mutex_init( &p_sys->si.lock );
 
     p_demux->pf_demux = Demux;
     p_demux->pf_control = Control;
@@ -1022,6 +1135,7 @@ static int Open( vlc_object_t *p_this )
     patpid = GetPID(p_sys, 0);
     if ( !PIDSetup( p_demux, TYPE_PAT, patpid, NULL ) )
     {
+        vlc_mutex_destroy( &p_sys->si.lock );
         vlc_mutex_destroy( &p_sys->csa_lock );
         free( p_sys );
         return VLC_ENOMEM;
@@ -1029,6 +1143,7 @@ static int Open( vlc_object_t *p_this )
     if( !dvbpsi_pat_attach( patpid->u.p_pat->handle, PATCallBack, p_demux ) )
     {
         PIDRelease( p_demux, patpid );
+        vlc_mutex_destroy( &p_sys->si.lock );
         vlc_mutex_destroy( &p_sys->csa_lock );
         free( p_sys );
         return VLC_EGENERIC;
@@ -1061,6 +1176,8 @@ static int Open( vlc_object_t *p_this )
 
 # undef VLC_DVBPSI_DEMUX_TABLE_INIT
 
+    p_sys->packet_pool = block_PoolNew( i_packet_size, PACKET_POOL_MAX );
+
     p_sys->i_pmt_es = 0;
     p_sys->b_es_all = false;
 
@@ -1129,6 +1246,8 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_canseek = false;
     p_sys->b_canfastseek = false;
     p_sys->b_force_seek_per_percent = var_InheritBool( p_demux, "ts-seek-percent" );
+    p_sys->b_program_threads = var_InheritBool( p_demux, "ts-program-threads" );
+    p_sys->b_workers_dirty = true;
 
     p_sys->arib.e_mode = var_InheritInteger( p_demux, "ts-arib" );
 
@@ -1147,6 +1266,15 @@ static int Open( vlc_object_t *p_this )
     else
         p_sys->es_creation = ( p_sys->b_access_control ? CREATE_ES : DELAY_ES );
 
+    /* The service and event information is parsed off the demux thread */
+    if( p_sys->b_dvb_meta )
+    {
+        p_sys->p_si_worker = ts_worker_New( p_demux, VLC_THREAD_PRIORITY_LOW );
+        if( p_sys->p_si_worker == NULL )
+            msg_Warn( p_demux, "parsing service information inline" );
+    }
+    UpdateSIState( p_demux );
+
     return VLC_SUCCESS;
 }
 
@@ -1158,6 +1286,9 @@ static void Close( vlc_object_t *p_this )
     demux_t     *p_demux = (demux_t*)p_this;
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    StopProgramWorkers( p_demux );
+    if( p_sys->p_si_worker )
+        ts_worker_Delete( p_sys->p_si_worker );
     PIDRelease( p_demux, GetPID(p_sys, 0) );
 
     if( p_sys->b_dvb_meta )
@@ -1189,8 +1320,18 @@ static void Close( vlc_object_t *p_this )
         stream_Delete( p_sys->arib.b25stream );
     }
 
+    vlc_mutex_destroy( &p_sys->si.lock );
     vlc_mutex_destroy( &p_sys->csa_lock );
 
+    if( p_sys->packet_pool )
+    {
+        uint64_t i_hits, i_misses;
+        block_PoolGetStats( p_sys->packet_pool, &i_hits, &i_misses );
+        msg_Dbg( p_demux, "packet pool: %"PRIu64" hits, %"PRIu64" misses",
+                 i_hits, i_misses );
+        block_PoolDelete( p_sys->packet_pool );
+    }
+
     /* Release all non default pids */
     for( int i = 0; i < p_sys->pids.i_all; i++ )
     {
@@ -1202,6 +1343,8 @@ static void Close( vlc_object_t *p_this )
         free( pid );
     }
     free( p_sys->pids.pp_all );
+    for( unsigned i = 0; i < ARRAY_SIZE(p_sys->pids.pp_index); i++ )
+        free( p_sys->pids.pp_index[i] );
 
     free( p_sys );
 }
@@ -1228,118 +1371,632 @@ static int ChangeKeyCallback( vlc_object_t *p_this, char const *psz_cmd,
     return i_tmp;
 }
 
+static void TSPacketNoRelease( block_t *p_pkt )
+{
+    (void) p_pkt;
+}
+
+static block_t *CopyTSPacket( demux_sys_t *p_sys, const block_t *p_pkt )
+{
+    block_t *p_copy = p_sys->packet_pool
+                    ? block_PoolAlloc( p_sys->packet_pool, p_pkt->i_buffer )
+                    : block_Alloc( p_pkt->i_buffer );
+    if( likely(p_copy != NULL) )
+        memcpy( p_copy->p_buffer, p_pkt->p_buffer, p_pkt->i_buffer );
+    return p_copy;
+}
+
 /*****************************************************************************
- * Demux:
+ * Program workers
  *****************************************************************************/
-static int Demux( demux_t *p_demux )
+static void *WorkerThread( void *data )
+{
+    ts_worker_t *p_worker = data;
+    demux_t *p_demux = p_worker->p_demux;
+
+    for( ;; )
+    {
+        ts_job_t job;
+
+        vlc_mutex_lock( &p_worker->lock );
+        mutex_cleanup_push( &p_worker->lock );
+        while( p_worker->i_count == 0 )
+        {
+            p_worker->b_busy = false;
+            vlc_cond_broadcast( &p_worker->done );
+            vlc_cond_wait( &p_worker->wait, &p_worker->lock );
+        }
+        job = p_worker->jobs[p_worker->i_first];
+        p_worker->i_first = (p_worker->i_first + 1) % TS_WORKER_QUEUE;
+        p_worker->i_count--;
+        p_worker->b_busy = true;
+        vlc_cond_broadcast( &p_worker->done );
+        vlc_cleanup_pop();
+        vlc_mutex_unlock( &p_worker->lock );
+
+        int canc = vlc_savecancel();
+        if( job.pid->type == TYPE_SDT || job.pid->type == TYPE_TDT ||
+            job.pid->type == TYPE_EIT )
+        {
+            dvbpsi_packet_push( job.pid->u.p_psi->handle, job.p_pkt->p_buffer );
+            block_Release( job.p_pkt );
+        }
+        else if( job.b_pcr_only )
+        {
+            PCRHandle( p_demux, job.pid, job.p_pkt );
+            block_Release( job.p_pkt );
+        }
+        else
+            GatherData( p_demux, job.pid, job.p_pkt );
+        vlc_restorecancel( canc );
+    }
+    vlc_assert_unreachable();
+}
+
+static ts_worker_t *ts_worker_New( demux_t *p_demux, int i_priority )
+{
+    ts_worker_t *p_worker = malloc( sizeof( *p_worker ) );
+    if( !p_worker )
+        return NULL;
+
+    p_worker->p_demux = p_demux;
+    vlc_mutex_init( &p_worker->lock );
+    vlc_cond_init( &p_worker->wait );
+    vlc_cond_init( &p_worker->done );
+    p_worker->i_first = 0;
+    p_worker->i_count = 0;
+    p_worker->b_busy = false;
+    ARRAY_INIT( p_worker->output );
+    ARRAY_INIT( p_worker->replay );
+
+    if( vlc_clone( &p_worker->thread, WorkerThread, p_worker, i_priority ) )
+    {
+        vlc_cond_destroy( &p_worker->done );
+        vlc_cond_destroy( &p_worker->wait );
+        vlc_mutex_destroy( &p_worker->lock );
+        free( p_worker );
+        return NULL;
+    }
+    return p_worker;
+}
+
+/* Performs an es_out call, on the input thread */
+static void ReplayOutput( demux_t *p_demux, const ts_output_t *p_out )
+{
+    switch( p_out->i_query )
+    {
+    case TS_OUTPUT_SEND:
+        es_out_Send( p_demux->out, p_out->id, p_out->u.p_block );
+        break;
+    case ES_OUT_SET_GROUP_PCR:
+        es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR,
+                        p_out->i_group, p_out->u.i_pcr );
+        break;
+    case ES_OUT_SET_GROUP_META:
+        es_out_Control( p_demux->out, ES_OUT_SET_GROUP_META,
+                        p_out->i_group, p_out->u.p_meta );
+        vlc_meta_Delete( p_out->u.p_meta );
+        break;
+    case ES_OUT_SET_GROUP_EPG:
+        es_out_Control( p_demux->out, ES_OUT_SET_GROUP_EPG,
+                        p_out->i_group, p_out->u.p_epg );
+        vlc_epg_Delete( p_out->u.p_epg );
+        break;
+    default:
+        vlc_assert_unreachable();
+    }
+}
+
+/* Calls es_out, or queues the call if it is made on behalf of a worker.
+ * Takes ownership of the block, meta or EPG. */
+static void Output( demux_t *p_demux, ts_worker_t *p_worker, ts_output_t out )
+{
+    if( p_worker == NULL )
+    {
+        ReplayOutput( p_demux, &out );
+        return;
+    }
+
+    vlc_mutex_lock( &p_worker->lock );
+    ARRAY_APPEND( p_worker->output, out );
+    vlc_mutex_unlock( &p_worker->lock );
+}
+
+/* Replays the es_out calls queued by a worker, on the input thread */
+static void FlushWorkerOutput( ts_worker_t *p_worker )
+{
+    ts_output_array_t output;
+
+    vlc_mutex_lock( &p_worker->lock );
+    output = p_worker->output;
+    p_worker->output = p_worker->replay;
+    vlc_mutex_unlock( &p_worker->lock );
+
+    for( int i = 0; i < output.i_size; i++ )
+        ReplayOutput( p_worker->p_demux, &output.p_elems[i] );
+    output.i_size = 0;
+    p_worker->replay = output;
+}
+
+/* Stops the thread, dropping the packets it has not processed yet */
+static void ts_worker_Delete( ts_worker_t *p_worker )
+{
+    vlc_cancel( p_worker->thread );
+    vlc_join( p_worker->thread, NULL );
+
+    for( unsigned i = 0; i < p_worker->i_count; i++ )
+        block_Release( p_worker->jobs[(p_worker->i_first + i) % TS_WORKER_QUEUE].p_pkt );
+
+    FlushWorkerOutput( p_worker );
+    ARRAY_RESET( p_worker->output );
+    ARRAY_RESET( p_worker->replay );
+
+    vlc_cond_destroy( &p_worker->done );
+    vlc_cond_destroy( &p_worker->wait );
+    vlc_mutex_destroy( &p_worker->lock );
+    free( p_worker );
+}
+
+static void ts_worker_Drain( ts_worker_t *p_worker )
+{
+    vlc_mutex_lock( &p_worker->lock );
+    while( p_worker->i_count > 0 || p_worker->b_busy )
+        vlc_cond_wait( &p_worker->done, &p_worker->lock );
+    vlc_mutex_unlock( &p_worker->lock );
+}
+
+static void QueueTSPacket( demux_sys_t *p_sys, ts_worker_t *p_worker,
+                           ts_pid_t *pid, block_t *p_pkt, bool b_pcr_only )
+{
+    /* Packets processed in place must be copied to be kept */
+    if( p_pkt->pf_release == TSPacketNoRelease &&
+        !( p_pkt = CopyTSPacket( p_sys, p_pkt ) ) )
+        return;
+
+    vlc_mutex_lock( &p_worker->lock );
+    while( p_worker->i_count == TS_WORKER_QUEUE )
+        vlc_cond_wait( &p_worker->done, &p_worker->lock );
+
+    ts_job_t *job = &p_worker->jobs[(p_worker->i_first + p_worker->i_count) % TS_WORKER_QUEUE];
+    job->pid = pid;
+    job->p_pkt = p_pkt;
+    job->b_pcr_only = b_pcr_only;
+    p_worker->i_count++;
+    vlc_cond_signal( &p_worker->wait );
+    vlc_mutex_unlock( &p_worker->lock );
+}
+
+/* Never waits for the SI worker: the tables are repeated, so the packets
+ * it cannot keep up with are dropped and the sections are gathered again
+ * from a later repetition. */
+static void QueueSIPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    bool b_wait_es = p_sys->i_pmt_es <= 0;
+    ts_worker_t *p_worker = p_sys->p_si_worker;
 
-    /* If we had no PAT within MIN_PAT_INTERVAL, create PAT/PMT from probed streams */
-    if( p_sys->i_pmt_es == 0 && !SEEN(GetPID(p_sys, 0)) && p_sys->patfix.b_pat_deadline )
-        MissingPATPMTFixup( p_demux );
+    vlc_mutex_lock( &p_worker->lock );
+    const bool b_full = p_worker->i_count == TS_WORKER_QUEUE;
+    vlc_mutex_unlock( &p_worker->lock );
 
-    /* We read at most 100 TS packet or until a frame is completed */
-    for( unsigned i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
+    if( b_full != p_sys->b_si_late )
+    {
+        p_sys->b_si_late = b_full;
+        if( b_full )
+            msg_Warn( p_demux, "service information parsing is late, "
+                      "dropping packets" );
+    }
+    if( b_full )
+    {
+        block_Release( p_pkt );
+        return;
+    }
+    /* Only this thread queues, so the queue cannot be full now */
+    QueueTSPacket( p_sys, p_worker, pid, p_pkt, false );
+}
+
+/* Shares the state of the demux the SI parsing depends on */
+static void UpdateSIState( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const bool b_create_es = p_sys->es_creation == CREATE_ES;
+    const int i_program = p_sys->programs.i_size ? p_sys->programs.p_elems[0] : 0;
+
+    if( b_create_es == p_sys->si.b_create_es && i_program == p_sys->si.i_program )
+        return;
+
+    vlc_mutex_lock( &p_sys->si.lock );
+    p_sys->si.b_create_es = b_create_es;
+    p_sys->si.i_program = i_program;
+    vlc_mutex_unlock( &p_sys->si.lock );
+}
+
+/* A program can be demuxed on its own thread if none of its streams,
+ * including the PCR, is shared with another program, and if gathering
+ * its data cannot change the PID filters anymore. */
+static bool ProgramCanThread( demux_sys_t *p_sys, const ts_pat_t *p_pat,
+                              const ts_pmt_t *p_pmt )
+{
+    if( !ProgramIsSelected( p_sys, p_pmt->i_number ) )
+        return false;
+
+    /* PCR workaround and MPEG-4 object descriptors update the filters */
+    if( p_pmt->iod || !( p_pmt->pcr.b_fix_done || p_pmt->pcr.b_disable ) )
+        return false;
+
+    for( int i = 0; i < p_pmt->e_streams.i_size; i++ )
+        if( p_pmt->e_streams.p_elems[i]->i_refcount != 1 )
+            return false;
+
+    if( p_pmt->i_pid_pcr == 0x1FFF )
+        return true;
+
+    for( int i = 0; i < p_pat->programs.i_size; i++ )
+    {
+        const ts_pmt_t *p_other = p_pat->programs.p_elems[i]->u.p_pmt;
+        if( p_other == p_pmt )
+            continue;
+        if( p_other->i_pid_pcr == p_pmt->i_pid_pcr )
+            return false;
+        for( int j = 0; j < p_other->e_streams.i_size; j++ )
+            if( p_other->e_streams.p_elems[j]->i_pid == p_pmt->i_pid_pcr )
+                return false;
+    }
+    return true;
+}
+
+/* Starts or stops the workers after the programs or the selection changed.
+ * The workers must be idle. */
+static void UpdateProgramWorkers( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    p_sys->b_workers_dirty = false;
+    if( GetPID(p_sys, 0)->type != TYPE_PAT )
+        return;
+
+    const ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+    const bool b_threads = p_sys->es_creation != NO_ES &&
+                           p_sys->programs.i_size > 1;
+
+    for( int i = 0; i < p_pat->programs.i_size; i++ )
     {
-        bool         b_frame = false;
-        block_t     *p_pkt;
-        if( !(p_pkt = ReadTSPacket( p_demux )) )
+        ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+
+        if( b_threads && ProgramCanThread( p_sys, p_pat, p_pmt ) )
         {
-            return VLC_DEMUXER_EOF;
+            if( p_pmt->p_worker == NULL )
+            {
+                p_pmt->p_worker = ts_worker_New( p_demux,
+                                                 VLC_THREAD_PRIORITY_INPUT );
+                if( p_pmt->p_worker )
+                    msg_Dbg( p_demux, "program %d demuxed on its own thread",
+                             p_pmt->i_number );
+            }
         }
+        else if( p_pmt->p_worker )
+        {
+            ts_worker_Delete( p_pmt->p_worker );
+            p_pmt->p_worker = NULL;
+        }
+    }
+}
 
-        if( p_sys->b_start_record )
+/* Returns the worker handling the packets of a PID, if any */
+static ts_worker_t *GetPIDWorker( demux_t *p_demux, ts_pid_t *pid )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->b_program_threads )
+        return NULL;
+    if( p_sys->b_workers_dirty )
+        UpdateProgramWorkers( p_demux );
+
+    if( pid->type == TYPE_PES )
+    {
+        if( pid->i_refcount != 1 || pid->p_parent == NULL ||
+            pid->p_parent->type != TYPE_PMT )
+            return NULL;
+        return pid->p_parent->u.p_pmt->p_worker;
+    }
+
+    /* Dedicated PCR PID */
+    if( GetPID(p_sys, 0)->type != TYPE_PAT )
+        return NULL;
+
+    const ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+    for( int i = 0; i < p_pat->programs.i_size; i++ )
+    {
+        const ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+        if( p_pmt->i_pid_pcr == pid->i_pid )
+            return p_pmt->p_worker;
+    }
+    return NULL;
+}
+
+/* Waits until all queued packets have been processed, and their output
+ * has been sent */
+static void DrainProgramWorkers( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->b_program_threads || GetPID(p_sys, 0)->type != TYPE_PAT )
+        return;
+
+    const ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+    for( int i = 0; i < p_pat->programs.i_size; i++ )
+    {
+        ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+        if( p_pmt->p_worker )
         {
-            /* Enable recording once synchronized */
-            stream_Control( p_sys->stream, STREAM_SET_RECORD_STATE, true, "ts" );
-            p_sys->b_start_record = false;
+            ts_worker_Drain( p_pmt->p_worker );
+            FlushWorkerOutput( p_pmt->p_worker );
         }
+    }
+}
 
-        /* Parse the TS packet */
-        ts_pid_t *p_pid = GetPID( p_sys, PIDGet( p_pkt ) );
+/* Replays the es_out calls of all the workers */
+static void FlushWorkers( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->p_si_worker )
+        FlushWorkerOutput( p_sys->p_si_worker );
+
+    if( !p_sys->b_program_threads || GetPID(p_sys, 0)->type != TYPE_PAT )
+        return;
 
-        if( (p_pkt->p_buffer[1] & 0x40) && (p_pkt->p_buffer[3] & 0x10) &&
-            !SCRAMBLED(*p_pid) != !(p_pkt->p_buffer[3] & 0x80) )
+    const ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+    for( int i = 0; i < p_pat->programs.i_size; i++ )
+    {
+        ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+        if( p_pmt->p_worker )
+            FlushWorkerOutput( p_pmt->p_worker );
+    }
+}
+
+static void StopProgramWorkers( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( GetPID(p_sys, 0)->type != TYPE_PAT )
+        return;
+
+    const ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+    for( int i = 0; i < p_pat->programs.i_size; i++ )
+    {
+        ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+        if( p_pmt->p_worker )
+        {
+            ts_worker_Delete( p_pmt->p_worker );
+            p_pmt->p_worker = NULL;
+        }
+    }
+}
+
+/*****************************************************************************
+ * ProcessTSPacket: handles one TS packet, returns true if a frame is complete
+ *****************************************************************************/
+static bool ProcessTSPacket( demux_t *p_demux, block_t *p_pkt )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    bool         b_frame = false;
+
+    /* Parse the TS packet */
+    ts_pid_t *p_pid = GetPID( p_sys, PIDGet( p_pkt ) );
+
+    if( (p_pkt->p_buffer[1] & 0x40) && (p_pkt->p_buffer[3] & 0x10) &&
+        !SCRAMBLED(*p_pid) != !(p_pkt->p_buffer[3] & 0x80) )
+    {
+        DrainProgramWorkers( p_demux );
+        UpdateScrambledState( p_demux, p_pid, p_pkt->p_buffer[3] & 0x80 );
+    }
+
+    if( !SEEN(p_pid) )
+    {
+        if( p_pid->type == TYPE_FREE )
+            msg_Dbg( p_demux, "pid[%d] unknown", p_pid->i_pid );
+        p_pid->i_flags |= FLAG_SEEN;
+    }
+
+    if ( SCRAMBLED(*p_pid) && !p_demux->p_sys->csa )
+    {
+        ts_worker_t *p_worker = GetPIDWorker( p_demux, p_pid );
+        if( p_worker )
         {
-            UpdateScrambledState( p_demux, p_pid, p_pkt->p_buffer[3] & 0x80 );
+            QueueTSPacket( p_sys, p_worker, p_pid, p_pkt, true );
+            return false;
         }
+        PCRHandle( p_demux, p_pid, p_pkt );
+        block_Release( p_pkt );
+        return false;
+    }
+
+    /* Probe streams to build PAT/PMT after MIN_PAT_INTERVAL in case we don't see any PAT */
+    if( !SEEN( GetPID( p_sys, 0 ) ) &&
+        (p_pid->probed.i_type == 0 || p_pid->i_pid == p_sys->patfix.i_timesourcepid) &&
+        (p_pkt->p_buffer[1] & 0xC0) == 0x40 && /* Payload start but not corrupt */
+        (p_pkt->p_buffer[3] & 0xD0) == 0x10 )  /* Has payload but is not encrypted */
+    {
+        ProbePES( p_demux, p_pid, p_pkt->p_buffer + TS_HEADER_SIZE,
+                  p_pkt->i_buffer - TS_HEADER_SIZE, p_pkt->p_buffer[3] & 0x20 /* Adaptation field */);
+    }
+
+    switch( p_pid->type )
+    {
+    case TYPE_PAT:
+        DrainProgramWorkers( p_demux );
+        dvbpsi_packet_push( p_pid->u.p_pat->handle, p_pkt->p_buffer );
+        block_Release( p_pkt );
+        p_sys->b_workers_dirty = true;
+        break;
 
-        if( !SEEN(p_pid) )
+    case TYPE_PMT:
+        DrainProgramWorkers( p_demux );
+        /* The PMT callback may probe the stream, which invalidates
+         * packets processed in place */
+        if( p_pkt->pf_release == TSPacketNoRelease &&
+            !( p_pkt = CopyTSPacket( p_sys, p_pkt ) ) )
+            return false;
+        dvbpsi_packet_push( p_pid->u.p_pmt->handle, p_pkt->p_buffer );
+        block_Release( p_pkt );
+        p_sys->b_workers_dirty = true;
+        break;
+
+    case TYPE_PES:
+    {
+        p_sys->b_end_preparse = true;
+
+        if( p_sys->es_creation == DELAY_ES ) /* No longer delay ES since that pid's program sends data */
         {
-            if( p_pid->type == TYPE_FREE )
-                msg_Dbg( p_demux, "pid[%d] unknown", p_pid->i_pid );
-            p_pid->i_flags |= FLAG_SEEN;
+            msg_Dbg( p_demux, "Creating delayed ES" );
+            DrainProgramWorkers( p_demux );
+            AddAndCreateES( p_demux, p_pid, true );
+            p_sys->b_workers_dirty = true;
         }
 
-        if ( SCRAMBLED(*p_pid) && !p_demux->p_sys->csa )
+        if( !p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
         {
-            PCRHandle( p_demux, p_pid, p_pkt );
+            /* That packet is for an unselected ES, don't waste time/memory gathering its data */
             block_Release( p_pkt );
-            continue;
+            return false;
         }
 
-        /* Probe streams to build PAT/PMT after MIN_PAT_INTERVAL in case we don't see any PAT */
-        if( !SEEN( GetPID( p_sys, 0 ) ) &&
-            (p_pid->probed.i_type == 0 || p_pid->i_pid == p_sys->patfix.i_timesourcepid) &&
-            (p_pkt->p_buffer[1] & 0xC0) == 0x40 && /* Payload start but not corrupt */
-            (p_pkt->p_buffer[3] & 0xD0) == 0x10 )  /* Has payload but is not encrypted */
+        ts_worker_t *p_worker = GetPIDWorker( p_demux, p_pid );
+        if( p_worker )
         {
-            ProbePES( p_demux, p_pid, p_pkt->p_buffer + TS_HEADER_SIZE,
-                      p_pkt->i_buffer - TS_HEADER_SIZE, p_pkt->p_buffer[3] & 0x20 /* Adaptation field */);
+            QueueTSPacket( p_sys, p_worker, p_pid, p_pkt, false );
+            break;
         }
 
-        switch( p_pid->type )
+        /* Packets processed in place must be copied to be kept */
+        if( p_pkt->pf_release == TSPacketNoRelease &&
+            !( p_pkt = CopyTSPacket( p_sys, p_pkt ) ) )
+            return false;
+
+        b_frame = GatherData( p_demux, p_pid, p_pkt );
+        break;
+    }
+
+    case TYPE_SDT:
+    case TYPE_TDT:
+    case TYPE_EIT:
+        if( p_sys->b_dvb_meta && p_sys->p_si_worker )
         {
-        case TYPE_PAT:
-            dvbpsi_packet_push( p_pid->u.p_pat->handle, p_pkt->p_buffer );
-            block_Release( p_pkt );
+            QueueSIPacket( p_demux, p_pid, p_pkt );
             break;
+        }
+        if( p_sys->b_dvb_meta )
+            dvbpsi_packet_push( p_pid->u.p_psi->handle, p_pkt->p_buffer );
+        block_Release( p_pkt );
+        break;
 
-        case TYPE_PMT:
-            dvbpsi_packet_push( p_pid->u.p_pmt->handle, p_pkt->p_buffer );
-            block_Release( p_pkt );
+    default:
+    {
+        ts_worker_t *p_worker = GetPIDWorker( p_demux, p_pid );
+        if( p_worker )
+        {
+            QueueTSPacket( p_sys, p_worker, p_pid, p_pkt, true );
             break;
+        }
+        /* We have to handle PCR if present */
+        PCRHandle( p_demux, p_pid, p_pkt );
+        block_Release( p_pkt );
+        break;
+    }
+    }
 
-        case TYPE_PES:
-            p_sys->b_end_preparse = true;
+    return b_frame;
+}
 
-            if( p_sys->es_creation == DELAY_ES ) /* No longer delay ES since that pid's program sends data */
-            {
-                msg_Dbg( p_demux, "Creating delayed ES" );
-                AddAndCreateES( p_demux, p_pid, true );
-            }
+/*****************************************************************************
+ * Demux:
+ *****************************************************************************/
+static int Demux( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    bool b_wait_es = p_sys->i_pmt_es <= 0;
 
-            if( !p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
-            {
-                /* That packet is for an unselected ES, don't waste time/memory gathering its data */
-                block_Release( p_pkt );
-                continue;
-            }
+    UpdateSIState( p_demux );
 
-            b_frame = GatherData( p_demux, p_pid, p_pkt );
-            break;
+    /* If we had no PAT within MIN_PAT_INTERVAL, create PAT/PMT from probed streams */
+    if( p_sys->i_pmt_es == 0 && !SEEN(GetPID(p_sys, 0)) && p_sys->patfix.b_pat_deadline )
+        MissingPATPMTFixup( p_demux );
 
-        case TYPE_SDT:
-        case TYPE_TDT:
-        case TYPE_EIT:
-            if( p_sys->b_dvb_meta )
-                dvbpsi_packet_push( p_pid->u.p_psi->handle, p_pkt->p_buffer );
-            block_Release( p_pkt );
-            break;
+    /* We read at most 100 TS packet or until a frame is completed */
+    for( unsigned i_pkt = 0; i_pkt < p_sys->i_ts_read; )
+    {
+        /* Process as many packets as possible in place from the stream
+         * buffer, and skip them with a single read */
+        const uint8_t *p_peek;
+        unsigned i_batch = p_sys->i_ts_read - i_pkt;
+        ssize_t i_peek = stream_Peek( p_sys->stream, &p_peek,
+                                      i_batch * p_sys->i_packet_size );
+        unsigned i_done = 0;
+        bool b_stop = false, b_repeek = false;
 
-        default:
-            /* We have to handle PCR if present */
-            PCRHandle( p_demux, p_pid, p_pkt );
-            block_Release( p_pkt );
-            break;
+        i_batch = ( i_peek > 0 ) ? __MIN( i_batch, i_peek / p_sys->i_packet_size ) : 0;
+
+        if( i_batch > 0 && p_sys->b_start_record )
+        {
+            /* Enable recording once synchronized */
+            stream_Control( p_sys->stream, STREAM_SET_RECORD_STATE, true, "ts" );
+            p_sys->b_start_record = false;
+            continue; /* the peek buffer is no longer valid */
+        }
+
+        while( i_done < i_batch && !b_stop && !b_repeek )
+        {
+            const uint8_t *p = &p_peek[i_done * p_sys->i_packet_size
+                                       + p_sys->i_packet_header_size];
+            if( p[0] != 0x47 )
+                break; /* lost synchro, see ReadTSPacket() */
+
+            block_t pkt;
+            block_Init( &pkt, (uint8_t *)p,
+                        p_sys->i_packet_size - p_sys->i_packet_header_size );
+            pkt.pf_release = TSPacketNoRelease;
+
+            /* Probing from the PMT callback seeks and reads the stream:
+             * the rest of the peek buffer is not valid anymore */
+            b_repeek = GetPID( p_sys, PIDGet( &pkt ) )->type == TYPE_PMT;
+
+            i_done++;
+            b_stop = ProcessTSPacket( p_demux, &pkt ) ||
+                     ( b_wait_es && p_sys->i_pmt_es > 0 );
         }
 
-        if( b_frame || ( b_wait_es && p_sys->i_pmt_es > 0 ) )
+        if( i_done > 0 )
+        {
+            stream_Read( p_sys->stream, NULL, i_done * p_sys->i_packet_size );
+            i_pkt += i_done;
+            if( b_stop )
+                break;
+            continue;
+        }
+
+        /* End of stream, truncated or unsynchronized data */
+        block_t *p_pkt = ReadTSPacket( p_demux );
+        if( !p_pkt )
+        {
+            DrainProgramWorkers( p_demux );
+            FlushWorkers( p_demux );
+            return VLC_DEMUXER_EOF;
+        }
+        i_pkt++;
+
+        if( p_sys->b_start_record )
+        {
+            /* Enable recording once synchronized */
+            stream_Control( p_sys->stream, STREAM_SET_RECORD_STATE, true, "ts" );
+            p_sys->b_start_record = false;
+        }
+
+        if( ProcessTSPacket( p_demux, p_pkt ) ||
+            ( b_wait_es && p_sys->i_pmt_es > 0 ) )
             break;
     }
 
+    FlushWorkers( p_demux );
     demux_UpdateTitleFromStream( p_demux );
     return VLC_DEMUXER_SUCCESS;
 }
@@ -1355,26 +2012,45 @@ static int DVBEventInformation( demux_t *p_demux, int64_t *pi_time, int64_t *pi_
     if( pi_time )
         *pi_time = 0;
 
-    if( p_sys->i_dvb_length > 0 )
-    {
-        const int64_t t = mdate() + p_sys->i_tdt_delta;
+    vlc_mutex_lock( &p_sys->si.lock );
+    const int64_t i_start = p_sys->i_dvb_start;
+    const int64_t i_length = p_sys->i_dvb_length;
+    const int64_t t = mdate() + p_sys->i_tdt_delta;
+    vlc_mutex_unlock( &p_sys->si.lock );
 
-        if( p_sys->i_dvb_start <= t && t < p_sys->i_dvb_start + p_sys->i_dvb_length )
+    if( i_length > 0 )
+    {
+        if( i_start <= t && t < i_start + i_length )
         {
             if( pi_length )
-                *pi_length = p_sys->i_dvb_length;
+                *pi_length = i_length;
             if( pi_time )
-                *pi_time   = t - p_sys->i_dvb_start;
+                *pi_time   = t - i_start;
             return VLC_SUCCESS;
         }
     }
     return VLC_EGENERIC;
 }
 
+/* Changes the access filter of a PID only if its state differs */
+static void UpdatePIDFilter( demux_sys_t *p_sys, ts_pid_t *p_pid, bool b_selected )
+{
+    if( !!(p_pid->i_flags & FLAG_FILTERED) != b_selected )
+        SetPIDFilter( p_sys, p_pid, b_selected );
+}
+
 static void UpdatePESFilters( demux_t *p_demux, bool b_all )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
     ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+
+    /* The same PID can belong to several programs (PCR, teletext...), so all
+     * the wanted PIDs are gathered before any filter is removed. */
+    uint32_t wanted[8192 / 32];
+    memset( wanted, 0, sizeof(wanted) );
+#define WANT(pid) (wanted[(pid) >> 5] |= UINT32_C(1) << ((pid) & 31))
+#define WANTED(pid) ((wanted[(pid) >> 5] >> ((pid) & 31)) & 1)
+
     for( int i=0; i< p_pat->programs.i_size; i++ )
     {
         ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
@@ -1384,13 +2060,15 @@ static void UpdatePESFilters( demux_t *p_demux, bool b_all )
         else
              b_program_selected = ProgramIsSelected( p_sys, p_pmt->i_number );
 
-        SetPIDFilter( p_sys, p_pat->programs.p_elems[i], b_program_selected );
+        if( !b_program_selected )
+            continue;
+        WANT( p_pat->programs.p_elems[i]->i_pid );
 
         for( int j=0; j<p_pmt->e_streams.i_size; j++ )
         {
             ts_pid_t *espid = p_pmt->e_streams.p_elems[j];
-            bool b_stream_selected = b_program_selected;
-            if( b_program_selected && !b_all && espid->u.p_pes->es.id )
+            bool b_stream_selected = true;
+            if( !b_all && espid->u.p_pes->es.id )
             {
                 es_out_Control( p_demux->out, ES_OUT_GET_ES_STATE,
                                 espid->u.p_pes->es.id, &b_stream_selected );
@@ -1413,21 +2091,43 @@ static void UpdatePESFilters( demux_t *p_demux, bool b_all )
             }
 
             if( b_stream_selected )
+            {
                 msg_Dbg( p_demux, "enabling pid %d from program %d", espid->i_pid, p_pmt->i_number );
-
-            SetPIDFilter( p_sys, espid, b_stream_selected );
-            if( !b_stream_selected )
-                FlushESBuffer( espid->u.p_pes );
+                WANT( espid->i_pid );
+            }
         }
 
         /* Select pcr last in case it is handled by unselected ES */
         if( p_pmt->i_pid_pcr > 0 )
         {
-            SetPIDFilter( p_sys, GetPID(p_sys, p_pmt->i_pid_pcr), b_program_selected );
-            if( b_program_selected )
-                msg_Dbg( p_demux, "enabling pcr pid %d from program %d", p_pmt->i_pid_pcr, p_pmt->i_number );
+            msg_Dbg( p_demux, "enabling pcr pid %d from program %d", p_pmt->i_pid_pcr, p_pmt->i_number );
+            WANT( p_pmt->i_pid_pcr );
+        }
+    }
+
+    for( int i=0; i< p_pat->programs.i_size; i++ )
+    {
+        ts_pid_t *pmtpid = p_pat->programs.p_elems[i];
+        ts_pmt_t *p_pmt = pmtpid->u.p_pmt;
+
+        UpdatePIDFilter( p_sys, pmtpid, WANTED( pmtpid->i_pid ) );
+
+        for( int j=0; j<p_pmt->e_streams.i_size; j++ )
+        {
+            ts_pid_t *espid = p_pmt->e_streams.p_elems[j];
+            bool b_stream_selected = WANTED( espid->i_pid );
+
+            UpdatePIDFilter( p_sys, espid, b_stream_selected );
+            if( !b_stream_selected )
+                FlushESBuffer( espid->u.p_pes );
         }
+
+        if( p_pmt->i_pid_pcr > 0 )
+            UpdatePIDFilter( p_sys, GetPID(p_sys, p_pmt->i_pid_pcr),
+                             WANTED( p_pmt->i_pid_pcr ) );
     }
+#undef WANTED
+#undef WANT
 }
 
 static int Control( demux_t *p_demux, int i_query, va_list args )
@@ -1441,6 +2141,10 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     ts_pmt_t *p_pmt;
     int i_first_program = ( p_sys->programs.i_size ) ? p_sys->programs.p_elems[0] : 0;
 
+    /* Program states and selection are only touched with idle workers */
+    DrainProgramWorkers( p_demux );
+    p_sys->b_workers_dirty = true;
+
     if( PREPARSING || !i_first_program || p_sys->b_default_selection )
     {
         if( likely(GetPID(p_sys, 0)->type == TYPE_PAT) )
@@ -2331,11 +3035,17 @@ static void ParsePES( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
                 {
                     for( int i = 0; i < pid->u.p_pes->extra_es.i_size; i++ )
                     {
-                        es_out_Send( p_demux->out, pid->u.p_pes->extra_es.p_elems[i]->id,
-                                block_Duplicate( p_block ) );
+                        block_t *p_dup = block_Duplicate( p_block );
+                        if( p_dup )
+                            Output( p_demux, p_pmt->p_worker, (ts_output_t) {
+                                .i_query = TS_OUTPUT_SEND,
+                                .id = pid->u.p_pes->extra_es.p_elems[i]->id,
+                                .u.p_block = p_dup } );
                     }
 
-                    es_out_Send( p_demux->out, pid->u.p_pes->es.id, p_block );
+                    Output( p_demux, p_pmt->p_worker, (ts_output_t) {
+                        .i_query = TS_OUTPUT_SEND, .id = pid->u.p_pes->es.id,
+                        .u.p_block = p_block } );
                 }
             }
             else
@@ -2440,13 +3150,24 @@ static void ParseTableSection( demux_t *p_demux, ts_pid_t *pid, block_t *p_data
                          SetupISO14496LogicalStream( p_demux, &p_mpeg4desc->dec_descr, &fmt ) &&
                          !es_format_IsSimilar( &fmt, &p_es->fmt ) )
                     {
+                        const bool b_same_cat = p_es->id && fmt.i_cat == p_es->fmt.i_cat;
+
                         es_format_Clean( &p_es->fmt );
                         p_es->fmt = fmt;
 
-                        es_out_Del( p_demux->out, p_es->id );
                         p_es->fmt.b_packetized = true; /* Split by access unit, no sync code */
                         FREENULL( p_es->fmt.psz_description );
-                        p_es->id = es_out_Add( p_demux->out, &p_es->fmt );
+                        if( b_same_cat )
+                        {   /* Let the decoder reconfigure itself in place */
+                            es_out_Control( p_demux->out, ES_OUT_SET_ES_FMT,
+                                            p_es->id, &p_es->fmt );
+                        }
+                        else
+                        {
+                            if( p_es->id )
+                                es_out_Del( p_demux->out, p_es->id );
+                            p_es->id = es_out_Add( p_demux->out, &p_es->fmt );
+                        }
                         b_changed = true;
                     }
                 }
@@ -2462,7 +3183,9 @@ static void ParseTableSection( demux_t *p_demux, ts_pid_t *pid, block_t *p_data
     }
 
     if( pid->u.p_pes->es.id )
-        es_out_Send( p_demux->out, pid->u.p_pes->es.id, p_content );
+        Output( p_demux, p_pmt->p_worker, (ts_output_t) {
+            .i_query = TS_OUTPUT_SEND, .id = pid->u.p_pes->es.id,
+            .u.p_block = p_content } );
     else
         block_Release( p_content );
 }
@@ -2494,6 +3217,26 @@ static void ParseData( demux_t *p_demux, ts_pid_t *pid )
     }
 }
 
+static block_t* ReadTSBlock( demux_sys_t *p_sys )
+{
+    if( p_sys->packet_pool == NULL )
+        return stream_Block( p_sys->stream, p_sys->i_packet_size );
+
+    block_t *p_pkt = block_PoolAlloc( p_sys->packet_pool, p_sys->i_packet_size );
+    if( unlikely(p_pkt == NULL) )
+        return NULL;
+
+    ssize_t i_read = stream_Read( p_sys->stream, p_pkt->p_buffer,
+                                  p_sys->i_packet_size );
+    if( i_read <= 0 )
+    {
+        block_Release( p_pkt );
+        return NULL;
+    }
+    p_pkt->i_buffer = i_read;
+    return p_pkt;
+}
+
 static block_t* ReadTSPacket( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -2501,7 +3244,7 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     block_t     *p_pkt;
 
     /* Get a new TS packet */
-    if( !( p_pkt = stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
+    if( !( p_pkt = ReadTSBlock( p_sys ) ) )
     {
         if( stream_Tell( p_sys->stream ) == stream_Size( p_sys->stream ) )
             msg_Dbg( p_demux, "EOF at %"PRId64, stream_Tell( p_sys->stream ) );
@@ -2542,15 +3285,8 @@ static block_t* ReadTSPacket( demux_t *p_demux )
                 return NULL;
             }
 
-            while( i_skip < i_peek - p_sys->i_packet_size )
-            {
-                if( p_peek[i_skip + p_sys->i_packet_header_size] == 0x47 &&
-                        p_peek[i_skip + p_sys->i_packet_header_size + p_sys->i_packet_size] == 0x47 )
-                {
-                    break;
-                }
-                i_skip++;
-            }
+            i_skip = FindSync( p_peek, i_peek, p_sys->i_packet_header_size,
+                               p_sys->i_packet_size );
             msg_Dbg( p_demux, "skipping %d bytes of garbage", i_skip );
             stream_Read( p_sys->stream, NULL, i_skip );
 
@@ -2559,7 +3295,7 @@ static block_t* ReadTSPacket( demux_t *p_demux )
                 break;
             }
         }
-        if( !( p_pkt = stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
+        if( !( p_pkt = ReadTSBlock( p_sys ) ) )
         {
             msg_Dbg( p_demux, "eof ?" );
             return NULL;
@@ -2790,20 +3526,20 @@ static ts_pid_t *GetPID( demux_sys_t *p_sys, uint16_t i_pid )
             return &p_sys->pids.pat;
         case 0x1FFF:
             return &p_sys->pids.dummy;
-        default:
-            if( p_sys->pids.i_last_pid == i_pid )
-                return p_sys->pids.p_last;
-        break;
     }
 
-    for( int i=0; i < p_sys->pids.i_all; i++ )
+    assert( i_pid < 0x1FFF );
+    ts_pid_t ***ppp_page = &p_sys->pids.pp_index[i_pid >> PID_INDEX_BITS];
+    const unsigned i_entry = i_pid & ((1 << PID_INDEX_BITS) - 1);
+
+    if( likely(*ppp_page != NULL) && likely((*ppp_page)[i_entry] != NULL) )
+        return (*ppp_page)[i_entry];
+
+    if( *ppp_page == NULL )
     {
-        if( p_sys->pids.pp_all[i]->i_pid == i_pid )
-        {
-            p_sys->pids.p_last = p_sys->pids.pp_all[i];
-            p_sys->pids.i_last_pid = i_pid;
-            return p_sys->pids.p_last;
-        }
+        *ppp_page = calloc( 1 << PID_INDEX_BITS, sizeof(ts_pid_t *) );
+        if( !*ppp_page )
+            return NULL;
     }
 
     if( p_sys->pids.i_all >= p_sys->pids.i_all_alloc )
@@ -2825,9 +3561,7 @@ static ts_pid_t *GetPID( demux_sys_t *p_sys, uint16_t i_pid )
 
     p_pid->i_pid = i_pid;
     p_sys->pids.pp_all[p_sys->pids.i_all++] = p_pid;
-
-    p_sys->pids.p_last = p_pid;
-    p_sys->pids.i_last_pid = i_pid;
+    (*ppp_page)[i_entry] = p_pid;
 
     return p_pid;
 }
@@ -3011,9 +3745,13 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
         mtime_t i_mindts = -1;
 
         ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+        const ts_pmt_t *p_self = p_pmt;
         for( int i=0; i< p_pat->programs.i_size; i++ )
         {
             ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+            /* Other programs may be demuxed on other threads */
+            if( p_pmt != p_self && ( p_self->p_worker || p_pmt->p_worker ) )
+                continue;
             for( int j=0; j<p_pmt->e_streams.i_size; j++ )
             {
                 ts_pid_t *p_pid = p_pmt->e_streams.p_elems[j];
@@ -3042,8 +3780,9 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
 
     if ( p_sys->i_pmt_es )
     {
-        es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR,
-                        p_pmt->i_number, VLC_TS_0 + i_pcr * 100 / 9 );
+        Output( p_demux, p_pmt->p_worker, (ts_output_t) {
+            .i_query = ES_OUT_SET_GROUP_PCR, .i_group = p_pmt->i_number,
+            .u.i_pcr = VLC_TS_0 + i_pcr * 100 / 9 } );
     }
 }
 
@@ -3068,14 +3807,13 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
     for( int i = 0; i < p_pat->programs.i_size; i++ )
     {
         ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
-        mtime_t i_program_pcr = TimeStampWrapAround( p_pmt, i_pcr );
 
         if( p_pmt->i_pid_pcr == 0x1FFF ) /* That program has no dedicated PCR pid ISO/IEC 13818-1 2.4.4.9 */
         {
             if( pid->p_parent == p_pat->programs.p_elems[i] ) /* PCR shall be on pid itself */
             {
                 /* ? update PCR for the whole group program ? */
-                ProgramSetPCR( p_demux, p_pmt, i_program_pcr );
+                ProgramSetPCR( p_demux, p_pmt, TimeStampWrapAround( p_pmt, i_pcr ) );
             }
         }
         else /* set PCR provided by current pid to program(s) referencing it */
@@ -3084,7 +3822,7 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
             if( p_pmt->i_pid_pcr == pid->i_pid ) /* If that program references current pid as PCR */
             {
                 /* We've found a target group for update */
-                ProgramSetPCR( p_demux, p_pmt, i_program_pcr );
+                ProgramSetPCR( p_demux, p_pmt, TimeStampWrapAround( p_pmt, i_pcr ) );
             }
         }
 
@@ -3156,6 +3894,7 @@ static void PCRFixHandle( demux_t *p_demux, ts_pmt_t *p_pmt, block_t *p_block )
             UpdatePESFilters( p_demux, p_demux->p_sys->b_es_all );
         }
         p_pmt->pcr.b_fix_done = true;
+        p_demux->p_sys->b_workers_dirty = true;
     }
 }
 
@@ -3509,7 +4248,11 @@ static void SDTCallBack( demux_t *p_demux, dvbpsi_sdt_t *p_sdt )
 
     msg_Dbg( p_demux, "SDTCallBack called" );
 
-    if( p_sys->es_creation != CREATE_ES ||
+    vlc_mutex_lock( &p_sys->si.lock );
+    const bool b_create_es = p_sys->si.b_create_es;
+    vlc_mutex_unlock( &p_sys->si.lock );
+
+    if( !b_create_es ||
        !p_sdt->b_current_next ||
         p_sdt->i_version == sdt->u.p_psi->i_version )
     {
@@ -3635,9 +4378,9 @@ static void SDTCallBack( demux_t *p_demux, dvbpsi_sdt_t *p_sdt )
         if( psz_status )
             vlc_meta_AddExtra( p_meta, "Status", psz_status );
 
-        es_out_Control( p_demux->out, ES_OUT_SET_GROUP_META,
-                        p_srv->i_service_id, p_meta );
-        vlc_meta_Delete( p_meta );
+        Output( p_demux, p_sys->p_si_worker, (ts_output_t) {
+            .i_query = ES_OUT_SET_GROUP_META, .i_group = p_srv->i_service_id,
+            .u.p_meta = p_meta } );
     }
 
     sdt->u.p_psi->i_version = p_sdt->i_version;
@@ -3707,12 +4450,53 @@ static void TDTCallBack( demux_t *p_demux, dvbpsi_tot_t *p_tdt )
 {
     demux_sys_t        *p_sys = p_demux->p_sys;
 
+    vlc_mutex_lock( &p_sys->si.lock );
     p_sys->i_tdt_delta = CLOCK_FREQ * EITConvertStartTime( p_tdt->i_utc_time )
                          - mdate();
+    vlc_mutex_unlock( &p_sys->si.lock );
     dvbpsi_tot_delete(p_tdt);
 }
 
 
+/* FNV-1a digest of the content of an EIT, not of its version */
+static uint64_t EITDigestBytes( uint64_t h, const void *p_data, size_t i_data )
+{
+    const uint8_t *p = p_data;
+    for( size_t i = 0; i < i_data; i++ )
+        h = ( h ^ p[i] ) * UINT64_C(0x100000001b3);
+    return h;
+}
+
+static uint64_t EITDigest( const dvbpsi_eit_t *p_eit, bool b_current_following,
+                           bool b_selected )
+{
+    const uint32_t pi_header[] = {
+        p_eit->i_extension, p_eit->i_ts_id, p_eit->i_network_id,
+        b_current_following, b_selected,
+    };
+    uint64_t h = EITDigestBytes( UINT64_C(0xcbf29ce484222325),
+                                 pi_header, sizeof(pi_header) );
+
+    for( const dvbpsi_eit_event_t *p_evt = p_eit->p_first_event; p_evt;
+         p_evt = p_evt->p_next )
+    {
+        const uint64_t pi_event[] = {
+            p_evt->i_event_id, p_evt->i_start_time, p_evt->i_duration,
+            p_evt->i_running_status, p_evt->b_free_ca,
+        };
+        h = EITDigestBytes( h, pi_event, sizeof(pi_event) );
+
+        for( const dvbpsi_descriptor_t *p_dr = p_evt->p_first_descriptor;
+             p_dr; p_dr = p_dr->p_next )
+        {
+            const uint8_t pi_dr[] = { p_dr->i_tag, p_dr->i_length };
+            h = EITDigestBytes( h, pi_dr, sizeof(pi_dr) );
+            h = EITDigestBytes( h, p_dr->p_data, p_dr->i_length );
+        }
+    }
+    return h;
+}
+
 static void EITCallBack( demux_t *p_demux,
                          dvbpsi_eit_t *p_eit, bool b_current_following )
 {
@@ -3727,6 +4511,23 @@ static void EITCallBack( demux_t *p_demux,
         return;
     }
 
+    vlc_mutex_lock( &p_sys->si.lock );
+    const int i_program = p_sys->si.i_program;
+    vlc_mutex_unlock( &p_sys->si.lock );
+
+    /* A new version of a table often carries the same events */
+    const uint64_t i_digest = EITDigest( p_eit, b_current_following,
+                                         i_program == p_eit->i_extension );
+    uint64_t *p_last = &p_sys->si.epg[i_digest % TS_SI_EPG_DIGESTS];
+    if( *p_last == i_digest )
+    {
+        msg_Dbg( p_demux, "unchanged EIT service_id=%d version=%d",
+                 p_eit->i_extension, p_eit->i_version );
+        dvbpsi_eit_delete( p_eit );
+        return;
+    }
+    *p_last = i_digest;
+
     msg_Dbg( p_demux, "new EIT service_id=%d version=%d current_next=%d "
              "ts_id=%d network_id=%d segment_last_section_number=%d "
              "last_table_id=%d",
@@ -3753,7 +4554,11 @@ static void EITCallBack( demux_t *p_demux,
         if( p_sys->arib.e_mode == ARIBMODE_ENABLED )
         {
             if( p_sys->i_tdt_delta == 0 )
+            {
+                vlc_mutex_lock( &p_sys->si.lock );
                 p_sys->i_tdt_delta = CLOCK_FREQ * (i_start + i_duration - 5) - mdate();
+                vlc_mutex_unlock( &p_sys->si.lock );
+            }
 
             i_tot_time = (mdate() + p_sys->i_tdt_delta) / CLOCK_FREQ;
 
@@ -3899,11 +4704,9 @@ static void EITCallBack( demux_t *p_demux,
     if( p_epg->i_event > 0 )
     {
         if( b_current_following &&
-            (  p_sys->programs.i_size == 0 ||
-               p_sys->programs.p_elems[0] ==
-                    p_eit->i_extension
-                ) )
+            ( i_program == 0 || i_program == p_eit->i_extension ) )
         {
+            vlc_mutex_lock( &p_sys->si.lock );
             p_sys->i_dvb_length = 0;
             p_sys->i_dvb_start = 0;
 
@@ -3912,12 +4715,14 @@ static void EITCallBack( demux_t *p_demux,
                 p_sys->i_dvb_start = CLOCK_FREQ * p_epg->p_current->i_start;
                 p_sys->i_dvb_length = CLOCK_FREQ * p_epg->p_current->i_duration;
             }
+            vlc_mutex_unlock( &p_sys->si.lock );
         }
-        es_out_Control( p_demux->out, ES_OUT_SET_GROUP_EPG,
-                        p_eit->i_extension,
-                        p_epg );
+        Output( p_demux, p_sys->p_si_worker, (ts_output_t) {
+            .i_query = ES_OUT_SET_GROUP_EPG, .i_group = p_eit->i_extension,
+            .u.p_epg = p_epg } );
     }
-    vlc_epg_Delete( p_epg );
+    else
+        vlc_epg_Delete( p_epg );
 
     dvbpsi_eit_delete( p_eit );
 }
@@ -5619,11 +6424,15 @@ static ts_pmt_t *ts_pmt_New( demux_t *p_demux )
 
     pmt->pcr.b_fix_done = false;
 
+    pmt->p_worker = NULL;
+
     return pmt;
 }
 
 static void ts_pmt_Del( demux_t *p_demux, ts_pmt_t *pmt )
 {
+    if( pmt->p_worker )
+        ts_worker_Delete( pmt->p_worker );
     if( dvbpsi_decoder_present( pmt->handle ) )
         dvbpsi_pmt_detach( pmt->handle );
     dvbpsi_delete( pmt->handle );
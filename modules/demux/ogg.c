@@ -345,6 +345,7 @@ static int Demux( demux_t * p_demux )
      * And, as we all know, seeking without having backed up all headers is bad, since the
      * codec will fail to initialize if it's missing its headers.
      */
+    int64_t i_page_pos = -1;
     if( !p_sys->b_page_waiting)
     {
         /*
@@ -352,6 +353,8 @@ static int Demux( demux_t * p_demux )
          */
         if( Ogg_ReadPage( p_demux, &p_sys->current_page ) != VLC_SUCCESS )
             return VLC_DEMUXER_EOF; /* EOF */
+        i_page_pos = stream_Tell( p_demux->s ) - ( p_sys->oy.fill - p_sys->oy.returned )
+                   - p_sys->current_page.header_len - p_sys->current_page.body_len;
         /* Test for End of Stream */
         if( ogg_page_eos( &p_sys->current_page ) )
         {
@@ -445,6 +448,14 @@ static int Demux( demux_t * p_demux )
         while( ogg_stream_packetout( &p_stream->os, &oggpacket ) > 0 )
         {
             i_real_page_packets++;
+
+            /* index the keyframes starting a page, to seek back to them */
+            if( i_real_page_packets == 1 && i_page_pos >= 0 &&
+                !ogg_page_continued( &p_sys->current_page ) &&
+                p_sys->i_nzpcr_offset == 0 && p_stream->i_pcr > VLC_TS_0 &&
+                p_stream->i_secondary_header_packets == 0 )
+                OggSeek_IndexPage( p_stream, &oggpacket,
+                                   p_stream->i_pcr - VLC_TS_0, i_page_pos );
             int i_max_packets = __MAX(i_page_packets, i_real_page_packets);
             if ( b_doprepcr && p_stream->prepcr.i_size < i_max_packets )
             {
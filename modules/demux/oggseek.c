@@ -138,7 +138,7 @@ const demux_index_entry_t *OggSeek_IndexAdd ( logical_stream_t *p_stream,
     else
     {
         idx->p_next = oidx;
-        oidx = idx;
+        p_stream->idx = idx;
     }
 
     if ( idx->p_next != NULL )
@@ -152,6 +152,38 @@ const demux_index_entry_t *OggSeek_IndexAdd ( logical_stream_t *p_stream,
     return idx;
 }
 
+/* Indexes the page starting at i_pagepos, while demuxing, if its first packet
+ * is a keyframe of a stream in which keyframes can be told from their data.
+ * i_timestamp is the time of the previous packets, which the keyframe does
+ * not precede. */
+void OggSeek_IndexPage ( logical_stream_t *p_stream, ogg_packet *p_packet,
+                         int64_t i_timestamp, int64_t i_pagepos )
+{
+    if ( p_stream->fmt.i_cat != VIDEO_ES && p_stream->fmt.i_cat != AUDIO_ES )
+        return;
+    /* their keyframe info is in the granule of the last packet of the page */
+    if ( p_stream->fmt.i_codec == VLC_CODEC_VP8 ||
+         p_stream->fmt.i_codec == VLC_CODEC_DIRAC )
+        return;
+    if ( !Ogg_IsKeyFrame( p_stream, p_packet ) )
+        return;
+
+    /* keep the index sparse */
+    for ( const demux_index_entry_t *idx = p_stream->idx; idx; idx = idx->p_next )
+    {
+        if ( idx->i_value > i_timestamp - OGGSEEK_INDEX_INTERVAL &&
+             idx->i_value < i_timestamp + OGGSEEK_INDEX_INTERVAL )
+            return;
+        if ( idx->i_pagepos > i_pagepos )
+            break;
+    }
+
+    OggSeek_IndexAdd( p_stream, i_timestamp, i_pagepos );
+}
+
+/* Sets the bounds of i_timestamp from the index. Returns true only if the
+ * lower one is close enough to seek there directly, as the index may have
+ * been built only from parts of the stream. */
 static bool OggSeekIndexFind ( logical_stream_t *p_stream, int64_t i_timestamp,
                                int64_t *pi_pos_lower, int64_t *pi_pos_upper )
 {
@@ -164,13 +196,13 @@ static bool OggSeekIndexFind ( logical_stream_t *p_stream, int64_t i_timestamp,
             if ( !idx->p_next ) /* found on last index */
             {
                 *pi_pos_lower = idx->i_pagepos;
-                return true;
+                return i_timestamp - idx->i_value < OGGSEEK_INDEX_INTERVAL;
             }
             if ( idx->p_next->i_value > i_timestamp )
             {
                 *pi_pos_lower = idx->i_pagepos;
                 *pi_pos_upper = idx->p_next->i_pagepos;
-                return true;
+                return i_timestamp - idx->i_value < OGGSEEK_INDEX_INTERVAL;
             }
         }
         idx = idx->p_next;
@@ -752,6 +784,7 @@ static int64_t OggBisectSearchByTime( demux_t *p_demux, logical_stream_t *p_stre
     int64_t i_start_pos;
     int64_t i_end_pos;
     int64_t i_segsize;
+    int64_t i_span = 64; /* from a probe to the page it finds */
 
     struct
     {
@@ -815,6 +848,11 @@ static int64_t OggBisectSearchByTime( demux_t *p_demux, logical_stream_t *p_stre
         {
             /* found a page */
 
+            /* probes closer than that mostly find the same pages again, and
+             * each of them reads that much anyway */
+            i_span = __MAX( 64, current.i_pos - i_start_pos );
+            i_span = __MIN( i_span, OGGSEEK_BYTES_TO_READ );
+
             if ( current.i_timestamp <= i_targettime )
             {
                 /* set our lower bound */
@@ -845,7 +883,7 @@ static int64_t OggBisectSearchByTime( demux_t *p_demux, logical_stream_t *p_stre
         i_segsize = ( i_end_pos - i_start_pos + 1 ) >> 1;
         i_start_pos += i_segsize;
 
-    } while ( i_segsize > 64 );
+    } while ( i_segsize > ( bestlower.i_granule != -1 ? i_span : 64 ) );
 
     if ( bestlower.i_granule == -1 )
     {
@@ -918,11 +956,13 @@ int Oggseek_BlindSeektoAbsoluteTime( demux_t *p_demux, logical_stream_t *p_strea
         b_found = true;
     }
 
-    /* or search */
+    /* or search, within the bounds from the index if any */
     if ( !b_found && b_fastseek )
     {
         i_lowerpos = OggBisectSearchByTime( p_demux, p_stream, i_time,
-                                            p_stream->i_data_start, p_sys->i_total_length );
+                                            __MAX( i_lowerpos, p_stream->i_data_start ),
+                                            i_upperpos );
+        i_upperpos = -1;
         b_found = ( i_lowerpos != -1 );
     }
 
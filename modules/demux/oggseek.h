@@ -30,6 +30,9 @@
 
 #define OGGSEEK_BYTES_TO_READ 8500
 
+/* minimum time between the keyframes indexed while demuxing */
+#define OGGSEEK_INDEX_INTERVAL ( CLOCK_FREQ * 2 )
+
 /* index entries are structured as follows:
  *   - for theora, highest granulepos -> pagepos (bytes) where keyframe begins
  *  - for dirac, kframe (sync point) -> pagepos of sequence start (?)
@@ -58,6 +61,7 @@ int     Oggseek_BlindSeektoAbsoluteTime ( demux_t *, logical_stream_t *, int64_t
 int     Oggseek_BlindSeektoPosition ( demux_t *, logical_stream_t *, double f, bool );
 int     Oggseek_SeektoAbsolutetime ( demux_t *, logical_stream_t *, int64_t i_granulepos );
 const demux_index_entry_t *OggSeek_IndexAdd ( logical_stream_t *, int64_t, int64_t );
+void    OggSeek_IndexPage ( logical_stream_t *, ogg_packet *, int64_t, int64_t );
 void    Oggseek_ProbeEnd( demux_t * );
 
 void oggseek_index_entries_free ( demux_index_entry_t * );
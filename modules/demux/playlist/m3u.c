@@ -36,6 +36,10 @@
 
 #include "playlist.h"
 
+/* Entries posted at once: the first ones show up in the playlist while the
+ * rest of a large file is being parsed */
+#define M3U_BATCH 1000
+
 struct demux_sys_t
 {
     char *psz_prefix;
@@ -172,6 +176,7 @@ static int Demux( demux_t *p_demux )
     char *    (*pf_dup) (const char *) = p_demux->p_sys->pf_dup;
     int        i_options = 0;
     bool b_cleanup = false;
+    int        i_entries = 0;
     input_item_t *p_input;
 
     input_item_t *p_current_input = GetCurrentItem(p_demux);
@@ -269,13 +274,15 @@ static int Demux( demux_t *p_demux )
 
             input_item_node_AppendItem( p_subitems, p_input );
             vlc_gc_decref( p_input );
+            i_entries++;
         }
 
  error:
 
-        /* Fetch another line */
+        /* Fetch another line, unless the batch is complete */
         free( psz_line );
-        psz_line = stream_ReadLine( p_demux->s );
+        psz_line = ( i_entries < M3U_BATCH ) ? stream_ReadLine( p_demux->s )
+                                             : NULL;
         if( !psz_line ) b_cleanup = true;
 
         if( b_cleanup )
@@ -293,6 +300,14 @@ static int Demux( demux_t *p_demux )
             b_cleanup = false;
         }
     }
+    if( i_entries >= M3U_BATCH )
+    {   /* Parse the next batch on the next call */
+        p_subitems->b_partial = true;
+        input_item_node_PostAndDelete( p_subitems );
+        vlc_gc_decref(p_current_input);
+        return 1;
+    }
+
     input_item_node_PostAndDelete( p_subitems );
     vlc_gc_decref(p_current_input);
     var_Destroy( p_demux, "m3u-extvlcopt" );
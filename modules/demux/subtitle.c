@@ -57,6 +57,10 @@ static void Close( vlc_object_t *p_this );
     N_("Force the subtiles format. Selecting \"auto\" means autodetection and should always work.")
 #define SUB_DESCRIPTION_LONGTEXT \
     N_("Override the default track description.")
+#define SUB_INDEX_LONGTEXT \
+    N_("SubRip, SubViewer, WebVTT and SBV files bigger than this size " \
+    "(in MiB) are parsed on demand around the playback position, rather " \
+    "than loaded at once. 0 always loads the whole file.")
 
 static const char *const ppsz_sub_type[] =
 {
@@ -83,6 +87,8 @@ vlc_module_begin ()
         change_string_list( ppsz_sub_type, ppsz_sub_type )
     add_string( "sub-description", NULL, N_("Subtitle description"),
                 SUB_DESCRIPTION_LONGTEXT, true )
+    add_integer( "sub-index-size", 32, N_("On-demand parsing size"),
+                 SUB_INDEX_LONGTEXT, true )
     set_callbacks( Open, Close )
 
     add_shortcut( "subtitle" )
@@ -122,6 +128,11 @@ typedef struct
     int     i_line_count;
     int     i_line;
     char    **line;
+
+    /* Lines read from the stream one at a time, when parsing on demand */
+    stream_t *s;
+    char     *psz_line;
+    bool     b_previous;
 } text_t;
 
 static int  TextLoad( text_t *, stream_t *s );
@@ -135,6 +146,16 @@ typedef struct
     char    *psz_text;
 } subtitle_t;
 
+/* Entry of the index for on-demand parsing */
+typedef struct
+{
+    uint64_t i_offset; /* stream offset to parse the subtitle from */
+    int64_t  i_start;
+} sub_index_point_t;
+
+/* Minimum distance between the points of the index */
+#define SUB_INDEX_INTERVAL (256 * 1024)
+
 
 struct demux_sys_t
 {
@@ -152,6 +173,21 @@ struct demux_sys_t
 
     int64_t     i_length;
 
+    int         (*pf_read)( demux_t *, subtitle_t *, int );
+
+    /* On-demand parsing: only the next subtitle is kept, and an index of
+     * the start time at some offsets in the stream is used for seeking */
+    struct
+    {
+        bool              b_enabled;
+        bool              b_current;
+        subtitle_t        current; /* next subtitle to send */
+        uint64_t          i_data;  /* offset of the first subtitle */
+        uint64_t          i_size;
+        int               i_points;
+        sub_index_point_t *point;  /* sorted by offset */
+    } index;
+
     /* */
     struct
     {
@@ -228,6 +264,11 @@ static int Control( demux_t *, int, va_list );
 static void Fix( demux_t * );
 static char * get_language_from_filename( const char * );
 
+static int  IndexOpen( demux_t * );
+static void IndexClose( demux_t * );
+static int  IndexSeek( demux_t *, int64_t );
+static int  IndexDemux( demux_t *, int64_t );
+
 /*****************************************************************************
  * Module initializer
  *****************************************************************************/
@@ -257,6 +298,8 @@ static int Open ( vlc_object_t *p_this )
     p_sys->i_subtitle         = 0;
     p_sys->i_subtitles        = 0;
     p_sys->subtitle           = NULL;
+    p_sys->index.b_enabled    = false;
+    p_sys->txt.s              = NULL;
     p_sys->i_microsecperframe = 40000;
 
     p_sys->jss.b_inited       = false;
@@ -501,46 +544,57 @@ static int Open ( vlc_object_t *p_this )
         }
     }
 
-    msg_Dbg( p_demux, "loading all subtitles..." );
+    p_sys->pf_read = pf_read;
 
-    /* Load the whole file */
-    TextLoad( &p_sys->txt, p_demux->s );
-
-    /* Parse it */
-    for( i_max = 0;; )
+    /* Parse big files on demand */
+    if( IndexOpen( p_demux ) == VLC_SUCCESS )
     {
-        if( p_sys->i_subtitles >= i_max )
+        p_sys->index.b_enabled = true;
+        msg_Dbg( p_demux, "parsing subtitles on demand" );
+    }
+    else
+    {
+        msg_Dbg( p_demux, "loading all subtitles..." );
+
+        /* Load the whole file */
+        TextLoad( &p_sys->txt, p_demux->s );
+
+        /* Parse it */
+        for( i_max = 0;; )
         {
-            i_max += 500;
-            if( !( p_sys->subtitle = realloc_or_free( p_sys->subtitle,
-                                              sizeof(subtitle_t) * i_max ) ) )
+            if( p_sys->i_subtitles >= i_max )
             {
-                TextUnload( &p_sys->txt );
-                free( p_sys );
-                return VLC_ENOMEM;
+                i_max += 500;
+                if( !( p_sys->subtitle = realloc_or_free( p_sys->subtitle,
+                                                  sizeof(subtitle_t) * i_max ) ) )
+                {
+                    TextUnload( &p_sys->txt );
+                    free( p_sys );
+                    return VLC_ENOMEM;
+                }
             }
-        }
 
-        if( pf_read( p_demux, &p_sys->subtitle[p_sys->i_subtitles],
-                     p_sys->i_subtitles ) )
-            break;
+            if( pf_read( p_demux, &p_sys->subtitle[p_sys->i_subtitles],
+                         p_sys->i_subtitles ) )
+                break;
 
-        p_sys->i_subtitles++;
-    }
-    /* Unload */
-    TextUnload( &p_sys->txt );
+            p_sys->i_subtitles++;
+        }
+        /* Unload */
+        TextUnload( &p_sys->txt );
 
-    msg_Dbg(p_demux, "loaded %d subtitles", p_sys->i_subtitles );
+        msg_Dbg(p_demux, "loaded %d subtitles", p_sys->i_subtitles );
 
-    /* Fix subtitle (order and time) *** */
-    p_sys->i_subtitle = 0;
-    p_sys->i_length = 0;
-    if( p_sys->i_subtitles > 0 )
-    {
-        p_sys->i_length = p_sys->subtitle[p_sys->i_subtitles-1].i_stop;
-        /* +1 to avoid 0 */
-        if( p_sys->i_length <= 0 )
-            p_sys->i_length = p_sys->subtitle[p_sys->i_subtitles-1].i_start+1;
+        /* Fix subtitle (order and time) *** */
+        p_sys->i_subtitle = 0;
+        p_sys->i_length = 0;
+        if( p_sys->i_subtitles > 0 )
+        {
+            p_sys->i_length = p_sys->subtitle[p_sys->i_subtitles-1].i_stop;
+            /* +1 to avoid 0 */
+            if( p_sys->i_length <= 0 )
+                p_sys->i_length = p_sys->subtitle[p_sys->i_subtitles-1].i_start+1;
+        }
     }
 
     /* *** add subtitle ES *** */
@@ -591,6 +645,8 @@ static void Close( vlc_object_t *p_this )
     demux_sys_t *p_sys = p_demux->p_sys;
     int i;
 
+    if( p_sys->index.b_enabled )
+        IndexClose( p_demux );
     for( i = 0; i < p_sys->i_subtitles; i++ )
         free( p_sys->subtitle[i].psz_text );
     free( p_sys->subtitle );
@@ -608,6 +664,38 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     int64_t *pi64, i64;
     double *pf, f;
 
+    if( p_sys->index.b_enabled )
+    {
+        switch( i_query )
+        {
+            case DEMUX_GET_TIME:
+                pi64 = (int64_t*)va_arg( args, int64_t * );
+                if( !p_sys->index.b_current )
+                    return VLC_EGENERIC;
+                *pi64 = p_sys->index.current.i_start;
+                return VLC_SUCCESS;
+
+            case DEMUX_SET_TIME:
+                i64 = (int64_t)va_arg( args, int64_t );
+                return IndexSeek( p_demux, i64 );
+
+            case DEMUX_GET_POSITION:
+                pf = (double*)va_arg( args, double * );
+                if( !p_sys->index.b_current )
+                    *pf = 1.0;
+                else if( p_sys->i_length > 0 )
+                    *pf = (double)p_sys->index.current.i_start /
+                          (double)p_sys->i_length;
+                else
+                    *pf = 0.0;
+                return VLC_SUCCESS;
+
+            case DEMUX_SET_POSITION:
+                f = (double)va_arg( args, double );
+                return IndexSeek( p_demux, f * p_sys->i_length );
+        }
+    }
+
     switch( i_query )
     {
         case DEMUX_GET_LENGTH:
@@ -701,6 +789,10 @@ static int Demux( demux_t *p_demux )
     demux_sys_t *p_sys = p_demux->p_sys;
     int64_t i_maxdate;
 
+    if( p_sys->index.b_enabled )
+        return IndexDemux( p_demux, p_sys->i_next_demux_date -
+                           var_GetInteger( p_demux->p_parent, "spu-delay" ) );
+
     if( p_sys->i_subtitle >= p_sys->i_subtitles )
         return 0;
 
@@ -785,6 +877,258 @@ static void Fix( demux_t *p_demux )
     } while( !b_done );
 }
 
+/*****************************************************************************
+ * On-demand parsing
+ *****************************************************************************
+ * The subtitles are parsed from the stream as they are needed. The index
+ * keeps the start time of the subtitles parsed at some offsets, at least
+ * SUB_INDEX_INTERVAL bytes apart, and seeking bisects the stream between the
+ * closest known points, so that only a few subtitles are parsed.
+ *****************************************************************************/
+static void IndexAddPoint( demux_sys_t *p_sys, uint64_t i_offset,
+                           int64_t i_start )
+{
+    int i = 0;
+
+    /* Keep the points sorted and away from each other */
+    while( i < p_sys->index.i_points &&
+           p_sys->index.point[i].i_offset < i_offset )
+        i++;
+    if( i > 0 &&
+        i_offset - p_sys->index.point[i - 1].i_offset < SUB_INDEX_INTERVAL )
+        return;
+    if( i < p_sys->index.i_points &&
+        p_sys->index.point[i].i_offset - i_offset < SUB_INDEX_INTERVAL )
+        return;
+
+    sub_index_point_t *point = realloc( p_sys->index.point,
+                            sizeof( *point ) * ( p_sys->index.i_points + 1 ) );
+    if( point == NULL )
+        return;
+    memmove( &point[i + 1], &point[i],
+             sizeof( *point ) * ( p_sys->index.i_points - i ) );
+    point[i].i_offset = i_offset;
+    point[i].i_start = i_start;
+    p_sys->index.point = point;
+    p_sys->index.i_points++;
+}
+
+/* Seeks to an offset, skipping the partial line if not at a line start */
+static int IndexSeekOffset( demux_t *p_demux, uint64_t i_offset, bool b_sync )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    free( p_sys->txt.psz_line );
+    p_sys->txt.psz_line = NULL;
+    p_sys->txt.b_previous = false;
+
+    if( stream_Seek( p_demux->s, i_offset ) )
+        return VLC_EGENERIC;
+    if( b_sync && i_offset > p_sys->index.i_data )
+        free( stream_ReadLine( p_demux->s ) );
+    return VLC_SUCCESS;
+}
+
+/* Parses the subtitle following the current stream position */
+static int IndexParse( demux_t *p_demux, subtitle_t *p_subtitle,
+                       uint64_t *pi_offset )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    uint64_t i_offset = stream_Tell( p_demux->s );
+
+    if( p_sys->pf_read( p_demux, p_subtitle, 0 ) )
+        return VLC_EGENERIC;
+
+    IndexAddPoint( p_sys, i_offset, p_subtitle->i_start );
+    if( pi_offset != NULL )
+        *pi_offset = i_offset;
+    return VLC_SUCCESS;
+}
+
+/* Parses the next subtitle to send */
+static void IndexNext( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->index.b_current )
+        free( p_sys->index.current.psz_text );
+    p_sys->index.b_current =
+        IndexParse( p_demux, &p_sys->index.current, NULL ) == VLC_SUCCESS;
+}
+
+static int IndexOpen( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const int64_t i_threshold = var_InheritInteger( p_demux, "sub-index-size" );
+    const uint8_t *p_data;
+    bool b_seekable;
+
+    switch( p_sys->i_type )
+    {
+        case SUB_TYPE_SUBRIP:
+        case SUB_TYPE_SUBVIEWER:
+        case SUB_TYPE_VTT:
+        case SUB_TYPE_SBV:
+            break;
+        default: /* the other parsers depend on the previous subtitles */
+            return VLC_EGENERIC;
+    }
+
+    uint64_t i_size = stream_Size( p_demux->s );
+    if( i_threshold <= 0 || i_size < (uint64_t)i_threshold * 1024 * 1024 )
+        return VLC_EGENERIC;
+    if( stream_Control( p_demux->s, STREAM_CAN_FASTSEEK, &b_seekable )
+     || !b_seekable )
+        return VLC_EGENERIC;
+    /* Offsets in UTF-16 text cannot be resynchronized simply */
+    uint64_t i_data = stream_Tell( p_demux->s );
+    if( stream_Seek( p_demux->s, 0 ) == VLC_SUCCESS &&
+        stream_Peek( p_demux->s, &p_data, 2 ) >= 2 &&
+        ( !memcmp( p_data, "\xFF\xFE", 2 ) || !memcmp( p_data, "\xFE\xFF", 2 ) ) )
+    {
+        stream_Seek( p_demux->s, i_data );
+        return VLC_EGENERIC;
+    }
+
+    p_sys->index.b_current = false;
+    p_sys->index.i_data    = i_data;
+    p_sys->index.i_size    = i_size;
+    p_sys->index.i_points  = 0;
+    p_sys->index.point     = NULL;
+    p_sys->txt.s           = p_demux->s;
+    p_sys->txt.psz_line    = NULL;
+    p_sys->txt.b_previous  = false;
+
+    /* The length is the end of the last subtitles */
+    subtitle_t sub;
+    p_sys->i_length = 0;
+    if( IndexSeekOffset( p_demux, __MAX( i_data, i_size - SUB_INDEX_INTERVAL ),
+                         true ) == VLC_SUCCESS )
+    {
+        while( IndexParse( p_demux, &sub, NULL ) == VLC_SUCCESS )
+        {
+            p_sys->i_length = __MAX( p_sys->i_length, sub.i_stop );
+            free( sub.psz_text );
+        }
+    }
+
+    if( IndexSeekOffset( p_demux, i_data, false ) )
+    {
+        IndexClose( p_demux );
+        return VLC_EGENERIC;
+    }
+    IndexNext( p_demux );
+    return VLC_SUCCESS;
+}
+
+static void IndexClose( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->index.b_current )
+        free( p_sys->index.current.psz_text );
+    free( p_sys->index.point );
+    free( p_sys->txt.psz_line );
+    p_sys->txt.s = NULL;
+}
+
+static int IndexSeek( demux_t *p_demux, int64_t i_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    uint64_t i_low = p_sys->index.i_data;
+    uint64_t i_high = p_sys->index.i_size;
+
+    /* Start from the known points around the time */
+    for( int i = 0; i < p_sys->index.i_points; i++ )
+    {
+        const sub_index_point_t *point = &p_sys->index.point[i];
+
+        if( point->i_start < i_time )
+            i_low = point->i_offset;
+        else
+        {
+            i_high = point->i_offset;
+            break;
+        }
+    }
+
+    /* Bisect until the subtitles can be parsed through */
+    while( i_high - i_low > SUB_INDEX_INTERVAL )
+    {
+        const uint64_t i_middle = i_low + ( i_high - i_low ) / 2;
+        uint64_t i_offset;
+        subtitle_t sub;
+
+        if( IndexSeekOffset( p_demux, i_middle, true ) ||
+            IndexParse( p_demux, &sub, &i_offset ) )
+        {
+            i_high = i_middle;
+            continue;
+        }
+        free( sub.psz_text );
+
+        if( sub.i_start < i_time )
+            i_low = i_offset;
+        else
+            i_high = i_middle;
+    }
+
+    /* Find the first subtitle to display from there */
+    if( IndexSeekOffset( p_demux, i_low, false ) )
+        return VLC_EGENERIC;
+    for( IndexNext( p_demux ); p_sys->index.b_current; IndexNext( p_demux ) )
+    {
+        const subtitle_t *p_subtitle = &p_sys->index.current;
+
+        if( p_subtitle->i_start > i_time )
+            break;
+        if( p_subtitle->i_stop > p_subtitle->i_start && p_subtitle->i_stop > i_time )
+            break;
+    }
+    return p_sys->index.b_current ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+static int IndexDemux( demux_t *p_demux, int64_t i_maxdate )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->index.b_current )
+        return 0;
+
+    if( i_maxdate <= 0 )
+    {
+        /* Should not happen */
+        i_maxdate = p_sys->index.current.i_start + 1;
+    }
+
+    while( p_sys->index.b_current &&
+           p_sys->index.current.i_start < i_maxdate )
+    {
+        const subtitle_t *p_subtitle = &p_sys->index.current;
+        int i_len = strlen( p_subtitle->psz_text ) + 1;
+        block_t *p_block;
+
+        if( i_len > 1 && p_subtitle->i_start >= 0 &&
+            ( p_block = block_Alloc( i_len ) ) != NULL )
+        {
+            p_block->i_dts =
+            p_block->i_pts = VLC_TS_0 + p_subtitle->i_start;
+            if( p_subtitle->i_stop >= 0 && p_subtitle->i_stop >= p_subtitle->i_start )
+                p_block->i_length = p_subtitle->i_stop - p_subtitle->i_start;
+
+            memcpy( p_block->p_buffer, p_subtitle->psz_text, i_len );
+
+            es_out_Send( p_demux->out, p_sys->es, p_block );
+        }
+        IndexNext( p_demux );
+    }
+
+    /* */
+    p_sys->i_next_demux_date = 0;
+
+    return 1;
+}
+
 static int TextLoad( text_t *txt, stream_t *s )
 {
     int   i_line_max;
@@ -838,6 +1182,19 @@ static void TextUnload( text_t *txt )
 
 static char *TextGetLine( text_t *txt )
 {
+    if( txt->s != NULL )
+    {
+        /* The line is only valid until the next call */
+        if( txt->b_previous )
+        {
+            txt->b_previous = false;
+            return txt->psz_line;
+        }
+        free( txt->psz_line );
+        txt->psz_line = stream_ReadLine( txt->s );
+        return txt->psz_line;
+    }
+
     if( txt->i_line >= txt->i_line_count )
         return( NULL );
 
@@ -845,6 +1202,13 @@ static char *TextGetLine( text_t *txt )
 }
 static void TextPreviousLine( text_t *txt )
 {
+    if( txt->s != NULL )
+    {
+        if( txt->psz_line != NULL )
+            txt->b_previous = true;
+        return;
+    }
+
     if( txt->i_line > 0 )
         txt->i_line--;
 }
@@ -61,6 +61,7 @@ void PLItem::init( playlist_item_t *_playlist_item, PLItem *parent )
     i_playlist_id = _playlist_item->i_id;           /* Playlist item specific id */
     p_input = _playlist_item->p_input;
     vlc_gc_incref( p_input );
+    b_fetched = true;
 }
 
 /*
@@ -29,6 +29,7 @@
 #endif
 
 #include <QList>
+#include <QHash>
 #include <QString>
 #include <QUrl>
 
@@ -95,6 +96,8 @@ private:
     void init( playlist_item_t *, PLItem * );
     int i_playlist_id;
     input_item_t *p_input;
+    bool b_fetched; /* children populated (see PLModel::fetchMore()) */
+    QHash<int, QString> displayData; /* cached column text, by meta */
 };
 
 #endif
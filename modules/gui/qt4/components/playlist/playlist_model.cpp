@@ -56,6 +56,13 @@ PLModel::PLModel( playlist_t *_p_playlist,  /* THEPL */
     rootItem          = NULL; /* PLItem rootItem, will be set in rebuild( ) */
     latestSearch      = QString();
 
+    /* The playlist events come in bursts when adding or removing many
+     * items: they are coalesced and applied in batches */
+    updateTimer = new QTimer( this );
+    updateTimer->setSingleShot( true );
+    updateTimer->setInterval( PLMODEL_UPDATE_DELAY );
+    CONNECT( updateTimer, timeout(), this, processPendingUpdates() );
+
     rebuild( p_root );
     DCONNECT( THEMIM->getIM(), metaChanged( input_item_t *),
               this, processInputItemUpdate( input_item_t *) );
@@ -334,9 +341,16 @@ QVariant PLModel::data( const QModelIndex &index, const int role ) const
         }
         else
         {
+            /* Cached, not to lock the input item on every paint */
+            QHash<int, QString>::const_iterator it =
+                item->displayData.constFind( metadata );
+            if( it != item->displayData.constEnd() )
+                return QVariant( *it );
+
             char *psz = psz_column_meta( item->inputItem(), metadata );
             returninfo = qfu( psz );
             free( psz );
+            item->displayData.insert( metadata, returninfo );
         }
         return QVariant( returninfo );
     }
@@ -500,6 +514,45 @@ int PLModel::rowCount( const QModelIndex &parent ) const
     return parentItem->childCount();
 }
 
+bool PLModel::hasChildren( const QModelIndex &parent ) const
+{
+    PLItem *parentItem = parent.isValid() ? getItem( parent ) : rootItem;
+    return !parentItem->b_fetched || parentItem->childCount() > 0;
+}
+
+bool PLModel::canFetchMore( const QModelIndex &parent ) const
+{
+    return parent.isValid() && !getItem( parent )->b_fetched;
+}
+
+/* Populates a huge node left empty by updateChildren() */
+void PLModel::fetchMore( const QModelIndex &parent )
+{
+    if( !canFetchMore( parent ) ) return;
+    PLItem *item = getItem( parent );
+
+    PL_LOCK;
+    playlist_item_t *p_node =
+        playlist_ItemGetById( p_playlist, item->id( PLAYLIST_ID ) );
+    if( !p_node )
+    {
+        PL_UNLOCK;
+        return;
+    }
+
+    int count = 0;
+    for( int i = 0; i < p_node->i_children; i++ )
+        if( !( p_node->pp_children[i]->i_flags & PLAYLIST_DBL_FLAG ) )
+            count++;
+
+    if( count )
+        beginInsertRows( parent, 0, count - 1 );
+    updateChildren( p_node, item );
+    if( count )
+        endInsertRows();
+    PL_UNLOCK;
+}
+
 /************************* Lookups *****************************/
 PLItem *PLModel::findByPLId( PLItem *root, int i_plitemid ) const
 {
@@ -593,53 +646,143 @@ void PLModel::processInputItemUpdate( )
 void PLModel::processInputItemUpdate( input_item_t *p_item )
 {
     if( !p_item ||  p_item->i_id <= 0 ) return;
-    PLItem *item = findByInputId( rootItem, p_item->i_id );
-    if( item )
-        updateTreeItem( item );
+    pendingUpdates.insert( p_item->i_id );
+    if( !updateTimer->isActive() ) updateTimer->start();
 }
 
 void PLModel::processItemRemoval( int i_pl_itemid )
 {
     if( i_pl_itemid <= 0 ) return;
-    removeItem( findByPLId( rootItem, i_pl_itemid ) );
+    pendingRemovals.insert( i_pl_itemid );
+    if( !updateTimer->isActive() ) updateTimer->start();
 }
 
 void PLModel::processItemAppend( int i_pl_itemid, int i_pl_itemidparent )
 {
-    playlist_item_t *p_item = NULL;
-    PLItem *newItem = NULL;
-    int pos;
+    pendingAppends.append( qMakePair( i_pl_itemid, i_pl_itemidparent ) );
+    if( !updateTimer->isActive() ) updateTimer->start();
+}
 
-    /* Find the Parent */
-    PLItem *nodeParentItem = findByPLId( rootItem, i_pl_itemidparent );
-    if( !nodeParentItem ) return;
+void PLModel::processPendingUpdates()
+{
+    if( pendingRemovals.contains( rootItem->id( PLAYLIST_ID ) ) )
+    {
+        pendingAppends.clear();
+        pendingRemovals.clear();
+        pendingUpdates.clear();
+        removeItem( rootItem ); /* rebuilds everything */
+        return;
+    }
 
-    /* Search for an already matching children */
-    foreach( AbstractPLItem *existing, nodeParentItem->children )
-        if( existing->id( PLAYLIST_ID ) == i_pl_itemid ) return;
+    if( !pendingRemovals.isEmpty() || !pendingUpdates.isEmpty() )
+        processPendingItems( rootItem );
+    pendingRemovals.clear();
+    pendingUpdates.clear();
 
-    /* Find the child */
-    PL_LOCK;
-    p_item = playlist_ItemGetById( p_playlist, i_pl_itemid );
-    if( !p_item || p_item->i_flags & PLAYLIST_DBL_FLAG )
+    if( !pendingAppends.isEmpty() )
+        processPendingAppends();
+}
+
+/* Removes and refreshes the pending items, in one walk of the tree,
+ * with one removal per range of adjacent rows */
+void PLModel::processPendingItems( PLItem *node )
+{
+    for( int i = node->childCount() - 1; i >= 0; i-- )
     {
-        PL_UNLOCK; return;
+        PLItem *item = static_cast<PLItem *>( node->children[i] );
+
+        if( pendingRemovals.contains( item->id( PLAYLIST_ID ) ) )
+        {
+            int last = i;
+            while( i > 0 && pendingRemovals.contains(
+                                node->children[i - 1]->id( PLAYLIST_ID ) ) )
+                i--;
+
+            beginRemoveRows( index( node, 0 ), i, last );
+            QList<AbstractPLItem *>::iterator first = node->children.begin() + i;
+            QList<AbstractPLItem *>::iterator end = node->children.begin() + last + 1;
+            qDeleteAll( first, end );
+            node->children.erase( first, end );
+            endRemoveRows();
+            continue;
+        }
+
+        if( pendingUpdates.contains( item->id( INPUTITEM_ID ) ) )
+            updateTreeItem( item );
+        if( item->childCount() )
+            processPendingItems( item );
     }
+}
 
-    for( pos = p_item->p_parent->i_children - 1; pos >= 0; pos-- )
-        if( p_item->p_parent->pp_children[pos] == p_item ) break;
+/* Inserts the pending items, with one insertion per range of adjacent rows */
+void PLModel::processPendingAppends()
+{
+    QList< QPair<int, PLItem *> > items; /* position and new item */
+    QSet<int> known; /* IDs of the children of node */
+    PLItem *node = NULL;
+    int i_node = -1;
 
-    newItem = new PLItem( p_item, nodeParentItem );
+    PL_LOCK;
+    for( int i = 0; i < pendingAppends.count(); i++ )
+    {
+        const int i_pl_itemid = pendingAppends[i].first;
+        const int i_pl_itemidparent = pendingAppends[i].second;
+
+        /* Find the Parent */
+        if( i_pl_itemidparent != i_node )
+        {
+            i_node = i_pl_itemidparent;
+            node = findByPLId( rootItem, i_node );
+            known.clear();
+            if( node )
+                foreach( AbstractPLItem *existing, node->children )
+                    known.insert( existing->id( PLAYLIST_ID ) );
+        }
+
+        /* Children of a node not populated yet are added by fetchMore() */
+        if( !node || !node->b_fetched || known.contains( i_pl_itemid ) )
+            continue;
+
+        /* Find the child */
+        playlist_item_t *p_item = playlist_ItemGetById( p_playlist, i_pl_itemid );
+        if( !p_item || p_item->i_flags & PLAYLIST_DBL_FLAG )
+            continue;
+
+        int pos;
+        for( pos = p_item->p_parent->i_children - 1; pos >= 0; pos-- )
+            if( p_item->p_parent->pp_children[pos] == p_item ) break;
+
+        items.append( qMakePair( pos, new PLItem( p_item, node ) ) );
+        known.insert( i_pl_itemid );
+    }
     PL_UNLOCK;
+    pendingAppends.clear();
 
-    /* We insert the newItem (children) inside the parent */
-    beginInsertRows( index( nodeParentItem, 0 ), pos, pos );
-    nodeParentItem->insertChild( newItem, pos );
-    endInsertRows();
-    if ( newItem->inputItem() == THEMIM->currentInputItem() )
-        emit currentIndexChanged( index( newItem, 0 ) );
+    input_item_t *p_current = THEMIM->currentInputItem();
+    PLItem *current = NULL;
+
+    for( int i = 0; i < items.count(); )
+    {
+        PLItem *parent = static_cast<PLItem *>( items[i].second->parent() );
+        int pos = qMin( items[i].first, parent->childCount() );
+        QList<PLItem *> batch;
+
+        do
+        {
+            if( items[i].second->inputItem() == p_current )
+                current = items[i].second;
+            batch.append( items[i++].second );
+        }
+        while( i < items.count() && items[i].second->parent() == parent
+            && items[i].first == items[i - 1].first + 1 );
+
+        insertChildren( parent, batch, pos );
+    }
+
+    if( current )
+        emit currentIndexChanged( index( current, 0 ) );
 
-    if( latestSearch.isEmpty() ) return;
+    if( items.isEmpty() || latestSearch.isEmpty() ) return;
     filter( latestSearch, index( rootItem, 0), false /*FIXME*/ );
 }
 
@@ -720,12 +863,16 @@ void PLModel::updateChildren( PLItem *root )
 /* This function must be entered WITH the playlist lock */
 void PLModel::updateChildren( playlist_item_t *p_node, PLItem *root )
 {
+    root->b_fetched = true;
     for( int i = 0; i < p_node->i_children ; i++ )
     {
         if( p_node->pp_children[i]->i_flags & PLAYLIST_DBL_FLAG ) continue;
         PLItem *newItem =  new PLItem( p_node->pp_children[i], root );
         root->appendChild( newItem );
-        if( p_node->pp_children[i]->i_children != -1 )
+        /* Huge nodes are populated when shown, see fetchMore() */
+        if( p_node->pp_children[i]->i_children > PLMODEL_LAZY_CHILDREN )
+            newItem->b_fetched = false;
+        else if( p_node->pp_children[i]->i_children != -1 )
             updateChildren( p_node->pp_children[i], newItem );
     }
 }
@@ -734,6 +881,7 @@ void PLModel::updateChildren( playlist_item_t *p_node, PLItem *root )
 void PLModel::updateTreeItem( PLItem *item )
 {
     if( !item ) return;
+    item->displayData.clear();
     emit dataChanged( index( item, 0 ) , index( item, columnCount( QModelIndex() ) - 1 ) );
 }
 
@@ -42,6 +42,14 @@
 #include <QVariant>
 #include <QModelIndex>
 #include <QAction>
+#include <QTimer>
+#include <QSet>
+#include <QPair>
+
+/* Nodes with more children are only populated when first shown */
+#define PLMODEL_LAZY_CHILDREN 1000
+/* Delay to coalesce the playlist events (ms) */
+#define PLMODEL_UPDATE_DELAY 100
 
 class PLItem;
 class PlMimeData;
@@ -75,6 +83,9 @@ public:
     QVariant data( const QModelIndex &index, const int role ) const Q_DECL_OVERRIDE;
     bool setData( const QModelIndex &index, const QVariant & value, int role = Qt::EditRole ) Q_DECL_OVERRIDE;
     int rowCount( const QModelIndex &parent = QModelIndex() ) const Q_DECL_OVERRIDE;
+    bool hasChildren( const QModelIndex &parent = QModelIndex() ) const Q_DECL_OVERRIDE;
+    bool canFetchMore( const QModelIndex &parent ) const Q_DECL_OVERRIDE;
+    void fetchMore( const QModelIndex &parent ) Q_DECL_OVERRIDE;
     Qt::ItemFlags flags( const QModelIndex &index ) const Q_DECL_OVERRIDE;
     QModelIndex index( const int r, const int c, const QModelIndex &parent ) const Q_DECL_OVERRIDE;
     QModelIndex parent( const QModelIndex &index ) const Q_DECL_OVERRIDE;
@@ -133,6 +144,10 @@ private:
     void updateChildren( PLItem * );
     void updateChildren( playlist_item_t *, PLItem * );
 
+    /* Coalesced events */
+    void processPendingItems( PLItem * );
+    void processPendingAppends();
+
     /* Deep actions (affect core playlist) */
     void dropAppendCopy( const PlMimeData * data, PLItem *target, int pos );
     void dropMove( const PlMimeData * data, PLItem *target, int new_pos );
@@ -156,11 +171,18 @@ private:
     QString latestSearch;
     QFont   customFont;
 
+    /* Events waiting for updateTimer */
+    QTimer *updateTimer;
+    QList< QPair<int, int> > pendingAppends; /* item and parent IDs */
+    QSet<int> pendingRemovals;               /* playlist item IDs */
+    QSet<int> pendingUpdates;                /* input item IDs */
+
 private slots:
     void processInputItemUpdate( input_item_t *);
     void processInputItemUpdate();
     void processItemRemoval( int i_pl_itemid );
     void processItemAppend( int i_pl_itemid, int i_pl_itemidparent );
+    void processPendingUpdates();
     void activateItem( playlist_item_t *p_item );
     void activateItem( const QModelIndex &index );
 };
@@ -318,6 +318,7 @@ PlIconView::PlIconView( QAbstractItemModel *, QWidget *parent ) : QListView( par
     setResizeMode( QListView::Adjust );
     setWrapping( true );
     setUniformItemSizes( true );
+    setLayoutMode( QListView::Batched );
     setSelectionMode( QAbstractItemView::ExtendedSelection );
     setSelectionBehavior( QAbstractItemView::SelectRows );
     setDragEnabled(true);
@@ -363,6 +364,7 @@ PlListView::PlListView( QAbstractItemModel *, QWidget *parent ) : QListView( par
 {
     setViewMode( QListView::ListMode );
     setUniformItemSizes( true );
+    setLayoutMode( QListView::Batched );
     setSelectionMode( QAbstractItemView::ExtendedSelection );
     setSelectionBehavior( QAbstractItemView::SelectRows );
     setAlternatingRowColors( true );
@@ -59,6 +59,9 @@ vlc_module_begin()
     set_capability("decoder", 90)
     add_shortcut("mmal_decoder")
     add_bool(MMAL_OPAQUE_NAME, true, MMAL_OPAQUE_TEXT, MMAL_OPAQUE_LONGTEXT, false)
+    add_integer_with_range(MMAL_OPAQUE_BUFFERS_NAME, NUM_ACTUAL_OPAQUE_BUFFERS,
+                    8, 64, MMAL_OPAQUE_BUFFERS_TEXT,
+                    MMAL_OPAQUE_BUFFERS_LONGTEXT, true)
     set_callbacks(OpenDecoder, CloseDecoder)
 vlc_module_end()
 
@@ -342,7 +345,7 @@ port_reset:
     }
 
     if (sys->opaque) {
-        sys->output->buffer_num = NUM_ACTUAL_OPAQUE_BUFFERS;
+        sys->output->buffer_num = mmal_opaque_buffers(VLC_OBJECT(dec));
         pool_size = NUM_DECODER_BUFFER_HEADERS;
     } else {
         sys->output->buffer_num = __MAX(sys->output->buffer_num_recommended,
@@ -30,6 +30,14 @@
 /* Think twice before changing this. Incorrect values cause havoc. */
 #define NUM_ACTUAL_OPAQUE_BUFFERS 30
 
+/* Shared by the decoder and the vout, which must agree on the pool size */
+#define MMAL_OPAQUE_BUFFERS_NAME "mmal-opaque-buffers"
+#define MMAL_OPAQUE_BUFFERS_TEXT N_("Number of opaque pictures.")
+#define MMAL_OPAQUE_BUFFERS_LONGTEXT N_("Number of pictures allocated in " \
+        "VideoCore memory and shared by the decoder, the deinterlacer and " \
+        "the video output. Lower values save GPU memory, but may starve " \
+        "the decoder.")
+
 struct picture_sys_t {
     vlc_object_t *owner;
 
@@ -39,4 +47,10 @@ struct picture_sys_t {
 
 int mmal_picture_lock(picture_t *picture);
 
+static inline unsigned mmal_opaque_buffers(vlc_object_t *obj)
+{
+    int64_t count = var_InheritInteger(obj, MMAL_OPAQUE_BUFFERS_NAME);
+    return (count > 0) ? count : NUM_ACTUAL_OPAQUE_BUFFERS;
+}
+
 #endif
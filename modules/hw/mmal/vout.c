@@ -42,7 +42,6 @@
 #include <interface/vmcs_host/vc_tvservice.h>
 #include <interface/vmcs_host/vc_dispmanx.h>
 
-#define MAX_BUFFERS_IN_TRANSIT 1
 #define VC_TV_MAX_MODE_IDS 127
 
 #define MMAL_LAYER_NAME "mmal-layer"
@@ -53,6 +52,12 @@
 #define MMAL_ADJUST_REFRESHRATE_TEXT N_("Adjust HDMI refresh rate to the video.")
 #define MMAL_ADJUST_REFRESHRATE_LONGTEXT N_("Adjust HDMI refresh rate to the video.")
 
+#define MMAL_DISPLAY_BUFFERS_NAME "mmal-display-buffers"
+#define MMAL_DISPLAY_BUFFERS_TEXT N_("Pictures queued to the display.")
+#define MMAL_DISPLAY_BUFFERS_LONGTEXT N_("Maximum number of opaque " \
+        "pictures in transit to the renderer. Higher values absorb display " \
+        "jitter at the cost of latency.")
+
 #define MMAL_NATIVE_INTERLACED "mmal-native-interlaced"
 #define MMAL_NATIVE_INTERLACE_TEXT N_("Force interlaced video mode.")
 #define MMAL_NATIVE_INTERLACE_LONGTEXT N_("Force the HDMI output into an " \
@@ -75,6 +80,8 @@ vlc_module_begin()
                     MMAL_ADJUST_REFRESHRATE_LONGTEXT, false)
     add_bool(MMAL_NATIVE_INTERLACED, false, MMAL_NATIVE_INTERLACE_TEXT,
                     MMAL_NATIVE_INTERLACE_LONGTEXT, false)
+    add_integer_with_range(MMAL_DISPLAY_BUFFERS_NAME, 1, 1, 8,
+                    MMAL_DISPLAY_BUFFERS_TEXT, MMAL_DISPLAY_BUFFERS_LONGTEXT, true)
     set_callbacks(Open, Close)
 vlc_module_end()
 
@@ -108,6 +115,8 @@ struct vout_display_sys_t {
 
     uint32_t buffer_size; /* size of actual mmal buffers */
     int buffers_in_transit; /* number of buffers currently pushed to mmal component */
+    int max_buffers_in_transit; /* opaque buffers allowed in transit before blocking */
+    unsigned dropped; /* pictures which could not be sent to mmal component */
     unsigned num_buffers; /* number of buffers allocated at mmal port */
 
     DISPMANX_DISPLAY_HANDLE_T dmx_handle;
@@ -193,6 +202,9 @@ static int Open(vlc_object_t *object)
     vd->sys = sys;
 
     sys->layer = var_InheritInteger(vd, MMAL_LAYER_NAME);
+    sys->max_buffers_in_transit = var_InheritInteger(vd, MMAL_DISPLAY_BUFFERS_NAME);
+    if (sys->max_buffers_in_transit < 1)
+        sys->max_buffers_in_transit = 1;
     bcm_host_init();
 
     vd->info.has_hide_mouse = true;
@@ -324,6 +336,9 @@ static void Close(vlc_object_t *object)
 
     vc_tv_unregister_callback_full(tvservice_cb, vd);
 
+    if (sys->dropped > 0)
+        msg_Dbg(vd, "%u pictures dropped", sys->dropped);
+
     if (sys->dmx_handle)
         close_dmx(vd);
 
@@ -455,8 +470,9 @@ static picture_pool_t *vd_pool(vout_display_t *vd, unsigned count)
     }
 
     if (sys->opaque) {
-        if (count <= NUM_ACTUAL_OPAQUE_BUFFERS)
-            count = NUM_ACTUAL_OPAQUE_BUFFERS;
+        unsigned opaque_count = mmal_opaque_buffers(VLC_OBJECT(vd));
+        if (count <= opaque_count)
+            count = opaque_count;
 
         MMAL_PARAMETER_BOOLEAN_T zero_copy = {
             { MMAL_PARAMETER_ZERO_COPY, sizeof(MMAL_PARAMETER_BOOLEAN_T) },
@@ -578,6 +594,7 @@ static void vd_display(vout_display_t *vd, picture_t *picture,
 
         if (status != MMAL_SUCCESS) {
             msg_Err(vd, "Failed to send buffer to input port. Frame dropped");
+            sys->dropped++;
             picture_Release(picture);
         }
 
@@ -597,7 +614,7 @@ static void vd_display(vout_display_t *vd, picture_t *picture,
 
     if (sys->opaque) {
         vlc_mutex_lock(&sys->buffer_mutex);
-        while (atomic_load(&sys->buffers_in_transit) >= MAX_BUFFERS_IN_TRANSIT)
+        while (atomic_load(&sys->buffers_in_transit) >= sys->max_buffers_in_transit)
             vlc_cond_wait(&sys->buffer_cond, &sys->buffer_mutex);
         vlc_mutex_unlock(&sys->buffer_mutex);
     }
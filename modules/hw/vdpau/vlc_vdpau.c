@@ -127,6 +127,11 @@ VdpStatus vdp_get_proc_address(const vdp_t *vdp, VdpDevice device,
     return vdp->vt.get_proc_address(device, func_id, func_ptr);
 }
 
+VdpGetProcAddress *vdp_get_proc_address_function(const vdp_t *vdp)
+{
+    return vdp->vt.get_proc_address;
+}
+
 VdpStatus vdp_get_api_version(const vdp_t *vdp, uint32_t *ver)
 {
     CHECK_FUNC(GET_API_VERSION);
@@ -203,6 +203,12 @@ vdp_t *vdp_hold_x11(vdp_t *vdp, VdpDevice *device);
  */
 void vdp_release_x11(vdp_t *);
 
+/**
+ * Gets the VdpGetProcAddress entry point of a VDPAU instance, so that its
+ * device can be shared with another API (e.g. GL_NV_vdpau_interop).
+ */
+VdpGetProcAddress *vdp_get_proc_address_function(const vdp_t *);
+
 /* VLC specifics */
 # include <stdbool.h>
 # include <vlc_common.h>
@@ -29,21 +29,201 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_fs.h>
+#include <vlc_atomic.h>
 //#include <vlc_charset.h>
 
 #include <stdarg.h>
+#include <stdio.h>
 #include <assert.h>
 #include <errno.h>
 
 static const char msg_type[4][9] = { "", " error", " warning", " debug" };
 
+/* Asynchronous logging: the threads logging a message only format it into
+ * a lock-free ring of lines, and the logger thread writes the lines to the
+ * file in batches. A message is dropped rather than waited for when the
+ * ring is full. */
+#define LOG_RING_SIZE 1024 /* lines, power of 2 */
+#define LOG_LINE_SIZE 512  /* bytes, longer lines are truncated */
+#define LOG_RATE_SLOTS 64  /* objects rate-limited apart */
+
+typedef struct
+{
+    atomic_uint seq; /* position of the line when it can be written */
+    char line[LOG_LINE_SIZE];
+} log_line_t;
+
 typedef struct
 {
     FILE *stream;
     const char *footer;
     int verbosity;
+
+    /* Asynchronous logging */
+    bool async;
+    vlc_thread_t thread;
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    atomic_bool idle; /* the logger thread waits for lines */
+    bool stop; /* lock */
+    log_line_t *ring;
+    atomic_uint head; /* next line to fill */
+    unsigned tail; /* next line to write, logger thread only */
+    atomic_uint dropped;
+
+    /* Rate limiting per object */
+    unsigned rate; /* messages per second, 0 if not limited */
+    struct
+    {
+        atomic_uint second;
+        atomic_uint count;
+    } rates[LOG_RATE_SLOTS];
 } vlc_logger_sys_t;
 
+static bool LogRateExceeded(vlc_logger_sys_t *sys, const vlc_log_t *meta)
+{
+    if (sys->rate == 0)
+        return false;
+
+    unsigned slot = (meta->i_object_id >> 4) % LOG_RATE_SLOTS;
+    unsigned now = mdate() / CLOCK_FREQ;
+    unsigned second = atomic_load_explicit(&sys->rates[slot].second,
+                                           memory_order_relaxed);
+
+    if (second != now
+     && atomic_compare_exchange_strong(&sys->rates[slot].second, &second, now))
+        atomic_store_explicit(&sys->rates[slot].count, 0,
+                              memory_order_relaxed);
+
+    return atomic_fetch_add_explicit(&sys->rates[slot].count, 1,
+                                     memory_order_relaxed) >= sys->rate;
+}
+
+/* Returns a line to fill, or NULL if the ring is full */
+static log_line_t *LogLineGet(vlc_logger_sys_t *sys, unsigned *restrict pos)
+{
+    unsigned head = atomic_load_explicit(&sys->head, memory_order_relaxed);
+
+    for (;;)
+    {
+        log_line_t *line = &sys->ring[head % LOG_RING_SIZE];
+        unsigned seq = atomic_load_explicit(&line->seq, memory_order_acquire);
+        int diff = (int)(seq - head);
+
+        if (diff < 0)
+            return NULL;
+        if (diff == 0
+         && atomic_compare_exchange_weak(&sys->head, &head, head + 1))
+        {
+            *pos = head;
+            return line;
+        }
+        if (diff > 0)
+            head = atomic_load_explicit(&sys->head, memory_order_relaxed);
+    }
+}
+
+static void LogLinePut(vlc_logger_sys_t *sys, log_line_t *line, unsigned pos)
+{
+    atomic_store_explicit(&line->seq, pos + 1, memory_order_release);
+    /* Order the line before the idle flag check: the logger thread sets the
+     * flag, then checks the lines (LogPending), the other way around. */
+    atomic_thread_fence(memory_order_seq_cst);
+
+    /* Only wake the logger thread up if it is idle */
+    if (atomic_load(&sys->idle) && atomic_exchange(&sys->idle, false))
+    {
+        vlc_mutex_lock(&sys->lock);
+        vlc_cond_signal(&sys->wait);
+        vlc_mutex_unlock(&sys->lock);
+    }
+}
+
+/* Formats a message as a line of the ring, with the given prefix and
+ * suffix, unless the ring is full or the emitter logs too much */
+static void LogQueue(vlc_logger_sys_t *sys, const vlc_log_t *meta,
+                     const char *prefix, const char *suffix,
+                     const char *format, va_list ap)
+{
+    unsigned pos;
+    log_line_t *line;
+
+    if (LogRateExceeded(sys, meta)
+     || (line = LogLineGet(sys, &pos)) == NULL)
+    {
+        atomic_fetch_add_explicit(&sys->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    /* Keep room for the suffix */
+    size_t suffix_len = strlen(suffix);
+    size_t max = sizeof (line->line) - suffix_len;
+    size_t len = strnlen(prefix, max - 1);
+
+    memcpy(line->line, prefix, len);
+    int n = vsnprintf(line->line + len, max - len, format, ap);
+    if (n > 0)
+        len = __MIN(len + n, max - 1);
+    memcpy(line->line + len, suffix, suffix_len + 1);
+
+    LogLinePut(sys, line, pos);
+}
+
+static bool LogPending(vlc_logger_sys_t *sys)
+{
+    const log_line_t *line = &sys->ring[sys->tail % LOG_RING_SIZE];
+
+    return atomic_load(&line->seq) == sys->tail + 1
+        || atomic_load(&sys->dropped) > 0;
+}
+
+/* Writes the lines filled so far */
+static void LogFlush(vlc_logger_sys_t *sys)
+{
+    for (;;)
+    {
+        log_line_t *line = &sys->ring[sys->tail % LOG_RING_SIZE];
+        unsigned seq = atomic_load_explicit(&line->seq, memory_order_acquire);
+
+        if (seq != sys->tail + 1)
+            break; /* not filled yet */
+
+        fputs(line->line, sys->stream);
+        atomic_store_explicit(&line->seq, sys->tail + LOG_RING_SIZE,
+                              memory_order_release);
+        sys->tail++;
+    }
+
+    unsigned dropped = atomic_exchange(&sys->dropped, 0);
+    if (dropped > 0)
+        fprintf(sys->stream, "-- %u messages dropped --\n", dropped);
+    fflush(sys->stream);
+}
+
+static void *LogThread(void *opaque)
+{
+    vlc_logger_sys_t *sys = opaque;
+
+    for (;;)
+    {
+        LogFlush(sys);
+
+        vlc_mutex_lock(&sys->lock);
+        atomic_store(&sys->idle, true);
+        while (!sys->stop && !LogPending(sys))
+            vlc_cond_wait(&sys->wait, &sys->lock);
+        atomic_store(&sys->idle, false);
+        bool stop = sys->stop;
+        vlc_mutex_unlock(&sys->lock);
+
+        if (stop)
+            break;
+        /* Let lines accumulate, to write them in one go */
+        mwait(mdate() + CLOCK_FREQ / 50);
+    }
+    return NULL;
+}
+
 #define TEXT_FILENAME "vlc-log.txt"
 #define TEXT_HEADER "\xEF\xBB\xBF" /* UTF-8 BOM */ \
                     "-- logger module started --\n"
@@ -58,6 +238,16 @@ static void LogText(void *opaque, int type, const vlc_log_t *meta,
     if (sys->verbosity < type)
         return;
 
+    if (sys->async)
+    {
+        char prefix[64];
+
+        snprintf(prefix, sizeof (prefix), "%s%s: ", meta->psz_module,
+                 msg_type[type]);
+        LogQueue(sys, meta, prefix, "\n", format, ap);
+        return;
+    }
+
     flockfile(stream);
     fprintf(stream, "%s%s: ", meta->psz_module, msg_type[type]);
     vfprintf(stream, format, ap);
@@ -96,6 +286,17 @@ static void LogHtml(void *opaque, int type, const vlc_log_t *meta,
     if (sys->verbosity < type)
         return;
 
+    if (sys->async)
+    {
+        char prefix[96];
+
+        snprintf(prefix, sizeof (prefix),
+                 "%s%s: <span style=\"color: #%06x\">",
+                 meta->psz_module, msg_type[type], color[type]);
+        LogQueue(sys, meta, prefix, "</span>\n", format, ap);
+        return;
+    }
+
     flockfile(stream);
     fprintf(stream, "%s%s: <span style=\"color: #%06x\">",
             meta->psz_module, msg_type[type], color[type]);
@@ -173,7 +374,44 @@ static vlc_log_cb Open(vlc_object_t *obj, void **restrict sysp)
     }
     free(path);
 
-    setvbuf(sys->stream, NULL, _IONBF, 0);
+    sys->async = var_InheritBool(obj, "log-async");
+    sys->rate = var_InheritInteger(obj, "log-rate");
+    if (sys->async)
+    {
+        sys->ring = malloc(LOG_RING_SIZE * sizeof (*sys->ring));
+        if (unlikely(sys->ring == NULL))
+            sys->async = false;
+    }
+
+    if (sys->async)
+    {
+        for (unsigned i = 0; i < LOG_RING_SIZE; i++)
+            atomic_init(&sys->ring[i].seq, i);
+        atomic_init(&sys->head, 0);
+        sys->tail = 0;
+        atomic_init(&sys->dropped, 0);
+        atomic_init(&sys->idle, false);
+        sys->stop = false;
+        for (unsigned i = 0; i < LOG_RATE_SLOTS; i++)
+        {
+            atomic_init(&sys->rates[i].second, 0);
+            atomic_init(&sys->rates[i].count, 0);
+        }
+        vlc_mutex_init(&sys->lock);
+        vlc_cond_init(&sys->wait);
+
+        if (vlc_clone(&sys->thread, LogThread, sys, VLC_THREAD_PRIORITY_LOW))
+        {
+            vlc_cond_destroy(&sys->wait);
+            vlc_mutex_destroy(&sys->lock);
+            free(sys->ring);
+            sys->async = false;
+        }
+    }
+
+    /* The synchronous logging writes the messages as they come */
+    if (!sys->async)
+        setvbuf(sys->stream, NULL, _IONBF, 0);
     fputs(header, sys->stream);
 
     *sysp = sys;
@@ -184,6 +422,19 @@ static void Close(void *opaque)
 {
     vlc_logger_sys_t *sys = opaque;
 
+    if (sys->async)
+    {
+        vlc_mutex_lock(&sys->lock);
+        sys->stop = true;
+        vlc_cond_signal(&sys->wait);
+        vlc_mutex_unlock(&sys->lock);
+        vlc_join(sys->thread, NULL);
+        LogFlush(sys);
+        vlc_cond_destroy(&sys->wait);
+        vlc_mutex_destroy(&sys->lock);
+        free(sys->ring);
+    }
+
     fputs(sys->footer, sys->stream);
     fclose(sys->stream);
     free(sys);
@@ -198,6 +449,14 @@ static const char *const mode_list_text[] = { N_("Text"), N_("HTML") };
 #define LOGMODE_TEXT N_("Log format")
 #define LOGMODE_LONGTEXT N_("Specify the logging format.")
 
+#define LOGASYNC_TEXT N_("Asynchronous logging")
+#define LOGASYNC_LONGTEXT N_("Write the messages to the file from a " \
+"dedicated thread, dropping them rather than blocking when it is late.")
+
+#define LOGRATE_TEXT N_("Maximum message rate per object")
+#define LOGRATE_LONGTEXT N_("Drop the messages of an object beyond that " \
+"many per second when logging asynchronously, or 0 for no limit.")
+
 #define LOGVERBOSE_TEXT N_("Verbosity")
 #define LOGVERBOSE_LONGTEXT N_("Select the verbosity to use for log or -1 to " \
 "use the same verbosity given by --verbose.")
@@ -217,4 +476,7 @@ vlc_module_begin()
         change_string_list(mode_list, mode_list_text)
     add_integer("log-verbose", -1, LOGVERBOSE_TEXT, LOGVERBOSE_LONGTEXT,
                 false)
+    add_bool("log-async", false, LOGASYNC_TEXT, LOGASYNC_LONGTEXT, true)
+    add_integer("log-rate", 0, LOGRATE_TEXT, LOGRATE_LONGTEXT, true)
+        change_integer_range(0, 100000)
 vlc_module_end ()
@@ -667,6 +667,40 @@ static void ReadMetaFromMP4( MP4::Tag* tag, demux_meta_t *p_demux_meta, vlc_meta
 #endif
 
 
+/**
+ * Get the codec of the audio of a file, as guessed from its format
+ * @param p_file: the TagLib file
+ * @return the codec, or 0 if it cannot be told
+ */
+static vlc_fourcc_t GetCodec( File* p_file )
+{
+#ifdef TAGLIB_HAVE_APEFILE_H
+    if( dynamic_cast<APE::File*>(p_file) )
+        return VLC_CODEC_APE;
+#endif
+    if( dynamic_cast<FLAC::File*>(p_file)
+     || dynamic_cast<Ogg::FLAC::File*>(p_file) )
+        return VLC_CODEC_FLAC;
+    if( dynamic_cast<MPC::File*>(p_file) )
+        return VLC_CODEC_MUSEPACK7;
+    if( dynamic_cast<MPEG::File*>(p_file) )
+        return VLC_CODEC_MPGA;
+    if( dynamic_cast<Ogg::Speex::File*>(p_file) )
+        return VLC_CODEC_SPEEX;
+    if( dynamic_cast<Ogg::Vorbis::File*>(p_file) )
+        return VLC_CODEC_VORBIS;
+#if defined(TAGLIB_OPUSFILE_H)
+    if( dynamic_cast<Ogg::Opus::File*>(p_file) )
+        return VLC_CODEC_OPUS;
+#endif
+    if( dynamic_cast<TrueAudio::File*>(p_file) )
+        return VLC_CODEC_TTA;
+    if( dynamic_cast<WavPack::File*>(p_file) )
+        return VLC_CODEC_WAVPACK;
+    /* MP4, ASF and RIFF may contain about any codec */
+    return 0;
+}
+
 /**
  * Get the tags from the file using TagLib
  * @param p_this: the demux object
@@ -709,6 +743,16 @@ static int ReadMeta( vlc_object_t* p_this)
     if( !f.tag() || f.tag()->isEmpty() )
         return VLC_EGENERIC;
 
+    // Describe the audio track, as read from the headers
+    if( const AudioProperties* p_props = f.audioProperties() )
+    {
+        p_demux_meta->i_duration = INT64_C(1000000) * p_props->length();
+        es_format_Init( &p_demux_meta->fmt, AUDIO_ES, GetCodec( f.file() ) );
+        p_demux_meta->fmt.audio.i_rate = p_props->sampleRate();
+        p_demux_meta->fmt.audio.i_channels = p_props->channels();
+        p_demux_meta->fmt.i_bitrate = p_props->bitrate() * 1000;
+    }
+
     p_demux_meta->p_meta = p_meta = vlc_meta_New();
     if( !p_meta )
         return VLC_ENOMEM;
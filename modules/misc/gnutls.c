@@ -189,6 +189,108 @@ static int gnutls_Recv (void *opaque, void *buf, size_t length)
     return (val < 0) ? gnutls_Error (tls, val) : val;
 }
 
+/*** Client session cache ***/
+
+/* Resumption data of the last sessions with each server. It is shared by all
+ * client credentials, so that reconnecting to a server, even from another
+ * access, abbreviates the handshake. */
+#define SESSION_CACHE_SIZE 16
+/* Servers seldom keep session states or ticket keys longer than that */
+#define SESSION_CACHE_LIFETIME (2 * 60 * 60)
+
+static struct
+{
+    char *host;
+    gnutls_datum_t data;
+    time_t expiry;
+} session_cache[SESSION_CACHE_SIZE];
+static vlc_mutex_t session_cache_lock = VLC_STATIC_MUTEX;
+
+/**
+ * Loads cached resumption data for a server, if any.
+ */
+static void gnutls_SessionLoad (vlc_tls_t *tls, gnutls_session_t session,
+                                const char *host)
+{
+    time_t now = time (NULL);
+
+    vlc_mutex_lock (&session_cache_lock);
+    for (unsigned i = 0; i < SESSION_CACHE_SIZE; i++)
+    {
+        if (session_cache[i].host == NULL
+         || strcmp (session_cache[i].host, host))
+            continue;
+
+        if (session_cache[i].expiry < now
+         || gnutls_session_set_data (session, session_cache[i].data.data,
+                                     session_cache[i].data.size))
+        {
+            free (session_cache[i].host);
+            gnutls_free (session_cache[i].data.data);
+            session_cache[i].host = NULL;
+        }
+        else
+            msg_Dbg (tls, "trying to resume TLS session with %s", host);
+        break;
+    }
+    vlc_mutex_unlock (&session_cache_lock);
+}
+
+/**
+ * Saves the resumption data of an established session.
+ */
+static void gnutls_SessionSave (vlc_tls_t *tls, gnutls_session_t session,
+                                const char *host)
+{
+    gnutls_datum_t data;
+
+    if (gnutls_session_is_resumed (session))
+        msg_Dbg (tls, "resumed TLS session with %s", host);
+
+    if (gnutls_session_get_data2 (session, &data))
+        return;
+
+    char *name = strdup (host);
+    if (unlikely(name == NULL))
+    {
+        gnutls_free (data.data);
+        return;
+    }
+
+    time_t now = time (NULL);
+    unsigned slot = 0;
+
+    vlc_mutex_lock (&session_cache_lock);
+    /* Replace the entry for the same server, else a free or the oldest one */
+    for (unsigned i = 0; i < SESSION_CACHE_SIZE; i++)
+    {
+        if (session_cache[i].host == NULL)
+        {
+            if (session_cache[slot].host != NULL)
+                slot = i;
+            continue;
+        }
+        if (!strcmp (session_cache[i].host, host))
+        {
+            slot = i;
+            break;
+        }
+        if (session_cache[slot].host != NULL
+         && session_cache[i].expiry < session_cache[slot].expiry)
+            slot = i;
+    }
+
+    if (session_cache[slot].host != NULL)
+    {
+        free (session_cache[slot].host);
+        gnutls_free (session_cache[slot].data.data);
+    }
+    session_cache[slot].host = name;
+    session_cache[slot].data = data;
+    session_cache[slot].expiry = now + SESSION_CACHE_LIFETIME;
+    vlc_mutex_unlock (&session_cache_lock);
+}
+
 static int gnutls_SessionOpen (vlc_tls_t *tls, int type,
                                gnutls_certificate_credentials_t x509, int fd,
                                const char *const *alpn)
@@ -342,7 +444,15 @@ static int gnutls_ClientSessionOpen (vlc_tls_creds_t *crd, vlc_tls_t *tls,
                                      int fd, const char *hostname,
                                      const char *const *alpn)
 {
-    int val = gnutls_SessionOpen (tls, GNUTLS_CLIENT, crd->sys, fd, alpn);
+    int type = GNUTLS_CLIENT;
+#if (GNUTLS_VERSION_NUMBER >= 0x030500)
+    /* Send the request without waiting for the server Finished message
+     * (only with forward secret key exchanges, as decided by GnuTLS). */
+    if (var_InheritBool (crd, "gnutls-false-start"))
+        type |= GNUTLS_ENABLE_FALSE_START;
+#endif
+
+    int val = gnutls_SessionOpen (tls, type, crd->sys, fd, alpn);
     if (val != VLC_SUCCESS)
         return val;
 
@@ -352,9 +462,12 @@ static int gnutls_ClientSessionOpen (vlc_tls_creds_t *crd, vlc_tls_t *tls,
     gnutls_dh_set_prime_bits (session, 1024);
 
     if (likely(hostname != NULL))
+    {
         /* fill Server Name Indication */
         gnutls_server_name_set (session, GNUTLS_NAME_DNS,
                                 hostname, strlen (hostname));
+        gnutls_SessionLoad (tls, session, hostname);
+    }
 
     return VLC_SUCCESS;
 }
@@ -384,6 +497,8 @@ failure:
     {   /* Good certificate */
 success:
         tls->sock.p_sys = tls;
+        if (host != NULL)
+            gnutls_SessionSave (tls, session, host);
         return 0;
     }
 
@@ -687,6 +802,10 @@ static void CloseServer (vlc_tls_creds_t *crd)
 #define PRIORITIES_LONGTEXT N_("Ciphers, key exchange methods, " \
     "hash functions and compression methods can be selected. " \
     "Refer to GNU TLS documentation for detailed syntax.")
+#define FALSE_START_TEXT N_("TLS False Start")
+#define FALSE_START_LONGTEXT N_("Send application data before the " \
+    "server has completed the handshake, saving one round trip on new " \
+    "connections. Only enabled with forward secret key exchanges.")
 static const char *const priorities_values[] = {
     "PERFORMANCE",
     "NORMAL",
@@ -712,6 +831,10 @@ vlc_module_begin ()
     add_string ("gnutls-priorities", "NORMAL", PRIORITIES_TEXT,
                 PRIORITIES_LONGTEXT, false)
         change_string_list (priorities_values, priorities_text)
+#if (GNUTLS_VERSION_NUMBER >= 0x030500)
+    add_bool ("gnutls-false-start", true, FALSE_START_TEXT,
+              FALSE_START_LONGTEXT, true)
+#endif
 #ifdef ENABLE_SOUT
     add_submodule ()
         set_description( N_("GNU TLS server") )
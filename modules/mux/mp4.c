@@ -55,6 +55,11 @@
     "\"Fast Start\" files are optimized for downloads and allow the user " \
     "to start previewing the file while it is downloading.")
 
+#define FRAGDURATION_TEXT N_("Fragment duration (ms)")
+#define FRAGDURATION_LONGTEXT N_(\
+    "Target duration of each fragment. Fragments are cut on keyframes, " \
+    "and only the current fragment is kept in memory.")
+
 static int  Open   (vlc_object_t *);
 static void Close  (vlc_object_t *);
 static int  OpenFrag   (vlc_object_t *);
@@ -81,6 +86,9 @@ add_submodule ()
     set_subcategory(SUBCAT_SOUT_MUX)
     set_shortname("MP4 Frag")
     add_shortcut("mp4frag", "mp4stream")
+    add_integer(SOUT_CFG_PREFIX "fragduration", 1500,
+                FRAGDURATION_TEXT, FRAGDURATION_LONGTEXT, true)
+        change_integer_range(100, 60000)
     set_capability("sout mux", 0)
     set_callbacks(OpenFrag, CloseFrag)
 
@@ -93,6 +101,10 @@ static const char *const ppsz_sout_options[] = {
     "faststart", NULL
 };
 
+static const char *const ppsz_sout_frag_options[] = {
+    "fragduration", NULL
+};
+
 static int Control(sout_mux_t *, int, va_list);
 static int AddStream(sout_mux_t *, sout_input_t *);
 static void DelStream(sout_mux_t *, sout_input_t *);
@@ -199,6 +211,8 @@ struct sout_mux_sys_t
     /* mp4frag */
     bool           b_fragmented;
     bool           b_header_sent;
+    bool           b_index;         /* write mfra, for non streamed content */
+    mtime_t        i_fragment_length;
     mtime_t        i_written_duration;
     uint32_t       i_mfhd_sequence;
 };
@@ -761,6 +775,11 @@ static block_t *ConvertSUBT(block_t *p_block)
 
 static block_t *ConvertFromAnnexB(block_t *p_block)
 {
+    /* start codes are rewritten in place */
+    p_block = block_Unshare(p_block);
+    if( !p_block )
+        return NULL;
+
     if(p_block->i_buffer < 4)
     {
         block_Release(p_block);
@@ -2482,8 +2501,6 @@ static int64_t get_timestamp(void)
 /***************************************************************************
     MP4 Live submodule
 ****************************************************************************/
-#define FRAGMENT_LENGTH  (CLOCK_FREQ * 3/2)
-
 #define ENQUEUE_ENTRY(object, entry) \
     do {\
         if (object.p_last)\
@@ -2721,7 +2738,7 @@ static bo_t *GetMoofBox(sout_mux_t *p_mux, size_t *pi_mdat_total_size,
                 i_sample++;
 
                 /* Add keyframe entry if needed */
-                if (p_stream->b_hasiframes && (p_entry->p_block->i_flags & BLOCK_FLAG_TYPE_I) &&
+                if (p_sys->b_index && p_stream->b_hasiframes && (p_entry->p_block->i_flags & BLOCK_FLAG_TYPE_I) &&
                     (p_stream->fmt.i_cat == VIDEO_ES || p_stream->fmt.i_cat == AUDIO_ES))
                 {
                     AddKeyframeEntry(p_stream, i_write_pos, i_trak, i_sample, i_time);
@@ -2871,6 +2888,8 @@ static int OpenFrag(vlc_object_t *p_this)
     p_mux->pf_delstream = DelStream;
     p_mux->pf_mux       = MuxFrag;
 
+    config_ChainParse(p_mux, SOUT_CFG_PREFIX, ppsz_sout_frag_options, p_mux->p_cfg);
+
     /* unused */
     p_sys->b_mov        = false;
     p_sys->b_3gp        = false;
@@ -2888,6 +2907,12 @@ static int OpenFrag(vlc_object_t *p_this)
     p_sys->b_fragmented  = true;
     p_sys->i_mfhd_sequence = 1;
 
+    /* The index refers to moof by absolute position, so it is useless on
+     * streamed content and would only grow with the stream duration. */
+    p_sys->b_index = !strcmp(p_mux->psz_mux, "mp4frag");
+    p_sys->i_fragment_length = var_GetInteger(p_mux,
+                                   SOUT_CFG_PREFIX "fragduration") * 1000;
+
     return VLC_SUCCESS;
 }
 
@@ -2895,7 +2920,7 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
 {
     sout_mux_sys_t *p_sys = (sout_mux_sys_t*) p_mux->p_sys;
     bo_t *moof = NULL;
-    mtime_t i_barrier_time = p_sys->i_written_duration + FRAGMENT_LENGTH;
+    mtime_t i_barrier_time = p_sys->i_written_duration + p_sys->i_fragment_length;
     size_t i_mdat_size = 0;
     bool b_has_samples = false;
 
@@ -2920,6 +2945,20 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
     if (!p_sys->b_header_sent)
         FlushHeader(p_mux);
 
+    /* date the fragment with its first sample, for segmenters */
+    mtime_t i_dts = VLC_TS_INVALID;
+    for (unsigned int i = 0; i < p_sys->i_nb_streams; i++)
+    {
+        const mp4_stream_t *p_stream = p_sys->pp_streams[i];
+        if (p_stream->read.p_first)
+        {
+            mtime_t i_first = p_stream->read.p_first->p_block->i_dts;
+            if (i_first > VLC_TS_INVALID &&
+                (i_dts == VLC_TS_INVALID || i_first < i_dts))
+                i_dts = i_first;
+        }
+    }
+
     if (b_has_samples)
         moof = GetMoofBox(p_mux, &i_mdat_size, (b_flush)?0:i_barrier_time, p_sys->i_pos);
 
@@ -2932,6 +2971,7 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
     if (moof)
     {
         msg_Dbg(p_mux, "writing moof @ %"PRId64, p_sys->i_pos);
+        moof->b->i_dts = i_dts;
         p_sys->i_pos += moof->b->i_buffer;
         assert(moof->b->i_flags & BLOCK_FLAG_TYPE_I); /* http sout */
         box_send(p_mux, moof);
@@ -3028,7 +3068,7 @@ static void CloseFrag(vlc_object_t *p_this)
 
     /* Write indexes, but only for non streamed content
        as they refer to moof by absolute position */
-    if (!strcmp(p_mux->psz_mux, "mp4frag"))
+    if (p_sys->b_index)
     {
         bo_t *mfra = GetMfraBox(p_mux);
         if (mfra)
@@ -3050,14 +3090,9 @@ static void CloseFrag(vlc_object_t *p_this)
     CleanupFrag(p_sys);
 }
 
-static int MuxFrag(sout_mux_t *p_mux)
+static int MuxFragBlock(sout_mux_t *p_mux, sout_input_t *p_input)
 {
     sout_mux_sys_t *p_sys = (sout_mux_sys_t*) p_mux->p_sys;
-
-    int i_stream = sout_MuxGetStream(p_mux, 1, NULL);
-    if (i_stream < 0)
-        return VLC_SUCCESS;
-    sout_input_t *p_input  = p_mux->pp_inputs[i_stream];
     mp4_stream_t *p_stream = (mp4_stream_t*) p_input->p_sys;
     block_t *p_currentblock = block_FifoGet(p_input->p_fifo);
 
@@ -3100,7 +3135,7 @@ static int MuxFrag(sout_mux_t *p_mux)
         p_stream->p_held_entry = NULL;
 
         if (p_stream->b_hasiframes && (p_heldblock->i_flags & BLOCK_FLAG_TYPE_I) &&
-            p_stream->i_read_duration - p_sys->i_written_duration < FRAGMENT_LENGTH)
+            p_stream->i_read_duration - p_sys->i_written_duration < p_sys->i_fragment_length)
         {
             /* Flag the last iframe time, we'll use it as boundary so it will start
                next fragment */
@@ -3149,8 +3184,25 @@ static int MuxFrag(sout_mux_t *p_mux)
     p_sys->i_written_duration = i_min_written_duration;
 
     /* we have prerolled enough to know all streams, and have enough date to create a fragment */
-    if (p_stream->read.p_first && p_sys->i_read_duration - p_sys->i_written_duration >= FRAGMENT_LENGTH)
+    if (p_stream->read.p_first &&
+        p_sys->i_read_duration - p_sys->i_written_duration >= p_sys->i_fragment_length)
         WriteFragments(p_mux, false);
 
     return VLC_SUCCESS;
 }
+
+static int MuxFrag(sout_mux_t *p_mux)
+{
+    /* Consume everything queued, as blocks buffered while the muxer was
+     * waiting for its streams would be lost on close otherwise */
+    for (;;)
+    {
+        int i_stream = sout_MuxGetStream(p_mux, 1, NULL);
+        if (i_stream < 0)
+            return VLC_SUCCESS;
+
+        int i_ret = MuxFragBlock(p_mux, p_mux->pp_inputs[i_stream]);
+        if (i_ret != VLC_SUCCESS)
+            return i_ret;
+    }
+}
@@ -55,6 +55,24 @@ static void csa_StreamCypher( csa_t *c, int b_init, uint8_t *ck, uint8_t *sb, ui
 
 static void csa_BlockDecypher( uint8_t kk[57], uint8_t ib[8], uint8_t bd[8] );
 static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] );
+static void csa_BlockCypher2( const uint8_t kk[57], const uint8_t bd[2][8],
+                              uint8_t *ib0, uint8_t *ib1 );
+
+/* bitsliced stream cypher state, for up to 64 packets */
+typedef uint64_t slice_t;
+
+typedef struct
+{
+    slice_t A[11][4];
+    slice_t B[11][4];
+    slice_t X[4], Y[4], Z[4];
+    slice_t D[4], E[4], F[4];
+    slice_t p, q, r;
+} csa_slices_t;
+
+static void csa_SlicedInit( csa_slices_t *s, const uint8_t ck[8],
+                            uint8_t *const sb[], int i_lanes );
+static void csa_SlicedCypher( csa_slices_t *s, uint8_t cb[][8], int i_lanes );
 
 /*****************************************************************************
  * csa_New:
@@ -307,6 +325,128 @@ void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
     }
 }
 
+/*****************************************************************************
+ * csa_EncryptPackets: scrambles packets as csa_Encrypt does, CSA_PACKETS at
+ * a time: the stream cypher runs bitsliced, one packet per bit of a word.
+ *****************************************************************************/
+static void csa_EncryptLanes( csa_t *c, uint8_t **pp_pkts, int i_pkts,
+                              int i_pkt_size )
+{
+    uint8_t *ck = c->use_odd ? c->o_ck : c->e_ck;
+    uint8_t *kk = c->use_odd ? c->o_kk : c->e_kk;
+
+    uint8_t *pkt[CSA_PACKETS];
+    uint8_t ib[CSA_PACKETS][184/8+2][8];
+    uint8_t *sb[CSA_PACKETS];
+    uint8_t stream[CSA_PACKETS][8];
+    int     i_hdr[CSA_PACKETS], n[CSA_PACKETS], i_residue[CSA_PACKETS];
+    int     i_lanes = 0, i_steps = 0;
+
+    for( int l = 0; l < i_pkts; l++ )
+    {
+        uint8_t *p = pp_pkts[l];
+        int h = 4;
+
+        /* set transport scrambling control */
+        p[3] |= 0x80;
+        if( c->use_odd )
+            p[3] |= 0x40;
+        if( p[3]&0x20 )
+        {
+            /* skip adaption field */
+            h += p[4] + 1;
+        }
+        if( (i_pkt_size - h) / 8 <= 0 )
+        {
+            p[3] &= 0x3f;
+            continue;
+        }
+
+        pkt[i_lanes] = p;
+        i_hdr[i_lanes] = h;
+        n[i_lanes] = (i_pkt_size - h) / 8;
+        i_residue[i_lanes] = (i_pkt_size - h) % 8;
+        i_lanes++;
+    }
+    if( i_lanes == 0 )
+        return;
+
+    /* The block cypher chains each packet backwards: run two chains at
+     * once, as each one is a long sequence of dependent lookups */
+    for( int l = 0; l < i_lanes; l += 2 )
+    {
+        const int m = __MIN( i_lanes - l, 2 );
+        uint8_t block[2][8];
+
+        for( int k = 0; k < m; k++ )
+            memset( ib[l+k][n[l+k]+1], 0, 8 );
+        for( int t = 0; t < __MAX( n[l], n[l+m-1] ); t++ )
+        {
+            int i_run = 0, lane[2];
+
+            for( int k = 0; k < m; k++ )
+            {
+                const int i = n[l+k] - t;
+                if( i <= 0 )
+                    continue;
+                for( int j = 0; j < 8; j++ )
+                    block[i_run][j] = pkt[l+k][i_hdr[l+k]+8*(i-1)+j]
+                                    ^ ib[l+k][i+1][j];
+                lane[i_run++] = k;
+            }
+            if( i_run == 2 )
+                csa_BlockCypher2( kk, block, ib[l][n[l]-t],
+                                  ib[l+1][n[l+1]-t] );
+            else
+                csa_BlockCypher( kk, block[0],
+                                 ib[l+lane[0]][n[l+lane[0]]-t] );
+        }
+    }
+
+    for( int l = 0; l < i_lanes; l++ )
+    {
+        memcpy( &pkt[l][i_hdr[l]], ib[l][1], 8 );
+        sb[l] = ib[l][1];
+
+        /* one stream step per block after the first and for the residue */
+        int i_need = n[l] - 1 + ( i_residue[l] > 0 );
+        if( i_steps < i_need )
+            i_steps = i_need;
+    }
+
+    /* The stream cypher runs on all the packets at once */
+    csa_slices_t state;
+    csa_SlicedInit( &state, ck, sb, i_lanes );
+
+    for( int i = 2; i < 2 + i_steps; i++ )
+    {
+        csa_SlicedCypher( &state, stream, i_lanes );
+        for( int l = 0; l < i_lanes; l++ )
+        {
+            const int h = i_hdr[l];
+
+            if( i <= n[l] )
+            {
+                for( int j = 0; j < 8; j++ )
+                    pkt[l][h+8*(i-1)+j] = ib[l][i][j] ^ stream[l][j];
+            }
+            else if( i == n[l] + 1 && i_residue[l] > 0 )
+            {
+                for( int j = 0; j < i_residue[l]; j++ )
+                    pkt[l][i_pkt_size - i_residue[l] + j] ^= stream[l][j];
+            }
+        }
+    }
+}
+
+void csa_EncryptPackets( csa_t *c, uint8_t **pp_pkts, int i_pkts,
+                         int i_pkt_size )
+{
+    for( int i = 0; i < i_pkts; i += CSA_PACKETS )
+        csa_EncryptLanes( c, &pp_pkts[i], __MIN( i_pkts - i, CSA_PACKETS ),
+                          i_pkt_size );
+}
+
 /*****************************************************************************
  * Divers
  *****************************************************************************/
@@ -494,6 +634,194 @@ static void csa_StreamCypher( csa_t *c, int b_init, uint8_t *ck, uint8_t *sb, ui
 }
 
 
+/*****************************************************************************
+ * Bitsliced stream cypher: each register bit is a word holding that bit for
+ * up to 64 packets, so that one pass of logical operations advances the
+ * cyphers of all the packets. It produces the same output as
+ * csa_StreamCypher() for each packet.
+ *****************************************************************************/
+/* sbox1..sbox7 low and high output bits, as truth tables */
+static const uint32_t sbox_tt[7][2] =
+{
+    { 0x78C6B16C, 0x4B368771 },
+    { 0xE41B4B63, 0x58B98679 },
+    { 0xE41B1BE4, 0x69D25879 },
+    { 0x92AD994B, 0x66B492AD },
+    { 0x35E29E58, 0x9C274CF1 },
+    { 0x66D2E61A, 0x691BB46C },
+    { 0x266D9D92, 0xB38C691E },
+};
+
+/* Evaluates a 5 inputs boolean function given by its truth table: with a
+ * constant table, this folds down to a tree of multiplexers */
+static inline slice_t csa_SlicedBox( uint32_t tt, const slice_t x[5] )
+{
+    slice_t v[16];
+
+    for( int i = 0; i < 16; i++ )
+    {
+        const slice_t t0 = -(slice_t)( ( tt >> (2*i) )&1 );
+        const slice_t t1 = -(slice_t)( ( tt >> (2*i+1) )&1 );
+        v[i] = t0 ^ ( ( t0 ^ t1 ) & x[0] );
+    }
+    for( int k = 1, w = 8; k < 5; k++, w /= 2 )
+        for( int i = 0; i < w; i++ )
+            v[i] = v[2*i] ^ ( ( v[2*i] ^ v[2*i+1] ) & x[k] );
+    return v[0];
+}
+
+/* Transposes one byte of each lane into 8 slices */
+static void csa_SliceBytes( slice_t out[8], uint8_t *const in[], int i,
+                            int i_lanes )
+{
+    for( int b = 0; b < 8; b++ )
+        out[b] = 0;
+    for( int l = 0; l < i_lanes; l++ )
+        for( int b = 0; b < 8; b++ )
+            out[b] |= (slice_t)( ( in[l][i] >> b )&1 ) << l;
+}
+
+static void csa_SlicedStep( csa_slices_t *s, const slice_t *in1,
+                            const slice_t *in2, slice_t out[2] )
+{
+    slice_t (*A)[4] = s->A, (*B)[4] = s->B;
+    slice_t x[5], s_out[7][2];
+
+    /* the same 35 bits of A[1]..A[10] as csa_StreamCypher, least
+     * significant first */
+    static const uint8_t box_in[7][5][2] =
+    {
+        { {9,0}, {7,3}, {6,1}, {1,2}, {4,0} },
+        { {9,1}, {7,0}, {6,3}, {3,2}, {2,1} },
+        { {6,2}, {5,3}, {5,1}, {2,0}, {1,3} },
+        { {8,0}, {4,2}, {2,3}, {1,1}, {3,3} },
+        { {9,2}, {8,1}, {6,0}, {4,3}, {5,2} },
+        { {9,3}, {7,2}, {5,0}, {4,1}, {3,1} },
+        { {8,3}, {8,2}, {7,1}, {3,0}, {2,2} },
+    };
+#define BOX( i ) \
+    do { \
+        for( int k = 0; k < 5; k++ ) \
+            x[k] = A[box_in[i][k][0]][box_in[i][k][1]]; \
+        s_out[i][0] = csa_SlicedBox( sbox_tt[i][0], x ); \
+        s_out[i][1] = csa_SlicedBox( sbox_tt[i][1], x ); \
+    } while( 0 )
+    BOX( 0 ); BOX( 1 ); BOX( 2 ); BOX( 3 ); BOX( 4 ); BOX( 5 ); BOX( 6 );
+#undef BOX
+
+    /* use 4x4 xor to produce extra nibble for T3 */
+    slice_t extra_B[4];
+    extra_B[3] = B[3][0] ^ B[6][1] ^ B[7][2] ^ B[9][3];
+    extra_B[2] = B[6][0] ^ B[8][1] ^ B[3][3] ^ B[4][2];
+    extra_B[1] = B[5][3] ^ B[8][2] ^ B[4][0] ^ B[5][1];
+    extra_B[0] = B[9][2] ^ B[6][3] ^ B[3][1] ^ B[8][0];
+
+    /* T1, T2 */
+    slice_t next_A1[4], next_B1[4];
+    for( int b = 0; b < 4; b++ )
+    {
+        next_A1[b] = A[10][b] ^ s->X[b];
+        next_B1[b] = B[7][b] ^ B[10][b] ^ s->Y[b];
+        if( in1 != NULL )
+        {
+            next_A1[b] ^= s->D[b] ^ in1[b];
+            next_B1[b] ^= in2[b];
+        }
+    }
+    /* if p=1, rotate left */
+    slice_t rot[4] = { next_B1[3], next_B1[0], next_B1[1], next_B1[2] };
+    for( int b = 0; b < 4; b++ )
+        next_B1[b] ^= ( next_B1[b] ^ rot[b] ) & s->p;
+
+    /* T3 */
+    for( int b = 0; b < 4; b++ )
+        s->D[b] = s->E[b] ^ s->Z[b] ^ extra_B[b];
+
+    /* T4 = sum, carry of Z + E + r, if q */
+    slice_t carry = s->r;
+    for( int b = 0; b < 4; b++ )
+    {
+        const slice_t ze = s->Z[b] ^ s->E[b];
+        const slice_t sum = ze ^ carry;
+        const slice_t next_E = s->F[b];
+
+        carry = ( s->Z[b] & s->E[b] ) | ( carry & ze );
+        s->F[b] = s->E[b] ^ ( ( s->E[b] ^ sum ) & s->q );
+        s->E[b] = next_E;
+    }
+    s->r ^= ( s->r ^ carry ) & s->q;
+
+    memmove( A[2], A[1], 9 * sizeof( A[1] ) );
+    memmove( B[2], B[1], 9 * sizeof( B[1] ) );
+    memcpy( A[1], next_A1, sizeof( next_A1 ) );
+    memcpy( B[1], next_B1, sizeof( next_B1 ) );
+
+    s->X[3] = s_out[3][0]; s->X[2] = s_out[2][0];
+    s->X[1] = s_out[1][1]; s->X[0] = s_out[0][1];
+    s->Y[3] = s_out[5][0]; s->Y[2] = s_out[4][0];
+    s->Y[1] = s_out[3][1]; s->Y[0] = s_out[2][1];
+    s->Z[3] = s_out[1][0]; s->Z[2] = s_out[0][0];
+    s->Z[1] = s_out[5][1]; s->Z[0] = s_out[4][1];
+    s->p = s_out[6][1];
+    s->q = s_out[6][0];
+
+    /* 2 output bits are a function of the 4 bits of D */
+    out[1] = s->D[2] ^ s->D[3];
+    out[0] = s->D[0] ^ s->D[1];
+}
+
+static void csa_SlicedInit( csa_slices_t *s, const uint8_t ck[8],
+                            uint8_t *const sb[], int i_lanes )
+{
+    memset( s, 0, sizeof( *s ) );
+
+    /* all the packets use the same key */
+    for( int i = 0; i < 4; i++ )
+        for( int b = 0; b < 4; b++ )
+        {
+            s->A[1+2*i+0][b] = -(slice_t)( ( ck[i] >> (4+b) )&1 );
+            s->A[1+2*i+1][b] = -(slice_t)( ( ck[i] >> b )&1 );
+            s->B[1+2*i+0][b] = -(slice_t)( ( ck[4+i] >> (4+b) )&1 );
+            s->B[1+2*i+1][b] = -(slice_t)( ( ck[4+i] >> b )&1 );
+        }
+
+    for( int i = 0; i < 8; i++ )
+    {
+        slice_t in[8], out[2];
+
+        csa_SliceBytes( in, sb, i, i_lanes );
+        /* in1 is the high nibble, alternating with in2 */
+        for( int j = 0; j < 4; j++ )
+            csa_SlicedStep( s, (j % 2) ? &in[0] : &in[4],
+                            (j % 2) ? &in[4] : &in[0], out );
+    }
+}
+
+static void csa_SlicedCypher( csa_slices_t *s, uint8_t cb[][8], int i_lanes )
+{
+    for( int i = 0; i < 8; i++ )
+    {
+        slice_t op[8];
+
+        for( int j = 0; j < 4; j++ )
+        {
+            slice_t out[2];
+
+            csa_SlicedStep( s, NULL, NULL, out );
+            op[7-2*j] = out[1];
+            op[6-2*j] = out[0];
+        }
+        for( int l = 0; l < i_lanes; l++ )
+        {
+            uint8_t v = 0;
+            for( int b = 0; b < 8; b++ )
+                v |= ( ( op[b] >> l )&1 ) << b;
+            cb[l][i] = v;
+        }
+    }
+}
+
+
 // block - sbox
 static const uint8_t block_sbox[256] =
 {
@@ -610,3 +938,48 @@ static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] )
     }
 }
 
+/* Two independent csa_BlockCypher() */
+static void csa_BlockCypher2( const uint8_t kk[57], const uint8_t bd[2][8],
+                              uint8_t *ib0, uint8_t *ib1 )
+{
+    unsigned R[9], S[9];
+
+    for( int i = 0; i < 8; i++ )
+    {
+        R[i+1] = bd[0][i];
+        S[i+1] = bd[1][i];
+    }
+
+    // loop over kk[1]..kk[56]
+    for( int i = 1; i <= 56; i++ )
+    {
+        const unsigned sbox_out_R = block_sbox[ kk[i]^R[8] ];
+        const unsigned sbox_out_S = block_sbox[ kk[i]^S[8] ];
+        const unsigned next_R1 = R[2];
+        const unsigned next_S1 = S[2];
+
+        R[2] = R[3] ^ R[1];
+        S[2] = S[3] ^ S[1];
+        R[3] = R[4] ^ R[1];
+        S[3] = S[4] ^ S[1];
+        R[4] = R[5] ^ R[1];
+        S[4] = S[5] ^ S[1];
+        R[5] = R[6];
+        S[5] = S[6];
+        R[6] = R[7] ^ block_perm[sbox_out_R];
+        S[6] = S[7] ^ block_perm[sbox_out_S];
+        R[7] = R[8];
+        S[7] = S[8];
+        R[8] = R[1] ^ sbox_out_R;
+        S[8] = S[1] ^ sbox_out_S;
+
+        R[1] = next_R1;
+        S[1] = next_S1;
+    }
+
+    for( int i = 0; i < 8; i++ )
+    {
+        ib0[i] = R[i+1];
+        ib1[i] = S[i+1];
+    }
+}
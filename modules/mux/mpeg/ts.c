@@ -155,6 +155,11 @@ static void    Close  ( vlc_object_t * );
   "stream, compared to the PCRs. This allows for some buffering inside " \
   "the client decoder.")
 
+#define MUXRATE_TEXT N_("Mux rate (bits/s)")
+#define MUXRATE_LONGTEXT N_("Produce a constant bitrate stream at the " \
+  "given rate, padded with null packets. The PCRs then match the packet " \
+  "positions exactly. 0 sends the packets as they come (variable bitrate).")
+
 #define ACRYPT_TEXT N_("Crypt audio")
 #define ACRYPT_LONGTEXT N_("Crypt audio using CSA")
 #define VCRYPT_TEXT N_("Crypt video")
@@ -215,6 +220,7 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "bmin", 0, BMIN_TEXT, BMIN_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "bmax", 0, BMAX_TEXT, BMAX_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "dts-delay", 400, DTS_TEXT, DTS_LONGTEXT, true)
+    add_integer( SOUT_CFG_PREFIX "muxrate", 0, MUXRATE_TEXT, MUXRATE_LONGTEXT, true)
 
     add_bool( SOUT_CFG_PREFIX "crypt-audio", true, ACRYPT_TEXT, ACRYPT_LONGTEXT, true)
     add_bool( SOUT_CFG_PREFIX "crypt-video", true, VCRYPT_TEXT, VCRYPT_LONGTEXT, true)
@@ -234,7 +240,7 @@ static const char *const ppsz_sout_options[] = {
     "netid", "sdtdesc",
     "es-id-pid", "shaping", "pcr", "bmin", "bmax", "use-key-frames",
     "dts-delay", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "crypt-audio", "crypt-video",
-    "muxpmt", "program-pmt", "alignment",
+    "muxpmt", "program-pmt", "alignment", "muxrate",
     NULL
 };
 
@@ -325,6 +331,12 @@ typedef struct
     pes_state_t  state;
 } sout_input_sys_t;
 
+#define PACKET_POOL_MAX 512 /* idle TS packets kept for recycling */
+/* TS packets are sent in bursts of up to 7 (what fits in a UDP datagram
+ * on Ethernet) rather than one by one */
+#define BURST_PACKETS 7
+#define BURST_POOL_MAX 64
+
 struct sout_mux_sys_t
 {
     int             i_pcr_pid;
@@ -333,6 +345,8 @@ struct sout_mux_sys_t
     vlc_mutex_t     csa_lock;
 
     dvbpsi_t        *p_dvbpsi;
+    block_pool_t    *packet_pool;
+    block_pool_t    *burst_pool;
     bool            b_es_id_pid;
     bool            b_sdt;
     int             i_pid_video;
@@ -363,6 +377,17 @@ struct sout_mux_sys_t
     int64_t         i_dts_delay;
     mtime_t         first_dts;
 
+    /* constant bitrate: the date of the next packet slot is kept in 27MHz
+     * ticks, with the remainder of the slot duration, so that it never
+     * drifts from the mux rate */
+    int64_t         i_muxrate;
+    int64_t         i_cbr_clock;
+    int64_t         i_cbr_rem;
+    uint64_t        i_cbr_nulls;
+    unsigned        i_cbr_overflows;
+    unsigned        i_cbr_late;     /* packets after their DTS */
+    unsigned        i_cbr_early;    /* packets more than 1s before their DTS */
+
     bool            b_use_key_frames;
 
     mtime_t         i_pcr;  /* last PCR emited */
@@ -463,11 +488,13 @@ static void TSSchedule  ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                           mtime_t i_pcr_length, mtime_t i_pcr_dts );
 static void TSDate      ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                           mtime_t i_pcr_length, mtime_t i_pcr_dts );
+static void TSDateCBR   ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+                          mtime_t i_pcr_length, mtime_t i_pcr_dts );
 static void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 
 static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream, bool b_pcr );
-static void TSSetPCR( block_t *p_ts, mtime_t i_dts );
+static void TSSetPCR( block_t *p_ts, int64_t i_pcr );
 
 static csa_t *csaSetup( vlc_object_t *p_this )
 {
@@ -544,6 +571,19 @@ static int Open( vlc_object_t *p_this )
     }
     p_sys->p_dvbpsi->p_sys = (void *) p_mux;
 
+    p_sys->packet_pool = block_PoolNew( 188, PACKET_POOL_MAX );
+    p_sys->burst_pool = block_PoolNew( BURST_PACKETS * 188, BURST_POOL_MAX );
+    if( !p_sys->packet_pool || !p_sys->burst_pool )
+    {
+        if( p_sys->burst_pool )
+            block_PoolDelete( p_sys->burst_pool );
+        if( p_sys->packet_pool )
+            block_PoolDelete( p_sys->packet_pool );
+        dvbpsi_delete( p_sys->p_dvbpsi );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
     p_sys->b_es_id_pid = var_GetBool( p_mux, SOUT_CFG_PREFIX "es-id-pid" );
 
     /*
@@ -715,6 +755,13 @@ static int Open( vlc_object_t *p_this )
     var_Get( p_mux, SOUT_CFG_PREFIX "dts-delay", &val );
     p_sys->i_dts_delay = val.i_int * 1000;
 
+    p_sys->i_muxrate = var_GetInteger( p_mux, SOUT_CFG_PREFIX "muxrate" );
+    if( p_sys->i_muxrate < 0 )
+        p_sys->i_muxrate = 0;
+    if( p_sys->i_muxrate > 0 )
+        msg_Dbg( p_mux, "constant bitrate of %"PRId64" bits/s",
+                 p_sys->i_muxrate );
+
     msg_Dbg( p_mux, "shaping=%"PRId64" pcr=%"PRId64" dts_delay=%"PRId64,
              p_sys->i_shaping_delay, p_sys->i_pcr_delay, p_sys->i_dts_delay );
 
@@ -743,6 +790,22 @@ static void Close( vlc_object_t * p_this )
     if( p_sys->p_dvbpsi )
         dvbpsi_delete( p_sys->p_dvbpsi );
 
+    uint64_t i_hits, i_misses;
+    block_PoolGetStats( p_sys->packet_pool, &i_hits, &i_misses );
+    msg_Dbg( p_mux, "packet pool: %"PRIu64" hits, %"PRIu64" misses",
+             i_hits, i_misses );
+    block_PoolDelete( p_sys->packet_pool );
+    block_PoolGetStats( p_sys->burst_pool, &i_hits, &i_misses );
+    msg_Dbg( p_mux, "burst pool: %"PRIu64" hits, %"PRIu64" misses",
+             i_hits, i_misses );
+    block_PoolDelete( p_sys->burst_pool );
+
+    if( p_sys->i_muxrate > 0 )
+        msg_Dbg( p_mux, "constant bitrate: %"PRIu64" null packets, "
+                 "mux rate exceeded %u times, %u late and %u early packets",
+                 p_sys->i_cbr_nulls, p_sys->i_cbr_overflows,
+                 p_sys->i_cbr_late, p_sys->i_cbr_early );
+
     if( p_sys->csa )
     {
         var_DelCallback( p_mux, SOUT_CFG_PREFIX "csa-ck", ChangeKeyCallback, NULL );
@@ -1567,7 +1630,10 @@ static bool MuxStreams(sout_mux_t *p_mux )
     }
 
     /* 4: date and send */
-    TSSchedule( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
+    if( p_sys->i_muxrate > 0 )
+        TSDateCBR( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
+    else
+        TSSchedule( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
     return false;
 }
 
@@ -1755,6 +1821,84 @@ static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         TSDate( p_mux, &new_chain, i_pcr_length, i_pcr_dts );
 }
 
+/* Scrambles the packets of a chain that need it, CSA_PACKETS at a time */
+static void TSScramble( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    uint8_t *pp_pkts[CSA_PACKETS];
+    int i_pkts = 0;
+
+    if( p_sys->csa == NULL )
+        return;
+
+    vlc_mutex_lock( &p_sys->csa_lock );
+    for( block_t *p_ts = p_chain_ts->p_first; p_ts; p_ts = p_ts->p_next )
+    {
+        if( !( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED ) )
+            continue;
+        pp_pkts[i_pkts++] = p_ts->p_buffer;
+        if( i_pkts == CSA_PACKETS )
+        {
+            csa_EncryptPackets( p_sys->csa, pp_pkts, i_pkts,
+                                p_sys->i_csa_pkt_size );
+            i_pkts = 0;
+        }
+    }
+    if( i_pkts > 0 )
+        csa_EncryptPackets( p_sys->csa, pp_pkts, i_pkts,
+                            p_sys->i_csa_pkt_size );
+    vlc_mutex_unlock( &p_sys->csa_lock );
+}
+
+/* Packs the TS packets in bursts: the access output gets fewer, larger
+ * blocks. A NULL packet writes the pending burst. */
+static void TSWrite( sout_mux_t *p_mux, block_t **pp_burst, block_t *p_ts )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    block_t *p_burst = *pp_burst;
+
+    if( p_ts == NULL )
+    {
+        if( p_burst != NULL )
+            sout_AccessOutWrite( p_mux->p_access, p_burst );
+        *pp_burst = NULL;
+        return;
+    }
+
+    /* Start a new burst with a PCR, a PAT/PMT or a key frame, so that
+     * the access output sees its flags and its date first */
+    const uint32_t i_flags = p_ts->i_flags & ( BLOCK_FLAG_CLOCK |
+                               BLOCK_FLAG_HEADER | BLOCK_FLAG_TYPE_I );
+    if( p_burst != NULL &&
+        ( i_flags || p_burst->i_buffer + p_ts->i_buffer >
+                     BURST_PACKETS * 188 ) )
+    {
+        sout_AccessOutWrite( p_mux->p_access, p_burst );
+        p_burst = NULL;
+    }
+    if( p_burst == NULL )
+    {
+        p_burst = block_PoolAlloc( p_sys->burst_pool, BURST_PACKETS * 188 );
+        if( unlikely(p_burst == NULL) )
+        {
+            *pp_burst = NULL;
+            sout_AccessOutWrite( p_mux->p_access, p_ts );
+            return;
+        }
+        p_burst->i_buffer = 0;
+        p_burst->i_flags  = i_flags;
+        p_burst->i_dts    = p_ts->i_dts;
+        p_burst->i_length = 0;
+    }
+
+    memcpy( &p_burst->p_buffer[p_burst->i_buffer], p_ts->p_buffer,
+            p_ts->i_buffer );
+    p_burst->i_buffer += p_ts->i_buffer;
+    p_burst->i_length += p_ts->i_length;
+    block_Release( p_ts );
+    *pp_burst = p_burst;
+}
+
 static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                     mtime_t i_pcr_length, mtime_t i_pcr_dts )
 {
@@ -1780,7 +1924,10 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         i_pcr_length = i_packet_count;
     }
 
+    TSScramble( p_mux, p_chain_ts );
+
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
+    block_t *p_burst = NULL;
     for (int i = 0; i < i_packet_count; i++ )
     {
         block_t *p_ts = BufferChainGet( p_chain_ts );
@@ -1792,26 +1939,147 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
         {
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
-            TSSetPCR( p_ts, p_ts->i_dts - p_sys->i_dts_delay - p_sys->first_dts );
-        }
-        if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
-        {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
+            TSSetPCR( p_ts, ( p_ts->i_dts - p_sys->i_dts_delay
+                              - p_sys->first_dts ) * 27 );
         }
 
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
 
-        sout_AccessOutWrite( p_mux->p_access, p_ts );
+        TSWrite( p_mux, &p_burst, p_ts );
+    }
+
+    TSWrite( p_mux, &p_burst, NULL );
+}
+
+/* Null packets fill the unused slots of a constant bitrate stream */
+static block_t *TSNull( sout_mux_t *p_mux )
+{
+    block_t *p_ts = block_PoolAlloc( p_mux->p_sys->packet_pool, 188 );
+    if( unlikely(p_ts == NULL) )
+        return NULL;
+
+    p_ts->p_buffer[0] = 0x47;
+    p_ts->p_buffer[1] = 0x1f;
+    p_ts->p_buffer[2] = 0xff;
+    p_ts->p_buffer[3] = 0x10;
+    memset( &p_ts->p_buffer[4], 0xff, 184 );
+    return p_ts;
+}
+
+/* Checks the delay of a packet in the decoder buffer (T-STD): its data must
+ * arrive before its decoding time, and at most one second before */
+static void TSCheckDelay( sout_mux_t *p_mux, const block_t *p_ts,
+                          mtime_t i_date )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    mtime_t i_delay = p_ts->i_dts + p_sys->i_dts_delay - i_date;
+
+    if( i_delay < 0 )
+    {
+        if( p_sys->i_cbr_late++ == 0 )
+            msg_Warn( p_mux, "packet %"PRId64" ms after its DTS, raise the "
+                      "mux rate", -i_delay / 1000 );
+    }
+    else if( i_delay > CLOCK_FREQ )
+    {
+        if( p_sys->i_cbr_early++ == 0 )
+            msg_Warn( p_mux, "packet %"PRId64" ms before its DTS, lower the "
+                      "DTS delay", i_delay / 1000 );
+    }
+}
+
+static void TSDateCBR( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+                       mtime_t i_pcr_length, mtime_t i_pcr_dts )
+{
+    sout_mux_sys_t  *p_sys = p_mux->p_sys;
+    /* 27MHz ticks times bits/s per packet */
+    const int64_t i_slot = INT64_C(188 * 8) * 27000000;
+    const int64_t i_start = i_pcr_dts * 27;
+    const int64_t i_end = ( i_pcr_dts + i_pcr_length ) * 27;
+    int i_packet_count = p_chain_ts->i_depth;
+
+    /* Short gaps in the input are stuffed, longer ones restart the clock */
+    if( p_sys->i_cbr_clock == 0 ||
+        llabs( p_sys->i_cbr_clock - i_start ) > INT64_C(27000000) )
+    {
+        if( p_sys->i_cbr_clock != 0 )
+            msg_Warn( p_mux, "resetting the mux clock (%"PRId64" ms off)",
+                      ( p_sys->i_cbr_clock - i_start ) / 27000 );
+        p_sys->i_cbr_clock = i_start;
+        p_sys->i_cbr_rem = 0;
+    }
+
+    int64_t i_slots = 0;
+    if( i_end > p_sys->i_cbr_clock )
+        i_slots = ( i_end - p_sys->i_cbr_clock ) * p_sys->i_muxrate / i_slot;
+    if( i_slots < i_packet_count )
+    {
+        p_sys->i_cbr_overflows++;
+        msg_Warn( p_mux, "mux rate exceeded at %"PRId64" (%d pkt for %"PRId64
+                  " slots in %"PRId64" us)",
+                  i_pcr_dts + p_sys->i_shaping_delay * 3 / 2 - mdate(),
+                  i_packet_count, i_slots, i_pcr_length );
+        i_slots = i_packet_count;
+    }
+
+    TSScramble( p_mux, p_chain_ts );
+
+    block_t *p_burst = NULL;
+    int i_sent = 0;
+    for( int64_t i = 0; i < i_slots; i++ )
+    {
+        const mtime_t i_date = p_sys->i_cbr_clock / 27;
+        block_t *p_ts;
+
+        /* Spread the packets evenly over the slots, so that the PCRs stay
+         * as far apart as planned */
+        if( i_sent < i_packet_count && i * i_packet_count >= i_sent * i_slots )
+        {
+            p_ts = BufferChainGet( p_chain_ts );
+            i_sent++;
+            if( p_ts->i_dts > VLC_TS_INVALID )
+                TSCheckDelay( p_mux, p_ts, i_date );
+        }
+        else
+        {
+            p_ts = TSNull( p_mux );
+            p_sys->i_cbr_nulls++;
+        }
+
+        if( likely(p_ts != NULL) )
+        {
+            p_ts->i_dts    = i_date;
+            p_ts->i_length = i_slot / p_sys->i_muxrate / 27;
+
+            if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
+            {
+                /* The PCR is the arrival time of its last byte, which is
+                 * the 11th of the packet */
+                int64_t i_pcr = p_sys->i_cbr_clock
+                              + INT64_C(11 * 8) * 27000000 / p_sys->i_muxrate
+                              - ( p_sys->i_dts_delay + p_sys->first_dts ) * 27;
+                TSSetPCR( p_ts, i_pcr );
+            }
+
+            /* latency */
+            p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
+
+            TSWrite( p_mux, &p_burst, p_ts );
+        }
+
+        /* Next slot */
+        int64_t i_ticks = i_slot + p_sys->i_cbr_rem;
+        p_sys->i_cbr_clock += i_ticks / p_sys->i_muxrate;
+        p_sys->i_cbr_rem = i_ticks % p_sys->i_muxrate;
     }
+
+    TSWrite( p_mux, &p_burst, NULL );
 }
 
 static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
                        bool b_pcr )
 {
-    VLC_UNUSED(p_mux);
     block_t *p_pes = p_stream->state.chain_pes.p_first;
 
     bool b_new_pes = false;
@@ -1831,7 +2099,7 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         b_adaptation_field = true;
     }
 
-    block_t *p_ts = block_Alloc( 188 );
+    block_t *p_ts = block_PoolAlloc( p_mux->p_sys->packet_pool, 188 );
 
     if (b_new_pes && !(p_pes->i_flags & BLOCK_FLAG_NO_KEYFRAME) && p_pes->i_flags & BLOCK_FLAG_TYPE_I)
     {
@@ -1911,17 +2179,19 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
     return p_ts;
 }
 
-static void TSSetPCR( block_t *p_ts, mtime_t i_dts )
+/* Writes a PCR given in 27MHz ticks: a 90kHz base and a 27MHz extension */
+static void TSSetPCR( block_t *p_ts, int64_t i_pcr )
 {
-    mtime_t i_pcr = 9 * i_dts / 100;
-
-    p_ts->p_buffer[6]  = ( i_pcr >> 25 )&0xff;
-    p_ts->p_buffer[7]  = ( i_pcr >> 17 )&0xff;
-    p_ts->p_buffer[8]  = ( i_pcr >> 9  )&0xff;
-    p_ts->p_buffer[9]  = ( i_pcr >> 1  )&0xff;
-    p_ts->p_buffer[10] = ( i_pcr << 7  )&0x80;
-    p_ts->p_buffer[10] |= 0x7e;
-    p_ts->p_buffer[11] = 0; /* we don't set PCR extension */
+    int64_t  i_base = i_pcr / 300;
+    unsigned i_ext  = i_pcr % 300;
+
+    p_ts->p_buffer[6]  = ( i_base >> 25 )&0xff;
+    p_ts->p_buffer[7]  = ( i_base >> 17 )&0xff;
+    p_ts->p_buffer[8]  = ( i_base >> 9  )&0xff;
+    p_ts->p_buffer[9]  = ( i_base >> 1  )&0xff;
+    p_ts->p_buffer[10] = ( i_base << 7  )&0x80;
+    p_ts->p_buffer[10] |= 0x7e | ( ( i_ext >> 8 )&0x01 );
+    p_ts->p_buffer[11] = i_ext&0xff;
 }
 
 void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
@@ -237,8 +237,8 @@ block_t *convert_annexb_to_h264( block_t *p_block, size_t i_nal_length_size )
 {
     size_t i_startcode_ofs = 0;
     size_t i_startcode_size = 0;
-    uint32_t i_buf = p_block->i_buffer;
-    uint8_t *p_buf = p_block->p_buffer;
+    uint32_t i_buf;
+    uint8_t *p_buf;
     size_t i_ofs = 0;
 
     /* The length of the NAL size is encoded using 1, 2 or 4 bytes */
@@ -246,6 +246,13 @@ block_t *convert_annexb_to_h264( block_t *p_block, size_t i_nal_length_size )
      && i_nal_length_size != 4 )
         goto error;
 
+    /* The start codes are replaced in place */
+    p_block = block_Unshare( p_block );
+    if( !p_block )
+        return NULL;
+    i_buf = p_block->i_buffer;
+    p_buf = p_block->p_buffer;
+
     /* Replace the Annex B start code with the size of the NAL. */
     while( i_buf > 0 )
     {
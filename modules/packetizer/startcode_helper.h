@@ -0,0 +1,111 @@
+/*****************************************************************************
+ * startcode_helper.h: Annex B start code scanning
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_STARTCODE_HELPER_H_
+#define VLC_STARTCODE_HELPER_H_
+
+#include <string.h>
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+/* Start codes begin with a zero byte: whole chunks without any zero byte
+ * are skipped at once, and only the chunks containing one are checked byte
+ * per byte. */
+
+#ifdef __SSE2__
+static inline const uint8_t *startcode_FindAnnexB_SSE2( const uint8_t **pp,
+                                                        const uint8_t *end )
+{
+    const uint8_t *p = *pp;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8( 1 );
+
+    /* The 16 possible start codes of a chunk end up to 2 bytes after it */
+    for( ; end - p >= 18; p += 16 )
+    {
+        __m128i v = _mm_loadu_si128( (const __m128i *)p );
+        if( _mm_movemask_epi8( _mm_cmpeq_epi8( v, zero ) ) == 0 )
+            continue;
+
+        __m128i z = _mm_and_si128( _mm_cmpeq_epi8( v, zero ),
+                        _mm_cmpeq_epi8(
+                            _mm_loadu_si128( (const __m128i *)(p + 1) ), zero ) );
+        z = _mm_and_si128( z, _mm_cmpeq_epi8(
+                            _mm_loadu_si128( (const __m128i *)(p + 2) ), one ) );
+        unsigned i_mask = _mm_movemask_epi8( z );
+        if( i_mask )
+            return p + ctz( i_mask );
+    }
+    *pp = p;
+    return NULL;
+}
+#endif
+
+static inline const uint8_t *startcode_FindAnnexB_Bits( const uint8_t **pp,
+                                                        const uint8_t *end )
+{
+    const uint8_t *p = *pp;
+    /* Has a zero byte: https://graphics.stanford.edu/~seander/bithacks.html */
+#define HAS_ZERO_BYTE(x) (((x) - UINT64_C(0x0101010101010101)) & ~(x) & \
+                          UINT64_C(0x8080808080808080))
+
+    for( ; end - p >= 10; p += 8 )
+    {
+        uint64_t x;
+        memcpy( &x, p, sizeof(x) );
+        if( !HAS_ZERO_BYTE(x) )
+            continue;
+
+        for( unsigned i = 0; i < 8; i++ )
+            if( p[i] == 0 && p[i + 1] == 0 && p[i + 2] == 1 )
+                return p + i;
+    }
+#undef HAS_ZERO_BYTE
+    *pp = p;
+    return NULL;
+}
+
+/**
+ * Looks for the first 00 00 01 start code of [p, end).
+ * \return a pointer to the start code, or NULL if there is none
+ */
+static inline const uint8_t *startcode_FindAnnexB( const uint8_t *p,
+                                                   const uint8_t *end )
+{
+    const uint8_t *p_res;
+
+#ifdef __SSE2__
+    p_res = startcode_FindAnnexB_SSE2( &p, end );
+    if( p_res )
+        return p_res;
+#endif
+    p_res = startcode_FindAnnexB_Bits( &p, end );
+    if( p_res )
+        return p_res;
+
+    for( ; end - p >= 3; p++ )
+        if( p[0] == 0 && p[1] == 0 && p[2] == 1 )
+            return p;
+    return NULL;
+}
+
+#endif
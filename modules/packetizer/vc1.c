@@ -39,6 +39,7 @@
 #include <vlc_block_helper.h>
 #include "../codec/cc.h"
 #include "packetizer_helper.h"
+#include "startcode_helper.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -154,6 +155,7 @@ static int Open( vlc_object_t *p_this )
 
     packetizer_Init( &p_sys->packetizer,
                      p_vc1_startcode, sizeof(p_vc1_startcode),
+                     startcode_FindAnnexB,
                      NULL, 0, 4,
                      PacketizeReset, PacketizeParse, PacketizeValidate, p_dec );
 
@@ -482,9 +484,13 @@ static block_t *ParseIDU( decoder_t *p_dec, bool *pb_ts_used, block_t *p_frag )
                     p_es->video.i_height = i_potential_height;
 
                     /* Remove it */
-                    p_frag->p_buffer += 4;
-                    p_frag->i_buffer -= 4;
-                    memcpy( p_frag->p_buffer, startcode, sizeof(startcode) );
+                    p_release = p_frag = block_Unshare( p_frag );
+                    if( p_frag )
+                    {
+                        p_frag->p_buffer += 4;
+                        p_frag->i_buffer -= 4;
+                        memcpy( p_frag->p_buffer, startcode, sizeof(startcode) );
+                    }
                 }
             }
         }
@@ -76,6 +76,11 @@
 #define SAP_V4_LINK_ADDRESS     "224.0.0.255"
 #define ADD_SESSION 1
 
+/* Number of buckets of the announcements hash table (power of two) */
+#define SAP_HASH_SIZE 1024
+/* Maximum number of packets read from a socket per wake-up */
+#define SAP_BURST 64
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -209,6 +214,11 @@ struct sap_announce_t
     sdp_t       *p_sdp;
 
     input_item_t * p_item;
+
+    /* Next announce in the same hash table bucket */
+    struct sap_announce_t *p_next;
+    /* Index in the table of announces */
+    int i_index;
 };
 
 struct services_discovery_sys_t
@@ -222,6 +232,12 @@ struct services_discovery_sys_t
     /* Table of announces */
     int i_announces;
     struct sap_announce_t **pp_announces;
+    /* Announces by source and message identifier hash,
+     * or by origin for SAPv0 announces without hash */
+    struct sap_announce_t *pp_table[SAP_HASH_SIZE];
+    /* New announces, waiting to be added to the playlist */
+    int i_pending;
+    struct sap_announce_t **pp_pending;
 
     /* Modes */
     bool  b_strict;
@@ -251,6 +267,7 @@ struct demux_sys_t
     static sdp_t *ParseSDP (vlc_object_t *p_sd, const char *psz_sdp);
     static sap_announce_t *CreateAnnounce( services_discovery_t *, uint32_t *, uint16_t, sdp_t * );
     static int RemoveAnnounce( services_discovery_t *p_sd, sap_announce_t *p_announce );
+    static void AddAnnounces( services_discovery_t *p_sd );
 
 /* Helper functions */
     static inline attribute_t *MakeAttribute (const char *str);
@@ -269,6 +286,56 @@ static inline int min_int( int a, int b )
     return a > b ? b : a;
 }
 
+static unsigned HashAnnounce( const uint32_t *i_source, uint16_t i_hash )
+{
+    uint32_t h = i_hash;
+    for( int i = 0; i < 4; i++ )
+        h = h * 0x01000193 ^ i_source[i];
+    return ( h ^ ( h >> 16 ) ) & ( SAP_HASH_SIZE - 1 );
+}
+
+static unsigned HashSession( const sdp_t *p_sdp )
+{
+    /* FNV-1a of the fields compared by IsSameSession() */
+    uint32_t h = 0x811c9dc5;
+    for( const char *psz = p_sdp->username; *psz; psz++ )
+        h = ( h ^ (uint8_t)*psz ) * 0x01000193;
+    for( const char *psz = p_sdp->orig_host; *psz; psz++ )
+        h = ( h ^ (uint8_t)*psz ) * 0x01000193;
+    h = ( h ^ (uint32_t)p_sdp->session_id ) * 0x01000193;
+    h = ( h ^ (uint32_t)( p_sdp->session_id >> 32 ) ) * 0x01000193;
+    h = ( h ^ p_sdp->orig_ip_version ) * 0x01000193;
+    return ( h ^ ( h >> 16 ) ) & ( SAP_HASH_SIZE - 1 );
+}
+
+static unsigned GetAnnounceBucket( const sap_announce_t *p_announce )
+{
+    if( p_announce->i_hash )
+        return HashAnnounce( p_announce->i_source, p_announce->i_hash );
+    return HashSession( p_announce->p_sdp );
+}
+
+/* Finds a known announce by source and hash, or by session if no hash */
+static sap_announce_t *FindAnnounce( services_discovery_sys_t *p_sys,
+                                     const uint32_t *i_source, uint16_t i_hash,
+                                     sdp_t *p_sdp )
+{
+    unsigned i_bucket = i_hash ? HashAnnounce( i_source, i_hash )
+                               : HashSession( p_sdp );
+
+    for( sap_announce_t *p_announce = p_sys->pp_table[i_bucket];
+         p_announce != NULL; p_announce = p_announce->p_next )
+    {
+        if( i_hash ? ( p_announce->i_hash == i_hash
+                       && !memcmp( p_announce->i_source, i_source,
+                                   sizeof( p_announce->i_source ) ) )
+                   : ( !p_announce->i_hash
+                       && IsSameSession( p_announce->p_sdp, p_sdp ) ) )
+            return p_announce;
+    }
+    return NULL;
+}
+
 static bool IsWellKnownPayload (int type)
 {
     switch (type)
@@ -310,6 +377,9 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->i_announces = 0;
     p_sys->pp_announces = NULL;
+    for( unsigned i = 0; i < SAP_HASH_SIZE; i++ )
+        p_sys->pp_table[i] = NULL;
+    TAB_INIT( p_sys->i_pending, p_sys->pp_pending );
     /* TODO: create sockets here, and fix racy sockets table */
     if (vlc_clone (&p_sys->thread, Run, p_sd, VLC_THREAD_PRIORITY_LOW))
     {
@@ -430,6 +500,8 @@ static void Close( vlc_object_t *p_this )
         RemoveAnnounce( p_sd, p_sys->pp_announces[i] );
     }
     FREENULL( p_sys->pp_announces );
+    assert( p_sys->i_pending == 0 );
+    TAB_CLEAN( p_sys->i_pending, p_sys->pp_pending );
 
     free( p_sys );
 }
@@ -554,18 +626,30 @@ static void *Run( void *data )
                     uint8_t p_buffer[MAX_SAP_BUFFER+1];
                     ssize_t i_read;
 
-                    i_read = recv (ufd[i].fd, p_buffer, MAX_SAP_BUFFER, 0);
-                    if (i_read < 0)
-                        msg_Warn (p_sd, "receive error: %s",
-                                  vlc_strerror_c(errno));
-                    if (i_read > 6)
+                    /* Drain the socket, so that bursts do not overflow it */
+                    for (unsigned j = 0; j < SAP_BURST; j++)
                     {
-                        /* Parse the packet */
-                        p_buffer[i_read] = '\0';
-                        ParseSAP (p_sd, p_buffer, i_read);
+                        i_read = recv (ufd[i].fd, p_buffer, MAX_SAP_BUFFER,
+                                       j ? MSG_DONTWAIT : 0);
+                        if (i_read < 0)
+                        {
+                            if (j == 0 || errno != EAGAIN)
+                                msg_Warn (p_sd, "receive error: %s",
+                                          vlc_strerror_c(errno));
+                            break;
+                        }
+                        if (i_read > 6)
+                        {
+                            /* Parse the packet */
+                            p_buffer[i_read] = '\0';
+                            ParseSAP (p_sd, p_buffer, i_read);
+                        }
                     }
                 }
             }
+
+            /* Add the new announces together, once the sockets are read */
+            AddAnnounces (p_sd);
         }
 
         mtime_t now = mdate();
@@ -575,7 +659,7 @@ static void *Run( void *data )
         timeout = 1000 * 60 * 60;
 
         /* Check for items that need deletion */
-        for( i = 0; i < p_sd->p_sys->i_announces; i++ )
+        for( i = 0; i < p_sd->p_sys->i_announces; )
         {
             mtime_t i_timeout = ( mtime_t ) 1000000 * p_sd->p_sys->i_timeout;
             sap_announce_t * p_announce = p_sd->p_sys->pp_announces[i];
@@ -587,6 +671,7 @@ static void *Run( void *data )
             if( ( p_announce->i_period_trust > 5 && i_last_period > 10 * p_announce->i_period ) ||
                 i_last_period > i_timeout )
             {
+                /* The last announce takes its place in the table */
                 RemoveAnnounce( p_sd, p_announce );
             }
             else
@@ -595,6 +680,7 @@ static void *Run( void *data )
                 if( p_announce->i_period_trust > 5 )
                     timeout = min_int((10 * p_announce->i_period - i_last_period) / 1000, timeout);
                 timeout = min_int((i_timeout - i_last_period)/1000, timeout);
+                i++;
             }
         }
 
@@ -658,11 +744,30 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
  * Local functions
  **************************************************************/
 
+static void RefreshAnnounce( sap_announce_t *p_announce, bool b_need_delete )
+{
+    /* We don't support delete announcement as they can easily
+     * Be used to highjack an announcement by a third party.
+     * Instead we cleverly implement Implicit Announcement removal.
+     */
+    if( b_need_delete )
+        return;
+
+    /* No need to go after six, as we start to trust the
+     * average period at six */
+    if( p_announce->i_period_trust <= 5 )
+        p_announce->i_period_trust++;
+
+    /* Compute the average period */
+    mtime_t now = mdate();
+    p_announce->i_period = ( p_announce->i_period * (p_announce->i_period_trust-1) + (now - p_announce->i_last) ) / p_announce->i_period_trust;
+    p_announce->i_last = now;
+}
+
 /* i_read is at least > 6 */
 static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
                      size_t len )
 {
-    int i;
     const char          *psz_sdp;
     const uint8_t *end = buf + len;
     sdp_t               *p_sdp;
@@ -716,6 +821,16 @@ static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
     if (buf > end)
         return VLC_EGENERIC;
 
+    /* Known announce: skip decompression and SDP parsing altogether */
+    sap_announce_t *p_announce = NULL;
+    if( i_hash )
+        p_announce = FindAnnounce( p_sd->p_sys, i_source, i_hash, NULL );
+    if( p_announce != NULL )
+    {
+        RefreshAnnounce( p_announce, b_need_delete );
+        return VLC_SUCCESS;
+    }
+
     uint8_t *decomp = NULL;
     if( b_compressed )
     {
@@ -787,39 +902,15 @@ static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
         goto error;
     }
 
-    for( i = 0 ; i< p_sd->p_sys->i_announces ; i++ )
+    /* SAPv0 announce without hash: identify the session */
+    if( !i_hash )
+        p_announce = FindAnnounce( p_sd->p_sys, NULL, 0, p_sdp );
+    if( p_announce != NULL )
     {
-        sap_announce_t * p_announce = p_sd->p_sys->pp_announces[i];
-        /* FIXME: slow */
-        if( ( !i_hash && IsSameSession( p_announce->p_sdp, p_sdp ) )
-            || ( i_hash && p_announce->i_hash == i_hash
-                 && !memcmp(p_announce->i_source, i_source, sizeof(i_source)) ) )
-        {
-            /* We don't support delete announcement as they can easily
-             * Be used to highjack an announcement by a third party.
-             * Instead we cleverly implement Implicit Announcement removal.
-             *
-             * if( b_need_delete )
-             *    RemoveAnnounce( p_sd, p_sd->p_sys->pp_announces[i]);
-             * else
-             */
-
-            if( !b_need_delete )
-            {
-                /* No need to go after six, as we start to trust the
-                 * average period at six */
-                if( p_announce->i_period_trust <= 5 )
-                    p_announce->i_period_trust++;
-
-                /* Compute the average period */
-                mtime_t now = mdate();
-                p_announce->i_period = ( p_announce->i_period * (p_announce->i_period_trust-1) + (now - p_announce->i_last) ) / p_announce->i_period_trust;
-                p_announce->i_last = now;
-            }
-            FreeSDP( p_sdp );
-            free (decomp);
-            return VLC_SUCCESS;
-        }
+        RefreshAnnounce( p_announce, b_need_delete );
+        FreeSDP( p_sdp );
+        free (decomp);
+        return VLC_SUCCESS;
     }
 
     CreateAnnounce( p_sd, i_source, i_hash, p_sdp );
@@ -890,33 +981,54 @@ sap_announce_t *CreateAnnounce( services_discovery_t *p_sd, uint32_t *i_source,
                            p_sdp->username );
     }
 
-    /* Handle category */
-    psz_value = GetAttribute(p_sap->p_sdp->pp_attributes,
-                             p_sap->p_sdp->i_attributes, "cat");
-    if (psz_value != NULL)
-    {
-        /* a=cat provides a dot-separated hierarchy.
-         * For the time being only replace dots with pipe. TODO: FIXME */
-        char *str = strdup(psz_value);
-        if (likely(str != NULL))
-            for (char *p = strchr(str, '.'); p != NULL; p = strchr(p, '.'))
-                *(p++) = '|';
-        services_discovery_AddItem(p_sd, p_input, str ? str : psz_value);
-        free(str);
-    }
-    else
-    {
-        /* backward compatibility with VLC 0.7.3-2.0.0 senders */
-        psz_value = GetAttribute(p_sap->p_sdp->pp_attributes,
-                                 p_sap->p_sdp->i_attributes, "x-plgroup");
-        services_discovery_AddItem(p_sd, p_input, psz_value);
-    }
+    unsigned i_bucket = GetAnnounceBucket( p_sap );
+    p_sap->p_next = p_sys->pp_table[i_bucket];
+    p_sys->pp_table[i_bucket] = p_sap;
 
+    p_sap->i_index = p_sys->i_announces;
     TAB_APPEND( p_sys->i_announces, p_sys->pp_announces, p_sap );
+    TAB_APPEND( p_sys->i_pending, p_sys->pp_pending, p_sap );
 
     return p_sap;
 }
 
+/* Adds the new announces to the services discovery */
+static void AddAnnounces( services_discovery_t *p_sd )
+{
+    services_discovery_sys_t *p_sys = p_sd->p_sys;
+
+    for( int i = 0; i < p_sys->i_pending; i++ )
+    {
+        sap_announce_t *p_sap = p_sys->pp_pending[i];
+        input_item_t *p_input = p_sap->p_item;
+        const char *psz_value;
+
+        /* Handle category */
+        psz_value = GetAttribute(p_sap->p_sdp->pp_attributes,
+                                 p_sap->p_sdp->i_attributes, "cat");
+        if (psz_value != NULL)
+        {
+            /* a=cat provides a dot-separated hierarchy.
+             * For the time being only replace dots with pipe. TODO: FIXME */
+            char *str = strdup(psz_value);
+            if (likely(str != NULL))
+                for (char *p = strchr(str, '.'); p != NULL; p = strchr(p, '.'))
+                    *(p++) = '|';
+            services_discovery_AddItem(p_sd, p_input, str ? str : psz_value);
+            free(str);
+        }
+        else
+        {
+            /* backward compatibility with VLC 0.7.3-2.0.0 senders */
+            psz_value = GetAttribute(p_sap->p_sdp->pp_attributes,
+                                     p_sap->p_sdp->i_attributes, "x-plgroup");
+            services_discovery_AddItem(p_sd, p_input, psz_value);
+        }
+    }
+
+    TAB_CLEAN( p_sys->i_pending, p_sys->pp_pending );
+}
+
 
 static const char *FindAttribute (const sdp_t *sdp, unsigned media,
                                   const char *name)
@@ -1551,7 +1663,20 @@ static void FreeSDP( sdp_t *p_sdp )
 static int RemoveAnnounce( services_discovery_t *p_sd,
                            sap_announce_t *p_announce )
 {
-    int i;
+    services_discovery_sys_t *p_sys = p_sd->p_sys;
+
+    /* Unlink from the hash table, while the SDP is still there */
+    sap_announce_t **pp = &p_sys->pp_table[GetAnnounceBucket( p_announce )];
+    while( *pp != p_announce )
+        pp = &(*pp)->p_next;
+    *pp = p_announce->p_next;
+
+    /* Move the last announce in its place in the table */
+    sap_announce_t *p_last = p_sys->pp_announces[p_sys->i_announces - 1];
+    p_sys->pp_announces[p_announce->i_index] = p_last;
+    p_last->i_index = p_announce->i_index;
+    if( --p_sys->i_announces == 0 )
+        FREENULL( p_sys->pp_announces );
 
     if( p_announce->p_sdp )
     {
@@ -1566,16 +1691,6 @@ static int RemoveAnnounce( services_discovery_t *p_sd,
         p_announce->p_item = NULL;
     }
 
-    for( i = 0; i< p_sd->p_sys->i_announces; i++)
-    {
-        if( p_sd->p_sys->pp_announces[i] == p_announce )
-        {
-            REMOVE_ELEM( p_sd->p_sys->pp_announces, p_sd->p_sys->i_announces,
-                         i);
-            break;
-        }
-    }
-
     free( p_announce );
 
     return VLC_SUCCESS;
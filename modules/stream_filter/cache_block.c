@@ -49,9 +49,12 @@
 #ifdef OPTIMIZE_MEMORY
     /* Max size of our cache 128Ko per track */
 #   define STREAM_CACHE_SIZE  (1024*128)
+#   define STREAM_CACHE_MIN_SIZE STREAM_CACHE_SIZE
 #else
     /* Max size of our cache 4Mo per track */
 #   define STREAM_CACHE_SIZE  (4*12*1024*1024)
+    /* Size of the cache while the stream is read sequentially */
+#   define STREAM_CACHE_MIN_SIZE (1024*1024)
 #endif
 
 /* How many data we try to prebuffer
@@ -61,7 +64,13 @@
 
 /* Method: Simple, for pf_block.
  *  We get blocks and put them in the linked list.
- *  We release blocks once the total size is bigger than CACHE_BLOCK_SIZE
+ *  We release blocks once the total size is bigger than the cache size.
+ *
+ *  The cache size follows the access pattern: it doubles (up to
+ *  STREAM_CACHE_SIZE) whenever a backward seek goes past the cached data,
+ *  and halves (down to STREAM_CACHE_MIN_SIZE) after twice its size was read
+ *  without such a seek. A sequential reader then does not hold tens of
+ *  megabytes it will never read again.
  */
 
 struct stream_sys_t
@@ -76,15 +85,36 @@ struct stream_sys_t
     block_t     *p_first;
     block_t    **pp_last;
 
+    uint64_t     i_cache_size;   /* Current cache size */
+    uint64_t     i_sequential;   /* Bytes read since the last cache miss */
+
     struct
     {
         /* Stat about reading data */
         uint64_t i_read_count;
         uint64_t i_bytes;
         uint64_t i_read_time;
+
+        /* Stat about seeking */
+        unsigned i_seek_count;
+        unsigned i_seek_hits;    /* served from the cache */
     } stat;
 };
 
+/* A backward seek went past the cached data: keep more of it */
+static void AStreamCacheMiss(stream_t *s)
+{
+    stream_sys_t *sys = s->p_sys;
+
+    if (sys->i_cache_size < STREAM_CACHE_SIZE)
+    {
+        sys->i_cache_size = __MIN(2 * sys->i_cache_size, STREAM_CACHE_SIZE);
+        msg_Dbg(s, "random access, cache size %"PRIu64" KiB",
+                sys->i_cache_size / 1024);
+    }
+    sys->i_sequential = 0;
+}
+
 static block_t *AReadBlock(stream_t *s, bool *restrict eof)
 {
     block_t *block;
@@ -101,8 +131,18 @@ static int AStreamRefillBlock(stream_t *s)
 {
     stream_sys_t *sys = s->p_sys;
 
+    /* Sequential access: keep less data */
+    if (sys->i_sequential >= 2 * sys->i_cache_size &&
+        sys->i_cache_size > STREAM_CACHE_MIN_SIZE)
+    {
+        sys->i_cache_size = __MAX(sys->i_cache_size / 2, STREAM_CACHE_MIN_SIZE);
+        sys->i_sequential = 0;
+        msg_Dbg(s, "sequential access, cache size %"PRIu64" KiB",
+                sys->i_cache_size / 1024);
+    }
+
     /* Release data */
-    while (sys->i_size >= STREAM_CACHE_SIZE &&
+    while (sys->i_size >= sys->i_cache_size &&
            sys->p_first != sys->p_current)
     {
         block_t *b = sys->p_first;
@@ -113,7 +153,7 @@ static int AStreamRefillBlock(stream_t *s)
 
         block_Release(b);
     }
-    if (sys->i_size >= STREAM_CACHE_SIZE &&
+    if (sys->i_size >= sys->i_cache_size &&
         sys->p_current == sys->p_first &&
         sys->p_current->p_next)    /* At least 2 packets */
     {
@@ -250,9 +290,13 @@ static int AStreamSeekBlock(stream_t *s, uint64_t i_pos)
     int64_t    i_offset = i_pos - sys->i_start;
     bool b_seek;
 
+    sys->stat.i_seek_count++;
+
     /* We already have thoses data, just update p_current/i_offset */
     if (i_offset >= 0 && (uint64_t)i_offset < sys->i_size)
     {
+        sys->stat.i_seek_hits++;
+
         block_t *b = sys->p_first;
         int i_current = 0;
 
@@ -282,6 +326,7 @@ static int AStreamSeekBlock(stream_t *s, uint64_t i_pos)
             return VLC_EGENERIC;
         }
 
+        AStreamCacheMiss(s);
         b_seek = true;
     }
     else
@@ -307,7 +352,7 @@ static int AStreamSeekBlock(stream_t *s, uint64_t i_pos)
             int i_th = b_aseekfast ? 1 : 5;
 
             if (i_skip <= i_th * i_avg &&
-                i_skip < STREAM_CACHE_SIZE)
+                (uint64_t)i_skip < sys->i_cache_size)
                 b_seek = false;
             else
                 b_seek = true;
@@ -392,6 +437,7 @@ static ssize_t AStreamReadBlock(stream_t *s, void *buf, size_t len)
         memcpy(buf, &sys->p_current->p_buffer[sys->i_offset], i_copy);
 
     sys->i_offset += i_copy;
+    sys->i_sequential += i_copy;
     if (sys->i_offset >= sys->p_current->i_buffer)
     {   /* Current block is now empty, switch to next */
         sys->i_offset = 0;
@@ -466,6 +512,11 @@ static int Open(vlc_object_t *obj)
     sys->stat.i_bytes = 0;
     sys->stat.i_read_time = 0;
     sys->stat.i_read_count = 0;
+    sys->stat.i_seek_count = 0;
+    sys->stat.i_seek_hits = 0;
+
+    sys->i_cache_size = STREAM_CACHE_MIN_SIZE;
+    sys->i_sequential = 0;
 
     msg_Dbg(s, "Using block method for AStream*");
 
@@ -502,6 +553,9 @@ static void Close(vlc_object_t *obj)
     stream_t *s = (stream_t *)obj;
     stream_sys_t *sys = s->p_sys;
 
+    msg_Dbg(s, "read %"PRIu64" bytes in %"PRIu64" blocks, %u seeks, "
+            "%u from the cache", sys->stat.i_bytes, sys->stat.i_read_count,
+            sys->stat.i_seek_count, sys->stat.i_seek_hits);
     block_ChainRelease(sys->p_first);
     free(sys);
 }
@@ -0,0 +1,185 @@
+/*****************************************************************************
+ * inflate.c: in-process gzip decompression stream filter
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_stream.h>
+
+static int  Open (vlc_object_t *);
+static void Close (vlc_object_t *);
+
+vlc_module_begin ()
+    set_category (CAT_INPUT)
+    set_subcategory (SUBCAT_INPUT_STREAM_FILTER)
+    /* Takes precedence over the external zcat of the decomp module */
+    set_capability ("stream_filter", 30)
+    set_description (N_("gzip decompression"))
+    set_callbacks (Open, Close)
+vlc_module_end ()
+
+struct stream_sys_t
+{
+    z_stream zstream;
+    bool     eof;
+    unsigned char buffer[65536]; /* compressed data */
+};
+
+static ssize_t Read (stream_t *stream, void *buf, size_t buflen)
+{
+    stream_sys_t *sys = stream->p_sys;
+    z_stream *zs = &sys->zstream;
+
+    if (buf == NULL) /* caller skips data */
+    {
+        unsigned char dummy[16384];
+        size_t total = 0;
+
+        while (total < buflen)
+        {
+            size_t len = buflen - total;
+            ssize_t val = Read (stream, dummy,
+                                (len < sizeof (dummy)) ? len : sizeof (dummy));
+            if (val <= 0)
+                break;
+            total += val;
+        }
+        return total;
+    }
+
+    if (buflen > UINT_MAX)
+        buflen = UINT_MAX;
+
+    zs->next_out = buf;
+    zs->avail_out = buflen;
+
+    /* Return as soon as some data was decompressed */
+    while (!sys->eof && zs->avail_out == buflen)
+    {
+        if (zs->avail_in == 0)
+        {
+            ssize_t len = stream_Read (stream->p_source, sys->buffer,
+                                       sizeof (sys->buffer));
+            if (len <= 0)
+            {
+                sys->eof = true;
+                break;
+            }
+            zs->next_in = sys->buffer;
+            zs->avail_in = len;
+        }
+
+        int val = inflate (zs, Z_NO_FLUSH);
+        switch (val)
+        {
+            case Z_OK:
+            case Z_BUF_ERROR: /* no progress possible without input */
+                break;
+            case Z_STREAM_END: /* concatenated members, as gunzip accepts */
+                if (inflateReset (zs) != Z_OK)
+                    sys->eof = true;
+                break;
+            default:
+                msg_Err (stream, "decompression error: %s",
+                         (zs->msg != NULL) ? zs->msg : "unknown");
+                sys->eof = true;
+        }
+    }
+
+    return buflen - zs->avail_out;
+}
+
+static int Control (stream_t *stream, int query, va_list args)
+{
+    switch (query)
+    {
+        case STREAM_CAN_SEEK:
+        case STREAM_CAN_FASTSEEK:
+            *(va_arg (args, bool *)) = false;
+            break;
+        case STREAM_GET_SIZE:
+            *(va_arg (args, uint64_t *)) = 0;
+            break;
+        case STREAM_CAN_PAUSE:
+        case STREAM_CAN_CONTROL_PACE:
+        case STREAM_GET_PTS_DELAY:
+        case STREAM_SET_PAUSE_STATE:
+            return stream_vaControl (stream->p_source, query, args);
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+/**
+ * Detects gzip file format
+ */
+static int Open (vlc_object_t *obj)
+{
+    stream_t      *stream = (stream_t *)obj;
+    const uint8_t *peek;
+
+    if (stream_Peek (stream->p_source, &peek, 3) < 3)
+        return VLC_EGENERIC;
+
+    if (memcmp (peek, "\x1f\x8b\x08", 3))
+        return VLC_EGENERIC;
+
+    stream_sys_t *sys = malloc (sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    sys->zstream.next_in = Z_NULL;
+    sys->zstream.avail_in = 0;
+    sys->zstream.zalloc = Z_NULL;
+    sys->zstream.zfree = Z_NULL;
+    sys->zstream.opaque = Z_NULL;
+    sys->eof = false;
+
+    /* 16 + window bits: gzip header and trailer */
+    if (inflateInit2 (&sys->zstream, 16 + MAX_WBITS) != Z_OK)
+    {
+        free (sys);
+        return VLC_EGENERIC;
+    }
+
+    msg_Dbg (obj, "detected gzip compressed stream");
+    stream->p_sys = sys;
+    stream->pf_read = Read;
+    stream->pf_seek = NULL;
+    stream->pf_control = Control;
+    return VLC_SUCCESS;
+}
+
+static void Close (vlc_object_t *obj)
+{
+    stream_t *stream = (stream_t *)obj;
+    stream_sys_t *sys = stream->p_sys;
+
+    inflateEnd (&sys->zstream);
+    free (sys);
+}
@@ -51,6 +51,17 @@
 #include <vlc_stream.h>
 #include <vlc_fs.h>
 #include <vlc_interrupt.h>
+#include <vlc_atomic.h>
+#include <vlc_memory.h>
+
+/* Copy of previously buffered data, kept across seeks */
+struct prefetch_window
+{
+    struct prefetch_window *next;
+    uint64_t     offset;
+    size_t       length;
+    char         data[];
+};
 
 struct stream_sys_t
 {
@@ -73,13 +84,240 @@ struct stream_sys_t
 
     uint64_t     buffer_offset;
     uint64_t     stream_offset;
+    uint64_t     seek_origin; /* read offset before the last seek */
     size_t       buffer_length;
     size_t       buffer_size;
     char        *buffer;
     size_t       read_size;
+    size_t       read_size_min;
+    size_t       read_size_max;
     size_t       seek_threshold;
+
+    vlc_membudget_t *budget;
+    atomic_size_t buffer_limit; /* requested by the memory budget */
+    bool         trimmed; /* memory released for the current limit */
+
+    struct prefetch_window *windows; /* most recently used first */
+    unsigned     window_count;
+    unsigned     window_max;
+    size_t       window_size;
 };
 
+/**
+ * Finds the saved window containing a given offset, and marks it as the most
+ * recently used one.
+ */
+static struct prefetch_window *WindowFind(stream_sys_t *sys, uint64_t offset)
+{
+    for (struct prefetch_window **pp = &sys->windows; *pp != NULL;
+         pp = &(*pp)->next)
+    {
+        struct prefetch_window *w = *pp;
+
+        if (offset < w->offset || offset - w->offset >= w->length)
+            continue;
+
+        *pp = w->next;
+        w->next = sys->windows;
+        sys->windows = w;
+        return w;
+    }
+    return NULL;
+}
+
+/**
+ * Keeps a copy of the buffered data around the last read offset before the
+ * buffer is discarded by a seek, so that demuxers going back and forth (e.g.
+ * between an index and the data) do not read it again from the source.
+ */
+static void WindowSave(stream_sys_t *sys)
+{
+    size_t length = sys->buffer_length;
+
+    if (sys->window_max == 0 || length == 0)
+        return;
+    if (length > sys->window_size)
+        length = sys->window_size;
+
+    uint64_t end = sys->buffer_offset + sys->buffer_length;
+    uint64_t offset = end - length;
+
+    if (sys->seek_origin >= sys->buffer_offset && sys->seek_origin <= end)
+    {   /* Half before, half after where the reader left, if possible */
+        uint64_t start = sys->buffer_offset;
+
+        if (sys->seek_origin - start > sys->window_size / 2)
+            start = sys->seek_origin - sys->window_size / 2;
+        if (start < offset)
+            offset = start;
+    }
+
+    /* Saved windows never overlap */
+    for (struct prefetch_window **pp = &sys->windows; *pp != NULL;)
+    {
+        struct prefetch_window *w = *pp;
+
+        if (w->offset < offset + length && offset < w->offset + w->length)
+        {
+            *pp = w->next;
+            free(w);
+            sys->window_count--;
+        }
+        else
+            pp = &w->next;
+    }
+
+    struct prefetch_window *w = malloc(sizeof (*w) + length);
+    if (unlikely(w == NULL))
+        return;
+
+    w->offset = offset;
+    w->length = length;
+    /* The buffer is mapped twice in a row: no need to handle wrapping */
+    memcpy(w->data, sys->buffer + (offset % sys->buffer_size), length);
+    w->next = sys->windows;
+    sys->windows = w;
+
+    if (++sys->window_count > sys->window_max)
+    {   /* Evict the least recently used window */
+        struct prefetch_window **pp = &sys->windows;
+
+        while ((*pp)->next != NULL)
+            pp = &(*pp)->next;
+        free(*pp);
+        *pp = NULL;
+        sys->window_count--;
+    }
+}
+
+static void WindowsClear(stream_sys_t *sys)
+{
+    while (sys->windows != NULL)
+    {
+        struct prefetch_window *w = sys->windows;
+
+        sys->windows = w->next;
+        free(w);
+    }
+    sys->window_count = 0;
+}
+
+/**
+ * Memory budget shrink request. It is only recorded here: the thread applies
+ * it the next time it looks at the buffer.
+ */
+static void BudgetShrink(void *opaque, size_t target)
+{
+    stream_sys_t *sys = opaque;
+
+    atomic_store(&sys->buffer_limit, target);
+    vlc_cond_signal(&sys->wait_space);
+}
+
+static void ThreadAccount(stream_sys_t *sys)
+{
+    size_t usage = sys->buffer_length;
+
+    for (const struct prefetch_window *w = sys->windows; w != NULL; w = w->next)
+        usage += w->length;
+    vlc_membudget_Set(sys->budget, usage);
+}
+
+/**
+ * Returns how much of the buffer may be filled: all of it, unless the memory
+ * budget asked for less. At least one read must fit.
+ */
+static size_t ThreadBufferSize(stream_sys_t *sys)
+{
+    size_t limit = atomic_load(&sys->buffer_limit);
+
+    if (limit >= sys->buffer_size)
+    {
+        sys->trimmed = false;
+        return sys->buffer_size;
+    }
+    if (limit < sys->read_size)
+        limit = sys->read_size;
+    return limit;
+}
+
+/**
+ * Releases the memory not holding data under memory pressure: the saved
+ * windows, and the pages of the unused part of the buffer.
+ */
+static void ThreadTrim(stream_sys_t *sys)
+{
+    WindowsClear(sys);
+
+#if !defined(_WIN32) && defined(MADV_REMOVE)
+    /* The buffer is mapped twice in a row: the unused part is contiguous */
+    uintptr_t page_mask = sysconf(_SC_PAGESIZE) - 1;
+    char *start = sys->buffer + (sys->buffer_offset + sys->buffer_length)
+                                % sys->buffer_size;
+    uintptr_t first = ((uintptr_t)start + page_mask) & ~page_mask;
+    uintptr_t last = ((uintptr_t)start + sys->buffer_size
+                      - sys->buffer_length) & ~page_mask;
+
+    if (last > first)
+        madvise((void *)first, last - first, MADV_REMOVE);
+#endif
+    sys->trimmed = true;
+}
+
+/**
+ * Determines the offset from where the buffer shall be filled: the read
+ * offset, unless the data there is already available from saved windows.
+ * Returns false while enough saved data remains ahead of the reader, in which
+ * case the buffer should be left alone.
+ */
+static bool ThreadOffset(const stream_sys_t *sys, uint64_t *restrict pos)
+{
+    uint64_t offset = sys->stream_offset;
+
+    for (;;)
+    {
+        if (offset >= sys->buffer_offset
+         && offset - sys->buffer_offset <= sys->buffer_length)
+        {   /* in the buffer, or right after */
+            *pos = offset;
+            return true;
+        }
+
+        const struct prefetch_window *w;
+
+        for (w = sys->windows; w != NULL; w = w->next)
+            if (offset >= w->offset && offset - w->offset < w->length)
+                break;
+        if (w == NULL)
+            break;
+        offset = w->offset + w->length;
+    }
+
+    *pos = offset;
+    return offset - sys->stream_offset <= sys->read_size;
+}
+
+#define READ_DURATION (CLOCK_FREQ / 4)
+
+/**
+ * Sizes the background reads after the measured throughput. Large reads are
+ * more efficient, but the thread cannot react to seeks while blocked in one,
+ * so aim at about READ_DURATION per read.
+ */
+static void ThreadAdaptReadSize(stream_sys_t *sys, size_t length,
+                                mtime_t duration)
+{
+    uint64_t size = 2 * length;
+
+    if (duration > 0 && length * READ_DURATION / duration < size)
+        size = length * READ_DURATION / duration;
+    if (size > sys->read_size_max)
+        size = sys->read_size_max;
+    if (size < sys->read_size_min)
+        size = sys->read_size_min;
+    sys->read_size = size;
+}
+
 static int ThreadRead(stream_t *stream, size_t length)
 {
     stream_sys_t *sys = stream->p_sys;
@@ -90,7 +328,9 @@ static int ThreadRead(stream_t *stream, size_t length)
 
     char *p = sys->buffer + (sys->buffer_offset % sys->buffer_size)
                           + sys->buffer_length;
+    mtime_t duration = mdate();
     ssize_t val = stream_Read(stream->p_source, p, length);
+    duration = mdate() - duration;
 
     if (val < 0)
         msg_Err(stream, "cannot read data (at offset %"PRIu64")",
@@ -108,6 +348,8 @@ static int ThreadRead(stream_t *stream, size_t length)
         sys->eof = true;
 
     assert((size_t)val <= length);
+    if ((size_t)val == length && length == sys->read_size)
+        ThreadAdaptReadSize(sys, length, duration);
     sys->buffer_length += val;
     assert(sys->buffer_length <= sys->buffer_size);
     //msg_Dbg(stream, "buffer: %zu/%zu", sys->buffer_length, sys->buffer_size);
@@ -119,6 +361,7 @@ static int ThreadSeek(stream_t *stream, uint64_t seek_offset)
     stream_sys_t *sys = stream->p_sys;
     int canc = vlc_savecancel();
 
+    WindowSave(sys);
     vlc_mutex_unlock(&sys->lock);
 
     int val = stream_Seek(stream->p_source, seek_offset);
@@ -134,6 +377,7 @@ static int ThreadSeek(stream_t *stream, uint64_t seek_offset)
     sys->buffer_offset = seek_offset;
     sys->buffer_length = 0;
     sys->eof = false;
+    ThreadAccount(sys);
     return 0;
 }
 
@@ -186,9 +430,17 @@ static void *Thread(void *data)
             continue;
         }
 
-        if (sys->stream_offset < sys->buffer_offset)
+        uint64_t offset;
+
+        if (!ThreadOffset(sys, &offset))
+        {   /* Reading from saved windows, wait until their end is close */
+            vlc_cond_wait(&sys->wait_space, &sys->lock);
+            continue;
+        }
+
+        if (offset < sys->buffer_offset)
         {   /* Need to seek backward */
-            if (ThreadSeek(stream, sys->stream_offset))
+            if (ThreadSeek(stream, offset))
                 break;
             continue;
         }
@@ -199,25 +451,33 @@ static void *Thread(void *data)
             continue;
         }
 
-        assert(sys->stream_offset >= sys->buffer_offset);
+        assert(offset >= sys->buffer_offset);
 
         /* As long as there is space, the buffer will retain already read
          * ("historical") data. The data can be used if/when seeking backward.
          * Unread data is however given precedence if the buffer is full. */
-        uint64_t history = sys->stream_offset - sys->buffer_offset;
+        uint64_t history = offset - sys->buffer_offset;
 
         if (sys->can_seek
          && history >= (sys->buffer_length + sys->seek_threshold))
         {   /* Large skip: seek forward */
-            if (ThreadSeek(stream, sys->stream_offset))
+            if (ThreadSeek(stream, offset))
                 break;
             continue;
         }
 
         assert(sys->buffer_size >= sys->buffer_length);
 
-        size_t unused = sys->buffer_size - sys->buffer_length;
-        if (unused == 0)
+        size_t size = ThreadBufferSize(sys);
+        if (size < sys->buffer_size && !sys->trimmed)
+        {
+            msg_Dbg(stream, "memory budget exceeded, shrinking to %zu bytes",
+                    size);
+            ThreadTrim(sys);
+            ThreadAccount(sys);
+        }
+
+        if (sys->buffer_length >= size)
         {   /* Buffer is full */
             if (history == 0)
             {
@@ -235,20 +495,27 @@ static void *Thread(void *data)
                 continue;
             }
 
-            /* Discard some historical data to make room. */
-            size_t discard = sys->read_size;
+            /* Discard some historical data to make room, and the data
+             * beyond the size allowed by the memory budget. */
+            size_t discard = sys->read_size + (sys->buffer_length - size);
             if (discard > history)
                 discard = history;
 
-            /* discard <= sys->read_size <= sys->buffer_size = ...
-             * ... unused + sys->buffer_length = 0 + sys->buffer_length */
+            /* history <= sys->buffer_length, as the read offset is at most
+             * at the end of the buffered data */
             assert(discard <= sys->buffer_length);
             sys->buffer_offset += discard;
             sys->buffer_length -= discard;
             history -= discard;
-            unused = discard;
+            if (size < sys->buffer_size)
+                ThreadTrim(sys);
+            ThreadAccount(sys);
+            if (sys->buffer_length >= size)
+                continue;
         }
 
+        size_t unused = size - sys->buffer_length;
+
         /* Some streams cannot return a short data count and just wait for all
          * requested data to become available (e.g. regular files). So we have
          * to limit the data read in a single operation to avoid blocking for
@@ -258,6 +525,7 @@ static void *Thread(void *data)
 
         if (ThreadRead(stream, unused))
             break;
+        ThreadAccount(sys);
 
         vlc_cond_signal(&sys->wait_data);
     }
@@ -276,6 +544,7 @@ static int Seek(stream_t *stream, uint64_t offset)
     vlc_mutex_lock(&sys->lock);
     if (sys->stream_offset != offset)
     {
+        sys->seek_origin = sys->stream_offset;
         sys->stream_offset = offset;
         vlc_cond_signal(&sys->wait_space);
     }
@@ -283,25 +552,37 @@ static int Seek(stream_t *stream, uint64_t offset)
     return 0;
 }
 
-static size_t BufferLevel(const stream_t *stream, bool *eof)
+static size_t BufferLevel(stream_t *stream, const char **data, bool *eof)
 {
     stream_sys_t *sys = stream->p_sys;
 
     *eof = false;
 
-    if (sys->stream_offset < sys->buffer_offset)
-        return 0;
-    if ((sys->stream_offset - sys->buffer_offset) >= sys->buffer_length)
+    if (sys->stream_offset >= sys->buffer_offset
+     && (sys->stream_offset - sys->buffer_offset) < sys->buffer_length)
     {
-        *eof = sys->eof;
-        return 0;
+        *data = sys->buffer + (sys->stream_offset % sys->buffer_size);
+        return sys->buffer_offset + sys->buffer_length - sys->stream_offset;
+    }
+
+    struct prefetch_window *w = WindowFind(sys, sys->stream_offset);
+    if (w != NULL)
+    {
+        size_t delta = sys->stream_offset - w->offset;
+
+        *data = w->data + delta;
+        return w->length - delta;
     }
-    return sys->buffer_offset + sys->buffer_length - sys->stream_offset;
+
+    if (sys->stream_offset >= sys->buffer_offset)
+        *eof = sys->eof;
+    return 0;
 }
 
 static ssize_t Read(stream_t *stream, void *buf, size_t buflen)
 {
     stream_sys_t *sys = stream->p_sys;
+    const char *p;
     size_t copy;
     bool eof;
 
@@ -319,7 +600,7 @@ static ssize_t Read(stream_t *stream, void *buf, size_t buflen)
         vlc_cond_signal(&sys->wait_space);
     }
 
-    while ((copy = BufferLevel(stream, &eof)) == 0 && !eof)
+    while ((copy = BufferLevel(stream, &p, &eof)) == 0 && !eof)
     {
         void *data[2];
 
@@ -333,7 +614,6 @@ static ssize_t Read(stream_t *stream, void *buf, size_t buflen)
         vlc_interrupt_forward_stop(data);
     }
 
-    char *p = sys->buffer + (sys->stream_offset % sys->buffer_size);
     if (copy > buflen)
         copy = buflen;
     if (copy > 0)
@@ -456,10 +736,17 @@ static int Open(vlc_object_t *obj)
     sys->paused = false;
     sys->buffer_offset = 0;
     sys->stream_offset = 0;
+    sys->seek_origin = 0;
     sys->buffer_length = 0;
     sys->buffer_size = var_InheritInteger(obj, "prefetch-buffer-size") << 10u;
     sys->read_size = var_InheritInteger(obj, "prefetch-read-size");
     sys->seek_threshold = var_InheritInteger(obj, "prefetch-seek-threshold");
+    sys->windows = NULL;
+    sys->window_count = 0;
+    sys->window_max = var_InheritInteger(obj, "prefetch-windows");
+    sys->window_size = var_InheritInteger(obj, "prefetch-window-size") << 10u;
+    atomic_init(&sys->buffer_limit, SIZE_MAX);
+    sys->trimmed = false;
 
     uint64_t size = stream_Size(stream->p_source);
     if (size > 0)
@@ -471,6 +758,8 @@ static int Open(vlc_object_t *obj)
     }
     if (sys->buffer_size < sys->read_size)
         sys->buffer_size = sys->read_size;
+    if (sys->window_size > sys->buffer_size)
+        sys->window_size = sys->buffer_size;
 
 #ifndef _WIN32
     /* Round up to a multiple of the page size */
@@ -543,6 +832,13 @@ static int Open(vlc_object_t *obj)
         goto error;
 #endif /* _WIN32 */
 
+    /* The configured read size is the smallest; it grows with the
+     * throughput up to a quarter of the buffer. */
+    sys->read_size_min = sys->read_size;
+    sys->read_size_max = sys->buffer_size / 4;
+    if (sys->read_size_max < sys->read_size_min)
+        sys->read_size_max = sys->read_size_min;
+
     sys->interrupt = vlc_interrupt_create();
     if (unlikely(sys->interrupt == NULL))
         goto error;
@@ -550,11 +846,13 @@ static int Open(vlc_object_t *obj)
     vlc_mutex_init(&sys->lock);
     vlc_cond_init(&sys->wait_data);
     vlc_cond_init(&sys->wait_space);
+    sys->budget = vlc_membudget_Register("prefetch", BudgetShrink, sys);
 
     stream->p_sys = sys;
 
     if (vlc_clone(&sys->thread, Thread, stream, VLC_THREAD_PRIORITY_LOW))
     {
+        vlc_membudget_Unregister(sys->budget);
         vlc_cond_destroy(&sys->wait_space);
         vlc_cond_destroy(&sys->wait_data);
         vlc_mutex_destroy(&sys->lock);
@@ -562,8 +860,9 @@ static int Open(vlc_object_t *obj)
         goto error;
     }
 
-    msg_Dbg(stream, "using %zu bytes buffer, %zu bytes read",
-            sys->buffer_size, sys->read_size);
+    msg_Dbg(stream, "using %zu bytes buffer, %zu bytes read, "
+            "%u windows of %zu bytes", sys->buffer_size, sys->read_size,
+            sys->window_max, sys->window_size);
     stream->pf_read = Read;
     stream->pf_readdir = ReadDir;
     stream->pf_control = Control;
@@ -596,11 +895,14 @@ static void Close (vlc_object_t *obj)
     vlc_cancel(sys->thread);
     vlc_interrupt_kill(sys->interrupt);
     vlc_join(sys->thread, NULL);
+    vlc_membudget_Unregister(sys->budget);
     vlc_interrupt_destroy(sys->interrupt);
     vlc_cond_destroy(&sys->wait_space);
     vlc_cond_destroy(&sys->wait_data);
     vlc_mutex_destroy(&sys->lock);
 
+    WindowsClear(sys);
+
 #ifndef _WIN32
     munmap(sys->buffer, 2 * sys->buffer_size);
 #else
@@ -628,4 +930,11 @@ vlc_module_begin()
     add_integer("prefetch-seek-threshold", 1 << 14, N_("Seek threshold"),
                 N_("Prefetch forward seek threshold (bytes)"), true)
         change_integer_range(0, UINT64_C(1) << 60)
+    add_integer("prefetch-windows", 4, N_("Kept windows"),
+                N_("Number of buffered ranges kept across seeks"), true)
+        change_integer_range(0, 64)
+    add_integer("prefetch-window-size", 1 << 11, N_("Window size"),
+                N_("Size of each buffered range kept across seeks (KiB)"),
+                true)
+        change_integer_range(4, 1 << 20)
 vlc_module_end()
@@ -32,6 +32,9 @@
 #include <vlc_plugin.h>
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <vlc_stream.h>
 #include <vlc_input.h>
 #include <vlc_fs.h>
@@ -43,21 +46,78 @@
 static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 
+#define BUFFER_SIZE_TEXT N_("Record buffer size")
+#define BUFFER_SIZE_LONGTEXT N_( \
+    "Size of the buffer between the input and the recording thread (KiB).")
+#define WRITE_SIZE_TEXT N_("Record write size")
+#define WRITE_SIZE_LONGTEXT N_( \
+    "Size of each write to the recording file (KiB).")
+#define STALL_TEXT N_("Stall when recording is too slow")
+#define STALL_LONGTEXT N_( \
+    "Wait for the storage when the record buffer is full, " \
+    "instead of dropping data from the recording.")
+#define DIRECT_TEXT N_("Direct I/O")
+#define DIRECT_LONGTEXT N_( \
+    "Write the recording bypassing the system cache, where supported.")
+#define PREALLOCATE_TEXT N_("Preallocated size")
+#define PREALLOCATE_LONGTEXT N_( \
+    "Space reserved for the recording file when it is created (MiB), " \
+    "against fragmentation. The file is truncated at the end.")
+
 vlc_module_begin()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_STREAM_FILTER )
     set_description( N_("Internal stream record") )
     set_capability( "stream_filter", 0 )
     set_callbacks( Open, Close )
+
+    add_integer( "record-buffer-size", 8192, BUFFER_SIZE_TEXT,
+                 BUFFER_SIZE_LONGTEXT, true )
+        change_integer_range( 64, 1 << 20 )
+    add_integer( "record-write-size", 1024, WRITE_SIZE_TEXT,
+                 WRITE_SIZE_LONGTEXT, true )
+        change_integer_range( 4, 1 << 16 )
+    add_bool( "record-stall", false, STALL_TEXT, STALL_LONGTEXT, true )
+    add_bool( "record-direct", false, DIRECT_TEXT, DIRECT_LONGTEXT, true )
+    add_integer( "record-preallocate", 0, PREALLOCATE_TEXT,
+                 PREALLOCATE_LONGTEXT, true )
+        change_integer_range( 0, 1 << 20 )
 vlc_module_end()
 
 /*****************************************************************************
  *
  *****************************************************************************/
+/* Alignment of the buffer and of the writes (for direct I/O) */
+#define RECORD_ALIGN 4096
+
 struct stream_sys_t
 {
-    FILE *f;        /* TODO it could be replaced by access_output_t one day */
-    bool b_error;
+    int fd;         /* TODO it could be replaced by access_output_t one day */
+    bool b_direct;
+    bool b_stall;
+    bool b_preallocated;
+
+    vlc_thread_t thread;
+    vlc_mutex_t  lock;
+    vlc_cond_t   wait_data;   /* for the writer thread */
+    vlc_cond_t   wait_space;  /* for the reading thread */
+
+    /* Ring buffer, protected by the lock */
+    uint8_t *p_buffer;
+    size_t   i_size;
+    size_t   i_chunk;   /* Size of the writes, divides i_size */
+    size_t   i_start;   /* Offset of the data to write */
+    size_t   i_used;
+    bool     b_stop;
+    bool     b_error;
+    bool     b_dropping;
+
+    /* Statistics, protected by the lock */
+    uint64_t i_written;
+    uint64_t i_dropped;
+    unsigned i_writes;
+    mtime_t  i_latency_total;
+    mtime_t  i_latency_max;
 };
 
 
@@ -71,6 +131,7 @@ static int  Control( stream_t *, int i_query, va_list );
 static int  Start  ( stream_t *, const char *psz_extension );
 static int  Stop   ( stream_t * );
 static void Write  ( stream_t *, const uint8_t *p_buffer, size_t i_buffer );
+static void *Run   ( void * );
 
 /****************************************************************************
  * Open
@@ -85,7 +146,10 @@ static int Open ( vlc_object_t *p_this )
     if( !p_sys )
         return VLC_ENOMEM;
 
-    p_sys->f = NULL;
+    p_sys->fd = -1;
+    vlc_mutex_init( &p_sys->lock );
+    vlc_cond_init( &p_sys->wait_data );
+    vlc_cond_init( &p_sys->wait_space );
 
     /* */
     s->pf_read = Read;
@@ -104,9 +168,12 @@ static void Close( vlc_object_t *p_this )
     stream_t *s = (stream_t*)p_this;
     stream_sys_t *p_sys = s->p_sys;
 
-    if( p_sys->f )
+    if( p_sys->fd != -1 )
         Stop( s );
 
+    vlc_cond_destroy( &p_sys->wait_space );
+    vlc_cond_destroy( &p_sys->wait_data );
+    vlc_mutex_destroy( &p_sys->lock );
     free( p_sys );
 }
 
@@ -119,14 +186,14 @@ static ssize_t Read( stream_t *s, void *p_read, size_t i_read )
     void *p_record = p_read;
 
     /* Allocate a temporary buffer for record when no p_read */
-    if( p_sys->f && !p_record )
+    if( p_sys->fd != -1 && !p_record )
         p_record = malloc( i_read );
 
     /* */
     const ssize_t i_record = stream_Read( s->p_source, p_record, i_read );
 
     /* Dump read data */
-    if( p_sys->f )
+    if( p_sys->fd != -1 )
     {
         if( p_record && i_record > 0 )
             Write( s, p_record, i_record );
@@ -152,7 +219,7 @@ static int Control( stream_t *s, int i_query, va_list args )
     if( b_active )
         psz_extension = (const char*)va_arg( args, const char* );
 
-    if( !s->p_sys->f == !b_active )
+    if( (s->p_sys->fd != -1) == b_active )
         return VLC_SUCCESS;
 
     if( b_active )
@@ -169,7 +236,6 @@ static int Start( stream_t *s, const char *psz_extension )
     stream_sys_t *p_sys = s->p_sys;
 
     char *psz_file;
-    FILE *f;
 
     /* */
     if( !psz_extension )
@@ -192,12 +258,80 @@ static int Start( stream_t *s, const char *psz_extension )
     if( !psz_file )
         return VLC_ENOMEM;
 
-    f = vlc_fopen( psz_file, "wb" );
-    if( !f )
+    const bool b_direct = var_InheritBool( s, "record-direct" );
+    int fd = -1;
+#ifdef O_DIRECT
+    if( b_direct )
+    {
+        fd = vlc_open( psz_file, O_WRONLY|O_CREAT|O_TRUNC|O_DIRECT, 0666 );
+        if( fd == -1 && errno == EINVAL )
+            msg_Warn( s, "direct I/O not supported by the file system" );
+    }
+#endif
+    if( fd == -1 )
+        fd = vlc_open( psz_file, O_WRONLY|O_CREAT|O_TRUNC, 0666 );
+    if( fd == -1 )
     {
         free( psz_file );
         return VLC_EGENERIC;
     }
+#ifdef O_DIRECT
+    p_sys->b_direct = b_direct && (fcntl( fd, F_GETFL ) & O_DIRECT);
+#else
+    p_sys->b_direct = false;
+#endif
+
+    /* The writes are whole chunks (but for the last one), so that they are
+     * aligned in memory and in the file */
+    p_sys->i_chunk = var_InheritInteger( s, "record-write-size" ) * 1024;
+    p_sys->i_size = var_InheritInteger( s, "record-buffer-size" ) * 1024;
+    p_sys->i_size = __MAX( p_sys->i_size - p_sys->i_size % p_sys->i_chunk,
+                           2 * p_sys->i_chunk );
+    p_sys->p_buffer = vlc_memalign( RECORD_ALIGN, p_sys->i_size );
+    if( p_sys->p_buffer == NULL )
+    {
+        close( fd );
+        free( psz_file );
+        return VLC_ENOMEM;
+    }
+
+    const int64_t i_preallocate = var_InheritInteger( s, "record-preallocate" );
+    p_sys->b_preallocated = false;
+#ifdef HAVE_POSIX_FALLOCATE
+    if( i_preallocate > 0 )
+    {
+        errno = posix_fallocate( fd, 0, i_preallocate * 1024 * 1024 );
+        if( errno == 0 )
+            p_sys->b_preallocated = true;
+        else
+            msg_Warn( s, "cannot preallocate the recording: %s",
+                      vlc_strerror_c(errno) );
+    }
+#else
+    VLC_UNUSED(i_preallocate);
+#endif
+
+    p_sys->fd = fd;
+    p_sys->b_stall = var_InheritBool( s, "record-stall" );
+    p_sys->i_start = 0;
+    p_sys->i_used = 0;
+    p_sys->b_stop = false;
+    p_sys->b_error = false;
+    p_sys->b_dropping = false;
+    p_sys->i_written = 0;
+    p_sys->i_dropped = 0;
+    p_sys->i_writes = 0;
+    p_sys->i_latency_total = 0;
+    p_sys->i_latency_max = 0;
+
+    if( vlc_clone( &p_sys->thread, Run, s, VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_free( p_sys->p_buffer );
+        close( fd );
+        p_sys->fd = -1;
+        free( psz_file );
+        return VLC_EGENERIC;
+    }
 
     /* signal new record file */
     var_SetString( s->p_libvlc, "record-file", psz_file );
@@ -205,20 +339,38 @@ static int Start( stream_t *s, const char *psz_extension )
     msg_Dbg( s, "Recording into %s", psz_file );
     free( psz_file );
 
-    /* */
-    p_sys->f = f;
-    p_sys->b_error = false;
     return VLC_SUCCESS;
 }
 static int Stop( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
 
-    assert( p_sys->f );
+    assert( p_sys->fd != -1 );
+
+    /* Let the writer thread flush the buffer */
+    vlc_mutex_lock( &p_sys->lock );
+    p_sys->b_stop = true;
+    vlc_cond_signal( &p_sys->wait_data );
+    vlc_mutex_unlock( &p_sys->lock );
+    vlc_join( p_sys->thread, NULL );
 
     msg_Dbg( s, "Recording completed" );
-    fclose( p_sys->f );
-    p_sys->f = NULL;
+    msg_Dbg( s, "recorded %"PRIu64" bytes in %u writes (latency average %"
+             PRId64" us, max %"PRId64" us), dropped %"PRIu64" bytes",
+             p_sys->i_written, p_sys->i_writes,
+             p_sys->i_writes ? p_sys->i_latency_total / p_sys->i_writes : 0,
+             p_sys->i_latency_max, p_sys->i_dropped );
+
+    if( p_sys->b_preallocated )
+    {
+        off_t i_end = lseek( p_sys->fd, 0, SEEK_CUR );
+        if( i_end == -1 || ftruncate( p_sys->fd, i_end ) )
+            msg_Warn( s, "cannot truncate the recording: %s",
+                      vlc_strerror_c(errno) );
+    }
+    close( p_sys->fd );
+    p_sys->fd = -1;
+    vlc_free( p_sys->p_buffer );
     return VLC_SUCCESS;
 }
 
@@ -226,19 +378,122 @@ static void Write( stream_t *s, const uint8_t *p_buffer, size_t i_buffer )
 {
     stream_sys_t *p_sys = s->p_sys;
 
-    assert( p_sys->f );
+    assert( p_sys->fd != -1 );
+
+    vlc_mutex_lock( &p_sys->lock );
+    while( p_sys->b_stall && !p_sys->b_error &&
+           p_sys->i_size - p_sys->i_used < i_buffer && p_sys->i_used > 0 )
+        vlc_cond_wait( &p_sys->wait_space, &p_sys->lock );
 
-    if( i_buffer > 0 )
+    const bool b_previous_dropping = p_sys->b_dropping;
+    p_sys->b_dropping = p_sys->i_size - p_sys->i_used < i_buffer;
+
+    /* TODO maybe a intf_UserError or something like that ? */
+    if( p_sys->b_dropping && !b_previous_dropping )
+        msg_Err( s, "Recording too slow, dropping data (begin)" );
+    else if( !p_sys->b_dropping && b_previous_dropping )
+        msg_Err( s, "Recording too slow, dropping data (end)" );
+
+    if( p_sys->b_dropping )
+        p_sys->i_dropped += i_buffer;
+    else
     {
-        const bool b_previous_error = p_sys->b_error;
-        const size_t i_written = fwrite( p_buffer, 1, i_buffer, p_sys->f );
+        while( i_buffer > 0 )
+        {
+            const size_t i_end = (p_sys->i_start + p_sys->i_used) % p_sys->i_size;
+            const size_t i_copy = __MIN( i_buffer, p_sys->i_size - i_end );
+
+            memcpy( &p_sys->p_buffer[i_end], p_buffer, i_copy );
+            p_sys->i_used += i_copy;
+            p_buffer += i_copy;
+            i_buffer -= i_copy;
+        }
+        if( p_sys->i_used >= p_sys->i_chunk )
+            vlc_cond_signal( &p_sys->wait_data );
+    }
+    vlc_mutex_unlock( &p_sys->lock );
+}
+
+static ssize_t WriteAll( int fd, const uint8_t *p_buffer, size_t i_buffer )
+{
+    size_t i_done = 0;
+
+    while( i_done < i_buffer )
+    {
+        ssize_t i_ret = write( fd, p_buffer + i_done, i_buffer - i_done );
+        if( i_ret < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+            return -1;
+        }
+        i_done += i_ret;
+    }
+    return i_done;
+}
+
+static void *Run( void *p_data )
+{
+    stream_t *s = p_data;
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+    for( ;; )
+    {
+        /* Wait for a whole chunk, but do not keep a partial chunk for more
+         * than a second (unless it cannot be written directly) */
+        mtime_t i_deadline = mdate() + CLOCK_FREQ;
+        while( !p_sys->b_stop && p_sys->i_used < p_sys->i_chunk )
+        {
+            if( vlc_cond_timedwait( &p_sys->wait_data, &p_sys->lock,
+                                    i_deadline ) == 0 )
+                continue;
+            if( p_sys->i_used > 0 && !p_sys->b_direct )
+                break;
+            i_deadline = mdate() + CLOCK_FREQ;
+        }
+        if( p_sys->i_used == 0 )
+        {
+            if( p_sys->b_stop )
+                break;
+            continue;
+        }
+
+        const uint8_t *p_chunk = &p_sys->p_buffer[p_sys->i_start];
+        size_t i_chunk = __MIN( p_sys->i_used, p_sys->i_chunk );
+        i_chunk = __MIN( i_chunk, p_sys->i_size - p_sys->i_start );
+#ifdef O_DIRECT
+        if( p_sys->b_direct && i_chunk < p_sys->i_chunk )
+        {   /* The tail of the recording is not aligned */
+            fcntl( p_sys->fd, F_SETFL, fcntl( p_sys->fd, F_GETFL ) & ~O_DIRECT );
+            p_sys->b_direct = false;
+        }
+#endif
+        vlc_mutex_unlock( &p_sys->lock );
 
-        p_sys->b_error = i_written != i_buffer;
+        const mtime_t i_date = mdate();
+        const bool b_error = WriteAll( p_sys->fd, p_chunk, i_chunk ) < 0;
+        const mtime_t i_latency = mdate() - i_date;
 
+        vlc_mutex_lock( &p_sys->lock );
         /* TODO maybe a intf_UserError or something like that ? */
-        if( p_sys->b_error && !b_previous_error )
+        if( b_error && !p_sys->b_error )
             msg_Err( s, "Failed to record data (begin)" );
-        else if( !p_sys->b_error && b_previous_error )
+        else if( !b_error && p_sys->b_error )
             msg_Err( s, "Failed to record data (end)" );
+        p_sys->b_error = b_error;
+
+        if( !b_error )
+            p_sys->i_written += i_chunk;
+        p_sys->i_writes++;
+        p_sys->i_latency_total += i_latency;
+        p_sys->i_latency_max = __MAX( p_sys->i_latency_max, i_latency );
+
+        /* The data is consumed even on error, not to stall the input */
+        p_sys->i_start = (p_sys->i_start + i_chunk) % p_sys->i_size;
+        p_sys->i_used -= i_chunk;
+        vlc_cond_signal( &p_sys->wait_space );
     }
+    vlc_mutex_unlock( &p_sys->lock );
+    return NULL;
 }
@@ -161,7 +161,7 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *p_es,
     }
 
     if ( !p_es->b_error )
-        p_stream->p_next->pf_send( p_stream->p_next, p_es->id, p_buffer );
+        sout_StreamIdSend( p_stream->p_next, p_es->id, p_buffer );
     else
         block_ChainRelease( p_buffer );
 
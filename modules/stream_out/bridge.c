@@ -508,7 +508,7 @@ static int SendIn( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
 
     /* First forward the packet for our own ES */
     if( !p_sys->b_placeholder )
-        p_stream->p_next->pf_send( p_stream->p_next, id->id, p_buffer );
+        sout_StreamIdSend( p_stream->p_next, id->id, p_buffer );
 
     /* Then check all bridged streams */
     vlc_mutex_lock( &lock );
@@ -617,9 +617,9 @@ static int SendIn( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                             ( p_bridge->pp_es[i]->fmt.i_cat == VIDEO_ES &&
                               p_bridge->pp_es[i]->p_block->i_flags & BLOCK_FLAG_TYPE_I ) )
                         {
-                            p_stream->p_next->pf_send( p_stream->p_next,
-                                       newid,
-                                       p_bridge->pp_es[i]->p_block );
+                            sout_StreamIdSend( p_stream->p_next,
+                                               newid,
+                                               p_bridge->pp_es[i]->p_block );
                             p_sys->i_state = placeholder_off;
                         }
                         break;
@@ -629,16 +629,16 @@ static int SendIn( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                             break;
                         p_sys->i_last_audio = i_date;
                     default:
-                        p_stream->p_next->pf_send( p_stream->p_next,
-                                   newid?newid:p_bridge->pp_es[i]->id,
-                                   p_bridge->pp_es[i]->p_block );
+                        sout_StreamIdSend( p_stream->p_next,
+                                           newid?newid:p_bridge->pp_es[i]->id,
+                                           p_bridge->pp_es[i]->p_block );
                         break;
                 }
             }
             else /* !b_placeholder */
-                p_stream->p_next->pf_send( p_stream->p_next,
-                                       p_bridge->pp_es[i]->id,
-                                       p_bridge->pp_es[i]->p_block );
+                sout_StreamIdSend( p_stream->p_next,
+                                   p_bridge->pp_es[i]->id,
+                                   p_bridge->pp_es[i]->p_block );
         }
         else
         {
@@ -669,7 +669,7 @@ static int SendIn( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                        || p_buffer->i_flags & BLOCK_FLAG_TYPE_I ) )
                   || p_sys->i_state == placeholder_on )
                 {
-                    p_stream->p_next->pf_send( p_stream->p_next, id->id, p_buffer );
+                    sout_StreamIdSend( p_stream->p_next, id->id, p_buffer );
                     p_sys->i_state = placeholder_on;
                 }
                 else
@@ -678,7 +678,7 @@ static int SendIn( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
 
             case AUDIO_ES:
                 if( p_sys->i_last_audio + p_sys->i_placeholder_delay < i_date )
-                    p_stream->p_next->pf_send( p_stream->p_next, id->id, p_buffer );
+                    sout_StreamIdSend( p_stream->p_next, id->id, p_buffer );
                 else
                     block_Release( p_buffer );
                 break;
@@ -69,7 +69,8 @@ struct sout_stream_sys_t
 {
     sout_stream_sys_t()
         : p_tls(NULL), i_requestId(0),
-          i_status(CHROMECAST_DISCONNECTED), p_out(NULL)
+          i_status(CHROMECAST_DISCONNECTED), p_out(NULL),
+          p_transcode(NULL), p_transcode_last(NULL), b_webm(false)
     {
     }
 
@@ -91,6 +92,18 @@ struct sout_stream_sys_t
     vlc_cond_t loadCommandCond;
 
     sout_stream_t *p_out;
+
+    /* Encoders for the ES the Chromecast cannot play, created on demand.
+     * They feed the same HTTP output as the remuxed ES. */
+    sout_stream_t *p_transcode;
+    sout_stream_t *p_transcode_last;
+    bool b_webm;
+};
+
+struct sout_stream_id_sys_t
+{
+    sout_stream_t        *p_out;
+    sout_stream_id_sys_t *p_id;
 };
 
 // Media player Chromecast app id
@@ -168,27 +181,95 @@ vlc_module_end ()
 /*****************************************************************************
  * Sout callbacks
  *****************************************************************************/
+/**
+ * @brief Check whether the Chromecast can play an ES as is
+ * @param p_fmt the ES format
+ * @param b_webm whether the ES is muxed in WebM rather than MP4
+ */
+static bool canRemux(const es_format_t *p_fmt, bool b_webm)
+{
+    switch (p_fmt->i_codec)
+    {
+    case VLC_CODEC_H264:
+        /* Up to High profile, level 4.1 */
+        if (b_webm)
+            return false;
+        if (p_fmt->i_profile > 100 || p_fmt->i_level > 41)
+            return false;
+        return true;
+    case VLC_CODEC_MP4A:
+        return !b_webm;
+    case VLC_CODEC_MPGA:
+        /* MP3 only */
+        return !b_webm && (p_fmt->i_profile <= 0 || p_fmt->i_profile == 3);
+    case VLC_CODEC_VP8:
+    case VLC_CODEC_VORBIS:
+    case VLC_CODEC_OPUS:
+        return b_webm;
+    default:
+        /* Let the muxer decide for the other ES categories */
+        return p_fmt->i_cat != VIDEO_ES && p_fmt->i_cat != AUDIO_ES;
+    }
+}
+
+
 static sout_stream_id_sys_t *Add(sout_stream_t *p_stream, const es_format_t *p_fmt)
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
-    return p_sys->p_out->pf_add(p_sys->p_out, p_fmt);
+    sout_stream_t *p_out = p_sys->p_out;
+
+    if (!canRemux(p_fmt, p_sys->b_webm))
+    {
+        if (p_sys->p_transcode == NULL)
+        {
+            char psz_chain[] = "transcode{vcodec=h264,acodec=mp4a}";
+            char psz_webm_chain[] = "transcode{vcodec=VP80,acodec=vorb}";
+
+            p_sys->p_transcode = sout_StreamChainNew(p_stream->p_sout,
+                                    p_sys->b_webm ? psz_webm_chain : psz_chain,
+                                    p_sys->p_out, &p_sys->p_transcode_last);
+            if (p_sys->p_transcode == NULL)
+            {
+                msg_Err(p_stream, "Could not create the transcoder for the "
+                        "unsupported ES");
+                return NULL;
+            }
+        }
+        msg_Dbg(p_stream, "transcoding ES with codec %4.4s",
+                (const char *)&p_fmt->i_codec);
+        p_out = p_sys->p_transcode;
+    }
+
+    sout_stream_id_sys_t *id = new(std::nothrow) sout_stream_id_sys_t;
+    if (id == NULL)
+        return NULL;
+
+    id->p_out = p_out;
+    id->p_id = p_out->pf_add(p_out, p_fmt);
+    if (id->p_id == NULL)
+    {
+        delete id;
+        return NULL;
+    }
+    return id;
 }
 
 
 static void Del(sout_stream_t *p_stream, sout_stream_id_sys_t *id)
 {
-    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    VLC_UNUSED(p_stream);
 
-    p_sys->p_out->pf_del(p_sys->p_out, id);
+    id->p_out->pf_del(id->p_out, id->p_id);
+    delete id;
 }
 
 
 static int Send(sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                 block_t *p_buffer)
 {
-    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    VLC_UNUSED(p_stream);
 
-    return p_sys->p_out->pf_send(p_sys->p_out, id, p_buffer);
+    return sout_StreamIdSend(id->p_out, id->p_id, p_buffer);
 }
 
 
@@ -239,6 +320,8 @@ static int Open(vlc_object_t *p_this)
         Clean(p_stream);
         return VLC_EGENERIC;
     }
+    p_sys->b_webm = strstr(psz_mux, "webm") != NULL || strstr(psz_mux, "mkv") != NULL;
+
     char *psz_chain = NULL;
     int i_bytes = asprintf(&psz_chain, "http{dst=:%u/stream,mux=%s}",
                            (unsigned)var_InheritInteger(p_stream, SOUT_CFG_PREFIX"http-port"),
@@ -347,6 +430,8 @@ static void Clean(sout_stream_t *p_stream)
     {
         vlc_mutex_destroy(&p_sys->lock);
         vlc_cond_destroy(&p_sys->loadCommandCond);
+        if (p_sys->p_transcode)
+            sout_StreamChainDelete(p_sys->p_transcode, p_sys->p_transcode_last);
         sout_StreamChainDelete(p_sys->p_out, p_sys->p_out);
     }
 
@@ -171,5 +171,5 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
         }
     }
 
-    return p_stream->p_next->pf_send( p_stream->p_next, id, p_buffer );
+    return sout_StreamIdSend( p_stream->p_next, id, p_buffer );
 }
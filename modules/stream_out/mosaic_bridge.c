@@ -366,6 +366,9 @@ static sout_stream_id_sys_t * Add( sout_stream_t *p_stream, const es_format_t *p
     p_es->p_picture = NULL;
     p_es->pp_last = &p_es->p_picture;
     p_es->b_empty = false;
+    p_es->i_tile_width = 0;
+    p_es->i_tile_height = 0;
+    p_es->b_tile_ar = false;
 
     vlc_global_unlock( VLC_MOSAIC_MUTEX );
 
@@ -514,8 +517,40 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                                                         &p_buffer )) )
     {
         picture_t *p_new_pic;
+        unsigned i_tile_width, i_tile_height;
+        bool b_tile_ar;
 
-        if( p_sys->i_height || p_sys->i_width )
+        vlc_global_lock( VLC_MOSAIC_MUTEX );
+        i_tile_width = p_sys->p_es->i_tile_width;
+        i_tile_height = p_sys->p_es->i_tile_height;
+        b_tile_ar = p_sys->p_es->b_tile_ar;
+        vlc_global_unlock( VLC_MOSAIC_MUTEX );
+
+        if( !p_sys->i_height && !p_sys->i_width && !p_sys->p_vf2
+         && i_tile_width && i_tile_height )
+        {
+            /* Scale to the mosaic tile here, on the input thread, rather
+             * than in the mosaic filter for all inputs in turn */
+            video_format_t fmt_out;
+
+            if( p_sys->p_image == NULL )
+                p_sys->p_image = image_HandlerCreate( p_stream );
+
+            mosaic_TileFormat( &fmt_out, &p_pic->format, i_tile_width,
+                               i_tile_height, b_tile_ar );
+
+            p_new_pic = NULL;
+            if( p_sys->p_image != NULL )
+                p_new_pic = image_Convert( p_sys->p_image, p_pic,
+                                           &p_pic->format, &fmt_out );
+            if( p_new_pic == NULL )
+            {
+                msg_Err( p_stream, "image conversion failed" );
+                picture_Release( p_pic );
+                continue;
+            }
+        }
+        else if( p_sys->i_height || p_sys->i_width )
         {
             video_format_t fmt_out, fmt_in;
 
@@ -167,6 +167,14 @@ static const char *const ppsz_protocols[] = {
 #define RFC3016_LONGTEXT N_( \
     "This allows you to stream MPEG4 LATM audio streams (see RFC3016)." )
 
+#define SENDERS_TEXT N_("Sender threads")
+#define SENDERS_LONGTEXT N_( \
+    "Number of threads sending the packets to the destinations, each " \
+    "destination having its own queue, so that a slow client does not " \
+    "delay the others. With 0, packets are sent to all the destinations " \
+    "in turn. The default (-1) uses 4 threads for RTSP and VoD, none " \
+    "otherwise." )
+
 #define RTSP_TIMEOUT_TEXT N_( "RTSP session timeout (s)" )
 #define RTSP_TIMEOUT_LONGTEXT N_( "RTSP sessions will be closed after " \
     "not receiving any RTSP request for this long. Setting it to a " \
@@ -231,6 +239,9 @@ vlc_module_begin ()
               RTCP_MUX_TEXT, RTCP_MUX_LONGTEXT, false )
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000,
                  CACHING_TEXT, CACHING_LONGTEXT, true )
+    add_integer( SOUT_CFG_PREFIX "sender-threads", -1,
+                 SENDERS_TEXT, SENDERS_LONGTEXT, true )
+        change_integer_range( -1, 64 )
 
 #ifdef HAVE_SRTP
     add_string( SOUT_CFG_PREFIX "key", "",
@@ -267,7 +278,7 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "dst", "name", "cat", "port", "port-audio", "port-video", "*sdp", "ttl",
     "mux", "sap", "description", "url", "email", "phone",
-    "proto", "rtcp-mux", "caching",
+    "proto", "rtcp-mux", "caching", "sender-threads",
 #ifdef HAVE_SRTP
     "key", "salt",
 #endif
@@ -285,6 +296,9 @@ static int               MuxSend( sout_stream_t *, sout_stream_id_sys_t *,
 
 static sout_access_out_t *GrabberCreate( sout_stream_t *p_sout );
 static void* ThreadSend( void * );
+typedef struct rtp_sender_t rtp_sender_t;
+static rtp_sender_t *SenderNew( vlc_object_t *, unsigned );
+static void SenderDelete( rtp_sender_t * );
 static void *rtp_listen_thread( void * );
 
 static void SDPHandleUrl( sout_stream_t *, const char * );
@@ -335,6 +349,9 @@ struct sout_stream_sys_t
     vod_media_t *p_vod_media;
     char     *psz_vod_session;
 
+    /* Sender threads, NULL if the ES threads send themselves */
+    rtp_sender_t *p_sender;
+
     /* in case we do TS/PS over rtp */
     sout_mux_t        *p_mux;
     sout_access_out_t *p_grab;
@@ -346,11 +363,24 @@ struct sout_stream_sys_t
     sout_stream_id_sys_t **es;
 };
 
-typedef struct rtp_sink_t
+typedef struct rtp_sink_t rtp_sink_t;
+
+struct rtp_sink_t
 {
     int rtp_fd;
     rtcp_sender_t *rtcp;
-} rtp_sink_t;
+    bool b_rtcp; /* FIXME: SRTCP support */
+
+    /* Queue for the sender threads, protected by the sender lock */
+    block_t     *p_queue;
+    block_t    **pp_queue_last;
+    unsigned     i_queue;
+    unsigned     i_dropped;
+    bool         b_ready;   /* on the ready list */
+    bool         b_busy;    /* being sent by a sender thread */
+    bool         b_dead;    /* broken connection */
+    rtp_sink_t  *p_next_ready;
+};
 
 struct sout_stream_id_sys_t
 {
@@ -380,7 +410,7 @@ struct sout_stream_id_sys_t
     vlc_thread_t      thread;
     vlc_mutex_t       lock_sink;
     int               sinkc;
-    rtp_sink_t       *sinkv;
+    rtp_sink_t      **sinkv;
     rtsp_stream_id_t *rtsp_id;
     struct {
         int          *fd;
@@ -603,6 +633,18 @@ static int Open( vlc_object_t *p_this )
     }
     p_stream->pace_nocontrol = true;
 
+    /* Unicast sessions each get their own destination */
+    int i_senders = var_GetInteger( p_stream, SOUT_CFG_PREFIX "sender-threads" );
+    if( i_senders < 0 )
+        i_senders = ( b_rtsp || p_sys->p_vod_media != NULL ) ? 4 : 0;
+    p_sys->p_sender = NULL;
+    if( i_senders > 0 )
+    {
+        p_sys->p_sender = SenderNew( p_this, i_senders );
+        if( p_sys->p_sender == NULL )
+            msg_Warn( p_stream, "cannot start sender threads" );
+    }
+
     if( var_GetBool( p_stream, SOUT_CFG_PREFIX"sap" ) )
         SDPHandleUrl( p_stream, "sap" );
 
@@ -669,6 +711,9 @@ static void Close( vlc_object_t * p_this )
     if( p_sys->rtsp != NULL )
         RtspUnsetup( p_sys->rtsp );
 
+    if( p_sys->p_sender != NULL )
+        SenderDelete( p_sys->p_sender );
+
     vlc_mutex_destroy( &p_sys->lock_sdp );
     vlc_mutex_destroy( &p_sys->lock_ts );
     vlc_mutex_destroy( &p_sys->lock_es );
@@ -815,7 +860,7 @@ char *SDPGenerate( sout_stream_t *p_stream, const char *rtsp_url )
             getsockname( p_sys->es[0]->listen.fd[0],
                          (struct sockaddr *)&dst, &dstlen );
         else
-            getpeername( p_sys->es[0]->sinkv[0].rtp_fd,
+            getpeername( p_sys->es[0]->sinkv[0]->rtp_fd,
                          (struct sockaddr *)&dst, &dstlen );
     }
     else
@@ -1170,7 +1215,7 @@ static sout_stream_id_sys_t *Add( sout_stream_t *p_stream,
     if( cscov != -1 )
         cscov += 8 /* UDP */ + 12 /* RTP */;
     if( id->sinkc > 0 )
-        net_SetCSCov( id->sinkv[0].rtp_fd, cscov, -1 );
+        net_SetCSCov( id->sinkv[0]->rtp_fd, cscov, -1 );
 #endif
 
     vlc_mutex_lock( &p_sys->lock_ts );
@@ -1249,7 +1294,7 @@ static void Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
     /* Delete remaining sinks (incoming connections or explicit
      * outgoing dst=) */
     while( id->sinkc > 0 )
-        rtp_del_sink( id, id->sinkv[0].rtp_fd );
+        rtp_del_sink( id, id->sinkv[0]->rtp_fd );
 #ifdef HAVE_SRTP
     if( id->srtp != NULL )
         srtp_destroy( id->srtp );
@@ -1394,53 +1439,365 @@ static int  HttpCallback( httpd_file_sys_t *p_args,
 /****************************************************************************
  * RTP send
  ****************************************************************************/
-static void* ThreadSend( void *data )
-{
 #ifdef _WIN32
 # define ENOBUFS      WSAENOBUFS
 # define EAGAIN       WSAEWOULDBLOCK
 # define EWOULDBLOCK  WSAEWOULDBLOCK
 #endif
+
+/* Maximum number of packets sent per batch */
+#define RTP_BATCH_MAX 16
+/* Maximum number of packets queued for one destination */
+#define RTP_SINK_QUEUE_MAX 1024
+
+/**
+ * Sends a batch of packets to a destination.
+ * \return false if the connection is broken
+ */
+static bool SinkSend( rtp_sink_t *sink, block_t *const *pkts, unsigned count )
+{
+    unsigned done = 0;
+
+    if( sink->b_rtcp )
+        for( unsigned i = 0; i < count; i++ )
+            SendRTCP( sink->rtcp, pkts[i] );
+
+#ifdef HAVE_SENDMMSG
+    if( count > 1 )
+    {
+        struct mmsghdr msgs[RTP_BATCH_MAX];
+        struct iovec iov[RTP_BATCH_MAX];
+
+        assert( count <= RTP_BATCH_MAX );
+        for( unsigned i = 0; i < count; i++ )
+        {
+            iov[i].iov_base = pkts[i]->p_buffer;
+            iov[i].iov_len = pkts[i]->i_buffer;
+            memset( &msgs[i], 0, sizeof (msgs[i]) );
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        while( done < count )
+        {
+            int val = sendmmsg( sink->rtp_fd, &msgs[done], count - done, 0 );
+            if( val <= 0 )
+                break; /* let send() deal with the error */
+            done += val;
+        }
+    }
+#endif
+
+    for( ; done < count; done++ )
+    {
+        const block_t *out = pkts[done];
+
+        if( send( sink->rtp_fd, out->p_buffer, out->i_buffer, 0 ) == -1
+         && net_errno != EAGAIN && net_errno != EWOULDBLOCK
+         && net_errno != ENOBUFS && net_errno != ENOMEM )
+        {
+            int type;
+            getsockopt( sink->rtp_fd, SOL_SOCKET, SO_TYPE,
+                        &type, &(socklen_t){ sizeof(type) });
+            if( type != SOCK_DGRAM )
+                return false; /* Broken connection */
+
+            /* ICMP soft error: ignore and retry */
+            send( sink->rtp_fd, out->p_buffer, out->i_buffer, 0 );
+        }
+    }
+    return true;
+}
+
+/*
+ * Sender threads. Each destination has a queue of packets, and the sender
+ * threads take turns to send the queues of the destinations which have
+ * packets ready, so that a slow or blocked destination only holds one
+ * thread, and only loses its own packets once its queue is full.
+ */
+struct rtp_sender_t
+{
+    vlc_object_t *p_obj;
+    vlc_mutex_t   lock;
+    vlc_cond_t    wait_ready; /* A destination is ready, or quit */
+    vlc_cond_t    wait_idle;  /* A destination is no longer busy */
+    rtp_sink_t   *p_ready;
+    rtp_sink_t  **pp_ready_last;
+    bool          b_quit;
+
+    unsigned      i_threads;
+    vlc_thread_t  threads[];
+};
+
+/* Puts a destination on the ready list, with the sender lock held */
+static void SenderReady( rtp_sender_t *p_sender, rtp_sink_t *sink )
+{
+    sink->b_ready = true;
+    *p_sender->pp_ready_last = sink;
+    p_sender->pp_ready_last = &sink->p_next_ready;
+    vlc_cond_signal( &p_sender->wait_ready );
+}
+
+static void *SenderThread( void *data )
+{
+    rtp_sender_t *p_sender = data;
+
+    vlc_mutex_lock( &p_sender->lock );
+    for( ;; )
+    {
+        while( p_sender->p_ready == NULL && !p_sender->b_quit )
+            vlc_cond_wait( &p_sender->wait_ready, &p_sender->lock );
+        if( p_sender->b_quit )
+            break;
+
+        rtp_sink_t *sink = p_sender->p_ready;
+        p_sender->p_ready = sink->p_next_ready;
+        if( p_sender->p_ready == NULL )
+            p_sender->pp_ready_last = &p_sender->p_ready;
+        sink->p_next_ready = NULL;
+        sink->b_ready = false;
+        sink->b_busy = true;
+
+        block_t *chain = sink->p_queue;
+        sink->p_queue = NULL;
+        sink->pp_queue_last = &sink->p_queue;
+        sink->i_queue = 0;
+        vlc_mutex_unlock( &p_sender->lock );
+
+        bool b_alive = true;
+        while( chain != NULL )
+        {
+            block_t *pkts[RTP_BATCH_MAX];
+            unsigned count = 0;
+
+            while( chain != NULL && count < RTP_BATCH_MAX )
+            {
+                pkts[count++] = chain;
+                chain = chain->p_next;
+            }
+
+            if( b_alive )
+                b_alive = SinkSend( sink, pkts, count );
+            for( unsigned i = 0; i < count; i++ )
+                block_Release( pkts[i] );
+        }
+
+        vlc_mutex_lock( &p_sender->lock );
+        sink->b_busy = false;
+        if( !b_alive )
+            sink->b_dead = true;
+        else if( sink->p_queue != NULL )
+            SenderReady( p_sender, sink ); /* queued while it was sent */
+        vlc_cond_broadcast( &p_sender->wait_idle );
+    }
+    vlc_mutex_unlock( &p_sender->lock );
+    return NULL;
+}
+
+static rtp_sender_t *SenderNew( vlc_object_t *p_obj, unsigned i_threads )
+{
+    rtp_sender_t *p_sender = malloc( sizeof (*p_sender)
+                                     + i_threads * sizeof (vlc_thread_t) );
+    if( unlikely(p_sender == NULL) )
+        return NULL;
+
+    p_sender->p_obj = p_obj;
+    vlc_mutex_init( &p_sender->lock );
+    vlc_cond_init( &p_sender->wait_ready );
+    vlc_cond_init( &p_sender->wait_idle );
+    p_sender->p_ready = NULL;
+    p_sender->pp_ready_last = &p_sender->p_ready;
+    p_sender->b_quit = false;
+
+    for( p_sender->i_threads = 0; p_sender->i_threads < i_threads;
+         p_sender->i_threads++ )
+        if( vlc_clone( &p_sender->threads[p_sender->i_threads], SenderThread,
+                       p_sender, VLC_THREAD_PRIORITY_HIGHEST ) )
+            break;
+
+    if( p_sender->i_threads == 0 )
+    {
+        SenderDelete( p_sender );
+        return NULL;
+    }
+    msg_Dbg( p_obj, "%u sender threads", p_sender->i_threads );
+    return p_sender;
+}
+
+static void SenderDelete( rtp_sender_t *p_sender )
+{
+    vlc_mutex_lock( &p_sender->lock );
+    /* All the destinations are gone by now */
+    assert( p_sender->p_ready == NULL );
+    p_sender->b_quit = true;
+    vlc_cond_broadcast( &p_sender->wait_ready );
+    vlc_mutex_unlock( &p_sender->lock );
+
+    for( unsigned i = 0; i < p_sender->i_threads; i++ )
+        vlc_join( p_sender->threads[i], NULL );
+
+    vlc_cond_destroy( &p_sender->wait_idle );
+    vlc_cond_destroy( &p_sender->wait_ready );
+    vlc_mutex_destroy( &p_sender->lock );
+    free( p_sender );
+}
+
+/**
+ * Queues a batch of packets to a destination, for the sender threads.
+ * \return false if the connection is broken
+ */
+static bool SenderQueue( rtp_sender_t *p_sender, rtp_sink_t *sink,
+                         block_t *const *pkts, unsigned count )
+{
+    block_t *chain = NULL, **pp_last = &chain;
+
+    /* Views sharing the payload of the packets with the other queues */
+    for( unsigned i = 0; i < count; i++ )
+    {
+        block_t *view = block_Share( pkts[i] );
+        if( likely(view != NULL) )
+        {
+            *pp_last = view;
+            pp_last = &view->p_next;
+        }
+    }
+
+    vlc_mutex_lock( &p_sender->lock );
+    bool b_alive = !sink->b_dead;
+    if( b_alive && sink->i_queue + count <= RTP_SINK_QUEUE_MAX )
+    {
+        *sink->pp_queue_last = chain;
+        sink->pp_queue_last = pp_last;
+        sink->i_queue += count;
+        chain = NULL;
+
+        if( !sink->b_ready && !sink->b_busy )
+            SenderReady( p_sender, sink );
+    }
+    else if( b_alive )
+    {
+        if( sink->i_dropped == 0 )
+            msg_Warn( p_sender->p_obj, "destination %d too slow, dropping "
+                      "packets", sink->rtp_fd );
+        sink->i_dropped += count;
+    }
+    vlc_mutex_unlock( &p_sender->lock );
+
+    block_ChainRelease( chain );
+    return b_alive;
+}
+
+/* Takes a destination away from the sender threads */
+static void SenderRemove( rtp_sender_t *p_sender, rtp_sink_t *sink )
+{
+    vlc_mutex_lock( &p_sender->lock );
+    if( sink->b_ready )
+    {
+        rtp_sink_t **pp = &p_sender->p_ready;
+        while( *pp != sink )
+            pp = &(*pp)->p_next_ready;
+        *pp = sink->p_next_ready;
+        if( p_sender->pp_ready_last == &sink->p_next_ready )
+            p_sender->pp_ready_last = pp;
+        sink->b_ready = false;
+    }
+    while( sink->b_busy )
+        vlc_cond_wait( &p_sender->wait_idle, &p_sender->lock );
+    vlc_mutex_unlock( &p_sender->lock );
+
+    block_ChainRelease( sink->p_queue );
+    if( sink->i_dropped > 0 )
+        msg_Dbg( p_sender->p_obj, "destination %d: %u packets dropped",
+                 sink->rtp_fd, sink->i_dropped );
+}
+
+#ifdef HAVE_SRTP
+static block_t *SrtpProtect( sout_stream_id_sys_t *id, block_t *out )
+{
+    /* FIXME: this is awfully inefficient */
+    size_t len = out->i_buffer;
+    out = block_Realloc( out, 0, len + 10 );
+    if( out == NULL )
+        return NULL;
+    out->i_buffer = len;
+
+    int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
+    if( val )
+    {
+        msg_Dbg( id->p_stream, "SRTP sending error: %s",
+                 vlc_strerror_c(val) );
+        block_Release( out );
+        return NULL;
+    }
+    out->i_buffer = len;
+    return out;
+}
+#endif
+
+/* Waits until a packet is due (cancellation point) */
+static void SendWait( block_t *out, mtime_t i_caching )
+{
+    block_cleanup_push (out);
+    mwait (out->i_dts + i_caching);
+    vlc_cleanup_pop ();
+}
+
+static void* ThreadSend( void *data )
+{
     sout_stream_id_sys_t *id = data;
+    rtp_sender_t *p_sender = id->p_stream->p_sys->p_sender;
     unsigned i_caching = id->i_caching;
+    block_t *next = NULL;
 
     for (;;)
     {
-        block_t *out = block_FifoGet( id->p_fifo );
-        block_cleanup_push (out);
+        block_t *out = next;
+        if( out == NULL )
+            out = block_FifoGet( id->p_fifo );
+        next = NULL;
+        SendWait( out, i_caching );
 
-#ifdef HAVE_SRTP
-        if( id->srtp )
-        {   /* FIXME: this is awfully inefficient */
-            size_t len = out->i_buffer;
-            out = block_Realloc( out, 0, len + 10 );
-            out->i_buffer = len;
-
-            int canc = vlc_savecancel ();
-            int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
-            vlc_restorecancel (canc);
-            if( val )
+        int canc = vlc_savecancel ();
+
+        /* Send the packets already due along, e.g. the rest of a frame */
+        block_t *pkts[RTP_BATCH_MAX];
+        unsigned count = 0;
+        mtime_t now = mdate();
+
+        pkts[count++] = out;
+        vlc_fifo_Lock( id->p_fifo );
+        while( count < RTP_BATCH_MAX && !vlc_fifo_IsEmpty( id->p_fifo ) )
+        {
+            block_t *pkt = vlc_fifo_DequeueUnlocked( id->p_fifo );
+            if( pkt->i_dts + i_caching > now )
             {
-                msg_Dbg( id->p_stream, "SRTP sending error: %s",
-                         vlc_strerror_c(val) );
-                block_Release( out );
-                out = NULL;
+                next = pkt;
+                break;
             }
-            else
-                out->i_buffer = len;
+            pkts[count++] = pkt;
         }
-        if (out)
-            mwait (out->i_dts + i_caching);
-        vlc_cleanup_pop ();
-        if (out == NULL)
-            continue;
-#else
-        mwait (out->i_dts + i_caching);
-        vlc_cleanup_pop ();
-#endif
+        vlc_fifo_Unlock( id->p_fifo );
 
-        ssize_t len = out->i_buffer;
-        int canc = vlc_savecancel ();
+        unsigned valid = 0;
+        for( unsigned i = 0; i < count; i++ )
+        {
+            block_t *pkt = pkts[i];
+#ifdef HAVE_SRTP
+            if( id->srtp )
+                pkt = SrtpProtect( id, pkt );
+#endif
+            /* The sender threads queue views of the packets */
+            if( pkt != NULL && p_sender != NULL )
+                pkt = block_Shareable( pkt );
+            if( pkt != NULL )
+                pkts[valid++] = pkt;
+        }
+        count = valid;
+        if( count == 0 )
+        {
+            vlc_restorecancel (canc);
+            continue;
+        }
 
         vlc_mutex_lock( &id->lock_sink );
         unsigned deadc = 0; /* How many dead sockets? */
@@ -1448,29 +1805,22 @@ static void* ThreadSend( void *data )
 
         for( int i = 0; i < id->sinkc; i++ )
         {
-#ifdef HAVE_SRTP
-            if( !id->srtp ) /* FIXME: SRTCP support */
-#endif
-                SendRTCP( id->sinkv[i].rtcp, out );
+            rtp_sink_t *sink = id->sinkv[i];
+            bool b_alive;
 
-            if( send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 ) == -1
-             && net_errno != EAGAIN && net_errno != EWOULDBLOCK
-             && net_errno != ENOBUFS && net_errno != ENOMEM )
-            {
-                int type;
-                getsockopt( id->sinkv[i].rtp_fd, SOL_SOCKET, SO_TYPE,
-                            &type, &(socklen_t){ sizeof(type) });
-                if( type == SOCK_DGRAM )
-                    /* ICMP soft error: ignore and retry */
-                    send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 );
-                else
-                    /* Broken connection */
-                    deadv[deadc++] = id->sinkv[i].rtp_fd;
-            }
+            if( p_sender != NULL )
+                b_alive = SenderQueue( p_sender, sink, pkts, count );
+            else
+                b_alive = SinkSend( sink, pkts, count );
+
+            if( !b_alive )
+                deadv[deadc++] = sink->rtp_fd;
         }
-        id->i_seq_sent_next = ntohs(((uint16_t *) out->p_buffer)[1]) + 1;
+        id->i_seq_sent_next = ntohs(((uint16_t *) pkts[count - 1]->p_buffer)[1]) + 1;
         vlc_mutex_unlock( &id->lock_sink );
-        block_Release( out );
+
+        for( unsigned i = 0; i < count; i++ )
+            block_Release( pkts[i] );
 
         for( unsigned i = 0; i < deadc; i++ )
         {
@@ -1506,11 +1856,20 @@ static void *rtp_listen_thread( void *data )
 
 int rtp_add_sink( sout_stream_id_sys_t *id, int fd, bool rtcp_mux, uint16_t *seq )
 {
-    rtp_sink_t sink = { fd, NULL };
-    sink.rtcp = OpenRTCP( VLC_OBJECT( id->p_stream ), fd, IPPROTO_UDP,
-                          rtcp_mux );
-    if( sink.rtcp == NULL )
+    rtp_sink_t *sink = calloc( 1, sizeof (*sink) );
+    if( unlikely(sink == NULL) )
+        return VLC_ENOMEM;
+
+    sink->rtp_fd = fd;
+    sink->rtcp = OpenRTCP( VLC_OBJECT( id->p_stream ), fd, IPPROTO_UDP,
+                           rtcp_mux );
+    if( sink->rtcp == NULL )
         msg_Err( id->p_stream, "RTCP failed!" );
+    sink->b_rtcp = true;
+#ifdef HAVE_SRTP
+    sink->b_rtcp = id->srtp == NULL;
+#endif
+    sink->pp_queue_last = &sink->p_queue;
 
     vlc_mutex_lock( &id->lock_sink );
     INSERT_ELEM( id->sinkv, id->sinkc, id->sinkc, sink );
@@ -1522,13 +1881,13 @@ int rtp_add_sink( sout_stream_id_sys_t *id, int fd, bool rtcp_mux, uint16_t *seq
 
 void rtp_del_sink( sout_stream_id_sys_t *id, int fd )
 {
-    rtp_sink_t sink = { fd, NULL };
+    rtp_sink_t *sink = NULL;
 
     /* NOTE: must be safe to use if fd is not included */
     vlc_mutex_lock( &id->lock_sink );
     for( int i = 0; i < id->sinkc; i++ )
     {
-        if (id->sinkv[i].rtp_fd == fd)
+        if (id->sinkv[i]->rtp_fd == fd)
         {
             sink = id->sinkv[i];
             REMOVE_ELEM( id->sinkv, id->sinkc, i );
@@ -1537,8 +1896,19 @@ void rtp_del_sink( sout_stream_id_sys_t *id, int fd )
     }
     vlc_mutex_unlock( &id->lock_sink );
 
-    CloseRTCP( sink.rtcp );
-    net_Close( sink.rtp_fd );
+    if( sink == NULL )
+    {
+        net_Close( fd );
+        return;
+    }
+
+    rtp_sender_t *p_sender = id->p_stream->p_sys->p_sender;
+    if( p_sender != NULL )
+        SenderRemove( p_sender, sink );
+
+    CloseRTCP( sink->rtcp );
+    net_Close( sink->rtp_fd );
+    free( sink );
 }
 
 uint16_t rtp_get_seq( sout_stream_id_sys_t *id )
@@ -230,5 +230,5 @@ static void Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
 static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                  block_t *p_buffer )
 {
-    return p_stream->p_next->pf_send( p_stream->p_next, id, p_buffer );
+    return sout_StreamIdSend( p_stream->p_next, id, p_buffer );
 }
@@ -37,6 +37,25 @@
  *
  * the video-data and audio-data pointers will be passed to lock/unlock function
  *
+ * Alternatively, the block callbacks avoid the copy: they are given the
+ * buffers of the stream output directly, together with opaque handles. Each
+ * handle must be released with the given release function once its buffer is
+ * no longer used, possibly from another thread, and before the LibVLC
+ * instance is released. The batch option sets how many buffers are given at
+ * once (the last batch of an elementary stream may be shorter):
+ *
+ * void video_block_callback( void *p_video_data, unsigned count,
+ *                            void *const *handles, uint8_t *const *pixels,
+ *                            const size_t *sizes, const mtime_t *pts,
+ *                            int width, int height, int pixel_pitch,
+ *                            void (*release)( void *handle ) );
+ * void audio_block_callback( void *p_audio_data, unsigned count,
+ *                            void *const *handles, uint8_t *const *pcm,
+ *                            const size_t *sizes, const mtime_t *pts,
+ *                            unsigned channels, unsigned rate,
+ *                            unsigned bits_per_sample,
+ *                            void (*release)( void *handle ) );
+ *
  ******************************************************************************/
 
 /*****************************************************************************
@@ -74,6 +93,20 @@
 #define LT_AUDIO_POSTRENDER_CALLBACK N_( "Address of the audio postrender callback function. " \
                                         "This function will be called when the render is into the buffer." )
 
+#define T_VIDEO_BLOCK_CALLBACK N_( "Video block callback" )
+#define LT_VIDEO_BLOCK_CALLBACK N_( "Address of the video block callback function. " \
+                                    "If set, this function is given the buffers without any copy, " \
+                                    "instead of the prerender and postrender callbacks." )
+
+#define T_AUDIO_BLOCK_CALLBACK N_( "Audio block callback" )
+#define LT_AUDIO_BLOCK_CALLBACK N_( "Address of the audio block callback function. " \
+                                    "If set, this function is given the buffers without any copy, " \
+                                    "instead of the prerender and postrender callbacks." )
+
+#define T_BATCH N_( "Buffers per block callback" )
+#define LT_BATCH N_( "Number of buffers of an elementary stream given " \
+                     "to each call of the block callbacks." )
+
 #define T_VIDEO_DATA N_( "Video Callback data" )
 #define LT_VIDEO_DATA N_( "Data for the video callback function." )
 
@@ -107,6 +140,12 @@ vlc_module_begin ()
         change_volatile()
     add_string( SOUT_PREFIX_AUDIO "postrender-callback", "0", T_AUDIO_POSTRENDER_CALLBACK, LT_AUDIO_POSTRENDER_CALLBACK, true )
         change_volatile()
+    add_string( SOUT_PREFIX_VIDEO "block-callback", "0", T_VIDEO_BLOCK_CALLBACK, LT_VIDEO_BLOCK_CALLBACK, true )
+        change_volatile()
+    add_string( SOUT_PREFIX_AUDIO "block-callback", "0", T_AUDIO_BLOCK_CALLBACK, LT_AUDIO_BLOCK_CALLBACK, true )
+        change_volatile()
+    add_integer_with_range( SOUT_CFG_PREFIX "batch", 1, 1, 256, T_BATCH, LT_BATCH, true )
+        change_private()
     add_string( SOUT_PREFIX_VIDEO "data", "0", T_VIDEO_DATA, LT_VIDEO_DATA, true )
         change_volatile()
     add_string( SOUT_PREFIX_AUDIO "data", "0", T_AUDIO_DATA, LT_VIDEO_DATA, true )
@@ -122,7 +161,9 @@ vlc_module_end ()
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
     "video-prerender-callback", "audio-prerender-callback",
-    "video-postrender-callback", "audio-postrender-callback", "video-data", "audio-data", "time-sync", NULL
+    "video-postrender-callback", "audio-postrender-callback",
+    "video-block-callback", "audio-block-callback", "batch",
+    "video-data", "audio-data", "time-sync", NULL
 };
 
 static sout_stream_id_sys_t *Add( sout_stream_t *, const es_format_t * );
@@ -139,10 +180,19 @@ static int SendVideo( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
 static int SendAudio( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                       block_t *p_buffer );
 
+typedef void ( *smem_release_cb )( void *p_handle );
+
 struct sout_stream_id_sys_t
 {
     es_format_t* format;
     void *p_data;
+
+    /* Pending buffers for the block callbacks */
+    unsigned i_batch;
+    void **pp_handles;
+    uint8_t **pp_buffers;
+    size_t *pi_sizes;
+    mtime_t *pi_pts;
 };
 
 struct sout_stream_sys_t
@@ -152,6 +202,9 @@ struct sout_stream_sys_t
     void ( *pf_audio_prerender_callback ) ( void* p_audio_data, uint8_t** pp_pcm_buffer, size_t size );
     void ( *pf_video_postrender_callback ) ( void* p_video_data, uint8_t* p_pixel_buffer, int width, int height, int pixel_pitch, size_t size, mtime_t pts );
     void ( *pf_audio_postrender_callback ) ( void* p_audio_data, uint8_t* p_pcm_buffer, unsigned int channels, unsigned int rate, unsigned int nb_samples, unsigned int bits_per_sample, size_t size, mtime_t pts );
+    void ( *pf_video_block_callback ) ( void* p_video_data, unsigned count, void *const *handles, uint8_t *const *pixels, const size_t *sizes, const mtime_t *pts, int width, int height, int pixel_pitch, smem_release_cb release );
+    void ( *pf_audio_block_callback ) ( void* p_audio_data, unsigned count, void *const *handles, uint8_t *const *pcm, const size_t *sizes, const mtime_t *pts, unsigned channels, unsigned rate, unsigned bits_per_sample, smem_release_cb release );
+    unsigned i_batch;
     bool time_sync;
 };
 
@@ -190,6 +243,18 @@ static int Open( vlc_object_t *p_this )
     p_sys->pf_audio_postrender_callback = (void (*) (void*, uint8_t*, unsigned int, unsigned int, unsigned int, unsigned int, size_t, mtime_t))(intptr_t)atoll( psz_tmp );
     free( psz_tmp );
 
+    psz_tmp = var_GetString( p_stream, SOUT_PREFIX_VIDEO "block-callback" );
+    p_sys->pf_video_block_callback = (void (*) (void*, unsigned, void *const *, uint8_t *const *, const size_t *, const mtime_t *, int, int, int, smem_release_cb))(intptr_t)atoll( psz_tmp );
+    free( psz_tmp );
+
+    psz_tmp = var_GetString( p_stream, SOUT_PREFIX_AUDIO "block-callback" );
+    p_sys->pf_audio_block_callback = (void (*) (void*, unsigned, void *const *, uint8_t *const *, const size_t *, const mtime_t *, unsigned, unsigned, unsigned, smem_release_cb))(intptr_t)atoll( psz_tmp );
+    free( psz_tmp );
+
+    p_sys->i_batch = var_GetInteger( p_stream, SOUT_CFG_PREFIX "batch" );
+    if( p_sys->i_batch < 1 )
+        p_sys->i_batch = 1;
+
     /* Setting stream out module callbacks */
     p_stream->pf_add    = Add;
     p_stream->pf_del    = Del;
@@ -220,6 +285,31 @@ static sout_stream_id_sys_t *Add( sout_stream_t *p_stream,
     return id;
 }
 
+static sout_stream_id_sys_t *NewId( sout_stream_t *p_stream, bool b_blocks )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    sout_stream_id_sys_t *id = calloc( 1, sizeof( sout_stream_id_sys_t ) );
+    if( !id || !b_blocks )
+        return id;
+
+    unsigned n = p_sys->i_batch;
+
+    id->pp_handles = malloc( n * sizeof( *id->pp_handles ) );
+    id->pp_buffers = malloc( n * sizeof( *id->pp_buffers ) );
+    id->pi_sizes = malloc( n * sizeof( *id->pi_sizes ) );
+    id->pi_pts = malloc( n * sizeof( *id->pi_pts ) );
+    if( !id->pp_handles || !id->pp_buffers || !id->pi_sizes || !id->pi_pts )
+    {
+        free( id->pi_pts );
+        free( id->pi_sizes );
+        free( id->pp_buffers );
+        free( id->pp_handles );
+        free( id );
+        return NULL;
+    }
+    return id;
+}
+
 static sout_stream_id_sys_t *AddVideo( sout_stream_t *p_stream,
                                        const es_format_t *p_fmt )
 {
@@ -257,7 +347,7 @@ static sout_stream_id_sys_t *AddVideo( sout_stream_t *p_stream,
             break;
     }
 
-    id = calloc( 1, sizeof( sout_stream_id_sys_t ) );
+    id = NewId( p_stream, p_stream->p_sys->pf_video_block_callback != NULL );
     if( !id )
         return NULL;
 
@@ -283,7 +373,7 @@ static sout_stream_id_sys_t *AddAudio( sout_stream_t *p_stream,
         return NULL;
     }
 
-    id = calloc( 1, sizeof( sout_stream_id_sys_t ) );
+    id = NewId( p_stream, p_stream->p_sys->pf_audio_block_callback != NULL );
     if( !id )
         return NULL;
 
@@ -296,15 +386,75 @@ static sout_stream_id_sys_t *AddAudio( sout_stream_t *p_stream,
     return id;
 }
 
+static void ReleaseHandle( void *p_handle )
+{
+    block_Release( (block_t *)p_handle );
+}
+
+/* Hands the pending buffers over to the block callback */
+static void Flush( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    if( id->i_batch == 0 )
+        return;
+
+    if( id->format->i_cat == VIDEO_ES )
+        p_sys->pf_video_block_callback( id->p_data, id->i_batch,
+                                        id->pp_handles, id->pp_buffers,
+                                        id->pi_sizes, id->pi_pts,
+                                        id->format->video.i_width,
+                                        id->format->video.i_height,
+                                        id->format->video.i_bits_per_pixel,
+                                        ReleaseHandle );
+    else
+        p_sys->pf_audio_block_callback( id->p_data, id->i_batch,
+                                        id->pp_handles, id->pp_buffers,
+                                        id->pi_sizes, id->pi_pts,
+                                        id->format->audio.i_channels,
+                                        id->format->audio.i_rate,
+                                        id->format->audio.i_bitspersample,
+                                        ReleaseHandle );
+    id->i_batch = 0;
+}
+
+/* Queues the buffers of a chain for the block callback, without copying */
+static int SendBlocks( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                       block_t *p_buffer )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    while( p_buffer != NULL )
+    {
+        block_t *p_next = p_buffer->p_next;
+
+        p_buffer->p_next = NULL;
+        id->pp_handles[id->i_batch] = p_buffer;
+        id->pp_buffers[id->i_batch] = p_buffer->p_buffer;
+        id->pi_sizes[id->i_batch] = p_buffer->i_buffer;
+        id->pi_pts[id->i_batch] = p_buffer->i_pts;
+        if( ++id->i_batch == p_sys->i_batch )
+            Flush( p_stream, id );
+        p_buffer = p_next;
+    }
+    return VLC_SUCCESS;
+}
+
 static void Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
 {
-    VLC_UNUSED( p_stream );
+    Flush( p_stream, id );
+    free( id->pi_pts );
+    free( id->pi_sizes );
+    free( id->pp_buffers );
+    free( id->pp_handles );
     free( id );
 }
 
 static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                  block_t *p_buffer )
 {
+    if ( id->pp_handles != NULL )
+        return SendBlocks( p_stream, id, p_buffer );
     if ( id->format->i_cat == VIDEO_ES )
         return SendVideo( p_stream, id, p_buffer );
     else if ( id->format->i_cat == AUDIO_ES )
@@ -164,13 +164,13 @@ static void create_SDP(sout_stream_t *p_stream, sout_access_out_t *p_access)
     if (!vlc_getaddrinfo (dhost, dport, &hints, &res))
     {
         memcpy (&dst, res->ai_addr, dstlen = res->ai_addrlen);
-        freeaddrinfo (res);
+        vlc_freeaddrinfo (res);
     }
 
     if (!vlc_getaddrinfo (shost, sport, &hints, &res))
     {
         memcpy (&src, res->ai_addr, srclen = res->ai_addrlen);
-        freeaddrinfo (res);
+        vlc_freeaddrinfo (res);
     }
 
     char *head = vlc_sdp_Start (VLC_OBJECT (p_stream), SOUT_CFG_PREFIX,
@@ -33,6 +33,7 @@
 #include <vlc_block.h>
 #include <vlc_md5.h>
 #include <vlc_fs.h>
+#include <vlc_modules.h>
 
 /*****************************************************************************
  * Module descriptor
@@ -133,6 +134,37 @@ static int Open( vlc_object_t *p_this )
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * CpuTimeReport: prints the modules using the most CPU time (with --cpu-stats)
+ *****************************************************************************/
+static void CpuTimeReport( sout_stream_t *p_stream )
+{
+    sout_stream_sys_t *p_sys = (sout_stream_sys_t *)p_stream->p_sys;
+    vlc_module_cputime_t *tab;
+    ssize_t count = vlc_module_GetCpuTime( p_stream, &tab );
+
+    if( count <= 0 )
+        return;
+
+    if( p_sys->output )
+        fprintf( p_sys->output, "#prefix\tmodule\tcapability\tcalls\tself_ns\ttotal_ns\n" );
+    for( ssize_t i = 0; i < count; i++ )
+    {
+        const char *psz_module = module_get_object( tab[i].p_module );
+        const char *psz_cap = module_get_capability( tab[i].p_module );
+
+        msg_Info( p_stream, "%s: CPU time module:%s (%s) calls:%"PRIu64
+                  " self:%"PRIu64"us total:%"PRIu64"us", p_sys->prefix,
+                  psz_module, psz_cap, tab[i].i_calls, tab[i].i_self / 1000,
+                  tab[i].i_total / 1000 );
+        if( p_sys->output )
+            fprintf( p_sys->output, "%s\t%s\t%s\t%"PRIu64"\t%"PRIu64"\t%"PRIu64"\n",
+                     p_sys->prefix, psz_module, psz_cap, tab[i].i_calls,
+                     tab[i].i_self, tab[i].i_total );
+    }
+    free( tab );
+}
+
 /*****************************************************************************
  * Close:
  *****************************************************************************/
@@ -141,6 +173,8 @@ static void Close( vlc_object_t * p_this )
     sout_stream_t     *p_stream = (sout_stream_t*)p_this;
     sout_stream_sys_t *p_sys = (sout_stream_sys_t *)p_stream->p_sys;
 
+    CpuTimeReport( p_stream );
+
     if( p_sys->output )
         fclose( p_sys->output );
 
@@ -0,0 +1,432 @@
+/*****************************************************************************
+ * ladder.c: transcoding stream output module (encoding ladder)
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * A ladder adds extra video outputs (rungs) to a transcoded video ES. The ES
+ * is decoded and filtered only once: every rung holds the filtered pictures,
+ * and scales and encodes them on its own thread. The encoded blocks are
+ * collected and sent down the stream chain from the transcode thread.
+ */
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#include "transcode.h"
+
+#include <limits.h>
+#include <vlc_arrays.h>
+#include <vlc_modules.h>
+
+/* The rung N gets the ES ID of the source plus N times this */
+#define LADDER_ID_OFFSET 1000
+
+typedef struct
+{
+    sout_stream_sys_t *p_sys;
+    encoder_t       *p_encoder;
+    filter_chain_t  *p_chain;   /**< Scaling, owned by the rung thread */
+    video_format_t  fmt_src;    /**< Input format of the scaling */
+    void            *id;        /**< Output ES of the next stream */
+
+    vlc_thread_t    thread;
+    vlc_mutex_t     lock;
+    vlc_cond_t      cond;
+    vlc_array_t     pics;       /**< Queue; not a picture fifo, as the
+                                     pictures are shared by all rungs */
+    block_t         *p_buffers;
+    bool            b_abort;
+    bool            b_thread;   /**< The thread is running */
+} transcode_rung_t;
+
+struct transcode_ladder_t
+{
+    unsigned int    i_rungs;
+    transcode_rung_t rungs[];
+};
+
+/**
+ * Parses a colon-separated list of rungs: <width>x<height>[@<bitrate>].
+ * Either dimension can be 0, to keep the aspect ratio.
+ */
+unsigned transcode_ladder_parse( sout_stream_t *p_stream, const char *psz,
+                                 transcode_rung_cfg_t **pp_rungs )
+{
+    transcode_rung_cfg_t *p_rungs = NULL;
+    unsigned i_rungs = 0;
+
+    while( psz != NULL && *psz != '\0' )
+    {
+        transcode_rung_cfg_t cfg = { 0, 0, 0 };
+        const char *psz_end = strchr( psz, ':' );
+        int i_len = psz_end ? psz_end - psz : (int)strlen( psz );
+        char *psz_rung = strndup( psz, i_len );
+
+        if( unlikely(psz_rung == NULL) )
+            break;
+
+        if( sscanf( psz_rung, "%ux%u@%d", &cfg.i_width, &cfg.i_height,
+                    &cfg.i_bitrate ) < 2
+         || ( cfg.i_width == 0 && cfg.i_height == 0 )
+         || cfg.i_width > INT_MAX || cfg.i_height > INT_MAX )
+        {
+            msg_Warn( p_stream, "invalid ladder rung `%s'", psz_rung );
+            free( psz_rung );
+            psz = psz_end ? psz_end + 1 : NULL;
+            continue;
+        }
+        free( psz_rung );
+
+        if( cfg.i_bitrate < 16000 )
+            cfg.i_bitrate *= 1000;
+
+        transcode_rung_cfg_t *p_tab = realloc( p_rungs, ( i_rungs + 1 )
+                                                        * sizeof( *p_tab ) );
+        if( unlikely(p_tab == NULL) )
+            break;
+        p_rungs = p_tab;
+        p_rungs[i_rungs++] = cfg;
+
+        msg_Dbg( p_stream, "ladder rung %u: %ux%u %dkb/s", i_rungs,
+                 cfg.i_width, cfg.i_height, cfg.i_bitrate / 1000 );
+        psz = psz_end ? psz_end + 1 : NULL;
+    }
+
+    *pp_rungs = p_rungs;
+    return i_rungs;
+}
+
+static picture_t *transcode_ladder_buffer_new( filter_t *p_filter )
+{
+    p_filter->fmt_out.video.i_chroma = p_filter->fmt_out.i_codec;
+    return picture_NewFromFormat( &p_filter->fmt_out.video );
+}
+
+/* Scales (rebuilding the chain on format changes) and encodes a picture */
+static block_t *RungEncode( transcode_rung_t *p_rung, picture_t *p_pic )
+{
+    encoder_t *p_enc = p_rung->p_encoder;
+
+    if( video_format_IsSimilar( &p_rung->fmt_src, &p_pic->format ) )
+        goto encode;
+
+    if( p_rung->p_chain != NULL )
+    {
+        filter_chain_Delete( p_rung->p_chain );
+        p_rung->p_chain = NULL;
+    }
+    p_rung->fmt_src = p_pic->format;
+
+    if( p_pic->format.i_chroma != p_enc->fmt_in.video.i_chroma
+     || p_pic->format.i_width != p_enc->fmt_in.video.i_width
+     || p_pic->format.i_height != p_enc->fmt_in.video.i_height )
+    {
+        filter_owner_t owner = {
+            .sys = p_rung->p_sys,
+            .video = {
+                .buffer_new = transcode_ladder_buffer_new,
+            },
+        };
+        es_format_t fmt;
+
+        es_format_Init( &fmt, VIDEO_ES, p_pic->format.i_chroma );
+        fmt.video = p_pic->format;
+
+        p_rung->p_chain = filter_chain_NewVideo( p_enc, false, &owner );
+        if( unlikely(p_rung->p_chain == NULL) )
+        {
+            video_format_Init( &p_rung->fmt_src, 0 );
+            picture_Release( p_pic );
+            return NULL;
+        }
+        filter_chain_Reset( p_rung->p_chain, &fmt, &p_enc->fmt_in );
+        if( filter_chain_AppendFilter( p_rung->p_chain, NULL, NULL, &fmt,
+                                       &p_enc->fmt_in ) == NULL )
+        {
+            msg_Err( p_enc, "cannot scale %ux%u to %ux%u",
+                     p_pic->format.i_width, p_pic->format.i_height,
+                     p_enc->fmt_in.video.i_width,
+                     p_enc->fmt_in.video.i_height );
+            filter_chain_Delete( p_rung->p_chain );
+            p_rung->p_chain = NULL;
+            video_format_Init( &p_rung->fmt_src, 0 );
+            picture_Release( p_pic );
+            return NULL;
+        }
+    }
+
+encode:
+    if( p_rung->p_chain != NULL )
+    {
+        p_pic = filter_chain_VideoFilter( p_rung->p_chain, p_pic );
+        if( p_pic == NULL )
+            return NULL;
+    }
+
+    block_t *p_block = p_enc->pf_encode_video( p_enc, p_pic );
+    picture_Release( p_pic );
+    return p_block;
+}
+
+static void *RungThread( void *data )
+{
+    transcode_rung_t *p_rung = data;
+    block_t *p_block;
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock( &p_rung->lock );
+    for( ;; )
+    {
+        /* Encode the queued pictures even once aborted */
+        while( vlc_array_count( &p_rung->pics ) == 0 && !p_rung->b_abort )
+            vlc_cond_wait( &p_rung->cond, &p_rung->lock );
+
+        if( vlc_array_count( &p_rung->pics ) == 0 )
+            break;
+
+        picture_t *p_pic = vlc_array_item_at_index( &p_rung->pics, 0 );
+        vlc_array_remove( &p_rung->pics, 0 );
+
+        /* release lock while scaling and encoding */
+        vlc_mutex_unlock( &p_rung->lock );
+        p_block = RungEncode( p_rung, p_pic );
+        vlc_mutex_lock( &p_rung->lock );
+
+        block_ChainAppend( &p_rung->p_buffers, p_block );
+    }
+    vlc_mutex_unlock( &p_rung->lock );
+
+    /* Flush the encoder */
+    while( (p_block = p_rung->p_encoder->pf_encode_video( p_rung->p_encoder,
+                                                          NULL )) != NULL )
+    {
+        vlc_mutex_lock( &p_rung->lock );
+        block_ChainAppend( &p_rung->p_buffers, p_block );
+        vlc_mutex_unlock( &p_rung->lock );
+    }
+
+    vlc_restorecancel( canc );
+    return NULL;
+}
+
+static int RungOpen( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                     transcode_rung_t *p_rung,
+                     const transcode_rung_cfg_t *p_cfg, unsigned i_rung )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    const es_format_t *p_main = &id->p_encoder->fmt_out;
+
+    encoder_t *p_enc = sout_EncoderCreate( p_stream );
+    if( unlikely(p_enc == NULL) )
+        return VLC_ENOMEM;
+    p_rung->p_encoder = p_enc;
+    p_enc->p_module = NULL;
+
+    /* Same codec and settings as the main output, but for the size */
+    es_format_Init( &p_enc->fmt_in, VIDEO_ES, id->p_encoder->fmt_in.i_codec );
+    p_enc->fmt_in.video.i_chroma = p_enc->fmt_in.i_codec;
+    es_format_Init( &p_enc->fmt_out, VIDEO_ES, p_sys->i_vcodec );
+    p_enc->fmt_out.i_id    = p_main->i_id + LADDER_ID_OFFSET * ( i_rung + 1 );
+    p_enc->fmt_out.i_group = p_main->i_group;
+    if( p_main->psz_language )
+        p_enc->fmt_out.psz_language = strdup( p_main->psz_language );
+    p_enc->fmt_out.i_bitrate = p_cfg->i_bitrate;
+    p_enc->fmt_out.video.i_visible_width  = p_cfg->i_width & ~1;
+    p_enc->fmt_out.video.i_visible_height = p_cfg->i_height & ~1;
+    p_enc->fmt_out.video.i_frame_rate = p_main->video.i_frame_rate;
+    p_enc->fmt_out.video.i_frame_rate_base = p_main->video.i_frame_rate_base;
+
+    transcode_video_encoder_init( p_stream, id, p_enc );
+
+    p_enc->i_threads = p_sys->i_threads;
+    p_enc->p_cfg = p_sys->p_video_cfg;
+
+    p_enc->p_module = module_need( p_enc, "encoder", p_sys->psz_venc, true );
+    if( p_enc->p_module == NULL )
+    {
+        msg_Err( p_stream, "cannot find video encoder for ladder rung %u",
+                 i_rung + 1 );
+        return VLC_EGENERIC;
+    }
+    p_enc->fmt_in.video.i_chroma = p_enc->fmt_in.i_codec;
+    p_enc->fmt_out.i_codec =
+        vlc_fourcc_GetCodec( VIDEO_ES, p_enc->fmt_out.i_codec );
+
+    p_rung->id = sout_StreamIdAdd( p_stream->p_next, &p_enc->fmt_out );
+    if( p_rung->id == NULL )
+    {
+        msg_Err( p_stream, "cannot add ladder rung %u", i_rung + 1 );
+        return VLC_EGENERIC;
+    }
+
+    msg_Dbg( p_stream, "ladder rung %u: %ux%u, ES ID %d", i_rung + 1,
+             p_enc->fmt_in.video.i_visible_width,
+             p_enc->fmt_in.video.i_visible_height, p_enc->fmt_out.i_id );
+    return VLC_SUCCESS;
+}
+
+static void RungClose( sout_stream_t *p_stream, transcode_rung_t *p_rung )
+{
+    if( p_rung->id != NULL )
+        sout_StreamIdDel( p_stream->p_next, p_rung->id );
+    if( p_rung->p_chain != NULL )
+        filter_chain_Delete( p_rung->p_chain );
+
+    encoder_t *p_enc = p_rung->p_encoder;
+    if( p_enc == NULL )
+        return;
+    if( p_enc->p_module != NULL )
+        module_unneed( p_enc, p_enc->p_module );
+    es_format_Clean( &p_enc->fmt_in );
+    es_format_Clean( &p_enc->fmt_out );
+    vlc_object_release( p_enc );
+}
+
+/**
+ * Creates the rungs of a video ES, once its main encoder is open.
+ */
+transcode_ladder_t *transcode_ladder_new( sout_stream_t *p_stream,
+                                          sout_stream_id_sys_t *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    transcode_ladder_t *p_ladder;
+
+    p_ladder = calloc( 1, sizeof( *p_ladder )
+                          + p_sys->i_rungs * sizeof( p_ladder->rungs[0] ) );
+    if( unlikely(p_ladder == NULL) )
+        return NULL;
+
+    int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
+                       VLC_THREAD_PRIORITY_VIDEO;
+
+    for( unsigned i = 0; i < p_sys->i_rungs; i++ )
+    {
+        transcode_rung_t *p_rung = &p_ladder->rungs[i];
+
+        p_rung->p_sys = p_sys;
+        vlc_array_init( &p_rung->pics );
+        vlc_mutex_init( &p_rung->lock );
+        vlc_cond_init( &p_rung->cond );
+        /* From now on, the rung is cleaned up by transcode_ladder_delete() */
+        p_ladder->i_rungs++;
+
+        if( RungOpen( p_stream, id, p_rung, &p_sys->p_rungs[i], i ) )
+            goto error;
+
+        if( vlc_clone( &p_rung->thread, RungThread, p_rung, i_priority ) )
+        {
+            msg_Err( p_stream, "cannot spawn ladder thread" );
+            goto error;
+        }
+        p_rung->b_thread = true;
+    }
+    return p_ladder;
+
+error:
+    transcode_ladder_delete( p_stream, p_ladder );
+    return NULL;
+}
+
+/* Waits for the rungs to encode all their pictures and flush their encoders */
+static void StopThreads( transcode_ladder_t *p_ladder )
+{
+    for( unsigned i = 0; i < p_ladder->i_rungs; i++ )
+    {
+        transcode_rung_t *p_rung = &p_ladder->rungs[i];
+
+        if( !p_rung->b_thread )
+            continue;
+
+        vlc_mutex_lock( &p_rung->lock );
+        p_rung->b_abort = true;
+        vlc_cond_signal( &p_rung->cond );
+        vlc_mutex_unlock( &p_rung->lock );
+
+        vlc_join( p_rung->thread, NULL );
+        p_rung->b_thread = false;
+    }
+}
+
+void transcode_ladder_delete( sout_stream_t *p_stream,
+                              transcode_ladder_t *p_ladder )
+{
+    StopThreads( p_ladder );
+
+    for( unsigned i = 0; i < p_ladder->i_rungs; i++ )
+    {
+        transcode_rung_t *p_rung = &p_ladder->rungs[i];
+
+        block_ChainRelease( p_rung->p_buffers );
+        for( int j = 0; j < vlc_array_count( &p_rung->pics ); j++ )
+            picture_Release( vlc_array_item_at_index( &p_rung->pics, j ) );
+        vlc_array_clear( &p_rung->pics );
+        RungClose( p_stream, p_rung );
+        vlc_cond_destroy( &p_rung->cond );
+        vlc_mutex_destroy( &p_rung->lock );
+    }
+    free( p_ladder );
+}
+
+/**
+ * Queues a filtered picture to all the rungs.
+ */
+void transcode_ladder_push( transcode_ladder_t *p_ladder, picture_t *p_pic )
+{
+    for( unsigned i = 0; i < p_ladder->i_rungs; i++ )
+    {
+        transcode_rung_t *p_rung = &p_ladder->rungs[i];
+
+        vlc_mutex_lock( &p_rung->lock );
+        vlc_array_append( &p_rung->pics, picture_Hold( p_pic ) );
+        vlc_cond_signal( &p_rung->cond );
+        vlc_mutex_unlock( &p_rung->lock );
+    }
+}
+
+/**
+ * Sends the blocks encoded so far by the rungs to the next stream.
+ */
+void transcode_ladder_send( sout_stream_t *p_stream,
+                            transcode_ladder_t *p_ladder )
+{
+    for( unsigned i = 0; i < p_ladder->i_rungs; i++ )
+    {
+        transcode_rung_t *p_rung = &p_ladder->rungs[i];
+
+        vlc_mutex_lock( &p_rung->lock );
+        block_t *p_out = p_rung->p_buffers;
+        p_rung->p_buffers = NULL;
+        vlc_mutex_unlock( &p_rung->lock );
+
+        if( p_out != NULL )
+            sout_StreamIdSend( p_stream->p_next, p_rung->id, p_out );
+    }
+}
+
+/**
+ * Encodes all the queued pictures, flushes the rung encoders and sends
+ * everything to the next stream.
+ */
+void transcode_ladder_drain( sout_stream_t *p_stream,
+                             transcode_ladder_t *p_ladder )
+{
+    StopThreads( p_ladder );
+    transcode_ladder_send( p_stream, p_ladder );
+}
@@ -84,8 +84,10 @@ int transcode_osd_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
         if( !id->id ) goto error;
     }
 
+    vlc_mutex_lock( &p_sys->lock_spu );
     if( !p_sys->p_spu )
         p_sys->p_spu = spu_Create( p_stream );
+    vlc_mutex_unlock( &p_sys->lock_spu );
 
     return VLC_SUCCESS;
 
@@ -127,8 +129,10 @@ int transcode_osd_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
     else
     {
         msg_Warn( p_stream, "spu channel not initialized, doing it now" );
+        vlc_mutex_lock( &p_sys->lock_spu );
         if( !p_sys->p_spu )
             p_sys->p_spu = spu_Create( p_stream );
+        vlc_mutex_unlock( &p_sys->lock_spu );
     }
 
     if( p_subpic )
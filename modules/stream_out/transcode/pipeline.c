@@ -0,0 +1,210 @@
+/*****************************************************************************
+ * pipeline.c: transcoding stream output module (pipeline stages)
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * A stage processes pictures on its own thread. Pictures are queued to it
+ * from the previous stage; once the queue is full, the previous stage waits
+ * (back pressure), so that a slow stage bounds the memory used upstream.
+ */
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#include "transcode.h"
+
+#include <vlc_picture_fifo.h>
+
+struct transcode_stage_t
+{
+    const char      *psz_name;
+    transcode_stage_cb pf_process;
+    sout_stream_t   *p_stream;
+    sout_stream_id_sys_t *id;
+
+    vlc_thread_t    thread;
+    vlc_mutex_t     lock;
+    vlc_cond_t      wait_in;    /**< A picture was queued, or abort */
+    vlc_cond_t      wait_out;   /**< A picture was dequeued or processed */
+    picture_fifo_t  *pp_pics;
+    unsigned int    i_pics;
+    unsigned int    i_max;      /**< Queue size, 0 if unbounded */
+    bool            b_busy;
+    bool            b_abort;
+
+    /* Statistics */
+    unsigned int    i_processed;
+    mtime_t         i_busy;     /**< Time spent processing */
+    mtime_t         i_starved;  /**< Time spent waiting for pictures */
+    mtime_t         i_blocked;  /**< Time the previous stage waited */
+};
+
+static void *StageThread( void *data )
+{
+    transcode_stage_t *p_stage = data;
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock( &p_stage->lock );
+    for( ;; )
+    {
+        mtime_t i_start = mdate();
+
+        /* Process the queued pictures even once aborted */
+        while( p_stage->i_pics == 0 && !p_stage->b_abort )
+            vlc_cond_wait( &p_stage->wait_in, &p_stage->lock );
+
+        if( p_stage->i_pics == 0 )
+            break;
+
+        picture_t *p_pic = picture_fifo_Pop( p_stage->pp_pics );
+        p_stage->i_pics--;
+        p_stage->b_busy = true;
+        vlc_cond_broadcast( &p_stage->wait_out );
+        vlc_mutex_unlock( &p_stage->lock );
+
+        mtime_t i_now = mdate();
+        p_stage->pf_process( p_stage->p_stream, p_stage->id, p_pic );
+        mtime_t i_done = mdate();
+
+        vlc_mutex_lock( &p_stage->lock );
+        p_stage->b_busy = false;
+        p_stage->i_processed++;
+        p_stage->i_starved += i_now - i_start;
+        p_stage->i_busy += i_done - i_now;
+        vlc_cond_broadcast( &p_stage->wait_out );
+    }
+    vlc_mutex_unlock( &p_stage->lock );
+
+    /* Flush the stage */
+    p_stage->pf_process( p_stage->p_stream, p_stage->id, NULL );
+
+    vlc_restorecancel( canc );
+    return NULL;
+}
+
+/**
+ * Starts a stage. A stage calls pf_process() for each queued picture, in
+ * order, and then once with NULL when it is deleted.
+ *
+ * \param i_max maximum number of queued pictures, or 0 for no limit
+ */
+transcode_stage_t *transcode_stage_new( sout_stream_t *p_stream,
+                                        sout_stream_id_sys_t *id,
+                                        const char *psz_name,
+                                        unsigned int i_max,
+                                        transcode_stage_cb pf_process )
+{
+    transcode_stage_t *p_stage = calloc( 1, sizeof( *p_stage ) );
+    if( unlikely(p_stage == NULL) )
+        return NULL;
+
+    p_stage->pp_pics = picture_fifo_New();
+    if( unlikely(p_stage->pp_pics == NULL) )
+    {
+        free( p_stage );
+        return NULL;
+    }
+    p_stage->psz_name = psz_name;
+    p_stage->pf_process = pf_process;
+    p_stage->p_stream = p_stream;
+    p_stage->id = id;
+    p_stage->i_max = i_max;
+    vlc_mutex_init( &p_stage->lock );
+    vlc_cond_init( &p_stage->wait_in );
+    vlc_cond_init( &p_stage->wait_out );
+
+    int i_priority = p_stream->p_sys->b_high_priority ?
+                       VLC_THREAD_PRIORITY_OUTPUT : VLC_THREAD_PRIORITY_VIDEO;
+    if( vlc_clone( &p_stage->thread, StageThread, p_stage, i_priority ) )
+    {
+        msg_Err( p_stream, "cannot spawn %s thread", psz_name );
+        vlc_cond_destroy( &p_stage->wait_out );
+        vlc_cond_destroy( &p_stage->wait_in );
+        vlc_mutex_destroy( &p_stage->lock );
+        picture_fifo_Delete( p_stage->pp_pics );
+        free( p_stage );
+        return NULL;
+    }
+
+    msg_Dbg( p_stream, "%s thread started, queue of %u pictures", psz_name,
+             i_max );
+    return p_stage;
+}
+
+/**
+ * Processes the remaining pictures, flushes the stage and stops it.
+ */
+void transcode_stage_delete( sout_stream_t *p_stream,
+                             transcode_stage_t *p_stage )
+{
+    vlc_mutex_lock( &p_stage->lock );
+    p_stage->b_abort = true;
+    vlc_cond_signal( &p_stage->wait_in );
+    vlc_mutex_unlock( &p_stage->lock );
+
+    vlc_join( p_stage->thread, NULL );
+
+    if( p_stage->i_processed > 0 )
+        msg_Dbg( p_stream, "%s thread: %u pictures, %"PRId64" us busy and "
+                 "%"PRId64" us waiting per picture, blocked the previous "
+                 "stage for %"PRId64" ms", p_stage->psz_name,
+                 p_stage->i_processed,
+                 p_stage->i_busy / p_stage->i_processed,
+                 p_stage->i_starved / p_stage->i_processed,
+                 p_stage->i_blocked / 1000 );
+
+    vlc_cond_destroy( &p_stage->wait_out );
+    vlc_cond_destroy( &p_stage->wait_in );
+    vlc_mutex_destroy( &p_stage->lock );
+    picture_fifo_Delete( p_stage->pp_pics );
+    free( p_stage );
+}
+
+/**
+ * Queues a picture to a stage, waiting for room in its queue first.
+ */
+void transcode_stage_push( transcode_stage_t *p_stage, picture_t *p_pic )
+{
+    vlc_mutex_lock( &p_stage->lock );
+    if( p_stage->i_max > 0 && p_stage->i_pics >= p_stage->i_max )
+    {
+        mtime_t i_start = mdate();
+
+        while( p_stage->i_pics >= p_stage->i_max )
+            vlc_cond_wait( &p_stage->wait_out, &p_stage->lock );
+        p_stage->i_blocked += mdate() - i_start;
+    }
+
+    picture_fifo_Push( p_stage->pp_pics, p_pic );
+    p_stage->i_pics++;
+    vlc_cond_signal( &p_stage->wait_in );
+    vlc_mutex_unlock( &p_stage->lock );
+}
+
+/**
+ * Waits until a stage has processed all its queued pictures.
+ */
+void transcode_stage_wait( transcode_stage_t *p_stage )
+{
+    vlc_mutex_lock( &p_stage->lock );
+    while( p_stage->i_pics > 0 || p_stage->b_busy )
+        vlc_cond_wait( &p_stage->wait_out, &p_stage->lock );
+    vlc_mutex_unlock( &p_stage->lock );
+}
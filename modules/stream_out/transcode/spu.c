@@ -88,8 +88,10 @@ int transcode_spu_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
         }
     }
 
+    vlc_mutex_lock( &p_sys->lock_spu );
     if( !p_sys->p_spu )
         p_sys->p_spu = spu_Create( p_stream );
+    vlc_mutex_unlock( &p_sys->lock_spu );
 
     return VLC_SUCCESS;
 }
@@ -107,11 +109,13 @@ void transcode_spu_close( sout_stream_t *p_stream, sout_stream_id_sys_t *id)
     if( id->p_encoder->p_module )
         module_unneed( id->p_encoder, id->p_encoder->p_module );
 
+    vlc_mutex_lock( &p_sys->lock_spu );
     if( p_sys->p_spu )
     {
         spu_Destroy( p_sys->p_spu );
         p_sys->p_spu = NULL;
     }
+    vlc_mutex_unlock( &p_sys->lock_spu );
 }
 
 int transcode_spu_process( sout_stream_t *p_stream,
@@ -80,6 +80,13 @@
 #define VFILTER_LONGTEXT N_( \
     "Video filters will be applied to the video streams (after overlays " \
     "are applied). You can enter a colon-separated list of filters." )
+#define LADDER_TEXT N_("Encoding ladder")
+#define LADDER_LONGTEXT N_( \
+    "Extra video outputs, decoded and filtered once with the main output, " \
+    "and scaled and encoded on their own threads. You can enter a " \
+    "colon-separated list of <width>x<height>@<bitrate>, with 0 as a " \
+    "dimension to keep the aspect ratio. The outputs get the ES ID of the " \
+    "video plus 1000, 2000..." )
 
 #define AENC_TEXT N_("Audio encoder")
 #define AENC_LONGTEXT N_( \
@@ -131,6 +138,18 @@
 #define HP_LONGTEXT N_( \
     "Runs the optional encoder thread at the OUTPUT priority instead of " \
     "VIDEO." )
+#define FILTER_THREAD_TEXT N_("Filter thread")
+#define FILTER_THREAD_LONGTEXT N_( \
+    "Runs the video filters and the scaling on their own thread, between " \
+    "the decoder and the encoder." )
+#define FILTER_QUEUE_TEXT N_("Filter queue size")
+#define FILTER_QUEUE_LONGTEXT N_( \
+    "Maximum number of decoded pictures waiting for the filter thread; " \
+    "decoding waits once it is reached. 0 means no limit." )
+#define ENCODER_QUEUE_TEXT N_("Encoder queue size")
+#define ENCODER_QUEUE_LONGTEXT N_( \
+    "Maximum number of filtered pictures waiting for the encoder thread; " \
+    "filtering waits once it is reached. 0 means no limit." )
 
 
 static const char *const ppsz_deinterlace_type[] =
@@ -179,6 +198,8 @@ vlc_module_begin ()
                  MAXHEIGHT_LONGTEXT, true )
     add_module_list( SOUT_CFG_PREFIX "vfilter", "video filter2",
                      NULL, VFILTER_TEXT, VFILTER_LONGTEXT, false )
+    add_string( SOUT_CFG_PREFIX "ladder", NULL, LADDER_TEXT,
+                LADDER_LONGTEXT, true )
 
     set_section( N_("Audio"), NULL )
     add_module( SOUT_CFG_PREFIX "aenc", "encoder", NULL, AENC_TEXT,
@@ -218,6 +239,14 @@ vlc_module_begin ()
                  THREADS_LONGTEXT, true )
     add_bool( SOUT_CFG_PREFIX "high-priority", false, HP_TEXT, HP_LONGTEXT,
               true )
+    add_bool( SOUT_CFG_PREFIX "filter-thread", false, FILTER_THREAD_TEXT,
+              FILTER_THREAD_LONGTEXT, true )
+    add_integer( SOUT_CFG_PREFIX "filter-queue", 4, FILTER_QUEUE_TEXT,
+                 FILTER_QUEUE_LONGTEXT, true )
+        change_integer_range( 0, 1000 )
+    add_integer( SOUT_CFG_PREFIX "encoder-queue", 8, ENCODER_QUEUE_TEXT,
+                 ENCODER_QUEUE_LONGTEXT, true )
+        change_integer_range( 0, 1000 )
 
 vlc_module_end ()
 
@@ -226,7 +255,8 @@ static const char *const ppsz_sout_options[] = {
     "scale", "fps", "width", "height", "vfilter", "deinterlace",
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
-    "sfilter", "osd", "high-priority", "maxwidth", "maxheight",
+    "sfilter", "osd", "high-priority", "maxwidth", "maxheight", "ladder",
+    "filter-thread", "filter-queue", "encoder-queue",
     NULL
 };
 
@@ -358,6 +388,11 @@ static int Open( vlc_object_t *p_this )
         p_sys->psz_vf2 = NULL;
     free( psz_string );
 
+    psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "ladder" );
+    p_sys->i_rungs = transcode_ladder_parse( p_stream, psz_string,
+                                             &p_sys->p_rungs );
+    free( psz_string );
+
     p_sys->b_deinterlace = var_GetBool( p_stream, SOUT_CFG_PREFIX "deinterlace" );
 
     psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "deinterlace-module" );
@@ -375,6 +410,19 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->i_threads = var_GetInteger( p_stream, SOUT_CFG_PREFIX "threads" );
     p_sys->b_high_priority = var_GetBool( p_stream, SOUT_CFG_PREFIX "high-priority" );
+    p_sys->b_filter_thread = var_GetBool( p_stream, SOUT_CFG_PREFIX "filter-thread" );
+    p_sys->i_filter_queue = __MAX( 0, var_GetInteger( p_stream, SOUT_CFG_PREFIX "filter-queue" ) );
+    p_sys->i_encoder_queue = __MAX( 0, var_GetInteger( p_stream, SOUT_CFG_PREFIX "encoder-queue" ) );
+    if( var_InheritBool( p_stream, "low-latency" ) )
+    {   /* Every queued picture delays the output by a frame */
+        p_sys->i_filter_queue = 1;
+        p_sys->i_encoder_queue = 1;
+    }
+    if( p_stream->p_sout->b_unpaced && p_sys->i_threads == 0 )
+    {   /* Pipeline decoding, filtering and encoding across the CPUs */
+        p_sys->i_threads = vlc_GetCPUCount();
+        p_sys->b_filter_thread = true;
+    }
 
     if( p_sys->i_vcodec )
     {
@@ -384,6 +432,7 @@ static int Open( vlc_object_t *p_this )
     }
 
     /* Subpictures transcoding parameters */
+    vlc_mutex_init( &p_sys->lock_spu );
     p_sys->p_spu = NULL;
     p_sys->p_spu_blend = NULL;
     p_sys->psz_senc = NULL;
@@ -479,6 +528,7 @@ static void Close( vlc_object_t * p_this )
     free( p_sys->psz_alang );
 
     free( p_sys->psz_vf2 );
+    free( p_sys->p_rungs );
 
     config_ChainDestroy( p_sys->p_video_cfg );
     free( p_sys->psz_venc );
@@ -491,6 +541,7 @@ static void Close( vlc_object_t * p_this )
 
     if( p_sys->p_spu ) spu_Destroy( p_sys->p_spu );
     if( p_sys->p_spu_blend ) filter_DeleteBlend( p_sys->p_spu_blend );
+    vlc_mutex_destroy( &p_sys->lock_spu );
 
     config_ChainDestroy( p_sys->p_osd_cfg );
     free( p_sys->psz_osdenc );
@@ -640,6 +691,15 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
         return VLC_EGENERIC;
     }
 
+    /* Decoders and packetizers may modify their input in place
+     * (NULL flushes the transcoding chains) */
+    if( p_buffer != NULL )
+    {
+        p_buffer = block_Unshare( p_buffer );
+        if( unlikely(p_buffer == NULL) )
+            return VLC_ENOMEM;
+    }
+
     switch( id->p_decoder->fmt_in.i_cat )
     {
     case AUDIO_ES:
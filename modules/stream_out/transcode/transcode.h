@@ -9,21 +9,26 @@
 #include <vlc_es.h>
 #include <vlc_codec.h>
 
-#include <vlc_picture_fifo.h>
-
 /*100ms is around the limit where people are noticing lipsync issues*/
 #define MASTER_SYNC_MAX_DRIFT 100000
 
-struct sout_stream_sys_t
+/* Extra video output of an encoding ladder */
+typedef struct
 {
-    sout_stream_id_sys_t *id_video;
-    block_t         *p_buffers;
-    vlc_mutex_t     lock_out;
-    vlc_cond_t      cond;
-    bool            b_abort;
-    picture_fifo_t *pp_pics;
-    vlc_thread_t    thread;
+    unsigned int    i_width;
+    unsigned int    i_height;
+    int             i_bitrate;
+} transcode_rung_cfg_t;
+
+typedef struct transcode_ladder_t transcode_ladder_t;
+
+/* Thread of the video pipeline */
+typedef struct transcode_stage_t transcode_stage_t;
+typedef void (*transcode_stage_cb)( sout_stream_t *, sout_stream_id_sys_t *,
+                                    picture_t * );
 
+struct sout_stream_sys_t
+{
     /* Audio */
     vlc_fourcc_t    i_acodec;   /* codec audio (0 if not transcode) */
     char            *psz_aenc;
@@ -47,17 +52,26 @@ struct sout_stream_sys_t
     char            *psz_deinterlace;
     config_chain_t  *p_deinterlace_cfg;
     int             i_threads;
+    bool            b_filter_thread;
+    unsigned int    i_filter_queue;
+    unsigned int    i_encoder_queue;
     bool            b_high_priority;
     bool            b_hurry_up;
     unsigned int    fps_num,fps_den;
 
     char            *psz_vf2;
 
+    /* Ladder */
+    transcode_rung_cfg_t *p_rungs;
+    unsigned int    i_rungs;
+
     /* SPU */
     vlc_fourcc_t    i_scodec;   /* codec spu (0 if not transcode) */
     char            *psz_senc;
     bool            b_soverlay;
     config_chain_t  *p_spu_cfg;
+    vlc_mutex_t     lock_spu;   /**< p_spu and p_spu_blend, which the video
+                                     filter thread uses */
     spu_t           *p_spu;
     filter_t        *p_spu_blend;
 
@@ -91,7 +105,19 @@ struct sout_stream_id_sys_t
          {
              filter_chain_t  *p_f_chain; /**< Video filters */
              filter_chain_t  *p_uf_chain; /**< User-specified video filters */
+             filter_chain_t  *p_conv_chain; /**< Scaling, with a ladder */
+             transcode_ladder_t *p_ladder; /**< Extra outputs */
              video_format_t  fmt_input_video;
+
+             transcode_stage_t *p_filter_stage; /**< Filter thread */
+             transcode_stage_t *p_encoder_stage; /**< Encoder thread */
+             vlc_mutex_t     lock_out;  /**< Protects p_buffers */
+             block_t         *p_buffers; /**< Encoded, not sent yet */
+             unsigned int    i_decoded;
+             mtime_t         i_decode_time;
+             unsigned int    i_encoded;
+             mtime_t         i_encode_time;
+             mtime_t         i_encode_max; /**< Slowest picture */
          };
          struct
          {
@@ -143,3 +169,25 @@ int  transcode_video_process( sout_stream_t *, sout_stream_id_sys_t *,
                                      block_t *, block_t ** );
 bool transcode_video_add    ( sout_stream_t *, const es_format_t *,
                                 sout_stream_id_sys_t *);
+void transcode_video_encoder_init( sout_stream_t *, sout_stream_id_sys_t *,
+                                   encoder_t * );
+
+/* LADDER */
+
+unsigned transcode_ladder_parse( sout_stream_t *, const char *,
+                                 transcode_rung_cfg_t ** );
+transcode_ladder_t *transcode_ladder_new( sout_stream_t *,
+                                          sout_stream_id_sys_t * );
+void transcode_ladder_delete( sout_stream_t *, transcode_ladder_t * );
+void transcode_ladder_push  ( transcode_ladder_t *, picture_t * );
+void transcode_ladder_send  ( sout_stream_t *, transcode_ladder_t * );
+void transcode_ladder_drain ( sout_stream_t *, transcode_ladder_t * );
+
+/* PIPELINE */
+
+transcode_stage_t *transcode_stage_new( sout_stream_t *,
+                                        sout_stream_id_sys_t *, const char *,
+                                        unsigned int, transcode_stage_cb );
+void transcode_stage_delete( sout_stream_t *, transcode_stage_t * );
+void transcode_stage_push  ( transcode_stage_t *, picture_t * );
+void transcode_stage_wait  ( transcode_stage_t * );
@@ -66,56 +66,47 @@ static picture_t *transcode_video_filter_buffer_new( filter_t *p_filter )
     return picture_NewFromFormat( &p_filter->fmt_out.video );
 }
 
-static void* EncoderThread( void *obj )
-{
-    sout_stream_sys_t *p_sys = (sout_stream_sys_t*)obj;
-    sout_stream_id_sys_t *id = p_sys->id_video;
-    picture_t *p_pic = NULL;
-    int canc = vlc_savecancel ();
-    block_t *p_block = NULL;
+static void FilterFrame( sout_stream_t *, sout_stream_id_sys_t *,
+                         picture_t * );
 
-    vlc_mutex_lock( &p_sys->lock_out );
-
-    for( ;; )
-    {
-        while( !p_sys->b_abort &&
-               (p_pic = picture_fifo_Pop( p_sys->pp_pics )) == NULL )
-            vlc_cond_wait( &p_sys->cond, &p_sys->lock_out );
-
-        if( p_pic )
-        {
-            /* release lock while encoding */
-            vlc_mutex_unlock( &p_sys->lock_out );
-            p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
-            picture_Release( p_pic );
-            vlc_mutex_lock( &p_sys->lock_out );
+/* Queues encoded blocks, to be sent from the stream output thread */
+static void OutputBlocks( sout_stream_id_sys_t *id, block_t *p_block )
+{
+    if( p_block == NULL )
+        return;
 
-            block_ChainAppend( &p_sys->p_buffers, p_block );
-        }
+    vlc_mutex_lock( &id->lock_out );
+    block_ChainAppend( &id->p_buffers, p_block );
+    vlc_mutex_unlock( &id->lock_out );
+}
 
-        if( p_sys->b_abort )
-            break;
-    }
+/* Encodes a picture, or flushes the encoder if p_pic is NULL */
+static void EncodeFrame( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                         picture_t *p_pic )
+{
+    block_t *p_block;
 
-    /*Encode what we have in the buffer on closing*/
-    while( (p_pic = picture_fifo_Pop( p_sys->pp_pics )) != NULL )
+    VLC_UNUSED(p_stream);
+    if( p_pic == NULL )
     {
-        p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
-        picture_Release( p_pic );
-        block_ChainAppend( &p_sys->p_buffers, p_block );
+        if( !id->p_encoder->p_module )
+            return;
+        while( (p_block = id->p_encoder->pf_encode_video( id->p_encoder,
+                                                          NULL )) != NULL )
+            OutputBlocks( id, p_block );
+        return;
     }
 
-    /*Now flush encoder*/
-    do {
-        p_block = id->p_encoder->pf_encode_video(id->p_encoder, NULL );
-        block_ChainAppend( &p_sys->p_buffers, p_block );
-    } while( p_block );
-
-    vlc_mutex_unlock( &p_sys->lock_out );
+    mtime_t i_start = mdate();
+    p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
+    mtime_t i_duration = mdate() - i_start;
+    picture_Release( p_pic );
+    OutputBlocks( id, p_block );
 
-    vlc_restorecancel (canc);
-
-    return NULL;
+    id->i_encoded++;
+    id->i_encode_time += i_duration;
+    if( i_duration > id->i_encode_max )
+        id->i_encode_max = i_duration;
 }
 
 int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
@@ -211,37 +202,41 @@ int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
     }
     id->p_encoder->p_module = NULL;
 
-    if( p_sys->i_threads <= 0 )
-        return VLC_SUCCESS;
+    vlc_mutex_init( &id->lock_out );
+    id->p_buffers = NULL;
+    id->i_decoded = 0;
+    id->i_decode_time = 0;
+    id->i_encoded = 0;
+    id->i_encode_time = 0;
+    id->i_encode_max = 0;
 
-    int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
-                       VLC_THREAD_PRIORITY_VIDEO;
-    p_sys->id_video = id;
-    p_sys->pp_pics = picture_fifo_New();
-    if( p_sys->pp_pics == NULL )
+    if( p_sys->i_threads > 0 )
     {
-        msg_Err( p_stream, "cannot create picture fifo" );
-        module_unneed( id->p_decoder, id->p_decoder->p_module );
-        id->p_decoder->p_module = NULL;
-        free( id->p_decoder->p_owner );
-        return VLC_ENOMEM;
+        id->p_encoder_stage = transcode_stage_new( p_stream, id, "encoder",
+                                                   p_sys->i_encoder_queue,
+                                                   EncodeFrame );
+        if( id->p_encoder_stage == NULL )
+            goto error;
     }
-    vlc_mutex_init( &p_sys->lock_out );
-    vlc_cond_init( &p_sys->cond );
-    p_sys->p_buffers = NULL;
-    p_sys->b_abort = false;
-    if( vlc_clone( &p_sys->thread, EncoderThread, p_sys, i_priority ) )
+    if( p_sys->b_filter_thread )
     {
-        msg_Err( p_stream, "cannot spawn encoder thread" );
-        vlc_mutex_destroy( &p_sys->lock_out );
-        vlc_cond_destroy( &p_sys->cond );
-        picture_fifo_Delete( p_sys->pp_pics );
-        module_unneed( id->p_decoder, id->p_decoder->p_module );
-        id->p_decoder->p_module = NULL;
-        free( id->p_decoder->p_owner );
-        return VLC_EGENERIC;
+        id->p_filter_stage = transcode_stage_new( p_stream, id, "filter",
+                                                  p_sys->i_filter_queue,
+                                                  FilterFrame );
+        if( id->p_filter_stage == NULL )
+            goto error;
     }
     return VLC_SUCCESS;
+
+error:
+    if( id->p_encoder_stage )
+        transcode_stage_delete( p_stream, id->p_encoder_stage );
+    id->p_encoder_stage = NULL;
+    vlc_mutex_destroy( &id->lock_out );
+    module_unneed( id->p_decoder, id->p_decoder->p_module );
+    id->p_decoder->p_module = NULL;
+    free( id->p_decoder->p_owner );
+    return VLC_EGENERIC;
 }
 
 static void transcode_video_filter_init( sout_stream_t *p_stream,
@@ -314,8 +309,25 @@ static void transcode_video_filter_init( sout_stream_t *p_stream,
 
 }
 
+/* Hardware surfaces cannot be accessed as system memory */
+static bool transcode_video_is_hw( vlc_fourcc_t i_chroma )
+{
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( i_chroma );
+
+    return p_dsc != NULL && p_dsc->plane_count == 0;
+}
+
+static bool transcode_video_is_scaled( const video_format_t *p_src,
+                                       const video_format_t *p_dst )
+{
+    return p_src->i_width != p_dst->i_width
+        || p_src->i_height != p_dst->i_height;
+}
+
 /* Take care of the scaling and chroma conversions. */
-static void conversion_video_filter_append( sout_stream_id_sys_t *id )
+static void conversion_video_filter_append( sout_stream_t *p_stream,
+                                            sout_stream_id_sys_t *id )
 {
     const es_format_t *p_fmt_out = &id->p_decoder->fmt_out;
     if( id->p_f_chain )
@@ -324,19 +336,62 @@ static void conversion_video_filter_append( sout_stream_id_sys_t *id )
     if( id->p_uf_chain )
         p_fmt_out = filter_chain_GetFmtOut( id->p_uf_chain );
 
-    if( ( p_fmt_out->video.i_chroma != id->p_encoder->fmt_in.video.i_chroma ) ||
-        ( p_fmt_out->video.i_width != id->p_encoder->fmt_in.video.i_width ) ||
-        ( p_fmt_out->video.i_height != id->p_encoder->fmt_in.video.i_height ) )
+    if( p_fmt_out->video.i_chroma == id->p_encoder->fmt_in.video.i_chroma &&
+        !transcode_video_is_scaled( &p_fmt_out->video,
+                                    &id->p_encoder->fmt_in.video ) )
+        return;
+
+    filter_chain_t *p_chain = id->p_uf_chain ? id->p_uf_chain : id->p_f_chain;
+
+    if( p_stream->p_sys->i_rungs > 0 )
     {
-        filter_chain_AppendFilter( id->p_uf_chain ? id->p_uf_chain : id->p_f_chain,
-                                   NULL, NULL,
-                                   p_fmt_out,
-                                   &id->p_encoder->fmt_in );
+        /* The ladder rungs scale the unscaled pictures on their own, so
+         * the main output gets a separate conversion chain. */
+        filter_owner_t owner = {
+            .sys = p_stream->p_sys,
+            .video = {
+                .buffer_new = transcode_video_filter_buffer_new,
+            },
+        };
+
+        id->p_conv_chain = filter_chain_NewVideo( p_stream, false, &owner );
+        filter_chain_Reset( id->p_conv_chain, p_fmt_out,
+                            &id->p_encoder->fmt_in );
+        p_chain = id->p_conv_chain;
+    }
+
+    /* Scale hardware surfaces before they get downloaded, if the encoder
+     * cannot take them as they are */
+    if( transcode_video_is_hw( p_fmt_out->video.i_chroma ) &&
+        transcode_video_is_scaled( &p_fmt_out->video,
+                                   &id->p_encoder->fmt_in.video ) )
+    {
+        es_format_t fmt;
+
+        es_format_Copy( &fmt, &id->p_encoder->fmt_in );
+        fmt.i_codec = fmt.video.i_chroma = p_fmt_out->video.i_chroma;
+        if( filter_chain_AppendFilter( p_chain, NULL, NULL, p_fmt_out,
+                                       &fmt ) != NULL )
+        {
+            msg_Dbg( p_stream, "scaling %4.4s surfaces",
+                     (const char *)&fmt.i_codec );
+            p_fmt_out = filter_chain_GetFmtOut( p_chain );
+        }
+        es_format_Clean( &fmt );
     }
+
+    if( p_fmt_out->video.i_chroma != id->p_encoder->fmt_in.video.i_chroma ||
+        transcode_video_is_scaled( &p_fmt_out->video,
+                                   &id->p_encoder->fmt_in.video ) )
+        filter_chain_AppendFilter( p_chain, NULL, NULL, p_fmt_out,
+                                   &id->p_encoder->fmt_in );
 }
 
-static void transcode_video_encoder_init( sout_stream_t *p_stream,
-                                          sout_stream_id_sys_t *id )
+/* Computes the encoder formats (size, aspect ratio and frame rate) from the
+ * format of the filtered pictures and the requested output size. */
+void transcode_video_encoder_init( sout_stream_t *p_stream,
+                                   sout_stream_id_sys_t *id,
+                                   encoder_t *p_enc )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
 
@@ -376,8 +431,8 @@ static void transcode_video_encoder_init( sout_stream_t *p_stream,
     msg_Dbg( p_stream, "source pixel aspect is %f:1", (double) f_aspect );
 
     /* Calculate scaling factor for specified parameters */
-    if( id->p_encoder->fmt_out.video.i_visible_width <= 0 &&
-        id->p_encoder->fmt_out.video.i_visible_height <= 0 && p_sys->f_scale )
+    if( p_enc->fmt_out.video.i_visible_width <= 0 &&
+        p_enc->fmt_out.video.i_visible_height <= 0 && p_sys->f_scale )
     {
         /* Global scaling. Make sure width will remain a factor of 16 */
         float f_real_scale;
@@ -396,26 +451,26 @@ static void transcode_video_encoder_init( sout_stream_t *p_stream,
         f_scale_width = f_real_scale;
         f_scale_height = (float) i_new_height / (float) i_src_visible_height;
     }
-    else if( id->p_encoder->fmt_out.video.i_visible_width > 0 &&
-             id->p_encoder->fmt_out.video.i_visible_height <= 0 )
+    else if( p_enc->fmt_out.video.i_visible_width > 0 &&
+             p_enc->fmt_out.video.i_visible_height <= 0 )
     {
         /* Only width specified */
-        f_scale_width = (float)id->p_encoder->fmt_out.video.i_visible_width/i_src_visible_width;
+        f_scale_width = (float)p_enc->fmt_out.video.i_visible_width/i_src_visible_width;
         f_scale_height = f_scale_width;
     }
-    else if( id->p_encoder->fmt_out.video.i_visible_width <= 0 &&
-             id->p_encoder->fmt_out.video.i_visible_height > 0 )
+    else if( p_enc->fmt_out.video.i_visible_width <= 0 &&
+             p_enc->fmt_out.video.i_visible_height > 0 )
     {
          /* Only height specified */
-         f_scale_height = (float)id->p_encoder->fmt_out.video.i_visible_height/i_src_visible_height;
+         f_scale_height = (float)p_enc->fmt_out.video.i_visible_height/i_src_visible_height;
          f_scale_width = f_scale_height;
      }
-     else if( id->p_encoder->fmt_out.video.i_visible_width > 0 &&
-              id->p_encoder->fmt_out.video.i_visible_height > 0 )
+     else if( p_enc->fmt_out.video.i_visible_width > 0 &&
+              p_enc->fmt_out.video.i_visible_height > 0 )
      {
          /* Width and height specified */
-         f_scale_width = (float)id->p_encoder->fmt_out.video.i_visible_width/i_src_visible_width;
-         f_scale_height = (float)id->p_encoder->fmt_out.video.i_visible_height/i_src_visible_height;
+         f_scale_width = (float)p_enc->fmt_out.video.i_visible_width/i_src_visible_width;
+         f_scale_height = (float)p_enc->fmt_out.video.i_visible_height/i_src_visible_height;
      }
 
      /* check maxwidth and maxheight */
@@ -450,15 +505,15 @@ static void transcode_video_encoder_init( sout_stream_t *p_stream,
      f_aspect = f_aspect * i_dst_visible_width / i_dst_visible_height;
 
      /* Store calculated values */
-     id->p_encoder->fmt_out.video.i_width = i_dst_width;
-     id->p_encoder->fmt_out.video.i_visible_width = i_dst_visible_width;
-     id->p_encoder->fmt_out.video.i_height = i_dst_height;
-     id->p_encoder->fmt_out.video.i_visible_height = i_dst_visible_height;
+     p_enc->fmt_out.video.i_width = i_dst_width;
+     p_enc->fmt_out.video.i_visible_width = i_dst_visible_width;
+     p_enc->fmt_out.video.i_height = i_dst_height;
+     p_enc->fmt_out.video.i_visible_height = i_dst_visible_height;
 
-     id->p_encoder->fmt_in.video.i_width = i_dst_width;
-     id->p_encoder->fmt_in.video.i_visible_width = i_dst_visible_width;
-     id->p_encoder->fmt_in.video.i_height = i_dst_height;
-     id->p_encoder->fmt_in.video.i_visible_height = i_dst_visible_height;
+     p_enc->fmt_in.video.i_width = i_dst_width;
+     p_enc->fmt_in.video.i_visible_width = i_dst_visible_width;
+     p_enc->fmt_in.video.i_height = i_dst_height;
+     p_enc->fmt_in.video.i_visible_height = i_dst_visible_height;
 
      msg_Dbg( p_stream, "source %ix%i, destination %ix%i",
          i_src_visible_width, i_src_visible_height,
@@ -466,73 +521,73 @@ static void transcode_video_encoder_init( sout_stream_t *p_stream,
      );
 
     /* Handle frame rate conversion */
-    if( !id->p_encoder->fmt_out.video.i_frame_rate ||
-        !id->p_encoder->fmt_out.video.i_frame_rate_base )
+    if( !p_enc->fmt_out.video.i_frame_rate ||
+        !p_enc->fmt_out.video.i_frame_rate_base )
     {
         if( p_fmt_out->video.i_frame_rate &&
             p_fmt_out->video.i_frame_rate_base )
         {
-            id->p_encoder->fmt_out.video.i_frame_rate =
+            p_enc->fmt_out.video.i_frame_rate =
                 p_fmt_out->video.i_frame_rate;
-            id->p_encoder->fmt_out.video.i_frame_rate_base =
+            p_enc->fmt_out.video.i_frame_rate_base =
                 p_fmt_out->video.i_frame_rate_base;
         }
         else
         {
             /* Pick a sensible default value */
-            id->p_encoder->fmt_out.video.i_frame_rate = ENC_FRAMERATE;
-            id->p_encoder->fmt_out.video.i_frame_rate_base = ENC_FRAMERATE_BASE;
+            p_enc->fmt_out.video.i_frame_rate = ENC_FRAMERATE;
+            p_enc->fmt_out.video.i_frame_rate_base = ENC_FRAMERATE_BASE;
         }
     }
 
-    id->p_encoder->fmt_in.video.orientation =
-        id->p_encoder->fmt_out.video.orientation =
+    p_enc->fmt_in.video.orientation =
+        p_enc->fmt_out.video.orientation =
         id->p_decoder->fmt_in.video.orientation;
 
-    id->p_encoder->fmt_in.video.i_frame_rate =
-        id->p_encoder->fmt_out.video.i_frame_rate;
-    id->p_encoder->fmt_in.video.i_frame_rate_base =
-        id->p_encoder->fmt_out.video.i_frame_rate_base;
+    p_enc->fmt_in.video.i_frame_rate =
+        p_enc->fmt_out.video.i_frame_rate;
+    p_enc->fmt_in.video.i_frame_rate_base =
+        p_enc->fmt_out.video.i_frame_rate_base;
 
-    vlc_ureduce( &id->p_encoder->fmt_in.video.i_frame_rate,
-        &id->p_encoder->fmt_in.video.i_frame_rate_base,
-        id->p_encoder->fmt_in.video.i_frame_rate,
-        id->p_encoder->fmt_in.video.i_frame_rate_base,
+    vlc_ureduce( &p_enc->fmt_in.video.i_frame_rate,
+        &p_enc->fmt_in.video.i_frame_rate_base,
+        p_enc->fmt_in.video.i_frame_rate,
+        p_enc->fmt_in.video.i_frame_rate_base,
         0 );
      msg_Dbg( p_stream, "source fps %d/%d, destination %d/%d",
         id->p_decoder->fmt_out.video.i_frame_rate,
         id->p_decoder->fmt_out.video.i_frame_rate_base,
-        id->p_encoder->fmt_in.video.i_frame_rate,
-        id->p_encoder->fmt_in.video.i_frame_rate_base );
+        p_enc->fmt_in.video.i_frame_rate,
+        p_enc->fmt_in.video.i_frame_rate_base );
 
 
     /* Check whether a particular aspect ratio was requested */
-    if( id->p_encoder->fmt_out.video.i_sar_num <= 0 ||
-        id->p_encoder->fmt_out.video.i_sar_den <= 0 )
+    if( p_enc->fmt_out.video.i_sar_num <= 0 ||
+        p_enc->fmt_out.video.i_sar_den <= 0 )
     {
-        vlc_ureduce( &id->p_encoder->fmt_out.video.i_sar_num,
-                     &id->p_encoder->fmt_out.video.i_sar_den,
+        vlc_ureduce( &p_enc->fmt_out.video.i_sar_num,
+                     &p_enc->fmt_out.video.i_sar_den,
                      (uint64_t)p_fmt_out->video.i_sar_num * i_src_visible_width  * i_dst_visible_height,
                      (uint64_t)p_fmt_out->video.i_sar_den * i_src_visible_height * i_dst_visible_width,
                      0 );
     }
     else
     {
-        vlc_ureduce( &id->p_encoder->fmt_out.video.i_sar_num,
-                     &id->p_encoder->fmt_out.video.i_sar_den,
-                     id->p_encoder->fmt_out.video.i_sar_num,
-                     id->p_encoder->fmt_out.video.i_sar_den,
+        vlc_ureduce( &p_enc->fmt_out.video.i_sar_num,
+                     &p_enc->fmt_out.video.i_sar_den,
+                     p_enc->fmt_out.video.i_sar_num,
+                     p_enc->fmt_out.video.i_sar_den,
                      0 );
     }
 
-    id->p_encoder->fmt_in.video.i_sar_num =
-        id->p_encoder->fmt_out.video.i_sar_num;
-    id->p_encoder->fmt_in.video.i_sar_den =
-        id->p_encoder->fmt_out.video.i_sar_den;
+    p_enc->fmt_in.video.i_sar_num =
+        p_enc->fmt_out.video.i_sar_num;
+    p_enc->fmt_in.video.i_sar_den =
+        p_enc->fmt_out.video.i_sar_den;
 
     msg_Dbg( p_stream, "encoder aspect is %i:%i",
-             id->p_encoder->fmt_out.video.i_sar_num * id->p_encoder->fmt_out.video.i_width,
-             id->p_encoder->fmt_out.video.i_sar_den * id->p_encoder->fmt_out.video.i_height );
+             p_enc->fmt_out.video.i_sar_num * p_enc->fmt_out.video.i_width,
+             p_enc->fmt_out.video.i_sar_den * p_enc->fmt_out.video.i_height );
 
 }
 
@@ -546,6 +601,17 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
              id->p_encoder->fmt_in.video.i_width,
              id->p_encoder->fmt_in.video.i_height );
 
+    /* Offer the pictures in the chroma they come out of the filters, so
+     * that an encoder taking them as they are (hardware surfaces from a
+     * hardware decoder, in particular) needs no conversion */
+    const es_format_t *p_fmt_out = &id->p_decoder->fmt_out;
+    if( id->p_f_chain )
+        p_fmt_out = filter_chain_GetFmtOut( id->p_f_chain );
+    if( id->p_uf_chain )
+        p_fmt_out = filter_chain_GetFmtOut( id->p_uf_chain );
+    id->p_encoder->fmt_in.i_codec =
+    id->p_encoder->fmt_in.video.i_chroma = p_fmt_out->video.i_chroma;
+
     id->p_encoder->p_module =
         module_need( id->p_encoder, "encoder", p_sys->psz_venc, true );
     if( !id->p_encoder->p_module )
@@ -557,6 +623,9 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
     }
 
     id->p_encoder->fmt_in.video.i_chroma = id->p_encoder->fmt_in.i_codec;
+    if( transcode_video_is_hw( id->p_encoder->fmt_in.i_codec ) )
+        msg_Dbg( p_stream, "encoding %4.4s surfaces directly",
+                 (const char *)&id->p_encoder->fmt_in.i_codec );
 
     /*  */
     id->p_encoder->fmt_out.i_codec =
@@ -575,21 +644,25 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
 void transcode_video_close( sout_stream_t *p_stream,
                                    sout_stream_id_sys_t *id )
 {
-    if( p_stream->p_sys->i_threads >= 1 && !p_stream->p_sys->b_abort )
-    {
-        vlc_mutex_lock( &p_stream->p_sys->lock_out );
-        p_stream->p_sys->b_abort = true;
-        vlc_cond_signal( &p_stream->p_sys->cond );
-        vlc_mutex_unlock( &p_stream->p_sys->lock_out );
-
-        vlc_join( p_stream->p_sys->thread, NULL );
-
-        picture_fifo_Delete( p_stream->p_sys->pp_pics );
-        block_ChainRelease( p_stream->p_sys->p_buffers );
-    }
-
-    vlc_mutex_destroy( &p_stream->p_sys->lock_out );
-    vlc_cond_destroy( &p_stream->p_sys->cond );
+    /* Stop the pipeline, in order */
+    if( id->p_filter_stage )
+        transcode_stage_delete( p_stream, id->p_filter_stage );
+    id->p_filter_stage = NULL;
+    if( id->p_encoder_stage )
+        transcode_stage_delete( p_stream, id->p_encoder_stage );
+    id->p_encoder_stage = NULL;
+
+    block_ChainRelease( id->p_buffers );
+    id->p_buffers = NULL;
+    vlc_mutex_destroy( &id->lock_out );
+
+    if( id->i_decoded > 0 )
+        msg_Dbg( p_stream, "decoder: %u pictures, %"PRId64" us per picture",
+                 id->i_decoded, id->i_decode_time / id->i_decoded );
+    if( id->i_encoded > 0 )
+        msg_Dbg( p_stream, "encoder: %u pictures, %"PRId64" us per picture, "
+                 "%"PRId64" us at most", id->i_encoded,
+                 id->i_encode_time / id->i_encoded, id->i_encode_max );
 
     /* Close decoder */
     if( id->p_decoder->p_module )
@@ -603,23 +676,30 @@ void transcode_video_close( sout_stream_t *p_stream,
     if( id->p_encoder->p_module )
         module_unneed( id->p_encoder, id->p_encoder->p_module );
 
+    if( id->p_ladder )
+        transcode_ladder_delete( p_stream, id->p_ladder );
+    id->p_ladder = NULL;
+
     /* Close filters */
     if( id->p_f_chain )
         filter_chain_Delete( id->p_f_chain );
     if( id->p_uf_chain )
         filter_chain_Delete( id->p_uf_chain );
+    if( id->p_conv_chain )
+        filter_chain_Delete( id->p_conv_chain );
 }
 
-static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_id_sys_t *id, block_t **out )
+static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_id_sys_t *id )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
-    picture_t *p_pic2 = NULL;
 
     /*
      * Encoding
      */
-    /* Check if we have a subpicture to overlay */
-    if( p_sys->p_spu )
+    /* Check if we have a subpicture to overlay (not onto hardware surfaces,
+     * which cannot be blended into) */
+    vlc_mutex_lock( &p_sys->lock_spu );
+    if( p_sys->p_spu && !transcode_video_is_hw( p_pic->format.i_chroma ) )
     {
         video_format_t fmt = id->p_encoder->fmt_in.video;
         if( fmt.i_visible_width <= 0 || fmt.i_visible_height <= 0 )
@@ -656,27 +736,69 @@ static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_
             subpicture_Delete( p_subpic );
         }
     }
+    vlc_mutex_unlock( &p_sys->lock_spu );
 
-    if( p_sys->i_threads == 0 )
-    {
-        block_t *p_block;
+    if( id->p_encoder_stage )
+        transcode_stage_push( id->p_encoder_stage, p_pic );
+    else
+        EncodeFrame( p_stream, id, p_pic );
+}
 
-        p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
-        block_ChainAppend( out, p_block );
-    }
+/* Runs the filter chains on a decoded picture, and outputs the result */
+static void FilterFrame( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                         picture_t *p_pic )
+{
+    if( p_pic == NULL )
+        return;
 
-    if( p_sys->i_threads )
-    {
-        vlc_mutex_lock( &p_sys->lock_out );
-        picture_fifo_Push( p_sys->pp_pics, p_pic );
-        vlc_cond_signal( &p_sys->cond );
-        vlc_mutex_unlock( &p_sys->lock_out );
+    /* Run the filter and output chains; first with the picture,
+     * and then with NULL as many times as we need until they
+     * stop outputting frames.
+     */
+    for ( ;; ) {
+        picture_t *p_filtered_pic = p_pic;
+
+        /* Run filter chain */
+        if( id->p_f_chain )
+            p_filtered_pic = filter_chain_VideoFilter( id->p_f_chain, p_filtered_pic );
+        if( !p_filtered_pic )
+            break;
+
+        for ( ;; ) {
+            picture_t *p_user_filtered_pic = p_filtered_pic;
+
+            /* Run user specified filter chain */
+            if( id->p_uf_chain )
+                p_user_filtered_pic = filter_chain_VideoFilter( id->p_uf_chain, p_user_filtered_pic );
+            if( !p_user_filtered_pic )
+                break;
+
+            /* The rungs hold the picture, so that it gets copied
+             * before any subpicture is blended into it */
+            if( id->p_ladder )
+                transcode_ladder_push( id->p_ladder,
+                                       p_user_filtered_pic );
+            if( id->p_conv_chain )
+                p_user_filtered_pic = filter_chain_VideoFilter(
+                    id->p_conv_chain, p_user_filtered_pic );
+            if( p_user_filtered_pic )
+                OutputFrame( p_stream, p_user_filtered_pic, id );
+
+            p_filtered_pic = NULL;
+        }
+
+        p_pic = NULL;
     }
+}
 
-    if( p_sys->i_threads && p_pic2 )
-        picture_Release( p_pic2 );
-    else if ( p_sys->i_threads == 0 )
-        picture_Release( p_pic );
+/* Waits for the filter and encoder threads to be done with their pictures,
+ * before the filters or the encoder get reconfigured */
+static void WaitPipeline( sout_stream_id_sys_t *id )
+{
+    if( id->p_filter_stage )
+        transcode_stage_wait( id->p_filter_stage );
+    if( id->p_encoder_stage )
+        transcode_stage_wait( id->p_encoder_stage );
 }
 
 int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
@@ -688,36 +810,36 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
 
     if( unlikely( in == NULL ) )
     {
-        if( p_sys->i_threads == 0 )
-        {
-            block_t *p_block;
-            do {
-                p_block = id->p_encoder->pf_encode_video(id->p_encoder, NULL );
-                block_ChainAppend( out, p_block );
-            } while( p_block );
-        }
+        msg_Dbg( p_stream, "flushing the video pipeline" );
+        if( id->p_filter_stage )
+            transcode_stage_delete( p_stream, id->p_filter_stage );
+        id->p_filter_stage = NULL;
+
+        if( id->p_ladder )
+            transcode_ladder_drain( p_stream, id->p_ladder );
+
+        if( id->p_encoder_stage )
+            transcode_stage_delete( p_stream, id->p_encoder_stage );
         else
-        {
-            msg_Dbg( p_stream, "Flushing thread and waiting that");
-            vlc_mutex_lock( &p_stream->p_sys->lock_out );
-            p_stream->p_sys->b_abort = true;
-            vlc_cond_signal( &p_stream->p_sys->cond );
-            vlc_mutex_unlock( &p_stream->p_sys->lock_out );
-
-            vlc_join( p_stream->p_sys->thread, NULL );
-            vlc_mutex_lock( &p_sys->lock_out );
-            *out = p_sys->p_buffers;
-            p_sys->p_buffers = NULL;
-            vlc_mutex_unlock( &p_sys->lock_out );
-
-            msg_Dbg( p_stream, "Flushing done");
-        }
+            EncodeFrame( p_stream, id, NULL );
+        id->p_encoder_stage = NULL;
+
+        vlc_mutex_lock( &id->lock_out );
+        *out = id->p_buffers;
+        id->p_buffers = NULL;
+        vlc_mutex_unlock( &id->lock_out );
         return VLC_SUCCESS;
     }
 
 
-    while( (p_pic = id->p_decoder->pf_decode_video( id->p_decoder, &in )) )
+    for( ;; )
     {
+        mtime_t i_start = mdate();
+        p_pic = id->p_decoder->pf_decode_video( id->p_decoder, &in );
+        id->i_decode_time += mdate() - i_start;
+        if( p_pic == NULL )
+            break;
+        id->i_decoded++;
 
         if( unlikely (
              id->p_encoder->p_module &&
@@ -729,6 +851,8 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                         id->fmt_input_video.i_sar_num, id->p_decoder->fmt_out.video.i_sar_num,
                         id->fmt_input_video.i_sar_den, id->p_decoder->fmt_out.video.i_sar_den
                     );
+            WaitPipeline( id );
+
             /* Close filters */
             if( id->p_f_chain )
                 filter_chain_Delete( id->p_f_chain );
@@ -736,6 +860,9 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             if( id->p_uf_chain )
                 filter_chain_Delete( id->p_uf_chain );
             id->p_uf_chain = NULL;
+            if( id->p_conv_chain )
+                filter_chain_Delete( id->p_conv_chain );
+            id->p_conv_chain = NULL;
 
             /* Reinitialize filters */
             id->p_encoder->fmt_out.video.i_visible_width  = p_sys->i_width & ~1;
@@ -743,23 +870,26 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             id->p_encoder->fmt_out.video.i_sar_num = id->p_encoder->fmt_out.video.i_sar_den = 0;
 
             transcode_video_filter_init( p_stream, id );
-            transcode_video_encoder_init( p_stream, id );
-            conversion_video_filter_append( id );
+            transcode_video_encoder_init( p_stream, id, id->p_encoder );
+            conversion_video_filter_append( p_stream, id );
             memcpy( &id->fmt_input_video, &id->p_decoder->fmt_out.video, sizeof(video_format_t));
         }
 
 
         if( unlikely( !id->p_encoder->p_module ) )
         {
+            WaitPipeline( id );
+
             if( id->p_f_chain )
                 filter_chain_Delete( id->p_f_chain );
             if( id->p_uf_chain )
                 filter_chain_Delete( id->p_uf_chain );
-            id->p_f_chain = id->p_uf_chain = NULL;
+            if( id->p_conv_chain )
+                filter_chain_Delete( id->p_conv_chain );
+            id->p_f_chain = id->p_uf_chain = id->p_conv_chain = NULL;
 
             transcode_video_filter_init( p_stream, id );
-            transcode_video_encoder_init( p_stream, id );
-            conversion_video_filter_append( id );
+            transcode_video_encoder_init( p_stream, id, id->p_encoder );
             memcpy( &id->fmt_input_video, &id->p_decoder->fmt_out.video, sizeof(video_format_t));
 
             if( transcode_video_encoder_open( p_stream, id ) != VLC_SUCCESS )
@@ -769,48 +899,37 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                 id->b_transcode = false;
                 return VLC_EGENERIC;
             }
-        }
-
-        /* Run the filter and output chains; first with the picture,
-         * and then with NULL as many times as we need until they
-         * stop outputting frames.
-         */
-        for ( ;; ) {
-            picture_t *p_filtered_pic = p_pic;
-
-            /* Run filter chain */
-            if( id->p_f_chain )
-                p_filtered_pic = filter_chain_VideoFilter( id->p_f_chain, p_filtered_pic );
-            if( !p_filtered_pic )
-                break;
+            /* Convert to whatever the encoder asked for */
+            conversion_video_filter_append( p_stream, id );
 
-            for ( ;; ) {
-                picture_t *p_user_filtered_pic = p_filtered_pic;
-
-                /* Run user specified filter chain */
-                if( id->p_uf_chain )
-                    p_user_filtered_pic = filter_chain_VideoFilter( id->p_uf_chain, p_user_filtered_pic );
-                if( !p_user_filtered_pic )
-                    break;
-
-                OutputFrame( p_stream, p_user_filtered_pic, id, out );
-
-                p_filtered_pic = NULL;
+            if( p_sys->i_rungs > 0 )
+            {
+                id->p_ladder = transcode_ladder_new( p_stream, id );
+                if( id->p_ladder == NULL )
+                {
+                    picture_Release( p_pic );
+                    transcode_video_close( p_stream, id );
+                    id->b_transcode = false;
+                    return VLC_EGENERIC;
+                }
             }
-
-            p_pic = NULL;
         }
-    }
 
-    if( p_sys->i_threads >= 1 )
-    {
-        /* Pick up any return data the encoder thread wants to output. */
-        vlc_mutex_lock( &p_sys->lock_out );
-        *out = p_sys->p_buffers;
-        p_sys->p_buffers = NULL;
-        vlc_mutex_unlock( &p_sys->lock_out );
+        if( id->p_filter_stage )
+            transcode_stage_push( id->p_filter_stage, p_pic );
+        else
+            FilterFrame( p_stream, id, p_pic );
     }
 
+    if( id->p_ladder )
+        transcode_ladder_send( p_stream, id->p_ladder );
+
+    /* Pick up the blocks encoded so far */
+    vlc_mutex_lock( &id->lock_out );
+    *out = id->p_buffers;
+    id->p_buffers = NULL;
+    vlc_mutex_unlock( &id->lock_out );
+
     return VLC_SUCCESS;
 }
 
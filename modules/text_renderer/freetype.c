@@ -968,6 +968,110 @@ static uni_char_t* SegmentsToTextAndStyles( filter_t *p_filter, const text_segme
     return psz_uni;
 }
 
+static bool StyleEquals( const text_style_t *p_style1,
+                         const text_style_t *p_style2 )
+{
+    return p_style1->i_features == p_style2->i_features
+        && p_style1->i_style_flags == p_style2->i_style_flags
+        && p_style1->f_font_relsize == p_style2->f_font_relsize
+        && p_style1->i_font_size == p_style2->i_font_size
+        && p_style1->i_font_color == p_style2->i_font_color
+        && p_style1->i_font_alpha == p_style2->i_font_alpha
+        && p_style1->i_spacing == p_style2->i_spacing
+        && p_style1->i_outline_color == p_style2->i_outline_color
+        && p_style1->i_outline_alpha == p_style2->i_outline_alpha
+        && p_style1->i_outline_width == p_style2->i_outline_width
+        && p_style1->i_shadow_color == p_style2->i_shadow_color
+        && p_style1->i_shadow_alpha == p_style2->i_shadow_alpha
+        && p_style1->i_shadow_width == p_style2->i_shadow_width
+        && p_style1->i_background_color == p_style2->i_background_color
+        && p_style1->i_background_alpha == p_style2->i_background_alpha
+        && p_style1->i_karaoke_background_color == p_style2->i_karaoke_background_color
+        && p_style1->i_karaoke_background_alpha == p_style2->i_karaoke_background_alpha
+        && !strcmp( p_style1->psz_fontname ? p_style1->psz_fontname : "",
+                    p_style2->psz_fontname ? p_style2->psz_fontname : "" )
+        && !strcmp( p_style1->psz_monofontname ? p_style1->psz_monofontname : "",
+                    p_style2->psz_monofontname ? p_style2->psz_monofontname : "" );
+}
+
+static void LinesCacheClean( lines_cache_entry_t *p_entry )
+{
+    if( !p_entry->psz_text )
+        return;
+    FreeLines( p_entry->p_lines );
+    free( p_entry->psz_text );
+    FreeStylesArray( p_entry->pp_styles, p_entry->i_styles );
+    p_entry->psz_text = NULL;
+}
+
+/**
+ * Look the layout of a text up, as computed by a previous Render()
+ */
+static lines_cache_entry_t *LinesCacheFind( filter_t *p_filter,
+                                            const uni_char_t *psz_text,
+                                            size_t i_text_length,
+                                            text_style_t *const *pp_styles,
+                                            bool b_grid )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    for( int i = 0; i < LINES_CACHE_SIZE; ++i )
+    {
+        lines_cache_entry_t *p_entry = &p_sys->lines_cache[ i ];
+        if( !p_entry->psz_text
+         || p_entry->i_text_length != i_text_length
+         || p_entry->b_grid != b_grid
+         || p_entry->i_width != p_filter->fmt_out.video.i_width
+         || p_entry->i_height != p_filter->fmt_out.video.i_height
+         || memcmp( p_entry->psz_text, psz_text,
+                    i_text_length * sizeof( *psz_text ) ) )
+            continue;
+
+        size_t j = 0;
+        while( j < i_text_length
+            && ( ( j > 0 && pp_styles[ j ] == pp_styles[ j - 1 ]
+                         && p_entry->pp_styles[ j ] == p_entry->pp_styles[ j - 1 ] )
+              || StyleEquals( pp_styles[ j ], p_entry->pp_styles[ j ] ) ) )
+            j++;
+        if( j < i_text_length )
+            continue;
+
+        p_entry->i_last_use = ++p_sys->i_lines_use_count;
+        return p_entry;
+    }
+    return NULL;
+}
+
+/**
+ * Keep the layout of a text, which then owns the text and its styles
+ */
+static void LinesCachePut( filter_t *p_filter, uni_char_t *psz_text,
+                           size_t i_text_length, text_style_t **pp_styles,
+                           size_t i_styles, bool b_grid, line_desc_t *p_lines,
+                           const FT_BBox *p_bbox, int i_max_face_height )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    lines_cache_entry_t *p_entry = &p_sys->lines_cache[ 0 ];
+    for( int i = 1; i < LINES_CACHE_SIZE && p_entry->psz_text; ++i )
+        if( !p_sys->lines_cache[ i ].psz_text
+         || p_sys->lines_cache[ i ].i_last_use < p_entry->i_last_use )
+            p_entry = &p_sys->lines_cache[ i ];
+    LinesCacheClean( p_entry );
+
+    p_entry->psz_text = psz_text;
+    p_entry->i_text_length = i_text_length;
+    p_entry->pp_styles = pp_styles;
+    p_entry->i_styles = i_styles;
+    p_entry->b_grid = b_grid;
+    p_entry->i_width = p_filter->fmt_out.video.i_width;
+    p_entry->i_height = p_filter->fmt_out.video.i_height;
+    p_entry->p_lines = p_lines;
+    p_entry->bbox = *p_bbox;
+    p_entry->i_max_face_height = i_max_face_height;
+    p_entry->i_last_use = ++p_sys->i_lines_use_count;
+}
+
 /**
  * This function renders a text subpicture region into another one.
  * It also calculates the size needed for this string, and renders the
@@ -999,9 +1103,35 @@ static int Render( filter_t *p_filter, subpicture_region_t *p_region_out,
 
     uint32_t *pi_k_durations   = NULL;
 
-    rv = LayoutText( p_filter,
-                     &p_lines, &bbox, &i_max_face_height,
-                     psz_text, pp_styles, pi_k_durations, i_text_length, p_region_in->b_gridmode );
+    /* The same text is often rendered again (OSD, marquee, ...) */
+    lines_cache_entry_t *p_cached =
+        LinesCacheFind( p_filter, psz_text, i_text_length, pp_styles,
+                        p_region_in->b_gridmode );
+    if( p_cached )
+    {
+        free( psz_text );
+        FreeStylesArray( pp_styles, i_styles );
+        psz_text = NULL;
+        pp_styles = NULL;
+
+        p_lines = p_cached->p_lines;
+        bbox = p_cached->bbox;
+        i_max_face_height = p_cached->i_max_face_height;
+    }
+    else
+    {
+        rv = LayoutText( p_filter,
+                         &p_lines, &bbox, &i_max_face_height,
+                         psz_text, pp_styles, pi_k_durations, i_text_length, p_region_in->b_gridmode );
+        if( !rv )
+        {
+            LinesCachePut( p_filter, psz_text, i_text_length, pp_styles,
+                           i_styles, p_region_in->b_gridmode, p_lines,
+                           &bbox, i_max_face_height );
+            psz_text = NULL;
+            pp_styles = NULL;
+        }
+    }
 
     p_region_out->i_x = p_region_in->i_x;
     p_region_out->i_y = p_region_in->i_y;
@@ -1056,10 +1186,13 @@ static int Render( filter_t *p_filter, subpicture_region_t *p_region_out,
             var_SetBool( p_filter, "text-rerender", true );
     }
 
-    FreeLines( p_lines );
-
+    /* Otherwise, the lines are kept in the cache */
+    if( pp_styles )
+    {
+        FreeLines( p_lines );
+        FreeStylesArray( pp_styles, i_styles );
+    }
     free( psz_text );
-    FreeStylesArray( pp_styles, i_styles );
     free( pi_k_durations );
 
     return rv;
@@ -1239,6 +1372,13 @@ static int Create( vlc_object_t *p_this )
     p_sys->faces_cache.i_cache_size = i_faces_size;
     p_sys->faces_cache.i_faces_count = 0;
 
+    /* Without it, the glyphs are just loaded every time */
+    p_sys->glyphs_cache.p_entries = calloc( GLYPHS_CACHE_SETS * GLYPHS_CACHE_WAYS,
+                                            sizeof( *p_sys->glyphs_cache.p_entries ) );
+    p_sys->glyphs_cache.i_use_count = 0;
+    memset( p_sys->lines_cache, 0, sizeof( p_sys->lines_cache ) );
+    p_sys->i_lines_use_count = 0;
+
     p_sys->pp_font_attachments = NULL;
     p_sys->i_font_attachments = 0;
 
@@ -1283,6 +1423,22 @@ static void Destroy( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
+    for( int i = 0; i < LINES_CACHE_SIZE; ++i )
+        LinesCacheClean( &p_sys->lines_cache[ i ] );
+
+    glyphs_cache_t *p_glyphs = &p_sys->glyphs_cache;
+    for( int i = 0; p_glyphs->p_entries
+                 && i < GLYPHS_CACHE_SETS * GLYPHS_CACHE_WAYS; ++i )
+    {
+        glyphs_cache_entry_t *p_entry = &p_glyphs->p_entries[ i ];
+        if( !p_entry->p_face )
+            continue;
+        FT_Done_Glyph( p_entry->p_glyph );
+        if( p_entry->p_outline )
+            FT_Done_Glyph( p_entry->p_outline );
+    }
+    free( p_glyphs->p_entries );
+
     faces_cache_t *p_cache = &p_sys->faces_cache;
     for( int i = 0; i < p_cache->i_faces_count; ++i )
     {
@@ -1354,6 +1510,90 @@ static FT_Face LoadEmbeddedFace( filter_sys_t *p_sys, const char *psz_fontname,
     return NULL;
 }
 
+static glyphs_cache_entry_t *GlyphsCacheSet( glyphs_cache_t *p_cache,
+                                             FT_Face p_face, int i_glyph_index )
+{
+    uintptr_t i_hash = ( (uintptr_t)p_face >> 4 ) ^ ( i_glyph_index * 2654435761u );
+    return p_cache->p_entries
+         + ( i_hash % GLYPHS_CACHE_SETS ) * GLYPHS_CACHE_WAYS;
+}
+
+int GetCachedGlyph( filter_t *p_filter, FT_Face p_face, int i_glyph_index,
+                    int i_style_flags, int i_outline_radius,
+                    FT_Glyph *pp_glyph, FT_Glyph *pp_outline,
+                    FT_Vector *p_advance )
+{
+    glyphs_cache_t *p_cache = &p_filter->p_sys->glyphs_cache;
+    if( !p_cache->p_entries )
+        return VLC_EGENERIC;
+
+    glyphs_cache_entry_t *p_set = GlyphsCacheSet( p_cache, p_face, i_glyph_index );
+    for( int i = 0; i < GLYPHS_CACHE_WAYS; ++i )
+    {
+        glyphs_cache_entry_t *p_entry = &p_set[ i ];
+        if( p_entry->p_face != p_face
+         || p_entry->i_glyph_index != i_glyph_index
+         || p_entry->i_style_flags != i_style_flags
+         || p_entry->i_outline_radius != i_outline_radius )
+            continue;
+
+        /* The layout renders the glyphs in place, hand out copies */
+        if( FT_Glyph_Copy( p_entry->p_glyph, pp_glyph ) )
+            return VLC_ENOMEM;
+        *pp_outline = 0;
+        if( p_entry->p_outline
+         && FT_Glyph_Copy( p_entry->p_outline, pp_outline ) )
+        {
+            FT_Done_Glyph( *pp_glyph );
+            return VLC_ENOMEM;
+        }
+        *p_advance = p_entry->advance;
+        p_entry->i_last_use = ++p_cache->i_use_count;
+        return VLC_SUCCESS;
+    }
+    return VLC_EGENERIC;
+}
+
+void PutCachedGlyph( filter_t *p_filter, FT_Face p_face, int i_glyph_index,
+                     int i_style_flags, int i_outline_radius,
+                     FT_Glyph p_glyph, FT_Glyph p_outline,
+                     const FT_Vector *p_advance )
+{
+    glyphs_cache_t *p_cache = &p_filter->p_sys->glyphs_cache;
+    if( !p_cache->p_entries )
+        return;
+
+    glyphs_cache_entry_t *p_set = GlyphsCacheSet( p_cache, p_face, i_glyph_index );
+    glyphs_cache_entry_t *p_entry = &p_set[ 0 ];
+    for( int i = 1; i < GLYPHS_CACHE_WAYS && p_entry->p_face; ++i )
+        if( !p_set[ i ].p_face || p_set[ i ].i_last_use < p_entry->i_last_use )
+            p_entry = &p_set[ i ];
+
+    FT_Glyph p_glyph_copy, p_outline_copy = 0;
+    if( FT_Glyph_Copy( p_glyph, &p_glyph_copy ) )
+        return;
+    if( p_outline && FT_Glyph_Copy( p_outline, &p_outline_copy ) )
+    {
+        FT_Done_Glyph( p_glyph_copy );
+        return;
+    }
+
+    if( p_entry->p_face )
+    {
+        FT_Done_Glyph( p_entry->p_glyph );
+        if( p_entry->p_outline )
+            FT_Done_Glyph( p_entry->p_outline );
+    }
+    p_entry->p_face = p_face;
+    p_entry->i_glyph_index = i_glyph_index;
+    p_entry->i_style_flags = i_style_flags;
+    p_entry->i_outline_radius = i_outline_radius;
+    p_entry->p_glyph = p_glyph_copy;
+    p_entry->p_outline = p_outline_copy;
+    p_entry->advance = *p_advance;
+    p_entry->i_last_use = ++p_cache->i_use_count;
+}
+
 int ConvertToLiveSize( filter_t *p_filter, const text_style_t *p_style )
 {
     int i_font_size = STYLE_DEFAULT_FONT_SIZE;
@@ -30,6 +30,18 @@
 
 #include <vlc_text_style.h>                                   /* text_style_t*/
 
+#ifdef __OS2__
+typedef uint16_t uni_char_t;
+# define FREETYPE_TO_UCS    "UCS-2LE"
+#else
+typedef uint32_t uni_char_t;
+# if defined(WORDS_BIGENDIAN)
+#  define FREETYPE_TO_UCS   "UCS-4BE"
+# else
+#  define FREETYPE_TO_UCS   "UCS-4LE"
+# endif
+#endif
+
 typedef struct faces_cache_t
 {
     FT_Face        *p_faces;
@@ -38,6 +50,46 @@ typedef struct faces_cache_t
     int            i_cache_size;
 } faces_cache_t;
 
+/* Loaded glyphs, in sets of GLYPHS_CACHE_WAYS least recently used first out */
+#define GLYPHS_CACHE_SETS 256
+#define GLYPHS_CACHE_WAYS 4
+
+typedef struct glyphs_cache_entry_t
+{
+    FT_Face        p_face;      /* NULL if unused */
+    int            i_glyph_index;
+    int            i_style_flags;
+    int            i_outline_radius;
+    FT_Glyph       p_glyph;
+    FT_Glyph       p_outline;
+    FT_Vector      advance;
+    unsigned       i_last_use;
+} glyphs_cache_entry_t;
+
+typedef struct glyphs_cache_t
+{
+    glyphs_cache_entry_t *p_entries;
+    unsigned       i_use_count;
+} glyphs_cache_t;
+
+/* Laid out texts, least recently used first out */
+#define LINES_CACHE_SIZE 4
+
+typedef struct lines_cache_entry_t
+{
+    uni_char_t     *psz_text;   /* NULL if unused */
+    size_t         i_text_length;
+    text_style_t   **pp_styles; /* referenced by the lines */
+    size_t         i_styles;
+    bool           b_grid;
+    unsigned       i_width;     /* of the output */
+    unsigned       i_height;
+    struct line_desc_t *p_lines;
+    FT_BBox        bbox;
+    int            i_max_face_height;
+    unsigned       i_last_use;
+} lines_cache_entry_t;
+
 /*****************************************************************************
  * filter_sys_t: freetype local data
  *****************************************************************************
@@ -64,6 +116,11 @@ struct filter_sys_t
     /* Font faces cache */
     faces_cache_t  faces_cache;
 
+    /* Glyphs and layouts caches */
+    glyphs_cache_t glyphs_cache;
+    lines_cache_entry_t lines_cache[LINES_CACHE_SIZE];
+    unsigned       i_lines_use_count;
+
     char * (*pf_select) (filter_t *, const char* family,
                                bool bold, bool italic, int size,
                                int *index);
@@ -76,22 +133,19 @@ struct filter_sys_t
  #define FT_MulFix(v, s) (((v)*(s))>>16)
 #endif
 
-#ifdef __OS2__
-typedef uint16_t uni_char_t;
-# define FREETYPE_TO_UCS    "UCS-2LE"
-#else
-typedef uint32_t uni_char_t;
-# if defined(WORDS_BIGENDIAN)
-#  define FREETYPE_TO_UCS   "UCS-4BE"
-# else
-#  define FREETYPE_TO_UCS   "UCS-4LE"
-# endif
-#endif
-
 
 FT_Face LoadFace( filter_t *p_filter, const text_style_t *p_style, int );
 int ConvertToLiveSize( filter_t *p_filter, const text_style_t *p_style );
 
+int GetCachedGlyph( filter_t *p_filter, FT_Face p_face, int i_glyph_index,
+                    int i_style_flags, int i_outline_radius,
+                    FT_Glyph *pp_glyph, FT_Glyph *pp_outline,
+                    FT_Vector *p_advance );
+void PutCachedGlyph( filter_t *p_filter, FT_Face p_face, int i_glyph_index,
+                     int i_style_flags, int i_outline_radius,
+                     FT_Glyph p_glyph, FT_Glyph p_outline,
+                     const FT_Vector *p_advance );
+
 bool FaceStyleEquals( const text_style_t *p_style1,
                       const text_style_t *p_style2 );
 
@@ -798,12 +798,13 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         else
             p_face = p_run->p_face;
 
+        int i_radius = 0;
         if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
         {
             double f_outline_thickness =
                 var_InheritInteger( p_filter, "freetype-outline-thickness" ) / 100.0;
             f_outline_thickness = VLC_CLIP( f_outline_thickness, 0.0, 0.5 );
-            int i_radius = ( i_live_size << 6 ) * f_outline_thickness;
+            i_radius = ( i_live_size << 6 ) * f_outline_thickness;
             FT_Stroker_Set( p_sys->p_stroker,
                             i_radius,
                             FT_STROKER_LINECAP_ROUND,
@@ -821,6 +822,26 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
 
             glyph_bitmaps_t *p_bitmaps = p_paragraph->p_glyph_bitmaps + j;
 
+            /* Loading, emboldening and stroking are done once per glyph */
+            const int i_cache_flags = p_style->i_style_flags
+                                    & ( STYLE_BOLD | STYLE_ITALIC | STYLE_OUTLINE );
+            FT_Vector advance;
+            if( !GetCachedGlyph( p_filter, p_face, i_glyph_index, i_cache_flags,
+                                 i_radius, &p_bitmaps->p_glyph,
+                                 &p_bitmaps->p_outline, &advance ) )
+            {
+                if( p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
+                    p_bitmaps->p_shadow = p_bitmaps->p_outline ?
+                                          p_bitmaps->p_outline : p_bitmaps->p_glyph;
+
+                if( b_overwrite_advance )
+                {
+                    p_bitmaps->i_x_advance = advance.x;
+                    p_bitmaps->i_y_advance = advance.y;
+                }
+                continue;
+            }
+
             if( FT_Load_Glyph( p_face, i_glyph_index,
                                FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
              && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
@@ -858,6 +879,10 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                     p_bitmaps->p_outline = 0;
             }
 
+            PutCachedGlyph( p_filter, p_face, i_glyph_index, i_cache_flags,
+                            i_radius, p_bitmaps->p_glyph, p_bitmaps->p_outline,
+                            &p_face->glyph->advance );
+
             if( p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
                 p_bitmaps->p_shadow = p_bitmaps->p_outline ?
                                       p_bitmaps->p_outline : p_bitmaps->p_glyph;
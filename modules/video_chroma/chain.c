@@ -29,6 +29,8 @@
 # include "config.h"
 #endif
 
+#include <stdlib.h>
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
@@ -63,11 +65,86 @@ static void EsFormatMergeSize( es_format_t *p_dst,
 static const vlc_fourcc_t pi_allowed_chromas[] = {
     VLC_CODEC_I420,
     VLC_CODEC_I422,
+    VLC_CODEC_I444,
     VLC_CODEC_RGB32,
     VLC_CODEC_RGB24,
     0
 };
 
+/*****************************************************************************
+ * Cost model
+ *****************************************************************************
+ * Converters are assumed to be memory bound: the cost of a step is
+ * estimated from the number of bytes read and written per pixel, in sixteenth
+ * of bytes, plus a fixed cost for the matrix between YUV and RGB.
+ * Intermediate formats with less chroma resolution than both ends are
+ * heavily penalised, as they lose quality.
+ *****************************************************************************/
+#define COST_MATRIX  64
+#define COST_QUALITY 1024
+
+static unsigned ChromaSize( vlc_fourcc_t i_chroma )
+{
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( i_chroma );
+    if( p_dsc == NULL )
+        return 4 * 16;
+
+    unsigned i_size = 0;
+    for( unsigned i = 0; i < p_dsc->plane_count; i++ )
+        i_size += 16 * p_dsc->pixel_size * p_dsc->p[i].w.num * p_dsc->p[i].h.num
+                / ( p_dsc->p[i].w.den * p_dsc->p[i].h.den );
+    return i_size;
+}
+
+/* Chroma samples per 4 pixels */
+static unsigned ChromaResolution( vlc_fourcc_t i_chroma )
+{
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( i_chroma );
+    if( p_dsc == NULL || p_dsc->plane_count < 3 || !vlc_fourcc_IsYUV( i_chroma ) )
+        return 4;
+    return 4 * p_dsc->p[1].w.num * p_dsc->p[1].h.num
+             / ( p_dsc->p[1].w.den * p_dsc->p[1].h.den );
+}
+
+static unsigned StepCost( vlc_fourcc_t i_src, vlc_fourcc_t i_dst )
+{
+    unsigned i_cost = ChromaSize( i_src ) + ChromaSize( i_dst );
+
+    if( vlc_fourcc_IsYUV( i_src ) != vlc_fourcc_IsYUV( i_dst ) )
+        i_cost += COST_MATRIX;
+    return i_cost;
+}
+
+static unsigned MiddleCost( vlc_fourcc_t i_src, vlc_fourcc_t i_mid,
+                            vlc_fourcc_t i_dst )
+{
+    unsigned i_cost = StepCost( i_src, i_mid ) + StepCost( i_mid, i_dst );
+    unsigned i_res = ChromaResolution( i_mid );
+
+    if( i_res < ChromaResolution( i_src ) && i_res < ChromaResolution( i_dst ) )
+        i_cost += COST_QUALITY;
+    return i_cost;
+}
+
+typedef struct
+{
+    vlc_fourcc_t i_chroma;
+    unsigned     i_cost;
+    unsigned     i_index; /**< rank in pi_allowed_chromas */
+} chroma_candidate_t;
+
+static int CandidateCmp( const void *a, const void *b )
+{
+    const chroma_candidate_t *p_a = a, *p_b = b;
+
+    if( p_a->i_cost != p_b->i_cost )
+        return ( p_a->i_cost < p_b->i_cost ) ? -1 : 1;
+    /* Keep the order of the list otherwise */
+    return ( p_a->i_index < p_b->i_index ) ? -1 : 1;
+}
+
 struct filter_sys_t
 {
     filter_chain_t *p_chain;
@@ -193,21 +270,37 @@ static int BuildChromaResize( filter_t *p_filter )
     es_format_t fmt_mid;
     int i_ret;
 
-    /* Lets try resizing and then doing the chroma conversion */
-    msg_Dbg( p_filter, "Trying to build resize+chroma" );
-    EsFormatMergeSize( &fmt_mid, &p_filter->fmt_in, &p_filter->fmt_out );
-    i_ret = CreateChain( p_filter, &fmt_mid, NULL );
-    es_format_Clean( &fmt_mid );
-    if( i_ret == VLC_SUCCESS )
-        return VLC_SUCCESS;
-
-    /* Lets try it the other way arround (chroma and then resize) */
-    msg_Dbg( p_filter, "Trying to build chroma+resize" );
-    EsFormatMergeSize( &fmt_mid, &p_filter->fmt_out, &p_filter->fmt_in );
-    i_ret = CreateChain( p_filter, &fmt_mid, NULL );
-    es_format_Clean( &fmt_mid );
-    if( i_ret == VLC_SUCCESS )
-        return VLC_SUCCESS;
+    /* Converting the chroma is cheaper on the smaller picture, while scaling
+     * is cheaper in the smaller chroma: estimate both orders. */
+    const video_format_t *p_in = &p_filter->fmt_in.video;
+    const video_format_t *p_out = &p_filter->fmt_out.video;
+    const uint64_t i_in = (uint64_t)p_in->i_width * p_in->i_height;
+    const uint64_t i_out = (uint64_t)p_out->i_width * p_out->i_height;
+    const uint64_t i_step = StepCost( p_in->i_chroma, p_out->i_chroma );
+    const uint64_t i_resize_first = ChromaSize( p_in->i_chroma ) * ( i_in + i_out )
+                                  + i_step * i_out;
+    const uint64_t i_chroma_first = i_step * i_in
+                                  + ChromaSize( p_out->i_chroma ) * ( i_in + i_out );
+
+    for( int i = 0; i < 2; i++ )
+    {
+        if( ( i == 0 ) == ( i_resize_first <= i_chroma_first ) )
+        {
+            /* Lets try resizing and then doing the chroma conversion */
+            msg_Dbg( p_filter, "Trying to build resize+chroma" );
+            EsFormatMergeSize( &fmt_mid, &p_filter->fmt_in, &p_filter->fmt_out );
+        }
+        else
+        {
+            /* Lets try the chroma conversion and then resizing */
+            msg_Dbg( p_filter, "Trying to build chroma+resize" );
+            EsFormatMergeSize( &fmt_mid, &p_filter->fmt_out, &p_filter->fmt_in );
+        }
+        i_ret = CreateChain( p_filter, &fmt_mid, NULL );
+        es_format_Clean( &fmt_mid );
+        if( i_ret == VLC_SUCCESS )
+            return VLC_SUCCESS;
+    }
 
     return VLC_EGENERIC;
 }
@@ -245,7 +338,10 @@ static int BuildChromaChain( filter_t *p_filter )
     if( !cfg_level.psz_name || !cfg_level.psz_value )
         goto exit;
 
-    /* Now try chroma format list */
+    /* Now try chroma format list, cheapest conversions first */
+    chroma_candidate_t candidates[ARRAY_SIZE(pi_allowed_chromas)];
+    size_t i_candidates = 0;
+
     for( int i = 0; pi_allowed_chromas[i]; i++ )
     {
         const vlc_fourcc_t i_chroma = pi_allowed_chromas[i];
@@ -253,8 +349,21 @@ static int BuildChromaChain( filter_t *p_filter )
             i_chroma == p_filter->fmt_out.i_codec )
             continue;
 
-        msg_Dbg( p_filter, "Trying to use chroma %4.4s as middle man",
-                 (char*)&i_chroma );
+        candidates[i_candidates].i_chroma = i_chroma;
+        candidates[i_candidates].i_index = i;
+        candidates[i_candidates].i_cost =
+            MiddleCost( p_filter->fmt_in.i_codec, i_chroma,
+                        p_filter->fmt_out.i_codec );
+        i_candidates++;
+    }
+    qsort( candidates, i_candidates, sizeof( *candidates ), CandidateCmp );
+
+    for( size_t i = 0; i < i_candidates; i++ )
+    {
+        const vlc_fourcc_t i_chroma = candidates[i].i_chroma;
+
+        msg_Dbg( p_filter, "Trying to use chroma %4.4s as middle man "
+                 "(cost %u)", (char*)&i_chroma, candidates[i].i_cost );
 
         es_format_Copy( &fmt_mid, &p_filter->fmt_in );
         fmt_mid.i_codec        =
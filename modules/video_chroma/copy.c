@@ -28,19 +28,40 @@
 #include <vlc_common.h>
 #include <vlc_picture.h>
 #include <vlc_cpu.h>
+#include <vlc_filter.h>
 #include <assert.h>
 
 #include "copy.h"
 
-int CopyInitCache(copy_cache_t *cache, unsigned width)
+#define COPY_THREADS_MAX 4
+#define COPY_THREADS_MIN_WIDTH 2560 /* frames split among threads (4K, 8K) */
+
+int CopyInitCache(vlc_object_t *obj, copy_cache_t *cache, unsigned width)
 {
 #ifdef CAN_COMPILE_SSE2
+    /* The workers are started once, rather than for every frame */
+    cache->threads = 1;
+    cache->slices = NULL;
+    if (width >= COPY_THREADS_MIN_WIDTH) {
+        unsigned threads = __MIN(vlc_GetCPUCount(), COPY_THREADS_MAX);
+
+        if (threads > 1)
+            cache->slices = filter_NewSlices(obj, threads);
+        if (cache->slices != NULL)
+            cache->threads = threads;
+    }
+
+    /* One cache slice per thread */
     cache->size = __MAX((width + 0x3f) & ~ 0x3f, 4096);
-    cache->buffer = vlc_memalign(64, cache->size);
-    if (!cache->buffer)
+    cache->buffer = vlc_memalign(64, cache->size * cache->threads);
+    if (!cache->buffer) {
+        if (cache->slices != NULL)
+            filter_DeleteSlices(cache->slices);
+        cache->slices = NULL;
         return VLC_EGENERIC;
+    }
 #else
-    (void) cache; (void) width;
+    (void) obj; (void) cache; (void) width;
 #endif
     return VLC_SUCCESS;
 }
@@ -48,9 +69,13 @@ int CopyInitCache(copy_cache_t *cache, unsigned width)
 void CopyCleanCache(copy_cache_t *cache)
 {
 #ifdef CAN_COMPILE_SSE2
+    if (cache->slices != NULL)
+        filter_DeleteSlices(cache->slices);
     vlc_free(cache->buffer);
-    cache->buffer = NULL;
-    cache->size   = 0;
+    cache->buffer  = NULL;
+    cache->size    = 0;
+    cache->threads = 0;
+    cache->slices  = NULL;
 #else
     (void) cache;
 #endif
@@ -78,6 +103,32 @@ void CopyCleanCache(copy_cache_t *cache)
         store " %%xmm4,   48(%[dst])\n" \
         : : [dst]"r"(dstp), [src]"r"(srcp) : "memory", "xmm1", "xmm2", "xmm3", "xmm4")
 
+#ifdef CAN_COMPILE_AVX2
+/* Same as above with the AVX2 instruction load and store, 32/128 bytes */
+#define COPY32(dstp, srcp, load, store) \
+    asm volatile (                      \
+        load "  0(%[src]), %%ymm1\n"    \
+        store " %%ymm1,    0(%[dst])\n" \
+        : : [dst]"r"(dstp), [src]"r"(srcp) : "memory", "xmm1")
+
+#define COPY128(dstp, srcp, load, store) \
+    asm volatile (                      \
+        load "  0(%[src]), %%ymm1\n"    \
+        load " 32(%[src]), %%ymm2\n"    \
+        load " 64(%[src]), %%ymm3\n"    \
+        load " 96(%[src]), %%ymm4\n"    \
+        store " %%ymm1,    0(%[dst])\n" \
+        store " %%ymm2,   32(%[dst])\n" \
+        store " %%ymm3,   64(%[dst])\n" \
+        store " %%ymm4,   96(%[dst])\n" \
+        : : [dst]"r"(dstp), [src]"r"(srcp) : "memory", "xmm1", "xmm2", "xmm3", "xmm4")
+#endif
+
+#ifndef __AVX2__
+# undef vlc_CPU_AVX2
+# define vlc_CPU_AVX2() ((cpu & VLC_CPU_AVX2) != 0)
+#endif
+
 #ifndef __SSE4_1__
 # undef vlc_CPU_SSE4_1
 # define vlc_CPU_SSE4_1() ((cpu & VLC_CPU_SSE4_1) != 0)
@@ -261,27 +312,146 @@ static void SSE_SplitUV(uint8_t *dstu, size_t dstu_pitch,
     }
 }
 
+#ifdef CAN_COMPILE_AVX2
+/* AVX2 version of CopyFromUswc(), the 32 bytes streaming load (vmovntdqa)
+ * needs AVX2. */
+static void AVX2_CopyFromUswc(uint8_t *dst, size_t dst_pitch,
+                              const uint8_t *src, size_t src_pitch,
+                              unsigned width, unsigned height)
+{
+    assert(((intptr_t)dst & 0x1f) == 0 && (dst_pitch & 0x1f) == 0);
+
+    asm volatile ("mfence");
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        if (width >= 128) {
+            const unsigned unaligned = (-(uintptr_t)src) & 0x1f;
+
+            x = unaligned;
+            if (!unaligned) {
+                for (; x+127 < width; x += 128)
+                    COPY128(&dst[x], &src[x], "vmovntdqa", "vmovdqa");
+            } else {
+                COPY32(dst, src, "vmovdqu", "vmovdqa");
+                for (; x+127 < width; x += 128)
+                    COPY128(&dst[x], &src[x], "vmovntdqa", "vmovdqu");
+            }
+        }
+
+        for (; x < width; x++)
+            dst[x] = src[x];
+
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+    asm volatile ("mfence\n" "vzeroupper");
+}
+
+/* AVX2 version of Copy2d(), with non-temporal stores to the destination */
+static void AVX2_Copy2d(uint8_t *dst, size_t dst_pitch,
+                        const uint8_t *src, size_t src_pitch,
+                        unsigned width, unsigned height)
+{
+    assert(((intptr_t)src & 0x1f) == 0 && (src_pitch & 0x1f) == 0);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        bool unaligned = ((intptr_t)dst & 0x1f) != 0;
+        if (!unaligned) {
+            for (; x+127 < width; x += 128)
+                COPY128(&dst[x], &src[x], "vmovdqa", "vmovntdq");
+        } else {
+            for (; x+127 < width; x += 128)
+                COPY128(&dst[x], &src[x], "vmovdqa", "vmovdqu");
+        }
+
+        for (; x < width; x++)
+            dst[x] = src[x];
+
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+    asm volatile ("sfence\n" "vzeroupper");
+}
+
+static void AVX2_SplitUV(uint8_t *dstu, size_t dstu_pitch,
+                         uint8_t *dstv, size_t dstv_pitch,
+                         const uint8_t *src, size_t src_pitch,
+                         unsigned width, unsigned height)
+{
+    const uint8_t shuffle[] = { 0, 2, 4, 6, 8, 10, 12, 14,
+                                1, 3, 5, 7, 9, 11, 13, 15,
+                                0, 2, 4, 6, 8, 10, 12, 14,
+                                1, 3, 5, 7, 9, 11, 13, 15 };
+
+    assert(((intptr_t)src & 0x1f) == 0 && (src_pitch & 0x1f) == 0);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x;
+
+        /* Deinterleave within each lane, then gather the lanes */
+        for (x = 0; x < (width & ~31); x += 32) {
+            asm volatile (
+                "vmovdqu (%[shuffle]), %%ymm7\n"
+                "vmovdqa  0(%[src]), %%ymm0\n"
+                "vmovdqa 32(%[src]), %%ymm1\n"
+                "vpshufb %%ymm7, %%ymm0, %%ymm0\n"
+                "vpshufb %%ymm7, %%ymm1, %%ymm1\n"
+                "vpermq  $0xd8, %%ymm0, %%ymm0\n"
+                "vpermq  $0xd8, %%ymm1, %%ymm1\n"
+                "vperm2i128 $0x20, %%ymm1, %%ymm0, %%ymm2\n"
+                "vperm2i128 $0x31, %%ymm1, %%ymm0, %%ymm3\n"
+                "vmovdqu %%ymm2, (%[dst1])\n"
+                "vmovdqu %%ymm3, (%[dst2])\n"
+                : : [dst1]"r"(&dstu[x]), [dst2]"r"(&dstv[x]), [src]"r"(&src[2*x]), [shuffle]"r"(shuffle) : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm7");
+        }
+
+        for (; x < width; x++) {
+            dstu[x] = src[2*x+0];
+            dstv[x] = src[2*x+1];
+        }
+        src  += src_pitch;
+        dstu += dstu_pitch;
+        dstv += dstv_pitch;
+    }
+    asm volatile ("vzeroupper");
+}
+#undef COPY128
+#undef COPY32
+#endif /* CAN_COMPILE_AVX2 */
+
 static void SSE_CopyPlane(uint8_t *dst, size_t dst_pitch,
                           const uint8_t *src, size_t src_pitch,
                           uint8_t *cache, size_t cache_size,
                           unsigned width, unsigned height, unsigned cpu)
 {
-    const unsigned w16 = (width+15) & ~15;
-    const unsigned hstep = cache_size / w16;
+    const unsigned w32 = (width+31) & ~31;
+    const unsigned hstep = cache_size / w32;
     assert(hstep > 0);
 
     for (unsigned y = 0; y < height; y += hstep) {
         const unsigned hblock =  __MIN(hstep, height - y);
 
-        /* Copy a bunch of line into our cache */
-        CopyFromUswc(cache, w16,
-                     src, src_pitch,
-                     width, hblock, cpu);
-
-        /* Copy from our cache to the destination */
-        Copy2d(dst, dst_pitch,
-               cache, w16,
-               width, hblock);
+#ifdef CAN_COMPILE_AVX2
+        if (vlc_CPU_AVX2()) {
+            AVX2_CopyFromUswc(cache, w32, src, src_pitch, width, hblock);
+            AVX2_Copy2d(dst, dst_pitch, cache, w32, width, hblock);
+        } else
+#endif
+        {
+            /* Copy a bunch of line into our cache */
+            CopyFromUswc(cache, w32,
+                         src, src_pitch,
+                         width, hblock, cpu);
+
+            /* Copy from our cache to the destination */
+            Copy2d(dst, dst_pitch,
+                   cache, w32,
+                   width, hblock);
+        }
 
         /* */
         src += src_pitch * hblock;
@@ -295,20 +465,29 @@ static void SSE_SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
                             uint8_t *cache, size_t cache_size,
                             unsigned width, unsigned height, unsigned cpu)
 {
-    const unsigned w16 = (2*width+15) & ~15;
-    const unsigned hstep = cache_size / w16;
+    const unsigned w32 = (2*width+31) & ~31;
+    const unsigned hstep = cache_size / w32;
     assert(hstep > 0);
 
     for (unsigned y = 0; y < height; y += hstep) {
         const unsigned hblock =  __MIN(hstep, height - y);
 
-        /* Copy a bunch of line into our cache */
-        CopyFromUswc(cache, w16, src, src_pitch,
-                     2*width, hblock, cpu);
+#ifdef CAN_COMPILE_AVX2
+        if (vlc_CPU_AVX2()) {
+            AVX2_CopyFromUswc(cache, w32, src, src_pitch, 2*width, hblock);
+            AVX2_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
+                         cache, w32, width, hblock);
+        } else
+#endif
+        {
+            /* Copy a bunch of line into our cache */
+            CopyFromUswc(cache, w32, src, src_pitch,
+                         2*width, hblock, cpu);
 
-        /* Copy from our cache to the destination */
-        SSE_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
-                    cache, w16, width, hblock, cpu);
+            /* Copy from our cache to the destination */
+            SSE_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
+                        cache, w32, width, hblock, cpu);
+        }
 
         /* */
         src  += src_pitch  * hblock;
@@ -317,21 +496,82 @@ static void SSE_SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
     }
 }
 
+/* A plane to copy, or to split into two planes if dst[1] is not NULL */
+typedef struct {
+    uint8_t       *dst[2];
+    size_t         dst_pitch[2];
+    const uint8_t *src;
+    size_t         src_pitch;
+    unsigned       width;
+    unsigned       height;
+} copy_plane_t;
+
+/* The planes to copy by horizontal bands, each with its own cache slice */
+typedef struct {
+    const copy_plane_t *planes;
+    unsigned            count;
+    uint8_t            *cache;
+    size_t              cache_size;
+    unsigned            cpu;
+} copy_band_t;
+
+static void SSE_CopyBand(void *data, unsigned band, unsigned bands)
+{
+    const copy_band_t *b = data;
+    uint8_t *cache = b->cache + band * b->cache_size;
+
+    for (unsigned i = 0; i < b->count; i++) {
+        const copy_plane_t *p = &b->planes[i];
+        const unsigned y = p->height *  band      / bands;
+        const unsigned h = p->height * (band + 1) / bands - y;
+
+        if (h == 0)
+            continue;
+        if (p->dst[1] == NULL)
+            SSE_CopyPlane(p->dst[0] + y * p->dst_pitch[0], p->dst_pitch[0],
+                          p->src + y * p->src_pitch, p->src_pitch,
+                          cache, b->cache_size, p->width, h, b->cpu);
+        else
+            SSE_SplitPlanes(p->dst[0] + y * p->dst_pitch[0], p->dst_pitch[0],
+                            p->dst[1] + y * p->dst_pitch[1], p->dst_pitch[1],
+                            p->src + y * p->src_pitch, p->src_pitch,
+                            cache, b->cache_size, p->width, h, b->cpu);
+    }
+    asm volatile ("emms");
+}
+
+/* Large frames are split in as many bands as the cache has slices, and
+ * copied by the slice workers of the cache and the calling thread. */
+static void SSE_CopyPlanes(const copy_plane_t *planes, unsigned count,
+                           copy_cache_t *cache, unsigned cpu)
+{
+    copy_band_t band = {
+        .planes     = planes,
+        .count      = count,
+        .cache      = cache->buffer,
+        .cache_size = cache->size,
+        .cpu        = cpu,
+    };
+
+    if (cache->slices != NULL)
+        filter_RunTasks(cache->slices, cache->threads, SSE_CopyBand, &band);
+    else
+        SSE_CopyBand(&band, 0, 1);
+}
+
 static void SSE_CopyFromNv12(picture_t *dst,
                              uint8_t *src[2], size_t src_pitch[2],
                              unsigned width, unsigned height,
                              copy_cache_t *cache, unsigned cpu)
 {
-    SSE_CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
-                  src[0], src_pitch[0],
-                  cache->buffer, cache->size,
-                  width, height, cpu);
-    SSE_SplitPlanes(dst->p[2].p_pixels, dst->p[2].i_pitch,
-                    dst->p[1].p_pixels, dst->p[1].i_pitch,
-                    src[1], src_pitch[1],
-                    cache->buffer, cache->size,
-                    (width+1)/2, (height+1)/2, cpu);
-    asm volatile ("emms");
+    const copy_plane_t planes[] = {
+        { { dst->p[0].p_pixels, NULL }, { dst->p[0].i_pitch, 0 },
+          src[0], src_pitch[0], width, height },
+        { { dst->p[2].p_pixels, dst->p[1].p_pixels },
+          { dst->p[2].i_pitch, dst->p[1].i_pitch },
+          src[1], src_pitch[1], (width+1)/2, (height+1)/2 },
+    };
+    SSE_CopyPlanes(planes, 2, cache, cpu);
 }
 
 static void SSE_CopyFromYv12(picture_t *dst,
@@ -339,14 +579,15 @@ static void SSE_CopyFromYv12(picture_t *dst,
                              unsigned width, unsigned height,
                              copy_cache_t *cache, unsigned cpu)
 {
+    copy_plane_t planes[3];
+
     for (unsigned n = 0; n < 3; n++) {
         const unsigned d = n > 0 ? 2 : 1;
-        SSE_CopyPlane(dst->p[n].p_pixels, dst->p[n].i_pitch,
-                      src[n], src_pitch[n],
-                      cache->buffer, cache->size,
-                      (width+d-1)/d, (height+d-1)/d, cpu);
+        planes[n] = (copy_plane_t) {
+            { dst->p[n].p_pixels, NULL }, { dst->p[n].i_pitch, 0 },
+            src[n], src_pitch[n], (width+d-1)/d, (height+d-1)/d };
     }
-    asm volatile ("emms");
+    SSE_CopyPlanes(planes, 3, cache, cpu);
 }
 
 
@@ -355,15 +596,13 @@ static void SSE_CopyFromNv12ToNv12(picture_t *dst,
                              unsigned width, unsigned height,
                              copy_cache_t *cache, unsigned cpu)
 {
-    SSE_CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
-                  src[0], src_pitch[0],
-                  cache->buffer, cache->size,
-                  width, height, cpu);
-    SSE_CopyPlane(dst->p[1].p_pixels, dst->p[1].i_pitch,
-                  src[1], src_pitch[1],
-                  cache->buffer, cache->size,
-                  width, height/2, cpu);
-    asm volatile ("emms");
+    const copy_plane_t planes[] = {
+        { { dst->p[0].p_pixels, NULL }, { dst->p[0].i_pitch, 0 },
+          src[0], src_pitch[0], width, height },
+        { { dst->p[1].p_pixels, NULL }, { dst->p[1].i_pitch, 0 },
+          src[1], src_pitch[1], width, height/2 },
+    };
+    SSE_CopyPlanes(planes, 2, cache, cpu);
 }
 #undef COPY64
 #endif /* CAN_COMPILE_SSE2 */
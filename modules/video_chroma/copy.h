@@ -28,10 +28,12 @@ typedef struct {
 # ifdef CAN_COMPILE_SSE2
     uint8_t *buffer;
     size_t  size;
+    unsigned threads; /* number of cache slices of the given size */
+    struct filter_slices_t *slices; /* workers for large frames, or NULL */
 # endif
 } copy_cache_t;
 
-int  CopyInitCache(copy_cache_t *cache, unsigned width);
+int  CopyInitCache(vlc_object_t *obj, copy_cache_t *cache, unsigned width);
 void CopyCleanCache(copy_cache_t *cache);
 
 /* Copy planes from NV12 to YV12 */
@@ -120,6 +120,19 @@ static int Activate( vlc_object_t *p_this )
 
     switch( p_filter->fmt_in.video.i_chroma )
     {
+#if defined (SSE2) && defined (CAN_COMPILE_AVX2)
+        case VLC_CODEC_J420:
+            /* Full range is only handled by the AVX2 RV32 conversions,
+             * which do not scale */
+            if( !vlc_CPU_AVX2()
+             || p_filter->fmt_out.video.i_chroma != VLC_CODEC_RGB32
+             || p_filter->fmt_in.video.i_width
+                    != p_filter->fmt_out.video.i_width
+             || p_filter->fmt_in.video.i_height
+                    != p_filter->fmt_out.video.i_height )
+                return VLC_EGENERIC;
+#endif
+            /* fall through */
         case VLC_CODEC_YV12:
         case VLC_CODEC_I420:
             switch( p_filter->fmt_out.video.i_chroma )
@@ -72,6 +72,21 @@ void I420_B8G8R8A8     ( filter_t *, picture_t *, picture_t * );
 void I420_A8B8G8R8     ( filter_t *, picture_t *, picture_t * );
 #endif
 
+#if defined (SSE2) && defined (CAN_COMPILE_AVX2)
+typedef enum
+{
+    AVX2_A8R8G8B8,
+    AVX2_R8G8B8A8,
+    AVX2_B8G8R8A8,
+    AVX2_A8B8G8R8,
+} i420_avx2_order_t;
+
+/* Converts a picture if AVX2 is available and there is no scaling.
+ * Returns false if the picture was not converted. */
+bool I420_RGB32_AVX2   ( filter_t *, picture_t *, picture_t *,
+                         i420_avx2_order_t );
+#endif
+
 /*****************************************************************************
  * CONVERT_*_PIXEL: pixel conversion macros
  *****************************************************************************
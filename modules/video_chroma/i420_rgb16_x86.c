@@ -563,6 +563,11 @@ VLC_TARGET
 void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
                                             picture_t *p_dest )
 {
+#if defined (SSE2) && defined (CAN_COMPILE_AVX2)
+    if( I420_RGB32_AVX2( p_filter, p_src, p_dest, AVX2_A8R8G8B8 ) )
+        return;
+#endif
+
     /* We got this one from the old arguments */
     uint32_t *p_pic = (uint32_t*)p_dest->p->p_pixels;
     uint8_t  *p_y   = p_src->Y_PIXELS;
@@ -791,6 +796,11 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
 VLC_TARGET
 void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 {
+#if defined (SSE2) && defined (CAN_COMPILE_AVX2)
+    if( I420_RGB32_AVX2( p_filter, p_src, p_dest, AVX2_R8G8B8A8 ) )
+        return;
+#endif
+
     /* We got this one from the old arguments */
     uint32_t *p_pic = (uint32_t*)p_dest->p->p_pixels;
     uint8_t  *p_y   = p_src->Y_PIXELS;
@@ -1019,6 +1029,11 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 VLC_TARGET
 void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 {
+#if defined (SSE2) && defined (CAN_COMPILE_AVX2)
+    if( I420_RGB32_AVX2( p_filter, p_src, p_dest, AVX2_B8G8R8A8 ) )
+        return;
+#endif
+
     /* We got this one from the old arguments */
     uint32_t *p_pic = (uint32_t*)p_dest->p->p_pixels;
     uint8_t  *p_y   = p_src->Y_PIXELS;
@@ -1244,6 +1259,11 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 VLC_TARGET
 void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 {
+#if defined (SSE2) && defined (CAN_COMPILE_AVX2)
+    if( I420_RGB32_AVX2( p_filter, p_src, p_dest, AVX2_A8B8G8R8 ) )
+        return;
+#endif
+
     /* We got this one from the old arguments */
     uint32_t *p_pic = (uint32_t*)p_dest->p->p_pixels;
     uint8_t  *p_y   = p_src->Y_PIXELS;
@@ -0,0 +1,198 @@
+/*****************************************************************************
+ * i420_rgb_avx2.c : YUV to 32 bits RGB conversion using AVX2 intrinsics
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_cpu.h>
+
+#include "i420_rgb.h"
+
+#ifdef CAN_COMPILE_AVX2
+#include <immintrin.h>
+
+#define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+
+/* The arithmetic is the same as that of the SSE2 and MMX versions: the
+ * samples are promoted to 16-bits with 3 fractional bits, and multiplied by
+ * coefficients with 13 fractional bits, keeping the upper 16-bits. */
+typedef struct
+{
+    int16_t y_offset;
+    int16_t y;
+    int16_t cb_blue, cb_green;
+    int16_t cr_red, cr_green;
+} yuv2rgb_coeffs_t;
+
+/** ITU-R BT.601, video range (as in the other versions) */
+static const yuv2rgb_coeffs_t coeffs_601_video = {
+    16, 0x253f, 0x4093, -0x0c83, 0x3312, -0x1a04,
+};
+
+/** ITU-R BT.601, full range (as in JPEG) */
+static const yuv2rgb_coeffs_t coeffs_601_full = {
+    0, 0x2000, 0x38b4, -0x0b03, 0x2cdd, -0x16da,
+};
+
+/* Component indices, and the byte order of each pixel in memory */
+enum { R, G, B, A };
+#define ORDER(c0, c1, c2, c3) ((c0) | ((c1) << 2) | ((c2) << 4) | ((c3) << 6))
+
+static inline unsigned Order( i420_avx2_order_t order )
+{
+    switch( order )
+    {
+        case AVX2_A8R8G8B8: return ORDER(B, G, R, A);
+        case AVX2_R8G8B8A8: return ORDER(A, B, G, R);
+        case AVX2_B8G8R8A8: return ORDER(A, R, G, B);
+        case AVX2_A8B8G8R8: return ORDER(R, G, B, A);
+    }
+    vlc_assert_unreachable();
+}
+
+static inline uint8_t Clip( int v )
+{
+    return (v < 0) ? 0 : (v > 255) ? 255 : v;
+}
+
+/* Converts one pixel the same way as the vector code. */
+static inline void ConvertPixel( uint8_t *dst, int y, int u, int v,
+                                 const yuv2rgb_coeffs_t *c, unsigned order )
+{
+    int l = y - c->y_offset;
+
+    l = ((l < 0 ? 0 : l) * 8 * c->y) >> 16;
+    u = (u - 128) * 8;
+    v = (v - 128) * 8;
+
+    uint8_t px[4];
+    px[R] = Clip( l + ((v * c->cr_red) >> 16) );
+    px[G] = Clip( l + ((u * c->cb_green) >> 16) + ((v * c->cr_green) >> 16) );
+    px[B] = Clip( l + ((u * c->cb_blue) >> 16) );
+    px[A] = 0;
+
+    for( unsigned i = 0; i < 4; i++ )
+        dst[i] = px[(order >> (2 * i)) & 3];
+}
+
+/* Converts 16 pixels. */
+VLC_AVX2
+static inline void Convert16( uint8_t *dst, const uint8_t *p_y,
+                              const uint8_t *p_u, const uint8_t *p_v,
+                              const yuv2rgb_coeffs_t *c, unsigned order )
+{
+    __m256i y = _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)p_y ) );
+    y = _mm256_subs_epu16( y, _mm256_set1_epi16( c->y_offset ) );
+    y = _mm256_mulhi_epi16( _mm256_slli_epi16( y, 3 ),
+                            _mm256_set1_epi16( c->y ) );
+
+    /* Each chroma sample covers two pixels */
+    __m128i u8 = _mm_cvtepu8_epi16( _mm_loadl_epi64( (const __m128i *)p_u ) );
+    __m128i v8 = _mm_cvtepu8_epi16( _mm_loadl_epi64( (const __m128i *)p_v ) );
+    __m256i u = _mm256_inserti128_si256(
+        _mm256_castsi128_si256( _mm_unpacklo_epi16( u8, u8 ) ),
+        _mm_unpackhi_epi16( u8, u8 ), 1 );
+    __m256i v = _mm256_inserti128_si256(
+        _mm256_castsi128_si256( _mm_unpacklo_epi16( v8, v8 ) ),
+        _mm_unpackhi_epi16( v8, v8 ), 1 );
+    const __m256i bias = _mm256_set1_epi16( 128 );
+
+    u = _mm256_slli_epi16( _mm256_sub_epi16( u, bias ), 3 );
+    v = _mm256_slli_epi16( _mm256_sub_epi16( v, bias ), 3 );
+
+    __m256i px[4];
+    px[R] = _mm256_adds_epi16( y, _mm256_mulhi_epi16( v,
+                                    _mm256_set1_epi16( c->cr_red ) ) );
+    px[G] = _mm256_adds_epi16( y, _mm256_adds_epi16(
+                _mm256_mulhi_epi16( u, _mm256_set1_epi16( c->cb_green ) ),
+                _mm256_mulhi_epi16( v, _mm256_set1_epi16( c->cr_green ) ) ) );
+    px[B] = _mm256_adds_epi16( y, _mm256_mulhi_epi16( u,
+                                    _mm256_set1_epi16( c->cb_blue ) ) );
+    px[A] = _mm256_setzero_si256();
+
+    /* Pack and interleave the components in the order of the pixel format.
+     * The packing instructions work within each 128-bits lane, so the lanes
+     * are put back in order at the end. */
+    __m256i p02 = _mm256_packus_epi16( px[order & 3], px[(order >> 4) & 3] );
+    __m256i p13 = _mm256_packus_epi16( px[(order >> 2) & 3], px[order >> 6] );
+    __m256i c01 = _mm256_unpacklo_epi8( p02, p13 );
+    __m256i c23 = _mm256_unpackhi_epi8( p02, p13 );
+    __m256i lo = _mm256_unpacklo_epi16( c01, c23 ); /* pixels 0-3, 8-11 */
+    __m256i hi = _mm256_unpackhi_epi16( c01, c23 ); /* pixels 4-7, 12-15 */
+
+    _mm256_storeu_si256( (__m256i *)dst,
+                         _mm256_permute2x128_si256( lo, hi, 0x20 ) );
+    _mm256_storeu_si256( (__m256i *)(dst + 32),
+                         _mm256_permute2x128_si256( lo, hi, 0x31 ) );
+}
+
+VLC_AVX2
+bool I420_RGB32_AVX2( filter_t *p_filter, picture_t *p_src,
+                      picture_t *p_dest, i420_avx2_order_t format )
+{
+    const video_format_t *fmt = &p_filter->fmt_in.video;
+
+    /* Scaling is left to the other versions */
+    if( !vlc_CPU_AVX2()
+     || fmt->i_width != p_filter->fmt_out.video.i_width
+     || fmt->i_height != p_filter->fmt_out.video.i_height )
+        return false;
+
+    const yuv2rgb_coeffs_t *c = (fmt->i_chroma == VLC_CODEC_J420)
+                              ? &coeffs_601_full : &coeffs_601_video;
+    const unsigned order = Order( format );
+    const unsigned i_width = fmt->i_width;
+
+    for( unsigned i_y = 0; i_y < fmt->i_height; i_y++ )
+    {
+        const uint8_t *p_y = p_src->Y_PIXELS + i_y * p_src->p[Y_PLANE].i_pitch;
+        const uint8_t *p_u = p_src->U_PIXELS
+                           + (i_y / 2) * p_src->p[U_PLANE].i_pitch;
+        const uint8_t *p_v = p_src->V_PIXELS
+                           + (i_y / 2) * p_src->p[V_PLANE].i_pitch;
+        uint8_t *p_pic = p_dest->p->p_pixels + i_y * p_dest->p->i_pitch;
+        unsigned i_x = 0;
+
+        for( ; i_x + 16 <= i_width; i_x += 16 )
+            Convert16( p_pic + 4 * i_x, p_y + i_x,
+                       p_u + i_x / 2, p_v + i_x / 2, c, order );
+
+        if( i_x < i_width )
+        {
+            if( i_width >= 16 )
+            {   /* Convert the last 16 pixels again, including the rest */
+                i_x = i_width - 16;
+                Convert16( p_pic + 4 * i_x, p_y + i_x,
+                           p_u + i_x / 2, p_v + i_x / 2, c, order );
+            }
+            else
+                for( ; i_x < i_width; i_x++ )
+                    ConvertPixel( p_pic + 4 * i_x, p_y[i_x],
+                                  p_u[i_x / 2], p_v[i_x / 2], c, order );
+        }
+    }
+    return true;
+}
+#endif
@@ -0,0 +1,618 @@
+/*****************************************************************************
+ * yuvscale.c: bilinear and bicubic scaling of planar and semi-planar YUV
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_cpu.h>
+
+/* The intrinsics headers can be used with target attributes since GCC 4.9 */
+#if (defined(__i386__) || defined(__x86_64__)) \
+ && (VLC_GCC_VERSION(4, 9) || defined(__clang__))
+# include <immintrin.h>
+# define HAVE_X86_KERNELS 1
+#endif
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+#define MODE_TEXT N_("Scaling mode")
+#define MODE_LONGTEXT N_("Interpolation used to resize the pictures.")
+
+static const int pi_mode_values[] = { 0, 1 };
+static const char *const ppsz_mode_descriptions[] =
+{ N_("Bilinear"), N_("Bicubic (good quality)") };
+
+vlc_module_begin ()
+    set_description( N_("YUV scaling filter") )
+    set_shortname( N_("YUV scaler") )
+    /* Above swscale, which needs a new context for every size change */
+    set_capability( "video filter2", 160 )
+    set_category( CAT_VIDEO )
+    set_subcategory( SUBCAT_VIDEO_VFILTER )
+    set_callbacks( Open, Close )
+    add_integer( "yuvscale-mode", 1, MODE_TEXT, MODE_LONGTEXT, true )
+        change_integer_list( pi_mode_values, ppsz_mode_descriptions )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+#define COEF_BITS  14 /* fixed point precision of the filter coefficients */
+#define INTER_BITS 6  /* extra precision of the horizontally scaled lines */
+
+/**
+ * Resampling filter of one dimension, computed once per picture size.
+ */
+typedef struct
+{
+    unsigned  taps; /* coefficients per output sample */
+    int      *pos;  /* first input sample of each output sample */
+    int16_t  *coef; /* taps coefficients of each output sample */
+} scale_kernel_t;
+
+typedef struct
+{
+    scale_kernel_t h, v;
+    unsigned  src_width, src_height; /* in samples of one component */
+    unsigned  dst_width, dst_height;
+    unsigned  components; /* 2 for the interleaved chroma of NV12 */
+    unsigned  pad;        /* samples replicated on each side of a line */
+    uint8_t  *line;       /* padded input line of one component */
+    int16_t  *tmp;        /* scaled line of one component */
+    int16_t  *rows;       /* window of v.taps horizontally scaled lines */
+    int      *row_tags;   /* input line held by each window row, or -1 */
+    int16_t **taps;       /* window rows used for the current output line */
+} scale_plane_t;
+
+typedef void (*scale_line_t)( int16_t *, const uint8_t *,
+                              const scale_kernel_t *, unsigned );
+typedef void (*scale_columns_t)( uint8_t *, int16_t *const *,
+                                 const int16_t *, unsigned, unsigned );
+
+struct filter_sys_t
+{
+    bool            b_bicubic;
+    bool            b_semiplanar;
+    unsigned        i_planes;
+    scale_plane_t   plane[PICTURE_PLANE_MAX];
+
+    /* Sizes the kernels were computed for */
+    unsigned        i_src_width, i_src_height;
+    unsigned        i_dst_width, i_dst_height;
+
+    scale_line_t    pf_scale_line;
+    scale_columns_t pf_scale_columns;
+};
+
+static picture_t *Filter( filter_t *, picture_t * );
+
+/*****************************************************************************
+ * Filter kernels
+ *****************************************************************************/
+static double Weight( double x, bool b_bicubic )
+{
+    x = fabs( x );
+    if( !b_bicubic )
+        return x < 1. ? 1. - x : 0.;
+    /* Keys cubic convolution with a = -0.5 (Catmull-Rom) */
+    if( x < 1. )
+        return (1.5 * x - 2.5) * x * x + 1.;
+    if( x < 2. )
+        return ((-0.5 * x + 2.5) * x - 4.) * x + 2.;
+    return 0.;
+}
+
+static void KernelClean( scale_kernel_t *k )
+{
+    free( k->pos );
+    free( k->coef );
+    k->pos = NULL;
+    k->coef = NULL;
+}
+
+/* The taps count is rounded up to a multiple of align, with null taps */
+static int KernelInit( scale_kernel_t *k, unsigned i_src, unsigned i_dst,
+                       bool b_bicubic, unsigned align )
+{
+    const double scale = (double)i_src / i_dst;
+    /* Stretch the filter when downscaling, so that every input sample
+     * contributes to the output */
+    const double stretch = scale > 1. ? scale : 1.;
+    const double radius = (b_bicubic ? 2. : 1.) * stretch;
+    unsigned taps = ceil( 2. * radius );
+
+    taps = (taps + align - 1) / align * align;
+    k->taps = taps;
+    k->pos = malloc( i_dst * sizeof(*k->pos) );
+    k->coef = malloc( i_dst * taps * sizeof(*k->coef) );
+    if( unlikely(k->pos == NULL || k->coef == NULL) )
+    {
+        KernelClean( k );
+        return VLC_ENOMEM;
+    }
+
+    for( unsigned i = 0; i < i_dst; i++ )
+    {
+        const double center = (i + .5) * scale - .5;
+        const int first = floor( center - radius ) + 1;
+        int16_t *coef = &k->coef[i * taps];
+        double sum = 0.;
+
+        for( unsigned j = 0; j < taps; j++ )
+            sum += Weight( (first + (int)j - center) / stretch, b_bicubic );
+
+        int total = 0;
+        unsigned peak = 0;
+        for( unsigned j = 0; j < taps; j++ )
+        {
+            double w = Weight( (first + (int)j - center) / stretch,
+                               b_bicubic ) / sum;
+            coef[j] = lround( w * (1 << COEF_BITS) );
+            total += coef[j];
+            if( coef[j] > coef[peak] )
+                peak = j;
+        }
+        /* Keep a unity gain despite the rounding */
+        coef[peak] += (1 << COEF_BITS) - total;
+        k->pos[i] = first;
+    }
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Line kernels
+ *****************************************************************************/
+static inline int16_t ScaleSample( const uint8_t *in, const int16_t *coef,
+                                   unsigned taps )
+{
+    int sum = 0;
+    for( unsigned j = 0; j < taps; j++ )
+        sum += in[j] * coef[j];
+    return (sum + (1 << (COEF_BITS - INTER_BITS - 1)))
+               >> (COEF_BITS - INTER_BITS);
+}
+
+static void ScaleLine_C( int16_t *dst, const uint8_t *src,
+                         const scale_kernel_t *k, unsigned width )
+{
+    for( unsigned i = 0; i < width; i++ )
+        dst[i] = ScaleSample( src + k->pos[i], &k->coef[i * k->taps],
+                              k->taps );
+}
+
+static void ScaleColumns_C( uint8_t *dst, int16_t *const *rows,
+                            const int16_t *coef, unsigned taps,
+                            unsigned width )
+{
+    for( unsigned i = 0; i < width; i++ )
+    {
+        int sum = 0;
+        for( unsigned j = 0; j < taps; j++ )
+            sum += rows[j][i] * coef[j];
+        sum = (sum + (1 << (COEF_BITS + INTER_BITS - 1)))
+                  >> (COEF_BITS + INTER_BITS);
+        dst[i] = VLC_CLIP( sum, 0, 255 );
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+/* The horizontal taps are a multiple of 8, one 8 pixels dot product each */
+__attribute__ ((__target__ ("sse2")))
+static void ScaleLine_SSE2( int16_t *dst, const uint8_t *src,
+                            const scale_kernel_t *k, unsigned width )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32( 1 << (COEF_BITS - INTER_BITS - 1) );
+    unsigned i = 0;
+
+    for( ; i + 4 <= width; i += 4 )
+    {
+        __m128i sum[4];
+
+        for( unsigned n = 0; n < 4; n++ )
+        {
+            const uint8_t *in = src + k->pos[i + n];
+            const int16_t *coef = &k->coef[(i + n) * k->taps];
+            __m128i acc = _mm_setzero_si128();
+
+            for( unsigned j = 0; j < k->taps; j += 8 )
+            {
+                __m128i px = _mm_loadl_epi64( (const __m128i *)(in + j) );
+                __m128i c = _mm_loadu_si128( (const __m128i *)(coef + j) );
+                acc = _mm_add_epi32( acc,
+                                     _mm_madd_epi16( _mm_unpacklo_epi8( px, zero ), c ) );
+            }
+            sum[n] = acc;
+        }
+
+        /* Transpose and add, to get the four sums in one register */
+        __m128i t0 = _mm_add_epi32( _mm_unpacklo_epi32( sum[0], sum[1] ),
+                                    _mm_unpackhi_epi32( sum[0], sum[1] ) );
+        __m128i t1 = _mm_add_epi32( _mm_unpacklo_epi32( sum[2], sum[3] ),
+                                    _mm_unpackhi_epi32( sum[2], sum[3] ) );
+        __m128i s = _mm_add_epi32( _mm_unpacklo_epi64( t0, t1 ),
+                                   _mm_unpackhi_epi64( t0, t1 ) );
+
+        s = _mm_srai_epi32( _mm_add_epi32( s, round ), COEF_BITS - INTER_BITS );
+        _mm_storel_epi64( (__m128i *)(dst + i), _mm_packs_epi32( s, s ) );
+    }
+
+    for( ; i < width; i++ )
+        dst[i] = ScaleSample( src + k->pos[i], &k->coef[i * k->taps],
+                              k->taps );
+}
+
+/* Lines are paired to multiply and add them with one instruction */
+__attribute__ ((__target__ ("sse2")))
+static void ScaleColumns_SSE2( uint8_t *dst, int16_t *const *rows,
+                               const int16_t *coef, unsigned taps,
+                               unsigned width )
+{
+    const __m128i round = _mm_set1_epi32( 1 << (COEF_BITS + INTER_BITS - 1) );
+    unsigned i = 0;
+
+    for( ; i + 8 <= width; i += 8 )
+    {
+        __m128i lo = round, hi = round;
+
+        for( unsigned j = 0; j < taps; j += 2 )
+        {
+            const bool pair = j + 1 < taps;
+            __m128i a = _mm_loadu_si128( (const __m128i *)(rows[j] + i) );
+            __m128i b = pair ? _mm_loadu_si128( (const __m128i *)(rows[j + 1] + i) )
+                             : a;
+            uint32_t c01 = (uint16_t)coef[j]
+                         | (uint32_t)(uint16_t)(pair ? coef[j + 1] : 0) << 16;
+            __m128i c = _mm_set1_epi32( c01 );
+
+            lo = _mm_add_epi32( lo, _mm_madd_epi16( _mm_unpacklo_epi16( a, b ), c ) );
+            hi = _mm_add_epi32( hi, _mm_madd_epi16( _mm_unpackhi_epi16( a, b ), c ) );
+        }
+        lo = _mm_srai_epi32( lo, COEF_BITS + INTER_BITS );
+        hi = _mm_srai_epi32( hi, COEF_BITS + INTER_BITS );
+
+        __m128i w = _mm_packs_epi32( lo, hi );
+        _mm_storel_epi64( (__m128i *)(dst + i), _mm_packus_epi16( w, w ) );
+    }
+
+    if( i < width )
+    {
+        int16_t *tail[taps];
+
+        for( unsigned j = 0; j < taps; j++ )
+            tail[j] = rows[j] + i;
+        ScaleColumns_C( dst + i, tail, coef, taps, width - i );
+    }
+}
+#endif
+
+/*****************************************************************************
+ * Planes
+ *****************************************************************************/
+static void PlaneClean( scale_plane_t *p )
+{
+    KernelClean( &p->h );
+    KernelClean( &p->v );
+    free( p->line );
+    free( p->tmp );
+    free( p->rows );
+    free( p->row_tags );
+    free( p->taps );
+    memset( p, 0, sizeof(*p) );
+}
+
+static int PlaneInit( scale_plane_t *p, unsigned src_width,
+                      unsigned src_height, unsigned dst_width,
+                      unsigned dst_height, unsigned components,
+                      bool b_bicubic )
+{
+    memset( p, 0, sizeof(*p) );
+    p->src_width = src_width;
+    p->src_height = src_height;
+    p->dst_width = dst_width;
+    p->dst_height = dst_height;
+    p->components = components;
+
+    if( KernelInit( &p->h, src_width, dst_width, b_bicubic, 8 )
+     || KernelInit( &p->v, src_height, dst_height, b_bicubic, 1 ) )
+        goto error;
+
+    /* The first input sample of a filter is at least -taps, and the
+     * last one at most width + taps */
+    p->pad = p->h.taps;
+    for( unsigned i = 0; i < dst_width; i++ )
+        p->h.pos[i] += p->pad;
+
+    const size_t row = dst_width * components;
+    p->line = malloc( src_width + 2 * p->pad );
+    p->tmp = malloc( dst_width * sizeof(*p->tmp) );
+    p->rows = malloc( p->v.taps * row * sizeof(*p->rows) );
+    p->row_tags = malloc( p->v.taps * sizeof(*p->row_tags) );
+    p->taps = malloc( p->v.taps * sizeof(*p->taps) );
+    if( unlikely(p->line == NULL || p->tmp == NULL || p->rows == NULL
+              || p->row_tags == NULL || p->taps == NULL) )
+        goto error;
+    return VLC_SUCCESS;
+
+error:
+    PlaneClean( p );
+    return VLC_ENOMEM;
+}
+
+/* Scales one input line horizontally into a window row */
+static void ScaleInputLine( filter_sys_t *p_sys, scale_plane_t *p,
+                            int16_t *row, const uint8_t *in )
+{
+    uint8_t *line = p->line + p->pad;
+    const unsigned w = p->src_width;
+
+    for( unsigned c = 0; c < p->components; c++ )
+    {
+        if( p->components == 1 )
+            memcpy( line, in, w );
+        else
+            for( unsigned x = 0; x < w; x++ )
+                line[x] = in[x * p->components + c];
+        memset( p->line, line[0], p->pad );
+        memset( line + w, line[w - 1], p->pad );
+
+        if( p->components == 1 )
+        {
+            p_sys->pf_scale_line( row, p->line, &p->h, p->dst_width );
+            break;
+        }
+
+        p_sys->pf_scale_line( p->tmp, p->line, &p->h, p->dst_width );
+        for( unsigned x = 0; x < p->dst_width; x++ )
+            row[x * p->components + c] = p->tmp[x];
+    }
+}
+
+static void ScalePlane( filter_sys_t *p_sys, scale_plane_t *p,
+                        plane_t *dst, const uint8_t *src, int src_pitch )
+{
+    const size_t row = p->dst_width * p->components;
+
+    for( unsigned i = 0; i < p->v.taps; i++ )
+        p->row_tags[i] = -1;
+
+    for( unsigned y = 0; y < p->dst_height; y++ )
+    {
+        const int first = p->v.pos[y];
+
+        /* The window holds v.taps consecutive input lines, so that each
+         * one is scaled horizontally only once */
+        for( unsigned j = 0; j < p->v.taps; j++ )
+        {
+            int line = VLC_CLIP( first + (int)j, 0, (int)p->src_height - 1 );
+            unsigned slot = line % p->v.taps;
+
+            if( p->row_tags[slot] != line )
+            {
+                ScaleInputLine( p_sys, p, &p->rows[slot * row],
+                                src + line * src_pitch );
+                p->row_tags[slot] = line;
+            }
+            p->taps[j] = &p->rows[slot * row];
+        }
+
+        p_sys->pf_scale_columns( &dst->p_pixels[y * dst->i_pitch], p->taps,
+                                 &p->v.coef[y * p->v.taps], p->v.taps, row );
+    }
+}
+
+/*****************************************************************************
+ * Filter
+ *****************************************************************************/
+static unsigned VisibleWidth( const video_format_t *fmt )
+{
+    return fmt->i_visible_width ? fmt->i_visible_width : fmt->i_width;
+}
+
+static unsigned VisibleHeight( const video_format_t *fmt )
+{
+    return fmt->i_visible_height ? fmt->i_visible_height : fmt->i_height;
+}
+
+static void Clean( filter_sys_t *p_sys )
+{
+    for( unsigned i = 0; i < p_sys->i_planes; i++ )
+        PlaneClean( &p_sys->plane[i] );
+    p_sys->i_src_width = p_sys->i_src_height = 0;
+    p_sys->i_dst_width = p_sys->i_dst_height = 0;
+}
+
+/* Computes the kernels again only if the picture sizes changed */
+static int Configure( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const video_format_t *in = &p_filter->fmt_in.video;
+    const video_format_t *out = &p_filter->fmt_out.video;
+    const unsigned i_src_width = VisibleWidth( in );
+    const unsigned i_src_height = VisibleHeight( in );
+    const unsigned i_dst_width = VisibleWidth( out );
+    const unsigned i_dst_height = VisibleHeight( out );
+
+    if( i_src_width == p_sys->i_src_width
+     && i_src_height == p_sys->i_src_height
+     && i_dst_width == p_sys->i_dst_width
+     && i_dst_height == p_sys->i_dst_height )
+        return VLC_SUCCESS;
+
+    Clean( p_sys );
+    if( i_src_width == 0 || i_src_height == 0
+     || i_dst_width == 0 || i_dst_height == 0 )
+        return VLC_EGENERIC;
+
+    const vlc_chroma_description_t *dsc =
+        vlc_fourcc_GetChromaDescription( in->i_chroma );
+
+    for( unsigned i = 0; i < p_sys->i_planes; i++ )
+    {
+        const unsigned components = (p_sys->b_semiplanar && i == 1) ? 2 : 1;
+        const unsigned num = dsc->p[i].w.num, den = dsc->p[i].w.den * components;
+        const unsigned vnum = dsc->p[i].h.num, vden = dsc->p[i].h.den;
+
+        if( PlaneInit( &p_sys->plane[i],
+                       (i_src_width * num + den - 1) / den,
+                       (i_src_height * vnum + vden - 1) / vden,
+                       (i_dst_width * num + den - 1) / den,
+                       (i_dst_height * vnum + vden - 1) / vden,
+                       components, p_sys->b_bicubic ) )
+        {
+            Clean( p_sys );
+            return VLC_ENOMEM;
+        }
+    }
+
+    p_sys->i_src_width = i_src_width;
+    p_sys->i_src_height = i_src_height;
+    p_sys->i_dst_width = i_dst_width;
+    p_sys->i_dst_height = i_dst_height;
+    msg_Dbg( p_filter, "%ux%u -> %ux%u, %u/%u taps", i_src_width,
+             i_src_height, i_dst_width, i_dst_height,
+             p_sys->plane[0].h.taps, p_sys->plane[0].v.taps );
+    return VLC_SUCCESS;
+}
+
+static int Open( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    const video_format_t *in = &p_filter->fmt_in.video;
+    const video_format_t *out = &p_filter->fmt_out.video;
+    bool b_semiplanar;
+
+    if( in->i_chroma != out->i_chroma
+     || in->orientation != out->orientation )
+        return VLC_EGENERIC;
+
+    switch( in->i_chroma )
+    {
+        case VLC_CODEC_I420:
+        case VLC_CODEC_J420:
+        case VLC_CODEC_YV12:
+        case VLC_CODEC_I422:
+        case VLC_CODEC_J422:
+        case VLC_CODEC_I444:
+        case VLC_CODEC_J444:
+            b_semiplanar = false;
+            break;
+        case VLC_CODEC_NV12:
+        case VLC_CODEC_NV21:
+            b_semiplanar = true;
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+
+    filter_sys_t *p_sys = calloc( 1, sizeof(*p_sys) );
+    if( unlikely(p_sys == NULL) )
+        return VLC_ENOMEM;
+
+    p_sys->b_bicubic = var_InheritInteger( p_filter, "yuvscale-mode" ) != 0;
+    p_sys->b_semiplanar = b_semiplanar;
+    p_sys->i_planes = vlc_fourcc_GetChromaDescription( in->i_chroma )->plane_count;
+    p_sys->pf_scale_line = ScaleLine_C;
+    p_sys->pf_scale_columns = ScaleColumns_C;
+#ifdef HAVE_X86_KERNELS
+    if( vlc_CPU_SSE2() )
+    {
+        p_sys->pf_scale_line = ScaleLine_SSE2;
+        p_sys->pf_scale_columns = ScaleColumns_SSE2;
+    }
+#endif
+    p_filter->p_sys = p_sys;
+
+    if( Configure( p_filter ) )
+    {
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
+    video_format_ScaleCropAr( &p_filter->fmt_out.video, &p_filter->fmt_in.video );
+    p_filter->pf_video_filter = Filter;
+    return VLC_SUCCESS;
+}
+
+static void Close( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    Clean( p_sys );
+    free( p_sys );
+}
+
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( !p_pic )
+        return NULL;
+
+    /* The owner may change the sizes between two pictures */
+    if( Configure( p_filter ) )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+    video_format_ScaleCropAr( &p_filter->fmt_out.video, &p_filter->fmt_in.video );
+
+    picture_t *p_dst = filter_NewPicture( p_filter );
+    if( !p_dst )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    const video_format_t *in = &p_filter->fmt_in.video;
+    const vlc_chroma_description_t *dsc =
+        vlc_fourcc_GetChromaDescription( in->i_chroma );
+
+    for( unsigned i = 0; i < p_sys->i_planes; i++ )
+    {
+        const plane_t *src = &p_pic->p[i];
+        /* Offsets of the visible area, in bytes and lines of the plane */
+        const unsigned x = in->i_x_offset * dsc->p[i].w.num / dsc->p[i].w.den;
+        const unsigned y = in->i_y_offset * dsc->p[i].h.num / dsc->p[i].h.den;
+
+        ScalePlane( p_sys, &p_sys->plane[i], &p_dst->p[i],
+                    &src->p_pixels[y * src->i_pitch
+                                   + (x & ~(p_sys->plane[i].components - 1))],
+                    src->i_pitch );
+    }
+
+    picture_CopyProperties( p_dst, p_pic );
+    picture_Release( p_pic );
+    return p_dst;
+}
@@ -123,6 +123,14 @@ struct filter_sys_t
                                int, int );
     int (*pf_process_sat_hue_clip)( picture_t *, picture_t *, int, int,
                                     int, int, int );
+    filter_slices_t *p_slices;
+
+    /* Tables derived from the parameters, only recomputed when they change.
+     * The full range will only be used for 10-bit. */
+    bool     b_update;
+    int      i_range;
+    int      pi_luma[1024];
+    int      i_sin, i_cos, i_sat, i_x, i_y;
 };
 
 /*****************************************************************************
@@ -157,6 +165,8 @@ static int Create( vlc_object_t *p_this )
     p_sys->f_gamma = var_CreateGetFloatCommand( p_filter, "gamma" );
     p_sys->b_brightness_threshold =
         var_CreateGetBoolCommand( p_filter, "brightness-threshold" );
+    p_sys->b_update = true;
+    p_sys->i_range = 256;
 
     /* Choose Planar/Packed function and pointer to a Hue/Saturation processing
      * function*/
@@ -170,11 +180,19 @@ static int Create( vlc_object_t *p_this )
             break;
 
         CASE_PLANAR_YUV10
+            /* Planar YUV 10-bit */
+            p_filter->pf_video_filter = FilterPlanar;
+            p_sys->pf_process_sat_hue_clip = planar_sat_hue_clip_C_16;
+            p_sys->pf_process_sat_hue = planar_sat_hue_C_16;
+            p_sys->i_range = 1024;
+            break;
+
         CASE_PLANAR_YUV9
-            /* Planar YUV 9-bit or 10-bit */
+            /* Planar YUV 9-bit */
             p_filter->pf_video_filter = FilterPlanar;
             p_sys->pf_process_sat_hue_clip = planar_sat_hue_clip_C_16;
             p_sys->pf_process_sat_hue = planar_sat_hue_C_16;
+            p_sys->i_range = 512;
             break;
 
         CASE_PACKED_YUV_422
@@ -187,9 +205,17 @@ static int Create( vlc_object_t *p_this )
         default:
             msg_Err( p_filter, "Unsupported input chroma (%4.4s)",
                      (char*)&(p_filter->fmt_in.video.i_chroma) );
+            free( p_sys );
             return VLC_EGENERIC;
     }
 
+    p_sys->p_slices = filter_NewSlices( p_filter, 0 );
+    if( p_sys->p_slices == NULL )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
     vlc_mutex_init( &p_sys->lock );
     var_AddCallback( p_filter, "contrast",   AdjustCallback, p_sys );
     var_AddCallback( p_filter, "brightness", AdjustCallback, p_sys );
@@ -218,120 +244,50 @@ static void Destroy( vlc_object_t *p_this )
     var_DelCallback( p_filter, "brightness-threshold",
                                              AdjustCallback, p_sys );
 
+    filter_DeleteSlices( p_sys->p_slices );
     vlc_mutex_destroy( &p_sys->lock );
     free( p_sys );
 }
 
 /*****************************************************************************
- * Run the filter on a Planar YUV picture
+ * Run the filter on one band of lines of a Planar YUV picture
  *****************************************************************************/
-static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
+typedef struct
 {
-    /* The full range will only be used for 10-bit */
-    int pi_luma[1024];
-    int pi_gamma[1024];
-
-    picture_t *p_outpic;
-
-    filter_sys_t *p_sys = p_filter->p_sys;
-
-    if( !p_pic ) return NULL;
-
-    p_outpic = filter_NewPicture( p_filter );
-    if( !p_outpic )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-
-    bool b_16bit;
-    float f_range;
-    switch( p_filter->fmt_in.video.i_chroma )
-    {
-        CASE_PLANAR_YUV10
-            b_16bit = true;
-            f_range = 1024.f;
-            break;
-        CASE_PLANAR_YUV9
-            b_16bit = true;
-            f_range = 512.f;
-            break;
-        default:
-            b_16bit = false;
-            f_range = 256.f;
-    }
-
-    const float f_max = f_range - 1.f;
-    const unsigned i_max = f_max;
-    const int i_range = f_range;
-    const unsigned i_size = i_range;
-    const unsigned i_mid = i_range >> 1;
-
-    /* Get variables */
-    vlc_mutex_lock( &p_sys->lock );
-    int32_t i_cont = lroundf( p_sys->f_contrast * f_max );
-    int32_t i_lum = lroundf( (p_sys->f_brightness - 1.f) * f_max );
-    float f_hue = p_sys->f_hue * (float)(M_PI / 180.);
-    int i_sat = (int)( p_sys->f_saturation * f_range );
-    float f_gamma = 1.f / p_sys->f_gamma;
-    bool b_thres = p_sys->b_brightness_threshold;
-    vlc_mutex_unlock( &p_sys->lock );
-
-    /*
-     * Threshold mode drops out everything about luma, contrast and gamma.
-     */
-    if( !b_thres )
-    {
-
-        /* Contrast is a fast but kludged function, so I put this gap to be
-         * cleaner :) */
-        i_lum += i_mid - i_cont / 2;
-
-        /* Fill the gamma lookup table */
-        for( unsigned i = 0 ; i < i_size; i++ )
-        {
-            pi_gamma[ i ] = VLC_CLIP( powf(i / f_max, f_gamma) * f_max, 0, i_max );
-        }
-
-        /* Fill the luma lookup table */
-        for( unsigned i = 0 ; i < i_size; i++ )
-        {
-            pi_luma[ i ] = pi_gamma[VLC_CLIP( ( i_lum + i_cont * i / i_range), 0, i_max )];
-        }
-    }
-    else
-    {
-        /*
-         * We get luma as threshold value: the higher it is, the darker is
-         * the image. Should I reverse this?
-         */
-        for( int i = 0 ; i < i_range; i++ )
-        {
-            pi_luma[ i ] = (i < i_lum) ? 0 : i_max;
-        }
+    const picture_t *p_src;
+    picture_t       *p_dst;
+    const filter_sys_t *p_sys;
+    bool             b_16bit;
+    int              i_y_offset; /* packed formats only */
+    int            (*pf_process_sat_hue)( picture_t *, picture_t *, int, int,
+                                          int, int, int );
+} adjust_slice_t;
+
+static void FilterPlanarSlice( void *opaque, unsigned i_slice,
+                               unsigned i_slices )
+{
+    const adjust_slice_t *p_ctx = opaque;
+    const filter_sys_t *p_sys = p_ctx->p_sys;
+    const int *pi_luma = p_sys->pi_luma;
+    picture_t view_in, view_out;
 
-        /*
-         * Desaturates image to avoid that strange yellow halo...
-         */
-        i_sat = 0;
-    }
+    filter_SlicePicture( &view_in, p_ctx->p_src, i_slice, i_slices );
+    filter_SlicePicture( &view_out, p_ctx->p_dst, i_slice, i_slices );
 
-    /*
-     * Do the Y plane
-     */
-    if ( b_16bit )
+    /* Do the Y plane */
+    if ( p_ctx->b_16bit )
     {
         uint16_t *p_in, *p_in_end, *p_line_end;
         uint16_t *p_out;
-        p_in = (uint16_t *) p_pic->p[Y_PLANE].p_pixels;
-        p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
-            * (p_pic->p[Y_PLANE].i_pitch >> 1) - 8;
+        p_in = (uint16_t *) view_in.p[Y_PLANE].p_pixels;
+        p_in_end = p_in + view_in.p[Y_PLANE].i_visible_lines
+            * (view_in.p[Y_PLANE].i_pitch >> 1) - 8;
 
-        p_out = (uint16_t *) p_outpic->p[Y_PLANE].p_pixels;
+        p_out = (uint16_t *) view_out.p[Y_PLANE].p_pixels;
 
         for( ; p_in < p_in_end ; )
         {
-            p_line_end = p_in + (p_pic->p[Y_PLANE].i_visible_pitch >> 1) - 8;
+            p_line_end = p_in + (view_in.p[Y_PLANE].i_visible_pitch >> 1) - 8;
 
             for( ; p_in < p_line_end ; )
             {
@@ -349,25 +305,25 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
                 *p_out++ = pi_luma[ *p_in++ ];
             }
 
-            p_in += (p_pic->p[Y_PLANE].i_pitch >> 1)
-                - (p_pic->p[Y_PLANE].i_visible_pitch >> 1);
-            p_out += (p_outpic->p[Y_PLANE].i_pitch >> 1)
-                - (p_outpic->p[Y_PLANE].i_visible_pitch >> 1);
+            p_in += (view_in.p[Y_PLANE].i_pitch >> 1)
+                - (view_in.p[Y_PLANE].i_visible_pitch >> 1);
+            p_out += (view_out.p[Y_PLANE].i_pitch >> 1)
+                - (view_out.p[Y_PLANE].i_visible_pitch >> 1);
         }
     }
     else
     {
         uint8_t *p_in, *p_in_end, *p_line_end;
         uint8_t *p_out;
-        p_in = p_pic->p[Y_PLANE].p_pixels;
-        p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
-                 * p_pic->p[Y_PLANE].i_pitch - 8;
+        p_in = view_in.p[Y_PLANE].p_pixels;
+        p_in_end = p_in + view_in.p[Y_PLANE].i_visible_lines
+                 * view_in.p[Y_PLANE].i_pitch - 8;
 
-        p_out = p_outpic->p[Y_PLANE].p_pixels;
+        p_out = view_out.p[Y_PLANE].p_pixels;
 
         for( ; p_in < p_in_end ; )
         {
-            p_line_end = p_in + p_pic->p[Y_PLANE].i_visible_pitch - 8;
+            p_line_end = p_in + view_in.p[Y_PLANE].i_visible_pitch - 8;
 
             for( ; p_in < p_line_end ; )
             {
@@ -385,119 +341,122 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
                 *p_out++ = pi_luma[ *p_in++ ];
             }
 
-            p_in += p_pic->p[Y_PLANE].i_pitch
-                  - p_pic->p[Y_PLANE].i_visible_pitch;
-            p_out += p_outpic->p[Y_PLANE].i_pitch
-                   - p_outpic->p[Y_PLANE].i_visible_pitch;
+            p_in += view_in.p[Y_PLANE].i_pitch
+                  - view_in.p[Y_PLANE].i_visible_pitch;
+            p_out += view_out.p[Y_PLANE].i_pitch
+                   - view_out.p[Y_PLANE].i_visible_pitch;
         }
     }
 
-    /*
-     * Do the U and V planes
-     */
-
-    int i_sin = sinf(f_hue) * f_max;
-    int i_cos = cosf(f_hue) * f_max;
-
-    /* pow(2, (bpp * 2) - 1) */
-    int i_x = ( cosf(f_hue) + sinf(f_hue) ) * f_range * i_mid;
-    int i_y = ( cosf(f_hue) - sinf(f_hue) ) * f_range * i_mid;
-
-    if ( i_sat > i_range )
-    {
-        /* Currently no errors are implemented in the function, if any are added
-         * check them here */
-        p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
-    }
-    else
-    {
-        /* Currently no errors are implemented in the function, if any are added
-         * check them here */
-        p_sys->pf_process_sat_hue( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
-    }
-
-    return CopyInfoAndRelease( p_outpic, p_pic );
+    /* Do the U and V planes */
+    p_ctx->pf_process_sat_hue( &view_in, &view_out, p_sys->i_sin, p_sys->i_cos,
+                               p_sys->i_sat, p_sys->i_x, p_sys->i_y );
 }
 
 /*****************************************************************************
- * Run the filter on a Packed YUV picture
+ * Run the filter on one band of lines of a Packed YUV picture
  *****************************************************************************/
-static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
+static void FilterPackedSlice( void *opaque, unsigned i_slice,
+                               unsigned i_slices )
 {
-    int pi_luma[256];
-    int pi_gamma[256];
-
-    picture_t *p_outpic;
+    const adjust_slice_t *p_ctx = opaque;
+    const filter_sys_t *p_sys = p_ctx->p_sys;
+    const int *pi_luma = p_sys->pi_luma;
+    picture_t view_in, view_out;
     uint8_t *p_in, *p_in_end, *p_line_end;
     uint8_t *p_out;
-    int i_y_offset, i_u_offset, i_v_offset;
-
-    int i_pitch, i_visible_pitch;
 
-    bool b_thres;
-    double  f_hue;
-    double  f_gamma;
-    int32_t i_cont, i_lum;
-    int i_sat, i_sin, i_cos, i_x, i_y;
+    filter_SlicePicture( &view_in, p_ctx->p_src, i_slice, i_slices );
+    filter_SlicePicture( &view_out, p_ctx->p_dst, i_slice, i_slices );
 
-    filter_sys_t *p_sys = p_filter->p_sys;
+    /*
+     * Do the Y plane
+     */
 
-    if( !p_pic ) return NULL;
+    p_in = view_in.p->p_pixels + p_ctx->i_y_offset;
+    p_in_end = p_in + view_in.p->i_visible_lines * view_in.p->i_pitch - 8 * 4;
 
-    i_pitch = p_pic->p->i_pitch;
-    i_visible_pitch = p_pic->p->i_visible_pitch;
+    p_out = view_out.p->p_pixels + p_ctx->i_y_offset;
 
-    if( GetPackedYuvOffsets( p_pic->format.i_chroma, &i_y_offset,
-                             &i_u_offset, &i_v_offset ) != VLC_SUCCESS )
+    for( ; p_in < p_in_end ; )
     {
-        msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                  (char*)&(p_pic->format.i_chroma) );
+        p_line_end = p_in + view_in.p->i_visible_pitch - 8 * 4;
 
-        picture_Release( p_pic );
-        return NULL;
-    }
+        for( ; p_in < p_line_end ; )
+        {
+            /* Do 8 pixels at a time */
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+        }
 
-    p_outpic = filter_NewPicture( p_filter );
-    if( !p_outpic )
-    {
-        msg_Warn( p_filter, "can't get output picture" );
+        p_line_end += 8 * 4;
 
-        picture_Release( p_pic );
-        return NULL;
+        for( ; p_in < p_line_end ; )
+        {
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+        }
+
+        p_in += view_in.p->i_pitch - view_in.p->i_visible_pitch;
+        p_out += view_out.p->i_pitch - view_out.p->i_visible_pitch;
     }
 
-    /* Get variables */
-    vlc_mutex_lock( &p_sys->lock );
-    i_cont = (int)( p_sys->f_contrast * 255 );
-    i_lum = (int)( (p_sys->f_brightness - 1.0)*255 );
-    f_hue = p_sys->f_hue * (float)(M_PI / 180.);
-    i_sat = (int)( p_sys->f_saturation * 256 );
-    f_gamma = 1.0 / p_sys->f_gamma;
-    b_thres = p_sys->b_brightness_threshold;
-    vlc_mutex_unlock( &p_sys->lock );
+    /*
+     * Do the U and V planes
+     */
+
+    /* The chroma was checked by FilterPacked(), this cannot fail */
+    p_ctx->pf_process_sat_hue( &view_in, &view_out, p_sys->i_sin, p_sys->i_cos,
+                               p_sys->i_sat, p_sys->i_x, p_sys->i_y );
+}
+
+/*****************************************************************************
+ * UpdateTables: recomputes the luma table and the hue/saturation factors
+ *****************************************************************************
+ * This must be called with the lock held, from the filter thread.
+ *****************************************************************************/
+static void UpdateTables( filter_sys_t *p_sys )
+{
+    int pi_gamma[1024];
+
+    const float f_range = p_sys->i_range;
+    const float f_max = f_range - 1.f;
+    const unsigned i_max = f_max;
+    const int i_range = p_sys->i_range;
+    const unsigned i_size = i_range;
+    const unsigned i_mid = i_range >> 1;
+
+    int32_t i_cont = lroundf( p_sys->f_contrast * f_max );
+    int32_t i_lum = lroundf( (p_sys->f_brightness - 1.f) * f_max );
+    float f_hue = p_sys->f_hue * (float)(M_PI / 180.);
+    int i_sat = (int)( p_sys->f_saturation * f_range );
+    float f_gamma = 1.f / p_sys->f_gamma;
 
     /*
      * Threshold mode drops out everything about luma, contrast and gamma.
      */
-    if( !b_thres )
+    if( !p_sys->b_brightness_threshold )
     {
 
         /* Contrast is a fast but kludged function, so I put this gap to be
          * cleaner :) */
-        i_lum += 128 - i_cont / 2;
+        i_lum += i_mid - i_cont / 2;
 
         /* Fill the gamma lookup table */
-        for( int i = 0 ; i < 256 ; i++ )
+        for( unsigned i = 0 ; i < i_size; i++ )
         {
-          pi_gamma[ i ] = clip_uint8_vlc( pow(i / 255.0, f_gamma) * 255.0);
+            pi_gamma[ i ] = VLC_CLIP( powf(i / f_max, f_gamma) * f_max, 0, i_max );
         }
 
         /* Fill the luma lookup table */
-        for( int i = 0 ; i < 256 ; i++ )
+        for( unsigned i = 0 ; i < i_size; i++ )
         {
-            pi_luma[ i ] = pi_gamma[clip_uint8_vlc( i_lum + i_cont * i / 256)];
+            p_sys->pi_luma[ i ] = pi_gamma[VLC_CLIP( ( i_lum + i_cont * i / i_range), 0, i_max )];
         }
     }
     else
@@ -506,9 +465,9 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
          * We get luma as threshold value: the higher it is, the darker is
          * the image. Should I reverse this?
          */
-        for( int i = 0 ; i < 256 ; i++ )
+        for( int i = 0 ; i < i_range; i++ )
         {
-            pi_luma[ i ] = (i < i_lum) ? 0 : 255;
+            p_sys->pi_luma[ i ] = (i < i_lum) ? 0 : i_max;
         }
 
         /*
@@ -517,80 +476,109 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
         i_sat = 0;
     }
 
-    /*
-     * Do the Y plane
-     */
+    p_sys->i_sat = i_sat;
+    p_sys->i_sin = sinf(f_hue) * f_max;
+    p_sys->i_cos = cosf(f_hue) * f_max;
 
-    p_in = p_pic->p->p_pixels + i_y_offset;
-    p_in_end = p_in + p_pic->p->i_visible_lines * p_pic->p->i_pitch - 8 * 4;
-
-    p_out = p_outpic->p->p_pixels + i_y_offset;
+    /* pow(2, (bpp * 2) - 1) */
+    p_sys->i_x = ( cosf(f_hue) + sinf(f_hue) ) * f_range * i_mid;
+    p_sys->i_y = ( cosf(f_hue) - sinf(f_hue) ) * f_range * i_mid;
 
-    for( ; p_in < p_in_end ; )
-    {
-        p_line_end = p_in + i_visible_pitch - 8 * 4;
+    p_sys->b_update = false;
+}
 
-        for( ; p_in < p_line_end ; )
-        {
-            /* Do 8 pixels at a time */
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-        }
+/*****************************************************************************
+ * Run the filter on a Planar YUV picture
+ *****************************************************************************/
+static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
+{
+    picture_t *p_outpic;
 
-        p_line_end += 8 * 4;
+    filter_sys_t *p_sys = p_filter->p_sys;
 
-        for( ; p_in < p_line_end ; )
-        {
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-        }
+    if( !p_pic ) return NULL;
 
-        p_in += i_pitch - p_pic->p->i_visible_pitch;
-        p_out += i_pitch - p_outpic->p->i_visible_pitch;
+    p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
+    {
+        picture_Release( p_pic );
+        return NULL;
     }
 
-    /*
-     * Do the U and V planes
-     */
+    /* The tables are only written here, the slices can read them unlocked */
+    vlc_mutex_lock( &p_sys->lock );
+    if( p_sys->b_update )
+        UpdateTables( p_sys );
+    vlc_mutex_unlock( &p_sys->lock );
 
-    i_sin = sin(f_hue) * 256;
-    i_cos = cos(f_hue) * 256;
+    adjust_slice_t ctx = {
+        .p_src = p_pic,
+        .p_dst = p_outpic,
+        .p_sys = p_sys,
+        .b_16bit = p_sys->i_range > 256,
+        /* Currently no errors are implemented in the functions, if any are
+         * added check them here */
+        .pf_process_sat_hue = ( p_sys->i_sat > p_sys->i_range )
+                            ? p_sys->pf_process_sat_hue_clip
+                            : p_sys->pf_process_sat_hue,
+    };
+
+    /* Every band of lines is processed independently */
+    filter_RunSlices( p_sys->p_slices, p_pic->p[Y_PLANE].i_visible_lines,
+                      FilterPlanarSlice, &ctx );
 
-    i_x = ( cos(f_hue) + sin(f_hue) ) * 32768;
-    i_y = ( cos(f_hue) - sin(f_hue) ) * 32768;
+    return CopyInfoAndRelease( p_outpic, p_pic );
+}
 
-    if ( i_sat > 256 )
+/*****************************************************************************
+ * Run the filter on a Packed YUV picture
+ *****************************************************************************/
+static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
+{
+    picture_t *p_outpic;
+    int i_y_offset, i_u_offset, i_v_offset;
+
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( !p_pic ) return NULL;
+
+    if( GetPackedYuvOffsets( p_pic->format.i_chroma, &i_y_offset,
+                             &i_u_offset, &i_v_offset ) != VLC_SUCCESS )
     {
-        if ( p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                             i_x, i_y ) != VLC_SUCCESS )
-        {
-            /* Currently only one error can happen in the function, but if there
-             * will be more of them, this message must go away */
-            msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                      (char*)&(p_pic->format.i_chroma) );
-            picture_Release( p_pic );
-            return NULL;
-        }
+        msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
+                  (char*)&(p_pic->format.i_chroma) );
+
+        picture_Release( p_pic );
+        return NULL;
     }
-    else
+
+    p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
     {
-        if ( p_sys->pf_process_sat_hue( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y ) != VLC_SUCCESS )
-        {
-            /* Currently only one error can happen in the function, but if there
-             * will be more of them, this message must go away */
-            msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                      (char*)&(p_pic->format.i_chroma) );
-            picture_Release( p_pic );
-            return NULL;
-        }
+        msg_Warn( p_filter, "can't get output picture" );
+
+        picture_Release( p_pic );
+        return NULL;
     }
 
+    vlc_mutex_lock( &p_sys->lock );
+    if( p_sys->b_update )
+        UpdateTables( p_sys );
+    vlc_mutex_unlock( &p_sys->lock );
+
+    adjust_slice_t ctx = {
+        .p_src = p_pic,
+        .p_dst = p_outpic,
+        .p_sys = p_sys,
+        .i_y_offset = i_y_offset,
+        .pf_process_sat_hue = ( p_sys->i_sat > p_sys->i_range )
+                            ? p_sys->pf_process_sat_hue_clip
+                            : p_sys->pf_process_sat_hue,
+    };
+
+    filter_RunSlices( p_sys->p_slices, p_pic->p->i_visible_lines,
+                      FilterPackedSlice, &ctx );
+
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
 
@@ -614,6 +602,7 @@ static int AdjustCallback( vlc_object_t *p_this, char const *psz_var,
         p_sys->f_gamma = newval.f_float;
     else if( !strcmp( psz_var, "brightness-threshold" ) )
         p_sys->b_brightness_threshold = newval.b_bool;
+    p_sys->b_update = true;
     vlc_mutex_unlock( &p_sys->lock );
 
     return VLC_SUCCESS;
@@ -31,8 +31,20 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
 #include "filter_picture.h"
 
+/* The intrinsics headers can be used with target attributes since GCC 4.9 */
+#if (defined(__i386__) || defined(__x86_64__)) \
+ && (VLC_GCC_VERSION(4, 9) || defined(__clang__))
+# include <immintrin.h>
+# define HAVE_X86_KERNELS 1
+#endif
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+# include <arm_neon.h>
+# define HAVE_NEON_KERNELS 1
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -78,6 +90,18 @@ public:
     {
         return fmt;
     }
+    const picture_t *getPicture() const
+    {
+        return picture;
+    }
+    unsigned getX() const
+    {
+        return x;
+    }
+    unsigned getY() const
+    {
+        return y;
+    }
     bool isFull(unsigned) const
     {
         return true;
@@ -622,6 +646,359 @@ static const struct {
 #undef YUV
 };
 
+/* Row kernels of the fast blenders below. Alpha() scales the source alpha
+ * by the global alpha, and Merge() blends count bytes each with its own
+ * alpha. Both round exactly like div255() and merge(), so that the fast
+ * blenders give the same pictures as the generic ones. */
+struct KernelsC {
+    static void Alpha(uint8_t *a, const uint8_t *src, unsigned count,
+                      unsigned alpha)
+    {
+        for (unsigned i = 0; i < count; i++)
+            a[i] = div255(alpha * src[i]);
+    }
+    static void Merge(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                      unsigned count)
+    {
+        for (unsigned i = 0; i < count; i++)
+            ::merge(&dst[i], src[i], a[i]);
+    }
+};
+
+#ifdef HAVE_X86_KERNELS
+/* No 16 bits lane can overflow: 255 * 255 + 254 + 1 < 65536 */
+__attribute__ ((__target__ ("sse2")))
+static inline __m128i div255_sse2(__m128i v)
+{
+    v = _mm_add_epi16(v, _mm_srli_epi16(v, 8));
+    v = _mm_add_epi16(v, _mm_set1_epi16(1));
+    return _mm_srli_epi16(v, 8);
+}
+
+struct KernelsSSE2 {
+    __attribute__ ((__target__ ("sse2")))
+    static void Alpha(uint8_t *a, const uint8_t *src, unsigned count,
+                      unsigned alpha)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ga   = _mm_set1_epi16(alpha);
+        unsigned i = 0;
+
+        for (; i + 16 <= count; i += 16) {
+            __m128i s  = _mm_loadu_si128((const __m128i *)&src[i]);
+            __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), ga);
+            __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), ga);
+            _mm_storeu_si128((__m128i *)&a[i],
+                             _mm_packus_epi16(div255_sse2(lo),
+                                              div255_sse2(hi)));
+        }
+        KernelsC::Alpha(&a[i], &src[i], count - i, alpha);
+    }
+    __attribute__ ((__target__ ("sse2")))
+    static void Merge(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                      unsigned count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i full = _mm_set1_epi16(255);
+        unsigned i = 0;
+
+        for (; i + 16 <= count; i += 16) {
+            __m128i d  = _mm_loadu_si128((const __m128i *)&dst[i]);
+            __m128i s  = _mm_loadu_si128((const __m128i *)&src[i]);
+            __m128i f  = _mm_loadu_si128((const __m128i *)&a[i]);
+            __m128i flo = _mm_unpacklo_epi8(f, zero);
+            __m128i fhi = _mm_unpackhi_epi8(f, zero);
+            __m128i lo = _mm_add_epi16(
+                _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero),
+                                _mm_sub_epi16(full, flo)),
+                _mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), flo));
+            __m128i hi = _mm_add_epi16(
+                _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero),
+                                _mm_sub_epi16(full, fhi)),
+                _mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), fhi));
+            _mm_storeu_si128((__m128i *)&dst[i],
+                             _mm_packus_epi16(div255_sse2(lo),
+                                              div255_sse2(hi)));
+        }
+        KernelsC::Merge(&dst[i], &src[i], &a[i], count - i);
+    }
+};
+
+/* The 256 bits unpack and pack instructions work within each 128 bits lane,
+ * so that the byte order is preserved from the loads to the stores. */
+__attribute__ ((__target__ ("avx2")))
+static inline __m256i div255_avx2(__m256i v)
+{
+    v = _mm256_add_epi16(v, _mm256_srli_epi16(v, 8));
+    v = _mm256_add_epi16(v, _mm256_set1_epi16(1));
+    return _mm256_srli_epi16(v, 8);
+}
+
+struct KernelsAVX2 {
+    __attribute__ ((__target__ ("avx2")))
+    static void Alpha(uint8_t *a, const uint8_t *src, unsigned count,
+                      unsigned alpha)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i ga   = _mm256_set1_epi16(alpha);
+        unsigned i = 0;
+
+        for (; i + 32 <= count; i += 32) {
+            __m256i s  = _mm256_loadu_si256((const __m256i *)&src[i]);
+            __m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), ga);
+            __m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), ga);
+            _mm256_storeu_si256((__m256i *)&a[i],
+                                _mm256_packus_epi16(div255_avx2(lo),
+                                                    div255_avx2(hi)));
+        }
+        _mm256_zeroupper();
+        KernelsSSE2::Alpha(&a[i], &src[i], count - i, alpha);
+    }
+    __attribute__ ((__target__ ("avx2")))
+    static void Merge(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                      unsigned count)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i full = _mm256_set1_epi16(255);
+        unsigned i = 0;
+
+        for (; i + 32 <= count; i += 32) {
+            __m256i d  = _mm256_loadu_si256((const __m256i *)&dst[i]);
+            __m256i s  = _mm256_loadu_si256((const __m256i *)&src[i]);
+            __m256i f  = _mm256_loadu_si256((const __m256i *)&a[i]);
+            __m256i flo = _mm256_unpacklo_epi8(f, zero);
+            __m256i fhi = _mm256_unpackhi_epi8(f, zero);
+            __m256i lo = _mm256_add_epi16(
+                _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero),
+                                   _mm256_sub_epi16(full, flo)),
+                _mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), flo));
+            __m256i hi = _mm256_add_epi16(
+                _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero),
+                                   _mm256_sub_epi16(full, fhi)),
+                _mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), fhi));
+            _mm256_storeu_si256((__m256i *)&dst[i],
+                                _mm256_packus_epi16(div255_avx2(lo),
+                                                    div255_avx2(hi)));
+        }
+        _mm256_zeroupper();
+        KernelsSSE2::Merge(&dst[i], &src[i], &a[i], count - i);
+    }
+};
+#endif
+
+#ifdef HAVE_NEON_KERNELS
+static inline uint8x8_t div255_neon(uint16x8_t v)
+{
+    v = vaddq_u16(v, vshrq_n_u16(v, 8));
+    v = vaddq_u16(v, vdupq_n_u16(1));
+    return vshrn_n_u16(v, 8);
+}
+
+struct KernelsNEON {
+    static void Alpha(uint8_t *a, const uint8_t *src, unsigned count,
+                      unsigned alpha)
+    {
+        const uint8x8_t ga = vdup_n_u8(alpha);
+        unsigned i = 0;
+
+        for (; i + 8 <= count; i += 8)
+            vst1_u8(&a[i], div255_neon(vmull_u8(vld1_u8(&src[i]), ga)));
+        KernelsC::Alpha(&a[i], &src[i], count - i, alpha);
+    }
+    static void Merge(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                      unsigned count)
+    {
+        const uint8x8_t full = vdup_n_u8(255);
+        unsigned i = 0;
+
+        for (; i + 8 <= count; i += 8) {
+            uint8x8_t f  = vld1_u8(&a[i]);
+            uint16x8_t v = vmull_u8(vld1_u8(&dst[i]), vsub_u8(full, f));
+            v = vmlal_u8(v, vld1_u8(&src[i]), f);
+            vst1_u8(&dst[i], div255_neon(v));
+        }
+        KernelsC::Merge(&dst[i], &src[i], &a[i], count - i);
+    }
+};
+#endif
+
+/* The fast blenders process the lines by chunks of an even number of
+ * pixels, to keep the chroma subsampling phase of the destination. */
+#define BLEND_CHUNK 256
+
+template <class K, bool swap_uv>
+void BlendYUVAToI420(const CPicture &dst_data, const CPicture &src_data,
+                     unsigned width, unsigned height, int alpha)
+{
+    const picture_t *dst = dst_data.getPicture();
+    const picture_t *src = src_data.getPicture();
+    const unsigned dx = dst_data.getX(), dy = dst_data.getY();
+    const unsigned sx = src_data.getX(), sy = src_data.getY();
+    const plane_t *du = &dst->p[swap_uv ? 2 : 1];
+    const plane_t *dv = &dst->p[swap_uv ? 1 : 2];
+    uint8_t a[BLEND_CHUNK];
+    uint8_t cu[BLEND_CHUNK / 2], cv[BLEND_CHUNK / 2], ca[BLEND_CHUNK / 2];
+
+    for (unsigned y = 0; y < height; y++) {
+        const uint8_t *s[4];
+        for (unsigned i = 0; i < 4; i++)
+            s[i] = &src->p[i].p_pixels[(sy + y) * src->p[i].i_pitch + sx];
+        uint8_t *d = &dst->p[0].p_pixels[(dy + y) * dst->p[0].i_pitch + dx];
+        uint8_t *du_line = &du->p_pixels[(dy + y) / 2 * du->i_pitch];
+        uint8_t *dv_line = &dv->p_pixels[(dy + y) / 2 * dv->i_pitch];
+        const bool chroma = ((dy + y) % 2) == 0;
+
+        for (unsigned x = 0; x < width; x += BLEND_CHUNK) {
+            const unsigned count = __MIN(width - x, BLEND_CHUNK);
+
+            K::Alpha(a, &s[3][x], count, alpha);
+            K::Merge(&d[x], &s[0][x], a, count);
+            if (!chroma)
+                continue;
+
+            const unsigned first = dx % 2;
+            unsigned n = 0;
+            for (unsigned i = first; i < count; i += 2, n++) {
+                cu[n] = s[1][x + i];
+                cv[n] = s[2][x + i];
+                ca[n] = a[i];
+            }
+            K::Merge(&du_line[(dx + x + first) / 2], cu, ca, n);
+            K::Merge(&dv_line[(dx + x + first) / 2], cv, ca, n);
+        }
+    }
+}
+
+template <class K, bool swap_uv>
+void BlendYUVAToNV12(const CPicture &dst_data, const CPicture &src_data,
+                     unsigned width, unsigned height, int alpha)
+{
+    const picture_t *dst = dst_data.getPicture();
+    const picture_t *src = src_data.getPicture();
+    const unsigned dx = dst_data.getX(), dy = dst_data.getY();
+    const unsigned sx = src_data.getX(), sy = src_data.getY();
+    uint8_t a[BLEND_CHUNK], cuv[BLEND_CHUNK], ca[BLEND_CHUNK];
+
+    for (unsigned y = 0; y < height; y++) {
+        const uint8_t *s[4];
+        for (unsigned i = 0; i < 4; i++)
+            s[i] = &src->p[i].p_pixels[(sy + y) * src->p[i].i_pitch + sx];
+        uint8_t *d = &dst->p[0].p_pixels[(dy + y) * dst->p[0].i_pitch + dx];
+        uint8_t *duv = &dst->p[1].p_pixels[(dy + y) / 2 * dst->p[1].i_pitch];
+        const bool chroma = ((dy + y) % 2) == 0;
+
+        for (unsigned x = 0; x < width; x += BLEND_CHUNK) {
+            const unsigned count = __MIN(width - x, BLEND_CHUNK);
+
+            K::Alpha(a, &s[3][x], count, alpha);
+            K::Merge(&d[x], &s[0][x], a, count);
+            if (!chroma)
+                continue;
+
+            const unsigned first = dx % 2;
+            unsigned n = 0;
+            for (unsigned i = first; i < count; i += 2, n += 2) {
+                cuv[n +  swap_uv] = s[1][x + i];
+                cuv[n + !swap_uv] = s[2][x + i];
+                ca[n] = ca[n + 1] = a[i];
+            }
+            K::Merge(&duv[dx + x + first], cuv, ca, n);
+        }
+    }
+}
+
+template <class K>
+void BlendYUVAToRGB32(const CPicture &dst_data, const CPicture &src_data,
+                      unsigned width, unsigned height, int alpha)
+{
+    const picture_t *dst = dst_data.getPicture();
+    const picture_t *src = src_data.getPicture();
+    const video_format_t *fmt = dst_data.getFormat();
+    const unsigned dx = dst_data.getX(), dy = dst_data.getY();
+    const unsigned sx = src_data.getX(), sy = src_data.getY();
+#ifdef WORDS_BIGENDIAN
+    const unsigned offset_r = (32 - fmt->i_lrshift) / 8;
+    const unsigned offset_g = (32 - fmt->i_lgshift) / 8;
+    const unsigned offset_b = (32 - fmt->i_lbshift) / 8;
+#else
+    const unsigned offset_r = fmt->i_lrshift / 8;
+    const unsigned offset_g = fmt->i_lgshift / 8;
+    const unsigned offset_b = fmt->i_lbshift / 8;
+#endif
+    uint8_t a[BLEND_CHUNK], rgb[4 * BLEND_CHUNK], ca[4 * BLEND_CHUNK];
+
+    /* The padding byte is merged with a null alpha, which keeps it as is */
+    memset(rgb, 0, sizeof(rgb));
+    memset(ca, 0, sizeof(ca));
+
+    for (unsigned y = 0; y < height; y++) {
+        const uint8_t *s[4];
+        for (unsigned i = 0; i < 4; i++)
+            s[i] = &src->p[i].p_pixels[(sy + y) * src->p[i].i_pitch + sx];
+        uint8_t *d = &dst->p[0].p_pixels[(dy + y) * dst->p[0].i_pitch + 4 * dx];
+
+        for (unsigned x = 0; x < width; x += BLEND_CHUNK) {
+            const unsigned count = __MIN(width - x, BLEND_CHUNK);
+
+            K::Alpha(a, &s[3][x], count, alpha);
+            for (unsigned i = 0; i < count; i++) {
+                int r = 0, g = 0, b = 0;
+                if (a[i] != 0)
+                    yuv_to_rgb(&r, &g, &b, s[0][x + i], s[1][x + i],
+                               s[2][x + i]);
+                rgb[4 * i + offset_r] = r;
+                rgb[4 * i + offset_g] = g;
+                rgb[4 * i + offset_b] = b;
+                ca[4 * i + offset_r] =
+                ca[4 * i + offset_g] =
+                ca[4 * i + offset_b] = a[i];
+            }
+            K::Merge(&d[4 * x], rgb, ca, 4 * count);
+        }
+    }
+}
+
+template <class K>
+blend_function_t FindFastBlend(vlc_fourcc_t dst)
+{
+    switch (dst) {
+        case VLC_CODEC_I420:
+        case VLC_CODEC_J420:
+            return BlendYUVAToI420<K, false>;
+        case VLC_CODEC_YV12:
+            return BlendYUVAToI420<K, true>;
+        case VLC_CODEC_NV12:
+            return BlendYUVAToNV12<K, false>;
+        case VLC_CODEC_NV21:
+            return BlendYUVAToNV12<K, true>;
+        case VLC_CODEC_RGB32:
+            return BlendYUVAToRGB32<K>;
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * Returns the SIMD blender for the most common chromas, or NULL.
+ */
+static blend_function_t FindFastBlend(vlc_fourcc_t dst, vlc_fourcc_t src)
+{
+    if (src != VLC_CODEC_YUVA)
+        return NULL;
+#ifdef HAVE_X86_KERNELS
+    if (vlc_CPU_AVX2())
+        return FindFastBlend<KernelsAVX2>(dst);
+    if (vlc_CPU_SSE2())
+        return FindFastBlend<KernelsSSE2>(dst);
+#endif
+#ifdef HAVE_NEON_KERNELS
+    return FindFastBlend<KernelsNEON>(dst);
+#else
+    (void) dst;
+    return NULL;
+#endif
+}
+
 struct filter_sys_t {
     filter_sys_t() : blend(NULL)
     {
@@ -670,7 +1047,8 @@ static int Open(vlc_object_t *object)
     const vlc_fourcc_t dst = filter->fmt_out.video.i_chroma;
 
     filter_sys_t *sys = new filter_sys_t();
-    for (size_t i = 0; i < sizeof(blends) / sizeof(*blends); i++) {
+    sys->blend = FindFastBlend(dst, src);
+    for (size_t i = 0; !sys->blend && i < sizeof(blends) / sizeof(*blends); i++) {
         if (blends[i].src == src && blends[i].dst == dst)
             sys->blend = blends[i].blend;
     }
@@ -56,17 +56,26 @@ static picture_t *Filter( filter_t *, picture_t * );
 #define ALPHA_LONGTEXT N_("Alpha with which the blend image is blended")
 
 #define BASE_IMAGE_TEXT N_("Image to be blended onto")
-#define BASE_IMAGE_LONGTEXT N_("The image which will be used to blend onto")
+#define BASE_IMAGE_LONGTEXT N_("The image which will be used to blend onto. " \
+    "A synthetic picture is used if none is given.")
 
-#define BASE_CHROMA_TEXT N_("Chroma for the base image")
-#define BASE_CHROMA_LONGTEXT N_("Chroma which the base image will be loaded in")
+#define BASE_CHROMA_TEXT N_("Chromas for the base image")
+#define BASE_CHROMA_LONGTEXT N_("Comma separated list of the chromas which " \
+    "the base image will be loaded in")
 
 #define BLEND_IMAGE_TEXT N_("Image which will be blended")
-#define BLEND_IMAGE_LONGTEXT N_("The image blended onto the base image")
+#define BLEND_IMAGE_LONGTEXT N_("The image blended onto the base image. " \
+    "A synthetic picture is used if none is given.")
 
-#define BLEND_CHROMA_TEXT N_("Chroma for the blend image")
-#define BLEND_CHROMA_LONGTEXT N_("Chroma which the blend image will be loaded" \
-                                 " in")
+#define BLEND_CHROMA_TEXT N_("Chromas for the blend image")
+#define BLEND_CHROMA_LONGTEXT N_("Comma separated list of the chromas which " \
+    "the blend image will be loaded in")
+
+#define WIDTH_TEXT N_("Synthetic picture width")
+#define WIDTH_LONGTEXT N_("Width of the pictures used when no image is given")
+
+#define HEIGHT_TEXT N_("Synthetic picture height")
+#define HEIGHT_LONGTEXT N_("Height of the pictures used when no image is given")
 
 #define CFG_PREFIX "blendbench-"
 
@@ -82,25 +91,28 @@ vlc_module_begin ()
               LOOPS_LONGTEXT, false )
     add_integer_with_range( CFG_PREFIX "alpha", 128, 0, 255, ALPHA_TEXT,
               ALPHA_LONGTEXT, false )
+    add_integer( CFG_PREFIX "width", 1920, WIDTH_TEXT, WIDTH_LONGTEXT, true )
+    add_integer( CFG_PREFIX "height", 1080, HEIGHT_TEXT, HEIGHT_LONGTEXT,
+                 true )
 
     set_section( N_("Base image"), NULL )
     add_loadfile( CFG_PREFIX "base-image", NULL, BASE_IMAGE_TEXT,
                   BASE_IMAGE_LONGTEXT, false )
-    add_string( CFG_PREFIX "base-chroma", "I420", BASE_CHROMA_TEXT,
-              BASE_CHROMA_LONGTEXT, false )
+    add_string( CFG_PREFIX "base-chroma", "I420,YV12,NV12,NV21,RV32",
+                BASE_CHROMA_TEXT, BASE_CHROMA_LONGTEXT, false )
 
     set_section( N_("Blend image"), NULL )
     add_loadfile( CFG_PREFIX "blend-image", NULL, BLEND_IMAGE_TEXT,
                   BLEND_IMAGE_LONGTEXT, false )
-    add_string( CFG_PREFIX "blend-chroma", "YUVA", BLEND_CHROMA_TEXT,
-              BLEND_CHROMA_LONGTEXT, false )
+    add_string( CFG_PREFIX "blend-chroma", "YUVA,RGBA,YUVP",
+                BLEND_CHROMA_TEXT, BLEND_CHROMA_LONGTEXT, false )
 
     set_callbacks( Create, Destroy )
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
-    "loops", "alpha", "base-image", "base-chroma", "blend-image",
-    "blend-chroma", NULL
+    "loops", "alpha", "width", "height", "base-image", "base-chroma",
+    "blend-image", "blend-chroma", NULL
 };
 
 /*****************************************************************************
@@ -110,39 +122,84 @@ struct filter_sys_t
 {
     bool b_done;
     int i_loops, i_alpha;
+    unsigned i_width, i_height;
+
+    char *psz_base_image;
+    char *psz_blend_image;
 
-    picture_t *p_base_image;
-    picture_t *p_blend_image;
+    char *psz_base_chroma;
+    char *psz_blend_chroma;
 
-    vlc_fourcc_t i_base_chroma;
-    vlc_fourcc_t i_blend_chroma;
+    video_palette_t palette; /* of the synthetic YUVP pictures */
 };
 
-static int blendbench_LoadImage( vlc_object_t *p_this, picture_t **pp_pic,
-                                 vlc_fourcc_t i_chroma, char *psz_file, const char *psz_name )
+static picture_t *blendbench_LoadImage( vlc_object_t *p_this,
+                                        vlc_fourcc_t i_chroma,
+                                        const char *psz_file,
+                                        const char *psz_name )
 {
     image_handler_t *p_image;
     video_format_t fmt_in, fmt_out;
+    picture_t *p_pic;
 
     memset( &fmt_in, 0, sizeof(video_format_t) );
     memset( &fmt_out, 0, sizeof(video_format_t) );
 
     fmt_out.i_chroma = i_chroma;
     p_image = image_HandlerCreate( p_this );
-    *pp_pic = image_ReadUrl( p_image, psz_file, &fmt_in, &fmt_out );
+    p_pic = image_ReadUrl( p_image, psz_file, &fmt_in, &fmt_out );
     image_HandlerDelete( p_image );
 
-    if( *pp_pic == NULL )
+    if( p_pic == NULL )
     {
         msg_Err( p_this, "Unable to load %s image", psz_name );
-        return VLC_EGENERIC;
+        return NULL;
     }
 
     msg_Dbg( p_this, "%s image has dim %d x %d (Y plane)", psz_name,
-             (*pp_pic)->p[Y_PLANE].i_visible_pitch,
-             (*pp_pic)->p[Y_PLANE].i_visible_lines );
+             p_pic->p[Y_PLANE].i_visible_pitch,
+             p_pic->p[Y_PLANE].i_visible_lines );
 
-    return VLC_SUCCESS;
+    return p_pic;
+}
+
+/* Fills all the planes with a pattern, which gives every alpha value
+ * and every palette index for the chromas that have them */
+static picture_t *blendbench_NewImage( filter_sys_t *p_sys,
+                                       vlc_fourcc_t i_chroma )
+{
+    picture_t *p_pic = picture_New( i_chroma, p_sys->i_width,
+                                    p_sys->i_height, 1, 1 );
+    if( p_pic == NULL )
+        return NULL;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+                p->p_pixels[y * p->i_pitch + x] = x * 3 + y * 5 + i * 64;
+    }
+
+    if( i_chroma == VLC_CODEC_YUVP )
+        p_pic->format.p_palette = &p_sys->palette;
+    return p_pic;
+}
+
+static picture_t *blendbench_GetImage( filter_t *p_filter,
+                                       vlc_fourcc_t i_chroma,
+                                       const char *psz_file,
+                                       const char *psz_name )
+{
+    if( psz_file != NULL && *psz_file )
+        return blendbench_LoadImage( VLC_OBJECT(p_filter), i_chroma,
+                                     psz_file, psz_name );
+
+    picture_t *p_pic = blendbench_NewImage( p_filter->p_sys, i_chroma );
+    if( p_pic == NULL )
+        msg_Err( p_filter, "Unable to create %s image", psz_name );
+    return p_pic;
 }
 
 /*****************************************************************************
@@ -152,8 +209,6 @@ static int Create( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys;
-    char *psz_temp, *psz_cmd;
-    int i_ret;
 
     /* Allocate structure */
     p_filter->p_sys = malloc( sizeof( filter_sys_t ) );
@@ -174,31 +229,29 @@ static int Create( vlc_object_t *p_this )
                                                   CFG_PREFIX "loops" );
     p_sys->i_alpha = var_CreateGetIntegerCommand( p_filter,
                                                   CFG_PREFIX "alpha" );
-
-    psz_temp = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
-    p_sys->i_base_chroma = VLC_FOURCC( psz_temp[0], psz_temp[1],
-                                       psz_temp[2], psz_temp[3] );
-    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-image" );
-    i_ret = blendbench_LoadImage( p_this, &p_sys->p_base_image,
-                                  p_sys->i_base_chroma, psz_cmd, "Base" );
-    free( psz_temp );
-    free( psz_cmd );
-    if( i_ret != VLC_SUCCESS )
+    p_sys->i_width = __MAX( var_CreateGetInteger( p_filter,
+                                                  CFG_PREFIX "width" ), 1 );
+    p_sys->i_height = __MAX( var_CreateGetInteger( p_filter,
+                                                   CFG_PREFIX "height" ), 1 );
+
+    p_sys->psz_base_chroma = var_CreateGetString( p_filter,
+                                                  CFG_PREFIX "base-chroma" );
+    p_sys->psz_base_image = var_CreateGetString( p_filter,
+                                                 CFG_PREFIX "base-image" );
+    p_sys->psz_blend_chroma = var_CreateGetString( p_filter,
+                                                   CFG_PREFIX "blend-chroma" );
+    p_sys->psz_blend_image = var_CreateGetString( p_filter,
+                                                  CFG_PREFIX "blend-image" );
+
+    p_sys->palette.i_entries = 256;
+    for( int i = 0; i < 256; i++ )
     {
-        free( p_sys );
-        return i_ret;
+        p_sys->palette.palette[i][0] = i;
+        p_sys->palette.palette[i][1] = 255 - i;
+        p_sys->palette.palette[i][2] = i ^ 0x55;
+        p_sys->palette.palette[i][3] = i;
     }
 
-    psz_temp = var_CreateGetStringCommand( p_filter,
-                                           CFG_PREFIX "blend-chroma" );
-    p_sys->i_blend_chroma = VLC_FOURCC( psz_temp[0], psz_temp[1],
-                                        psz_temp[2], psz_temp[3] );
-    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "blend-image" );
-    blendbench_LoadImage( p_this, &p_sys->p_blend_image, p_sys->i_blend_chroma,
-                          psz_cmd, "Blend" );
-    free( psz_temp );
-    free( psz_cmd );
-
     return VLC_SUCCESS;
 }
 
@@ -210,57 +263,121 @@ static void Destroy( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
-    picture_Release( p_sys->p_base_image );
-    picture_Release( p_sys->p_blend_image );
+    free( p_sys->psz_blend_image );
+    free( p_sys->psz_blend_chroma );
+    free( p_sys->psz_base_image );
+    free( p_sys->psz_base_chroma );
+    free( p_sys );
+}
+
+static vlc_fourcc_t blendbench_Chroma( const char *psz )
+{
+    char fcc[5] = "    ";
+
+    memcpy( fcc, psz, strnlen( psz, 4 ) );
+    return vlc_fourcc_GetCodecFromString( VIDEO_ES, fcc );
 }
 
 /*****************************************************************************
- * Render: displays previously rendered output
+ * Bench: blends one pair of chromas
  *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+static void Bench( filter_t *p_filter, const char *psz_base,
+                   const char *psz_blend )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    filter_t *p_blend;
+    vlc_fourcc_t i_base_chroma = blendbench_Chroma( psz_base );
+    vlc_fourcc_t i_blend_chroma = blendbench_Chroma( psz_blend );
 
-    if( p_sys->b_done )
-        return p_pic;
-
-    p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
-    if( !p_blend )
+    if( !i_base_chroma || !i_blend_chroma )
     {
-        picture_Release( p_pic );
-        return NULL;
+        msg_Err( p_filter, "Unknown chroma %s -> %s", psz_blend, psz_base );
+        return;
     }
-    p_blend->fmt_out.video = p_sys->p_base_image->format;
-    p_blend->fmt_in.video = p_sys->p_blend_image->format;
-    p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
-    if( !p_blend->p_module )
+
+    picture_t *p_base = blendbench_GetImage( p_filter, i_base_chroma,
+                                             p_sys->psz_base_image, "Base" );
+    picture_t *p_blend = blendbench_GetImage( p_filter, i_blend_chroma,
+                                              p_sys->psz_blend_image,
+                                              "Blend" );
+    filter_t *p_blender = NULL;
+
+    if( p_base == NULL || p_blend == NULL )
+        goto out;
+
+    p_blender = vlc_object_create( p_filter, sizeof(filter_t) );
+    if( !p_blender )
+        goto out;
+    p_blender->fmt_out.video = p_base->format;
+    p_blender->fmt_in.video = p_blend->format;
+    p_blender->p_module = module_need( p_blender, "video blending", NULL,
+                                       false );
+    if( !p_blender->p_module )
     {
-        picture_Release( p_pic );
-        vlc_object_release( p_blend );
-        return NULL;
+        msg_Warn( p_filter, "No blender for %s -> %s", psz_blend, psz_base );
+        goto out;
     }
 
     mtime_t time = mdate();
     for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
     {
-        p_blend->pf_video_blend( p_blend,
-                                 p_sys->p_base_image, p_sys->p_blend_image,
-                                 0, 0, p_sys->i_alpha );
+        p_blender->pf_video_blend( p_blender, p_base, p_blend,
+                                   0, 0, p_sys->i_alpha );
     }
     time = mdate() - time;
+    if( time <= 0 )
+        time = 1;
 
-    msg_Info( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
-              time / 1000000.0f );
-    msg_Info( p_filter, "Speed is: %f images/second, %f pixels/second",
+    msg_Info( p_filter, "%s -> %s: blended %d images in %f sec", psz_blend,
+              psz_base, p_sys->i_loops, time / 1000000.0f );
+    msg_Info( p_filter, "%s -> %s: %f images/second, %f pixels/second",
+              psz_blend, psz_base,
               (float) p_sys->i_loops / time * 1000000,
               (float) p_sys->i_loops / time * 1000000 *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_pitch *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_lines );
+                  p_blend->format.i_visible_width *
+                  p_blend->format.i_visible_height );
+
+    module_unneed( p_blender, p_blender->p_module );
+out:
+    if( p_blender )
+        vlc_object_release( p_blender );
+    if( p_blend )
+        picture_Release( p_blend );
+    if( p_base )
+        picture_Release( p_base );
+}
 
-    module_unneed( p_blend, p_blend->p_module );
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->b_done )
+        return p_pic;
 
-    vlc_object_release( p_blend );
+    /* Every base chroma with every blend chroma */
+    char *psz_bases = strdup( p_sys->psz_base_chroma );
+    char *psz_blends = strdup( p_sys->psz_blend_chroma );
+    char *psz_base_save, *psz_blend_save;
+
+    if( psz_bases != NULL && psz_blends != NULL )
+        for( char *psz_base = strtok_r( psz_bases, ",", &psz_base_save );
+             psz_base != NULL;
+             psz_base = strtok_r( NULL, ",", &psz_base_save ) )
+        {
+            char *psz_list = strdup( psz_blends );
+            if( psz_list == NULL )
+                break;
+
+            for( char *psz_blend = strtok_r( psz_list, ",", &psz_blend_save );
+                 psz_blend != NULL;
+                 psz_blend = strtok_r( NULL, ",", &psz_blend_save ) )
+                Bench( p_filter, psz_base, psz_blend );
+            free( psz_list );
+        }
+    free( psz_blends );
+    free( psz_bases );
 
     p_sys->b_done = true;
     return p_pic;
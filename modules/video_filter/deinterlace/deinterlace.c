@@ -663,6 +663,18 @@ notsupp:
 
     IVTCClearState( p_filter );
 
+    p_sys->p_slices = NULL;
+    if( p_sys->i_mode == DEINTERLACE_YADIF
+     || p_sys->i_mode == DEINTERLACE_YADIF2X )
+    {
+        p_sys->p_slices = filter_NewSlices( p_filter, 0 );
+        if( !p_sys->p_slices )
+        {
+            free( p_sys );
+            return VLC_ENOMEM;
+        }
+    }
+
 #if defined(CAN_COMPILE_C_ALTIVEC)
     if( pixel_size == 1 && vlc_CPU_ALTIVEC() )
         p_sys->pf_merge = MergeAltivec;
@@ -774,5 +786,7 @@ void Close( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t*)p_this;
 
     Flush( p_filter );
+    if( p_filter->p_sys->p_slices )
+        filter_DeleteSlices( p_filter->p_sys->p_slices );
     free( p_filter->p_sys );
 }
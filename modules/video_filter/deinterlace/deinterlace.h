@@ -35,6 +35,7 @@ struct vlc_object_t;
 
 #include <vlc_common.h>
 #include <vlc_mouse.h>
+#include <vlc_filter.h>
 
 /* Local algorithm headers */
 #include "algo_basic.h"
@@ -121,6 +122,9 @@ struct filter_sys_t
     /* Algorithm-specific substructures */
     phosphor_sys_t phosphor; /**< Phosphor algorithm state. */
     ivtc_sys_t ivtc;         /**< IVTC algorithm state. */
+
+    /** Slice worker threads, for the Yadif modes only (NULL otherwise). */
+    filter_slices_t *p_slices;
 };
 
 /*****************************************************************************
@@ -40,6 +40,17 @@ DECLARE_ASM_CONST(16, xmm_reg, pb_1) = {0x0101010101010101ULL, 0x010101010101010
 DECLARE_ASM_CONST(16, xmm_reg, pw_1) = {0x0001000100010001ULL, 0x0001000100010001ULL};
 
 
+#if defined(CAN_COMPILE_AVX2) && defined(__x86_64__)
+// ================ AVX2 =================
+/* The AVX2 version needs more registers than i386 has */
+#define HAVE_YADIF_AVX2
+#define COMPILE_TEMPLATE_AVX2 1
+#define RENAME(a) a ## _avx2
+#include "yadif_template.h"
+#undef COMPILE_TEMPLATE_AVX2
+#undef RENAME
+#endif
+
 #ifdef CAN_COMPILE_SSSE3
 #if defined(__SSE__) || VLC_GCC_VERSION(4, 4) || defined(__clang__)
 // ================ SSSE3 =================
@@ -30,6 +30,187 @@
              [mode] "g"(mode),
 #endif
 
+#ifdef COMPILE_TEMPLATE_AVX2
+/* The AVX2 version works on 16 pixels, widened to words as they are loaded
+ * (vpmovzxbw), so that no byte shuffle ever crosses the 128-bit lanes. */
+#define LOAD(mem,dst) \
+            "vpmovzxbw "mem", "dst" \n\t"
+
+#define ABSDIFF(a,b,dst) \
+            "vpsubw    "b", "a", "dst" \n\t"\
+            "vpabsw    "dst", "dst" \n\t"
+
+#define CHECK(pj,mj) \
+            LOAD(#pj"(%[cur],%[mrefs])", "%%ymm2") /* cur[x-refs-1+j] */\
+            LOAD(#mj"(%[cur],%[prefs])", "%%ymm3") /* cur[x+refs-1-j] */\
+            ABSDIFF("%%ymm2", "%%ymm3", "%%ymm2")\
+            LOAD(#pj"+1(%[cur],%[mrefs])", "%%ymm3") /* cur[x-refs+j] */\
+            LOAD(#mj"+1(%[cur],%[prefs])", "%%ymm4") /* cur[x+refs-j] */\
+            "vpaddw    %%ymm4, %%ymm3, %%ymm5 \n\t"\
+            "vpsrlw    $1, %%ymm5, %%ymm5 \n\t" /* (cur[x-refs+j] + cur[x+refs-j])>>1 */\
+            ABSDIFF("%%ymm3", "%%ymm4", "%%ymm3")\
+            "vpaddw    %%ymm3, %%ymm2, %%ymm2 \n\t"\
+            LOAD(#pj"+2(%[cur],%[mrefs])", "%%ymm3") /* cur[x-refs+1+j] */\
+            LOAD(#mj"+2(%[cur],%[prefs])", "%%ymm4") /* cur[x+refs+1-j] */\
+            ABSDIFF("%%ymm3", "%%ymm4", "%%ymm3")\
+            "vpaddw    %%ymm3, %%ymm2, %%ymm2 \n\t" /* score */
+
+#define CHECK1 \
+            "vpcmpgtw  %%ymm2, %%ymm0, %%ymm6 \n\t" /* if(score < spatial_score) */\
+            "vpminsw   %%ymm2, %%ymm0, %%ymm0 \n\t" /* spatial_score= score; */\
+            "vpblendvb %%ymm6, %%ymm5, %%ymm1, %%ymm1 \n\t" /* spatial_pred= ... */
+
+#define CHECK2 /* pretend not to have checked dir=2 if dir=1 was bad.\
+                  hurts both quality and speed, but matches the C version. */\
+            "vpsubw    %%ymm7, %%ymm6, %%ymm6 \n\t"\
+            "vpsllw    $14, %%ymm6, %%ymm6 \n\t"\
+            "vpaddsw   %%ymm6, %%ymm2, %%ymm2 \n\t"\
+            "vpcmpgtw  %%ymm2, %%ymm0, %%ymm3 \n\t"\
+            "vpminsw   %%ymm2, %%ymm0, %%ymm0 \n\t"\
+            "vpblendvb %%ymm3, %%ymm5, %%ymm1, %%ymm1 \n\t"
+
+static void RENAME(yadif_filter_line)(uint8_t *dst,
+                              uint8_t *prev, uint8_t *cur, uint8_t *next,
+                              int w, int prefs, int mrefs, int parity, int mode)
+{
+    uint8_t tmpU[5*32];
+    uint8_t *tmp= (uint8_t*)(((uintptr_t)(tmpU+31)) & ~31);
+    int x;
+
+#define FILTER\
+    for(x=0; x<w; x+=16){\
+        __asm__ volatile(\
+            "vpcmpeqw  %%ymm7, %%ymm7, %%ymm7 \n\t" /* -1 */\
+            LOAD("(%[cur],%[mrefs])", "%%ymm0") /* c = cur[x-refs] */\
+            LOAD("(%[cur],%[prefs])", "%%ymm1") /* e = cur[x+refs] */\
+            LOAD("(%["prev2"])", "%%ymm2") /* prev2[x] */\
+            LOAD("(%["next2"])", "%%ymm3") /* next2[x] */\
+            "vpaddw    %%ymm3, %%ymm2, %%ymm4 \n\t"\
+            "vpsraw    $1, %%ymm4, %%ymm4 \n\t" /* d = (prev2[x] + next2[x])>>1 */\
+            "vmovdqa   %%ymm0,   (%[tmp]) \n\t" /* c */\
+            "vmovdqa   %%ymm4, 32(%[tmp]) \n\t" /* d */\
+            "vmovdqa   %%ymm1, 64(%[tmp]) \n\t" /* e */\
+            ABSDIFF("%%ymm2", "%%ymm3", "%%ymm2") /* temporal_diff0 */\
+            LOAD("(%[prev],%[mrefs])", "%%ymm3") /* prev[x-refs] */\
+            LOAD("(%[prev],%[prefs])", "%%ymm4") /* prev[x+refs] */\
+            ABSDIFF("%%ymm3", "%%ymm0", "%%ymm3")\
+            ABSDIFF("%%ymm4", "%%ymm1", "%%ymm4")\
+            "vpaddw    %%ymm4, %%ymm3, %%ymm3 \n\t" /* temporal_diff1 */\
+            "vpsrlw    $1, %%ymm2, %%ymm2 \n\t"\
+            "vpsrlw    $1, %%ymm3, %%ymm3 \n\t"\
+            "vpmaxsw   %%ymm3, %%ymm2, %%ymm2 \n\t"\
+            LOAD("(%[next],%[mrefs])", "%%ymm3") /* next[x-refs] */\
+            LOAD("(%[next],%[prefs])", "%%ymm4") /* next[x+refs] */\
+            ABSDIFF("%%ymm3", "%%ymm0", "%%ymm3")\
+            ABSDIFF("%%ymm4", "%%ymm1", "%%ymm4")\
+            "vpaddw    %%ymm4, %%ymm3, %%ymm3 \n\t" /* temporal_diff2 */\
+            "vpsrlw    $1, %%ymm3, %%ymm3 \n\t"\
+            "vpmaxsw   %%ymm3, %%ymm2, %%ymm2 \n\t"\
+            "vmovdqa   %%ymm2, 96(%[tmp]) \n\t" /* diff */\
+\
+            ABSDIFF("%%ymm0", "%%ymm1", "%%ymm2") /* ABS(c-e) */\
+            "vpaddw    %%ymm1, %%ymm0, %%ymm1 \n\t"\
+            "vpsrlw    $1, %%ymm1, %%ymm1 \n\t" /* spatial_pred */\
+            LOAD("-1(%[cur],%[mrefs])", "%%ymm3") /* cur[x-refs-1] */\
+            LOAD("-1(%[cur],%[prefs])", "%%ymm4") /* cur[x+refs-1] */\
+            ABSDIFF("%%ymm3", "%%ymm4", "%%ymm3")\
+            "vpaddw    %%ymm3, %%ymm2, %%ymm2 \n\t"\
+            LOAD("1(%[cur],%[mrefs])", "%%ymm3") /* cur[x-refs+1] */\
+            LOAD("1(%[cur],%[prefs])", "%%ymm4") /* cur[x+refs+1] */\
+            ABSDIFF("%%ymm3", "%%ymm4", "%%ymm3")\
+            "vpaddw    %%ymm3, %%ymm2, %%ymm2 \n\t"\
+            "vpaddw    %%ymm7, %%ymm2, %%ymm0 \n\t" /* spatial_score */\
+\
+            CHECK(-2,0)\
+            CHECK1\
+            CHECK(-3,1)\
+            CHECK2\
+            CHECK(0,-2)\
+            CHECK1\
+            CHECK(1,-3)\
+            CHECK2\
+\
+            /* if(p->mode<2) ... */\
+            "vmovdqa   96(%[tmp]), %%ymm6 \n\t" /* diff */\
+            "cmpl      $2, %[mode] \n\t"\
+            "jge       1f \n\t"\
+            LOAD("(%["prev2"],%[mrefs],2)", "%%ymm2") /* prev2[x-2*refs] */\
+            LOAD("(%["next2"],%[mrefs],2)", "%%ymm4") /* next2[x-2*refs] */\
+            LOAD("(%["prev2"],%[prefs],2)", "%%ymm3") /* prev2[x+2*refs] */\
+            LOAD("(%["next2"],%[prefs],2)", "%%ymm5") /* next2[x+2*refs] */\
+            "vpaddw    %%ymm4, %%ymm2, %%ymm2 \n\t"\
+            "vpaddw    %%ymm5, %%ymm3, %%ymm3 \n\t"\
+            "vpsrlw    $1, %%ymm2, %%ymm2 \n\t" /* b */\
+            "vpsrlw    $1, %%ymm3, %%ymm3 \n\t" /* f */\
+            "vmovdqa     (%[tmp]), %%ymm4 \n\t" /* c */\
+            "vmovdqa   32(%[tmp]), %%ymm5 \n\t" /* d */\
+            "vmovdqa   64(%[tmp]), %%ymm7 \n\t" /* e */\
+            "vpsubw    %%ymm4, %%ymm2, %%ymm2 \n\t" /* b-c */\
+            "vpsubw    %%ymm7, %%ymm3, %%ymm3 \n\t" /* f-e */\
+            "vpsubw    %%ymm7, %%ymm5, %%ymm0 \n\t" /* d-e */\
+            "vpsubw    %%ymm4, %%ymm5, %%ymm5 \n\t" /* d-c */\
+            "vpminsw   %%ymm3, %%ymm2, %%ymm4 \n\t"\
+            "vpmaxsw   %%ymm3, %%ymm2, %%ymm3 \n\t"\
+            "vpmaxsw   %%ymm5, %%ymm4, %%ymm4 \n\t"\
+            "vpminsw   %%ymm5, %%ymm3, %%ymm3 \n\t"\
+            "vpmaxsw   %%ymm0, %%ymm4, %%ymm4 \n\t" /* max */\
+            "vpminsw   %%ymm0, %%ymm3, %%ymm3 \n\t" /* min */\
+            "vpmaxsw   %%ymm3, %%ymm6, %%ymm6 \n\t"\
+            "vpxor     %%ymm2, %%ymm2, %%ymm2 \n\t"\
+            "vpsubw    %%ymm4, %%ymm2, %%ymm2 \n\t" /* -max */\
+            "vpmaxsw   %%ymm2, %%ymm6, %%ymm6 \n\t" /* diff= MAX3(diff, min, -max); */\
+            "1: \n\t"\
+\
+            "vmovdqa   32(%[tmp]), %%ymm2 \n\t" /* d */\
+            "vpsubw    %%ymm6, %%ymm2, %%ymm3 \n\t" /* d-diff */\
+            "vpaddw    %%ymm6, %%ymm2, %%ymm4 \n\t" /* d+diff */\
+            "vpmaxsw   %%ymm3, %%ymm1, %%ymm1 \n\t"\
+            "vpminsw   %%ymm4, %%ymm1, %%ymm1 \n\t" /* d = clip(spatial_pred, d-diff, d+diff); */\
+            "vextracti128 $1, %%ymm1, %%xmm2 \n\t"\
+            "vpackuswb %%xmm2, %%xmm1, %%xmm1 \n\t"\
+            "vmovdqu   %%xmm1, (%[dst]) \n\t"\
+\
+            ::[prev] "r"(prev),\
+             [cur]  "r"(cur),\
+             [next] "r"(next),\
+             [prefs]"r"((x86_reg)prefs),\
+             [mrefs]"r"((x86_reg)mrefs),\
+             [mode] "rm"(mode),\
+             [tmp]  "r"(tmp),\
+             [dst]  "r"(dst)\
+            : "memory", "xmm0", "xmm1", "xmm2", "xmm3",\
+              "xmm4", "xmm5", "xmm6", "xmm7"\
+        );\
+        dst += 16;\
+        prev+= 16;\
+        cur += 16;\
+        next+= 16;\
+    }
+
+    if (parity) {
+#define prev2 "prev"
+#define next2 "cur"
+        FILTER
+#undef prev2
+#undef next2
+    } else {
+#define prev2 "cur"
+#define next2 "next"
+        FILTER
+#undef prev2
+#undef next2
+    }
+    __asm__ volatile ("vzeroupper");
+}
+#undef LOAD
+#undef ABSDIFF
+#undef CHECK
+#undef CHECK1
+#undef CHECK2
+#undef FILTER
+
+#else /* !COMPILE_TEMPLATE_AVX2 */
+
 #ifdef COMPILE_TEMPLATE_SSE
 #define REGMM "xmm"
 #define MM "%%"REGMM
@@ -280,3 +461,4 @@ VLC_TARGET static void RENAME(yadif_filter_line)(uint8_t *dst,
 #undef CHECK2
 #undef FILTER
 
+#endif /* !COMPILE_TEMPLATE_AVX2 */
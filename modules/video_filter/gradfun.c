@@ -88,6 +88,19 @@ vlc_module_end()
 #else
 #   define HAVE_SSSE3 0
 #endif
+#ifdef CAN_COMPILE_AVX2
+#   define HAVE_AVX2 1
+#   include <immintrin.h>
+#   define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+#else
+#   define HAVE_AVX2 0
+#endif
+#ifdef __ARM_NEON__
+#   define HAVE_NEON 1
+#   include <arm_neon.h>
+#else
+#   define HAVE_NEON 0
+#endif
 // FIXME too restrictive
 #ifdef __x86_64__
 #   define HAVE_6REGS 1
@@ -100,14 +113,52 @@ vlc_module_end()
 static picture_t *Filter(filter_t *, picture_t *);
 static int Callback(vlc_object_t *, char const *, vlc_value_t, vlc_value_t, void *);
 
+/* Minimal number of rows per band, in multiples of the radius, as each band
+ * recomputes the sums of the radius above it */
+#define BAND_ROWS_MIN (4)
+
 struct filter_sys_t {
     vlc_mutex_t      lock;
     float            strength;
     int              radius;
     const vlc_chroma_description_t *chroma;
     struct vf_priv_s cfg;
+    vlc_taskpool_t  *pool;
+    unsigned         bands;
+    size_t           band_size; /* elements of cfg.buf per band */
 };
 
+/* A plane to filter, split in bands */
+struct gradfun_plane {
+    struct vf_priv_s *cfg;
+    uint16_t *buf;
+    size_t    band_size;
+    uint8_t  *dst;
+    uint8_t  *src;
+    int       width;
+    int       height;
+    int       dstride;
+    int       sstride;
+    int       r;
+    int       bands;
+};
+
+static void FilterBands(void *data, unsigned first, unsigned last)
+{
+    const struct gradfun_plane *p = data;
+
+    for (int i = first; i < (int)last; i++) {
+        /* Bands start on even rows */
+        int y0 = 2 * ((p->height / 2) * i / p->bands);
+        int y1 = i + 1 < p->bands ? 2 * ((p->height / 2) * (i + 1) / p->bands)
+                                  : p->height;
+
+        filter_plane(p->cfg, p->buf + i * p->band_size, p->dst, p->src,
+                     p->width, p->height, p->dstride, p->sstride, p->r,
+                     y0, y1);
+    }
+}
+
 static int Open(vlc_object_t *object)
 {
     filter_t *filter = (filter_t *)object;
@@ -130,18 +181,35 @@ static int Open(vlc_object_t *object)
     var_AddCallback(filter, CFG_PREFIX "strength", Callback, NULL);
     var_AddCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
     sys->cfg.buf = NULL;
+    sys->pool    = vlc_taskpool_hold();
+    sys->bands   = sys->pool ? vlc_taskpool_count(sys->pool) + 1 : 1;
 
     struct vf_priv_s *cfg = &sys->cfg;
     cfg->thresh      = 0.0;
     cfg->radius      = 0;
     cfg->buf         = NULL;
 
+#if HAVE_AVX2
+    if (vlc_CPU_AVX2())
+        cfg->blur_line = blur_line_avx2;
+    else
+#endif
 #if HAVE_SSE2 && HAVE_6REGS
     if (vlc_CPU_SSE2())
         cfg->blur_line = blur_line_sse2;
     else
+#endif
+#if HAVE_NEON
+    if (vlc_CPU_ARM_NEON())
+        cfg->blur_line = blur_line_neon;
+    else
 #endif
         cfg->blur_line   = blur_line_c;
+#if HAVE_AVX2
+    if (vlc_CPU_AVX2())
+        cfg->filter_line = filter_line_avx2;
+    else
+#endif
 #if HAVE_SSSE3
     if (vlc_CPU_SSSE3())
         cfg->filter_line = filter_line_ssse3;
@@ -151,6 +219,11 @@ static int Open(vlc_object_t *object)
     if (vlc_CPU_MMXEXT())
         cfg->filter_line = filter_line_mmx2;
     else
+#endif
+#if HAVE_NEON
+    if (vlc_CPU_ARM_NEON())
+        cfg->filter_line = filter_line_neon;
+    else
 #endif
         cfg->filter_line = filter_line_c;
 
@@ -167,6 +240,8 @@ static void Close(vlc_object_t *object)
     var_DelCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
     var_DelCallback(filter, CFG_PREFIX "strength", Callback, NULL);
     vlc_free(sys->cfg.buf);
+    if (sys->pool)
+        vlc_taskpool_release(sys->pool);
     vlc_mutex_destroy(&sys->lock);
     free(sys);
 }
@@ -192,8 +267,9 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     cfg->thresh = (1 << 15) / strength;
     if (cfg->radius != radius) {
         cfg->radius = radius;
-        cfg->buf    = vlc_memalign(16,
-                                   (((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32) * sizeof(*cfg->buf));
+        sys->band_size = filter_buffer_size(fmt->i_width, cfg->radius);
+        vlc_free(cfg->buf);
+        cfg->buf    = vlc_memalign(16, sys->bands * sys->band_size * sizeof(*cfg->buf));
     }
 
     for (int i = 0; i < dst->i_planes; i++) {
@@ -207,8 +283,24 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
                  cfg->radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
         r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
         if (__MIN(w, h) > 2 * r && cfg->buf) {
-            filter_plane(cfg, dstp->p_pixels, srcp->p_pixels,
-                         w, h, dstp->i_pitch, srcp->i_pitch, r);
+            struct gradfun_plane plane = {
+                .cfg       = cfg,
+                .buf       = cfg->buf,
+                .band_size = sys->band_size,
+                .dst       = dstp->p_pixels,
+                .src       = srcp->p_pixels,
+                .width     = w,
+                .height    = h,
+                .dstride   = dstp->i_pitch,
+                .sstride   = srcp->i_pitch,
+                .r         = r,
+                .bands     = VLC_CLIP(h / (BAND_ROWS_MIN * r), 1, (int)sys->bands),
+            };
+            /* One band per index, each with its part of the buffer */
+            if (plane.bands > 1)
+                vlc_taskpool_for(sys->pool, plane.bands, FilterBands, &plane);
+            else
+                FilterBands(&plane, 0, 1);
         } else {
             plane_CopyPixels(dstp, srcp);
         }
@@ -222,45 +222,167 @@ static void blur_line_sse2(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
 }
 #endif // HAVE_6REGS && HAVE_SSE2
 
-static void filter_plane(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
-                         int width, int height, int dstride, int sstride, int r)
+#if HAVE_AVX2
+VLC_AVX2
+static void filter_line_avx2(uint8_t *dst, uint8_t *src, uint16_t *dc,
+                             int width, int thresh, const uint16_t *dithers)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i th   = _mm256_set1_epi16(thresh);
+    const __m256i c127 = _mm256_set1_epi16(127);
+    const __m256i dith = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)dithers));
+    int x;
+
+    /* Same arithmetic as the SSSE3 version, 16 pixels at a time */
+    for (x = 0; x + 16 <= width; x += 16) {
+        __m256i pix = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)&src[x]));
+        __m256i d   = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)&dc[x/2]));
+        d   = _mm256_or_si256(d, _mm256_slli_epi32(d, 16)); // one dc per 2 pixels
+        pix = _mm256_slli_epi16(pix, 7);
+        __m256i delta = _mm256_sub_epi16(d, pix);            // delta = dc - pix
+        __m256i m = _mm256_mulhi_epu16(_mm256_abs_epi16(delta), th);
+        m = _mm256_min_epi16(_mm256_sub_epi16(m, c127), zero); // m = -max(0, 127-m)
+        m = _mm256_slli_epi16(_mm256_mullo_epi16(m, m), 1);
+        pix = _mm256_add_epi16(pix, dith);                   // pix += dither
+        pix = _mm256_add_epi16(pix, _mm256_mulhrs_epi16(delta, m)); // pix += m*m*delta >> 14
+        pix = _mm256_srai_epi16(pix, 7);
+        pix = _mm256_permute4x64_epi64(_mm256_packus_epi16(pix, pix), 0xd8);
+        _mm_storeu_si128((__m128i *)&dst[x], _mm256_castsi256_si128(pix));
+    }
+    if (x < width)
+        filter_line_c(dst+x, src+x, dc+x/2, width-x, thresh, dithers);
+}
+
+VLC_AVX2
+static void blur_line_avx2(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
+                           uint8_t *src, int sstride, int width)
+{
+    const __m256i ones = _mm256_set1_epi8(1);
+    int x;
+
+    for (x = 0; x + 16 <= width; x += 16) {
+        __m256i s0 = _mm256_loadu_si256((const __m256i *)&src[2*x]);
+        __m256i s1 = _mm256_loadu_si256((const __m256i *)&src[2*x+sstride]);
+        __m256i v  = _mm256_add_epi16(_mm256_maddubs_epi16(s0, ones),
+                                      _mm256_maddubs_epi16(s1, ones));
+        v = _mm256_add_epi16(v, _mm256_loadu_si256((const __m256i *)&buf1[x]));
+        __m256i old = _mm256_loadu_si256((const __m256i *)&buf[x]);
+        _mm256_storeu_si256((__m256i *)&buf[x], v);
+        _mm256_storeu_si256((__m256i *)&dc[x], _mm256_sub_epi16(v, old));
+    }
+    if (x < width)
+        blur_line_c(dc+x, buf+x, buf1+x, src+2*x, sstride, width-x);
+}
+#endif // HAVE_AVX2
+
+#if HAVE_NEON
+static void filter_line_neon(uint8_t *dst, uint8_t *src, uint16_t *dc,
+                             int width, int thresh, const uint16_t *dithers)
+{
+    const uint16x4_t th   = vdup_n_u16(thresh);
+    const int16x8_t  c127 = vdupq_n_s16(127);
+    const int16x8_t  dith = vreinterpretq_s16_u16(vld1q_u16(dithers));
+    int x;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+        uint16x4_t d4 = vld1_u16(&dc[x/2]);
+        int16x8_t  d  = vreinterpretq_s16_u16(vcombine_u16(vzip_u16(d4, d4).val[0],
+                                                           vzip_u16(d4, d4).val[1]));
+        int16x8_t pix = vreinterpretq_s16_u16(vshll_n_u8(vld1_u8(&src[x]), 7));
+        int16x8_t delta = vsubq_s16(d, pix);               // delta = dc - pix
+        uint16x8_t a = vreinterpretq_u16_s16(vabsq_s16(delta));
+        int16x8_t m = vreinterpretq_s16_u16(vcombine_u16(
+                          vshrn_n_u32(vmull_u16(vget_low_u16(a), th), 16),
+                          vshrn_n_u32(vmull_u16(vget_high_u16(a), th), 16)));
+        m = vmaxq_s16(vsubq_s16(c127, m), vdupq_n_s16(0)); // m = max(0, 127-m)
+        m = vshlq_n_s16(vmulq_s16(m, m), 1);
+        pix = vaddq_s16(pix, dith);                        // pix += dither
+        pix = vaddq_s16(pix, vqrdmulhq_s16(delta, m));     // pix += m*m*delta >> 14
+        vst1_u8(&dst[x], vqshrun_n_s16(pix, 7));
+    }
+    if (x < width)
+        filter_line_c(dst+x, src+x, dc+x/2, width-x, thresh, dithers);
+}
+
+static void blur_line_neon(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
+                           uint8_t *src, int sstride, int width)
+{
+    int x;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+        uint16x8_t v = vaddq_u16(vpaddlq_u8(vld1q_u8(&src[2*x])),
+                                 vpaddlq_u8(vld1q_u8(&src[2*x+sstride])));
+        v = vaddq_u16(v, vld1q_u16(&buf1[x]));
+        uint16x8_t old = vld1q_u16(&buf[x]);
+        vst1q_u16(&buf[x], v);
+        vst1q_u16(&dc[x], vsubq_u16(v, old));
+    }
+    if (x < width)
+        blur_line_c(dc+x, buf+x, buf1+x, src+2*x, sstride, width-x);
+}
+#endif // HAVE_NEON
+
+/* Size in elements of the buffer needed by filter_plane() */
+static size_t filter_buffer_size(int width, int r)
+{
+    return ((width+15)&~15) * (r+1) / 2 + 32;
+}
+
+/* Vertical box sums of the half lines up to the one of row y, updated
+ * every other row from the previous ones. */
+static void blur_rows(struct vf_priv_s *ctx, uint16_t *dc, uint16_t *buf,
+                      uint8_t *src, int width, int sstride, int r, int y,
+                      uint32_t dc_factor)
+{
+    int bstride = ((width+15)&~15)/2;
+    int k = (y+r)/2;
+    int mod = k%r;
+    uint16_t *buf0 = buf+mod*bstride;
+    uint16_t *buf1 = buf+(mod?mod-1:r-1)*bstride;
+    int x, v;
+    ctx->blur_line(dc, buf0, buf1, src+2*k*sstride, sstride, width/2);
+    for (x=v=0; x<r; x++)
+        v += dc[x];
+    for (; x<width/2; x++) {
+        v += dc[x] - dc[x-r];
+        dc[x-r] = v * dc_factor >> 16;
+    }
+    for (; x<(width+r+1)/2; x++)
+        dc[x-r] = v * dc_factor >> 16;
+    for (x=-r/2; x<0; x++)
+        dc[x] = dc[0];
+}
+
+/* Filters the rows from first (even) to last (excluded) using its own
+ * buffer: the sums are primed from the r half lines above the first row,
+ * so that bands of the same plane can be filtered concurrently. */
+static void filter_plane(struct vf_priv_s *ctx, uint16_t *buffer,
+                         uint8_t *dst, uint8_t *src,
+                         int width, int height, int dstride, int sstride, int r,
+                         int first, int last)
 {
     int bstride = ((width+15)&~15)/2;
-    int y;
     uint32_t dc_factor = (1<<21)/(r*r);
-    uint16_t *dc = ctx->buf+16;
-    uint16_t *buf = ctx->buf+bstride+32;
+    uint16_t *dc = buffer+16;
+    uint16_t *buf = buffer+bstride+32;
     int thresh = ctx->thresh;
+    /* The sums are updated on rows r, r+2... below height-r */
+    int ymax = r + (height-2*r-1)/2*2;
+    int u = VLC_CLIP(first, r, ymax);
 
     memset(dc, 0, (bstride+16)*sizeof(*buf));
-    for (y=0; y<r; y++)
-        ctx->blur_line(dc, buf+y*bstride, buf+(y-1)*bstride, src+2*y*sstride, sstride, width/2);
-    for (;;) {
-        if (y < height-r) {
-            int mod = ((y+r)/2)%r;
-            uint16_t *buf0 = buf+mod*bstride;
-            uint16_t *buf1 = buf+(mod?mod-1:r-1)*bstride;
-            int x, v;
-            ctx->blur_line(dc, buf0, buf1, src+(y+r)*sstride, sstride, width/2);
-            for (x=v=0; x<r; x++)
-                v += dc[x];
-            for (; x<width/2; x++) {
-                v += dc[x] - dc[x-r];
-                dc[x-r] = v * dc_factor >> 16;
-            }
-            for (; x<(width+r+1)/2; x++)
-                dc[x-r] = v * dc_factor >> 16;
-            for (x=-r/2; x<0; x++)
-                dc[x] = dc[0];
-        }
-        if (y == r) {
-            for (y=0; y<r; y++)
-                ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
+    for (int k = (u-r)/2; k < (u+r)/2; k++)
+        ctx->blur_line(dc, buf+(k%r)*bstride,
+                       k == (u-r)/2 ? buf-bstride : buf+((k+r-1)%r)*bstride,
+                       src+2*k*sstride, sstride, width/2);
+    blur_rows(ctx, dc, buf, src, width, sstride, r, u, dc_factor);
+
+    for (int y = first; y < last; y++) {
+        if (!(y&1) && y > u && y <= ymax) {
+            u = y;
+            blur_rows(ctx, dc, buf, src, width, sstride, r, u, dc_factor);
         }
         ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
-        if (++y >= height) break;
-        ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
-        if (++y >= height) break;
     }
 }
 
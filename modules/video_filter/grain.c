@@ -38,6 +38,14 @@
 
 #include <vlc_rand.h>
 
+#ifdef CAN_COMPILE_AVX2
+# include <immintrin.h>
+# define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
+#ifdef __ARM_NEON__
+# include <arm_neon.h>
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -95,6 +103,8 @@ struct filter_sys_t {
                   const int16_t *noise);
     void (*emms)(void);
 
+    vlc_taskpool_t *pool;
+
     struct {
         vlc_mutex_t lock;
         double      variance;
@@ -199,6 +209,44 @@ static void Emms(void)
 }
 #endif
 
+#ifdef CAN_COMPILE_AVX2
+VLC_AVX2
+static void BlockBlendAvx2(uint8_t *dst, size_t dst_pitch,
+                           const uint8_t *src, size_t src_pitch,
+                           const int16_t *noise)
+{
+    /* Two lines at a time */
+    for (int i = 0; i < BLEND_SIZE; i += 2) {
+        __m128i s = _mm_unpacklo_epi64(
+            _mm_loadl_epi64((const __m128i *)&src[(i+0) * src_pitch]),
+            _mm_loadl_epi64((const __m128i *)&src[(i+1) * src_pitch]));
+        __m256i n = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(
+                _mm_loadu_si128((const __m128i *)&noise[(i+0) * BANK_SIZE])),
+            _mm_loadu_si128((const __m128i *)&noise[(i+1) * BANK_SIZE]), 1);
+        __m256i v = _mm256_adds_epi16(_mm256_cvtepu8_epi16(s), n);
+        __m128i d = _mm_packus_epi16(_mm256_castsi256_si128(v),
+                                     _mm256_extracti128_si256(v, 1));
+        _mm_storel_epi64((__m128i *)&dst[(i+0) * dst_pitch], d);
+        _mm_storel_epi64((__m128i *)&dst[(i+1) * dst_pitch],
+                         _mm_srli_si128(d, 8));
+    }
+}
+#endif
+
+#ifdef __ARM_NEON__
+static void BlockBlendNeon(uint8_t *dst, size_t dst_pitch,
+                           const uint8_t *src, size_t src_pitch,
+                           const int16_t *noise)
+{
+    for (int i = 0; i < BLEND_SIZE; i++) {
+        int16x8_t v = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&src[i * src_pitch])));
+        v = vqaddq_s16(v, vld1q_s16(&noise[i * BANK_SIZE]));
+        vst1_u8(&dst[i * dst_pitch], vqmovun_s16(v));
+    }
+}
+#endif
+
 /**
  * Scale the given signed data (on 7 bits + 1 for sign) using scale on 8 bits.
  */
@@ -220,17 +268,33 @@ static void Scale(int16_t *dst, int16_t *src, int scale)
     }
 }
 
-static void PlaneFilter(filter_t *filter,
-                        plane_t *dst, const plane_t *src,
-                        int16_t *bank, uint32_t *seed)
+/* A plane to filter, by lines of blocks */
+struct grain_plane {
+    filter_sys_t  *sys;
+    plane_t       *dst;
+    const plane_t *src;
+    const int16_t *bank;
+    uint32_t       seed;
+};
+
+static void PlaneFilterLines(void *data, unsigned first, unsigned last)
 {
-    filter_sys_t *sys = filter->p_sys;
+    const struct grain_plane *p = data;
+    filter_sys_t  *sys = p->sys;
+    plane_t       *dst = p->dst;
+    const plane_t *src = p->src;
+
+    for (int y = first * BLEND_SIZE; y < (int)last * BLEND_SIZE; y += BLEND_SIZE) {
+        /* Each line of blocks has its own generator, so that the lines can
+         * be filtered in any order */
+        uint32_t seed = p->seed + (y / BLEND_SIZE) * UINT32_C(0x9E3779B9);
+        if (seed == 0)
+            seed = URAND_SEED;
 
-    for (int y = 0; y < dst->i_visible_lines; y += BLEND_SIZE) {
         for (int x = 0; x < dst->i_visible_pitch; x += BLEND_SIZE) {
-            int bx = urand(seed) % (BANK_SIZE - BLEND_SIZE + 1);
-            int by = urand(seed) % (BANK_SIZE - BLEND_SIZE + 1);
-            const int16_t *noise = &bank[by * BANK_SIZE + bx];
+            int bx = urand(&seed) % (BANK_SIZE - BLEND_SIZE + 1);
+            int by = urand(&seed) % (BANK_SIZE - BLEND_SIZE + 1);
+            const int16_t *noise = &p->bank[by * BANK_SIZE + bx];
 
             int w  = dst->i_visible_pitch - x;
             int h  = dst->i_visible_lines - y;
@@ -249,6 +313,26 @@ static void PlaneFilter(filter_t *filter,
         sys->emms();
 }
 
+static void PlaneFilter(filter_t *filter,
+                        plane_t *dst, const plane_t *src,
+                        int16_t *bank, uint32_t *seed)
+{
+    filter_sys_t *sys = filter->p_sys;
+    struct grain_plane plane = {
+        .sys  = sys,
+        .dst  = dst,
+        .src  = src,
+        .bank = bank,
+        .seed = urand(seed),
+    };
+    unsigned lines = (dst->i_visible_lines + BLEND_SIZE - 1) / BLEND_SIZE;
+
+    if (sys->pool)
+        vlc_taskpool_for(sys->pool, lines, PlaneFilterLines, &plane);
+    else
+        PlaneFilterLines(&plane, 0, lines);
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     filter_sys_t *sys = filter->p_sys;
@@ -414,6 +498,17 @@ static int Open(vlc_object_t *object)
         sys->emms  = Emms;
     }
 #endif
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2()) {
+        sys->blend = BlockBlendAvx2;
+        sys->emms  = NULL;
+    }
+#endif
+#ifdef __ARM_NEON__
+    if (vlc_CPU_ARM_NEON())
+        sys->blend = BlockBlendNeon;
+#endif
+    sys->pool = vlc_taskpool_hold();
 
     vlc_mutex_init(&sys->cfg.lock);
     sys->cfg.variance = var_CreateGetFloatCommand(filter, CFG_PREFIX "variance");
@@ -430,6 +525,8 @@ static void Close(vlc_object_t *object)
     filter_sys_t *sys    = filter->p_sys;
 
     var_DelCallback(filter, CFG_PREFIX "variance", Callback, NULL);
+    if (sys->pool)
+        vlc_taskpool_release(sys->pool);
     vlc_mutex_destroy(&sys->cfg.lock);
     free(sys);
 }
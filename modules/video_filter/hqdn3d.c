@@ -95,6 +95,8 @@ struct filter_sys_t
     bool   b_recalc_coefs;
     vlc_mutex_t coefs_mutex;
     float  luma_spat, luma_temp, chroma_spat, chroma_temp;
+
+    filter_slices_t *slices;
 };
 
 /*****************************************************************************
@@ -137,8 +139,21 @@ static int Open(vlc_object_t *this)
         if (sys->w[i] > wmax) wmax = sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
     }
-    cfg->Line = malloc(wmax*sizeof(unsigned int));
-    if (!cfg->Line) {
+    /* One line buffer per plane, as the planes are filtered concurrently */
+    for (int i = 0; i < 3; ++i) {
+        cfg->Line[i] = malloc(wmax*sizeof(unsigned int));
+        if (!cfg->Line[i]) {
+            for (int j = 0; j < i; ++j)
+                free(cfg->Line[j]);
+            free(sys);
+            return VLC_ENOMEM;
+        }
+    }
+
+    sys->slices = filter_NewSlices(filter, 0);
+    if (!sys->slices) {
+        for (int i = 0; i < 3; ++i)
+            free(cfg->Line[i]);
         free(sys);
         return VLC_ENOMEM;
     }
@@ -179,18 +194,72 @@ static void Close(vlc_object_t *this)
     var_DelCallback( filter, FILTER_PREFIX "luma-temp", DenoiseCallback, sys );
     var_DelCallback( filter, FILTER_PREFIX "chroma-temp", DenoiseCallback, sys );
 
+    filter_DeleteSlices(sys->slices);
     vlc_mutex_destroy( &sys->coefs_mutex );
 
     for (int i = 0; i < 3; ++i) {
         free(cfg->Frame[i]);
+        free(cfg->Line[i]);
     }
-    free(cfg->Line);
     free(sys);
 }
 
 /*****************************************************************************
  * Filter
  *****************************************************************************/
+typedef struct
+{
+    picture_t    *src;
+    picture_t    *dst;
+    filter_sys_t *sys;
+} hqdn3d_ctx_t;
+
+/* Coefficient tables of a plane: spatial, then temporal */
+static int *PlaneCoefs(struct vf_priv_s *cfg, int plane, bool temporal)
+{
+    return cfg->Coefs[(plane ? 2 : 0) + temporal];
+}
+
+/* Filters a whole plane: the spatial filter is recursive both along and
+ * across the lines, so a plane cannot be split without changing its output */
+static void FilterPlane(void *opaque, unsigned plane, unsigned planes)
+{
+    const hqdn3d_ctx_t *ctx = opaque;
+    filter_sys_t *sys = ctx->sys;
+    struct vf_priv_s *cfg = &sys->cfg;
+    const plane_t *src = &ctx->src->p[plane];
+    const plane_t *dst = &ctx->dst->p[plane];
+    int *spatial = PlaneCoefs(cfg, plane, false);
+    VLC_UNUSED(planes);
+
+    deNoise(src->p_pixels, dst->p_pixels,
+            cfg->Line[plane], &cfg->Frame[plane], sys->w[plane], sys->h[plane],
+            src->i_pitch, dst->i_pitch,
+            spatial, spatial, PlaneCoefs(cfg, plane, true));
+}
+
+/* Filters one band of lines of every plane, with the temporal filter only:
+ * the pixels are then independent from one another */
+static void FilterTemporalSlice(void *opaque, unsigned slice, unsigned slices)
+{
+    const hqdn3d_ctx_t *ctx = opaque;
+    filter_sys_t *sys = ctx->sys;
+    struct vf_priv_s *cfg = &sys->cfg;
+
+    for (int i = 0; i < 3; ++i) {
+        const plane_t *src = &ctx->src->p[i];
+        const plane_t *dst = &ctx->dst->p[i];
+        int first, end;
+
+        filter_GetSliceLines(sys->h[i], slice, slices, &first, &end);
+        deNoiseTemporal(src->p_pixels + first * src->i_pitch,
+                        dst->p_pixels + first * dst->i_pitch,
+                        cfg->Frame[i] + first * sys->w[i],
+                        sys->w[i], end - first, src->i_pitch, dst->i_pitch,
+                        PlaneCoefs(cfg, i, true));
+    }
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     picture_t *dst;
@@ -220,24 +289,22 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     }
     vlc_mutex_unlock( &sys->coefs_mutex );
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
+    for (int i = 0; i < 3; ++i) {
+        if (!deNoisePrevFrame(src->p[i].p_pixels, &cfg->Frame[i],
+                              sys->w[i], sys->h[i], src->p[i].i_pitch)) {
+            picture_Release(dst);
+            picture_Release(src);
+            return NULL;
+        }
+    }
+
+    hqdn3d_ctx_t ctx = { .src = src, .dst = dst, .sys = sys };
+
+    /* The Ct[0] entry of a table tells whether the filter is enabled */
+    if (!cfg->Coefs[0][0] && !cfg->Coefs[2][0])
+        filter_RunSlices(sys->slices, sys->h[0], FilterTemporalSlice, &ctx);
+    else
+        filter_RunTasks(sys->slices, 3, FilterPlane, &ctx);
 
     return CopyInfoAndRelease(dst, src);
 }
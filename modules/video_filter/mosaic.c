@@ -403,6 +403,17 @@ static void DestroyFilter( vlc_object_t *p_this )
 
     if( !p_sys->b_keep )
     {
+        /* Stop the bridges scaling for us */
+        vlc_global_lock( VLC_MOSAIC_MUTEX );
+        bridge_t *p_bridge = GetBridge( p_filter );
+        if( p_bridge != NULL )
+            for( int i_index = 0; i_index < p_bridge->i_es_num; i_index++ )
+            {
+                p_bridge->pp_es[i_index]->i_tile_width = 0;
+                p_bridge->pp_es[i_index]->i_tile_height = 0;
+            }
+        vlc_global_unlock( VLC_MOSAIC_MUTEX );
+
         image_HandlerDelete( p_sys->p_image );
     }
 
@@ -586,37 +597,36 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
         i_col = i_real_index % p_sys->i_cols ;
 
         if ( !p_sys->b_keep )
+        {
+            /* Let the bridge scale the next pictures on its own thread */
+            p_es->i_tile_width = col_inner_width;
+            p_es->i_tile_height = row_inner_height;
+            p_es->b_tile_ar = p_sys->b_ar;
+        }
+
+        if ( p_sys->b_keep
+          || mosaic_TileFits( &p_es->p_picture->format, col_inner_width,
+                              row_inner_height, p_sys->b_ar ) )
+        {
+            /* Blend the picture as is */
+            p_converted = picture_Hold( p_es->p_picture );
+            fmt_in.i_width = fmt_out.i_width = p_converted->format.i_width;
+            fmt_in.i_height = fmt_out.i_height = p_converted->format.i_height;
+            fmt_in.i_chroma = fmt_out.i_chroma = p_converted->format.i_chroma;
+            fmt_out.i_visible_width = fmt_out.i_width;
+            fmt_out.i_visible_height = fmt_out.i_height;
+        }
+        else
         {
             /* Convert the images */
             fmt_in.i_chroma = p_es->p_picture->format.i_chroma;
             fmt_in.i_height = p_es->p_picture->format.i_height;
             fmt_in.i_width = p_es->p_picture->format.i_width;
+            fmt_in.i_visible_width = p_es->p_picture->format.i_visible_width;
+            fmt_in.i_visible_height = p_es->p_picture->format.i_visible_height;
 
-            if( fmt_in.i_chroma == VLC_CODEC_YUVA ||
-                fmt_in.i_chroma == VLC_CODEC_RGBA )
-                fmt_out.i_chroma = VLC_CODEC_YUVA;
-            else
-                fmt_out.i_chroma = VLC_CODEC_I420;
-            fmt_out.i_width = col_inner_width;
-            fmt_out.i_height = row_inner_height;
-
-            if( p_sys->b_ar ) /* keep aspect ratio */
-            {
-                if( (float)fmt_out.i_width / (float)fmt_out.i_height
-                      > (float)fmt_in.i_width / (float)fmt_in.i_height )
-                {
-                    fmt_out.i_width = ( fmt_out.i_height * fmt_in.i_width )
-                                         / fmt_in.i_height;
-                }
-                else
-                {
-                    fmt_out.i_height = ( fmt_out.i_width * fmt_in.i_height )
-                                        / fmt_in.i_width;
-                }
-             }
-
-            fmt_out.i_visible_width = fmt_out.i_width;
-            fmt_out.i_visible_height = fmt_out.i_height;
+            mosaic_TileFormat( &fmt_out, &fmt_in, col_inner_width,
+                               row_inner_height, p_sys->b_ar );
 
             p_converted = image_Convert( p_sys->p_image, p_es->p_picture,
                                          &fmt_in, &fmt_out );
@@ -627,21 +637,14 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
                 continue;
             }
         }
-        else
-        {
-            p_converted = p_es->p_picture;
-            fmt_in.i_width = fmt_out.i_width = p_converted->format.i_width;
-            fmt_in.i_height = fmt_out.i_height = p_converted->format.i_height;
-            fmt_in.i_chroma = fmt_out.i_chroma = p_converted->format.i_chroma;
-            fmt_out.i_visible_width = fmt_out.i_width;
-            fmt_out.i_visible_height = fmt_out.i_height;
-        }
 
         p_region = subpicture_region_New( &fmt_out );
-        /* FIXME the copy is probably not needed anymore */
         if( p_region )
-            picture_Copy( p_region->p_picture, p_converted );
-        if( !p_sys->b_keep )
+        {
+            picture_Release( p_region->p_picture );
+            p_region->p_picture = p_converted;
+        }
+        else
             picture_Release( p_converted );
 
         if( !p_region )
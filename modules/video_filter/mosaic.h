@@ -33,6 +33,12 @@ typedef struct bridged_es_t
     int i_alpha;
     int i_x;
     int i_y;
+
+    /* Tile area requested by the mosaic filter, or 0 if unknown. The bridge
+     * scales its pictures to it, so that the filter need not do it. */
+    unsigned i_tile_width;
+    unsigned i_tile_height;
+    bool b_tile_ar;
 } bridged_es_t;
 
 typedef struct bridge_t
@@ -46,3 +52,58 @@ static bridge_t *GetBridge( vlc_object_t *p_object )
     return var_GetAddress(VLC_OBJECT(p_object->p_libvlc), "mosaic-struct");
 }
 #define GetBridge(a) GetBridge( VLC_OBJECT(a) )
+
+/**
+ * Computes the format of a picture once scaled to fit a mosaic tile.
+ * Both the mosaic filter and the bridge use this, so that pictures scaled
+ * by the bridge can be blended as they are.
+ */
+static inline void mosaic_TileFormat( video_format_t *p_fmt_out,
+                                      const video_format_t *p_fmt_in,
+                                      unsigned i_width, unsigned i_height,
+                                      bool b_ar )
+{
+    memset( p_fmt_out, 0, sizeof( *p_fmt_out ) );
+
+    if( p_fmt_in->i_chroma == VLC_CODEC_YUVA ||
+        p_fmt_in->i_chroma == VLC_CODEC_RGBA )
+        p_fmt_out->i_chroma = VLC_CODEC_YUVA;
+    else
+        p_fmt_out->i_chroma = VLC_CODEC_I420;
+    p_fmt_out->i_width = i_width;
+    p_fmt_out->i_height = i_height;
+
+    if( b_ar ) /* keep aspect ratio */
+    {
+        if( (float)p_fmt_out->i_width / (float)p_fmt_out->i_height
+              > (float)p_fmt_in->i_width / (float)p_fmt_in->i_height )
+        {
+            p_fmt_out->i_width = ( p_fmt_out->i_height * p_fmt_in->i_width )
+                                 / p_fmt_in->i_height;
+        }
+        else
+        {
+            p_fmt_out->i_height = ( p_fmt_out->i_width * p_fmt_in->i_height )
+                                  / p_fmt_in->i_width;
+        }
+    }
+
+    p_fmt_out->i_visible_width = p_fmt_out->i_width;
+    p_fmt_out->i_visible_height = p_fmt_out->i_height;
+}
+
+/**
+ * Checks whether a picture already fits a mosaic tile.
+ */
+static inline bool mosaic_TileFits( const video_format_t *p_fmt,
+                                    unsigned i_width, unsigned i_height,
+                                    bool b_ar )
+{
+    if( p_fmt->i_chroma != VLC_CODEC_I420 && p_fmt->i_chroma != VLC_CODEC_YUVA )
+        return false;
+    if( p_fmt->i_width > i_width || p_fmt->i_height > i_height )
+        return false;
+    if( b_ar )
+        return p_fmt->i_width == i_width || p_fmt->i_height == i_height;
+    return p_fmt->i_width == i_width && p_fmt->i_height == i_height;
+}
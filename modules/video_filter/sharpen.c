@@ -90,6 +90,7 @@ struct filter_sys_t
 {
     vlc_mutex_t lock;
     int tab_precalc[512];
+    filter_slices_t *p_slices;
 };
 
 /*****************************************************************************
@@ -129,6 +130,13 @@ static int Create( vlc_object_t *p_this )
     if( p_filter->p_sys == NULL )
         return VLC_ENOMEM;
 
+    p_filter->p_sys->p_slices = filter_NewSlices( p_filter, 0 );
+    if( p_filter->p_sys->p_slices == NULL )
+    {
+        free( p_filter->p_sys );
+        return VLC_ENOMEM;
+    }
+
     p_filter->pf_video_filter = Filter;
 
     config_ChainParse( p_filter, FILTER_PREFIX, ppsz_filter_options,
@@ -156,51 +164,49 @@ static void Destroy( vlc_object_t *p_this )
     filter_sys_t *p_sys = p_filter->p_sys;
 
     var_DelCallback( p_filter, FILTER_PREFIX "sigma", SharpenCallback, p_sys );
+    filter_DeleteSlices( p_sys->p_slices );
     vlc_mutex_destroy( &p_sys->lock );
     free( p_sys );
 }
 
 /*****************************************************************************
- * Render: displays previously rendered output
- *****************************************************************************
- * This function send the currently rendered image to Invert image, waits
- * until it is displayed and switch the two rendering buffers, preparing next
- * frame.
+ * FilterSlice: sharpens one band of lines of the Y plane
  *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+typedef struct
 {
-    picture_t *p_outpic;
-    uint8_t *restrict p_src = NULL;
-    uint8_t *restrict p_out = NULL;
-    int i_src_pitch;
-    int i_out_pitch;
+    const plane_t *p_src;
+    plane_t       *p_dst;
+    int            sigma;
+} sharpen_slice_t;
+
+static void FilterSlice( void *opaque, unsigned i_slice, unsigned i_slices )
+{
+    const sharpen_slice_t *p_ctx = opaque;
+    const uint8_t *restrict p_src = p_ctx->p_src->p_pixels;
+    uint8_t *restrict p_out = p_ctx->p_dst->p_pixels;
+    const int i_src_pitch = p_ctx->p_src->i_pitch;
+    const int i_out_pitch = p_ctx->p_dst->i_pitch;
+    const int sigma = p_ctx->sigma;
     int pix;
     const int v1 = -1;
     const int v2 = 3; /* 2^3 = 8 */
-    const unsigned i_visible_lines = p_pic->p[Y_PLANE].i_visible_lines;
-    const unsigned i_visible_pitch = p_pic->p[Y_PLANE].i_visible_pitch;
-    const int sigma = var_GetFloat( p_filter, FILTER_PREFIX "sigma" ) * (1 << 20);
-
-    p_outpic = filter_NewPicture( p_filter );
-    if( !p_outpic )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-
-    /* process the Y plane */
-    p_src = p_pic->p[Y_PLANE].p_pixels;
-    p_out = p_outpic->p[Y_PLANE].p_pixels;
-    i_src_pitch = p_pic->p[Y_PLANE].i_pitch;
-    i_out_pitch = p_outpic->p[Y_PLANE].i_pitch;
+    const int i_visible_lines = p_ctx->p_src->i_visible_lines;
+    const unsigned i_visible_pitch = p_ctx->p_src->i_visible_pitch;
+    int i_first, i_end;
 
-    /* perform convolution only on Y plane. Avoid border line. */
-    vlc_mutex_lock( &p_filter->p_sys->lock );
+    filter_GetSliceLines( i_visible_lines, i_slice, i_slices,
+                          &i_first, &i_end );
 
-    memcpy(p_out, p_src, i_visible_pitch);
-
-    for( unsigned i = 1; i < i_visible_lines - 1; i++ )
+    /* Avoid border line. */
+    for( int i = i_first; i < i_end; i++ )
     {
+        if( i == 0 || i == i_visible_lines - 1 )
+        {
+            memcpy( &p_out[i * i_out_pitch], &p_src[i * i_src_pitch],
+                    i_visible_pitch );
+            continue;
+        }
+
         p_out[i * i_out_pitch] = p_src[i * i_src_pitch];
 
         for( unsigned j = 1; j < i_visible_pitch - 1; j++ )
@@ -223,10 +229,38 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         p_out[i * i_out_pitch + i_visible_pitch - 1] =
             p_src[i * i_src_pitch + i_visible_pitch - 1];
     }
-    memcpy(&p_out[(i_visible_lines - 1) * i_out_pitch],
-           &p_src[(i_visible_lines - 1) * i_src_pitch], i_visible_pitch);
+}
+
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************
+ * This function send the currently rendered image to Invert image, waits
+ * until it is displayed and switch the two rendering buffers, preparing next
+ * frame.
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    picture_t *p_outpic;
+
+    p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
 
-    vlc_mutex_unlock( &p_filter->p_sys->lock );
+    sharpen_slice_t ctx = {
+        .p_src = &p_pic->p[Y_PLANE],
+        .p_dst = &p_outpic->p[Y_PLANE],
+        .sigma = var_GetFloat( p_filter, FILTER_PREFIX "sigma" ) * (1 << 20),
+    };
+
+    /* perform convolution only on Y plane, one band of lines per thread. */
+    vlc_mutex_lock( &p_sys->lock );
+    filter_RunSlices( p_sys->p_slices, ctx.p_src->i_visible_lines,
+                      FilterSlice, &ctx );
+    vlc_mutex_unlock( &p_sys->lock );
 
     plane_CopyPixels( &p_outpic->p[U_PLANE], &p_pic->p[U_PLANE] );
     plane_CopyPixels( &p_outpic->p[V_PLANE], &p_pic->p[V_PLANE] );
@@ -134,6 +134,7 @@ static int Open (vlc_object_t *obj)
     vd->sys = sys;
     vd->info.has_pictures_invalid = false;
     vd->info.has_event_thread = false;
+    vd->info.has_deinterlace = true;
     vd->info.subpicture_chromas = spu_chromas;
     vd->pool = Pool;
     vd->prepare = PictureRender;
@@ -249,6 +250,12 @@ static int Control (vout_display_t *vd, int query, va_list ap)
         vlc_gl_ReleaseCurrent (sys->gl);
         return VLC_SUCCESS;
       }
+
+      case VOUT_DISPLAY_CHANGE_DEINTERLACE:
+      {
+        const char *mode = va_arg (ap, const char *);
+        return vout_display_opengl_SetDeinterlace (sys->vgl, mode);
+      }
       default:
         msg_Err (vd, "Unknown request %d", query);
     }
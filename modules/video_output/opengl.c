@@ -39,9 +39,17 @@
 
 #include "opengl.h"
 
+#ifdef HAVE_GL_VDPAU
+# include <vlc_vout_window.h>
+# include "../hw/vdpau/vlc_vdpau.h"
+#endif
+
 #ifndef GL_CLAMP_TO_EDGE
 # define GL_CLAMP_TO_EDGE 0x812F
 #endif
+#ifndef GL_READ_ONLY
+# define GL_READ_ONLY 0x88B8
+#endif
 
 #if USE_OPENGL_ES == 2 || defined(__APPLE__)
 #   define PFNGLGETPROGRAMIVPROC             typeof(glGetProgramiv)*
@@ -93,14 +101,25 @@
 #   define PRECISION ""
 #   define SUPPORTS_SHADERS
 #   define SUPPORTS_FIXED_PIPELINE
+#if defined(GL_ARB_buffer_storage) && defined(GL_ARB_sync)
+#   define SUPPORTS_PBO
+#endif
+#endif
+
+#ifdef SUPPORTS_PBO
+/* Pictures held until the GPU has read them, after the upload */
+#   define VLCGL_PBO_HELD_MAX 4
 #endif
 
 typedef struct {
     GLuint   texture;
+    picture_t *picture; /* held source of the texture content */
     unsigned format;
     unsigned type;
     unsigned width;
     unsigned height;
+    unsigned x_offset;
+    unsigned y_offset;
 
     float    alpha;
 
@@ -142,12 +161,37 @@ struct vout_display_opengl_t {
     int        local_count;
     GLfloat    local_value[16];
 
+    /* Deinterlacing done by the YUV fragment shader */
+    int        deinterlace; /* 0: none, 1: bob, 2: linear, 3: edge directed */
+    int        field;       /* field kept from the last prepared picture */
+
     GLuint vertex_buffer_object;
     GLuint texture_buffer_object[PICTURE_PLANE_MAX];
 
     GLuint *subpicture_buffer_object;
     int    subpicture_buffer_object_count;
 
+#ifdef HAVE_GL_VDPAU
+    /* GL_NV_vdpau_interop: the pictures are VDPAU output surfaces, each one
+     * registered once as a texture and mapped while it is being displayed */
+    vdp_t           *vdp;
+    VdpDevice        vdp_device;
+    unsigned         vdp_count;
+    int              vdp_mapped; /* index of the mapped surface, or -1 */
+    VdpOutputSurface vdp_surface[VLCGL_PICTURE_MAX];
+    GLuint           vdp_texture[VLCGL_PICTURE_MAX];
+    intptr_t         vdp_gl_surface[VLCGL_PICTURE_MAX]; /* GLvdpauSurfaceNV */
+
+    void     (*VDPAUInitNV)(const void *, const void *);
+    void     (*VDPAUFiniNV)(void);
+    intptr_t (*VDPAURegisterOutputSurfaceNV)(const void *, GLenum, GLsizei,
+                                             const GLuint *);
+    void     (*VDPAUUnregisterSurfaceNV)(intptr_t);
+    void     (*VDPAUSurfaceAccessNV)(intptr_t, GLenum);
+    void     (*VDPAUMapSurfacesNV)(GLsizei, const intptr_t *);
+    void     (*VDPAUUnmapSurfacesNV)(GLsizei, const intptr_t *);
+#endif
+
     /* Shader variables commands*/
 #ifdef SUPPORTS_SHADERS
     PFNGLGETUNIFORMLOCATIONPROC      GetUniformLocation;
@@ -199,8 +243,30 @@ struct vout_display_opengl_t {
 
     uint8_t *texture_temp_buf;
     int      texture_temp_buf_size;
+
+#ifdef SUPPORTS_PBO
+    /* Persistently mapped pixel buffer objects: the decoder renders into
+     * the pictures of the pool directly, and the texture upload from them
+     * is asynchronous. A picture is held until the fence after its upload
+     * is signaled, so that it is not rendered into while it is read. */
+    PFNGLBUFFERSTORAGEPROC  BufferStorage;
+    PFNGLMAPBUFFERRANGEPROC MapBufferRange;
+    PFNGLFENCESYNCPROC      FenceSync;
+    PFNGLCLIENTWAITSYNCPROC ClientWaitSync;
+    PFNGLDELETESYNCPROC     DeleteSync;
+
+    unsigned pbo_count;
+    GLuint   pbo[VLCGL_PICTURE_MAX];
+    uint8_t *pbo_base[VLCGL_PICTURE_MAX]; /* mapping of each buffer */
+
+    unsigned   pbo_held_count;
+    picture_t *pbo_held[VLCGL_PBO_HELD_MAX]; /* oldest first */
+    GLsync     pbo_fence[VLCGL_PBO_HELD_MAX];
+#endif
 };
 
+#define ALIGN(x, y) (((x) + ((y) - 1)) & ~((y) - 1))
+
 static inline int GetAlignedSize(unsigned size)
 {
     /* Return the smallest larger or equal power of 2 */
@@ -226,6 +292,185 @@ static bool IsLuminance16Supported(int target)
 }
 #endif
 
+#ifdef HAVE_GL_VDPAU
+static bool OpenVDPAU(vout_display_opengl_t *vgl, const video_format_t *fmt,
+                      const char *extensions)
+{
+    if (fmt->i_chroma != VLC_CODEC_VDPAU_VIDEO_420
+     && fmt->i_chroma != VLC_CODEC_VDPAU_VIDEO_422
+     && fmt->i_chroma != VLC_CODEC_VDPAU_VIDEO_444
+     && fmt->i_chroma != VLC_CODEC_VDPAU_OUTPUT)
+        return false;
+    if (!HasExtension(extensions, "GL_NV_vdpau_interop"))
+        return false;
+
+    vgl->VDPAUInitNV = vlc_gl_GetProcAddress(vgl->gl, "glVDPAUInitNV");
+    vgl->VDPAUFiniNV = vlc_gl_GetProcAddress(vgl->gl, "glVDPAUFiniNV");
+    vgl->VDPAURegisterOutputSurfaceNV =
+        vlc_gl_GetProcAddress(vgl->gl, "glVDPAURegisterOutputSurfaceNV");
+    vgl->VDPAUUnregisterSurfaceNV =
+        vlc_gl_GetProcAddress(vgl->gl, "glVDPAUUnregisterSurfaceNV");
+    vgl->VDPAUSurfaceAccessNV =
+        vlc_gl_GetProcAddress(vgl->gl, "glVDPAUSurfaceAccessNV");
+    vgl->VDPAUMapSurfacesNV =
+        vlc_gl_GetProcAddress(vgl->gl, "glVDPAUMapSurfacesNV");
+    vgl->VDPAUUnmapSurfacesNV =
+        vlc_gl_GetProcAddress(vgl->gl, "glVDPAUUnmapSurfacesNV");
+    if (!vgl->VDPAUInitNV || !vgl->VDPAUFiniNV
+     || !vgl->VDPAURegisterOutputSurfaceNV || !vgl->VDPAUUnregisterSurfaceNV
+     || !vgl->VDPAUSurfaceAccessNV || !vgl->VDPAUMapSurfacesNV
+     || !vgl->VDPAUUnmapSurfacesNV)
+        return false;
+
+    /* The decoder and the mixer must use the same device as the GL context */
+    const char *name = NULL;
+    if (vgl->gl->surface != NULL
+     && vgl->gl->surface->type == VOUT_WINDOW_TYPE_XID)
+        name = vgl->gl->surface->display.x11;
+
+    if (vdp_get_x11(name, -1, &vgl->vdp, &vgl->vdp_device) != VDP_STATUS_OK)
+    {
+        vgl->vdp = NULL;
+        return false;
+    }
+
+    while (glGetError() != GL_NO_ERROR);
+    vgl->VDPAUInitNV((const void *)(uintptr_t)vgl->vdp_device,
+                     (const void *)vdp_get_proc_address_function(vgl->vdp));
+    if (glGetError() != GL_NO_ERROR)
+    {
+        vdp_release_x11(vgl->vdp);
+        vgl->vdp = NULL;
+        return false;
+    }
+
+    vgl->vdp_count = 0;
+    vgl->vdp_mapped = -1;
+    return true;
+}
+
+/* Must be called with the GL context current, before the pool is released */
+static void CloseVDPAU(vout_display_opengl_t *vgl)
+{
+    if (vgl->vdp_mapped >= 0)
+        vgl->VDPAUUnmapSurfacesNV(1, &vgl->vdp_gl_surface[vgl->vdp_mapped]);
+    vgl->vdp_mapped = -1;
+
+    for (unsigned i = 0; i < vgl->vdp_count; i++)
+        vgl->VDPAUUnregisterSurfaceNV(vgl->vdp_gl_surface[i]);
+    glDeleteTextures(vgl->vdp_count, vgl->vdp_texture);
+    vgl->vdp_count = 0;
+    vgl->texture[0][0] = 0; /* the current interop texture */
+
+    vgl->VDPAUFiniNV();
+}
+
+static void PictureDestroyVDPAU(picture_t *pic)
+{
+    picture_sys_t *psys = pic->p_sys;
+
+    vdp_output_surface_destroy(psys->vdp, psys->surface);
+    vdp_release_x11(psys->vdp);
+    free(psys);
+    free(pic);
+}
+
+static picture_pool_t *GetPoolVDPAU(vout_display_opengl_t *vgl,
+                                    unsigned requested_count)
+{
+    picture_t *picture[VLCGL_PICTURE_MAX];
+    unsigned count = 0;
+
+    if (vlc_gl_Lock(vgl->gl))
+        return NULL;
+
+    while (count < __MIN(VLCGL_PICTURE_MAX, requested_count)) {
+        picture_sys_t *psys = malloc(sizeof (*psys));
+        if (unlikely(psys == NULL))
+            break;
+
+        psys->vdp = vdp_hold_x11(vgl->vdp, &psys->device);
+        if (vdp_output_surface_create(psys->vdp, psys->device,
+                                      VDP_RGBA_FORMAT_B8G8R8A8,
+                                      vgl->fmt.i_visible_width,
+                                      vgl->fmt.i_visible_height,
+                                      &psys->surface) != VDP_STATUS_OK) {
+            vdp_release_x11(psys->vdp);
+            free(psys);
+            break;
+        }
+
+        picture_resource_t res = {
+            .p_sys = psys,
+            .pf_destroy = PictureDestroyVDPAU,
+        };
+        picture_t *pic = picture_NewFromResource(&vgl->fmt, &res);
+        if (unlikely(pic == NULL)) {
+            vdp_output_surface_destroy(psys->vdp, psys->surface);
+            vdp_release_x11(psys->vdp);
+            free(psys);
+            break;
+        }
+
+        GLuint texture;
+        glGenTextures(1, &texture);
+        intptr_t surface =
+            vgl->VDPAURegisterOutputSurfaceNV((const void *)(uintptr_t)psys->surface,
+                                              GL_TEXTURE_2D, 1, &texture);
+        if (surface == 0) {
+            glDeleteTextures(1, &texture);
+            picture_Release(pic);
+            break;
+        }
+        vgl->VDPAUSurfaceAccessNV(surface, GL_READ_ONLY);
+
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        vgl->vdp_surface[count]    = psys->surface;
+        vgl->vdp_texture[count]    = texture;
+        vgl->vdp_gl_surface[count] = surface;
+        picture[count++] = pic;
+    }
+    vgl->vdp_count = count;
+
+    if (count > 0) {
+        vgl->pool = picture_pool_New(count, picture);
+        if (unlikely(vgl->pool == NULL)) {
+            for (unsigned i = 0; i < count; i++)
+                vgl->VDPAUUnregisterSurfaceNV(vgl->vdp_gl_surface[i]);
+            glDeleteTextures(count, vgl->vdp_texture);
+            vgl->vdp_count = 0;
+            for (unsigned i = 0; i < count; i++)
+                picture_Release(picture[i]);
+        }
+    }
+    vlc_gl_Unlock(vgl->gl);
+    return vgl->pool;
+}
+
+/* Maps the output surface of the picture in place of the picture texture */
+static void PrepareVDPAU(vout_display_opengl_t *vgl, const picture_t *picture)
+{
+    if (vgl->vdp_mapped >= 0)
+        vgl->VDPAUUnmapSurfacesNV(1, &vgl->vdp_gl_surface[vgl->vdp_mapped]);
+    vgl->vdp_mapped = -1;
+    vgl->texture[0][0] = 0;
+
+    for (unsigned i = 0; i < vgl->vdp_count; i++) {
+        if (vgl->vdp_surface[i] == picture->p_sys->surface) {
+            vgl->VDPAUMapSurfacesNV(1, &vgl->vdp_gl_surface[i]);
+            vgl->vdp_mapped = i;
+            vgl->texture[0][0] = vgl->vdp_texture[i];
+            break;
+        }
+    }
+}
+#endif
+
 #ifdef SUPPORTS_SHADERS
 static void BuildVertexShader(vout_display_opengl_t *vgl,
                               GLint *shader)
@@ -275,7 +520,9 @@ static void BuildYUVFragmentShader(vout_display_opengl_t *vgl,
     const float (*matrix) = fmt->i_height > 576 ? matrix_bt709_tv2full
                                                 : matrix_bt601_tv2full;
 
-    /* Basic linear YUV -> RGB conversion using bilinear interpolation */
+    /* Basic linear YUV -> RGB conversion using bilinear interpolation.
+     * The lines of the other field are interpolated from the kept one when
+     * deinterlacing, like the deinterlace video filter does in memory. */
     const char *template_glsl_yuv =
         "#version " GLSL_VERSION "\n"
         PRECISION
@@ -283,13 +530,46 @@ static void BuildYUVFragmentShader(vout_display_opengl_t *vgl,
         "uniform sampler2D Texture1;"
         "uniform sampler2D Texture2;"
         "uniform vec4      Coefficient[4];"
+        "uniform vec4      Deinterlace;"    /* mode, kept field */
+        "uniform vec4      DeintTexel[3];"  /* texel width/height, height */
         "varying vec4      TexCoord0,TexCoord1,TexCoord2;"
 
+        "vec4 fetch(sampler2D tex, vec2 pos, vec4 texel) {"
+        " if (Deinterlace.x == 0.0)"
+        "  return texture2D(tex, pos);"
+        " float row = floor(pos.t * texel.z);"
+        " vec2 c = vec2(pos.s, (row + 0.5) * texel.y);"
+        " if (mod(row, 2.0) == Deinterlace.y)"
+        "  return texture2D(tex, c);"
+        " vec2 up = vec2(0.0, -texel.y);"
+        " vec2 down = vec2(0.0, texel.y);"
+        " if (Deinterlace.x == 1.0)"
+        "  return texture2D(tex, Deinterlace.y == 0.0 ? c + up : c + down);"
+        " vec4 a = texture2D(tex, c + up);"
+        " vec4 b = texture2D(tex, c + down);"
+        " if (Deinterlace.x == 2.0)"
+        "  return (a + b) * 0.5;"
+        /* Edge directed: interpolate along the closest matching diagonal */
+        " vec2 dx = vec2(texel.x, 0.0);"
+        " vec4 a1 = texture2D(tex, c + up - dx);"
+        " vec4 b1 = texture2D(tex, c + down + dx);"
+        " vec4 a2 = texture2D(tex, c + up + dx);"
+        " vec4 b2 = texture2D(tex, c + down - dx);"
+        " float s0 = abs(a.r - b.r);"
+        " float s1 = abs(a1.r - b1.r);"
+        " float s2 = abs(a2.r - b2.r);"
+        " if (s1 < s0 && s1 <= s2)"
+        "  return (a1 + b1) * 0.5;"
+        " if (s2 < s0)"
+        "  return (a2 + b2) * 0.5;"
+        " return (a + b) * 0.5;"
+        "}"
+
         "void main(void) {"
         " vec4 x,y,z,result;"
-        " x  = texture2D(Texture0, TexCoord0.st);"
-        " %c = texture2D(Texture1, TexCoord1.st);"
-        " %c = texture2D(Texture2, TexCoord2.st);"
+        " x  = fetch(Texture0, TexCoord0.st, DeintTexel[0]);"
+        " %c = fetch(Texture1, TexCoord1.st, DeintTexel[1]);"
+        " %c = fetch(Texture2, TexCoord2.st, DeintTexel[2]);"
 
         " result = x * Coefficient[0] + Coefficient[3];"
         " result = (y * Coefficient[1]) + result;"
@@ -507,6 +787,22 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
 #   define glClientActiveTexture vgl->ClientActiveTexture
 #endif
 
+#ifdef SUPPORTS_PBO
+    if ((strverscmp((const char *)ogl_version, "4.4") >= 0
+      || HasExtension(extensions, "GL_ARB_buffer_storage"))
+     && (strverscmp((const char *)ogl_version, "3.2") >= 0
+      || HasExtension(extensions, "GL_ARB_sync"))) {
+        vgl->BufferStorage  = (PFNGLBUFFERSTORAGEPROC)vlc_gl_GetProcAddress(vgl->gl, "glBufferStorage");
+        vgl->MapBufferRange = (PFNGLMAPBUFFERRANGEPROC)vlc_gl_GetProcAddress(vgl->gl, "glMapBufferRange");
+        vgl->FenceSync      = (PFNGLFENCESYNCPROC)vlc_gl_GetProcAddress(vgl->gl, "glFenceSync");
+        vgl->ClientWaitSync = (PFNGLCLIENTWAITSYNCPROC)vlc_gl_GetProcAddress(vgl->gl, "glClientWaitSync");
+        vgl->DeleteSync     = (PFNGLDELETESYNCPROC)vlc_gl_GetProcAddress(vgl->gl, "glDeleteSync");
+        if (!vgl->MapBufferRange || !vgl->FenceSync || !vgl->ClientWaitSync
+         || !vgl->DeleteSync || !supports_shaders)
+            vgl->BufferStorage = NULL;
+    }
+#endif
+
     vgl->supports_npot = HasExtension(extensions, "GL_ARB_texture_non_power_of_two") ||
                          HasExtension(extensions, "GL_APPLE_texture_2D_limited_npot");
 
@@ -589,11 +885,20 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
     assert(vgl->chroma != NULL);
     vgl->use_multitexture = vgl->chroma->plane_count > 1;
 
+#ifdef HAVE_GL_VDPAU
+    /* Hardware decoded pictures are converted to RGBA output surfaces by the
+     * VDPAU mixer and drawn as is, without any read back to system memory */
+    if (OpenVDPAU(vgl, fmt, extensions)) {
+        vgl->fmt.i_chroma = VLC_CODEC_VDPAU_OUTPUT;
+        msg_Dbg(vgl->gl, "using VDPAU OpenGL interoperability");
+    }
+#endif
+
     /* Texture size */
     for (unsigned j = 0; j < vgl->chroma->plane_count; j++) {
         int w = vgl->fmt.i_visible_width  * vgl->chroma->p[j].w.num / vgl->chroma->p[j].w.den;
         int h = vgl->fmt.i_visible_height * vgl->chroma->p[j].h.num / vgl->chroma->p[j].h.den;
-        if (vgl->supports_npot) {
+        if (vgl->supports_npot || vgl->fmt.i_chroma == VLC_CODEC_VDPAU_OUTPUT) {
             vgl->tex_width[j]  = w;
             vgl->tex_height[j] = h;
         } else {
@@ -609,6 +914,8 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
     vgl->shader[1] =
     vgl->shader[2] = -1;
     vgl->local_count = 0;
+    vgl->deinterlace = 0;
+    vgl->field = 0;
     if (supports_shaders && (need_fs_yuv || need_fs_xyz|| need_fs_rgba)) {
 #ifdef SUPPORTS_SHADERS
         if (need_fs_xyz)
@@ -718,11 +1025,17 @@ void vout_display_opengl_Delete(vout_display_opengl_t *vgl)
     if (!vlc_gl_Lock(vgl->gl)) {
         glFinish();
         glFlush();
+#ifdef HAVE_GL_VDPAU
+        if (vgl->vdp != NULL)
+            CloseVDPAU(vgl);
+#endif
         for (int i = 0; i < VLCGL_TEXTURE_COUNT; i++)
             glDeleteTextures(vgl->chroma->plane_count, vgl->texture[i]);
         for (int i = 0; i < vgl->region_count; i++) {
             if (vgl->region[i].texture)
                 glDeleteTextures(1, &vgl->region[i].texture);
+            if (vgl->region[i].picture)
+                picture_Release(vgl->region[i].picture);
         }
         free(vgl->region);
 
@@ -740,24 +1053,153 @@ void vout_display_opengl_Delete(vout_display_opengl_t *vgl)
         free(vgl->subpicture_buffer_object);
 #endif
 
+#ifdef SUPPORTS_PBO
+        /* The GPU is done with the buffers after glFinish() */
+        for (unsigned i = 0; i < vgl->pbo_held_count; i++) {
+            vgl->DeleteSync(vgl->pbo_fence[i]);
+            picture_Release(vgl->pbo_held[i]);
+        }
+        vgl->pbo_held_count = 0;
+        if (vgl->pbo_count > 0)
+            vgl->DeleteBuffers(vgl->pbo_count, vgl->pbo);
+#endif
+
         free(vgl->texture_temp_buf);
         vlc_gl_Unlock(vgl->gl);
     }
     if (vgl->pool)
         picture_pool_Release(vgl->pool);
+#ifdef HAVE_GL_VDPAU
+    if (vgl->vdp != NULL)
+        vdp_release_x11(vgl->vdp);
+#endif
     free(vgl);
 }
 
+#ifdef SUPPORTS_PBO
+static void PictureDestroyPBO(picture_t *pic)
+{
+    free(pic);
+}
+
+/* Allocates pictures in persistently mapped pixel buffer objects */
+static unsigned GetPicturesPBO(vout_display_opengl_t *vgl,
+                               picture_t **picture, unsigned count)
+{
+    picture_t *model = picture_NewFromFormat(&vgl->fmt);
+    if (!model)
+        return 0;
+
+    size_t offset[PICTURE_PLANE_MAX];
+    size_t size = 0;
+
+    for (int j = 0; j < model->i_planes; j++) {
+        offset[j] = size;
+        size += ALIGN(model->p[j].i_pitch * model->p[j].i_lines, 64);
+    }
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT
+                           | GL_MAP_COHERENT_BIT;
+    unsigned n = 0;
+
+    if (vlc_gl_Lock(vgl->gl)) {
+        picture_Release(model);
+        return 0;
+    }
+
+    vgl->GenBuffers(count, vgl->pbo);
+    for (; n < count; n++) {
+        vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, vgl->pbo[n]);
+        vgl->BufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+        vgl->pbo_base[n] = vgl->MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+                                               size, flags);
+        if (vgl->pbo_base[n] == NULL)
+            break;
+
+        picture_resource_t rsc = { .pf_destroy = PictureDestroyPBO };
+        for (int j = 0; j < model->i_planes; j++) {
+            rsc.p[j].p_pixels = vgl->pbo_base[n] + offset[j];
+            rsc.p[j].i_lines = model->p[j].i_lines;
+            rsc.p[j].i_pitch = model->p[j].i_pitch;
+        }
+
+        picture[n] = picture_NewFromResource(&vgl->fmt, &rsc);
+        if (!picture[n])
+            break;
+    }
+    vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (n < count) {
+        msg_Warn(vgl->gl, "cannot map pixel buffer objects");
+        for (unsigned i = 0; i < n; i++)
+            picture_Release(picture[i]);
+        vgl->DeleteBuffers(count, vgl->pbo);
+        n = 0;
+    }
+    vgl->pbo_count = n;
+    vlc_gl_Unlock(vgl->gl);
+    picture_Release(model);
+    return n;
+}
+
+/* Returns the buffer a picture was allocated in, or -1 */
+static int GetPBO(const vout_display_opengl_t *vgl, const picture_t *picture)
+{
+    for (unsigned i = 0; i < vgl->pbo_count; i++)
+        if (picture->p[0].p_pixels == vgl->pbo_base[i])
+            return i;
+    return -1;
+}
+
+/* Gives back to the pool the pictures the GPU is done with. If wait is true,
+ * waits for the oldest one at least. */
+static void RetirePBO(vout_display_opengl_t *vgl, bool wait)
+{
+    unsigned done = 0;
+
+    while (done < vgl->pbo_held_count) {
+        GLenum ret = vgl->ClientWaitSync(vgl->pbo_fence[done],
+                                         GL_SYNC_FLUSH_COMMANDS_BIT,
+                                         (wait && done == 0) ? INT64_C(1000000000) : 0);
+        if (ret != GL_ALREADY_SIGNALED && ret != GL_CONDITION_SATISFIED
+         && !(wait && done == 0))
+            break;
+        vgl->DeleteSync(vgl->pbo_fence[done]);
+        picture_Release(vgl->pbo_held[done]);
+        done++;
+    }
+
+    vgl->pbo_held_count -= done;
+    memmove(vgl->pbo_held, vgl->pbo_held + done,
+            vgl->pbo_held_count * sizeof (vgl->pbo_held[0]));
+    memmove(vgl->pbo_fence, vgl->pbo_fence + done,
+            vgl->pbo_held_count * sizeof (vgl->pbo_fence[0]));
+}
+#endif
+
 picture_pool_t *vout_display_opengl_GetPool(vout_display_opengl_t *vgl, unsigned requested_count)
 {
     if (vgl->pool)
         return vgl->pool;
 
+#ifdef HAVE_GL_VDPAU
+    if (vgl->vdp != NULL)
+        return GetPoolVDPAU(vgl, requested_count);
+#endif
+
     /* Allocate our pictures */
     picture_t *picture[VLCGL_PICTURE_MAX] = {NULL, };
-    unsigned count;
+    unsigned count = 0;
+
+#ifdef SUPPORTS_PBO
+    /* Extra pictures for the ones held until their upload completes */
+    if (vgl->BufferStorage != NULL)
+        count = GetPicturesPBO(vgl, picture,
+                               __MIN(VLCGL_PICTURE_MAX,
+                                     requested_count + VLCGL_PBO_HELD_MAX));
+#endif
 
-    for (count = 0; count < __MIN(VLCGL_PICTURE_MAX, requested_count); count++) {
+    for (; count < __MIN(VLCGL_PICTURE_MAX, requested_count); count++) {
         picture[count] = picture_NewFromFormat(&vgl->fmt);
         if (!picture[count])
             break;
@@ -811,7 +1253,6 @@ error:
     return NULL;
 }
 
-#define ALIGN(x, y) (((x) + ((y) - 1)) & ~((y) - 1))
 static void Upload(vout_display_opengl_t *vgl, int in_width, int in_height,
                    int in_full_width, int in_full_height,
                    int w_num, int w_den, int h_num, int h_den,
@@ -882,18 +1323,66 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
     if (vlc_gl_Lock(vgl->gl))
         return VLC_EGENERIC;
 
+    /* The deinterlace filter keeps the first field too */
+    vgl->field = picture->b_top_field_first ? 0 : 1;
+
+#ifdef SUPPORTS_PBO
+    int pbo = -1;
+
+    if (vgl->pbo_count > 0) {
+        RetirePBO(vgl, vgl->pbo_held_count == VLCGL_PBO_HELD_MAX);
+        pbo = GetPBO(vgl, picture);
+        if (pbo >= 0)
+            vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, vgl->pbo[pbo]);
+    }
+#endif
+
+#ifdef HAVE_GL_VDPAU
+    if (vgl->vdp != NULL)
+        PrepareVDPAU(vgl, picture);
+    else
+#endif
     /* Update the texture */
     for (unsigned j = 0; j < vgl->chroma->plane_count; j++) {
+        const uint8_t *pixels = picture->p[j].p_pixels;
+
         if (vgl->use_multitexture) {
             glActiveTexture(GL_TEXTURE0 + j);
             glClientActiveTexture(GL_TEXTURE0 + j);
         }
         glBindTexture(vgl->tex_target, vgl->texture[0][j]);
 
+#ifdef SUPPORTS_PBO
+        /* Offset in the bound buffer */
+        if (pbo >= 0)
+            pixels = (const uint8_t *)(uintptr_t)(pixels - vgl->pbo_base[pbo]);
+#endif
         Upload(vgl, picture->format.i_visible_width, vgl->fmt.i_visible_height,
                vgl->fmt.i_width, vgl->fmt.i_height,
                vgl->chroma->p[j].w.num, vgl->chroma->p[j].w.den, vgl->chroma->p[j].h.num, vgl->chroma->p[j].h.den,
-               picture->p[j].i_pitch, picture->p[j].i_pixel_pitch, 0, picture->p[j].p_pixels, vgl->tex_target, vgl->tex_format, vgl->tex_type);
+               picture->p[j].i_pitch, picture->p[j].i_pixel_pitch, 0, pixels, vgl->tex_target, vgl->tex_format, vgl->tex_type);
+    }
+
+#ifdef SUPPORTS_PBO
+    if (pbo >= 0) {
+        vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        assert(vgl->pbo_held_count < VLCGL_PBO_HELD_MAX);
+        vgl->pbo_fence[vgl->pbo_held_count] =
+            vgl->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        vgl->pbo_held[vgl->pbo_held_count++] = picture_Hold(picture);
+    }
+#endif
+
+    /* Keep the textures of unchanged subpictures */
+    if (subpicture && vgl->region &&
+        (subpicture->i_dirty_width <= 0 || subpicture->i_dirty_height <= 0)) {
+        int count = 0;
+        for (subpicture_region_t *r = subpicture->p_region; r; r = r->p_next)
+            count++;
+        if (count == vgl->region_count) {
+            vlc_gl_Unlock(vgl->gl);
+            return VLC_SUCCESS;
+        }
     }
 
     int         last_count = vgl->region_count;
@@ -939,6 +1428,30 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
             glr->bottom = -2.0 * (r->i_y + r->fmt.i_visible_height) / subpicture->i_original_picture_height + 1.0;
 
             glr->texture = 0;
+            glr->picture = picture_Hold(r->p_picture);
+            glr->x_offset = r->fmt.i_x_offset;
+            glr->y_offset = r->fmt.i_y_offset;
+
+            /* A region still showing the same picture keeps its texture
+               as is: the content only needs to be uploaded on change. */
+            bool b_uploaded = false;
+            for (int j = 0; j < last_count; j++) {
+                if (last[j].texture &&
+                    last[j].picture  == glr->picture &&
+                    last[j].x_offset == glr->x_offset &&
+                    last[j].y_offset == glr->y_offset &&
+                    last[j].width    == glr->width &&
+                    last[j].height   == glr->height) {
+                    glr->texture = last[j].texture;
+                    picture_Release(last[j].picture);
+                    memset(&last[j], 0, sizeof(last[j]));
+                    b_uploaded = true;
+                    break;
+                }
+            }
+            if (b_uploaded)
+                continue;
+
             /* Try to recycle the textures allocated by the previous
                call to this function. */
             for (int j = 0; j < last_count; j++) {
@@ -948,6 +1461,8 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
                     last[j].format == glr->format &&
                     last[j].type   == glr->type) {
                     glr->texture = last[j].texture;
+                    if (last[j].picture)
+                        picture_Release(last[j].picture);
                     memset(&last[j], 0, sizeof(last[j]));
                     break;
                 }
@@ -982,6 +1497,8 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
     for (int i = 0; i < last_count; i++) {
         if (last[i].texture)
             glDeleteTextures(1, &last[i].texture);
+        if (last[i].picture)
+            picture_Release(last[i].picture);
     }
     free(last);
 
@@ -1121,6 +1638,17 @@ static void DrawWithShaders(vout_display_opengl_t *vgl,
             vgl->Uniform1i(vgl->GetUniformLocation(vgl->program[0], "Texture0"), 0);
             vgl->Uniform1i(vgl->GetUniformLocation(vgl->program[0], "Texture1"), 1);
             vgl->Uniform1i(vgl->GetUniformLocation(vgl->program[0], "Texture2"), 2);
+
+            GLfloat texel[3 * 4];
+            for (unsigned j = 0; j < 3; j++) {
+                texel[4*j+0] = 1.f / vgl->tex_width[j];
+                texel[4*j+1] = 1.f / vgl->tex_height[j];
+                texel[4*j+2] = vgl->tex_height[j];
+                texel[4*j+3] = 0.f;
+            }
+            vgl->Uniform4f(vgl->GetUniformLocation(vgl->program[0], "Deinterlace"),
+                           vgl->deinterlace, vgl->field, 0.f, 0.f);
+            vgl->Uniform4fv(vgl->GetUniformLocation(vgl->program[0], "DeintTexel"), 3, texel);
         }
         else if (vgl->chroma->plane_count == 1) {
             vgl->Uniform1i(vgl->GetUniformLocation(vgl->program[0], "Texture0"), 0);
@@ -1173,6 +1701,37 @@ static void DrawWithShaders(vout_display_opengl_t *vgl,
 }
 #endif
 
+int vout_display_opengl_SetDeinterlace(vout_display_opengl_t *vgl,
+                                       const char *mode)
+{
+    static const struct {
+        char name[8];
+        int  deinterlace;
+    } modes[] = {
+        { "bob",     1 },
+        { "linear",  2 },
+        { "yadif",   3 },
+        { "yadif2x", 3 },
+    };
+
+    if (mode == NULL) {
+        vgl->deinterlace = 0;
+        return VLC_SUCCESS;
+    }
+
+    /* Only the planar YUV shader interpolates the missing lines */
+    if (vgl->program[0] == 0 || vgl->chroma->plane_count != 3
+     || vgl->tex_target != GL_TEXTURE_2D)
+        return VLC_EGENERIC;
+
+    for (size_t i = 0; i < ARRAY_SIZE(modes); i++)
+        if (!strcmp(mode, modes[i].name)) {
+            vgl->deinterlace = modes[i].deinterlace;
+            return VLC_SUCCESS;
+        }
+    return VLC_EGENERIC;
+}
+
 int vout_display_opengl_Display(vout_display_opengl_t *vgl,
                                 const video_format_t *source)
 {
@@ -1218,6 +1777,13 @@ int vout_display_opengl_Display(vout_display_opengl_t *vgl,
         right[j]  = (source->i_x_offset + source->i_visible_width ) * scale_w;
         bottom[j] = (source->i_y_offset + source->i_visible_height) * scale_h;
     }
+#ifdef HAVE_GL_VDPAU
+    /* The mixer renders the visible area only, to the whole output surface */
+    if (vgl->vdp != NULL) {
+        left[0] = top[0] = 0.0;
+        right[0] = bottom[0] = 1.0;
+    }
+#endif
 
 #ifdef SUPPORTS_SHADERS
     if (vgl->program[0] && (vgl->chroma->plane_count == 3 || vgl->chroma->plane_count == 1))
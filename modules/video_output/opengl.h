@@ -100,5 +100,7 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
                                 picture_t *picture, subpicture_t *subpicture);
 int vout_display_opengl_Display(vout_display_opengl_t *vgl,
                                 const video_format_t *source);
+int vout_display_opengl_SetDeinterlace(vout_display_opengl_t *vgl,
+                                       const char *mode);
 
 #endif
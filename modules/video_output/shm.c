@@ -0,0 +1,434 @@
+/*****************************************************************************
+ * shm.c : shared memory video output
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_vout_display.h>
+#include <vlc_picture_pool.h>
+#include <vlc_atomic.h>
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+#define NAME_TEXT N_("Shared memory object name")
+#define NAME_LONGTEXT N_( \
+    "Name of the POSIX shared memory object to publish the frames in, " \
+    "such as \"/vlc-vout\". Each video output needs its own. " \
+    "Defaults to \"/vlc-vout-\" followed by the process identifier.")
+
+#define CHROMA_TEXT N_("Chroma used")
+#define CHROMA_LONGTEXT N_(\
+    "Force use of a specific chroma for output. " \
+    "Defaults to the chroma of the video.")
+
+#define CFG_PREFIX "vout-shm-"
+
+static int  Open (vlc_object_t *);
+static void Close(vlc_object_t *);
+
+vlc_module_begin()
+    set_shortname(N_("Shared memory"))
+    set_description(N_("Shared memory video output"))
+    set_category(CAT_VIDEO)
+    set_subcategory(SUBCAT_VIDEO_VOUT)
+    set_capability("vout display", 0)
+
+    add_string(CFG_PREFIX "name", NULL, NAME_TEXT, NAME_LONGTEXT, false)
+    add_string(CFG_PREFIX "chroma", NULL, CHROMA_TEXT, CHROMA_LONGTEXT, true)
+
+    add_shortcut("shm")
+    set_callbacks(Open, Close)
+vlc_module_end()
+
+/*****************************************************************************
+ * Shared memory layout
+ *****************************************************************************
+ * The object starts with struct vout_shm_header, and holds slot_count slots
+ * of slot_size bytes from slot_offset. The decoder renders directly into the
+ * slots. All integers are in host byte order.
+ *
+ * The header is complete once the magic is set. The plane offsets are
+ * relative to the start of a slot.
+ *
+ * Each slot has a sequence fence, which is odd while the slot is being
+ * rendered, and even once its frame is complete. latest is one plus the index
+ * of the slot with the last complete frame, or zero if none, and frames counts
+ * the complete frames. The slot of the latest frame is not rendered into
+ * until a newer frame is complete. A consumer reads a frame without copying
+ * it as follows:
+ *
+ *   do {
+ *       slot = latest - 1;
+ *       seq = slots[slot].seq;     (acquire)
+ *       if (seq & 1) continue;
+ *       ...read or render the frame...
+ *   } while (slots[slot].seq != seq);   (acquire)
+ *
+ * state becomes VOUT_SHM_CLOSED when the video output is closed: the
+ * consumer should then unmap the object, and open it again by name, as the
+ * format may have changed.
+ */
+#define VOUT_SHM_MAGIC "VLCVOUT1"
+
+enum
+{
+    VOUT_SHM_OPEN = 1,
+    VOUT_SHM_CLOSED = 2,
+};
+
+struct vout_shm_plane
+{
+    uint32_t offset;
+    uint32_t pitch;
+    uint32_t lines;
+    uint32_t visible_pitch;
+    uint32_t visible_lines;
+};
+
+struct vout_shm_slot
+{
+    atomic_uint seq;
+    uint32_t    reserved;
+    int64_t     date; /* display date of the frame, in microseconds */
+};
+
+struct vout_shm_header
+{
+    char        magic[8];
+    uint32_t    header_size;
+    atomic_uint state;
+    uint32_t    chroma; /* VLC fourcc */
+    uint32_t    width, height; /* visible size */
+    uint32_t    x_offset, y_offset; /* visible area offset in the planes */
+    uint32_t    sar_num, sar_den;
+    uint32_t    frame_rate, frame_rate_base;
+    uint32_t    plane_count;
+    struct vout_shm_plane plane[PICTURE_PLANE_MAX];
+    uint32_t    slot_count;
+    uint32_t    slot_size;
+    uint32_t    slot_offset;
+    atomic_uint latest;
+    atomic_uint frames;
+    struct vout_shm_slot slots[];
+};
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static picture_pool_t *Pool  (vout_display_t *, unsigned);
+static void           Display(vout_display_t *, picture_t *, subpicture_t *subpicture);
+static int            Control(vout_display_t *, int, va_list);
+
+/*****************************************************************************
+ * vout_display_sys_t: video output descriptor
+ *****************************************************************************/
+struct vout_display_sys_t {
+    char                   *name;
+    struct vout_shm_header *header;
+    size_t                  size;
+
+    picture_pool_t *pool;
+    picture_t      *displayed; /* latest published frame */
+};
+
+/* */
+static int Open(vlc_object_t *object)
+{
+    vout_display_t *vd = (vout_display_t *)object;
+    vout_display_sys_t *sys;
+
+    /* Allocate instance and initialize some members */
+    vd->sys = sys = malloc(sizeof(*sys));
+    if (!sys)
+        return VLC_ENOMEM;
+
+    sys->name = var_InheritString(vd, CFG_PREFIX "name");
+    if (sys->name == NULL
+     && asprintf(&sys->name, "/vlc-vout-%u", (unsigned)getpid()) < 0)
+        sys->name = NULL;
+    if (sys->name == NULL) {
+        free(sys);
+        return VLC_ENOMEM;
+    }
+    sys->header = NULL;
+    sys->size = 0;
+    sys->pool = NULL;
+    sys->displayed = NULL;
+
+    /* */
+    char *psz_fcc = var_InheritString(vd, CFG_PREFIX "chroma");
+    const vlc_fourcc_t chroma = vlc_fourcc_GetCodecFromString(VIDEO_ES,
+                                                              psz_fcc);
+    free(psz_fcc);
+
+    /* */
+    video_format_t fmt;
+    video_format_ApplyRotation(&fmt, &vd->fmt);
+    if (chroma)
+        fmt.i_chroma = chroma;
+    video_format_FixRgb(&fmt);
+
+    /* */
+    vout_display_info_t info = vd->info;
+    info.has_hide_mouse = true;
+
+    /* */
+    vd->fmt     = fmt;
+    vd->info    = info;
+    vd->pool    = Pool;
+    vd->prepare = NULL;
+    vd->display = Display;
+    vd->control = Control;
+    vd->manage  = NULL;
+
+    vout_display_SendEventFullscreen(vd, false);
+    vout_display_DeleteWindow(vd, NULL);
+    return VLC_SUCCESS;
+}
+
+/* */
+static void Close(vlc_object_t *object)
+{
+    vout_display_t *vd = (vout_display_t *)object;
+    vout_display_sys_t *sys = vd->sys;
+
+    if (sys->displayed)
+        picture_Release(sys->displayed);
+    if (sys->pool)
+        picture_pool_Release(sys->pool);
+    if (sys->header) {
+        atomic_store_explicit(&sys->header->state, VOUT_SHM_CLOSED,
+                              memory_order_release);
+        munmap(sys->header, sys->size);
+        shm_unlink(sys->name);
+    }
+    free(sys->name);
+    free(sys);
+}
+
+/*****************************************************************************
+ *
+ *****************************************************************************/
+static struct vout_shm_slot *GetSlot(picture_t *picture)
+{
+    return (struct vout_shm_slot *)picture->p_sys;
+}
+
+/* Marks the slot of a picture from the pool as being rendered */
+static int LockSlot(picture_t *picture)
+{
+    struct vout_shm_slot *slot = GetSlot(picture);
+    unsigned seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+
+    if (!(seq & 1)) {
+        atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+    }
+    return VLC_SUCCESS;
+}
+
+static void DestroyPicture(picture_t *picture)
+{
+    free(picture);
+}
+
+static void *Map(vout_display_t *vd, size_t size)
+{
+    vout_display_sys_t *sys = vd->sys;
+    int fd = shm_open(sys->name, O_RDWR|O_CREAT|O_TRUNC|O_CLOEXEC, 0600);
+    if (fd == -1) {
+        msg_Err(vd, "cannot create shared memory %s: %s", sys->name,
+                vlc_strerror_c(errno));
+        return NULL;
+    }
+
+    void *addr = MAP_FAILED;
+    if (ftruncate(fd, size) == 0)
+        addr = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (addr == MAP_FAILED) {
+        msg_Err(vd, "cannot map shared memory %s: %s", sys->name,
+                vlc_strerror_c(errno));
+        shm_unlink(sys->name);
+        return NULL;
+    }
+    return addr;
+}
+
+static picture_pool_t *Pool(vout_display_t *vd, unsigned count)
+{
+    vout_display_sys_t *sys = vd->sys;
+    if (sys->pool)
+        return sys->pool;
+
+    /* One more slot for the latest frame, which is kept */
+    count++;
+
+    /* Get the planes layout the core would use */
+    picture_t *model = picture_NewFromFormat(&vd->fmt);
+    if (!model)
+        return NULL;
+
+    const long page = sysconf(_SC_PAGESIZE);
+    size_t header_size = sizeof (struct vout_shm_header)
+                       + count * sizeof (struct vout_shm_slot);
+    size_t slot_size = 0;
+
+    header_size = (header_size + page - 1) & ~(page - 1);
+    for (int i = 0; i < model->i_planes; i++)
+        slot_size += model->p[i].i_pitch * model->p[i].i_lines;
+    slot_size = (slot_size + page - 1) & ~(page - 1);
+
+    if (slot_size > UINT32_MAX || header_size > UINT32_MAX
+     || (SIZE_MAX - header_size) / count < slot_size) {
+        picture_Release(model);
+        return NULL;
+    }
+
+    sys->size = header_size + count * slot_size;
+    sys->header = Map(vd, sys->size);
+    if (!sys->header) {
+        picture_Release(model);
+        return NULL;
+    }
+
+    /* Describe the format */
+    struct vout_shm_header *hdr = sys->header;
+    uint8_t *base = (uint8_t *)hdr;
+    uint32_t offset = 0;
+
+    hdr->header_size = sizeof (*hdr);
+    atomic_init(&hdr->state, VOUT_SHM_OPEN);
+    hdr->chroma = vd->fmt.i_chroma;
+    hdr->width = vd->fmt.i_visible_width;
+    hdr->height = vd->fmt.i_visible_height;
+    hdr->x_offset = vd->fmt.i_x_offset;
+    hdr->y_offset = vd->fmt.i_y_offset;
+    hdr->sar_num = vd->source.i_sar_num;
+    hdr->sar_den = vd->source.i_sar_den;
+    hdr->frame_rate = vd->source.i_frame_rate;
+    hdr->frame_rate_base = vd->source.i_frame_rate_base;
+    hdr->plane_count = model->i_planes;
+    for (int i = 0; i < model->i_planes; i++) {
+        const plane_t *p = &model->p[i];
+
+        hdr->plane[i].offset = offset;
+        hdr->plane[i].pitch = p->i_pitch;
+        hdr->plane[i].lines = p->i_lines;
+        hdr->plane[i].visible_pitch = p->i_visible_pitch;
+        hdr->plane[i].visible_lines = p->i_visible_lines;
+        offset += p->i_pitch * p->i_lines;
+    }
+    hdr->slot_count = count;
+    hdr->slot_size = slot_size;
+    hdr->slot_offset = header_size;
+    atomic_init(&hdr->latest, 0);
+    atomic_init(&hdr->frames, 0);
+
+    /* Make pictures of the slots */
+    picture_t *pictures[count];
+    unsigned n;
+
+    for (n = 0; n < count; n++) {
+        picture_resource_t rsc = {
+            .p_sys = (picture_sys_t *)&hdr->slots[n],
+            .pf_destroy = DestroyPicture,
+        };
+        uint8_t *slot = base + header_size + n * slot_size;
+
+        atomic_init(&hdr->slots[n].seq, 0);
+        hdr->slots[n].date = 0;
+        for (int i = 0; i < model->i_planes; i++) {
+            rsc.p[i].p_pixels = slot + hdr->plane[i].offset;
+            rsc.p[i].i_lines = model->p[i].i_lines;
+            rsc.p[i].i_pitch = model->p[i].i_pitch;
+        }
+
+        pictures[n] = picture_NewFromResource(&vd->fmt, &rsc);
+        if (!pictures[n])
+            break;
+    }
+    picture_Release(model);
+
+    picture_pool_configuration_t cfg = {
+        .picture_count = n,
+        .picture = pictures,
+        .lock = LockSlot,
+    };
+
+    if (n == count)
+        sys->pool = picture_pool_NewExtended(&cfg);
+    if (!sys->pool) {
+        for (unsigned i = 0; i < n; i++)
+            picture_Release(pictures[i]);
+        return NULL;
+    }
+
+    /* The header is complete */
+    atomic_thread_fence(memory_order_release);
+    memcpy(hdr->magic, VOUT_SHM_MAGIC, sizeof (hdr->magic));
+
+    msg_Dbg(vd, "publishing %u frames of %zu bytes in %s", count,
+            slot_size, sys->name);
+    return sys->pool;
+}
+
+static void Display(vout_display_t *vd, picture_t *picture, subpicture_t *subpicture)
+{
+    vout_display_sys_t *sys = vd->sys;
+    struct vout_shm_header *hdr = sys->header;
+    struct vout_shm_slot *slot = GetSlot(picture);
+    unsigned seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+
+    /* Complete the frame, then publish it */
+    slot->date = picture->date;
+    if (seq & 1)
+        atomic_store_explicit(&slot->seq, seq + 1, memory_order_release);
+    atomic_store_explicit(&hdr->latest, (slot - hdr->slots) + 1,
+                          memory_order_release);
+    atomic_fetch_add_explicit(&hdr->frames, 1, memory_order_release);
+
+    /* Keep the latest frame, so that its slot is not rendered into */
+    if (sys->displayed)
+        picture_Release(sys->displayed);
+    sys->displayed = picture;
+    VLC_UNUSED(subpicture);
+}
+
+static int Control(vout_display_t *vd, int query, va_list args)
+{
+    (void) vd; (void) query; (void) args;
+    return VLC_EGENERIC;
+}
@@ -121,6 +121,7 @@ static int Open (vlc_object_t *obj)
     vd->sys = sys;
     vd->info.has_pictures_invalid = false;
     vd->info.has_event_thread = true;
+    vd->info.has_deinterlace = true;
     vd->info.subpicture_chromas = spu_chromas;
     vd->pool = Pool;
     vd->prepare = PictureRender;
@@ -239,6 +240,12 @@ static int Control (vout_display_t *vd, int query, va_list ap)
         return VLC_SUCCESS;
     }
 
+    case VOUT_DISPLAY_CHANGE_DEINTERLACE:
+    {
+        const char *mode = va_arg (ap, const char *);
+        return vout_display_opengl_SetDeinterlace (sys->vgl, mode);
+    }
+
     /* Hide the mouse. It will be send when
      * vout_display_t::info.b_hide_mouse is false */
     case VOUT_DISPLAY_HIDE_MOUSE:
@@ -191,7 +191,12 @@ static int Filter( video_splitter_t *p_splitter,
     }
 
     for( int i = 0; i < p_splitter->i_output; i++ )
-        picture_Copy( pp_dst[i], p_src );
+    {
+        if( pp_dst[i] == NULL )
+            pp_dst[i] = picture_Hold( p_src );
+        else
+            picture_Copy( pp_dst[i], p_src );
+    }
 
     picture_Release( p_src );
     return VLC_SUCCESS;
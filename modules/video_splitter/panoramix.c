@@ -713,6 +713,14 @@ static void Close( vlc_object_t *p_this )
     free( p_sys );
 }
 
+static bool IsCrop( const panoramix_filter_t *p_filter )
+{
+    return p_filter->black.i_left == 0 && p_filter->black.i_right == 0 &&
+           p_filter->black.i_top == 0 && p_filter->black.i_bottom == 0 &&
+           p_filter->attenuate.i_left == 0 && p_filter->attenuate.i_right == 0 &&
+           p_filter->attenuate.i_top == 0 && p_filter->attenuate.i_bottom == 0;
+}
+
 /**
  * It creates multiples pictures from the source one
  */
@@ -737,6 +745,27 @@ static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t
             /* */
             picture_t *p_dst = pp_dst[p_output->i_output];
 
+            if( p_dst == NULL )
+            {
+                const video_format_t *p_fmt =
+                    &p_splitter->p_output[p_output->i_output].fmt;
+
+                /* Without black or blended borders, the output is only a
+                 * part of the source: show it in place */
+                if( IsCrop( &p_output->filter ) )
+                    p_dst = picture_NewView( p_src, p_fmt, p_output->i_src_x,
+                                             p_output->i_src_y );
+                if( p_dst != NULL )
+                {
+                    pp_dst[p_output->i_output] = p_dst;
+                    continue;
+                }
+                p_dst = picture_NewFromFormat( p_fmt );
+                pp_dst[p_output->i_output] = p_dst;
+                if( p_dst == NULL )
+                    continue;
+            }
+
             /* */
             picture_CopyProperties( p_dst, p_src );
 
@@ -407,6 +407,24 @@ static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t
 
             picture_t *p_dst = pp_dst[p_output->i_output];
 
+            if( p_dst == NULL )
+            {   /* Show the part of the source in place */
+                const video_format_t *p_fmt =
+                    &p_splitter->p_output[p_output->i_output].fmt;
+
+                p_dst = picture_NewView( p_src, p_fmt, p_output->i_left,
+                                         p_output->i_top );
+                if( p_dst != NULL )
+                {
+                    pp_dst[p_output->i_output] = p_dst;
+                    continue;
+                }
+                p_dst = picture_NewFromFormat( p_fmt );
+                pp_dst[p_output->i_output] = p_dst;
+                if( p_dst == NULL )
+                    continue;
+            }
+
             /* */
             picture_t tmp = *p_src;
             for( int i = 0; i < tmp.i_planes; i++ )
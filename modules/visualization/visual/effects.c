@@ -75,8 +75,12 @@ typedef struct spectrum_data
     int16_t *p_prev_s16_buff;
 
     window_param wind_param;
+    window_context wind_ctx;
+    fft_state *p_state;
 } spectrum_data;
 
+static void spectrum_Free( void * );
+
 static int spectrum_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
                         const block_t * p_buffer , picture_t * p_picture)
 {
@@ -104,9 +108,6 @@ static int spectrum_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
      110,115,121,130,141,152,163,174,185,200,255};
     const int *xscale;
 
-    fft_state *p_state;                 /* internal FFT data */
-    DEFINE_WIND_CONTEXT( wind_ctx );    /* internal window data */
-
     int i , j , y , k;
     int i_line;
     int16_t p_dest[FFT_BUFFER_SIZE];      /* Adapted FFT result */
@@ -136,8 +137,27 @@ static int spectrum_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
 
         p_data->i_prev_nb_samples = 0;
         p_data->p_prev_s16_buff = NULL;
+        p_data->wind_ctx = (window_context){ NULL, 0 };
+        p_data->p_state = NULL;
 
+        /* The FFT and window tables only depend on the settings */
         window_get_param( p_aout, &p_data->wind_param );
+        if( !window_init( FFT_BUFFER_SIZE, &p_data->wind_param,
+                          &p_data->wind_ctx ) )
+        {
+            msg_Err(p_aout,"unable to initialize FFT window");
+            p_effect->p_data = NULL;
+            spectrum_Free( p_data );
+            return -1;
+        }
+        p_data->p_state = visual_fft_init();
+        if( !p_data->p_state )
+        {
+            msg_Err(p_aout,"unable to initialize FFT transform");
+            p_effect->p_data = NULL;
+            spectrum_Free( p_data );
+            return -1;
+        }
     }
     peaks = (int *)p_data->peaks;
     prev_heights = (int *)p_data->prev_heights;
@@ -186,20 +206,6 @@ static int spectrum_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
 
         p_buffl++ ; p_buffs++ ;
     }
-    p_state  = visual_fft_init();
-    if( !p_state)
-    {
-        free( height );
-        msg_Err(p_aout,"unable to initialize FFT transform");
-        return -1;
-    }
-    if( !window_init( FFT_BUFFER_SIZE, &p_data->wind_param, &wind_ctx ) )
-    {
-        fft_close( p_state );
-        free( height );
-        msg_Err(p_aout,"unable to initialize FFT window");
-        return -1;
-    }
     p_buffs = p_s16_buff;
     for ( i = 0 ; i < FFT_BUFFER_SIZE ; i++)
     {
@@ -211,8 +217,8 @@ static int spectrum_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
             p_buffs = p_s16_buff;
 
     }
-    window_scale_in_place( p_buffer1, &wind_ctx );
-    fft_perform( p_buffer1, p_output, p_state);
+    window_scale_in_place( p_buffer1, &p_data->wind_ctx );
+    fft_perform( p_buffer1, p_output, p_data->p_state );
     for( i = 0; i< FFT_BUFFER_SIZE ; i++ )
         p_dest[i] = p_output[i] *  ( 2 ^ 16 ) / ( ( FFT_BUFFER_SIZE / 2 * 32768 ) ^ 2 );
 
@@ -359,10 +365,6 @@ static int spectrum_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
         }
     }
 
-    window_close( &wind_ctx );
-
-    fft_close( p_state );
-
     free( height );
 
     return 0;
@@ -377,6 +379,9 @@ static void spectrum_Free( void *data )
         free( p_data->peaks );
         free( p_data->prev_heights );
         free( p_data->p_prev_s16_buff );
+        window_close( &p_data->wind_ctx );
+        if( p_data->p_state != NULL )
+            fft_close( p_data->p_state );
         free( p_data );
     }
 }
@@ -393,8 +398,12 @@ typedef struct
     int16_t *p_prev_s16_buff;
 
     window_param wind_param;
+    window_context wind_ctx;
+    fft_state *p_state;
 } spectrometer_data;
 
+static void spectrometer_Free( void * );
+
 static int spectrometer_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
                             const block_t * p_buffer , picture_t * p_picture)
 {
@@ -442,9 +451,6 @@ static int spectrometer_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
     const int *xscale;
     const double y_scale =  3.60673760222;  /* (log 256) */
 
-    fft_state *p_state;                 /* internal FFT data */
-    DEFINE_WIND_CONTEXT( wind_ctx );    /* internal window data */
-
     int i , j , k;
     int i_line = 0;
     int16_t p_dest[FFT_BUFFER_SIZE];      /* Adapted FFT result */
@@ -476,7 +482,25 @@ static int spectrometer_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
         }
         p_data->i_prev_nb_samples = 0;
         p_data->p_prev_s16_buff = NULL;
+        p_data->wind_ctx = (window_context){ NULL, 0 };
+        p_data->p_state = NULL;
+
+        /* The FFT and window tables only depend on the settings */
         window_get_param( p_aout, &p_data->wind_param );
+        if( !window_init( FFT_BUFFER_SIZE, &p_data->wind_param,
+                          &p_data->wind_ctx ) )
+        {
+            msg_Err(p_aout,"unable to initialize FFT window");
+            spectrometer_Free( p_data );
+            return -1;
+        }
+        p_data->p_state = visual_fft_init();
+        if( !p_data->p_state )
+        {
+            msg_Err(p_aout,"unable to initialize FFT transform");
+            spectrometer_Free( p_data );
+            return -1;
+        }
         p_effect->p_data = (void*)p_data;
     }
     peaks = p_data->peaks;
@@ -534,20 +558,6 @@ static int spectrometer_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
 
         p_buffl++ ; p_buffs++ ;
     }
-    p_state  = visual_fft_init();
-    if( !p_state)
-    {
-        msg_Err(p_aout,"unable to initialize FFT transform");
-        free( height );
-        return -1;
-    }
-    if( !window_init( FFT_BUFFER_SIZE, &p_data->wind_param, &wind_ctx ) )
-    {
-        fft_close( p_state );
-        free( height );
-        msg_Err(p_aout,"unable to initialize FFT window");
-        return -1;
-    }
     p_buffs = p_s16_buff;
     for ( i = 0 ; i < FFT_BUFFER_SIZE; i++)
     {
@@ -558,8 +568,8 @@ static int spectrometer_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
         if( p_buffs >= &p_s16_buff[p_buffer->i_nb_samples * p_effect->i_nb_chans] )
             p_buffs = p_s16_buff;
     }
-    window_scale_in_place( p_buffer1, &wind_ctx );
-    fft_perform( p_buffer1, p_output, p_state);
+    window_scale_in_place( p_buffer1, &p_data->wind_ctx );
+    fft_perform( p_buffer1, p_output, p_data->p_state );
     for(i = 0; i < FFT_BUFFER_SIZE; i++)
     {
         int sqrti = sqrt(p_output[i]);
@@ -856,10 +866,6 @@ static int spectrometer_Run(visual_effect_t * p_effect, vlc_object_t *p_aout,
         }
     }
 
-    window_close( &wind_ctx );
-
-    fft_close( p_state );
-
     free( height );
 
     return 0;
@@ -873,6 +879,9 @@ static void spectrometer_Free( void *data )
     {
         free( p_data->peaks );
         free( p_data->p_prev_s16_buff );
+        window_close( &p_data->wind_ctx );
+        if( p_data->p_state != NULL )
+            fft_close( p_data->p_state );
         free( p_data );
     }
 }
@@ -111,6 +111,9 @@
 #define VOUT_WIDTH  800
 #define VOUT_HEIGHT 500
 
+/* Audio buffers waiting for the effects thread */
+#define MAX_QUEUED_BUFFERS 4
+
 static int  Open         ( vlc_object_t * );
 static void Close        ( vlc_object_t * );
 
@@ -386,6 +389,11 @@ static void *Thread( void *data )
 
 static block_t *DoWork( filter_t *p_filter, block_t *p_in_buf )
 {
+    /* If the effects cannot keep up, skip the buffer rather than lag
+     * further behind the audio: its picture would only be late */
+    if( block_FifoCount( p_filter->p_sys->fifo ) >= MAX_QUEUED_BUFFERS )
+        return p_in_buf;
+
     block_t *block = block_Duplicate( p_in_buf );
     if( likely(block != NULL) )
         block_FifoPut( p_filter->p_sys->fifo, block );
@@ -65,6 +65,23 @@ function strsplit(text, delimiter)
     return list
 end
 
+--snapshots of the status and playlist, shared by the requests received
+--within a short delay (in microseconds), and dropped by any command
+
+local status_delay = 250000
+local playlist_delay = 1000000
+local snapshots = {}
+
+local function snapshot(name, delay, build)
+    local now = vlc.misc.mdate()
+    local s = snapshots[name]
+    if s == nil or now - s.date >= delay then
+        s = { date = now, value = build() }
+        snapshots[name] = s
+    end
+    return s.value
+end
+
 --main function to process commands sent with the request
 
 processcommands = function ()
@@ -201,6 +218,10 @@ processcommands = function ()
         vlc.var.set(vlc.object.input(), "spu-es", val)
     end
 
+    if command then
+        snapshots = {}
+    end
+
     local input = nil
     local command = nil
     local id = nil
@@ -222,8 +243,9 @@ end
 
 --dkjson outputs numbered tables as arrays
 --so we don't need the array indicators
+--the tables are copied, not to alter the snapshots
 function removeArrayIndicators(dict)
-    local newDict=dict
+    local newDict={}
 
     for k,v in pairs(dict) do
         if (type(v)=="table") then
@@ -232,8 +254,9 @@ function removeArrayIndicators(dict)
                 v=arrayEntry
             end
 
-            dict[k]=removeArrayIndicators(v)
+            v=removeArrayIndicators(v)
         end
+        newDict[k]=v
     end
 
     return newDict
@@ -311,9 +334,12 @@ getplaylist = function ()
     return p
 end
 
-parseplaylist = function (item)
+parseplaylist = function (item, current_item_id)
     if item.flags.disabled then return end
 
+    --look the current item up once, not for each leaf
+    current_item_id = current_item_id or vlc.playlist.current()
+
     if (item.children) then
         local result={}
         local name = (item.name or "")
@@ -329,7 +355,7 @@ parseplaylist = function (item)
         result.children._array={}
 
         for _, child in ipairs(item.children) do
-            local nextChild=parseplaylist(child)
+            local nextChild=parseplaylist(child, current_item_id)
             table.insert(result.children._array,nextChild)
         end
 
@@ -338,13 +364,10 @@ parseplaylist = function (item)
         local result={}
         local name, path = item.name or ""
         local path = item.path or ""
-        local current_item_id = vlc.playlist.current()
 
         -- Is the item the one currently played
-        if(current_item_id ~= nil) then
-            if(current_item_id == item.id) then
-                result.current = "current"
-            end
+        if(current_item_id == item.id) then
+            result.current = "current"
         end
 
         result["type"]="leaf"
@@ -361,9 +384,14 @@ end
 
 playlisttable = function ()
 
-    local basePlaylist=getplaylist()
+    --searches are not shared
+    if _GET["search"] then
+        return parseplaylist(getplaylist())
+    end
 
-    return parseplaylist(basePlaylist)
+    return snapshot("playlist", playlist_delay, function ()
+        return parseplaylist(getplaylist())
+    end)
 end
 
 getbrowsetable = function ()
@@ -439,7 +467,7 @@ getbrowsetable = function ()
 end
 
 
-getstatus = function (includecategories)
+local buildstatus = function (includecategories)
 
 
     local input = vlc.object.input()
@@ -546,3 +574,11 @@ getstatus = function (includecategories)
     return s
 end
 
+getstatus = function (includecategories)
+    local name = includecategories and "status_full" or "status"
+
+    return snapshot(name, status_delay, function ()
+        return buildstatus(includecategories)
+    end)
+end
+
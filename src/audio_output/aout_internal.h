@@ -73,6 +73,11 @@ typedef struct
         unsigned resamp_start_drift; /**< Resampler drift absolute value */
         int resamp_type; /**< Resampler mode (FIXME: redundant / resampling) */
         bool discontinuity;
+        bool low_latency; /**< Flush rather than resample when late */
+        mtime_t latency; /**< Target latency (0 if unspecified) */
+        mtime_t drift; /**< Smoothed drift (with a target latency) */
+        int resamp_offset; /**< Current resampling offset (Hz) */
+        mtime_t delay; /**< Last measured output delay */
     } sync;
 
     audio_sample_format_t input_format;
@@ -138,6 +143,7 @@ int aout_DecNew(audio_output_t *, const audio_sample_format_t *,
 void aout_DecDelete(audio_output_t *);
 int aout_DecPlay(audio_output_t *, block_t *, int i_input_rate);
 int aout_DecGetResetLost(audio_output_t *);
+mtime_t aout_DecGetLatency(audio_output_t *);
 void aout_DecChangePause(audio_output_t *, bool b_paused, mtime_t i_date);
 void aout_DecFlush(audio_output_t *, bool wait);
 void aout_RequestRestart (audio_output_t *, unsigned);
@@ -105,6 +105,11 @@ error:
     owner->sync.end = VLC_TS_INVALID;
     owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
     owner->sync.discontinuity = true;
+    owner->sync.low_latency = var_InheritBool (p_aout, "low-latency");
+    owner->sync.latency = aout_LatencyTarget (p_aout);
+    owner->sync.drift = 0;
+    owner->sync.resamp_offset = 0;
+    owner->sync.delay = 0;
     aout_OutputUnlock (p_aout);
 
     atomic_init (&owner->buffers_lost, 0);
@@ -189,14 +194,48 @@ void aout_RequestRestart (audio_output_t *aout, unsigned mode)
  * Buffer management
  */
 
+/* Time over which the drift is absorbed with a target latency */
+#define AOUT_DRIFT_PERIOD (2 * CLOCK_FREQ)
+
 static void aout_StopResampling (audio_output_t *aout)
 {
     aout_owner_t *owner = aout_owner (aout);
 
     owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
+    owner->sync.drift = 0;
+    owner->sync.resamp_offset = 0;
     aout_FiltersAdjustResampling (owner->filters, 0);
 }
 
+/**
+ * Corrects the drift continuously, with a target latency. The resampling
+ * offset follows the smoothed drift, so that it is absorbed within
+ * AOUT_DRIFT_PERIOD, without the audible jumps of stepwise resampling.
+ */
+static void aout_DecTrackDrift (audio_output_t *aout, mtime_t drift)
+{
+    aout_owner_t *owner = aout_owner (aout);
+    const int rate = owner->input_format.i_rate;
+    const int max = rate * AOUT_MAX_RESAMPLING / 100;
+
+    /* Smooth the output timing jitter out */
+    owner->sync.drift += (drift - owner->sync.drift) / 8;
+
+    int offset = (int64_t)rate * owner->sync.drift / AOUT_DRIFT_PERIOD;
+    if (offset > max)
+        offset = max;
+    if (offset < -max)
+        offset = -max;
+
+    if (offset == owner->sync.resamp_offset)
+        return;
+
+    int adjust = offset ? offset - owner->sync.resamp_offset : 0;
+    if (!aout_FiltersAdjustResampling (owner->filters, adjust) && offset != 0)
+        return; /* no resampler */
+    owner->sync.resamp_offset = offset;
+}
+
 static void aout_DecSilence (audio_output_t *aout, mtime_t length, mtime_t pts)
 {
     aout_owner_t *owner = aout_owner (aout);
@@ -244,6 +283,7 @@ static void aout_DecSynchronize (audio_output_t *aout, mtime_t dec_pts,
      */
     if (aout_OutputTimeGet (aout, &drift) != 0)
         return; /* nothing can be done if timing is unknown */
+    owner->sync.delay = drift;
     drift += mdate () - dec_pts;
 
     /* Late audio output.
@@ -252,8 +292,12 @@ static void aout_DecSynchronize (audio_output_t *aout, mtime_t dec_pts,
      * is not portable, not supported by some hardware and often unsafe/buggy
      * where supported. The other alternative is to flush the buffers
      * completely. */
+    /* With low latency, up-sampling would take too long to catch up. */
+    const int late_factor =
+        (owner->sync.low_latency || owner->sync.latency > 0) ? 1 : 3;
+
     if (drift > (owner->sync.discontinuity ? 0
-                  : +3 * input_rate * AOUT_MAX_PTS_DELAY / INPUT_RATE_DEFAULT))
+                  : +late_factor * input_rate * AOUT_MAX_PTS_DELAY / INPUT_RATE_DEFAULT))
     {
         if (!owner->sync.discontinuity)
             msg_Warn (aout, "playback way too late (%"PRId64"): "
@@ -288,6 +332,12 @@ static void aout_DecSynchronize (audio_output_t *aout, mtime_t dec_pts,
         drift = 0;
     }
 
+    if (owner->sync.latency > 0)
+    {
+        aout_DecTrackDrift (aout, drift);
+        return;
+    }
+
     /* Resampling */
     if (drift > +AOUT_MAX_PTS_DELAY
      && owner->sync.resamp_type != AOUT_RESAMPLING_UP)
@@ -383,7 +433,11 @@ int aout_DecPlay (audio_output_t *aout, block_t *block, int input_rate)
     /* Output */
     owner->sync.end = block->i_pts + block->i_length + 1;
     owner->sync.discontinuity = false;
+
+    mtime_t trace = vlc_TracePointStart (aout, VLC_TP_AOUT_PLAY);
+    unsigned samples = block->i_nb_samples;
     aout_OutputPlay (aout, block);
+    vlc_TracePoint (aout, VLC_TP_AOUT_PLAY, trace, samples);
 out:
     aout_OutputUnlock (aout);
     return 0;
@@ -401,6 +455,20 @@ int aout_DecGetResetLost (audio_output_t *aout)
     return atomic_exchange(&owner->buffers_lost, 0);
 }
 
+/**
+ * Gets the last measured delay until playback of the audio output.
+ */
+mtime_t aout_DecGetLatency (audio_output_t *aout)
+{
+    aout_owner_t *owner = aout_owner (aout);
+    mtime_t delay;
+
+    aout_OutputLock (aout);
+    delay = owner->sync.delay;
+    aout_OutputUnlock (aout);
+    return delay;
+}
+
 void aout_DecChangePause (audio_output_t *aout, bool paused, mtime_t date)
 {
     aout_owner_t *owner = aout_owner (aout);
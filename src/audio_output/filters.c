@@ -261,10 +261,13 @@ static block_t *aout_FiltersPipelinePlay(filter_t *const *filters,
     for (unsigned i = 0; (i < count) && (block != NULL); i++)
     {
         filter_t *filter = filters[i];
+        vlc_cputime_frame_t frame;
+        bool timed = vlc_CpuTimeStart (filter, &frame);
 
         /* Please note that p_block->i_nb_samples & i_buffer
          * shall be set by the filter plug-in. */
         block = filter->pf_audio_filter (filter, block);
+        vlc_CpuTimeStop (filter, timed, &frame, filter->p_module);
     }
     return block;
 }
@@ -357,6 +357,9 @@ ssize_t config_GetIntChoices (vlc_object_t *obj, const char *name,
     {
         if (cfg->list.i_cb == NULL)
             return 0;
+        /* The callback is only valid once the plug-in is loaded */
+        if (module_MapConfig (obj, cfg))
+            return -1;
         return cfg->list.i_cb(obj, name, values, texts);
     }
 
@@ -452,6 +455,9 @@ ssize_t config_GetPszChoices (vlc_object_t *obj, const char *name,
     {
         if (cfg->list.psz_cb == NULL)
             return 0;
+        /* The callback is only valid once the plug-in is loaded */
+        if (module_MapConfig (obj, cfg))
+            return -1;
         return cfg->list.psz_cb(obj, name, values, texts);
     }
 
@@ -471,26 +477,25 @@ ssize_t config_GetPszChoices (vlc_object_t *obj, const char *name,
     return count;
 }
 
-static int confcmp (const void *a, const void *b)
+static struct
 {
-    const module_config_t *const *ca = a, *const *cb = b;
-
-    return strcmp ((*ca)->psz_name, (*cb)->psz_name);
-}
+    module_config_t **table; /**< Hash table with linear probing */
+    size_t mask; /**< Table size minus one (the size is a power of two) */
+} config = { NULL, 0 };
 
-static int confnamecmp (const void *key, const void *elem)
+/* FNV-1a */
+static size_t confhash (const char *name)
 {
-    const module_config_t *const *conf = elem;
+    uint_fast32_t h = 2166136261u;
 
-    return strcmp (key, (*conf)->psz_name);
+    while (*name)
+    {
+        h ^= (unsigned char)*(name++);
+        h = (h * 16777619u) & 0xffffffff;
+    }
+    return h;
 }
 
-static struct
-{
-    module_config_t **list;
-    size_t count;
-} config = { NULL, 0 };
-
 /**
  * Index the configuration items by name for faster lookups.
  */
@@ -502,14 +507,18 @@ int config_SortConfig (void)
     for (size_t i = 0; i < nmod; i++)
          nconf  += mlist[i]->confsize;
 
-    module_config_t **clist = malloc (sizeof (*clist) * nconf);
-    if (unlikely(clist == NULL))
+    /* Keep the load factor at or below one half */
+    size_t size = 16;
+    while (size < 2 * nconf)
+        size *= 2;
+
+    module_config_t **table = calloc (size, sizeof (*table));
+    if (unlikely(table == NULL))
     {
         module_list_free (mlist);
         return VLC_ENOMEM;
     }
 
-    nconf = 0;
     for (size_t i = 0; i < nmod; i++)
     {
         module_t *parser = mlist[i];
@@ -521,27 +530,31 @@ int config_SortConfig (void)
         {
             if (!CONFIG_ITEM(item->i_type))
                 continue; /* ignore hints */
-            clist[nconf++] = item;
+
+            size_t h = confhash (item->psz_name) & (size - 1);
+            while (table[h] != NULL
+                && strcmp (table[h]->psz_name, item->psz_name))
+                h = (h + 1) & (size - 1);
+            if (table[h] == NULL) /* the first module wins on duplicates */
+                table[h] = item;
         }
     }
     module_list_free (mlist);
 
-    qsort (clist, nconf, sizeof (*clist), confcmp);
-
-    config.list = clist;
-    config.count = nconf;
+    config.table = table;
+    config.mask = size - 1;
     return VLC_SUCCESS;
 }
 
 void config_UnsortConfig (void)
 {
-    module_config_t **clist;
+    module_config_t **table;
 
-    clist = config.list;
-    config.list = NULL;
-    config.count = 0;
+    table = config.table;
+    config.table = NULL;
+    config.mask = 0;
 
-    free (clist);
+    free (table);
 }
 
 /*****************************************************************************
@@ -553,12 +566,15 @@ module_config_t *config_FindConfig (vlc_object_t *p_this, const char *name)
 {
     VLC_UNUSED(p_this);
 
-    if (unlikely(name == NULL))
+    if (unlikely(name == NULL) || config.table == NULL)
         return NULL;
 
-    module_config_t *const *p;
-    p = bsearch (name, config.list, config.count, sizeof (*p), confnamecmp);
-    return p ? *p : NULL;
+    for (size_t h = confhash (name) & config.mask;
+         config.table[h] != NULL;
+         h = (h + 1) & config.mask)
+        if (!strcmp (config.table[h]->psz_name, name))
+            return config.table[h];
+    return NULL;
 }
 
 /**
@@ -34,6 +34,7 @@
 #include <vlc_input.h>
 #include "clock.h"
 #include <assert.h>
+#include <math.h>
 
 /* TODO:
  * - clean up locking once clock code is stable
@@ -66,6 +67,13 @@
  *
  * It is a very important matter if you want to avoid underflow or overflow
  * in all the FIFOs, but it may be not enough.
+ *
+ * The average lags behind the actual drift, which must then be absorbed by
+ * a larger caching. Alternatively, the drift can be tracked by a
+ * second-order phase-locked loop: it estimates both the clock offset and
+ * its rate of change (the frequency error between the two clocks), so it
+ * follows a constant drift without lag, while the loop bandwidth sets how
+ * much network jitter is rejected.
  */
 
 /* i_cr_average : Maximum number of samples used to compute the
@@ -122,6 +130,23 @@ static void    AvgUpdate( average_t *, mtime_t i_value );
 static mtime_t AvgGet( average_t * );
 static void    AvgRescale( average_t *, int i_divider );
 
+/**
+ * This structure holds the phase-locked loop drift estimator
+ */
+typedef struct
+{
+    double  f_bandwidth; /* loop bandwidth (Hz) */
+    bool    b_locked;
+    mtime_t i_date;      /* system date of the last update */
+    double  f_offset;    /* estimated drift (stream clock) */
+    double  f_rate;      /* drift change rate (us/s, i.e. ppm) */
+    double  f_jitter;    /* mean absolute phase error (us) */
+} pll_t;
+static void    PllInit( pll_t *, double f_bandwidth );
+static void    PllReset( pll_t * );
+static void    PllUpdate( pll_t *, mtime_t i_date, mtime_t i_value );
+static mtime_t PllGet( const pll_t * );
+
 /* */
 typedef struct
 {
@@ -157,6 +182,8 @@ struct input_clock_t
     /* Clock drift */
     mtime_t i_next_drift_update;
     average_t drift;
+    bool      b_pll;
+    pll_t     pll;
 
     /* Late statistics */
     struct
@@ -184,6 +211,7 @@ static mtime_t ClockStreamToSystem( input_clock_t *, mtime_t i_stream );
 static mtime_t ClockSystemToStream( input_clock_t *, mtime_t i_system );
 
 static mtime_t ClockGetTsOffset( input_clock_t * );
+static mtime_t ClockGetDrift( input_clock_t * );
 
 /*****************************************************************************
  * input_clock_New: create a new clock
@@ -207,6 +235,8 @@ input_clock_t *input_clock_New( int i_rate )
 
     cl->i_next_drift_update = VLC_TS_INVALID;
     AvgInit( &cl->drift, 10 );
+    cl->b_pll = false;
+    PllInit( &cl->pll, 0. );
 
     cl->late.i_index = 0;
     for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
@@ -272,6 +302,7 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
     {
         cl->i_next_drift_update = VLC_TS_INVALID;
         AvgReset( &cl->drift );
+        PllReset( &cl->pll );
 
         /* Feed synchro with a new reference point. */
         cl->b_has_reference = true;
@@ -282,7 +313,15 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
 
     /* Compute the drift between the stream clock and the system clock
      * when we don't control the source pace */
-    if( !b_can_pace_control && cl->i_next_drift_update < i_ck_system )
+    if( !b_can_pace_control && cl->b_pll )
+    {
+        const mtime_t i_converted = ClockSystemToStream( cl, i_ck_system );
+
+        /* The loop gains depend on the update interval, so every clock
+         * reference can be used */
+        PllUpdate( &cl->pll, i_ck_system, i_converted - i_ck_stream );
+    }
+    else if( !b_can_pace_control && cl->i_next_drift_update < i_ck_system )
     {
         const mtime_t i_converted = ClockSystemToStream( cl, i_ck_system );
 
@@ -314,7 +353,7 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
 
     /* It does not take the decoder latency into account but it is not really
      * the goal of the clock here */
-    const mtime_t i_system_expected = ClockStreamToSystem( cl, i_ck_stream + AvgGet( &cl->drift ) );
+    const mtime_t i_system_expected = ClockStreamToSystem( cl, i_ck_stream + ClockGetDrift( cl ) );
     const mtime_t i_late = ( i_ck_system - cl->i_pts_delay ) - i_system_expected;
     *pb_late = i_late > 0;
     if( i_late > 0 )
@@ -394,7 +433,7 @@ mtime_t input_clock_GetWakeup( input_clock_t *cl )
 
     /* Synchronized, we can wait */
     if( cl->b_has_reference )
-        i_wakeup = ClockStreamToSystem( cl, cl->last.i_stream + AvgGet( &cl->drift ) - cl->i_buffering_duration );
+        i_wakeup = ClockStreamToSystem( cl, cl->last.i_stream + ClockGetDrift( cl ) - cl->i_buffering_duration );
 
     vlc_mutex_unlock( &cl->lock );
 
@@ -432,7 +471,7 @@ int input_clock_ConvertTS( vlc_object_t *p_object, input_clock_t *cl,
     /* */
     if( *pi_ts0 > VLC_TS_INVALID )
     {
-        *pi_ts0 = ClockStreamToSystem( cl, *pi_ts0 + AvgGet( &cl->drift ) );
+        *pi_ts0 = ClockStreamToSystem( cl, *pi_ts0 + ClockGetDrift( cl ) );
         if( *pi_ts0 > cl->i_ts_max )
             cl->i_ts_max = *pi_ts0;
         *pi_ts0 += i_ts_delay;
@@ -441,7 +480,7 @@ int input_clock_ConvertTS( vlc_object_t *p_object, input_clock_t *cl,
     /* XXX we do not update i_ts_max on purpose */
     if( pi_ts1 && *pi_ts1 > VLC_TS_INVALID )
     {
-        *pi_ts1 = ClockStreamToSystem( cl, *pi_ts1 + AvgGet( &cl->drift ) ) +
+        *pi_ts1 = ClockStreamToSystem( cl, *pi_ts1 + ClockGetDrift( cl ) ) +
                   i_ts_delay;
     }
 
@@ -576,6 +615,35 @@ void input_clock_SetJitter( input_clock_t *cl,
     vlc_mutex_unlock( &cl->lock );
 }
 
+void input_clock_SetRecovery( input_clock_t *cl, double f_bandwidth )
+{
+    vlc_mutex_lock( &cl->lock );
+
+    cl->b_pll = f_bandwidth > 0.;
+    if( cl->b_pll && cl->pll.f_bandwidth != f_bandwidth )
+        PllInit( &cl->pll, f_bandwidth );
+
+    vlc_mutex_unlock( &cl->lock );
+}
+
+int input_clock_GetDrift( input_clock_t *cl, double *pf_drift,
+                          mtime_t *pi_jitter )
+{
+    int i_ret = VLC_EGENERIC;
+
+    vlc_mutex_lock( &cl->lock );
+    if( cl->b_pll && cl->pll.b_locked )
+    {
+        /* The offset decreases when the stream clock is faster */
+        *pf_drift = -cl->pll.f_rate;
+        *pi_jitter = llround( cl->pll.f_jitter );
+        i_ret = VLC_SUCCESS;
+    }
+    vlc_mutex_unlock( &cl->lock );
+
+    return i_ret;
+}
+
 mtime_t input_clock_GetJitter( input_clock_t *cl )
 {
     vlc_mutex_lock( &cl->lock );
@@ -631,6 +699,11 @@ static mtime_t ClockGetTsOffset( input_clock_t *cl )
     return cl->i_pts_delay * ( cl->i_rate - INPUT_RATE_DEFAULT ) / INPUT_RATE_DEFAULT;
 }
 
+static mtime_t ClockGetDrift( input_clock_t *cl )
+{
+    return cl->b_pll ? PllGet( &cl->pll ) : AvgGet( &cl->drift );
+}
+
 /*****************************************************************************
  * Long term average helpers
  *****************************************************************************/
@@ -673,3 +746,55 @@ static void AvgRescale( average_t *p_avg, int i_divider )
     p_avg->i_value   = i_tmp / p_avg->i_divider;
     p_avg->i_residue = i_tmp % p_avg->i_divider;
 }
+
+/*****************************************************************************
+ * Phase-locked loop helpers
+ *****************************************************************************/
+static void PllInit( pll_t *p_pll, double f_bandwidth )
+{
+    p_pll->f_bandwidth = f_bandwidth;
+    PllReset( p_pll );
+}
+static void PllReset( pll_t *p_pll )
+{
+    p_pll->b_locked = false;
+    p_pll->i_date = VLC_TS_INVALID;
+    p_pll->f_offset = 0.;
+    p_pll->f_rate = 0.;
+    p_pll->f_jitter = 0.;
+}
+static void PllUpdate( pll_t *p_pll, mtime_t i_date, mtime_t i_value )
+{
+    if( !p_pll->b_locked )
+    {
+        p_pll->b_locked = true;
+        p_pll->i_date = i_date;
+        p_pll->f_offset = i_value;
+        return;
+    }
+
+    const double f_dt = (double)(i_date - p_pll->i_date) / CLOCK_FREQ;
+    if( f_dt <= 0. )
+        return;
+    p_pll->i_date = i_date;
+
+    /* Critically damped (zeta = 1/sqrt(2)) second-order loop, with the
+     * proportional gain capped for stability when updates are sparse */
+    const double f_wn = 2. * M_PI * p_pll->f_bandwidth;
+    double f_alpha = M_SQRT2 * f_wn * f_dt;
+    if( f_alpha > 1. )
+        f_alpha = 1.;
+    const double f_beta = f_alpha * f_alpha / 2.;
+
+    const double f_predicted = p_pll->f_offset + p_pll->f_rate * f_dt;
+    const double f_error = i_value - f_predicted;
+
+    p_pll->f_offset = f_predicted + f_alpha * f_error;
+    p_pll->f_rate += f_beta * f_error / f_dt;
+    /* Same smoothing as the RTP interarrival jitter (RFC 3550) */
+    p_pll->f_jitter += (fabs( f_error ) - p_pll->f_jitter) / 16.;
+}
+static mtime_t PllGet( const pll_t *p_pll )
+{
+    return llround( p_pll->f_offset );
+}
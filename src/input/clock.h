@@ -136,4 +136,20 @@ void input_clock_SetJitter( input_clock_t *,
  */
 mtime_t input_clock_GetJitter( input_clock_t * );
 
+/**
+ * This function selects the drift estimator of the clock: averaging if the
+ * bandwidth is not positive, or a phase-locked loop of the given bandwidth
+ * (in Hz).
+ */
+void input_clock_SetRecovery( input_clock_t *, double f_bandwidth );
+
+/**
+ * This function returns the drift between the stream and system clocks
+ * (in ppm) and the clock reference jitter (in microseconds), as estimated
+ * by the phase-locked loop.
+ *
+ * \return VLC_SUCCESS, or VLC_EGENERIC if no estimation is available
+ */
+int input_clock_GetDrift( input_clock_t *, double *pf_drift, mtime_t *pi_jitter );
+
 #endif
@@ -42,6 +42,9 @@
 #include <vlc_meta.h>
 #include <vlc_dialog.h>
 #include <vlc_modules.h>
+#include <vlc_interrupt.h>
+#include <vlc_atomic.h>
+#include <vlc_memory.h>
 
 #include "audio_output/aout_internal.h"
 #include "stream_output/stream_output.h"
@@ -85,6 +88,15 @@ struct decoder_owner_sys_t
     /* fifo */
     block_fifo_t *p_fifo;
 
+    /* Blocks queued by the input thread without locking, newest first.
+     * They are moved to the fifo whenever the input takes the fifo lock, so
+     * they are always newer than the blocks in the fifo. */
+    atomic_uintptr_t inbox;
+    atomic_size_t    i_inbox_bytes;
+    atomic_uint      i_inbox_count;
+    atomic_bool      b_asleep; /* decoder thread waiting on the fifo */
+    vlc_membudget_t *p_budget; /* accounting of the queued blocks */
+
     /* Lock for communication with decoder thread */
     vlc_mutex_t lock;
     vlc_cond_t  wait_request;
@@ -115,6 +127,16 @@ struct decoder_owner_sys_t
     bool b_draining;
     bool b_drained;
     bool b_idle;
+    bool b_batch; /* dequeued blocks not decoded yet, fifo lock */
+    block_t *p_batch; /* those blocks, decoder thread only */
+
+    /* Queue limits, fifo lock */
+    size_t  i_queue_max_bytes;  /* 0 if not limited */
+    mtime_t i_queue_max_length; /* 0 if not limited */
+    size_t  i_batch_bytes;      /* of the blocks dequeued last */
+    mtime_t i_queue_first;      /* oldest date not decoded yet */
+    mtime_t i_queue_date;       /* arrival of the oldest queued block */
+    mtime_t i_queue_last;       /* newest date queued */
 
     /* CC */
     struct
@@ -124,8 +146,24 @@ struct decoder_owner_sys_t
         decoder_t *pp_decoder[4];
     } cc;
 
+    /* Zap time measurement, VLC_TS_INVALID once the first picture is out */
+    mtime_t i_zap_date;
+
     /* Delay */
     mtime_t i_ts_delay;
+
+    /* Trick play: the video inter frames are dropped, lock */
+    bool b_keyframes_only;
+
+    /* Format of the input changed in place, lock */
+    bool        b_fmt_request;
+    es_format_t fmt_request;
+
+    /* Decoding slot, protected by the decoder scheduler lock */
+    bool b_slot;
+
+    /* Time spent in the decoder for the current block, decoder thread only */
+    mtime_t i_decode_time;
 };
 
 /* Pictures which are DECODER_BOGUS_VIDEO_DELAY or more in advance probably have
@@ -135,6 +173,149 @@ struct decoder_owner_sys_t
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION ((int)(0.200*CLOCK_FREQ))
 
+/* A full decoder queue holds the input back as long as the decoder keeps
+ * consuming it at least that often */
+#define DECODER_QUEUE_TIMEOUT (CLOCK_FREQ)
+
+/*****************************************************************************
+ * Decoding slots
+ *****************************************************************************
+ * The decoders of all the inputs of the process share "decoder-slots" slots:
+ * a decoder holds one while its module decodes, and gives it back while it
+ * waits for a picture buffer or a video output. The decoders of the streams
+ * being displayed or played get the free slots first.
+ * The slot belongs to the decoder rather than to its thread, as the decoder
+ * modules may allocate buffers from threads of their own.
+ *****************************************************************************/
+static struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    unsigned    i_max;     /* 0 if not limited */
+    unsigned    i_running;
+    unsigned    i_waiting; /* decoders with an output waiting for a slot */
+} sched = { VLC_STATIC_MUTEX, VLC_STATIC_COND, 0, 0, 0 };
+
+static void DecoderSlotInit( decoder_t *p_dec )
+{
+    int64_t i_max = var_InheritInteger( p_dec, "decoder-slots" );
+
+    /* The first decoder sets the limit for the whole process */
+    vlc_mutex_lock( &sched.lock );
+    if( sched.i_max == 0 && i_max > 0 )
+        sched.i_max = i_max;
+    vlc_mutex_unlock( &sched.lock );
+}
+
+static void DecoderSlotAcquire( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &sched.lock );
+    if( sched.i_max != 0 && !p_owner->b_slot )
+    {
+        if( p_owner->p_vout != NULL || p_owner->p_aout != NULL )
+        {
+            sched.i_waiting++;
+            while( sched.i_running >= sched.i_max )
+                vlc_cond_wait( &sched.wait, &sched.lock );
+            sched.i_waiting--;
+        }
+        else
+        {
+            while( sched.i_running >= sched.i_max || sched.i_waiting > 0 )
+                vlc_cond_wait( &sched.wait, &sched.lock );
+        }
+        sched.i_running++;
+        p_owner->b_slot = true;
+    }
+    vlc_mutex_unlock( &sched.lock );
+}
+
+static void DecoderSlotRelease( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &sched.lock );
+    if( p_owner->b_slot )
+    {
+        assert( sched.i_running > 0 );
+        sched.i_running--;
+        p_owner->b_slot = false;
+        vlc_cond_broadcast( &sched.wait );
+    }
+    vlc_mutex_unlock( &sched.lock );
+}
+
+/* Lets other decoders run while this one waits, if it holds a slot.
+ * Returns whether DecoderSlotResume() must take the slot back. */
+static bool DecoderSlotYield( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &sched.lock );
+    bool b_slot = p_owner->b_slot;
+    vlc_mutex_unlock( &sched.lock );
+
+    if( b_slot )
+        DecoderSlotRelease( p_dec );
+    return b_slot;
+}
+
+static void DecoderSlotResume( decoder_t *p_dec, bool b_slot )
+{
+    if( b_slot )
+        DecoderSlotAcquire( p_dec );
+}
+
+static picture_t *DecoderSlotDecodeVideo( decoder_t *p_dec,
+                                          block_t **pp_block )
+{
+    vlc_cputime_frame_t frame;
+    DecoderSlotAcquire( p_dec );
+    mtime_t i_start = mdate();
+    bool b_timed = vlc_CpuTimeStart( p_dec, &frame );
+    picture_t *p_pic = p_dec->pf_decode_video( p_dec, pp_block );
+    vlc_CpuTimeStop( p_dec, b_timed, &frame, p_dec->p_module );
+    p_dec->p_owner->i_decode_time += mdate() - i_start;
+    DecoderSlotRelease( p_dec );
+    return p_pic;
+}
+
+static block_t *DecoderSlotDecodeAudio( decoder_t *p_dec, block_t **pp_block )
+{
+    vlc_cputime_frame_t frame;
+    DecoderSlotAcquire( p_dec );
+    mtime_t i_start = mdate();
+    bool b_timed = vlc_CpuTimeStart( p_dec, &frame );
+    block_t *p_buf = p_dec->pf_decode_audio( p_dec, pp_block );
+    vlc_CpuTimeStop( p_dec, b_timed, &frame, p_dec->p_module );
+    p_dec->p_owner->i_decode_time += mdate() - i_start;
+    DecoderSlotRelease( p_dec );
+    return p_buf;
+}
+
+static subpicture_t *DecoderSlotDecodeSub( decoder_t *p_dec,
+                                           block_t **pp_block )
+{
+    vlc_cputime_frame_t frame;
+    DecoderSlotAcquire( p_dec );
+    bool b_timed = vlc_CpuTimeStart( p_dec, &frame );
+    subpicture_t *p_spu = p_dec->pf_decode_sub( p_dec, pp_block );
+    vlc_CpuTimeStop( p_dec, b_timed, &frame, p_dec->p_module );
+    DecoderSlotRelease( p_dec );
+    return p_spu;
+}
+
+static block_t *DecoderPacketize( decoder_t *p_packetizer, block_t **pp_block )
+{
+    vlc_cputime_frame_t frame;
+    bool b_timed = vlc_CpuTimeStart( p_packetizer, &frame );
+    block_t *p_out = p_packetizer->pf_packetize( p_packetizer, pp_block );
+    vlc_CpuTimeStop( p_packetizer, b_timed, &frame, p_packetizer->p_module );
+    return p_out;
+}
+
 /**
  * Load a decoder module
  */
@@ -448,6 +629,9 @@ static int vout_update_format( decoder_t *p_dec )
         case VLC_CODEC_VP8:
             dpb_size = 3;
             break;
+        case VLC_CODEC_VP9:
+            dpb_size = 8;
+            break;
         default:
             dpb_size = 2;
             break;
@@ -489,7 +673,9 @@ static picture_t *vout_new_buffer( decoder_t *p_dec )
             return p_picture;
 
         /* FIXME add a vout_WaitPictureAvailable (timedwait) */
+        bool b_slot = DecoderSlotYield( p_dec );
         msleep( VOUT_OUTMEM_SLEEP );
+        DecoderSlotResume( p_dec, b_slot );
     }
 }
 
@@ -510,7 +696,9 @@ static subpicture_t *spu_new_buffer( decoder_t *p_dec,
         if( p_vout )
             break;
 
+        bool b_slot = DecoderSlotYield( p_dec );
         msleep( DECODER_SPU_VOUT_WAIT_DURATION );
+        DecoderSlotResume( p_dec, b_slot );
     }
 
     if( !p_vout )
@@ -601,9 +789,18 @@ block_t *decoder_NewAudioBuffer( decoder_t *dec, int samples )
 
     size_t length = samples * dec->fmt_out.audio.i_bytes_per_frame
                             / dec->fmt_out.audio.i_frame_length;
-    block_t *block = block_Alloc( length );
+    size_t room = length;
+    unsigned bits = dec->fmt_out.audio.i_bitspersample;
+
+    /* Leave tail room for the audio output to widen the samples to float
+     * in place, rather than copy them to a new block. */
+    if( bits > 0 && bits < 32 && AOUT_FMT_LINEAR( &dec->fmt_out.audio ) )
+        room = length * 32 / bits;
+
+    block_t *block = block_Alloc( room );
     if( likely(block != NULL) )
     {
+        block->i_buffer = length;
         block->i_nb_samples = samples;
         block->i_pts = block->i_length = 0;
     }
@@ -810,7 +1007,7 @@ static void DecoderProcessSout( decoder_t *p_dec, block_t *p_block )
     block_t *p_sout_block;
 
     while( ( p_sout_block =
-                 p_dec->pf_packetize( p_dec, p_block ? &p_block : NULL ) ) )
+                 DecoderPacketize( p_dec, p_block ? &p_block : NULL ) ) )
     {
         if( p_owner->p_sout_input == NULL )
         {
@@ -909,7 +1106,8 @@ static void DecoderGetCc( decoder_t *p_dec, decoder_t *p_dec_cc )
 }
 
 static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
-                              int *pi_played_sum, int *pi_lost_sum )
+                              int *pi_played_sum, int *pi_lost_sum,
+                              int *pi_late_sum )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
     vout_thread_t  *p_vout = p_owner->p_vout;
@@ -947,6 +1145,13 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
     DecoderFixTs( p_dec, &p_picture->date, NULL, NULL,
                   &i_rate, DECODER_BOGUS_VIDEO_DELAY );
 
+    mtime_t i_zap_date = VLC_TS_INVALID;
+    if( !b_reject )
+    {
+        i_zap_date = p_owner->i_zap_date;
+        p_owner->i_zap_date = VLC_TS_INVALID;
+    }
+
     vlc_mutex_unlock( &p_owner->lock );
 
     /* */
@@ -961,6 +1166,18 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
             vout_Flush( p_vout, p_picture->date );
             p_owner->i_last_rate = i_rate;
         }
+
+        input_thread_t *p_input = p_owner->p_input;
+        if( i_zap_date > VLC_TS_INVALID && p_input != NULL )
+        {
+            mtime_t i_zap = __MAX( p_picture->date, mdate() ) - i_zap_date;
+
+            msg_Dbg( p_dec, "first picture %"PRId64" ms after the zap",
+                     i_zap / 1000 );
+            vlc_mutex_lock( &p_input->p->counters.counters_lock );
+            stats_Update( p_input->p->counters.p_zap_time, i_zap, NULL );
+            vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+        }
         vout_PutPicture( p_vout, p_picture );
     }
     else
@@ -975,10 +1192,12 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
     }
     int i_tmp_display;
     int i_tmp_lost;
-    vout_GetResetStatistic( p_vout, &i_tmp_display, &i_tmp_lost );
+    int i_tmp_late;
+    vout_GetResetStatistic( p_vout, &i_tmp_display, &i_tmp_lost, &i_tmp_late );
 
     *pi_played_sum += i_tmp_display;
     *pi_lost_sum += i_tmp_lost;
+    *pi_late_sum += i_tmp_late;
 }
 
 static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
@@ -986,10 +1205,26 @@ static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
     picture_t      *p_pic;
     int i_lost = 0;
+    int i_late = 0;
     int i_decoded = 0;
     int i_displayed = 0;
 
-    while( (p_pic = p_dec->pf_decode_video( p_dec, &p_block )) )
+    /* Drop the inter frames which the demuxer or packetizer flagged */
+    if( p_block != NULL && (p_block->i_flags & BLOCK_FLAG_TYPE_MASK)
+     && !(p_block->i_flags & BLOCK_FLAG_TYPE_I) )
+    {
+        vlc_mutex_lock( &p_owner->lock );
+        bool b_drop = p_owner->b_keyframes_only;
+        vlc_mutex_unlock( &p_owner->lock );
+
+        if( b_drop )
+        {
+            block_Release( p_block );
+            return;
+        }
+    }
+
+    while( (p_pic = DecoderSlotDecodeVideo( p_dec, &p_block )) )
     {
         vout_thread_t  *p_vout = p_owner->p_vout;
         if( DecoderIsFlushing( p_dec ) )
@@ -1021,19 +1256,27 @@ static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
             ( !p_owner->p_packetizer || !p_owner->p_packetizer->pf_get_cc ) )
             DecoderGetCc( p_dec, p_dec );
 
-        DecoderPlayVideo( p_dec, p_pic, &i_displayed, &i_lost );
+        DecoderPlayVideo( p_dec, p_pic, &i_displayed, &i_lost, &i_late );
     }
 
     /* Update ugly stat */
     input_thread_t *p_input = p_owner->p_input;
+    mtime_t i_decode_time = p_owner->i_decode_time;
+    p_owner->i_decode_time = 0;
+    vlc_Latency( p_dec, VLC_LATENCY_DECODE, i_decode_time );
 
-    if( p_input != NULL && (i_decoded > 0 || i_lost > 0 || i_displayed > 0) )
+    if( p_input != NULL && (i_decoded > 0 || i_lost > 0 || i_displayed > 0
+                            || i_late > 0) )
     {
         vlc_mutex_lock( &p_input->p->counters.counters_lock );
         stats_Update( p_input->p->counters.p_decoded_video, i_decoded, NULL );
         stats_Update( p_input->p->counters.p_lost_pictures, i_lost , NULL);
+        stats_Update( p_input->p->counters.p_late_pictures, i_late, NULL );
         stats_Update( p_input->p->counters.p_displayed_pictures,
                       i_displayed, NULL);
+        if( i_decoded > 0 )
+            stats_Update( p_input->p->counters.p_decoder_latency,
+                          i_decode_time, NULL );
         vlc_mutex_unlock( &p_input->p->counters.counters_lock );
     }
 }
@@ -1050,7 +1293,7 @@ static void DecoderProcessVideo( decoder_t *p_dec, block_t *p_block, bool b_flus
         decoder_t *p_packetizer = p_owner->p_packetizer;
 
         while( (p_packetized_block =
-                p_packetizer->pf_packetize( p_packetizer, p_block ? &p_block : NULL )) )
+                DecoderPacketize( p_packetizer, p_block ? &p_block : NULL )) )
         {
             if( !es_format_IsSimilar( &p_dec->fmt_in, &p_packetizer->fmt_out ) )
             {
@@ -1100,7 +1343,8 @@ static void DecoderProcessVideo( decoder_t *p_dec, block_t *p_block, bool b_flus
 }
 
 static void DecoderPlayAudio( decoder_t *p_dec, block_t *p_audio,
-                              int *pi_played_sum, int *pi_lost_sum )
+                              int *pi_played_sum, int *pi_lost_sum,
+                              mtime_t *pi_latency )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
@@ -1152,6 +1396,7 @@ race:
         if( !aout_DecPlay( p_aout, p_audio, i_rate ) )
             *pi_played_sum += 1;
         *pi_lost_sum += aout_DecGetResetLost( p_aout );
+        *pi_latency = aout_DecGetLatency( p_aout );
     }
     else
     {
@@ -1169,8 +1414,9 @@ static void DecoderDecodeAudio( decoder_t *p_dec, block_t *p_block )
     int i_decoded = 0;
     int i_lost = 0;
     int i_played = 0;
+    mtime_t i_latency = -1;
 
-    while( (p_aout_buf = p_dec->pf_decode_audio( p_dec, &p_block )) )
+    while( (p_aout_buf = DecoderSlotDecodeAudio( p_dec, &p_block )) )
     {
         if( DecoderIsFlushing( p_dec ) )
         {
@@ -1198,11 +1444,14 @@ static void DecoderDecodeAudio( decoder_t *p_dec, block_t *p_block )
             p_owner->i_preroll_end = VLC_TS_INVALID;
         }
 
-        DecoderPlayAudio( p_dec, p_aout_buf, &i_played, &i_lost );
+        DecoderPlayAudio( p_dec, p_aout_buf, &i_played, &i_lost, &i_latency );
     }
 
     /* Update ugly stat */
     input_thread_t  *p_input = p_owner->p_input;
+    mtime_t i_decode_time = p_owner->i_decode_time;
+    p_owner->i_decode_time = 0;
+    vlc_Latency( p_dec, VLC_LATENCY_DECODE, i_decode_time );
 
     if( p_input != NULL && (i_decoded > 0 || i_lost > 0 || i_played > 0) )
     {
@@ -1210,6 +1459,12 @@ static void DecoderDecodeAudio( decoder_t *p_dec, block_t *p_block )
         stats_Update( p_input->p->counters.p_lost_abuffers, i_lost, NULL );
         stats_Update( p_input->p->counters.p_played_abuffers, i_played, NULL );
         stats_Update( p_input->p->counters.p_decoded_audio, i_decoded, NULL );
+        if( i_decoded > 0 )
+            stats_Update( p_input->p->counters.p_decoder_latency,
+                          i_decode_time, NULL );
+        if( i_latency >= 0 )
+            stats_Update( p_input->p->counters.p_audio_latency, i_latency,
+                          NULL );
         vlc_mutex_unlock( &p_input->p->counters.counters_lock);
     }
 }
@@ -1226,7 +1481,7 @@ static void DecoderProcessAudio( decoder_t *p_dec, block_t *p_block, bool b_flus
         decoder_t *p_packetizer = p_owner->p_packetizer;
 
         while( (p_packetized_block =
-                p_packetizer->pf_packetize( p_packetizer, p_block ? &p_block : NULL )) )
+                DecoderPacketize( p_packetizer, p_block ? &p_block : NULL )) )
         {
             if( !es_format_IsSimilar( &p_dec->fmt_in, &p_packetizer->fmt_out ) )
             {
@@ -1322,7 +1577,7 @@ static void DecoderProcessSpu( decoder_t *p_dec, block_t *p_block, bool b_flush
     vout_thread_t *p_vout;
     subpicture_t *p_spu;
 
-    while( (p_spu = p_dec->pf_decode_sub( p_dec, p_block ? &p_block : NULL ) ) )
+    while( (p_spu = DecoderSlotDecodeSub( p_dec, p_block ? &p_block : NULL ) ) )
     {
         if( p_input != NULL )
         {
@@ -1381,6 +1636,60 @@ static void DecoderProcessOnFlush( decoder_t *p_dec )
     vlc_mutex_unlock( &p_owner->lock );
 }
 
+static bool DecoderFormatIsSame( const es_format_t *p_fmt1,
+                                 const es_format_t *p_fmt2 )
+{
+    return es_format_IsSimilar( p_fmt1, p_fmt2 )
+        && p_fmt1->i_extra == p_fmt2->i_extra
+        && ( p_fmt1->i_extra == 0
+          || !memcmp( p_fmt1->p_extra, p_fmt2->p_extra, p_fmt1->i_extra ) );
+}
+
+/**
+ * Apply an input format change without recreating the decoder
+ *
+ * Only the first module fed with the input is reloaded: if there is a
+ * packetizer, the decoder follows its output as it does for the in-band
+ * format changes. The output (vout or aout) is kept and reused as long as
+ * the decoded format does not change.
+ */
+static void DecoderChangeFormat( decoder_t *p_dec, const es_format_t *p_fmt )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    decoder_t *p_packetizer = p_owner->p_packetizer;
+
+    if( p_packetizer != NULL )
+    {
+        if( DecoderFormatIsSame( &p_packetizer->fmt_in, p_fmt ) )
+            return;
+
+        msg_Dbg( p_dec, "reloading packetizer due to input format change" );
+        UnloadDecoder( p_packetizer );
+        if( LoadDecoder( p_packetizer, true, p_fmt ) )
+        {
+            p_dec->b_error = true;
+            return;
+        }
+        p_packetizer->fmt_out.b_packetized = true;
+        return;
+    }
+
+    if( DecoderFormatIsSame( &p_dec->fmt_in, p_fmt ) )
+        return;
+
+    msg_Dbg( p_dec, "reloading module due to input format change" );
+
+    /* Drain the decoder module */
+    if( p_dec->fmt_out.i_cat == VIDEO_ES )
+        DecoderDecodeVideo( p_dec, NULL );
+    else if( p_dec->fmt_out.i_cat == AUDIO_ES )
+        DecoderDecodeAudio( p_dec, NULL );
+
+    UnloadDecoder( p_dec );
+    if( LoadDecoder( p_dec, false, p_fmt ) )
+        p_dec->b_error = true;
+}
+
 /**
  * Decode a block
  *
@@ -1419,6 +1728,8 @@ static void DecoderProcess( decoder_t *p_dec, block_t *p_block )
 #endif
     {
         bool b_flush = false;
+        mtime_t i_trace = vlc_TracePointStart( p_dec, VLC_TP_DECODER_DECODE );
+        size_t i_size = p_block ? p_block->i_buffer : 0;
 
         if( p_block )
         {
@@ -1447,6 +1758,7 @@ static void DecoderProcess( decoder_t *p_dec, block_t *p_block )
             msg_Err( p_dec, "unknown ES format" );
             p_dec->b_error = true;
         }
+        vlc_TracePoint( p_dec, VLC_TP_DECODER_DECODE, i_trace, i_size );
     }
 
     /* */
@@ -1455,6 +1767,95 @@ flush:
         DecoderProcessOnFlush( p_dec );
 }
 
+static mtime_t DecoderBlockDate( const block_t *p_block )
+{
+    return p_block->i_dts > VLC_TS_INVALID ? p_block->i_dts : p_block->i_pts;
+}
+
+static bool DecoderQueueIsFull( decoder_owner_sys_t *p_owner )
+{
+    if( p_owner->i_queue_max_bytes != 0
+     && vlc_fifo_GetBytes( p_owner->p_fifo ) + p_owner->i_batch_bytes
+            >= p_owner->i_queue_max_bytes )
+        return true;
+
+    return p_owner->i_queue_max_length != 0
+        && p_owner->i_queue_first > VLC_TS_INVALID
+        && p_owner->i_queue_last - p_owner->i_queue_first
+            >= p_owner->i_queue_max_length;
+}
+
+static void DecoderQueueQueued( decoder_owner_sys_t *p_owner,
+                                const block_t *p_chain )
+{
+    for( const block_t *p = p_chain; p != NULL; p = p->p_next )
+    {
+        mtime_t i_date = DecoderBlockDate( p );
+        if( i_date <= VLC_TS_INVALID )
+            continue;
+        if( p_owner->i_queue_first <= VLC_TS_INVALID )
+            p_owner->i_queue_first = i_date;
+        p_owner->i_queue_last = i_date;
+    }
+}
+
+/* The dequeued blocks count until they are all decoded */
+static void DecoderQueueDequeued( decoder_owner_sys_t *p_owner,
+                                  const block_t *p_chain )
+{
+    p_owner->i_queue_first = VLC_TS_INVALID;
+    for( const block_t *p = p_chain; p != NULL; p = p->p_next )
+    {
+        p_owner->i_batch_bytes += p->i_buffer;
+        if( p_owner->i_queue_first <= VLC_TS_INVALID )
+            p_owner->i_queue_first = DecoderBlockDate( p );
+    }
+}
+
+static bool DecoderInboxPending( decoder_owner_sys_t *p_owner )
+{
+    return atomic_load( &p_owner->inbox ) != 0;
+}
+
+static void DecoderInboxPush( decoder_owner_sys_t *p_owner, block_t *p_chain )
+{
+    while( p_chain != NULL )
+    {
+        block_t *p_block = p_chain;
+        uintptr_t top = atomic_load( &p_owner->inbox );
+
+        p_chain = p_chain->p_next;
+        atomic_fetch_add( &p_owner->i_inbox_bytes, p_block->i_buffer );
+        atomic_fetch_add( &p_owner->i_inbox_count, 1 );
+        do
+            p_block->p_next = (block_t *)top;
+        while( !atomic_compare_exchange_weak( &p_owner->inbox, &top,
+                                              (uintptr_t)p_block ) );
+    }
+}
+
+/* Takes all the blocks of the inbox, oldest first. Any thread may call it. */
+static block_t *DecoderInboxTake( decoder_owner_sys_t *p_owner )
+{
+    block_t *p_block = (block_t *)atomic_exchange( &p_owner->inbox, 0 );
+    block_t *p_chain = NULL;
+    size_t i_bytes = 0;
+    unsigned i_count = 0;
+
+    while( p_block != NULL )
+    {
+        block_t *p_next = p_block->p_next;
+
+        p_block->p_next = p_chain;
+        p_chain = p_block;
+        i_bytes += p_block->i_buffer;
+        i_count++;
+        p_block = p_next;
+    }
+    atomic_fetch_sub( &p_owner->i_inbox_bytes, i_bytes );
+    atomic_fetch_sub( &p_owner->i_inbox_count, i_count );
+    return p_chain;
+}
 
 /**
  * The decoding main loop
@@ -1472,16 +1873,39 @@ static void *DecoderThread( void *p_data )
     {
         block_t *p_block;
 
+        if( p_owner->p_batch != NULL )
+        {   /* Decode the rest of the batch without touching the fifo. No
+             * cancellation point here: the batch would leak. */
+            p_block = p_owner->p_batch;
+            p_owner->p_batch = p_block->p_next;
+            p_block->p_next = NULL;
+
+            vlc_cond_signal( &p_owner->wait_acknowledge );
+            if( p_owner->b_flushing
+             && !(p_block->i_flags & BLOCK_FLAG_CORE_FLUSH) )
+            {   /* Queued before the flush request, which emptied the fifo */
+                block_Release( p_block );
+                continue;
+            }
+            vlc_mutex_unlock( &p_owner->lock );
+            goto process;
+        }
+
         vlc_fifo_Lock( p_owner->p_fifo );
+        p_owner->b_batch = false;
+        p_owner->i_batch_bytes = 0;
+        p_owner->i_queue_first = VLC_TS_INVALID;
         vlc_cond_signal( &p_owner->wait_acknowledge );
         vlc_mutex_unlock( &p_owner->lock );
+        bool b_fifo;
         vlc_fifo_CleanupPush( p_owner->p_fifo );
         /* Check if thread is cancelled before processing input blocks */
         vlc_testcancel();
 
         vlc_cond_signal( &p_owner->wait_fifo );
 
-        while( vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        while( vlc_fifo_IsEmpty( p_owner->p_fifo )
+            && !DecoderInboxPending( p_owner ) )
         {
             if( p_owner->b_draining )
             {   /* We have emptied the FIFO and there is a pending request to
@@ -1491,17 +1915,52 @@ static void *DecoderThread( void *p_data )
             }
 
             p_owner->b_idle = true;
-            vlc_fifo_Wait( p_owner->p_fifo );
+            /* The input checks b_asleep after pushing to the inbox */
+            atomic_store( &p_owner->b_asleep, true );
+            if( !DecoderInboxPending( p_owner ) )
+                vlc_fifo_Wait( p_owner->p_fifo );
             /* Make sure there is no cancellation point other than this one^^.
              * If you need one, be sure to push cleanup of p_block. */
+            atomic_store( &p_owner->b_asleep, false );
             p_owner->b_idle = false;
         }
 
-        p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
+        p_block = vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo );
+        b_fifo = p_block != NULL;
+        block_ChainAppend( &p_block, DecoderInboxTake( p_owner ) );
         vlc_cleanup_pop();
+        if( p_block != NULL )
+        {
+            DecoderQueueDequeued( p_owner, p_block );
+            p_owner->p_batch = p_block->p_next;
+            p_block->p_next = NULL;
+            p_owner->b_batch = p_owner->p_batch != NULL;
+        }
+        vlc_membudget_Set( p_owner->p_budget, p_owner->i_batch_bytes );
+        mtime_t i_queued = p_owner->i_queue_date;
         vlc_fifo_Unlock( p_owner->p_fifo );
 
+        if( b_fifo )
+            vlc_LatencySince( p_dec, VLC_LATENCY_DECODER_QUEUE, i_queued );
+
+process:;
         int canc = vlc_savecancel();
+
+        vlc_mutex_lock( &p_owner->lock );
+        if( p_owner->b_fmt_request )
+        {
+            es_format_t fmt = p_owner->fmt_request;
+
+            p_owner->b_fmt_request = false;
+            es_format_Init( &p_owner->fmt_request, UNKNOWN_ES, 0 );
+            vlc_mutex_unlock( &p_owner->lock );
+
+            DecoderChangeFormat( p_dec, &fmt );
+            es_format_Clean( &fmt );
+        }
+        else
+            vlc_mutex_unlock( &p_owner->lock );
+
         DecoderProcess( p_dec, p_block );
 
         vlc_mutex_lock( &p_owner->lock );
@@ -1564,6 +2023,10 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->p_description = NULL;
 
     p_owner->b_paused = false;
+    p_owner->b_keyframes_only = false;
+    p_owner->b_fmt_request = false;
+    es_format_Init( &p_owner->fmt_request, UNKNOWN_ES, 0 );
+    p_owner->i_zap_date = VLC_TS_INVALID;
     p_owner->pause.i_date = VLC_TS_INVALID;
     p_owner->pause.i_ignore = 0;
 
@@ -1575,6 +2038,20 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->b_draining = false;
     p_owner->b_drained = false;
     p_owner->b_idle = false;
+    p_owner->b_batch = false;
+    p_owner->p_batch = NULL;
+    atomic_init( &p_owner->inbox, 0 );
+    atomic_init( &p_owner->i_inbox_bytes, 0 );
+    atomic_init( &p_owner->i_inbox_count, 0 );
+    atomic_init( &p_owner->b_asleep, false );
+
+    p_owner->i_queue_max_bytes =
+        var_InheritInteger( p_dec, "decoder-queue-size" ) * 1024;
+    p_owner->i_queue_max_length =
+        var_InheritInteger( p_dec, "decoder-queue-duration" ) * 1000;
+    p_owner->i_batch_bytes = 0;
+    p_owner->i_queue_first = VLC_TS_INVALID;
+    p_owner->i_queue_last = VLC_TS_INVALID;
 
     es_format_Init( &p_owner->fmt, UNKNOWN_ES, 0 );
 
@@ -1586,6 +2063,7 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
         vlc_object_release( p_dec );
         return NULL;
     }
+    p_owner->p_budget = vlc_membudget_Register( "decoder", NULL, NULL );
 
     vlc_mutex_init( &p_owner->lock );
     vlc_cond_init( &p_owner->wait_request );
@@ -1660,6 +2138,11 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
         p_owner->cc.pp_decoder[i] = NULL;
     }
     p_owner->i_ts_delay = 0;
+
+    p_owner->b_slot = false;
+    p_owner->i_decode_time = 0;
+    p_owner->i_queue_date = VLC_TS_INVALID;
+    DecoderSlotInit( p_dec );
     return p_dec;
 }
 
@@ -1681,7 +2164,9 @@ static void DeleteDecoder( decoder_t * p_dec )
     UnloadDecoder( p_dec );
 
     /* Free all packets still in the decoder fifo. */
+    block_ChainRelease( DecoderInboxTake( p_owner ) );
     block_FifoRelease( p_owner->p_fifo );
+    vlc_membudget_Unregister( p_owner->p_budget );
 
     /* Cleanup */
     if( p_owner->p_aout )
@@ -1712,6 +2197,7 @@ static void DeleteDecoder( decoder_t * p_dec )
         sout_InputDelete( p_owner->p_sout_input );
     }
 #endif
+    es_format_Clean( &p_owner->fmt_request );
     es_format_Clean( &p_owner->fmt );
 
     if( b_flush_spu )
@@ -1873,17 +2359,75 @@ void input_DecoderDelete( decoder_t *p_dec )
 }
 
 /**
- * Put a block_t in the decoder's fifo.
+ * Put a block_t, or a chain of block_t, in the decoder's fifo.
  * Thread-safe w.r.t. the decoder. May be a cancellation point.
  *
+ * The decoder thread takes all the queued blocks at once, so submitting the
+ * blocks of a stream with a high packet rate as a chain saves locking and
+ * wake-ups on both sides.
+ *
+ * Unless the queue has limits or must be paced, the blocks are pushed without
+ * taking the fifo lock, so the input thread does not wait for a decoder
+ * thread busy with its fifo while feeding the other decoders.
+ *
  * \param p_dec the decoder object
- * \param p_block the data block
+ * \param p_block the data block or chain of data blocks
  */
 void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    size_t i_fifo;
+    bool b_held = false;
+
+    if( !(p_block->i_flags & BLOCK_FLAG_CORE_FLUSH)
+     && p_owner->i_queue_max_bytes == 0 && p_owner->i_queue_max_length == 0
+     && ( !b_do_pace || p_owner->b_waiting
+       || atomic_load( &p_owner->i_inbox_count ) < 10 )
+     && atomic_load( &p_owner->i_inbox_bytes ) <= 400*1024*1024 )
+    {
+        DecoderInboxPush( p_owner, p_block );
+        if( atomic_load( &p_owner->b_asleep ) )
+        {
+            vlc_fifo_Lock( p_owner->p_fifo );
+            vlc_fifo_Signal( p_owner->p_fifo );
+            vlc_fifo_Unlock( p_owner->p_fifo );
+        }
+        i_fifo = atomic_load( &p_owner->i_inbox_bytes );
+        goto stats;
+    }
 
     vlc_fifo_Lock( p_owner->p_fifo );
+
+    /* Keep the blocks in order */
+    block_t *p_inbox = DecoderInboxTake( p_owner );
+    if( p_inbox != NULL )
+    {
+        DecoderQueueQueued( p_owner, p_inbox );
+        if( vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+            p_owner->i_queue_date = vlc_LatencyStart( p_dec );
+        vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_inbox );
+    }
+
+    /* Hold the input back while the queue is full and the decoder consumes
+     * it. The FIFO is not consumed when waiting, and the flush request is
+     * sent with the decoder lock held. */
+    if( !p_owner->b_waiting && !(p_block->i_flags & BLOCK_FLAG_CORE_FLUSH)
+     && DecoderQueueIsFull( p_owner ) )
+    {
+        b_held = true;
+        do
+        {
+            if( vlc_fifo_TimedWaitCond( p_owner->p_fifo, &p_owner->wait_fifo,
+                                        mdate() + DECODER_QUEUE_TIMEOUT ) )
+            {
+                msg_Warn( p_dec, "decoder queue not consumed, exceeding "
+                          "its limits" );
+                break;
+            }
+        }
+        while( DecoderQueueIsFull( p_owner ) && !vlc_killed() );
+    }
+
     if( !b_do_pace )
     {
         /* FIXME: ideally we would check the time amount of data
@@ -1905,8 +2449,32 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
             vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
     }
 
+    DecoderQueueQueued( p_owner, p_block );
+    if( vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        p_owner->i_queue_date = vlc_LatencyStart( p_dec );
     vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
+    i_fifo = vlc_fifo_GetBytes( p_owner->p_fifo );
     vlc_fifo_Unlock( p_owner->p_fifo );
+
+stats:
+    vlc_membudget_Set( p_owner->p_budget, i_fifo );
+
+    input_thread_t *p_input = p_owner->p_input;
+    if( p_input != NULL )
+    {
+        counter_t *p_fifo_counter = NULL;
+        if( p_dec->fmt_in.i_cat == VIDEO_ES )
+            p_fifo_counter = p_input->p->counters.p_video_fifo;
+        else if( p_dec->fmt_in.i_cat == AUDIO_ES )
+            p_fifo_counter = p_input->p->counters.p_audio_fifo;
+
+        vlc_mutex_lock( &p_input->p->counters.counters_lock );
+        if( b_held )
+            stats_Update( p_input->p->counters.p_decoder_held, 1, NULL );
+        if( p_fifo_counter != NULL )
+            stats_Update( p_fifo_counter, i_fifo, NULL );
+        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+    }
 }
 
 bool input_DecoderIsEmpty( decoder_t * p_dec )
@@ -1915,7 +2483,11 @@ bool input_DecoderIsEmpty( decoder_t * p_dec )
 
     assert( !p_owner->b_waiting );
 
-    if( block_FifoCount( p_dec->p_owner->p_fifo ) > 0 )
+    vlc_fifo_Lock( p_owner->p_fifo );
+    bool b_queued = !vlc_fifo_IsEmpty( p_owner->p_fifo ) || p_owner->b_batch
+                 || DecoderInboxPending( p_owner );
+    vlc_fifo_Unlock( p_owner->p_fifo );
+    if( b_queued )
         return false;
 
     bool b_empty;
@@ -1959,6 +2531,8 @@ static void DecoderFlush( decoder_t *p_dec )
     vlc_fifo_Lock( p_owner->p_fifo );
     /* Empty the fifo */
     block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+    block_ChainRelease( DecoderInboxTake( p_owner ) );
+    p_owner->i_queue_first = VLC_TS_INVALID;
     p_owner->b_draining = false; /* flush supersedes drain */
     vlc_fifo_Unlock( p_owner->p_fifo );
 
@@ -2114,6 +2688,42 @@ void input_DecoderChangeDelay( decoder_t *p_dec, mtime_t i_delay )
     vlc_mutex_unlock( &p_owner->lock );
 }
 
+void input_DecoderSetKeyframesOnly( decoder_t *p_dec, bool b_keyframes_only )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &p_owner->lock );
+    p_owner->b_keyframes_only = b_keyframes_only;
+    vlc_mutex_unlock( &p_owner->lock );
+}
+
+int input_DecoderChangeFormat( decoder_t *p_dec, const es_format_t *p_fmt )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    /* The stream output packetizers cannot change format in place, nor the
+     * decoders fed with packetized data that would need a packetizer now */
+    if( p_owner->b_packetizer
+     || ( p_owner->p_packetizer == NULL && !p_fmt->b_packetized ) )
+        return VLC_EGENERIC;
+
+    vlc_mutex_lock( &p_owner->lock );
+    es_format_Clean( &p_owner->fmt_request );
+    es_format_Copy( &p_owner->fmt_request, p_fmt );
+    p_owner->b_fmt_request = true;
+    vlc_mutex_unlock( &p_owner->lock );
+    return VLC_SUCCESS;
+}
+
+void input_DecoderSetZapDate( decoder_t *p_dec, mtime_t i_date )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &p_owner->lock );
+    p_owner->i_zap_date = i_date;
+    vlc_mutex_unlock( &p_owner->lock );
+}
+
 void input_DecoderStartWait( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
@@ -2150,7 +2760,8 @@ void input_DecoderWait( decoder_t *p_dec )
     while( !p_owner->b_has_data )
     {
         vlc_fifo_Lock( p_owner->p_fifo );
-        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo )
+         && !DecoderInboxPending( p_owner ) )
         {
             msg_Warn( p_dec, "can't wait without data to decode" );
             vlc_fifo_Unlock( p_owner->p_fifo );
@@ -2219,7 +2830,8 @@ size_t input_DecoderGetFifoSize( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
-    return block_FifoSize( p_owner->p_fifo );
+    return block_FifoSize( p_owner->p_fifo )
+         + atomic_load( &p_owner->i_inbox_bytes );
 }
 
 void input_DecoderGetObjects( decoder_t *p_dec,
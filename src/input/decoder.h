@@ -45,6 +45,26 @@ void input_DecoderChangePause( decoder_t *, bool b_paused, mtime_t i_date );
  */
 void input_DecoderChangeDelay( decoder_t *, mtime_t i_delay );
 
+/**
+ * This function makes a video decoder drop the blocks flagged as P or B
+ * frames (for trick play).
+ */
+void input_DecoderSetKeyframesOnly( decoder_t *, bool b_keyframes_only );
+
+/**
+ * This function changes the format of the input of the decoder in place.
+ * The decoder applies it before its next block, reloading only the modules
+ * whose input changed and keeping its output.
+ * It returns an error if the decoder must be recreated instead.
+ */
+int input_DecoderChangeFormat( decoder_t *, const es_format_t * );
+
+/**
+ * This function sets the date the zap time of the decoder is measured from,
+ * until the display date of its first picture.
+ */
+void input_DecoderSetZapDate( decoder_t *, mtime_t i_date );
+
 /**
  * This function makes the decoder start waiting for a valid data block from its fifo.
  */
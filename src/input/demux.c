@@ -50,6 +50,43 @@ static int typecmp( const void *k, const void *t )
     return vlc_ascii_strcasecmp( key, type->type );
 }
 
+/* Guess the demux from the first bytes of the stream, before the
+ * probing walk, for formats with an unambiguous signature only. */
+static const char *demux_FromMagic( stream_t *s )
+{
+    static const struct
+    {
+        uint8_t offset;
+        uint8_t length;
+        char magic[20];
+        char demux[5];
+    } magics[] =
+    {
+        {  0,  4, "\x1A\x45\xDF\xA3", "mkv"  },
+        {  4,  4, "ftyp",             "mp4"  },
+        {  4,  4, "moov",             "mp4"  },
+        {  0,  4, "OggS",             "ogg"  },
+        {  0,  4, "fLaC",             "flac" },
+        {  8,  4, "AVI ",             "avi"  },
+        {  0,  8, "\x30\x26\xB2\x75\x8E\x66\xCF\x11", "asf" },
+        {  8,  4, "AIFF",             "aiff" },
+        {  0,  4, ".snd",             "au"   },
+        {  0,  4, "MThd",             "smf"  },
+        {  0, 19, "Creative Voice File", "voc" },
+    };
+    const uint8_t *peek;
+    ssize_t len = stream_Peek( s, &peek, 20 );
+
+    for( size_t i = 0; i < sizeof (magics) / sizeof (magics[0]); i++ )
+    {
+        if( magics[i].offset + magics[i].length <= len
+         && !memcmp( peek + magics[i].offset, magics[i].magic,
+                     magics[i].length ) )
+            return magics[i].demux;
+    }
+    return NULL;
+}
+
 static const char *demux_FromContentType(const char *mime)
 {
     static const struct demux_type types[] =
@@ -202,6 +239,14 @@ demux_t *demux_New( vlc_object_t *p_obj, input_thread_t *p_parent_input,
           ;
         SkipAPETag( p_demux );
 
+        /* Try the demux matching the signature first, if any */
+        if( !strcmp( psz_module, "any" ) )
+        {
+            const char *psz_magic = demux_FromMagic( s );
+            if( psz_magic != NULL )
+                psz_module = psz_magic;
+        }
+
         p_demux->p_module =
             module_need( p_demux, "demux", psz_module,
                          !strcmp( psz_module, p_demux->psz_demux ) );
@@ -29,6 +29,7 @@
 #include <vlc_demux.h>
 
 #include "stream.h"
+#include "../libvlc.h"
 
 /* stream_t *s could be null and then it mean a access+demux in one */
 demux_t *demux_New( vlc_object_t *p_obj, input_thread_t *p_parent_input, const char *psz_access, const char *psz_demux, const char *psz_path, stream_t *s, es_out_t *out, bool );
@@ -41,7 +42,11 @@ static inline int demux_Demux( demux_t *p_demux )
     if( !p_demux->pf_demux )
         return 1;
 
-    return p_demux->pf_demux( p_demux );
+    vlc_cputime_frame_t frame;
+    bool b_timed = vlc_CpuTimeStart( p_demux, &frame );
+    int i_ret = p_demux->pf_demux( p_demux );
+    vlc_CpuTimeStop( p_demux, b_timed, &frame, p_demux->p_module );
+    return i_ret;
 }
 static inline int demux_vaControl( demux_t *p_demux, int i_query, va_list args )
 {
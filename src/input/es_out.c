@@ -93,6 +93,13 @@ struct es_out_id_t
     decoder_t   *p_dec;
     decoder_t   *p_dec_record;
 
+    /* Data queued while the ES is selected in standby, without decoder */
+    bool        b_standby;
+    bool        b_standby_keyframes; /* keyframes are flagged */
+    block_t     *p_standby;
+    block_t     **pp_standby_last;
+    mtime_t     i_standby_start; /* date of the first queued block */
+
     /* Fields for Video with CC */
     bool  pb_cc_present[4];
     es_out_id_t  *pp_cc_es[4];
@@ -151,8 +158,13 @@ struct es_out_sys_t
     mtime_t     i_pts_delay;
     mtime_t     i_pts_jitter;
     int         i_cr_average;
+    double      f_clock_bandwidth; /* PLL bandwidth, or 0 for averaging */
+    bool        b_low_latency;
     int         i_rate;
 
+    /* Latency measurement */
+    mtime_t     i_latency_date;
+
     /* */
     bool        b_paused;
     mtime_t     i_pause_date;
@@ -160,6 +172,15 @@ struct es_out_sys_t
     /* Current preroll */
     mtime_t     i_preroll_end;
 
+    /* Trick play */
+    bool        b_keyframes_only;
+
+    /* Standby (fast zapping) */
+    bool        b_standby;
+    bool        b_standby_full;
+    mtime_t     i_standby_length;
+    mtime_t     i_zap_date; /* to measure the zap time from */
+
     /* Used for buffering */
     bool        b_buffering;
     mtime_t     i_buffering_extra_initial;
@@ -183,6 +204,8 @@ static void         EsOutTerminate( es_out_t * );
 static void         EsOutSelect( es_out_t *, es_out_id_t *es, bool b_force );
 static void         EsOutUpdateInfo( es_out_t *, es_out_id_t *es, const es_format_t *, const vlc_meta_t * );
 static int          EsOutSetRecord(  es_out_t *, bool b_record );
+static void         EsOutStandbyQueue( es_out_t *, es_out_id_t *es, block_t * );
+static void         EsOutSetStandby( es_out_t *, bool b_standby );
 
 static bool EsIsSelected( es_out_id_t *es );
 static void EsSelect( es_out_t *out, es_out_id_t *es );
@@ -256,6 +279,17 @@ es_out_t *input_EsOutNew( input_thread_t *p_input, int i_rate )
     TAB_INIT( p_sys->i_es, p_sys->es );
 
     /* */
+    p_sys->b_low_latency = var_InheritBool( p_input, "low-latency" );
+    p_sys->f_clock_bandwidth = 0.;
+    if( var_InheritInteger( p_input, "clock-recovery" ) == 1
+     || p_sys->b_low_latency )
+        p_sys->f_clock_bandwidth = var_InheritFloat( p_input,
+                                                     "clock-recovery-bandwidth" );
+    p_sys->i_latency_date = VLC_TS_INVALID;
+    p_sys->i_standby_length = var_InheritInteger( p_input, "standby-buffer" )
+                            * (CLOCK_FREQ / 1000);
+    p_sys->i_zap_date = mdate();
+
     p_sys->i_group_id = var_GetInteger( p_input, "program" );
     p_sys->i_audio_last = var_GetInteger( p_input, "audio-track" );
     p_sys->i_sub_last = var_GetInteger( p_input, "sub-track" );
@@ -577,6 +611,13 @@ static void EsOutChangePosition( es_out_t *out )
     {
         es_out_id_t *p_es = p_sys->es[i];
 
+        if( p_es->b_standby )
+        {
+            block_ChainRelease( p_es->p_standby );
+            p_es->p_standby = NULL;
+            p_es->pp_standby_last = &p_es->p_standby;
+            p_es->i_standby_start = VLC_TS_INVALID;
+        }
         if( p_es->p_dec != NULL )
         {
             input_DecoderFlush( p_es->p_dec );
@@ -598,6 +639,7 @@ static void EsOutChangePosition( es_out_t *out )
     p_sys->i_buffering_extra_system = 0;
     p_sys->i_preroll_end = -1;
     p_sys->i_prev_stream_level = -1;
+    p_sys->b_standby_full = false;
 }
 
 
@@ -606,6 +648,12 @@ static void EsOutDecodersStopBuffering( es_out_t *out, bool b_forced )
 {
     es_out_sys_t *p_sys = out->p_sys;
 
+    /* An input whose pace is controllable keeps buffering in standby, so that
+     * its clock only starts when it leaves the standby */
+    if( p_sys->b_standby && !b_forced
+     && p_sys->p_input->p->b_can_pace_control )
+        return;
+
     mtime_t i_stream_start;
     mtime_t i_system_start;
     mtime_t i_stream_duration;
@@ -670,8 +718,10 @@ static void EsOutDecodersStopBuffering( es_out_t *out, bool b_forced )
     msg_Dbg( p_sys->p_input, "Decoder wait done in %d ms",
               (int)(mdate() - i_decoder_buffering_start)/1000 );
 
-    /* Here is a good place to destroy unused vout with every demuxer */
-    input_resource_TerminateVout( p_sys->p_input->p->p_resource );
+    /* Here is a good place to destroy unused vout with every demuxer,
+     * unless it is kept for the playing input */
+    if( !p_sys->b_standby )
+        input_resource_TerminateVout( p_sys->p_input->p->p_resource );
 
     /* */
     const mtime_t i_wakeup_delay = 10*1000; /* FIXME CLEANUP thread wake up time*/
@@ -1063,6 +1113,7 @@ static es_out_pgrm_t *EsOutProgramAdd( es_out_t *out, int i_group )
     if( p_sys->b_paused )
         input_clock_ChangePause( p_pgrm->p_clock, p_sys->b_paused, p_sys->i_pause_date );
     input_clock_SetJitter( p_pgrm->p_clock, p_sys->i_pts_delay, p_sys->i_cr_average );
+    input_clock_SetRecovery( p_pgrm->p_clock, p_sys->f_clock_bandwidth );
 
     /* Append it */
     TAB_APPEND( p_sys->i_pgrm, p_sys->pgrm, p_pgrm );
@@ -1498,6 +1549,9 @@ static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *fmt )
     es->psz_language_code = LanguageGetCode( es->fmt.psz_language );
     es->p_dec = NULL;
     es->p_dec_record = NULL;
+    es->b_standby = false;
+    es->p_standby = NULL;
+    es->pp_standby_last = &es->p_standby;
     for( i = 0; i < 4; i++ )
         es->pb_cc_present[i] = false;
     es->p_master = NULL;
@@ -1549,7 +1603,7 @@ static bool EsIsSelected( es_out_id_t *es )
     }
     else
     {
-        return es->p_dec != NULL;
+        return es->p_dec != NULL || es->b_standby;
     }
 }
 static void EsCreateDecoder( es_out_t *out, es_out_id_t *p_es )
@@ -1557,11 +1611,28 @@ static void EsCreateDecoder( es_out_t *out, es_out_id_t *p_es )
     es_out_sys_t   *p_sys = out->p_sys;
     input_thread_t *p_input = p_sys->p_input;
 
+    if( p_sys->b_standby && !p_es->p_master )
+    {   /* The decoder is created when the input leaves the standby */
+        p_es->b_standby = true;
+        p_es->b_standby_keyframes = false;
+        p_es->p_standby = NULL;
+        p_es->pp_standby_last = &p_es->p_standby;
+        p_es->i_standby_start = VLC_TS_INVALID;
+        return;
+    }
+
     p_es->p_dec = input_DecoderNew( p_input, &p_es->fmt, p_es->p_pgrm->p_clock, p_input->p->p_sout );
     if( p_es->p_dec )
     {
+        if( p_es->fmt.i_cat == VIDEO_ES && p_sys->i_zap_date > VLC_TS_INVALID )
+        {
+            input_DecoderSetZapDate( p_es->p_dec, p_sys->i_zap_date );
+            p_sys->i_zap_date = VLC_TS_INVALID;
+        }
         if( p_sys->b_buffering )
             input_DecoderStartWait( p_es->p_dec );
+        if( p_sys->b_keyframes_only && p_es->fmt.i_cat == VIDEO_ES )
+            input_DecoderSetKeyframesOnly( p_es->p_dec, true );
 
         if( !p_es->p_master && p_sys->p_sout_record )
         {
@@ -1577,6 +1648,14 @@ static void EsDestroyDecoder( es_out_t *out, es_out_id_t *p_es )
 {
     VLC_UNUSED(out);
 
+    if( p_es->b_standby )
+    {
+        block_ChainRelease( p_es->p_standby );
+        p_es->p_standby = NULL;
+        p_es->pp_standby_last = &p_es->p_standby;
+        p_es->b_standby = false;
+    }
+
     if( !p_es->p_dec )
         return;
 
@@ -1644,7 +1723,8 @@ static void EsSelect( es_out_t *out, es_out_id_t *es )
 
         EsCreateDecoder( out, es );
 
-        if( es->p_dec == NULL || es->p_pgrm != p_sys->p_pgrm )
+        if( ( es->p_dec == NULL && !es->b_standby )
+         || es->p_pgrm != p_sys->p_pgrm )
             return;
     }
 
@@ -1914,7 +1994,7 @@ static void EsOutSelect( es_out_t *out, es_out_id_t *es, bool b_force )
  *
  * \param out the es_out to send from
  * \param es the es_out_id
- * \param p_block the data block to send
+ * \param p_block the data block, or chain of data blocks, to send
  */
 static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
 {
@@ -1926,19 +2006,22 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
         uint64_t i_total;
 
         vlc_mutex_lock( &p_input->p->counters.counters_lock );
-        stats_Update( p_input->p->counters.p_demux_read,
-                      p_block->i_buffer, &i_total );
-        stats_Update( p_input->p->counters.p_demux_bitrate, i_total, NULL );
-
-        /* Update number of corrupted data packats */
-        if( p_block->i_flags & BLOCK_FLAG_CORRUPTED )
+        for( block_t *p = p_block; p != NULL; p = p->p_next )
         {
-            stats_Update( p_input->p->counters.p_demux_corrupted, 1, NULL );
-        }
-        /* Update number of discontinuities */
-        if( p_block->i_flags & BLOCK_FLAG_DISCONTINUITY )
-        {
-            stats_Update( p_input->p->counters.p_demux_discontinuity, 1, NULL );
+            stats_Update( p_input->p->counters.p_demux_read,
+                          p->i_buffer, &i_total );
+            stats_Update( p_input->p->counters.p_demux_bitrate, i_total, NULL );
+
+            /* Update number of corrupted data packats */
+            if( p->i_flags & BLOCK_FLAG_CORRUPTED )
+            {
+                stats_Update( p_input->p->counters.p_demux_corrupted, 1, NULL );
+            }
+            /* Update number of discontinuities */
+            if( p->i_flags & BLOCK_FLAG_DISCONTINUITY )
+            {
+                stats_Update( p_input->p->counters.p_demux_discontinuity, 1, NULL );
+            }
         }
         vlc_mutex_unlock( &p_input->p->counters.counters_lock );
     }
@@ -1948,17 +2031,27 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
     /* Mark preroll blocks */
     if( p_sys->i_preroll_end >= 0 )
     {
-        int64_t i_date = p_block->i_pts;
-        if( p_block->i_pts <= VLC_TS_INVALID )
-            i_date = p_block->i_dts;
+        for( block_t *p = p_block; p != NULL; p = p->p_next )
+        {
+            int64_t i_date = p->i_pts;
+            if( p->i_pts <= VLC_TS_INVALID )
+                i_date = p->i_dts;
+
+            if( i_date < p_sys->i_preroll_end )
+                p->i_flags |= BLOCK_FLAG_PREROLL;
+        }
+    }
 
-        if( i_date < p_sys->i_preroll_end )
-            p_block->i_flags |= BLOCK_FLAG_PREROLL;
+    if( es->b_standby )
+    {
+        EsOutStandbyQueue( out, es, p_block );
+        vlc_mutex_unlock( &p_sys->lock );
+        return VLC_SUCCESS;
     }
 
     if( !es->p_dec )
     {
-        block_Release( p_block );
+        block_ChainRelease( p_block );
         vlc_mutex_unlock( &p_sys->lock );
         return VLC_SUCCESS;
     }
@@ -1981,10 +2074,35 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
         }
     }
 
+    /* Measure the delay until presentation of the master program data,
+     * from the time it is received */
+    if( es->p_pgrm == p_sys->p_pgrm && !p_sys->b_buffering
+     && es->fmt.i_cat != SPU_ES && p_block->i_pts > VLC_TS_INVALID
+     && p_sys->i_latency_date <= mdate() )
+    {
+        mtime_t i_date = p_block->i_pts;
+        mtime_t i_now = mdate();
+
+        if( input_clock_ConvertTS( VLC_OBJECT(p_input), es->p_pgrm->p_clock,
+                                   NULL, &i_date, NULL,
+                                   INT64_MAX ) == VLC_SUCCESS )
+        {
+            vlc_value_t val = { .i_int = __MAX( i_date - i_now, 0 ) };
+            var_Change( p_input, "latency", VLC_VAR_SETVALUE, &val, NULL );
+        }
+        p_sys->i_latency_date = i_now + CLOCK_FREQ / 4;
+    }
+
     /* Decode */
     if( es->p_dec_record )
     {
-        block_t *p_dup = block_Duplicate( p_block );
+        block_t *p_dup = NULL, **pp_last = &p_dup;
+        for( block_t *p = p_block; p != NULL; p = p->p_next )
+        {
+            block_t *p_copy = block_Duplicate( p );
+            if( p_copy )
+                block_ChainLastAppend( &pp_last, p_copy );
+        }
         if( p_dup )
             input_DecoderDecode( es->p_dec_record, p_dup,
                                  p_input->p->b_out_pace_control );
@@ -2037,6 +2155,147 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * EsOutStandbyQueue:
+ *****************************************************************************/
+static mtime_t EsBlockDate( const block_t *p_block )
+{
+    return p_block->i_dts > VLC_TS_INVALID ? p_block->i_dts : p_block->i_pts;
+}
+
+/**
+ * Queues the data of an ES in standby. If the input pace is controllable,
+ * the data are kept from the start, and the queue is full after the standby
+ * buffer length. Otherwise, video is kept from its last keyframe, when the
+ * demuxer flags them, so that the decoder can start right away, and anything
+ * else is kept for the standby buffer length.
+ */
+static void EsOutStandbyQueue( es_out_t *out, es_out_id_t *es, block_t *p_block )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    if( p_sys->p_input->p->b_can_pace_control )
+    {
+        for( block_t *p = p_block; p != NULL; p = p->p_next )
+        {
+            const mtime_t i_date = EsBlockDate( p );
+            if( i_date <= VLC_TS_INVALID )
+                continue;
+            if( es->i_standby_start <= VLC_TS_INVALID )
+                es->i_standby_start = i_date;
+            else if( i_date - es->i_standby_start >= p_sys->i_standby_length )
+                p_sys->b_standby_full = true;
+        }
+        block_ChainLastAppend( &es->pp_standby_last, p_block );
+        return;
+    }
+
+    while( p_block != NULL )
+    {
+        block_t *p_next = p_block->p_next;
+
+        p_block->p_next = NULL;
+        if( es->fmt.i_cat == VIDEO_ES && (p_block->i_flags & BLOCK_FLAG_TYPE_I) )
+        {   /* Only the last group of pictures is needed */
+            block_ChainRelease( es->p_standby );
+            es->p_standby = NULL;
+            es->pp_standby_last = &es->p_standby;
+            es->b_standby_keyframes = true;
+        }
+        block_ChainLastAppend( &es->pp_standby_last, p_block );
+
+        const mtime_t i_date = EsBlockDate( p_block );
+        if( !es->b_standby_keyframes && i_date > VLC_TS_INVALID )
+        {
+            while( es->p_standby != p_block )
+            {
+                block_t *p_head = es->p_standby;
+                const mtime_t i_head = EsBlockDate( p_head );
+
+                if( i_head > VLC_TS_INVALID
+                 && i_head >= i_date - p_sys->i_standby_length )
+                    break;
+                es->p_standby = p_head->p_next;
+                block_Release( p_head );
+            }
+        }
+        p_block = p_next;
+    }
+}
+
+/**
+ * Enters or leaves the standby. When leaving it, the decoders are created
+ * and fed the queued data, the part of it already late being prerolled,
+ * and the buffering held in standby is completed.
+ */
+static void EsOutSetStandby( es_out_t *out, bool b_standby )
+{
+    es_out_sys_t   *p_sys = out->p_sys;
+    input_thread_t *p_input = p_sys->p_input;
+    const bool b_held = !b_standby && p_sys->b_buffering
+                     && p_input->p->b_can_pace_control;
+
+    p_sys->b_standby = b_standby;
+    p_sys->b_standby_full = false;
+    msg_Dbg( p_input, "%s standby", b_standby ? "entering" : "leaving" );
+
+    if( b_standby )
+    {
+        for( int i = 0; i < p_sys->i_es; i++ )
+        {
+            es_out_id_t *es = p_sys->es[i];
+
+            if( es->p_master || es->p_dec == NULL )
+                continue;
+            EsDestroyDecoder( out, es );
+            EsCreateDecoder( out, es );
+        }
+        return;
+    }
+
+    const mtime_t i_now = mdate();
+
+    p_sys->i_zap_date = i_now;
+    for( int i = 0; i < p_sys->i_es; i++ )
+    {
+        es_out_id_t *es = p_sys->es[i];
+
+        if( !es->b_standby )
+            continue;
+
+        block_t *p_chain = es->p_standby;
+
+        es->p_standby = NULL;
+        es->pp_standby_last = &es->p_standby;
+        es->b_standby = false;
+        EsCreateDecoder( out, es );
+        if( es->p_dec == NULL )
+        {
+            block_ChainRelease( p_chain );
+            continue;
+        }
+
+        for( block_t *p = p_chain; p != NULL && !p_sys->b_buffering;
+             p = p->p_next )
+        {
+            mtime_t i_date = EsBlockDate( p );
+
+            if( i_date > VLC_TS_INVALID
+             && input_clock_ConvertTS( VLC_OBJECT(p_input), es->p_pgrm->p_clock,
+                                       NULL, &i_date, NULL,
+                                       INT64_MAX ) == VLC_SUCCESS
+             && i_date < i_now )
+                p->i_flags |= BLOCK_FLAG_PREROLL;
+        }
+        if( p_chain != NULL )
+            input_DecoderDecode( es->p_dec, p_chain,
+                                 p_input->p->b_out_pace_control );
+    }
+
+    if( b_held && p_sys->p_pgrm != NULL )
+        EsOutDecodersStopBuffering( out, true );
+}
+
 /*****************************************************************************
  * EsOutDel:
  *****************************************************************************/
@@ -2064,6 +2323,8 @@ static void EsOutDel( es_out_t *out, es_out_id_t *es )
         }
         EsUnselect( out, es, es->p_pgrm == p_sys->p_pgrm );
     }
+    else if( es->b_standby )
+        EsUnselect( out, es, es->p_pgrm == p_sys->p_pgrm );
 
     if( es->p_pgrm == p_sys->p_pgrm )
         EsOutESVarUpdate( out, es, true );
@@ -2349,7 +2610,11 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         }
         else if( p_pgrm == p_sys->p_pgrm )
         {
-            if( b_late && ( !p_sys->p_input->p->p_sout ||
+            if( b_late && p_sys->b_low_latency )
+            {
+                /* Keep the latency: the outputs drop late data instead */
+            }
+            else if( b_late && ( !p_sys->p_input->p->p_sout ||
                                  !p_sys->p_input->p->b_out_pace_control ) )
             {
                 const mtime_t i_pts_delay_base = p_sys->i_pts_delay - p_sys->i_pts_jitter;
@@ -2374,6 +2639,13 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
                              "ES_OUT_SET_(GROUP_)PCR  is called too late (pts_delay increased to %d ms)",
                              (int)(i_pts_delay/1000) );
 
+                    double f_drift;
+                    mtime_t i_jitter;
+                    if( input_clock_GetDrift( p_pgrm->p_clock, &f_drift,
+                                              &i_jitter ) == VLC_SUCCESS )
+                        msg_Dbg( p_sys->p_input, "estimated clock drift %.1f "
+                                 "ppm, jitter %"PRId64" us", f_drift, i_jitter );
+
                     /* Force a rebufferization when we are too late */
 
                     /* It is not really good, as we throw away already buffered data
@@ -2416,15 +2688,30 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         if( es == NULL )
             return VLC_EGENERIC;
 
+        const int i_cat = es->fmt.i_cat;
+
         es_format_Clean( &es->fmt );
         es_format_Copy( &es->fmt, p_fmt );
 
-        if( es->p_dec )
+        if( es->p_dec == NULL )
+            return VLC_SUCCESS;
+
+        /* Keep the decoder and its output when it can follow the change */
+        if( es->fmt.i_cat != i_cat
+         || input_DecoderChangeFormat( es->p_dec, &es->fmt ) )
         {
             EsDestroyDecoder( out, es );
             EsCreateDecoder( out, es );
         }
-
+        else if( es->p_dec_record )
+        {
+            input_DecoderDelete( es->p_dec_record );
+            es->p_dec_record = input_DecoderNew( p_sys->p_input, &es->fmt,
+                                                 es->p_pgrm->p_clock,
+                                                 p_sys->p_sout_record );
+            if( es->p_dec_record && p_sys->b_buffering )
+                input_DecoderStartWait( es->p_dec_record );
+        }
         return VLC_SUCCESS;
     }
 
@@ -2559,6 +2846,13 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         return VLC_SUCCESS;
     }
 
+    case ES_OUT_GET_STANDBY_FULL:
+    {
+        bool *pb = va_arg( args, bool* );
+        *pb = p_sys->b_standby && p_sys->b_standby_full;
+        return VLC_SUCCESS;
+    }
+
     case ES_OUT_SET_DELAY:
     {
         const int i_cat = (int)va_arg( args, int );
@@ -2596,6 +2890,30 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         return VLC_SUCCESS;
     }
 
+    case ES_OUT_SET_KEYFRAMES_ONLY:
+    {
+        const bool b_keyframes_only = (bool)va_arg( args, int );
+
+        p_sys->b_keyframes_only = b_keyframes_only;
+        for( int i = 0; i < p_sys->i_es; i++ )
+        {
+            es_out_id_t *es = p_sys->es[i];
+
+            if( es->fmt.i_cat == VIDEO_ES && es->p_dec != NULL )
+                input_DecoderSetKeyframesOnly( es->p_dec, b_keyframes_only );
+        }
+        return VLC_SUCCESS;
+    }
+
+    case ES_OUT_SET_STANDBY:
+    {
+        const bool b_standby = (bool)va_arg( args, int );
+
+        if( b_standby != p_sys->b_standby )
+            EsOutSetStandby( out, b_standby );
+        return VLC_SUCCESS;
+    }
+
     case ES_OUT_SET_TIME:
     {
         const mtime_t i_date = (mtime_t)va_arg( args, mtime_t );
@@ -2702,6 +3020,9 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         return VLC_SUCCESS;
     }
 
+    case ES_OUT_SET_TIMESHIFT_DATE:
+        return VLC_EGENERIC; /* Nothing is buffered here */
+
     default:
         msg_Err( p_sys->p_input, "unknown query in es_out_Control" );
         return VLC_EGENERIC;
@@ -82,6 +82,18 @@ enum es_out_query_private_e
 
     /* Set End Of Stream */
     ES_OUT_SET_EOS,                                 /* res=cannot fail */
+
+    /* Set video decoders to only decode key frames (trick play) */
+    ES_OUT_SET_KEYFRAMES_ONLY,                      /* arg1=bool                res=cannot fail */
+
+    /* Seek within the timeshift buffer, to the data received at a date */
+    ES_OUT_SET_TIMESHIFT_DATE,                      /* arg1=mtime_t             res=can fail */
+
+    /* Queue the data of the selected ES instead of decoding them, or create
+     * their decoders and feed them the queued data (fast zapping) */
+    ES_OUT_SET_STANDBY,                             /* arg1=bool                res=cannot fail */
+    /* Whether the standby queue holds enough data to start from */
+    ES_OUT_GET_STANDBY_FULL,                        /* arg1=bool*               res=cannot fail */
 };
 
 static inline void es_out_SetMode( es_out_t *p_out, int i_mode )
@@ -134,6 +146,10 @@ static inline int es_out_SetTime( es_out_t *p_out, mtime_t i_date )
 {
     return es_out_Control( p_out, ES_OUT_SET_TIME, i_date );
 }
+static inline int es_out_SetTimeshiftDate( es_out_t *p_out, mtime_t i_date )
+{
+    return es_out_Control( p_out, ES_OUT_SET_TIMESHIFT_DATE, i_date );
+}
 static inline int es_out_SetFrameNext( es_out_t *p_out )
 {
     return es_out_Control( p_out, ES_OUT_SET_FRAME_NEXT );
@@ -162,6 +178,24 @@ static inline int es_out_GetGroupForced( es_out_t *p_out )
     assert( !i_ret );
     return i_group;
 }
+static inline void es_out_SetKeyframesOnly( es_out_t *p_out, bool b_keyframes_only )
+{
+    int i_ret = es_out_Control( p_out, ES_OUT_SET_KEYFRAMES_ONLY, b_keyframes_only );
+    assert( !i_ret );
+}
+static inline void es_out_SetStandby( es_out_t *p_out, bool b_standby )
+{
+    int i_ret = es_out_Control( p_out, ES_OUT_SET_STANDBY, b_standby );
+    assert( !i_ret );
+}
+static inline bool es_out_GetStandbyFull( es_out_t *p_out )
+{
+    bool b;
+    int i_ret = es_out_Control( p_out, ES_OUT_GET_STANDBY_FULL, &b );
+
+    assert( !i_ret );
+    return b;
+}
 static inline void es_out_Eos( es_out_t *p_out )
 {
     int i_ret = es_out_Control( p_out, ES_OUT_SET_EOS );
@@ -37,6 +37,9 @@
 #endif
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef HAVE_MMAP
+#  include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_fs.h>
@@ -54,6 +57,9 @@
  * Local prototypes
  *****************************************************************************/
 
+/* Minimal size of the blocks read back by mapping the file */
+#define TS_MMAP_MIN_SIZE (64*1024)
+
 /* XXX attribute_packed is (and MUST be) used ONLY to reduce memory usage */
 #ifdef HAVE_ATTRIBUTE_PACKED
 #   define attribute_packed __attribute__((__packed__))
@@ -151,6 +157,14 @@ typedef struct attribute_packed
     } u;
 } ts_cmd_t;
 
+/* Index entry of a storage, by reception date */
+typedef struct
+{
+    mtime_t i_date;
+    int     i_cmd;      /* Index of the C_SEND command */
+    bool    b_keyframe;
+} ts_index_t;
+
 typedef struct ts_storage_t ts_storage_t;
 struct ts_storage_t
 {
@@ -170,6 +184,11 @@ struct ts_storage_t
     int      i_cmd_w;
     int      i_cmd_max;
     ts_cmd_t *p_cmd;
+
+    /* Sorted by date, one entry per keyframe and at least one per second */
+    int        i_index;
+    int        i_index_max;
+    ts_index_t *p_index;
 };
 
 typedef struct
@@ -178,6 +197,7 @@ typedef struct
     input_thread_t *p_input;
     es_out_t       *p_out;
     int64_t        i_tmp_size_max;
+    int64_t        i_storage_max;
     const char     *psz_tmp_path;
 
     /* Lock for all following fields */
@@ -200,8 +220,11 @@ typedef struct
     /* */
     ts_storage_t   *p_storage_r;
     ts_storage_t   *p_storage_w;
+    int64_t        i_storage_size;  /* Total size of the storage files */
+    bool           b_keyframes;     /* Keyframes were indexed */
 
     mtime_t        i_cmd_delay;
+    mtime_t        i_skip_date;     /* Older commands are skipped */
 
 } ts_thread_t;
 
@@ -217,6 +240,7 @@ struct es_out_sys_t
 
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
+    int64_t        i_storage_max;     /* Maximal total size in byte, 0 if none */
     char           *psz_tmp_path;     /* Path for temporary files */
 
     /* Lock for all following fields */
@@ -253,6 +277,10 @@ static bool         TsHasCmd( ts_thread_t * );
 static bool         TsIsUnused( ts_thread_t * );
 static int          TsChangePause( ts_thread_t *, bool b_source_paused, bool b_paused, mtime_t i_date );
 static int          TsChangeRate( ts_thread_t *, int i_src_rate, int i_rate );
+static int          TsSeek( ts_thread_t *, mtime_t i_date );
+static int          TsSeekLocked( ts_thread_t *, mtime_t i_date );
+static void         TsTrimLocked( ts_thread_t * );
+static bool         TsSkipCmdLocked( ts_thread_t * );
 
 static void         *TsRun( void * );
 
@@ -263,6 +291,11 @@ static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
 static bool         TsStorageIsEmpty( ts_storage_t * );
 static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
 static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
+static void         TsStorageTrim( ts_storage_t * );
+static const ts_index_t *TsStorageFind( const ts_storage_t *, mtime_t i_date, bool b_keyframe );
+#ifdef HAVE_MMAP
+static block_t      *TsStorageMap( ts_storage_t *, int64_t i_offset, size_t i_size );
+#endif
 
 static void CmdClean( ts_cmd_t * );
 static void cmd_cleanup_routine( void *p ) { CmdClean( p ); }
@@ -334,6 +367,16 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
     msg_Dbg( p_input, "using timeshift granularity of %d MiB",
              (int)p_sys->i_tmp_size_max/(1024*1024) );
 
+    /* The storage is a ring of at least two files */
+    const int64_t i_storage_max = var_CreateGetInteger( p_input, "input-timeshift-size" );
+    if( i_storage_max <= 0 )
+        p_sys->i_storage_max = 0;
+    else
+        p_sys->i_storage_max = __MAX( i_storage_max, 2 * p_sys->i_tmp_size_max );
+    if( p_sys->i_storage_max > 0 )
+        msg_Dbg( p_input, "using timeshift size of %"PRId64" MiB",
+                 p_sys->i_storage_max/(1024*1024) );
+
     p_sys->psz_tmp_path = var_InheritString( p_input, "input-timeshift-path" );
 #if defined (_WIN32) && !VLC_WINSTORE_APP
     if( p_sys->psz_tmp_path == NULL )
@@ -455,11 +498,24 @@ static int Send( es_out_t *p_out, es_out_id_t *p_es, block_t *p_block )
 
     TsAutoStop( p_out );
 
-    CmdInitSend( &cmd, p_es, p_block );
     if( p_sys->b_delayed )
-        TsPushCmd( p_sys->p_ts, &cmd );
+    {
+        /* The storage holds one block per command */
+        while( p_block != NULL )
+        {
+            block_t *p_next = p_block->p_next;
+
+            p_block->p_next = NULL;
+            CmdInitSend( &cmd, p_es, p_block );
+            TsPushCmd( p_sys->p_ts, &cmd );
+            p_block = p_next;
+        }
+    }
     else
+    {
+        CmdInitSend( &cmd, p_es, p_block );
         i_ret = CmdExecuteSend( p_sys->p_out, &cmd) ;
+    }
 
     vlc_mutex_unlock( &p_sys->lock );
 
@@ -605,6 +661,14 @@ static int ControlLockedSetTime( es_out_t *p_out, mtime_t i_date )
     msg_Err( p_sys->p_input, "EsOutTimeshift does not yet support time change" );
     return VLC_EGENERIC;
 }
+static int ControlLockedSetTimeshiftDate( es_out_t *p_out, mtime_t i_date )
+{
+    es_out_sys_t *p_sys = p_out->p_sys;
+
+    if( !p_sys->b_delayed )
+        return VLC_EGENERIC;
+    return TsSeek( p_sys->p_ts, i_date );
+}
 static int ControlLockedSetFrameNext( es_out_t *p_out )
 {
     es_out_sys_t *p_sys = p_out->p_sys;
@@ -638,6 +702,8 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
     case ES_OUT_SET_TIMES:
     case ES_OUT_SET_JITTER:
     case ES_OUT_SET_EOS:
+    case ES_OUT_SET_KEYFRAMES_ONLY:
+    case ES_OUT_SET_STANDBY:
     {
         ts_cmd_t cmd;
         if( CmdInitControl( &cmd, i_query, args, p_sys->b_delayed ) )
@@ -700,6 +766,12 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
 
         return ControlLockedSetTime( p_out, i_date );
     }
+    case ES_OUT_SET_TIMESHIFT_DATE:
+    {
+        const mtime_t i_date = (mtime_t)va_arg( args, mtime_t );
+
+        return ControlLockedSetTimeshiftDate( p_out, i_date );
+    }
     case ES_OUT_SET_FRAME_NEXT:
     {
         return ControlLockedSetFrameNext( p_out );
@@ -780,6 +852,7 @@ static int TsStart( es_out_t *p_out )
         return VLC_EGENERIC;
 
     p_ts->i_tmp_size_max = p_sys->i_tmp_size_max;
+    p_ts->i_storage_max = p_sys->i_storage_max;
     p_ts->psz_tmp_path = p_sys->psz_tmp_path;
     p_ts->p_input = p_sys->p_input;
     p_ts->p_out = p_sys->p_out;
@@ -793,8 +866,11 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_rate_delay = 0;
     p_ts->i_buffering_delay = 0;
     p_ts->i_cmd_delay = 0;
+    p_ts->i_skip_date = VLC_TS_INVALID;
     p_ts->p_storage_r = NULL;
     p_ts->p_storage_w = NULL;
+    p_ts->i_storage_size = 0;
+    p_ts->b_keyframes = false;
 
     p_sys->b_delayed = true;
     if( vlc_clone( &p_ts->thread, TsRun, p_ts, VLC_THREAD_PRIORITY_INPUT ) )
@@ -865,6 +941,8 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
         }
         else
         {
+            /* The file is read back through another handle */
+            fflush( p_ts->p_storage_w->p_filew );
             TsStoragePack( p_ts->p_storage_w );
             p_ts->p_storage_w->p_next = p_storage;
             p_ts->p_storage_w = p_storage;
@@ -872,7 +950,16 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
     }
 
     /* TODO return error and warn the user (but only once) */
+    const int64_t i_size = p_ts->p_storage_w->i_file_size;
     TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
+    p_ts->i_storage_size += p_ts->p_storage_w->i_file_size - i_size;
+
+    if( p_ts->p_storage_w->i_index > 0 &&
+        p_ts->p_storage_w->p_index[p_ts->p_storage_w->i_index - 1].b_keyframe )
+        p_ts->b_keyframes = true;
+
+    if( p_ts->i_storage_max > 0 && p_ts->i_storage_size > p_ts->i_storage_max )
+        TsTrimLocked( p_ts );
 
     vlc_cond_signal( &p_ts->wait );
 
@@ -893,6 +980,7 @@ static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
         if( !p_next )
             break;
 
+        p_ts->i_storage_size -= p_ts->p_storage_r->i_file_size;
         TsStorageDelete( p_ts->p_storage_r );
         p_ts->p_storage_r = p_next;
     }
@@ -970,6 +1058,107 @@ static int TsChangeRate( ts_thread_t *p_ts, int i_src_rate, int i_rate )
 
     return i_ret;
 }
+static int TsSeek( ts_thread_t *p_ts, mtime_t i_date )
+{
+    vlc_mutex_lock( &p_ts->lock );
+    int i_ret = TsSeekLocked( p_ts, i_date );
+    vlc_mutex_unlock( &p_ts->lock );
+
+    return i_ret;
+}
+static int TsSeekLocked( ts_thread_t *p_ts, mtime_t i_date )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    /* Look for the first keyframe received from the given date on, in the
+     * commands not executed yet */
+    const ts_index_t *p_entry = NULL;
+    for( ts_storage_t *p_storage = p_ts->p_storage_r;
+         p_storage != NULL && p_entry == NULL; p_storage = p_storage->p_next )
+        p_entry = TsStorageFind( p_storage, i_date, p_ts->b_keyframes );
+
+    if( p_entry == NULL )
+        return VLC_EGENERIC;
+    if( p_entry->i_date <= p_ts->i_skip_date )
+        return VLC_SUCCESS;
+
+    /* Skip to the entry and play it right away */
+    const mtime_t i_now = mdate();
+
+    p_ts->i_skip_date = p_entry->i_date;
+    p_ts->i_rate_date = -1;
+    p_ts->i_rate_delay = 0;
+    p_ts->i_cmd_delay = i_now - p_entry->i_date - p_ts->i_buffering_delay;
+    if( p_ts->b_paused )
+        p_ts->i_pause_date = i_now;
+
+    /* Reset the decoders states and clock sync */
+    es_out_SetTime( p_ts->p_out, -1 );
+
+    vlc_cond_signal( &p_ts->wait );
+    return VLC_SUCCESS;
+}
+static bool TsSkipCmdLocked( ts_thread_t *p_ts )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    const ts_storage_t *p_storage = p_ts->p_storage_r;
+    if( TsStorageIsEmpty( p_ts->p_storage_r ) ||
+        p_storage->p_cmd[p_storage->i_cmd_r].i_date >= p_ts->i_skip_date )
+        return false;
+
+    /* Catch up with the state changes of the commands skipped by a seek
+     * or lost in a trimmed file, without delay, and drop the data */
+    ts_cmd_t cmd;
+    TsPopCmdLocked( p_ts, &cmd, true );
+
+    switch( cmd.i_type )
+    {
+    case C_ADD:
+        CmdExecuteAdd( p_ts->p_out, &cmd );
+        CmdCleanAdd( &cmd );
+        break;
+    case C_SEND:
+        CmdCleanSend( &cmd );
+        break;
+    case C_CONTROL:
+        CmdExecuteControl( p_ts->p_out, &cmd );
+        CmdCleanControl( &cmd );
+        break;
+    case C_DEL:
+        CmdExecuteDel( p_ts->p_out, &cmd );
+        break;
+    default:
+        vlc_assert_unreachable();
+        break;
+    }
+    return true;
+}
+static void TsTrimLocked( ts_thread_t *p_ts )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    /* Drop the oldest files not being written, and skip their commands */
+    ts_storage_t *p_storage = p_ts->p_storage_r;
+    while( p_ts->i_storage_size > p_ts->i_storage_max &&
+           p_storage != NULL && p_storage->p_next != NULL )
+    {
+        if( p_storage->i_file_size > 0 )
+        {
+            p_ts->i_storage_size -= p_storage->i_file_size;
+            TsStorageTrim( p_storage );
+
+            ts_storage_t *p_next = p_storage->p_next;
+            const mtime_t i_date = p_next->i_cmd_r < p_next->i_cmd_w
+                                 ? p_next->p_cmd[p_next->i_cmd_r].i_date
+                                 : mdate();
+            msg_Dbg( p_ts->p_input, "es out timeshift: trimming the oldest file" );
+            if( TsSeekLocked( p_ts, i_date ) )
+                p_ts->i_skip_date = __MAX( p_ts->i_skip_date, i_date );
+        }
+        p_storage = p_storage->p_next;
+    }
+}
 
 static void *TsRun( void *p_data )
 {
@@ -991,6 +1180,11 @@ static void *TsRun( void *p_data )
             const int canc = vlc_savecancel();
             b_buffering = es_out_GetBuffering( p_ts->p_out );
 
+            if( TsSkipCmdLocked( p_ts ) )
+            {
+                vlc_restorecancel( canc );
+                continue;
+            }
             if( ( !p_ts->b_paused || b_buffering ) && !TsPopCmdLocked( p_ts, &cmd, false ) )
             {
                 vlc_restorecancel( canc );
@@ -1142,6 +1336,10 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     p_storage->p_cmd = malloc( p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) );
     //fprintf( stderr, "\nSTORAGE name=%s size=%d KiB\n", p_storage->psz_file, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) /1024 );
 
+    p_storage->i_index = 0;
+    p_storage->i_index_max = 0;
+    p_storage->p_index = NULL;
+
     if( !p_storage->p_cmd )
     {
         TsStorageDelete( p_storage );
@@ -1165,14 +1363,53 @@ static void TsStorageDelete( ts_storage_t *p_storage )
         CmdClean( &cmd );
     }
     free( p_storage->p_cmd );
+    free( p_storage->p_index );
+
+    TsStorageTrim( p_storage );
+    free( p_storage );
+}
+
+static void TsStorageTrim( ts_storage_t *p_storage )
+{
+    /* The commands are kept, but the data blocks are lost */
+    if( p_storage->p_filer == NULL )
+        return;
 
     fclose( p_storage->p_filer );
     fclose( p_storage->p_filew );
+    p_storage->p_filer = p_storage->p_filew = NULL;
+    p_storage->i_file_size = 0;
 #ifdef _WIN32
     vlc_unlink( p_storage->psz_file );
     free( p_storage->psz_file );
+    p_storage->psz_file = NULL;
 #endif
-    free( p_storage );
+}
+
+static const ts_index_t *TsStorageFind( const ts_storage_t *p_storage,
+                                        mtime_t i_date, bool b_keyframe )
+{
+    /* Binary search of the first entry received on or after the date */
+    int i_low = 0, i_high = p_storage->i_index;
+    while( i_low < i_high )
+    {
+        const int i_mid = (i_low + i_high) / 2;
+
+        if( p_storage->p_index[i_mid].i_date < i_date )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+
+    for( int i = i_low; i < p_storage->i_index; i++ )
+    {
+        const ts_index_t *p_entry = &p_storage->p_index[i];
+
+        if( p_entry->i_cmd >= p_storage->i_cmd_r &&
+            ( p_entry->b_keyframe || !b_keyframe ) )
+            return p_entry;
+    }
+    return NULL;
 }
 
 static void TsStoragePack( ts_storage_t *p_storage )
@@ -1211,6 +1448,7 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
     if( cmd.i_type == C_SEND )
     {
         block_t *p_block = cmd.u.send.p_block;
+        const bool b_keyframe = (p_block->i_flags & BLOCK_FLAG_TYPE_I) != 0;
 
         cmd.u.send.p_block = NULL;
         cmd.u.send.i_offset = ftell( p_storage->p_filew );
@@ -1234,6 +1472,34 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
 
         if( b_flush )
             fflush( p_storage->p_filew );
+
+        /* Index the keyframes, and the other blocks once a second */
+        const ts_index_t *p_last = p_storage->i_index > 0
+                                 ? &p_storage->p_index[p_storage->i_index - 1]
+                                 : NULL;
+        if( b_keyframe || p_last == NULL ||
+            p_last->i_date + CLOCK_FREQ <= cmd.i_date )
+        {
+            if( p_storage->i_index >= p_storage->i_index_max )
+            {
+                const int i_max = __MAX( 2 * p_storage->i_index_max, 64 );
+                ts_index_t *p_index = realloc( p_storage->p_index,
+                                               i_max * sizeof(*p_index) );
+                if( p_index )
+                {
+                    p_storage->p_index = p_index;
+                    p_storage->i_index_max = i_max;
+                }
+            }
+            if( p_storage->i_index < p_storage->i_index_max )
+            {
+                ts_index_t *p_entry = &p_storage->p_index[p_storage->i_index++];
+
+                p_entry->i_date = cmd.i_date;
+                p_entry->i_cmd = p_storage->i_cmd_w;
+                p_entry->b_keyframe = b_keyframe;
+            }
+        }
     }
     p_storage->p_cmd[p_storage->i_cmd_w++] = cmd;
 }
@@ -1246,11 +1512,24 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     {
         block_t block;
 
-        if( !b_flush &&
+        if( !b_flush && p_storage->p_filer != NULL &&
             !fseek( p_storage->p_filer, p_cmd->u.send.i_offset, SEEK_SET ) &&
             fread( &block, sizeof(block), 1, p_storage->p_filer ) == 1 )
         {
-            block_t *p_block = block_Alloc( block.i_buffer );
+            block_t *p_block = NULL;
+#ifdef HAVE_MMAP
+            /* Large blocks are mapped from the file rather than copied */
+            if( block.i_buffer >= TS_MMAP_MIN_SIZE )
+                p_block = TsStorageMap( p_storage,
+                                        p_cmd->u.send.i_offset + sizeof(block),
+                                        block.i_buffer );
+#endif
+            if( p_block == NULL )
+            {
+                p_block = block_Alloc( block.i_buffer );
+                if( p_block )
+                    p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_storage->p_filer );
+            }
             if( p_block )
             {
                 p_block->i_dts      = block.i_dts;
@@ -1258,7 +1537,6 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
                 p_block->i_flags    = block.i_flags;
                 p_block->i_length   = block.i_length;
                 p_block->i_nb_samples = block.i_nb_samples;
-                p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_storage->p_filer );
             }
             p_cmd->u.send.p_block = p_block;
         }
@@ -1270,6 +1548,23 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     }
 }
 
+#ifdef HAVE_MMAP
+static block_t *TsStorageMap( ts_storage_t *p_storage, int64_t i_offset, size_t i_size )
+{
+    /* The mapping is private, so the block is writable as usual and
+     * remains valid after the file is closed */
+    const int64_t i_page = sysconf( _SC_PAGESIZE );
+    const int64_t i_start = i_offset - i_offset % i_page;
+    const size_t i_left = i_offset - i_start;
+
+    void *p_addr = mmap( NULL, i_left + i_size, PROT_READ|PROT_WRITE,
+                         MAP_PRIVATE, fileno( p_storage->p_filer ), i_start );
+    if( p_addr == MAP_FAILED )
+        return NULL;
+    return block_mmap_Alloc( (uint8_t *)p_addr + i_left, i_size );
+}
+#endif
+
 /*****************************************************************************
  *
  *****************************************************************************/
@@ -1339,7 +1634,7 @@ static int CmdExecuteSend( es_out_t *p_out, ts_cmd_t *p_cmd )
     {
         if( p_cmd->u.send.p_es->p_es )
             return es_out_Send( p_out, p_cmd->u.send.p_es->p_es, p_block );
-        block_Release( p_block );
+        block_ChainRelease( p_block );
     }
     return VLC_EGENERIC;
 }
@@ -1373,6 +1668,8 @@ static int CmdInitControl( ts_cmd_t *p_cmd, int i_query, va_list args, bool b_co
     {
     /* Pass-through control */
     case ES_OUT_SET_MODE:    /* arg1= int                            */
+    case ES_OUT_SET_KEYFRAMES_ONLY: /* arg1= bool                    */
+    case ES_OUT_SET_STANDBY: /* arg1= bool                           */
     case ES_OUT_SET_GROUP:   /* arg1= int                            */
     case ES_OUT_DEL_GROUP:   /* arg1=int i_group */
         p_cmd->u.control.u.i_int = (int)va_arg( args, int );
@@ -1518,6 +1815,8 @@ static int CmdExecuteControl( es_out_t *p_out, ts_cmd_t *p_cmd )
     {
     /* Pass-through control */
     case ES_OUT_SET_MODE:    /* arg1= int                            */
+    case ES_OUT_SET_KEYFRAMES_ONLY: /* arg1= bool                    */
+    case ES_OUT_SET_STANDBY: /* arg1= bool                           */
     case ES_OUT_SET_GROUP:   /* arg1= int                            */
     case ES_OUT_DEL_GROUP:   /* arg1=int i_group */
         return es_out_Control( p_out, i_query, p_cmd->u.control.u.i_int );
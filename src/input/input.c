@@ -54,6 +54,9 @@
 #include <vlc_strings.h>
 #include <vlc_modules.h>
 
+/* Interval between the trick play steps */
+#define INPUT_TRICKPLAY_PERIOD (CLOCK_FREQ/4)
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -189,6 +192,63 @@ int input_Preparse( vlc_object_t *p_parent, input_item_t *p_item )
     return VLC_SUCCESS;
 }
 
+/**
+ * Read the meta data, duration and track of an item with the "meta reader"
+ * modules, without creating an input. This function is blocking.
+ *
+ * It only succeeds if all of these were found, and if no attachment has to
+ * be kept; input_Preparse() should be used otherwise.
+ *
+ * \param p_parent a vlc_object_t
+ * \param p_item an input item
+ * \return VLC_SUCCESS or an error
+ */
+int input_PreparseMeta( vlc_object_t *p_parent, input_item_t *p_item )
+{
+    demux_meta_t *p_demux_meta =
+        vlc_custom_create( p_parent, sizeof( *p_demux_meta ), "demux meta" );
+    if( unlikely(p_demux_meta == NULL) )
+        return VLC_ENOMEM;
+    p_demux_meta->p_item = p_item;
+
+    module_t *p_id3 = module_need( p_demux_meta, "meta reader", NULL, false );
+    if( p_id3 == NULL )
+    {
+        vlc_object_release( p_demux_meta );
+        return VLC_EGENERIC;
+    }
+    module_unneed( p_demux_meta, p_id3 );
+
+    vlc_meta_t *p_meta = p_demux_meta->p_meta;
+    int i_ret = VLC_EGENERIC;
+
+    if( p_meta != NULL && p_demux_meta->i_duration > 0
+     && p_demux_meta->fmt.i_cat != UNKNOWN_ES
+     && p_demux_meta->fmt.i_codec != 0
+     && p_demux_meta->i_attachments == 0 )
+    {
+        if( vlc_meta_Get( p_meta, vlc_meta_Title ) != NULL )
+            input_item_SetName( p_item, vlc_meta_Get( p_meta, vlc_meta_Title ) );
+
+        vlc_mutex_lock( &p_item->lock );
+        vlc_meta_Merge( p_item->p_meta, p_meta );
+        vlc_mutex_unlock( &p_item->lock );
+
+        input_item_SetDuration( p_item, p_demux_meta->i_duration );
+        input_item_UpdateTracksInfo( p_item, &p_demux_meta->fmt );
+        i_ret = VLC_SUCCESS;
+    }
+
+    if( p_meta != NULL )
+        vlc_meta_Delete( p_meta );
+    for( int i = 0; i < p_demux_meta->i_attachments; i++ )
+        vlc_input_attachment_Delete( p_demux_meta->attachments[i] );
+    TAB_CLEAN( p_demux_meta->i_attachments, p_demux_meta->attachments );
+    es_format_Clean( &p_demux_meta->fmt );
+    vlc_object_release( p_demux_meta );
+    return i_ret;
+}
+
 /**
  * Start a input_thread_t created by input_Create.
  *
@@ -347,6 +407,7 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
     p_input->p->is_running = false;
     p_input->p->is_stopped = false;
     p_input->p->b_recording = false;
+    p_input->p->b_standby = false;
     p_input->p->i_rate = INPUT_RATE_DEFAULT;
     memset( &p_input->p->bookmark, 0, sizeof(p_input->p->bookmark) );
     TAB_INIT( p_input->p->i_bookmark, p_input->p->pp_bookmark );
@@ -410,7 +471,6 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
         p_input->p->p_resource_private = input_resource_New( VLC_OBJECT( p_input ) );
         p_input->p->p_resource = input_resource_Hold( p_input->p->p_resource_private );
     }
-    input_resource_SetInput( p_input->p->p_resource, p_input );
 
     /* Init control buffer */
     vlc_mutex_init( &p_input->p->lock_control );
@@ -506,6 +566,8 @@ static void *Run( void *obj )
 {
     input_thread_t *p_input = (input_thread_t *)obj;
 
+    /* The decoders, outputs and stream outputs of the input inherit it */
+    vlc_thread_bind_node();
     vlc_interrupt_set(&p_input->p->interrupt);
 
     if( !Init( p_input ) )
@@ -549,7 +611,13 @@ static void MainLoopDemux( input_thread_t *p_input, bool *pb_changed, mtime_t i_
         ( p_input->p->i_run > 0 && i_start_mdate+p_input->p->i_run < mdate() ) )
         i_ret = 0; /* EOF */
     else
+    {
+        mtime_t i_trace = vlc_TracePointStart( p_input, VLC_TP_INPUT_DEMUX );
+        mtime_t i_latency = vlc_LatencyStart( p_input );
         i_ret = demux_Demux( p_input->p->input.p_demux );
+        vlc_LatencySince( p_input, VLC_LATENCY_DEMUX, i_latency );
+        vlc_TracePoint( p_input, VLC_TP_INPUT_DEMUX, i_trace, i_ret );
+    }
 
     if( i_ret > 0 )
     {
@@ -668,6 +736,62 @@ static void MainLoopStatistics( input_thread_t *p_input )
  * MainLoop
  * The main input loop.
  */
+/**
+ * Steps the trick play, by seeking to the keyframe nearest to where the
+ * stream would be at the current rate. This is what allows reverse playback
+ * and spares demuxing the skipped data at high rates.
+ *
+ * \return the date of the next step, or -1 if none
+ */
+static mtime_t MainLoopTrickplay( input_thread_t *p_input )
+{
+    input_thread_private_t *p_sys = p_input->p;
+    const mtime_t now = mdate();
+
+    if( p_sys->input.b_eof && p_sys->i_rate > 0 )
+        return -1; /* Let the end of stream happen */
+
+    if( p_sys->trickplay.i_date == VLC_TS_INVALID )
+    {
+        if( demux_Control( p_sys->input.p_demux, DEMUX_GET_TIME,
+                           &p_sys->trickplay.i_time ) )
+            p_sys->trickplay.i_time = p_sys->i_time;
+        p_sys->trickplay.i_date = now;
+        p_sys->trickplay.i_next = now + INPUT_TRICKPLAY_PERIOD;
+        return p_sys->trickplay.i_next;
+    }
+    if( now < p_sys->trickplay.i_next )
+        return p_sys->trickplay.i_next;
+    p_sys->trickplay.i_next = now + INPUT_TRICKPLAY_PERIOD;
+
+    mtime_t i_time = p_sys->trickplay.i_time
+                   + (now - p_sys->trickplay.i_date) * INPUT_RATE_DEFAULT
+                     / p_sys->i_rate;
+    bool b_start = i_time <= 0;
+    if( b_start )
+        i_time = 0;
+
+    /* Imprecise seeks land on the keyframes of the demuxer index */
+    es_out_SetTime( p_sys->p_es_out, -1 );
+    if( demux_Control( p_sys->input.p_demux, DEMUX_SET_TIME, i_time, false ) )
+        msg_Warn( p_input, "trick play step to %"PRId64" failed", i_time );
+    else
+    {
+        if( p_sys->i_slave > 0 )
+            SlaveSeek( p_input );
+        p_sys->input.b_eof = false;
+    }
+
+    if( b_start )
+    {   /* Rewound to the start: resume normal playback */
+        vlc_value_t val = { .i_int = INPUT_RATE_DEFAULT };
+
+        Control( p_input, INPUT_CONTROL_SET_RATE, val );
+        return -1;
+    }
+    return p_sys->trickplay.i_next;
+}
+
 static void MainLoop( input_thread_t *p_input, bool b_interactive )
 {
     mtime_t i_start_mdate = mdate();
@@ -690,8 +814,19 @@ static void MainLoop( input_thread_t *p_input, bool b_interactive )
         if( b_paused )
             b_paused = !es_out_GetBuffering( p_input->p->p_es_out ) || p_input->p->input.b_eof;
 
+        /* A standby input stops reading once it has enough data to start
+         * from, and must not end before it leaves the standby */
+        if( !b_paused && p_input->p->b_standby )
+            b_paused = p_input->p->input.b_eof
+                    || es_out_GetStandbyFull( p_input->p->p_es_out_display );
+
         if( !b_paused )
         {
+            mtime_t i_step = -1;
+
+            if( p_input->p->trickplay.b_active )
+                i_step = MainLoopTrickplay( p_input );
+
             if( !p_input->p->input.b_eof )
             {
                 bool b_force_update = false;
@@ -724,6 +859,9 @@ static void MainLoop( input_thread_t *p_input, bool b_interactive )
                     break;
             }
 
+            if( i_step >= 0 && (i_wakeup < 0 || i_wakeup > i_step) )
+                i_wakeup = i_step;
+
             /* Update interface and statistics */
             mtime_t now = mdate();
             if( now >= i_intf_update )
@@ -799,11 +937,18 @@ static void InitStatistics( input_thread_t * p_input )
         INIT_COUNTER( demux_discontinuity, COUNTER );
         INIT_COUNTER( played_abuffers, COUNTER );
         INIT_COUNTER( lost_abuffers, COUNTER );
+        INIT_COUNTER( audio_latency, LAST );
         INIT_COUNTER( displayed_pictures, COUNTER );
         INIT_COUNTER( lost_pictures, COUNTER );
+        INIT_COUNTER( late_pictures, COUNTER );
+        INIT_COUNTER( zap_time, LAST );
         INIT_COUNTER( decoded_audio, COUNTER );
         INIT_COUNTER( decoded_video, COUNTER );
         INIT_COUNTER( decoded_sub, COUNTER );
+        INIT_COUNTER( decoder_held, COUNTER );
+        INIT_COUNTER( decoder_latency, LAST );
+        INIT_COUNTER( video_fifo, LAST );
+        INIT_COUNTER( audio_fifo, LAST );
         p_input->p->counters.p_sout_send_bitrate = NULL;
         p_input->p->counters.p_sout_sent_packets = NULL;
         p_input->p->counters.p_sout_sent_bytes = NULL;
@@ -917,6 +1062,10 @@ static void StartTitle( input_thread_t * p_input )
         p_input->p->i_stop = 0;
     }
     p_input->p->b_fast_seek = var_GetBool( p_input, "input-fast-seek" );
+
+    float f_trickplay = var_GetFloat( p_input, "input-trickplay-rate" );
+    if( f_trickplay >= 1.f )
+        p_input->p->trickplay.i_rate_min = INPUT_RATE_DEFAULT / f_trickplay;
 }
 
 static void LoadSubtitles( input_thread_t *p_input )
@@ -1139,6 +1288,8 @@ static void InitPrograms( input_thread_t * p_input )
 
 static int Init( input_thread_t * p_input )
 {
+    mtime_t start = mdate();
+
     for( int i = 0; i < p_input->p->p_item->i_options; i++ )
     {
         if( !strncmp( p_input->p->p_item->ppsz_options[i], "meta-file", 9 ) )
@@ -1154,6 +1305,24 @@ static int Init( input_thread_t * p_input )
     }
 
     InitStatistics( p_input );
+
+    /* An input in standby only takes the outputs over when it leaves it */
+    p_input->p->b_standby = !p_input->b_preparsing
+                         && var_GetBool( p_input, "standby" );
+    if( p_input->p->b_standby )
+    {
+        char *psz_sout = var_GetNonEmptyString( p_input, "sout" );
+
+        free( psz_sout );
+        if( psz_sout != NULL )
+        {   /* The stream output would be shared with the playing input */
+            msg_Err( p_input, "standby is not supported with stream output" );
+            goto error;
+        }
+    }
+    else
+        input_resource_SetInput( p_input->p->p_resource, p_input );
+
 #ifdef ENABLE_SOUT
     if( InitSout( p_input ) )
         goto error;
@@ -1161,17 +1330,24 @@ static int Init( input_thread_t * p_input )
 
     /* Create es out */
     p_input->p->p_es_out = input_EsOutTimeshiftNew( p_input, p_input->p->p_es_out_display, p_input->p->i_rate );
+    if( p_input->p->b_standby )
+    {
+        msg_Dbg( p_input, "opening in standby" );
+        es_out_SetStandby( p_input->p->p_es_out_display, true );
+    }
 
     /* */
     input_ChangeState( p_input, OPENING_S );
     input_SendEventCache( p_input, 0.0 );
 
     /* */
+    mtime_t open_start = mdate();
     if( InputSourceInit( p_input, &p_input->p->input,
                          p_input->p->p_item->psz_uri, NULL, false ) )
     {
         goto error;
     }
+    vlc_TraceSpan( p_input, "input", open_start, "input source open" );
 
     InitTitle( p_input );
 
@@ -1239,6 +1415,7 @@ static int Init( input_thread_t * p_input )
 
     /* initialization is complete */
     input_ChangeState( p_input, PLAYING_S );
+    vlc_TraceSpan( p_input, "input", start, "input init" );
 
     return VLC_SUCCESS;
 
@@ -1253,7 +1430,8 @@ error:
         if( p_input->p->p_sout )
             input_resource_RequestSout( p_input->p->p_resource,
                                          p_input->p->p_sout, NULL );
-        input_resource_SetInput( p_input->p->p_resource, NULL );
+        if( !p_input->p->b_standby )
+            input_resource_SetInput( p_input->p->p_resource, NULL );
         if( p_input->p->p_resource_private )
             input_resource_Terminate( p_input->p->p_resource_private );
     }
@@ -1272,11 +1450,18 @@ error:
         EXIT_COUNTER( demux_discontinuity );
         EXIT_COUNTER( played_abuffers );
         EXIT_COUNTER( lost_abuffers );
+        EXIT_COUNTER( audio_latency );
         EXIT_COUNTER( displayed_pictures );
         EXIT_COUNTER( lost_pictures );
+        EXIT_COUNTER( late_pictures );
+        EXIT_COUNTER( zap_time );
         EXIT_COUNTER( decoded_audio );
         EXIT_COUNTER( decoded_video );
         EXIT_COUNTER( decoded_sub );
+        EXIT_COUNTER( decoder_held );
+        EXIT_COUNTER( decoder_latency );
+        EXIT_COUNTER( video_fifo );
+        EXIT_COUNTER( audio_fifo );
 
         if( p_input->p->p_sout )
         {
@@ -1343,11 +1528,18 @@ static void End( input_thread_t * p_input )
             CL_CO( demux_discontinuity );
             CL_CO( played_abuffers );
             CL_CO( lost_abuffers );
+            CL_CO( audio_latency );
             CL_CO( displayed_pictures );
             CL_CO( lost_pictures );
+            CL_CO( late_pictures );
+            CL_CO( zap_time );
             CL_CO( decoded_audio) ;
             CL_CO( decoded_video );
             CL_CO( decoded_sub) ;
+            CL_CO( decoder_held );
+            CL_CO( decoder_latency );
+            CL_CO( video_fifo );
+            CL_CO( audio_fifo );
         }
 
         /* Close optional stream output instance */
@@ -1374,7 +1566,8 @@ static void End( input_thread_t * p_input )
     /* */
     input_resource_RequestSout( p_input->p->p_resource,
                                  p_input->p->p_sout, NULL );
-    input_resource_SetInput( p_input->p->p_resource, NULL );
+    if( !p_input->p->b_standby )
+        input_resource_SetInput( p_input->p->p_resource, NULL );
     if( p_input->p->p_resource_private )
         input_resource_Terminate( p_input->p->p_resource_private );
 }
@@ -1587,6 +1780,25 @@ static void ControlUnpause( input_thread_t *p_input, mtime_t i_control_date )
     /* Switch to play */
     input_ChangeState( p_input, PLAYING_S );
     es_out_SetPauseState( p_input->p->p_es_out, false, false, i_control_date );
+    p_input->p->trickplay.i_date = VLC_TS_INVALID;
+}
+
+static void ControlUpdateTrickplay( input_thread_t *p_input )
+{
+    input_thread_private_t *p_sys = p_input->p;
+    const bool b_active = p_sys->input.b_rescale_ts
+                       && p_sys->trickplay.i_rate_min > 0
+                       && ( p_sys->i_rate < 0
+                         || p_sys->i_rate <= p_sys->trickplay.i_rate_min )
+                       && var_GetBool( p_input, "can-seek" );
+
+    if( b_active != p_sys->trickplay.b_active )
+    {
+        msg_Dbg( p_input, "%s trick play", b_active ? "starting" : "stopping" );
+        es_out_SetKeyframesOnly( p_sys->p_es_out, b_active );
+        p_sys->trickplay.b_active = b_active;
+    }
+    p_sys->trickplay.i_date = VLC_TS_INVALID;
 }
 
 static bool Control( input_thread_t *p_input,
@@ -1627,6 +1839,7 @@ static bool Control( input_thread_t *p_input,
                 if( p_input->p->i_slave > 0 )
                     SlaveSeek( p_input );
                 p_input->p->input.b_eof = false;
+                p_input->p->trickplay.i_date = VLC_TS_INVALID;
 
                 b_force_update = true;
             }
@@ -1669,6 +1882,23 @@ static bool Control( input_thread_t *p_input,
                 }
             }
             if( i_ret )
+            {
+                int64_t i_live;
+
+                /* Seek within the timeshift buffer of a live stream, the
+                 * demuxer being at the live edge */
+                if( !demux_Control( p_input->p->input.p_demux,
+                                    DEMUX_GET_TIME, &i_live ) && i_time < i_live
+                 && !es_out_SetTimeshiftDate( p_input->p->p_es_out,
+                                              mdate() - (i_live - i_time) ) )
+                {
+                    msg_Dbg( p_input, "seeking within the timeshift buffer" );
+                    p_input->p->trickplay.i_date = VLC_TS_INVALID;
+                    b_force_update = true;
+                    break;
+                }
+            }
+            if( i_ret )
             {
                 msg_Warn( p_input, "INPUT_CONTROL_SET_TIME(_OFFSET) %"PRId64
                          " failed or not possible", i_time );
@@ -1678,6 +1908,7 @@ static bool Control( input_thread_t *p_input,
                 if( p_input->p->i_slave > 0 )
                     SlaveSeek( p_input );
                 p_input->p->input.b_eof = false;
+                p_input->p->trickplay.i_date = VLC_TS_INVALID;
 
                 b_force_update = true;
             }
@@ -1727,7 +1958,10 @@ static bool Control( input_thread_t *p_input,
             /* Apply direction */
             if( i_rate_sign < 0 )
             {
-                if( p_input->p->input.b_rescale_ts )
+                /* Reverse playback is emulated by trick play steps */
+                if( p_input->p->input.b_rescale_ts
+                 && ( p_input->p->trickplay.i_rate_min <= 0
+                   || !var_GetBool( p_input, "can-seek" ) ) )
                 {
                     msg_Dbg( p_input, "cannot set negative rate" );
                     i_rate = p_input->p->i_rate;
@@ -1775,9 +2009,11 @@ static bool Control( input_thread_t *p_input,
 
                 if( p_input->p->input.b_rescale_ts )
                 {
-                    const int i_rate_source = (p_input->p->b_can_pace_control || p_input->p->b_can_rate_control ) ? i_rate : INPUT_RATE_DEFAULT;
-                    es_out_SetRate( p_input->p->p_es_out, i_rate_source, i_rate );
+                    const int i_rate_abs = abs( i_rate );
+                    const int i_rate_source = (p_input->p->b_can_pace_control || p_input->p->b_can_rate_control ) ? i_rate_abs : INPUT_RATE_DEFAULT;
+                    es_out_SetRate( p_input->p->p_es_out, i_rate_source, i_rate_abs );
                 }
+                ControlUpdateTrickplay( p_input );
 
                 b_force_update = true;
             }
@@ -1959,6 +2195,24 @@ static bool Control( input_thread_t *p_input,
             }
             break;
 
+        case INPUT_CONTROL_SET_STANDBY:
+            if( !p_input->p->b_standby == !val.b_bool )
+                break;
+            if( val.b_bool )
+            {
+                if( p_input->p->p_sout != NULL )
+                    break;
+                es_out_SetStandby( p_input->p->p_es_out_display, true );
+                input_resource_SetInput( p_input->p->p_resource, NULL );
+            }
+            else
+            {
+                input_resource_SetInput( p_input->p->p_resource, p_input );
+                es_out_SetStandby( p_input->p->p_es_out_display, false );
+            }
+            p_input->p->b_standby = val.b_bool;
+            break;
+
         case INPUT_CONTROL_SET_FRAME_NEXT:
             if( p_input->p->i_state == PAUSE_S )
             {
@@ -2507,6 +2761,7 @@ static void InputSourceMeta( input_thread_t *p_input,
         }
         module_unneed( p_demux, p_id3 );
     }
+    es_format_Clean( &p_demux_meta->fmt );
     vlc_object_release( p_demux_meta );
 }
 
@@ -89,6 +89,7 @@ struct input_thread_private_t
     bool        is_running;
     bool        is_stopped;
     bool        b_recording;
+    bool        b_standby; /* pre-opened, without decoders nor outputs */
     int         i_rate;
 
     /* Playtime configuration and state */
@@ -98,6 +99,16 @@ struct input_thread_private_t
     int64_t     i_time;     /* Current time */
     bool        b_fast_seek;/* :input-fast-seek */
 
+    /* Trick play (keyframes only, stepping by seeks) */
+    struct
+    {
+        int     i_rate_min; /* :input-trickplay-rate, 0 if disabled */
+        bool    b_active;
+        mtime_t i_time;     /* Anchor stream time */
+        mtime_t i_date;     /* Anchor date, VLC_TS_INVALID to re-anchor */
+        mtime_t i_next;     /* Date of the next step */
+    } trickplay;
+
     /* Output */
     bool            b_out_pace_control; /* XXX Move it ot es_sout ? */
     sout_instance_t *p_sout;            /* Idem ? */
@@ -148,13 +159,20 @@ struct input_thread_private_t
         counter_t *p_decoded_audio;
         counter_t *p_decoded_video;
         counter_t *p_decoded_sub;
+        counter_t *p_decoder_held;
+        counter_t *p_decoder_latency;
+        counter_t *p_video_fifo;
+        counter_t *p_audio_fifo;
         counter_t *p_sout_sent_packets;
         counter_t *p_sout_sent_bytes;
         counter_t *p_sout_send_bitrate;
         counter_t *p_played_abuffers;
         counter_t *p_lost_abuffers;
+        counter_t *p_audio_latency;
         counter_t *p_displayed_pictures;
         counter_t *p_lost_pictures;
+        counter_t *p_late_pictures;
+        counter_t *p_zap_time;
         vlc_mutex_t counters_lock;
     } counters;
 
@@ -212,6 +230,8 @@ enum input_control_e
     INPUT_CONTROL_SET_RECORD_STATE,
 
     INPUT_CONTROL_SET_FRAME_NEXT,
+
+    INPUT_CONTROL_SET_STANDBY,
 };
 
 /* Internal helpers */
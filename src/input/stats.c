@@ -98,6 +98,10 @@ void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
     /* Decoders */
     st->i_decoded_video = stats_GetTotal(input->p->counters.p_decoded_video);
     st->i_decoded_audio = stats_GetTotal(input->p->counters.p_decoded_audio);
+    st->i_decoder_held = stats_GetTotal(input->p->counters.p_decoder_held);
+    st->i_decoder_latency = stats_GetTotal(input->p->counters.p_decoder_latency);
+    st->i_video_fifo = stats_GetTotal(input->p->counters.p_video_fifo);
+    st->i_audio_fifo = stats_GetTotal(input->p->counters.p_audio_fifo);
 
     /* Sout */
     if (input->p->counters.p_sout_send_bitrate)
@@ -110,10 +114,13 @@ void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
     /* Aout */
     st->i_played_abuffers = stats_GetTotal(input->p->counters.p_played_abuffers);
     st->i_lost_abuffers = stats_GetTotal(input->p->counters.p_lost_abuffers);
+    st->i_audio_latency = stats_GetTotal(input->p->counters.p_audio_latency);
 
     /* Vouts */
     st->i_displayed_pictures = stats_GetTotal(input->p->counters.p_displayed_pictures);
     st->i_lost_pictures = stats_GetTotal(input->p->counters.p_lost_pictures);
+    st->i_late_pictures = stats_GetTotal(input->p->counters.p_late_pictures);
+    st->i_zap_time = stats_GetTotal(input->p->counters.p_zap_time);
 
     vlc_mutex_unlock(&st->lock);
     vlc_mutex_unlock(&input->p->counters.counters_lock);
@@ -128,8 +135,12 @@ void stats_ReinitInputStats( input_stats_t *p_stats )
     p_stats->f_demux_bitrate = p_stats->f_average_demux_bitrate =
     p_stats->i_demux_corrupted = p_stats->i_demux_discontinuity =
     p_stats->i_displayed_pictures = p_stats->i_lost_pictures =
+    p_stats->i_late_pictures = p_stats->i_zap_time =
     p_stats->i_played_abuffers = p_stats->i_lost_abuffers =
+    p_stats->i_audio_latency =
     p_stats->i_decoded_video = p_stats->i_decoded_audio =
+    p_stats->i_decoder_held = p_stats->i_decoder_latency =
+    p_stats->i_video_fifo = p_stats->i_audio_fifo =
     p_stats->i_sent_bytes = p_stats->i_sent_packets = p_stats->f_send_bitrate
      = 0;
     vlc_mutex_unlock( &p_stats->lock );
@@ -188,6 +199,7 @@ void stats_Update( counter_t *p_counter, uint64_t val, uint64_t *new_val )
         break;
     }
     case STATS_COUNTER:
+    case STATS_LAST:
         if( p_counter->i_samples == 0 )
         {
             counter_sample_t *p_new = (counter_sample_t*)malloc(
@@ -199,7 +211,10 @@ void stats_Update( counter_t *p_counter, uint64_t val, uint64_t *new_val )
         }
         if( p_counter->i_samples == 1 )
         {
-            p_counter->pp_samples[0]->value += val;
+            if( p_counter->i_compute_type == STATS_LAST )
+                p_counter->pp_samples[0]->value = val;
+            else
+                p_counter->pp_samples[0]->value += val;
             if( new_val )
                 *new_val = p_counter->pp_samples[0]->value;
         }
@@ -0,0 +1,685 @@
+/*****************************************************************************
+ * thumbnail.c: keyframe thumbnail extraction
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/**
+ * \file
+ * Extracts a thumbnail from a media without an input thread: the media is
+ * demuxed on the calling thread with a private ES output which only feeds
+ * the first video ES to a decoder. There is no video or audio output. The
+ * demuxer is seeked to the requested time, which lands on the nearest
+ * keyframe, and only keyframes are decoded until a picture comes out.
+ *
+ * A thumbnails strip runs the same extraction at regular intervals on a
+ * background thread, with a single demuxer and decoder which are seeked from
+ * one thumbnail to the next.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_input.h>
+#include <vlc_es_out.h>
+#include <vlc_block.h>
+#include <vlc_codec.h>
+#include <vlc_meta.h>
+#include <vlc_modules.h>
+#include <vlc_picture.h>
+
+#include <assert.h>
+
+#include "input_internal.h"
+#include "demux.h"
+#include "stream.h"
+#include "../libvlc.h"
+#include "../misc/interrupt.h"
+
+/* Give up if no picture could be decoded from that many video blocks */
+#define THUMBNAIL_MAX_BLOCKS 1000
+
+/* All the ES share the same two identifiers, they are only compared */
+struct es_out_id_t
+{
+    bool b_decoded;
+};
+
+struct es_out_sys_t
+{
+    vlc_object_t *p_obj;
+    es_out_id_t   video;  /* the only ES which is decoded */
+    es_out_id_t   other;
+    bool          b_has_video;
+    decoder_t    *p_dec;
+    decoder_t    *p_packetizer;
+    picture_t    *p_picture;
+    unsigned      i_blocks;
+    bool          b_error;
+};
+
+/*****************************************************************************
+ * Decoder
+ *****************************************************************************/
+static int VoutFormatUpdate( decoder_t *p_dec )
+{
+    p_dec->fmt_out.video.i_chroma = p_dec->fmt_out.i_codec;
+    return 0;
+}
+
+static picture_t *VoutBufferNew( decoder_t *p_dec )
+{
+    return picture_NewFromFormat( &p_dec->fmt_out.video );
+}
+
+static int LoadModule( decoder_t *p_dec, bool b_packetizer,
+                       const es_format_t *p_fmt )
+{
+    es_format_Copy( &p_dec->fmt_in, p_fmt );
+    es_format_Init( &p_dec->fmt_out, UNKNOWN_ES, 0 );
+
+    if( !b_packetizer )
+        p_dec->p_module = module_need( p_dec, "decoder", "$codec", false );
+    else
+        p_dec->p_module = module_need( p_dec, "packetizer", "$packetizer",
+                                       false );
+    if( p_dec->p_module == NULL )
+    {
+        es_format_Clean( &p_dec->fmt_in );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static void UnloadModule( decoder_t *p_dec )
+{
+    if( p_dec->p_module == NULL )
+        return;
+
+    module_unneed( p_dec, p_dec->p_module );
+    p_dec->p_module = NULL;
+    es_format_Clean( &p_dec->fmt_in );
+    es_format_Clean( &p_dec->fmt_out );
+    if( p_dec->p_description != NULL )
+    {
+        vlc_meta_Delete( p_dec->p_description );
+        p_dec->p_description = NULL;
+    }
+}
+
+static void DeleteDecoder( decoder_t *p_dec )
+{
+    UnloadModule( p_dec );
+    vlc_object_release( p_dec );
+}
+
+static decoder_t *CreateDecoder( vlc_object_t *p_obj, const es_format_t *p_fmt,
+                                 bool b_packetizer )
+{
+    decoder_t *p_dec = vlc_custom_create( p_obj, sizeof( *p_dec ),
+                                          b_packetizer ? "packetizer"
+                                                       : "decoder" );
+    if( unlikely(p_dec == NULL) )
+        return NULL;
+
+    p_dec->b_frame_drop_allowed = false;
+    p_dec->pf_vout_format_update = VoutFormatUpdate;
+    p_dec->pf_vout_buffer_new = VoutBufferNew;
+
+    if( !b_packetizer )
+    {
+        /* Decode the intra frames only, synchronously and in software */
+        var_Create( p_dec, "avcodec-skip-frame", VLC_VAR_INTEGER );
+        var_SetInteger( p_dec, "avcodec-skip-frame", 3 );
+        var_Create( p_dec, "avcodec-threads", VLC_VAR_INTEGER );
+        var_SetInteger( p_dec, "avcodec-threads", 1 );
+        var_Create( p_dec, "avcodec-hw", VLC_VAR_STRING );
+        var_SetString( p_dec, "avcodec-hw", "none" );
+    }
+
+    if( LoadModule( p_dec, b_packetizer, p_fmt ) )
+    {
+        msg_Err( p_obj, "no suitable %s module for fourcc `%4.4s'",
+                 b_packetizer ? "packetizer" : "decoder",
+                 (const char *)&p_fmt->i_codec );
+        vlc_object_release( p_dec );
+        return NULL;
+    }
+    return p_dec;
+}
+
+/* Decodes a packetized block, or drains the decoder if p_block is NULL */
+static void Decode( es_out_sys_t *p_sys, block_t *p_block )
+{
+    decoder_t *p_dec = p_sys->p_dec;
+    picture_t *p_pic;
+
+    /* Skip the inter frames when the packetizer or demuxer flagged them */
+    if( p_block != NULL && (p_block->i_flags & BLOCK_FLAG_TYPE_MASK)
+     && !(p_block->i_flags & BLOCK_FLAG_TYPE_I) )
+    {
+        block_Release( p_block );
+        return;
+    }
+
+    while( (p_pic = p_dec->pf_decode_video( p_dec, &p_block )) != NULL )
+    {
+        if( p_sys->p_picture == NULL )
+            p_sys->p_picture = p_pic;
+        else
+            picture_Release( p_pic );
+    }
+}
+
+/*****************************************************************************
+ * ES output
+ *****************************************************************************/
+static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *p_fmt )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    if( p_fmt->i_cat != VIDEO_ES || p_sys->b_has_video || p_sys->b_error )
+        return &p_sys->other;
+
+    p_sys->p_dec = CreateDecoder( p_sys->p_obj, p_fmt, false );
+    if( p_sys->p_dec == NULL )
+    {
+        p_sys->b_error = true;
+        return &p_sys->other;
+    }
+
+    if( !p_fmt->b_packetized )
+    {
+        p_sys->p_packetizer = CreateDecoder( p_sys->p_obj, p_fmt, true );
+        if( p_sys->p_packetizer == NULL )
+        {
+            DeleteDecoder( p_sys->p_dec );
+            p_sys->p_dec = NULL;
+            p_sys->b_error = true;
+            return &p_sys->other;
+        }
+    }
+
+    p_sys->b_has_video = true;
+    return &p_sys->video;
+}
+
+static int EsOutSend( es_out_t *out, es_out_id_t *id, block_t *p_block )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    if( !id->b_decoded || p_sys->p_picture != NULL || p_sys->b_error )
+    {
+        block_ChainRelease( p_block );
+        return VLC_SUCCESS;
+    }
+    p_sys->i_blocks++;
+
+    decoder_t *p_packetizer = p_sys->p_packetizer;
+    if( p_packetizer == NULL )
+    {
+        Decode( p_sys, p_block );
+        return VLC_SUCCESS;
+    }
+
+    block_t *p_chain;
+    while( (p_chain = p_packetizer->pf_packetize( p_packetizer,
+                                                  &p_block )) != NULL )
+    {
+        decoder_t *p_dec = p_sys->p_dec;
+
+        if( !es_format_IsSimilar( &p_dec->fmt_in, &p_packetizer->fmt_out ) )
+        {
+            UnloadModule( p_dec );
+            if( LoadModule( p_dec, false, &p_packetizer->fmt_out ) )
+            {
+                p_sys->b_error = true;
+                block_ChainRelease( p_chain );
+                break;
+            }
+        }
+
+        while( p_chain != NULL )
+        {
+            block_t *p_next = p_chain->p_next;
+
+            p_chain->p_next = NULL;
+            if( p_sys->p_picture == NULL )
+                Decode( p_sys, p_chain );
+            else
+                block_Release( p_chain );
+            p_chain = p_next;
+        }
+    }
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel( es_out_t *out, es_out_id_t *id )
+{
+    (void) out; (void) id;
+}
+
+static int EsOutControl( es_out_t *out, int i_query, va_list args )
+{
+    (void) out;
+
+    switch( i_query )
+    {
+        case ES_OUT_GET_ES_STATE:
+        {
+            es_out_id_t *id = va_arg( args, es_out_id_t * );
+            bool *pb = va_arg( args, bool * );
+
+            *pb = id->b_decoded;
+            return VLC_SUCCESS;
+        }
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static void EsOutDestroy( es_out_t *out )
+{
+    (void) out;
+}
+
+/*****************************************************************************
+ * Thumbnailer
+ *****************************************************************************/
+typedef struct
+{
+    vlc_object_t *p_obj;
+    demux_t      *p_demux;
+    es_out_t      out;
+    es_out_sys_t  sys;
+    bool          b_used;
+} thumbnailer_t;
+
+static void ThumbnailerClose( thumbnailer_t *p_th )
+{
+    if( p_th->p_demux != NULL )
+        demux_Delete( p_th->p_demux );
+    if( p_th->sys.p_packetizer != NULL )
+        DeleteDecoder( p_th->sys.p_packetizer );
+    if( p_th->sys.p_dec != NULL )
+        DeleteDecoder( p_th->sys.p_dec );
+    vlc_object_release( p_th->p_obj );
+    free( p_th );
+}
+
+/**
+ * Opens the demuxer of an input item with the private ES output.
+ */
+static thumbnailer_t *ThumbnailerOpen( vlc_object_t *p_parent,
+                                       input_item_t *p_item )
+{
+    thumbnailer_t *p_th = calloc( 1, sizeof( *p_th ) );
+    if( unlikely(p_th == NULL) )
+        return NULL;
+
+    /* The modules inherit the item options from this object */
+    p_th->p_obj = vlc_custom_create( p_parent, sizeof( *p_th->p_obj ),
+                                     "thumbnailer" );
+    if( unlikely(p_th->p_obj == NULL) )
+    {
+        free( p_th );
+        return NULL;
+    }
+    input_item_ApplyOptions( p_th->p_obj, p_item );
+
+    p_th->sys.p_obj = p_th->p_obj;
+    p_th->sys.video.b_decoded = true;
+    p_th->sys.other.b_decoded = false;
+    p_th->out.pf_add = EsOutAdd;
+    p_th->out.pf_send = EsOutSend;
+    p_th->out.pf_del = EsOutDel;
+    p_th->out.pf_control = EsOutControl;
+    p_th->out.pf_destroy = EsOutDestroy;
+    p_th->out.p_sys = &p_th->sys;
+
+    char *psz_uri = input_item_GetURI( p_item );
+    if( psz_uri == NULL )
+    {
+        ThumbnailerClose( p_th );
+        return NULL;
+    }
+
+    const char *psz_access, *psz_demux, *psz_path, *psz_anchor;
+    char *psz_var_demux = NULL;
+
+    input_SplitMRL( &psz_access, &psz_demux, &psz_path, &psz_anchor,
+                    psz_uri );
+    if( *psz_demux == '\0' )
+    {
+        psz_var_demux = var_InheritString( p_th->p_obj, "demux" );
+        psz_demux = (psz_var_demux != NULL) ? psz_var_demux : "any";
+    }
+
+    /* Try access_demux first */
+    p_th->p_demux = demux_New( p_th->p_obj, NULL, psz_access, psz_demux,
+                               psz_path, NULL, &p_th->out, false );
+    if( p_th->p_demux == NULL )
+    {
+        stream_t *p_stream = NULL;
+        char *psz_url;
+
+        if( likely(asprintf( &psz_url, "%s://%s", psz_access,
+                             psz_path ) >= 0) )
+        {
+            p_stream = stream_AccessNew( p_th->p_obj, NULL, psz_url );
+            free( psz_url );
+        }
+        if( p_stream == NULL )
+            msg_Err( p_th->p_obj, "cannot open `%s' for thumbnailing",
+                     psz_path );
+        else
+        {
+            p_stream = stream_FilterAutoNew( p_stream );
+
+            p_th->p_demux = demux_New( p_th->p_obj, NULL, psz_access,
+                                       psz_demux, psz_path, p_stream,
+                                       &p_th->out, false );
+            if( p_th->p_demux == NULL )
+            {
+                msg_Err( p_th->p_obj, "no suitable demux module for `%s'",
+                         psz_path );
+                stream_Delete( p_stream );
+            }
+        }
+    }
+    free( psz_var_demux );
+    free( psz_uri );
+
+    if( p_th->p_demux == NULL )
+    {
+        ThumbnailerClose( p_th );
+        return NULL;
+    }
+    return p_th;
+}
+
+/* Resets the decoder (and packetizer) state before the next extraction */
+static void ThumbnailerFlush( thumbnailer_t *p_th )
+{
+    es_out_sys_t *p_sys = &p_th->sys;
+
+    for( unsigned i = 0; i < 2; i++ )
+    {
+        decoder_t *p_dec = i ? p_sys->p_dec : p_sys->p_packetizer;
+        if( p_dec == NULL )
+            continue;
+
+        block_t *p_null = block_Alloc( 128 );
+        if( unlikely(p_null == NULL) )
+            continue;
+        p_null->i_flags |= BLOCK_FLAG_DISCONTINUITY | BLOCK_FLAG_CORRUPTED;
+        memset( p_null->p_buffer, 0, p_null->i_buffer );
+
+        if( i )
+        {
+            picture_t *p_pic;
+            while( (p_pic = p_dec->pf_decode_video( p_dec, &p_null )) )
+                picture_Release( p_pic );
+        }
+        else
+        {
+            block_t *p_chain = p_dec->pf_packetize( p_dec, &p_null );
+            if( p_chain != NULL )
+                block_ChainRelease( p_chain );
+        }
+    }
+    p_sys->i_blocks = 0;
+}
+
+/**
+ * Extracts the picture of the keyframe nearest to a time.
+ */
+static picture_t *ThumbnailerGet( thumbnailer_t *p_th, mtime_t i_time )
+{
+    es_out_sys_t *p_sys = &p_th->sys;
+
+    const bool b_used = p_th->b_used;
+
+    if( b_used )
+        ThumbnailerFlush( p_th );
+    p_th->b_used = true;
+
+    if( (i_time > 0 || b_used)
+     && demux_Control( p_th->p_demux, DEMUX_SET_TIME, i_time, false ) )
+        msg_Warn( p_th->p_obj, "cannot seek to %"PRId64" us, using the %s",
+                  i_time, b_used ? "current position" : "start" );
+
+    while( p_sys->p_picture == NULL && !p_sys->b_error
+        && p_sys->i_blocks < THUMBNAIL_MAX_BLOCKS )
+    {
+        if( demux_Demux( p_th->p_demux ) <= 0 )
+            break;
+    }
+
+    /* Drain the decoder, it may hold back the only keyframe it got */
+    if( p_sys->p_picture == NULL && p_sys->p_dec != NULL && !p_sys->b_error )
+        Decode( p_sys, NULL );
+
+    picture_t *p_pic = p_sys->p_picture;
+    p_sys->p_picture = NULL;
+    if( p_pic == NULL )
+        msg_Warn( p_th->p_obj, "no picture decoded for thumbnailing" );
+    return p_pic;
+}
+
+#undef input_GetThumbnail
+/**
+ * Extracts a thumbnail from an input item.
+ */
+block_t *input_GetThumbnail( vlc_object_t *p_parent, input_item_t *p_item,
+                             mtime_t i_time, vlc_fourcc_t i_format,
+                             int i_width, int i_height )
+{
+    thumbnailer_t *p_th = ThumbnailerOpen( p_parent, p_item );
+    if( p_th == NULL )
+        return NULL;
+
+    block_t *p_image = NULL;
+    picture_t *p_pic = ThumbnailerGet( p_th, i_time );
+    if( p_pic != NULL )
+    {
+        if( picture_Export( p_th->p_obj, &p_image, NULL, p_pic, i_format,
+                            i_width, i_height ) )
+            p_image = NULL;
+        picture_Release( p_pic );
+    }
+
+    ThumbnailerClose( p_th );
+    return p_image;
+}
+
+/*****************************************************************************
+ * Thumbnails strip
+ *****************************************************************************/
+struct input_thumbnails_t
+{
+    vlc_object_t *p_parent;
+    input_item_t *p_item;
+    mtime_t       i_interval;
+    vlc_fourcc_t  i_format;
+    int           i_width;
+    int           i_height;
+
+    vlc_thread_t    thread;
+    vlc_interrupt_t interrupt;
+
+    vlc_mutex_t lock;
+    block_t   **pp_images; /* NULL until generated */
+    unsigned    i_count;   /* 0 until the length is known */
+    bool        b_stop;
+};
+
+static void *ThumbnailsThread( void *data )
+{
+    input_thumbnails_t *p_ths = data;
+
+    vlc_interrupt_set( &p_ths->interrupt );
+
+    thumbnailer_t *p_th = ThumbnailerOpen( p_ths->p_parent, p_ths->p_item );
+    if( p_th == NULL )
+        return NULL;
+
+    mtime_t i_length;
+    if( demux_Control( p_th->p_demux, DEMUX_GET_LENGTH, &i_length )
+     || i_length <= 0 )
+        i_length = input_item_GetDuration( p_ths->p_item );
+
+    unsigned i_count = 1;
+    if( i_length > 0 )
+        i_count = (i_length + p_ths->i_interval - 1) / p_ths->i_interval;
+
+    block_t **pp_images = calloc( i_count, sizeof( *pp_images ) );
+    if( unlikely(pp_images == NULL) )
+    {
+        ThumbnailerClose( p_th );
+        return NULL;
+    }
+
+    vlc_mutex_lock( &p_ths->lock );
+    p_ths->pp_images = pp_images;
+    p_ths->i_count = i_count;
+    vlc_mutex_unlock( &p_ths->lock );
+
+    msg_Dbg( p_th->p_obj, "generating %u thumbnails every %"PRId64" us",
+             i_count, p_ths->i_interval );
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        picture_t *p_pic = ThumbnailerGet( p_th, i * p_ths->i_interval );
+        block_t *p_image = NULL;
+
+        if( p_pic != NULL )
+        {
+            if( picture_Export( p_th->p_obj, &p_image, NULL, p_pic,
+                                p_ths->i_format, p_ths->i_width,
+                                p_ths->i_height ) )
+                p_image = NULL;
+            picture_Release( p_pic );
+        }
+
+        vlc_mutex_lock( &p_ths->lock );
+        pp_images[i] = p_image;
+        bool b_stop = p_ths->b_stop;
+        vlc_mutex_unlock( &p_ths->lock );
+
+        if( b_stop || p_th->sys.b_error || !p_th->sys.b_has_video )
+            break;
+    }
+
+    ThumbnailerClose( p_th );
+    return NULL;
+}
+
+#undef input_thumbnails_New
+/**
+ * Starts generating the thumbnails strip of an input item.
+ */
+input_thumbnails_t *input_thumbnails_New( vlc_object_t *p_parent,
+                                          input_item_t *p_item,
+                                          mtime_t i_interval,
+                                          vlc_fourcc_t i_format,
+                                          int i_width, int i_height )
+{
+    assert( i_interval > 0 );
+
+    input_thumbnails_t *p_ths = malloc( sizeof( *p_ths ) );
+    if( unlikely(p_ths == NULL) )
+        return NULL;
+
+    p_ths->p_parent = p_parent;
+    p_ths->p_item = p_item;
+    p_ths->i_interval = i_interval;
+    p_ths->i_format = i_format;
+    p_ths->i_width = i_width;
+    p_ths->i_height = i_height;
+    p_ths->pp_images = NULL;
+    p_ths->i_count = 0;
+    p_ths->b_stop = false;
+    vlc_mutex_init( &p_ths->lock );
+    vlc_interrupt_init( &p_ths->interrupt );
+    input_item_Hold( p_item );
+
+    if( vlc_clone( &p_ths->thread, ThumbnailsThread, p_ths,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        input_item_Release( p_item );
+        vlc_interrupt_deinit( &p_ths->interrupt );
+        vlc_mutex_destroy( &p_ths->lock );
+        free( p_ths );
+        return NULL;
+    }
+    return p_ths;
+}
+
+/**
+ * Stops generating and destroys a thumbnails strip.
+ */
+void input_thumbnails_Delete( input_thumbnails_t *p_ths )
+{
+    vlc_mutex_lock( &p_ths->lock );
+    p_ths->b_stop = true;
+    vlc_mutex_unlock( &p_ths->lock );
+    vlc_interrupt_kill( &p_ths->interrupt );
+
+    vlc_join( p_ths->thread, NULL );
+
+    for( unsigned i = 0; i < p_ths->i_count; i++ )
+        if( p_ths->pp_images[i] != NULL )
+            block_Release( p_ths->pp_images[i] );
+    free( p_ths->pp_images );
+    input_item_Release( p_ths->p_item );
+    vlc_interrupt_deinit( &p_ths->interrupt );
+    vlc_mutex_destroy( &p_ths->lock );
+    free( p_ths );
+}
+
+/**
+ * Gets the number of thumbnails in a strip.
+ *
+ * \return the number of thumbnails, or 0 if the length of the media is not
+ * known yet
+ */
+unsigned input_thumbnails_Count( input_thumbnails_t *p_ths )
+{
+    vlc_mutex_lock( &p_ths->lock );
+    unsigned i_count = p_ths->i_count;
+    vlc_mutex_unlock( &p_ths->lock );
+    return i_count;
+}
+
+/**
+ * Gets a thumbnail of a strip.
+ *
+ * \return a copy of the encoded image, or NULL if it is not generated (yet)
+ */
+block_t *input_thumbnails_Get( input_thumbnails_t *p_ths, unsigned i_index )
+{
+    block_t *p_image = NULL;
+
+    vlc_mutex_lock( &p_ths->lock );
+    if( i_index < p_ths->i_count && p_ths->pp_images[i_index] != NULL )
+        p_image = block_Duplicate( p_ths->pp_images[i_index] );
+    vlc_mutex_unlock( &p_ths->lock );
+    return p_image;
+}
@@ -71,6 +71,9 @@ static int RecordCallback( vlc_object_t *p_this, char const *psz_cmd,
 static int FrameNextCallback( vlc_object_t *p_this, char const *psz_cmd,
                               vlc_value_t oldval, vlc_value_t newval,
                               void *p_data );
+static int StandbyCallback( vlc_object_t *p_this, char const *psz_cmd,
+                            vlc_value_t oldval, vlc_value_t newval,
+                            void *p_data );
 
 typedef struct
 {
@@ -105,6 +108,7 @@ static const vlc_input_callback_t p_input_callbacks[] =
     CALLBACK( "spu-es", ESCallback ),
     CALLBACK( "record", RecordCallback ),
     CALLBACK( "frame-next", FrameNextCallback ),
+    CALLBACK( "standby", StandbyCallback ),
 
     CALLBACK( NULL, NULL )
 };
@@ -208,6 +212,7 @@ void input_ControlVarInit ( input_thread_t *p_input )
     var_Create( p_input, "bookmarks", VLC_VAR_STRING | VLC_VAR_DOINHERIT );
 
     var_Create( p_input, "length", VLC_VAR_INTEGER );
+    var_Create( p_input, "latency", VLC_VAR_INTEGER );
 
     var_Create( p_input, "bit-rate", VLC_VAR_INTEGER );
     var_Create( p_input, "sample-rate", VLC_VAR_INTEGER );
@@ -445,6 +450,8 @@ void input_ConfigVarInit ( input_thread_t *p_input )
         var_Create( p_input, "stop-time", VLC_VAR_FLOAT|VLC_VAR_DOINHERIT );
         var_Create( p_input, "run-time", VLC_VAR_FLOAT|VLC_VAR_DOINHERIT );
         var_Create( p_input, "input-fast-seek", VLC_VAR_BOOL|VLC_VAR_DOINHERIT );
+        var_Create( p_input, "input-trickplay-rate",
+                    VLC_VAR_FLOAT|VLC_VAR_DOINHERIT );
 
         var_Create( p_input, "input-slave",
                     VLC_VAR_STRING | VLC_VAR_DOINHERIT );
@@ -475,6 +482,9 @@ void input_ConfigVarInit ( input_thread_t *p_input )
     var_Create( p_input, "record", VLC_VAR_BOOL );
     var_SetBool( p_input, "record", false );
 
+    var_Create( p_input, "standby", VLC_VAR_BOOL );
+    var_SetBool( p_input, "standby", false );
+
     var_Create( p_input, "teletext-es", VLC_VAR_INTEGER );
     var_SetInteger( p_input, "teletext-es", -1 );
 
@@ -817,3 +827,15 @@ static int FrameNextCallback( vlc_object_t *p_this, char const *psz_cmd,
     return VLC_SUCCESS;
 }
 
+
+static int StandbyCallback( vlc_object_t *p_this, char const *psz_cmd,
+                            vlc_value_t oldval, vlc_value_t newval,
+                            void *p_data )
+{
+    input_thread_t *p_input = (input_thread_t*)p_this;
+    VLC_UNUSED(psz_cmd); VLC_UNUSED(oldval); VLC_UNUSED(p_data);
+
+    input_ControlPush( p_input, INPUT_CONTROL_SET_STANDBY, &newval );
+
+    return VLC_SUCCESS;
+}
@@ -92,15 +92,55 @@ static int InputEvent( vlc_object_t *p_this, char const *psz_cmd,
 
     if( newval.i_int == INPUT_EVENT_STATE )
     {
+        const int state = var_GetInteger( p_input, "state" );
+
         for( int i = 0; i < p_media->i_instance; i++ )
         {
-            if( p_media->instance[i]->p_input == p_input )
+            vlm_media_instance_sys_t *p_instance = p_media->instance[i];
+
+            if( p_instance->p_input == p_input )
             {
-                psz_instance_name = p_media->instance[i]->psz_name;
+                psz_instance_name = p_instance->psz_name;
+                if( state == END_S || state == ERROR_S )
+                    atomic_store( &p_instance->ended, true );
                 break;
             }
         }
-        vlm_SendEventMediaInstanceState( p_vlm, p_media->cfg.id, p_media->cfg.psz_name, psz_instance_name, var_GetInteger( p_input, "state" ) );
+        vlm_SendEventMediaInstanceState( p_vlm, p_media->cfg.id, p_media->cfg.psz_name, psz_instance_name, state );
+
+        vlc_mutex_lock( &p_vlm->lock_manage );
+        p_vlm->input_state_changed = true;
+        vlc_cond_signal( &p_vlm->wait_manage );
+        vlc_mutex_unlock( &p_vlm->lock_manage );
+    }
+    return VLC_SUCCESS;
+}
+
+static int MuxInputEvent( vlc_object_t *p_this, char const *psz_cmd,
+                          vlc_value_t oldval, vlc_value_t newval,
+                          void *p_data )
+{
+    VLC_UNUSED(psz_cmd);
+    VLC_UNUSED(oldval);
+    input_thread_t *p_input = (input_thread_t *)p_this;
+    vlm_t *p_vlm = libvlc_priv( p_input->p_libvlc )->p_vlm;
+    assert( p_vlm );
+    vlm_mux_sys_t *p_mux = p_data;
+
+    if( newval.i_int == INPUT_EVENT_STATE )
+    {
+        const int state = var_GetInteger( p_input, "state" );
+
+        /* The members only change while the input is stopped */
+        for( int i = 0; i < p_mux->i_member; i++ )
+        {
+            vlm_media_instance_sys_t *p_instance = p_mux->member[i];
+            vlm_media_sys_t *p_media = p_instance->p_media;
+
+            if( state == END_S || state == ERROR_S )
+                atomic_store( &p_instance->ended, true );
+            vlm_SendEventMediaInstanceState( p_vlm, p_media->cfg.id, p_media->cfg.psz_name, p_instance->psz_name, state );
+        }
 
         vlc_mutex_lock( &p_vlm->lock_manage );
         p_vlm->input_state_changed = true;
@@ -152,6 +192,7 @@ vlm_t *vlm_New ( vlc_object_t *p_this )
     p_vlm->input_state_changed = false;
     p_vlm->i_id = 1;
     TAB_INIT( p_vlm->i_media, p_vlm->media );
+    TAB_INIT( p_vlm->i_mux, p_vlm->mux );
     TAB_INIT( p_vlm->i_schedule, p_vlm->schedule );
     p_vlm->p_vod = NULL;
     var_Create( p_vlm, "intf-event", VLC_VAR_ADDRESS );
@@ -217,6 +258,8 @@ void vlm_Delete( vlm_t *p_vlm )
     vlc_mutex_lock( &p_vlm->lock );
     vlm_ControlInternal( p_vlm, VLM_CLEAR_MEDIAS );
     TAB_CLEAN( p_vlm->i_media, p_vlm->media );
+    assert( p_vlm->i_mux == 0 );
+    TAB_CLEAN( p_vlm->i_mux, p_vlm->mux );
 
     vlm_ControlInternal( p_vlm, VLM_CLEAR_SCHEDULES );
     TAB_CLEAN( p_vlm->i_schedule, p_vlm->schedule );
@@ -416,7 +459,9 @@ static void* Manage( void* p_object )
         vlc_mutex_unlock( &vlm->lock_manage );
 
         int canc = vlc_savecancel ();
-        /* destroy the inputs that wants to die, and launch the next input */
+        /* destroy the inputs that wants to die, and launch the next input.
+         * The input events flag the ended instances, so that this does not
+         * query the state of every input of every media. */
         vlc_mutex_lock( &vlm->lock );
         for( i = 0; i < vlm->i_media; i++ )
         {
@@ -425,11 +470,8 @@ static void* Manage( void* p_object )
             for( j = 0; j < p_media->i_instance; )
             {
                 vlm_media_instance_sys_t *p_instance = p_media->instance[j];
-                int state = INIT_S;
 
-                if( p_instance->p_input != NULL )
-                    state = var_GetInteger( p_instance->p_input, "state" );
-                if( state == END_S || state == ERROR_S )
+                if( atomic_exchange( &p_instance->ended, false ) )
                 {
                     int i_new_input_index;
 
@@ -794,6 +836,19 @@ static int vlm_ControlMediaAdd( vlm_t *p_vlm, vlm_media_t *p_cfg, int64_t *p_id
     return vlm_OnMediaUpdate( p_vlm, p_media );
 }
 
+/* Asks all the inputs of a media to stop at once: they then wind down in
+ * parallel, instead of each one only after the previous one was joined. */
+static void vlm_MediaInstancesStop( vlm_media_sys_t *p_media )
+{
+    for( int i = 0; i < p_media->i_instance; i++ )
+    {
+        vlm_media_instance_sys_t *p_instance = p_media->instance[i];
+
+        if( p_instance->p_input != NULL && p_instance->p_mux == NULL )
+            input_Stop( p_instance->p_input );
+    }
+}
+
 static int vlm_ControlMediaDel( vlm_t *p_vlm, int64_t id )
 {
     vlm_media_sys_t *p_media = vlm_ControlMediaGetById( p_vlm, id );
@@ -801,6 +856,7 @@ static int vlm_ControlMediaDel( vlm_t *p_vlm, int64_t id )
     if( !p_media )
         return VLC_EGENERIC;
 
+    vlm_MediaInstancesStop( p_media );
     while( p_media->i_instance > 0 )
         vlm_ControlInternal( p_vlm, VLM_STOP_MEDIA_INSTANCE, id, p_media->instance[0]->psz_name );
 
@@ -846,6 +902,9 @@ static int vlm_ControlMediaGets( vlm_t *p_vlm, vlm_media_t ***ppp_dsc, int *pi_d
 }
 static int vlm_ControlMediaClear( vlm_t *p_vlm )
 {
+    for( int i = 0; i < p_vlm->i_media; i++ )
+        vlm_MediaInstancesStop( p_vlm->media[i] );
+
     while( p_vlm->i_media > 0 )
         vlm_ControlMediaDel( p_vlm, p_vlm->media[0]->cfg.id );
 
@@ -900,13 +959,236 @@ static vlm_media_instance_sys_t *vlm_MediaInstanceNew( vlm_t *p_vlm, const char
     p_instance->p_parent = vlc_object_create( p_vlm, sizeof (vlc_object_t) );
     p_instance->p_input = NULL;
     p_instance->p_input_resource = input_resource_New( p_instance->p_parent );
+    p_instance->p_mux = NULL;
+    p_instance->p_media = NULL;
+    atomic_init( &p_instance->ended, false );
 
     return p_instance;
 }
+
+/*****************************************************************************
+ * Shared multiplex inputs:
+ * The broadcast instances of medias with the "shared" option feed on a
+ * single input per input MRL, for instance a DVB multiplex. The input
+ * receives and demultiplexes the selected programs only once, and the
+ * duplicate stream output sends each program to the output of its media.
+ *****************************************************************************/
+/* Returns the program number of a shared media, or 0 if it is not shared */
+static int vlm_MediaSharedProgram( const vlm_media_t *p_cfg )
+{
+    bool b_shared = false;
+    int i_program = 0;
+
+    if( p_cfg->b_vod || p_cfg->psz_output == NULL )
+        return 0;
+
+    for( int i = 0; i < p_cfg->i_option; i++ )
+    {
+        const char *psz_option = p_cfg->ppsz_option[i];
+
+        if( !strcmp( psz_option, "shared" ) )
+            b_shared = true;
+        else if( !strcmp( psz_option, "noshared" ) || !strcmp( psz_option, "no-shared" ) )
+            b_shared = false;
+        else if( !strncmp( psz_option, "program=", 8 ) )
+            i_program = atoi( psz_option + 8 );
+    }
+    return ( b_shared && i_program > 0 ) ? i_program : 0;
+}
+
+static void vlm_MuxStop( vlm_mux_sys_t *p_mux )
+{
+    input_thread_t *p_input = p_mux->p_input;
+    if( !p_input )
+        return;
+
+    var_DelCallback( p_input, "intf-event", MuxInputEvent, p_mux );
+    input_Stop( p_input );
+    input_Close( p_input );
+    input_resource_TerminateSout( p_mux->p_input_resource );
+
+    p_mux->p_input = NULL;
+    for( int i = 0; i < p_mux->i_member; i++ )
+        p_mux->member[i]->p_input = NULL;
+}
+
+static int vlm_MuxStart( vlm_mux_sys_t *p_mux )
+{
+    assert( p_mux->p_input == NULL );
+    if( p_mux->i_member <= 0 )
+        return VLC_EGENERIC;
+
+    input_item_t *p_item = input_item_New( p_mux->psz_input, NULL );
+    if( !p_item )
+        return VLC_ENOMEM;
+
+    /* The input (e.g. tuning) options are those of the first member */
+    const vlm_media_t *p_cfg = &p_mux->member[0]->p_media->cfg;
+    for( int i = 0; i < p_cfg->i_option; i++ )
+    {
+        const char *psz_option = p_cfg->ppsz_option[i];
+
+        if( strcmp( psz_option, "shared" ) && strcmp( psz_option, "noshared" ) &&
+            strcmp( psz_option, "no-shared" ) && strcmp( psz_option, "sout-keep" ) &&
+            strcmp( psz_option, "nosout-keep" ) && strcmp( psz_option, "no-sout-keep" ) &&
+            strncmp( psz_option, "program=", 8 ) )
+            input_item_AddOption( p_item, psz_option, VLC_INPUT_OPTION_TRUSTED );
+    }
+
+    /* Select the programs, and send each one to the output of its media */
+    char *psz_programs = NULL, *psz_sout = NULL;
+    size_t i_programs, i_sout;
+    FILE *programs = open_memstream( &psz_programs, &i_programs );
+    FILE *sout = open_memstream( &psz_sout, &i_sout );
+
+    if( programs == NULL || sout == NULL )
+    {
+        if( programs != NULL )
+            fclose( programs );
+        if( sout != NULL )
+            fclose( sout );
+        free( psz_programs );
+        free( psz_sout );
+        vlc_gc_decref( p_item );
+        return VLC_ENOMEM;
+    }
+
+    fputs( "programs=", programs );
+    fputs( "sout=#duplicate{", sout );
+    for( int i = 0; i < p_mux->i_member; i++ )
+    {
+        const vlm_media_t *p_member = &p_mux->member[i]->p_media->cfg;
+        const char *psz_output = p_member->psz_output;
+        int i_program = vlm_MediaSharedProgram( p_member );
+
+        if( *psz_output == '#' )
+            psz_output++;
+        fprintf( programs, "%s%d", i ? "," : "", i_program );
+        fprintf( sout, "%sdst=%s,select=\"program=%d\"", i ? "," : "",
+                 psz_output, i_program );
+    }
+    fputc( '}', sout );
+    fclose( programs );
+    fclose( sout );
+
+    input_item_AddOption( p_item, psz_programs, VLC_INPUT_OPTION_TRUSTED );
+    input_item_AddOption( p_item, psz_sout, VLC_INPUT_OPTION_TRUSTED );
+    free( psz_programs );
+    free( psz_sout );
+
+    if( p_mux->p_item )
+        vlc_gc_decref( p_mux->p_item );
+    p_mux->p_item = p_item;
+
+    char *psz_log;
+    if( asprintf( &psz_log, _("Multiplex: %s"), p_mux->psz_input ) == -1 )
+        return VLC_ENOMEM;
+
+    input_thread_t *p_input = input_Create( p_mux->p_parent, p_item, psz_log,
+                                            p_mux->p_input_resource );
+    free( psz_log );
+    if( !p_input )
+        return VLC_EGENERIC;
+
+    var_AddCallback( p_input, "intf-event", MuxInputEvent, p_mux );
+    if( input_Start( p_input ) != VLC_SUCCESS )
+    {
+        var_DelCallback( p_input, "intf-event", MuxInputEvent, p_mux );
+        input_Close( p_input );
+        return VLC_EGENERIC;
+    }
+
+    p_mux->p_input = p_input;
+    for( int i = 0; i < p_mux->i_member; i++ )
+        p_mux->member[i]->p_input = p_input;
+    return VLC_SUCCESS;
+}
+
+static void vlm_MuxDetach( vlm_t *p_vlm, vlm_media_instance_sys_t *p_instance )
+{
+    vlm_mux_sys_t *p_mux = p_instance->p_mux;
+
+    /* The other programs are interrupted while the input restarts */
+    vlm_MuxStop( p_mux );
+    TAB_REMOVE( p_mux->i_member, p_mux->member, p_instance );
+    p_instance->p_mux = NULL;
+    p_instance->p_media = NULL;
+
+    if( p_mux->i_member > 0 )
+    {
+        if( vlm_MuxStart( p_mux ) )
+            msg_Err( p_vlm, "cannot restart multiplex %s", p_mux->psz_input );
+        return;
+    }
+
+    msg_Dbg( p_vlm, "closing multiplex %s", p_mux->psz_input );
+    input_resource_Terminate( p_mux->p_input_resource );
+    input_resource_Release( p_mux->p_input_resource );
+    vlc_object_release( p_mux->p_parent );
+    if( p_mux->p_item )
+        vlc_gc_decref( p_mux->p_item );
+
+    TAB_REMOVE( p_vlm->i_mux, p_vlm->mux, p_mux );
+    TAB_CLEAN( p_mux->i_member, p_mux->member );
+    free( p_mux->psz_input );
+    free( p_mux );
+}
+
+static int vlm_MuxAttach( vlm_t *p_vlm, vlm_media_sys_t *p_media,
+                          vlm_media_instance_sys_t *p_instance,
+                          const char *psz_input )
+{
+    vlm_mux_sys_t *p_mux = NULL;
+
+    for( int i = 0; i < p_vlm->i_mux; i++ )
+        if( !strcmp( p_vlm->mux[i]->psz_input, psz_input ) )
+        {
+            p_mux = p_vlm->mux[i];
+            break;
+        }
+
+    if( !p_mux )
+    {
+        p_mux = calloc( 1, sizeof( *p_mux ) );
+        if( !p_mux )
+            return VLC_ENOMEM;
+        p_mux->psz_input = strdup( psz_input );
+        if( !p_mux->psz_input )
+        {
+            free( p_mux );
+            return VLC_ENOMEM;
+        }
+        p_mux->p_parent = vlc_object_create( p_vlm, sizeof (vlc_object_t) );
+        p_mux->p_item = NULL;
+        p_mux->p_input = NULL;
+        p_mux->p_input_resource = input_resource_New( p_mux->p_parent );
+        TAB_INIT( p_mux->i_member, p_mux->member );
+        TAB_APPEND( p_vlm->i_mux, p_vlm->mux, p_mux );
+        msg_Dbg( p_vlm, "opening multiplex %s", psz_input );
+    }
+
+    vlm_MuxStop( p_mux );
+    p_instance->p_mux = p_mux;
+    p_instance->p_media = p_media;
+    TAB_APPEND( p_mux->i_member, p_mux->member, p_instance );
+
+    if( vlm_MuxStart( p_mux ) )
+    {
+        vlm_MuxDetach( p_vlm, p_instance );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
 static void vlm_MediaInstanceDelete( vlm_t *p_vlm, int64_t id, vlm_media_instance_sys_t *p_instance, vlm_media_sys_t *p_media )
 {
     input_thread_t *p_input = p_instance->p_input;
-    if( p_input )
+    if( p_instance->p_mux )
+    {
+        vlm_MuxDetach( p_vlm, p_instance );
+
+        vlm_SendEventMediaInstanceStopped( p_vlm, id, p_media->cfg.psz_name );
+    }
+    else if( p_input )
     {
         input_Stop( p_input );
         input_Close( p_input );
@@ -987,7 +1269,16 @@ static int vlm_ControlMediaInstanceStart( vlm_t *p_vlm, int64_t id, const char *
 
     /* Stop old instance */
     input_thread_t *p_input = p_instance->p_input;
-    if( p_input )
+    if( p_instance->p_mux )
+    {
+        if( p_instance->i_index == i_input_index && p_input )
+            return VLC_SUCCESS;
+
+        vlm_MuxDetach( p_vlm, p_instance );
+
+        vlm_SendEventMediaInstanceStopped( p_vlm, id, p_media->cfg.psz_name );
+    }
+    else if( p_input )
     {
         if( p_instance->i_index == i_input_index )
         {
@@ -1008,16 +1299,32 @@ static int vlm_ControlMediaInstanceStart( vlm_t *p_vlm, int64_t id, const char *
     }
 
     /* Start new one */
+    atomic_store( &p_instance->ended, false );
     p_instance->i_index = i_input_index;
+    char *psz_uri;
     if( strstr( p_media->cfg.ppsz_input[p_instance->i_index], "://" ) == NULL )
-    {
-        char *psz_uri = vlc_path2uri(
+        psz_uri = vlc_path2uri(
                           p_media->cfg.ppsz_input[p_instance->i_index], NULL );
-        input_item_SetURI( p_instance->p_item, psz_uri ) ;
+    else
+        psz_uri = strdup( p_media->cfg.ppsz_input[p_instance->i_index] );
+    if( unlikely(psz_uri == NULL) )
+    {
+        vlm_MediaInstanceDelete( p_vlm, id, p_instance, p_media );
+        return VLC_ENOMEM;
+    }
+
+    if( vlm_MediaSharedProgram( &p_media->cfg ) > 0 )
+    {
+        if( vlm_MuxAttach( p_vlm, p_media, p_instance, psz_uri ) )
+            vlm_MediaInstanceDelete( p_vlm, id, p_instance, p_media );
+        else
+            vlm_SendEventMediaInstanceStarted( p_vlm, id, p_media->cfg.psz_name );
         free( psz_uri );
+        return VLC_SUCCESS;
     }
-    else
-        input_item_SetURI( p_instance->p_item, p_media->cfg.ppsz_input[p_instance->i_index] ) ;
+
+    input_item_SetURI( p_instance->p_item, psz_uri ) ;
+    free( psz_uri );
 
     if( asprintf( &psz_log, _("Media: %s"), p_media->cfg.psz_name ) != -1 )
     {
@@ -1076,7 +1383,7 @@ static int vlm_ControlMediaInstancePause( vlm_t *p_vlm, int64_t id, const char *
         return VLC_EGENERIC;
 
     p_instance = vlm_ControlMediaInstanceGetByName( p_media, psz_id );
-    if( !p_instance || !p_instance->p_input )
+    if( !p_instance || !p_instance->p_input || p_instance->p_mux )
         return VLC_EGENERIC;
 
     /* Toggle pause state */
@@ -1114,7 +1421,7 @@ static int vlm_ControlMediaInstanceSetTimePosition( vlm_t *p_vlm, int64_t id, co
         return VLC_EGENERIC;
 
     p_instance = vlm_ControlMediaInstanceGetByName( p_media, psz_id );
-    if( !p_instance || !p_instance->p_input )
+    if( !p_instance || !p_instance->p_input || p_instance->p_mux )
         return VLC_EGENERIC;
 
     if( i_time >= 0 )
@@ -1167,6 +1474,7 @@ static int vlm_ControlMediaInstanceClear( vlm_t *p_vlm, int64_t id )
     if( !p_media )
         return VLC_EGENERIC;
 
+    vlm_MediaInstancesStop( p_media );
     while( p_media->i_instance > 0 )
         vlm_ControlMediaInstanceStop( p_vlm, id, p_media->instance[0]->psz_name );
 
@@ -25,9 +25,12 @@
 #define LIBVLC_VLM_INTERNAL_H 1
 
 #include <vlc_vlm.h>
+#include <vlc_atomic.h>
 #include "input_interface.h"
 
 /* Private */
+typedef struct vlm_mux_sys_t vlm_mux_sys_t;
+
 typedef struct
 {
     /* instance name */
@@ -43,10 +46,17 @@ typedef struct
     input_thread_t    *p_input;
     input_resource_t *p_input_resource;
 
+    /* shared input of the multiplex (p_input then belongs to it) */
+    vlm_mux_sys_t           *p_mux;
+    struct vlm_media_sys_t  *p_media;
+
+    /* set by the input events when the input ended, cleared by Manage() */
+    atomic_bool             ended;
+
 } vlm_media_instance_sys_t;
 
 
-typedef struct
+typedef struct vlm_media_sys_t
 {
     vlm_media_t cfg;
 
@@ -61,6 +71,22 @@ typedef struct
     vlm_media_instance_sys_t **instance;
 } vlm_media_sys_t;
 
+/* Input shared by the broadcast instances of the programs of a multiplex */
+struct vlm_mux_sys_t
+{
+    /* input MRL */
+    char *psz_input;
+
+    vlc_object_t *p_parent;
+    input_item_t      *p_item;
+    input_thread_t    *p_input;
+    input_resource_t *p_input_resource;
+
+    /* instances fed by the input, one program each */
+    int                      i_member;
+    vlm_media_instance_sys_t **member;
+};
+
 typedef struct
 {
     /* names "schedule" is reserved */
@@ -103,6 +129,10 @@ struct vlm_t
     int                i_media;
     vlm_media_sys_t    **media;
 
+    /* Shared multiplex inputs */
+    int                i_mux;
+    vlm_mux_sys_t      **mux;
+
     /* Schedule list */
     int            i_schedule;
     vlm_schedule_sys_t **schedule;
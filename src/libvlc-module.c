@@ -31,6 +31,8 @@
 # include "config.h"
 #endif
 
+#include <limits.h>
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_cpu.h>
@@ -148,6 +150,13 @@ static const char *const ppsz_snap_formats[] =
     "This delays the audio output. The delay must be given in milliseconds. " \
     "This can be handy if you notice a lag between the video and the audio.")
 
+#define AUDIO_LATENCY_TEXT N_("Audio latency target (ms)")
+#define AUDIO_LATENCY_LONGTEXT N_( \
+    "Playback delay that the audio output should aim for. Outputs that " \
+    "support it size their buffers accordingly, and the drift is corrected " \
+    "by continuous fine-grained resampling rather than in steps. " \
+    "0 keeps the output defaults.")
+
 #define AUDIO_RESAMPLER_TEXT N_("Audio resampler")
 #define AUDIO_RESAMPLER_LONGTEXT N_( \
     "This selects which plugin to use for audio resampling." )
@@ -468,6 +477,20 @@ static const char *const ppsz_pos_descriptions[] =
     "This drops frames that are late (arrive to the video output after " \
     "their intended display date)." )
 
+#define VIDEO_PIPELINING_TEXT N_("Prepare pictures ahead")
+#define VIDEO_PIPELINING_LONGTEXT N_( \
+    "Filter, blend the subtitles and prepare the display of the next " \
+    "picture as soon as the current one is displayed, rather than just " \
+    "before the next display date. This uses more of the frame interval " \
+    "for slow filters and displays, at the cost of an early subtitles and " \
+    "OSD rendering." )
+
+#define VIDEO_FILTER_THREAD_TEXT N_("Filter pictures in a separate thread")
+#define VIDEO_FILTER_THREAD_LONGTEXT N_( \
+    "Run the deinterlacing and post-processing filters in their own " \
+    "thread, a few pictures ahead of the display, so that slow filters " \
+    "do not delay the display of the pictures." )
+
 #define QUIET_SYNCHRO_TEXT N_("Quiet synchro")
 #define QUIET_SYNCHRO_LONGTEXT N_( \
     "This avoids flooding the message log with debug output from the " \
@@ -518,6 +541,33 @@ static const char *const ppsz_pos_descriptions[] =
     "real-time sources. Use this if you experience jerky playback of " \
     "network streams.")
 
+#define CLOCK_RECOVERY_TEXT N_("Clock recovery")
+#define CLOCK_RECOVERY_LONGTEXT N_( \
+    "Method used to estimate the drift between the clock of a real-time " \
+    "source and the local clock. The phase-locked loop follows the drift " \
+    "without lagging, which allows for a lower network caching.")
+static const int pi_clock_recovery_values[] = { 0, 1 };
+static const char *const ppsz_clock_recovery_descriptions[] =
+{ N_("Average"), N_("Phase-locked loop") };
+
+#define CLOCK_BANDWIDTH_TEXT N_("Clock recovery bandwidth (Hz)")
+#define CLOCK_BANDWIDTH_LONGTEXT N_( \
+    "Bandwidth of the clock recovery phase-locked loop. Lower values " \
+    "reject more network jitter, higher values lock on the drift faster.")
+
+#define LOW_LATENCY_TEXT N_("Low latency")
+#define LOW_LATENCY_LONGTEXT N_( \
+    "Minimize the delay of live sources: the clock is recovered with a " \
+    "phase-locked loop, the caching is not increased when the source is " \
+    "late, late pictures and audio are dropped to catch up, and decoders " \
+    "avoid modes that delay frames.")
+
+#define STANDBY_BUFFER_TEXT N_("Standby buffer (ms)")
+#define STANDBY_BUFFER_LONGTEXT N_( \
+    "Data kept by an input opened in standby for fast zapping, for the " \
+    "elementary streams whose keyframes are not known (video is kept from " \
+    "its last keyframe).")
+
 #define CLOCK_JITTER_TEXT N_("Clock jitter")
 #define CLOCK_JITTER_LONGTEXT N_( \
     "This defines the maximum input delay jitter that the synchronization " \
@@ -636,6 +686,12 @@ static const char *const ppsz_prefres[] = {
 #define INPUT_FAST_SEEK_LONGTEXT N_( \
     "Favor speed over precision while seeking" )
 
+#define INPUT_TRICKPLAY_TEXT N_("Trick play speed")
+#define INPUT_TRICKPLAY_LONGTEXT N_( \
+    "From this playback speed on, and when playing backward, only the key " \
+    "frames of the video are decoded, by seeking from one to the next. " \
+    "0 disables trick play (and backward playback)." )
+
 #define INPUT_RATE_TEXT N_("Playback speed")
 #define INPUT_RATE_LONGTEXT N_( \
     "This defines the playback speed (nominal speed is 1.0)." )
@@ -675,6 +731,12 @@ static const char *const ppsz_prefres[] = {
     "This is the maximum size in bytes of the temporary files " \
     "that will be used to store the timeshifted streams." )
 
+#define INPUT_TIMESHIFT_SIZE_TEXT N_("Timeshift size")
+#define INPUT_TIMESHIFT_SIZE_LONGTEXT N_( \
+    "This is the maximum total size in bytes of the temporary files. " \
+    "The oldest ones are dropped when it is reached, moving the " \
+    "timeshifted playback forward. 0 means no limit." )
+
 #define INPUT_TITLE_FORMAT_TEXT N_( "Change title according to current media" )
 #define INPUT_TITLE_FORMAT_LONGTEXT N_( "This option allows you to set the title according to what's being played<br>"  \
     "$a: Artist<br>$b: Album<br>$c: Copyright<br>$t: Title<br>$g: Genre<br>"  \
@@ -897,6 +959,25 @@ static const char *const ppsz_prefres[] = {
     "This allows you to select a list of encoders that VLC will use in " \
     "priority.")
 
+#define DEC_SLOTS_TEXT N_("Concurrent decoders")
+#define DEC_SLOTS_LONGTEXT N_( \
+    "Maximum number of decoders decoding at the same time, for all the " \
+    "inputs of the process. The decoders of the streams being displayed " \
+    "or played go first. This is useful when many inputs are played at " \
+    "once, for instance on a monitoring wall. 0 means no limit." )
+
+#define DEC_QUEUE_SIZE_TEXT N_("Decoder queue size (KiB)")
+#define DEC_QUEUE_SIZE_LONGTEXT N_( \
+    "Maximum amount of data waiting to be decoded for each elementary " \
+    "stream. The input waits for the decoder instead of reading further " \
+    "when it is reached. 0 means no limit." )
+
+#define DEC_QUEUE_DURATION_TEXT N_("Decoder queue duration (ms)")
+#define DEC_QUEUE_DURATION_LONGTEXT N_( \
+    "Maximum duration of the data waiting to be decoded for each " \
+    "elementary stream. The input waits for the decoder instead of reading " \
+    "further when it is reached. 0 means no limit." )
+
 /*****************************************************************************
  * Sout
  ****************************************************************************/
@@ -941,6 +1022,13 @@ static const char *const ppsz_prefres[] = {
     "multiple playlist item (automatically insert the gather stream output " \
     "if not specified)" )
 
+#define SOUT_UNPACED_TEXT N_("Process as fast as possible")
+#define SOUT_UNPACED_LONGTEXT N_( \
+    "Ignore the pace of the stream outputs that cannot control it, such " \
+    "as network outputs or the display, so that the input is never paced " \
+    "by the clock, but only by the queues of the decoders and of the " \
+    "transcoding threads. This is meant for batch transcoding." )
+
 #define SOUT_MUX_CACHING_TEXT N_("Stream output muxer caching (ms)")
 #define SOUT_MUX_CACHING_LONGTEXT N_( \
     "This allow you to configure the initial caching amount for stream output " \
@@ -1008,6 +1096,15 @@ static const char *const ppsz_prefres[] = {
     "slow. You should only activate this if you know what you're " \
     "doing.")
 
+#define THREAD_AFFINITY_TEXT N_("Thread affinity")
+#define THREAD_AFFINITY_LONGTEXT N_( \
+    "Binds all the threads of each input, i.e. the input, decoders, " \
+    "outputs and stream outputs, to one NUMA node, in turn, and allocates " \
+    "their memory from that node when possible.")
+static const int pi_thread_affinity_values[] = { 0, 1 };
+static const char *const ppsz_thread_affinity_descriptions[] =
+    { N_("None"), N_("NUMA node per input") };
+
 #define RT_OFFSET_TEXT N_("Adjust VLC priority")
 #define RT_OFFSET_LONGTEXT N_( \
     "This option adds an offset (positive or negative) to VLC default " \
@@ -1030,6 +1127,42 @@ static const char *const ppsz_prefres[] = {
 #define STATS_LONGTEXT N_( \
      "Collect miscellaneous local statistics about the playing media.")
 
+#define TRACE_FILE_TEXT N_("Timeline trace file")
+#define TRACE_FILE_LONGTEXT N_( \
+    "Record the time spent loading modules, opening inputs, probing and " \
+    "opening modules, creating video outputs and displaying the first " \
+    "picture, and write it to this file in the Chrome trace event format " \
+    "(chrome://tracing) when LibVLC exits.")
+
+#define TRACE_MASK_TEXT N_("Timeline tracepoints")
+#define TRACE_MASK_LONGTEXT N_( \
+    "Hot path tracepoints recorded in the timeline trace file, " \
+    "as a sum of: 1 (demux calls), 2 (decoder calls), 4 (picture display), " \
+    "8 (late pictures), 16 (audio buffers played).")
+
+#define LATENCY_STATS_TEXT N_("Pipeline latency statistics")
+#define LATENCY_STATS_LONGTEXT N_( \
+    "Collect histograms of the time spent demuxing, queued to the decoders, " \
+    "decoding, filtering, rendering and displaying, and of the lateness of " \
+    "the displayed pictures.")
+
+#define CPU_STATS_TEXT N_("Module CPU time statistics")
+#define CPU_STATS_LONGTEXT N_( \
+    "Measure the CPU time spent in each demuxer, decoder, filter and " \
+    "stream output module, and log the most expensive ones on exit.")
+
+#define MEMORY_BUDGET_TEXT N_("Memory budget (MiB)")
+#define MEMORY_BUDGET_LONGTEXT N_( \
+    "Memory that the stream caches and decoder queues of the whole process " \
+    "should stay within. Beyond it, the caches are asked to shrink. " \
+    "0 means no limit.")
+
+#define TIME_EVENT_INTERVAL_TEXT N_("Time event interval (ms)")
+#define TIME_EVENT_INTERVAL_LONGTEXT N_( \
+    "Minimum interval between the time and position change events " \
+    "delivered to LibVLC applications. More frequent changes are merged " \
+    "into the latest one. Zero delivers every change.")
+
 #define DAEMON_TEXT N_("Run as daemon process")
 #define DAEMON_LONGTEXT N_( \
      "Runs VLC as a background daemon process.")
@@ -1093,6 +1226,25 @@ static const char *const ppsz_prefres[] = {
     "Automatically preparse files added to the playlist " \
     "(to retrieve some metadata)." )
 
+#define PREPARSE_THREADS_TEXT N_( "Preparsing threads" )
+#define PREPARSE_THREADS_LONGTEXT N_( \
+    "Maximum number of threads used to preparse files at the same time." )
+
+#define PREPARSE_TIMEOUT_TEXT N_( "Preparsing timeout" )
+#define PREPARSE_TIMEOUT_LONGTEXT N_( \
+    "Delay in milliseconds after which the preparsing of a file is " \
+    "interrupted. 0 means no timeout." )
+
+#define PREPARSE_FAST_TEXT N_( "Fast preparsing" )
+#define PREPARSE_FAST_LONGTEXT N_( \
+    "Read the meta data, duration and track of local files from their " \
+    "tags and headers only, and fully preparse them only if that fails." )
+
+#define META_CACHE_TEXT N_( "Meta data cache" )
+#define META_CACHE_LONGTEXT N_( \
+    "Save the meta data and duration of local files, so that they are not " \
+    "preparsed again until they are modified." )
+
 #define METADATA_NETWORK_TEXT N_( "Allow metadata network access" )
 
 #define SD_TEXT N_( "Services discovery modules")
@@ -1116,6 +1268,12 @@ static const char *const ppsz_prefres[] = {
 #define PAS_LONGTEXT N_( \
     "Stop the playlist after each played playlist item." )
 
+#define ZAP_STANDBY_TEXT N_("Fast zapping standby items")
+#define ZAP_STANDBY_LONGTEXT N_( \
+    "Number of playlist items, before and after the playing one, that are " \
+    "opened in standby, so that switching to them starts at once. " \
+    "0 disables it. It is not used with stream output.")
+
 #define PAE_TEXT N_("Play and exit")
 #define PAE_LONGTEXT N_( \
     "Exit if there are no more items in the playlist." )
@@ -1450,6 +1608,8 @@ vlc_module_begin ()
     add_integer( "audio-desync", 0, DESYNC_TEXT,
                  DESYNC_LONGTEXT, true )
         change_safe ()
+    add_integer_with_range( "audio-latency", 0, 0, 1000, AUDIO_LATENCY_TEXT,
+                            AUDIO_LATENCY_LONGTEXT, true )
 
     add_module( "audio-resampler", "audio resampler", NULL,
                 AUDIO_RESAMPLER_TEXT, AUDIO_RESAMPLER_LONGTEXT, true )
@@ -1497,6 +1657,10 @@ vlc_module_begin ()
         change_private ()
     add_bool( "drop-late-frames", 1, DROP_LATE_FRAMES_TEXT,
               DROP_LATE_FRAMES_LONGTEXT, true )
+    add_bool( "video-pipelining", false, VIDEO_PIPELINING_TEXT,
+              VIDEO_PIPELINING_LONGTEXT, true )
+    add_bool( "video-filter-thread", false, VIDEO_FILTER_THREAD_TEXT,
+              VIDEO_FILTER_THREAD_LONGTEXT, true )
     /* Used in vout_synchro */
     add_bool( "skip-frames", 1, SKIP_FRAMES_TEXT,
               SKIP_FRAMES_LONGTEXT, true )
@@ -1698,6 +1862,9 @@ vlc_module_begin ()
     add_bool( "input-fast-seek", false,
               INPUT_FAST_SEEK_TEXT, INPUT_FAST_SEEK_LONGTEXT, false )
         change_safe ()
+    add_float( "input-trickplay-rate", 8.,
+               INPUT_TRICKPLAY_TEXT, INPUT_TRICKPLAY_LONGTEXT, true )
+        change_safe ()
     add_float( "rate", 1.,
                INPUT_RATE_TEXT, INPUT_RATE_LONGTEXT, false )
 
@@ -1834,6 +2001,22 @@ vlc_module_begin ()
     add_integer( "clock-jitter", 5 * CLOCK_FREQ/1000, CLOCK_JITTER_TEXT,
               CLOCK_JITTER_LONGTEXT, true )
         change_safe()
+    add_integer( "clock-recovery", 0, CLOCK_RECOVERY_TEXT,
+                 CLOCK_RECOVERY_LONGTEXT, true )
+        change_integer_list( pi_clock_recovery_values,
+                             ppsz_clock_recovery_descriptions )
+        change_safe()
+    add_float( "clock-recovery-bandwidth", 0.02, CLOCK_BANDWIDTH_TEXT,
+               CLOCK_BANDWIDTH_LONGTEXT, true )
+        change_float_range( 0.001, 10. )
+        change_safe()
+    add_bool( "low-latency", false, LOW_LATENCY_TEXT,
+              LOW_LATENCY_LONGTEXT, true )
+        change_safe()
+    add_integer( "standby-buffer", 2000, STANDBY_BUFFER_TEXT,
+                 STANDBY_BUFFER_LONGTEXT, true )
+        change_integer_range( 0, 60000 )
+        change_safe()
 
     add_bool( "network-synchronisation", false, NETSYNC_TEXT,
               NETSYNC_LONGTEXT, true )
@@ -1847,6 +2030,8 @@ vlc_module_begin ()
                 INPUT_TIMESHIFT_PATH_LONGTEXT, true )
     add_integer( "input-timeshift-granularity", -1, INPUT_TIMESHIFT_GRANULARITY_TEXT,
                  INPUT_TIMESHIFT_GRANULARITY_LONGTEXT, true )
+    add_integer( "input-timeshift-size", 0, INPUT_TIMESHIFT_SIZE_TEXT,
+                 INPUT_TIMESHIFT_SIZE_LONGTEXT, true )
 
     add_string( "input-title-format", "$Z", INPUT_TITLE_FORMAT_TEXT, INPUT_TITLE_FORMAT_LONGTEXT, false );
 
@@ -1857,6 +2042,17 @@ vlc_module_begin ()
                 CODEC_LONGTEXT, true )
     add_string( "encoder",  NULL, ENCODER_TEXT,
                 ENCODER_LONGTEXT, true )
+    add_integer( "decoder-slots", 0, DEC_SLOTS_TEXT,
+                 DEC_SLOTS_LONGTEXT, true )
+        change_integer_range( 0, 256 )
+    add_integer( "decoder-queue-size", 0, DEC_QUEUE_SIZE_TEXT,
+                 DEC_QUEUE_SIZE_LONGTEXT, true )
+        change_integer_range( 0, 4 * 1024 * 1024 )
+        change_safe()
+    add_integer( "decoder-queue-duration", 0, DEC_QUEUE_DURATION_TEXT,
+                 DEC_QUEUE_DURATION_LONGTEXT, true )
+        change_integer_range( 0, 3600 * 1000 )
+        change_safe()
 
     set_subcategory( SUBCAT_INPUT_ACCESS )
     add_category_hint( N_("Input"), INPUT_CAT_LONGTEXT , false )
@@ -1893,6 +2089,8 @@ vlc_module_begin ()
                                 SOUT_SPU_LONGTEXT, true )
     add_integer( "sout-mux-caching", 1500, SOUT_MUX_CACHING_TEXT,
                                 SOUT_MUX_CACHING_LONGTEXT, true )
+    add_bool( "sout-unpaced", false, SOUT_UNPACED_TEXT,
+                                SOUT_UNPACED_LONGTEXT, true )
 
     set_section( N_("VLM"), NULL )
     add_loadfile( "vlm-conf", NULL, VLM_CONF_TEXT,
@@ -1959,6 +2157,12 @@ vlc_module_begin ()
     add_integer( "rt-offset", 0, RT_OFFSET_TEXT,
                  RT_OFFSET_LONGTEXT, true )
 #endif
+#if defined (__linux__) && !defined (__ANDROID__)
+    add_integer( "thread-affinity", 0, THREAD_AFFINITY_TEXT,
+                 THREAD_AFFINITY_LONGTEXT, true )
+        change_integer_list( pi_thread_affinity_values,
+                             ppsz_thread_affinity_descriptions )
+#endif
 
 #if defined(HAVE_DBUS)
     add_bool( "inhibit", 1, INHIBIT_TEXT,
@@ -1992,6 +2196,9 @@ vlc_module_begin ()
     add_bool( "play-and-exit", 0, PAE_TEXT, PAE_LONGTEXT, false )
     add_bool( "play-and-stop", 0, PAS_TEXT, PAS_LONGTEXT, false )
         change_safe()
+    add_integer( "zap-standby", 0, ZAP_STANDBY_TEXT, ZAP_STANDBY_LONGTEXT,
+                 true )
+        change_integer_range( 0, 8 )
     add_bool( "play-and-pause", 0, PAP_TEXT, PAP_LONGTEXT, true )
         change_safe()
     add_bool( "start-paused", 0, SP_TEXT, SP_LONGTEXT, false )
@@ -2017,6 +2224,16 @@ vlc_module_begin ()
 
     add_bool( "auto-preparse", true, PREPARSE_TEXT,
               PREPARSE_LONGTEXT, false )
+    add_integer( "preparse-threads", 1, PREPARSE_THREADS_TEXT,
+                 PREPARSE_THREADS_LONGTEXT, true )
+        change_integer_range( 1, 32 )
+    add_integer( "preparse-timeout", 5000, PREPARSE_TIMEOUT_TEXT,
+                 PREPARSE_TIMEOUT_LONGTEXT, true )
+        change_integer_range( 0, INT_MAX )
+    add_bool( "preparse-fast", true, PREPARSE_FAST_TEXT,
+              PREPARSE_FAST_LONGTEXT, true )
+    add_bool( "meta-cache", true, META_CACHE_TEXT,
+              META_CACHE_LONGTEXT, true )
 
     add_obsolete_integer( "album-art" )
     add_bool( "metadata-network-access", false, METADATA_NETWORK_TEXT,
@@ -2055,6 +2272,18 @@ vlc_module_begin ()
 
     add_bool ( "stats", true, STATS_TEXT, STATS_LONGTEXT, true )
 
+    add_savefile( "trace-file", NULL, TRACE_FILE_TEXT,
+                  TRACE_FILE_LONGTEXT, true )
+    add_integer( "trace-mask", 0, TRACE_MASK_TEXT, TRACE_MASK_LONGTEXT, true )
+    add_bool( "latency-stats", false, LATENCY_STATS_TEXT,
+              LATENCY_STATS_LONGTEXT, true )
+    add_bool( "cpu-stats", false, CPU_STATS_TEXT, CPU_STATS_LONGTEXT, true )
+    add_integer( "memory-budget", 0, MEMORY_BUDGET_TEXT,
+                 MEMORY_BUDGET_LONGTEXT, true )
+        change_integer_range( 0, INT_MAX )
+    add_integer( "time-event-interval", 0, TIME_EVENT_INTERVAL_TEXT,
+                 TIME_EVENT_INTERVAL_LONGTEXT, true )
+
     set_subcategory( SUBCAT_INTERFACE_MAIN )
     add_module_cat( "intf", SUBCAT_INTERFACE_MAIN, NULL, INTF_TEXT,
                 INTF_LONGTEXT, false )
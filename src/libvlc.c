@@ -69,6 +69,7 @@
 #include "libvlc.h"
 #include "playlist/playlist_internal.h"
 #include "misc/variables.h"
+#include "misc/picture.h"
 
 #include <vlc_vlm.h>
 
@@ -102,6 +103,10 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv->playlist = NULL;
     priv->p_dialog_provider = NULL;
     priv->p_vlm = NULL;
+    priv->tracer = NULL;
+    priv->trace_mask = 0;
+    priv->latency = NULL;
+    priv->cputime = NULL;
 
     vlc_ExitInit( &priv->exit );
 
@@ -124,6 +129,7 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
     char *       psz_parser = NULL;
     char *       psz_control = NULL;
     char        *psz_val;
+    mtime_t      start = mdate();
 
     /* System specific initialization code */
     system_Init();
@@ -144,12 +150,16 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
     }
 
     vlc_threads_setup (p_libvlc);
+    vlc_TraceInit (p_libvlc, start);
 
     /* Load the builtins and plugins into the module_bank.
      * We have to do it before config_Load*() because this also gets the
      * list of configuration options exported by each module and loads their
      * default values. */
+    mtime_t bank_start = mdate();
     size_t module_count = module_LoadPlugins (p_libvlc);
+    vlc_TraceSpan (p_libvlc, "libvlc", bank_start, "module bank load (%zu)",
+                   module_count);
 
     /*
      * Override default configuration with config file settings
@@ -168,6 +178,7 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
     int vlc_optind;
     if( config_LoadCmdLine( p_libvlc, i_argc, ppsz_argv, &vlc_optind ) )
     {
+        vlc_TraceDeinit (p_libvlc);
         vlc_LogDeinit (p_libvlc);
         module_EndBank (true);
         return VLC_EGENERIC;
@@ -194,6 +205,7 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
     if( module_count <= 1 )
     {
         msg_Err( p_libvlc, "No plugins found! Check your VLC installation.");
+        vlc_TraceDeinit (p_libvlc);
         vlc_LogDeinit (p_libvlc);
         module_EndBank (true);
         return VLC_ENOMOD;
@@ -206,6 +218,7 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
         if( daemon( 1, 0) != 0 )
         {
             msg_Err( p_libvlc, "Unable to fork vlc to daemon mode" );
+            vlc_TraceDeinit (p_libvlc);
             vlc_LogDeinit (p_libvlc);
             module_EndBank (true);
             return VLC_ENOMEM;
@@ -352,6 +365,13 @@ dbus_out:
     vlc_CPU_dump( VLC_OBJECT(p_libvlc) );
 
     priv->b_stats = var_InheritBool( p_libvlc, "stats" );
+    vlc_LatencyInit( p_libvlc );
+    vlc_CpuTimeInit( p_libvlc );
+
+    /* The budget is process-wide: the last instance setting one wins */
+    int64_t i_budget = var_InheritInteger( p_libvlc, "memory-budget" );
+    if( i_budget > 0 )
+        vlc_membudget_SetLimit( __MIN( (uint64_t)i_budget << 20, SIZE_MAX ) );
 
     /*
      * Initialize hotkey handling
@@ -487,6 +507,7 @@ dbus_out:
         free( psz_val );
     }
 
+    vlc_TraceSpan (p_libvlc, "libvlc", start, "libvlc init");
     return VLC_SUCCESS;
 }
 
@@ -533,6 +554,11 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
         config_AutoSaveConfigFile( VLC_OBJECT(p_libvlc) );
 
     /* Free module bank. It is refcounted, so we call this each time  */
+    vlc_CpuTimeDeinit (p_libvlc);
+    vlc_LatencyDeinit (p_libvlc);
+    vlc_TraceDeinit (p_libvlc);
+    picture_BufferCacheFlush ();
+    vlc_getaddrinfo_CacheFlush ();
     vlc_LogDeinit (p_libvlc);
     module_EndBank (true);
 #if defined(_WIN32) || defined(__OS2__)
@@ -61,6 +61,24 @@ int vlc_set_priority( vlc_thread_t, int );
 
 void vlc_threads_setup (libvlc_int_t *);
 
+#if defined (__linux__) && defined (HAVE_SCHED_GETAFFINITY) \
+ && !defined (__ANDROID__)
+void vlc_thread_bind_node (void);
+void vlc_thread_unbind (void);
+#else
+# define vlc_thread_bind_node() (void)0
+# define vlc_thread_unbind() (void)0
+#endif
+
+/**
+ * Holds the process-wide task pool for blocking tasks.
+ *
+ * This is a separate pool with a few worker threads, for tasks that wait
+ * on I/O, so that they do not tie up the CPU-bound workers of the shared
+ * task pool. It is released with vlc_taskpool_release().
+ */
+vlc_taskpool_t *vlc_taskpool_hold_io (void);
+
 void vlc_trace (const char *fn, const char *file, unsigned line);
 #define vlc_backtrace() vlc_trace(__func__, __FILE__, __LINE__)
 
@@ -79,6 +97,142 @@ int vlc_LogPreinit(libvlc_int_t *);
 int vlc_LogInit(libvlc_int_t *);
 void vlc_LogDeinit(libvlc_int_t *);
 
+/*
+ * Tracing
+ */
+typedef struct vlc_tracer vlc_tracer_t;
+
+void vlc_TraceInit(libvlc_int_t *, mtime_t origin);
+void vlc_TraceDeinit(libvlc_int_t *);
+/** Records an event that started at the given date and ended now */
+void vlc_TraceSpan(vlc_object_t *, const char *cat, mtime_t start,
+                   const char *fmt, ...) VLC_FORMAT(4, 5);
+#define vlc_TraceSpan(o, ...) vlc_TraceSpan(VLC_OBJECT(o), __VA_ARGS__)
+/** Records an instant event */
+void vlc_TraceEvent(vlc_object_t *, const char *cat,
+                    const char *fmt, ...) VLC_FORMAT(3, 4);
+#define vlc_TraceEvent(o, ...) vlc_TraceEvent(VLC_OBJECT(o), __VA_ARGS__)
+
+/** Hot path tracepoints, enabled by the "trace-mask" bits */
+enum vlc_tracepoint
+{
+    VLC_TP_INPUT_DEMUX,    /**< demux call, value: demux result */
+    VLC_TP_DECODER_DECODE, /**< decoder call, value: input block size */
+    VLC_TP_VOUT_DISPLAY,   /**< picture display, value: picture date */
+    VLC_TP_VOUT_LATE,      /**< late picture dropped, value: lateness */
+    VLC_TP_AOUT_PLAY,      /**< audio buffer played, value: sample count */
+    VLC_TP_MAX
+};
+
+void vlc_TracePointAdd(vlc_object_t *, unsigned id, mtime_t start,
+                       int64_t value);
+
+#define vlc_TracePointEnabled(o, id) \
+    ((libvlc_priv(VLC_OBJECT(o)->p_libvlc)->trace_mask >> (id)) & 1)
+/** Returns the start date for vlc_TracePoint(), or VLC_TS_INVALID if the
+ * tracepoint is disabled */
+#define vlc_TracePointStart(o, id) \
+    (vlc_TracePointEnabled(o, id) ? mdate() : VLC_TS_INVALID)
+/**
+ * Records a tracepoint in the ring buffer of the calling thread, spanning
+ * from start (from vlc_TracePointStart()) until now, or instant if start is
+ * VLC_TS_INVALID. This only costs a test when the tracepoint is disabled.
+ */
+#define vlc_TracePoint(o, id, start, value) \
+    do { \
+        if (vlc_TracePointEnabled(o, id)) \
+            vlc_TracePointAdd(VLC_OBJECT(o), id, start, value); \
+    } while (0)
+
+/*
+ * Latency statistics
+ */
+typedef struct vlc_latency vlc_latency_t;
+
+/** Playback pipeline stages, in the order of the libvlc_latency_stage_t */
+enum vlc_latency_stage
+{
+    VLC_LATENCY_DEMUX,         /**< demux call */
+    VLC_LATENCY_DECODER_QUEUE, /**< wait of the oldest block in a decoder fifo */
+    VLC_LATENCY_DECODE,        /**< decoder call */
+    VLC_LATENCY_FILTER,        /**< video filter chains */
+    VLC_LATENCY_RENDER,        /**< subpicture blending and display prepare */
+    VLC_LATENCY_DISPLAY,       /**< picture display call */
+    VLC_LATENCY_LATENESS,      /**< picture display past its date */
+    VLC_LATENCY_MAX
+};
+
+#define VLC_LATENCY_BUCKETS 24 /* log2 buckets of microseconds */
+
+void vlc_LatencyInit(libvlc_int_t *);
+void vlc_LatencyDeinit(libvlc_int_t *);
+void vlc_LatencyRecord(vlc_object_t *, unsigned stage, mtime_t duration);
+
+#define vlc_LatencyEnabled(o) \
+    (libvlc_priv(VLC_OBJECT(o)->p_libvlc)->latency != NULL)
+/** Returns the start date for vlc_LatencySince(), or VLC_TS_INVALID if the
+ * latency statistics are disabled */
+#define vlc_LatencyStart(o) \
+    (vlc_LatencyEnabled(o) ? mdate() : VLC_TS_INVALID)
+/** Records a duration in the histogram of a stage, if enabled */
+#define vlc_Latency(o, stage, duration) \
+    do { \
+        if (vlc_LatencyEnabled(o)) \
+            vlc_LatencyRecord(VLC_OBJECT(o), stage, duration); \
+    } while (0)
+/** Records the time elapsed since start (from vlc_LatencyStart()) */
+#define vlc_LatencySince(o, stage, start) \
+    do { \
+        mtime_t start_ = (start); \
+        if (start_ > VLC_TS_INVALID) \
+            vlc_LatencyRecord(VLC_OBJECT(o), stage, mdate() - start_); \
+    } while (0)
+
+/*
+ * Module CPU time statistics
+ */
+typedef struct vlc_cputime vlc_cputime_t;
+
+/**
+ * Call of a module, on the stack of the calling thread. The CPU time of the
+ * nested calls is subtracted from the self time of the outer ones.
+ */
+typedef struct vlc_cputime_frame
+{
+    struct vlc_cputime_frame *parent;
+    uint64_t start;    /**< thread CPU time at the start (ns) */
+    uint64_t children; /**< CPU time of the nested calls (ns) */
+} vlc_cputime_frame_t;
+
+void vlc_CpuTimeInit(libvlc_int_t *);
+void vlc_CpuTimeDeinit(libvlc_int_t *);
+void vlc_CpuTimeEnter(vlc_object_t *, vlc_cputime_frame_t *);
+void vlc_CpuTimeLeave(vlc_object_t *, vlc_cputime_frame_t *,
+                      const module_t *);
+
+#define vlc_CpuTimeEnabled(o) \
+    (libvlc_priv(VLC_OBJECT(o)->p_libvlc)->cputime != NULL)
+/** Starts timing a call to a module, if enabled; returns whether it is */
+#define vlc_CpuTimeStart(o, frame) \
+    (vlc_CpuTimeEnabled(o) ? (vlc_CpuTimeEnter(VLC_OBJECT(o), frame), true) \
+                           : false)
+/** Ends timing a call started with vlc_CpuTimeStart() */
+#define vlc_CpuTimeStop(o, timed, frame, module) \
+    do { \
+        if (timed) \
+            vlc_CpuTimeLeave(VLC_OBJECT(o), frame, module); \
+    } while (0)
+
+/*
+ * Memory budget
+ */
+void vlc_membudget_SetLimit(size_t);
+
+/*
+ * Host name resolution cache
+ */
+void vlc_getaddrinfo_CacheFlush(void);
+
 /*
  * LibVLC exit event handling
  */
@@ -146,6 +300,10 @@ typedef struct libvlc_priv_t
 
     /* Logging */
     bool               b_stats;     ///< Whether to collect stats
+    vlc_tracer_t      *tracer;      ///< Timeline trace (or NULL)
+    unsigned           trace_mask;  ///< Enabled tracepoints
+    vlc_latency_t     *latency;     ///< Latency histograms (or NULL)
+    vlc_cputime_t     *cputime;     ///< Module CPU times (or NULL)
 
     /* Singleton objects */
     vlc_logger_t      *logger;
@@ -185,6 +343,7 @@ enum
 {
     STATS_COUNTER,
     STATS_DERIVATIVE,
+    STATS_LAST,
 };
 
 typedef struct counter_sample_t
@@ -35,6 +35,7 @@
 #include <fcntl.h>
 
 #include <vlc_common.h>
+#include <vlc_atomic.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
 
@@ -123,6 +124,15 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /** Initial reserved header and footer size. */
 #define BLOCK_PADDING      32
 
+static void block_Align (block_t *b, size_t size)
+{
+    static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
+                   "BLOCK_PADDING must be a multiple of BLOCK_ALIGN");
+    b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
+    b->p_buffer = (void *)(((uintptr_t)b->p_buffer) & ~(BLOCK_ALIGN - 1));
+    b->i_buffer = size;
+}
+
 block_t *block_Alloc (size_t size)
 {
     /* 2 * BLOCK_PADDING: pre + post padding */
@@ -136,15 +146,416 @@ block_t *block_Alloc (size_t size)
         return NULL;
 
     block_Init (b, b + 1, alloc - sizeof (*b));
-    static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
-                   "BLOCK_PADDING must be a multiple of BLOCK_ALIGN");
-    b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
-    b->p_buffer = (void *)(((uintptr_t)b->p_buffer) & ~(BLOCK_ALIGN - 1));
-    b->i_buffer = size;
+    block_Align (b, size);
     b->pf_release = block_generic_Release;
     return b;
 }
 
+/**
+ * @section Block pools.
+ *
+ * A block pool recycles blocks of a given maximum payload size, so that hot
+ * paths allocating one block per packet do not hit the heap allocator.
+ * Recycled blocks are kept on a singly-linked free list (through p_next).
+ * The pool is reference counted by its owner and by every block it has
+ * allocated, so pooled blocks can outlive block_PoolDelete().
+ */
+struct block_pool_t
+{
+    vlc_mutex_t lock;
+    block_t    *free; /**< Recycled blocks */
+    unsigned    count; /**< Number of recycled blocks */
+    unsigned    max; /**< Maximum number of recycled blocks */
+    unsigned    refs; /**< Owner plus live blocks */
+    size_t      size; /**< Payload size class */
+    uint64_t    hits;
+    uint64_t    misses;
+};
+
+typedef struct
+{
+    block_t       self;
+    block_pool_t *pool;
+} block_pooled_t;
+
+static void block_pool_Destroy (block_pool_t *pool)
+{
+    assert (pool->free == NULL);
+    vlc_mutex_destroy (&pool->lock);
+    free (pool);
+}
+
+static void block_pool_Release (block_t *block)
+{
+    block_pooled_t *pb = (block_pooled_t *)block;
+    block_pool_t *pool = pb->pool;
+    bool destroy = false;
+
+    block_Invalidate (block);
+
+    vlc_mutex_lock (&pool->lock);
+    if (pool->count < pool->max)
+    {
+        block->p_next = pool->free;
+        pool->free = block;
+        pool->count++;
+        block = NULL;
+    }
+    else
+        destroy = --pool->refs == 0;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (block != NULL)
+        free (pb);
+    if (destroy)
+        block_pool_Destroy (pool);
+}
+
+/** Size of the allocation backing one pooled block. */
+static size_t block_pool_AllocSize (size_t size)
+{
+    return sizeof (block_pooled_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING) + size;
+}
+
+/**
+ * Creates a pool of blocks.
+ *
+ * @param size maximum payload size of pooled blocks (larger requests
+ *             fall back to block_Alloc())
+ * @param max maximum number of idle blocks kept for recycling
+ * @return a pool or NULL on error
+ */
+block_pool_t *block_PoolNew (size_t size, unsigned max)
+{
+    if (unlikely(block_pool_AllocSize (size) <= size))
+        return NULL;
+
+    block_pool_t *pool = malloc (sizeof (*pool));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    vlc_mutex_init (&pool->lock);
+    pool->free = NULL;
+    pool->count = 0;
+    pool->max = max;
+    pool->refs = 1;
+    pool->size = size;
+    pool->hits = 0;
+    pool->misses = 0;
+    return pool;
+}
+
+/**
+ * Releases a pool of blocks.
+ *
+ * Idle blocks are freed immediately. Blocks still in use remain valid, and
+ * are freed rather than recycled when released.
+ */
+void block_PoolDelete (block_pool_t *pool)
+{
+    vlc_mutex_lock (&pool->lock);
+    block_t *list = pool->free;
+    pool->free = NULL;
+    pool->refs -= pool->count;
+    pool->count = 0;
+    pool->max = 0;
+    bool destroy = --pool->refs == 0;
+    vlc_mutex_unlock (&pool->lock);
+
+    while (list != NULL)
+    {
+        block_t *next = list->p_next;
+        free (list);
+        list = next;
+    }
+
+    if (destroy)
+        block_pool_Destroy (pool);
+}
+
+/**
+ * Allocates a block from a pool.
+ *
+ * The block is recycled from the pool if possible. It is released with
+ * block_Release() as any other block, which returns it to its pool.
+ *
+ * @param size payload size (if it exceeds the pool size class, the block is
+ *             allocated with block_Alloc() and not recycled)
+ */
+block_t *block_PoolAlloc (block_pool_t *pool, size_t size)
+{
+    block_t *block;
+
+    vlc_mutex_lock (&pool->lock);
+    if (size > pool->size)
+    {
+        pool->misses++;
+        vlc_mutex_unlock (&pool->lock);
+        return block_Alloc (size);
+    }
+
+    block = pool->free;
+    if (block != NULL)
+    {
+        pool->free = block->p_next;
+        pool->count--;
+        pool->hits++;
+    }
+    else
+    {
+        pool->misses++;
+        pool->refs++;
+    }
+    vlc_mutex_unlock (&pool->lock);
+
+    block_pooled_t *pb = (block_pooled_t *)block;
+
+    if (block == NULL)
+    {
+        pb = malloc (block_pool_AllocSize (pool->size));
+        if (unlikely(pb == NULL))
+        {
+            vlc_mutex_lock (&pool->lock);
+            pool->refs--; /* cannot drop to zero: the owner holds a ref */
+            vlc_mutex_unlock (&pool->lock);
+            return NULL;
+        }
+        pb->pool = pool;
+        block = &pb->self;
+    }
+
+    block_Init (block, pb + 1, block_pool_AllocSize (pool->size)
+                               - sizeof (*pb));
+    block_Align (block, size);
+    block->pf_release = block_pool_Release;
+    return block;
+}
+
+/**
+ * Gets the pool usage counters.
+ *
+ * @param hits number of allocations served from recycled blocks [OUT]
+ * @param misses number of allocations served by the heap [OUT]
+ */
+void block_PoolGetStats (block_pool_t *pool, uint64_t *hits,
+                         uint64_t *misses)
+{
+    vlc_mutex_lock (&pool->lock);
+    *hits = pool->hits;
+    *misses = pool->misses;
+    vlc_mutex_unlock (&pool->lock);
+}
+
+/**
+ * @section Shared blocks.
+ *
+ * A shared block is a view of the payload of another block, so that several
+ * owners can hold the same payload without copying it. The payload is
+ * released with its last view. Views are read-only: the payload must be made
+ * private with block_Unshare() before it is modified in place, while
+ * block_Realloc() copies it whenever it would grow it.
+ */
+typedef struct
+{
+    atomic_uint refs; /**< Number of views */
+    block_t    *payload; /**< Block owning the payload */
+} block_share_t;
+
+typedef struct
+{
+    block_t        self;
+    block_share_t *share;
+} block_view_t;
+
+static void block_view_Release (block_t *block)
+{
+    block_share_t *share = ((block_view_t *)block)->share;
+
+    block_Invalidate (block);
+    free (block);
+
+    if (atomic_fetch_sub (&share->refs, 1) == 1)
+    {
+        block_Release (share->payload);
+        free (share);
+    }
+}
+
+static bool block_IsShared (const block_t *block)
+{
+    return block->pf_release == block_view_Release
+        && atomic_load (&((const block_view_t *)block)->share->refs) > 1;
+}
+
+static block_t *block_view_New (block_share_t *share, const block_t *from)
+{
+    block_view_t *view = malloc (sizeof (*view));
+    if (unlikely(view == NULL))
+        return NULL;
+
+    /* No head nor tail room: the views cannot grow in place */
+    block_t *block = &view->self;
+    block_Init (block, from->p_buffer, from->i_buffer);
+    BlockMetaCopy (block, from);
+    block->p_next = NULL;
+    block->pf_release = block_view_Release;
+    view->share = share;
+    return block;
+}
+
+/**
+ * Makes a block shareable.
+ *
+ * The block is replaced with a view of its payload, which block_Share() can
+ * then reference without copying. If the block already is a view, it is
+ * returned as is.
+ *
+ * @return the view, or NULL on error (the block is then released)
+ */
+block_t *block_Shareable (block_t *block)
+{
+    block_Check (block);
+
+    if (block->pf_release == block_view_Release)
+        return block;
+
+    block_share_t *share = malloc (sizeof (*share));
+    block_t *view = NULL;
+
+    if (likely(share != NULL))
+        view = block_view_New (share, block);
+    if (unlikely(view == NULL))
+    {
+        free (share);
+        block_Release (block);
+        return NULL;
+    }
+
+    atomic_init (&share->refs, 1);
+    share->payload = block;
+    view->p_next = block->p_next;
+    block->p_next = NULL;
+    return view;
+}
+
+/**
+ * Creates a new reference to the payload of a block.
+ *
+ * If the block was made shareable with block_Shareable(), the returned block
+ * is another view of the same payload, with copies of the block properties.
+ * Otherwise, the block is duplicated. Either way, the block is not consumed.
+ *
+ * @return a block with the same payload and properties, or NULL on error
+ */
+block_t *block_Share (block_t *block)
+{
+    block_Check (block);
+
+    if (block->pf_release != block_view_Release)
+        return block_Duplicate (block);
+
+    block_share_t *share = ((block_view_t *)block)->share;
+    block_t *view = block_view_New (share, block);
+    if (likely(view != NULL))
+        atomic_fetch_add (&share->refs, 1);
+    return view;
+}
+
+/**
+ * Creates a new reference to a part of the payload of a block.
+ *
+ * Like block_Share(), but the returned block only covers length bytes of the
+ * payload, from offset. Either way, the block is not consumed.
+ *
+ * @return a block with that part of the payload and the same properties, or
+ * NULL on error
+ */
+block_t *block_ShareRange (block_t *block, size_t offset, size_t length)
+{
+    block_Check (block);
+    assert (offset + length <= block->i_buffer);
+
+    if (block->pf_release != block_view_Release)
+    {
+        block_t *dup = block_Alloc (length);
+        if (likely(dup != NULL))
+        {
+            block_CopyProperties (dup, block);
+            memcpy (dup->p_buffer, block->p_buffer + offset, length);
+        }
+        return dup;
+    }
+
+    block_share_t *share = ((block_view_t *)block)->share;
+    block_t *view = block_view_New (share, block);
+    if (unlikely(view == NULL))
+        return NULL;
+
+    atomic_fetch_add (&share->refs, 1);
+    view->p_start = view->p_buffer += offset;
+    view->i_size = view->i_buffer = length;
+    return view;
+}
+
+/**
+ * Joins a chain of consecutive views of the same payload into one view.
+ *
+ * Nothing is copied: the first view is extended over the next ones, which
+ * are released. The chain is left untouched if it cannot be joined.
+ *
+ * @return the joined view, or NULL if the blocks of the chain are not views
+ * of the same payload that follow each other
+ */
+block_t *block_ChainJoin (block_t *list)
+{
+    if (list->pf_release != block_view_Release)
+        return NULL;
+
+    const block_share_t *share = ((block_view_t *)list)->share;
+    size_t total = list->i_buffer;
+    mtime_t length = list->i_length;
+
+    for (const block_t *prev = list, *b = list->p_next; b != NULL;
+         prev = b, b = b->p_next)
+    {
+        if (b->pf_release != block_view_Release
+         || ((const block_view_t *)b)->share != share
+         || b->p_buffer != prev->p_buffer + prev->i_buffer)
+            return NULL;
+        total += b->i_buffer;
+        length += b->i_length;
+    }
+
+    block_ChainRelease (list->p_next);
+    list->p_next = NULL;
+    list->i_size = list->p_buffer + total - list->p_start;
+    list->i_buffer = total;
+    list->i_length = length;
+    return list;
+}
+
+/**
+ * Makes the payload of a block private, so that it can be modified in place.
+ *
+ * The payload is copied if, and only if, it is shared with other views.
+ *
+ * @return a block with a private payload, or NULL on error (the block is then
+ * released)
+ */
+block_t *block_Unshare (block_t *block)
+{
+    block_Check (block);
+
+    if (!block_IsShared (block))
+        return block;
+
+    block_t *dup = block_Duplicate (block);
+    if (likely(dup != NULL))
+        dup->p_next = block->p_next;
+    block_Release (block);
+    return dup;
+}
+
 block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 {
     block_Check( p_block );
@@ -179,6 +590,21 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 
     size_t requested = i_prebody + i_body;
 
+    /* Shared payloads are read-only: grow into a private copy */
+    if( block_IsShared( p_block )
+     && ( i_prebody > 0 || i_body > p_block->i_buffer ) )
+    {
+        block_t *p_rea = block_Alloc( requested );
+        if( p_rea == NULL )
+            return NULL;
+
+        memcpy( p_rea->p_buffer + i_prebody, p_block->p_buffer,
+                p_block->i_buffer );
+        BlockMetaCopy( p_rea, p_block );
+        block_Release( p_block );
+        return p_rea;
+    }
+
     if( p_block->i_buffer == 0 )
     {   /* Corner case: nothing to preserve */
         if( requested <= p_block->i_size )
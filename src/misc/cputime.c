@@ -0,0 +1,291 @@
+/*****************************************************************************
+ * cputime.c: per-module CPU time statistics
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+#ifdef _WIN32
+# include <windows.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_modules.h>
+#include "libvlc.h"
+#include "../lib/libvlc_internal.h"
+
+/**
+ * \file
+ * CPU time spent in each module by the threads of a LibVLC instance. The
+ * counters are only allocated if the "cpu-stats" option is set; the call
+ * sites then only test the pointer.
+ *
+ * There is one entry per module, in a list that only grows: entries are
+ * looked up without locking, and their counters are relaxed atomics.
+ * The calls in progress on a thread are chained through a thread variable,
+ * so that the time of a nested call is only counted once as self time.
+ */
+
+struct vlc_cputime_entry
+{
+    struct vlc_cputime_entry *next;
+    const module_t *module;
+    atomic_uint_fast64_t calls;
+    atomic_uint_fast64_t self;
+    atomic_uint_fast64_t total;
+};
+
+struct vlc_cputime
+{
+    vlc_mutex_t lock; /* serializes insertions */
+    atomic_uintptr_t head;
+    vlc_threadvar_t frame;
+};
+
+/**
+ * Returns the CPU time consumed by the calling thread in nanoseconds, or
+ * the wall time if the system has no thread CPU clock.
+ */
+static uint64_t ThreadTime(void)
+{
+#if defined (_POSIX_THREAD_CPUTIME) && (_POSIX_THREAD_CPUTIME >= 0)
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+        return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+#elif defined (_WIN32) && !VLC_WINSTORE_APP
+    FILETIME creation, exit, kernel, user;
+
+    if (GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+    {
+        uint64_t t = ((uint64_t)kernel.dwHighDateTime << 32)
+                   + kernel.dwLowDateTime
+                   + ((uint64_t)user.dwHighDateTime << 32)
+                   + user.dwLowDateTime;
+        return t * 100; /* 100 ns units */
+    }
+#endif
+    return mdate() * (1000000000 / CLOCK_FREQ);
+}
+
+void vlc_CpuTimeInit(libvlc_int_t *vlc)
+{
+    libvlc_priv_t *priv = libvlc_priv(vlc);
+
+    priv->cputime = NULL;
+    if (!var_InheritBool(vlc, "cpu-stats"))
+        return;
+
+    struct vlc_cputime *cputime = malloc(sizeof (*cputime));
+    if (unlikely(cputime == NULL))
+        return;
+
+    if (vlc_threadvar_create(&cputime->frame, NULL))
+    {
+        free(cputime);
+        return;
+    }
+    vlc_mutex_init(&cputime->lock);
+    atomic_init(&cputime->head, 0);
+    priv->cputime = cputime;
+}
+
+/** Logs the modules using the most CPU time */
+static void Report(libvlc_int_t *vlc)
+{
+    vlc_module_cputime_t *tab;
+    ssize_t count = vlc_module_GetCpuTime(vlc, &tab);
+
+    if (count <= 0)
+        return;
+
+    uint64_t sum = 0;
+    for (ssize_t i = 0; i < count; i++)
+        sum += tab[i].i_self;
+
+    for (ssize_t i = 0; i < count && i < 10; i++)
+        msg_Dbg(vlc, "CPU time: %s (%s): %"PRIu64" ms (%.1f%%) in %"PRIu64
+                " calls, %"PRIu64" ms with callees",
+                module_get_object(tab[i].p_module),
+                module_get_capability(tab[i].p_module),
+                tab[i].i_self / 1000000,
+                sum ? 100. * tab[i].i_self / sum : 0.,
+                tab[i].i_calls, tab[i].i_total / 1000000);
+    free(tab);
+}
+
+void vlc_CpuTimeDeinit(libvlc_int_t *vlc)
+{
+    libvlc_priv_t *priv = libvlc_priv(vlc);
+    struct vlc_cputime *cputime = priv->cputime;
+
+    if (cputime == NULL)
+        return;
+
+    Report(vlc);
+
+    struct vlc_cputime_entry *entry =
+        (struct vlc_cputime_entry *)atomic_load(&cputime->head);
+    while (entry != NULL)
+    {
+        struct vlc_cputime_entry *next = entry->next;
+
+        free(entry);
+        entry = next;
+    }
+
+    vlc_mutex_destroy(&cputime->lock);
+    vlc_threadvar_delete(&cputime->frame);
+    free(cputime);
+    priv->cputime = NULL;
+}
+
+static struct vlc_cputime_entry *Lookup(struct vlc_cputime *cputime,
+                                        const module_t *module)
+{
+    struct vlc_cputime_entry *head, *entry;
+
+    head = (struct vlc_cputime_entry *)atomic_load(&cputime->head);
+    for (entry = head; entry != NULL; entry = entry->next)
+        if (entry->module == module)
+            return entry;
+
+    vlc_mutex_lock(&cputime->lock);
+    /* Check the entries inserted in the mean time */
+    for (entry = (struct vlc_cputime_entry *)atomic_load(&cputime->head);
+         entry != head; entry = entry->next)
+        if (entry->module == module)
+            break;
+
+    if (entry == head)
+    {
+        entry = malloc(sizeof (*entry));
+        if (likely(entry != NULL))
+        {
+            entry->module = module;
+            atomic_init(&entry->calls, 0);
+            atomic_init(&entry->self, 0);
+            atomic_init(&entry->total, 0);
+            entry->next = (struct vlc_cputime_entry *)atomic_load(&cputime->head);
+            atomic_store(&cputime->head, (uintptr_t)entry);
+        }
+    }
+    vlc_mutex_unlock(&cputime->lock);
+    return entry;
+}
+
+void vlc_CpuTimeEnter(vlc_object_t *obj, vlc_cputime_frame_t *frame)
+{
+    struct vlc_cputime *cputime = libvlc_priv(obj->p_libvlc)->cputime;
+
+    frame->parent = vlc_threadvar_get(cputime->frame);
+    frame->children = 0;
+    vlc_threadvar_set(cputime->frame, frame);
+    frame->start = ThreadTime();
+}
+
+void vlc_CpuTimeLeave(vlc_object_t *obj, vlc_cputime_frame_t *frame,
+                      const module_t *module)
+{
+    uint64_t total = ThreadTime() - frame->start;
+    struct vlc_cputime *cputime = libvlc_priv(obj->p_libvlc)->cputime;
+
+    assert(vlc_threadvar_get(cputime->frame) == frame);
+    vlc_threadvar_set(cputime->frame, frame->parent);
+    if (frame->parent != NULL)
+        frame->parent->children += total;
+
+    if (module == NULL)
+        return;
+
+    struct vlc_cputime_entry *entry = Lookup(cputime, module);
+    if (unlikely(entry == NULL))
+        return;
+
+    uint64_t self = (total > frame->children) ? total - frame->children : 0;
+
+    atomic_fetch_add_explicit(&entry->calls, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&entry->self, self, memory_order_relaxed);
+    atomic_fetch_add_explicit(&entry->total, total, memory_order_relaxed);
+}
+
+static int CompareSelf(const void *a, const void *b)
+{
+    const vlc_module_cputime_t *ta = a, *tb = b;
+
+    if (ta->i_self != tb->i_self)
+        return (ta->i_self < tb->i_self) ? 1 : -1;
+    return 0;
+}
+
+#undef vlc_module_GetCpuTime
+ssize_t vlc_module_GetCpuTime(vlc_object_t *obj, vlc_module_cputime_t **tabp)
+{
+    struct vlc_cputime *cputime = libvlc_priv(obj->p_libvlc)->cputime;
+
+    if (cputime == NULL)
+        return -1;
+
+    /* The list only grows at the head: count first, then copy as many */
+    struct vlc_cputime_entry *head =
+        (struct vlc_cputime_entry *)atomic_load(&cputime->head);
+    size_t count = 0;
+
+    for (struct vlc_cputime_entry *e = head; e != NULL; e = e->next)
+        count++;
+
+    vlc_module_cputime_t *tab = malloc((count ? count : 1) * sizeof (*tab));
+    if (unlikely(tab == NULL))
+        return -1;
+
+    size_t i = 0;
+    for (struct vlc_cputime_entry *e = head; e != NULL; e = e->next, i++)
+    {
+        tab[i].p_module = e->module;
+        tab[i].i_calls = atomic_load_explicit(&e->calls, memory_order_relaxed);
+        tab[i].i_self = atomic_load_explicit(&e->self, memory_order_relaxed);
+        tab[i].i_total = atomic_load_explicit(&e->total, memory_order_relaxed);
+    }
+
+    qsort(tab, count, sizeof (*tab), CompareSelf);
+    *tabp = tab;
+    return count;
+}
+
+void libvlc_InternalCpuTimeReset(libvlc_int_t *vlc)
+{
+    struct vlc_cputime *cputime = libvlc_priv(vlc)->cputime;
+
+    if (cputime == NULL)
+        return;
+
+    for (struct vlc_cputime_entry *e =
+             (struct vlc_cputime_entry *)atomic_load(&cputime->head);
+         e != NULL; e = e->next)
+    {
+        atomic_store_explicit(&e->calls, 0, memory_order_relaxed);
+        atomic_store_explicit(&e->self, 0, memory_order_relaxed);
+        atomic_store_explicit(&e->total, 0, memory_order_relaxed);
+    }
+}
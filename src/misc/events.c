@@ -37,6 +37,7 @@
 
 #include <vlc_events.h>
 #include <vlc_arrays.h>
+#include <vlc_atomic.h>
 
 /*****************************************************************************
  * Documentation : Read vlc_events.h
@@ -52,36 +53,53 @@ typedef struct vlc_event_listener_t
     vlc_event_callback_t pf_callback;
 } vlc_event_listener_t;
 
+/* Array of listeners. It is never modified once published, but for the
+ * callbacks of detached listeners, which are reset to NULL: vlc_event_send()
+ * holds a reference while it calls the listeners, without copying them nor
+ * holding the object lock, and vlc_event_attach() publishes a new array. */
+typedef struct vlc_event_listeners_t
+{
+    atomic_uint          refs;
+    int                  count;
+    vlc_event_listener_t items[];
+} vlc_event_listeners_t;
+
 typedef struct vlc_event_listeners_group_t
 {
-    vlc_event_type_t    event_type;
-    DECL_ARRAY(struct vlc_event_listener_t *) listeners;
-
-   /* Used in vlc_event_send() to make sure to behave
-      Correctly when vlc_event_detach was called during
-      a callback */
-    bool          b_sublistener_removed;
-                                         
+    vlc_event_type_t        event_type;
+    vlc_event_listeners_t * listeners; /* NULL if none */
 } vlc_event_listeners_group_t;
 
-static bool
-listeners_are_equal( vlc_event_listener_t * listener1,
-                     vlc_event_listener_t * listener2 )
+static vlc_event_listeners_t * listeners_new( int count )
 {
-    return listener1->pf_callback == listener2->pf_callback &&
-           listener1->p_user_data == listener2->p_user_data;
+    vlc_event_listeners_t * listeners;
+
+    listeners = malloc( sizeof(*listeners)
+                      + count * sizeof(listeners->items[0]) );
+    if( listeners )
+    {
+        atomic_init( &listeners->refs, 1 );
+        listeners->count = 0;
+    }
+    return listeners;
 }
 
-static bool
-group_contains_listener( vlc_event_listeners_group_t * group,
-                         vlc_event_listener_t * searched_listener )
+static void listeners_release( vlc_event_listeners_t * listeners )
 {
-    vlc_event_listener_t * listener;
-    FOREACH_ARRAY( listener, group->listeners )
-        if( listeners_are_equal(searched_listener, listener) )
-            return true;
+    if( listeners &&
+        atomic_fetch_sub( &listeners->refs, 1 ) == 1 )
+        free( listeners );
+}
+
+static vlc_event_listeners_group_t *
+group_find( vlc_event_manager_t * p_em, vlc_event_type_t event_type )
+{
+    vlc_event_listeners_group_t * listeners_group;
+    FOREACH_ARRAY( listeners_group, p_em->listeners_groups )
+        if( listeners_group->event_type == event_type )
+            return listeners_group;
     FOREACH_END()
-    return false;
+    return NULL;
 }
 
 /*****************************************************************************
@@ -117,16 +135,12 @@ int vlc_event_manager_init( vlc_event_manager_t * p_em, void * p_obj )
 void vlc_event_manager_fini( vlc_event_manager_t * p_em )
 {
     struct vlc_event_listeners_group_t * listeners_group;
-    struct vlc_event_listener_t * listener;
 
     vlc_mutex_destroy( &p_em->object_lock );
     vlc_mutex_destroy( &p_em->event_sending_lock );
 
     FOREACH_ARRAY( listeners_group, p_em->listeners_groups )
-        FOREACH_ARRAY( listener, listeners_group->listeners )
-            free( listener );
-        FOREACH_END()
-        ARRAY_RESET( listeners_group->listeners );
+        listeners_release( listeners_group->listeners );
         free( listeners_group );
     FOREACH_END()
     ARRAY_RESET( p_em->listeners_groups );
@@ -146,8 +160,8 @@ int vlc_event_manager_register_event_type(
         return VLC_ENOMEM;
 
     listeners_group->event_type = event_type;
-    ARRAY_INIT( listeners_group->listeners );
- 
+    listeners_group->listeners = NULL;
+
     vlc_mutex_lock( &p_em->object_lock );
     ARRAY_APPEND( p_em->listeners_groups, listeners_group );
     vlc_mutex_unlock( &p_em->object_lock );
@@ -161,85 +175,39 @@ int vlc_event_manager_register_event_type(
 void vlc_event_send( vlc_event_manager_t * p_em,
                      vlc_event_t * p_event )
 {
-    vlc_event_listeners_group_t * listeners_group = NULL;
-    vlc_event_listener_t * listener;
-    vlc_event_listener_t * array_of_cached_listeners = NULL;
-    vlc_event_listener_t * cached_listener;
-    int i, i_cached_listeners = 0;
+    vlc_event_listeners_group_t * listeners_group;
+    vlc_event_listeners_t * listeners = NULL;
 
     /* Fill event with the sending object now */
     p_event->p_obj = p_em->p_obj;
 
     vlc_mutex_lock( &p_em->event_sending_lock ) ;
-    vlc_mutex_lock( &p_em->object_lock );
-
-    FOREACH_ARRAY( listeners_group, p_em->listeners_groups )
-        if( listeners_group->event_type == p_event->type )
-        {
-            if( listeners_group->listeners.i_size <= 0 )
-                break;
-
-            /* Save the function to call */
-            i_cached_listeners = listeners_group->listeners.i_size;
-            array_of_cached_listeners = malloc(
-                    sizeof(vlc_event_listener_t)*i_cached_listeners );
-            if( !array_of_cached_listeners )
-            {
-                vlc_mutex_unlock( &p_em->object_lock );
-                vlc_mutex_unlock( &p_em->event_sending_lock ) ;
-                return;
-            }
-
-            cached_listener = array_of_cached_listeners;
-            FOREACH_ARRAY( listener, listeners_group->listeners )
-                memcpy( cached_listener, listener, sizeof(vlc_event_listener_t));
-                cached_listener++;
-            FOREACH_END()
-
-            break;
-        }
-    FOREACH_END()
-
-    /* Track item removed from *this* thread, with a simple flag. Indeed
-     * event_sending_lock is a recursive lock. This has the advantage of
-     * allowing to remove an event listener from within a callback */
-    listeners_group->b_sublistener_removed = false;
-
-    vlc_mutex_unlock( &p_em->object_lock );
 
-    /* Call the function attached */
-    cached_listener = array_of_cached_listeners;
-
-    if( !listeners_group || !array_of_cached_listeners )
+    vlc_mutex_lock( &p_em->object_lock );
+    listeners_group = group_find( p_em, p_event->type );
+    if( listeners_group && listeners_group->listeners )
     {
-        free( array_of_cached_listeners );
-        vlc_mutex_unlock( &p_em->event_sending_lock );
-        return;
+        listeners = listeners_group->listeners;
+        atomic_fetch_add( &listeners->refs, 1 );
     }
+    vlc_mutex_unlock( &p_em->object_lock );
 
-
-    for( i = 0; i < i_cached_listeners; i++ )
+    if( listeners )
     {
-        if( listeners_group->b_sublistener_removed )
+        /* A listener detached from a callback, i.e. from *this* thread as
+         * event_sending_lock is a recursive lock, has its callback reset:
+         * it is not called anymore. */
+        for( int i = 0; i < listeners->count; i++ )
         {
-            /* If a callback was removed inside one of our callback, this gets
-	     * called */
-            bool valid_listener;
-            vlc_mutex_lock( &p_em->object_lock );
-            valid_listener = group_contains_listener( listeners_group, cached_listener );
-            vlc_mutex_unlock( &p_em->object_lock );
-            if( !valid_listener )
-            {
-                cached_listener++;
-                continue;
-            }
+            vlc_event_listener_t * listener = &listeners->items[i];
+
+            if( listener->pf_callback )
+                listener->pf_callback( p_event, listener->p_user_data );
         }
-        cached_listener->pf_callback( p_event, cached_listener->p_user_data );
-        cached_listener++;
+        listeners_release( listeners );
     }
-    vlc_mutex_unlock( &p_em->event_sending_lock );
 
-    free( array_of_cached_listeners );
+    vlc_mutex_unlock( &p_em->event_sending_lock );
 }
 
 #undef vlc_event_attach
@@ -252,25 +220,33 @@ int vlc_event_attach( vlc_event_manager_t * p_em,
                       void *p_user_data )
 {
     vlc_event_listeners_group_t * listeners_group;
-    vlc_event_listener_t * listener;
-    listener = malloc(sizeof(vlc_event_listener_t));
-    if( !listener )
-        return VLC_ENOMEM;
- 
-    listener->p_user_data = p_user_data;
-    listener->pf_callback = pf_callback;
+    vlc_event_listeners_t * old, * listeners;
 
     vlc_mutex_lock( &p_em->object_lock );
-    FOREACH_ARRAY( listeners_group, p_em->listeners_groups )
-        if( listeners_group->event_type == event_type )
-        {
-            ARRAY_APPEND( listeners_group->listeners, listener );
-            vlc_mutex_unlock( &p_em->object_lock );
-            return VLC_SUCCESS;
-        }
-    FOREACH_END()
+    listeners_group = group_find( p_em, event_type );
     /* Unknown event = BUG */
-    vlc_assert_unreachable();
+    assert( listeners_group );
+
+    old = listeners_group->listeners;
+    listeners = listeners_new( (old ? old->count : 0) + 1 );
+    if( !listeners )
+    {
+        vlc_mutex_unlock( &p_em->object_lock );
+        return VLC_ENOMEM;
+    }
+
+    for( int i = 0; old && i < old->count; i++ )
+        if( old->items[i].pf_callback )
+            listeners->items[listeners->count++] = old->items[i];
+    listeners->items[listeners->count].p_user_data = p_user_data;
+    listeners->items[listeners->count].pf_callback = pf_callback;
+    listeners->count++;
+
+    listeners_group->listeners = listeners;
+    vlc_mutex_unlock( &p_em->object_lock );
+
+    listeners_release( old );
+    return VLC_SUCCESS;
 }
 
 /**
@@ -283,33 +259,47 @@ void vlc_event_detach( vlc_event_manager_t *p_em,
                        void *p_user_data )
 {
     vlc_event_listeners_group_t * listeners_group;
-    struct vlc_event_listener_t * listener;
+    vlc_event_listeners_t * old, * listeners;
 
     vlc_mutex_lock( &p_em->event_sending_lock );
     vlc_mutex_lock( &p_em->object_lock );
-    FOREACH_ARRAY( listeners_group, p_em->listeners_groups )
-        if( listeners_group->event_type == event_type )
+    listeners_group = group_find( p_em, event_type );
+    assert( listeners_group );
+
+    old = listeners_group->listeners;
+    for( int i = 0; old && i < old->count; i++ )
+    {
+        vlc_event_listener_t * listener = &old->items[i];
+
+        if( listener->pf_callback != pf_callback ||
+            listener->p_user_data != p_user_data )
+            continue;
+
+        /* that's our listener: vlc_event_send() may be in our caller
+         * stack, but in no other thread, as we hold event_sending_lock */
+        listener->pf_callback = NULL;
+
+        /* Publish the remaining listeners. If that fails, the array with
+         * the reset callback is kept, all the same. */
+        listeners = listeners_new( old->count - 1 );
+        if( listeners )
         {
-            FOREACH_ARRAY( listener, listeners_group->listeners )
-                if( listener->pf_callback == pf_callback &&
-                    listener->p_user_data == p_user_data )
-                {
-                    /* Tell vlc_event_send, we did remove an item from that group,
-                       in case vlc_event_send is in our caller stack  */
-                    listeners_group->b_sublistener_removed = true;
-
-                    /* that's our listener */
-                    ARRAY_REMOVE( listeners_group->listeners,
-                        fe_idx /* This comes from the macro (and that's why
-                                  I hate macro) */ );
-                    free( listener );
-                    vlc_mutex_unlock( &p_em->event_sending_lock );
-                    vlc_mutex_unlock( &p_em->object_lock );
-                    return;
-                }
-            FOREACH_END()
+            for( int j = 0; j < old->count; j++ )
+                if( old->items[j].pf_callback )
+                    listeners->items[listeners->count++] = old->items[j];
+            if( listeners->count == 0 )
+            {
+                listeners_release( listeners );
+                listeners = NULL;
+            }
+            listeners_group->listeners = listeners;
+            listeners_release( old );
         }
-    FOREACH_END()
+
+        vlc_mutex_unlock( &p_em->object_lock );
+        vlc_mutex_unlock( &p_em->event_sending_lock );
+        return;
+    }
 
     vlc_assert_unreachable();
 }
@@ -30,6 +30,7 @@
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include "libvlc.h"
 
 /**
@@ -48,8 +49,25 @@ struct block_fifo_t
     block_t             **pp_last;
     size_t              i_depth;
     size_t              i_size;
+
+    /* Single producer single consumer mode (see block_FifoNewSPSC()).
+     * Blocks go through the lock-less ring while possible, and spill over
+     * to the locked list above when the ring is full. */
+    struct
+    {
+        block_t       **ring; /**< NULL in normal mode */
+        atomic_size_t   head; /**< Next slot to dequeue (consumer) */
+        atomic_size_t   tail; /**< Next slot to enqueue (producer) */
+        atomic_size_t   overflow; /**< Blocks in the locked list */
+        atomic_size_t   depth;
+        atomic_size_t   size;
+        atomic_bool     waiting; /**< Consumer is parked */
+    } spsc;
 };
 
+/** Lock-less ring slots (must be a power of two) */
+#define FIFO_RING_SIZE 256
+
 /**
  * Locks a block FIFO. No more than one thread can lock the FIFO at any given
  * time, and no other thread can modify the FIFO while it is locked.
@@ -110,6 +128,18 @@ void vlc_fifo_WaitCond(vlc_fifo_t *fifo, vlc_cond_t *condvar)
     vlc_cond_wait(condvar, &fifo->lock);
 }
 
+/**
+ * Same as vlc_fifo_WaitCond(), with a deadline.
+ *
+ * @return 0 if signaled (or spuriously woken up), an error code if the
+ * deadline was reached.
+ */
+int vlc_fifo_TimedWaitCond(vlc_fifo_t *fifo, vlc_cond_t *condvar,
+                           mtime_t deadline)
+{
+    return vlc_cond_timedwait(condvar, &fifo->lock, deadline);
+}
+
 /**
  * Checks how many blocks are queued in a locked FIFO.
  *
@@ -158,6 +188,7 @@ size_t vlc_fifo_GetBytes(const vlc_fifo_t *fifo)
 void vlc_fifo_QueueUnlocked(block_fifo_t *fifo, block_t *block)
 {
     vlc_assert_locked(&fifo->lock);
+    assert(fifo->spsc.ring == NULL);
     assert(*(fifo->pp_last) == NULL);
 
     *(fifo->pp_last) = block;
@@ -187,6 +218,7 @@ void vlc_fifo_QueueUnlocked(block_fifo_t *fifo, block_t *block)
 block_t *vlc_fifo_DequeueUnlocked(block_fifo_t *fifo)
 {
     vlc_assert_locked(&fifo->lock);
+    assert(fifo->spsc.ring == NULL);
 
     block_t *block = fifo->p_first;
 
@@ -221,6 +253,7 @@ block_t *vlc_fifo_DequeueUnlocked(block_fifo_t *fifo)
 block_t *vlc_fifo_DequeueAllUnlocked(block_fifo_t *fifo)
 {
     vlc_assert_locked(&fifo->lock);
+    assert(fifo->spsc.ring == NULL);
 
     block_t *block = fifo->p_first;
 
@@ -249,16 +282,163 @@ block_fifo_t *block_FifoNew( void )
     p_fifo->p_first = NULL;
     p_fifo->pp_last = &p_fifo->p_first;
     p_fifo->i_depth = p_fifo->i_size = 0;
+    p_fifo->spsc.ring = NULL;
 
     return p_fifo;
 }
 
+/**
+ * Creates a block FIFO for one producer and one consumer thread.
+ *
+ * Blocks are passed through a lock-less ring buffer, and the consumer thread
+ * is only woken up if it is actually waiting. Only block_FifoPut() (producer),
+ * block_FifoGet(), block_FifoShow() and block_FifoEmpty() (consumer),
+ * block_FifoCount() and block_FifoSize() (either thread) can be used;
+ * the FIFO cannot be locked with vlc_fifo_Lock().
+ *
+ * @return the FIFO or NULL on memory error
+ */
+block_fifo_t *block_FifoNewSPSC( void )
+{
+    block_fifo_t *p_fifo = block_FifoNew();
+    if( !p_fifo )
+        return NULL;
+
+    p_fifo->spsc.ring = malloc( FIFO_RING_SIZE * sizeof (block_t *) );
+    if( !p_fifo->spsc.ring )
+    {
+        block_FifoRelease( p_fifo );
+        return NULL;
+    }
+    atomic_init( &p_fifo->spsc.head, 0 );
+    atomic_init( &p_fifo->spsc.tail, 0 );
+    atomic_init( &p_fifo->spsc.overflow, 0 );
+    atomic_init( &p_fifo->spsc.depth, 0 );
+    atomic_init( &p_fifo->spsc.size, 0 );
+    atomic_init( &p_fifo->spsc.waiting, false );
+    return p_fifo;
+}
+
+/* Producer side of a SPSC FIFO: queues a single block. */
+static void spsc_Push(block_fifo_t *fifo, block_t *block)
+{
+    /* Account first, so that the consumer never sees a negative depth. */
+    atomic_fetch_add(&fifo->spsc.size, block->i_buffer);
+    atomic_fetch_add(&fifo->spsc.depth, 1);
+
+    /* Only the producer sets a non-zero overflow count. Once the ring has
+     * overflowed, keep queuing to the list until the consumer drained it, so
+     * that ordering is preserved. */
+    if (atomic_load_explicit(&fifo->spsc.overflow, memory_order_relaxed) == 0)
+    {
+        size_t tail = atomic_load_explicit(&fifo->spsc.tail,
+                                           memory_order_relaxed);
+        size_t head = atomic_load_explicit(&fifo->spsc.head,
+                                           memory_order_acquire);
+
+        if (tail - head < FIFO_RING_SIZE)
+        {
+            fifo->spsc.ring[tail & (FIFO_RING_SIZE - 1)] = block;
+            atomic_store_explicit(&fifo->spsc.tail, tail + 1,
+                                  memory_order_release);
+            return;
+        }
+    }
+
+    vlc_mutex_lock(&fifo->lock);
+    *(fifo->pp_last) = block;
+    fifo->pp_last = &block->p_next;
+    fifo->i_depth++;
+    fifo->i_size += block->i_buffer;
+    atomic_store(&fifo->spsc.overflow, fifo->i_depth);
+    vlc_mutex_unlock(&fifo->lock);
+}
+
+/* Consumer side of a SPSC FIFO: dequeues a single block, if any. */
+static block_t *spsc_Pop(block_fifo_t *fifo, bool peek)
+{
+    block_t *block = NULL;
+    size_t head = atomic_load_explicit(&fifo->spsc.head, memory_order_relaxed);
+
+retry:
+    if (head != atomic_load_explicit(&fifo->spsc.tail, memory_order_acquire))
+    {
+        block = fifo->spsc.ring[head & (FIFO_RING_SIZE - 1)];
+        if (peek)
+            return block;
+        atomic_store_explicit(&fifo->spsc.head, head + 1,
+                              memory_order_release);
+    }
+    else if (atomic_load(&fifo->spsc.overflow) > 0)
+    {
+        vlc_mutex_lock(&fifo->lock);
+        /* Since the ring was seen empty, the producer may have filled it and
+         * then spilled over to the list. The ring blocks are then older.
+         * The producer queues to the list under the lock, after its last
+         * update of the ring tail: if the list is not empty, the ring is. */
+        if (head != atomic_load_explicit(&fifo->spsc.tail,
+                                         memory_order_acquire))
+        {
+            vlc_mutex_unlock(&fifo->lock);
+            goto retry;
+        }
+
+        block = fifo->p_first;
+        if (block != NULL && !peek)
+        {
+            fifo->p_first = block->p_next;
+            if (block->p_next == NULL)
+                fifo->pp_last = &fifo->p_first;
+            block->p_next = NULL;
+            fifo->i_depth--;
+            fifo->i_size -= block->i_buffer;
+            atomic_store(&fifo->spsc.overflow, fifo->i_depth);
+        }
+        vlc_mutex_unlock(&fifo->lock);
+    }
+
+    if (block != NULL && !peek)
+    {
+        atomic_fetch_sub(&fifo->spsc.depth, 1);
+        atomic_fetch_sub(&fifo->spsc.size, block->i_buffer);
+    }
+    return block;
+}
+
+static void spsc_Unpark(void *data)
+{
+    block_fifo_t *fifo = data;
+
+    atomic_store(&fifo->spsc.waiting, false);
+    vlc_mutex_unlock(&fifo->lock);
+}
+
+/* Consumer side of a SPSC FIFO: waits for a block to be queued. */
+static void spsc_Wait(block_fifo_t *fifo)
+{
+    vlc_mutex_lock(&fifo->lock);
+    atomic_store(&fifo->spsc.waiting, true);
+    vlc_cleanup_push(spsc_Unpark, fifo);
+    while (atomic_load(&fifo->spsc.depth) == 0)
+        vlc_cond_wait(&fifo->wait, &fifo->lock);
+    vlc_cleanup_pop();
+    spsc_Unpark(fifo);
+}
+
 /**
  * Destroys a FIFO created by block_FifoNew().
  * Any queued blocks are also destroyed.
  */
 void block_FifoRelease( block_fifo_t *p_fifo )
 {
+    if( p_fifo->spsc.ring != NULL )
+    {
+        block_t *b;
+
+        while( (b = spsc_Pop( p_fifo, false )) != NULL )
+            block_Release( b );
+        free( p_fifo->spsc.ring );
+    }
     block_ChainRelease( p_fifo->p_first );
     vlc_cond_destroy( &p_fifo->wait );
     vlc_mutex_destroy( &p_fifo->lock );
@@ -272,6 +452,13 @@ void block_FifoEmpty(block_fifo_t *fifo)
 {
     block_t *block;
 
+    if (fifo->spsc.ring != NULL)
+    {
+        while ((block = spsc_Pop(fifo, false)) != NULL)
+            block_Release(block);
+        return;
+    }
+
     vlc_fifo_Lock(fifo);
     block = vlc_fifo_DequeueAllUnlocked(fifo);
     vlc_fifo_Unlock(fifo);
@@ -285,6 +472,26 @@ void block_FifoEmpty(block_fifo_t *fifo)
  */
 void block_FifoPut(block_fifo_t *fifo, block_t *block)
 {
+    if (fifo->spsc.ring != NULL)
+    {
+        while (block != NULL)
+        {
+            block_t *next = block->p_next;
+
+            block->p_next = NULL;
+            spsc_Push(fifo, block);
+            block = next;
+        }
+
+        if (atomic_load(&fifo->spsc.waiting))
+        {
+            vlc_mutex_lock(&fifo->lock);
+            vlc_cond_signal(&fifo->wait);
+            vlc_mutex_unlock(&fifo->lock);
+        }
+        return;
+    }
+
     vlc_fifo_Lock(fifo);
     vlc_fifo_QueueUnlocked(fifo, block);
     vlc_fifo_Unlock(fifo);
@@ -302,6 +509,15 @@ block_t *block_FifoGet(block_fifo_t *fifo)
 
     vlc_testcancel();
 
+    if (fifo->spsc.ring != NULL)
+    {
+        while ((block = spsc_Pop(fifo, false)) == NULL)
+            if (atomic_load(&fifo->spsc.depth) == 0)
+                spsc_Wait(fifo);
+            /* else the producer is still queuing the block: retry */
+        return block;
+    }
+
     vlc_fifo_Lock(fifo);
     while (vlc_fifo_IsEmpty(fifo))
     {
@@ -330,6 +546,15 @@ block_t *block_FifoShow( block_fifo_t *p_fifo )
 {
     block_t *b;
 
+    if( p_fifo->spsc.ring != NULL )
+    {
+        do
+            b = spsc_Pop( p_fifo, true );
+        while( b == NULL && atomic_load( &p_fifo->spsc.depth ) > 0 );
+        assert(b != NULL);
+        return b;
+    }
+
     vlc_mutex_lock( &p_fifo->lock );
     assert(p_fifo->p_first != NULL);
     b = p_fifo->p_first;
@@ -343,6 +568,9 @@ size_t block_FifoSize (block_fifo_t *fifo)
 {
     size_t size;
 
+    if (fifo->spsc.ring != NULL)
+        return atomic_load (&fifo->spsc.size);
+
     vlc_mutex_lock (&fifo->lock);
     size = fifo->i_size;
     vlc_mutex_unlock (&fifo->lock);
@@ -354,6 +582,9 @@ size_t block_FifoCount (block_fifo_t *fifo)
 {
     size_t depth;
 
+    if (fifo->spsc.ring != NULL)
+        return atomic_load (&fifo->spsc.depth);
+
     vlc_mutex_lock (&fifo->lock);
     depth = fifo->i_depth;
     vlc_mutex_unlock (&fifo->lock);
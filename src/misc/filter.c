@@ -111,6 +111,152 @@ void filter_DeleteBlend( filter_t *p_blend )
     vlc_object_release( p_blend );
 }
 
+/* */
+#define SLICES_MAX_THREADS 16
+#define SLICE_MIN_LINES    32 /* below this, threading costs more than it saves */
+
+struct filter_slices_t
+{
+    vlc_mutex_t     lock;
+    vlc_cond_t      wait; /* slices to process, or exit */
+    vlc_cond_t      done; /* all slices processed */
+
+    filter_slice_cb cb;
+    void           *opaque;
+    unsigned        slices;
+    unsigned        next;
+    unsigned        pending;
+    bool            exit;
+
+    unsigned        count;
+    vlc_thread_t    threads[];
+};
+
+static void *SliceThread( void *data )
+{
+    filter_slices_t *p_slices = data;
+
+    vlc_mutex_lock( &p_slices->lock );
+    for( ;; )
+    {
+        while( !p_slices->exit && p_slices->next >= p_slices->slices )
+            vlc_cond_wait( &p_slices->wait, &p_slices->lock );
+        if( p_slices->exit )
+            break;
+
+        const unsigned i_slice = p_slices->next++;
+        const unsigned i_slices = p_slices->slices;
+        filter_slice_cb cb = p_slices->cb;
+        void *opaque = p_slices->opaque;
+        vlc_mutex_unlock( &p_slices->lock );
+
+        cb( opaque, i_slice, i_slices );
+
+        vlc_mutex_lock( &p_slices->lock );
+        if( --p_slices->pending == 0 )
+            vlc_cond_signal( &p_slices->done );
+    }
+    vlc_mutex_unlock( &p_slices->lock );
+    return NULL;
+}
+
+#undef filter_NewSlices
+filter_slices_t *filter_NewSlices( vlc_object_t *p_this, unsigned i_threads )
+{
+    if( i_threads == 0 )
+        i_threads = vlc_GetCPUCount();
+    if( i_threads > SLICES_MAX_THREADS )
+        i_threads = SLICES_MAX_THREADS;
+    /* The calling thread processes slices too */
+    const unsigned i_workers = i_threads > 1 ? i_threads - 1 : 0;
+
+    filter_slices_t *p_slices = malloc( sizeof(*p_slices)
+                                      + i_workers * sizeof(vlc_thread_t) );
+    if( unlikely(p_slices == NULL) )
+        return NULL;
+
+    vlc_mutex_init( &p_slices->lock );
+    vlc_cond_init( &p_slices->wait );
+    vlc_cond_init( &p_slices->done );
+    p_slices->cb = NULL;
+    p_slices->opaque = NULL;
+    p_slices->slices = 0;
+    p_slices->next = 0;
+    p_slices->pending = 0;
+    p_slices->exit = false;
+
+    for( p_slices->count = 0; p_slices->count < i_workers; p_slices->count++ )
+        if( vlc_clone( &p_slices->threads[p_slices->count], SliceThread,
+                       p_slices, VLC_THREAD_PRIORITY_VIDEO ) )
+            break; /* run with the threads that could be started */
+
+    msg_Dbg( p_this, "processing slices with %u thread(s)",
+             p_slices->count + 1 );
+    return p_slices;
+}
+
+void filter_RunSlices( filter_slices_t *p_slices, unsigned i_lines,
+                       filter_slice_cb cb, void *opaque )
+{
+    unsigned i_slices = p_slices->count + 1;
+    if( i_slices > i_lines / SLICE_MIN_LINES )
+        i_slices = i_lines / SLICE_MIN_LINES;
+    if( i_slices < 1 )
+        i_slices = 1;
+
+    filter_RunTasks( p_slices, i_slices, cb, opaque );
+}
+
+void filter_RunTasks( filter_slices_t *p_slices, unsigned i_slices,
+                      filter_slice_cb cb, void *opaque )
+{
+    if( p_slices->count == 0 || i_slices <= 1 )
+    {
+        for( unsigned i = 0; i < i_slices; i++ )
+            cb( opaque, i, i_slices );
+        return;
+    }
+
+    vlc_mutex_lock( &p_slices->lock );
+    p_slices->cb = cb;
+    p_slices->opaque = opaque;
+    p_slices->slices = i_slices;
+    p_slices->next = 0;
+    p_slices->pending = i_slices;
+    vlc_cond_broadcast( &p_slices->wait );
+
+    while( p_slices->next < i_slices )
+    {
+        const unsigned i_slice = p_slices->next++;
+        vlc_mutex_unlock( &p_slices->lock );
+
+        cb( opaque, i_slice, i_slices );
+
+        vlc_mutex_lock( &p_slices->lock );
+        p_slices->pending--;
+    }
+
+    while( p_slices->pending > 0 )
+        vlc_cond_wait( &p_slices->done, &p_slices->lock );
+    vlc_mutex_unlock( &p_slices->lock );
+}
+
+void filter_DeleteSlices( filter_slices_t *p_slices )
+{
+    vlc_mutex_lock( &p_slices->lock );
+    p_slices->exit = true;
+    vlc_cond_broadcast( &p_slices->wait );
+    vlc_mutex_unlock( &p_slices->lock );
+
+    for( unsigned i = 0; i < p_slices->count; i++ )
+        vlc_join( p_slices->threads[i], NULL );
+
+    vlc_cond_destroy( &p_slices->done );
+    vlc_cond_destroy( &p_slices->wait );
+    vlc_mutex_destroy( &p_slices->lock );
+    free( p_slices );
+}
+
 /* */
 #include <vlc_video_splitter.h>
 
@@ -371,7 +371,10 @@ static picture_t *FilterChainVideoFilter( chained_filter_t *f, picture_t *p_pic
     for( ; f != NULL; f = f->next )
     {
         filter_t *p_filter = &f->filter;
+        vlc_cputime_frame_t frame;
+        bool b_timed = vlc_CpuTimeStart( p_filter, &frame );
         p_pic = p_filter->pf_video_filter( p_filter, p_pic );
+        vlc_CpuTimeStop( p_filter, b_timed, &frame, p_filter->p_module );
         if( !p_pic )
             break;
         if( f->pending )
@@ -427,8 +430,11 @@ block_t *filter_chain_AudioFilter( filter_chain_t *p_chain, block_t *p_block )
     for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
     {
         filter_t *p_filter = &f->filter;
+        vlc_cputime_frame_t frame;
+        bool b_timed = vlc_CpuTimeStart( p_filter, &frame );
 
         p_block = p_filter->pf_audio_filter( p_filter, p_block );
+        vlc_CpuTimeStop( p_filter, b_timed, &frame, p_filter->p_module );
         if( !p_block )
             break;
     }
@@ -452,8 +458,11 @@ subpicture_t *filter_chain_SubFilter( filter_chain_t *p_chain, subpicture_t *p_s
     for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
     {
         filter_t *p_filter = &f->filter;
+        vlc_cputime_frame_t frame;
+        bool b_timed = vlc_CpuTimeStart( p_filter, &frame );
 
         p_subpic = p_filter->pf_sub_filter( p_filter, p_subpic );
+        vlc_CpuTimeStop( p_filter, b_timed, &frame, p_filter->p_module );
 
         if( !p_subpic )
             break;
@@ -36,8 +36,12 @@
 
 #include <errno.h>
 #include <limits.h>
+#include <string.h>
 
 #include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_interrupt.h>
+#include <vlc_memory.h>
 #include <vlc_codec.h>
 #include <vlc_meta.h>
 #include <vlc_filter.h>
@@ -498,6 +502,284 @@ static picture_t *ImageConvert( image_handler_t *p_image, picture_t *p_pic,
     return p_pif;
 }
 
+/**
+ * Asynchronous reading
+ *
+ */
+
+struct image_cache_entry
+{
+    struct image_cache_entry *p_next;
+    picture_t      *p_pic;
+    video_format_t  fmt;
+    size_t          i_size;
+    /* key */
+    vlc_fourcc_t    i_chroma;
+    unsigned        i_width;
+    unsigned        i_height;
+    char            psz_url[];
+};
+
+struct image_async_t
+{
+    vlc_object_t    *p_parent;
+    vlc_taskpool_t  *p_pool;
+    vlc_membudget_t *p_budget;
+
+    vlc_mutex_t      lock;
+    struct image_cache_entry *p_cache; /* most recently used first */
+    size_t           i_size;
+    size_t           i_max;
+    size_t           i_limit; /* i_max, or less if the budget is exceeded */
+};
+
+struct image_request_t
+{
+    image_async_t   *p_async;
+    vlc_taskgroup_t  group;
+    vlc_interrupt_t *p_interrupt;
+    atomic_bool      b_canceled;
+    image_async_cb   pf_done;
+    void            *p_opaque;
+    video_format_t   fmt_in;
+    video_format_t   fmt_out;
+    char             psz_url[];
+};
+
+static size_t PictureSize( const picture_t *p_pic )
+{
+    size_t i_size = 0;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        i_size += (size_t)p_pic->p[i].i_pitch * p_pic->p[i].i_lines;
+    return i_size;
+}
+
+/* The cache lock must be held. The usage is reported by the callers once
+ * the lock is released, as the budget may call back CacheShrink(). */
+static void CacheTrim( image_async_t *p_async, size_t i_limit )
+{
+    while( p_async->i_size > i_limit )
+    {
+        /* Evict the least recently used entry */
+        struct image_cache_entry **pp = &p_async->p_cache;
+        while( (*pp)->p_next != NULL )
+            pp = &(*pp)->p_next;
+
+        struct image_cache_entry *p_entry = *pp;
+        *pp = NULL;
+        p_async->i_size -= p_entry->i_size;
+        picture_Release( p_entry->p_pic );
+        free( p_entry );
+    }
+}
+
+static picture_t *CacheGet( image_async_t *p_async, const char *psz_url,
+                            const video_format_t *p_key,
+                            video_format_t *p_fmt )
+{
+    picture_t *p_pic = NULL;
+
+    vlc_mutex_lock( &p_async->lock );
+    for( struct image_cache_entry **pp = &p_async->p_cache; *pp != NULL;
+         pp = &(*pp)->p_next )
+    {
+        struct image_cache_entry *p_entry = *pp;
+
+        if( p_entry->i_chroma != p_key->i_chroma
+         || p_entry->i_width != p_key->i_width
+         || p_entry->i_height != p_key->i_height
+         || strcmp( p_entry->psz_url, psz_url ) )
+            continue;
+
+        /* Move to front */
+        *pp = p_entry->p_next;
+        p_entry->p_next = p_async->p_cache;
+        p_async->p_cache = p_entry;
+
+        p_pic = picture_Hold( p_entry->p_pic );
+        *p_fmt = p_entry->fmt;
+        break;
+    }
+    vlc_mutex_unlock( &p_async->lock );
+    return p_pic;
+}
+
+static void CachePut( image_async_t *p_async, const char *psz_url,
+                      const video_format_t *p_key, picture_t *p_pic,
+                      const video_format_t *p_fmt )
+{
+    size_t i_size = PictureSize( p_pic );
+    size_t i_len = strlen( psz_url ) + 1;
+
+    struct image_cache_entry *p_entry = malloc( sizeof (*p_entry) + i_len );
+    if( unlikely(p_entry == NULL) )
+        return;
+
+    p_entry->p_pic = picture_Hold( p_pic );
+    p_entry->fmt = *p_fmt;
+    p_entry->i_size = i_size;
+    p_entry->i_chroma = p_key->i_chroma;
+    p_entry->i_width = p_key->i_width;
+    p_entry->i_height = p_key->i_height;
+    memcpy( p_entry->psz_url, psz_url, i_len );
+
+    size_t i_usage;
+
+    vlc_mutex_lock( &p_async->lock );
+    if( i_size <= p_async->i_limit )
+    {
+        /* Another request may have cached the same picture concurrently:
+         * keep both, the older one will be evicted first. */
+        p_entry->p_next = p_async->p_cache;
+        p_async->p_cache = p_entry;
+        p_async->i_size += i_size;
+        CacheTrim( p_async, p_async->i_limit );
+        p_entry = NULL;
+    }
+    i_usage = p_async->i_size;
+    vlc_mutex_unlock( &p_async->lock );
+
+    vlc_membudget_Set( p_async->p_budget, i_usage );
+
+    if( p_entry != NULL )
+    {   /* larger than the whole cache */
+        picture_Release( p_entry->p_pic );
+        free( p_entry );
+    }
+}
+
+static void CacheShrink( void *opaque, size_t i_target )
+{
+    image_async_t *p_async = opaque;
+
+    vlc_mutex_lock( &p_async->lock );
+    p_async->i_limit = __MIN( i_target, p_async->i_max );
+    CacheTrim( p_async, p_async->i_limit );
+    size_t i_usage = p_async->i_size;
+    vlc_mutex_unlock( &p_async->lock );
+
+    vlc_membudget_Set( p_async->p_budget, i_usage );
+}
+
+#undef image_AsyncCreate
+image_async_t *image_AsyncCreate( vlc_object_t *p_parent, size_t i_cache )
+{
+    image_async_t *p_async = malloc( sizeof (*p_async) );
+    if( unlikely(p_async == NULL) )
+        return NULL;
+
+    p_async->p_pool = vlc_taskpool_hold_io();
+    if( p_async->p_pool == NULL )
+    {
+        free( p_async );
+        return NULL;
+    }
+
+    p_async->p_parent = p_parent;
+    vlc_mutex_init( &p_async->lock );
+    p_async->p_cache = NULL;
+    p_async->i_size = 0;
+    p_async->i_max = p_async->i_limit = i_cache;
+    p_async->p_budget = NULL;
+    if( i_cache > 0 )
+        p_async->p_budget = vlc_membudget_Register( "image cache",
+                                                    CacheShrink, p_async );
+    return p_async;
+}
+
+void image_AsyncDelete( image_async_t *p_async )
+{
+    vlc_membudget_Unregister( p_async->p_budget );
+    p_async->p_budget = NULL;
+    CacheTrim( p_async, 0 );
+    vlc_mutex_destroy( &p_async->lock );
+    vlc_taskpool_release( p_async->p_pool );
+    free( p_async );
+}
+
+static void AsyncRead( void *data )
+{
+    image_request_t *p_req = data;
+    image_async_t *p_async = p_req->p_async;
+    video_format_t fmt_in = p_req->fmt_in, fmt_out = p_req->fmt_out;
+    picture_t *p_pic;
+
+    if( atomic_load( &p_req->b_canceled ) )
+        return;
+
+    p_pic = CacheGet( p_async, p_req->psz_url, &p_req->fmt_out, &fmt_out );
+    if( p_pic == NULL )
+    {
+        /* Decoders and filters are not reentrant: use a handler per
+         * request, so that requests run in parallel. */
+        image_handler_t *p_image = image_HandlerCreate( p_async->p_parent );
+        if( p_image != NULL )
+        {
+            vlc_interrupt_t *p_old = vlc_interrupt_set( p_req->p_interrupt );
+            p_pic = ImageReadUrl( p_image, p_req->psz_url, &fmt_in, &fmt_out );
+            vlc_interrupt_set( p_old );
+            image_HandlerDelete( p_image );
+        }
+
+        if( p_pic != NULL && p_async->i_max > 0 )
+            CachePut( p_async, p_req->psz_url, &p_req->fmt_out, p_pic,
+                      &fmt_out );
+    }
+
+    if( !atomic_load( &p_req->b_canceled ) )
+        p_req->pf_done( p_req->p_opaque, p_pic, &fmt_out );
+    else if( p_pic != NULL )
+        picture_Release( p_pic );
+}
+
+image_request_t *image_AsyncReadUrl( image_async_t *p_async,
+                                     const char *psz_url,
+                                     const video_format_t *p_fmt_in,
+                                     const video_format_t *p_fmt_out,
+                                     image_async_cb pf_done, void *p_opaque )
+{
+    size_t i_len = strlen( psz_url ) + 1;
+    image_request_t *p_req = malloc( sizeof (*p_req) + i_len );
+    if( unlikely(p_req == NULL) )
+        return NULL;
+
+    p_req->p_interrupt = vlc_interrupt_create();
+    if( unlikely(p_req->p_interrupt == NULL) )
+    {
+        free( p_req );
+        return NULL;
+    }
+
+    p_req->p_async = p_async;
+    vlc_taskgroup_init( &p_req->group );
+    atomic_init( &p_req->b_canceled, false );
+    p_req->pf_done = pf_done;
+    p_req->p_opaque = p_opaque;
+    p_req->fmt_in = *p_fmt_in;
+    p_req->fmt_out = *p_fmt_out;
+    memcpy( p_req->psz_url, psz_url, i_len );
+
+    vlc_taskpool_submit( p_async->p_pool, &p_req->group, AsyncRead, p_req );
+    return p_req;
+}
+
+void image_AsyncCancel( image_request_t *p_req )
+{
+    atomic_store( &p_req->b_canceled, true );
+    vlc_interrupt_kill( p_req->p_interrupt );
+
+    /* Wait without running queued I/O on the calling thread, nor being
+     * interrupted, as the request is freed afterwards. */
+    vlc_interrupt_t *p_old = vlc_interrupt_set( NULL );
+    vlc_taskpool_wait_i11e( p_req->p_async->p_pool, &p_req->group );
+    vlc_interrupt_set( p_old );
+
+    vlc_taskgroup_destroy( &p_req->group );
+    vlc_interrupt_destroy( p_req->p_interrupt );
+    free( p_req );
+}
+
 /**
  * Misc functions
  *
@@ -0,0 +1,120 @@
+/*****************************************************************************
+ * latency.c: playback pipeline latency histograms
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include "libvlc.h"
+#include "../lib/libvlc_internal.h"
+
+/**
+ * \file
+ * Histograms of the time spent in each stage of the playback pipeline, for
+ * all the inputs and outputs of a LibVLC instance. They are only allocated
+ * if the "latency-stats" option is set; the recording sites then only test
+ * the pointer.
+ *
+ * The buckets are independent relaxed atomic counters, so that recording
+ * does not take any lock, and a histogram read while recording is not an
+ * exact snapshot.
+ */
+
+struct vlc_latency
+{
+    atomic_uint_fast64_t counts[VLC_LATENCY_MAX][VLC_LATENCY_BUCKETS];
+};
+
+void vlc_LatencyInit(libvlc_int_t *vlc)
+{
+    libvlc_priv_t *priv = libvlc_priv(vlc);
+
+    priv->latency = NULL;
+    if (!var_InheritBool(vlc, "latency-stats"))
+        return;
+
+    struct vlc_latency *latency = malloc(sizeof (*latency));
+    if (unlikely(latency == NULL))
+        return;
+
+    for (unsigned i = 0; i < VLC_LATENCY_MAX; i++)
+        for (unsigned j = 0; j < VLC_LATENCY_BUCKETS; j++)
+            atomic_init(&latency->counts[i][j], 0);
+    priv->latency = latency;
+}
+
+void vlc_LatencyDeinit(libvlc_int_t *vlc)
+{
+    libvlc_priv_t *priv = libvlc_priv(vlc);
+
+    free(priv->latency);
+    priv->latency = NULL;
+}
+
+void vlc_LatencyRecord(vlc_object_t *obj, unsigned stage, mtime_t duration)
+{
+    struct vlc_latency *latency = libvlc_priv(obj->p_libvlc)->latency;
+    unsigned bucket = 0;
+
+    assert(stage < VLC_LATENCY_MAX);
+    if (duration > 0)
+    {   /* Bucket N counts [2^(N-1), 2^N) microseconds */
+        if (duration >= (INT64_C(1) << (VLC_LATENCY_BUCKETS - 2)))
+            bucket = VLC_LATENCY_BUCKETS - 1;
+        else
+            bucket = (sizeof (unsigned) * 8) - clz(duration);
+    }
+    atomic_fetch_add_explicit(&latency->counts[stage][bucket], 1,
+                              memory_order_relaxed);
+}
+
+int libvlc_InternalLatency(libvlc_int_t *vlc, unsigned stage,
+                           uint64_t *counts, unsigned count)
+{
+    struct vlc_latency *latency = libvlc_priv(vlc)->latency;
+
+    if (latency == NULL || stage >= VLC_LATENCY_MAX)
+        return -1;
+    if (count > VLC_LATENCY_BUCKETS)
+        count = VLC_LATENCY_BUCKETS;
+
+    for (unsigned i = 0; i < count; i++)
+        counts[i] = atomic_load_explicit(&latency->counts[stage][i],
+                                         memory_order_relaxed);
+    return count;
+}
+
+void libvlc_InternalLatencyReset(libvlc_int_t *vlc)
+{
+    struct vlc_latency *latency = libvlc_priv(vlc)->latency;
+
+    if (latency == NULL)
+        return;
+
+    for (unsigned i = 0; i < VLC_LATENCY_MAX; i++)
+        for (unsigned j = 0; j < VLC_LATENCY_BUCKETS; j++)
+            atomic_store_explicit(&latency->counts[i][j], 0,
+                                  memory_order_relaxed);
+}
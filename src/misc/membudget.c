@@ -0,0 +1,232 @@
+/*****************************************************************************
+ * membudget.c: process-wide memory accounting and budget
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_memory.h>
+#include "libvlc.h"
+
+/**
+ * \file
+ * The usages are atomic counters, so that the clients update them
+ * without locking. The client list is only locked to register, unregister,
+ * read the usages, and to send shrink requests.
+ *
+ * The budget is shared by all the LibVLC instances of the process, since
+ * they compete for the same memory.
+ */
+
+struct vlc_membudget
+{
+    struct vlc_membudget *next;
+    vlc_membudget_shrink_cb shrink;
+    void *opaque;
+    atomic_size_t usage;
+    atomic_size_t peak;
+    size_t target; /* last requested usage, SIZE_MAX if none */
+    char name[VLC_MEMBUDGET_NAME_MAX];
+};
+
+/* Pressure is checked at most this often */
+#define MEMBUDGET_INTERVAL (CLOCK_FREQ / 10)
+
+static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+static struct vlc_membudget *clients = NULL;
+static mtime_t last_check = VLC_TS_INVALID;
+static atomic_bool constrained = ATOMIC_VAR_INIT(false);
+static atomic_size_t total = ATOMIC_VAR_INIT(0);
+static atomic_size_t limit = ATOMIC_VAR_INIT(0);
+
+void vlc_membudget_SetLimit(size_t max)
+{
+    atomic_store(&limit, max);
+}
+
+vlc_membudget_t *vlc_membudget_Register(const char *name,
+                                        vlc_membudget_shrink_cb shrink,
+                                        void *opaque)
+{
+    vlc_membudget_t *client = malloc(sizeof (*client));
+    if (unlikely(client == NULL))
+        return NULL;
+
+    client->shrink = shrink;
+    client->opaque = opaque;
+    atomic_init(&client->usage, 0);
+    atomic_init(&client->peak, 0);
+    client->target = SIZE_MAX;
+    strncpy(client->name, name, sizeof (client->name) - 1);
+    client->name[sizeof (client->name) - 1] = '\0';
+
+    vlc_mutex_lock(&lock);
+    client->next = clients;
+    clients = client;
+    vlc_mutex_unlock(&lock);
+    return client;
+}
+
+void vlc_membudget_Unregister(vlc_membudget_t *client)
+{
+    if (client == NULL)
+        return;
+
+    vlc_mutex_lock(&lock);
+    vlc_membudget_t **pp = &clients;
+    while (*pp != client)
+        pp = &(*pp)->next;
+    *pp = client->next;
+    vlc_mutex_unlock(&lock);
+
+    atomic_fetch_sub(&total, atomic_load(&client->usage));
+    free(client);
+}
+
+/**
+ * Sends shrink requests if the budget is exceeded, or lifts them once the
+ * usage is back well below the budget. The lock must be held.
+ */
+static void Balance(size_t max)
+{
+    size_t sum = atomic_load(&total);
+
+    if (sum > max)
+    {
+        /* Aim below the budget, so that requests are not sent again as soon
+         * as the clients grow back a little */
+        uint64_t excess = sum - max / 4 * 3;
+        uint64_t shrinkable = 0;
+
+        for (vlc_membudget_t *c = clients; c != NULL; c = c->next)
+            if (c->shrink != NULL)
+                shrinkable += atomic_load(&c->usage);
+        if (shrinkable == 0)
+            return;
+
+        for (vlc_membudget_t *c = clients; c != NULL; c = c->next)
+        {
+            if (c->shrink == NULL)
+                continue;
+
+            uint64_t usage = atomic_load(&c->usage);
+            uint64_t cut = (excess < shrinkable)
+                ? (excess * usage) / shrinkable : usage;
+            size_t target = usage - cut;
+
+            if (target < c->target)
+            {
+                c->target = target;
+                c->shrink(c->opaque, target);
+            }
+        }
+        atomic_store(&constrained, true);
+    }
+    else if (atomic_load(&constrained) && sum < max / 2)
+    {
+        for (vlc_membudget_t *c = clients; c != NULL; c = c->next)
+            if (c->target != SIZE_MAX)
+            {
+                c->target = SIZE_MAX;
+                c->shrink(c->opaque, SIZE_MAX);
+            }
+        atomic_store(&constrained, false);
+    }
+}
+
+void vlc_membudget_Set(vlc_membudget_t *client, size_t usage)
+{
+    if (client == NULL)
+        return;
+
+    size_t old = atomic_exchange(&client->usage, usage);
+    /* Unsigned wrap-around takes care of decreases */
+    size_t sum = atomic_fetch_add(&total, usage - old) + (usage - old);
+
+    size_t peak = atomic_load(&client->peak);
+    while (usage > peak
+        && !atomic_compare_exchange_weak(&client->peak, &peak, usage));
+
+    size_t max = atomic_load(&limit);
+    if (max == 0)
+        return;
+    if (sum <= max && (sum >= max / 2 || !atomic_load(&constrained)))
+        return;
+
+    /* Do not wait if another thread is already balancing */
+    if (vlc_mutex_trylock(&lock))
+        return;
+
+    mtime_t now = mdate();
+    if (last_check == VLC_TS_INVALID || now - last_check >= MEMBUDGET_INTERVAL)
+    {
+        last_check = now;
+        Balance(max);
+    }
+    vlc_mutex_unlock(&lock);
+}
+
+ssize_t vlc_membudget_GetUsage(vlc_membudget_usage_t **restrict tabp)
+{
+    vlc_membudget_usage_t *tab = NULL;
+    size_t count = 0;
+
+    vlc_mutex_lock(&lock);
+    for (vlc_membudget_t *c = clients; c != NULL; c = c->next)
+    {
+        size_t i;
+
+        for (i = 0; i < count; i++)
+            if (!strcmp(tab[i].psz_name, c->name))
+                break;
+
+        if (i == count)
+        {
+            vlc_membudget_usage_t *n = realloc(tab, (count + 1) * sizeof (*n));
+            if (unlikely(n == NULL))
+            {
+                vlc_mutex_unlock(&lock);
+                free(tab);
+                return -1;
+            }
+            tab = n;
+            strcpy(tab[i].psz_name, c->name);
+            tab[i].i_usage = 0;
+            tab[i].i_peak = 0;
+            tab[i].i_clients = 0;
+            count++;
+        }
+
+        tab[i].i_usage += atomic_load(&c->usage);
+        tab[i].i_peak += atomic_load(&c->peak);
+        tab[i].i_clients++;
+    }
+    vlc_mutex_unlock(&lock);
+
+    *tabp = tab;
+    return count;
+}
@@ -32,12 +32,142 @@
 # include "config.h"
 #endif
 #include <assert.h>
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include "picture.h"
 #include <vlc_image.h>
 #include <vlc_block.h>
 
+/** Alignment of the planes and of the pitches of the pictures in the heap.
+ * @note libavcodec AVX-512 optimizations require 64 bytes to render directly
+ * into the pictures. */
+#define PICTURE_ALIGN 64
+
+/** Pictures at least this big are mapped in huge pages, if possible, and
+ * their buffers are kept for other pictures of the same size when they are
+ * destroyed, across picture pools. */
+#define PICTURE_HUGE_SIZE (2 << 20)
+
+/** Maximum size of the kept picture buffers */
+#define PICTURE_CACHE_SIZE (256 << 20)
+
+struct picture_buffer
+{
+    struct picture_buffer *next;
+    size_t size;
+};
+
+static vlc_mutex_t buffer_lock = VLC_STATIC_MUTEX;
+static struct picture_buffer *buffer_cache = NULL;
+static size_t buffer_cached = 0;
+static atomic_bool buffer_hugetlb = ATOMIC_VAR_INIT(true);
+
+static void *BufferMap( size_t size )
+{
+#ifdef HAVE_MMAP
+    void *p;
+# ifdef MAP_HUGETLB
+    /* Explicit huge pages, if the administrator reserved some */
+    if( atomic_load_explicit( &buffer_hugetlb, memory_order_relaxed ) )
+    {
+        p = mmap( NULL, size, PROT_READ|PROT_WRITE,
+                  MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0 );
+        if( p != MAP_FAILED )
+            return p;
+        atomic_store_explicit( &buffer_hugetlb, false,
+                               memory_order_relaxed );
+    }
+# endif
+    p = mmap( NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS,
+              -1, 0 );
+    if( p == MAP_FAILED )
+        return NULL;
+# ifdef MADV_HUGEPAGE
+    /* Transparent huge pages otherwise */
+    madvise( p, size, MADV_HUGEPAGE );
+# endif
+    return p;
+#else
+    return vlc_memalign( PICTURE_ALIGN, size );
+#endif
+}
+
+static void BufferUnmap( void *p, size_t size )
+{
+#ifdef HAVE_MMAP
+    munmap( p, size );
+#else
+    (void) size;
+    vlc_free( p );
+#endif
+}
+
+/**
+ * Gets a buffer for a big picture, preferably a kept one.
+ * \param size size of the buffer, rounded up on return
+ */
+static void *BufferGet( size_t *size )
+{
+    *size = (*size + PICTURE_HUGE_SIZE - 1) & ~(size_t)(PICTURE_HUGE_SIZE - 1);
+
+    vlc_mutex_lock( &buffer_lock );
+    for( struct picture_buffer **pp = &buffer_cache; *pp != NULL;
+         pp = &(*pp)->next )
+    {
+        struct picture_buffer *buf = *pp;
+
+        if( buf->size == *size )
+        {
+            *pp = buf->next;
+            buffer_cached -= buf->size;
+            vlc_mutex_unlock( &buffer_lock );
+            return buf;
+        }
+    }
+    vlc_mutex_unlock( &buffer_lock );
+
+    return BufferMap( *size );
+}
+
+/**
+ * Keeps the buffer of a destroyed big picture, if there is room left.
+ */
+static void BufferPut( void *p, size_t size )
+{
+    struct picture_buffer *buf = p;
+
+    vlc_mutex_lock( &buffer_lock );
+    if( buffer_cached + size <= PICTURE_CACHE_SIZE )
+    {
+        buf->next = buffer_cache;
+        buf->size = size;
+        buffer_cache = buf;
+        buffer_cached += size;
+        buf = NULL;
+    }
+    vlc_mutex_unlock( &buffer_lock );
+
+    if( buf != NULL )
+        BufferUnmap( p, size );
+}
+
+void picture_BufferCacheFlush( void )
+{
+    vlc_mutex_lock( &buffer_lock );
+    while( buffer_cache != NULL )
+    {
+        struct picture_buffer *buf = buffer_cache;
+
+        buffer_cache = buf->next;
+        BufferUnmap( buf, buf->size );
+    }
+    buffer_cached = 0;
+    vlc_mutex_unlock( &buffer_lock );
+}
+
 /**
  * Allocate a new picture in the heap.
  *
@@ -62,7 +192,16 @@ static int AllocatePicture( picture_t *p_pic )
         i_bytes += p->i_pitch * p->i_lines;
     }
 
-    uint8_t *p_data = vlc_memalign( 16, i_bytes );
+    picture_priv_t *priv = (picture_priv_t *)p_pic;
+    uint8_t *p_data;
+
+    if( i_bytes >= PICTURE_HUGE_SIZE )
+    {   /* The size is needed to keep or unmap the buffer */
+        p_data = BufferGet( &i_bytes );
+        priv->gc.opaque = (void *)i_bytes;
+    }
+    else
+        p_data = vlc_memalign( PICTURE_ALIGN, i_bytes );
     if( i_bytes > 0 && p_data == NULL )
     {
         p_pic->i_planes = 0;
@@ -111,7 +250,12 @@ static void picture_DestroyFromResource( picture_t *p_picture )
  */
 static void picture_Destroy( picture_t *p_picture )
 {
-    vlc_free( p_picture->p[0].p_pixels );
+    picture_priv_t *priv = (picture_priv_t *)p_picture;
+
+    if( priv->gc.opaque != NULL )
+        BufferPut( p_picture->p[0].p_pixels, (size_t)priv->gc.opaque );
+    else
+        vlc_free( p_picture->p[0].p_pixels );
     free( p_picture );
 }
 
@@ -164,13 +308,15 @@ int picture_Setup( picture_t *p_picture, const video_format_t *restrict fmt )
         (V * p_dsc->p[i].w.i_num/p_dsc->p[i].w.i_den * p_dsc->i_pixel_size) % 16 == 0
        Which is respected if you have
        V % lcm( p_dsc->p[0..planes].w.i_den * 16) == 0
+       The width is aligned further, so that the pitches are multiples of
+       PICTURE_ALIGN, and so are the plane offsets.
     */
     int i_modulo_w = 1;
     int i_modulo_h = 1;
     unsigned int i_ratio_h  = 1;
     for( unsigned i = 0; i < p_dsc->plane_count; i++ )
     {
-        i_modulo_w = LCM( i_modulo_w, 16 * p_dsc->p[i].w.den );
+        i_modulo_w = LCM( i_modulo_w, PICTURE_ALIGN * p_dsc->p[i].w.den );
         i_modulo_h = LCM( i_modulo_h, 16 * p_dsc->p[i].h.den );
         if( i_ratio_h < p_dsc->p[i].h.den )
             i_ratio_h = p_dsc->p[i].h.den;
@@ -269,6 +415,52 @@ picture_t *picture_NewFromFormat( const video_format_t *p_fmt )
     return picture_NewFromResource( p_fmt, NULL );
 }
 
+/**
+ * Destroys a picture allocated by picture_NewView().
+ */
+static void picture_DestroyView( picture_t *p_view )
+{
+    picture_priv_t *priv = (picture_priv_t *)p_view;
+
+    picture_Release( priv->gc.opaque );
+    free( p_view );
+}
+
+picture_t *picture_NewView( picture_t *p_picture, const video_format_t *p_fmt,
+                            unsigned i_x, unsigned i_y )
+{
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( p_picture->format.i_chroma );
+    if( p_dsc == NULL || p_dsc->plane_count == 0 ||
+        p_fmt->i_chroma != p_picture->format.i_chroma )
+        return NULL;
+
+    picture_resource_t rsc = { .pf_destroy = picture_DestroyView };
+
+    for( int i = 0; i < p_picture->i_planes; i++ )
+    {
+        const plane_t *p = &p_picture->p[i];
+        const int i_px = i_x * p_dsc->p[i].w.num / p_dsc->p[i].w.den;
+        const int i_py = i_y * p_dsc->p[i].h.num / p_dsc->p[i].h.den;
+
+        if( i_py >= p->i_lines )
+            return NULL;
+        rsc.p[i].p_pixels = p->p_pixels + i_py * p->i_pitch
+                                        + i_px * p->i_pixel_pitch;
+        rsc.p[i].i_lines  = p->i_lines - i_py;
+        rsc.p[i].i_pitch  = p->i_pitch;
+    }
+
+    picture_t *p_view = picture_NewFromResource( p_fmt, &rsc );
+    if( unlikely(p_view == NULL) )
+        return NULL;
+
+    picture_priv_t *priv = (picture_priv_t *)p_view;
+    priv->gc.opaque = picture_Hold( p_picture );
+    picture_CopyProperties( p_view, p_picture );
+    return p_view;
+}
+
 picture_t *picture_New( vlc_fourcc_t i_chroma, int i_width, int i_height, int i_sar_num, int i_sar_den )
 {
     video_format_t fmt;
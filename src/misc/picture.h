@@ -31,3 +31,8 @@ typedef struct
         void *opaque;
     } gc;
 } picture_priv_t;
+
+/**
+ * Frees the buffers kept for big pictures.
+ */
+void picture_BufferCacheFlush(void);
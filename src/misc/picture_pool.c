@@ -34,17 +34,25 @@
 #include <vlc_atomic.h>
 #include "picture.h"
 
-static const uintptr_t pool_max = CHAR_BIT * sizeof (unsigned long long);
+struct picture_pool_slot {
+    picture_pool_t *pool;
+    picture_t      *picture;
+    picture_t      *clone; /**< Picture handed out, or NULL */
+    int             next; /**< Next free slot, or -1 */
+    bool            used;
+};
 
 struct picture_pool_t {
     int       (*pic_lock)(picture_t *);
     void      (*pic_unlock)(picture_t *);
     vlc_mutex_t lock;
+    vlc_cond_t  wait;
 
-    unsigned long long available;
+    int                available; /**< First free slot, or -1 */
+    unsigned           generation; /**< Incremented by picture_pool_Reset() */
     atomic_ushort      refs;
     unsigned short     picture_count;
-    picture_t  *picture[];
+    struct picture_pool_slot slot[];
 };
 
 static void picture_pool_Destroy(picture_pool_t *pool)
@@ -52,44 +60,56 @@ static void picture_pool_Destroy(picture_pool_t *pool)
     if (atomic_fetch_sub(&pool->refs, 1) != 1)
         return;
 
+    vlc_cond_destroy(&pool->wait);
     vlc_mutex_destroy(&pool->lock);
-    vlc_free(pool);
+    free(pool);
 }
 
 void picture_pool_Release(picture_pool_t *pool)
 {
     for (unsigned i = 0; i < pool->picture_count; i++)
-        picture_Release(pool->picture[i]);
+        picture_Release(pool->slot[i].picture);
     picture_pool_Destroy(pool);
 }
 
+/** Returns a slot to the free list (the pool lock must be held). */
+static void picture_pool_PushLocked(picture_pool_t *pool,
+                                    struct picture_pool_slot *slot)
+{
+    assert(slot->used);
+    slot->used = false;
+    slot->clone = NULL;
+    slot->next = pool->available;
+    pool->available = slot - pool->slot;
+}
+
 static void picture_pool_ReleasePicture(picture_t *clone)
 {
     picture_priv_t *priv = (picture_priv_t *)clone;
-    uintptr_t sys = (uintptr_t)priv->gc.opaque;
-    picture_pool_t *pool = (void *)(sys & ~(pool_max - 1));
-    unsigned offset = sys & (pool_max - 1);
-    picture_t *picture = pool->picture[offset];
-
-    free(clone);
+    struct picture_pool_slot *slot = priv->gc.opaque;
+    picture_pool_t *pool = slot->pool;
+    picture_t *picture = slot->picture;
 
     if (pool->pic_unlock != NULL)
         pool->pic_unlock(picture);
     picture_Release(picture);
 
     vlc_mutex_lock(&pool->lock);
-    assert(!(pool->available & (1ULL << offset)));
-    pool->available |= 1ULL << offset;
+    /* If picture_pool_Reset() reclaimed the slot, it is either free already
+     * or handed out as another picture. */
+    if (slot->clone == clone) {
+        picture_pool_PushLocked(pool, slot);
+        vlc_cond_signal(&pool->wait);
+    }
     vlc_mutex_unlock(&pool->lock);
 
+    free(clone);
     picture_pool_Destroy(pool);
 }
 
-static picture_t *picture_pool_ClonePicture(picture_pool_t *pool,
-                                            unsigned offset)
+static picture_t *picture_pool_ClonePicture(struct picture_pool_slot *slot)
 {
-    picture_t *picture = pool->picture[offset];
-    uintptr_t sys = ((uintptr_t)pool) + offset;
+    picture_t *picture = slot->picture;
     picture_resource_t res = {
         .p_sys = picture->p_sys,
         .pf_destroy = picture_pool_ReleasePicture,
@@ -103,30 +123,45 @@ static picture_t *picture_pool_ClonePicture(picture_pool_t *pool,
 
     picture_t *clone = picture_NewFromResource(&picture->format, &res);
     if (likely(clone != NULL)) {
-        ((picture_priv_t *)clone)->gc.opaque = (void *)sys;
+        ((picture_priv_t *)clone)->gc.opaque = slot;
         picture_Hold(picture);
     }
     return clone;
 }
 
+/** Marks all slots free, in increasing order (the pool lock must be held). */
+static void picture_pool_ResetLocked(picture_pool_t *pool)
+{
+    for (unsigned i = 0; i < pool->picture_count; i++) {
+        pool->slot[i].next = (i + 1 < pool->picture_count) ? (int)(i + 1) : -1;
+        pool->slot[i].used = false;
+        pool->slot[i].clone = NULL;
+    }
+    pool->available = pool->picture_count ? 0 : -1;
+}
+
 picture_pool_t *picture_pool_NewExtended(const picture_pool_configuration_t *cfg)
 {
-    if (unlikely(cfg->picture_count > pool_max))
+    if (unlikely(cfg->picture_count > USHRT_MAX))
         return NULL;
 
-    picture_pool_t *pool = vlc_memalign(pool_max,
-        sizeof (*pool) + cfg->picture_count * sizeof (picture_t *));
+    picture_pool_t *pool = malloc(sizeof (*pool)
+        + cfg->picture_count * sizeof (struct picture_pool_slot));
     if (unlikely(pool == NULL))
         return NULL;
 
     pool->pic_lock   = cfg->lock;
     pool->pic_unlock = cfg->unlock;
     vlc_mutex_init(&pool->lock);
-    pool->available = (1ULL << cfg->picture_count) - 1;
+    vlc_cond_init(&pool->wait);
     atomic_init(&pool->refs,  1);
     pool->picture_count = cfg->picture_count;
-    memcpy(pool->picture, cfg->picture,
-           cfg->picture_count * sizeof (picture_t *));
+    pool->generation = 0;
+    for (unsigned i = 0; i < cfg->picture_count; i++) {
+        pool->slot[i].pool = pool;
+        pool->slot[i].picture = cfg->picture[i];
+    }
+    picture_pool_ResetLocked(pool);
     return pool;
 }
 
@@ -187,52 +222,90 @@ error:
     return NULL;
 }
 
-/** Find next (bit) set */
-static int fnsll(unsigned long long x, unsigned i)
-{
-    if (i >= CHAR_BIT * sizeof (x))
-        return 0;
-    return ffsll(x & ~((1ULL << i) - 1));
-}
-
 picture_t *picture_pool_Get(picture_pool_t *pool)
 {
+    struct picture_pool_slot *failed = NULL; /* slots that failed to lock */
+    picture_t *clone = NULL;
+
     vlc_mutex_lock(&pool->lock);
     assert(pool->refs > 0);
 
-    for (unsigned i = ffsll(pool->available); i; i = fnsll(pool->available, i))
+    while (pool->available >= 0)
     {
-        pool->available &= ~(1ULL << (i - 1));
-        vlc_mutex_unlock(&pool->lock);
+        struct picture_pool_slot *slot = &pool->slot[pool->available];
+        unsigned generation = pool->generation;
 
-        picture_t *picture = pool->picture[i - 1];
+        assert(!slot->used);
+        pool->available = slot->next;
+        slot->used = true;
+        vlc_mutex_unlock(&pool->lock);
 
-        if (pool->pic_lock != NULL && pool->pic_lock(picture) != 0) {
+        if (pool->pic_lock != NULL && pool->pic_lock(slot->picture) != 0) {
             vlc_mutex_lock(&pool->lock);
-            pool->available |= 1ULL << (i - 1);
+            if (pool->generation != generation)
+                failed = NULL; /* reclaimed by picture_pool_Reset() */
+            else {
+                slot->next = (failed != NULL) ? failed - pool->slot : -1;
+                failed = slot;
+            }
             continue;
         }
 
-        picture_t *clone = picture_pool_ClonePicture(pool, i - 1);
+        clone = picture_pool_ClonePicture(slot);
         if (clone != NULL) {
             assert(clone->p_next == NULL);
             atomic_fetch_add(&pool->refs, 1);
-        }
-        return clone;
+        } else if (pool->pic_unlock != NULL)
+            pool->pic_unlock(slot->picture);
+
+        vlc_mutex_lock(&pool->lock);
+        if (pool->generation != generation)
+            failed = NULL; /* reclaimed: the clone is not tracked */
+        else if (clone != NULL)
+            slot->clone = clone;
+        else
+            picture_pool_PushLocked(pool, slot);
+        break;
     }
 
+    while (failed != NULL) {
+        struct picture_pool_slot *next =
+            (failed->next >= 0) ? &pool->slot[failed->next] : NULL;
+
+        picture_pool_PushLocked(pool, failed);
+        failed = next;
+    }
     vlc_mutex_unlock(&pool->lock);
-    return NULL;
+    return clone;
+}
+
+picture_t *picture_pool_Wait(picture_pool_t *pool)
+{
+    picture_t *picture;
+
+    while ((picture = picture_pool_Get(pool)) == NULL) {
+        vlc_mutex_lock(&pool->lock);
+        mutex_cleanup_push(&pool->lock);
+        while (pool->available < 0)
+            vlc_cond_wait(&pool->wait, &pool->lock);
+        vlc_cleanup_pop();
+        vlc_mutex_unlock(&pool->lock);
+    }
+    return picture;
 }
 
 unsigned picture_pool_Reset(picture_pool_t *pool)
 {
-    unsigned ret;
+    unsigned ret = 0;
 
     vlc_mutex_lock(&pool->lock);
     assert(pool->refs > 0);
-    ret = pool->picture_count - popcountll(pool->available);
-    pool->available = (1ULL << pool->picture_count) - 1;
+    for (unsigned i = 0; i < pool->picture_count; i++)
+        if (pool->slot[i].used)
+            ret++;
+    picture_pool_ResetLocked(pool);
+    pool->generation++;
+    vlc_cond_broadcast(&pool->wait);
     vlc_mutex_unlock(&pool->lock);
 
     return ret;
@@ -249,5 +322,5 @@ void picture_pool_Enum(picture_pool_t *pool, void (*cb)(void *, picture_t *),
     /* NOTE: So far, the pictures table cannot change after the pool is created
      * so there is no need to lock the pool mutex here. */
     for (unsigned i = 0; i < pool->picture_count; i++)
-        cb(opaque, pool->picture[i]);
+        cb(opaque, pool->slot[i].picture);
 }
@@ -29,6 +29,7 @@
 # include "config.h"
 #endif
 #include <assert.h>
+#include <limits.h>
 
 #include <vlc_common.h>
 #include <vlc_image.h>
@@ -53,6 +54,8 @@ subpicture_t *subpicture_New( const subpicture_updater_t *p_upd )
     p_subpic->b_subtitle = false;
     p_subpic->i_alpha    = 0xFF;
     p_subpic->p_region   = NULL;
+    p_subpic->i_dirty_width  = INT_MAX;
+    p_subpic->i_dirty_height = INT_MAX;
 
     if( p_upd )
     {
@@ -0,0 +1,473 @@
+/*****************************************************************************
+ * taskpool.c: work-stealing thread pool
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/** @ingroup taskpool */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_interrupt.h>
+#include "../libvlc.h"
+
+struct vlc_task
+{
+    struct vlc_task *prev;
+    struct vlc_task *next;
+    vlc_taskgroup_t *group;
+    void           (*func)(void *);
+    void            *data;
+};
+
+/* Each worker has its own deque: the owner pushes and pops at the head,
+ * the other threads queue and steal at the tail. */
+struct vlc_taskworker
+{
+    vlc_mutex_t      lock;
+    struct vlc_task *head;
+    struct vlc_task *tail;
+    vlc_taskpool_t  *pool;
+    vlc_thread_t     thread;
+};
+
+struct vlc_taskpool
+{
+    vlc_mutex_t     lock;
+    vlc_cond_t      wait; /* for idle workers */
+    unsigned        queued;
+    unsigned        next; /* worker for the next external task */
+    bool            exit;
+    unsigned        refs;
+    vlc_taskpool_t **instance;
+    vlc_threadvar_t self;
+    unsigned        count;
+    struct vlc_taskworker workers[];
+};
+
+static vlc_mutex_t pool_lock = VLC_STATIC_MUTEX;
+static vlc_taskpool_t *pool_instance = NULL;
+static vlc_taskpool_t *io_instance = NULL;
+
+/* Blocking tasks mostly wait, so the I/O pool does not depend on the CPUs */
+#define IO_THREADS 4
+
+static void PushHead(struct vlc_taskworker *w, struct vlc_task *task)
+{
+    vlc_mutex_lock(&w->lock);
+    task->prev = NULL;
+    task->next = w->head;
+    if (w->head != NULL)
+        w->head->prev = task;
+    else
+        w->tail = task;
+    w->head = task;
+    vlc_mutex_unlock(&w->lock);
+}
+
+static void PushTail(struct vlc_taskworker *w, struct vlc_task *task)
+{
+    vlc_mutex_lock(&w->lock);
+    task->next = NULL;
+    task->prev = w->tail;
+    if (w->tail != NULL)
+        w->tail->next = task;
+    else
+        w->head = task;
+    w->tail = task;
+    vlc_mutex_unlock(&w->lock);
+}
+
+static struct vlc_task *PopHead(struct vlc_taskworker *w)
+{
+    vlc_mutex_lock(&w->lock);
+    struct vlc_task *task = w->head;
+    if (task != NULL)
+    {
+        w->head = task->next;
+        if (w->head != NULL)
+            w->head->prev = NULL;
+        else
+            w->tail = NULL;
+    }
+    vlc_mutex_unlock(&w->lock);
+    return task;
+}
+
+static struct vlc_task *PopTail(struct vlc_taskworker *w)
+{
+    vlc_mutex_lock(&w->lock);
+    struct vlc_task *task = w->tail;
+    if (task != NULL)
+    {
+        w->tail = task->prev;
+        if (w->tail != NULL)
+            w->tail->next = NULL;
+        else
+            w->head = NULL;
+    }
+    vlc_mutex_unlock(&w->lock);
+    return task;
+}
+
+/**
+ * Returns the worker the calling thread is, or NULL if it is not one.
+ */
+static struct vlc_taskworker *Self(vlc_taskpool_t *pool)
+{
+    return vlc_threadvar_get(pool->self);
+}
+
+/**
+ * Dequeues a task: the latest one of the calling worker, if any, otherwise
+ * the oldest one of the other workers.
+ */
+static struct vlc_task *Take(vlc_taskpool_t *pool)
+{
+    struct vlc_taskworker *self = Self(pool);
+    struct vlc_task *task = NULL;
+    unsigned first = 0;
+
+    if (self != NULL)
+    {
+        task = PopHead(self);
+        first = self - pool->workers;
+    }
+
+    for (unsigned i = 0; task == NULL && i < pool->count; i++)
+    {
+        struct vlc_taskworker *w = pool->workers + (first + i) % pool->count;
+
+        if (w != self)
+            task = PopTail(w);
+    }
+
+    if (task != NULL)
+    {
+        vlc_mutex_lock(&pool->lock);
+        assert(pool->queued > 0);
+        pool->queued--;
+        vlc_mutex_unlock(&pool->lock);
+    }
+    return task;
+}
+
+static void Run(struct vlc_task *task)
+{
+    vlc_taskgroup_t *group = task->group;
+
+    task->func(task->data);
+    free(task);
+
+    vlc_mutex_lock(&group->lock);
+    assert(group->pending > 0);
+    if (--group->pending == 0)
+        vlc_sem_post(&group->done);
+    vlc_mutex_unlock(&group->lock);
+}
+
+static void *Thread(void *data)
+{
+    struct vlc_taskworker *self = data;
+    vlc_taskpool_t *pool = self->pool;
+
+    vlc_threadvar_set(pool->self, self);
+    vlc_savecancel();
+    vlc_thread_unbind(); /* shared by all inputs */
+
+    for (;;)
+    {
+        struct vlc_task *task = Take(pool);
+        if (task != NULL)
+        {
+            Run(task);
+            continue;
+        }
+
+        vlc_mutex_lock(&pool->lock);
+        while (pool->queued == 0 && !pool->exit)
+            vlc_cond_wait(&pool->wait, &pool->lock);
+        if (pool->queued == 0)
+        {   /* exiting, and nothing left to run */
+            vlc_mutex_unlock(&pool->lock);
+            break;
+        }
+        vlc_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+static void Destroy(vlc_taskpool_t *pool, unsigned threads)
+{
+    vlc_mutex_lock(&pool->lock);
+    pool->exit = true;
+    vlc_cond_broadcast(&pool->wait);
+    vlc_mutex_unlock(&pool->lock);
+
+    for (unsigned i = 0; i < threads; i++)
+        vlc_join(pool->workers[i].thread, NULL);
+    for (unsigned i = 0; i < pool->count; i++)
+    {
+        assert(pool->workers[i].head == NULL);
+        vlc_mutex_destroy(&pool->workers[i].lock);
+    }
+
+    vlc_threadvar_delete(&pool->self);
+    vlc_cond_destroy(&pool->wait);
+    vlc_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+static vlc_taskpool_t *Create(vlc_taskpool_t **instance, unsigned count)
+{
+    vlc_taskpool_t *pool = malloc(sizeof (*pool)
+                                  + count * sizeof (pool->workers[0]));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    if (vlc_threadvar_create(&pool->self, NULL))
+    {
+        free(pool);
+        return NULL;
+    }
+
+    vlc_mutex_init(&pool->lock);
+    vlc_cond_init(&pool->wait);
+    pool->queued = 0;
+    pool->next = 0;
+    pool->exit = false;
+    pool->refs = 1;
+    pool->instance = instance;
+    pool->count = count;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        struct vlc_taskworker *w = pool->workers + i;
+
+        vlc_mutex_init(&w->lock);
+        w->head = w->tail = NULL;
+        w->pool = pool;
+    }
+
+    for (unsigned i = 0; i < count; i++)
+        if (vlc_clone(&pool->workers[i].thread, Thread, pool->workers + i,
+                      VLC_THREAD_PRIORITY_LOW))
+        {
+            Destroy(pool, i);
+            return NULL;
+        }
+    return pool;
+}
+
+static vlc_taskpool_t *Hold(vlc_taskpool_t **instance, unsigned count)
+{
+    vlc_taskpool_t *pool;
+
+    vlc_mutex_lock(&pool_lock);
+    pool = *instance;
+    if (pool != NULL)
+        pool->refs++;
+    else
+        pool = *instance = Create(instance, count);
+    vlc_mutex_unlock(&pool_lock);
+    return pool;
+}
+
+vlc_taskpool_t *vlc_taskpool_hold(void)
+{
+    unsigned count = vlc_GetCPUCount();
+    if (count == 0)
+        count = 1;
+
+    return Hold(&pool_instance, count);
+}
+
+vlc_taskpool_t *vlc_taskpool_hold_io(void)
+{
+    return Hold(&io_instance, IO_THREADS);
+}
+
+void vlc_taskpool_release(vlc_taskpool_t *pool)
+{
+    vlc_mutex_lock(&pool_lock);
+    assert(pool == *pool->instance);
+    if (--pool->refs == 0)
+        *pool->instance = NULL;
+    else
+        pool = NULL;
+    vlc_mutex_unlock(&pool_lock);
+
+    if (pool != NULL)
+        Destroy(pool, pool->count);
+}
+
+unsigned vlc_taskpool_count(const vlc_taskpool_t *pool)
+{
+    return pool->count;
+}
+
+void vlc_taskgroup_init(vlc_taskgroup_t *group)
+{
+    vlc_mutex_init(&group->lock);
+    group->pending = 0;
+    vlc_sem_init(&group->done, 0);
+}
+
+void vlc_taskgroup_destroy(vlc_taskgroup_t *group)
+{
+    assert(group->pending == 0);
+    vlc_sem_destroy(&group->done);
+    vlc_mutex_destroy(&group->lock);
+}
+
+void vlc_taskpool_submit(vlc_taskpool_t *pool, vlc_taskgroup_t *group,
+                         void (*func)(void *), void *data)
+{
+    struct vlc_task *task = malloc(sizeof (*task));
+    if (unlikely(task == NULL))
+    {
+        func(data);
+        return;
+    }
+
+    task->group = group;
+    task->func = func;
+    task->data = data;
+
+    vlc_mutex_lock(&group->lock);
+    group->pending++;
+    vlc_mutex_unlock(&group->lock);
+
+    struct vlc_taskworker *self = Self(pool), *w = NULL;
+
+    /* Count the task before it can be taken */
+    vlc_mutex_lock(&pool->lock);
+    pool->queued++;
+    if (self == NULL) /* spread external tasks over the workers */
+        w = pool->workers + (pool->next++ % pool->count);
+    vlc_mutex_unlock(&pool->lock);
+
+    if (self != NULL)
+        PushHead(self, task);
+    else
+        PushTail(w, task);
+
+    vlc_mutex_lock(&pool->lock);
+    vlc_cond_signal(&pool->wait);
+    vlc_mutex_unlock(&pool->lock);
+}
+
+static bool Pending(vlc_taskgroup_t *group)
+{
+    vlc_mutex_lock(&group->lock);
+    bool pending = group->pending > 0;
+    vlc_mutex_unlock(&group->lock);
+    return pending;
+}
+
+void vlc_taskpool_wait(vlc_taskpool_t *pool, vlc_taskgroup_t *group)
+{
+    /* The semaphore is posted whenever the count drops to zero, including
+     * for earlier waits: only the count tells if the tasks are done. */
+    while (Pending(group))
+    {
+        struct vlc_task *task = Take(pool);
+        if (task != NULL)
+            Run(task);
+        else
+            vlc_sem_wait(&group->done);
+    }
+}
+
+int vlc_taskpool_wait_i11e(vlc_taskpool_t *pool, vlc_taskgroup_t *group)
+{
+    (void) pool;
+
+    while (Pending(group))
+        if (vlc_sem_wait_i11e(&group->done))
+            return EINTR;
+    return 0;
+}
+
+struct vlc_taskband
+{
+    void   (*func)(void *, unsigned, unsigned);
+    void    *data;
+    unsigned rows;
+    unsigned bands;
+};
+
+struct vlc_taskband_arg
+{
+    const struct vlc_taskband *band;
+    unsigned index;
+};
+
+static void RunBand(const struct vlc_taskband *band, unsigned index)
+{
+    unsigned first = (uint64_t)band->rows * index / band->bands;
+    unsigned last = (uint64_t)band->rows * (index + 1) / band->bands;
+
+    band->func(band->data, first, last);
+}
+
+static void BandTask(void *data)
+{
+    const struct vlc_taskband_arg *arg = data;
+
+    RunBand(arg->band, arg->index);
+}
+
+void vlc_taskpool_for(vlc_taskpool_t *pool, unsigned rows,
+                      void (*func)(void *, unsigned, unsigned), void *data)
+{
+    struct vlc_taskband band = {
+        .func = func,
+        .data = data,
+        .rows = rows,
+        .bands = pool->count + 1,
+    };
+
+    if (band.bands > rows)
+        band.bands = rows;
+    if (band.bands <= 1)
+    {
+        if (rows > 0)
+            func(data, 0, rows);
+        return;
+    }
+
+    struct vlc_taskband_arg args[band.bands - 1];
+    vlc_taskgroup_t group;
+
+    vlc_taskgroup_init(&group);
+    for (unsigned i = 1; i < band.bands; i++)
+    {
+        args[i - 1].band = &band;
+        args[i - 1].index = i;
+        vlc_taskpool_submit(pool, &group, BandTask, &args[i - 1]);
+    }
+    RunBand(&band, 0);
+    vlc_taskpool_wait(pool, &group);
+    vlc_taskgroup_destroy(&group);
+}
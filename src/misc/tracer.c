@@ -0,0 +1,354 @@
+/*****************************************************************************
+ * tracer.c: startup and playback timeline tracing
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_fs.h>
+#include "libvlc.h"
+
+/**
+ * \file
+ * Records timestamped events of a LibVLC instance (module bank loading,
+ * module probing, video output creation, first picture...), and writes them
+ * to the file given by the "trace-file" option when the instance is
+ * destroyed, in the Chrome trace event format (chrome://tracing).
+ *
+ * Hot path tracepoints (demux, decode, display and play calls) are binary
+ * records written without locking into a ring buffer owned by the calling
+ * thread. The rings are only read back when the instance is destroyed, once
+ * all the threads that could write to them have been joined.
+ */
+
+#define TRACE_RING_SIZE 4096 /* tracepoints kept per thread, power of two */
+
+struct vlc_trace_event
+{
+    char *name;
+    const char *cat;
+    mtime_t start;
+    mtime_t duration; /* or -1 for an instant event */
+    unsigned thread;
+};
+
+struct vlc_trace_point
+{
+    mtime_t start;
+    mtime_t duration; /* or -1 for an instant tracepoint */
+    int64_t value;
+    unsigned id;
+};
+
+struct vlc_trace_thread
+{
+    struct vlc_trace_thread *next;
+    unsigned id;
+    size_t head; /* total number of tracepoints written */
+    struct vlc_trace_point points[TRACE_RING_SIZE];
+};
+
+struct vlc_tracer
+{
+    char *path;
+    mtime_t origin;
+    vlc_mutex_t lock;
+    vlc_threadvar_t thread_key;
+    unsigned thread_count;
+    struct vlc_trace_thread *threads;
+    struct vlc_trace_event *events;
+    size_t count;
+    size_t size;
+};
+
+static const struct
+{
+    char name[16];
+    char cat[8];
+} tracepoints[VLC_TP_MAX] =
+{
+    [VLC_TP_INPUT_DEMUX]    = { "demux",          "input"   },
+    [VLC_TP_DECODER_DECODE] = { "decode",         "decoder" },
+    [VLC_TP_VOUT_DISPLAY]   = { "display",        "vout"    },
+    [VLC_TP_VOUT_LATE]      = { "late picture",   "vout"    },
+    [VLC_TP_AOUT_PLAY]      = { "play",           "aout"    },
+};
+
+/* The instance object is created before the options are parsed */
+void vlc_TraceInit(libvlc_int_t *vlc, mtime_t origin)
+{
+    libvlc_priv_t *priv = libvlc_priv(vlc);
+    char *path = var_InheritString(vlc, "trace-file");
+
+    priv->tracer = NULL;
+    priv->trace_mask = 0;
+    if (path == NULL)
+        return;
+
+    struct vlc_tracer *tracer = malloc(sizeof (*tracer));
+    if (unlikely(tracer == NULL)
+     || vlc_threadvar_create(&tracer->thread_key, NULL))
+    {
+        free(tracer);
+        free(path);
+        return;
+    }
+
+    tracer->path = path;
+    tracer->origin = origin;
+    vlc_mutex_init(&tracer->lock);
+    tracer->thread_count = 0;
+    tracer->threads = NULL;
+    tracer->events = NULL;
+    tracer->count = 0;
+    tracer->size = 0;
+    priv->tracer = tracer;
+    priv->trace_mask = var_InheritInteger(vlc, "trace-mask")
+                     & ((1u << VLC_TP_MAX) - 1);
+}
+
+static void TraceWriteString(FILE *stream, const char *str)
+{
+    fputc('"', stream);
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++)
+    {
+        if (*p == '"' || *p == '\\')
+            fprintf(stream, "\\%c", *p);
+        else if (*p < 0x20)
+            fprintf(stream, "\\u%04x", *p);
+        else
+            fputc(*p, stream);
+    }
+    fputc('"', stream);
+}
+
+static void TraceWriteTiming(FILE *stream, mtime_t start, mtime_t duration,
+                             mtime_t origin, char scope, unsigned pid,
+                             unsigned thread)
+{
+    fprintf(stream, ",\"ts\":%"PRId64, start - origin);
+    if (duration >= 0)
+        fprintf(stream, ",\"ph\":\"X\",\"dur\":%"PRId64, duration);
+    else
+        fprintf(stream, ",\"ph\":\"i\",\"s\":\"%c\"", scope);
+    fprintf(stream, ",\"pid\":%u,\"tid\":%u}", pid, thread);
+}
+
+static void TraceWrite(const struct vlc_tracer *tracer, FILE *stream)
+{
+    unsigned pid = getpid();
+    const char *sep = "\n";
+
+    fputs("{\"traceEvents\":[", stream);
+    for (size_t i = 0; i < tracer->count; i++)
+    {
+        const struct vlc_trace_event *ev = &tracer->events[i];
+
+        fprintf(stream, "%s{\"name\":", sep);
+        TraceWriteString(stream, ev->name);
+        fprintf(stream, ",\"cat\":\"%s\"", ev->cat);
+        TraceWriteTiming(stream, ev->start, ev->duration, tracer->origin,
+                         'p', pid, ev->thread);
+        sep = ",\n";
+    }
+
+    for (const struct vlc_trace_thread *th = tracer->threads;
+         th != NULL; th = th->next)
+    {
+        size_t i = (th->head > TRACE_RING_SIZE)
+                 ? (th->head - TRACE_RING_SIZE) : 0;
+
+        for (; i < th->head; i++)
+        {
+            const struct vlc_trace_point *tp =
+                &th->points[i & (TRACE_RING_SIZE - 1)];
+
+            fprintf(stream, "%s{\"name\":\"%s\",\"cat\":\"%s\","
+                    "\"args\":{\"value\":%"PRId64"}", sep,
+                    tracepoints[tp->id].name, tracepoints[tp->id].cat,
+                    tp->value);
+            TraceWriteTiming(stream, tp->start, tp->duration,
+                             tracer->origin, 't', pid, th->id);
+            sep = ",\n";
+        }
+    }
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", stream);
+}
+
+void vlc_TraceDeinit(libvlc_int_t *vlc)
+{
+    libvlc_priv_t *priv = libvlc_priv(vlc);
+    struct vlc_tracer *tracer = priv->tracer;
+
+    if (tracer == NULL)
+        return;
+    priv->tracer = NULL;
+    priv->trace_mask = 0;
+
+    FILE *stream = vlc_fopen(tracer->path, "wt");
+    if (stream != NULL)
+    {
+        TraceWrite(tracer, stream);
+
+        if (ferror(stream) | fclose(stream))
+            msg_Err(vlc, "cannot write trace file %s: %s", tracer->path,
+                    vlc_strerror_c(errno));
+        else
+            msg_Dbg(vlc, "trace written to %s (%zu events)", tracer->path,
+                    tracer->count);
+    }
+    else
+        msg_Err(vlc, "cannot create trace file %s: %s", tracer->path,
+                vlc_strerror_c(errno));
+
+    for (size_t i = 0; i < tracer->count; i++)
+        free(tracer->events[i].name);
+    free(tracer->events);
+    for (struct vlc_trace_thread *th = tracer->threads, *next;
+         th != NULL; th = next)
+    {
+        next = th->next;
+        free(th);
+    }
+    vlc_threadvar_delete(&tracer->thread_key);
+    vlc_mutex_destroy(&tracer->lock);
+    free(tracer->path);
+    free(tracer);
+}
+
+/* Gets the ring of the calling thread, creating it on first use */
+static struct vlc_trace_thread *TraceThread(struct vlc_tracer *tracer)
+{
+    struct vlc_trace_thread *th = vlc_threadvar_get(tracer->thread_key);
+    if (likely(th != NULL))
+        return th;
+
+    th = malloc(sizeof (*th));
+    if (unlikely(th == NULL))
+        return NULL;
+    th->head = 0;
+
+    vlc_mutex_lock(&tracer->lock);
+    /* Number the threads in order of appearance, for readability */
+    th->id = ++tracer->thread_count;
+    th->next = tracer->threads;
+    tracer->threads = th;
+    vlc_mutex_unlock(&tracer->lock);
+
+    vlc_threadvar_set(tracer->thread_key, th);
+    return th;
+}
+
+static void TraceAddV(vlc_object_t *obj, const char *cat, mtime_t start,
+                      mtime_t duration, const char *fmt, va_list ap)
+{
+    struct vlc_tracer *tracer = libvlc_priv(obj->p_libvlc)->tracer;
+    struct vlc_trace_thread *th = TraceThread(tracer);
+    char *name;
+
+    if (unlikely(th == NULL) || vasprintf(&name, fmt, ap) == -1)
+        return;
+
+    vlc_mutex_lock(&tracer->lock);
+    if (tracer->count == tracer->size)
+    {
+        size_t size = tracer->size ? (tracer->size * 2) : 256;
+        struct vlc_trace_event *tab = realloc(tracer->events,
+                                              size * sizeof (*tab));
+        if (unlikely(tab == NULL))
+        {
+            vlc_mutex_unlock(&tracer->lock);
+            free(name);
+            return;
+        }
+        tracer->events = tab;
+        tracer->size = size;
+    }
+
+    struct vlc_trace_event *ev = &tracer->events[tracer->count++];
+    ev->name = name;
+    ev->cat = cat;
+    ev->start = start;
+    ev->duration = duration;
+    ev->thread = th->id;
+    vlc_mutex_unlock(&tracer->lock);
+}
+
+#undef vlc_TraceSpan
+void vlc_TraceSpan(vlc_object_t *obj, const char *cat, mtime_t start,
+                   const char *fmt, ...)
+{
+    if (libvlc_priv(obj->p_libvlc)->tracer == NULL)
+        return;
+
+    mtime_t now = mdate();
+    va_list ap;
+
+    va_start(ap, fmt);
+    TraceAddV(obj, cat, start, now - start, fmt, ap);
+    va_end(ap);
+}
+
+#undef vlc_TraceEvent
+void vlc_TraceEvent(vlc_object_t *obj, const char *cat, const char *fmt, ...)
+{
+    if (libvlc_priv(obj->p_libvlc)->tracer == NULL)
+        return;
+
+    va_list ap;
+
+    va_start(ap, fmt);
+    TraceAddV(obj, cat, mdate(), -1, fmt, ap);
+    va_end(ap);
+}
+
+void vlc_TracePointAdd(vlc_object_t *obj, unsigned id, mtime_t start,
+                       int64_t value)
+{
+    struct vlc_tracer *tracer = libvlc_priv(obj->p_libvlc)->tracer;
+    struct vlc_trace_thread *th = TraceThread(tracer);
+
+    if (unlikely(th == NULL))
+        return;
+
+    struct vlc_trace_point *tp = &th->points[th->head & (TRACE_RING_SIZE - 1)];
+    mtime_t now = mdate();
+
+    if (start != VLC_TS_INVALID)
+    {
+        tp->start = start;
+        tp->duration = now - start;
+    }
+    else
+    {
+        tp->start = now;
+        tp->duration = -1;
+    }
+    tp->value = value;
+    tp->id = id;
+    th->head++;
+}
@@ -37,6 +37,7 @@
 #include <limits.h>
 
 #include <vlc_common.h>
+#include <vlc_atomic.h>
 #include <vlc_charset.h>
 #include "libvlc.h"
 #include "variables.h"
@@ -76,6 +77,8 @@ struct variable_t
 
     /** The variable's exported value */
     vlc_value_t  val;
+    /** Copy of the value that can be read without locking */
+    atomic_uint_least64_t fast_val;
 
     /** The variable display name, mainly for use by the interfaces */
     char *       psz_text;
@@ -162,6 +165,17 @@ static variable_t *Lookup( vlc_object_t *obj, const char *psz_name )
     return (pp_var != NULL) ? *pp_var : NULL;
 }
 
+/* Must be called with the lock held, whenever the value has changed */
+static void Publish( variable_t *p_var )
+{
+    uint64_t bits;
+
+    static_assert( sizeof (p_var->val) == sizeof (bits),
+                   "Unexpected vlc_value_t size" );
+    memcpy( &bits, &p_var->val, sizeof (bits) );
+    atomic_store_explicit( &p_var->fast_val, bits, memory_order_release );
+}
+
 static void Destroy( variable_t *p_var )
 {
     p_var->ops->pf_free( &p_var->val );
@@ -393,6 +407,9 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
         }
     }
 
+    atomic_init( &p_var->fast_val, 0 );
+    Publish( p_var );
+
     vlc_object_internals_t *p_priv = vlc_internals( p_this );
     variable_t **pp_var, *p_oldvar;
     int ret = VLC_SUCCESS;
@@ -684,6 +701,7 @@ int var_Change( vlc_object_t *p_this, const char *psz_name,
             break;
     }
 
+    Publish( p_var );
     vlc_mutex_unlock( &p_priv->var_lock );
 
     return ret;
@@ -751,6 +769,7 @@ int var_GetAndSet( vlc_object_t *p_this, const char *psz_name, int i_action,
 
     /*  Check boundaries */
     CheckValue( p_var, &p_var->val );
+    Publish( p_var );
     *p_val = p_var->val;
 
     /* Deal with callbacks.*/
@@ -789,26 +808,12 @@ int var_Type( vlc_object_t *p_this, const char *psz_name )
     return i_type;
 }
 
-#undef var_SetChecked
-int var_SetChecked( vlc_object_t *p_this, const char *psz_name,
-                    int expected_type, vlc_value_t val )
+/* Must be called with the lock held */
+static void SetLocked( vlc_object_t *p_this, variable_t *p_var,
+                       vlc_value_t val )
 {
-    variable_t *p_var;
     vlc_value_t oldval;
 
-    assert( p_this );
-
-    vlc_object_internals_t *p_priv = vlc_internals( p_this );
-
-    p_var = Lookup( p_this, psz_name );
-    if( p_var == NULL )
-    {
-        vlc_mutex_unlock( &p_priv->var_lock );
-        return VLC_ENOVAR;
-    }
-
-    assert( expected_type == 0 ||
-            (p_var->i_type & VLC_VAR_CLASS) == expected_type );
     assert ((p_var->i_type & VLC_VAR_CLASS) != VLC_VAR_VOID);
 
     WaitUnused( p_this, p_var );
@@ -824,12 +829,36 @@ int var_SetChecked( vlc_object_t *p_this, const char *psz_name,
 
     /* Set the variable */
     p_var->val = val;
+    Publish( p_var );
 
     /* Deal with callbacks */
-    TriggerCallback( p_this, p_var, psz_name, oldval );
+    TriggerCallback( p_this, p_var, p_var->psz_name, oldval );
 
     /* Free data if needed */
     p_var->ops->pf_free( &oldval );
+}
+
+#undef var_SetChecked
+int var_SetChecked( vlc_object_t *p_this, const char *psz_name,
+                    int expected_type, vlc_value_t val )
+{
+    variable_t *p_var;
+
+    assert( p_this );
+
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
+
+    p_var = Lookup( p_this, psz_name );
+    if( p_var == NULL )
+    {
+        vlc_mutex_unlock( &p_priv->var_lock );
+        return VLC_ENOVAR;
+    }
+
+    assert( expected_type == 0 ||
+            (p_var->i_type & VLC_VAR_CLASS) == expected_type );
+
+    SetLocked( p_this, p_var, val );
 
     vlc_mutex_unlock( &p_priv->var_lock );
     return VLC_SUCCESS;
@@ -892,6 +921,76 @@ int var_Get( vlc_object_t *p_this, const char *psz_name, vlc_value_t *p_val )
     return var_GetChecked( p_this, psz_name, 0, p_val );
 }
 
+#undef var_GetHandle
+/**
+ * Looks a variable up once, for repeated accesses
+ *
+ * The handle holds a reference to the variable, as var_Create() does, so
+ * that the variable remains valid until var_ReleaseHandle(), even if it is
+ * destroyed by its owner in the mean time. It must be released before the
+ * object that holds the variable is destroyed.
+ *
+ * \param p_this The object that holds the variable
+ * \param psz_name The name of the variable
+ * \return a variable handle, or NULL if the variable does not exist
+ */
+vlc_var_handle_t *var_GetHandle( vlc_object_t *p_this, const char *psz_name )
+{
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
+    variable_t *p_var = Lookup( p_this, psz_name );
+
+    if( p_var != NULL )
+        p_var->i_usage++;
+    vlc_mutex_unlock( &p_priv->var_lock );
+    return p_var;
+}
+
+#undef var_ReleaseHandle
+/**
+ * Releases a variable handle from var_GetHandle()
+ */
+void var_ReleaseHandle( vlc_object_t *p_this, vlc_var_handle_t *p_var )
+{
+    var_Destroy( p_this, p_var->psz_name );
+}
+
+/**
+ * Gets the value of a boolean, integer or float variable without locking
+ *
+ * The value is the last one that was set, as var_Get() would return it,
+ * but this does not wait for pending callbacks to complete.
+ */
+vlc_value_t var_HandleGet( vlc_var_handle_t *p_var )
+{
+    vlc_value_t val;
+    uint64_t bits;
+
+    assert( (p_var->i_type & VLC_VAR_CLASS) == VLC_VAR_BOOL
+         || (p_var->i_type & VLC_VAR_CLASS) == VLC_VAR_INTEGER
+         || (p_var->i_type & VLC_VAR_CLASS) == VLC_VAR_FLOAT );
+
+    bits = atomic_load_explicit( &p_var->fast_val, memory_order_acquire );
+    memcpy( &val, &bits, sizeof (val) );
+    return val;
+}
+
+#undef var_HandleSet
+/**
+ * Sets a variable's value through a handle, skipping the variable look-up
+ *
+ * This is otherwise the same as var_Set(), including callbacks.
+ */
+int var_HandleSet( vlc_object_t *p_this, vlc_var_handle_t *p_var,
+                   vlc_value_t val )
+{
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
+
+    vlc_mutex_lock( &p_priv->var_lock );
+    SetLocked( p_this, p_var, val );
+    vlc_mutex_unlock( &p_priv->var_lock );
+    return VLC_SUCCESS;
+}
+
 static int AddCallback( vlc_object_t *p_this, const char *psz_name,
                         callback_entry_t entry, vlc_callback_type_t i_type )
 {
@@ -41,6 +41,7 @@
 #include <vlc_plugin.h>
 #include <vlc_modules.h>
 #include <vlc_fs.h>
+#include <vlc_block.h>
 #include "libvlc.h"
 #include "config/configuration.h"
 #include "modules/modules.h"
@@ -50,7 +51,9 @@ static struct
     vlc_mutex_t lock;
     module_t *head;
     unsigned usage;
-} modules = { VLC_STATIC_MUTEX, NULL, 0 };
+    module_t **caps; /* modules sorted by capability, then score */
+    size_t caps_count;
+} modules = { VLC_STATIC_MUTEX, NULL, 0, NULL, 0 };
 
 /*****************************************************************************
  * Local prototypes
@@ -59,6 +62,7 @@ static struct
 static void AllocateAllPlugins (vlc_object_t *);
 #endif
 static module_t *module_InitStatic (vlc_plugin_cb);
+static void module_IndexCaps (void);
 
 static void module_StoreBank (module_t *module)
 {
@@ -143,6 +147,9 @@ void module_EndBank (bool b_plugins)
     if (--modules.usage == 0)
     {
         config_UnsortConfig ();
+        free (modules.caps);
+        modules.caps = NULL;
+        modules.caps_count = 0;
         head = modules.head;
         modules.head = NULL;
     }
@@ -185,6 +192,7 @@ size_t module_LoadPlugins (vlc_object_t *obj)
 #endif
         config_UnsortConfig ();
         config_SortConfig ();
+        module_IndexCaps ();
     }
     vlc_mutex_unlock (&modules.lock);
 
@@ -247,6 +255,69 @@ static int modulecmp (const void *a, const void *b)
     return (*mb)->i_score - (*ma)->i_score;
 }
 
+struct module_pos
+{
+    module_t *module;
+    size_t pos; /* in the bank */
+};
+
+static int modulecapcmp (const void *a, const void *b)
+{
+    const struct module_pos *ma = a, *mb = b;
+    int ret = strcmp (module_get_capability (ma->module),
+                      module_get_capability (mb->module));
+    if (ret == 0) /* preserve the bank order within a capability */
+        ret = (ma->pos > mb->pos) - (ma->pos < mb->pos);
+    return ret;
+}
+
+/**
+ * Indexes the modules by capability, so that module_need() does not need
+ * to go through the whole bank for every lookup.
+ * The index is rebuilt once all plug-ins are loaded, and is then read-only.
+ */
+static void module_IndexCaps (void)
+{
+    size_t n;
+    module_t **list = module_list_get (&n);
+
+    free (modules.caps);
+    modules.caps = NULL;
+    modules.caps_count = 0;
+
+    struct module_pos *tab = malloc (n * sizeof (*tab));
+    if (unlikely(tab == NULL))
+    {
+        module_list_free (list);
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        tab[i].module = list[i];
+        tab[i].pos = i;
+    }
+    qsort (tab, n, sizeof (*tab), modulecapcmp);
+
+    for (size_t i = 0; i < n; i++)
+        list[i] = tab[i].module;
+    free (tab);
+
+    /* Sort each capability by score, in the same way as module_list_cap() */
+    for (size_t i = 0, j; i < n; i = j)
+    {
+        const char *cap = module_get_capability (list[i]);
+
+        for (j = i + 1; j < n; j++)
+            if (!module_provides (list[j], cap))
+                break;
+        qsort (list + i, j - i, sizeof (*list), modulecmp);
+    }
+
+    modules.caps = list;
+    modules.caps_count = n;
+}
+
 /**
  * Builds a sorted list of all VLC modules with a given capability.
  * The list is sorted from the highest module score to the lowest.
@@ -257,11 +328,38 @@ static int modulecmp (const void *a, const void *b)
  */
 ssize_t module_list_cap (module_t ***restrict list, const char *cap)
 {
-    /* TODO: This is quite inefficient. List should be sorted by capability. */
     ssize_t n = 0;
 
     assert (list != NULL);
 
+    if (modules.caps != NULL)
+    {   /* Look for the first module with the capability in the index */
+        size_t lo = 0, hi = modules.caps_count;
+
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+
+            if (strcmp (module_get_capability (modules.caps[mid]), cap) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        while (lo + n < modules.caps_count
+            && module_provides (modules.caps[lo + n], cap))
+            n++;
+
+        module_t **tab = malloc (sizeof (*tab) * n);
+        *list = tab;
+        if (unlikely(tab == NULL))
+            return -1;
+        if (n > 0)
+            memcpy (tab, modules.caps + lo, sizeof (*tab) * n);
+        return n;
+    }
+
+    /* Plug-ins are not loaded yet: go through the whole bank */
     for (module_t *mod = modules.head; mod != NULL; mod = mod->next)
     {
          if (module_provides (mod, cap))
@@ -373,12 +471,13 @@ static void AllocatePluginPath (vlc_object_t *p_this, const char *path,
 {
     module_bank_t bank;
     module_cache_t *cache = NULL;
+    block_t *cachefile = NULL;
     size_t count = 0;
 
     switch( mode )
     {
         case CACHE_USE:
-            count = CacheLoad( p_this, path, &cache );
+            count = CacheLoad( p_this, path, &cache, &cachefile );
             break;
         case CACHE_RESET:
             CacheDelete( p_this, path );
@@ -411,6 +510,8 @@ static void AllocatePluginPath (vlc_object_t *p_this, const char *path,
                 free (cache[i].path);
             }
             free( cache );
+            if (cachefile != NULL)
+                block_Release (cachefile);
             for (size_t i = 0; i < bank.i_cache; i++)
                 free (bank.cache[i].path);
             free (bank.cache);
@@ -542,19 +643,8 @@ static int AllocatePluginFile (module_bank_t *bank, const char *abspath,
         module->b_loaded = false;
     }
 
-    /* For now we force loading if the module's config contains callbacks.
-     * Could be optimized by adding an API call.*/
-    for (size_t n = module->confsize, i = 0; i < n; i++)
-         if (module->p_config[i].list_count == 0
-          && (module->p_config[i].list.psz_cb != NULL || module->p_config[i].list.i_cb != NULL))
-         {
-             /* !unloadable not allowed for plugins with callbacks */
-             vlc_module_destroy (module);
-             module = module_InitDynamic (bank->obj, abspath, false);
-             if (unlikely(module == NULL))
-                 return -1;
-             break;
-         }
+    /* Configuration choices callbacks are not usable until the plug-in is
+     * mapped again, see module_MapConfig(). */
 
     module_StoreBank (module);
 
@@ -672,3 +762,16 @@ int module_Map (vlc_object_t *obj, module_t *module)
     vlc_mutex_unlock(&lock);
     return -(module == NULL);
 }
+
+/**
+ * Makes sure the module owning a configuration item is loaded in memory,
+ * so that the item callbacks can be called.
+ * \return 0 on success, -1 on failure
+ */
+int module_MapConfig (vlc_object_t *obj, const module_config_t *item)
+{
+    for (module_t *mod = modules.head; mod != NULL; mod = mod->next)
+        if (item >= mod->p_config && item < mod->p_config + mod->confsize)
+            return module_Map (obj, mod);
+    return -1;
+}
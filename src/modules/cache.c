@@ -40,6 +40,7 @@
 #include "libvlc.h"
 
 #include <vlc_plugin.h>
+#include <vlc_block.h>
 #include <errno.h>
 
 #include "config/configuration.h"
@@ -55,7 +56,7 @@
 #ifdef HAVE_DYNAMIC_PLUGINS
 /* Sub-version number
  * (only used to avoid breakage in dev version when cache structure changes) */
-#define CACHE_SUBVERSION_NUM 23
+#define CACHE_SUBVERSION_NUM 24
 
 /* Cache filename */
 #define CACHE_NAME "plugins.dat"
@@ -76,8 +77,18 @@ void CacheDelete( vlc_object_t *obj, const char *dir )
     free( path );
 }
 
+static int CacheLoadData (void *buf, size_t size, block_t *file)
+{
+    if (file->i_buffer < size)
+        return -1;
+    memcpy (buf, file->p_buffer, size);
+    file->p_buffer += size;
+    file->i_buffer -= size;
+    return 0;
+}
+
 #define LOAD_IMMEDIATE(a) \
-    if (fread (&(a), sizeof (char), sizeof (a), file) != sizeof (a)) \
+    if (CacheLoadData (&(a), sizeof (a), file)) \
         goto error
 #define LOAD_FLAG(a) \
     do { \
@@ -88,7 +99,7 @@ void CacheDelete( vlc_object_t *obj, const char *dir )
         (a) = b; \
     } while (0)
 
-static int CacheLoadString (char **p, FILE *file)
+static int CacheLoadString (char **p, block_t *file)
 {
     char *psz = NULL;
     uint16_t size;
@@ -102,15 +113,13 @@ error:
 
     if (size > 0)
     {
-        psz = malloc (size+1);
-        if (unlikely(psz == NULL))
+        if (file->i_buffer < size)
             goto error;
-        if (fread (psz, 1, size, file) != size)
-        {
-            free (psz);
+        psz = strndup ((const char *)file->p_buffer, size);
+        if (unlikely(psz == NULL))
             goto error;
-        }
-        psz[size] = '\0';
+        file->p_buffer += size;
+        file->i_buffer -= size;
     }
     *p = psz;
     return 0;
@@ -119,7 +128,7 @@ error:
 #define LOAD_STRING(a) \
     if (CacheLoadString (&(a), file)) goto error
 
-static int CacheLoadConfig (module_config_t *cfg, FILE *file)
+static int CacheLoadConfig (module_config_t *cfg, block_t *file)
 {
     LOAD_IMMEDIATE (cfg->i_type);
     LOAD_IMMEDIATE (cfg->i_short);
@@ -182,7 +191,7 @@ error:
     return -1; /* FIXME: leaks */
 }
 
-static int CacheLoadModuleConfig (module_t *module, FILE *file)
+static int CacheLoadModuleConfig (module_t *module, block_t *file)
 {
     uint16_t lines;
 
@@ -214,7 +223,7 @@ error:
     return -1; /* FIXME: leaks */
 }
 
-static module_t *CacheLoadModule (FILE *file)
+static module_t *CacheLoadModule (block_t *file)
 {
     module_t *module = vlc_module_create (NULL);
     if (unlikely(module == NULL))
@@ -280,6 +289,19 @@ error:
     return NULL;
 }
 
+static int CacheEntryCmp (const void *a, const void *b)
+{
+    const module_cache_t *ca = a, *cb = b;
+    return strcmp (ca->path, cb->path);
+}
+
+#define LOAD_HEADER(str) \
+    if (file->i_buffer < sizeof (str) - 1 \
+     || memcmp (file->p_buffer, str, sizeof (str) - 1)) \
+        goto error; \
+    file->p_buffer += sizeof (str) - 1; \
+    file->i_buffer -= sizeof (str) - 1
+
 /**
  * Loads a plugins cache file.
  *
@@ -287,25 +309,28 @@ error:
  * will in turn be queried by AllocateAllPlugins() to see if it needs to
  * actually load the dynamically loadable module.
  * This allows us to only fully load plugins when they are actually used.
+ *
+ * The file is mapped in memory at once. Only its index is parsed here;
+ * module descriptors are decoded by CacheFind(), once their plugin file
+ * has been found to match. The returned block must be released after the
+ * last call to CacheFind().
  */
-size_t CacheLoad( vlc_object_t *p_this, const char *dir, module_cache_t **r )
+size_t CacheLoad (vlc_object_t *p_this, const char *dir, module_cache_t **r,
+                  block_t **blockp)
 {
     char *psz_filename;
-    FILE *file;
-    int i_size, i_read;
-    char p_cachestring[sizeof(CACHE_STRING)];
-    int32_t i_marker;
 
     assert( dir != NULL );
 
     *r = NULL;
+    *blockp = NULL;
     if( asprintf( &psz_filename, "%s"DIR_SEP CACHE_NAME, dir ) == -1 )
         return 0;
 
     msg_Dbg( p_this, "loading plugins cache file %s", psz_filename );
 
-    file = vlc_fopen( psz_filename, "rb" );
-    if( !file )
+    block_t *block = block_FilePath (psz_filename);
+    if (block == NULL)
     {
         msg_Warn( p_this, "cannot read %s: %s", psz_filename,
                   vlc_strerror_c(errno) );
@@ -314,92 +339,86 @@ size_t CacheLoad( vlc_object_t *p_this, const char *dir, module_cache_t **r )
     }
     free( psz_filename );
 
-    /* Check the file is a plugins cache */
-    i_size = sizeof(CACHE_STRING) - 1;
-    i_read = fread( p_cachestring, 1, i_size, file );
-    if( i_read != i_size ||
-        memcmp( p_cachestring, CACHE_STRING, i_size ) )
-    {
-        msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
-        fclose( file );
-        return 0;
-    }
+    block_t file_buf, *file = &file_buf;
+    module_cache_t *cache = NULL;
+    uint32_t count = 0, i_marker;
+
+    block_Init (file, block->p_buffer, block->i_buffer);
 
+    /* Check the file is a plugins cache */
+    LOAD_HEADER(CACHE_STRING);
 #ifdef DISTRO_VERSION
     /* Check for distribution specific version */
-    char p_distrostring[sizeof( DISTRO_VERSION )];
-    i_size = sizeof( DISTRO_VERSION ) - 1;
-    i_read = fread( p_distrostring, 1, i_size, file );
-    if( i_read != i_size ||
-        memcmp( p_distrostring, DISTRO_VERSION, i_size ) )
-    {
-        msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
-        fclose( file );
-        return 0;
-    }
+    LOAD_HEADER(DISTRO_VERSION);
 #endif
 
     /* Check sub-version number */
-    i_read = fread( &i_marker, 1, sizeof(i_marker), file );
-    if( i_read != sizeof(i_marker) || i_marker != CACHE_SUBVERSION_NUM )
-    {
-        msg_Warn( p_this, "This doesn't look like a valid plugins cache "
-                  "(corrupted header)" );
-        fclose( file );
-        return 0;
-    }
+    LOAD_IMMEDIATE(i_marker);
+    if (i_marker != CACHE_SUBVERSION_NUM)
+        goto error;
 
     /* Check header marker */
-    i_read = fread( &i_marker, 1, sizeof(i_marker), file );
-    if( i_read != sizeof(i_marker) ||
-        i_marker != ftell( file ) - (int)sizeof(i_marker) )
-    {
-        msg_Warn( p_this, "This doesn't look like a valid plugins cache "
-                  "(corrupted header)" );
-        fclose( file );
-        return 0;
-    }
+    LOAD_IMMEDIATE(i_marker);
+    if (i_marker != file->p_buffer - block->p_buffer - sizeof (i_marker))
+        goto error;
 
-    module_cache_t *cache = NULL;
-    size_t count = 0;
+    /* The index is located by the trailer, once all modules are written */
+    if (block->i_buffer < file->p_buffer - block->p_buffer + sizeof (i_marker))
+        goto error;
+    memcpy (&i_marker, block->p_buffer + block->i_buffer - sizeof (i_marker),
+            sizeof (i_marker));
+    if (i_marker < file->p_buffer - block->p_buffer
+     || i_marker > block->i_buffer - sizeof (i_marker))
+        goto error;
+
+    const uint8_t *records = file->p_buffer;
+    size_t records_size = i_marker - (records - block->p_buffer);
 
-    for (;;)
+    block_Init (file, block->p_buffer + i_marker,
+                block->i_buffer - i_marker - sizeof (i_marker));
+    LOAD_IMMEDIATE(count);
+    if (count > file->i_buffer)
+        goto error;
+
+    cache = calloc (count, sizeof (*cache));
+    if (unlikely(cache == NULL))
     {
-        module_t *module = CacheLoadModule (file);
-        if (module == NULL)
-        {
-            if (feof (file))
-                break;
-            goto error;
-        }
+        count = 0;
+        goto error;
+    }
 
-        char *path;
-        struct stat st;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t offset, size;
 
         /* Load common info */
-        LOAD_STRING(path);
-        if (path == NULL)
+        LOAD_STRING(cache[i].path);
+        if (cache[i].path == NULL)
             goto error;
-        LOAD_IMMEDIATE(st.st_mtime);
-        LOAD_IMMEDIATE(st.st_size);
-
-        CacheAdd (&cache, &count, path, &st, module);
-        free (path);
-        /* TODO: deal with errors */
+        LOAD_IMMEDIATE(cache[i].mtime);
+        LOAD_IMMEDIATE(cache[i].size);
+        LOAD_IMMEDIATE(offset);
+        LOAD_IMMEDIATE(size);
+        if (offset > records_size || size > records_size - offset)
+            goto error;
+        cache[i].data = records + offset;
+        cache[i].datasize = size;
     }
 
-    fclose( file );
+    if (file->i_buffer != 0)
+        goto error;
 
+    qsort (cache, count, sizeof (*cache), CacheEntryCmp);
     *r = cache;
+    *blockp = block;
     return count;
 
 error:
-    if (ferror (file))
-        msg_Err(p_this, "plugins cache read error: %s", vlc_strerror_c(errno));
     msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
-
-    /* TODO: cleanup */
-    fclose( file );
+    for (uint32_t i = 0; i < count; i++)
+        free (cache[i].path);
+    free (cache);
+    block_Release (block);
     return 0;
 }
 
@@ -546,6 +565,8 @@ static int CacheSaveBank (FILE *file, const module_cache_t *cache,
                           size_t i_cache)
 {
     uint32_t i_file_size = 0;
+    uint32_t (*records)[2] = NULL; /* offset and size of each module */
+    long base;
 
     /* Contains version number */
     if (fputs (CACHE_STRING, file) == EOF)
@@ -566,11 +587,21 @@ static int CacheSaveBank (FILE *file, const module_cache_t *cache,
     if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1)
         goto error;
 
+    base = ftell (file);
+    if (i_cache > 0)
+    {
+        records = malloc (i_cache * sizeof (*records));
+        if (unlikely(records == NULL))
+            goto error;
+    }
+
     for (unsigned i = 0; i < i_cache; i++)
     {
         module_t *module = cache[i].p_module;
         uint32_t i_submodule;
 
+        records[i][0] = ftell (file) - base;
+
         /* Save additional infos */
         SAVE_STRING(module->psz_shortname);
         SAVE_STRING(module->psz_longname);
@@ -594,17 +625,34 @@ static int CacheSaveBank (FILE *file, const module_cache_t *cache,
         if (CacheSaveSubmodule (file, module->submodule))
             goto error;
 
+        records[i][1] = ftell (file) - base - records[i][0];
+    }
+
+    /* Index of the plugin files, with their module descriptor location */
+    i_file_size = ftell (file);
+    uint32_t count = i_cache;
+    SAVE_IMMEDIATE(count);
+
+    for (unsigned i = 0; i < i_cache; i++)
+    {
         /* Save common info */
         SAVE_STRING(cache[i].path);
         SAVE_IMMEDIATE(cache[i].mtime);
         SAVE_IMMEDIATE(cache[i].size);
+        SAVE_IMMEDIATE(records[i][0]);
+        SAVE_IMMEDIATE(records[i][1]);
     }
 
+    /* Trailer: index offset */
+    SAVE_IMMEDIATE(i_file_size);
+
     if (fflush (file)) /* flush libc buffers */
         goto error;
+    free (records);
     return 0; /* success! */
 
 error:
+    free (records);
     return -1;
 }
 
@@ -653,32 +701,38 @@ void CacheMerge( vlc_object_t *p_this, module_t *p_cache, module_t *p_module )
         p_cchild = p_cchild->next;
     }
 
+    /* Choices callbacks from the cache or from an unloaded plug-in are
+     * stale, only their presence is meaningful. */
+    if (p_cache->confsize == p_module->confsize)
+        for (size_t i = 0; i < p_cache->confsize; i++)
+            if (p_cache->p_config[i].list_count == 0
+             && p_module->p_config[i].list_count == 0)
+                p_cache->p_config[i].list = p_module->p_config[i].list;
+
     p_cache->b_loaded = true;
     p_module->b_loaded = false;
 }
 
 /**
- * Looks up a plugin file in a table of cached plugins.
+ * Looks up a plugin file in a table of cached plugins, as returned by
+ * CacheLoad(), and decodes its module descriptor.
  */
 module_t *CacheFind (module_cache_t *cache, size_t count,
                      const char *path, const struct stat *st)
 {
-    while (count > 0)
-    {
-        if (cache->path != NULL
-         && !strcmp (cache->path, path)
-         && cache->mtime == st->st_mtime
-         && cache->size == st->st_size)
-       {
-            module_t *module = cache->p_module;
-            cache->p_module = NULL;
-            return module;
-       }
-       cache++;
-       count--;
-    }
+    module_cache_t key = { .path = (char *)path };
+    module_cache_t *entry = bsearch (&key, cache, count, sizeof (*cache),
+                                     CacheEntryCmp);
 
-    return NULL;
+    if (entry == NULL || entry->data == NULL
+     || entry->mtime != st->st_mtime || entry->size != st->st_size)
+        return NULL;
+
+    block_t file;
+
+    block_Init (&file, (void *)entry->data, entry->datasize);
+    entry->data = NULL; /* each entry is used once */
+    return CacheLoadModule (&file);
 }
 
 /** Adds entry to the cache */
@@ -699,6 +753,8 @@ int CacheAdd (module_cache_t **cachep, size_t *countp,
     cache->mtime = st->st_mtime;
     cache->size = st->st_size;
     cache->p_module = module;
+    cache->data = NULL;
+    cache->datasize = 0;
     *countp = count + 1;
     return 0;
 }
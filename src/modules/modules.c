@@ -173,6 +173,7 @@ static int module_load (vlc_object_t *obj, module_t *m,
                         vlc_activate_t init, va_list args)
 {
     int ret = VLC_SUCCESS;
+    mtime_t start = mdate ();
 
     if (module_Map (obj, m))
         return VLC_EGENERIC;
@@ -185,6 +186,10 @@ static int module_load (vlc_object_t *obj, module_t *m,
         ret = init (m->pf_activate, ap);
         va_end (ap);
     }
+
+    vlc_TraceSpan (obj, "module", start, "%s: %s%s",
+                   module_get_capability (m), module_get_object (m),
+                   (ret == VLC_SUCCESS) ? "" : " (failed)");
     return ret;
 }
 
@@ -38,6 +38,8 @@ struct module_cache_t
 
     /* Optional extra data */
     module_t *p_module;
+    const void *data; /* undecoded module descriptor (loaded caches only) */
+    size_t datasize;
 };
 
 
@@ -109,6 +111,7 @@ size_t module_LoadPlugins( vlc_object_t * );
 #define module_LoadPlugins(a) module_LoadPlugins(VLC_OBJECT(a))
 void module_EndBank (bool);
 int module_Map (vlc_object_t *, module_t *);
+int module_MapConfig (vlc_object_t *, const module_config_t *);
 
 ssize_t module_list_cap (module_t ***, const char *);
 
@@ -122,7 +125,8 @@ void module_Unload (module_handle_t);
 /* Plugins cache */
 void   CacheMerge (vlc_object_t *, module_t *, module_t *);
 void   CacheDelete(vlc_object_t *, const char *);
-size_t CacheLoad  (vlc_object_t *, const char *, module_cache_t **);
+size_t CacheLoad  (vlc_object_t *, const char *, module_cache_t **,
+                   block_t **);
 
 struct stat;
 
@@ -36,6 +36,7 @@
 
 #include <sys/types.h>
 #include <vlc_network.h>
+#include "libvlc.h"
 
 #ifndef AF_UNSPEC
 #   define AF_UNSPEC   0
@@ -68,19 +69,149 @@ int vlc_getnameinfo( const struct sockaddr *sa, int salen,
 }
 
 
+/*** Resolver cache ***/
+
+/* getaddrinfo() does not expose the DNS records time-to-live.
+ * Results are kept for a fixed time, in the order of common CDN TTLs. The
+ * first lookup after that resolves the name again on the calling thread. */
+#define GAI_CACHE_SIZE     16
+#define GAI_CACHE_LIFETIME (CLOCK_FREQ * 60)
+
+struct gai_entry
+{
+    char *node;
+    unsigned port;
+    struct addrinfo hints;
+    struct addrinfo *res;
+    mtime_t date;
+};
+
+static struct gai_entry gai_cache[GAI_CACHE_SIZE];
+static vlc_mutex_t gai_cache_lock = VLC_STATIC_MUTEX;
+
 /**
- * Resolves a host name to a list of socket addresses (like getaddrinfo()).
- *
- * @param node host name to resolve (encoded as UTF-8), or NULL
- * @param i_port port number for the socket addresses
- * @param p_hints parameters (see getaddrinfo() manual page)
- * @param res pointer set to the resulting chained list.
- * @return 0 on success, a getaddrinfo() error otherwise.
- * On failure, *res is undefined. On success, it must be freed with
- * freeaddrinfo().
+ * Copies a list of addresses into a single allocation.
  */
-int vlc_getaddrinfo (const char *node, unsigned port,
-                     const struct addrinfo *hints, struct addrinfo **res)
+static struct addrinfo *gai_dup (const struct addrinfo *res)
+{
+    size_t size = 0;
+
+    for (const struct addrinfo *ptr = res; ptr != NULL; ptr = ptr->ai_next)
+    {
+        size += sizeof (*ptr) + ptr->ai_addrlen;
+        if (ptr->ai_canonname != NULL)
+            size += strlen (ptr->ai_canonname) + 1;
+        size = (size + sizeof (void *) - 1) & ~(sizeof (void *) - 1);
+    }
+
+    unsigned char *buf = malloc (size);
+    if (unlikely(buf == NULL))
+        return NULL;
+
+    struct addrinfo *dup = (struct addrinfo *)buf, **pp = &dup;
+    for (const struct addrinfo *ptr = res; ptr != NULL; ptr = ptr->ai_next)
+    {
+        struct addrinfo *ai = (struct addrinfo *)buf;
+
+        buf += sizeof (*ai);
+        *ai = *ptr;
+        ai->ai_addr = memcpy (buf, ptr->ai_addr, ptr->ai_addrlen);
+        buf += ptr->ai_addrlen;
+        if (ptr->ai_canonname != NULL)
+        {
+            size_t len = strlen (ptr->ai_canonname) + 1;
+            ai->ai_canonname = memcpy (buf, ptr->ai_canonname, len);
+            buf += len;
+        }
+        ai->ai_next = NULL;
+        buf = (unsigned char *)(((uintptr_t)buf + sizeof (void *) - 1)
+                                & ~(uintptr_t)(sizeof (void *) - 1));
+        *pp = ai;
+        pp = &ai->ai_next;
+    }
+    return dup;
+}
+
+static bool gai_cacheable (const char *node, const struct addrinfo *hints)
+{
+    if (node == NULL || hints == NULL
+     || (hints->ai_flags & (AI_PASSIVE|AI_NUMERICHOST)))
+        return false;
+    /* Numeric addresses resolve instantly and need no cache */
+    return node[strspn (node, "0123456789abcdefABCDEF.:")] != '\0';
+}
+
+static struct gai_entry *gai_find (const char *node, unsigned port,
+                                   const struct addrinfo *hints)
+{
+    for (unsigned i = 0; i < GAI_CACHE_SIZE; i++)
+    {
+        struct gai_entry *e = gai_cache + i;
+
+        if (e->node != NULL && e->port == port && !strcmp (e->node, node)
+         && e->hints.ai_flags == hints->ai_flags
+         && e->hints.ai_family == hints->ai_family
+         && e->hints.ai_socktype == hints->ai_socktype
+         && e->hints.ai_protocol == hints->ai_protocol)
+            return e;
+    }
+    return NULL;
+}
+
+/**
+ * Stores a resolution result, replacing the entry for the same lookup, or
+ * else the oldest one.
+ */
+static void gai_store (const char *node, unsigned port,
+                       const struct addrinfo *hints, struct addrinfo *res)
+{
+    struct gai_entry *e = gai_find (node, port, hints);
+
+    if (e == NULL)
+    {
+        e = gai_cache;
+        for (unsigned i = 1; i < GAI_CACHE_SIZE && e->node != NULL; i++)
+            if (gai_cache[i].node == NULL || gai_cache[i].date < e->date)
+                e = gai_cache + i;
+
+        char *name = strdup (node);
+        if (unlikely(name == NULL))
+        {
+            free (res);
+            return;
+        }
+        free (e->node);
+        free (e->res);
+        e->node = name;
+        e->port = port;
+        e->hints = *hints;
+    }
+    else
+        free (e->res);
+
+    e->res = res;
+    e->date = mdate ();
+}
+
+/**
+ * Looks a resolution up in the cache.
+ * @return a copy of the cached addresses, or NULL if none or expired
+ */
+static struct addrinfo *gai_lookup (const char *node, unsigned port,
+                                    const struct addrinfo *hints)
+{
+    struct addrinfo *res = NULL;
+
+    vlc_mutex_lock (&gai_cache_lock);
+    struct gai_entry *e = gai_find (node, port, hints);
+    if (e != NULL && mdate () - e->date < GAI_CACHE_LIFETIME)
+        res = gai_dup (e->res);
+    vlc_mutex_unlock (&gai_cache_lock);
+    return res;
+}
+
+static int gai_resolve (const char *node, unsigned port,
+                        const struct addrinfo *hints, struct addrinfo **res)
 {
     char hostbuf[NI_MAXHOST], portbuf[6], *servname;
 
@@ -123,3 +254,77 @@ int vlc_getaddrinfo (const char *node, unsigned port,
 
     return getaddrinfo (node, servname, hints, res);
 }
+
+/**
+ * Resolves a host name to a list of socket addresses (like getaddrinfo()).
+ *
+ * Host name resolutions are cached for a short time, and shared by all
+ * callers.
+ *
+ * @param node host name to resolve (encoded as UTF-8), or NULL
+ * @param i_port port number for the socket addresses
+ * @param p_hints parameters (see getaddrinfo() manual page)
+ * @param res pointer set to the resulting chained list.
+ * @return 0 on success, a getaddrinfo() error otherwise.
+ * On failure, *res is undefined. On success, it must be freed with
+ * vlc_freeaddrinfo().
+ */
+int vlc_getaddrinfo (const char *node, unsigned port,
+                     const struct addrinfo *hints, struct addrinfo **res)
+{
+    const bool cacheable = gai_cacheable (node, hints);
+    if (cacheable)
+    {
+        *res = gai_lookup (node, port, hints);
+        if (*res != NULL)
+            return 0;
+    }
+
+    struct addrinfo *sysres;
+    int val = gai_resolve (node, port, hints, &sysres);
+    if (val)
+        return val;
+
+    *res = gai_dup (sysres);
+    freeaddrinfo (sysres);
+    if (unlikely(*res == NULL))
+        return EAI_MEMORY;
+
+    if (cacheable)
+    {
+        struct addrinfo *dup = gai_dup (*res);
+        if (likely(dup != NULL))
+        {
+            vlc_mutex_lock (&gai_cache_lock);
+            gai_store (node, port, hints, dup);
+            vlc_mutex_unlock (&gai_cache_lock);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Frees all the cached host name resolutions.
+ */
+void vlc_getaddrinfo_CacheFlush (void)
+{
+    vlc_mutex_lock (&gai_cache_lock);
+    for (unsigned i = 0; i < GAI_CACHE_SIZE; i++)
+    {
+        struct gai_entry *e = gai_cache + i;
+
+        free (e->node);
+        free (e->res);
+        e->node = NULL;
+        e->res = NULL;
+    }
+    vlc_mutex_unlock (&gai_cache_lock);
+}
+
+/**
+ * Releases a list of socket addresses returned by vlc_getaddrinfo().
+ */
+void vlc_freeaddrinfo (struct addrinfo *res)
+{
+    free (res);
+}
@@ -40,15 +40,25 @@
 #include <vlc_url.h>
 #include <vlc_mime.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
+#include <vlc_fs.h>
 #include "../libvlc.h"
 
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
 
 #if defined(_WIN32)
 #   include <winsock2.h>
@@ -63,8 +73,20 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* size of the shared stream buffer segments */
+#define HTTPD_STREAM_CHUNK 65536
+
+/* largest piece of a local file sent at once */
+#define HTTPD_FILE_CHUNK (1 << 20)
+/* largest local file kept in memory once requested again */
+#define HTTPD_FILE_CACHE_MAX (8 << 20)
+
+typedef struct httpd_stream_chunk_t httpd_stream_chunk_t;
+
 static void httpd_ClientClean(httpd_client_t *cl);
+static void httpd_HostSchedule(httpd_host_t *, httpd_client_t *);
 static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
+static void httpd_StreamChunkRelease(httpd_stream_chunk_t *chunk);
 
 /* each host run in his own thread */
 struct httpd_host_t
@@ -93,6 +115,14 @@ struct httpd_host_t
     int            i_client;
     httpd_client_t **client;
 
+    /* epoll set of listening and client sockets, or -1 to use poll() */
+    int            epfd;
+    /* clients to advance on the next iteration of the epoll loop */
+    httpd_client_t *p_ready;
+    /* clients with an inactivity timeout, by increasing deadline */
+    httpd_client_t *p_timer_first;
+    httpd_client_t *p_timer_last;
+
     /* TLS data */
     vlc_tls_creds_t *p_tls;
 };
@@ -146,6 +176,14 @@ struct httpd_client_t
     int     i_ref;
 
     int     fd;
+    short   i_poll_events; /* events registered in the host epoll set */
+
+    /* epoll loop scheduling, see httpd_HostSchedule() and httpd_TimerUpdate() */
+    bool    b_ready;
+    bool    b_timer;
+    httpd_client_t *p_ready_next;
+    httpd_client_t *p_timer_prev;
+    httpd_client_t *p_timer_next;
 
     bool    b_stream_mode;
     uint8_t i_state;
@@ -158,6 +196,16 @@ struct httpd_client_t
     int     i_buffer;
     uint8_t *p_buffer;
 
+    /* stream data being sent, borrowed from the stream buffer */
+    httpd_stream_chunk_t *p_chunk;
+    size_t  i_chunk_offset;
+    size_t  i_chunk_end;
+
+    /* local file being sent, or -1 */
+    int      i_file_fd;
+    uint64_t i_file_offset;
+    uint64_t i_file_end;
+
     /*
      * If waiting for a keyframe, this is the position (in bytes) of the
      * last keyframe the stream saw before this client connected.
@@ -611,9 +659,11 @@ struct httpd_stream_t
     bool        b_has_keyframes;
     int64_t     i_last_keyframe_seen_pos;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
+    /* buffer, as a list of segments shared with the clients */
+    int         i_buffer_size;      /* buffer size */
+    httpd_stream_chunk_t *p_first;  /* oldest segment */
+    httpd_stream_chunk_t *p_last;   /* segment being filled */
+    unsigned    i_chunks;
     int64_t     i_buffer_pos;       /* absolute position from begining */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
 
@@ -622,57 +672,91 @@ struct httpd_stream_t
     httpd_header * p_http_headers;
 };
 
-static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
-                                 httpd_client_t *cl, httpd_message_t *answer,
-                                 const httpd_message_t *query)
+/* Segment of the stream buffer. Clients hold a reference to the segment they
+ * are sending from, so the data is never copied per client. Data is only
+ * appended beyond what clients have been handed out.
+ * Also used to keep a whole local file in memory (see httpd_vod_t). */
+struct httpd_stream_chunk_t
 {
-    httpd_stream_t *stream = (httpd_stream_t*)p_sys;
-
-    if (!answer || !query || !cl)
-        return VLC_SUCCESS;
+    atomic_uint          refs;
+    httpd_stream_chunk_t *next;    /* protected by the stream lock */
+    int64_t              i_pos;    /* stream position of p_data[0] */
+    size_t               i_size;   /* bytes written so far */
+    uint8_t              p_data[];
+};
 
-    if (answer->i_body_offset > 0) {
-        int     i_pos;
+static void httpd_StreamChunkRelease(httpd_stream_chunk_t *chunk)
+{
+    if (atomic_fetch_sub(&chunk->refs, 1) == 1)
+        free(chunk);
+}
 
-        if (answer->i_body_offset >= stream->i_buffer_pos)
-            return VLC_EGENERIC;    /* wait, no data available */
+/* Hands the stream data at answer->i_body_offset out to a client.
+ * The stream lock must be held. */
+static int httpd_StreamGetData(httpd_stream_t *stream, httpd_client_t *cl,
+                               httpd_message_t *answer)
+{
+    if (answer->i_body_offset >= stream->i_buffer_pos)
+        return VLC_EGENERIC;    /* wait, no data available */
 
-        if (cl->i_keyframe_wait_to_pass >= 0) {
-            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
-                /* still waiting for the next keyframe */
-                return VLC_EGENERIC;
+    if (cl->i_keyframe_wait_to_pass >= 0) {
+        if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
+            /* still waiting for the next keyframe */
+            return VLC_EGENERIC;
 
-            /* seek to the new keyframe */
-            answer->i_body_offset = stream->i_last_keyframe_seen_pos;
-            cl->i_keyframe_wait_to_pass = -1;
-        }
+        /* seek to the new keyframe */
+        answer->i_body_offset = stream->i_last_keyframe_seen_pos;
+        cl->i_keyframe_wait_to_pass = -1;
+    }
 
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
-            answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
+    httpd_stream_chunk_t *chunk = stream->p_first;
+    if (chunk == NULL)
+        return VLC_EGENERIC;
 
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
+    if (answer->i_body_offset < chunk->i_pos)
+        answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
+    if (answer->i_body_offset < chunk->i_pos)
+        answer->i_body_offset = chunk->i_pos;
 
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
+    while (answer->i_body_offset >= chunk->i_pos + (int64_t)chunk->i_size) {
+        chunk = chunk->next;
+        if (chunk == NULL)
             return VLC_EGENERIC;    /* wait, no data available */
+    }
 
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
+    size_t i_pos = answer->i_body_offset - chunk->i_pos;
+    size_t i_write = __MIN(chunk->i_size - i_pos, HTTPD_CL_BUFSIZE);
 
-        /* using HTTPD_MSG_ANSWER -> data available */
-        answer->i_proto  = HTTPD_PROTO_HTTP;
-        answer->i_version= 0;
-        answer->i_type   = HTTPD_MSG_ANSWER;
+    /* using HTTPD_MSG_ANSWER -> data available */
+    answer->i_proto  = HTTPD_PROTO_HTTP;
+    answer->i_version= 0;
+    answer->i_type   = HTTPD_MSG_ANSWER;
 
-        answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
+    assert(cl->p_chunk == NULL);
+    atomic_fetch_add(&chunk->refs, 1);
+    cl->p_chunk = chunk;
+    cl->i_chunk_offset = i_pos;
+    cl->i_chunk_end = i_pos + i_write;
 
-        answer->i_body_offset += i_write;
+    answer->i_body_offset += i_write;
 
+    return VLC_SUCCESS;
+}
+
+static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
+                                 httpd_client_t *cl, httpd_message_t *answer,
+                                 const httpd_message_t *query)
+{
+    httpd_stream_t *stream = (httpd_stream_t*)p_sys;
+
+    if (!answer || !query || !cl)
         return VLC_SUCCESS;
+
+    if (answer->i_body_offset > 0) {
+        vlc_mutex_lock(&stream->lock);
+        int ret = httpd_StreamGetData(stream, cl, answer);
+        vlc_mutex_unlock(&stream->lock);
+        return ret;
     } else {
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
@@ -766,7 +850,9 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
     stream->i_header = 0;
     stream->p_header = NULL;
     stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-    stream->p_buffer = xmalloc(stream->i_buffer_size);
+    stream->p_first = NULL;
+    stream->p_last = NULL;
+    stream->i_chunks = 0;
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
     stream->i_buffer_pos = 1;
@@ -804,20 +890,44 @@ int httpd_StreamHeader(httpd_stream_t *stream, uint8_t *p_data, int i_data)
 
 static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data)
 {
-    int i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    int i_count = i_data;
-    while (i_count > 0) {
-        int i_copy = __MIN(i_count, stream->i_buffer_size - i_pos);
+    const unsigned i_max = stream->i_buffer_size / HTTPD_STREAM_CHUNK;
 
-        /* Ok, we can't go past the end of our buffer */
-        memcpy(&stream->p_buffer[i_pos], p_data, i_copy);
+    while (i_data > 0) {
+        httpd_stream_chunk_t *chunk = stream->p_last;
 
-        i_pos = (i_pos + i_copy) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
-    }
+        if (chunk == NULL || chunk->i_size == HTTPD_STREAM_CHUNK) {
+            chunk = xmalloc(sizeof (*chunk) + HTTPD_STREAM_CHUNK);
+            atomic_init(&chunk->refs, 1); /* owned by the stream */
+            chunk->next = NULL;
+            chunk->i_pos = stream->i_buffer_pos;
+            chunk->i_size = 0;
+
+            if (stream->p_last != NULL)
+                stream->p_last->next = chunk;
+            else
+                stream->p_first = chunk;
+            stream->p_last = chunk;
+            stream->i_chunks++;
+
+            /* Drop the oldest segment; clients still sending from it keep
+             * it alive until they are done. */
+            while (stream->i_chunks > i_max) {
+                httpd_stream_chunk_t *old = stream->p_first;
+
+                stream->p_first = old->next;
+                stream->i_chunks--;
+                httpd_StreamChunkRelease(old);
+            }
+        }
+
+        size_t i_copy = __MIN((size_t)i_data, HTTPD_STREAM_CHUNK - chunk->i_size);
 
-    stream->i_buffer_pos += i_data;
+        memcpy(&chunk->p_data[chunk->i_size], p_data, i_copy);
+        chunk->i_size += i_copy;
+        stream->i_buffer_pos += i_copy;
+        i_data -= i_copy;
+        p_data += i_copy;
+    }
 }
 
 int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
@@ -852,10 +962,271 @@ void httpd_StreamDelete(httpd_stream_t *stream)
     vlc_mutex_destroy(&stream->lock);
     free(stream->psz_mime);
     free(stream->p_header);
-    free(stream->p_buffer);
+    while (stream->p_first != NULL) {
+        httpd_stream_chunk_t *chunk = stream->p_first;
+
+        stream->p_first = chunk->next;
+        httpd_StreamChunkRelease(chunk);
+    }
     free(stream);
 }
 
+/*****************************************************************************
+ * High Level Functions: httpd_vod_t
+ *****************************************************************************/
+struct httpd_vod_t
+{
+    vlc_mutex_t lock;
+    httpd_url_t *url;
+    char        *psz_path;
+
+    /* in-memory copy of the file, once requested more than once */
+    httpd_stream_chunk_t *p_cache;
+    time_t      i_cache_mtime;
+    unsigned    i_hits;
+
+    char mime[1];
+};
+
+static void httpd_HttpDate(char *psz_date, time_t t)
+{
+    static const char days[7][4] = {
+        "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    static const char months[12][4] = {
+        "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    struct tm tm;
+
+    gmtime_r(&t, &tm);
+    sprintf(psz_date, "%s, %02d %s %04d %02d:%02d:%02d GMT",
+            days[tm.tm_wday], tm.tm_mday, months[tm.tm_mon],
+            tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
+
+/* Parses a single byte range. Returns false if the range cannot be
+ * satisfied; pi_start and pi_end are left untouched if there is none. */
+static bool httpd_ParseRange(const char *psz_range, uint64_t i_size,
+                             uint64_t *pi_start, uint64_t *pi_end)
+{
+    unsigned long long a, b;
+
+    if (strncmp(psz_range, "bytes=", 6) || strchr(psz_range, ',') != NULL)
+        return true; /* ignore other units and multiple ranges */
+    psz_range += 6;
+
+    if (sscanf(psz_range, "%llu-%llu", &a, &b) == 2) {
+        if (a > b || a >= i_size)
+            return false;
+        *pi_start = a;
+        *pi_end = __MIN(b + 1, i_size);
+    } else if (sscanf(psz_range, "%llu-", &a) == 1) {
+        if (a >= i_size)
+            return false;
+        *pi_start = a;
+        *pi_end = i_size;
+    } else if (sscanf(psz_range, "-%llu", &b) == 1) {
+        if (b == 0)
+            return false;
+        *pi_start = i_size - __MIN(b, i_size);
+        *pi_end = i_size;
+    }
+    return true;
+}
+
+static ssize_t httpd_FileRead(int fd, uint8_t *p, size_t i_len, uint64_t i_offset)
+{
+#ifdef HAVE_PREAD
+    return pread(fd, p, i_len, i_offset);
+#else
+    if (lseek(fd, i_offset, SEEK_SET) == (off_t)-1)
+        return -1;
+    return read(fd, p, i_len);
+#endif
+}
+
+/* Returns a reference to the in-memory copy of the file, loading it if the
+ * file is small and already served before. The vod lock must be held. */
+static httpd_stream_chunk_t *httpd_VodCache(httpd_vod_t *vod, int fd,
+                                            const struct stat *st)
+{
+    httpd_stream_chunk_t *chunk = vod->p_cache;
+
+    if (chunk != NULL && (vod->i_cache_mtime != st->st_mtime
+                       || chunk->i_size != (uint64_t)st->st_size)) {
+        /* the file changed */
+        httpd_StreamChunkRelease(chunk);
+        vod->p_cache = chunk = NULL;
+        vod->i_hits = 0;
+    }
+
+    if (chunk == NULL) {
+        if (st->st_size > HTTPD_FILE_CACHE_MAX || vod->i_hits++ < 1)
+            return NULL;
+
+        chunk = malloc(sizeof (*chunk) + st->st_size);
+        if (unlikely(chunk == NULL))
+            return NULL;
+        atomic_init(&chunk->refs, 1); /* owned by the vod */
+        chunk->next = NULL;
+        chunk->i_pos = 0;
+        chunk->i_size = 0;
+
+        while (chunk->i_size < (size_t)st->st_size) {
+            ssize_t val = httpd_FileRead(fd, &chunk->p_data[chunk->i_size],
+                                         st->st_size - chunk->i_size,
+                                         chunk->i_size);
+            if (val <= 0) {
+                free(chunk);
+                return NULL;
+            }
+            chunk->i_size += val;
+        }
+        vod->p_cache = chunk;
+        vod->i_cache_mtime = st->st_mtime;
+    }
+
+    atomic_fetch_add(&chunk->refs, 1);
+    return chunk;
+}
+
+static int httpd_VodCallBack(httpd_callback_sys_t *p_sys, httpd_client_t *cl,
+                             httpd_message_t *answer,
+                             const httpd_message_t *query)
+{
+    httpd_vod_t *vod = (httpd_vod_t *)p_sys;
+
+    if (!answer || !query)
+        return VLC_SUCCESS;
+
+    int fd = vlc_open(vod->psz_path, O_RDONLY);
+    if (fd == -1)
+        return VLC_EGENERIC; /* 404 */
+
+    struct stat st;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return VLC_EGENERIC;
+    }
+
+    uint64_t i_size = st.st_size;
+    uint64_t i_start = 0, i_end = i_size;
+    char psz_etag[48], psz_date[32];
+    const char *psz;
+
+    snprintf(psz_etag, sizeof (psz_etag), "\"%"PRIx64"-%"PRIx64"\"",
+             (uint64_t)st.st_mtime, i_size);
+    httpd_HttpDate(psz_date, st.st_mtime);
+
+    answer->i_proto  = HTTPD_PROTO_HTTP;
+    answer->i_version= 1;
+    answer->i_type   = HTTPD_MSG_ANSWER;
+    answer->i_status = 200;
+
+    httpd_MsgAdd(answer, "Content-Type", "%s", vod->mime);
+    httpd_MsgAdd(answer, "Accept-Ranges", "bytes");
+    httpd_MsgAdd(answer, "ETag", "%s", psz_etag);
+    httpd_MsgAdd(answer, "Last-Modified", "%s", psz_date);
+
+    if ((psz = httpd_MsgGet(query, "If-None-Match")) != NULL
+          ? !strcmp(psz, psz_etag)
+          : ((psz = httpd_MsgGet(query, "If-Modified-Since")) != NULL
+             && !strcmp(psz, psz_date))) {
+        answer->i_status = 304;
+        i_start = i_end = 0;
+    } else if ((psz = httpd_MsgGet(query, "Range")) != NULL) {
+        const char *psz_if = httpd_MsgGet(query, "If-Range");
+
+        if (psz_if != NULL && strcmp(psz_if, psz_etag)
+                           && strcmp(psz_if, psz_date))
+            ; /* the file changed, send it whole */
+        else if (!httpd_ParseRange(psz, i_size, &i_start, &i_end)) {
+            answer->i_status = 416;
+            httpd_MsgAdd(answer, "Content-Range", "bytes */%"PRIu64, i_size);
+            i_start = i_end = 0;
+        } else if (i_end - i_start < i_size) {
+            answer->i_status = 206;
+            httpd_MsgAdd(answer, "Content-Range",
+                         "bytes %"PRIu64"-%"PRIu64"/%"PRIu64,
+                         i_start, i_end - 1, i_size);
+        }
+    }
+
+    httpd_MsgAdd(answer, "Content-Length", "%"PRIu64,
+                 (answer->i_status == 304) ? 0 : i_end - i_start);
+
+    if (query->i_type == HTTPD_MSG_HEAD || i_start == i_end) {
+        close(fd);
+        return VLC_SUCCESS;
+    }
+
+    vlc_mutex_lock(&vod->lock);
+    httpd_stream_chunk_t *chunk = httpd_VodCache(vod, fd, &st);
+    vlc_mutex_unlock(&vod->lock);
+
+    assert(cl->p_chunk == NULL && cl->i_file_fd == -1);
+    if (chunk != NULL) {
+        /* hot file: send it straight from memory */
+        close(fd);
+        cl->p_chunk = chunk;
+        cl->i_chunk_offset = i_start;
+        cl->i_chunk_end = i_end;
+    } else {
+        cl->i_file_fd = fd;
+        cl->i_file_offset = i_start;
+        cl->i_file_end = i_end;
+    }
+    return VLC_SUCCESS;
+}
+
+httpd_vod_t *httpd_VodNew(httpd_host_t *host, const char *psz_url,
+                          const char *psz_path, const char *psz_mime,
+                          const char *psz_user, const char *psz_password)
+{
+    const char *mime = psz_mime;
+    if (mime == NULL || mime[0] == '\0')
+        mime = vlc_mime_Ext2Mime(psz_path);
+
+    size_t mimelen = strlen(mime);
+    httpd_vod_t *vod = malloc(sizeof(*vod) + mimelen);
+    if (unlikely(vod == NULL))
+        return NULL;
+
+    vod->psz_path = strdup(psz_path);
+    if (unlikely(vod->psz_path == NULL)) {
+        free(vod);
+        return NULL;
+    }
+
+    vod->url = httpd_UrlNew(host, psz_url, psz_user, psz_password);
+    if (!vod->url) {
+        free(vod->psz_path);
+        free(vod);
+        return NULL;
+    }
+
+    vlc_mutex_init(&vod->lock);
+    vod->p_cache = NULL;
+    vod->i_hits = 0;
+    memcpy(vod->mime, mime, mimelen + 1);
+
+    httpd_UrlCatch(vod->url, HTTPD_MSG_HEAD, httpd_VodCallBack,
+                    (httpd_callback_sys_t*)vod);
+    httpd_UrlCatch(vod->url, HTTPD_MSG_GET,  httpd_VodCallBack,
+                    (httpd_callback_sys_t*)vod);
+
+    return vod;
+}
+
+void httpd_VodDelete(httpd_vod_t *vod)
+{
+    httpd_UrlDelete(vod->url);
+    if (vod->p_cache != NULL)
+        httpd_StreamChunkRelease(vod->p_cache);
+    vlc_mutex_destroy(&vod->lock);
+    free(vod->psz_path);
+    free(vod);
+}
+
 /*****************************************************************************
  * Low level
  *****************************************************************************/
@@ -973,11 +1344,34 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     host->i_client = 0;
     host->client   = NULL;
     host->p_tls    = p_tls;
+    host->p_ready  = NULL;
+    host->p_timer_first = NULL;
+    host->p_timer_last  = NULL;
+
+    host->epfd = -1;
+#ifdef HAVE_SYS_EPOLL_H
+    host->epfd = epoll_create1(EPOLL_CLOEXEC);
+    for (unsigned i = 0; host->epfd != -1 && i < host->nfd; i++) {
+        struct epoll_event ev = {
+            .events = EPOLLIN,
+            .data.ptr = &host->fds[i],
+        };
+
+        if (epoll_ctl(host->epfd, EPOLL_CTL_ADD, host->fds[i], &ev)) {
+            close(host->epfd);
+            host->epfd = -1;
+        }
+    }
+    if (host->epfd == -1)
+        msg_Warn(p_this, "cannot use epoll, falling back to poll");
+#endif
 
     /* create the thread */
     if (vlc_clone(&host->thread, httpd_HostThread, host,
                    VLC_THREAD_PRIORITY_LOW)) {
         msg_Err(p_this, "cannot spawn http host thread");
+        if (host->epfd != -1)
+            close(host->epfd);
         goto error;
     }
 
@@ -1042,6 +1436,8 @@ void httpd_HostDelete(httpd_host_t *host)
         /* TODO */
     }
 
+    if (host->epfd != -1)
+        close(host->epfd);
     vlc_tls_Delete(host->p_tls);
     net_ListenClose(host->fds);
     vlc_cond_destroy(&host->wait);
@@ -1118,10 +1514,12 @@ void httpd_UrlDelete(httpd_url_t *url)
 
         /* TODO complete it */
         msg_Warn(host, "force closing connections");
+        /* The host thread may be holding events of the client: leave the
+         * destruction to it. */
         httpd_ClientClean(client);
-        TAB_REMOVE(host->i_client, host->client, client);
-        free(client);
-        i--;
+        client->url = NULL;
+        client->i_state = HTTPD_CLIENT_DEAD;
+        httpd_HostSchedule(host, client);
     }
     free(url);
     vlc_mutex_unlock(&host->lock);
@@ -1235,6 +1633,16 @@ static void httpd_ClientClean(httpd_client_t *cl)
 
     free(cl->p_buffer);
     cl->p_buffer = NULL;
+
+    if (cl->p_chunk != NULL) {
+        httpd_StreamChunkRelease(cl->p_chunk);
+        cl->p_chunk = NULL;
+    }
+
+    if (cl->i_file_fd != -1) {
+        close(cl->i_file_fd);
+        cl->i_file_fd = -1;
+    }
 }
 
 static httpd_client_t *httpd_ClientNew(int fd, vlc_tls_t *p_tls, mtime_t now)
@@ -1245,6 +1653,11 @@ static httpd_client_t *httpd_ClientNew(int fd, vlc_tls_t *p_tls, mtime_t now)
 
     cl->i_ref   = 0;
     cl->fd      = fd;
+    cl->i_poll_events = 0;
+    cl->b_ready = false;
+    cl->b_timer = false;
+    cl->p_chunk = NULL;
+    cl->i_file_fd = -1;
     cl->url     = NULL;
     cl->p_tls = p_tls;
 
@@ -1587,6 +2000,46 @@ static void httpd_ClientRecv(httpd_client_t *cl)
         cl->i_activity_timeout = 0;
 }
 
+/* Sends the next piece of a local file, without copy when possible.
+ * Returns true if the piece was read into the client buffer instead. */
+static bool httpd_ClientSendFile(httpd_client_t *cl)
+{
+    size_t i_len = __MIN(cl->i_file_end - cl->i_file_offset, HTTPD_FILE_CHUNK);
+    ssize_t val;
+
+    if (i_len == 0) {
+        close(cl->i_file_fd);
+        cl->i_file_fd = -1;
+        cl->i_state = HTTPD_CLIENT_SEND_DONE;
+        return false;
+    }
+
+#ifdef HAVE_SYS_SENDFILE_H
+    if (cl->p_tls == NULL) {
+        off_t i_offset = cl->i_file_offset;
+
+        val = sendfile(cl->fd, cl->i_file_fd, &i_offset, i_len);
+        if (val > 0)
+            cl->i_file_offset += val;
+        else if (val == 0 || errno != EAGAIN)
+            cl->i_state = HTTPD_CLIENT_DEAD; /* error or file truncated */
+        return false;
+    }
+#endif
+
+    /* Read the piece in the client buffer, httpd_ClientSend() sends it */
+    cl->p_buffer = xrealloc(cl->p_buffer, i_len);
+    val = httpd_FileRead(cl->i_file_fd, cl->p_buffer, i_len, cl->i_file_offset);
+    if (val <= 0) {
+        cl->i_state = HTTPD_CLIENT_DEAD;
+        return false;
+    }
+    cl->i_file_offset += val;
+    cl->i_buffer = 0;
+    cl->i_buffer_size = val;
+    return true;
+}
+
 static void httpd_ClientSend(httpd_client_t *cl)
 {
     int i_len;
@@ -1622,12 +2075,31 @@ static void httpd_ClientSend(httpd_client_t *cl)
         cl->i_buffer_size = (uint8_t*)p - cl->p_buffer;
     }
 
-    i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
-                           cl->i_buffer_size - cl->i_buffer);
+    if (cl->i_file_fd != -1 && cl->i_buffer >= cl->i_buffer_size
+     && !httpd_ClientSendFile(cl))
+        return;
+
+    /* Once the header is out, send stream data straight from the
+     * shared stream buffer */
+    bool b_chunk = cl->p_chunk != NULL && cl->i_buffer >= cl->i_buffer_size;
+
+    if (b_chunk)
+        i_len = httpd_NetSend(cl, &cl->p_chunk->p_data[cl->i_chunk_offset],
+                               cl->i_chunk_end - cl->i_chunk_offset);
+    else
+        i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
+                               cl->i_buffer_size - cl->i_buffer);
     if (i_len >= 0) {
-        cl->i_buffer += i_len;
+        if (b_chunk) {
+            cl->i_chunk_offset += i_len;
+            if (cl->i_chunk_offset < cl->i_chunk_end)
+                return;
+            httpd_StreamChunkRelease(cl->p_chunk);
+            cl->p_chunk = NULL;
+        } else
+            cl->i_buffer += i_len;
 
-        if (cl->i_buffer >= cl->i_buffer_size) {
+        if (cl->i_buffer >= cl->i_buffer_size && cl->p_chunk == NULL) {
             if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
                 /* catch more body data */
                 int     i_msg = cl->query.i_type;
@@ -1649,8 +2121,8 @@ static void httpd_ClientSend(httpd_client_t *cl)
 
                 cl->answer.i_body = 0;
                 cl->answer.p_body = NULL;
-            } else /* send finished */
-                cl->i_state = HTTPD_CLIENT_SEND_DONE;
+            } else if (cl->p_chunk == NULL && cl->i_file_fd == -1)
+                cl->i_state = HTTPD_CLIENT_SEND_DONE; /* send finished */
         }
     } else {
 #if defined(_WIN32)
@@ -1716,264 +2188,354 @@ auth_failed:
     return false;
 }
 
-static void httpdLoop(httpd_host_t *host)
+/**
+ * Advances the state of a client, and returns the poll events to wait for
+ * (or zero if the client does not need to wait for its socket).
+ */
+static short httpd_ClientPrepare(httpd_host_t *host, httpd_client_t *cl)
 {
-    struct pollfd ufd[host->nfd + host->i_client];
-    unsigned nfd;
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        ufd[nfd].fd = host->fds[nfd];
-        ufd[nfd].events = POLLIN;
-        ufd[nfd].revents = 0;
-    }
-
-    /* add all socket that should be read/write and close dead connection */
-    while (host->i_url <= 0) {
-        mutex_cleanup_push(&host->lock);
-        vlc_cond_wait(&host->wait, &host->lock);
-        vlc_cleanup_pop();
-    }
+    int64_t i_offset;
+    short events = 0;
 
-    mtime_t now = mdate();
-    bool b_low_delay = false;
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING:
+        case HTTPD_CLIENT_TLS_HS_IN:
+            events = POLLIN;
+            break;
 
-    int canc = vlc_savecancel();
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
-        int64_t i_offset;
-        httpd_client_t *cl = host->client[i_client];
-        if (cl->i_ref < 0 || (cl->i_ref == 0 &&
-                    (cl->i_state == HTTPD_CLIENT_DEAD ||
-                      (cl->i_activity_timeout > 0 &&
-                        cl->i_activity_date+cl->i_activity_timeout < now)))) {
-            httpd_ClientClean(cl);
-            TAB_REMOVE(host->i_client, host->client, cl);
-            free(cl);
-            i_client--;
-            continue;
-        }
+        case HTTPD_CLIENT_SENDING:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            events = POLLOUT;
+            break;
 
-        struct pollfd *pufd = ufd + nfd;
-        assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
+        case HTTPD_CLIENT_RECEIVE_DONE: {
+            httpd_message_t *answer = &cl->answer;
+            httpd_message_t *query  = &cl->query;
+
+            httpd_MsgInit(answer);
+
+            /* Handle what we received */
+            switch (query->i_type) {
+                case HTTPD_MSG_ANSWER:
+                    cl->url     = NULL;
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                    break;
+
+                case HTTPD_MSG_OPTIONS:
+                    answer->i_type   = HTTPD_MSG_ANSWER;
+                    answer->i_proto  = query->i_proto;
+                    answer->i_status = 200;
+                    answer->i_body = 0;
+                    answer->p_body = NULL;
+
+                    httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
+                    httpd_MsgAdd(answer, "Content-Length", "0");
+
+                    switch(query->i_proto) {
+                    case HTTPD_PROTO_HTTP:
+                        answer->i_version = 1;
+                        httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
+                        break;
 
-        pufd->fd = cl->fd;
-        pufd->events = pufd->revents = 0;
+                    case HTTPD_PROTO_RTSP:
+                        answer->i_version = 0;
 
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING:
-            case HTTPD_CLIENT_TLS_HS_IN:
-                pufd->events = POLLIN;
-                break;
+                        const char *p = httpd_MsgGet(query, "Cseq");
+                        if (p)
+                            httpd_MsgAdd(answer, "Cseq", "%s", p);
+                        p = httpd_MsgGet(query, "Timestamp");
+                        if (p)
+                            httpd_MsgAdd(answer, "Timestamp", "%s", p);
 
-            case HTTPD_CLIENT_SENDING:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                pufd->events = POLLOUT;
-                break;
+                        p = httpd_MsgGet(query, "Require");
+                        if (p) {
+                            answer->i_status = 551;
+                            httpd_MsgAdd(query, "Unsupported", "%s", p);
+                        }
 
-            case HTTPD_CLIENT_RECEIVE_DONE: {
-                httpd_message_t *answer = &cl->answer;
-                httpd_message_t *query  = &cl->query;
+                        httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
+                                "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
+                        break;
+                    }
 
-                httpd_MsgInit(answer);
+                    cl->i_buffer = -1;  /* Force the creation of the answer in
+                                         * httpd_ClientSend */
+                    cl->i_state = HTTPD_CLIENT_SENDING;
+                    break;
 
-                /* Handle what we received */
-                switch (query->i_type) {
-                    case HTTPD_MSG_ANSWER:
-                        cl->url     = NULL;
+                case HTTPD_MSG_NONE:
+                    if (query->i_proto == HTTPD_PROTO_NONE) {
+                        cl->url = NULL;
                         cl->i_state = HTTPD_CLIENT_DEAD;
-                        break;
-
-                    case HTTPD_MSG_OPTIONS:
+                    } else {
+                        /* unimplemented */
+                        answer->i_proto  = query->i_proto ;
                         answer->i_type   = HTTPD_MSG_ANSWER;
-                        answer->i_proto  = query->i_proto;
-                        answer->i_status = 200;
-                        answer->i_body = 0;
-                        answer->p_body = NULL;
+                        answer->i_version= 0;
+                        answer->i_status = 501;
 
-                        httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
-                        httpd_MsgAdd(answer, "Content-Length", "0");
+                        char *p;
+                        answer->i_body = httpd_HtmlError (&p, 501, NULL);
+                        answer->p_body = (uint8_t *)p;
+                        httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
 
-                        switch(query->i_proto) {
-                        case HTTPD_PROTO_HTTP:
-                            answer->i_version = 1;
-                            httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
-                            break;
+                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                        cl->i_state = HTTPD_CLIENT_SENDING;
+                    }
+                    break;
 
-                        case HTTPD_PROTO_RTSP:
-                            answer->i_version = 0;
+                default: {
+                    int i_msg = query->i_type;
+                    bool b_auth_failed = false;
 
-                            const char *p = httpd_MsgGet(query, "Cseq");
-                            if (p)
-                                httpd_MsgAdd(answer, "Cseq", "%s", p);
-                            p = httpd_MsgGet(query, "Timestamp");
-                            if (p)
-                                httpd_MsgAdd(answer, "Timestamp", "%s", p);
+                    /* Search the url and trigger callbacks */
+                    for (int i = 0; i < host->i_url; i++) {
+                        httpd_url_t *url = host->url[i];
 
-                            p = httpd_MsgGet(query, "Require");
-                            if (p) {
-                                answer->i_status = 551;
-                                httpd_MsgAdd(query, "Unsupported", "%s", p);
-                            }
+                        if (strcmp(url->psz_url, query->psz_url))
+                            continue;
+                        if (!url->catch[i_msg].cb)
+                            continue;
 
-                            httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
-                                    "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
-                            break;
+                        if (answer) {
+                            b_auth_failed = !httpdAuthOk(url->psz_user,
+                               url->psz_password,
+                               httpd_MsgGet(query, "Authorization")); /* BASIC id */
+                            if (b_auth_failed)
+                               break;
                         }
 
-                        cl->i_buffer = -1;  /* Force the creation of the answer in
-                                             * httpd_ClientSend */
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                        break;
+                        if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
+                            continue;
 
-                    case HTTPD_MSG_NONE:
-                        if (query->i_proto == HTTPD_PROTO_NONE) {
-                            cl->url = NULL;
-                            cl->i_state = HTTPD_CLIENT_DEAD;
-                        } else {
-                            /* unimplemented */
-                            answer->i_proto  = query->i_proto ;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-                            answer->i_status = 501;
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, 501, NULL);
-                            answer->p_body = (uint8_t *)p;
-                            httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
-
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            cl->i_state = HTTPD_CLIENT_SENDING;
-                        }
-                        break;
+                        if (answer->i_proto == HTTPD_PROTO_NONE)
+                            cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
+                        else
+                            cl->i_buffer = -1;
 
-                    default: {
-                        int i_msg = query->i_type;
-                        bool b_auth_failed = false;
-
-                        /* Search the url and trigger callbacks */
-                        for (int i = 0; i < host->i_url; i++) {
-                            httpd_url_t *url = host->url[i];
-
-                            if (strcmp(url->psz_url, query->psz_url))
-                                continue;
-                            if (!url->catch[i_msg].cb)
-                                continue;
-
-                            if (answer) {
-                                b_auth_failed = !httpdAuthOk(url->psz_user,
-                                   url->psz_password,
-                                   httpd_MsgGet(query, "Authorization")); /* BASIC id */
-                                if (b_auth_failed)
-                                   break;
-                            }
-
-                            if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
-                                continue;
-
-                            if (answer->i_proto == HTTPD_PROTO_NONE)
-                                cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
-                            else
-                                cl->i_buffer = -1;
-
-                            /* only one url can answer */
-                            answer = NULL;
-                            if (!cl->url)
-                                cl->url = url;
-                        }
-
-                        if (answer) {
-                            answer->i_proto  = query->i_proto;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-
-                           if (b_auth_failed) {
-                                httpd_MsgAdd(answer, "WWW-Authenticate",
-                                        "Basic realm=\"VLC stream\"");
-                                answer->i_status = 401;
-                            } else
-                                answer->i_status = 404; /* no url registered */
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, answer->i_status,
-                                    query->psz_url);
-                            answer->p_body = (uint8_t *)p;
-
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
-                            httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
-                        }
+                        /* only one url can answer */
+                        answer = NULL;
+                        if (!cl->url)
+                            cl->url = url;
+                    }
 
-                        cl->i_state = HTTPD_CLIENT_SENDING;
+                    if (answer) {
+                        answer->i_proto  = query->i_proto;
+                        answer->i_type   = HTTPD_MSG_ANSWER;
+                        answer->i_version= 0;
+
+                       if (b_auth_failed) {
+                            httpd_MsgAdd(answer, "WWW-Authenticate",
+                                    "Basic realm=\"VLC stream\"");
+                            answer->i_status = 401;
+                        } else
+                            answer->i_status = 404; /* no url registered */
+
+                        char *p;
+                        answer->i_body = httpd_HtmlError (&p, answer->i_status,
+                                query->psz_url);
+                        answer->p_body = (uint8_t *)p;
+
+                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                        httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+                        httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
                     }
+
+                    cl->i_state = HTTPD_CLIENT_SENDING;
                 }
-                break;
             }
+            break;
+        }
 
-            case HTTPD_CLIENT_SEND_DONE:
-                if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
-                    const char *psz_connection = httpd_MsgGet(&cl->answer, "Connection");
-                    const char *psz_query = httpd_MsgGet(&cl->query, "Connection");
-                    bool b_connection = false;
-                    bool b_keepalive = false;
-                    bool b_query = false;
-
-                    cl->url = NULL;
-                    if (psz_connection) {
-                        b_connection = (strcasecmp(psz_connection, "Close") == 0);
-                        b_keepalive = (strcasecmp(psz_connection, "Keep-Alive") == 0);
-                    }
-
-                    if (psz_query)
-                        b_query = (strcasecmp(psz_query, "Close") == 0);
-
-                    if (((cl->query.i_proto == HTTPD_PROTO_HTTP) &&
-                                ((cl->query.i_version == 0 && b_keepalive) ||
-                                  (cl->query.i_version == 1 && !b_connection))) ||
-                            ((cl->query.i_proto == HTTPD_PROTO_RTSP) &&
-                              !b_query && !b_connection)) {
-                        httpd_MsgClean(&cl->query);
-                        httpd_MsgInit(&cl->query);
-
-                        cl->i_buffer = 0;
-                        cl->i_buffer_size = 1000;
-                        free(cl->p_buffer);
-                        cl->p_buffer = xmalloc(cl->i_buffer_size);
-                        cl->i_state = HTTPD_CLIENT_RECEIVING;
-                    } else
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                    httpd_MsgClean(&cl->answer);
-                } else {
-                    i_offset = cl->answer.i_body_offset;
-                    httpd_MsgClean(&cl->answer);
+        case HTTPD_CLIENT_SEND_DONE:
+            if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
+                const char *psz_connection = httpd_MsgGet(&cl->answer, "Connection");
+                const char *psz_query = httpd_MsgGet(&cl->query, "Connection");
+                bool b_connection = false;
+                bool b_keepalive = false;
+                bool b_query = false;
+
+                cl->url = NULL;
+                if (psz_connection) {
+                    b_connection = (strcasecmp(psz_connection, "Close") == 0);
+                    b_keepalive = (strcasecmp(psz_connection, "Keep-Alive") == 0);
+                }
 
-                    cl->answer.i_body_offset = i_offset;
-                    free(cl->p_buffer);
-                    cl->p_buffer = NULL;
-                    cl->i_buffer = 0;
-                    cl->i_buffer_size = 0;
+                if (psz_query)
+                    b_query = (strcasecmp(psz_query, "Close") == 0);
 
-                    cl->i_state = HTTPD_CLIENT_WAITING;
-                }
-                break;
+                if (((cl->query.i_proto == HTTPD_PROTO_HTTP) &&
+                            ((cl->query.i_version == 0 && b_keepalive) ||
+                              (cl->query.i_version == 1 && !b_connection))) ||
+                        ((cl->query.i_proto == HTTPD_PROTO_RTSP) &&
+                          !b_query && !b_connection)) {
+                    httpd_MsgClean(&cl->query);
+                    httpd_MsgInit(&cl->query);
 
-            case HTTPD_CLIENT_WAITING:
+                    cl->i_buffer = 0;
+                    cl->i_buffer_size = 1000;
+                    free(cl->p_buffer);
+                    cl->p_buffer = xmalloc(cl->i_buffer_size);
+                    cl->i_state = HTTPD_CLIENT_RECEIVING;
+                } else
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                httpd_MsgClean(&cl->answer);
+            } else {
                 i_offset = cl->answer.i_body_offset;
-                int i_msg = cl->query.i_type;
+                httpd_MsgClean(&cl->answer);
 
-                httpd_MsgInit(&cl->answer);
                 cl->answer.i_body_offset = i_offset;
+                free(cl->p_buffer);
+                cl->p_buffer = NULL;
+                cl->i_buffer = 0;
+                cl->i_buffer_size = 0;
 
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                        &cl->answer, &cl->query);
-                if (cl->answer.i_type != HTTPD_MSG_NONE) {
-                    /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
+                cl->i_state = HTTPD_CLIENT_WAITING;
+            }
+            break;
+
+        case HTTPD_CLIENT_WAITING:
+            i_offset = cl->answer.i_body_offset;
+            int i_msg = cl->query.i_type;
+
+            httpd_MsgInit(&cl->answer);
+            cl->answer.i_body_offset = i_offset;
+
+            cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
+                    &cl->answer, &cl->query);
+            if (cl->answer.i_type != HTTPD_MSG_NONE) {
+                /* we have new data, so re-enter send mode */
+                cl->i_buffer      = 0;
+                cl->p_buffer      = cl->answer.p_body;
+                cl->i_buffer_size = cl->answer.i_body;
+                cl->answer.p_body = NULL;
+                cl->answer.i_body = 0;
+                cl->i_state = HTTPD_CLIENT_SENDING;
+            }
+    }
+    return events;
+}
+
+/** Checks whether a client needs to be destroyed. */
+static bool httpd_ClientIsDead(const httpd_client_t *cl, mtime_t now)
+{
+    return cl->i_ref < 0 || (cl->i_ref == 0 &&
+                (cl->i_state == HTTPD_CLIENT_DEAD ||
+                  (cl->i_activity_timeout > 0 &&
+                    cl->i_activity_date+cl->i_activity_timeout < now)));
+}
+
+/**
+ * Advances the state of a client until it needs to wait, either for its
+ * socket (the poll events are returned), or for stream data or destruction
+ * (zero is returned).
+ */
+static short httpd_ClientAdvance(httpd_host_t *host, httpd_client_t *cl)
+{
+    short events;
+    uint8_t state;
+
+    do {
+        state = cl->i_state;
+        events = httpd_ClientPrepare(host, cl);
+    } while (events == 0 && cl->i_state != state);
+
+    return events;
+}
+
+/** Handles socket readiness for a client. */
+static void httpd_ClientProcess(httpd_client_t *cl, mtime_t now)
+{
+    cl->i_activity_date = now;
+
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
+        case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
+        case HTTPD_CLIENT_TLS_HS_IN:
+        case HTTPD_CLIENT_TLS_HS_OUT: httpd_ClientTlsHandshake(cl); break;
+    }
+}
+
+/** Destroys a client (the host lock must be held). */
+static void httpd_HostRemove(httpd_host_t *host, httpd_client_t *cl);
+
+/** Accepts a new connection on a listening socket. */
+static httpd_client_t *httpd_HostAccept(httpd_host_t *host, int fd,
+                                        mtime_t now)
+{
+    httpd_client_t *cl;
+
+    fd = vlc_accept (fd, NULL, NULL, true);
+    if (fd == -1)
+        return NULL;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+            &(int){ 1 }, sizeof(int));
+
+    vlc_tls_t *p_tls;
+
+    if (host->p_tls != NULL)
+    {
+        const char *alpn[] = { "http/1.1", NULL };
+
+        p_tls = vlc_tls_SessionCreate(host->p_tls, fd, NULL, alpn);
+    }
+    else
+        p_tls = NULL;
+
+    cl = httpd_ClientNew(fd, p_tls, now);
+    if (unlikely(cl == NULL)) {
+        if (p_tls != NULL)
+            vlc_tls_SessionDelete(p_tls);
+        net_Close(fd);
+        return NULL;
+    }
+
+    TAB_APPEND(host->i_client, host->client, cl);
+    return cl;
+}
+
+/** Waits until at least one URL is registered. */
+static void httpd_HostWaitUrl(httpd_host_t *host)
+{
+    while (host->i_url <= 0) {
+        mutex_cleanup_push(&host->lock);
+        vlc_cond_wait(&host->wait, &host->lock);
+        vlc_cleanup_pop();
+    }
+}
+
+static void httpdLoop(httpd_host_t *host)
+{
+    struct pollfd ufd[host->nfd + host->i_client];
+    unsigned nfd;
+    for (nfd = 0; nfd < host->nfd; nfd++) {
+        ufd[nfd].fd = host->fds[nfd];
+        ufd[nfd].events = POLLIN;
+        ufd[nfd].revents = 0;
+    }
+
+    /* add all socket that should be read/write and close dead connection */
+    httpd_HostWaitUrl(host);
+
+    mtime_t now = mdate();
+    bool b_low_delay = false;
+
+    int canc = vlc_savecancel();
+    for (int i_client = 0; i_client < host->i_client; i_client++) {
+        httpd_client_t *cl = host->client[i_client];
+        if (httpd_ClientIsDead(cl, now)) {
+            httpd_HostRemove(host, cl);
+            i_client--;
+            continue;
         }
 
+        struct pollfd *pufd = ufd + nfd;
+        assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
+
+        pufd->fd = cl->fd;
+        pufd->events = httpd_ClientAdvance(host, cl);
+        pufd->revents = 0;
+
         if (pufd->events != 0)
             nfd++;
         else
@@ -2015,19 +2577,11 @@ static void httpdLoop(httpd_host_t *host)
         if (pufd->revents == 0)
             continue; // no event received
 
-        cl->i_activity_date = now;
-
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
-            case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
-            case HTTPD_CLIENT_TLS_HS_IN:
-            case HTTPD_CLIENT_TLS_HS_OUT: httpd_ClientTlsHandshake(cl); break;
-        }
+        httpd_ClientProcess(cl, now);
     }
 
     /* Handle server sockets (accept new connections) */
     for (nfd = 0; nfd < host->nfd; nfd++) {
-        httpd_client_t *cl;
         int fd = ufd[nfd].fd;
 
         assert (fd == host->fds[nfd]);
@@ -2035,31 +2589,221 @@ static void httpdLoop(httpd_host_t *host)
         if (ufd[nfd].revents == 0)
             continue;
 
-        /* */
-        fd = vlc_accept (fd, NULL, NULL, true);
-        if (fd == -1)
-            continue;
-        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                &(int){ 1 }, sizeof(int));
+        httpd_HostAccept(host, fd, now);
+    }
+
+    vlc_restorecancel(canc);
+}
 
-        vlc_tls_t *p_tls;
+/*
+ * The epoll loop does not visit every client on each wake-up. A client is
+ * only advanced when it is scheduled: when its state changed after socket
+ * I/O, when it was accepted or force-closed, when its inactivity timer
+ * expired, and while it waits for stream data (HTTPD_CLIENT_WAITING).
+ * Clients are only destroyed by the host thread, before it waits, so the
+ * client pointers of the epoll events are always valid.
+ */
+
+/** Schedules a client for the next iteration of the epoll loop. */
+static void httpd_HostSchedule(httpd_host_t *host, httpd_client_t *cl)
+{
+    if (host->epfd == -1 || cl->b_ready)
+        return; /* the poll loop visits all clients anyway */
 
-        if (host->p_tls != NULL)
-        {
-            const char *alpn[] = { "http/1.1", NULL };
+    cl->b_ready = true;
+    cl->p_ready_next = host->p_ready;
+    host->p_ready = cl;
+}
+
+static mtime_t httpd_ClientDeadline(const httpd_client_t *cl)
+{
+    return cl->i_activity_date + cl->i_activity_timeout;
+}
+
+static void httpd_TimerRemove(httpd_host_t *host, httpd_client_t *cl)
+{
+    if (!cl->b_timer)
+        return;
+
+    if (cl->p_timer_prev != NULL)
+        cl->p_timer_prev->p_timer_next = cl->p_timer_next;
+    else
+        host->p_timer_first = cl->p_timer_next;
+    if (cl->p_timer_next != NULL)
+        cl->p_timer_next->p_timer_prev = cl->p_timer_prev;
+    else
+        host->p_timer_last = cl->p_timer_prev;
+    cl->b_timer = false;
+}
+
+/** (Re)arms the inactivity timer of a client after some activity. */
+static void httpd_TimerUpdate(httpd_host_t *host, httpd_client_t *cl)
+{
+    httpd_TimerRemove(host, cl);
+    if (host->epfd == -1 || cl->i_activity_timeout <= 0)
+        return;
+
+    /* All clients have the same timeout: search from the latest deadline */
+    mtime_t deadline = httpd_ClientDeadline(cl);
+    httpd_client_t *prev = host->p_timer_last;
+
+    while (prev != NULL && httpd_ClientDeadline(prev) > deadline)
+        prev = prev->p_timer_prev;
+
+    cl->p_timer_prev = prev;
+    cl->p_timer_next = (prev != NULL) ? prev->p_timer_next
+                                      : host->p_timer_first;
+    if (prev != NULL)
+        prev->p_timer_next = cl;
+    else
+        host->p_timer_first = cl;
+    if (cl->p_timer_next != NULL)
+        cl->p_timer_next->p_timer_prev = cl;
+    else
+        host->p_timer_last = cl;
+    cl->b_timer = true;
+}
+
+static void httpd_HostRemove(httpd_host_t *host, httpd_client_t *cl)
+{
+    assert(!cl->b_ready);
+    httpd_TimerRemove(host, cl);
+    /* closing the socket also removes it from the epoll set */
+    httpd_ClientClean(cl);
+    TAB_REMOVE(host->i_client, host->client, cl);
+    free(cl);
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/* Maximum number of events handled per wake-up */
+#define HTTPD_EPOLL_EVENTS 64
+
+/** Updates the epoll interest of a client. */
+static int httpd_ClientWatch(httpd_host_t *host, httpd_client_t *cl,
+                             short events)
+{
+    if (events == cl->i_poll_events)
+        return 0;
+
+    struct epoll_event cev = {
+        .events = ((events & POLLIN) ? EPOLLIN : 0)
+                | ((events & POLLOUT) ? EPOLLOUT : 0),
+        .data.ptr = cl,
+    };
+    int op = (cl->i_poll_events == 0) ? EPOLL_CTL_ADD
+           : (events == 0) ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+
+    if (epoll_ctl(host->epfd, op, cl->fd, &cev)) {
+        msg_Err(host, "cannot watch client socket: %s",
+                vlc_strerror_c(errno));
+        return -1;
+    }
+    cl->i_poll_events = events;
+    return 0;
+}
+
+/**
+ * Host loop using a persistent epoll set: client sockets stay registered
+ * across iterations, and only the scheduled clients are visited.
+ */
+static void httpdLoopEpoll(httpd_host_t *host)
+{
+    struct epoll_event ev[HTTPD_EPOLL_EVENTS];
+
+    httpd_HostWaitUrl(host);
+
+    mtime_t now = mdate();
+    int canc = vlc_savecancel();
+
+    /* Expired clients are destroyed with the scheduled ones */
+    while (host->p_timer_first != NULL
+        && httpd_ClientDeadline(host->p_timer_first) < now) {
+        httpd_client_t *cl = host->p_timer_first;
+
+        httpd_TimerRemove(host, cl);
+        httpd_HostSchedule(host, cl);
+    }
 
-            p_tls = vlc_tls_SessionCreate(host->p_tls, fd, NULL, alpn);
+    /* Only the clients waiting for stream data stay scheduled */
+    for (httpd_client_t **pp = &host->p_ready, *cl; (cl = *pp) != NULL;) {
+        short events = 0;
+
+        if (!httpd_ClientIsDead(cl, now)) {
+            events = httpd_ClientAdvance(host, cl);
+            if (httpd_ClientWatch(host, cl, events))
+                cl->i_state = HTTPD_CLIENT_DEAD;
         }
-        else
-            p_tls = NULL;
 
-        cl = httpd_ClientNew(fd, p_tls, now);
+        if (events != 0 || httpd_ClientIsDead(cl, now)) {
+            *pp = cl->p_ready_next;
+            cl->b_ready = false;
+            if (events == 0)
+                httpd_HostRemove(host, cl);
+        } else
+            pp = &cl->p_ready_next;
+    }
+
+    /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
+    int timeout = -1;
+
+    if (host->p_ready != NULL)
+        timeout = 20;
+    else if (host->p_timer_first != NULL) {
+        mtime_t delay = httpd_ClientDeadline(host->p_timer_first) - now;
+
+        timeout = (delay + 999) / 1000;
+        if (timeout < 0)
+            timeout = 0;
+    }
+
+    vlc_mutex_unlock(&host->lock);
+    vlc_restorecancel(canc);
+
+    int ret = epoll_wait(host->epfd, ev, HTTPD_EPOLL_EVENTS, timeout);
 
-        TAB_APPEND(host->i_client, host->client, cl);
+    canc = vlc_savecancel();
+    vlc_mutex_lock(&host->lock);
+    switch(ret) {
+        case -1:
+            if (errno != EINTR) {
+                /* Kernel on low memory or a bug: pace */
+                msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+                msleep(100000);
+            }
+        case 0:
+            vlc_restorecancel(canc);
+            return;
+    }
+
+    now = mdate();
+
+    for (int i = 0; i < ret; i++) {
+        int *pfd = ev[i].data.ptr;
+
+        /* Handle server sockets (accept new connections) */
+        if (pfd >= host->fds && pfd < host->fds + host->nfd) {
+            httpd_client_t *cl = httpd_HostAccept(host, *pfd, now);
+            if (cl != NULL) {
+                httpd_TimerUpdate(host, cl);
+                httpd_HostSchedule(host, cl);
+            }
+            continue;
+        }
+
+        /* Handle client sockets. A client closed by httpd_UrlDelete()
+         * meanwhile is dead, and is left alone. */
+        httpd_client_t *cl = ev[i].data.ptr;
+        uint8_t state = cl->i_state;
+
+        httpd_ClientProcess(cl, now);
+        httpd_TimerUpdate(host, cl);
+        if (cl->i_state != state)
+            httpd_HostSchedule(host, cl);
     }
 
     vlc_restorecancel(canc);
 }
+#endif
 
 static void* httpd_HostThread(void *data)
 {
@@ -2067,7 +2811,12 @@ static void* httpd_HostThread(void *data)
 
     vlc_mutex_lock(&host->lock);
     while (host->i_ref > 0)
-        httpdLoop(host);
+#ifdef HAVE_SYS_EPOLL_H
+        if (host->epfd != -1)
+            httpdLoopEpoll(host);
+        else
+#endif
+            httpdLoop(host);
     vlc_mutex_unlock(&host->lock);
     return NULL;
 }
@@ -216,7 +216,7 @@ int *net_Listen (vlc_object_t *p_this, const char *psz_host,
             net_Close (fd);
     }
 
-    freeaddrinfo (res);
+    vlc_freeaddrinfo (res);
 
     if (sockv != NULL)
         sockv[sockc] = -1;
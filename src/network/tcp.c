@@ -59,6 +59,191 @@ static int SocksHandshakeTCP( vlc_object_t *,
 extern int net_Socket( vlc_object_t *p_this, int i_family, int i_socktype,
                        int i_protocol );
 
+/* Delay before racing the next address while a connection is pending
+ * (the RFC 8305 "Connection Attempt Delay") in milliseconds */
+#define NET_CONNECT_DELAY 250
+/* Maximum number of concurrently pending connection attempts */
+#define NET_CONNECT_MAX   8
+
+/**
+ * Orders resolved addresses so that address families alternate, starting
+ * with the preferred (first) one, as per RFC 8305 section 4.
+ * @return the number of addresses in the table (to be freed)
+ */
+static size_t net_SortAddresses (struct addrinfo *res,
+                                 struct addrinfo ***restrict tabp)
+{
+    size_t count = 0;
+
+    for (struct addrinfo *ptr = res; ptr != NULL; ptr = ptr->ai_next)
+        count++;
+
+    struct addrinfo **tab = malloc (count * sizeof (*tab));
+    if (unlikely(tab == NULL))
+        return 0;
+
+    struct addrinfo *first = res, *other = res;
+    size_t n = 0;
+
+    while (n < count)
+    {
+        while (first != NULL && first->ai_family != res->ai_family)
+            first = first->ai_next;
+        while (other != NULL && other->ai_family == res->ai_family)
+            other = other->ai_next;
+
+        if (first != NULL)
+        {
+            tab[n++] = first;
+            first = first->ai_next;
+        }
+        if (other != NULL)
+        {
+            tab[n++] = other;
+            other = other->ai_next;
+        }
+    }
+
+    *tabp = tab;
+    return count;
+}
+
+/**
+ * Connects to the first reachable of a list of addresses. A new attempt
+ * is started whenever the pending ones have not completed within
+ * NET_CONNECT_DELAY, so that unreachable addresses (typically broken IPv6
+ * connectivity) do not stall the connection for the whole timeout.
+ * @param timeout per-attempt timeout in milliseconds, or -1 for none
+ * @return the connected socket, or -1 on error.
+ */
+static int net_ConnectRace (vlc_object_t *p_this, struct addrinfo *res,
+                            int timeout)
+{
+    struct addrinfo **tab;
+    size_t count = net_SortAddresses (res, &tab);
+    if (count == 0)
+        return -1;
+
+    struct pollfd ufd[NET_CONNECT_MAX];
+    mtime_t deadline[NET_CONNECT_MAX];
+    unsigned pending = 0;
+    size_t next = 0;
+    int i_handle = -1;
+
+    while (i_handle == -1 && (next < count || pending > 0))
+    {
+        if (vlc_killed())
+            break;
+
+        if (next < count && pending < NET_CONNECT_MAX)
+        {
+            const struct addrinfo *ptr = tab[next++];
+            int fd = net_Socket( p_this, ptr->ai_family,
+                                 ptr->ai_socktype, ptr->ai_protocol );
+            if( fd == -1 )
+            {
+                msg_Dbg( p_this, "socket error: %s",
+                         vlc_strerror_c(net_errno) );
+                continue;
+            }
+
+            if( connect( fd, ptr->ai_addr, ptr->ai_addrlen ) == 0 )
+            {
+                i_handle = fd;
+                break;
+            }
+
+            if( net_errno != EINPROGRESS && errno != EINTR )
+            {
+                msg_Err( p_this, "connection failed: %s",
+                         vlc_strerror_c(net_errno) );
+                net_Close( fd );
+                continue;
+            }
+
+            ufd[pending].fd = fd;
+            ufd[pending].events = POLLOUT;
+            deadline[pending] = (timeout >= 0)
+                ? mdate() + timeout * INT64_C(1000) : INT64_MAX;
+            pending++;
+        }
+
+        if (pending == 0)
+            continue;
+
+        /* Wait until an attempt completes or times out, or until it is
+         * time to start racing the next address */
+        mtime_t now = mdate();
+        int delay = -1;
+
+        if (next < count && pending < NET_CONNECT_MAX)
+            delay = NET_CONNECT_DELAY;
+        for (unsigned i = 0; i < pending; i++)
+            if (deadline[i] != INT64_MAX)
+            {
+                mtime_t left = (deadline[i] - now) / 1000;
+                if (left < 0)
+                    left = 0;
+                if (delay < 0 || left < delay)
+                    delay = left;
+            }
+
+        if (vlc_poll_i11e(ufd, pending, delay) < 0)
+        {
+            if (errno != EINTR)
+                msg_Err (p_this, "polling error: %s",
+                         vlc_strerror_c(net_errno));
+            break;
+        }
+
+        now = mdate();
+        for (unsigned i = 0; i < pending;)
+        {
+            int fd = ufd[i].fd;
+
+            if (ufd[i].revents)
+            {
+                int val;
+
+                /* There is NO WAY around checking SO_ERROR.
+                 * Don't ifdef it out!!! */
+                if (getsockopt (fd, SOL_SOCKET, SO_ERROR, &val,
+                                &(socklen_t){ sizeof (val) }))
+                    val = net_errno;
+                if (val == 0)
+                {
+                    i_handle = fd;
+                    ufd[i] = ufd[--pending];
+                    deadline[i] = deadline[pending];
+                    break;
+                }
+                msg_Err (p_this, "connection failed: %s",
+                         vlc_strerror_c(val));
+            }
+            else if (deadline[i] > now)
+            {
+                i++;
+                continue;
+            }
+            else
+                msg_Warn (p_this, "connection timed out");
+
+            net_Close (fd);
+            ufd[i] = ufd[--pending];
+            deadline[i] = deadline[pending];
+        }
+    }
+
+    /* Abandon the attempts that lost the race */
+    while (pending > 0)
+        net_Close (ufd[--pending].fd);
+    free (tab);
+
+    if (i_handle != -1)
+        msg_Dbg( p_this, "connection succeeded (socket = %d)", i_handle );
+    return i_handle;
+}
+
 #undef net_Connect
 /*****************************************************************************
  * net_Connect:
@@ -141,71 +326,8 @@ int net_Connect( vlc_object_t *p_this, const char *psz_host, int i_port,
     if (timeout < 0)
         timeout = -1;
 
-    for (struct addrinfo *ptr = res; ptr != NULL; ptr = ptr->ai_next)
-    {
-        int fd = net_Socket( p_this, ptr->ai_family,
-                             ptr->ai_socktype, ptr->ai_protocol );
-        if( fd == -1 )
-        {
-            msg_Dbg( p_this, "socket error: %s", vlc_strerror_c(net_errno) );
-            continue;
-        }
-
-        if( connect( fd, ptr->ai_addr, ptr->ai_addrlen ) )
-        {
-            if( net_errno != EINPROGRESS && errno != EINTR )
-            {
-                msg_Err( p_this, "connection failed: %s",
-                         vlc_strerror_c(net_errno) );
-                goto next_ai;
-            }
-
-            struct pollfd ufd;
-
-            ufd.fd = fd;
-            ufd.events = POLLOUT;
-
-            do  /* NOTE: timeout screwed up if we catch a signal (EINTR) */
-            {
-                if (vlc_killed())
-                    goto next_ai;
-
-                val = vlc_poll_i11e(&ufd, 1, timeout);
-            }
-            while (val == -1 && errno == EINTR);
-
-            switch (val)
-            {
-                 case -1: /* error */
-                     msg_Err (p_this, "polling error: %s",
-                              vlc_strerror_c(net_errno));
-                     goto next_ai;
-
-                 case 0: /* timeout */
-                     msg_Warn (p_this, "connection timed out");
-                     goto next_ai;
-            }
-
-            /* There is NO WAY around checking SO_ERROR.
-             * Don't ifdef it out!!! */
-            if (getsockopt (fd, SOL_SOCKET, SO_ERROR, &val,
-                            &(socklen_t){ sizeof (val) }) || val)
-            {
-                msg_Err (p_this, "connection failed: %s",
-                         vlc_strerror_c(val));
-                goto next_ai;
-            }
-        }
-
-        msg_Dbg( p_this, "connection succeeded (socket = %d)", fd );
-        i_handle = fd; /* success! */
-        break;
-
-next_ai: /* failure */
-        net_Close( fd );
-    }
-
-    freeaddrinfo( res );
+    i_handle = net_ConnectRace (p_this, res, timeout);
+    vlc_freeaddrinfo( res );
 
     if( i_handle == -1 )
         return -1;
@@ -440,7 +562,7 @@ static int SocksHandshakeTCP( vlc_object_t *p_obj,
         SetWBE( &buffer[2], i_port );   /* Port */
         memcpy (&buffer[4],             /* Address */
                 &((struct sockaddr_in *)(res->ai_addr))->sin_addr, 4);
-        freeaddrinfo (res);
+        vlc_freeaddrinfo (res);
 
         buffer[8] = 0;                  /* Empty user id */
 
@@ -195,7 +195,7 @@ static int net_ListenSingle (vlc_object_t *obj, const char *host, int port,
         break;
     }
 
-    freeaddrinfo (res);
+    vlc_freeaddrinfo (res);
     return val;
 }
 
@@ -580,7 +580,7 @@ int net_ConnectDgram( vlc_object_t *p_this, const char *psz_host, int i_port,
         net_Close( fd );
     }
 
-    freeaddrinfo( res );
+    vlc_freeaddrinfo( res );
 
     if( i_handle == -1 )
     {
@@ -628,7 +628,7 @@ int net_OpenDgram( vlc_object_t *obj, const char *psz_bind, int i_bind,
     {
         msg_Err (obj, "cannot resolve %s port %d : %s", psz_bind, i_bind,
                  gai_strerror (val));
-        freeaddrinfo (rem);
+        vlc_freeaddrinfo (rem);
         return -1;
     }
 
@@ -671,8 +671,8 @@ int net_OpenDgram( vlc_object_t *obj, const char *psz_bind, int i_bind,
         net_Close (fd);
     }
 
-    freeaddrinfo (rem);
-    freeaddrinfo (loc);
+    vlc_freeaddrinfo (rem);
+    vlc_freeaddrinfo (loc);
     return val;
 }
 
@@ -229,6 +229,8 @@ playlist_t *playlist_Create( vlc_object_t *p_parent )
     pl_priv(p_playlist)->b_reset_currently_playing = true;
 
     pl_priv(p_playlist)->b_tree = var_InheritBool( p_parent, "playlist-tree" );
+    pl_priv(p_playlist)->search.psz_string = NULL;
+    atomic_init( &pl_priv(p_playlist)->search.b_stale, false );
 
     /* Create the root, playing items and meida library nodes */
     playlist_item_t *root, *playing, *ml;
@@ -278,6 +280,7 @@ playlist_t *playlist_Create( vlc_object_t *p_parent )
     p->p_input_resource = input_resource_New( VLC_OBJECT( p_playlist ) );
     if( unlikely(p->p_input_resource == NULL) )
         abort();
+    TAB_INIT( p->i_standby, p->pp_standby );
 
     /* Audio output (needed for volume and device controls). */
     audio_output_t *aout = input_resource_GetAout( p->p_input_resource );
@@ -331,6 +334,8 @@ void playlist_Destroy( playlist_t *p_playlist )
 
     /* Release input resources */
     assert( p_sys->p_input == NULL );
+    assert( p_sys->i_standby == 0 );
+    TAB_CLEAN( p_sys->i_standby, p_sys->pp_standby );
     input_resource_Release( p_sys->p_input_resource );
 
     if( p_playlist->p_media_library != NULL )
@@ -362,6 +367,7 @@ void playlist_Destroy( playlist_t *p_playlist )
 
     ARRAY_RESET( p_playlist->items );
     ARRAY_RESET( p_playlist->current );
+    free( p_sys->search.psz_string );
 
     vlc_http_cookie_jar_t *cookies = var_GetAddress( p_playlist, "http-cookies" );
     if ( cookies )
@@ -38,6 +38,7 @@
 #include "libvlc.h"
 #include "art.h"
 #include "fetcher.h"
+#include "metacache.h"
 #include "input/input_interface.h"
 
 /*****************************************************************************
@@ -81,6 +82,7 @@ struct playlist_fetcher_t
 
     DECL_ARRAY(playlist_album_t) albums;
     meta_fetcher_scope_t e_scope;
+    bool            b_cache; /* save the art found to the meta cache */
 };
 
 static void *Thread( void * );
@@ -105,6 +107,7 @@ playlist_fetcher_t *playlist_fetcher_New( vlc_object_t *parent )
         b_access = ( var_InheritInteger( parent, "album-art" ) == ALBUM_ART_ALL );
 
     p_fetcher->e_scope = ( b_access ) ? FETCHER_SCOPE_ANY : FETCHER_SCOPE_LOCAL;
+    p_fetcher->b_cache = var_InheritBool( parent, "meta-cache" );
 
     memset( p_fetcher->p_waiting_head, 0, PASS_COUNT * sizeof(fetcher_entry_t *) );
     memset( p_fetcher->p_waiting_tail, 0, PASS_COUNT * sizeof(fetcher_entry_t *) );
@@ -464,7 +467,7 @@ static void *Thread( void *p_data )
         meta_fetcher_scope_t e_prev_scope = p_fetcher->e_scope;
 
         /* scope override */
-        switch ( p_entry->i_options ) {
+        switch ( p_entry->i_options & META_REQUEST_OPTION_SCOPE_ANY ) {
         case META_REQUEST_OPTION_SCOPE_ANY:
             p_fetcher->e_scope = FETCHER_SCOPE_ANY;
             break;
@@ -536,6 +539,9 @@ static void *Thread( void *p_data )
                 msg_Dbg( obj, "found art for %s in cache", psz_name );
                 input_item_SetArtFetched( p_entry->p_item, true );
                 var_SetAddress( obj, "item-change", p_entry->p_item );
+                if( p_fetcher->b_cache
+                 && input_item_IsPreparsed( p_entry->p_item ) )
+                    playlist_SaveMetaToCache( p_entry->p_item );
             }
             else
             {
@@ -68,7 +68,15 @@ static void input_item_add_subitem_tree ( const vlc_event_t * p_event,
     bool b_stop = p_item->i_flags & PLAYLIST_SUBITEM_STOP_FLAG;
     bool b_flat = false;
 
-    p_item->i_flags &= ~PLAYLIST_SUBITEM_STOP_FLAG;
+    /* A partial tree is followed by more sub-items of the same item: it is
+     * only inserted, and the item is kept until the last tree, which also
+     * controls the playback for all the sub-items. */
+    const bool b_partial = p_new_root->b_partial;
+    playlist_item_t *p_source = p_item;
+    int i_partial = p_item->i_partial;
+
+    if( !b_partial )
+        p_item->i_flags &= ~PLAYLIST_SUBITEM_STOP_FLAG;
 
     /* We will have to flatten the tree out if we are in "the playlist" node and
     the user setting demands flat playlist */
@@ -89,7 +97,7 @@ static void input_item_add_subitem_tree ( const vlc_event_t * p_event,
     int pos = 0;
 
     /* If we have to flatten out, then take the item's position in the parent as
-    insertion point and delete the item */
+    insertion point and delete the item (after the last partial tree) */
 
     if( b_flat )
     {
@@ -107,7 +115,8 @@ static void input_item_add_subitem_tree ( const vlc_event_t * p_event,
         }
         assert( i < p_parent->i_children );
 
-        playlist_DeleteItem( p_playlist, p_item, true );
+        if( !b_partial )
+            playlist_DeleteItem( p_playlist, p_item, true );
 
         p_item = p_parent;
     }
@@ -126,7 +135,20 @@ static void input_item_add_subitem_tree ( const vlc_event_t * p_event,
                                                  pos,
                                                  b_flat );
 
-    if( !b_flat ) var_SetInteger( p_playlist, "leaf-to-parent", p_item->i_id );
+    if( !b_flat && i_partial == 0 )
+        var_SetInteger( p_playlist, "leaf-to-parent", p_item->i_id );
+
+    if( b_partial )
+    {
+        p_source->i_partial += last_pos - pos;
+        PL_UNLOCK;
+        return;
+    }
+
+    /* Account for the sub-items inserted before (they precede this tree) */
+    pos -= i_partial;
+    if( !b_flat )
+        p_source->i_partial = 0;
 
     //control playback only if it was the current playing item that got subitems
     if( b_current )
@@ -193,6 +215,8 @@ static void input_item_changed( const vlc_event_t * p_event,
 {
     playlist_item_t *p_item = user_data;
     VLC_UNUSED( p_event );
+    /* The item may now match the live search */
+    atomic_store( &pl_priv(p_item->p_playlist)->search.b_stale, true );
     var_SetAddress( p_item->p_playlist, "item-change", p_item->p_input );
 }
 
@@ -252,6 +276,7 @@ playlist_item_t *playlist_ItemNewFromInput( playlist_t *p_playlist,
 
     p_item->p_parent = NULL;
     p_item->i_children = -1;
+    p_item->i_partial = 0;
     p_item->pp_children = NULL;
     p_item->i_nb_played = 0;
     p_item->i_flags = 0;
@@ -522,6 +547,91 @@ end:
     return p_item;
 }
 
+/**
+ * Add input items to a given node, in one go
+ *
+ * This is equivalent to a playlist_NodeAddInput() call per input item, but
+ * the playlist lock is taken, the node grown and the playlist engine woken
+ * up only once. Only the first item is played with PLAYLIST_GO.
+ *
+ * \param p_playlist the playlist to add into
+ * \param pp_inputs the input items to add
+ * \param i_inputs the number of input items
+ * \param p_parent the parent item to add into
+ * \param i_mode the mode used when adding
+ * \param i_pos the position in the node where to add. If this is
+ *        PLAYLIST_END the items will be added at the end of the node
+ * \param b_locked TRUE if the playlist is locked
+ * \return the number of items added
+ */
+int playlist_NodeAddInputs( playlist_t *p_playlist,
+                            input_item_t *const *pp_inputs, int i_inputs,
+                            playlist_item_t *p_parent, int i_mode, int i_pos,
+                            bool b_locked )
+{
+    assert( p_parent && p_parent->i_children != -1 );
+    if( i_inputs <= 0 )
+        return 0;
+
+    playlist_item_t **pp_items = malloc( i_inputs * sizeof( *pp_items ) );
+    if( unlikely(pp_items == NULL) )
+        return 0;
+
+    PL_LOCK_IF( !b_locked );
+
+    int i_added = 0;
+    while( i_added < i_inputs )
+    {
+        playlist_item_t *p_item =
+            playlist_ItemNewFromInput( p_playlist, pp_inputs[i_added] );
+        if( p_item == NULL )
+            break;
+        pp_items[i_added++] = p_item;
+    }
+
+    if( i_pos == PLAYLIST_END )
+        i_pos = p_parent->i_children;
+    assert( i_pos <= p_parent->i_children );
+
+    playlist_item_t **pp_children = realloc( p_parent->pp_children,
+        ( p_parent->i_children + i_added ) * sizeof( *pp_children ) );
+    if( unlikely(pp_children == NULL) )
+    {
+        for( int i = 0; i < i_added; i++ )
+            playlist_ItemRelease( pp_items[i] );
+        i_added = 0;
+        goto end;
+    }
+    memmove( pp_children + i_pos + i_added, pp_children + i_pos,
+             ( p_parent->i_children - i_pos ) * sizeof( *pp_children ) );
+    memcpy( pp_children + i_pos, pp_items, i_added * sizeof( *pp_children ) );
+    p_parent->pp_children = pp_children;
+    p_parent->i_children += i_added;
+    /* A refined live search would not look into a disabled node */
+    if( p_parent->i_flags & PLAYLIST_DBL_FLAG )
+        atomic_store( &pl_priv(p_playlist)->search.b_stale, true );
+
+    for( int i = 0; i < i_added; i++ )
+    {
+        playlist_item_t *p_item = pp_items[i];
+
+        p_item->p_parent = p_parent;
+        ARRAY_APPEND(p_playlist->items, p_item);
+        ARRAY_APPEND(p_playlist->all_items, p_item);
+        playlist_SendAddNotify( p_playlist, p_item->i_id, p_parent->i_id,
+                                false );
+        GoAndPreparse( p_playlist, i == 0 ? i_mode : i_mode & ~PLAYLIST_GO,
+                       p_item );
+    }
+    if( i_added > 0 && !( i_mode & PLAYLIST_NO_REBUILD ) )
+        vlc_cond_signal( &pl_priv(p_playlist)->signal );
+
+end:
+    PL_UNLOCK_IF( !b_locked );
+    free( pp_items );
+    return i_added;
+}
+
 /**
  * Copy an item (and all its children, if any) into another node
  *
@@ -781,7 +891,9 @@ static void GoAndPreparse( playlist_t *p_playlist, int i_mode,
     char *psz_album = input_item_GetAlbum( p_item->p_input );
     if( sys->p_preparser != NULL && !input_item_IsPreparsed( p_item->p_input )
      && (EMPTY_STR(psz_artist) || EMPTY_STR(psz_album)) )
-        playlist_preparser_Push( sys->p_preparser, p_item->p_input, 0 );
+        playlist_preparser_Push( sys->p_preparser, p_item->p_input,
+                                 (i_mode & PLAYLIST_GO) ?
+                                     META_REQUEST_OPTION_PRIORITY : 0 );
     free( psz_artist );
     free( psz_album );
 }
@@ -843,6 +955,29 @@ static int RecursiveAddIntoParent (
 
     if( i_pos == PLAYLIST_END ) i_pos = p_parent->i_children;
 
+    /* Add a plain list of items at once */
+    int i_leaves = 0;
+    while( i_leaves < p_node->i_children
+        && p_node->pp_children[i_leaves]->i_children <= 0 )
+        i_leaves++;
+    if( i_leaves > 0 && i_leaves == p_node->i_children )
+    {
+        input_item_t **pp_inputs = malloc( i_leaves * sizeof( *pp_inputs ) );
+        if( pp_inputs != NULL )
+        {
+            for( int i = 0; i < i_leaves; i++ )
+                pp_inputs[i] = p_node->pp_children[i]->p_item;
+            int i_added = playlist_NodeAddInputs( p_playlist, pp_inputs,
+                                                  i_leaves, p_parent,
+                                                  PLAYLIST_INSERT, i_pos,
+                                                  pl_Locked );
+            free( pp_inputs );
+            if( i_added > 0 )
+                *pp_first_leaf = p_parent->pp_children[i_pos];
+            return i_pos + i_added;
+        }
+    }
+
     for( int i = 0; i < p_node->i_children; i++ )
     {
         input_item_node_t *p_child_node = p_node->pp_children[i];
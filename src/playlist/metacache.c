@@ -0,0 +1,234 @@
+/*****************************************************************************
+ * metacache.c: Persistent meta data cache
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <sys/stat.h>
+#include <errno.h>
+
+#include <vlc_common.h>
+#include <vlc_input_item.h>
+#include <vlc_fs.h>
+#include <vlc_url.h>
+#include <vlc_md5.h>
+
+#include "metacache.h"
+
+/* Bump when the format of the entries changes */
+#define METACACHE_VERSION 1
+
+/*
+ * The cache holds one entry per file, named after the MD5 hash of its path:
+ * <cache dir>/meta/<first 2 digits of the hash>/<hash>
+ * The first line of an entry is:
+ * <version> <file size> <file modification time> <duration>
+ * and the next ones are the meta data:
+ * <vlc_meta_type_t> <URI-encoded value>
+ */
+
+/* Returns the path of the file of an item, or NULL if it is not local */
+static char *ItemPath( input_item_t *p_item, struct stat *p_st )
+{
+    char *psz_uri = input_item_GetURI( p_item );
+    if( unlikely(psz_uri == NULL) )
+        return NULL;
+
+    char *psz_path = make_path( psz_uri );
+    free( psz_uri );
+    if( psz_path == NULL )
+        return NULL;
+
+    if( vlc_stat( psz_path, p_st ) || !S_ISREG( p_st->st_mode ) )
+    {
+        free( psz_path );
+        return NULL;
+    }
+    return psz_path;
+}
+
+static char *EntryPath( const char *psz_path, bool b_create )
+{
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, psz_path, strlen( psz_path ) );
+    EndMD5( &md5 );
+    char *psz_hash = psz_md5_hash( &md5 );
+    if( unlikely(psz_hash == NULL) )
+        return NULL;
+
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    char *psz_entry;
+    if( psz_cachedir == NULL
+     || asprintf( &psz_entry, "%s" DIR_SEP "meta" DIR_SEP "%.2s" DIR_SEP "%s",
+                  psz_cachedir, psz_hash, psz_hash ) == -1 )
+        psz_entry = NULL;
+
+    if( psz_entry != NULL && b_create )
+    {
+        char *psz_dir = strrchr( psz_entry, DIR_SEP_CHAR );
+
+        /* cache dir, meta dir, then hash prefix dir */
+        vlc_mkdir( psz_cachedir, 0700 );
+        *psz_dir = '\0';
+        *strrchr( psz_entry, DIR_SEP_CHAR ) = '\0';
+        vlc_mkdir( psz_entry, 0700 );
+        psz_entry[strlen( psz_entry )] = DIR_SEP_CHAR;
+        vlc_mkdir( psz_entry, 0700 );
+        *psz_dir = DIR_SEP_CHAR;
+    }
+    free( psz_cachedir );
+    free( psz_hash );
+    return psz_entry;
+}
+
+/* Checks that the saved art has not been removed from its cache */
+static bool ArtExists( const char *psz_arturl )
+{
+    if( strncmp( psz_arturl, "file://", 7 ) )
+        return true;
+
+    char *psz_path = make_path( psz_arturl );
+    struct stat st;
+    bool b_exists = psz_path != NULL && !vlc_stat( psz_path, &st );
+    free( psz_path );
+    return b_exists;
+}
+
+int playlist_FindMetaInCache( input_item_t *p_item )
+{
+    struct stat st;
+    char *psz_path = ItemPath( p_item, &st );
+    if( psz_path == NULL )
+        return VLC_EGENERIC;
+
+    char *psz_entry = EntryPath( psz_path, false );
+    free( psz_path );
+    if( psz_entry == NULL )
+        return VLC_EGENERIC;
+
+    FILE *file = vlc_fopen( psz_entry, "rt" );
+    free( psz_entry );
+    if( file == NULL )
+        return VLC_EGENERIC;
+
+    int i_version;
+    uintmax_t i_size;
+    intmax_t i_mtime, i_duration;
+    if( fscanf( file, "%d %ju %jd %jd\n", &i_version, &i_size, &i_mtime,
+                &i_duration ) != 4
+     || i_version != METACACHE_VERSION
+     || i_size != (uintmax_t)st.st_size || i_mtime != (intmax_t)st.st_mtime )
+    {   /* Stale entry: the file changed since */
+        fclose( file );
+        return VLC_EGENERIC;
+    }
+
+    vlc_meta_t *p_meta = vlc_meta_New();
+    if( unlikely(p_meta == NULL) )
+    {
+        fclose( file );
+        return VLC_ENOMEM;
+    }
+
+    char *psz_line = NULL;
+    size_t i_line = 0;
+    ssize_t i_read;
+    while( (i_read = getline( &psz_line, &i_line, file )) != -1 )
+    {
+        char *psz_value;
+        unsigned long i_type = strtoul( psz_line, &psz_value, 10 );
+
+        if( psz_line[i_read - 1] == '\n' )
+            psz_line[i_read - 1] = '\0';
+        if( i_type >= VLC_META_TYPE_COUNT || *psz_value != ' ' )
+            continue;
+        psz_value = decode_URI( psz_value + 1 );
+        if( i_type == vlc_meta_ArtworkURL && !ArtExists( psz_value ) )
+            continue; /* let the fetcher find it again */
+        vlc_meta_Set( p_meta, i_type, psz_value );
+    }
+    free( psz_line );
+    fclose( file );
+
+    if( vlc_meta_Get( p_meta, vlc_meta_Title ) != NULL )
+        input_item_SetName( p_item, vlc_meta_Get( p_meta, vlc_meta_Title ) );
+
+    vlc_mutex_lock( &p_item->lock );
+    vlc_meta_Merge( p_item->p_meta, p_meta );
+    vlc_mutex_unlock( &p_item->lock );
+    vlc_meta_Delete( p_meta );
+
+    input_item_SetDuration( p_item, i_duration );
+    return VLC_SUCCESS;
+}
+
+void playlist_SaveMetaToCache( input_item_t *p_item )
+{
+    struct stat st;
+    char *psz_path = ItemPath( p_item, &st );
+    if( psz_path == NULL )
+        return;
+
+    char *psz_entry = EntryPath( psz_path, true );
+    free( psz_path );
+    if( psz_entry == NULL )
+        return;
+
+    /* Write aside, so that readers never see a partial entry */
+    char *psz_tmp;
+    if( asprintf( &psz_tmp, "%s.tmp", psz_entry ) == -1 )
+    {
+        free( psz_entry );
+        return;
+    }
+
+    FILE *file = vlc_fopen( psz_tmp, "wt" );
+    if( file == NULL )
+    {
+        free( psz_tmp );
+        free( psz_entry );
+        return;
+    }
+
+    fprintf( file, "%d %ju %jd %jd\n", METACACHE_VERSION,
+             (uintmax_t)st.st_size, (intmax_t)st.st_mtime,
+             (intmax_t)input_item_GetDuration( p_item ) );
+
+    vlc_mutex_lock( &p_item->lock );
+    for( int i = 0; p_item->p_meta != NULL && i < VLC_META_TYPE_COUNT; i++ )
+    {
+        const char *psz_value = vlc_meta_Get( p_item->p_meta, i );
+        if( psz_value == NULL )
+            continue;
+
+        char *psz_encoded = encode_URI_component( psz_value );
+        if( psz_encoded != NULL )
+            fprintf( file, "%d %s\n", i, psz_encoded );
+        free( psz_encoded );
+    }
+    vlc_mutex_unlock( &p_item->lock );
+
+    if( fclose( file ) || vlc_rename( psz_tmp, psz_entry ) )
+        vlc_unlink( psz_tmp );
+    free( psz_tmp );
+    free( psz_entry );
+}
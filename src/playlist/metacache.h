@@ -0,0 +1,38 @@
+/*****************************************************************************
+ * metacache.h: Persistent meta data cache
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _PLAYLIST_METACACHE_H
+#define _PLAYLIST_METACACHE_H 1
+
+/**
+ * This function fills the meta data and the duration of a local file from
+ * the cache, if they were saved since the file was last modified.
+ *
+ * It returns VLC_SUCCESS if so, an error otherwise.
+ */
+int playlist_FindMetaInCache( input_item_t * );
+
+/**
+ * This function saves the meta data and the duration of a local file to the
+ * cache, along with the size and modification time of the file.
+ */
+void playlist_SaveMetaToCache( input_item_t * );
+
+#endif
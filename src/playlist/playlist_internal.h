@@ -36,6 +36,7 @@
 
 #include "input/input_interface.h"
 #include <assert.h>
+#include <vlc_atomic.h>
 
 #include "art.h"
 #include "preparser.h"
@@ -58,6 +59,9 @@ typedef struct playlist_private_t
     input_thread_t *      p_input;  /**< the input thread associated
                                      * with the current item */
     input_resource_t *   p_input_resource; /**< input resources */
+    input_thread_t **    pp_standby; /**< inputs pre-opened in standby for
+                                      * fast zapping (playlist thread only) */
+    int                  i_standby;
     struct {
         /* Current status. These fields are readonly, only the playlist
          * main loop can touch it*/
@@ -87,6 +91,14 @@ typedef struct playlist_private_t
     bool     b_reset_currently_playing; /** Reset current item array */
 
     bool     b_tree; /**< Display as a tree */
+
+    struct {
+        /* Last live search, which the next one may refine */
+        char            *psz_string; /**< NULL if none */
+        playlist_item_t *p_root;
+        bool             b_recursive;
+        atomic_bool      b_stale; /**< an item changed since */
+    } search;
 } playlist_private_t;
 
 #define pl_priv( pl ) ((playlist_private_t *)(pl))
@@ -26,8 +26,13 @@
 #endif
 
 #include <vlc_common.h>
+#include <vlc_interrupt.h>
+#ifdef HAVE_SEARCH_H
+# include <search.h>
+#endif
 
 #include "fetcher.h"
+#include "metacache.h"
 #include "preparser.h"
 #include "input/input_interface.h"
 
@@ -40,22 +45,148 @@ struct preparser_entry_t
 {
     input_item_t    *p_item;
     input_item_meta_request_option_t i_options;
+    preparser_entry_t *p_prev;
+    preparser_entry_t *p_next;
 };
 
+typedef struct preparser_worker_t
+{
+    playlist_preparser_t *p_preparser;
+    vlc_timer_t     timer;
+    bool            b_timer;
+
+    vlc_mutex_t     lock; /* outlives the timer, unlike the preparser */
+    vlc_interrupt_t *p_interrupt; /* of the current item, or NULL */
+    mtime_t         i_deadline;
+    bool            b_timedout;
+} preparser_worker_t;
+
 struct playlist_preparser_t
 {
     vlc_object_t        *object;
     playlist_fetcher_t  *p_fetcher;
+    int             i_max_workers;
+    mtime_t         i_timeout;   /* per item, 0 if none */
+    bool            b_fast;      /* try the meta readers first */
+    bool            b_cache;     /* try the meta cache before anything */
 
     vlc_mutex_t     lock;
     vlc_cond_t      wait;
-    bool            b_live;
-    preparser_entry_t  **pp_waiting;
-    int             i_waiting;
+    preparser_worker_t **pp_workers;
+    int             i_workers;
+    /* Waiting queue, in order, and indexed by item */
+    preparser_entry_t *p_first;
+    preparser_entry_t *p_last;
+    void            *p_index;
+    unsigned        i_waiting;
+
+    /* Statistics, since the preparser last got busy */
+    mtime_t         i_busy_date;
+    unsigned        i_parsed;
+    unsigned        i_fast;
+    unsigned        i_cached;
+    unsigned        i_timedout;
 };
 
 static void *Thread( void * );
 
+static int EntryCmp( const void *a, const void *b )
+{
+    const preparser_entry_t *ea = a, *eb = b;
+
+    if( ea->p_item == eb->p_item )
+        return 0;
+    return (uintptr_t)ea->p_item < (uintptr_t)eb->p_item ? -1 : 1;
+}
+
+static void EntryLink( playlist_preparser_t *p_preparser,
+                       preparser_entry_t *p_entry, bool b_first )
+{
+    if( b_first )
+    {
+        p_entry->p_prev = NULL;
+        p_entry->p_next = p_preparser->p_first;
+        if( p_preparser->p_first != NULL )
+            p_preparser->p_first->p_prev = p_entry;
+        else
+            p_preparser->p_last = p_entry;
+        p_preparser->p_first = p_entry;
+    }
+    else
+    {
+        p_entry->p_next = NULL;
+        p_entry->p_prev = p_preparser->p_last;
+        if( p_preparser->p_last != NULL )
+            p_preparser->p_last->p_next = p_entry;
+        else
+            p_preparser->p_first = p_entry;
+        p_preparser->p_last = p_entry;
+    }
+}
+
+static void EntryUnlink( playlist_preparser_t *p_preparser,
+                         preparser_entry_t *p_entry )
+{
+    if( p_entry->p_prev != NULL )
+        p_entry->p_prev->p_next = p_entry->p_next;
+    else
+        p_preparser->p_first = p_entry->p_next;
+    if( p_entry->p_next != NULL )
+        p_entry->p_next->p_prev = p_entry->p_prev;
+    else
+        p_preparser->p_last = p_entry->p_prev;
+}
+
+/* Interrupts the preparsing of an item once it is late */
+static void Watchdog( void *data )
+{
+    preparser_worker_t *p_worker = data;
+
+    vlc_mutex_lock( &p_worker->lock );
+    /* The timer may fire late, once the next item has started */
+    if( p_worker->p_interrupt != NULL && mdate() >= p_worker->i_deadline )
+    {
+        p_worker->b_timedout = true;
+        vlc_interrupt_kill( p_worker->p_interrupt );
+    }
+    vlc_mutex_unlock( &p_worker->lock );
+}
+
+/* Must be called with the lock held */
+static void SpawnWorker( playlist_preparser_t *p_preparser )
+{
+    preparser_worker_t *p_worker = malloc( sizeof(*p_worker) );
+    if( unlikely(p_worker == NULL) )
+        return;
+
+    p_worker->p_preparser = p_preparser;
+    vlc_mutex_init( &p_worker->lock );
+    p_worker->p_interrupt = NULL;
+    p_worker->b_timedout = false;
+    p_worker->b_timer = p_preparser->i_timeout > 0
+        && !vlc_timer_create( &p_worker->timer, Watchdog, p_worker );
+
+    if( vlc_clone_detach( NULL, Thread, p_worker, VLC_THREAD_PRIORITY_LOW ) )
+    {
+        msg_Warn( p_preparser->object, "cannot spawn pre-parser thread" );
+        if( p_worker->b_timer )
+            vlc_timer_destroy( p_worker->timer );
+        vlc_mutex_destroy( &p_worker->lock );
+        free( p_worker );
+        return;
+    }
+
+    if( p_preparser->i_workers == 0 )
+    {
+        p_preparser->i_busy_date = mdate();
+        p_preparser->i_parsed = 0;
+        p_preparser->i_fast = 0;
+        p_preparser->i_cached = 0;
+        p_preparser->i_timedout = 0;
+    }
+    TAB_APPEND( p_preparser->i_workers, p_preparser->pp_workers, p_worker );
+}
+
 /*****************************************************************************
  * Public functions
  *****************************************************************************/
@@ -70,11 +201,21 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t *parent )
     if( unlikely(p_preparser->p_fetcher == NULL) )
         msg_Err( parent, "cannot create fetcher" );
 
+    p_preparser->i_max_workers = var_InheritInteger( parent, "preparse-threads" );
+    if( p_preparser->i_max_workers < 1 )
+        p_preparser->i_max_workers = 1;
+    p_preparser->i_timeout =
+        var_InheritInteger( parent, "preparse-timeout" ) * (CLOCK_FREQ / 1000);
+    p_preparser->b_fast = var_InheritBool( parent, "preparse-fast" );
+    p_preparser->b_cache = var_InheritBool( parent, "meta-cache" );
+
     vlc_mutex_init( &p_preparser->lock );
     vlc_cond_init( &p_preparser->wait );
-    p_preparser->b_live = false;
+    TAB_INIT( p_preparser->i_workers, p_preparser->pp_workers );
+    p_preparser->p_first = NULL;
+    p_preparser->p_last = NULL;
+    p_preparser->p_index = NULL;
     p_preparser->i_waiting = 0;
-    p_preparser->pp_waiting = NULL;
 
     return p_preparser;
 }
@@ -82,25 +223,45 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t *parent )
 void playlist_preparser_Push( playlist_preparser_t *p_preparser, input_item_t *p_item,
                               input_item_meta_request_option_t i_options )
 {
-    preparser_entry_t *p_entry = malloc( sizeof(preparser_entry_t) );
+    const bool b_priority = i_options & META_REQUEST_OPTION_PRIORITY;
+    preparser_entry_t key = { .p_item = p_item };
+
+    vlc_mutex_lock( &p_preparser->lock );
+    void **pp_found = tfind( &key, &p_preparser->p_index, EntryCmp );
+    if( pp_found != NULL )
+    {   /* Already queued: merge the requests */
+        preparser_entry_t *p_entry = *pp_found;
 
-    if ( !p_entry )
+        p_entry->i_options |= i_options & ~META_REQUEST_OPTION_PRIORITY;
+        if( b_priority && p_entry != p_preparser->p_first )
+        {
+            EntryUnlink( p_preparser, p_entry );
+            EntryLink( p_preparser, p_entry, true );
+        }
+        vlc_mutex_unlock( &p_preparser->lock );
         return;
-    p_entry->p_item = p_item;
-    p_entry->i_options = i_options;
-    vlc_gc_incref( p_entry->p_item );
+    }
 
-    vlc_mutex_lock( &p_preparser->lock );
-    INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
-                 p_preparser->i_waiting, p_entry );
-    if( !p_preparser->b_live )
+    preparser_entry_t *p_entry = malloc( sizeof(preparser_entry_t) );
+    if( p_entry != NULL )
     {
-        if( vlc_clone_detach( NULL, Thread, p_preparser,
-                              VLC_THREAD_PRIORITY_LOW ) )
-            msg_Warn( p_preparser->object, "cannot spawn pre-parser thread" );
-        else
-            p_preparser->b_live = true;
+        p_entry->p_item = p_item;
+        p_entry->i_options = i_options & ~META_REQUEST_OPTION_PRIORITY;
     }
+    if( p_entry == NULL
+     || tsearch( p_entry, &p_preparser->p_index, EntryCmp ) == NULL )
+    {
+        vlc_mutex_unlock( &p_preparser->lock );
+        free( p_entry );
+        return;
+    }
+    vlc_gc_incref( p_entry->p_item );
+    EntryLink( p_preparser, p_entry, b_priority );
+    p_preparser->i_waiting++;
+
+    if( p_preparser->i_workers < p_preparser->i_max_workers
+     && (unsigned)p_preparser->i_workers < p_preparser->i_waiting )
+        SpawnWorker( p_preparser );
     vlc_mutex_unlock( &p_preparser->lock );
 }
 
@@ -111,23 +272,44 @@ void playlist_preparser_fetcher_Push( playlist_preparser_t *p_preparser,
         playlist_fetcher_Push( p_preparser->p_fetcher, p_item, i_options );
 }
 
+static void EntryNoop( void *p_entry )
+{
+    (void) p_entry;
+}
+
 void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
 {
     vlc_mutex_lock( &p_preparser->lock );
     /* Remove pending item to speed up preparser thread exit */
-    while( p_preparser->i_waiting > 0 )
+    tdestroy( p_preparser->p_index, EntryNoop );
+    p_preparser->p_index = NULL;
+    while( p_preparser->p_first != NULL )
     {
-        preparser_entry_t *p_entry = p_preparser->pp_waiting[0];
+        preparser_entry_t *p_entry = p_preparser->p_first;
+
+        EntryUnlink( p_preparser, p_entry );
         vlc_gc_decref( p_entry->p_item );
         free( p_entry );
-        REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
+    }
+    p_preparser->i_waiting = 0;
+
+    /* and interrupt those in progress */
+    for( int i = 0; i < p_preparser->i_workers; i++ )
+    {
+        preparser_worker_t *p_worker = p_preparser->pp_workers[i];
+
+        vlc_mutex_lock( &p_worker->lock );
+        if( p_worker->p_interrupt != NULL )
+            vlc_interrupt_kill( p_worker->p_interrupt );
+        vlc_mutex_unlock( &p_worker->lock );
     }
 
-    while( p_preparser->b_live )
+    while( p_preparser->i_workers > 0 )
         vlc_cond_wait( &p_preparser->wait, &p_preparser->lock );
     vlc_mutex_unlock( &p_preparser->lock );
 
     /* Destroy the item preparser */
+    TAB_CLEAN( p_preparser->i_workers, p_preparser->pp_workers );
     vlc_cond_destroy( &p_preparser->wait );
     vlc_mutex_destroy( &p_preparser->lock );
 
@@ -139,12 +321,26 @@ void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
 /*****************************************************************************
  * Privates functions
  *****************************************************************************/
+enum preparse_source
+{
+    PREPARSE_NONE,  /* nothing to do */
+    PREPARSE_FULL,  /* with an input */
+    PREPARSE_META,  /* with the meta readers only */
+    PREPARSE_CACHE, /* from the meta cache */
+};
+
 /**
  * This function preparses an item when needed.
+ *
+ * Local files are first looked up in the meta cache, then given to the meta
+ * readers only, both being much cheaper than opening an input.
  */
-static void Preparse( vlc_object_t *obj, input_item_t *p_item,
-                      input_item_meta_request_option_t i_options )
+static enum preparse_source Preparse( playlist_preparser_t *p_preparser,
+                                      input_item_t *p_item,
+                                      input_item_meta_request_option_t i_options )
 {
+    vlc_object_t *obj = p_preparser->object;
+
     vlc_mutex_lock( &p_item->lock );
     int i_type = p_item->i_type;
     bool b_net = p_item->b_net;
@@ -164,18 +360,32 @@ static void Preparse( vlc_object_t *obj, input_item_t *p_item,
     {
         input_item_SetPreparsed( p_item, true );
         input_item_SignalPreparseEnded( p_item );
-        return;
+        return PREPARSE_NONE;
     }
 
     /* Do not preparse if it is already done (like by playing it) */
+    enum preparse_source source = PREPARSE_NONE;
     if( !input_item_IsPreparsed( p_item ) )
     {
-        input_Preparse( obj, p_item );
+        const bool b_local = i_type == ITEM_TYPE_FILE && !b_net;
+
+        if( b_local && p_preparser->b_cache
+         && playlist_FindMetaInCache( p_item ) == VLC_SUCCESS )
+            source = PREPARSE_CACHE;
+        else if( b_local && p_preparser->b_fast
+              && input_PreparseMeta( obj, p_item ) == VLC_SUCCESS )
+            source = PREPARSE_META;
+        else
+        {
+            input_Preparse( obj, p_item );
+            source = PREPARSE_FULL;
+        }
         input_item_SetPreparsed( p_item, true );
 
         var_SetAddress( obj, "item-change", p_item );
     }
     input_item_SignalPreparseEnded( p_item );
+    return source;
 }
 
 /**
@@ -224,40 +434,100 @@ static void Art( playlist_preparser_t *p_preparser, input_item_t *p_item )
  */
 static void *Thread( void *data )
 {
-    playlist_preparser_t *p_preparser = data;
+    preparser_worker_t *p_worker = data;
+    playlist_preparser_t *p_preparser = p_worker->p_preparser;
     vlc_object_t *obj = p_preparser->object;
 
     for( ;; )
     {
-        input_item_t *p_current;
-        input_item_meta_request_option_t i_options;
+        preparser_entry_t *p_entry;
+        vlc_interrupt_t *p_interrupt = vlc_interrupt_create();
 
         /* */
         vlc_mutex_lock( &p_preparser->lock );
-        if( p_preparser->i_waiting > 0 )
+        p_entry = p_preparser->p_first;
+        if( p_entry != NULL )
         {
-            preparser_entry_t *p_entry = p_preparser->pp_waiting[0];
-            p_current = p_entry->p_item;
-            i_options = p_entry->i_options;
-            free( p_entry );
-            REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
+            EntryUnlink( p_preparser, p_entry );
+            tdelete( p_entry, &p_preparser->p_index, EntryCmp );
+            p_preparser->i_waiting--;
+
+            vlc_mutex_lock( &p_worker->lock );
+            p_worker->p_interrupt = p_interrupt;
+            p_worker->i_deadline = mdate() + p_preparser->i_timeout;
+            p_worker->b_timedout = false;
+            vlc_mutex_unlock( &p_worker->lock );
         }
         else
         {
-            p_current = NULL;
-            p_preparser->b_live = false;
-            vlc_cond_signal( &p_preparser->wait );
+            TAB_REMOVE( p_preparser->i_workers, p_preparser->pp_workers,
+                        p_worker );
+            if( p_preparser->i_workers == 0 )
+            {
+                mtime_t i_busy = mdate() - p_preparser->i_busy_date;
+
+                msg_Dbg( obj, "preparsed %u item(s) in %"PRId64" ms "
+                         "(%.1f/s), %u from cache, %u from meta only, "
+                         "%u timed out", p_preparser->i_parsed, i_busy / 1000,
+                         p_preparser->i_parsed *
+                         (double)CLOCK_FREQ / (i_busy + 1),
+                         p_preparser->i_cached, p_preparser->i_fast,
+                         p_preparser->i_timedout );
+                vlc_cond_signal( &p_preparser->wait );
+            }
         }
         vlc_mutex_unlock( &p_preparser->lock );
 
-        if( !p_current )
+        if( p_entry == NULL )
+        {
+            if( p_interrupt != NULL )
+                vlc_interrupt_destroy( p_interrupt );
             break;
+        }
 
-        Preparse( obj, p_current, i_options );
+        if( p_worker->b_timer && p_interrupt != NULL )
+            vlc_timer_schedule( p_worker->timer, false,
+                                p_preparser->i_timeout, 0 );
+        vlc_interrupt_t *p_oldctx = vlc_interrupt_set( p_interrupt );
+
+        enum preparse_source source =
+            Preparse( p_preparser, p_entry->p_item, p_entry->i_options );
+
+        vlc_interrupt_set( p_oldctx );
+        if( p_worker->b_timer )
+            vlc_timer_schedule( p_worker->timer, false, 0, 0 );
+
+        vlc_mutex_lock( &p_worker->lock );
+        p_worker->p_interrupt = NULL;
+        bool b_timedout = p_worker->b_timedout;
+        vlc_mutex_unlock( &p_worker->lock );
+
+        if( b_timedout )
+            msg_Warn( obj, "preparsing of %s timed out",
+                      p_entry->p_item->psz_uri );
+        else if( p_preparser->b_cache && ( source == PREPARSE_FULL
+                                        || source == PREPARSE_META ) )
+            playlist_SaveMetaToCache( p_entry->p_item );
+        vlc_mutex_lock( &p_preparser->lock );
+        p_preparser->i_parsed++;
+        if( source == PREPARSE_CACHE )
+            p_preparser->i_cached++;
+        if( source == PREPARSE_META )
+            p_preparser->i_fast++;
+        if( b_timedout )
+            p_preparser->i_timedout++;
+        vlc_mutex_unlock( &p_preparser->lock );
+        if( p_interrupt != NULL )
+            vlc_interrupt_destroy( p_interrupt );
 
-        Art( p_preparser, p_current );
-        vlc_gc_decref(p_current);
+        Art( p_preparser, p_entry->p_item );
+        vlc_gc_decref( p_entry->p_item );
+        free( p_entry );
     }
+
+    if( p_worker->b_timer )
+        vlc_timer_destroy( p_worker->timer );
+    vlc_mutex_destroy( &p_worker->lock );
+    free( p_worker );
     return NULL;
 }
-
@@ -36,7 +36,8 @@
 typedef struct playlist_preparser_t playlist_preparser_t;
 
 /**
- * This function creates the preparser object and thread.
+ * This function creates the preparser object. Items are preparsed by up to
+ * "preparse-threads" threads, each given "preparse-timeout" per item.
  */
 playlist_preparser_t *playlist_preparser_New( vlc_object_t * );
 
@@ -44,7 +45,9 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t * );
  * This function enqueues the provided item to be preparsed.
  *
  * The input item is retained until the preparsing is done or until the
- * preparser object is deleted.
+ * preparser object is deleted. An item already waiting is not queued twice:
+ * the requests are merged. With META_REQUEST_OPTION_PRIORITY, the item is
+ * preparsed before the other waiting items.
  * Listen to vlc_InputItemPreparseEnded event to get notified when item is
  * preparsed.
  */
@@ -55,9 +58,10 @@ void playlist_preparser_fetcher_Push( playlist_preparser_t *, input_item_t *,
                                       input_item_meta_request_option_t );
 
 /**
- * This function destroys the preparser object and thread.
+ * This function destroys the preparser object and threads.
  *
- * All pending input items will be released.
+ * All pending input items will be released, and the preparsing in progress
+ * interrupted.
  */
 void playlist_preparser_Delete( playlist_preparser_t * );
 
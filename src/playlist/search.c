@@ -105,10 +105,12 @@ static void playlist_LiveSearchClean( playlist_item_t *p_root )
  * Enable/Disable items in the playlist according to the search argument
  * @param p_root: the current root item
  * @param psz_string: the string to search
+ * @param b_refine: true if only the enabled items can match
  * @return true if an item match
  */
 static bool playlist_LiveSearchUpdateInternal( playlist_item_t *p_root,
-                                               const char *psz_string, bool b_recursive )
+                                               const char *psz_string, bool b_recursive,
+                                               bool b_refine )
 {
     int i;
     bool b_match = false;
@@ -116,9 +118,13 @@ static bool playlist_LiveSearchUpdateInternal( playlist_item_t *p_root,
     {
         bool b_enable = false;
         playlist_item_t *p_item = p_root->pp_children[i];
+        // Neither it nor its children matched the previous search
+        if( b_refine && p_item->i_flags & PLAYLIST_DBL_FLAG )
+            continue;
         // Go recurssively if their is some children
         if( b_recursive && p_item->i_children >= 0 &&
-            playlist_LiveSearchUpdateInternal( p_item, psz_string, true ) )
+            playlist_LiveSearchUpdateInternal( p_item, psz_string, true,
+                                               b_refine ) )
         {
             b_enable = true;
         }
@@ -158,6 +164,9 @@ static bool playlist_LiveSearchUpdateInternal( playlist_item_t *p_root,
 
 /**
  * Launch the recursive search in the playlist
+ *
+ * While the string is being typed, each search contains the previous one,
+ * so only the items that matched it need to be looked at again.
  * @param p_playlist: the playlist
  * @param p_root: the current root item
  * @param psz_string: the string to find
@@ -167,12 +176,29 @@ int playlist_LiveSearchUpdate( playlist_t *p_playlist, playlist_item_t *p_root,
                                const char *psz_string, bool b_recursive )
 {
     PL_ASSERT_LOCKED;
-    pl_priv(p_playlist)->b_reset_currently_playing = true;
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+
+    p_sys->b_reset_currently_playing = true;
+
+    bool b_stale = atomic_exchange( &p_sys->search.b_stale, false );
+    bool b_refine = !b_stale && p_sys->search.psz_string != NULL
+                 && p_sys->search.p_root == p_root
+                 && p_sys->search.b_recursive == b_recursive
+                 && vlc_strcasestr( psz_string, p_sys->search.psz_string );
+
+    free( p_sys->search.psz_string );
+    p_sys->search.psz_string = NULL;
     if( *psz_string )
-        playlist_LiveSearchUpdateInternal( p_root, psz_string, b_recursive );
+    {
+        playlist_LiveSearchUpdateInternal( p_root, psz_string, b_recursive,
+                                           b_refine );
+        p_sys->search.psz_string = strdup( psz_string );
+        p_sys->search.p_root = p_root;
+        p_sys->search.b_recursive = b_recursive;
+    }
     else
         playlist_LiveSearchClean( p_root );
-    vlc_cond_signal( &pl_priv(p_playlist)->signal );
+    vlc_cond_signal( &p_sys->signal );
     return VLC_SUCCESS;
 }
 
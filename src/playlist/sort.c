@@ -33,77 +33,152 @@
 #include "playlist_internal.h"
 
 
+/* Sort keys */
+/**
+ * The fields of an item that it is sorted on, read once before sorting
+ * rather than at each comparison.
+ */
+typedef struct
+{
+    playlist_item_t *p_item;
+    bool     b_node;
+    mtime_t  i_duration;
+    char    *psz_title;         /**< title, or name */
+    char    *psz_uri;
+    char    *psz_album;
+    char    *psz_artist;
+    char    *psz_description;
+    char    *psz_genre;
+    char    *psz_rating;
+    char    *psz_track_number;
+} playlist_sort_key_t;
+
+/**
+ * Read the fields of an item needed to sort it
+ * @param p_key: the key to fill, zeroed
+ * @param p_item: the item
+ * @param i_mode: a SORT_* enum indicating the field to sort on
+ */
+static void playlist_SortKeyInit( playlist_sort_key_t *p_key,
+                                  playlist_item_t *p_item, int i_mode )
+{
+    input_item_t *p_input = p_item->p_input;
+
+    p_key->p_item = p_item;
+    p_key->b_node = p_item->i_children >= 0;
+
+    switch( i_mode )
+    {
+        case SORT_ID:
+            return;
+        case SORT_DURATION:
+            p_key->i_duration = input_item_GetDuration( p_input );
+            return;
+        case SORT_URI:
+            p_key->psz_uri = input_item_GetURI( p_input );
+            return;
+        case SORT_ARTIST:
+            p_key->psz_artist = input_item_GetMeta( p_input, vlc_meta_Artist );
+            /* fall through */
+        case SORT_ALBUM:
+            p_key->psz_album = input_item_GetMeta( p_input, vlc_meta_Album );
+            /* fall through */
+        case SORT_TRACK_NUMBER:
+            p_key->psz_track_number =
+                input_item_GetMeta( p_input, vlc_meta_TrackNumber );
+            break;
+        case SORT_DESCRIPTION:
+            p_key->psz_description =
+                input_item_GetMeta( p_input, vlc_meta_Description );
+            break;
+        case SORT_GENRE:
+            p_key->psz_genre = input_item_GetMeta( p_input, vlc_meta_Genre );
+            break;
+        case SORT_RATING:
+            p_key->psz_rating = input_item_GetMeta( p_input, vlc_meta_Rating );
+            break;
+    }
+    /* The other criteria fall back to the title */
+    p_key->psz_title = input_item_GetTitleFbName( p_input );
+}
+
+static void playlist_SortKeyClean( playlist_sort_key_t *p_key )
+{
+    free( p_key->psz_title );
+    free( p_key->psz_uri );
+    free( p_key->psz_album );
+    free( p_key->psz_artist );
+    free( p_key->psz_description );
+    free( p_key->psz_genre );
+    free( p_key->psz_rating );
+    free( p_key->psz_track_number );
+}
+
 /* General comparison functions */
 /**
- * Compare two items using their title or name
- * @param first: the first item
- * @param second: the second item
+ * Compare two strings, the missing ones going last
+ * @param psz_first: the first string or NULL
+ * @param psz_second: the second string or NULL
+ * @param b_integer: true if the strings are integers
  * @return -1, 0 or 1 like strcmp
  */
-static inline int meta_strcasecmp_title( const playlist_item_t *first,
-                              const playlist_item_t *second )
+static inline int meta_strcasecmp( const char *psz_first,
+                                   const char *psz_second, bool b_integer )
 {
-    int i_ret;
-    char *psz_first = input_item_GetTitleFbName( first->p_input );
-    char *psz_second = input_item_GetTitleFbName( second->p_input );
-
     if( psz_first && psz_second )
-        i_ret = strcasecmp( psz_first, psz_second );
+    {
+        if( b_integer )
+            return atoi( psz_first ) - atoi( psz_second );
+        return strcasecmp( psz_first, psz_second );
+    }
     else if( !psz_first && psz_second )
-        i_ret = 1;
+        return 1;
     else if( psz_first && !psz_second )
-        i_ret = -1;
+        return -1;
     else
-        i_ret = 0;
-    free( psz_first );
-    free( psz_second );
+        return 0;
+}
 
-    return i_ret;
+/**
+ * Compare two items using their title or name
+ * @param first: the first item
+ * @param second: the second item
+ * @return -1, 0 or 1 like strcmp
+ */
+static inline int meta_strcasecmp_title( const playlist_sort_key_t *first,
+                                         const playlist_sort_key_t *second )
+{
+    return meta_strcasecmp( first->psz_title, second->psz_title, false );
 }
 
 /**
- * Compare two intems accoring to the given meta type
+ * Compare two intems accoring to the given meta
  * @param first: the first item
  * @param second: the second item
- * @param meta: the meta type to use to sort the items
+ * @param psz_first: the meta of the first item, or NULL
+ * @param psz_second: the meta of the second item, or NULL
  * @param b_integer: true if the meta are integers
  * @return -1, 0 or 1 like strcmp
  */
-static inline int meta_sort( const playlist_item_t *first,
-                             const playlist_item_t *second,
-                             vlc_meta_type_t meta, bool b_integer )
+static inline int meta_sort( const playlist_sort_key_t *first,
+                             const playlist_sort_key_t *second,
+                             const char *psz_first, const char *psz_second,
+                             bool b_integer )
 {
-    int i_ret;
-    char *psz_first = input_item_GetMeta( first->p_input, meta );
-    char *psz_second = input_item_GetMeta( second->p_input, meta );
-
     /* Nodes go first */
-    if( first->i_children == -1 && second->i_children >= 0 )
-        i_ret = 1;
-    else if( first->i_children >= 0 && second->i_children == -1 )
-       i_ret = -1;
+    if( !first->b_node && second->b_node )
+        return 1;
+    else if( first->b_node && !second->b_node )
+        return -1;
     /* Both are nodes, sort by name */
-    else if( first->i_children >= 0 && second->i_children >= 0 )
-        i_ret = meta_strcasecmp_title( first, second );
-    /* Both are items */
-    else if( !psz_first && psz_second )
-        i_ret = 1;
-    else if( psz_first && !psz_second )
-        i_ret = -1;
+    else if( first->b_node && second->b_node )
+        return meta_strcasecmp_title( first, second );
     /* No meta, sort by name */
     else if( !psz_first && !psz_second )
-        i_ret = meta_strcasecmp_title( first, second );
+        return meta_strcasecmp_title( first, second );
+    /* Both are items */
     else
-    {
-        if( b_integer )
-            i_ret = atoi( psz_first ) - atoi( psz_second );
-        else
-            i_ret = strcasecmp( psz_first, psz_second );
-    }
-
-    free( psz_first );
-    free( psz_second );
-    return i_ret;
+        return meta_strcasecmp( psz_first, psz_second, b_integer );
 }
 
 /* Comparison functions */
@@ -128,16 +203,31 @@ static inline sortfn_t find_sorting_fn( unsigned i_mode, unsigned i_type )
  * Sort an array of items recursively
  * @param i_items: number of items
  * @param pp_items: the array of items
+ * @param i_mode: a SORT_* enum indicating the field to sort on
  * @param p_sortfn: the sorting function
  * @return nothing
  */
 static inline
 void playlist_ItemArraySort( unsigned i_items, playlist_item_t **pp_items,
-                             sortfn_t p_sortfn )
+                             int i_mode, sortfn_t p_sortfn )
 {
     if( p_sortfn )
     {
-        qsort( pp_items, i_items, sizeof( pp_items[0] ), p_sortfn );
+        playlist_sort_key_t *p_keys = calloc( i_items, sizeof( *p_keys ) );
+        if( unlikely(p_keys == NULL) )
+            return;
+
+        for( unsigned i = 0; i < i_items; i++ )
+            playlist_SortKeyInit( &p_keys[i], pp_items[i], i_mode );
+
+        qsort( p_keys, i_items, sizeof( p_keys[0] ), p_sortfn );
+
+        for( unsigned i = 0; i < i_items; i++ )
+        {
+            pp_items[i] = p_keys[i].p_item;
+            playlist_SortKeyClean( &p_keys[i] );
+        }
+        free( p_keys );
     }
     else /* Randomise */
     {
@@ -161,19 +251,21 @@ void playlist_ItemArraySort( unsigned i_items, playlist_item_t **pp_items,
  * This function must be entered with the playlist lock !
  * @param p_playlist the playlist
  * @param p_node the node to sort
+ * @param i_mode: a SORT_* enum indicating the field to sort on
  * @param p_sortfn the sorting function
  * @return VLC_SUCCESS on success
  */
 static int recursiveNodeSort( playlist_t *p_playlist, playlist_item_t *p_node,
-                              sortfn_t p_sortfn )
+                              int i_mode, sortfn_t p_sortfn )
 {
     int i;
-    playlist_ItemArraySort(p_node->i_children,p_node->pp_children,p_sortfn);
+    playlist_ItemArraySort(p_node->i_children,p_node->pp_children,i_mode,p_sortfn);
     for( i = 0 ; i< p_node->i_children; i++ )
     {
         if( p_node->pp_children[i]->i_children != -1 )
         {
-            recursiveNodeSort( p_playlist, p_node->pp_children[i], p_sortfn );
+            recursiveNodeSort( p_playlist, p_node->pp_children[i], i_mode,
+                               p_sortfn );
         }
     }
     return VLC_SUCCESS;
@@ -197,13 +289,14 @@ int playlist_RecursiveNodeSort( playlist_t *p_playlist, playlist_item_t *p_node,
     pl_priv(p_playlist)->b_reset_currently_playing = true;
 
     /* Do the real job recursively */
-    return recursiveNodeSort(p_playlist,p_node,find_sorting_fn(i_mode,i_type));
+    return recursiveNodeSort(p_playlist,p_node,i_mode,
+                             find_sorting_fn(i_mode,i_type));
 }
 
 
 /* This is the stuff the sorting functions are made of. The proto_##
  * functions are wrapped in cmp_a_## and cmp_d_## functions that do
- * void * to const playlist_item_t * casting and dereferencing and
+ * void * to const playlist_sort_key_t * casting and
  * cmp_d_## inverts the result, too. proto_## are static inline,
  * cmp_[ad]_## are merely static as they're the target of pointers.
  *
@@ -212,21 +305,24 @@ int playlist_RecursiveNodeSort( playlist_t *p_playlist, playlist_item_t *p_node,
  */
 
 #define SORTFN( SORT, first, second ) static inline int proto_##SORT \
-	( const playlist_item_t *first, const playlist_item_t *second )
+	( const playlist_sort_key_t *first, const playlist_sort_key_t *second )
 
 SORTFN( SORT_ALBUM, first, second )
 {
-    int i_ret = meta_sort( first, second, vlc_meta_Album, false );
+    int i_ret = meta_sort( first, second, first->psz_album,
+                           second->psz_album, false );
     /* Items came from the same album: compare the track numbers */
     if( i_ret == 0 )
-        i_ret = meta_sort( first, second, vlc_meta_TrackNumber, true );
+        i_ret = meta_sort( first, second, first->psz_track_number,
+                           second->psz_track_number, true );
 
     return i_ret;
 }
 
 SORTFN( SORT_ARTIST, first, second )
 {
-    int i_ret = meta_sort( first, second, vlc_meta_Artist, false );
+    int i_ret = meta_sort( first, second, first->psz_artist,
+                           second->psz_artist, false );
     /* Items came from the same artist: compare the albums */
     if( i_ret == 0 )
         i_ret = proto_SORT_ALBUM( first, second );
@@ -236,13 +332,14 @@ SORTFN( SORT_ARTIST, first, second )
 
 SORTFN( SORT_DESCRIPTION, first, second )
 {
-    return meta_sort( first, second, vlc_meta_Description, false );
+    return meta_sort( first, second, first->psz_description,
+                      second->psz_description, false );
 }
 
 SORTFN( SORT_DURATION, first, second )
 {
-    mtime_t time1 = input_item_GetDuration( first->p_input );
-    mtime_t time2 = input_item_GetDuration( second->p_input );
+    mtime_t time1 = first->i_duration;
+    mtime_t time2 = second->i_duration;
     int i_ret = time1 > time2 ? 1 :
                     ( time1 == time2 ? 0 : -1 );
     return i_ret;
@@ -250,17 +347,19 @@ SORTFN( SORT_DURATION, first, second )
 
 SORTFN( SORT_GENRE, first, second )
 {
-    return meta_sort( first, second, vlc_meta_Genre, false );
+    return meta_sort( first, second, first->psz_genre,
+                      second->psz_genre, false );
 }
 
 SORTFN( SORT_ID, first, second )
 {
-    return first->i_id - second->i_id;
+    return first->p_item->i_id - second->p_item->i_id;
 }
 
 SORTFN( SORT_RATING, first, second )
 {
-    return meta_sort( first, second, vlc_meta_Rating, true );
+    return meta_sort( first, second, first->psz_rating,
+                      second->psz_rating, true );
 }
 
 SORTFN( SORT_TITLE, first, second )
@@ -271,10 +370,10 @@ SORTFN( SORT_TITLE, first, second )
 SORTFN( SORT_TITLE_NODES_FIRST, first, second )
 {
     /* If first is a node but not second */
-    if( first->i_children == -1 && second->i_children >= 0 )
+    if( !first->b_node && second->b_node )
         return -1;
     /* If second is a node but not first */
-    else if( first->i_children >= 0 && second->i_children == -1 )
+    else if( first->b_node && !second->b_node )
         return 1;
     /* Both are nodes or both are not nodes */
     else
@@ -283,47 +382,18 @@ SORTFN( SORT_TITLE_NODES_FIRST, first, second )
 
 SORTFN( SORT_TITLE_NUMERIC, first, second )
 {
-    int i_ret;
-    char *psz_first = input_item_GetTitleFbName( first->p_input );
-    char *psz_second = input_item_GetTitleFbName( second->p_input );
-
-    if( psz_first && psz_second )
-        i_ret = atoi( psz_first ) - atoi( psz_second );
-    else if( !psz_first && psz_second )
-        i_ret = 1;
-    else if( psz_first && !psz_second )
-        i_ret = -1;
-    else
-        i_ret = 0;
-
-    free( psz_first );
-    free( psz_second );
-    return i_ret;
+    return meta_strcasecmp( first->psz_title, second->psz_title, true );
 }
 
 SORTFN( SORT_TRACK_NUMBER, first, second )
 {
-    return meta_sort( first, second, vlc_meta_TrackNumber, true );
+    return meta_sort( first, second, first->psz_track_number,
+                      second->psz_track_number, true );
 }
 
 SORTFN( SORT_URI, first, second )
 {
-    int i_ret;
-    char *psz_first = input_item_GetURI( first->p_input );
-    char *psz_second = input_item_GetURI( second->p_input );
-
-    if( psz_first && psz_second )
-        i_ret = strcasecmp( psz_first, psz_second );
-    else if( !psz_first && psz_second )
-        i_ret = 1;
-    else if( psz_first && !psz_second )
-        i_ret = -1;
-    else
-        i_ret = 0;
-
-    free( psz_first );
-    free( psz_second );
-    return i_ret;
+    return meta_strcasecmp( first->psz_uri, second->psz_uri, false );
 }
 
 #undef  SORTFN
@@ -338,11 +408,11 @@ SORTFN( SORT_URI, first, second )
 
 #define DEF( s ) \
 	static int cmp_a_##s(const void *l,const void *r) \
-	{ return proto_##s(*(const playlist_item_t *const *)l, \
-                           *(const playlist_item_t *const *)r); } \
+	{ return proto_##s((const playlist_sort_key_t *)l, \
+                           (const playlist_sort_key_t *)r); } \
 	static int cmp_d_##s(const void *l,const void *r) \
-	{ return -1*proto_##s(*(const playlist_item_t * const *)l, \
-                              *(const playlist_item_t * const *)r); }
+	{ return -1*proto_##s((const playlist_sort_key_t *)l, \
+                              (const playlist_sort_key_t *)r); }
 
 	VLC_DEFINE_SORT_FUNCTIONS
 
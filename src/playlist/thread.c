@@ -185,6 +185,149 @@ void ResetCurrentlyPlaying( playlist_t *p_playlist,
 }
 
 
+/*****************************************************************************
+ * Standby inputs (fast zapping)
+ *****************************************************************************/
+#define STANDBY_MAX 8
+
+static void StandbyClose( input_thread_t *p_input )
+{
+    input_Stop( p_input );
+    input_Close( p_input );
+}
+
+/**
+ * Takes the standby input of an item, if any.
+ * Must be called without the playlist lock.
+ */
+static input_thread_t *StandbyTake( playlist_t *p_playlist,
+                                    input_item_t *p_item )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+
+    for( int i = 0; i < p_sys->i_standby; i++ )
+    {
+        input_thread_t *p_input = p_sys->pp_standby[i];
+
+        if( input_GetItem( p_input ) != p_item )
+            continue;
+
+        TAB_REMOVE( p_sys->i_standby, p_sys->pp_standby, p_input );
+
+        const int i_state = var_GetInteger( p_input, "state" );
+        if( i_state == END_S || i_state == ERROR_S )
+        {   /* This one is dead, it is opened again normally */
+            StandbyClose( p_input );
+            return NULL;
+        }
+        return p_input;
+    }
+    return NULL;
+}
+
+/**
+ * Opens in standby the items around the current one, and closes the standby
+ * inputs of the other items.
+ */
+static void StandbyUpdate( playlist_t *p_playlist )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+    input_item_t *pp_wanted[2 * STANDBY_MAX];
+    int i_wanted = 0;
+
+    PL_ASSERT_LOCKED;
+
+    int i_around = var_InheritInteger( p_playlist, "zap-standby" );
+    char *psz_sout = var_InheritString( p_playlist, "sout" );
+
+    if( i_around > STANDBY_MAX )
+        i_around = STANDBY_MAX;
+    if( psz_sout != NULL && *psz_sout )
+        i_around = 0; /* the stream output cannot be shared */
+    free( psz_sout );
+
+    const int i_size = p_playlist->current.i_size;
+    const int i_current = p_playlist->i_current_index;
+    playlist_item_t *p_current = p_sys->status.p_item;
+
+    if( i_current >= 0 && p_current != NULL )
+        for( int i = 1; i <= i_around; i++ )
+            for( int j = -1; j <= 1; j += 2 )
+            {
+                int i_index = ((i_current + j * i) % i_size + i_size) % i_size;
+                input_item_t *p_item =
+                    ARRAY_VAL( p_playlist->current, i_index )->p_input;
+
+                if( p_item == p_current->p_input )
+                    continue;
+                for( int k = 0; k < i_wanted && p_item != NULL; k++ )
+                    if( pp_wanted[k] == p_item )
+                        p_item = NULL;
+                if( p_item != NULL )
+                    pp_wanted[i_wanted++] = input_item_Hold( p_item );
+            }
+    PL_UNLOCK;
+
+    /* WARNING: Input creation and deletion are incompatible with the
+     * playlist lock. */
+    for( int i = p_sys->i_standby - 1; i >= 0; i-- )
+    {
+        input_thread_t *p_input = p_sys->pp_standby[i];
+        input_item_t *p_item = input_GetItem( p_input );
+        bool b_wanted = false;
+
+        for( int k = 0; k < i_wanted; k++ )
+            if( pp_wanted[k] == p_item )
+            {   /* Already opened */
+                input_item_Release( p_item );
+                pp_wanted[k] = NULL;
+                b_wanted = true;
+            }
+        if( b_wanted )
+            continue;
+
+        TAB_REMOVE( p_sys->i_standby, p_sys->pp_standby, p_input );
+        StandbyClose( p_input );
+    }
+
+    for( int k = 0; k < i_wanted; k++ )
+    {
+        input_item_t *p_item = pp_wanted[k];
+        if( p_item == NULL )
+            continue;
+
+        input_thread_t *p_input = input_Create( p_playlist, p_item, NULL,
+                                                p_sys->p_input_resource );
+        if( likely(p_input != NULL) )
+        {
+            var_SetBool( p_input, "standby", true );
+            if( input_Start( p_input ) )
+                vlc_object_release( p_input );
+            else
+                TAB_APPEND( p_sys->i_standby, p_sys->pp_standby, p_input );
+        }
+        input_item_Release( p_item );
+    }
+    PL_LOCK;
+}
+
+/**
+ * Closes all the standby inputs.
+ * Must be called without the playlist lock.
+ */
+static void StandbyCloseAll( playlist_t *p_playlist )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+
+    while( p_sys->i_standby > 0 )
+    {
+        input_thread_t *p_input = p_sys->pp_standby[p_sys->i_standby - 1];
+
+        TAB_REMOVE( p_sys->i_standby, p_sys->pp_standby, p_input );
+        StandbyClose( p_input );
+    }
+}
+
 /**
  * Start the input for an item
  *
@@ -205,19 +348,30 @@ static bool PlayItem( playlist_t *p_playlist, playlist_item_t *p_item )
     assert( p_sys->p_input == NULL );
     PL_UNLOCK;
 
-    input_thread_t *p_input_thread = input_Create( p_playlist, p_input, NULL,
-                                                   p_sys->p_input_resource );
-    if( likely(p_input_thread != NULL) )
-    {
+    input_thread_t *p_input_thread = StandbyTake( p_playlist, p_input );
+    if( p_input_thread != NULL )
+    {   /* Already opened: the decoders are created right away */
+        msg_Dbg( p_playlist, "leaving standby" );
         var_AddCallback( p_input_thread, "intf-event",
                          InputEvent, p_playlist );
-
-        if( input_Start( p_input_thread ) )
+        var_SetBool( p_input_thread, "standby", false );
+    }
+    else
+    {
+        p_input_thread = input_Create( p_playlist, p_input, NULL,
+                                       p_sys->p_input_resource );
+        if( likely(p_input_thread != NULL) )
         {
-            var_DelCallback( p_input_thread, "intf-event",
+            var_AddCallback( p_input_thread, "intf-event",
                              InputEvent, p_playlist );
-            vlc_object_release( p_input_thread );
-            p_input_thread = NULL;
+
+            if( input_Start( p_input_thread ) )
+            {
+                var_DelCallback( p_input_thread, "intf-event",
+                                 InputEvent, p_playlist );
+                vlc_object_release( p_input_thread );
+                p_input_thread = NULL;
+            }
         }
     }
 
@@ -240,6 +394,7 @@ static bool PlayItem( playlist_t *p_playlist, playlist_item_t *p_item )
     var_SetAddress( p_playlist, "input-current", p_input_thread );
 
     PL_LOCK;
+    StandbyUpdate( p_playlist );
     return p_input_thread != NULL;
 }
 
@@ -508,6 +663,12 @@ static void *Thread ( void *data )
         }
 
         msg_Dbg( p_playlist, "nothing to play" );
+        if( p_sys->i_standby > 0 )
+        {
+            PL_UNLOCK;
+            StandbyCloseAll( p_playlist );
+            PL_LOCK;
+        }
         if( var_InheritBool( p_playlist, "play-and-exit" ) )
         {
             msg_Info( p_playlist, "end of playlist, exiting" );
@@ -524,6 +685,7 @@ static void *Thread ( void *data )
     }
     PL_UNLOCK;
 
+    StandbyCloseAll( p_playlist );
     input_resource_Terminate( p_sys->p_input_resource );
     return NULL;
 }
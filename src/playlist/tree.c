@@ -212,7 +212,6 @@ int playlist_NodeInsert( playlist_t *p_playlist,
                          int i_position )
 {
     PL_ASSERT_LOCKED;
-    (void)p_playlist;
     assert( p_parent && p_parent->i_children != -1 );
     if( i_position == -1 ) i_position = p_parent->i_children ;
     assert( i_position <= p_parent->i_children);
@@ -222,6 +221,9 @@ int playlist_NodeInsert( playlist_t *p_playlist,
                  i_position,
                  p_item );
     p_item->p_parent = p_parent;
+    /* A refined live search would not look into a disabled node */
+    if( p_parent->i_flags & PLAYLIST_DBL_FLAG )
+        atomic_store( &pl_priv(p_playlist)->search.b_stale, true );
     return VLC_SUCCESS;
 }
 
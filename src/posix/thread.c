@@ -44,7 +44,8 @@
 #include <sched.h>
 
 #ifdef __linux__
-# include <sys/syscall.h> /* SYS_gettid */
+# include <stdio.h>
+# include <sys/syscall.h> /* SYS_gettid, SYS_set_mempolicy */
 #endif
 #ifdef HAVE_EXECINFO_H
 # include <execinfo.h>
@@ -400,6 +401,114 @@ void *vlc_threadvar_get (vlc_threadvar_t key)
 static bool rt_priorities = false;
 static int rt_offset;
 
+#if defined (__linux__) && defined (HAVE_SCHED_GETAFFINITY)
+# define VLC_NUMA_MAX_NODES 32
+
+static unsigned numa_nodes = 0; /* zero if the threads are not bound */
+static cpu_set_t numa_all_cpus;
+static atomic_uint numa_next = ATOMIC_VAR_INIT(0);
+
+/**
+ * Reads the CPUs of a NUMA node, from a list such as "0-7,16-23".
+ */
+static int vlc_numa_cpus (unsigned node, cpu_set_t *set)
+{
+    char path[64];
+
+    snprintf (path, sizeof (path), "/sys/devices/system/node/node%u/cpulist",
+              node);
+
+    FILE *stream = fopen (path, "re");
+    if (stream == NULL)
+        return -1;
+
+    unsigned first, last;
+    int ret = -1;
+
+    CPU_ZERO (set);
+    while (fscanf (stream, "%u", &first) == 1)
+    {
+        int c = fgetc (stream);
+
+        last = first;
+        if (c == '-')
+        {
+            if (fscanf (stream, "%u", &last) != 1)
+                break;
+            c = fgetc (stream);
+        }
+        for (unsigned cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+            CPU_SET (cpu, set);
+        ret = 0;
+        if (c != ',')
+            break;
+    }
+    fclose (stream);
+    return ret;
+}
+
+static void vlc_numa_setup (libvlc_int_t *p_libvlc)
+{
+    if (var_InheritInteger (p_libvlc, "thread-affinity") != 1)
+        return;
+
+    cpu_set_t set;
+    unsigned n = 0;
+
+    while (n < VLC_NUMA_MAX_NODES && vlc_numa_cpus (n, &set) == 0)
+        n++;
+    if (n > 1 && sched_getaffinity (0, sizeof (numa_all_cpus),
+                                    &numa_all_cpus) == 0)
+        numa_nodes = n;
+}
+
+/**
+ * Binds the calling thread to the next NUMA node, if the thread affinity
+ * policy says so. As Linux threads inherit the CPU affinity and the memory
+ * policy of their creator, the threads created by the calling thread run on
+ * the same node, and their allocations, such as picture pools and FIFOs,
+ * preferably come from that node.
+ */
+void vlc_thread_bind_node (void)
+{
+    if (numa_nodes == 0)
+        return;
+
+    unsigned node = atomic_fetch_add (&numa_next, 1) % numa_nodes;
+    cpu_set_t set;
+
+    if (vlc_numa_cpus (node, &set))
+        return;
+    CPU_AND (&set, &set, &numa_all_cpus);
+    if (CPU_COUNT (&set) == 0)
+        return; /* none of the CPUs of the node are allowed */
+
+    sched_setaffinity (0, sizeof (set), &set);
+# ifdef SYS_set_mempolicy
+    unsigned long nodes = 1UL << node;
+    syscall (SYS_set_mempolicy, 1 /* MPOL_PREFERRED */, &nodes,
+             8 * sizeof (nodes));
+# endif
+}
+
+/**
+ * Undoes vlc_thread_bind_node(), for process-wide threads that may be created
+ * by a bound thread.
+ */
+void vlc_thread_unbind (void)
+{
+    if (numa_nodes == 0)
+        return;
+
+    sched_setaffinity (0, sizeof (numa_all_cpus), &numa_all_cpus);
+# ifdef SYS_set_mempolicy
+    syscall (SYS_set_mempolicy, 0 /* MPOL_DEFAULT */, NULL, 0);
+# endif
+}
+#else
+# define vlc_numa_setup(obj) (void)(obj)
+#endif
+
 void vlc_threads_setup (libvlc_int_t *p_libvlc)
 {
     static vlc_mutex_t lock = VLC_STATIC_MUTEX;
@@ -415,6 +524,7 @@ void vlc_threads_setup (libvlc_int_t *p_libvlc)
             rt_offset = var_InheritInteger (p_libvlc, "rt-offset");
             rt_priorities = true;
         }
+        vlc_numa_setup (p_libvlc);
         initialized = true;
     }
     vlc_mutex_unlock (&lock);
@@ -1,5 +1,5 @@
 /*****************************************************************************
- * timer.c: simple threaded timer
+ * timer.c: timer wheel
  *****************************************************************************
  * Copyright (C) 2009-2012 Rémi Denis-Courmont
  *
@@ -28,6 +28,7 @@
 
 #include <vlc_common.h>
 #include <vlc_atomic.h>
+#include "libvlc.h"
 
 /*
  * POSIX timers are essentially unusable from a library: there provide no safe
@@ -35,67 +36,339 @@
  * they typically require one thread per timer plus one thread per iteration,
  * which is inefficient and overkill (unless you need multiple iteration
  * of the same timer concurrently).
- * Thus, this is a generic manual implementation of timers using a thread.
+ * Thus, this is a generic manual implementation of timers: all timers share
+ * a pool of threads. One of them, the leader, keeps the timers in a
+ * hierarchical timing wheel and sleeps until the earliest deadline. When a
+ * timer expires, the leader hands the wheel over to another thread, starting
+ * one if none is idle, and then runs the callback itself: a callback that
+ * blocks does not delay the other timers.
+ *
+ * The wheel has WHEEL_LEVELS levels of WHEEL_SLOTS slots. A slot of level 0
+ * holds the timers expiring within one tick, a slot of level N the timers
+ * expiring within WHEEL_SLOTS^N ticks; the timers of a slot are moved down
+ * to the lower levels ("cascaded") when the wheel reaches the slot. Arming
+ * and disarming are thus constant time. The ticks only sort the timers:
+ * the thread wakes up at the exact deadline of each timer.
  */
 
+#define WHEEL_BITS   6
+#define WHEEL_SLOTS  (1 << WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_TICK   (CLOCK_FREQ / 1000)
+
 struct vlc_timer
 {
-    vlc_thread_t thread;
-    vlc_cond_t   reschedule;
-    vlc_mutex_t  lock;
+    struct vlc_timer  *next;
+    struct vlc_timer **pprev;
+    uint64_t     tick; /* slot position in the wheel */
     void       (*func) (void *);
     void        *data;
     mtime_t      value, interval;
     atomic_uint  overruns;
+    bool         busy; /* callback running */
+    unsigned     expired; /* occurrences left to run */
 };
 
-VLC_NORETURN
-static void *vlc_timer_thread (void *data)
+struct vlc_timer_thread
 {
-    struct vlc_timer *timer = data;
+    struct vlc_timer_thread *next;
+    vlc_thread_t thread;
+};
 
-    vlc_mutex_lock (&timer->lock);
-    mutex_cleanup_push (&timer->lock);
+static struct
+{
+    vlc_mutex_t       lock;
+    vlc_cond_t        wakeup; /* for the leader */
+    vlc_cond_t        lead; /* for the idle threads */
+    vlc_cond_t        idle; /* timer no longer busy */
+    uint64_t          tick; /* current position of the wheel */
+    mtime_t           deadline; /* wake up date of the leader, or zero */
+    bool              has_leader;
+    unsigned          followers; /* idle threads */
+    struct vlc_timer_thread *threads;
+    bool              exit;
+    struct vlc_timer *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+} wheel;
 
-    for (;;)
+/* Serializes the start and stop of the thread */
+static vlc_mutex_t wheel_setup_lock = VLC_STATIC_MUTEX;
+static unsigned wheel_users = 0;
+
+static void wheel_insert (struct vlc_timer *timer)
+{
+    uint64_t tick = timer->value / WHEEL_TICK;
+    unsigned level = 0;
+
+    if (tick < wheel.tick)
+        tick = wheel.tick; /* late already */
+
+    uint64_t delta = tick - wheel.tick;
+
+    while (level < WHEEL_LEVELS - 1
+        && delta >= (UINT64_C(1) << (WHEEL_BITS * (level + 1))))
+        level++;
+    if (delta >= (UINT64_C(1) << (WHEEL_BITS * WHEEL_LEVELS)))
+        /* Beyond the wheel: cascaded again from the last slot it can reach */
+        tick = wheel.tick + (UINT64_C(1) << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+
+    struct vlc_timer **slot =
+        &wheel.slots[level][(tick >> (WHEEL_BITS * level)) & WHEEL_MASK];
+
+    timer->tick = tick;
+    timer->next = *slot;
+    if (timer->next != NULL)
+        timer->next->pprev = &timer->next;
+    timer->pprev = slot;
+    *slot = timer;
+}
+
+static void wheel_remove (struct vlc_timer *timer)
+{
+    *timer->pprev = timer->next;
+    if (timer->next != NULL)
+        timer->next->pprev = timer->pprev;
+}
+
+/**
+ * Returns the next tick a non-empty slot of the upper levels is cascaded at,
+ * or UINT64_MAX if the upper levels are empty.
+ */
+static uint64_t wheel_next_cascade (void)
+{
+    uint64_t next = UINT64_MAX;
+
+    for (unsigned level = 1; level < WHEEL_LEVELS; level++)
+    {
+        unsigned shift = WHEEL_BITS * level;
+
+        for (unsigned k = 1; k <= WHEEL_SLOTS; k++)
+        {
+            uint64_t tick = ((wheel.tick >> shift) + k) << shift;
+
+            if (tick >= next)
+                break;
+            if (wheel.slots[level][(tick >> shift) & WHEEL_MASK] != NULL)
+            {
+                next = tick;
+                break;
+            }
+        }
+    }
+    return next;
+}
+
+/**
+ * Returns the next tick after the current one with anything to do,
+ * or UINT64_MAX if the wheel is empty.
+ */
+static uint64_t wheel_next (void)
+{
+    uint64_t next = wheel_next_cascade ();
+
+    for (unsigned k = 1; k < WHEEL_SLOTS && wheel.tick + k < next; k++)
+        if (wheel.slots[0][(wheel.tick + k) & WHEEL_MASK] != NULL)
+            return wheel.tick + k;
+    return next;
+}
+
+/**
+ * Returns the date the thread must wake up at, or zero if none.
+ */
+static mtime_t wheel_deadline (void)
+{
+    uint64_t cascade = wheel_next_cascade ();
+    mtime_t deadline = (cascade != UINT64_MAX) ? cascade * WHEEL_TICK : 0;
+
+    for (unsigned k = 0; k < WHEEL_SLOTS; k++)
     {
-        while (timer->value == 0)
-            vlc_cond_wait (&timer->reschedule, &timer->lock);
+        struct vlc_timer *timer = wheel.slots[0][(wheel.tick + k) & WHEEL_MASK];
 
-        if (vlc_cond_timedwait (&timer->reschedule, &timer->lock,
-                                timer->value) == 0)
+        if (timer == NULL)
             continue;
-        if (timer->interval == 0)
-            timer->value = 0; /* disarm */
-        vlc_mutex_unlock (&timer->lock);
+        for (; timer != NULL; timer = timer->next)
+            if (deadline == 0 || timer->value < deadline)
+                deadline = timer->value;
+        break;
+    }
+    return deadline;
+}
+
+static void wheel_cascade (unsigned level, unsigned index)
+{
+    struct vlc_timer *timer = wheel.slots[level][index];
+
+    wheel.slots[level][index] = NULL;
+    while (timer != NULL)
+    {
+        struct vlc_timer *next = timer->next;
+
+        wheel_insert (timer);
+        timer = next;
+    }
+}
+
+/**
+ * Advances the wheel up to the given date, and removes an expired timer.
+ * \return the expired timer, or NULL if none
+ */
+static struct vlc_timer *wheel_expire (mtime_t now)
+{
+    uint64_t target = now / WHEEL_TICK;
+
+    for (;;)
+    {
+        for (struct vlc_timer *timer = wheel.slots[0][wheel.tick & WHEEL_MASK];
+             timer != NULL; timer = timer->next)
+            if (timer->value <= now)
+            {
+                wheel_remove (timer);
+                return timer;
+            }
+
+        uint64_t next = wheel_next ();
+        if (next > target)
+            break;
+
+        wheel.tick = next;
+        for (unsigned level = WHEEL_LEVELS - 1; level > 0; level--)
+        {
+            unsigned shift = WHEEL_BITS * level;
 
-        int canc = vlc_savecancel ();
-        timer->func (timer->data);
-        vlc_restorecancel (canc);
+            if ((next & ((UINT64_C(1) << shift) - 1)) == 0)
+                wheel_cascade (level, (next >> shift) & WHEEL_MASK);
+        }
+    }
+
+    /* Nothing happens until the target: skip there */
+    if (target > wheel.tick)
+        wheel.tick = target;
+    return NULL;
+}
+
+static void *vlc_timer_thread (void *data);
+
+/**
+ * Starts another thread of the pool.
+ */
+static int vlc_timer_spawn (void)
+{
+    struct vlc_timer_thread *th = malloc (sizeof (*th));
 
+    if (unlikely(th == NULL))
+        return ENOMEM;
+    if (vlc_clone (&th->thread, vlc_timer_thread, NULL,
+                   VLC_THREAD_PRIORITY_INPUT))
+    {
+        free (th);
+        return ENOMEM;
+    }
+    th->next = wheel.threads;
+    wheel.threads = th;
+    return 0;
+}
+
+/**
+ * Waits until a timer the calling thread must run expires.
+ * \return the timer, or NULL on exit
+ */
+static struct vlc_timer *wheel_lead (void)
+{
+    while (!wheel.exit)
+    {
         mtime_t now = mdate ();
-        unsigned misses;
+        struct vlc_timer *timer = wheel_expire (now);
 
-        vlc_mutex_lock (&timer->lock);
-        if (timer->interval == 0)
+        if (timer == NULL)
+        {
+            wheel.deadline = wheel_deadline ();
+            if (wheel.deadline == 0)
+                vlc_cond_wait (&wheel.wakeup, &wheel.lock);
+            else
+                vlc_cond_timedwait (&wheel.wakeup, &wheel.lock,
+                                    wheel.deadline);
             continue;
+        }
 
-        misses = (now - timer->value) / timer->interval;
-        timer->value += timer->interval;
-        /* Try to compensate for one miss (mwait() will return immediately)
-         * but no more. Otherwise, we might busy loop, after extended periods
-         * without scheduling (suspend, SIGSTOP, RT preemption, ...). */
-        if (misses > 1)
+        if (timer->interval != 0)
         {
-            misses--;
-            timer->value += misses * timer->interval;
-            atomic_fetch_add_explicit (&timer->overruns, misses,
-                                       memory_order_relaxed);
+            unsigned misses = (now - timer->value) / timer->interval;
+
+            timer->value += timer->interval;
+            /* Try to compensate for one miss (the timer will expire
+             * immediately) but no more. Otherwise, we might busy loop, after
+             * extended periods without scheduling (suspend, SIGSTOP, RT
+             * preemption, ...). */
+            if (misses > 1)
+            {
+                misses--;
+                timer->value += misses * timer->interval;
+                atomic_fetch_add_explicit (&timer->overruns, misses,
+                                           memory_order_relaxed);
+            }
+            wheel_insert (timer);
         }
+        else
+            timer->value = 0; /* disarm */
+
+        if (!timer->busy)
+        {
+            timer->busy = true;
+            timer->expired = 1;
+            return timer;
+        }
+
+        /* Occurrences of a timer run one at a time: keep one more for the
+         * thread running the callback */
+        if (timer->expired >= 1)
+            atomic_fetch_add_explicit (&timer->overruns, 1,
+                                       memory_order_relaxed);
+        else
+            timer->expired++;
     }
+    return NULL;
+}
+
+static void *vlc_timer_thread (void *data)
+{
+    (void) data;
 
-    vlc_cleanup_pop ();
-    vlc_assert_unreachable ();
+    vlc_thread_unbind (); /* shared by all inputs */
+    vlc_mutex_lock (&wheel.lock);
+    for (;;)
+    {
+        while (wheel.has_leader && !wheel.exit)
+        {
+            wheel.followers++;
+            vlc_cond_wait (&wheel.lead, &wheel.lock);
+            wheel.followers--;
+        }
+
+        wheel.has_leader = true;
+        struct vlc_timer *timer = wheel_lead ();
+        wheel.has_leader = false;
+        wheel.deadline = 0;
+        if (timer == NULL)
+            break;
+
+        /* Hand the wheel over, as the callback may block */
+        if (wheel.followers > 0)
+            vlc_cond_signal (&wheel.lead);
+        else
+            vlc_timer_spawn (); /* or lead again after the callback */
+
+        while (timer->expired > 0)
+        {
+            timer->expired--;
+            vlc_mutex_unlock (&wheel.lock);
+            timer->func (timer->data);
+            vlc_mutex_lock (&wheel.lock);
+        }
+        timer->busy = false;
+        vlc_cond_broadcast (&wheel.idle);
+    }
+    vlc_mutex_unlock (&wheel.lock);
+    return NULL;
 }
 
 int vlc_timer_create (vlc_timer_t *id, void (*func) (void *), void *data)
@@ -104,23 +377,42 @@ int vlc_timer_create (vlc_timer_t *id, void (*func) (void *), void *data)
 
     if (unlikely(timer == NULL))
         return ENOMEM;
-    vlc_mutex_init (&timer->lock);
-    vlc_cond_init (&timer->reschedule);
     assert (func);
     timer->func = func;
     timer->data = data;
     timer->value = 0;
     timer->interval = 0;
     atomic_init(&timer->overruns, 0);
+    timer->busy = false;
+    timer->expired = 0;
 
-    if (vlc_clone (&timer->thread, vlc_timer_thread, timer,
-                   VLC_THREAD_PRIORITY_INPUT))
+    vlc_mutex_lock (&wheel_setup_lock);
+    if (wheel_users == 0)
     {
-        vlc_cond_destroy (&timer->reschedule);
-        vlc_mutex_destroy (&timer->lock);
-        free (timer);
-        return ENOMEM;
+        vlc_mutex_init (&wheel.lock);
+        vlc_cond_init (&wheel.wakeup);
+        vlc_cond_init (&wheel.lead);
+        vlc_cond_init (&wheel.idle);
+        wheel.tick = mdate () / WHEEL_TICK;
+        wheel.deadline = 0;
+        wheel.has_leader = false;
+        wheel.followers = 0;
+        wheel.threads = NULL;
+        wheel.exit = false;
+
+        if (vlc_timer_spawn ())
+        {
+            vlc_cond_destroy (&wheel.idle);
+            vlc_cond_destroy (&wheel.lead);
+            vlc_cond_destroy (&wheel.wakeup);
+            vlc_mutex_destroy (&wheel.lock);
+            vlc_mutex_unlock (&wheel_setup_lock);
+            free (timer);
+            return ENOMEM;
+        }
     }
+    wheel_users++;
+    vlc_mutex_unlock (&wheel_setup_lock);
 
     *id = timer;
     return 0;
@@ -128,10 +420,40 @@ int vlc_timer_create (vlc_timer_t *id, void (*func) (void *), void *data)
 
 void vlc_timer_destroy (vlc_timer_t timer)
 {
-    vlc_cancel (timer->thread);
-    vlc_join (timer->thread, NULL);
-    vlc_cond_destroy (&timer->reschedule);
-    vlc_mutex_destroy (&timer->lock);
+    vlc_mutex_lock (&wheel.lock);
+    if (timer->value != 0)
+        wheel_remove (timer);
+    timer->value = 0;
+    timer->expired = 0;
+    while (timer->busy)
+        vlc_cond_wait (&wheel.idle, &wheel.lock);
+    vlc_mutex_unlock (&wheel.lock);
+
+    vlc_mutex_lock (&wheel_setup_lock);
+    assert (wheel_users > 0);
+    if (--wheel_users == 0)
+    {
+        vlc_mutex_lock (&wheel.lock);
+        wheel.exit = true;
+        vlc_cond_signal (&wheel.wakeup);
+        vlc_cond_broadcast (&wheel.lead);
+        vlc_mutex_unlock (&wheel.lock);
+
+        /* No timers are left, so no threads can be started anymore */
+        while (wheel.threads != NULL)
+        {
+            struct vlc_timer_thread *th = wheel.threads;
+
+            wheel.threads = th->next;
+            vlc_join (th->thread, NULL);
+            free (th);
+        }
+        vlc_cond_destroy (&wheel.idle);
+        vlc_cond_destroy (&wheel.lead);
+        vlc_cond_destroy (&wheel.wakeup);
+        vlc_mutex_destroy (&wheel.lock);
+    }
+    vlc_mutex_unlock (&wheel_setup_lock);
     free (timer);
 }
 
@@ -141,11 +463,18 @@ void vlc_timer_schedule (vlc_timer_t timer, bool absolute,
     if (!absolute && value != 0)
         value += mdate();
 
-    vlc_mutex_lock (&timer->lock);
+    vlc_mutex_lock (&wheel.lock);
+    if (timer->value != 0)
+        wheel_remove (timer);
     timer->value = value;
     timer->interval = interval;
-    vlc_cond_signal (&timer->reschedule);
-    vlc_mutex_unlock (&timer->lock);
+    if (value != 0)
+    {
+        wheel_insert (timer);
+        if (wheel.deadline == 0 || value < wheel.deadline)
+            vlc_cond_signal (&wheel.wakeup);
+    }
+    vlc_mutex_unlock (&wheel.lock);
 }
 
 unsigned vlc_timer_getoverrun (vlc_timer_t timer)
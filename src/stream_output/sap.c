@@ -194,7 +194,7 @@ sout_AnnounceRegisterSDP (vlc_object_t *obj, const char *sdp,
         if (res->ai_addrlen <= sizeof (addr))
             memcpy (&addr, res->ai_addr, res->ai_addrlen);
         addrlen = res->ai_addrlen;
-        freeaddrinfo (res);
+        vlc_freeaddrinfo (res);
     }
 
     if (addrlen == 0 || addrlen > sizeof (addr))
@@ -49,6 +49,7 @@
 #include <vlc_modules.h>
 
 #include "input/input_interface.h"
+#include "libvlc.h"
 
 #define VLC_CODEC_NULL VLC_FOURCC( 'n', 'u', 'l', 'l' )
 
@@ -112,6 +113,9 @@ sout_instance_t *sout_NewInstance( vlc_object_t *p_parent, const char *psz_dest
     /* *** init descriptor *** */
     p_sout->psz_sout    = strdup( psz_dest );
     p_sout->i_out_pace_nocontrol = 0;
+    p_sout->b_unpaced = var_InheritBool( p_parent, "sout-unpaced" );
+    if( p_sout->b_unpaced )
+        msg_Dbg( p_sout, "processing as fast as possible" );
 
     vlc_mutex_init( &p_sout->lock );
     p_sout->p_stream = NULL;
@@ -225,8 +229,7 @@ int sout_InputSendBuffer( sout_packetizer_input_t *p_input,
     }
 
     vlc_mutex_lock( &p_sout->lock );
-    i_ret = p_sout->p_stream->pf_send( p_sout->p_stream,
-                                       p_input->id, p_buffer );
+    i_ret = sout_StreamIdSend( p_sout->p_stream, p_input->id, p_buffer );
     vlc_mutex_unlock( &p_sout->lock );
 
     return i_ret;
@@ -715,6 +718,17 @@ static void mrl_Clean( mrl_t *p_mrl )
  ****************************************************************************
  ****************************************************************************/
 
+/* Send a block to a "stream_out" module */
+int sout_StreamIdSend( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                       block_t *p_buffer )
+{
+    vlc_cputime_frame_t frame;
+    bool b_timed = vlc_CpuTimeStart( p_stream, &frame );
+    int i_ret = p_stream->pf_send( p_stream, id, p_buffer );
+    vlc_CpuTimeStop( p_stream, b_timed, &frame, p_stream->p_module );
+    return i_ret;
+}
+
 /* Destroy a "stream_out" module */
 static void sout_StreamDelete( sout_stream_t *p_stream )
 {
@@ -722,7 +736,8 @@ static void sout_StreamDelete( sout_stream_t *p_stream )
 
     msg_Dbg( p_stream, "destroying chain... (name=%s)", p_stream->psz_name );
 
-    p_sout->i_out_pace_nocontrol -= p_stream->pace_nocontrol;
+    if( !p_sout->b_unpaced )
+        p_sout->i_out_pace_nocontrol -= p_stream->pace_nocontrol;
 
     if( p_stream->p_module != NULL )
         module_unneed( p_stream, p_stream->p_module );
@@ -792,7 +807,8 @@ static sout_stream_t *sout_StreamNew( sout_instance_t *p_sout, char *psz_name,
         return NULL;
     }
 
-    p_sout->i_out_pace_nocontrol += p_stream->pace_nocontrol;
+    if( !p_sout->b_unpaced )
+        p_sout->i_out_pace_nocontrol += p_stream->pace_nocontrol;
     return p_stream;
 }
 
@@ -0,0 +1,328 @@
+/*****************************************************************************
+ * bench.c: libvlccore primitives micro-benchmarks
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Times the core primitives that sit on the playback hot paths. Each result
+ * is printed on its own line as "<name> <value> <unit>", so that the output
+ * of two builds can be compared with a script, and the extra information
+ * goes to the standard error.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_arrays.h>
+#include <vlc_block.h>
+#include <vlc_es.h>
+#include <vlc_interrupt.h>
+#include <vlc_picture_pool.h>
+#include "../../lib/libvlc_internal.h"
+
+#define ITERATIONS 1000000
+
+static void report(const char *name, double value, const char *unit)
+{
+    printf("%s %.3f %s\n", name, value, unit);
+    fflush(stdout);
+}
+
+/* Reports the time per operation of a loop started at the given date */
+static void report_ns(const char *name, mtime_t start, unsigned ops)
+{
+    report(name, (mdate() - start) * (1000000000. / CLOCK_FREQ) / ops, "ns");
+}
+
+static void bench_block(void)
+{
+    mtime_t start = mdate();
+
+    for (unsigned i = 0; i < ITERATIONS; i++)
+    {
+        block_t *block = block_Alloc(1316);
+        assert(block != NULL);
+        block_Release(block);
+    }
+    report_ns("block_alloc_release", start, ITERATIONS);
+}
+
+/*** FIFO ***/
+#define FIFO_PRODUCERS 4
+#define FIFO_BLOCKS (ITERATIONS / 10)
+
+static void *fifo_producer(void *data)
+{
+    block_fifo_t *fifo = data;
+
+    for (unsigned i = 0; i < FIFO_BLOCKS; i++)
+    {
+        block_t *block = block_Alloc(188);
+        assert(block != NULL);
+        block_FifoPut(fifo, block);
+    }
+    return NULL;
+}
+
+static void bench_fifo_run(const char *name, block_fifo_t *fifo,
+                           unsigned producers)
+{
+    vlc_thread_t threads[FIFO_PRODUCERS];
+    mtime_t start = mdate();
+
+    for (unsigned i = 0; i < producers; i++)
+    {
+        int val = vlc_clone(&threads[i], fifo_producer, fifo,
+                            VLC_THREAD_PRIORITY_LOW);
+        assert(val == 0);
+    }
+    for (unsigned i = 0; i < producers * FIFO_BLOCKS; i++)
+        block_Release(block_FifoGet(fifo));
+    report_ns(name, start, producers * FIFO_BLOCKS);
+
+    for (unsigned i = 0; i < producers; i++)
+        vlc_join(threads[i], NULL);
+    block_FifoRelease(fifo);
+}
+
+static void bench_fifo(void)
+{
+    bench_fifo_run("block_fifo_1to1", block_FifoNew(), 1);
+    bench_fifo_run("block_fifo_spsc", block_FifoNewSPSC(), 1);
+    bench_fifo_run("block_fifo_4to1", block_FifoNew(), FIFO_PRODUCERS);
+}
+
+static void bench_picture_pool(void)
+{
+    video_format_t fmt;
+    video_format_Setup(&fmt, VLC_CODEC_I420, 1920, 1080, 1920, 1080, 1, 1);
+
+    picture_pool_t *pool = picture_pool_NewFromFormat(&fmt, 10);
+    assert(pool != NULL);
+
+    mtime_t start = mdate();
+    for (unsigned i = 0; i < ITERATIONS; i++)
+    {
+        picture_t *pic = picture_pool_Get(pool);
+        assert(pic != NULL);
+        picture_Release(pic);
+    }
+    report_ns("picture_pool_get_release", start, ITERATIONS);
+    picture_pool_Release(pool);
+}
+
+/*** Dictionary ***/
+#define DICT_KEYS 10000
+
+static void bench_dictionary(void)
+{
+    static char keys[DICT_KEYS][16];
+    vlc_dictionary_t dict;
+    mtime_t start;
+
+    for (unsigned i = 0; i < DICT_KEYS; i++)
+        snprintf(keys[i], sizeof (keys[i]), "key-%u", i);
+
+    vlc_dictionary_init(&dict, 0);
+
+    start = mdate();
+    for (unsigned i = 0; i < DICT_KEYS; i++)
+        vlc_dictionary_insert(&dict, keys[i], keys[i]);
+    report_ns("dictionary_insert", start, DICT_KEYS);
+
+    unsigned found = 0;
+
+    start = mdate();
+    for (unsigned n = 0; n < ITERATIONS / DICT_KEYS; n++)
+        for (unsigned i = 0; i < DICT_KEYS; i++)
+            if (vlc_dictionary_value_for_key(&dict, keys[i]) == keys[i])
+                found++;
+    report_ns("dictionary_lookup", start, ITERATIONS);
+    assert(found == (ITERATIONS / DICT_KEYS) * DICT_KEYS);
+
+    start = mdate();
+    for (unsigned i = 0; i < DICT_KEYS; i++)
+        vlc_dictionary_remove_value_for_key(&dict, keys[i], NULL, NULL);
+    report_ns("dictionary_remove", start, DICT_KEYS);
+
+    vlc_dictionary_clear(&dict, NULL, NULL);
+}
+
+static void bench_variables(void)
+{
+    libvlc_int_t *obj = libvlc_InternalCreate();
+    assert(obj != NULL);
+
+    /* Some other variables, as a real object would have */
+    for (unsigned i = 0; i < 64; i++)
+    {
+        char name[16];
+
+        snprintf(name, sizeof (name), "bench-%u", i);
+        var_Create(obj, name, VLC_VAR_INTEGER);
+    }
+    var_Create(obj, "bench", VLC_VAR_INTEGER);
+
+    mtime_t start = mdate();
+    for (unsigned i = 0; i < ITERATIONS; i++)
+        var_SetInteger(obj, "bench", i);
+    report_ns("var_set_integer", start, ITERATIONS);
+
+    unsigned found = 0;
+
+    start = mdate();
+    for (unsigned i = 0; i < ITERATIONS; i++)
+        if (var_GetInteger(obj, "bench") == ITERATIONS - 1)
+            found++;
+    report_ns("var_get_integer", start, ITERATIONS);
+    assert(found == ITERATIONS);
+
+    libvlc_InternalDestroy(obj);
+}
+
+/*** Timer ***/
+#define TIMER_TICKS  100
+#define TIMER_PERIOD (CLOCK_FREQ / 100)
+
+struct timer_data
+{
+    vlc_timer_t timer;
+    vlc_sem_t   done;
+    mtime_t     deadline;
+    unsigned    count;
+    mtime_t     total;
+    mtime_t     worst;
+};
+
+static void timer_callback(void *data)
+{
+    struct timer_data *d = data;
+    mtime_t late = mdate() - d->deadline;
+
+    if (d->count >= TIMER_TICKS)
+        return; /* until the timer is destroyed */
+    d->total += late;
+    if (late > d->worst)
+        d->worst = late;
+    d->deadline += TIMER_PERIOD * (1 + vlc_timer_getoverrun(d->timer));
+    if (++d->count == TIMER_TICKS)
+        vlc_sem_post(&d->done);
+}
+
+static void bench_timer(void)
+{
+    struct timer_data d = { .count = 0, .total = 0, .worst = 0 };
+
+    vlc_sem_init(&d.done, 0);
+    int val = vlc_timer_create(&d.timer, timer_callback, &d);
+    assert(val == 0);
+
+    d.deadline = mdate() + TIMER_PERIOD;
+    vlc_timer_schedule(d.timer, true, d.deadline, TIMER_PERIOD);
+    vlc_sem_wait(&d.done);
+    vlc_timer_destroy(d.timer);
+    vlc_sem_destroy(&d.done);
+
+    report("timer_lateness_mean", (double)d.total / TIMER_TICKS, "us");
+    report("timer_lateness_max", d.worst, "us");
+}
+
+/*** Interrupt ***/
+#define INTERRUPTS 100
+
+struct interrupt_data
+{
+    vlc_interrupt_t *ictx;
+    vlc_sem_t        wait;
+    vlc_sem_t        ready;
+    vlc_sem_t        woken;
+    mtime_t          wake_date;
+};
+
+static void *interrupt_thread(void *data)
+{
+    struct interrupt_data *d = data;
+
+    vlc_interrupt_set(d->ictx);
+    for (unsigned i = 0; i < INTERRUPTS; i++)
+    {
+        vlc_sem_post(&d->ready);
+        int val = vlc_sem_wait_i11e(&d->wait);
+        d->wake_date = mdate();
+        assert(val == EINTR);
+        vlc_sem_post(&d->woken);
+    }
+    vlc_interrupt_set(NULL);
+    return NULL;
+}
+
+static void bench_interrupt(void)
+{
+    struct interrupt_data d;
+    vlc_thread_t th;
+    mtime_t total = 0;
+
+    d.ictx = vlc_interrupt_create();
+    assert(d.ictx != NULL);
+    vlc_sem_init(&d.wait, 0);
+    vlc_sem_init(&d.ready, 0);
+    vlc_sem_init(&d.woken, 0);
+    int val = vlc_clone(&th, interrupt_thread, &d, VLC_THREAD_PRIORITY_LOW);
+    assert(val == 0);
+
+    for (unsigned i = 0; i < INTERRUPTS; i++)
+    {
+        vlc_sem_wait(&d.ready);
+        mwait(mdate() + CLOCK_FREQ / 100); /* let the thread block */
+
+        mtime_t date = mdate();
+        vlc_interrupt_raise(d.ictx);
+        vlc_sem_wait(&d.woken);
+        total += d.wake_date - date;
+    }
+
+    vlc_join(th, NULL);
+    vlc_sem_destroy(&d.woken);
+    vlc_sem_destroy(&d.ready);
+    vlc_sem_destroy(&d.wait);
+    vlc_interrupt_destroy(d.ictx);
+
+    report("interrupt_latency", (double)total / INTERRUPTS, "us");
+}
+
+int main(void)
+{
+    fprintf(stderr, "libvlccore micro-benchmarks, %u CPU(s)\n",
+            vlc_GetCPUCount());
+
+    bench_block();
+    bench_fifo();
+    bench_picture_pool();
+    bench_dictionary();
+    bench_variables();
+    bench_timer();
+    bench_interrupt();
+    return 0;
+}
@@ -84,10 +84,264 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void test_block_share (void)
+{
+    block_t *block = block_Alloc (sizeof (text));
+    assert (block != NULL);
+    memcpy (block->p_buffer, text, sizeof (text));
+    block->i_pts = 42;
+
+    /* Plain blocks are copied */
+    block_t *dup = block_Share (block);
+    assert (dup != NULL && dup->p_buffer != block->p_buffer);
+    assert (dup->i_pts == 42);
+    block_Release (dup);
+
+    block = block_Shareable (block);
+    assert (block != NULL);
+    assert (block_Shareable (block) == block);
+
+    block_t *view = block_Share (block);
+    assert (view != NULL);
+    assert (view->p_buffer == block->p_buffer);
+    assert (view->i_buffer == sizeof (text));
+    assert (view->i_pts == 42);
+
+    /* Growing a shared payload copies it */
+    view = block_Realloc (view, 2, sizeof (text));
+    assert (view != NULL);
+    assert (view->p_buffer + 2 != block->p_buffer);
+    assert (!memcmp (view->p_buffer + 2, text, sizeof (text)));
+    memset (view->p_buffer, 0, view->i_buffer);
+    block_Release (view);
+    assert (!memcmp (block->p_buffer, text, sizeof (text)));
+
+    /* Unsharing copies the payload only while it is shared */
+    view = block_Share (block);
+    assert (view != NULL);
+    view = block_Unshare (view);
+    assert (view != NULL && view->p_buffer != block->p_buffer);
+    memset (view->p_buffer, 0, view->i_buffer);
+    assert (!memcmp (block->p_buffer, text, sizeof (text)));
+    block_Release (view);
+
+    view = block_Share (block);
+    assert (view != NULL);
+    block_Release (block);
+    const uint8_t *payload = view->p_buffer;
+    view = block_Unshare (view);
+    assert (view != NULL && view->p_buffer == payload);
+    assert (!memcmp (view->p_buffer, text, sizeof (text)));
+    block_Release (view);
+}
+
+static void test_block_share_range (void)
+{
+    block_t *block = block_Alloc (sizeof (text));
+    assert (block != NULL);
+    memcpy (block->p_buffer, text, sizeof (text));
+    block->i_pts = 42;
+
+    /* Plain blocks are copied */
+    block_t *dup = block_ShareRange (block, 4, 5);
+    assert (dup != NULL && dup->p_buffer != block->p_buffer + 4);
+    assert (dup->i_buffer == 5 && dup->i_pts == 42);
+    assert (!memcmp (dup->p_buffer, text + 4, 5));
+    assert (block_ChainJoin (dup) == NULL);
+    block_Release (dup);
+
+    block = block_Shareable (block);
+    assert (block != NULL);
+
+    block_t *a = block_ShareRange (block, 0, 4);
+    block_t *b = block_ShareRange (block, 4, 5);
+    block_t *c = block_ShareRange (block, 10, 3);
+    assert (a != NULL && b != NULL && c != NULL);
+    assert (a->p_buffer == block->p_buffer && a->i_buffer == 4);
+    assert (b->p_buffer == block->p_buffer + 4 && b->i_buffer == 5);
+    a->i_length = 1;
+    b->i_length = 2;
+
+    /* Views with a gap are not joined */
+    a->p_next = c;
+    assert (block_ChainJoin (a) == NULL);
+    assert (a->p_next == c);
+    block_Release (c);
+
+    /* Nor views of another payload */
+    block_t *other = block_Shareable (block_Alloc (16));
+    assert (other != NULL);
+    a->p_next = other;
+    assert (block_ChainJoin (a) == NULL);
+    block_Release (other);
+
+    /* Consecutive views are joined without copying */
+    a->p_next = b;
+    block_t *ab = block_ChainGather (a);
+    assert (ab == a && ab->p_next == NULL);
+    assert (ab->p_buffer == block->p_buffer && ab->i_buffer == 9);
+    assert (ab->i_length == 3 && ab->i_pts == 42);
+
+    /* The payload outlives the original view */
+    block_Release (block);
+    assert (!memcmp (ab->p_buffer, text, 9));
+    block_Release (ab);
+}
+
+#define FIFO_COUNT 10000
+
+static void *test_fifo_producer (void *data)
+{
+    block_fifo_t *fifo = data;
+
+    for (unsigned i = 0; i < FIFO_COUNT; i++)
+    {
+        block_t *block = block_Alloc (i % 64);
+        assert (block != NULL);
+        block->i_dts = i;
+        block_FifoPut (fifo, block);
+    }
+    return NULL;
+}
+
+/* Keeps the ring overflowing while the consumer drains it */
+#define FIFO_BURST 600
+#define FIFO_BURST_COUNT (FIFO_BURST * 500)
+
+static void *test_fifo_burst_producer (void *data)
+{
+    block_fifo_t *fifo = data;
+
+    for (unsigned i = 0; i < FIFO_BURST_COUNT; i += FIFO_BURST)
+    {
+        block_t *chain = NULL, **pp = &chain;
+
+        for (unsigned j = i; j < i + FIFO_BURST; j++)
+        {
+            *pp = block_Alloc (0);
+            assert (*pp != NULL);
+            (*pp)->i_dts = j;
+            pp = &(*pp)->p_next;
+        }
+        block_FifoPut (fifo, chain);
+    }
+    return NULL;
+}
+
+static void test_block_fifo_spsc (void)
+{
+    block_fifo_t *fifo = block_FifoNewSPSC ();
+    vlc_thread_t th;
+
+    assert (fifo != NULL);
+    assert (block_FifoCount (fifo) == 0);
+
+    /* Chain put and overflow of the ring, single-threaded */
+    block_t *chain = NULL, **pp = &chain;
+    for (unsigned i = 0; i < 1000; i++)
+    {
+        *pp = block_Alloc (1);
+        assert (*pp != NULL);
+        (*pp)->i_dts = i;
+        pp = &(*pp)->p_next;
+    }
+    block_FifoPut (fifo, chain);
+    assert (block_FifoCount (fifo) == 1000);
+    for (unsigned i = 0; i < 1000; i++)
+    {
+        assert (block_FifoShow (fifo)->i_dts == i);
+        block_t *block = block_FifoGet (fifo);
+        assert (block->i_dts == i);
+        assert (block->p_next == NULL);
+        block_Release (block);
+    }
+    assert (block_FifoCount (fifo) == 0);
+
+    /* Concurrent producer */
+    int val = vlc_clone (&th, test_fifo_producer, fifo,
+                         VLC_THREAD_PRIORITY_LOW);
+    assert (val == 0);
+    for (unsigned i = 0; i < FIFO_COUNT; i++)
+    {
+        block_t *block = block_FifoGet (fifo);
+        assert (block->i_dts == i);
+        assert (block->i_buffer == i % 64);
+        block_Release (block);
+    }
+    vlc_join (th, NULL);
+    assert (block_FifoCount (fifo) == 0);
+
+    /* Concurrent producer, switching between the ring and the list */
+    val = vlc_clone (&th, test_fifo_burst_producer, fifo,
+                     VLC_THREAD_PRIORITY_LOW);
+    assert (val == 0);
+    for (unsigned i = 0; i < FIFO_BURST_COUNT; i++)
+    {
+        block_t *block = block_FifoGet (fifo);
+        assert (block->i_dts == i);
+        block_Release (block);
+    }
+    vlc_join (th, NULL);
+    assert (block_FifoCount (fifo) == 0);
+
+    test_fifo_producer (fifo);
+    block_FifoEmpty (fifo);
+    assert (block_FifoCount (fifo) == 0);
+    test_fifo_producer (fifo);
+    block_FifoRelease (fifo);
+}
+
+static void test_block_pool (void)
+{
+    block_pool_t *pool = block_PoolNew (188, 2);
+    assert (pool != NULL);
+
+    block_t *a = block_PoolAlloc (pool, 188);
+    block_t *b = block_PoolAlloc (pool, 100);
+    block_t *c = block_PoolAlloc (pool, 188);
+    assert (a != NULL && b != NULL && c != NULL);
+    assert (b->i_buffer == 100);
+    assert (((uintptr_t)a->p_buffer % 32) == 0);
+    memset (a->p_buffer, 0x47, a->i_buffer);
+    block_Release (a);
+    block_Release (b);
+    block_Release (c); /* pool is full: freed */
+
+    a = block_PoolAlloc (pool, sizeof (text));
+    assert (a != NULL);
+    assert (a->i_buffer == sizeof (text));
+    assert (a->p_next == NULL);
+    memcpy (a->p_buffer, text, sizeof (text));
+    a = block_Realloc (a, 100, sizeof (text) + 100);
+    assert (a != NULL);
+    assert (!memcmp (a->p_buffer + 100, text, sizeof (text)));
+
+    b = block_PoolAlloc (pool, 4096); /* oversized */
+    assert (b != NULL);
+    assert (b->i_buffer == 4096);
+    block_Release (b);
+
+    uint64_t hits, misses;
+    block_PoolGetStats (pool, &hits, &misses);
+    assert (hits == 1);
+    assert (misses == 4);
+
+    c = block_PoolAlloc (pool, 188);
+    assert (c != NULL);
+    block_PoolDelete (pool);
+    /* blocks outlive their pool */
+    block_Release (c);
+    block_Release (a);
+}
+
 int main (void)
 {
     test_block_File ();
     test_block ();
+    test_block_share ();
+    test_block_share_range ();
+    test_block_pool ();
+    test_block_fifo_spsc ();
     return 0;
 }
 
@@ -98,6 +98,52 @@ static void test(bool zombie)
             picture_Release(pics[i]);
 }
 
+#define MANY_PICTURES 200
+
+static void *release_later(void *data)
+{
+    picture_t *pic = data;
+
+    msleep(10000);
+    picture_Release(pic);
+    return NULL;
+}
+
+static void test_many(void)
+{
+    picture_t *pics[MANY_PICTURES];
+    vlc_thread_t th;
+
+    pool = picture_pool_NewFromFormat(&fmt, MANY_PICTURES);
+    assert(pool != NULL);
+    assert(picture_pool_GetSize(pool) == MANY_PICTURES);
+
+    for (unsigned i = 0; i < MANY_PICTURES; i++) {
+        pics[i] = picture_pool_Get(pool);
+        assert(pics[i] != NULL);
+        for (unsigned j = 0; j < i; j++)
+            assert(pics[j]->p[0].p_pixels != pics[i]->p[0].p_pixels);
+    }
+    assert(picture_pool_Get(pool) == NULL);
+
+    /* Wait for a picture released by another thread */
+    void *plane = pics[100]->p[0].p_pixels;
+    assert(vlc_clone(&th, release_later, pics[100],
+                     VLC_THREAD_PRIORITY_LOW) == 0);
+    pics[100] = picture_pool_Wait(pool);
+    assert(pics[100] != NULL);
+    assert(pics[100]->p[0].p_pixels == plane);
+    vlc_join(th, NULL);
+
+    for (unsigned i = 0; i < MANY_PICTURES; i++)
+        picture_Release(pics[i]);
+
+    pics[0] = picture_pool_Wait(pool);
+    assert(pics[0] != NULL);
+    picture_Release(pics[0]);
+    picture_pool_Release(pool);
+}
+
 int main(void)
 {
     video_format_Setup(&fmt, VLC_CODEC_I420, 320, 200, 320, 200, 1, 1);
@@ -114,6 +160,7 @@ int main(void)
 
     test(false);
     test(true);
+    test_many();
 
     return 0;
 }
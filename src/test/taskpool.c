@@ -0,0 +1,128 @@
+/*****************************************************************************
+ * taskpool.c: Test for task pool API
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_interrupt.h>
+
+#define TASKS 1000
+#define ROWS  1080
+
+static vlc_taskpool_t *pool;
+
+static void count(void *data)
+{
+    atomic_uint *counter = data;
+
+    atomic_fetch_add(counter, 1);
+}
+
+/* Submits and waits for tasks of its own from within a task */
+static void nested(void *data)
+{
+    vlc_taskgroup_t group;
+
+    vlc_taskgroup_init(&group);
+    for (unsigned i = 0; i < 10; i++)
+        vlc_taskpool_submit(pool, &group, count, data);
+    vlc_taskpool_wait(pool, &group);
+    vlc_taskgroup_destroy(&group);
+}
+
+static void rows(void *data, unsigned first, unsigned last)
+{
+    unsigned char *done = data;
+
+    assert(first < last && last <= ROWS);
+    for (unsigned i = first; i < last; i++)
+        done[i]++;
+}
+
+static void block(void *data)
+{
+    vlc_sem_wait(data);
+}
+
+int main(void)
+{
+    vlc_taskgroup_t group;
+    atomic_uint counter = ATOMIC_VAR_INIT(0);
+
+    pool = vlc_taskpool_hold();
+    assert(pool != NULL);
+    assert(vlc_taskpool_hold() == pool);
+    vlc_taskpool_release(pool);
+    assert(vlc_taskpool_count(pool) > 0);
+
+    vlc_taskgroup_init(&group);
+
+    /* plain tasks, and waiting twice with the same group */
+    for (unsigned i = 0; i < TASKS; i++)
+        vlc_taskpool_submit(pool, &group, count, &counter);
+    vlc_taskpool_wait(pool, &group);
+    assert(atomic_load(&counter) == TASKS);
+    vlc_taskpool_wait(pool, &group);
+
+    /* nested tasks */
+    atomic_store(&counter, 0);
+    for (unsigned i = 0; i < TASKS / 10; i++)
+        vlc_taskpool_submit(pool, &group, nested, &counter);
+    vlc_taskpool_wait(pool, &group);
+    assert(atomic_load(&counter) == TASKS);
+
+    /* parallel for: every row exactly once */
+    static unsigned char done[ROWS];
+    vlc_taskpool_for(pool, ROWS, rows, done);
+    for (unsigned i = 0; i < ROWS; i++)
+        assert(done[i] == 1);
+    vlc_taskpool_for(pool, 1, rows, done);
+    assert(done[0] == 2);
+    vlc_taskpool_for(pool, 0, rows, done);
+
+    /* interruption */
+    vlc_interrupt_t *ictx = vlc_interrupt_create();
+    vlc_sem_t sem;
+
+    assert(ictx != NULL);
+    vlc_sem_init(&sem, 0);
+    vlc_interrupt_set(ictx);
+    vlc_taskpool_submit(pool, &group, block, &sem);
+    vlc_interrupt_raise(ictx);
+    assert(vlc_taskpool_wait_i11e(pool, &group) == EINTR);
+    vlc_sem_post(&sem);
+    assert(vlc_taskpool_wait_i11e(pool, &group) == 0);
+    vlc_interrupt_set(NULL);
+    vlc_interrupt_destroy(ictx);
+    vlc_sem_destroy(&sem);
+
+    vlc_taskgroup_destroy(&group);
+    vlc_taskpool_release(pool);
+    return 0;
+}
@@ -46,6 +46,11 @@ static void callback (void *ptr)
     vlc_mutex_unlock (&data->lock);
 }
 
+static void blocking_callback (void *ptr)
+{
+    vlc_sem_wait (ptr);
+}
+
 
 int main (void)
 {
@@ -89,8 +94,30 @@ int main (void)
     data.count += vlc_timer_getoverrun (data.timer);
     printf ("Count = %u\n", data.count);
     assert (data.count >= 10);
+    data.count = 0;
+    vlc_mutex_unlock (&data.lock);
+    vlc_timer_schedule (data.timer, false, 0, 0);
+
+    /* Blocking callback of another timer */
+    vlc_timer_t blocker;
+    vlc_sem_t sem;
+
+    vlc_sem_init (&sem, 0);
+    val = vlc_timer_create (&blocker, blocking_callback, &sem);
+    assert (val == 0);
+    vlc_timer_schedule (blocker, false, 1, 0);
+
+    vlc_timer_schedule (data.timer, false, 1, CLOCK_FREQ / 100);
+    msleep (CLOCK_FREQ / 10);
+    vlc_mutex_lock (&data.lock);
+    data.count += vlc_timer_getoverrun (data.timer);
+    printf ("Count = %u\n", data.count);
+    assert (data.count >= 10);
     vlc_mutex_unlock (&data.lock);
 
+    vlc_sem_post (&sem);
+    vlc_timer_destroy (blocker);
+    vlc_sem_destroy (&sem);
     vlc_timer_destroy (data.timer);
     vlc_mutex_destroy (&data.lock);
 
@@ -93,6 +93,7 @@ static vout_display_t *vout_display_New(vlc_object_t *obj,
     vd->info.has_hide_mouse = false;
     vd->info.has_pictures_invalid = false;
     vd->info.has_event_thread = false;
+    vd->info.has_deinterlace = false;
     vd->info.subpicture_chromas = NULL;
 
     vd->cfg = cfg;
@@ -1191,6 +1192,14 @@ void vout_SetDisplayCrop(vout_display_t *vd,
     }
 }
 
+bool vout_SetDisplayDeinterlace(vout_display_t *vd, const char *mode)
+{
+    if (!vd->info.has_deinterlace)
+        return false;
+    return vout_display_Control(vd, VOUT_DISPLAY_CHANGE_DEINTERLACE,
+                                mode) == VLC_SUCCESS;
+}
+
 static vout_display_t *DisplayNew(vout_thread_t *vout,
                                   const video_format_t *source,
                                   const vout_display_state_t *state,
@@ -1464,16 +1473,19 @@ static int SplitterPictureNew(video_splitter_t *splitter, picture_t *picture[])
     vout_display_sys_t *wsys = splitter->p_owner->wrapper->sys;
 
     for (int i = 0; i < wsys->count; i++) {
+        /* The converters of a filtered display copy the picture anyway, so
+         * let the splitter hand over the source (or a view of it) as is */
         if (vout_IsDisplayFiltered(wsys->display[i])) {
-            /* TODO use a pool ? */
-            picture[i] = picture_NewFromFormat(&wsys->display[i]->source);
-        } else {
-            picture_pool_t *pool = vout_display_Pool(wsys->display[i], 1);
-            picture[i] = pool ? picture_pool_Get(pool) : NULL;
+            picture[i] = NULL;
+            continue;
         }
+
+        picture_pool_t *pool = vout_display_Pool(wsys->display[i], 1);
+        picture[i] = pool ? picture_pool_Get(pool) : NULL;
         if (!picture[i]) {
             for (int j = 0; j < i; j++)
-                picture_Release(picture[j]);
+                if (picture[j])
+                    picture_Release(picture[j]);
             return VLC_EGENERIC;
         }
     }
@@ -1484,7 +1496,8 @@ static void SplitterPictureDel(video_splitter_t *splitter, picture_t *picture[])
     vout_display_sys_t *wsys = splitter->p_owner->wrapper->sys;
 
     for (int i = 0; i < wsys->count; i++)
-        picture_Release(picture[i]);
+        if (picture[i])
+            picture_Release(picture[i]);
 }
 static void SplitterClose(vout_display_t *vd)
 {
@@ -1601,8 +1614,10 @@ void vout_SendDisplayEventMouse(vout_thread_t *vout, const vlc_mouse_t *m)
     if (vout->p->filter.chain_static && vout->p->filter.chain_interactive) {
         if (!filter_chain_MouseFilter(vout->p->filter.chain_interactive, &tmp1, m))
             m = &tmp1;
+        vlc_mutex_lock( &vout->p->filter.static_lock );
         if (!filter_chain_MouseFilter(vout->p->filter.chain_static,      &tmp2, m))
             m = &tmp2;
+        vlc_mutex_unlock( &vout->p->filter.static_lock );
     }
     vlc_mutex_unlock( &vout->p->filter.lock );
 
@@ -57,6 +57,7 @@
  * Local prototypes
  *****************************************************************************/
 static void *Thread(void *);
+static void ThreadFilterWorkerSignal(vout_thread_t *);
 static void VoutDestructor(vlc_object_t *);
 
 /* Maximum delay between 2 displayed pictures.
@@ -118,6 +119,8 @@ static vout_thread_t *VoutCreate(vlc_object_t *object,
     if (VoutValidateFormat(&original, cfg->fmt))
         return NULL;
 
+    mtime_t start = mdate();
+
     /* Allocate descriptor */
     vout_thread_t *vout = vlc_custom_create(object,
                                             sizeof(*vout) + sizeof(*vout->p),
@@ -142,6 +145,9 @@ static vout_thread_t *VoutCreate(vlc_object_t *object,
 
     /* Initialize locks */
     vlc_mutex_init(&vout->p->filter.lock);
+    vlc_mutex_init(&vout->p->filter.static_lock);
+    vlc_mutex_init(&vout->p->worker.lock);
+    vlc_cond_init(&vout->p->worker.wait);
     vlc_mutex_init(&vout->p->spu_lock);
 
     /* Take care of some "interface/control" related initialisations */
@@ -213,6 +219,7 @@ static vout_thread_t *VoutCreate(vlc_object_t *object,
     if (vout->p->input)
         spu_Attach(vout->p->spu, vout->p->input, true);
 
+    vlc_TraceSpan(vout, "vout", start, "video output creation");
     return vout;
 }
 
@@ -291,6 +298,9 @@ static void VoutDestructor(vlc_object_t *object)
 
     /* Destroy the locks */
     vlc_mutex_destroy(&vout->p->spu_lock);
+    vlc_cond_destroy(&vout->p->worker.wait);
+    vlc_mutex_destroy(&vout->p->worker.lock);
+    vlc_mutex_destroy(&vout->p->filter.static_lock);
     vlc_mutex_destroy(&vout->p->filter.lock);
     vout_control_Clean(&vout->p->control);
 
@@ -315,9 +325,10 @@ void vout_ChangePause(vout_thread_t *vout, bool is_paused, mtime_t date)
     vout_control_WaitEmpty(&vout->p->control);
 }
 
-void vout_GetResetStatistic(vout_thread_t *vout, int *displayed, int *lost)
+void vout_GetResetStatistic(vout_thread_t *vout, int *displayed, int *lost,
+                            int *late)
 {
-    vout_statistic_GetReset( &vout->p->statistic, displayed, lost );
+    vout_statistic_GetReset( &vout->p->statistic, displayed, lost, late );
 }
 
 void vout_Flush(vout_thread_t *vout, mtime_t date)
@@ -338,7 +349,11 @@ bool vout_IsEmpty(vout_thread_t *vout)
     if (picture)
         picture_Release(picture);
 
-    return !picture;
+    vlc_mutex_lock(&vout->p->worker.lock);
+    const bool is_filtered = vout->p->worker.count > 0;
+    vlc_mutex_unlock(&vout->p->worker.lock);
+
+    return !picture && !is_filtered;
 }
 
 void vout_NextPicture(vout_thread_t *vout, mtime_t *duration)
@@ -415,6 +430,7 @@ void vout_PutPicture(vout_thread_t *vout, picture_t *picture)
     picture->p_next = NULL;
     picture_fifo_Push(vout->p->decoder_fifo, picture);
 
+    ThreadFilterWorkerSignal(vout);
     vout_control_Wake(&vout->p->control);
 }
 
@@ -629,7 +645,7 @@ static picture_t *VoutVideoFilterStaticNewPicture(filter_t *filter)
 {
     vout_thread_t *vout = filter->owner.sys;
 
-    vlc_assert_locked(&vout->p->filter.lock);
+    vlc_assert_locked(&vout->p->filter.static_lock);
     if (filter_chain_GetLength(vout->p->filter.chain_interactive) == 0)
         return VoutVideoFilterInteractiveNewPicture(filter);
 
@@ -638,6 +654,8 @@ static picture_t *VoutVideoFilterStaticNewPicture(filter_t *filter)
 
 static void ThreadFilterFlush(vout_thread_t *vout, bool is_locked)
 {
+    vout_DiscardPrepared(vout);
+
     if (vout->p->displayed.current)
         picture_Release( vout->p->displayed.current );
     vout->p->displayed.current = NULL;
@@ -646,12 +664,189 @@ static void ThreadFilterFlush(vout_thread_t *vout, bool is_locked)
         picture_Release( vout->p->displayed.next );
     vout->p->displayed.next = NULL;
 
-    if (!is_locked)
+    if (!is_locked) {
         vlc_mutex_lock(&vout->p->filter.lock);
+        vlc_mutex_lock(&vout->p->filter.static_lock);
+    }
     filter_chain_VideoFlush(vout->p->filter.chain_static);
     filter_chain_VideoFlush(vout->p->filter.chain_interactive);
-    if (!is_locked)
+    if (!is_locked) {
+        vlc_mutex_unlock(&vout->p->filter.static_lock);
         vlc_mutex_unlock(&vout->p->filter.lock);
+    }
+}
+
+/*****************************************************************************
+ * Static filter chain worker
+ *
+ * When enabled, the static filters (deinterlace, postproc) are run by a
+ * separate thread, which keeps a few filtered pictures ahead in a queue, so
+ * that their cost does not delay the display. The decoder fifo is only
+ * popped or flushed with filter.static_lock held, and the worker keeps it
+ * while filtering, so that the pictures are queued in order.
+ *
+ * A picture which needs a change of the filters, because its format is not
+ * the one of the chain, is left in the decoder fifo, and filtered by the
+ * vout thread as without the worker.
+ *****************************************************************************/
+static void ThreadFilterWorkerSignal(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    vlc_mutex_lock(&sys->worker.lock);
+    sys->worker.pending = true;
+    vlc_cond_signal(&sys->worker.wait);
+    vlc_mutex_unlock(&sys->worker.lock);
+}
+
+/* Filters the decoded pictures until the queue is full, or until the
+ * decoder fifo is empty or starts with a format change.
+ * It returns true if pictures were queued. */
+static bool ThreadFilterWorkerRun(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+    bool is_queued = false;
+
+    vlc_assert_locked(&sys->filter.static_lock);
+    for (;;) {
+        vlc_mutex_lock(&sys->worker.lock);
+        const bool is_full = sys->worker.count >= VOUT_FILTER_QUEUE / 2;
+        vlc_mutex_unlock(&sys->worker.lock);
+        if (is_full)
+            break;
+
+        picture_t *decoded = picture_fifo_Peek(sys->decoder_fifo);
+        if (!decoded)
+            break;
+        const bool is_changed = !VideoFormatIsCropArEqual(&decoded->format,
+                                                          &sys->filter.format);
+        picture_Release(decoded);
+        if (is_changed)
+            break;
+
+        decoded = picture_fifo_Pop(sys->decoder_fifo);
+        assert(decoded);
+        picture_t *source = picture_Hold(decoded);
+
+        mtime_t latency = vlc_LatencyStart(vout);
+        picture_t *filtered = filter_chain_VideoFilter(sys->filter.chain_static, decoded);
+        while (filtered) {
+            vlc_mutex_lock(&sys->worker.lock);
+            if (sys->worker.count < VOUT_FILTER_QUEUE) {
+                const unsigned index = (sys->worker.first + sys->worker.count) % VOUT_FILTER_QUEUE;
+                sys->worker.queue[index].decoded  = picture_Hold(source);
+                sys->worker.queue[index].filtered = filtered;
+                sys->worker.count++;
+                is_queued = true;
+            } else {
+                picture_Release(filtered);
+                vout_statistic_AddLost(&sys->statistic, 1);
+            }
+            vlc_mutex_unlock(&sys->worker.lock);
+
+            filtered = filter_chain_VideoFilter(sys->filter.chain_static, NULL);
+        }
+        vlc_LatencySince(vout, VLC_LATENCY_FILTER, latency);
+        picture_Release(source);
+    }
+    return is_queued;
+}
+
+static void *ThreadFilterWorker(void *object)
+{
+    vout_thread_t *vout = object;
+    vout_thread_sys_t *sys = vout->p;
+
+    vlc_mutex_lock(&sys->worker.lock);
+    for (;;) {
+        while (!sys->worker.dead && !sys->worker.pending)
+            vlc_cond_wait(&sys->worker.wait, &sys->worker.lock);
+        if (sys->worker.dead)
+            break;
+        sys->worker.pending = false;
+        vlc_mutex_unlock(&sys->worker.lock);
+
+        vlc_mutex_lock(&sys->filter.static_lock);
+        const bool is_queued = ThreadFilterWorkerRun(vout);
+        vlc_mutex_unlock(&sys->filter.static_lock);
+
+        if (is_queued)
+            vout_control_Wake(&sys->control);
+
+        vlc_mutex_lock(&sys->worker.lock);
+    }
+    vlc_mutex_unlock(&sys->worker.lock);
+    return NULL;
+}
+
+/* Takes the first filtered picture of the queue, and makes its source the
+ * last decoded picture. */
+static picture_t *ThreadFilterWorkerPop(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+    picture_t *filtered = NULL;
+
+    vlc_mutex_lock(&sys->worker.lock);
+    if (sys->worker.count > 0) {
+        const unsigned index = sys->worker.first;
+        picture_t *decoded = sys->worker.queue[index].decoded;
+
+        filtered = sys->worker.queue[index].filtered;
+        sys->worker.first = (index + 1) % VOUT_FILTER_QUEUE;
+        sys->worker.count--;
+        /* There is room to filter again */
+        sys->worker.pending = true;
+        vlc_cond_signal(&sys->worker.wait);
+
+        if (sys->displayed.decoded)
+            picture_Release(sys->displayed.decoded);
+        sys->displayed.decoded       = decoded;
+        sys->displayed.timestamp     = decoded->date;
+        sys->displayed.is_interlaced = !decoded->b_progressive;
+    }
+    vlc_mutex_unlock(&sys->worker.lock);
+    return filtered;
+}
+
+/* Removes the queued pictures as picture_fifo_Flush() does */
+static void ThreadFilterWorkerFlush(vout_thread_t *vout, bool below, mtime_t date)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    vlc_mutex_lock(&sys->worker.lock);
+    unsigned count = 0;
+    for (unsigned i = 0; i < sys->worker.count; i++) {
+        const unsigned index = (sys->worker.first + i) % VOUT_FILTER_QUEUE;
+        picture_t *decoded = sys->worker.queue[index].decoded;
+
+        if (( below && decoded->date <= date) ||
+            (!below && decoded->date >= date)) {
+            picture_Release(decoded);
+            picture_Release(sys->worker.queue[index].filtered);
+        } else {
+            const unsigned kept = (sys->worker.first + count++) % VOUT_FILTER_QUEUE;
+            sys->worker.queue[kept] = sys->worker.queue[index];
+        }
+    }
+    sys->worker.count = count;
+    sys->worker.pending = true;
+    vlc_cond_signal(&sys->worker.wait);
+    vlc_mutex_unlock(&sys->worker.lock);
+}
+
+static void ThreadFilterWorkerOffsetDate(vout_thread_t *vout, mtime_t duration)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    vlc_mutex_lock(&sys->worker.lock);
+    for (unsigned i = 0; i < sys->worker.count; i++) {
+        const unsigned index = (sys->worker.first + i) % VOUT_FILTER_QUEUE;
+
+        sys->worker.queue[index].decoded->date += duration;
+        if (sys->worker.queue[index].filtered != sys->worker.queue[index].decoded)
+            sys->worker.queue[index].filtered->date += duration;
+    }
+    vlc_mutex_unlock(&sys->worker.lock);
 }
 
 typedef struct {
@@ -659,6 +854,30 @@ typedef struct {
     config_chain_t *cfg;
 } vout_filter_t;
 
+/* Lets the display deinterlace the pictures instead of the filter */
+static bool ThreadDisplayDeinterlace(vout_thread_t *vout,
+                                     const config_chain_t *cfg)
+{
+    vout_display_t *vd = vout->p->display.vd;
+    if (vd == NULL || !vd->info.has_deinterlace)
+        return false;
+
+    char *mode = NULL;
+    for (; cfg != NULL; cfg = cfg->p_next)
+        if (!strcmp(cfg->psz_name, "mode") && cfg->psz_value != NULL)
+            mode = strdup(cfg->psz_value);
+    if (mode == NULL)
+        mode = var_InheritString(vout, "sout-deinterlace-mode");
+    if (mode == NULL)
+        return false;
+
+    bool ok = vout_SetDisplayDeinterlace(vd, mode);
+    if (ok)
+        msg_Dbg(vout, "deinterlacing with the display, mode %s", mode);
+    free(mode);
+    return ok;
+}
+
 static void ThreadChangeFilters(vout_thread_t *vout,
                                 const video_format_t *source,
                                 const char *filters,
@@ -671,13 +890,19 @@ static void ThreadChangeFilters(vout_thread_t *vout,
 
     vlc_array_init(&array_static);
     vlc_array_init(&array_interactive);
+    bool display_deinterlace = false;
     char *current = filters ? strdup(filters) : NULL;
     while (current) {
         config_chain_t *cfg;
         char *name;
         char *next = config_ChainCreate(&name, &cfg, current);
 
-        if (name && *name) {
+        if (name && !strcmp(name, "deinterlace") && !display_deinterlace &&
+            ThreadDisplayDeinterlace(vout, cfg)) {
+            display_deinterlace = true;
+            config_ChainDestroy(cfg);
+            free(name);
+        } else if (name && *name) {
             vout_filter_t *e = xmalloc(sizeof(*e));
             e->name = name;
             e->cfg  = cfg;
@@ -695,9 +920,15 @@ static void ThreadChangeFilters(vout_thread_t *vout,
         free(current);
         current = next;
     }
+    if (!display_deinterlace && vout->p->display.vd != NULL)
+        vout_SetDisplayDeinterlace(vout->p->display.vd, NULL);
 
-    if (!is_locked)
+    if (!is_locked) {
         vlc_mutex_lock(&vout->p->filter.lock);
+        vlc_mutex_lock(&vout->p->filter.static_lock);
+    }
+    /* The queued pictures were filtered with the former filters */
+    ThreadFilterWorkerFlush(vout, true, INT64_MAX);
 
     es_format_t fmt_target;
     es_format_InitFromVideo(&fmt_target, source ? source : &vout->p->filter.format);
@@ -746,19 +977,71 @@ static void ThreadChangeFilters(vout_thread_t *vout,
         video_format_Copy(&vout->p->filter.format, source);
     }
 
-    if (!is_locked)
+    if (!is_locked) {
+        vlc_mutex_unlock(&vout->p->filter.static_lock);
         vlc_mutex_unlock(&vout->p->filter.lock);
+    }
 }
 
 
+/* Checks if a decoded picture is late, and if it should be dropped */
+static bool ThreadIsPictureTooLate(vout_thread_t *vout, const picture_t *decoded,
+                                   bool is_late_checked, bool is_late_dropped)
+{
+    if (!is_late_checked || decoded->b_force)
+        return false;
+
+    const mtime_t predicted = mdate() + 0; /* TODO improve */
+    const mtime_t late = predicted - decoded->date;
+    if (late > 0)
+        vout_statistic_AddLate(&vout->p->statistic, 1);
+    if (is_late_dropped && late > VOUT_DISPLAY_LATE_THRESHOLD) {
+        msg_Warn(vout, "picture is too late to be displayed (missing %"PRId64" ms)", late/1000);
+        vlc_TracePoint(vout, VLC_TP_VOUT_LATE, VLC_TS_INVALID, late);
+        vout_statistic_AddLost(&vout->p->statistic, 1);
+        return true;
+    } else if (is_late_dropped && late > 0) {
+        msg_Dbg(vout, "picture might be displayed late (missing %"PRId64" ms)", late/1000);
+    }
+    return false;
+}
+
 /* */
 static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool frame_by_frame)
 {
-    bool is_late_dropped = vout->p->is_late_dropped && !vout->p->pause.is_on && !frame_by_frame;
+    const bool is_late_checked = !vout->p->pause.is_on && !frame_by_frame;
+    const bool is_late_dropped = vout->p->is_late_dropped && is_late_checked;
 
     vlc_mutex_lock(&vout->p->filter.lock);
 
-    picture_t *picture = filter_chain_VideoFilter(vout->p->filter.chain_static, NULL);
+    picture_t *picture = NULL;
+    if (vout->p->worker.is_on && !(reuse && vout->p->displayed.decoded)) {
+        /* Use the pictures filtered ahead by the worker, without waiting
+         * for it while it is filtering */
+        while ((picture = ThreadFilterWorkerPop(vout)) != NULL
+            && ThreadIsPictureTooLate(vout, picture,
+                                      is_late_checked, is_late_dropped))
+            picture_Release(picture);
+        if (picture || vlc_mutex_trylock(&vout->p->filter.static_lock))
+            goto out;
+
+        /* The worker is idle: only a format change is left to this thread */
+        while ((picture = ThreadFilterWorkerPop(vout)) != NULL
+            && ThreadIsPictureTooLate(vout, picture,
+                                      is_late_checked, is_late_dropped))
+            picture_Release(picture);
+        picture_t *decoded = picture ? NULL : picture_fifo_Peek(vout->p->decoder_fifo);
+        if (decoded)
+            picture_Release(decoded);
+        if (!decoded || VideoFormatIsCropArEqual(&decoded->format, &vout->p->filter.format)) {
+            vlc_mutex_unlock(&vout->p->filter.static_lock);
+            ThreadFilterWorkerSignal(vout);
+            goto out;
+        }
+    } else {
+        vlc_mutex_lock(&vout->p->filter.static_lock);
+        picture = filter_chain_VideoFilter(vout->p->filter.chain_static, NULL);
+    }
     assert(!reuse || !picture);
 
     while (!picture) {
@@ -768,17 +1051,10 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
         } else {
             decoded = picture_fifo_Pop(vout->p->decoder_fifo);
             if (decoded) {
-                if (is_late_dropped && !decoded->b_force) {
-                    const mtime_t predicted = mdate() + 0; /* TODO improve */
-                    const mtime_t late = predicted - decoded->date;
-                    if (late > VOUT_DISPLAY_LATE_THRESHOLD) {
-                        msg_Warn(vout, "picture is too late to be displayed (missing %"PRId64" ms)", late/1000);
-                        picture_Release(decoded);
-                        vout_statistic_AddLost(&vout->p->statistic, 1);
-                        continue;
-                    } else if (late > 0) {
-                        msg_Dbg(vout, "picture might be displayed late (missing %"PRId64" ms)", late/1000);
-                    }
+                if (ThreadIsPictureTooLate(vout, decoded,
+                                           is_late_checked, is_late_dropped)) {
+                    picture_Release(decoded);
+                    continue;
                 }
                 if (!VideoFormatIsCropArEqual(&decoded->format, &vout->p->filter.format))
                     ThreadChangeFilters(vout, &decoded->format, vout->p->filter.configuration, true);
@@ -796,9 +1072,15 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
         vout->p->displayed.timestamp     = decoded->date;
         vout->p->displayed.is_interlaced = !decoded->b_progressive;
 
+        mtime_t latency = vlc_LatencyStart(vout);
         picture = filter_chain_VideoFilter(vout->p->filter.chain_static, decoded);
+        vlc_LatencySince(vout, VLC_LATENCY_FILTER, latency);
     }
 
+    vlc_mutex_unlock(&vout->p->filter.static_lock);
+    if (vout->p->worker.is_on)
+        ThreadFilterWorkerSignal(vout);
+out:
     vlc_mutex_unlock(&vout->p->filter.lock);
 
     if (!picture)
@@ -812,23 +1094,43 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
     return VLC_SUCCESS;
 }
 
-static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
+void vout_DiscardPrepared(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    if (sys->display.prepared.source == NULL)
+        return;
+
+    picture_Release(sys->display.prepared.source);
+    picture_Release(sys->display.prepared.picture);
+    if (sys->display.prepared.subpic != NULL)
+        subpicture_Delete(sys->display.prepared.subpic);
+    sys->display.prepared.source = NULL;
+}
+
+/* Filters a picture, renders its subpictures and prepares the display with
+ * it. The result is kept in display.prepared until it is displayed. */
+static int ThreadDisplayRenderPicture(vout_thread_t *vout, picture_t *source)
 {
     vout_thread_sys_t *sys = vout->p;
     vout_display_t *vd = vout->p->display.vd;
 
-    picture_t *torender = picture_Hold(vout->p->displayed.current);
+    assert(sys->display.prepared.source == NULL);
+    picture_t *torender = picture_Hold(source);
 
     vout_chrono_Start(&vout->p->render);
 
+    mtime_t latency = vlc_LatencyStart(vout);
     vlc_mutex_lock(&vout->p->filter.lock);
     picture_t *filtered = filter_chain_VideoFilter(vout->p->filter.chain_interactive, torender);
     vlc_mutex_unlock(&vout->p->filter.lock);
+    vlc_LatencySince(vout, VLC_LATENCY_FILTER, latency);
+    latency = vlc_LatencyStart(vout);
 
     if (!filtered)
         return VLC_EGENERIC;
 
-    if (filtered->date != vout->p->displayed.current->date)
+    if (filtered->date != source->date)
         msg_Warn(vout, "Unsupported timestamp modifications done by chain_interactive");
 
     /*
@@ -961,6 +1263,7 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
         vout_snapshot_Set(&vout->p->snapshot, &vd->source, todisplay);
 
     /* Render the direct buffer */
+    const mtime_t date = todisplay->date;
     vout_UpdateDisplaySourceProperties(vd, &todisplay->format);
     if (sys->display.use_dr) {
         vout_display_Prepare(vd, todisplay, subpic);
@@ -985,6 +1288,7 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     }
 
     vout_chrono_Stop(&vout->p->render);
+    vlc_LatencySince(vout, VLC_LATENCY_RENDER, latency);
 #if 0
         {
         static int i = 0;
@@ -994,26 +1298,46 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
         }
 #endif
 
+    sys->display.prepared.source  = picture_Hold(source);
+    sys->display.prepared.picture = sys->display.filtered ? sys->display.filtered
+                                                          : todisplay;
+    sys->display.prepared.subpic  = subpic;
+    sys->display.prepared.date    = date;
+    sys->display.filtered = NULL;
+    return VLC_SUCCESS;
+}
+
+/* Displays the prepared picture, at its date unless forced */
+static void ThreadDisplayPreparedPicture(vout_thread_t *vout, bool is_forced)
+{
+    vout_thread_sys_t *sys = vout->p;
+    const mtime_t date = sys->display.prepared.date;
+
+    assert(sys->display.prepared.source != NULL);
+
     /* Wait the real date (for rendering jitter) */
-#if 0
-    mtime_t delay = direct->date - mdate();
-    if (delay < 1000)
-        msg_Warn(vout, "picture is late (%lld ms)", delay / 1000);
-#endif
     if (!is_forced)
-        mwait(todisplay->date);
+        mwait(date);
 
     /* Display the direct buffer returned by vout_RenderPicture */
+    if (vout->p->displayed.date <= VLC_TS_INVALID)
+        vlc_TraceEvent(vout, "vout", "first picture displayed");
     vout->p->displayed.date = mdate();
-    vout_display_Display(vd,
-                         sys->display.filtered ? sys->display.filtered
-                                                : todisplay,
-                         subpic);
-    sys->display.filtered = NULL;
 
-    vout_statistic_AddDisplayed(&vout->p->statistic, 1);
+    mtime_t trace = vlc_TracePointStart(vout, VLC_TP_VOUT_DISPLAY);
+    if (!is_forced)
+        vlc_Latency(vout, VLC_LATENCY_LATENESS,
+                    vout->p->displayed.date - date);
+    mtime_t latency = vlc_LatencyStart(vout);
+    vout_display_Display(sys->display.vd, sys->display.prepared.picture,
+                         sys->display.prepared.subpic);
+    vlc_LatencySince(vout, VLC_LATENCY_DISPLAY, latency);
+    vlc_TracePoint(vout, VLC_TP_VOUT_DISPLAY, trace, date);
 
-    return VLC_SUCCESS;
+    picture_Release(sys->display.prepared.source);
+    sys->display.prepared.source = NULL;
+
+    vout_statistic_AddDisplayed(&vout->p->statistic, 1);
 }
 
 static int ThreadDisplayPicture(vout_thread_t *vout, mtime_t *deadline)
@@ -1030,13 +1354,23 @@ static int ThreadDisplayPicture(vout_thread_t *vout, mtime_t *deadline)
         while (!vout->p->displayed.next && !ThreadDisplayPreparePicture(vout, false, frame_by_frame))
             ;
 
+    /* In pipelined mode, the next picture is prepared while the current one
+     * is being presented, and only the display remains at its date. */
+    picture_t *next = vout->p->displayed.next;
+    if (vout->p->is_pipelined && !first && !paused && next
+     && vout->p->display.prepared.source == NULL)
+        ThreadDisplayRenderPicture(vout, next);
+
     const mtime_t date = mdate();
     const mtime_t render_delay = vout_chrono_GetHigh(&vout->p->render) + VOUT_MWAIT_TOLERANCE;
 
     bool drop_next_frame = frame_by_frame;
     mtime_t date_next = VLC_TS_INVALID;
-    if (!paused && vout->p->displayed.next) {
-        date_next = vout->p->displayed.next->date - render_delay;
+    if (!paused && next) {
+        if (vout->p->display.prepared.source == next)
+            date_next = next->date - VOUT_MWAIT_TOLERANCE;
+        else
+            date_next = next->date - render_delay;
         if (date_next /* + 0 FIXME */ <= date)
             drop_next_frame = true;
     }
@@ -1079,9 +1413,16 @@ static int ThreadDisplayPicture(vout_thread_t *vout, mtime_t *deadline)
         return VLC_EGENERIC;
 
     /* display the picture immediately */
-    bool is_forced = frame_by_frame || force_refresh || vout->p->displayed.current->b_force;
-    int ret = ThreadDisplayRenderPicture(vout, is_forced);
-    return force_refresh ? VLC_EGENERIC : ret;
+    picture_t *current = vout->p->displayed.current;
+    bool is_forced = frame_by_frame || force_refresh || current->b_force;
+
+    if (vout->p->display.prepared.source != current) {
+        vout_DiscardPrepared(vout);
+        if (ThreadDisplayRenderPicture(vout, current))
+            return VLC_EGENERIC;
+    }
+    ThreadDisplayPreparedPicture(vout, is_forced);
+    return force_refresh ? VLC_EGENERIC : VLC_SUCCESS;
 }
 
 static void ThreadDisplaySubpicture(vout_thread_t *vout,
@@ -1132,6 +1473,7 @@ static void ThreadChangePause(vout_thread_t *vout, bool is_paused, mtime_t date)
         if (vout->p->step.last > VLC_TS_INVALID)
             vout->p->step.last += duration;
         picture_fifo_OffsetDate(vout->p->decoder_fifo, duration);
+        ThreadFilterWorkerOffsetDate(vout, duration);
         if (vout->p->displayed.decoded)
             vout->p->displayed.decoded->date += duration;
         spu_OffsetSubtitleDate(vout->p->spu, duration);
@@ -1164,7 +1506,10 @@ static void ThreadFlush(vout_thread_t *vout, bool below, mtime_t date)
         }
     }
 
+    vlc_mutex_lock(&vout->p->filter.static_lock);
     picture_fifo_Flush(vout->p->decoder_fifo, date, below);
+    ThreadFilterWorkerFlush(vout, below, date);
+    vlc_mutex_unlock(&vout->p->filter.static_lock);
 }
 
 static void ThreadReset(vout_thread_t *vout)
@@ -1297,6 +1642,9 @@ static int ThreadStart(vout_thread_t *vout, const vout_display_state_t *state)
     vout->p->filter.configuration = NULL;
     video_format_Copy(&vout->p->filter.format, &vout->p->original);
 
+    vout->p->worker.first = 0;
+    vout->p->worker.count = 0;
+
     filter_owner_t owner = {
         .sys = vout,
         .video = {
@@ -1348,6 +1696,16 @@ static int ThreadStart(vout_thread_t *vout, const vout_display_state_t *state)
     vout->p->spu_blend               = NULL;
 
     video_format_Print(VLC_OBJECT(vout), "original format", &vout->p->original);
+
+    if (vout->p->worker.is_on) {
+        vout->p->worker.dead    = false;
+        vout->p->worker.pending = true;
+        if (vlc_clone(&vout->p->worker.thread, ThreadFilterWorker, vout,
+                      VLC_THREAD_PRIORITY_VIDEO)) {
+            msg_Err(vout, "cannot create the filter thread");
+            vout->p->worker.is_on = false;
+        }
+    }
     return VLC_SUCCESS;
 error:
     if (vout->p->filter.chain_interactive != NULL)
@@ -1362,6 +1720,14 @@ error:
 
 static void ThreadStop(vout_thread_t *vout, vout_display_state_t *state)
 {
+    if (vout->p->worker.is_on) {
+        vlc_mutex_lock(&vout->p->worker.lock);
+        vout->p->worker.dead = true;
+        vlc_cond_signal(&vout->p->worker.wait);
+        vlc_mutex_unlock(&vout->p->worker.lock);
+        vlc_join(vout->p->worker.thread, NULL);
+    }
+
     if (vout->p->spu_blend)
         filter_DeleteBlend(vout->p->spu_blend);
 
@@ -1383,12 +1749,16 @@ static void ThreadStop(vout_thread_t *vout, vout_display_state_t *state)
     if (vout->p->decoder_fifo)
         picture_fifo_Delete(vout->p->decoder_fifo);
     assert(!vout->p->decoder_pool);
+    assert(vout->p->worker.count == 0);
 }
 
 static void ThreadInit(vout_thread_t *vout)
 {
     vout->p->dead            = false;
-    vout->p->is_late_dropped = var_InheritBool(vout, "drop-late-frames");
+    vout->p->is_late_dropped = var_InheritBool(vout, "drop-late-frames")
+                            || var_InheritBool(vout, "low-latency");
+    vout->p->is_pipelined    = var_InheritBool(vout, "video-pipelining");
+    vout->p->worker.is_on    = var_InheritBool(vout, "video-filter-thread");
     vout->p->pause.is_on     = false;
     vout->p->pause.date      = VLC_TS_INVALID;
 
@@ -38,8 +38,12 @@ void spu_OffsetSubtitleDate( spu_t *p_spu, mtime_t i_duration );
 
 /**
  * This function will return and reset internal statistics.
+ *
+ * The late pictures are the ones which reached the display after their
+ * date, whether they were dropped (they are then also lost) or not.
  */
-void vout_GetResetStatistic( vout_thread_t *p_vout, int *pi_displayed, int *pi_lost );
+void vout_GetResetStatistic( vout_thread_t *p_vout, int *pi_displayed,
+                             int *pi_lost, int *pi_late );
 
 /**
  * This function will ensure that all ready/displayed pciture have at most
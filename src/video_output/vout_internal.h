@@ -43,6 +43,14 @@
  */
 #define VOUT_MAX_PICTURES (20)
 
+/**
+ * Number of pictures the filter worker can keep ahead of the display.
+ *
+ * The worker only filters a new picture while less than half of them are
+ * used, the rest is for the filters outputting several pictures.
+ */
+#define VOUT_FILTER_QUEUE (4)
+
 /* */
 struct vout_thread_sys_t
 {
@@ -82,6 +90,14 @@ struct vout_thread_sys_t
         vout_display_t *vd;
         bool           use_dr;
         picture_t      *filtered;
+
+        /* Rendered and prepared picture, not displayed yet */
+        struct {
+            picture_t    *source;  /* picture it was rendered from */
+            picture_t    *picture; /* picture to display */
+            subpicture_t *subpic;
+            mtime_t      date;
+        } prepared;
     } display;
 
     struct {
@@ -112,16 +128,34 @@ struct vout_thread_sys_t
 
     /* */
     bool            is_late_dropped;
+    bool            is_pipelined;
 
     /* Video filter2 chain */
     struct {
         vlc_mutex_t     lock;
+        vlc_mutex_t     static_lock; /* chain_static, taken after lock */
         char            *configuration;
         video_format_t  format;
         struct filter_chain_t *chain_static;
         struct filter_chain_t *chain_interactive;
     } filter;
 
+    /* Static filter chain worker thread */
+    struct {
+        bool            is_on;
+        vlc_thread_t    thread;
+        vlc_mutex_t     lock;
+        vlc_cond_t      wait;
+        bool            dead;
+        bool            pending;   /* there may be something to filter */
+        unsigned        first;
+        unsigned        count;
+        struct {
+            picture_t   *decoded;  /* picture it was filtered from */
+            picture_t   *filtered;
+        } queue[VOUT_FILTER_QUEUE];
+    } worker;
+
     /* */
     vlc_mouse_t     mouse;
 
@@ -157,6 +191,7 @@ void vout_CloseWrapper(vout_thread_t *, vout_display_state_t *);
 int  vout_InitWrapper(vout_thread_t *);
 void vout_EndWrapper(vout_thread_t *);
 void vout_ManageWrapper(vout_thread_t *);
+void vout_DiscardPrepared(vout_thread_t *);
 
 /* */
 int spu_ProcessMouse(spu_t *, const vlc_mouse_t *, const video_format_t *);
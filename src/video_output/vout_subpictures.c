@@ -61,6 +61,26 @@ typedef struct {
     spu_heap_entry_t entry[VOUT_MAX_SUBPICTURES];
 } spu_heap_t;
 
+/* Number of rendered text regions kept for reuse */
+#define SPU_CACHE_SIZE 8
+
+typedef struct {
+    uint64_t       key;      /**< hash of the text and its rendering setup */
+    unsigned       last_use; /**< for the least recently used eviction */
+    video_format_t fmt;      /**< format of the rendered text */
+    picture_t      *picture; /**< rendered text, NULL if the entry is free */
+    subpicture_region_private_t *scaled; /**< last scaled copy or NULL */
+} spu_cache_entry_t;
+
+/* What an output region looked like, for the dirty area tracking */
+typedef struct {
+    picture_t *picture;
+    int x, y;
+    int width, height;
+    int x_offset, y_offset;
+    int alpha;
+} spu_rendered_t;
+
 struct spu_private_t {
     vlc_mutex_t  lock;            /* lock to protect all followings fields */
     vlc_object_t *input;
@@ -93,6 +113,16 @@ struct spu_private_t {
 
     /* */
     mtime_t last_sort_date;
+
+    /* Rendered text regions, by content */
+    spu_cache_entry_t cache[SPU_CACHE_SIZE];
+    unsigned          cache_clock;
+
+    /* Regions of the last rendered output */
+    spu_rendered_t *rendered;
+    unsigned       rendered_count;
+    int            rendered_width;
+    int            rendered_height;
 };
 
 /*****************************************************************************
@@ -647,6 +677,169 @@ static void SpuSelectSubpictures(spu_t *spu,
 
 
 
+/*****************************************************************************
+ * Rendered text cache
+ *****************************************************************************
+ * Text regions are laid out, rendered and scaled once per content: regions
+ * recreated with the same text (subtitle updaters, OSD, repeated captions)
+ * reuse the pictures of the previous rendering.
+ *****************************************************************************/
+static uint64_t SpuHash(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *p = data;
+
+    /* FNV-1a */
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ p[i]) * UINT64_C(0x100000001b3);
+    return hash;
+}
+
+static uint64_t SpuHashString(uint64_t hash, const char *str)
+{
+    return str ? SpuHash(hash, str, strlen(str) + 1) : SpuHash(hash, "", 0);
+}
+
+#define SpuHashValue(hash, v) SpuHash(hash, &(v), sizeof (v))
+
+static uint64_t SpuHashStyle(uint64_t hash, const text_style_t *style)
+{
+    if (!style)
+        return SpuHashValue(hash, style);
+
+    hash = SpuHashString(hash, style->psz_fontname);
+    hash = SpuHashString(hash, style->psz_monofontname);
+    hash = SpuHashValue(hash, style->i_features);
+    hash = SpuHashValue(hash, style->i_style_flags);
+    hash = SpuHashValue(hash, style->f_font_relsize);
+    hash = SpuHashValue(hash, style->i_font_size);
+    hash = SpuHashValue(hash, style->i_font_color);
+    hash = SpuHashValue(hash, style->i_font_alpha);
+    hash = SpuHashValue(hash, style->i_spacing);
+    hash = SpuHashValue(hash, style->i_outline_color);
+    hash = SpuHashValue(hash, style->i_outline_alpha);
+    hash = SpuHashValue(hash, style->i_outline_width);
+    hash = SpuHashValue(hash, style->i_shadow_color);
+    hash = SpuHashValue(hash, style->i_shadow_alpha);
+    hash = SpuHashValue(hash, style->i_shadow_width);
+    hash = SpuHashValue(hash, style->i_background_color);
+    hash = SpuHashValue(hash, style->i_background_alpha);
+    hash = SpuHashValue(hash, style->i_karaoke_background_color);
+    hash = SpuHashValue(hash, style->i_karaoke_background_alpha);
+    return hash;
+}
+
+/* Everything the text renderer output depends upon */
+static uint64_t SpuCacheKey(spu_t *spu, const subpicture_region_t *region,
+                            const vlc_fourcc_t *chroma_list)
+{
+    const video_format_t *fmt = &region->fmt;
+    const video_format_t *out = &spu->p->text->fmt_out.video;
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+
+    for (const text_segment_t *s = region->p_text; s; s = s->p_next) {
+        hash = SpuHashString(hash, s->psz_text);
+        hash = SpuHashStyle(hash, s->style);
+    }
+    hash = SpuHashValue(hash, fmt->i_width);
+    hash = SpuHashValue(hash, fmt->i_height);
+    hash = SpuHashValue(hash, fmt->i_visible_width);
+    hash = SpuHashValue(hash, fmt->i_visible_height);
+    hash = SpuHashValue(hash, fmt->i_sar_num);
+    hash = SpuHashValue(hash, fmt->i_sar_den);
+    hash = SpuHashValue(hash, region->i_align);
+    hash = SpuHashValue(hash, region->b_noregionbg);
+    hash = SpuHashValue(hash, region->b_gridmode);
+    hash = SpuHashValue(hash, out->i_width);
+    hash = SpuHashValue(hash, out->i_height);
+    for (size_t i = 0; chroma_list[i]; i++)
+        hash = SpuHashValue(hash, chroma_list[i]);
+    return hash;
+}
+
+static void SpuCacheRelease(spu_cache_entry_t *entry)
+{
+    if (!entry->picture)
+        return;
+    picture_Release(entry->picture);
+    entry->picture = NULL;
+    video_format_Clean(&entry->fmt);
+    if (entry->scaled) {
+        subpicture_region_private_Delete(entry->scaled);
+        entry->scaled = NULL;
+    }
+}
+
+static void SpuCacheClean(spu_private_t *sys)
+{
+    for (int i = 0; i < SPU_CACHE_SIZE; i++)
+        SpuCacheRelease(&sys->cache[i]);
+}
+
+static spu_cache_entry_t *SpuCacheFind(spu_private_t *sys, uint64_t key)
+{
+    for (int i = 0; i < SPU_CACHE_SIZE; i++) {
+        spu_cache_entry_t *entry = &sys->cache[i];
+
+        if (entry->picture && entry->key == key) {
+            entry->last_use = ++sys->cache_clock;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* Stores a freshly rendered text region, evicting the oldest entry */
+static spu_cache_entry_t *SpuCacheAdd(spu_private_t *sys, uint64_t key,
+                                      const subpicture_region_t *region)
+{
+    spu_cache_entry_t *entry = &sys->cache[0];
+
+    for (int i = 1; i < SPU_CACHE_SIZE && entry->picture; i++)
+        if (!sys->cache[i].picture ||
+            sys->cache[i].last_use < entry->last_use)
+            entry = &sys->cache[i];
+
+    SpuCacheRelease(entry);
+    if (!region->p_picture ||
+        video_format_Copy(&entry->fmt, &region->fmt) != VLC_SUCCESS)
+        return NULL;
+
+    entry->key      = key;
+    entry->last_use = ++sys->cache_clock;
+    entry->picture  = picture_Hold(region->p_picture);
+    return entry;
+}
+
+static subpicture_region_private_t *
+SpuRegionPrivateDuplicate(const subpicture_region_private_t *private)
+{
+    video_format_t fmt = private->fmt;
+    subpicture_region_private_t *dup = subpicture_region_private_New(&fmt);
+
+    if (dup)
+        dup->p_picture = picture_Hold(private->p_picture);
+    return dup;
+}
+
+/* Turns a text region into what the text renderer gave for the same text */
+static void SpuCacheApply(const spu_cache_entry_t *entry,
+                          subpicture_region_t *region)
+{
+    video_format_t fmt;
+
+    if (video_format_Copy(&fmt, &entry->fmt) != VLC_SUCCESS)
+        return;
+
+    if (region->p_picture)
+        picture_Release(region->p_picture);
+    region->p_picture = picture_Hold(entry->picture);
+    free(region->fmt.p_palette);
+    region->fmt = fmt;
+
+    if (entry->scaled && !region->p_private)
+        region->p_private = SpuRegionPrivateDuplicate(entry->scaled);
+}
+
 /**
  * It will transform the provided region into another region suitable for rendering.
  */
@@ -673,17 +866,32 @@ static void SpuRenderRegion(spu_t *spu,
     *dst_area = spu_area_create(0,0, 0,0, scale_size);
     *dst_ptr  = NULL;
 
-    /* Render text region */
-    if (region->fmt.i_chroma == VLC_CODEC_TEXT) {
-        SpuRenderText(spu, &restore_text, region,
-                      chroma_list,
-                      render_date - subpic->i_start);
-
-        /* Check if the rendering has failed ... */
-        if (region->fmt.i_chroma == VLC_CODEC_TEXT)
-            goto exit;
+    /* Render text region, unless the same text was rendered recently */
+    spu_cache_entry_t *cache = NULL;
+    if (region->fmt.i_chroma == VLC_CODEC_TEXT && sys->text &&
+        sys->text->p_module) {
+        const uint64_t key = SpuCacheKey(spu, region, chroma_list);
+
+        cache = SpuCacheFind(sys, key);
+        if (cache)
+            SpuCacheApply(cache, region);
+
+        if (region->fmt.i_chroma == VLC_CODEC_TEXT) {
+            SpuRenderText(spu, &restore_text, region,
+                          chroma_list,
+                          render_date - subpic->i_start);
+
+            /* Time-dependent text must be rendered every time */
+            cache = NULL;
+            if (!restore_text && region->fmt.i_chroma != VLC_CODEC_TEXT)
+                cache = SpuCacheAdd(sys, key, region);
+        }
     }
 
+    /* Check if the rendering has failed ... */
+    if (region->fmt.i_chroma == VLC_CODEC_TEXT)
+        goto exit;
+
     /* Force palette if requested
      * FIXME b_force_palette and force_crop are applied to all subpictures using palette
      * instead of only the right one (being the dvd spu).
@@ -868,6 +1076,15 @@ static void SpuRenderRegion(spu_t *spu,
         if (region->p_private) {
             region_fmt     = region->p_private->fmt;
             region_picture = region->p_private->p_picture;
+
+            /* Keep the scaled text for its next occurrence */
+            if (cache && !changed_palette &&
+                (!cache->scaled ||
+                 cache->scaled->p_picture != region_picture)) {
+                if (cache->scaled)
+                    subpicture_region_private_Delete(cache->scaled);
+                cache->scaled = SpuRegionPrivateDuplicate(region->p_private);
+            }
         }
     }
 
@@ -1083,6 +1300,115 @@ static subpicture_t *SpuRenderSubpictures(spu_t *spu,
     return output;
 }
 
+/*****************************************************************************
+ * Dirty area tracking
+ *****************************************************************************/
+typedef struct {
+    int x0, y0, x1, y1;
+} spu_box_t;
+
+static bool SpuRenderedEqual(const spu_rendered_t *a, const spu_rendered_t *b)
+{
+    return a->picture  == b->picture  &&
+           a->x        == b->x        && a->y        == b->y        &&
+           a->width    == b->width    && a->height   == b->height   &&
+           a->x_offset == b->x_offset && a->y_offset == b->y_offset &&
+           a->alpha    == b->alpha;
+}
+
+static void SpuBoxAdd(spu_box_t *box, const spu_rendered_t *r)
+{
+    box->x0 = __MIN(box->x0, r->x);
+    box->y0 = __MIN(box->y0, r->y);
+    box->x1 = __MAX(box->x1, r->x + r->width);
+    box->y1 = __MAX(box->y1, r->y + r->height);
+}
+
+static void SpuRenderedClean(spu_private_t *sys)
+{
+    for (unsigned i = 0; i < sys->rendered_count; i++)
+        if (sys->rendered[i].picture)
+            picture_Release(sys->rendered[i].picture);
+    free(sys->rendered);
+    sys->rendered = NULL;
+    sys->rendered_count = 0;
+}
+
+/**
+ * Compares the regions of a new output with the previous one, sets the
+ * dirty area of the output and remembers its regions for the next time.
+ * Region pictures are immutable once rendered, and held here, so that an
+ * unchanged picture pointer means unchanged content.
+ */
+static void SpuUpdateDirtyArea(spu_private_t *sys, subpicture_t *output)
+{
+    unsigned count = 0;
+    if (output)
+        for (subpicture_region_t *r = output->p_region; r; r = r->p_next)
+            count++;
+
+    spu_rendered_t *rendered = NULL;
+    if (count > 0) {
+        rendered = malloc(count * sizeof(*rendered));
+        if (unlikely(rendered == NULL)) {
+            /* Everything is left dirty */
+            SpuRenderedClean(sys);
+            return;
+        }
+    }
+
+    /* The positions are relative to the output size */
+    if (output && (output->i_original_picture_width  != sys->rendered_width ||
+                   output->i_original_picture_height != sys->rendered_height)) {
+        SpuRenderedClean(sys);
+        sys->rendered_width  = output->i_original_picture_width;
+        sys->rendered_height = output->i_original_picture_height;
+    }
+
+    spu_box_t box = { INT_MAX, INT_MAX, INT_MIN, INT_MIN };
+    unsigned i = 0;
+    for (subpicture_region_t *r = output ? output->p_region : NULL;
+         r; r = r->p_next, i++) {
+        spu_rendered_t *cur = &rendered[i];
+
+        cur->picture  = r->p_picture ? picture_Hold(r->p_picture) : NULL;
+        cur->x        = r->i_x;
+        cur->y        = r->i_y;
+        cur->width    = r->fmt.i_visible_width;
+        cur->height   = r->fmt.i_visible_height;
+        cur->x_offset = r->fmt.i_x_offset;
+        cur->y_offset = r->fmt.i_y_offset;
+        cur->alpha    = r->i_alpha;
+
+        if (i >= sys->rendered_count) {
+            SpuBoxAdd(&box, cur);
+        } else if (!SpuRenderedEqual(cur, &sys->rendered[i])) {
+            SpuBoxAdd(&box, cur);
+            SpuBoxAdd(&box, &sys->rendered[i]);
+        }
+    }
+    for (; i < sys->rendered_count; i++)
+        SpuBoxAdd(&box, &sys->rendered[i]);
+
+    SpuRenderedClean(sys);
+    sys->rendered       = rendered;
+    sys->rendered_count = count;
+
+    if (!output)
+        return;
+    if (box.x0 < box.x1 && box.y0 < box.y1) {
+        output->i_dirty_x      = box.x0;
+        output->i_dirty_y      = box.y0;
+        output->i_dirty_width  = box.x1 - box.x0;
+        output->i_dirty_height = box.y1 - box.y0;
+    } else {
+        output->i_dirty_x      =
+        output->i_dirty_y      =
+        output->i_dirty_width  =
+        output->i_dirty_height = 0;
+    }
+}
+
 /*****************************************************************************
  * Object variables callbacks
  *****************************************************************************/
@@ -1231,6 +1557,13 @@ spu_t *spu_Create(vlc_object_t *object)
     /* */
     sys->last_sort_date = -1;
 
+    memset(sys->cache, 0, sizeof(sys->cache));
+    sys->cache_clock = 0;
+    sys->rendered = NULL;
+    sys->rendered_count = 0;
+    sys->rendered_width = 0;
+    sys->rendered_height = 0;
+
     return spu;
 }
 
@@ -1263,6 +1596,9 @@ void spu_Destroy(spu_t *spu)
     /* Destroy all remaining subpictures */
     SpuHeapClean(&sys->heap);
 
+    SpuCacheClean(sys);
+    SpuRenderedClean(sys);
+
     vlc_mutex_destroy(&sys->lock);
 
     vlc_object_release(spu);
@@ -1457,6 +1793,7 @@ subpicture_t *spu_Render(spu_t *spu,
     SpuSelectSubpictures(spu, &subpicture_count, subpicture_array,
                          render_subtitle_date, render_osd_date, ignore_osd);
     if (subpicture_count <= 0) {
+        SpuUpdateDirtyArea(sys, NULL);
         vlc_mutex_unlock(&sys->lock);
         return NULL;
     }
@@ -1481,6 +1818,7 @@ subpicture_t *spu_Render(spu_t *spu,
                                                 fmt_src,
                                                 render_subtitle_date,
                                                 render_osd_date);
+    SpuUpdateDirtyArea(sys, render);
     vlc_mutex_unlock(&sys->lock);
 
     return render;
@@ -124,7 +124,8 @@ int vout_InitWrapper(vout_thread_t *vout)
 
     sys->display.use_dr = !vout_IsDisplayFiltered(vd);
     const bool allow_dr = !vd->info.has_pictures_invalid && !vd->info.is_slow && sys->display.use_dr;
-    const unsigned private_picture  = 4; /* XXX 3 for filter, 1 for SPU */
+    const unsigned private_picture  = 4 /* XXX 3 for filter, 1 for SPU */
+                                    + (sys->worker.is_on ? VOUT_FILTER_QUEUE : 0);
     const unsigned decoder_picture  = 1 + sys->dpb_size;
     const unsigned kept_picture     = 1; /* last displayed picture */
     const unsigned reserved_picture = DISPLAY_PICTURE_COUNT +
@@ -161,6 +162,7 @@ int vout_InitWrapper(vout_thread_t *vout)
     }
     sys->private_pool = picture_pool_Reserve(sys->decoder_pool, private_picture);
     sys->display.filtered = NULL;
+    sys->display.prepared.source = NULL;
     return VLC_SUCCESS;
 }
 
@@ -172,6 +174,7 @@ void vout_EndWrapper(vout_thread_t *vout)
     vout_thread_sys_t *sys = vout->p;
 
     assert(!sys->display.filtered);
+    assert(!sys->display.prepared.source);
     if (sys->private_pool)
         picture_pool_Release(sys->private_pool);
 
@@ -191,6 +194,8 @@ void vout_ManageWrapper(vout_thread_t *vout)
     reset_display_pool |= vout_ManageDisplay(vd, !sys->display.use_dr || reset_display_pool);
 
     if (reset_display_pool) {
+        /* The prepared picture belongs to the former display pictures */
+        vout_DiscardPrepared(vout);
         sys->display.use_dr = !vout_IsDisplayFiltered(vd);
         NoDrInit(vout);
     }
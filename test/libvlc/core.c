@@ -97,6 +97,87 @@ static void test_audio_output (void)
     libvlc_release (vlc);
 }
 
+static void test_latency (const char ** argv, int argc)
+{
+    const char *args[argc + 1];
+    uint64_t counts[LIBVLC_LATENCY_BUCKETS];
+
+    log ("Testing latency histograms\n");
+
+    libvlc_instance_t *vlc = libvlc_new (argc, argv);
+    assert (vlc != NULL);
+    assert (libvlc_latency_histogram (vlc, libvlc_latency_demux, counts,
+                                      LIBVLC_LATENCY_BUCKETS) == -1);
+    libvlc_release (vlc);
+
+    memcpy (args, argv, argc * sizeof (*args));
+    args[argc] = "--latency-stats";
+    vlc = libvlc_new (argc + 1, args);
+    assert (vlc != NULL);
+
+    for (int stage = libvlc_latency_demux;
+         stage <= libvlc_latency_lateness; stage++)
+    {
+        memset (counts, 0xff, sizeof (counts));
+        assert (libvlc_latency_histogram (vlc, stage, counts,
+                                          LIBVLC_LATENCY_BUCKETS)
+                == LIBVLC_LATENCY_BUCKETS);
+        for (unsigned i = 0; i < LIBVLC_LATENCY_BUCKETS; i++)
+            assert (counts[i] == 0);
+    }
+    assert (libvlc_latency_histogram (vlc, libvlc_latency_decode, counts,
+                                      2) == 2);
+    libvlc_latency_reset (vlc);
+    libvlc_release (vlc);
+}
+
+static void test_memory_usage (const char ** argv, int argc)
+{
+    log ("Testing memory usage\n");
+
+    libvlc_instance_t *vlc = libvlc_new (argc, argv);
+    assert (vlc != NULL);
+
+    libvlc_memory_usage_t *list = libvlc_memory_usage_get (vlc);
+    for (libvlc_memory_usage_t *u = list; u != NULL; u = u->p_next)
+    {
+        assert (u->psz_component != NULL);
+        assert (u->i_users > 0);
+        assert (u->i_peak >= u->i_usage);
+    }
+    libvlc_memory_usage_list_release (list);
+    libvlc_release (vlc);
+}
+
+static void test_cputime (const char ** argv, int argc)
+{
+    const char *args[argc + 1];
+
+    log ("Testing module CPU times\n");
+
+    libvlc_instance_t *vlc = libvlc_new (argc, argv);
+    assert (vlc != NULL);
+    assert (libvlc_module_cputime_get (vlc) == NULL);
+    libvlc_release (vlc);
+
+    memcpy (args, argv, argc * sizeof (*args));
+    args[argc] = "--cpu-stats";
+    vlc = libvlc_new (argc + 1, args);
+    assert (vlc != NULL);
+
+    libvlc_module_cputime_t *list = libvlc_module_cputime_get (vlc);
+    for (libvlc_module_cputime_t *t = list; t != NULL; t = t->p_next)
+    {
+        assert (t->psz_name != NULL && t->psz_capability != NULL);
+        assert (t->i_total >= t->i_self);
+        if (t->p_next != NULL)
+            assert (t->i_self >= t->p_next->i_self);
+    }
+    libvlc_module_cputime_list_release (list);
+    libvlc_module_cputime_reset (vlc);
+    libvlc_release (vlc);
+}
+
 int main (void)
 {
     test_init();
@@ -104,6 +185,9 @@ int main (void)
     test_core (test_defaults_args, test_defaults_nargs);
     test_audiovideofilterlists (test_defaults_args, test_defaults_nargs);
     test_audio_output ();
+    test_latency (test_defaults_args, test_defaults_nargs);
+    test_memory_usage (test_defaults_args, test_defaults_nargs);
+    test_cputime (test_defaults_args, test_defaults_nargs);
 
     return 0;
 }
@@ -23,6 +23,8 @@
 
 #include "test.h"
 
+#include <string.h>
+
 static void preparsed_changed(const libvlc_event_t *event, void *user_data)
 {
     (void)event;
@@ -73,11 +75,164 @@ static void test_media_preparsed(const char** argv, int argc)
     libvlc_release (vlc);
 }
 
+static unsigned read_be16 (const unsigned char *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static void check_jpeg (const unsigned char *data, size_t size,
+                        unsigned width, unsigned height)
+{
+    assert (size > 4);
+    assert (data[0] == 0xFF && data[1] == 0xD8);
+
+    /* Look for the baseline start of frame marker */
+    for (size_t i = 2; i + 9 <= size; i += 2 + read_be16 (data + i + 2))
+    {
+        assert (data[i] == 0xFF);
+        if (data[i + 1] == 0xC0)
+        {
+            assert (read_be16 (data + i + 5) == height);
+            assert (read_be16 (data + i + 7) == width);
+            return;
+        }
+    }
+    assert (!"no start of frame");
+}
+
+/* Writes three 64x48 frames at 25 fps */
+static void write_y4m (char *path)
+{
+    int fd = mkstemp (path);
+    assert (fd != -1);
+
+    FILE *stream = fdopen (fd, "wb");
+    assert (stream != NULL);
+    fputs ("YUV4MPEG2 W64 H48 F25:1 Ip A1:1 C420jpeg\n", stream);
+    for (unsigned i = 0; i < 3; i++)
+    {
+        fputs ("FRAME\n", stream);
+        for (unsigned j = 0; j < 64 * 48 * 3 / 2; j++)
+            fputc ((j < 64 * 48) ? 16 + 64 * i : 128, stream);
+    }
+    assert (!ferror (stream));
+    fclose (stream);
+}
+
+static void test_media_thumbnail(const char** argv, int argc)
+{
+    char path[] = "/tmp/libvlc_thumbnail_XXXXXX";
+    write_y4m (path);
+
+    log ("Testing thumbnail\n");
+
+    libvlc_instance_t *vlc = libvlc_new (argc, argv);
+    assert (vlc != NULL);
+
+    libvlc_media_t *media = libvlc_media_new_path (vlc, path);
+    assert (media != NULL);
+    /* The item options apply: rawvid wants the frame rate, and J420 is
+     * encoded to JPEG without any chroma converter */
+    libvlc_media_add_option (media, ":rawvid-fps=25");
+    libvlc_media_add_option (media, ":rawvid-chroma=J420");
+
+    size_t size;
+    unsigned char *data;
+
+    data = libvlc_media_thumbnail (media, 0, 0, 0, "jpeg", &size);
+    assert (data != NULL);
+    check_jpeg (data, size, 64, 48);
+    libvlc_free (data);
+
+    /* Keep the aspect ratio, and seek */
+    data = libvlc_media_thumbnail (media, 80, 32, 0, "jpeg", &size);
+    assert (data != NULL);
+    check_jpeg (data, size, 32, 24);
+    libvlc_free (data);
+
+    data = libvlc_media_thumbnail (media, 40, 0, 12, "jpeg", &size);
+    assert (data != NULL);
+    check_jpeg (data, size, 16, 12);
+    libvlc_free (data);
+
+    assert (libvlc_media_thumbnail (media, 0, 0, 0, "nonexistent",
+                                    &size) == NULL);
+    libvlc_media_release (media);
+
+    /* No video track */
+    media = libvlc_media_new_path (vlc, SRCDIR"/samples/empty.voc");
+    assert (media != NULL);
+    assert (libvlc_media_thumbnail (media, 0, 0, 0, "jpeg", &size) == NULL);
+    libvlc_media_release (media);
+
+    libvlc_release (vlc);
+    unlink (path);
+}
+
+static void test_media_thumbnails(const char** argv, int argc)
+{
+    char path[] = "/tmp/libvlc_thumbnails_XXXXXX";
+    write_y4m (path);
+
+    log ("Testing thumbnails strip\n");
+
+    libvlc_instance_t *vlc = libvlc_new (argc, argv);
+    assert (vlc != NULL);
+
+    libvlc_media_t *media = libvlc_media_new_path (vlc, path);
+    assert (media != NULL);
+    libvlc_media_add_option (media, ":rawvid-fps=25");
+    libvlc_media_add_option (media, ":rawvid-chroma=J420");
+
+    assert (libvlc_media_thumbnails_new (media, 0, 32, 0, "jpeg") == NULL);
+
+    libvlc_media_thumbnails_t *strip =
+        libvlc_media_thumbnails_new (media, 40, 32, 0, "jpeg");
+    assert (strip != NULL);
+
+    /* The media can go, the strip holds it */
+    libvlc_media_release (media);
+
+    unsigned count;
+    while ((count = libvlc_media_thumbnails_count (strip)) == 0)
+        usleep (10000);
+    assert (count >= 1);
+
+    size_t size;
+    unsigned char *data;
+
+    /* The last one may be past the last frame, depending on the estimated
+     * length */
+    for (unsigned i = 0; i < count && i < 2; i++)
+    {
+        while ((data = libvlc_media_thumbnails_get (strip, i, &size)) == NULL)
+            usleep (10000);
+        check_jpeg (data, size, 32, 24);
+        libvlc_free (data);
+    }
+    assert (libvlc_media_thumbnails_get (strip, count, &size) == NULL);
+
+    libvlc_media_thumbnails_release (strip);
+
+    /* Released while generating */
+    media = libvlc_media_new_path (vlc, path);
+    assert (media != NULL);
+    strip = libvlc_media_thumbnails_new (media, 1, 0, 0, "jpeg");
+    assert (strip != NULL);
+    libvlc_media_thumbnails_release (strip);
+    libvlc_media_release (media);
+
+    libvlc_release (vlc);
+    unlink (path);
+}
+
 int main (void)
 {
     test_init();
 
     test_media_preparsed (test_defaults_args, test_defaults_nargs);
+    test_media_thumbnail (test_defaults_args, test_defaults_nargs);
+    test_media_thumbnails (test_defaults_args, test_defaults_nargs);
 
     return 0;
 }
@@ -172,6 +172,54 @@ static void test_media_list_player_items_queue(const char** argv, int argc)
     libvlc_release (vlc);
 }
 
+static void test_media_list_player_preload(const char** argv, int argc)
+{
+    libvlc_instance_t *vlc;
+    libvlc_media_list_t *ml;
+    libvlc_media_list_player_t *mlp;
+
+    const char * file = test_default_sample;
+
+    log ("Testing media list player gapless preloading\n");
+
+    vlc = libvlc_new (argc, argv);
+    assert (vlc != NULL);
+
+    ml = libvlc_media_list_new (vlc);
+    assert (ml != NULL);
+
+    mlp = libvlc_media_list_player_new (vlc);
+    assert(mlp);
+
+    /* Longer than the sample: the next item is opened as soon as the length
+     * of the current one is known */
+    libvlc_media_list_player_set_preload_time (mlp, 3600 * 1000);
+
+    static struct check_items_order_data check;
+    check_data_init(&check);
+    queue_expected_item(&check, media_list_add_file_path (vlc, ml, file));
+    queue_expected_item(&check, media_list_add_file_path (vlc, ml, file));
+    queue_expected_item(&check, media_list_add_file_path (vlc, ml, file));
+
+    libvlc_media_list_player_set_media_list (mlp, ml);
+
+    libvlc_event_manager_t * em = libvlc_media_list_player_event_manager(mlp);
+    int val = libvlc_event_attach(em, libvlc_MediaListPlayerNextItemSet,
+                                  check_items_order_callback, &check);
+    assert(val == 0);
+
+    libvlc_media_list_player_play(mlp);
+
+    // Wait until all item are read
+    wait_queued_items(&check);
+
+    stop_and_wait (mlp);
+
+    libvlc_media_list_release (ml);
+    libvlc_media_list_player_release (mlp);
+    libvlc_release (vlc);
+}
+
 static void test_media_list_player_previous(const char** argv, int argc)
 {
     libvlc_instance_t *vlc;
@@ -518,14 +566,15 @@ int main (void)
 {
     test_init();
 
-    // There are 6 tests. And they take some times.
-    alarm(6 * 5);
+    // There are 7 tests. And they take some times.
+    alarm(7 * 5);
 
     test_media_list_player_pause_stop (test_defaults_args, test_defaults_nargs);
     test_media_list_player_play_item_at_index (test_defaults_args, test_defaults_nargs);
     test_media_list_player_previous (test_defaults_args, test_defaults_nargs);
     test_media_list_player_next (test_defaults_args, test_defaults_nargs);
     test_media_list_player_items_queue (test_defaults_args, test_defaults_nargs);
+    test_media_list_player_preload (test_defaults_args, test_defaults_nargs);
     test_media_list_player_playback_options (test_defaults_args, test_defaults_nargs);
     return 0;
 }
@@ -176,6 +176,43 @@ static void test_media_player_pause_stop(const char** argv, int argc)
     libvlc_release (vlc);
 }
 
+static void test_media_player_reset(const char** argv, int argc)
+{
+    libvlc_instance_t *vlc;
+    libvlc_media_t *md;
+    libvlc_media_player_t *mi;
+    const char * file = test_default_sample;
+
+    log ("Testing reset and reuse with %s\n", file);
+
+    vlc = libvlc_new (argc, argv);
+    assert (vlc != NULL);
+
+    mi = libvlc_media_player_new (vlc);
+    assert (mi != NULL);
+
+    for (int i = 0; i < 3; i++)
+    {
+        md = libvlc_media_new_path (vlc, file);
+        assert (md != NULL);
+        libvlc_media_player_set_media (mi, md);
+        libvlc_media_release (md);
+
+        libvlc_media_player_set_rate (mi, 2.f);
+        libvlc_video_set_aspect_ratio (mi, "16:9");
+
+        libvlc_media_player_play (mi);
+        wait_playing (mi);
+
+        libvlc_media_player_reset (mi);
+        assert (libvlc_media_player_get_media (mi) == NULL);
+        assert (libvlc_media_player_get_rate (mi) == 1.f);
+        assert (libvlc_video_get_aspect_ratio (mi) == NULL);
+    }
+
+    libvlc_media_player_release (mi);
+    libvlc_release (vlc);
+}
 
 int main (void)
 {
@@ -184,6 +221,7 @@ int main (void)
     test_media_player_set_media (test_defaults_args, test_defaults_nargs);
     test_media_player_play_stop (test_defaults_args, test_defaults_nargs);
     test_media_player_pause_stop (test_defaults_args, test_defaults_nargs);
+    test_media_player_reset (test_defaults_args, test_defaults_nargs);
 
     return 0;
 }
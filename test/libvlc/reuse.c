@@ -0,0 +1,101 @@
+/*
+ * reuse.c - libvlc instance reuse benchmark
+ */
+
+/**********************************************************************
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+/* Plays a short sample a number of times, first with a new LibVLC instance
+ * and media player for every run, then with a single media player that is
+ * reset between runs, and reports the average time per run for both.
+ * The sample is given as first argument, and defaults to the test sample.
+ */
+
+#include "test.h"
+
+#include <time.h>
+
+#define RUNS 20
+
+static double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void play (libvlc_media_player_t *mp, libvlc_instance_t *vlc,
+                  const char *path)
+{
+    libvlc_media_t *md = libvlc_media_new_path (vlc, path);
+    assert (md != NULL);
+
+    libvlc_media_player_set_media (mp, md);
+    libvlc_media_release (md);
+    libvlc_media_player_play (mp);
+
+    libvlc_state_t state;
+    do
+        state = libvlc_media_player_get_state (mp);
+    while (state != libvlc_Playing && state != libvlc_Error
+        && state != libvlc_Ended);
+    assert (state != libvlc_Error);
+}
+
+int main (int argc, char *argv[])
+{
+    const char *path = (argc > 1) ? argv[1] : test_default_sample;
+    double start;
+
+    setenv ("VLC_PLUGIN_PATH", "../modules", 0);
+
+    start = now ();
+    for (unsigned i = 0; i < RUNS; i++)
+    {
+        libvlc_instance_t *vlc = libvlc_new (test_defaults_nargs,
+                                             test_defaults_args);
+        assert (vlc != NULL);
+
+        libvlc_media_player_t *mp = libvlc_media_player_new (vlc);
+        assert (mp != NULL);
+
+        play (mp, vlc, path);
+        libvlc_media_player_stop (mp);
+        libvlc_media_player_release (mp);
+        libvlc_release (vlc);
+    }
+    log ("new instance per run: %.2f ms\n", (now () - start) * 1000 / RUNS);
+
+    libvlc_instance_t *vlc = libvlc_new (test_defaults_nargs,
+                                         test_defaults_args);
+    assert (vlc != NULL);
+
+    libvlc_media_player_t *mp = libvlc_media_player_new (vlc);
+    assert (mp != NULL);
+
+    start = now ();
+    for (unsigned i = 0; i < RUNS; i++)
+    {
+        play (mp, vlc, path);
+        libvlc_media_player_reset (mp);
+    }
+    log ("reused media player: %.2f ms\n", (now () - start) * 1000 / RUNS);
+
+    libvlc_media_player_release (mp);
+    libvlc_release (vlc);
+    return 0;
+}
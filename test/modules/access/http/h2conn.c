@@ -0,0 +1,232 @@
+/*
+ * h2conn.c - HTTP/2 client connection test
+ */
+
+/**********************************************************************
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+/* Runs a client connection over a socket pair, in place of a TLS session,
+ * with the test playing the server: a response whose header block spans
+ * CONTINUATION frames, then an oversized frame that must fail the
+ * pending streams and the connection.
+ */
+
+#include "../../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <string.h>
+#include <sys/socket.h>
+
+#include <vlc_common.h>
+#include <vlc_tls.h>
+
+#include "../modules/access/http/hpack.c"
+/* Both files have parser helpers and callbacks with the same names */
+#define vlc_h2_stream_lookup vlc_h2_parse_stream_lookup
+#define vlc_h2_stream_error vlc_h2_parse_stream_error
+#include "../modules/access/http/h2frame.c"
+#undef vlc_h2_stream_error
+#undef vlc_h2_stream_lookup
+#include "../modules/access/http/h2conn.c"
+
+/* After h2conn.c, as it includes config.h again */
+#undef NDEBUG
+#include <assert.h>
+
+static int server; /* server side of the socket pair */
+
+static int fake_recv(void *opaque, void *buf, size_t len)
+{
+    vlc_tls_t *tls = opaque;
+
+    return recv(tls->fd, buf, len, 0);
+}
+
+static int fake_send(void *opaque, const void *buf, size_t len)
+{
+    vlc_tls_t *tls = opaque;
+
+    return send(tls->fd, buf, len, MSG_NOSIGNAL);
+}
+
+static void fake_close(vlc_tls_t *tls)
+{
+    (void) tls;
+}
+
+static vlc_tls_t *fake_session(vlc_tls_creds_t *creds)
+{
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+        return NULL;
+
+    vlc_tls_t *tls = vlc_object_create(creds, sizeof (*tls));
+    assert(tls != NULL);
+    tls->sys = NULL;
+    tls->fd = fds[0];
+    tls->sock.p_sys = tls;
+    tls->sock.pf_recv = fake_recv;
+    tls->sock.pf_send = fake_send;
+    server = fds[1];
+    return tls;
+}
+
+static void server_recv(void *buf, size_t len)
+{
+    assert(recv(server, buf, len, MSG_WAITALL) == (ssize_t)len);
+}
+
+/* Reads the next frame from the client, other than flow control updates,
+ * and returns its type */
+static uint8_t server_recv_frame(uint32_t *restrict id)
+{
+    uint8_t hdr[VLC_H2_FRAME_HEADER_SIZE];
+    uint8_t payload[VLC_H2_DEFAULT_MAX_FRAME];
+
+    do
+    {
+        server_recv(hdr, sizeof (hdr));
+
+        size_t len = (hdr[0] << 16) | (hdr[1] << 8) | hdr[2];
+        assert(len <= sizeof (payload));
+        if (len > 0)
+            server_recv(payload, len);
+    }
+    while (hdr[3] == VLC_H2_FRAME_WINDOW_UPDATE);
+
+    *id = GetDWBE(hdr + 5) & 0x7FFFFFFF;
+    return hdr[3];
+}
+
+static void server_send(struct vlc_h2_frame *f)
+{
+    while (f != NULL)
+    {
+        struct vlc_h2_frame *next = f->next;
+        size_t size = vlc_h2_frame_size(f);
+
+        assert(send(server, f->data, size, MSG_NOSIGNAL) == (ssize_t)size);
+        free(f);
+        f = next;
+    }
+}
+
+static void server_send_data(uint_fast32_t id, const char *str, bool eos)
+{
+    size_t len = strlen(str);
+    struct vlc_h2_frame *f = vlc_h2_frame_alloc(VLC_H2_FRAME_DATA,
+                                eos ? VLC_H2_DATA_END_STREAM : 0, id, len);
+    assert(f != NULL);
+    memcpy(vlc_h2_frame_payload(f), str, len);
+    server_send(f);
+}
+
+static void test_conn(vlc_object_t *obj)
+{
+    vlc_tls_creds_t *creds = vlc_object_create(obj, sizeof (*creds));
+    assert(creds != NULL);
+    creds->close = fake_close;
+
+    vlc_tls_t *tls = fake_session(creds);
+    assert(tls != NULL);
+
+    struct vlc_h2_conn *conn = vlc_h2_conn_create(obj, tls);
+    assert(conn != NULL);
+
+    /* Preface, then SETTINGS */
+    char preface[sizeof (VLC_H2_CLIENT_PREFACE) - 1];
+    uint32_t id;
+
+    server_recv(preface, sizeof (preface));
+    assert(!memcmp(preface, VLC_H2_CLIENT_PREFACE, sizeof (preface)));
+    assert(server_recv_frame(&id) == VLC_H2_FRAME_SETTINGS && id == 0);
+
+    server_send(vlc_h2_frame_settings());
+    assert(server_recv_frame(&id) == VLC_H2_FRAME_SETTINGS && id == 0);
+
+    /* First request, with a response split in CONTINUATION frames */
+    static const char *const req[][2] = {
+        { ":method", "GET" }, { ":scheme", "https" },
+        { ":authority", "www.example.com" }, { ":path", "/" },
+    };
+    struct vlc_h2_stream *s = vlc_h2_stream_open(conn, req, 4);
+    assert(s != NULL);
+    assert(server_recv_frame(&id) == VLC_H2_FRAME_HEADERS && id == 1);
+
+    static const char *const resp[][2] = {
+        { ":status", "200" }, { "content-length", "11" },
+        { "content-type", "text/plain" },
+    };
+    server_send(vlc_h2_frame_headers(1, 8, false, 3, resp));
+    server_send_data(1, "hello ", false);
+    server_send_data(1, "world", true);
+
+    assert(vlc_h2_stream_wait(s) == 200);
+    assert(!strcmp(vlc_h2_stream_get_header(s, "Content-Length"), "11"));
+    assert(vlc_h2_stream_get_header(s, "location") == NULL);
+
+    char buf[16];
+    size_t len = 0;
+    ssize_t val;
+
+    while ((val = vlc_h2_stream_read(s, buf + len, 4)) > 0)
+        len += val;
+    assert(val == 0);
+    assert(len == 11 && !memcmp(buf, "hello world", 11));
+    vlc_h2_stream_close(s);
+    assert(vlc_h2_conn_usable(conn));
+
+    /* Second request, then a frame larger than the client accepts */
+    s = vlc_h2_stream_open(conn, req, 4);
+    assert(s != NULL);
+    assert(server_recv_frame(&id) == VLC_H2_FRAME_HEADERS && id == 3);
+
+    uint8_t hdr[VLC_H2_FRAME_HEADER_SIZE] = {
+        (VLC_H2_DEFAULT_MAX_FRAME + 1) >> 16,
+        (VLC_H2_DEFAULT_MAX_FRAME + 1) >> 8,
+        (VLC_H2_DEFAULT_MAX_FRAME + 1) & 0xff,
+        VLC_H2_FRAME_DATA, 0, 0, 0, 0, 3,
+    };
+    assert(send(server, hdr, sizeof (hdr), MSG_NOSIGNAL)
+           == (ssize_t)sizeof (hdr));
+
+    assert(vlc_h2_stream_wait(s) == -1);
+    assert(vlc_h2_stream_read(s, buf, sizeof (buf)) == -1);
+    assert(!vlc_h2_conn_usable(conn));
+    vlc_h2_stream_close(s);
+
+    /* No new stream on a failed connection */
+    assert(vlc_h2_stream_open(conn, req, 4) == NULL);
+
+    vlc_h2_conn_release(conn);
+    close(server);
+    vlc_object_release(creds);
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    test_conn(VLC_OBJECT(vlc->p_libvlc_int));
+
+    libvlc_release(vlc);
+    return 0;
+}
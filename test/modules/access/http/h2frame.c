@@ -0,0 +1,446 @@
+/*
+ * h2frame.c - HTTP/2 frame formatting and parsing test
+ */
+
+/**********************************************************************
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+/* Formats frames and parses them back, including header blocks split in
+ * HEADERS and CONTINUATION frames, and checks that frames of invalid size,
+ * on the wrong stream or out of sequence are connection errors.
+ */
+
+#include "../../../libvlc/test.h"
+
+#include <string.h>
+
+#include <vlc_common.h>
+
+#include "../modules/access/http/hpack.c"
+#include "../modules/access/http/h2frame.c"
+
+/* After h2frame.c, as it includes config.h again */
+#undef NDEBUG
+#include <assert.h>
+
+#define STREAM_ID 1 /* the only open stream */
+
+static struct
+{
+    int error; /* connection error code, or -1 */
+    int stream_error; /* stream error code, or -1 */
+    unsigned settings;
+    unsigned settings_done;
+    unsigned pings;
+    unsigned resets;
+    unsigned headers;
+    char status[4];
+    size_t data;
+    unsigned eos;
+} st;
+
+static int dummy_stream;
+
+static void reset_state(void)
+{
+    memset(&st, 0, sizeof (st));
+    st.error = st.stream_error = -1;
+}
+
+static void cb_setting(void *ctx, uint_fast16_t id, uint_fast32_t value)
+{
+    (void) ctx; (void) id; (void) value;
+    st.settings++;
+}
+
+static int cb_settings_done(void *ctx)
+{
+    (void) ctx;
+    st.settings_done++;
+    return 0;
+}
+
+static int cb_ping(void *ctx, uint_fast64_t opaque)
+{
+    (void) ctx; (void) opaque;
+    st.pings++;
+    return 0;
+}
+
+static void cb_error(void *ctx, uint_fast32_t code)
+{
+    (void) ctx;
+    assert(st.error == -1);
+    st.error = code;
+}
+
+static int cb_reset(void *ctx, uint_fast32_t last_id, uint_fast32_t code)
+{
+    (void) ctx; (void) last_id; (void) code;
+    st.resets++;
+    return 0;
+}
+
+static void cb_window_status(void *ctx, uint32_t *rcwd)
+{
+    (void) ctx; (void) rcwd;
+}
+
+static void *cb_stream_lookup(void *ctx, uint_fast32_t id)
+{
+    (void) ctx;
+    return (id == STREAM_ID) ? &dummy_stream : NULL;
+}
+
+static int cb_stream_error(void *ctx, uint_fast32_t id, uint_fast32_t code)
+{
+    (void) ctx; (void) id;
+    st.stream_error = code;
+    return 0;
+}
+
+static void cb_stream_headers(void *s, unsigned count, char *headers[][2])
+{
+    assert(s == &dummy_stream);
+    st.headers += count;
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (!strcmp(headers[i][0], ":status"))
+            snprintf(st.status, sizeof (st.status), "%s", headers[i][1]);
+        free(headers[i][1]);
+        free(headers[i][0]);
+    }
+}
+
+static int cb_stream_data(void *s, struct vlc_h2_frame *f)
+{
+    size_t len;
+
+    assert(s == &dummy_stream);
+    assert(vlc_h2_frame_data_get(f, &len) != NULL);
+    st.data += len;
+    free(f);
+    return 0;
+}
+
+static void cb_stream_end(void *s)
+{
+    assert(s == &dummy_stream);
+    st.eos++;
+}
+
+static int cb_stream_reset(void *s, uint_fast32_t code)
+{
+    assert(s == &dummy_stream);
+    (void) code;
+    st.resets++;
+    return 0;
+}
+
+static const struct vlc_h2_parser_cbs cbs =
+{
+    cb_setting,
+    cb_settings_done,
+    cb_ping,
+    cb_error,
+    cb_reset,
+    cb_window_status,
+    cb_stream_lookup,
+    cb_stream_error,
+    cb_stream_headers,
+    cb_stream_data,
+    cb_stream_end,
+    cb_stream_reset,
+};
+
+static struct vlc_h2_frame *frame(uint_fast8_t type, uint_fast8_t flags,
+                                  uint_fast32_t id, size_t len)
+{
+    struct vlc_h2_frame *f = vlc_h2_frame_alloc(type, flags, id, len);
+    assert(f != NULL);
+    memset(vlc_h2_frame_payload(f), 0, len);
+    return f;
+}
+
+/* Parses a chain of frames with a fresh parser, returns the result */
+static int parse(struct vlc_h2_frame *f)
+{
+    struct vlc_h2_parser *p = vlc_h2_parse_init(NULL, &cbs);
+    assert(p != NULL);
+
+    reset_state();
+    int ret = vlc_h2_parse(p, f);
+    vlc_h2_parse_destroy(p);
+    return ret;
+}
+
+static void check_error(struct vlc_h2_frame *f, int code)
+{
+    assert(parse(f) == -1);
+    assert(st.error == code);
+}
+
+static void check_ok(struct vlc_h2_frame *f)
+{
+    assert(parse(f) == 0);
+    assert(st.error == -1);
+}
+
+static struct vlc_h2_frame *response(uint_fast32_t mtu, bool eos)
+{
+    static const char *const headers[][2] = {
+        { ":status", "200" },
+        { "content-type", "application/octet-stream" },
+        { "content-length", "100" },
+        { "server", "vlc-test" },
+    };
+    struct vlc_h2_frame *f = vlc_h2_frame_headers(STREAM_ID, mtu, eos,
+                                                  4, headers);
+    assert(f != NULL);
+    return f;
+}
+
+static void test_headers(void)
+{
+    /* Single HEADERS frame */
+    struct vlc_h2_frame *f = response(VLC_H2_DEFAULT_MAX_FRAME, true);
+    assert(f->next == NULL);
+    assert(vlc_h2_frame_type(f) == VLC_H2_FRAME_HEADERS);
+    check_ok(f);
+    assert(st.headers == 4 && !strcmp(st.status, "200") && st.eos == 1);
+
+    /* HEADERS then CONTINUATION frames */
+    f = response(8, false);
+    unsigned count = 0;
+    for (struct vlc_h2_frame *n = f; n != NULL; n = n->next)
+    {
+        assert(vlc_h2_frame_type(n) == (count ? VLC_H2_FRAME_CONTINUATION
+                                              : VLC_H2_FRAME_HEADERS));
+        assert(vlc_h2_frame_length(n) <= 8);
+        assert(vlc_h2_frame_id(n) == STREAM_ID);
+        /* END_HEADERS on the last frame only */
+        assert(!(vlc_h2_frame_flags(n) & VLC_H2_HEADERS_END_HEADERS)
+               == (n->next != NULL));
+        count++;
+    }
+    assert(count > 2);
+    check_ok(f);
+    assert(st.headers == 4 && !strcmp(st.status, "200") && st.eos == 0);
+
+    /* Header block on a closed stream: decoded, then dropped */
+    static const char *const hdr[][2] = { { ":status", "404" } };
+    check_ok(vlc_h2_frame_headers(3, 16384, true, 1, hdr));
+    assert(st.headers == 0 && st.eos == 0);
+
+    /* Interleaved frame within a header block */
+    f = response(8, false);
+    struct vlc_h2_frame *ping = frame(VLC_H2_FRAME_PING, 0, 0, 8);
+    ping->next = f->next;
+    f->next = ping;
+    check_error(f, VLC_H2_PROTOCOL_ERROR);
+    assert(st.pings == 0 && st.headers == 0);
+
+    /* CONTINUATION of another stream */
+    f = response(8, false);
+    SetDWBE(f->next->data + 5, 3);
+    check_error(f, VLC_H2_PROTOCOL_ERROR);
+
+    /* CONTINUATION without HEADERS */
+    f = response(8, false);
+    struct vlc_h2_frame *next = f->next;
+    free(f);
+    check_error(next, VLC_H2_PROTOCOL_ERROR);
+
+    /* Unterminated header block, then end of the parsing: nothing leaks */
+    f = response(8, false);
+    while (f->next->next != NULL)
+    {
+        next = f->next->next;
+        free(f->next);
+        f->next = next;
+    }
+    free(f->next);
+    f->next = NULL;
+    check_ok(f);
+    assert(st.headers == 0);
+
+    /* HEADERS on stream 0 */
+    f = vlc_h2_frame_headers(0, 16384, true, 1, hdr);
+    check_error(f, VLC_H2_PROTOCOL_ERROR);
+
+    /* Padding longer than the payload */
+    f = frame(VLC_H2_FRAME_HEADERS, VLC_H2_HEADERS_PADDED
+              | VLC_H2_HEADERS_END_HEADERS, STREAM_ID, 4);
+    vlc_h2_frame_payload(f)[0] = 4;
+    check_error(f, VLC_H2_FRAME_SIZE_ERROR);
+
+    /* Priority shorter than 5 bytes */
+    f = frame(VLC_H2_FRAME_HEADERS, VLC_H2_HEADERS_PRIORITY
+              | VLC_H2_HEADERS_END_HEADERS, STREAM_ID, 4);
+    check_error(f, VLC_H2_FRAME_SIZE_ERROR);
+
+    /* Undecodable header block */
+    f = frame(VLC_H2_FRAME_HEADERS, VLC_H2_HEADERS_END_HEADERS, STREAM_ID, 1);
+    vlc_h2_frame_payload(f)[0] = 0x80;
+    check_error(f, VLC_H2_COMPRESSION_ERROR);
+
+    /* Header block larger than the limit, over CONTINUATION frames */
+    f = frame(VLC_H2_FRAME_HEADERS, 0, STREAM_ID, VLC_H2_DEFAULT_MAX_FRAME);
+    struct vlc_h2_frame **pp = &f->next;
+    for (size_t len = VLC_H2_DEFAULT_MAX_FRAME; len <= VLC_H2_MAX_HEADER_BLOCK;
+         len += VLC_H2_DEFAULT_MAX_FRAME)
+    {
+        *pp = frame(VLC_H2_FRAME_CONTINUATION, 0, STREAM_ID,
+                    VLC_H2_DEFAULT_MAX_FRAME);
+        pp = &(*pp)->next;
+    }
+    check_error(f, VLC_H2_ENHANCE_YOUR_CALM);
+}
+
+static void test_data(void)
+{
+    struct vlc_h2_frame *f;
+
+    f = frame(VLC_H2_FRAME_DATA, VLC_H2_DATA_END_STREAM, STREAM_ID, 100);
+    check_ok(f);
+    assert(st.data == 100 && st.eos == 1);
+
+    /* Padding */
+    f = frame(VLC_H2_FRAME_DATA, VLC_H2_DATA_PADDED, STREAM_ID, 100);
+    vlc_h2_frame_payload(f)[0] = 9;
+    check_ok(f);
+    assert(st.data == 90 && st.eos == 0);
+
+    f = frame(VLC_H2_FRAME_DATA, VLC_H2_DATA_PADDED, STREAM_ID, 100);
+    vlc_h2_frame_payload(f)[0] = 100;
+    check_error(f, VLC_H2_PROTOCOL_ERROR);
+
+    f = frame(VLC_H2_FRAME_DATA, VLC_H2_DATA_PADDED, STREAM_ID, 0);
+    check_error(f, VLC_H2_PROTOCOL_ERROR);
+
+    /* Stream 0 */
+    f = frame(VLC_H2_FRAME_DATA, 0, 0, 100);
+    check_error(f, VLC_H2_PROTOCOL_ERROR);
+
+    /* Closed stream: ignored */
+    f = frame(VLC_H2_FRAME_DATA, VLC_H2_DATA_END_STREAM, 3, 100);
+    check_ok(f);
+    assert(st.data == 0 && st.eos == 0);
+
+    /* Beyond the default connection window */
+    f = frame(VLC_H2_FRAME_DATA, 0, STREAM_ID, VLC_H2_DEFAULT_MAX_FRAME);
+    struct vlc_h2_frame **pp = &f->next;
+    for (unsigned i = 0; i < 4; i++)
+    {
+        *pp = frame(VLC_H2_FRAME_DATA, 0, STREAM_ID, VLC_H2_DEFAULT_MAX_FRAME);
+        pp = &(*pp)->next;
+    }
+    check_error(f, VLC_H2_FLOW_CONTROL_ERROR);
+    assert(st.data == 3 * VLC_H2_DEFAULT_MAX_FRAME);
+}
+
+static void test_control(void)
+{
+    struct vlc_h2_frame *f;
+
+    /* SETTINGS */
+    f = vlc_h2_frame_settings();
+    assert(f != NULL);
+
+    size_t len = vlc_h2_frame_length(f);
+    assert(len > 0 && len % 6 == 0);
+    check_ok(f);
+    assert(st.settings == len / 6 && st.settings_done == 1);
+
+    check_ok(vlc_h2_frame_settings_ack());
+    assert(st.settings_done == 0);
+
+    check_error(frame(VLC_H2_FRAME_SETTINGS, 0, 0, 5),
+                VLC_H2_FRAME_SIZE_ERROR);
+    check_error(frame(VLC_H2_FRAME_SETTINGS, VLC_H2_SETTINGS_ACK, 0, 6),
+                VLC_H2_FRAME_SIZE_ERROR);
+    check_error(frame(VLC_H2_FRAME_SETTINGS, 0, STREAM_ID, 6),
+                VLC_H2_PROTOCOL_ERROR);
+
+    /* PING */
+    check_ok(frame(VLC_H2_FRAME_PING, 0, 0, 8));
+    assert(st.pings == 1);
+    check_ok(vlc_h2_frame_pong(42));
+    assert(st.pings == 0);
+    check_error(frame(VLC_H2_FRAME_PING, 0, 0, 7), VLC_H2_FRAME_SIZE_ERROR);
+    check_error(frame(VLC_H2_FRAME_PING, 0, STREAM_ID, 8),
+                VLC_H2_PROTOCOL_ERROR);
+
+    /* GOAWAY */
+    check_ok(vlc_h2_frame_goaway(0, VLC_H2_NO_ERROR));
+    assert(st.resets == 1);
+    check_error(frame(VLC_H2_FRAME_GOAWAY, 0, 0, 7), VLC_H2_FRAME_SIZE_ERROR);
+    check_error(frame(VLC_H2_FRAME_GOAWAY, 0, STREAM_ID, 8),
+                VLC_H2_PROTOCOL_ERROR);
+
+    /* RST_STREAM */
+    check_ok(vlc_h2_frame_rst_stream(STREAM_ID, VLC_H2_CANCEL));
+    assert(st.resets == 1);
+    check_ok(vlc_h2_frame_rst_stream(3, VLC_H2_CANCEL));
+    assert(st.resets == 0);
+    check_error(frame(VLC_H2_FRAME_RST_STREAM, 0, STREAM_ID, 3),
+                VLC_H2_FRAME_SIZE_ERROR);
+    check_error(frame(VLC_H2_FRAME_RST_STREAM, 0, 0, 4),
+                VLC_H2_PROTOCOL_ERROR);
+
+    /* WINDOW_UPDATE */
+    check_ok(vlc_h2_frame_window_update(0, 1000));
+    check_ok(vlc_h2_frame_window_update(STREAM_ID, 1000));
+    check_error(frame(VLC_H2_FRAME_WINDOW_UPDATE, 0, 0, 3),
+                VLC_H2_FRAME_SIZE_ERROR);
+    check_ok(frame(VLC_H2_FRAME_WINDOW_UPDATE, 0, STREAM_ID, 5));
+    assert(st.stream_error == VLC_H2_FRAME_SIZE_ERROR);
+
+    /* PRIORITY */
+    check_ok(frame(VLC_H2_FRAME_PRIORITY, 0, STREAM_ID, 5));
+    check_ok(frame(VLC_H2_FRAME_PRIORITY, 0, STREAM_ID, 4));
+    assert(st.stream_error == VLC_H2_FRAME_SIZE_ERROR);
+    check_error(frame(VLC_H2_FRAME_PRIORITY, 0, 0, 5),
+                VLC_H2_PROTOCOL_ERROR);
+
+    /* PUSH_PROMISE, which is disabled */
+    check_error(frame(VLC_H2_FRAME_PUSH_PROMISE, 0, STREAM_ID, 8),
+                VLC_H2_PROTOCOL_ERROR);
+
+    /* Unknown frame types are ignored */
+    check_ok(frame(0xfe, 0xff, STREAM_ID, 42));
+
+    /* Frames after an error are freed */
+    f = frame(VLC_H2_FRAME_PING, 0, 0, 7);
+    f->next = frame(VLC_H2_FRAME_PING, 0, 0, 8);
+    f->next->next = frame(VLC_H2_FRAME_DATA, 0, STREAM_ID, 8);
+    check_error(f, VLC_H2_FRAME_SIZE_ERROR);
+    assert(st.pings == 0 && st.data == 0);
+
+    /* Frames larger than the 24 bits length */
+    assert(vlc_h2_frame_alloc(VLC_H2_FRAME_DATA, 0, 1, 1 << 24) == NULL);
+
+    for (uint_fast32_t code = 0; code < 20; code++)
+        assert(vlc_h2_strerror(code) != NULL);
+}
+
+int main(void)
+{
+    test_headers();
+    test_data();
+    test_control();
+    return 0;
+}
@@ -0,0 +1,280 @@
+/*
+ * hpack.c - HPACK header compression test
+ */
+
+/**********************************************************************
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+/* Encodes header lists and decodes them back, decodes the examples of
+ * RFC 7541 appendix C, with and without Huffman coding and through the
+ * dynamic table, and checks that malformed header blocks are rejected.
+ */
+
+#include "../../../libvlc/test.h"
+
+#include <string.h>
+
+#include "../modules/access/http/hpack.c"
+
+/* After hpack.c, as it includes config.h again */
+#undef NDEBUG
+#include <assert.h>
+
+#define ARRAY_SIZE(a) (sizeof (a) / sizeof ((a)[0]))
+
+static void free_headers(char *headers[][2], int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        free(headers[i][1]);
+        free(headers[i][0]);
+    }
+}
+
+static void check_decode(struct hpack_decoder *dec, const uint8_t *data,
+                         size_t length, const char *const expected[][2],
+                         unsigned count)
+{
+    char *headers[16][2];
+
+    assert(count <= ARRAY_SIZE(headers));
+
+    int n = hpack_decode(dec, data, length, headers, ARRAY_SIZE(headers));
+    assert(n >= 0 && (unsigned)n == count);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        assert(!strcmp(headers[i][0], expected[i][0]));
+        assert(!strcmp(headers[i][1], expected[i][1]));
+    }
+    free_headers(headers, n);
+}
+
+static void check_invalid(const uint8_t *data, size_t length)
+{
+    struct hpack_decoder *dec = hpack_decode_init(4096);
+    char *headers[4][2];
+
+    assert(dec != NULL);
+    assert(hpack_decode(dec, data, length, headers, 4) == -1);
+    hpack_decode_destroy(dec);
+}
+
+static void test_round_trip(void)
+{
+    char long_value[300];
+
+    memset(long_value, 'x', sizeof (long_value) - 1);
+    long_value[sizeof (long_value) - 1] = '\0';
+
+    /* The lengths cover one byte integers, the 127 bytes boundary of the
+     * 7 bits prefix and two bytes integers */
+    char boundary[128];
+    memset(boundary, 'y', 127);
+    boundary[127] = '\0';
+
+    const char *const headers[][2] = {
+        { ":method", "GET" },
+        { ":path", "/foo/bar?baz=1" },
+        { ":authority", "www.example.com" },
+        { "range", "bytes=0-" },
+        { "x-empty", "" },
+        { "x-boundary", boundary },
+        { "x-long", long_value },
+    };
+    const unsigned count = ARRAY_SIZE(headers);
+
+    size_t len = hpack_encode(NULL, 0, headers, count);
+    uint8_t *buf = malloc(len + 1);
+    assert(buf != NULL);
+
+    /* A short buffer gives the same length, and is not overflowed */
+    buf[len - 1] = 0xA5;
+    assert(hpack_encode(buf, len - 1, headers, count) == len);
+    assert(buf[len - 1] == 0xA5);
+
+    buf[len] = 0xA5;
+    assert(hpack_encode(buf, len, headers, count) == len);
+    assert(buf[len] == 0xA5);
+
+    struct hpack_decoder *dec = hpack_decode_init(4096);
+    assert(dec != NULL);
+    check_decode(dec, buf, len, headers, count);
+    /* Literals without indexing leave the dynamic table alone */
+    assert(dec->count == 0);
+    hpack_decode_destroy(dec);
+    free(buf);
+}
+
+/* RFC 7541 C.3 and C.4: requests, without then with Huffman coding */
+static void test_requests(bool huffman)
+{
+    static const uint8_t raw1[] = {
+        0x82, 0x86, 0x84, 0x41, 0x0f, 0x77, 0x77, 0x77, 0x2e, 0x65, 0x78,
+        0x61, 0x6d, 0x70, 0x6c, 0x65, 0x2e, 0x63, 0x6f, 0x6d,
+    };
+    static const uint8_t raw2[] = {
+        0x82, 0x86, 0x84, 0xbe, 0x58, 0x08, 0x6e, 0x6f, 0x2d, 0x63, 0x61,
+        0x63, 0x68, 0x65,
+    };
+    static const uint8_t raw3[] = {
+        0x82, 0x87, 0x85, 0xbf, 0x40, 0x0a, 0x63, 0x75, 0x73, 0x74, 0x6f,
+        0x6d, 0x2d, 0x6b, 0x65, 0x79, 0x0c, 0x63, 0x75, 0x73, 0x74, 0x6f,
+        0x6d, 0x2d, 0x76, 0x61, 0x6c, 0x75, 0x65,
+    };
+    static const uint8_t huff1[] = {
+        0x82, 0x86, 0x84, 0x41, 0x8c, 0xf1, 0xe3, 0xc2, 0xe5, 0xf2, 0x3a,
+        0x6b, 0xa0, 0xab, 0x90, 0xf4, 0xff,
+    };
+    static const uint8_t huff2[] = {
+        0x82, 0x86, 0x84, 0xbe, 0x58, 0x86, 0xa8, 0xeb, 0x10, 0x64, 0x9c,
+        0xbf,
+    };
+    static const uint8_t huff3[] = {
+        0x82, 0x87, 0x85, 0xbf, 0x40, 0x88, 0x25, 0xa8, 0x49, 0xe9, 0x5b,
+        0xa9, 0x7d, 0x7f, 0x89, 0x25, 0xa8, 0x49, 0xe9, 0x5b, 0xb8, 0xe8,
+        0xb4, 0xbf,
+    };
+    static const char *const req1[][2] = {
+        { ":method", "GET" }, { ":scheme", "http" }, { ":path", "/" },
+        { ":authority", "www.example.com" },
+    };
+    static const char *const req2[][2] = {
+        { ":method", "GET" }, { ":scheme", "http" }, { ":path", "/" },
+        { ":authority", "www.example.com" }, { "cache-control", "no-cache" },
+    };
+    static const char *const req3[][2] = {
+        { ":method", "GET" }, { ":scheme", "https" },
+        { ":path", "/index.html" }, { ":authority", "www.example.com" },
+        { "custom-key", "custom-value" },
+    };
+
+    struct hpack_decoder *dec = hpack_decode_init(4096);
+    assert(dec != NULL);
+
+    if (huffman)
+        check_decode(dec, huff1, sizeof (huff1), req1, ARRAY_SIZE(req1));
+    else
+        check_decode(dec, raw1, sizeof (raw1), req1, ARRAY_SIZE(req1));
+    assert(dec->count == 1 && dec->size == 57);
+
+    if (huffman)
+        check_decode(dec, huff2, sizeof (huff2), req2, ARRAY_SIZE(req2));
+    else
+        check_decode(dec, raw2, sizeof (raw2), req2, ARRAY_SIZE(req2));
+    assert(dec->count == 2 && dec->size == 110);
+
+    if (huffman)
+        check_decode(dec, huff3, sizeof (huff3), req3, ARRAY_SIZE(req3));
+    else
+        check_decode(dec, raw3, sizeof (raw3), req3, ARRAY_SIZE(req3));
+    assert(dec->count == 3 && dec->size == 164);
+
+    hpack_decode_destroy(dec);
+}
+
+/* RFC 7541 C.5: responses with a 256 bytes table, hence evictions */
+static void test_responses(void)
+{
+    static const uint8_t resp1[] = {
+        0x48, 0x03, 0x33, 0x30, 0x32, 0x58, 0x07, 0x70, 0x72, 0x69, 0x76,
+        0x61, 0x74, 0x65, 0x61, 0x1d, 0x4d, 0x6f, 0x6e, 0x2c, 0x20, 0x32,
+        0x31, 0x20, 0x4f, 0x63, 0x74, 0x20, 0x32, 0x30, 0x31, 0x33, 0x20,
+        0x32, 0x30, 0x3a, 0x31, 0x33, 0x3a, 0x32, 0x31, 0x20, 0x47, 0x4d,
+        0x54, 0x6e, 0x17, 0x68, 0x74, 0x74, 0x70, 0x73, 0x3a, 0x2f, 0x2f,
+        0x77, 0x77, 0x77, 0x2e, 0x65, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65,
+        0x2e, 0x63, 0x6f, 0x6d,
+    };
+    static const uint8_t resp2[] = {
+        0x48, 0x03, 0x33, 0x30, 0x37, 0xc1, 0xc0, 0xbf,
+    };
+    static const char *const hdr1[][2] = {
+        { ":status", "302" }, { "cache-control", "private" },
+        { "date", "Mon, 21 Oct 2013 20:13:21 GMT" },
+        { "location", "https://www.example.com" },
+    };
+    static const char *const hdr2[][2] = {
+        { ":status", "307" }, { "cache-control", "private" },
+        { "date", "Mon, 21 Oct 2013 20:13:21 GMT" },
+        { "location", "https://www.example.com" },
+    };
+
+    struct hpack_decoder *dec = hpack_decode_init(256);
+    assert(dec != NULL);
+
+    check_decode(dec, resp1, sizeof (resp1), hdr1, ARRAY_SIZE(hdr1));
+    assert(dec->count == 4 && dec->size == 222);
+    /* ":status: 302" is evicted to make room for ":status: 307" */
+    check_decode(dec, resp2, sizeof (resp2), hdr2, ARRAY_SIZE(hdr2));
+    assert(dec->count == 4 && dec->size == 222);
+
+    /* A table size update evicts down to the new size */
+    static const uint8_t shrink[] = { 0x3f, 0x51 }; /* 31 + 81 = 112 */
+    check_decode(dec, shrink, sizeof (shrink), NULL, 0);
+    assert(dec->count == 2 && dec->size <= 112);
+
+    hpack_decode_destroy(dec);
+}
+
+static void test_invalid(void)
+{
+    /* Indexed field 0 */
+    check_invalid((const uint8_t []){ 0x80 }, 1);
+    /* Indexed field past the static table, with an empty dynamic table */
+    check_invalid((const uint8_t []){ 0xbe }, 1);
+    /* Truncated integer */
+    check_invalid((const uint8_t []){ 0xff }, 1);
+    check_invalid((const uint8_t []){ 0xff, 0x80 }, 2);
+    /* Unreasonably large integer */
+    check_invalid((const uint8_t []){ 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f }, 6);
+    /* String longer than the block */
+    check_invalid((const uint8_t []){ 0x00, 0x05, 'a', 0x01, 'b' }, 5);
+    /* Missing value */
+    check_invalid((const uint8_t []){ 0x00, 0x01, 'a' }, 3);
+    /* Nul byte in a literal */
+    check_invalid((const uint8_t []){ 0x00, 0x01, 0x00, 0x01, 'b' }, 5);
+    /* Literal with an indexed name past the tables */
+    check_invalid((const uint8_t []){ 0x0f, 0x40, 0x01, 'b' }, 4);
+    /* Table size update above the limit (31 + 98 + (31 << 7) = 4097) */
+    check_invalid((const uint8_t []){ 0x3f, 0xe2, 0x1f }, 3);
+    /* Huffman string with more than 7 bits of padding */
+    check_invalid((const uint8_t []){ 0x00, 0x81, 0xff, 0x01, 'b' }, 5);
+    /* Huffman string with padding that is not an EOS prefix */
+    check_invalid((const uint8_t []){ 0x00, 0x81, 0x18, 0x01, 'b' }, 5);
+
+    /* ...but the shortest valid Huffman string is accepted */
+    static const uint8_t huff[] = { 0x00, 0x81, 0x1f, 0x81, 0x1f };
+    static const char *const hdr[][2] = { { "a", "a" } };
+    struct hpack_decoder *dec = hpack_decode_init(4096);
+    assert(dec != NULL);
+    check_decode(dec, huff, sizeof (huff), hdr, 1);
+
+    /* More fields than the table of the caller */
+    static const uint8_t two[] = { 0x82, 0x84 };
+    char *headers[1][2];
+    assert(hpack_decode(dec, two, sizeof (two), headers, 1) == -1);
+    hpack_decode_destroy(dec);
+}
+
+int main(void)
+{
+    test_round_trip();
+    test_requests(false);
+    test_requests(true);
+    test_responses();
+    test_invalid();
+    return 0;
+}
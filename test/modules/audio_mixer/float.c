@@ -0,0 +1,113 @@
+/*
+ * float.c - float32 audio volume microbenchmark
+ */
+
+/**********************************************************************
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+/* Amplifies 7.1 192 kHz float32 buffers, first with a plain scalar loop,
+ * then with the kernel that the float volume module selects for the CPU,
+ * checks that both give the same samples, and reports the throughput.
+ */
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <time.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_fourcc.h>
+#include <vlc_modules.h>
+#include <vlc_aout_volume.h>
+
+#define SAMPLES (8 * 192000 / 50) /* 20 ms of 7.1 at 192 kHz */
+#define RUNS 20000
+
+static double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void amplify_scalar (audio_volume_t *volume, block_t *block, float amp)
+{
+    float *p = (float *)block->p_buffer;
+
+    for (size_t i = block->i_buffer / sizeof (*p); i > 0; i--)
+        *(p++) *= amp;
+    (void) volume;
+}
+
+static double bench (audio_volume_t *volume, block_t *block,
+                     void (*amplify) (audio_volume_t *, block_t *, float))
+{
+    double start = now ();
+
+    /* Alternate gains to keep the samples in range */
+    for (unsigned i = 0; i < RUNS; i++)
+        amplify (volume, block, (i & 1) ? 2.f : .5f);
+    return now () - start;
+}
+
+int main (void)
+{
+    setenv ("VLC_PLUGIN_PATH", "../modules", 0);
+
+    libvlc_instance_t *vlc = libvlc_new (test_defaults_nargs,
+                                         test_defaults_args);
+    assert (vlc != NULL);
+
+    audio_volume_t *volume = vlc_object_create (vlc->p_libvlc_int,
+                                                sizeof (*volume));
+    assert (volume != NULL);
+    volume->format = VLC_CODEC_FL32;
+
+    module_t *module = module_need (volume, "audio volume", "float_mixer", true);
+    assert (module != NULL);
+
+    /* Odd sample count and offset to cover the unaligned head and tail */
+    block_t *ref = block_Alloc ((SAMPLES + 3) * sizeof (float));
+    block_t *out = block_Alloc ((SAMPLES + 3) * sizeof (float));
+    assert (ref != NULL && out != NULL);
+    ref->p_buffer += sizeof (float);
+    out->p_buffer += sizeof (float);
+    ref->i_buffer = out->i_buffer = SAMPLES * sizeof (float) + sizeof (float);
+
+    float *a = (float *)ref->p_buffer, *b = (float *)out->p_buffer;
+    for (size_t i = 0; i <= SAMPLES; i++)
+        a[i] = b[i] = rand () / (float)RAND_MAX - .5f;
+
+    amplify_scalar (volume, ref, .3f);
+    volume->amplify (volume, out, .3f);
+    assert (memcmp (a, b, ref->i_buffer) == 0);
+
+    double scalar = bench (volume, ref, amplify_scalar);
+    double simd = bench (volume, out, volume->amplify);
+    double bytes = (double)ref->i_buffer * RUNS;
+
+    log ("scalar: %.1f MB/s\n", bytes / scalar / 1e6);
+    log ("module: %.1f MB/s (%.2fx)\n", bytes / simd / 1e6, scalar / simd);
+
+    block_Release (out);
+    block_Release (ref);
+    module_unneed (volume, module);
+    vlc_object_release (volume);
+    libvlc_release (vlc);
+    return 0;
+}
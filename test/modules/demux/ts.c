@@ -0,0 +1,91 @@
+/*
+ * ts.c - TS demux microbenchmark
+ */
+
+/**********************************************************************
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+/* Replays a recorded transport stream (typically a full transponder
+ * capture) through the TS demux as fast as possible, and reports the
+ * throughput. The sample is given as first argument or through the
+ * VLC_TEST_TS_SAMPLE environment variable; the test is skipped without it.
+ */
+
+#include "../../libvlc/test.h"
+
+#include <time.h>
+#include <sys/stat.h>
+
+static double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main (int argc, char *argv[])
+{
+    const char *path = (argc > 1) ? argv[1] : getenv ("VLC_TEST_TS_SAMPLE");
+    struct stat st;
+
+    if (path == NULL || stat (path, &st))
+    {
+        log ("no TS sample, skipping\n");
+        return 77;
+    }
+
+    setenv ("VLC_PLUGIN_PATH", "../modules", 0);
+
+    static const char *args[] = {
+        "--ignore-config", "-I", "dummy", "--no-media-library",
+        "--demux=ts", "--sout=#dummy", "--no-sout-all",
+    };
+    libvlc_instance_t *vlc = libvlc_new (sizeof (args) / sizeof (args[0]),
+                                         args);
+    assert (vlc != NULL);
+
+    libvlc_media_t *media = libvlc_media_new_path (vlc, path);
+    assert (media != NULL);
+
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media (media);
+    assert (mp != NULL);
+    libvlc_media_release (media);
+
+    double start = now ();
+
+    libvlc_media_player_play (mp);
+
+    libvlc_state_t state;
+    do
+    {
+        usleep (10000);
+        state = libvlc_media_player_get_state (mp);
+    }
+    while (state != libvlc_Ended && state != libvlc_Error);
+
+    double elapsed = now () - start;
+
+    libvlc_media_player_stop (mp);
+    libvlc_media_player_release (mp);
+    libvlc_release (vlc);
+
+    assert (state == libvlc_Ended);
+    log ("demuxed %lld bytes (%lld packets) in %.3f s: %.1f Mbit/s\n",
+         (long long)st.st_size, (long long)st.st_size / 188, elapsed,
+         st.st_size * 8 / elapsed / 1e6);
+    return 0;
+}
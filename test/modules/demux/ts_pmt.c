@@ -0,0 +1,323 @@
+/*
+ * ts_pmt.c - TS demux regression test for program tables
+ */
+
+/**********************************************************************
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+/* Writes a multi-program transport stream to a seekable file, where the
+ * first PMT of most programs shows up in the middle of the packets that
+ * the demux processes in place. Such a PMT makes the demux probe the
+ * start and the end of the file, which must not disturb the packets that
+ * follow it: any continuity error on the selected program is a failure.
+ *
+ * The stream is then demuxed with all its programs selected, with and
+ * without a thread per program, which must send the same data: the stats
+ * stream output logs the size and MD5 sum of every track.
+ */
+
+#include "../../libvlc/test.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+#define PROGRAMS    5
+#define PACKETS     6000
+#define PES_PACKETS 25
+
+static uint8_t cc[0x2000];
+
+static void packet_header (uint8_t *p, unsigned pid, bool unit_start)
+{
+    memset (p, 0xff, 188);
+    p[0] = 0x47;
+    p[1] = (unit_start ? 0x40 : 0) | (pid >> 8);
+    p[2] = pid;
+    p[3] = 0x10 | (cc[pid]++ & 0xf);
+}
+
+static void write_section (FILE *out, unsigned pid, const uint8_t *sec,
+                           size_t len)
+{
+    uint8_t p[188];
+
+    assert (len <= 188 - 5);
+    packet_header (p, pid, true);
+    p[4] = 0; /* pointer field */
+    memcpy (p + 5, sec, len);
+    fwrite (p, 1, 188, out);
+}
+
+static size_t section_end (uint8_t *sec, size_t len)
+{
+    /* Section length, including a (dummy) CRC */
+    sec[1] = 0xb0 | ((len + 4 - 3) >> 8);
+    sec[2] = len + 4 - 3;
+    memset (sec + len, 0, 4);
+    return len + 4;
+}
+
+static void write_pat (FILE *out)
+{
+    uint8_t sec[183];
+    size_t len = 8;
+
+    sec[0] = 0x00;
+    sec[3] = 0x00; sec[4] = 0x01; /* transport_stream_id */
+    sec[5] = 0xc1; sec[6] = 0; sec[7] = 0;
+    for (unsigned i = 1; i <= PROGRAMS; i++)
+    {
+        sec[len++] = 0;
+        sec[len++] = i; /* program_number */
+        sec[len++] = 0xe0 | i; /* PMT PID i << 8 */
+        sec[len++] = 0;
+    }
+    write_section (out, 0, sec, section_end (sec, len));
+}
+
+static void write_pmt (FILE *out, unsigned program)
+{
+    const unsigned es_pid = (program << 8) + 1;
+    uint8_t sec[183];
+    size_t len = 12;
+
+    sec[0] = 0x02;
+    sec[3] = 0; sec[4] = program;
+    sec[5] = 0xc1; sec[6] = 0; sec[7] = 0;
+    sec[8] = 0xe0 | (es_pid >> 8); sec[9] = es_pid; /* PCR PID */
+    sec[10] = 0xf0; sec[11] = 0;
+    sec[len++] = 0x02; /* MPEG-2 video */
+    sec[len++] = 0xe0 | (es_pid >> 8);
+    sec[len++] = es_pid;
+    sec[len++] = 0xf0;
+    sec[len++] = 0;
+    write_section (out, program << 8, sec, section_end (sec, len));
+}
+
+static void write_es (FILE *out, unsigned program, unsigned n)
+{
+    const unsigned pid = (program << 8) + 1;
+    const bool unit_start = (n % PES_PACKETS) == 0;
+    uint8_t p[188];
+
+    packet_header (p, pid, unit_start);
+    if (unit_start)
+    {
+        /* Adaptation field with the PCR, then a PES header with the PTS */
+        const uint64_t ts = 90000 + 3600 * (n / PES_PACKETS);
+
+        p[3] |= 0x20;
+        p[4] = 7;
+        p[5] = 0x10;
+        p[6] = ts >> 25; p[7] = ts >> 17; p[8] = ts >> 9; p[9] = ts >> 1;
+        p[10] = (ts << 7) | 0x7e; p[11] = 0;
+
+        uint8_t *pes = p + 12;
+        pes[0] = 0; pes[1] = 0; pes[2] = 1; pes[3] = 0xe0;
+        pes[4] = 0; pes[5] = 0; /* unbounded */
+        pes[6] = 0x80; pes[7] = 0x80; pes[8] = 5;
+        pes[9] = 0x21 | ((ts >> 29) & 0x0e);
+        pes[10] = ts >> 22; pes[11] = (ts >> 14) | 1;
+        pes[12] = ts >> 7; pes[13] = (ts << 1) | 1;
+
+        /* Sequence header, intra picture and slice: enough for the
+         * packetizer to output one picture per PES */
+        static const uint8_t es[] = {
+            0, 0, 1, 0xb3, 0x16, 0x01, 0x20, 0x13, 0xff, 0xff, 0xe0, 0x80,
+            0, 0, 1, 0x00, 0x00, 0x0f, 0xff, 0xf8,
+            0, 0, 1, 0x01,
+        };
+        uint8_t *data = pes + 14;
+
+        memcpy (data, es, sizeof (es));
+        data[sizeof (es)] = 0x80 | (n / PES_PACKETS); /* picture number */
+        memset (data + sizeof (es) + 1, program,
+                188 - 12 - 14 - sizeof (es) - 1);
+    }
+    else
+        memset (p + 4, program, 188 - 4);
+    fwrite (p, 1, 188, out);
+}
+
+static void write_stream (FILE *out)
+{
+    unsigned es_count[PROGRAMS + 1] = { 0 };
+    unsigned announced = 1;
+
+    write_pat (out);
+    write_pmt (out, 1);
+
+    for (unsigned i = 2; i < PACKETS; i++)
+    {
+        if (i % 400 == 0)
+        {   /* Repeat the tables */
+            write_pat (out);
+            for (unsigned prg = 1; prg <= announced; prg++)
+                write_pmt (out, prg);
+        }
+        else if (announced < PROGRAMS && i == 123 + 61 * announced)
+            /* First PMT of the next program, at an arbitrary offset */
+            write_pmt (out, ++announced);
+        else
+        {
+            unsigned prg = 1 + i % announced;
+            write_es (out, prg, es_count[prg]++);
+        }
+    }
+}
+
+static unsigned pmt_count, threads, discontinuities;
+static char tracks[PROGRAMS][256];
+static unsigned track_count;
+
+static void logger (void *data, int level, const libvlc_log_t *ctx,
+                    const char *fmt, va_list ap)
+{
+    const char *module;
+    char msg[256];
+
+    (void) data; (void) level;
+    vsnprintf (msg, sizeof (msg), fmt, ap);
+
+    /* Size and MD5 sum of each track, from the stats stream output */
+    const char *final = strstr (msg, "final type:");
+    if (final != NULL)
+    {
+        assert (track_count < PROGRAMS);
+        strcpy (tracks[track_count++], final);
+    }
+
+    libvlc_log_get_context (ctx, &module, NULL, NULL);
+    if (module == NULL || strcmp (module, "ts"))
+        return;
+
+    if (!strncmp (msg, "new PMT ", 8))
+        pmt_count++;
+    if (strstr (msg, "demuxed on its own thread") != NULL)
+        threads++;
+    if (!strncmp (msg, "discontinuity received", 22))
+    {
+        log ("%s\n", msg);
+        discontinuities++;
+    }
+}
+
+static int compare_tracks (const void *a, const void *b)
+{
+    return strcmp (a, b);
+}
+
+static void play (const char *path, const char *sout,
+                  const char *const *extra_args, unsigned extra_count)
+{
+    const char *args[16] = {
+        "--ignore-config", "-I", "dummy", "--no-media-library",
+        "--demux=ts", sout,
+    };
+    unsigned count = 6;
+
+    assert (count + extra_count <= sizeof (args) / sizeof (args[0]));
+    for (unsigned i = 0; i < extra_count; i++)
+        args[count++] = extra_args[i];
+
+    pmt_count = threads = discontinuities = track_count = 0;
+
+    libvlc_instance_t *vlc = libvlc_new (count, args);
+    assert (vlc != NULL);
+    libvlc_log_set (vlc, logger, NULL);
+
+    libvlc_media_t *media = libvlc_media_new_path (vlc, path);
+    assert (media != NULL);
+
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media (media);
+    assert (mp != NULL);
+
+    libvlc_media_player_play (mp);
+
+    libvlc_state_t state;
+    do
+    {
+        usleep (10000);
+        state = libvlc_media_player_get_state (mp);
+    }
+    while (state != libvlc_Ended && state != libvlc_Error);
+
+    libvlc_media_player_stop (mp);
+    libvlc_media_player_release (mp);
+    libvlc_media_release (media);
+    libvlc_log_unset (vlc);
+    libvlc_release (vlc);
+
+    if (pmt_count > 0)
+        assert (state == libvlc_Ended);
+    /* The tracks are not removed in any particular order */
+    qsort (tracks, track_count, sizeof (tracks[0]), compare_tracks);
+}
+
+int main (void)
+{
+    char path[] = "/tmp/vlc-test-ts-XXXXXX";
+    int fd = mkstemp (path);
+    assert (fd != -1);
+
+    FILE *out = fdopen (fd, "wb");
+    assert (out != NULL);
+    write_stream (out);
+    fclose (out);
+
+    test_init ();
+
+    /* Default program, with the PMT of the others in the middle */
+    play (path, "--sout=#dummy", NULL, 0);
+    if (pmt_count == 0)
+    {
+        log ("TS demux not available, skipping\n");
+        unlink (path);
+        return 77;
+    }
+    log ("%u programs, %u discontinuities\n", pmt_count, discontinuities);
+    assert (pmt_count == PROGRAMS);
+    assert (discontinuities == 0);
+
+    /* All programs, on the input thread, then on their own threads */
+    static const char *const all_args[] = {
+        "--sout-all", "--programs=1,2,3,4,5",
+    };
+    char expected[PROGRAMS][256];
+
+    play (path, "--sout=#stats", all_args, 2);
+    assert (discontinuities == 0);
+    assert (threads == 0);
+    assert (track_count == PROGRAMS);
+    memcpy (expected, tracks, sizeof (expected));
+
+    static const char *const threaded_args[] = {
+        "--sout-all", "--programs=1,2,3,4,5", "--ts-program-threads",
+    };
+    play (path, "--sout=#stats", threaded_args, 3);
+    log ("%u tracks with %u program threads\n", track_count, threads);
+    assert (discontinuities == 0);
+    assert (threads == PROGRAMS);
+    assert (track_count == PROGRAMS);
+    for (unsigned i = 0; i < PROGRAMS; i++)
+    {
+        log ("%s\n", tracks[i]);
+        assert (!strcmp (tracks[i], expected[i]));
+    }
+
+    unlink (path);
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * csa.c - CSA scrambler benchmark
+ */
+
+/**********************************************************************
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+/* Scrambles TS packets, with and without adaptation fields, one by one and
+ * CSA_PACKETS at a time, checks that both give the same packets and that
+ * they descramble back, and reports the throughput of both.
+ */
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <time.h>
+
+#include <vlc_common.h>
+
+#define TS_NO_CSA_CK_MSG
+#include "../modules/mux/mpeg/csa.c"
+
+/* After csa.c, as it includes config.h again */
+#undef NDEBUG
+#include <assert.h>
+
+#define PACKETS 1000
+#define RUNS    20
+
+static double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void Fill (uint8_t *pkts)
+{
+    srand (42);
+    for (unsigned i = 0; i < PACKETS; i++)
+    {
+        uint8_t *pkt = &pkts[188 * i];
+
+        for (unsigned j = 0; j < 188; j++)
+            pkt[j] = rand ();
+        pkt[0] = 0x47;
+        pkt[3] = 0x10 | (i & 0x0f);
+        if (i % 3 == 0)
+        {
+            /* adaptation field, up to a payload too short to scramble */
+            pkt[3] |= 0x20;
+            pkt[4] = i % 184;
+        }
+    }
+}
+
+static void Scramble (csa_t *csa, uint8_t *pkts, bool batch)
+{
+    if (!batch)
+    {
+        for (unsigned i = 0; i < PACKETS; i++)
+            csa_Encrypt (csa, &pkts[188 * i], 188);
+        return;
+    }
+
+    uint8_t *pp[PACKETS];
+    for (unsigned i = 0; i < PACKETS; i++)
+        pp[i] = &pkts[188 * i];
+    csa_EncryptPackets (csa, pp, PACKETS, 188);
+}
+
+int main (void)
+{
+    static uint8_t clear[PACKETS * 188], single[PACKETS * 188],
+                   batch[PACKETS * 188];
+    char ck[] = "0x0123456789abcdef", ck2[] = "fedcba9876543210";
+
+    setenv ("VLC_PLUGIN_PATH", "../modules", 0);
+
+    libvlc_instance_t *vlc = libvlc_new (test_defaults_nargs,
+                                         test_defaults_args);
+    assert (vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT (vlc->p_libvlc_int);
+    csa_t *csa = csa_New ();
+    assert (csa != NULL);
+    assert (csa_SetCW (obj, csa, ck, true) == VLC_SUCCESS);
+    assert (csa_SetCW (obj, csa, ck2, false) == VLC_SUCCESS);
+
+    Fill (clear);
+    for (int odd = 0; odd < 2; odd++)
+    {
+        csa_UseKey (obj, csa, odd);
+
+        memcpy (single, clear, sizeof (clear));
+        memcpy (batch, clear, sizeof (clear));
+        Scramble (csa, single, false);
+        Scramble (csa, batch, true);
+        assert (!memcmp (single, batch, sizeof (batch)));
+
+        for (unsigned i = 0; i < PACKETS; i++)
+            csa_Decrypt (csa, &batch[188 * i], 188);
+        for (unsigned i = 0; i < PACKETS; i++)
+        {
+            /* packets too short to scramble are left alone */
+            assert (!memcmp (&batch[188 * i + 4], &clear[188 * i + 4], 184));
+            assert ((batch[188 * i + 3] & 0x3f) == clear[188 * i + 3]);
+        }
+    }
+
+    for (int b = 0; b < 2; b++)
+    {
+        double start = now ();
+        for (unsigned run = 0; run < RUNS; run++)
+        {
+            memcpy (single, clear, sizeof (clear));
+            Scramble (csa, single, b);
+        }
+
+        double t = now () - start;
+        log ("%-8s %8.0f packets/s, %6.1f Mbits/s\n",
+             b ? "batch" : "single", PACKETS * RUNS / t,
+             PACKETS * RUNS * 188 * 8 / t / 1e6);
+    }
+
+    csa_Delete (csa);
+    libvlc_release (vlc);
+    return 0;
+}
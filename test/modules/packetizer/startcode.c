@@ -0,0 +1,197 @@
+/*
+ * startcode.c - Annex B start code scanning microbenchmark
+ */
+
+/**********************************************************************
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+/* Looks for all the start codes of an elementary stream the way the
+ * packetizers do, cut in TS payload sized and in large blocks, with the
+ * byte per byte match and with the start code helper, checks that both
+ * find the same start codes and reports the throughput of both.
+ * The stream is a recorded H.264, HEVC or MPEG video elementary stream
+ * given as first argument or through the VLC_TEST_ES_SAMPLE environment
+ * variable, or random data with start codes without it.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_block_helper.h>
+
+#include "../modules/packetizer/startcode_helper.h"
+
+#undef NDEBUG
+#include <assert.h>
+
+#define MAX_SIZE (64 << 20)
+#define RUNS     5
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t Load(const char *path, uint8_t *buf)
+{
+    FILE *stream = fopen(path, "rb");
+    if (stream == NULL)
+        return 0;
+
+    size_t size = fread(buf, 1, MAX_SIZE, stream);
+    fclose(stream);
+    return size;
+}
+
+static size_t Fill(uint8_t *buf)
+{
+    srand(42);
+    for (size_t i = 0; i < MAX_SIZE / 4; i++)
+    {
+        /* mostly non-zero bytes, as in entropy coded slices */
+        buf[i] = rand();
+        if (buf[i] == 0 && (rand() & 7))
+            buf[i] = 0x80;
+        if (rand() % 20000 == 0 && i + 4 < MAX_SIZE / 4)
+        {
+            memcpy(&buf[i], "\x00\x00\x01", 3);
+            i += 3;
+            buf[i] = rand();
+        }
+    }
+    return MAX_SIZE / 4;
+}
+
+/* Checks the helper against the plain C loop on all the sub-buffers of
+ * short buffers, for the edge cases */
+static void CheckHelper(void)
+{
+    uint8_t buf[64];
+
+    srand(42);
+    for (unsigned run = 0; run < 200; run++)
+    {
+        for (size_t i = 0; i < sizeof (buf); i++)
+            buf[i] = (rand() & 3) ? 0 : 1;
+
+        for (size_t start = 0; start < sizeof (buf); start++)
+            for (size_t end = start; end <= sizeof (buf); end++)
+            {
+                const uint8_t *ref = NULL;
+                for (size_t i = start; i + 3 <= end; i++)
+                    if (buf[i] == 0 && buf[i + 1] == 0 && buf[i + 2] == 1)
+                    {
+                        ref = &buf[i];
+                        break;
+                    }
+                assert(startcode_FindAnnexB(&buf[start], &buf[end]) == ref);
+            }
+    }
+}
+
+static size_t Scan(const uint8_t *buf, size_t size, size_t i_block,
+                   block_startcode_helper_t helper, uint64_t *positions,
+                   double *elapsed)
+{
+    static const uint8_t startcode[3] = { 0x00, 0x00, 0x01 };
+    block_bytestream_t bytestream;
+    block_t *chain = NULL, **pp_last = &chain;
+
+    for (size_t i = 0; i < size; i += i_block)
+    {
+        size_t len = __MIN(i_block, size - i);
+        block_t *block = block_Alloc(len);
+        assert(block != NULL);
+        memcpy(block->p_buffer, &buf[i], len);
+        block_ChainLastAppend(&pp_last, block);
+    }
+    block_BytestreamInit(&bytestream);
+    block_BytestreamPush(&bytestream, chain);
+
+    double start = now();
+    size_t count = 0, offset = 0;
+    uint64_t pos = 0;
+
+    while (!block_FindStartcodeFromOffset(&bytestream, &offset, startcode,
+                                          sizeof (startcode), helper))
+    {
+        pos += offset;
+        positions[count++] = pos;
+
+        /* skip the unit, as the packetizers do */
+        block_SkipBytes(&bytestream, offset);
+        block_BytestreamFlush(&bytestream);
+        offset = 1;
+    }
+    *elapsed += now() - start;
+
+    block_BytestreamRelease(&bytestream);
+    return count;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = (argc > 1) ? argv[1] : getenv("VLC_TEST_ES_SAMPLE");
+    uint8_t *buf = malloc(MAX_SIZE);
+    assert(buf != NULL);
+
+    CheckHelper();
+
+    size_t size = (path != NULL) ? Load(path, buf) : 0;
+    if (size == 0)
+        size = Fill(buf);
+
+    /* at most one start code per 3 bytes */
+    uint64_t *ref = malloc((size / 3 + 1) * sizeof (*ref));
+    uint64_t *res = malloc((size / 3 + 1) * sizeof (*res));
+    assert(ref != NULL && res != NULL);
+
+    static const size_t blocks[] = { 184, 65536 };
+    for (size_t b = 0; b < ARRAY_SIZE(blocks); b++)
+    {
+        double t_ref = 0., t_res = 0.;
+        size_t i_ref, i_res;
+
+        for (unsigned run = 0; run < RUNS; run++)
+        {
+            i_ref = Scan(buf, size, blocks[b], NULL, ref, &t_ref);
+            i_res = Scan(buf, size, blocks[b], startcode_FindAnnexB, res,
+                         &t_res);
+            assert(i_ref == i_res);
+            assert(!memcmp(ref, res, i_ref * sizeof (*ref)));
+        }
+
+        printf("%zu bytes, %zu start codes, blocks of %zu bytes:\n",
+               size, i_ref, blocks[b]);
+        printf(" bytes  %8.1f MB/s\n", size * RUNS / t_ref / 1e6);
+        printf(" helper %8.1f MB/s\n", size * RUNS / t_res / 1e6);
+    }
+
+    free(res);
+    free(ref);
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,197 @@
+/*
+ * copy.c - hardware frame copy microbenchmark
+ */
+
+/**********************************************************************
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+/* Copies 2160p NV12 frames to YV12 and to NV12 with each copy kernel that
+ * the CPU supports, on one thread and on as many threads as the copy cache
+ * uses for such frames, checks the pictures against the plain C copies and
+ * reports the time per frame and the fastest kernel.
+ * NOTE: the source frames are in normal memory, not in a video surface.
+ */
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <time.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_picture.h>
+
+#ifndef CAN_COMPILE_SSE2
+int main(void)
+{
+    fprintf(stderr, "No SIMD copy kernels, not testing.\n");
+    return 77;
+}
+#else
+
+static unsigned real_cpu(void)
+{
+    return vlc_CPU();
+}
+
+/* Force the kernel selection of the copy functions */
+static unsigned bench_cpu;
+#define vlc_CPU() bench_cpu
+#include "../modules/video_chroma/copy.c"
+
+/* After copy.c, as it includes config.h again */
+#undef NDEBUG
+#include <assert.h>
+
+#define WIDTH  3840
+#define HEIGHT 2160
+#define PITCH  (WIDTH + 64)
+#define RUNS   100
+
+static const struct
+{
+    char     name[8];
+    unsigned flags;
+} kernels[] = {
+    { "SSE2",   VLC_CPU_SSE2 },
+    { "SSSE3",  VLC_CPU_SSE2 | VLC_CPU_SSSE3 },
+    { "SSE4.1", VLC_CPU_SSE2 | VLC_CPU_SSSE3 | VLC_CPU_SSE4_1 },
+#ifdef CAN_COMPILE_AVX2
+    { "AVX2",   VLC_CPU_SSE2 | VLC_CPU_SSSE3 | VLC_CPU_SSE4_1 | VLC_CPU_AVX2 },
+#endif
+};
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static picture_t *NewPicture(vlc_fourcc_t chroma)
+{
+    video_format_t fmt;
+
+    video_format_Setup(&fmt, chroma, WIDTH, HEIGHT, WIDTH, HEIGHT, 1, 1);
+    picture_t *pic = picture_NewFromFormat(&fmt);
+    assert(pic != NULL);
+    return pic;
+}
+
+static bool SamePictures(const picture_t *a, const picture_t *b)
+{
+    for (int i = 0; i < a->i_planes; i++)
+        for (int y = 0; y < a->p[i].i_visible_lines; y++)
+            if (memcmp(a->p[i].p_pixels + y * a->p[i].i_pitch,
+                       b->p[i].p_pixels + y * b->p[i].i_pitch,
+                       a->p[i].i_visible_pitch))
+                return false;
+    return true;
+}
+
+static double Bench(picture_t *yv12, picture_t *nv12, uint8_t *src[2],
+                    size_t pitch[2], copy_cache_t *cache)
+{
+    double start = now();
+
+    for (unsigned i = 0; i < RUNS; i++)
+    {
+        CopyFromNv12(yv12, src, pitch, WIDTH, HEIGHT, cache);
+        CopyFromNv12ToNv12(nv12, src, pitch, WIDTH, HEIGHT, cache);
+    }
+    return (now() - start) * 1000 / (2 * RUNS);
+}
+
+int main(void)
+{
+    /* Unaligned planes to cover the unaligned paths */
+    uint8_t *buf = malloc(PITCH * HEIGHT * 3 / 2 + 64);
+    assert(buf != NULL);
+
+    uint8_t *src[2] = { buf + 1, buf + 1 + PITCH * HEIGHT };
+    size_t pitch[2] = { PITCH, PITCH };
+    for (size_t i = 0; i < PITCH * HEIGHT * 3 / 2; i++)
+        src[0][i] = rand();
+
+    picture_t *ref_yv12 = NewPicture(VLC_CODEC_YV12);
+    picture_t *ref_nv12 = NewPicture(VLC_CODEC_NV12);
+    picture_t *yv12 = NewPicture(VLC_CODEC_YV12);
+    picture_t *nv12 = NewPicture(VLC_CODEC_NV12);
+
+    CopyPlane(ref_yv12->p[0].p_pixels, ref_yv12->p[0].i_pitch,
+              src[0], pitch[0], WIDTH, HEIGHT);
+    SplitPlanes(ref_yv12->p[2].p_pixels, ref_yv12->p[2].i_pitch,
+                ref_yv12->p[1].p_pixels, ref_yv12->p[1].i_pitch,
+                src[1], pitch[1], WIDTH / 2, HEIGHT / 2);
+    CopyPlane(ref_nv12->p[0].p_pixels, ref_nv12->p[0].i_pitch,
+              src[0], pitch[0], WIDTH, HEIGHT);
+    CopyPlane(ref_nv12->p[1].p_pixels, ref_nv12->p[1].i_pitch,
+              src[1], pitch[1], WIDTH, HEIGHT / 2);
+
+    /* The copy cache logs the start of its threads */
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    copy_cache_t cache;
+    int ret = CopyInitCache(VLC_OBJECT(vlc->p_libvlc_int), &cache, WIDTH);
+    assert(ret == VLC_SUCCESS);
+
+    const unsigned threads = cache.threads;
+    const char *best = NULL;
+    double best_ms = 0.;
+
+    for (size_t i = 0; i < ARRAY_SIZE(kernels); i++)
+    {
+        if ((kernels[i].flags & real_cpu()) != kernels[i].flags)
+            continue;
+        bench_cpu = kernels[i].flags;
+
+        for (cache.threads = 1; cache.threads <= threads; cache.threads++)
+        {
+            if (cache.threads > 1 && cache.threads < threads)
+                continue; /* only compare one thread with all threads */
+
+            CopyFromNv12(yv12, src, pitch, WIDTH, HEIGHT, &cache);
+            CopyFromNv12ToNv12(nv12, src, pitch, WIDTH, HEIGHT, &cache);
+            assert(SamePictures(yv12, ref_yv12));
+            assert(SamePictures(nv12, ref_nv12));
+
+            double ms = Bench(yv12, nv12, src, pitch, &cache);
+            printf("%-6s %u thread(s): %.2f ms/frame\n", kernels[i].name,
+                   cache.threads, ms);
+            if (best == NULL || ms < best_ms)
+            {
+                best = kernels[i].name;
+                best_ms = ms;
+            }
+        }
+    }
+    if (best != NULL)
+        printf("fastest: %s (%.2f ms/frame)\n", best, best_ms);
+
+    cache.threads = threads;
+    CopyCleanCache(&cache);
+    libvlc_release(vlc);
+    picture_Release(nv12);
+    picture_Release(yv12);
+    picture_Release(ref_nv12);
+    picture_Release(ref_yv12);
+    free(buf);
+    return 0;
+}
+#endif
@@ -0,0 +1,194 @@
+/*
+ * yuvscale.c - YUV scaler benchmark
+ */
+
+/**********************************************************************
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+/* Scales I420 and NV12 pictures down to mosaic and thumbnail sizes and up to
+ * 1080p, with the yuvscale filter in both of its modes, and with the scale
+ * and swscale filters when they are available, and reports the time per
+ * picture. The yuvscale pictures are checked: a horizontal luma ramp must
+ * stay a ramp and flat chroma planes must stay flat.
+ */
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <time.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_modules.h>
+#include <vlc_picture.h>
+
+#define RUNS 50
+
+static const struct
+{
+    unsigned src_width, src_height;
+    unsigned dst_width, dst_height;
+} sizes[] = {
+    { 1920, 1080,  480,  270 }, /* 4x4 mosaic */
+    { 1920, 1080,  160,   90 }, /* thumbnail */
+    {  720,  576, 1920, 1080 },
+};
+
+static double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static picture_t *NewPicture (filter_t *filter)
+{
+    return picture_NewFromFormat (&filter->fmt_out.video);
+}
+
+static filter_t *CreateScaler (vlc_object_t *obj, const char *name,
+                               vlc_fourcc_t chroma, unsigned i, int mode)
+{
+    filter_t *filter = vlc_object_create (obj, sizeof (*filter));
+    assert (filter != NULL);
+
+    es_format_Init (&filter->fmt_in, VIDEO_ES, chroma);
+    video_format_Setup (&filter->fmt_in.video, chroma,
+                        sizes[i].src_width, sizes[i].src_height,
+                        sizes[i].src_width, sizes[i].src_height, 1, 1);
+    es_format_Init (&filter->fmt_out, VIDEO_ES, chroma);
+    video_format_Setup (&filter->fmt_out.video, chroma,
+                        sizes[i].dst_width, sizes[i].dst_height,
+                        sizes[i].dst_width, sizes[i].dst_height, 1, 1);
+    filter->owner.video.buffer_new = NewPicture;
+
+    var_Create (filter, "yuvscale-mode", VLC_VAR_INTEGER);
+    var_SetInteger (filter, "yuvscale-mode", mode);
+
+    filter->p_module = module_need (filter, "video filter2", name, true);
+    if (filter->p_module == NULL)
+    {
+        es_format_Clean (&filter->fmt_out);
+        es_format_Clean (&filter->fmt_in);
+        vlc_object_release (filter);
+        return NULL;
+    }
+    return filter;
+}
+
+static void DeleteScaler (filter_t *filter)
+{
+    module_unneed (filter, filter->p_module);
+    es_format_Clean (&filter->fmt_out);
+    es_format_Clean (&filter->fmt_in);
+    vlc_object_release (filter);
+}
+
+static void Fill (picture_t *pic)
+{
+    const unsigned width = pic->format.i_visible_width;
+
+    for (int y = 0; y < pic->p[0].i_visible_lines; y++)
+        for (unsigned x = 0; x < width; x++)
+            pic->p[0].p_pixels[y * pic->p[0].i_pitch + x] =
+                x * 255 / (width - 1);
+
+    for (int i = 1; i < pic->i_planes; i++)
+        for (int y = 0; y < pic->p[i].i_visible_lines; y++)
+            for (int x = 0; x < pic->p[i].i_visible_pitch; x++)
+                pic->p[i].p_pixels[y * pic->p[i].i_pitch + x] =
+                    (pic->i_planes == 2 && (x & 1)) ? 200 : 100 + 10 * i;
+}
+
+static void Check (const picture_t *pic, unsigned src_width)
+{
+    const unsigned width = pic->format.i_visible_width;
+    const double scale = (double)src_width / width;
+
+    for (int y = 0; y < pic->p[0].i_visible_lines; y++)
+        for (unsigned x = 2; x + 2 < width; x++)
+        {
+            double c = (x + .5) * scale - .5;
+            double expected = VLC_CLIP (c, 0., src_width - 1.)
+                            * 255 / (src_width - 1);
+            double d = pic->p[0].p_pixels[y * pic->p[0].i_pitch + x]
+                     - expected;
+
+            assert (d >= -2. && d <= 2.);
+        }
+
+    for (int i = 1; i < pic->i_planes; i++)
+        for (int y = 0; y < pic->p[i].i_visible_lines; y++)
+            for (int x = 0; x < pic->p[i].i_visible_pitch; x++)
+                assert (pic->p[i].p_pixels[y * pic->p[i].i_pitch + x]
+                    == ((pic->i_planes == 2 && (x & 1)) ? 200 : 100 + 10 * i));
+}
+
+static void Bench (vlc_object_t *obj, const char *name, const char *desc,
+                   vlc_fourcc_t chroma, unsigned i, int mode)
+{
+    filter_t *filter = CreateScaler (obj, name, chroma, i, mode);
+    if (filter == NULL)
+        return;
+
+    picture_t *src = picture_NewFromFormat (&filter->fmt_in.video);
+    assert (src != NULL);
+    Fill (src);
+
+    double start = now ();
+    for (unsigned run = 0; run < RUNS; run++)
+    {
+        picture_t *dst = filter->pf_video_filter (filter, picture_Hold (src));
+        assert (dst != NULL);
+        if (run == 0 && !strcmp (name, "yuvscale"))
+            Check (dst, sizes[i].src_width);
+        picture_Release (dst);
+    }
+
+    log ("%4.4s %4ux%-4u -> %4ux%-4u %-10s %7.3f ms\n",
+         (const char *)&chroma, sizes[i].src_width, sizes[i].src_height,
+         sizes[i].dst_width, sizes[i].dst_height, desc,
+         (now () - start) * 1000 / RUNS);
+
+    picture_Release (src);
+    DeleteScaler (filter);
+}
+
+int main (void)
+{
+    static const vlc_fourcc_t chromas[] = { VLC_CODEC_I420, VLC_CODEC_NV12 };
+
+    setenv ("VLC_PLUGIN_PATH", "../modules", 0);
+
+    libvlc_instance_t *vlc = libvlc_new (test_defaults_nargs,
+                                         test_defaults_args);
+    assert (vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT (vlc->p_libvlc_int);
+
+    for (unsigned c = 0; c < ARRAY_SIZE (chromas); c++)
+        for (unsigned i = 0; i < ARRAY_SIZE (sizes); i++)
+        {
+            Bench (obj, "yuvscale", "bilinear", chromas[c], i, 0);
+            Bench (obj, "yuvscale", "bicubic", chromas[c], i, 1);
+            Bench (obj, "scale", "nearest", chromas[c], i, 0);
+            Bench (obj, "swscale", "swscale", chromas[c], i, 0);
+        }
+
+    libvlc_release (vlc);
+    return 0;
+}
@@ -0,0 +1,237 @@
+/*
+ * hqdn3d.c - HQ 3D denoiser microbenchmark
+ */
+
+/**********************************************************************
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+/* Denoises a sequence of noisy 1080p I420 frames with the default
+ * strengths, and with the temporal filter only, planes in turn on one
+ * thread as the filter used to, then the way the filter does now: the
+ * planes concurrently, or bands of lines for the temporal filter only.
+ * Checks the frames are bit-exact and reports the time per frame.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vlc/vlc.h>
+#include <vlc_common.h>
+#include <vlc_filter.h>
+
+#include "../lib/libvlc_internal.h"
+#include "../modules/video_filter/hqdn3d.h"
+
+#undef NDEBUG
+#include <assert.h>
+
+#define WIDTH  1920
+#define HEIGHT 1080
+#define FRAMES 8
+#define RUNS   5
+
+static const int widths[3] = { WIDTH, WIDTH / 2, WIDTH / 2 };
+static const int heights[3] = { HEIGHT, HEIGHT / 2, HEIGHT / 2 };
+
+typedef struct
+{
+    struct vf_priv_s *cfg;
+    unsigned char    *src[3];
+    unsigned char    *dst[3];
+} frame_t;
+
+static int *Coefs(struct vf_priv_s *cfg, int plane, bool temporal)
+{
+    return cfg->Coefs[(plane ? 2 : 0) + temporal];
+}
+
+/* As FilterPlane() in the filter */
+static void Plane(void *opaque, unsigned plane, unsigned planes)
+{
+    const frame_t *f = opaque;
+    int *spatial = Coefs(f->cfg, plane, false);
+    (void) planes;
+
+    deNoise(f->src[plane], f->dst[plane], f->cfg->Line[plane],
+            &f->cfg->Frame[plane], widths[plane], heights[plane],
+            widths[plane], widths[plane],
+            spatial, spatial, Coefs(f->cfg, plane, true));
+}
+
+/* As FilterTemporalSlice() in the filter */
+static void TemporalSlice(void *opaque, unsigned slice, unsigned slices)
+{
+    const frame_t *f = opaque;
+
+    for (int i = 0; i < 3; i++)
+    {
+        int first, end;
+
+        filter_GetSliceLines(heights[i], slice, slices, &first, &end);
+        deNoiseTemporal(f->src[i] + first * widths[i],
+                        f->dst[i] + first * widths[i],
+                        f->cfg->Frame[i] + first * widths[i],
+                        widths[i], end - first, widths[i], widths[i],
+                        Coefs(f->cfg, i, true));
+    }
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static struct vf_priv_s *NewConfig(double spatial, bool shared_line)
+{
+    struct vf_priv_s *cfg = calloc(1, sizeof (*cfg));
+    assert(cfg != NULL);
+
+    PrecalcCoefs(cfg->Coefs[0], spatial);
+    PrecalcCoefs(cfg->Coefs[1], PARAM3_DEFAULT);
+    PrecalcCoefs(cfg->Coefs[2], spatial * PARAM2_DEFAULT / PARAM1_DEFAULT);
+    PrecalcCoefs(cfg->Coefs[3], PARAM3_DEFAULT * PARAM2_DEFAULT / PARAM1_DEFAULT);
+    for (int i = 0; i < 3; i++)
+    {
+        /* The filter used to share one line buffer between the planes */
+        cfg->Line[i] = (shared_line && i > 0) ? cfg->Line[0]
+                                              : malloc(WIDTH * sizeof (int));
+        assert(cfg->Line[i] != NULL);
+    }
+    return cfg;
+}
+
+static void DeleteConfig(struct vf_priv_s *cfg, bool shared_line)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        free(cfg->Frame[i]);
+        if (!shared_line || i == 0)
+            free(cfg->Line[i]);
+    }
+    free(cfg);
+}
+
+/* Denoises the frames, and returns the time per frame in ms */
+static double Run(filter_slices_t *slices, struct vf_priv_s *cfg,
+                  unsigned char *const *in, unsigned char **out, bool threaded)
+{
+    double start = now();
+
+    for (unsigned n = 0; n < FRAMES; n++)
+    {
+        frame_t f = { .cfg = cfg };
+
+        for (int i = 0; i < 3; i++)
+        {
+            f.src[i] = in[n * 3 + i];
+            f.dst[i] = out[n * 3 + i];
+            assert(deNoisePrevFrame(f.src[i], &cfg->Frame[i],
+                                    widths[i], heights[i], widths[i]));
+        }
+
+        if (!threaded)
+            for (unsigned i = 0; i < 3; i++)
+                Plane(&f, i, 3);
+        else if (!cfg->Coefs[0][0] && !cfg->Coefs[2][0])
+            filter_RunSlices(slices, HEIGHT, TemporalSlice, &f);
+        else
+            filter_RunTasks(slices, 3, Plane, &f);
+    }
+    return (now() - start) * 1000 / FRAMES;
+}
+
+int main(void)
+{
+    setenv("VLC_PLUGIN_PATH", "../modules", 0);
+
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+
+    unsigned char *in[FRAMES * 3], *ref[FRAMES * 3], *out[FRAMES * 3];
+
+    /* Noise on a moving gradient */
+    for (unsigned n = 0; n < FRAMES; n++)
+        for (int i = 0; i < 3; i++)
+        {
+            size_t size = widths[i] * heights[i];
+            unsigned char *p = malloc(size);
+
+            assert(p != NULL);
+            for (int y = 0; y < heights[i]; y++)
+                for (int x = 0; x < widths[i]; x++)
+                    p[y * widths[i] + x] = x + y + 4 * n + (rand() & 15);
+            in[n * 3 + i] = p;
+            ref[n * 3 + i] = malloc(size);
+            out[n * 3 + i] = malloc(size);
+            assert(ref[n * 3 + i] != NULL && out[n * 3 + i] != NULL);
+        }
+
+    filter_slices_t *slices = filter_NewSlices(vlc->p_libvlc_int, 0);
+    assert(slices != NULL);
+
+    static const struct
+    {
+        const char *name;
+        double      spatial;
+    } modes[] = {
+        { "spatial and temporal", PARAM1_DEFAULT },
+        { "temporal only",        0. },
+    };
+
+    for (size_t m = 0; m < ARRAY_SIZE(modes); m++)
+    {
+        double ms_ref = 0., ms = 0.;
+
+        for (unsigned run = 0; run < RUNS; run++)
+        {
+            struct vf_priv_s *cfg_ref = NewConfig(modes[m].spatial, true);
+            struct vf_priv_s *cfg = NewConfig(modes[m].spatial, false);
+
+            ms_ref += Run(slices, cfg_ref, in, ref, false);
+            ms += Run(slices, cfg, in, out, true);
+
+            /* Every frame must be bit-exact */
+            for (unsigned i = 0; i < FRAMES * 3; i++)
+                assert(!memcmp(ref[i], out[i],
+                               widths[i % 3] * heights[i % 3]));
+
+            DeleteConfig(cfg, false);
+            DeleteConfig(cfg_ref, true);
+        }
+
+        printf("%-20s: %.2f ms/frame serial, %.2f ms/frame threaded\n",
+               modes[m].name, ms_ref / RUNS, ms / RUNS);
+    }
+
+    filter_DeleteSlices(slices);
+    for (unsigned i = 0; i < FRAMES * 3; i++)
+    {
+        free(out[i]);
+        free(ref[i]);
+        free(in[i]);
+    }
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,213 @@
+/*
+ * yadif.c - Yadif deinterlacer microbenchmark
+ */
+
+/**********************************************************************
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+/* Interpolates the fields of 1080i frames with each Yadif line filter that
+ * the CPU supports, on one thread and on one thread per CPU, checks the
+ * fields against the plain C filter and reports the time per field. Yadif
+ * renders one field per frame, and Yadif (2x) two.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <vlc/vlc.h>
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_filter.h>
+
+#include "../lib/libvlc_internal.h"
+#include "../modules/video_filter/deinterlace/common.h"
+#include "../modules/video_filter/deinterlace/yadif.h"
+
+/* After yadif.h, as it includes config.h again */
+#undef NDEBUG
+#include <assert.h>
+
+#define WIDTH  1920
+#define HEIGHT 1080
+#define PITCH  (WIDTH + 64)
+#define RUNS   50
+
+typedef void (*yadif_line_t)(uint8_t *, uint8_t *, uint8_t *, uint8_t *,
+                             int, int, int, int, int);
+
+static const struct
+{
+    char         name[8];
+    unsigned     flags;
+    yadif_line_t filter;
+} kernels[] = {
+    { "C",      0, yadif_filter_line_c },
+#ifdef HAVE_YADIF_MMX
+    { "MMX",    VLC_CPU_MMX, yadif_filter_line_mmx },
+#endif
+#ifdef HAVE_YADIF_SSE2
+    { "SSE2",   VLC_CPU_SSE2, yadif_filter_line_sse2 },
+#endif
+#ifdef HAVE_YADIF_SSSE3
+    { "SSSE3",  VLC_CPU_SSSE3, yadif_filter_line_ssse3 },
+#endif
+#ifdef HAVE_YADIF_AVX2
+    { "AVX2",   VLC_CPU_AVX2, yadif_filter_line_avx2 },
+#endif
+};
+
+typedef struct
+{
+    uint8_t     *dst;
+    uint8_t     *prev, *cur, *next;
+    yadif_line_t filter;
+    int          parity;
+} field_t;
+
+/* Interpolates the lines of one field, as RenderYadif() does */
+static void Field(void *opaque, unsigned slice, unsigned slices)
+{
+    const field_t *f = opaque;
+    int first, end;
+
+    filter_GetSliceLines(HEIGHT - 2, slice, slices, &first, &end);
+    for (int y = 1 + first; y < 1 + end; y++)
+    {
+        if ((y % 2) != f->parity)
+            continue;
+
+        int mode = (y >= 2 && y < HEIGHT - 2) ? 0 : 2;
+        f->filter(&f->dst[y * PITCH], &f->prev[y * PITCH],
+                  &f->cur[y * PITCH], &f->next[y * PITCH], WIDTH,
+                  y < HEIGHT - 2 ? PITCH : -PITCH,
+                  y - 1 ? -PITCH : PITCH, f->parity, mode);
+    }
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool SameFields(const uint8_t *a, const uint8_t *b)
+{
+    for (int y = 1; y < HEIGHT - 1; y++)
+        if (memcmp(a + y * PITCH, b + y * PITCH, WIDTH))
+            return false;
+    return true;
+}
+
+static uint8_t *NewFrame(void)
+{
+    /* Room for the reads and writes past the visible width */
+    uint8_t *buf = aligned_alloc(32, PITCH * (HEIGHT + 1));
+    assert(buf != NULL);
+    memset(buf, 0, PITCH * (HEIGHT + 1));
+    return buf;
+}
+
+int main(void)
+{
+    (void) yadif_filter_line_c_16bit;
+    setenv("VLC_PLUGIN_PATH", "../modules", 0);
+
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+
+    uint8_t *prev = NewFrame(), *cur = NewFrame(), *next = NewFrame();
+    uint8_t *ref = NewFrame(), *dst = NewFrame();
+
+    /* Moving noise on a gradient, so that both spatial and temporal
+     * predictions get used */
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++)
+        {
+            prev[y * PITCH + x] = x + y + (rand() & 15);
+            cur[y * PITCH + x] = x + y + (rand() & 31);
+            next[y * PITCH + x] = x - y + (rand() & 63);
+        }
+
+    filter_slices_t *mono = filter_NewSlices(vlc->p_libvlc_int, 1);
+    filter_slices_t *multi = filter_NewSlices(vlc->p_libvlc_int, 0);
+    assert(mono != NULL && multi != NULL);
+
+    const char *best = NULL;
+    double best_ms = 0.;
+
+    for (size_t i = 0; i < ARRAY_SIZE(kernels); i++)
+    {
+        if ((kernels[i].flags & vlc_CPU()) != kernels[i].flags)
+            continue;
+
+        for (int threaded = 0; threaded < 2; threaded++)
+        {
+            filter_slices_t *slices = threaded ? multi : mono;
+            field_t f = {
+                .dst = dst, .prev = prev, .cur = cur, .next = next,
+                .filter = kernels[i].filter,
+            };
+            field_t f_ref = f;
+
+            f_ref.dst = ref;
+            f_ref.filter = yadif_filter_line_c;
+            for (f.parity = 0; f.parity < 2; f.parity++)
+            {
+                f_ref.parity = f.parity;
+                memset(ref, 0, PITCH * HEIGHT);
+                memset(dst, 0, PITCH * HEIGHT);
+                Field(&f_ref, 0, 1);
+                filter_RunSlices(slices, HEIGHT, Field, &f);
+                assert(SameFields(ref, dst));
+            }
+
+            double start = now();
+            for (unsigned run = 0; run < RUNS; run++)
+            {
+                f.parity = run & 1;
+                filter_RunSlices(slices, HEIGHT, Field, &f);
+            }
+            double ms = (now() - start) * 1000 / RUNS;
+
+            printf("%-6s %s: %.2f ms/field\n", kernels[i].name,
+                   threaded ? "all threads" : "one thread ", ms);
+            if (best == NULL || ms < best_ms)
+            {
+                best = kernels[i].name;
+                best_ms = ms;
+            }
+        }
+    }
+    printf("fastest: %s (%.2f ms/field, %.2f ms/frame in Yadif (2x) mode)\n",
+           best, best_ms, 2 * best_ms);
+
+    filter_DeleteSlices(multi);
+    filter_DeleteSlices(mono);
+    free(dst);
+    free(ref);
+    free(next);
+    free(cur);
+    free(prev);
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,275 @@
+/*
+ * playback.c - end-to-end playback benchmark
+ */
+
+/**********************************************************************
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+/* Plays media through the whole pipeline, into the dummy video and audio
+ * outputs, at the highest rate the input allows and without dropping any
+ * frame. Each medium is played in a process of its own, so that the CPU
+ * time and the peak memory are its own.
+ *
+ * Synthetic Y4M video and WAV audio files are always played, so that the
+ * results can be compared without any sample; more media can be given as
+ * arguments or through the VLC_TEST_PLAYBACK_SAMPLES environment variable
+ * (colon-separated). The video claims 1000 frames per second, so that the
+ * clock does not limit it even at the highest rate.
+ *
+ * Each result is printed on its own line as "<medium>.<name> <value>
+ * <unit>", so that the output of two builds can be compared with a script.
+ */
+
+#include "../../libvlc/test.h"
+
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define Y4M_WIDTH  640
+#define Y4M_HEIGHT 360
+#define Y4M_FRAMES 250
+#define WAV_RATE    48000
+#define WAV_SECONDS 60
+
+static double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report (const char *medium, const char *name, double value,
+                    const char *unit)
+{
+    printf ("%s.%s %.3f %s\n", medium, name, value, unit);
+}
+
+static void write_y4m (const char *path)
+{
+    FILE *f = fopen (path, "wb");
+    assert (f != NULL);
+
+    static unsigned char frame[Y4M_WIDTH * Y4M_HEIGHT * 3 / 2];
+
+    fprintf (f, "YUV4MPEG2 W%d H%d F1000:1 Ip A1:1 C420jpeg\n",
+             Y4M_WIDTH, Y4M_HEIGHT);
+    for (unsigned n = 0; n < Y4M_FRAMES; n++)
+    {   /* Moving gradient, grey chroma */
+        for (unsigned y = 0; y < Y4M_HEIGHT; y++)
+            for (unsigned x = 0; x < Y4M_WIDTH; x++)
+                frame[y * Y4M_WIDTH + x] = x + y + n;
+        memset (frame + Y4M_WIDTH * Y4M_HEIGHT, 0x80,
+                Y4M_WIDTH * Y4M_HEIGHT / 2);
+        fputs ("FRAME\n", f);
+        assert (fwrite (frame, sizeof (frame), 1, f) == 1);
+    }
+    assert (fclose (f) == 0);
+}
+
+static void put_le32 (unsigned char *p, uint32_t v)
+{
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static void write_wav (const char *path)
+{
+    FILE *f = fopen (path, "wb");
+    assert (f != NULL);
+
+    const uint32_t size = WAV_RATE * WAV_SECONDS * 4;
+    unsigned char hdr[44] = "RIFF____WAVEfmt \x10\0\0\0\x01\0\x02\0"
+                            "________\x04\0\x10\0data____";
+
+    put_le32 (hdr + 4, 36 + size);
+    put_le32 (hdr + 24, WAV_RATE);
+    put_le32 (hdr + 28, WAV_RATE * 4);
+    put_le32 (hdr + 40, size);
+    assert (fwrite (hdr, sizeof (hdr), 1, f) == 1);
+
+    /* Sawtooth, 16-bit stereo */
+    for (uint32_t i = 0; i < WAV_RATE * WAV_SECONDS; i++)
+    {
+        unsigned char s[4] = { i, i >> 2, i, i >> 2 };
+        assert (fwrite (s, sizeof (s), 1, f) == 1);
+    }
+    assert (fclose (f) == 0);
+}
+
+static const struct
+{
+    const char *name;
+    libvlc_latency_stage_t stage;
+} stages[] = {
+    { "demux",   libvlc_latency_demux },
+    { "decode",  libvlc_latency_decode },
+    { "filter",  libvlc_latency_filter },
+    { "render",  libvlc_latency_render },
+    { "display", libvlc_latency_display },
+};
+
+/* Reports the total time spent in each stage, estimated from the middle of
+ * the histogram buckets */
+static void report_stages (libvlc_instance_t *vlc, const char *medium)
+{
+    for (size_t i = 0; i < sizeof (stages) / sizeof (stages[0]); i++)
+    {
+        uint64_t counts[LIBVLC_LATENCY_BUCKETS];
+        int n = libvlc_latency_histogram (vlc, stages[i].stage, counts,
+                                          LIBVLC_LATENCY_BUCKETS);
+        double total = 0.;
+
+        assert (n > 0);
+        for (int b = 0; b < n; b++)
+            total += counts[b] * (b ? 1.5 * (UINT64_C(1) << (b - 1)) : .5);
+
+        char name[32];
+        snprintf (name, sizeof (name), "%s_time", stages[i].name);
+        report (medium, name, total / 1000., "ms");
+    }
+}
+
+/* Plays a medium to the end, in the current process */
+static void play (const char *path, const char *medium)
+{
+    static const char *args[] = {
+        "--ignore-config", "-I", "dummy", "--no-media-library",
+        "--vout=dummy", "--aout=dummy", "--no-video-title-show",
+        "--rate=32", "--no-drop-late-frames", "--no-skip-frames",
+        "--stats", "--latency-stats",
+    };
+    libvlc_instance_t *vlc = libvlc_new (sizeof (args) / sizeof (args[0]),
+                                         args);
+    assert (vlc != NULL);
+
+    libvlc_media_t *media = libvlc_media_new_path (vlc, path);
+    assert (media != NULL);
+
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media (media);
+    assert (mp != NULL);
+
+    double start = now ();
+
+    libvlc_media_player_play (mp);
+
+    libvlc_state_t state;
+    do
+    {
+        usleep (10000);
+        state = libvlc_media_player_get_state (mp);
+    }
+    while (state != libvlc_Ended && state != libvlc_Error);
+
+    double elapsed = now () - start;
+    libvlc_media_stats_t stats;
+
+    assert (state == libvlc_Ended);
+    assert (libvlc_media_get_stats (media, &stats));
+
+    report (medium, "time", elapsed, "s");
+    report (medium, "demux_throughput",
+            stats.i_demux_read_bytes * 8 / elapsed / 1e6, "Mbit/s");
+    report (medium, "video_fps", stats.i_decoded_video / elapsed, "frames/s");
+    report (medium, "audio_blocks", stats.i_decoded_audio / elapsed,
+            "blocks/s");
+    report (medium, "lost_pictures", stats.i_lost_pictures, "frames");
+    report_stages (vlc, medium);
+
+    libvlc_media_player_stop (mp);
+    libvlc_media_player_release (mp);
+    libvlc_media_release (media);
+    libvlc_release (vlc);
+}
+
+/* Plays a medium in a child process, and reports its resource usage */
+static int bench (const char *path)
+{
+    const char *medium = strrchr (path, '/');
+    medium = (medium != NULL) ? medium + 1 : path;
+
+    fprintf (stderr, "playing %s\n", path);
+    fflush (stdout);
+
+    pid_t pid = fork ();
+    assert (pid != -1);
+    if (pid == 0)
+    {
+        alarm (600);
+        play (path, medium);
+        fflush (stdout);
+        _exit (0);
+    }
+
+    struct rusage ru;
+    int status;
+
+    assert (wait4 (pid, &status, 0, &ru) == pid);
+    if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    {
+        fprintf (stderr, "playing %s failed\n", path);
+        return -1;
+    }
+
+    report (medium, "cpu_user",
+            ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6, "s");
+    report (medium, "cpu_system",
+            ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6, "s");
+    report (medium, "peak_memory", ru.ru_maxrss / 1024., "MiB");
+    return 0;
+}
+
+int main (int argc, char *argv[])
+{
+    setenv ("VLC_PLUGIN_PATH", "../modules", 0);
+
+    const char *tmp = getenv ("TMPDIR");
+    char dir[256], y4m[300], wav[300];
+
+    snprintf (dir, sizeof (dir), "%s/vlc-bench-XXXXXX",
+              (tmp != NULL) ? tmp : "/tmp");
+    assert (mkdtemp (dir) != NULL);
+    snprintf (y4m, sizeof (y4m), "%s/synthetic.y4m", dir);
+    snprintf (wav, sizeof (wav), "%s/synthetic.wav", dir);
+    write_y4m (y4m);
+    write_wav (wav);
+
+    int ret = 0;
+
+    if (bench (y4m) || bench (wav))
+        ret = 1;
+    unlink (wav);
+    unlink (y4m);
+    rmdir (dir);
+
+    for (int i = 1; i < argc; i++)
+        if (bench (argv[i]))
+            ret = 1;
+
+    char *list = getenv ("VLC_TEST_PLAYBACK_SAMPLES");
+    if (list != NULL && (list = strdup (list)) != NULL)
+    {
+        char *saveptr;
+
+        for (char *path = strtok_r (list, ":", &saveptr); path != NULL;
+             path = strtok_r (NULL, ":", &saveptr))
+            if (bench (path))
+                ret = 1;
+        free (list);
+    }
+    return ret;
+}
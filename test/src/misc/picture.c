@@ -0,0 +1,118 @@
+/*****************************************************************************
+ * picture.c: test for the picture views
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+
+static void test_view( vlc_fourcc_t chroma, unsigned x, unsigned y )
+{
+    video_format_t fmt, crop;
+    video_format_Setup( &fmt, chroma, 1920, 1080, 1920, 1080, 1, 1 );
+    video_format_Setup( &crop, chroma, 480, 270, 480, 270, 1, 1 );
+
+    picture_t *pic = picture_NewFromFormat( &fmt );
+    assert( pic != NULL );
+    pic->date = 42;
+
+    picture_t *view = picture_NewView( pic, &crop, x, y );
+    assert( view != NULL );
+    assert( view->i_planes == pic->i_planes );
+    assert( view->date == 42 );
+
+    const vlc_chroma_description_t *dsc =
+        vlc_fourcc_GetChromaDescription( chroma );
+    for( int i = 0; i < pic->i_planes; i++ )
+    {
+        const plane_t *p = &pic->p[i], *v = &view->p[i];
+        const unsigned px = x * dsc->p[i].w.num / dsc->p[i].w.den;
+        const unsigned py = y * dsc->p[i].h.num / dsc->p[i].h.den;
+
+        /* The view shares the pixels of the source */
+        assert( v->p_pixels == p->p_pixels + py * p->i_pitch
+                                           + px * p->i_pixel_pitch );
+        assert( v->i_pitch == p->i_pitch );
+        assert( v->i_visible_lines <= p->i_lines - (int)py );
+    }
+
+    /* The view keeps the source alive */
+    picture_Release( pic );
+    assert( !picture_IsReferenced( view ) );
+    picture_Release( view );
+}
+
+static void test_reference( void )
+{
+    picture_t *pic = picture_New( VLC_CODEC_I420, 64, 64, 1, 1 );
+    assert( pic != NULL );
+
+    picture_t *view = picture_NewView( pic, &pic->format, 0, 0 );
+    assert( view != NULL );
+    assert( picture_IsReferenced( pic ) );
+    picture_Release( view );
+    assert( !picture_IsReferenced( pic ) );
+
+    /* The chroma cannot change */
+    video_format_t fmt = pic->format;
+    fmt.i_chroma = VLC_CODEC_RGB32;
+    assert( picture_NewView( pic, &fmt, 0, 0 ) == NULL );
+    picture_Release( pic );
+}
+
+static void test_big( void )
+{
+    video_format_t fmt;
+    video_format_Setup( &fmt, VLC_CODEC_I420, 3840, 2160, 3840, 2160, 1, 1 );
+
+    picture_t *pic = picture_NewFromFormat( &fmt );
+    assert( pic != NULL );
+    assert( ((uintptr_t)pic->p[0].p_pixels & 63) == 0 );
+    memset( pic->p[0].p_pixels, 0x10, pic->p[0].i_pitch * pic->p[0].i_lines );
+
+    /* The buffer of a big picture is reused by the next one of its size */
+    uint8_t *pixels = pic->p[0].p_pixels;
+    picture_Release( pic );
+    pic = picture_NewFromFormat( &fmt );
+    assert( pic != NULL );
+    assert( pic->p[0].p_pixels == pixels );
+    picture_Release( pic );
+}
+
+int main( void )
+{
+    test_init();
+
+    log( "Testing planar views\n" );
+    test_view( VLC_CODEC_I420, 0, 0 );
+    test_view( VLC_CODEC_I420, 1440, 810 );
+    test_view( VLC_CODEC_I422, 480, 270 );
+    log( "Testing packed views\n" );
+    test_view( VLC_CODEC_RGB32, 960, 540 );
+    test_view( VLC_CODEC_YUYV, 480, 0 );
+    log( "Testing view references\n" );
+    test_reference();
+    log( "Testing big pictures\n" );
+    test_big();
+
+    return 0;
+}
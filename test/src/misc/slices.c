@@ -0,0 +1,146 @@
+/*****************************************************************************
+ * slices.c: test for the slice-parallel filter helpers
+ *****************************************************************************
+ * Copyright (C) 2016 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_filter.h>
+
+#define LINES 2160
+
+typedef struct
+{
+    unsigned lines;
+    unsigned char count[LINES];
+    unsigned slices;
+} slice_test_t;
+
+/* Marks every line of the slice once */
+static void Slice( void *opaque, unsigned slice, unsigned slices )
+{
+    slice_test_t *t = opaque;
+    int first, end;
+
+    assert( slice < slices );
+    filter_GetSliceLines( t->lines, slice, slices, &first, &end );
+    assert( first <= end );
+    for( int i = first; i < end; i++ )
+        t->count[i]++;
+    if( slice == 0 )
+        t->slices = slices;
+}
+
+static void test_slices( vlc_object_t *obj, unsigned threads )
+{
+    filter_slices_t *slices = filter_NewSlices( obj, threads );
+    assert( slices != NULL );
+
+    slice_test_t t;
+    for( unsigned lines = 0; lines <= LINES; lines += 97 )
+    {
+        for( unsigned run = 0; run < 10; run++ )
+        {
+            memset( t.count, 0, sizeof (t.count) );
+            t.lines = lines;
+            filter_RunSlices( slices, lines, Slice, &t );
+
+            /* Every line must be processed exactly once */
+            for( unsigned i = 0; i < LINES; i++ )
+                assert( t.count[i] == (i < lines) );
+            /* Small pictures shall not be split */
+            if( lines < 64 )
+                assert( t.slices == 1 );
+        }
+    }
+
+    /* Tasks are never merged nor split */
+    for( unsigned tasks = 0; tasks <= 20; tasks++ )
+    {
+        memset( t.count, 0, sizeof (t.count) );
+        t.lines = tasks;
+        t.slices = 0;
+        filter_RunTasks( slices, tasks, Slice, &t );
+
+        for( unsigned i = 0; i < LINES; i++ )
+            assert( t.count[i] == (i < tasks) );
+        if( tasks > 0 )
+            assert( t.slices == tasks );
+    }
+
+    filter_DeleteSlices( slices );
+}
+
+static void test_slice_picture( void )
+{
+    video_format_t fmt;
+    video_format_Setup( &fmt, VLC_CODEC_I420, 64, 99, 64, 99, 1, 1 );
+
+    picture_t *pic = picture_NewFromFormat( &fmt );
+    assert( pic != NULL );
+
+    for( unsigned slices = 1; slices <= 4; slices++ )
+    {
+        int lines[PICTURE_PLANE_MAX] = { 0 };
+
+        for( unsigned slice = 0; slice < slices; slice++ )
+        {
+            picture_t view;
+
+            filter_SlicePicture( &view, pic, slice, slices );
+            for( int i = 0; i < pic->i_planes; i++ )
+            {
+                /* Bands are contiguous and cover every visible line */
+                assert( view.p[i].p_pixels == pic->p[i].p_pixels
+                                              + lines[i] * pic->p[i].i_pitch );
+                assert( view.p[i].i_pitch == pic->p[i].i_pitch );
+                lines[i] += view.p[i].i_visible_lines;
+            }
+        }
+        for( int i = 0; i < pic->i_planes; i++ )
+            assert( lines[i] == pic->p[i].i_visible_lines );
+    }
+
+    picture_Release( pic );
+}
+
+int main( void )
+{
+    libvlc_instance_t *p_vlc;
+
+    test_init();
+
+    p_vlc = libvlc_new( test_defaults_nargs, test_defaults_args );
+    assert( p_vlc != NULL );
+
+    vlc_object_t *obj = VLC_OBJECT(p_vlc->p_libvlc_int);
+
+    log( "Testing slices on the calling thread only\n" );
+    test_slices( obj, 1 );
+    log( "Testing slices on 4 threads\n" );
+    test_slices( obj, 4 );
+    log( "Testing slices on one thread per CPU\n" );
+    test_slices( obj, 0 );
+    log( "Testing picture slices\n" );
+    test_slice_picture();
+
+    libvlc_release( p_vlc );
+
+    return 0;
+}
@@ -212,6 +212,58 @@ static void test_callbacks( libvlc_int_t *p_libvlc )
         var_Destroy( p_libvlc, psz_var_name[i] );
 }
 
+static void test_handles( libvlc_int_t *p_libvlc )
+{
+    vlc_var_handle_t *h;
+    vlc_value_t val;
+
+    assert( var_GetHandle( p_libvlc, "a" ) == NULL );
+
+    var_Create( p_libvlc, "a", VLC_VAR_INTEGER );
+    var_AddCallback( p_libvlc, "a", callback, psz_var_name );
+    h = var_GetHandle( p_libvlc, "a" );
+    assert( h != NULL );
+    assert( var_HandleGetInteger( h ) == 0 );
+
+    /* Values set by name are seen through the handle, and vice versa */
+    var_SetInteger( p_libvlc, "a", 42 );
+    assert( var_HandleGetInteger( h ) == 42 );
+    val.i_int = 4212;
+    var_HandleSet( p_libvlc, h, val );
+    assert( var_GetInteger( p_libvlc, "a" ) == 4212 );
+    assert( var_value[0].i_int == 4212 ); /* callback triggered */
+    var_IncInteger( p_libvlc, "a" );
+    assert( var_HandleGetInteger( h ) == 4213 );
+    val.i_int = 12;
+    var_Change( p_libvlc, "a", VLC_VAR_SETVALUE, &val, NULL );
+    assert( var_HandleGetInteger( h ) == 12 );
+    val.i_int = 10;
+    var_Change( p_libvlc, "a", VLC_VAR_SETMAX, &val, NULL );
+    assert( var_HandleGetInteger( h ) == 10 );
+    var_DelCallback( p_libvlc, "a", callback, psz_var_name );
+
+    /* The handle keeps the variable alive */
+    var_Destroy( p_libvlc, "a" );
+    assert( var_HandleGetInteger( h ) == 10 );
+    var_ReleaseHandle( p_libvlc, h );
+    assert( var_Type( p_libvlc, "a" ) == 0 );
+
+    var_Create( p_libvlc, "a", VLC_VAR_FLOAT );
+    h = var_GetHandle( p_libvlc, "a" );
+    var_SetFloat( p_libvlc, "a", 2.5f );
+    assert( var_HandleGetFloat( h ) == 2.5f );
+    var_ReleaseHandle( p_libvlc, h );
+    var_Destroy( p_libvlc, "a" );
+
+    var_Create( p_libvlc, "a", VLC_VAR_BOOL );
+    h = var_GetHandle( p_libvlc, "a" );
+    assert( !var_HandleGetBool( h ) );
+    var_ToggleBool( p_libvlc, "a" );
+    assert( var_HandleGetBool( h ) );
+    var_ReleaseHandle( p_libvlc, h );
+    var_Destroy( p_libvlc, "a" );
+}
+
 static void test_limits( libvlc_int_t *p_libvlc )
 {
     vlc_value_t val;
@@ -405,6 +457,9 @@ static void test_variables( libvlc_instance_t *p_vlc )
     log( "Testing the callbacks\n" );
     test_callbacks( p_libvlc );
 
+    log( "Testing the handles\n" );
+    test_handles( p_libvlc );
+
     log( "Testing the limits\n" );
     test_limits( p_libvlc );
 